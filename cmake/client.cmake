@@ -18,14 +18,21 @@ set(CLIENT_SOURCES
     ${SOURCE_DIR}/client/cl_net_chan.c
     ${SOURCE_DIR}/client/cl_parse.c
     ${SOURCE_DIR}/client/cl_scrn.c
+    ${SOURCE_DIR}/client/cl_seek.c
+    ${SOURCE_DIR}/client/cl_export.c
+    ${SOURCE_DIR}/client/cl_pacing.c
     ${SOURCE_DIR}/client/cl_ui.c
     ${SOURCE_DIR}/client/cl_avi.c
+    ${SOURCE_DIR}/client/cl_bench.c
+    ${SOURCE_DIR}/client/cl_voip.c
     ${SOURCE_DIR}/client/libmumblelink.c
     ${SOURCE_DIR}/client/snd_altivec.c
     ${SOURCE_DIR}/client/snd_adpcm.c
     ${SOURCE_DIR}/client/snd_dma.c
     ${SOURCE_DIR}/client/snd_mem.c
+    ${SOURCE_DIR}/client/snd_registry.c
     ${SOURCE_DIR}/client/snd_mix.c
+    ${SOURCE_DIR}/client/snd_occlusion.c
     ${SOURCE_DIR}/client/snd_wavelet.c
     ${SOURCE_DIR}/client/snd_main.c
     ${SOURCE_DIR}/client/snd_codec.c
@@ -0,0 +1,24 @@
+# Collision benchmark, the engine's cm_*.c on their own with stand-ins
+# for the rest of qcommon
+
+if(NOT BUILD_CMBENCH)
+    return()
+endif()
+
+include(utils/set_output_dirs)
+
+set(CMBENCH_SOURCES
+    ${SOURCE_DIR}/tools/cmbench/cmbench.c
+    ${SOURCE_DIR}/qcommon/cm_load.c
+    ${SOURCE_DIR}/qcommon/cm_patch.c
+    ${SOURCE_DIR}/qcommon/cm_polylib.c
+    ${SOURCE_DIR}/qcommon/cm_test.c
+    ${SOURCE_DIR}/qcommon/cm_trace.c
+    ${SOURCE_DIR}/qcommon/md4.c
+    ${SOURCE_DIR}/qcommon/q_math.c
+    ${SOURCE_DIR}/qcommon/q_shared.c
+)
+
+add_executable(cmbench ${CMBENCH_SOURCES})
+target_link_libraries(cmbench PRIVATE ${COMMON_LIBRARIES})
+set_output_dirs(cmbench)
@@ -0,0 +1,27 @@
+# Snapshot encode / decode benchmark, the engine's msg.c on its own with
+# stand-ins for the rest of qcommon
+
+if(NOT BUILD_MSGBENCH)
+    return()
+endif()
+
+include(utils/set_output_dirs)
+
+set(MSGBENCH_SOURCES
+    ${SOURCE_DIR}/tools/msgbench/msgbench.c
+    ${SOURCE_DIR}/qcommon/msg.c
+    ${SOURCE_DIR}/qcommon/huffman.c
+    ${SOURCE_DIR}/qcommon/deflate.c
+    ${SOURCE_DIR}/qcommon/q_math.c
+    ${SOURCE_DIR}/qcommon/q_shared.c
+)
+
+if(USE_INTERNAL_ZLIB)
+    list(APPEND MSGBENCH_SOURCES ${ZLIB_SOURCES})
+endif()
+
+add_executable(msgbench ${MSGBENCH_SOURCES})
+target_include_directories(msgbench PRIVATE ${ZLIB_INCLUDE_DIRS})
+target_compile_definitions(msgbench PRIVATE ${ZLIB_DEFINITIONS})
+target_link_libraries(msgbench PRIVATE ${COMMON_LIBRARIES} ${ZLIB_LIBRARIES})
+set_output_dirs(msgbench)
@@ -20,3 +20,12 @@ list(APPEND COMMON_LIBRARIES
     ${CMAKE_DL_LIBS}    # Dynamic loader
     m                   # Math library
 )
+
+if(CMAKE_SYSTEM_NAME STREQUAL "Linux")
+    list(APPEND COMMON_LIBRARIES rt) # shm_open before glibc 2.34
+endif()
+
+if(NOT EMSCRIPTEN)
+    find_package(Threads REQUIRED)
+    list(APPEND COMMON_LIBRARIES Threads::Threads) # Job threads
+endif()
@@ -13,12 +13,16 @@ set(COMMON_SOURCES
     ${SOURCE_DIR}/qcommon/common.c
     ${SOURCE_DIR}/qcommon/cvar.c
     ${SOURCE_DIR}/qcommon/files.c
+    ${SOURCE_DIR}/qcommon/jobs.c
+    ${SOURCE_DIR}/qcommon/writer.c
+    ${SOURCE_DIR}/qcommon/profile.c
     ${SOURCE_DIR}/qcommon/md4.c
     ${SOURCE_DIR}/qcommon/md5.c
     ${SOURCE_DIR}/qcommon/msg.c
     ${SOURCE_DIR}/qcommon/net_chan.c
     ${SOURCE_DIR}/qcommon/net_ip.c
     ${SOURCE_DIR}/qcommon/huffman.c
+    ${SOURCE_DIR}/qcommon/deflate.c
     ${SOURCE_DIR}/qcommon/q_math.c
     ${SOURCE_DIR}/qcommon/q_shared.c
     ${SOURCE_DIR}/qcommon/unzip.c
@@ -46,6 +50,9 @@ set(SERVER_SOURCES
     ${SOURCE_DIR}/server/sv_ccmds.c
     ${SOURCE_DIR}/server/sv_game.c
     ${SOURCE_DIR}/server/sv_init.c
+    ${SOURCE_DIR}/server/sv_loadtest.c
+    ${SOURCE_DIR}/server/sv_demo.c
+    ${SOURCE_DIR}/server/sv_http.c
     ${SOURCE_DIR}/server/sv_main.c
     ${SOURCE_DIR}/server/sv_net_chan.c
     ${SOURCE_DIR}/server/sv_snapshot.c
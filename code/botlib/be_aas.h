@@ -145,6 +145,7 @@ typedef struct aas_entityinfo_s
 	int		weapon;			// determines weapon and flash model, etc
 	int		legsAnim;		// mask off ANIM_TOGGLEBIT
 	int		torsoAnim;		// mask off ANIM_TOGGLEBIT
+	int		areanum;		// area the origin is in
 } aas_entityinfo_t;
 
 // area info
@@ -126,7 +126,8 @@ typedef struct aas_settings_s
 typedef struct aas_routingcache_s
 {
 	byte type;									//portal or area cache
-	float time;									//last time accessed or updated
+	byte referenced;							//looked up since the clock hand last passed
+	float time;									//time the cache was created
 	int size;									//size of the routing cache
 	int cluster;								//cluster the cache is for
 	int areanum;								//area the cache is created for
@@ -134,7 +135,7 @@ typedef struct aas_routingcache_s
 	float starttraveltime;						//travel time to start with
 	int travelflags;							//combinations of the travel flags
 	struct aas_routingcache_s *prev, *next;
-	struct aas_routingcache_s *time_prev, *time_next;
+	struct aas_routingcache_s *clock_prev, *clock_next;
 	unsigned char *reachabilities;				//reachabilities used for routing
 	unsigned short int traveltimes[1];			//travel time for every area (variable sized)
 } aas_routingcache_t;
@@ -255,14 +256,18 @@ typedef struct aas_s
 	//array of size numclusters with cluster cache
 	aas_routingcache_t ***clusterareacache;
 	aas_routingcache_t **portalcache;
-	//cache list sorted on time
-	aas_routingcache_t *oldestcache;		// start of cache list sorted on time
-	aas_routingcache_t *newestcache;		// end of cache list sorted on time
+	//ring of all routing cache, swept by the clock hand when evicting
+	aas_routingcache_t *clockhand;
+	//routing cache read from a route cache dump, used in place
+	byte *routecacheblock;
+	int routecacheblocksize;
 	//maximum travel time through portal areas
 	int *portalmaxtraveltimes;
 	//areas the reachabilities go through
 	int *reachabilityareaindex;
 	aas_reachabilityareas_t *reachabilityareas;
+	//run start points of the jump reachabilities
+	vec3_t *reachabilityrunstarts;
 } aas_t;
 
 #define AASINTERN
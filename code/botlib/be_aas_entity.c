@@ -141,6 +141,11 @@ int AAS_UpdateEntity(int entnum, bot_entitystate_t *state)
 		VectorCopy(state->origin, ent->i.origin);
 		relink = qtrue;
 	} //end if
+	//keep track of the area the origin is in, the old area is the hint
+	if (relink || !ent->i.areanum)
+	{
+		ent->i.areanum = AAS_PointAreaNumHint(ent->i.origin, ent->i.areanum);
+	} //end if
 	//if the entity should be relinked
 	if (relink)
 	{
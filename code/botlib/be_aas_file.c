@@ -353,7 +353,9 @@ int AAS_LoadAASFile(char *filename)
 	botimport.FS_FOpenFile( filename, &fp, FS_READ );
 	if (!fp)
 	{
-		AAS_Error("can't open %s\n", filename);
+		//CoD1 maps ship without area awareness, the .aas has to be compiled
+		//with bspc from a Q3 style conversion of the map
+		botimport.Print(PRT_WARNING, "no %s, bots can't move on this map\n", filename);
 		return BLERR_CANNOTOPENAASFILE;
 	} //end if
 	//read the header
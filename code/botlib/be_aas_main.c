@@ -249,7 +249,7 @@ int AAS_LoadFiles(const char *mapname)
 //===========================================================================
 int AAS_LoadMap(const char *mapname)
 {
-	int	errnum;
+	int	errnum, memcategory;
 
 	//if no mapname is provided then the string indexes are updated
 	if (!mapname)
@@ -263,7 +263,9 @@ int AAS_LoadMap(const char *mapname)
 	// and number of areas in a clusters must be available
 	AAS_FreeRoutingCaches();
 	//load the map
+	memcategory = BeginMemoryPhase(MEMCAT_AAS);
 	errnum = AAS_LoadFiles(mapname);
+	EndMemoryPhase(memcategory);
 	if (errnum != BLERR_NOERROR)
 	{
 		aasworld.loaded = qfalse;
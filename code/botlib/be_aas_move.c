@@ -281,6 +281,61 @@ void AAS_JumpReachRunStart(aas_reachability_t *reach, vec3_t runstart)
 	} //end if
 } //end of the function AAS_JumpReachRunStart
 //===========================================================================
+// the run start points only depend on the reachability, so they're
+// predicted once for all jump reachabilities instead of every frame a
+// bot travels one
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+void AAS_InitJumpReachRunStarts(void)
+{
+	int i;
+	aas_reachability_t *reach;
+
+	AAS_FreeJumpReachRunStarts();
+	aasworld.reachabilityrunstarts = (vec3_t *) GetClearedMemory(aasworld.reachabilitysize * sizeof(vec3_t));
+	for (i = 0; i < aasworld.reachabilitysize; i++)
+	{
+		reach = &aasworld.reachability[i];
+		if ((reach->traveltype & TRAVELTYPE_MASK) != TRAVEL_JUMP) continue;
+		AAS_JumpReachRunStart(reach, aasworld.reachabilityrunstarts[i]);
+	} //end for
+} //end of the function AAS_InitJumpReachRunStarts
+//===========================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+void AAS_FreeJumpReachRunStarts(void)
+{
+	if (aasworld.reachabilityrunstarts) FreeMemory(aasworld.reachabilityrunstarts);
+	aasworld.reachabilityrunstarts = NULL;
+} //end of the function AAS_FreeJumpReachRunStarts
+//===========================================================================
+// returns the run start point of the jump reachability with the given number
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+void AAS_JumpReachNumRunStart(int reachnum, vec3_t runstart)
+{
+	if (reachnum <= 0 || reachnum >= aasworld.reachabilitysize)
+	{
+		VectorClear(runstart);
+		return;
+	} //end if
+	if (!aasworld.reachabilityrunstarts)
+	{
+		AAS_JumpReachRunStart(&aasworld.reachability[reachnum], runstart);
+		return;
+	} //end if
+	VectorCopy(aasworld.reachabilityrunstarts[reachnum], runstart);
+} //end of the function AAS_JumpReachNumRunStart
+//===========================================================================
 // returns the Z velocity when rocket jumping at the origin
 //
 // Parameter:			-
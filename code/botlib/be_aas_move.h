@@ -55,6 +55,14 @@ int AAS_OnGround(vec3_t origin, int presencetype, int passent);
 int AAS_Swimming(vec3_t origin);
 //returns the jump reachability run start point
 void AAS_JumpReachRunStart(struct aas_reachability_s *reach, vec3_t runstart);
+//returns the run start point of a jump reachability, predicted at load
+void AAS_JumpReachNumRunStart(int reachnum, vec3_t runstart);
+#ifdef AASINTERN
+//predicts the run start points of all jump reachabilities
+void AAS_InitJumpReachRunStarts(void);
+//frees them
+void AAS_FreeJumpReachRunStarts(void);
+#endif //AASINTERN
 //returns true if against a ladder at the given origin
 int AAS_AgainstLadder(vec3_t origin);
 //rocket jump Z velocity when rocket-jumping at origin
@@ -78,11 +78,17 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #ifdef ROUTING_DEBUG
 int numareacacheupdates;
+int numareacacherepairs;
 int numportalcacheupdates;
 #endif //ROUTING_DEBUG
 
 int routingcachesize;
 int max_routingcachesize;
+int numroutingcaches;
+//routing cache statistics, reset when routing is initialized
+int routingcachehits;
+int routingcachemisses;
+int routingcacheevictions;
 
 //===========================================================================
 //
@@ -94,8 +100,13 @@ int max_routingcachesize;
 void AAS_RoutingInfo(void)
 {
 	botimport.Print(PRT_MESSAGE, "%d area cache updates\n", numareacacheupdates);
+	botimport.Print(PRT_MESSAGE, "%d area cache repairs\n", numareacacherepairs);
 	botimport.Print(PRT_MESSAGE, "%d portal cache updates\n", numportalcacheupdates);
-	botimport.Print(PRT_MESSAGE, "%d bytes routing cache\n", routingcachesize);
+	botimport.Print(PRT_MESSAGE, "%d bytes routing cache in %d caches (max %d)\n",
+						routingcachesize, numroutingcaches, max_routingcachesize);
+	botimport.Print(PRT_MESSAGE, "%d bytes routing cache read from file\n", aasworld.routecacheblocksize);
+	botimport.Print(PRT_MESSAGE, "%d cache hits, %d misses, %d evictions\n",
+						routingcachehits, routingcachemisses, routingcacheevictions);
 } //end of the function AAS_RoutingInfo
 #endif //ROUTING_DEBUG
 //===========================================================================
@@ -198,12 +209,21 @@ int AAS_TravelFlagForType(int traveltype)
 //===========================================================================
 void AAS_UnlinkCache(aas_routingcache_t *cache)
 {
-	if (cache->time_next) cache->time_next->time_prev = cache->time_prev;
-	else aasworld.newestcache = cache->time_prev;
-	if (cache->time_prev) cache->time_prev->time_next = cache->time_next;
-	else aasworld.oldestcache = cache->time_next;
-	cache->time_next = NULL;
-	cache->time_prev = NULL;
+	if (!cache->clock_next) return;
+	if (cache->clock_next == cache)
+	{
+		aasworld.clockhand = NULL;
+	} //end if
+	else
+	{
+		if (aasworld.clockhand == cache) aasworld.clockhand = cache->clock_next;
+		cache->clock_prev->clock_next = cache->clock_next;
+		cache->clock_next->clock_prev = cache->clock_prev;
+	} //end else
+	cache->clock_next = NULL;
+	cache->clock_prev = NULL;
+	numroutingcaches--;
+	routingcachesize -= cache->size;
 } //end of the function AAS_UnlinkCache
 //===========================================================================
 //
@@ -213,18 +233,22 @@ void AAS_UnlinkCache(aas_routingcache_t *cache)
 //===========================================================================
 void AAS_LinkCache(aas_routingcache_t *cache)
 {
-	if (aasworld.newestcache)
+	//insert just behind the clock hand so the cache survives a full sweep
+	if (aasworld.clockhand)
 	{
-		aasworld.newestcache->time_next = cache;
-		cache->time_prev = aasworld.newestcache;
+		cache->clock_next = aasworld.clockhand;
+		cache->clock_prev = aasworld.clockhand->clock_prev;
+		cache->clock_prev->clock_next = cache;
+		aasworld.clockhand->clock_prev = cache;
 	} //end if
 	else
 	{
-		aasworld.oldestcache = cache;
-		cache->time_prev = NULL;
+		cache->clock_next = cache;
+		cache->clock_prev = cache;
+		aasworld.clockhand = cache;
 	} //end else
-	cache->time_next = NULL;
-	aasworld.newestcache = cache;
+	numroutingcaches++;
+	routingcachesize += cache->size;
 } //end of the function AAS_LinkCache
 //===========================================================================
 //
@@ -235,7 +259,9 @@ void AAS_LinkCache(aas_routingcache_t *cache)
 void AAS_FreeRoutingCache(aas_routingcache_t *cache)
 {
 	AAS_UnlinkCache(cache);
-	routingcachesize -= cache->size;
+	//cache read from a route cache dump is freed with the whole block
+	if ((byte *) cache >= aasworld.routecacheblock &&
+		(byte *) cache < aasworld.routecacheblock + aasworld.routecacheblocksize) return;
 	FreeMemory(cache);
 } //end of the function AAS_FreeRoutingCache
 //===========================================================================
@@ -244,61 +270,6 @@ void AAS_FreeRoutingCache(aas_routingcache_t *cache)
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
-void AAS_RemoveRoutingCacheInCluster( int clusternum )
-{
-	int i;
-	aas_routingcache_t *cache, *nextcache;
-	aas_cluster_t *cluster;
-
-	if (!aasworld.clusterareacache)
-		return;
-	cluster = &aasworld.clusters[clusternum];
-	for (i = 0; i < cluster->numareas; i++)
-	{
-		for (cache = aasworld.clusterareacache[clusternum][i]; cache; cache = nextcache)
-		{
-			nextcache = cache->next;
-			AAS_FreeRoutingCache(cache);
-		} //end for
-		aasworld.clusterareacache[clusternum][i] = NULL;
-	} //end for
-} //end of the function AAS_RemoveRoutingCacheInCluster
-//===========================================================================
-//
-// Parameter:			-
-// Returns:				-
-// Changes Globals:		-
-//===========================================================================
-void AAS_RemoveRoutingCacheUsingArea( int areanum )
-{
-	int i, clusternum;
-	aas_routingcache_t *cache, *nextcache;
-
-	clusternum = aasworld.areasettings[areanum].cluster;
-	if (clusternum > 0)
-	{
-		//remove all the cache in the cluster the area is in
-		AAS_RemoveRoutingCacheInCluster( clusternum );
-	} //end if
-	else
-	{
-		// if this is a portal remove all cache in both the front and back cluster
-		AAS_RemoveRoutingCacheInCluster( aasworld.portals[-clusternum].frontcluster );
-		AAS_RemoveRoutingCacheInCluster( aasworld.portals[-clusternum].backcluster );
-	} //end else
-	// remove all portal cache
-	for (i = 0; i < aasworld.numareas; i++)
-	{
-		//refresh portal cache
-		for (cache = aasworld.portalcache[i]; cache; cache = nextcache)
-		{
-			nextcache = cache->next;
-			AAS_FreeRoutingCache(cache);
-		} //end for
-		aasworld.portalcache[i] = NULL;
-	} //end for
-} //end of the function AAS_RemoveRoutingCacheUsingArea
-//===========================================================================
 //
 // Parameter:			-
 // Returns:				-
@@ -327,8 +298,8 @@ int AAS_EnableRoutingArea(int areanum, int enable)
 	// if the status of the area changed
 	if ( (flags & AREA_DISABLED) != (aasworld.areasettings[areanum].areaflags & AREA_DISABLED) )
 	{
-		//remove all routing cache involving this area
-		AAS_RemoveRoutingCacheUsingArea( areanum );
+		//repair all routing cache involving this area
+		AAS_RepairRoutingCacheUsingArea( areanum );
 	} //end if
 	return !flags;
 } //end of the function AAS_EnableRoutingArea
@@ -696,16 +667,28 @@ int AAS_FreeOldestCache(void)
 //===========================================================================
 int AAS_FreeOldestCache(void)
 {
-	int clusterareanum;
+	int i, clusterareanum;
 	aas_routingcache_t *cache;
 
-	for (cache = aasworld.oldestcache; cache; cache = cache->time_next) {
+	//second chance clock, lookups only set the referenced flag so hits
+	//never touch the ring, two laps clear every flag at least once
+	cache = NULL;
+	for (i = 0; i < numroutingcaches * 2; i++)
+	{
+		cache = aasworld.clockhand;
+		aasworld.clockhand = cache->clock_next;
 		// never free area cache leading towards a portal
 		if (cache->type == CACHETYPE_AREA && aasworld.areasettings[cache->areanum].cluster < 0) {
+			cache = NULL;
+			continue;
+		}
+		if (cache->referenced) {
+			cache->referenced = 0;
+			cache = NULL;
 			continue;
 		}
 		break;
-	}
+	} //end for
 	if (cache) {
 		// unlink the cache
 		if (cache->type == CACHETYPE_AREA) {
@@ -723,6 +706,7 @@ int AAS_FreeOldestCache(void)
 			if (cache->next) cache->next->prev = cache->prev;
 		}
 		AAS_FreeRoutingCache(cache);
+		routingcacheevictions++;
 		return qtrue;
 	}
 	return qfalse;
@@ -736,16 +720,16 @@ int AAS_FreeOldestCache(void)
 aas_routingcache_t *AAS_AllocRoutingCache(int numtraveltimes)
 {
 	aas_routingcache_t *cache;
-	int size;
+	int size, memcategory;
 
 	//
 	size = sizeof(aas_routingcache_t)
 						+ numtraveltimes * sizeof(unsigned short int)
 						+ numtraveltimes * sizeof(unsigned char);
 	//
-	routingcachesize += size;
-	//
+	memcategory = SetMemoryCategory(MEMCAT_ROUTING);
 	cache = (aas_routingcache_t *) GetClearedMemory(size);
+	SetMemoryCategory(memcategory);
 	cache->reachabilities = (unsigned char *) cache + sizeof(aas_routingcache_t)
 								+ numtraveltimes * sizeof(unsigned short int);
 	cache->size = size;
@@ -915,26 +899,51 @@ void AAS_CreateAllRoutingCache(void)
 //===========================================================================
 
 //the route cache header
-//this header is followed by numportalcache + numareacache aas_routingcache_t
-//structures that store routing cache
+//this header is followed by datasize bytes with numportalcache + numareacache
+//aas_routingcache_t structures, each padded to RCALIGN bytes. the file is
+//read in one go and the cache is used in place, only the pointers in the
+//structures are fixed up after loading
 typedef struct routecacheheader_s
 {
 	int ident;
 	int version;
+	int cachestructsize;				//sizeof(aas_routingcache_t) of the writer
+	int bspchecksum;
 	int numareas;
 	int numclusters;
 	int areacrc;
 	int clustercrc;
 	int numportalcache;
 	int numareacache;
+	int datasize;
 } routecacheheader_t;
 
 #define RCID						(('C'<<24)+('R'<<16)+('E'<<8)+'M')
-#define RCVERSION					2
+#define RCVERSION					3
+#define RCALIGN						16
 
 //void AAS_DecompressVis(byte *in, int numareas, byte *decompressed);
 //int AAS_CompressVis(byte *vis, int numareas, byte *dest);
 
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_WriteCache(fileHandle_t fp, aas_routingcache_t *cache)
+{
+	static byte zeros[RCALIGN];
+
+	botimport.FS_Write(cache, cache->size, fp);
+	botimport.FS_Write(zeros, PADLEN(cache->size, RCALIGN), fp);
+} //end of the function AAS_WriteCache
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
 void AAS_WriteRouteCache(void)
 {
 	int i, j, numportalcache, numareacache, totalsize;
@@ -945,11 +954,13 @@ void AAS_WriteRouteCache(void)
 	routecacheheader_t routecacheheader;
 
 	numportalcache = 0;
+	totalsize = 0;
 	for (i = 0; i < aasworld.numareas; i++)
 	{
 		for (cache = aasworld.portalcache[i]; cache; cache = cache->next)
 		{
 			numportalcache++;
+			totalsize += PAD(cache->size, RCALIGN);
 		} //end for
 	} //end for
 	numareacache = 0;
@@ -961,6 +972,7 @@ void AAS_WriteRouteCache(void)
 			for (cache = aasworld.clusterareacache[i][j]; cache; cache = cache->next)
 			{
 				numareacache++;
+				totalsize += PAD(cache->size, RCALIGN);
 			} //end for
 		} //end for
 	} //end for
@@ -975,23 +987,23 @@ void AAS_WriteRouteCache(void)
 	//create the header
 	routecacheheader.ident = RCID;
 	routecacheheader.version = RCVERSION;
+	routecacheheader.cachestructsize = sizeof(aas_routingcache_t);
+	routecacheheader.bspchecksum = aasworld.bspchecksum;
 	routecacheheader.numareas = aasworld.numareas;
 	routecacheheader.numclusters = aasworld.numclusters;
 	routecacheheader.areacrc = CRC_ProcessString( (unsigned char *)aasworld.areas, sizeof(aas_area_t) * aasworld.numareas );
 	routecacheheader.clustercrc = CRC_ProcessString( (unsigned char *)aasworld.clusters, sizeof(aas_cluster_t) * aasworld.numclusters );
 	routecacheheader.numportalcache = numportalcache;
 	routecacheheader.numareacache = numareacache;
+	routecacheheader.datasize = totalsize;
 	//write the header
 	botimport.FS_Write(&routecacheheader, sizeof(routecacheheader_t), fp);
-	//
-	totalsize = 0;
-	//write all the cache
+	//write all the cache, portal cache first
 	for (i = 0; i < aasworld.numareas; i++)
 	{
 		for (cache = aasworld.portalcache[i]; cache; cache = cache->next)
 		{
-			botimport.FS_Write(cache, cache->size, fp);
-			totalsize += cache->size;
+			AAS_WriteCache(fp, cache);
 		} //end for
 	} //end for
 	for (i = 0; i < aasworld.numclusters; i++)
@@ -1001,50 +1013,54 @@ void AAS_WriteRouteCache(void)
 		{
 			for (cache = aasworld.clusterareacache[i][j]; cache; cache = cache->next)
 			{
-				botimport.FS_Write(cache, cache->size, fp);
-				totalsize += cache->size;
+				AAS_WriteCache(fp, cache);
 			} //end for
 		} //end for
 	} //end for
-	// write the visareas
-	/*
-	for (i = 0; i < aasworld.numareas; i++)
-	{
-		if (!aasworld.areavisibility[i]) {
-			size = 0;
-			botimport.FS_Write(&size, sizeof(int), fp);
-			continue;
-		}
-		AAS_DecompressVis( aasworld.areavisibility[i], aasworld.numareas, aasworld.decompressedvis );
-		size = AAS_CompressVis( aasworld.decompressedvis, aasworld.numareas, aasworld.decompressedvis );
-		botimport.FS_Write(&size, sizeof(int), fp);
-		botimport.FS_Write(aasworld.decompressedvis, size, fp);
-	}
-	*/
 	//
 	botimport.FS_FCloseFile(fp);
 	botimport.Print(PRT_MESSAGE, "\nroute cache written to %s\n", filename);
 	botimport.Print(PRT_MESSAGE, "written %d bytes of routing cache\n", totalsize);
 } //end of the function AAS_WriteRouteCache
 //===========================================================================
+// fixes up a cache stored in the route cache block
 //
 // Parameter:			-
-// Returns:				-
+// Returns:				qfalse if the cache is not valid for the loaded AAS
 // Changes Globals:		-
 //===========================================================================
-aas_routingcache_t *AAS_ReadCache(fileHandle_t fp)
+static int AAS_FixupCache(aas_routingcache_t *cache, int type, int maxsize)
 {
-	int size;
-	aas_routingcache_t *cache;
+	int numtraveltimes, clusterareanum;
 
-	botimport.FS_Read(&size, sizeof(size), fp);
-	cache = (aas_routingcache_t *) GetMemory(size);
-	cache->size = size;
-	botimport.FS_Read((unsigned char *)cache + sizeof(size), size - sizeof(size), fp);
-	cache->reachabilities = (unsigned char *) cache + sizeof(aas_routingcache_t) - sizeof(unsigned short) +
-		(size - sizeof(aas_routingcache_t) + sizeof(unsigned short)) / 3 * 2;
-	return cache;
-} //end of the function AAS_ReadCache
+	if (cache->size < (int) sizeof(aas_routingcache_t) || cache->size > maxsize) return qfalse;
+	if (cache->type != type) return qfalse;
+	if (cache->areanum <= 0 || cache->areanum >= aasworld.numareas) return qfalse;
+	if (cache->cluster <= 0 || cache->cluster >= aasworld.numclusters) return qfalse;
+	//
+	numtraveltimes = (cache->size - sizeof(aas_routingcache_t)) / 3;
+	if (type == CACHETYPE_AREA)
+	{
+		if (aasworld.areasettings[cache->areanum].cluster > 0 &&
+			aasworld.areasettings[cache->areanum].cluster != cache->cluster) return qfalse;
+		clusterareanum = AAS_ClusterAreaNum(cache->cluster, cache->areanum);
+		if (clusterareanum < 0 || clusterareanum >= aasworld.clusters[cache->cluster].numareas) return qfalse;
+		if (numtraveltimes != aasworld.clusters[cache->cluster].numreachabilityareas) return qfalse;
+	} //end if
+	else
+	{
+		if (numtraveltimes != aasworld.numportals) return qfalse;
+	} //end else
+	cache->reachabilities = (unsigned char *) cache + sizeof(aas_routingcache_t)
+								+ numtraveltimes * sizeof(unsigned short int);
+	cache->referenced = 0;
+	cache->prev = NULL;
+	cache->next = NULL;
+	//the block is freed as a whole, these caches never enter the clock
+	cache->clock_prev = NULL;
+	cache->clock_next = NULL;
+	return qtrue;
+} //end of the function AAS_FixupCache
 //===========================================================================
 //
 // Parameter:			-
@@ -1053,87 +1069,87 @@ aas_routingcache_t *AAS_ReadCache(fileHandle_t fp)
 //===========================================================================
 int AAS_ReadRouteCache(void)
 {
-	int i, clusterareanum;//, size;
+	int i, offset, clusterareanum, length;
 	fileHandle_t fp;
 	char filename[MAX_QPATH];
 	routecacheheader_t routecacheheader;
-	aas_routingcache_t *cache;
+	aas_routingcache_t *cache, **bucket;
+	byte *block;
 
 	Com_sprintf(filename, MAX_QPATH, "maps/%s.rcd", aasworld.mapname);
-	botimport.FS_FOpenFile( filename, &fp, FS_READ );
+	length = botimport.FS_FOpenFile( filename, &fp, FS_READ );
 	if (!fp)
 	{
 		return qfalse;
 	} //end if
-	botimport.FS_Read(&routecacheheader, sizeof(routecacheheader_t), fp );
-	if (routecacheheader.ident != RCID)
+	if (length < (int) sizeof(routecacheheader_t))
 	{
-		AAS_Error("%s is not a route cache dump\n", filename);
+		botimport.FS_FCloseFile(fp);
 		return qfalse;
 	} //end if
-	if (routecacheheader.version != RCVERSION)
-	{
-		AAS_Error("route cache dump has wrong version %d, should be %d\n", routecacheheader.version, RCVERSION);
-		return qfalse;
-	} //end if
-	if (routecacheheader.numareas != aasworld.numareas)
-	{
-		//AAS_Error("route cache dump has wrong number of areas\n");
-		return qfalse;
-	} //end if
-	if (routecacheheader.numclusters != aasworld.numclusters)
-	{
-		//AAS_Error("route cache dump has wrong number of clusters\n");
-		return qfalse;
-	} //end if
-	if (routecacheheader.areacrc !=
-		CRC_ProcessString( (unsigned char *)aasworld.areas, sizeof(aas_area_t) * aasworld.numareas ))
+	botimport.FS_Read(&routecacheheader, sizeof(routecacheheader_t), fp );
+	if (routecacheheader.ident != RCID)
 	{
-		//AAS_Error("route cache dump area CRC incorrect\n");
+		botimport.FS_FCloseFile(fp);
+		AAS_Error("%s is not a route cache dump\n", filename);
 		return qfalse;
 	} //end if
-	if (routecacheheader.clustercrc !=
-		CRC_ProcessString( (unsigned char *)aasworld.clusters, sizeof(aas_cluster_t) * aasworld.numclusters ))
-	{
-		//AAS_Error("route cache dump cluster CRC incorrect\n");
+	//older dumps or ones written by a build with another structure layout
+	//are simply rebuilt
+	if (routecacheheader.version != RCVERSION ||
+		routecacheheader.cachestructsize != sizeof(aas_routingcache_t) ||
+		routecacheheader.bspchecksum != aasworld.bspchecksum ||
+		routecacheheader.numareas != aasworld.numareas ||
+		routecacheheader.numclusters != aasworld.numclusters ||
+		routecacheheader.datasize != length - (int) sizeof(routecacheheader_t) ||
+		routecacheheader.areacrc !=
+			CRC_ProcessString( (unsigned char *)aasworld.areas, sizeof(aas_area_t) * aasworld.numareas ) ||
+		routecacheheader.clustercrc !=
+			CRC_ProcessString( (unsigned char *)aasworld.clusters, sizeof(aas_cluster_t) * aasworld.numclusters ))
+	{
+		botimport.FS_FCloseFile(fp);
 		return qfalse;
 	} //end if
-	//read all the portal cache
-	for (i = 0; i < routecacheheader.numportalcache; i++)
-	{
-		cache = AAS_ReadCache(fp);
-		cache->next = aasworld.portalcache[cache->areanum];
-		cache->prev = NULL;
-		if (aasworld.portalcache[cache->areanum])
-			aasworld.portalcache[cache->areanum]->prev = cache;
-		aasworld.portalcache[cache->areanum] = cache;
+	//read all the cache at once
+	block = (byte *) GetMemory(routecacheheader.datasize);
+	botimport.FS_Read(block, routecacheheader.datasize, fp);
+	botimport.FS_FCloseFile(fp);
+	//validate and fix up all the cache before linking any of it
+	offset = 0;
+	for (i = 0; i < routecacheheader.numportalcache + routecacheheader.numareacache; i++)
+	{
+		cache = (aas_routingcache_t *) (block + offset);
+		if (offset + (int) sizeof(aas_routingcache_t) > routecacheheader.datasize ||
+			!AAS_FixupCache(cache, i < routecacheheader.numportalcache ? CACHETYPE_PORTAL : CACHETYPE_AREA,
+								routecacheheader.datasize - offset))
+		{
+			botimport.Print(PRT_WARNING, "%s is corrupt\n", filename);
+			FreeMemory(block);
+			return qfalse;
+		} //end if
+		offset += PAD(cache->size, RCALIGN);
 	} //end for
-	//read all the cluster area cache
-	for (i = 0; i < routecacheheader.numareacache; i++)
+	//link the cache into the portal and cluster area lists
+	offset = 0;
+	for (i = 0; i < routecacheheader.numportalcache + routecacheheader.numareacache; i++)
 	{
-		cache = AAS_ReadCache(fp);
-		clusterareanum = AAS_ClusterAreaNum(cache->cluster, cache->areanum);
-		cache->next = aasworld.clusterareacache[cache->cluster][clusterareanum];
-		cache->prev = NULL;
-		if (aasworld.clusterareacache[cache->cluster][clusterareanum])
-			aasworld.clusterareacache[cache->cluster][clusterareanum]->prev = cache;
-		aasworld.clusterareacache[cache->cluster][clusterareanum] = cache;
+		cache = (aas_routingcache_t *) (block + offset);
+		offset += PAD(cache->size, RCALIGN);
+		if (cache->type == CACHETYPE_PORTAL)
+		{
+			bucket = &aasworld.portalcache[cache->areanum];
+		} //end if
+		else
+		{
+			clusterareanum = AAS_ClusterAreaNum(cache->cluster, cache->areanum);
+			bucket = &aasworld.clusterareacache[cache->cluster][clusterareanum];
+		} //end else
+		cache->next = *bucket;
+		if (*bucket) (*bucket)->prev = cache;
+		*bucket = cache;
 	} //end for
-	// read the visareas
-	/*
-	aasworld.areavisibility = (byte **) GetClearedMemory(aasworld.numareas * sizeof(byte *));
-	aasworld.decompressedvis = (byte *) GetClearedMemory(aasworld.numareas * sizeof(byte));
-	for (i = 0; i < aasworld.numareas; i++)
-	{
-		botimport.FS_Read(&size, sizeof(size), fp );
-		if (size) {
-			aasworld.areavisibility[i] = (byte *) GetMemory(size);
-			botimport.FS_Read(aasworld.areavisibility[i], size, fp );
-		}
-	}
-	*/
-	//
-	botimport.FS_FCloseFile(fp);
+	aasworld.routecacheblock = block;
+	aasworld.routecacheblocksize = routecacheheader.datasize;
 	return qtrue;
 } //end of the function AAS_ReadRouteCache
 //===========================================================================
@@ -1218,6 +1234,9 @@ void AAS_InitReachabilityAreas(void)
 //===========================================================================
 void AAS_InitRouting(void)
 {
+	int memcategory;
+
+	memcategory = BeginMemoryPhase(MEMCAT_ROUTING);
 	AAS_InitTravelFlagFromType();
 	//
 	AAS_InitAreaContentsTravelFlags();
@@ -1235,16 +1254,24 @@ void AAS_InitRouting(void)
 	AAS_InitPortalMaxTravelTimes();
 	//get the areas reachabilities go through
 	AAS_InitReachabilityAreas();
+	//predict where bots start running for jumps
+	AAS_InitJumpReachRunStarts();
 	//
 #ifdef ROUTING_DEBUG
 	numareacacheupdates = 0;
+	numareacacherepairs = 0;
 	numportalcacheupdates = 0;
 #endif //ROUTING_DEBUG
 	//
 	routingcachesize = 0;
+	numroutingcaches = 0;
+	routingcachehits = 0;
+	routingcachemisses = 0;
+	routingcacheevictions = 0;
 	max_routingcachesize = 1024 * (int) LibVarValue("max_routingcache", "4096");
 	// read any routing cache if available
 	AAS_ReadRouteCache();
+	EndMemoryPhase(memcategory);
 } //end of the function AAS_InitRouting
 //===========================================================================
 //
@@ -1258,6 +1285,12 @@ void AAS_FreeRoutingCaches(void)
 	AAS_FreeAllClusterAreaCache();
 	// free all the existing portal cache
 	AAS_FreeAllPortalCache();
+	// free the jump run start points
+	AAS_FreeJumpReachRunStarts();
+	// free the cache read from a route cache dump
+	if (aasworld.routecacheblock) FreeMemory(aasworld.routecacheblock);
+	aasworld.routecacheblock = NULL;
+	aasworld.routecacheblocksize = 0;
 	// free cached travel times within areas
 	if (aasworld.areatraveltimes) FreeMemory(aasworld.areatraveltimes);
 	aasworld.areatraveltimes = NULL;
@@ -1283,51 +1316,27 @@ void AAS_FreeRoutingCaches(void)
 	aasworld.areacontentstravelflags = NULL;
 } //end of the function AAS_FreeRoutingCaches
 //===========================================================================
-// update the given routing cache
+// propagates travel times from the areas in the update list to every
+// area that can reach them, only ever lowering the cached times
 //
 // Parameter:			areacache		: routing cache to update
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
-void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
+static void AAS_RelaxAreaRoutingCache(aas_routingcache_t *areacache,
+							aas_routingupdate_t *updateliststart, aas_routingupdate_t *updatelistend)
 {
 	int i, nextareanum, cluster, badtravelflags, clusterareanum, linknum;
 	int numreachabilityareas;
-	unsigned short int t, startareatraveltimes[128]; //NOTE: not more than 128 reachabilities per area allowed
-	aas_routingupdate_t *updateliststart, *updatelistend, *curupdate, *nextupdate;
+	unsigned short int t;
+	aas_routingupdate_t *curupdate, *nextupdate;
 	aas_reachability_t *reach;
 	aas_reversedreachability_t *revreach;
 	aas_reversedlink_t *revlink;
 
-#ifdef ROUTING_DEBUG
-	numareacacheupdates++;
-#endif //ROUTING_DEBUG
-	//number of reachability areas within this cluster
 	numreachabilityareas = aasworld.clusters[areacache->cluster].numreachabilityareas;
-	//
-	aasworld.frameroutingupdates++;
-	//clear the routing update fields
-//	Com_Memset(aasworld.areaupdate, 0, aasworld.numareas * sizeof(aas_routingupdate_t));
-	//
 	badtravelflags = ~areacache->travelflags;
 	//
-	clusterareanum = AAS_ClusterAreaNum(areacache->cluster, areacache->areanum);
-	if (clusterareanum >= numreachabilityareas) return;
-	//
-	Com_Memset(startareatraveltimes, 0, sizeof(startareatraveltimes));
-	//
-	curupdate = &aasworld.areaupdate[clusterareanum];
-	curupdate->areanum = areacache->areanum;
-	//VectorCopy(areacache->origin, curupdate->start);
-	curupdate->areatraveltimes = startareatraveltimes;
-	curupdate->tmptraveltime = areacache->starttraveltime;
-	//
-	areacache->traveltimes[clusterareanum] = areacache->starttraveltime;
-	//put the area to start with in the current read list
-	curupdate->next = NULL;
-	curupdate->prev = NULL;
-	updateliststart = curupdate;
-	updatelistend = curupdate;
 	//while there are updates in the current list
 	while (updateliststart)
 	{
@@ -1393,8 +1402,288 @@ void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
 			} //end if
 		} //end for
 	} //end while
+} //end of the function AAS_RelaxAreaRoutingCache
+//===========================================================================
+// update the given routing cache
+//
+// Parameter:			areacache		: routing cache to update
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
+{
+	int clusterareanum;
+	int numreachabilityareas;
+	unsigned short int startareatraveltimes[128]; //NOTE: not more than 128 reachabilities per area allowed
+	aas_routingupdate_t *curupdate;
+
+#ifdef ROUTING_DEBUG
+	numareacacheupdates++;
+#endif //ROUTING_DEBUG
+	//number of reachability areas within this cluster
+	numreachabilityareas = aasworld.clusters[areacache->cluster].numreachabilityareas;
+	//
+	aasworld.frameroutingupdates++;
+	//clear the routing update fields
+//	Com_Memset(aasworld.areaupdate, 0, aasworld.numareas * sizeof(aas_routingupdate_t));
+	//
+	clusterareanum = AAS_ClusterAreaNum(areacache->cluster, areacache->areanum);
+	if (clusterareanum >= numreachabilityareas) return;
+	//
+	Com_Memset(startareatraveltimes, 0, sizeof(startareatraveltimes));
+	//
+	curupdate = &aasworld.areaupdate[clusterareanum];
+	curupdate->areanum = areacache->areanum;
+	//VectorCopy(areacache->origin, curupdate->start);
+	curupdate->areatraveltimes = startareatraveltimes;
+	curupdate->tmptraveltime = areacache->starttraveltime;
+	//
+	areacache->traveltimes[clusterareanum] = areacache->starttraveltime;
+	//put the area to start with in the current read list
+	curupdate->next = NULL;
+	curupdate->prev = NULL;
+	AAS_RelaxAreaRoutingCache(areacache, curupdate, curupdate);
 } //end of the function AAS_UpdateAreaRoutingCache
 //===========================================================================
+// returns the number of the area in the cluster or -1 if the area is
+// neither in the cluster nor a portal of it
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static int AAS_AreaInCluster(int cluster, int areanum)
+{
+	int areacluster;
+
+	areacluster = aasworld.areasettings[areanum].cluster;
+	if (areacluster > 0)
+	{
+		if (areacluster != cluster) return -1;
+	} //end if
+	else
+	{
+		if (aasworld.portals[-areacluster].frontcluster != cluster &&
+				aasworld.portals[-areacluster].backcluster != cluster) return -1;
+	} //end else
+	return AAS_ClusterAreaNum(cluster, areanum);
+} //end of the function AAS_AreaInCluster
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_AddAreaRoutingUpdate(aas_routingcache_t *areacache, int clusterareanum, int areanum,
+							aas_routingupdate_t **updateliststart, aas_routingupdate_t **updatelistend)
+{
+	static unsigned short int startareatraveltimes[128];
+	aas_routingupdate_t *update;
+
+	update = &aasworld.areaupdate[clusterareanum];
+	if (update->inlist) return;
+	update->areanum = areanum;
+	update->tmptraveltime = areacache->traveltimes[clusterareanum];
+	if (areanum == areacache->areanum)
+	{
+		update->areatraveltimes = startareatraveltimes;
+	} //end if
+	else
+	{
+		update->areatraveltimes = aasworld.areatraveltimes[areanum][areacache->reachabilities[clusterareanum]];
+	} //end else
+	update->next = NULL;
+	update->prev = *updatelistend;
+	if (*updatelistend) (*updatelistend)->next = update;
+	else *updateliststart = update;
+	*updatelistend = update;
+	update->inlist = qtrue;
+} //end of the function AAS_AddAreaRoutingUpdate
+//===========================================================================
+// repairs an area cache after the given area was enabled or disabled
+// instead of computing it again from scratch
+//
+// enabling an area can only lower travel times, so updating from the area
+// itself is enough. disabling an area invalidates every area whose route
+// leads through it, those are cleared and updated from the areas next to
+// them that still have a valid route
+//
+// Parameter:			areanums	: area number for every cluster area number
+//						state		: scratch, one byte per cluster area number
+//						stack		: scratch, one int per cluster area number
+// Returns:				qfalse if the cache has to be thrown away
+// Changes Globals:		-
+//===========================================================================
+#define REPAIR_UNKNOWN		0
+#define REPAIR_AFFECTED		1
+#define REPAIR_VALID		2
+#define REPAIR_VISITING		3
+
+static int AAS_RepairAreaRoutingCache(aas_routingcache_t *areacache, int areanum,
+							int *areanums, byte *state, int *stack)
+{
+	int i, j, n, cur, next, result, toggled, goal, nextareanum, numreachabilityareas;
+	aas_areasettings_t *settings;
+	aas_reachability_t *reach;
+	aas_routingupdate_t *updateliststart, *updatelistend;
+
+	if (areanum == areacache->areanum) return qfalse;
+	numreachabilityareas = aasworld.clusters[areacache->cluster].numreachabilityareas;
+	toggled = AAS_ClusterAreaNum(areacache->cluster, areanum);
+	if (toggled >= numreachabilityareas) return qtrue;
+	goal = AAS_ClusterAreaNum(areacache->cluster, areacache->areanum);
+	if (goal >= numreachabilityareas) return qtrue;
+	//
+	updateliststart = updatelistend = NULL;
+	if (!(aasworld.areasettings[areanum].areaflags & AREA_DISABLED))
+	{
+		//the area can be entered again
+		if (areacache->traveltimes[toggled])
+		{
+			AAS_AddAreaRoutingUpdate(areacache, toggled, areanum, &updateliststart, &updatelistend);
+		} //end if
+	} //end if
+	else
+	{
+		//find the areas whose route leads through the disabled area
+		Com_Memset(state, REPAIR_UNKNOWN, numreachabilityareas);
+		state[toggled] = REPAIR_VALID;
+		state[goal] = REPAIR_VALID;
+		for (i = 0; i < numreachabilityareas; i++)
+		{
+			if (state[i] || !areacache->traveltimes[i]) continue;
+			n = 0;
+			result = REPAIR_VALID;
+			for (cur = i; !state[cur]; cur = next)
+			{
+				stack[n++] = cur;
+				state[cur] = REPAIR_VISITING;
+				//follow the reachability the cache routes through
+				settings = &aasworld.areasettings[areanums[cur]];
+				reach = &aasworld.reachability[settings->firstreachablearea + areacache->reachabilities[cur]];
+				next = AAS_AreaInCluster(areacache->cluster, reach->areanum);
+				if (next < 0 || next >= numreachabilityareas || !areacache->traveltimes[next]) break;
+				if (next == toggled)
+				{
+					result = REPAIR_AFFECTED;
+					break;
+				} //end if
+			} //end for
+			if (state[cur] != REPAIR_VISITING) result = state[cur];
+			while (n > 0) state[stack[--n]] = result;
+		} //end for
+		//clear the invalid travel times
+		for (i = 0; i < numreachabilityareas; i++)
+		{
+			if (state[i] == REPAIR_AFFECTED) areacache->traveltimes[i] = 0;
+		} //end for
+		//update from the valid areas the invalid ones can travel to
+		for (i = 0; i < numreachabilityareas; i++)
+		{
+			if (state[i] != REPAIR_AFFECTED) continue;
+			settings = &aasworld.areasettings[areanums[i]];
+			for (j = 0; j < settings->numreachableareas; j++)
+			{
+				nextareanum = aasworld.reachability[settings->firstreachablearea + j].areanum;
+				next = AAS_AreaInCluster(areacache->cluster, nextareanum);
+				if (next < 0 || next >= numreachabilityareas) continue;
+				if (state[next] != REPAIR_VALID || !areacache->traveltimes[next]) continue;
+				AAS_AddAreaRoutingUpdate(areacache, next, nextareanum, &updateliststart, &updatelistend);
+			} //end for
+		} //end for
+	} //end else
+	if (updateliststart)
+	{
+		AAS_RelaxAreaRoutingCache(areacache, updateliststart, updatelistend);
+	} //end if
+	return qtrue;
+} //end of the function AAS_RepairAreaRoutingCache
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_RepairRoutingCacheInCluster(int clusternum, int areanum)
+{
+	int i, clusterareanum, numreachabilityareas, *areanums, *stack;
+	byte *state;
+	aas_routingcache_t *cache, *nextcache;
+	aas_cluster_t *cluster;
+
+	if (!aasworld.clusterareacache)
+		return;
+	cluster = &aasworld.clusters[clusternum];
+	numreachabilityareas = cluster->numreachabilityareas;
+	if (!numreachabilityareas)
+		return;
+	//map the cluster area numbers back to area numbers
+	areanums = (int *) GetClearedMemory(numreachabilityareas * (sizeof(int) * 2 + sizeof(byte)));
+	stack = areanums + numreachabilityareas;
+	state = (byte *) (stack + numreachabilityareas);
+	for (i = 1; i < aasworld.numareas; i++)
+	{
+		clusterareanum = AAS_AreaInCluster(clusternum, i);
+		if (clusterareanum < 0 || clusterareanum >= numreachabilityareas) continue;
+		areanums[clusterareanum] = i;
+	} //end for
+	//
+	for (i = 0; i < cluster->numareas; i++)
+	{
+		for (cache = aasworld.clusterareacache[clusternum][i]; cache; cache = nextcache)
+		{
+			nextcache = cache->next;
+			if (AAS_RepairAreaRoutingCache(cache, areanum, areanums, state, stack))
+			{
+#ifdef ROUTING_DEBUG
+				numareacacherepairs++;
+#endif //ROUTING_DEBUG
+				continue;
+			} //end if
+			if (cache->prev) cache->prev->next = cache->next;
+			else aasworld.clusterareacache[clusternum][i] = cache->next;
+			if (cache->next) cache->next->prev = cache->prev;
+			AAS_FreeRoutingCache(cache);
+		} //end for
+	} //end for
+	FreeMemory(areanums);
+} //end of the function AAS_RepairRoutingCacheInCluster
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_RepairRoutingCacheUsingArea( int areanum )
+{
+	int i, clusternum;
+	aas_routingcache_t *cache, *nextcache;
+
+	clusternum = aasworld.areasettings[areanum].cluster;
+	if (clusternum > 0)
+	{
+		//repair all the cache in the cluster the area is in
+		AAS_RepairRoutingCacheInCluster( clusternum, areanum );
+	} //end if
+	else
+	{
+		// if this is a portal repair all cache in both the front and back cluster
+		AAS_RepairRoutingCacheInCluster( aasworld.portals[-clusternum].frontcluster, areanum );
+		AAS_RepairRoutingCacheInCluster( aasworld.portals[-clusternum].backcluster, areanum );
+	} //end else
+	// remove all portal cache, it is cheap to build again from the area cache
+	for (i = 0; i < aasworld.numareas; i++)
+	{
+		//refresh portal cache
+		for (cache = aasworld.portalcache[i]; cache; cache = nextcache)
+		{
+			nextcache = cache->next;
+			AAS_FreeRoutingCache(cache);
+		} //end for
+		aasworld.portalcache[i] = NULL;
+	} //end for
+} //end of the function AAS_RepairRoutingCacheUsingArea
+//===========================================================================
 //
 // Parameter:			-
 // Returns:				-
@@ -1424,20 +1713,22 @@ aas_routingcache_t *AAS_GetAreaRoutingCache(int clusternum, int areanum, int tra
 		VectorCopy(aasworld.areas[areanum].center, cache->origin);
 		cache->starttraveltime = 1;
 		cache->travelflags = travelflags;
+		cache->time = AAS_RoutingTime();
+		cache->type = CACHETYPE_AREA;
 		cache->prev = NULL;
 		cache->next = clustercache;
 		if (clustercache) clustercache->prev = cache;
 		aasworld.clusterareacache[clusternum][clusterareanum] = cache;
 		AAS_UpdateAreaRoutingCache(cache);
+		AAS_LinkCache(cache);
+		routingcachemisses++;
 	} //end if
 	else
 	{
-		AAS_UnlinkCache(cache);
+		routingcachehits++;
 	} //end else
 	//the cache has been accessed
-	cache->time = AAS_RoutingTime();
-	cache->type = CACHETYPE_AREA;
-	AAS_LinkCache(cache);
+	cache->referenced = 1;
 	return cache;
 } //end of the function AAS_GetAreaRoutingCache
 //===========================================================================
@@ -1562,6 +1853,8 @@ aas_routingcache_t *AAS_GetPortalRoutingCache(int clusternum, int areanum, int t
 		VectorCopy(aasworld.areas[areanum].center, cache->origin);
 		cache->starttraveltime = 1;
 		cache->travelflags = travelflags;
+		cache->time = AAS_RoutingTime();
+		cache->type = CACHETYPE_PORTAL;
 		//add the cache to the cache list
 		cache->prev = NULL;
 		cache->next = aasworld.portalcache[areanum];
@@ -1569,15 +1862,15 @@ aas_routingcache_t *AAS_GetPortalRoutingCache(int clusternum, int areanum, int t
 		aasworld.portalcache[areanum] = cache;
 		//update the cache
 		AAS_UpdatePortalRoutingCache(cache);
+		AAS_LinkCache(cache);
+		routingcachemisses++;
 	} //end if
 	else
 	{
-		AAS_UnlinkCache(cache);
+		routingcachehits++;
 	} //end else
 	//the cache has been accessed
-	cache->time = AAS_RoutingTime();
-	cache->type = CACHETYPE_PORTAL;
-	AAS_LinkCache(cache);
+	cache->referenced = 1;
 	return cache;
 } //end of the function AAS_GetPortalRoutingCache
 //===========================================================================
@@ -1625,7 +1918,7 @@ int AAS_AreaRouteToGoalArea(int areanum, vec3_t origin, int goalareanum, int tra
 		return qfalse;
 	} //end if
 	// make sure the routing cache doesn't grow to large
-	while(AvailableMemory() < 1 * 1024 * 1024) {
+	while(routingcachesize > max_routingcachesize || AvailableMemory() < 1 * 1024 * 1024) {
 		if (!AAS_FreeOldestCache()) break;
 	}
 	//
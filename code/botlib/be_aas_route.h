@@ -39,6 +39,8 @@ unsigned short int AAS_AreaTravelTime(int areanum, vec3_t start, vec3_t end);
 //
 void AAS_CreateAllRoutingCache(void);
 void AAS_WriteRouteCache(void);
+//repairs the routing cache after the area was enabled or disabled
+void AAS_RepairRoutingCacheUsingArea(int areanum);
 //
 void AAS_RoutingInfo(void);
 #endif //AASINTERN
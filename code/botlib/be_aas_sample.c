@@ -257,6 +257,90 @@ int AAS_PointAreaNum(vec3_t point)
 	return -nodenum;
 } //end of the function AAS_PointAreaNum
 //===========================================================================
+// returns qtrue if the point is inside the convex area, otherwise stores
+// the area at the other side of the first face the point is outside of
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+static int AAS_PointInsideArea(vec3_t point, int areanum, int *nextareanum)
+{
+	int i;
+	vec_t dist;
+	aas_area_t *area;
+	aas_face_t *face;
+	aas_plane_t *plane;
+
+	*nextareanum = 0;
+	area = &aasworld.areas[areanum];
+	for (i = 0; i < area->numfaces; i++)
+	{
+		face = &aasworld.faces[abs(aasworld.faceindex[area->firstface + i])];
+		plane = &aasworld.planes[face->planenum];
+		dist = DotProduct(point, plane->normal) - plane->dist;
+		//same tie breaking as the tree walk, points on the plane are at the back
+		if (face->frontarea == areanum)
+		{
+			if (dist > 0) continue;
+			*nextareanum = face->backarea;
+		} //end if
+		else
+		{
+			if (dist <= 0) continue;
+			*nextareanum = face->frontarea;
+		} //end else
+		return qfalse;
+	} //end for
+	return qtrue;
+} //end of the function AAS_PointInsideArea
+//===========================================================================
+// returns the AAS area the point is in, the hint area the point was
+// last known to be in and the area it most likely moved into are tried
+// before walking the tree
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+int AAS_PointAreaNumHint(vec3_t point, int hintareanum)
+{
+	int nextareanum, crossareanum;
+	aas_area_t *area;
+
+	if (!aasworld.loaded)
+	{
+		botimport.Print(PRT_ERROR, "AAS_PointAreaNumHint: aas not loaded\n");
+		return 0;
+	} //end if
+
+	if (hintareanum > 0 && hintareanum < aasworld.numareas)
+	{
+		if (AAS_PointInsideArea(point, hintareanum, &nextareanum))
+		{
+#ifdef AAS_SAMPLE_DEBUG
+			if (hintareanum != AAS_PointAreaNum(point))
+			{
+				botimport.Print(PRT_MESSAGE, "hint area %d, must be %d\n", hintareanum, AAS_PointAreaNum(point));
+			} //end if
+#endif //AAS_SAMPLE_DEBUG
+			return hintareanum;
+		} //end if
+		if (nextareanum > 0 && nextareanum < aasworld.numareas)
+		{
+			area = &aasworld.areas[nextareanum];
+			if (point[0] >= area->mins[0] && point[0] <= area->maxs[0] &&
+				point[1] >= area->mins[1] && point[1] <= area->maxs[1] &&
+				point[2] >= area->mins[2] && point[2] <= area->maxs[2] &&
+				AAS_PointInsideArea(point, nextareanum, &crossareanum))
+			{
+				return nextareanum;
+			} //end if
+		} //end if
+	} //end if
+	return AAS_PointAreaNum(point);
+} //end of the function AAS_PointAreaNumHint
+//===========================================================================
 //
 // Parameter:			-
 // Returns:				-
@@ -62,6 +62,8 @@ int AAS_BBoxAreas(vec3_t absmins, vec3_t absmaxs, int *areas, int maxareas);
 int AAS_AreaInfo( int areanum, aas_areainfo_t *info );
 //returns the area the point is in
 int AAS_PointAreaNum(vec3_t point);
+//returns the area the point is in, starting the search at the hint area
+int AAS_PointAreaNumHint(vec3_t point, int hintareanum);
 //
 int AAS_PointReachabilityAreaIndex( vec3_t point );
 //returns the plane the given face is in
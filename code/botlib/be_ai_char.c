@@ -495,10 +495,12 @@ int BotLoadCachedCharacter(char *charfile, float skill, int reload)
 //===========================================================================
 int BotLoadCharacterSkill(char *charfile, float skill)
 {
-	int ch, defaultch;
+	int ch, defaultch, memcategory;
 
+	memcategory = BeginMemoryPhase(MEMCAT_CHARACTER);
 	defaultch = BotLoadCachedCharacter(DEFAULT_CHARACTER, skill, qfalse);
 	ch = BotLoadCachedCharacter(charfile, skill, LibVarGetValue("bot_reloadcharacters"));
+	EndMemoryPhase(memcategory);
 
 	if (defaultch && ch)
 	{
@@ -126,6 +126,7 @@ typedef struct bot_synonymlist_s
 typedef struct bot_matchstring_s
 {
 	char *string;
+	int id;										//index of the string in the match index
 	struct bot_matchstring_s *next;
 } bot_matchstring_t;
 
@@ -147,6 +148,18 @@ typedef struct bot_matchtemplate_s
 	struct bot_matchtemplate_s *next;
 } bot_matchtemplate_t;
 
+//node of the match index, an Aho-Corasick automaton over all the fixed
+//match strings so one scan of a message finds every string it contains
+typedef struct bot_matchnode_s
+{
+	int c;										//upper case character leading to this node
+	int child;									//first child node, 0 if none
+	int sibling;								//next node with the same parent
+	int fail;									//node of the longest proper suffix
+	int output;									//id of the string ending here, -1 if none
+	int dict;									//nearest node on the fail chain with output
+} bot_matchnode_t;
+
 //reply chat key
 typedef struct bot_replychatkey_s
 {
@@ -203,6 +216,11 @@ bot_consolemessage_t *consolemessageheap = NULL;
 bot_consolemessage_t *freeconsolemessages = NULL;
 //list with match strings
 bot_matchtemplate_t *matchtemplates = NULL;
+//index over all the fixed match strings
+bot_matchnode_t *matchnodes = NULL;
+int nummatchnodes;
+int nummatchstrings;
+byte *matchstringfound = NULL;
 //list with synonyms
 bot_synonymlist_t *synonyms = NULL;
 //list with random strings
@@ -1451,6 +1469,200 @@ int StringsMatch(bot_matchpiece_t *pieces, bot_match_t *match)
 // Returns:					-
 // Changes Globals:		-
 //===========================================================================
+static int BotMatchNodeChild(int node, int c)
+{
+	int child;
+
+	for (child = matchnodes[node].child; child; child = matchnodes[child].sibling)
+	{
+		if (matchnodes[child].c == c) return child;
+	} //end for
+	return 0;
+} //end of the function BotMatchNodeChild
+//===========================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+static int BotCountMatchPieceChars(bot_matchpiece_t *pieces)
+{
+	int count;
+	bot_matchpiece_t *mp;
+	bot_matchstring_t *ms;
+
+	count = 0;
+	for (mp = pieces; mp; mp = mp->next)
+	{
+		if (mp->type != MT_STRING) continue;
+		for (ms = mp->firststring; ms; ms = ms->next) count += strlen(ms->string);
+	} //end for
+	return count;
+} //end of the function BotCountMatchPieceChars
+//===========================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+static void BotIndexMatchPieces(bot_matchpiece_t *pieces)
+{
+	int node, child, c;
+	char *ptr;
+	bot_matchpiece_t *mp;
+	bot_matchstring_t *ms;
+
+	for (mp = pieces; mp; mp = mp->next)
+	{
+		if (mp->type != MT_STRING) continue;
+		for (ms = mp->firststring; ms; ms = ms->next)
+		{
+			ms->id = -1;
+			if (!*ms->string) continue;
+			node = 0;
+			for (ptr = ms->string; *ptr; ptr++)
+			{
+				c = toupper(*ptr);
+				child = BotMatchNodeChild(node, c);
+				if (!child)
+				{
+					child = nummatchnodes++;
+					matchnodes[child].c = c;
+					matchnodes[child].output = -1;
+					matchnodes[child].sibling = matchnodes[node].child;
+					matchnodes[node].child = child;
+				} //end if
+				node = child;
+			} //end for
+			if (matchnodes[node].output < 0) matchnodes[node].output = nummatchstrings++;
+			ms->id = matchnodes[node].output;
+		} //end for
+	} //end for
+} //end of the function BotIndexMatchPieces
+//===========================================================================
+// builds the match index over the match templates and reply chat keys
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+void BotBuildMatchIndex(void)
+{
+	int maxnodes, head, tail, node, child, fail, *queue;
+	bot_matchtemplate_t *mt;
+	bot_replychat_t *rchat;
+	bot_replychatkey_t *key;
+
+	//the trie never has more nodes than characters in all strings
+	maxnodes = 1;
+	for (mt = matchtemplates; mt; mt = mt->next) maxnodes += BotCountMatchPieceChars(mt->first);
+	for (rchat = replychats; rchat; rchat = rchat->next)
+	{
+		for (key = rchat->keys; key; key = key->next) maxnodes += BotCountMatchPieceChars(key->match);
+	} //end for
+	//
+	matchnodes = (bot_matchnode_t *) GetClearedMemory(maxnodes * sizeof(bot_matchnode_t) + maxnodes * sizeof(int));
+	queue = (int *) (matchnodes + maxnodes);
+	matchnodes[0].output = -1;
+	nummatchnodes = 1;
+	nummatchstrings = 0;
+	for (mt = matchtemplates; mt; mt = mt->next) BotIndexMatchPieces(mt->first);
+	for (rchat = replychats; rchat; rchat = rchat->next)
+	{
+		for (key = rchat->keys; key; key = key->next) BotIndexMatchPieces(key->match);
+	} //end for
+	//set the fail links breadth first, the root and its children fail to the root
+	head = tail = 0;
+	queue[tail++] = 0;
+	while (head < tail)
+	{
+		node = queue[head++];
+		for (child = matchnodes[node].child; child; child = matchnodes[child].sibling)
+		{
+			queue[tail++] = child;
+			if (!node) continue;
+			for (fail = matchnodes[node].fail; fail; fail = matchnodes[fail].fail)
+			{
+				if (BotMatchNodeChild(fail, matchnodes[child].c)) break;
+			} //end for
+			matchnodes[child].fail = BotMatchNodeChild(fail, matchnodes[child].c);
+			fail = matchnodes[child].fail;
+			matchnodes[child].dict = matchnodes[fail].output >= 0 ? fail : matchnodes[fail].dict;
+		} //end for
+	} //end while
+	//
+	matchstringfound = (byte *) GetClearedMemory(nummatchstrings + 1);
+} //end of the function BotBuildMatchIndex
+//===========================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+void BotFreeMatchIndex(void)
+{
+	if (matchnodes) FreeMemory(matchnodes);
+	matchnodes = NULL;
+	if (matchstringfound) FreeMemory(matchstringfound);
+	matchstringfound = NULL;
+	nummatchnodes = 0;
+	nummatchstrings = 0;
+} //end of the function BotFreeMatchIndex
+//===========================================================================
+// marks every indexed match string the message contains, ignoring case
+// like StringContains does
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+static void BotFindMatchStrings(char *str)
+{
+	int node, next, c, n;
+
+	Com_Memset(matchstringfound, 0, nummatchstrings);
+	node = 0;
+	for (; *str; str++)
+	{
+		c = toupper(*str);
+		while (!(next = BotMatchNodeChild(node, c)) && node) node = matchnodes[node].fail;
+		node = next;
+		for (n = matchnodes[node].output >= 0 ? node : matchnodes[node].dict; n; n = matchnodes[n].dict)
+		{
+			matchstringfound[matchnodes[n].output] = 1;
+		} //end for
+	} //end for
+} //end of the function BotFindMatchStrings
+//===========================================================================
+// quick rejection before StringsMatch, every fixed piece of the template
+// has to occur somewhere in the message
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+static int BotMatchPiecesPossible(bot_matchpiece_t *pieces)
+{
+	bot_matchpiece_t *mp;
+	bot_matchstring_t *ms;
+
+	for (mp = pieces; mp; mp = mp->next)
+	{
+		if (mp->type != MT_STRING) continue;
+		for (ms = mp->firststring; ms; ms = ms->next)
+		{
+			if (ms->id < 0 || matchstringfound[ms->id]) break;
+		} //end for
+		if (!ms) return qfalse;
+	} //end for
+	return qtrue;
+} //end of the function BotMatchPiecesPossible
+//===========================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
 int BotFindMatch(char *str, bot_match_t *match, unsigned long int context)
 {
 	int i;
@@ -1463,10 +1675,13 @@ int BotFindMatch(char *str, bot_match_t *match, unsigned long int context)
 	{
 		match->string[strlen(match->string)-1] = '\0';
 	} //end while
+	//find the fixed strings in the message once for all the templates
+	if (matchnodes) BotFindMatchStrings(match->string);
 	//compare the string with all the match strings
 	for (ms = matchtemplates; ms; ms = ms->next)
 	{
 		if (!(ms->context & context)) continue;
+		if (matchnodes && !BotMatchPiecesPossible(ms->first)) continue;
 		//reset the match variable offsets
 		for (i = 0; i < MAX_MATCHVARIABLES; i++) match->variables[i].offset = -1;
 		//
@@ -2221,7 +2436,7 @@ void BotFreeChatFile(int chatstate)
 int BotLoadChatFile(int chatstate, char *chatfile, char *chatname)
 {
 	bot_chatstate_t *cs;
-	int n, avail = 0;
+	int n, avail = 0, memcategory;
 
 	cs = BotChatStateFromHandle(chatstate);
 	if (!cs) return BLERR_CANNOTLOADICHAT;
@@ -2254,7 +2469,9 @@ int BotLoadChatFile(int chatstate, char *chatfile, char *chatname)
 		}
 	}
 
+	memcategory = BeginMemoryPhase(MEMCAT_CHAT);
 	cs->chat = BotLoadInitialChat(chatfile, chatname);
+	EndMemoryPhase(memcategory);
 	if (!cs->chat)
 	{
 		botimport.Print(PRT_FATAL, "couldn't load chat %s from %s\n", chatname, chatfile);
@@ -2647,6 +2864,7 @@ int BotReplyChat(int chatstate, char *message, int mcontext, int vcontext, char
 	bestpriority = -1;
 	bestchatmessage = NULL;
 	bestrchat = NULL;
+	if (matchnodes) BotFindMatchStrings(match.string);
 	//go through all the reply chats
 	for (rchat = replychats; rchat; rchat = rchat->next)
 	{
@@ -2660,7 +2878,10 @@ int BotReplyChat(int chatstate, char *message, int mcontext, int vcontext, char
 			else if (key->flags & RCKFL_GENDERFEMALE) res = (cs->gender == CHAT_GENDERFEMALE);
 			else if (key->flags & RCKFL_GENDERMALE) res = (cs->gender == CHAT_GENDERMALE);
 			else if (key->flags & RCKFL_GENDERLESS) res = (cs->gender == CHAT_GENDERLESS);
-			else if (key->flags & RCKFL_VARIABLES) res = StringsMatch(key->match, &match);
+			else if (key->flags & RCKFL_VARIABLES)
+			{
+				res = (!matchnodes || BotMatchPiecesPossible(key->match)) && StringsMatch(key->match, &match);
+			} //end else if
 			else if (key->flags & RCKFL_STRING) res = (StringContainsWord(message, key->string, qfalse) != NULL);
 			//if the key must be present
 			if (key->flags & RCKFL_AND)
@@ -2965,11 +3186,13 @@ void BotFreeChatState(int handle)
 int BotSetupChatAI(void)
 {
 	char *file;
+	int memcategory;
 
 #ifdef DEBUG
 	int starttime = Sys_MilliSeconds();
 #endif //DEBUG
 
+	memcategory = BeginMemoryPhase(MEMCAT_CHAT);
 	file = LibVarString("synfile", "syn.c");
 	synonyms = BotLoadSynonyms(file);
 	file = LibVarString("rndfile", "rnd.c");
@@ -2982,6 +3205,8 @@ int BotSetupChatAI(void)
 		file = LibVarString("rchatfile", "rchat.c");
 		replychats = BotLoadReplyChat(file);
 	} //end if
+	BotBuildMatchIndex();
+	EndMemoryPhase(memcategory);
 
 	InitConsoleMessageHeap();
 
@@ -3020,6 +3245,7 @@ void BotShutdownChatAI(void)
 	} //end for
 	if (consolemessageheap) FreeMemory(consolemessageheap);
 	consolemessageheap = NULL;
+	BotFreeMatchIndex();
 	if (matchtemplates) BotFreeMatchTemplates(matchtemplates);
 	matchtemplates = NULL;
 	if (randomstrings) FreeMemory(randomstrings);
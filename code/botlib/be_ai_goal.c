@@ -1697,11 +1697,14 @@ void BotResetGoalState(int goalstate)
 int BotLoadItemWeights(int goalstate, char *filename)
 {
 	bot_goalstate_t *gs;
+	int memcategory;
 
 	gs = BotGoalStateFromHandle(goalstate);
 	if (!gs) return BLERR_CANNOTLOADITEMWEIGHTS;
 	//load the weight configuration
+	memcategory = BeginMemoryPhase(MEMCAT_WEIGHTS);
 	gs->itemweightconfig = ReadWeightConfig(filename);
+	EndMemoryPhase(memcategory);
 	if (!gs->itemweightconfig)
 	{
 		botimport.Print(PRT_FATAL, "couldn't load weights\n");
@@ -1781,13 +1784,16 @@ void BotFreeGoalState(int handle)
 int BotSetupGoalAI(void)
 {
 	char *filename;
+	int memcategory;
 
 	//check if teamplay is on
 	g_gametype = LibVarValue("g_gametype", "0");
 	//item configuration file
 	filename = LibVarString("itemconfig", "items.c");
 	//load the item configuration
+	memcategory = BeginMemoryPhase(MEMCAT_WEIGHTS);
 	itemconfig = LoadItemConfig(filename);
+	EndMemoryPhase(memcategory);
 	if (!itemconfig)
 	{
 		botimport.Print(PRT_WARNING, "couldn't load item config\n");
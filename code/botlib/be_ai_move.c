@@ -1860,7 +1860,7 @@ bot_moveresult_t BotTravel_Jump(bot_movestate_t *ms, aas_reachability_t *reach)
 	bot_moveresult_t_cleared( result );
 
 	//
-	AAS_JumpReachRunStart(reach, runstart);
+	AAS_JumpReachNumRunStart(ms->lastreachnum, runstart);
 	//*
 	hordir[0] = runstart[0] - reach->start[0];
 	hordir[1] = runstart[1] - reach->start[1];
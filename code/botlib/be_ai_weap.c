@@ -364,12 +364,15 @@ void BotFreeWeaponWeights(int weaponstate)
 int BotLoadWeaponWeights(int weaponstate, char *filename)
 {
 	bot_weaponstate_t *ws;
+	int memcategory;
 
 	ws = BotWeaponStateFromHandle(weaponstate);
 	if (!ws) return BLERR_CANNOTLOADWEAPONWEIGHTS;
 	BotFreeWeaponWeights(weaponstate);
 	//
+	memcategory = BeginMemoryPhase(MEMCAT_WEIGHTS);
 	ws->weaponweightconfig = ReadWeightConfig(filename);
+	EndMemoryPhase(memcategory);
 	if (!ws->weaponweightconfig)
 	{
 		botimport.Print(PRT_FATAL, "couldn't load weapon config %s\n", filename);
@@ -492,9 +495,12 @@ void BotFreeWeaponState(int handle)
 int BotSetupWeaponAI(void)
 {
 	char *file;
+	int memcategory;
 
 	file = LibVarString("weaponconfig", "weapons.c");
+	memcategory = BeginMemoryPhase(MEMCAT_WEIGHTS);
 	weaponconfig = LoadWeaponConfig(file);
+	EndMemoryPhase(memcategory);
 	if (!weaponconfig)
 	{
 		botimport.Print(PRT_WARNING, "couldn't load the weapon config\n");
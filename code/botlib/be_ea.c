@@ -39,8 +39,65 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "be_ea.h"
 
 #define MAX_USERMOVE				400
+#define MAX_EA_COMMANDBUFFER		2048
+
+//client commands issued while a bot thinks, executed in order when the
+//input is fetched so thinking never changes the server directly
+typedef struct bot_commands_s
+{
+	int size;
+	char buffer[MAX_EA_COMMANDBUFFER];
+} bot_commands_t;
 
 bot_input_t *botinputs;
+bot_commands_t *botcommands;
+
+static void QDECL EA_QueueCommand(int client, const char *fmt, ...) Q_PRINTF_FUNC(2, 3);
+
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void EA_FlushCommands(int client)
+{
+	bot_commands_t *bc;
+	char *cmd;
+
+	bc = &botcommands[client];
+	for (cmd = bc->buffer; cmd < bc->buffer + bc->size; cmd += strlen(cmd) + 1)
+	{
+		botimport.BotClientCommand(client, cmd);
+	} //end for
+	bc->size = 0;
+} //end of the function EA_FlushCommands
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void QDECL EA_QueueCommand(int client, const char *fmt, ...)
+{
+	bot_commands_t *bc;
+	char cmd[MAX_EA_COMMANDBUFFER];
+	va_list argptr;
+	int len;
+
+	va_start(argptr, fmt);
+	Q_vsnprintf(cmd, sizeof(cmd), fmt, argptr);
+	va_end(argptr);
+
+	bc = &botcommands[client];
+	len = strlen(cmd) + 1;
+	if (bc->size + len > MAX_EA_COMMANDBUFFER)
+	{
+		EA_FlushCommands(client);
+	} //end if
+	Com_Memcpy(bc->buffer + bc->size, cmd, len);
+	bc->size += len;
+} //end of the function EA_QueueCommand
 
 //===========================================================================
 //
@@ -50,7 +107,7 @@ bot_input_t *botinputs;
 //===========================================================================
 void EA_Say(int client, char *str)
 {
-	botimport.BotClientCommand(client, va("say %s", str) );
+	EA_QueueCommand(client, "say %s", str);
 } //end of the function EA_Say
 //===========================================================================
 //
@@ -60,7 +117,7 @@ void EA_Say(int client, char *str)
 //===========================================================================
 void EA_SayTeam(int client, char *str)
 {
-	botimport.BotClientCommand(client, va("say_team %s", str));
+	EA_QueueCommand(client, "say_team %s", str);
 } //end of the function EA_SayTeam
 //===========================================================================
 //
@@ -70,7 +127,7 @@ void EA_SayTeam(int client, char *str)
 //===========================================================================
 void EA_Tell(int client, int clientto, char *str)
 {
-	botimport.BotClientCommand(client, va("tell %d, %s", clientto, str));
+	EA_QueueCommand(client, "tell %d, %s", clientto, str);
 } //end of the function EA_SayTeam
 //===========================================================================
 //
@@ -80,7 +137,7 @@ void EA_Tell(int client, int clientto, char *str)
 //===========================================================================
 void EA_UseItem(int client, char *it)
 {
-	botimport.BotClientCommand(client, va("use %s", it));
+	EA_QueueCommand(client, "use %s", it);
 } //end of the function EA_UseItem
 //===========================================================================
 //
@@ -90,7 +147,7 @@ void EA_UseItem(int client, char *it)
 //===========================================================================
 void EA_DropItem(int client, char *it)
 {
-	botimport.BotClientCommand(client, va("drop %s", it));
+	EA_QueueCommand(client, "drop %s", it);
 } //end of the function EA_DropItem
 //===========================================================================
 //
@@ -100,7 +157,7 @@ void EA_DropItem(int client, char *it)
 //===========================================================================
 void EA_UseInv(int client, char *inv)
 {
-	botimport.BotClientCommand(client, va("invuse %s", inv));
+	EA_QueueCommand(client, "invuse %s", inv);
 } //end of the function EA_UseInv
 //===========================================================================
 //
@@ -110,7 +167,7 @@ void EA_UseInv(int client, char *inv)
 //===========================================================================
 void EA_DropInv(int client, char *inv)
 {
-	botimport.BotClientCommand(client, va("invdrop %s", inv));
+	EA_QueueCommand(client, "invdrop %s", inv);
 } //end of the function EA_DropInv
 //===========================================================================
 //
@@ -134,7 +191,7 @@ void EA_Gesture(int client)
 //===========================================================================
 void EA_Command(int client, char *command)
 {
-	botimport.BotClientCommand(client, command);
+	EA_QueueCommand(client, "%s", command);
 } //end of the function EA_Command
 //===========================================================================
 //
@@ -425,6 +482,8 @@ void EA_GetInput(int client, float thinktime, bot_input_t *input)
 {
 	bot_input_t *bi;
 
+	EA_FlushCommands(client);
+
 	bi = &botinputs[client];
 	bi->thinktime = thinktime;
 	Com_Memcpy(input, bi, sizeof(bot_input_t));
@@ -460,6 +519,8 @@ int EA_Setup(void)
 	//initialize the bot inputs
 	botinputs = (bot_input_t *) GetClearedHunkMemory(
 									botlibglobals.maxclients * sizeof(bot_input_t));
+	botcommands = (bot_commands_t *) GetClearedHunkMemory(
+									botlibglobals.maxclients * sizeof(bot_commands_t));
 	return BLERR_NOERROR;
 } //end of the function EA_Setup
 //===========================================================================
@@ -472,4 +533,6 @@ void EA_Shutdown(void)
 {
 	FreeMemory(botinputs);
 	botinputs = NULL;
+	FreeMemory(botcommands);
+	botcommands = NULL;
 } //end of the function EA_Shutdown
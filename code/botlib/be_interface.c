@@ -197,6 +197,8 @@ int Export_BotLibShutdown(void)
 	LibVarDeAllocAll();
 	//remove all global defines from the pre compiler
 	PC_RemoveAllGlobalDefines();
+	//free the compiled bot files
+	PC_FreeCompiledSources();
 
 	//dump all allocated memory
 //	DumpMemory();
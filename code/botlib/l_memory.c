@@ -41,10 +41,99 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #define MEM_ID		0x12345678l
 #define HUNK_ID		0x87654321l
 
+#define ARENA_ID		0x2468ace0l
+#define ARENA_BLOCKSIZE	(64 * 1024)
+#define ARENA_ALIGN		16
+
 int allocatedmemory;
 int totalmemorysize;
 int numblocks;
 
+//scratch arena block, allocations follow the header
+typedef struct arenablock_s
+{
+	struct arenablock_s *next;
+	int size;
+	int used;
+} arenablock_t;
+
+static const char *memorycategorynames[MEMCAT_MAX] =
+{
+	"general",
+	"character",
+	"chat",
+	"weights",
+	"aas",
+	"routing"
+};
+
+static int memorycategory;
+static int memoryphasedepth;
+static arenablock_t *arenablocks;
+static int arenabytes;
+static int arenapeakbytes;
+static int arenanumblocks;
+static int arenaallocs;
+
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void FreeArena(void)
+{
+	arenablock_t *block;
+
+	while (arenablocks)
+	{
+		block = arenablocks;
+		arenablocks = block->next;
+		botimport.FreeMemory(block);
+	} //end while
+	arenabytes = 0;
+	arenanumblocks = 0;
+} //end of the function FreeArena
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+int SetMemoryCategory(int category)
+{
+	int previous;
+
+	if (category < 0 || category >= MEMCAT_MAX) category = MEMCAT_GENERAL;
+	previous = memorycategory;
+	memorycategory = category;
+	return previous;
+} //end of the function SetMemoryCategory
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+int BeginMemoryPhase(int category)
+{
+	memoryphasedepth++;
+	return SetMemoryCategory(category);
+} //end of the function BeginMemoryPhase
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void EndMemoryPhase(int previous)
+{
+	SetMemoryCategory(previous);
+	if (memoryphasedepth <= 0) return;
+	//nested phases share the outermost phase's arena
+	if (--memoryphasedepth == 0) FreeArena();
+} //end of the function EndMemoryPhase
+
 #ifdef MEMORYMANEGER
 
 typedef struct memoryblock_s
@@ -197,6 +286,33 @@ void *GetClearedHunkMemory(unsigned long size)
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
+void *GetScratchMemory(unsigned long size)
+{
+	void *ptr;
+
+	//every block is tracked while debugging memory
+	ptr = GetMemory(size);
+	return ptr;
+} //end of the function GetScratchMemory
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void *GetClearedScratchMemory(unsigned long size)
+{
+	void *ptr;
+
+	ptr = GetClearedMemory(size);
+	return ptr;
+} //end of the function GetClearedScratchMemory
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
 memoryblock_t *BlockFromPointer(void *ptr, char *str)
 {
 	memoryblock_t *block;
@@ -331,6 +447,52 @@ void DumpMemory(void)
 
 #else
 
+//header in front of every allocation, the id is right in front of the returned pointer
+typedef struct memoryheader_s
+{
+	int size;
+	int category;
+	unsigned long int id;
+} memoryheader_t;
+
+typedef struct memorystats_s
+{
+	int bytes;
+	int peakbytes;
+	int blocks;
+	int hunkbytes;
+} memorystats_t;
+
+static memorystats_t memorystats[MEMCAT_MAX];
+
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void *LinkMemoryHeader(void *ptr, unsigned long size, unsigned long int id)
+{
+	memoryheader_t *header;
+	memorystats_t *stats;
+
+	header = (memoryheader_t *) ptr;
+	header->size = size;
+	header->category = memorycategory;
+	header->id = id;
+	stats = &memorystats[memorycategory];
+	if (id == HUNK_ID)
+	{
+		stats->hunkbytes += size;
+	} //end if
+	else
+	{
+		stats->bytes += size;
+		stats->blocks++;
+		if (stats->bytes > stats->peakbytes) stats->peakbytes = stats->bytes;
+	} //end else
+	return header + 1;
+} //end of the function LinkMemoryHeader
 //===========================================================================
 //
 // Parameter:			-
@@ -344,13 +506,10 @@ void *GetMemory(unsigned long size)
 #endif //MEMDEBUG
 {
 	void *ptr;
-	unsigned long int *memid;
 
-	ptr = botimport.GetMemory(size + sizeof(unsigned long int));
+	ptr = botimport.GetMemory(size + sizeof(memoryheader_t));
 	if (!ptr) return NULL;
-	memid = (unsigned long int *) ptr;
-	*memid = MEM_ID;
-	return (unsigned long int *) ((char *) ptr + sizeof(unsigned long int));
+	return LinkMemoryHeader(ptr, size, MEM_ID);
 } //end of the function GetMemory
 //===========================================================================
 //
@@ -386,13 +545,10 @@ void *GetHunkMemory(unsigned long size)
 #endif //MEMDEBUG
 {
 	void *ptr;
-	unsigned long int *memid;
 
-	ptr = botimport.HunkAlloc(size + sizeof(unsigned long int));
+	ptr = botimport.HunkAlloc(size + sizeof(memoryheader_t));
 	if (!ptr) return NULL;
-	memid = (unsigned long int *) ptr;
-	*memid = HUNK_ID;
-	return (unsigned long int *) ((char *) ptr + sizeof(unsigned long int));
+	return LinkMemoryHeader(ptr, size, HUNK_ID);
 } //end of the function GetHunkMemory
 //===========================================================================
 //
@@ -421,16 +577,98 @@ void *GetClearedHunkMemory(unsigned long size)
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
+static void *AllocFromArena(int size)
+{
+	arenablock_t *block;
+	int blocksize, headersize;
+	void *ptr;
+
+	size = PAD(size, ARENA_ALIGN);
+	headersize = PAD(sizeof(arenablock_t), ARENA_ALIGN);
+	block = arenablocks;
+	if (!block || block->used + size > block->size)
+	{
+		blocksize = headersize + size;
+		if (blocksize < ARENA_BLOCKSIZE) blocksize = ARENA_BLOCKSIZE;
+		block = (arenablock_t *) botimport.GetMemory(blocksize);
+		block->size = blocksize;
+		block->used = headersize;
+		//a block taken by a single large allocation doesn't replace the current one
+		if (arenablocks && blocksize > ARENA_BLOCKSIZE)
+		{
+			block->next = arenablocks->next;
+			arenablocks->next = block;
+		} //end if
+		else
+		{
+			block->next = arenablocks;
+			arenablocks = block;
+		} //end else
+		arenanumblocks++;
+	} //end if
+	ptr = (byte *) block + block->used;
+	block->used += size;
+	arenabytes += size;
+	if (arenabytes > arenapeakbytes) arenapeakbytes = arenabytes;
+	arenaallocs++;
+	return ptr;
+} //end of the function AllocFromArena
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void *GetScratchMemory(unsigned long size)
+{
+	void *ptr;
+
+	if (!memoryphasedepth)
+	{
+		ptr = GetMemory(size);
+		return ptr;
+	} //end if
+	ptr = AllocFromArena(size + sizeof(memoryheader_t));
+	((memoryheader_t *) ptr)->size = size;
+	((memoryheader_t *) ptr)->category = memorycategory;
+	((memoryheader_t *) ptr)->id = ARENA_ID;
+	return (memoryheader_t *) ptr + 1;
+} //end of the function GetScratchMemory
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void *GetClearedScratchMemory(unsigned long size)
+{
+	void *ptr;
+
+	ptr = GetScratchMemory(size);
+	Com_Memset(ptr, 0, size);
+	return ptr;
+} //end of the function GetClearedScratchMemory
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
 void FreeMemory(void *ptr)
 {
-	unsigned long int *memid;
+	memoryheader_t *header;
+	memorystats_t *stats;
 
-	memid = (unsigned long int *) ((char *) ptr - sizeof(unsigned long int));
+	header = (memoryheader_t *) ptr - 1;
 
-	if (*memid == MEM_ID)
+	if (header->id == MEM_ID)
 	{
-		botimport.FreeMemory(memid);
+		stats = &memorystats[header->category];
+		stats->bytes -= header->size;
+		stats->blocks--;
+		botimport.FreeMemory(header);
 	} //end if
+	//scratch memory is released in bulk at the end of the load phase
 } //end of the function FreeMemory
 //===========================================================================
 //
@@ -450,6 +688,18 @@ int AvailableMemory(void)
 //===========================================================================
 void PrintUsedMemorySize(void)
 {
+	memorystats_t *stats;
+	int i;
+
+	botimport.Print(PRT_MESSAGE, "%-10s %10s %10s %8s %10s\n", "category", "zone KB", "peak KB", "blocks", "hunk KB");
+	for (i = 0; i < MEMCAT_MAX; i++)
+	{
+		stats = &memorystats[i];
+		botimport.Print(PRT_MESSAGE, "%-10s %10d %10d %8d %10d\n", memorycategorynames[i],
+							stats->bytes >> 10, stats->peakbytes >> 10, stats->blocks, stats->hunkbytes >> 10);
+	} //end for
+	botimport.Print(PRT_MESSAGE, "scratch arena: %d KB in %d blocks, peak %d KB, %d allocations\n",
+							arenabytes >> 10, arenanumblocks, arenapeakbytes >> 10, arenaallocs);
 } //end of the function PrintUsedMemorySize
 //===========================================================================
 //
@@ -31,6 +31,15 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 //#define MEMDEBUG
 
+//memory categories for the usage counters
+#define MEMCAT_GENERAL			0
+#define MEMCAT_CHARACTER		1
+#define MEMCAT_CHAT				2
+#define MEMCAT_WEIGHTS			3
+#define MEMCAT_AAS				4
+#define MEMCAT_ROUTING			5
+#define MEMCAT_MAX				6
+
 #ifdef MEMDEBUG
 #define GetMemory(size)				GetMemoryDebug(size, #size, __FILE__, __LINE__);
 #define GetClearedMemory(size)		GetClearedMemoryDebug(size, #size, __FILE__, __LINE__);
@@ -62,8 +71,18 @@ void *GetClearedHunkMemory(unsigned long size);
 #endif
 #endif
 
+//allocate short lived memory, released in bulk at the end of the load phase
+void *GetScratchMemory(unsigned long size);
+//allocate short lived memory and clear it
+void *GetClearedScratchMemory(unsigned long size);
 //free the given memory block
 void FreeMemory(void *ptr);
+//account new allocations to the given category, returns the previous category
+int SetMemoryCategory(int category);
+//start a load phase for the given category, returns the previous category
+int BeginMemoryPhase(int category);
+//end the load phase and free the scratch memory when it's the outermost phase
+void EndMemoryPhase(int previous);
 //returns the amount available memory
 int AvailableMemory(void);
 //prints the total used memory size
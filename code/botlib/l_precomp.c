@@ -59,6 +59,7 @@ typedef enum {qfalse, qtrue}	qboolean;
 #include "l_memory.h"
 #include "l_script.h"
 #include "l_precomp.h"
+#include "l_libvar.h"
 #include "l_log.h"
 #endif //BOTLIB
 
@@ -119,6 +120,64 @@ token_t *freetokens;					//free tokens from the heap
 //list with global defines added to every source loaded
 define_t *globaldefines;
 
+#ifdef BOTLIB
+//compiled sources are fully preprocessed token streams that are replayed
+//instead of tokenizing and preprocessing the source file again
+#define PCCACHE_ID				(('C'<<24)+('C'<<16)+('P'<<8)+'B')
+#define PCCACHE_VERSION			1
+#define MAX_PCCACHEDEPS			32
+
+//file a compiled source was built from
+typedef struct pccachedep_s
+{
+	char filename[MAX_QPATH];
+	int length;
+	unsigned int checksum;
+} pccachedep_t;
+
+typedef struct pccachetoken_s
+{
+	int type;
+	int subtype;
+	unsigned long int intvalue;
+	float floatvalue;
+	int line;
+	int linescrossed;
+	int string;								//offset in the string block
+} pccachetoken_t;
+
+//header of a compiled source, followed by the dependencies, tokens and strings
+typedef struct pccacheheader_s
+{
+	int ident;
+	int version;
+	int tokensize;							//sizeof(pccachetoken_t)
+	char filename[MAX_QPATH];				//base folder and file name
+	unsigned int definechecksum;			//checksum of the global defines
+	int numdeps;
+	int numtokens;
+	int stringsize;
+	int pad;								//keeps the tokens 8 byte aligned
+} pccacheheader_t;
+
+typedef struct pc_compiled_s
+{
+	pccacheheader_t *header;				//cache block, also the disk image
+	int size;								//size of the cache block
+	pccachedep_t *deps;
+	pccachetoken_t *tokens;
+	char *strings;
+	int users;								//sources replaying this compiled source
+	int stale;							//free when the last user is done
+	struct pc_compiled_s *next;
+} pc_compiled_t;
+
+pc_compiled_t *compiledsources;
+//dependencies recorded while compiling a source
+pccachedep_t *recordeddeps;
+int numrecordeddeps;
+#endif //BOTLIB
+
 //============================================================================
 //
 // Parameter:				-
@@ -134,6 +193,12 @@ void QDECL SourceError(source_t *source, char *str, ...)
 	Q_vsnprintf(text, sizeof(text), str, ap);
 	va_end(ap);
 #ifdef BOTLIB
+	numscriptdiagnostics++;
+	if (!source->scriptstack)
+	{
+		botimport.Print(PRT_ERROR, "file %s, line %d: %s\n", source->filename, source->token.line, text);
+		return;
+	} //end if
 	botimport.Print(PRT_ERROR, "file %s, line %d: %s\n", source->scriptstack->filename, source->scriptstack->line, text);
 #endif	//BOTLIB
 #ifdef MEQCC
@@ -158,6 +223,12 @@ void QDECL SourceWarning(source_t *source, char *str, ...)
 	Q_vsnprintf(text, sizeof(text), str, ap);
 	va_end(ap);
 #ifdef BOTLIB
+	numscriptdiagnostics++;
+	if (!source->scriptstack)
+	{
+		botimport.Print(PRT_WARNING, "file %s, line %d: %s\n", source->filename, source->token.line, text);
+		return;
+	} //end if
 	botimport.Print(PRT_WARNING, "file %s, line %d: %s\n", source->scriptstack->filename, source->scriptstack->line, text);
 #endif //BOTLIB
 #ifdef MEQCC
@@ -177,7 +248,7 @@ void PC_PushIndent(source_t *source, int type, int skip)
 {
 	indent_t *indent;
 
-	indent = (indent_t *) GetMemory(sizeof(indent_t));
+	indent = (indent_t *) GetScratchMemory(sizeof(indent_t));
 	indent->type = type;
 	indent->script = source->scriptstack;
 	indent->skip = (skip != 0);
@@ -210,6 +281,83 @@ void PC_PopIndent(source_t *source, int *type, int *skip)
 	source->skip -= indent->skip;
 	FreeMemory(indent);
 } //end of the function PC_PopIndent
+#ifdef BOTLIB
+//============================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//============================================================================
+static unsigned int PC_Checksum(const char *data, int length)
+{
+	unsigned int checksum;
+	int i;
+
+	//FNV-1a
+	checksum = 2166136261u;
+	for (i = 0; i < length; i++)
+	{
+		checksum ^= (unsigned char) data[i];
+		checksum *= 16777619u;
+	} //end for
+	return checksum;
+} //end of the function PC_Checksum
+//============================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//============================================================================
+static void PC_RecordDependency(script_t *script)
+{
+	pccachedep_t *dep;
+
+	//too many dependencies are checked after compiling
+	if (numrecordeddeps < MAX_PCCACHEDEPS)
+	{
+		dep = &recordeddeps[numrecordeddeps];
+		Q_strncpyz(dep->filename, script->filename, sizeof(dep->filename));
+		dep->length = script->length;
+		dep->checksum = PC_Checksum(script->buffer, script->length);
+	} //end if
+	numrecordeddeps++;
+} //end of the function PC_RecordDependency
+//============================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//============================================================================
+static int PC_ReadCompiledToken(source_t *source, token_t *token)
+{
+	pccachetoken_t *t;
+
+	if (source->compiledtoken >= source->compiled->header->numtokens) return qfalse;
+	t = &source->compiled->tokens[source->compiledtoken++];
+	Q_strncpyz(token->string, source->compiled->strings + t->string, sizeof(token->string));
+	token->type = t->type;
+	token->subtype = t->subtype;
+	token->intvalue = t->intvalue;
+	token->floatvalue = t->floatvalue;
+	token->whitespace_p = NULL;
+	token->endwhitespace_p = NULL;
+	token->line = t->line;
+	token->linescrossed = t->linescrossed;
+	token->next = NULL;
+	return qtrue;
+} //end of the function PC_ReadCompiledToken
+//============================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//============================================================================
+static void PC_FreeCompiledSource(pc_compiled_t *compiled)
+{
+	FreeMemory(compiled->header);
+	FreeMemory(compiled);
+} //end of the function PC_FreeCompiledSource
+#endif //BOTLIB
 //============================================================================
 //
 // Parameter:				-
@@ -231,6 +379,9 @@ void PC_PushScript(source_t *source, script_t *script)
 	//push the script on the script stack
 	script->next = source->scriptstack;
 	source->scriptstack = script;
+#ifdef BOTLIB
+	if (recordeddeps) PC_RecordDependency(script);
+#endif //BOTLIB
 } //end of the function PC_PushScript
 //============================================================================
 //
@@ -264,7 +415,7 @@ token_t *PC_CopyToken(token_t *token)
 	token_t *t;
 
 //	t = (token_t *) malloc(sizeof(token_t));
-	t = (token_t *) GetMemory(sizeof(token_t));
+	t = (token_t *) GetScratchMemory(sizeof(token_t));
 //	t = freetokens;
 	if (!t)
 	{
@@ -310,6 +461,9 @@ int PC_ReadSourceToken(source_t *source, token_t *token)
 	//if there's no token already available
 	while(!source->tokens)
 	{
+#ifdef BOTLIB
+		if (source->compiled) return PC_ReadCompiledToken(source, token);
+#endif //BOTLIB
 		//if there's a token to read from the script
 		if (PS_ReadToken(source->scriptstack, token)) return qtrue;
 		//if at the end of the script
@@ -681,9 +835,9 @@ void PC_AddBuiltinDefines(source_t *source)
 
 	for (i = 0; builtin[i].string; i++)
 	{
-		define = (define_t *) GetMemory(sizeof(define_t));
+		define = (define_t *) GetScratchMemory(sizeof(define_t));
 		Com_Memset(define, 0, sizeof(define_t));
-		define->name = (char *) GetMemory(strlen(builtin[i].string) + 1);
+		define->name = (char *) GetScratchMemory(strlen(builtin[i].string) + 1);
 		strcpy(define->name, builtin[i].string);
 		define->flags |= DEFINE_FIXED;
 		define->builtin = builtin[i].builtin;
@@ -1211,9 +1365,9 @@ int PC_Directive_define(source_t *source)
 		if (!PC_Directive_undef(source)) return qfalse;
 	} //end if
 	//allocate define
-	define = (define_t *) GetMemory(sizeof(define_t));
+	define = (define_t *) GetScratchMemory(sizeof(define_t));
 	Com_Memset(define, 0, sizeof(define_t));
-	define->name = (char *) GetMemory(strlen(token.string) + 1);
+	define->name = (char *) GetScratchMemory(strlen(token.string) + 1);
 	strcpy(define->name, token.string);
 	//add the define to the source
 #if DEFINEHASHING
@@ -1327,7 +1481,7 @@ define_t *PC_DefineFromString(char *string)
 	Q_strncpyz(src.filename, "*extern", sizeof(src.filename));
 	src.scriptstack = script;
 #if DEFINEHASHING
-	src.definehash = GetClearedMemory(DEFINEHASHSIZE * sizeof(define_t *));
+	src.definehash = GetClearedScratchMemory(DEFINEHASHSIZE * sizeof(define_t *));
 #endif //DEFINEHASHING
 	//create a define from the source
 	res = PC_Directive_define(&src);
@@ -1447,9 +1601,9 @@ define_t *PC_CopyDefine(source_t *source, define_t *define)
 	define_t *newdefine;
 	token_t *token, *newtoken, *lasttoken;
 
-	newdefine = (define_t *) GetMemory(sizeof(define_t));
+	newdefine = (define_t *) GetScratchMemory(sizeof(define_t));
 	//copy the define name
-	newdefine->name = (char *) GetMemory(strlen(define->name) + 1);
+	newdefine->name = (char *) GetScratchMemory(strlen(define->name) + 1);
 	strcpy(newdefine->name, define->name);
 	newdefine->flags = define->flags;
 	newdefine->builtin = define->builtin;
@@ -2987,7 +3141,7 @@ void PC_SetPunctuations(source_t *source, punctuation_t *p)
 // Returns:				-
 // Changes Globals:		-
 //============================================================================
-source_t *LoadSourceFile(const char *filename)
+static source_t *PC_OpenSourceFile(const char *filename)
 {
 	source_t *source;
 	script_t *script;
@@ -2999,7 +3153,7 @@ source_t *LoadSourceFile(const char *filename)
 
 	script->next = NULL;
 
-	source = (source_t *) GetMemory(sizeof(source_t));
+	source = (source_t *) GetScratchMemory(sizeof(source_t));
 	Com_Memset(source, 0, sizeof(source_t));
 
 	Q_strncpyz(source->filename, filename, sizeof(source->filename));
@@ -3010,11 +3164,11 @@ source_t *LoadSourceFile(const char *filename)
 	source->skip = 0;
 
 #if DEFINEHASHING
-	source->definehash = GetClearedMemory(DEFINEHASHSIZE * sizeof(define_t *));
+	source->definehash = GetClearedScratchMemory(DEFINEHASHSIZE * sizeof(define_t *));
 #endif //DEFINEHASHING
 	PC_AddGlobalDefinesToSource(source);
 	return source;
-} //end of the function LoadSourceFile
+} //end of the function PC_OpenSourceFile
 //============================================================================
 //
 // Parameter:				-
@@ -3032,7 +3186,7 @@ source_t *LoadSourceMemory(char *ptr, int length, char *name)
 	if (!script) return NULL;
 	script->next = NULL;
 
-	source = (source_t *) GetMemory(sizeof(source_t));
+	source = (source_t *) GetScratchMemory(sizeof(source_t));
 	Com_Memset(source, 0, sizeof(source_t));
 
 	Q_strncpyz(source->filename, name, sizeof(source->filename));
@@ -3043,7 +3197,7 @@ source_t *LoadSourceMemory(char *ptr, int length, char *name)
 	source->skip = 0;
 
 #if DEFINEHASHING
-	source->definehash = GetClearedMemory(DEFINEHASHSIZE * sizeof(define_t *));
+	source->definehash = GetClearedScratchMemory(DEFINEHASHSIZE * sizeof(define_t *));
 #endif //DEFINEHASHING
 	PC_AddGlobalDefinesToSource(source);
 	return source;
@@ -3107,9 +3261,396 @@ void FreeSource(source_t *source)
 	//
 	if (source->definehash) FreeMemory(source->definehash);
 #endif //DEFINEHASHING
+#ifdef BOTLIB
+	if (source->compiled)
+	{
+		source->compiled->users--;
+		if (source->compiled->stale && !source->compiled->users)
+		{
+			PC_FreeCompiledSource(source->compiled);
+		} //end if
+	} //end if
+#endif //BOTLIB
 	//free the source itself
 	FreeMemory(source);
 } //end of the function FreeSource
+#ifdef BOTLIB
+//============================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//============================================================================
+static unsigned int PC_DefinesChecksum(void)
+{
+	define_t *define;
+	token_t *token;
+	unsigned int checksum;
+
+	checksum = 0;
+	for (define = globaldefines; define; define = define->next)
+	{
+		checksum = checksum * 31 + PC_Checksum(define->name, strlen(define->name));
+		for (token = define->tokens; token; token = token->next)
+		{
+			checksum = checksum * 31 + PC_Checksum(token->string, strlen(token->string));
+		} //end for
+	} //end for
+	return checksum;
+} //end of the function PC_DefinesChecksum
+//============================================================================
+// sets up the pointers into a cache block, returns NULL if the block is bad
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//============================================================================
+static pc_compiled_t *PC_CompiledSourceFromBlock(pccacheheader_t *header, int size)
+{
+	pc_compiled_t *compiled;
+	char *strings;
+	int i, offset;
+
+	if (size < (int) sizeof(pccacheheader_t)) return NULL;
+	if (header->ident != PCCACHE_ID || header->version != PCCACHE_VERSION) return NULL;
+	if (header->tokensize != sizeof(pccachetoken_t)) return NULL;
+	if (header->numdeps < 1 || header->numdeps > MAX_PCCACHEDEPS) return NULL;
+	if (header->numtokens < 0 || header->stringsize < 0) return NULL;
+	if (size != (int) (sizeof(pccacheheader_t) + header->numdeps * sizeof(pccachedep_t) +
+				header->numtokens * sizeof(pccachetoken_t) + header->stringsize)) return NULL;
+	header->filename[sizeof(header->filename)-1] = '\0';
+	//
+	compiled = (pc_compiled_t *) GetClearedMemory(sizeof(pc_compiled_t));
+	compiled->header = header;
+	compiled->size = size;
+	compiled->deps = (pccachedep_t *) (header + 1);
+	compiled->tokens = (pccachetoken_t *) (compiled->deps + header->numdeps);
+	compiled->strings = (char *) (compiled->tokens + header->numtokens);
+	//every token string must be terminated within the string block
+	strings = compiled->strings;
+	for (i = 0; i < header->numtokens; i++)
+	{
+		offset = compiled->tokens[i].string;
+		if (offset < 0 || offset >= header->stringsize ||
+			!memchr(strings + offset, '\0', MIN(header->stringsize - offset, MAX_TOKEN)))
+		{
+			FreeMemory(compiled);
+			return NULL;
+		} //end if
+	} //end for
+	for (i = 0; i < header->numdeps; i++)
+	{
+		compiled->deps[i].filename[sizeof(compiled->deps[i].filename)-1] = '\0';
+	} //end for
+	return compiled;
+} //end of the function PC_CompiledSourceFromBlock
+//============================================================================
+// returns true if none of the files the source was compiled from changed
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//============================================================================
+static int PC_CompiledSourceValid(pc_compiled_t *compiled)
+{
+	pccachedep_t *dep;
+	script_t *script;
+	int i, valid;
+
+	for (i = 0; i < compiled->header->numdeps; i++)
+	{
+		dep = &compiled->deps[i];
+		script = LoadScriptFile(dep->filename);
+		if (!script) return qfalse;
+		valid = script->length == dep->length &&
+					PC_Checksum(script->buffer, script->length) == dep->checksum;
+		FreeScript(script);
+		if (!valid) return qfalse;
+	} //end for
+	return qtrue;
+} //end of the function PC_CompiledSourceValid
+//============================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//============================================================================
+static int PC_CompiledSourceFileName(const char *key, char *filename, int size)
+{
+	char *ptr;
+
+	if ((int) (strlen("botcache/") + strlen(key) + strlen(".pcc")) >= size) return qfalse;
+	Com_sprintf(filename, size, "botcache/%s.pcc", key);
+	for (ptr = filename + strlen("botcache/"); *ptr; ptr++)
+	{
+		if (*ptr == '/' || *ptr == '\\' || *ptr == ':') *ptr = '_';
+	} //end for
+	return qtrue;
+} //end of the function PC_CompiledSourceFileName
+//============================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//============================================================================
+static pc_compiled_t *PC_ReadCompiledSource(const char *key, unsigned int definechecksum)
+{
+	char filename[MAX_QPATH];
+	fileHandle_t fp;
+	pccacheheader_t *header;
+	pc_compiled_t *compiled;
+	int length;
+
+	if (!PC_CompiledSourceFileName(key, filename, sizeof(filename))) return NULL;
+	length = botimport.FS_FOpenFile(filename, &fp, FS_READ);
+	if (!fp) return NULL;
+	if (length < (int) sizeof(pccacheheader_t))
+	{
+		botimport.FS_FCloseFile(fp);
+		return NULL;
+	} //end if
+	header = (pccacheheader_t *) GetMemory(length);
+	botimport.FS_Read(header, length, fp);
+	botimport.FS_FCloseFile(fp);
+	//
+	compiled = PC_CompiledSourceFromBlock(header, length);
+	if (!compiled)
+	{
+		FreeMemory(header);
+		return NULL;
+	} //end if
+	if (Q_stricmp(header->filename, key) || header->definechecksum != definechecksum ||
+			!PC_CompiledSourceValid(compiled))
+	{
+		PC_FreeCompiledSource(compiled);
+		return NULL;
+	} //end if
+	return compiled;
+} //end of the function PC_ReadCompiledSource
+//============================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//============================================================================
+static void PC_WriteCompiledSource(pc_compiled_t *compiled)
+{
+	char filename[MAX_QPATH];
+	fileHandle_t fp;
+
+	if (!PC_CompiledSourceFileName(compiled->header->filename, filename, sizeof(filename))) return;
+	botimport.FS_FOpenFile(filename, &fp, FS_WRITE);
+	if (!fp) return;
+	botimport.FS_Write(compiled->header, compiled->size, fp);
+	botimport.FS_FCloseFile(fp);
+} //end of the function PC_WriteCompiledSource
+//============================================================================
+// reads all tokens from the source file through the precompiler
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//============================================================================
+static pc_compiled_t *PC_CompileSourceFile(const char *filename, const char *key, unsigned int definechecksum)
+{
+	source_t *source;
+	token_t token;
+	pccachedep_t deps[MAX_PCCACHEDEPS];
+	pccachetoken_t *tokens, *t;
+	pccacheheader_t *header;
+	pc_compiled_t *compiled;
+	char *strings, *ptr;
+	void *newbuf;
+	int diagnostics, numcompiled, maxtokens, stringsize, maxstringsize, len, size;
+
+	diagnostics = numscriptdiagnostics;
+	source = PC_OpenSourceFile(filename);
+	if (!source) return NULL;
+	recordeddeps = deps;
+	numrecordeddeps = 0;
+	PC_RecordDependency(source->scriptstack);
+	//
+	numcompiled = 0;
+	maxtokens = 1024;
+	tokens = (pccachetoken_t *) GetMemory(maxtokens * sizeof(pccachetoken_t));
+	stringsize = 0;
+	maxstringsize = 16384;
+	strings = (char *) GetMemory(maxstringsize);
+	while(PC_ReadToken(source, &token))
+	{
+		if (numcompiled >= maxtokens)
+		{
+			newbuf = GetMemory(maxtokens * 2 * sizeof(pccachetoken_t));
+			Com_Memcpy(newbuf, tokens, numcompiled * sizeof(pccachetoken_t));
+			FreeMemory(tokens);
+			tokens = (pccachetoken_t *) newbuf;
+			maxtokens *= 2;
+		} //end if
+		len = strlen(token.string) + 1;
+		if (stringsize + len > maxstringsize)
+		{
+			newbuf = GetMemory(maxstringsize * 2);
+			Com_Memcpy(newbuf, strings, stringsize);
+			FreeMemory(strings);
+			strings = (char *) newbuf;
+			maxstringsize *= 2;
+		} //end if
+		t = &tokens[numcompiled++];
+		t->type = token.type;
+		t->subtype = token.subtype;
+		t->intvalue = token.intvalue;
+		t->floatvalue = token.floatvalue;
+		t->line = token.line;
+		t->linescrossed = token.linescrossed;
+		t->string = stringsize;
+		Com_Memcpy(strings + stringsize, token.string, len);
+		stringsize += len;
+	} //end while
+	recordeddeps = NULL;
+	FreeSource(source);
+	//sources with errors or warnings aren't cached so they're reported on every load
+	if (numscriptdiagnostics != diagnostics || numrecordeddeps > MAX_PCCACHEDEPS)
+	{
+		FreeMemory(tokens);
+		FreeMemory(strings);
+		return NULL;
+	} //end if
+	//
+	size = sizeof(pccacheheader_t) + numrecordeddeps * sizeof(pccachedep_t) +
+				numcompiled * sizeof(pccachetoken_t) + stringsize;
+	header = (pccacheheader_t *) GetClearedMemory(size);
+	header->ident = PCCACHE_ID;
+	header->version = PCCACHE_VERSION;
+	header->tokensize = sizeof(pccachetoken_t);
+	Q_strncpyz(header->filename, key, sizeof(header->filename));
+	header->definechecksum = definechecksum;
+	header->numdeps = numrecordeddeps;
+	header->numtokens = numcompiled;
+	header->stringsize = stringsize;
+	ptr = (char *) (header + 1);
+	Com_Memcpy(ptr, deps, numrecordeddeps * sizeof(pccachedep_t));
+	ptr += numrecordeddeps * sizeof(pccachedep_t);
+	Com_Memcpy(ptr, tokens, numcompiled * sizeof(pccachetoken_t));
+	ptr += numcompiled * sizeof(pccachetoken_t);
+	Com_Memcpy(ptr, strings, stringsize);
+	FreeMemory(tokens);
+	FreeMemory(strings);
+	//
+	compiled = PC_CompiledSourceFromBlock(header, size);
+	if (!compiled) FreeMemory(header);
+	return compiled;
+} //end of the function PC_CompileSourceFile
+//============================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//============================================================================
+static pc_compiled_t *PC_FindCompiledSource(const char *filename, int diskcache)
+{
+	char key[MAX_QPATH];
+	unsigned int definechecksum;
+	pc_compiled_t *compiled, *prev;
+
+	if (strlen(PS_BaseFolder()) + 1 + strlen(filename) >= sizeof(key)) return NULL;
+	if (strlen(PS_BaseFolder()))
+		Com_sprintf(key, sizeof(key), "%s/%s", PS_BaseFolder(), filename);
+	else
+		Com_sprintf(key, sizeof(key), "%s", filename);
+	definechecksum = PC_DefinesChecksum();
+	//
+	prev = NULL;
+	for (compiled = compiledsources; compiled; compiled = compiled->next)
+	{
+		if (!Q_stricmp(compiled->header->filename, key)) break;
+		prev = compiled;
+	} //end for
+	if (compiled)
+	{
+		if (compiled->header->definechecksum == definechecksum &&
+				PC_CompiledSourceValid(compiled)) return compiled;
+		if (prev) prev->next = compiled->next;
+		else compiledsources = compiled->next;
+		if (compiled->users) compiled->stale = qtrue;
+		else PC_FreeCompiledSource(compiled);
+	} //end if
+	//
+	compiled = NULL;
+	if (diskcache) compiled = PC_ReadCompiledSource(key, definechecksum);
+	if (!compiled)
+	{
+		compiled = PC_CompileSourceFile(filename, key, definechecksum);
+		if (!compiled) return NULL;
+		if (diskcache) PC_WriteCompiledSource(compiled);
+	} //end if
+	compiled->next = compiledsources;
+	compiledsources = compiled;
+	return compiled;
+} //end of the function PC_FindCompiledSource
+//============================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//============================================================================
+static source_t *PC_LoadCompiledSource(pc_compiled_t *compiled, const char *filename)
+{
+	source_t *source;
+
+	source = (source_t *) GetScratchMemory(sizeof(source_t));
+	Com_Memset(source, 0, sizeof(source_t));
+
+	Q_strncpyz(source->filename, filename, sizeof(source->filename));
+#if DEFINEHASHING
+	source->definehash = GetClearedScratchMemory(DEFINEHASHSIZE * sizeof(define_t *));
+#endif //DEFINEHASHING
+	//the global defines were already applied when compiling
+	source->compiled = compiled;
+	source->compiledtoken = 0;
+	compiled->users++;
+	return source;
+} //end of the function PC_LoadCompiledSource
+//============================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//============================================================================
+void PC_FreeCompiledSources(void)
+{
+	pc_compiled_t *compiled;
+
+	while(compiledsources)
+	{
+		compiled = compiledsources;
+		compiledsources = compiled->next;
+		if (compiled->users) compiled->stale = qtrue;
+		else PC_FreeCompiledSource(compiled);
+	} //end while
+} //end of the function PC_FreeCompiledSources
+#endif //BOTLIB
+//============================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//============================================================================
+source_t *LoadSourceFile(const char *filename)
+{
+#ifdef BOTLIB
+	pc_compiled_t *compiled;
+	int precompcache;
+
+	//0 = off, 1 = keep compiled sources in memory, 2 = also on disk
+	precompcache = (int) LibVarValue("precompcache", "2");
+	if (precompcache)
+	{
+		compiled = PC_FindCompiledSource(filename, precompcache >= 2);
+		if (compiled) return PC_LoadCompiledSource(compiled, filename);
+	} //end if
+#endif //BOTLIB
+	return PC_OpenSourceFile(filename);
+} //end of the function LoadSourceFile
 //============================================================================
 //
 // Parameter:			-
@@ -3134,7 +3675,7 @@ int PC_LoadSourceHandle(const char *filename)
 	if (i >= MAX_SOURCEFILES)
 		return 0;
 	PS_SetBaseFolder("");
-	source = LoadSourceFile(filename);
+	source = PC_OpenSourceFile(filename);
 	if (!source)
 		return 0;
 	sourceFiles[i] = source;
@@ -164,6 +164,8 @@ punctuation_t default_punctuations[] =
 char basefolder[MAX_QPATH];
 #endif
 
+int numscriptdiagnostics;
+
 //===========================================================================
 //
 // Parameter:				-
@@ -177,7 +179,7 @@ void PS_CreatePunctuationTable(script_t *script, punctuation_t *punctuations)
 
 	//get memory for the table
 	if (!script->punctuationtable) script->punctuationtable = (punctuation_t **)
-												GetMemory(256 * sizeof(punctuation_t *));
+												GetScratchMemory(256 * sizeof(punctuation_t *));
 	Com_Memset(script->punctuationtable, 0, 256 * sizeof(punctuation_t *));
 	//add the punctuations in the list to the punctuation table
 	for (i = 0; punctuations[i].p; i++)
@@ -232,6 +234,7 @@ void QDECL ScriptError(script_t *script, char *str, ...)
 	va_list ap;
 
 	if (script->flags & SCFL_NOERRORS) return;
+	numscriptdiagnostics++;
 
 	va_start(ap, str);
 	Q_vsnprintf(text, sizeof(text), str, ap);
@@ -258,6 +261,7 @@ void QDECL ScriptWarning(script_t *script, char *str, ...)
 	va_list ap;
 
 	if (script->flags & SCFL_NOWARNINGS) return;
+	numscriptdiagnostics++;
 
 	va_start(ap, str);
 	Q_vsnprintf(text, sizeof(text), str, ap);
@@ -1347,7 +1351,7 @@ script_t *LoadScriptFile(const char *filename)
 	length = FileLength(fp);
 #endif
 
-	buffer = GetClearedMemory(sizeof(script_t) + length + 1);
+	buffer = GetClearedScratchMemory(sizeof(script_t) + length + 1);
 	script = (script_t *) buffer;
 	Com_Memset(script, 0, sizeof(script_t));
 	Q_strncpyz(script->filename, filename, sizeof(script->filename));
@@ -1393,7 +1397,7 @@ script_t *LoadScriptMemory(char *ptr, int length, char *name)
 	void *buffer;
 	script_t *script;
 
-	buffer = GetClearedMemory(sizeof(script_t) + length + 1);
+	buffer = GetClearedScratchMemory(sizeof(script_t) + length + 1);
 	script = (script_t *) buffer;
 	Com_Memset(script, 0, sizeof(script_t));
 	Q_strncpyz(script->filename, name, sizeof(script->filename));
@@ -1443,3 +1447,17 @@ void PS_SetBaseFolder(char *path)
 	Com_sprintf(basefolder, sizeof(basefolder), "%s", path);
 #endif
 } //end of the function PS_SetBaseFolder
+//============================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//============================================================================
+char *PS_BaseFolder(void)
+{
+#ifdef BOTLIB
+	return basefolder;
+#else
+	return "";
+#endif
+} //end of the function PS_BaseFolder
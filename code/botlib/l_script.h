@@ -239,9 +239,14 @@ script_t *LoadScriptMemory(char *ptr, int length, char *name);
 void FreeScript(script_t *script);
 //set the base folder to load files from
 void PS_SetBaseFolder(char *path);
+//returns the base folder files are loaded from
+char *PS_BaseFolder(void);
 //print a script error with filename and line number
 void QDECL ScriptError(script_t *script, char *str, ...) Q_PRINTF_FUNC(2, 3);
 //print a script warning with filename and line number
 void QDECL ScriptWarning(script_t *script, char *str, ...) Q_PRINTF_FUNC(2, 3);
 
+//number of script and source errors and warnings printed
+extern int numscriptdiagnostics;
+
 
@@ -124,74 +124,198 @@ void CG_Text_PaintChar(float x, float y, float width, float height, float scale,
   trap_R_DrawStretchPic( x, y, w, h, s, t, s2, t2, hShader );
 }
 
+/*
+==============================================================================
+
+TEXT CACHE
+
+HUD and scoreboard strings rarely change from frame to frame, so the
+glyph walk is done once and the resulting quads are kept, relative to
+the text origin, keyed on everything that affects their layout
+
+==============================================================================
+*/
+
+#define	TEXT_CACHE_SIZE			64		// must be a power of two
+#define	MAX_TEXT_CACHE_CHARS	64
+#define	MAX_TEXT_CACHE_PICS		128
+#define	MAX_TEXT_BUILD_PICS		( MAX_STRING_CHARS * 2 )
+
+typedef struct {
+	qboolean		valid;
+	char			text[MAX_TEXT_CACHE_CHARS];
+	fontInfo_t		*font;
+	float			scale;
+	float			adjust;
+	vec4_t			color;
+	int				limit;
+	int				style;
+	int				numPics;
+	stretchPic_t	pics[MAX_TEXT_CACHE_PICS];	// 640*480 values relative to the text origin
+} textCache_t;
+
+static textCache_t	cg_textCache[TEXT_CACHE_SIZE];
+static stretchPic_t	cg_textBuild[MAX_TEXT_BUILD_PICS];
+
+/*
+================
+CG_Text_Hash
+================
+*/
+static int CG_Text_Hash( const char *text, float scale, int limit, int style ) {
+	int		hash;
+
+	hash = limit * 31 + style * 7 + (int)( scale * 1000 );
+	while ( *text ) {
+		hash = hash * 33 + *text;
+		text++;
+	}
+	return hash & ( TEXT_CACHE_SIZE - 1 );
+}
+
+/*
+================
+CG_Text_CacheMatches
+================
+*/
+static qboolean CG_Text_CacheMatches( const textCache_t *tc, fontInfo_t *font, float scale, 
+									 const vec4_t color, const char *text, float adjust, int limit, int style ) {
+	if ( !tc->valid || tc->font != font || tc->scale != scale || tc->adjust != adjust
+		|| tc->limit != limit || tc->style != style ) {
+		return qfalse;
+	}
+	if ( tc->color[0] != color[0] || tc->color[1] != color[1] 
+		|| tc->color[2] != color[2] || tc->color[3] != color[3] ) {
+		return qfalse;
+	}
+	return ( strcmp( tc->text, text ) == 0 );
+}
+
+/*
+================
+CG_Text_BuildPics
+
+Lays out the quads for a string with its origin at 0,0
+================
+*/
+static int CG_Text_BuildPics( fontInfo_t *font, float scale, const vec4_t color, const char *text, 
+							 float adjust, int limit, int style, stretchPic_t *pics, int maxPics ) {
+	int				len, count;
+	int				numPics;
+	vec4_t			newColor;
+	vec4_t			shadowColor;
+	glyphInfo_t		*glyph;
+	stretchPic_t	*pic;
+	float			useScale;
+	float			x;
+	const char		*s;
+
+	useScale = scale * font->glyphScale;
+	memcpy( newColor, color, sizeof( vec4_t ) );
+	len = strlen( text );
+	if ( limit > 0 && len > limit ) {
+		len = limit;
+	}
+	s = text;
+	x = 0;
+	count = 0;
+	numPics = 0;
+	while ( *s && count < len ) {
+		if ( Q_IsColorString( s ) ) {
+			memcpy( newColor, g_color_table[ColorIndex(*(s+1))], sizeof( newColor ) );
+			newColor[3] = color[3];
+			s += 2;
+			continue;
+		}
+		if ( numPics + 2 > maxPics ) {
+			break;
+		}
+		glyph = &font->glyphs[*s & 255];
+		if ( style == ITEM_TEXTSTYLE_SHADOWED || style == ITEM_TEXTSTYLE_SHADOWEDMORE ) {
+			int ofs = style == ITEM_TEXTSTYLE_SHADOWED ? 1 : 2;
+
+			pic = &pics[numPics++];
+			pic->x = x + ofs;
+			pic->y = ofs - useScale * glyph->top;
+			pic->w = glyph->imageWidth * useScale;
+			pic->h = glyph->imageHeight * useScale;
+			pic->s1 = glyph->s;
+			pic->t1 = glyph->t;
+			pic->s2 = glyph->s2;
+			pic->t2 = glyph->t2;
+			pic->hShader = glyph->glyph;
+			VectorCopy( colorBlack, shadowColor );
+			shadowColor[3] = newColor[3];
+			Vector4Copy( shadowColor, pic->color );
+		}
+		pic = &pics[numPics++];
+		pic->x = x;
+		pic->y = -useScale * glyph->top;
+		pic->w = glyph->imageWidth * useScale;
+		pic->h = glyph->imageHeight * useScale;
+		pic->s1 = glyph->s;
+		pic->t1 = glyph->t;
+		pic->s2 = glyph->s2;
+		pic->t2 = glyph->t2;
+		pic->hShader = glyph->glyph;
+		Vector4Copy( newColor, pic->color );
+
+		x += ( glyph->xSkip * useScale ) + adjust;
+		s++;
+		count++;
+	}
+	return numPics;
+}
+
 void CG_Text_Paint(float x, float y, float scale, vec4_t color, const char *text, float adjust, int limit, int style) {
-  int len, count;
-	vec4_t newColor;
-	glyphInfo_t *glyph;
-	float useScale;
+	textCache_t		*tc;
+	stretchPic_t	*pics;
+	int				numPics;
+	int				i;
 	fontInfo_t *font = &cgDC.Assets.textFont;
+
+	if ( !text ) {
+		return;
+	}
 	if (scale <= cg_smallFont.value) {
 		font = &cgDC.Assets.smallFont;
 	} else if (scale > cg_bigFont.value) {
 		font = &cgDC.Assets.bigFont;
 	}
-	useScale = scale * font->glyphScale;
-  if (text) {
-		const char *s = text;
-		trap_R_SetColor( color );
-		memcpy(&newColor[0], &color[0], sizeof(vec4_t));
-    len = strlen(text);
-		if (limit > 0 && len > limit) {
-			len = limit;
+
+	tc = NULL;
+	if ( strlen( text ) < MAX_TEXT_CACHE_CHARS ) {
+		tc = &cg_textCache[ CG_Text_Hash( text, scale, limit, style ) ];
+	}
+
+	if ( tc && CG_Text_CacheMatches( tc, font, scale, color, text, adjust, limit, style ) ) {
+		pics = tc->pics;
+		numPics = tc->numPics;
+	} else {
+		pics = cg_textBuild;
+		numPics = CG_Text_BuildPics( font, scale, color, text, adjust, limit, style, 
+			cg_textBuild, MAX_TEXT_BUILD_PICS );
+		if ( tc && numPics <= MAX_TEXT_CACHE_PICS ) {
+			tc->valid = qtrue;
+			Q_strncpyz( tc->text, text, sizeof( tc->text ) );
+			tc->font = font;
+			tc->scale = scale;
+			tc->adjust = adjust;
+			Vector4Copy( color, tc->color );
+			tc->limit = limit;
+			tc->style = style;
+			tc->numPics = numPics;
+			memcpy( tc->pics, cg_textBuild, numPics * sizeof( stretchPic_t ) );
 		}
-		count = 0;
-		while (s && *s && count < len) {
-			glyph = &font->glyphs[*s & 255];
-      //int yadj = Assets.textFont.glyphs[text[i]].bottom + Assets.textFont.glyphs[text[i]].top;
-      //float yadj = scale * (Assets.textFont.glyphs[text[i]].imageHeight - Assets.textFont.glyphs[text[i]].height);
-			if ( Q_IsColorString( s ) ) {
-				memcpy( newColor, g_color_table[ColorIndex(*(s+1))], sizeof( newColor ) );
-				newColor[3] = color[3];
-				trap_R_SetColor( newColor );
-				s += 2;
-				continue;
-			} else {
-				float yadj = useScale * glyph->top;
-				if (style == ITEM_TEXTSTYLE_SHADOWED || style == ITEM_TEXTSTYLE_SHADOWEDMORE) {
-					int ofs = style == ITEM_TEXTSTYLE_SHADOWED ? 1 : 2;
-					colorBlack[3] = newColor[3];
-					trap_R_SetColor( colorBlack );
-					CG_Text_PaintChar(x + ofs, y - yadj + ofs, 
-														glyph->imageWidth,
-														glyph->imageHeight,
-														useScale, 
-														glyph->s,
-														glyph->t,
-														glyph->s2,
-														glyph->t2,
-														glyph->glyph);
-					colorBlack[3] = 1.0;
-					trap_R_SetColor( newColor );
-				}
-				CG_Text_PaintChar(x, y - yadj, 
-													glyph->imageWidth,
-													glyph->imageHeight,
-													useScale, 
-													glyph->s,
-													glyph->t,
-													glyph->s2,
-													glyph->t2,
-													glyph->glyph);
-				// CG_DrawPic(x, y - yadj, scale * cgDC.Assets.textFont.glyphs[text[i]].imageWidth, scale * cgDC.Assets.textFont.glyphs[text[i]].imageHeight, cgDC.Assets.textFont.glyphs[text[i]].glyph);
-				x += (glyph->xSkip * useScale) + adjust;
-				s++;
-				count++;
-			}
-    }
-	  trap_R_SetColor( NULL );
-  }
-}
+	}
 
+	for ( i = 0 ; i < numPics ; i++ ) {
+		CG_AddTextPic( x + pics[i].x, y + pics[i].y, pics[i].w, pics[i].h,
+			pics[i].s1, pics[i].t1, pics[i].s2, pics[i].t2, pics[i].hShader, pics[i].color );
+	}
+	CG_FlushTextPics();
+	trap_R_SetColor( NULL );
+}
 
 #endif
 
@@ -2647,6 +2771,9 @@ void CG_DrawActive( stereoFrame_t stereoView ) {
 	if(stereoView != STEREO_CENTER)
 		CG_DrawCrosshair3D();
 
+	// hand over the polys gathered this frame
+	CG_FlushPolyBatches();
+
 	// draw 3D view
 	trap_R_RenderScene( &cg.refdef );
 
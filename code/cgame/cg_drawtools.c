@@ -151,6 +151,89 @@ void CG_DrawChar( int x, int y, int width, int height, int ch ) {
 }
 
 
+/*
+==============================================================================
+
+TEXT BATCHING
+
+Characters are queued as stretch pics and handed to the renderer a
+whole string at a time instead of one trap per character
+
+==============================================================================
+*/
+
+#define	MAX_TEXT_PICS	256
+
+static stretchPic_t	cg_textPics[MAX_TEXT_PICS];
+static int			cg_numTextPics;
+
+/*
+================
+CG_FlushTextPics
+================
+*/
+void CG_FlushTextPics( void ) {
+	if ( cg_numTextPics ) {
+		trap_R_DrawStretchPics( cg_numTextPics, cg_textPics );
+		cg_numTextPics = 0;
+	}
+}
+
+/*
+================
+CG_AddTextPic
+
+Coordinates are 640*480 virtual values
+================
+*/
+void CG_AddTextPic( float x, float y, float w, float h, 
+				   float s1, float t1, float s2, float t2, qhandle_t hShader, const float *color ) {
+	stretchPic_t	*pic;
+
+	if ( cg_numTextPics == MAX_TEXT_PICS ) {
+		CG_FlushTextPics();
+	}
+	pic = &cg_textPics[cg_numTextPics++];
+
+	CG_AdjustFrom640( &x, &y, &w, &h );
+	pic->x = x;
+	pic->y = y;
+	pic->w = w;
+	pic->h = h;
+	pic->s1 = s1;
+	pic->t1 = t1;
+	pic->s2 = s2;
+	pic->t2 = t2;
+	pic->hShader = hShader;
+	Vector4Copy( color, pic->color );
+}
+
+/*
+================
+CG_AddCharPic
+
+Queues a character from the console charset
+================
+*/
+static void CG_AddCharPic( int x, int y, int width, int height, int ch, const float *color ) {
+	float	frow, fcol;
+	float	size;
+
+	ch &= 255;
+
+	if ( ch == ' ' ) {
+		return;
+	}
+
+	frow = ( ch >> 4 ) * 0.0625;
+	fcol = ( ch & 15 ) * 0.0625;
+	size = 0.0625;
+
+	CG_AddTextPic( x, y, width, height, fcol, frow, fcol + size, frow + size, 
+		cgs.media.charsetShader, color );
+}
+
+
 /*
 ==================
 CG_DrawStringExt
@@ -175,7 +258,6 @@ void CG_DrawStringExt( int x, int y, const char *string, const float *setColor,
 	if (shadow) {
 		color[0] = color[1] = color[2] = 0;
 		color[3] = setColor[3];
-		trap_R_SetColor( color );
 		s = string;
 		xx = x;
 		cnt = 0;
@@ -184,7 +266,7 @@ void CG_DrawStringExt( int x, int y, const char *string, const float *setColor,
 				s += 2;
 				continue;
 			}
-			CG_DrawChar( xx + 2, y + 2, charWidth, charHeight, *s );
+			CG_AddCharPic( xx + 2, y + 2, charWidth, charHeight, *s, color );
 			cnt++;
 			xx += charWidth;
 			s++;
@@ -195,22 +277,22 @@ void CG_DrawStringExt( int x, int y, const char *string, const float *setColor,
 	s = string;
 	xx = x;
 	cnt = 0;
-	trap_R_SetColor( setColor );
+	Vector4Copy( setColor, color );
 	while ( *s && cnt < maxChars) {
 		if ( Q_IsColorString( s ) ) {
 			if ( !forceColor ) {
 				memcpy( color, g_color_table[ColorIndex(*(s+1))], sizeof( color ) );
 				color[3] = setColor[3];
-				trap_R_SetColor( color );
 			}
 			s += 2;
 			continue;
 		}
-		CG_DrawChar( xx, y, charWidth, charHeight, *s );
+		CG_AddCharPic( xx, y, charWidth, charHeight, *s, color );
 		xx += charWidth;
 		cnt++;
 		s++;
 	}
+	CG_FlushTextPics();
 	trap_R_SetColor( NULL );
 }
 
@@ -25,6 +25,96 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "cg_local.h"
 
 
+/*
+======================
+TAG CACHE
+
+Players sharing a model and animation frame, and the same entity drawn
+in several views, lerp the same tags over and over.  Lerped tags are
+remembered for the rest of the frame so each distinct one costs a
+single trap.
+======================
+*/
+
+#define	TAG_CACHE_SIZE		256		// power of two
+#define	TAG_CACHE_PROBES	8
+
+typedef struct {
+	int				frame;			// cg.clientFrame it was filled in
+	qhandle_t		model;
+	int				startFrame;
+	int				endFrame;
+	float			frac;
+	char			tagName[MAX_QPATH];
+	qboolean		found;
+	orientation_t	tag;
+} cachedTag_t;
+
+static cachedTag_t	cg_tagCache[TAG_CACHE_SIZE];
+
+/*
+======================
+CG_ClearTagCache
+
+Model handles change with the level or renderer, so nothing cached
+before CG_Init may be reused
+======================
+*/
+void CG_ClearTagCache( void ) {
+	memset( cg_tagCache, 0, sizeof( cg_tagCache ) );
+}
+
+/*
+======================
+CG_LerpTag
+
+trap_R_LerpTag through the per-frame tag cache
+======================
+*/
+qboolean CG_LerpTag( orientation_t *tag, qhandle_t model, int startFrame, int endFrame,
+					float frac, const char *tagName ) {
+	cachedTag_t	*ct, *empty;
+	unsigned	hash;
+	int			i;
+
+	hash = model * 31 + startFrame * 17 + endFrame * 7 + (int)( frac * 1024 );
+	for ( i = 0 ; tagName[i] ; i++ ) {
+		hash = hash * 33 + tagName[i];
+	}
+
+	empty = NULL;
+	for ( i = 0 ; i < TAG_CACHE_PROBES ; i++ ) {
+		ct = &cg_tagCache[( hash + i ) & ( TAG_CACHE_SIZE - 1 )];
+		if ( ct->frame != cg.clientFrame ) {
+			if ( !empty ) {
+				empty = ct;
+			}
+			continue;
+		}
+		if ( ct->model == model && ct->startFrame == startFrame && ct->endFrame == endFrame
+			&& ct->frac == frac && !strcmp( ct->tagName, tagName ) ) {
+			*tag = ct->tag;
+			return ct->found;
+		}
+	}
+
+	if ( !empty || strlen( tagName ) >= sizeof( empty->tagName ) ) {
+		return trap_R_LerpTag( tag, model, startFrame, endFrame, frac, tagName );
+	}
+
+	empty->frame = cg.clientFrame;
+	empty->model = model;
+	empty->startFrame = startFrame;
+	empty->endFrame = endFrame;
+	empty->frac = frac;
+	Q_strncpyz( empty->tagName, tagName, sizeof( empty->tagName ) );
+	empty->found = trap_R_LerpTag( &empty->tag, model, startFrame, endFrame, frac, tagName );
+
+	*tag = empty->tag;
+	return empty->found;
+}
+
+
 /*
 ======================
 CG_PositionEntityOnTag
@@ -39,7 +129,7 @@ void CG_PositionEntityOnTag( refEntity_t *entity, const refEntity_t *parent,
 	orientation_t	lerped;
 	
 	// lerp the tag
-	trap_R_LerpTag( &lerped, parentModel, parent->oldframe, parent->frame,
+	CG_LerpTag( &lerped, parentModel, parent->oldframe, parent->frame,
 		1.0 - parent->backlerp, tagName );
 
 	// FIXME: allow origin offsets along tag?
@@ -70,7 +160,7 @@ void CG_PositionRotatedEntityOnTag( refEntity_t *entity, const refEntity_t *pare
 
 //AxisClear( entity->axis );
 	// lerp the tag
-	trap_R_LerpTag( &lerped, parentModel, parent->oldframe, parent->frame,
+	CG_LerpTag( &lerped, parentModel, parent->oldframe, parent->frame,
 		1.0 - parent->backlerp, tagName );
 
 	// FIXME: allow origin offsets along tag?
@@ -994,8 +1084,7 @@ static void CG_AddCEntity( centity_t *cent ) {
 		return;
 	}
 
-	// calculate the current origin
-	CG_CalcEntityLerpPositions( cent );
+	// the current origin was calculated by CG_AddPacketEntities
 
 	// add automatic effects
 	CG_EntityEffects( cent );
@@ -1079,15 +1168,29 @@ void CG_AddPacketEntities( void ) {
 	AnglesToAxis( cg.autoAngles, cg.autoAxis );
 	AnglesToAxis( cg.autoAnglesFast, cg.autoAxisFast );
 
-	// generate and add the entity from the playerstate
+	// generate the entity from the playerstate
 	ps = &cg.predictedPlayerState;
 	BG_PlayerStateToEntityState( ps, &cg.predictedPlayerEntity.currentState, qfalse );
-	CG_AddCEntity( &cg.predictedPlayerEntity );
+	CG_CalcEntityLerpPositions( &cg.predictedPlayerEntity );
 
 	// lerp the non-predicted value for lightning gun origins
 	CG_CalcEntityLerpPositions( &cg_entities[ cg.snap->ps.clientNum ] );
 
-	// add each entity sent over by the server
+	// lerp every entity before any is added, the positions don't depend
+	// on each other and this way entities that follow others (grapples,
+	// beams, traces against players) see where they are this frame
+	for ( num = 0 ; num < cg.snap->numEntities ; num++ ) {
+		cent = &cg_entities[ cg.snap->entities[ num ].number ];
+		if ( cent->currentState.eType < ET_EVENTS ) {
+			CG_CalcEntityLerpPositions( cent );
+		}
+	}
+
+	// the solids have new lerp origins
+	CG_InvalidateSolidGrid();
+
+	// add the predicted player and each entity sent over by the server
+	CG_AddCEntity( &cg.predictedPlayerEntity );
 	for ( num = 0 ; num < cg.snap->numEntities ; num++ ) {
 		cent = &cg_entities[ cg.snap->entities[ num ].number ];
 		CG_AddCEntity( cent );
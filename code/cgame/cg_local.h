@@ -1119,6 +1119,7 @@ extern	vmCvar_t		cg_errorDecay;
 extern	vmCvar_t		cg_nopredict;
 extern	vmCvar_t		cg_noPlayerAnims;
 extern	vmCvar_t		cg_showmiss;
+extern	vmCvar_t		cg_optimizePrediction;
 extern	vmCvar_t		cg_footsteps;
 extern	vmCvar_t		cg_addMarks;
 extern	vmCvar_t		cg_brassTime;
@@ -1243,6 +1244,9 @@ void CG_DrawString( float x, float y, const char *string,
 				   float charWidth, float charHeight, const float *modulate );
 
 
+void CG_AddTextPic( float x, float y, float w, float h, 
+				   float s1, float t1, float s2, float t2, qhandle_t hShader, const float *color );
+void CG_FlushTextPics( void );
 void CG_DrawStringExt( int x, int y, const char *string, const float *setColor, 
 		qboolean forceColor, qboolean shadow, int charWidth, int charHeight, int maxChars );
 void CG_DrawBigString( int x, int y, const char *s, float alpha );
@@ -1319,9 +1323,11 @@ sfxHandle_t	CG_CustomSound( int clientNum, const char *soundName );
 // cg_predict.c
 //
 void CG_BuildSolidList( void );
+void CG_InvalidateSolidGrid( void );
 int	CG_PointContents( const vec3_t point, int passEntityNum );
 void CG_Trace( trace_t *result, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, 
 					 int skipNumber, int mask );
+void CG_TraceBatch( trace_t *results, const cmTraceRequest_t *requests, int count, int skipNumber, int mask );
 void CG_PredictPlayerState( void );
 void CG_LoadDeferredPlayers( void );
 
@@ -1343,6 +1349,9 @@ void CG_AddPacketEntities( void );
 void CG_Beam( centity_t *cent );
 void CG_AdjustPositionForMover(const vec3_t in, int moverNum, int fromTime, int toTime, vec3_t out, vec3_t angles_in, vec3_t angles_out);
 
+void CG_ClearTagCache( void );
+qboolean CG_LerpTag( orientation_t *tag, qhandle_t model, int startFrame, int endFrame,
+					float frac, const char *tagName );
 void CG_PositionEntityOnTag( refEntity_t *entity, const refEntity_t *parent, 
 							qhandle_t parentModel, char *tagName );
 void CG_PositionRotatedEntityOnTag( refEntity_t *entity, const refEntity_t *parent, 
@@ -1379,6 +1388,9 @@ void CG_OutOfAmmoChange( void );	// should this be in pmove?
 //
 void	CG_InitMarkPolys( void );
 void	CG_AddMarks( void );
+void	CG_ClearPolyBatches( void );
+void	CG_AddBatchedPoly( qhandle_t shader, int numVerts, const polyVert_t *verts );
+void	CG_FlushPolyBatches( void );
 void	CG_ImpactMark( qhandle_t markShader, 
 				    const vec3_t origin, const vec3_t dir, 
 					float orientation, 
@@ -1492,6 +1504,7 @@ int			trap_Milliseconds( void );
 // console variable interaction
 void		trap_Cvar_Register( vmCvar_t *vmCvar, const char *varName, const char *defaultValue, int flags );
 void		trap_Cvar_Update( vmCvar_t *vmCvar );
+int			trap_Cvar_UpdateChanged( void );
 void		trap_Cvar_Set( const char *var_name, const char *value );
 void		trap_Cvar_VariableStringBuffer( const char *var_name, char *buffer, int bufsize );
 
@@ -1535,6 +1548,8 @@ int			trap_CM_TransformedPointContents( const vec3_t p, clipHandle_t model, cons
 void		trap_CM_BoxTrace( trace_t *results, const vec3_t start, const vec3_t end,
 					  const vec3_t mins, const vec3_t maxs,
 					  clipHandle_t model, int brushmask );
+void		trap_CM_BoxTraceBatch( trace_t *results, const cmTraceRequest_t *requests, int count,
+					  clipHandle_t model, int brushmask );
 void		trap_CM_CapsuleTrace( trace_t *results, const vec3_t start, const vec3_t end,
 					  const vec3_t mins, const vec3_t maxs,
 					  clipHandle_t model, int brushmask );
@@ -1598,6 +1613,7 @@ void		trap_R_RenderScene( const refdef_t *fd );
 void		trap_R_SetColor( const float *rgba );	// NULL = 1,1,1,1
 void		trap_R_DrawStretchPic( float x, float y, float w, float h, 
 			float s1, float t1, float s2, float t2, qhandle_t hShader );
+void		trap_R_DrawStretchPics( int numPics, const stretchPic_t *pics );
 void		trap_R_ModelBounds( clipHandle_t model, vec3_t mins, vec3_t maxs );
 int			trap_R_LerpTag( orientation_t *tag, clipHandle_t mod, int startFrame, int endFrame, 
 					   float frac, const char *tagName );
@@ -26,11 +26,17 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "cg_local.h"
 
-#define	MAX_LOCAL_ENTITIES	512
+#define	MAX_LOCAL_ENTITIES	2048
 localEntity_t	cg_localEntities[MAX_LOCAL_ENTITIES];
 localEntity_t	cg_activeLocalEntities;		// double linked list
 localEntity_t	*cg_freeLocalEntities;		// single linked list
 
+// the moves of all falling fragments are traced together before the
+// local entities are added, see CG_TraceFragments
+static cmTraceRequest_t	cg_fragmentRequests[MAX_LOCAL_ENTITIES];
+static trace_t			cg_fragmentTraces[MAX_LOCAL_ENTITIES];
+static int				cg_fragmentTraceNum[MAX_LOCAL_ENTITIES];	// 1 based, 0 when not traced
+
 /*
 ===================
 CG_InitLocalEntities
@@ -42,6 +48,7 @@ void	CG_InitLocalEntities( void ) {
 	int		i;
 
 	memset( cg_localEntities, 0, sizeof( cg_localEntities ) );
+	memset( cg_fragmentTraceNum, 0, sizeof( cg_fragmentTraceNum ) );
 	cg_activeLocalEntities.next = &cg_activeLocalEntities;
 	cg_activeLocalEntities.prev = &cg_activeLocalEntities;
 	cg_freeLocalEntities = cg_localEntities;
@@ -68,6 +75,8 @@ void CG_FreeLocalEntity( localEntity_t *le ) {
 	// the free list is only singly linked
 	le->next = cg_freeLocalEntities;
 	cg_freeLocalEntities = le;
+
+	cg_fragmentTraceNum[le - cg_localEntities] = 0;
 }
 
 /*
@@ -245,6 +254,7 @@ CG_AddFragment
 void CG_AddFragment( localEntity_t *le ) {
 	vec3_t	newOrigin;
 	trace_t	trace;
+	int		*traceNum;
 
 	if ( le->pos.trType == TR_STATIONARY ) {
 		// sink into the ground if near the removal time
@@ -272,8 +282,15 @@ void CG_AddFragment( localEntity_t *le ) {
 	// calculate new position
 	BG_EvaluateTrajectory( &le->pos, cg.time, newOrigin );
 
-	// trace a line from previous position to new position
-	CG_Trace( &trace, le->refEntity.origin, NULL, NULL, newOrigin, -1, CONTENTS_SOLID );
+	// trace a line from previous position to new position, unless
+	// CG_TraceFragments already did
+	traceNum = &cg_fragmentTraceNum[le - cg_localEntities];
+	if ( *traceNum ) {
+		trace = cg_fragmentTraces[*traceNum - 1];
+		*traceNum = 0;
+	} else {
+		CG_Trace( &trace, le->refEntity.origin, NULL, NULL, newOrigin, -1, CONTENTS_SOLID );
+	}
 	if ( trace.fraction == 1.0 ) {
 		// still in free fall
 		VectorCopy( newOrigin, le->refEntity.origin );
@@ -799,6 +816,40 @@ void CG_AddScorePlum( localEntity_t *le ) {
 
 //==============================================================================
 
+/*
+===================
+CG_TraceFragments
+
+Traces the moves of every falling fragment this frame with one batch,
+fragments spawned while the local entities are added trace on their own
+===================
+*/
+static void CG_TraceFragments( void ) {
+	localEntity_t		*le;
+	cmTraceRequest_t	*req;
+	int					count;
+
+	count = 0;
+	for ( le = cg_activeLocalEntities.next ; le != &cg_activeLocalEntities ; le = le->next ) {
+		if ( le->leType != LE_FRAGMENT || le->pos.trType == TR_STATIONARY || cg.time >= le->endTime ) {
+			continue;
+		}
+
+		req = &cg_fragmentRequests[count];
+		VectorCopy( le->refEntity.origin, req->start );
+		BG_EvaluateTrajectory( &le->pos, cg.time, req->end );
+		VectorClear( req->mins );
+		VectorClear( req->maxs );
+
+		count++;
+		cg_fragmentTraceNum[le - cg_localEntities] = count;
+	}
+
+	if ( count ) {
+		CG_TraceBatch( cg_fragmentTraces, cg_fragmentRequests, count, -1, CONTENTS_SOLID );
+	}
+}
+
 /*
 ===================
 CG_AddLocalEntities
@@ -808,6 +859,8 @@ CG_AddLocalEntities
 void CG_AddLocalEntities( void ) {
 	localEntity_t	*le, *next;
 
+	CG_TraceFragments();
+
 	// walk the list backwards, so any new local entities generated
 	// (trails, marks, etc) will be present this frame
 	le = cg_activeLocalEntities.prev;
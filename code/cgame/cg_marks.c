@@ -20,7 +20,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 ===========================================================================
 */
 //
-// cg_marks.c -- wall marks
+// cg_marks.c -- wall marks and batched polys
 
 #include "cg_local.h"
 
@@ -38,6 +38,31 @@ markPoly_t	*cg_freeMarkPolys;			// single linked list
 markPoly_t	cg_markPolys[MAX_MARK_POLYS];
 static		int	markTotal;
 
+/*
+Projecting a mark onto the world is the expensive part, so only a few
+are projected each frame.  The rest wait in a queue, which keeps a
+shotgun blast or a long burst from stalling a single frame.
+*/
+#define	MAX_MARK_PROJECTIONS	4		// per frame
+#define	MAX_PENDING_MARKS		64
+
+typedef struct {
+	qhandle_t	markShader;
+	vec3_t		origin;
+	vec3_t		dir;
+	float		orientation;
+	float		color[4];
+	qboolean	alphaFade;
+	float		radius;
+	int			time;
+} pendingMark_t;
+
+static pendingMark_t	pendingMarks[MAX_PENDING_MARKS];
+static int				firstPendingMark;
+static int				numPendingMarks;
+static int				markProjectionFrame;
+static int				markProjections;
+
 /*
 ===================
 CG_InitMarkPolys
@@ -56,6 +81,9 @@ void	CG_InitMarkPolys( void ) {
 	for ( i = 0 ; i < MAX_MARK_POLYS - 1 ; i++ ) {
 		cg_markPolys[i].nextMark = &cg_markPolys[i+1];
 	}
+
+	firstPendingMark = 0;
+	numPendingMarks = 0;
 }
 
 
@@ -115,21 +143,18 @@ markPoly_t	*CG_AllocMark( void ) {
 
 /*
 =================
-CG_ImpactMark
+CG_ProjectMark
 
-origin should be a point within a unit of the plane
-dir should be the plane normal
-
-temporary marks will not be stored or randomly oriented, but immediately
-passed to the renderer.
+Clips the mark against the world and stores the fragments, or passes
+them straight to the renderer if it is temporary
 =================
 */
 #define	MAX_MARK_FRAGMENTS	128
 #define	MAX_MARK_POINTS		384
 
-void CG_ImpactMark( qhandle_t markShader, const vec3_t origin, const vec3_t dir, 
+static void CG_ProjectMark( qhandle_t markShader, const vec3_t origin, const vec3_t dir, 
 				   float orientation, float red, float green, float blue, float alpha,
-				   qboolean alphaFade, float radius, qboolean temporary ) {
+				   qboolean alphaFade, float radius, qboolean temporary, int time ) {
 	vec3_t			axis[3];
 	float			texCoordScale;
 	vec3_t			originalPoints[4];
@@ -140,18 +165,6 @@ void CG_ImpactMark( qhandle_t markShader, const vec3_t origin, const vec3_t dir,
 	vec3_t			markPoints[MAX_MARK_POINTS];
 	vec3_t			projection;
 
-	if ( !cg_addMarks.integer ) {
-		return;
-	}
-
-	if ( radius <= 0 ) {
-		CG_Error( "CG_ImpactMark called with <= 0 radius" );
-	}
-
-	//if ( markTotal >= MAX_MARK_POLYS ) {
-	//	return;
-	//}
-
 	// create the texture axis
 	VectorNormalize2( dir, axis[0] );
 	PerpendicularVector( axis[1], axis[0] );
@@ -202,13 +215,13 @@ void CG_ImpactMark( qhandle_t markShader, const vec3_t origin, const vec3_t dir,
 
 		// if it is a temporary (shadow) mark, add it immediately and forget about it
 		if ( temporary ) {
-			trap_R_AddPolyToScene( markShader, mf->numPoints, verts );
+			CG_AddBatchedPoly( markShader, mf->numPoints, verts );
 			continue;
 		}
 
 		// otherwise save it persistantly
 		mark = CG_AllocMark();
-		mark->time = cg.time;
+		mark->time = time;
 		mark->alphaFade = alphaFade;
 		mark->markShader = markShader;
 		mark->poly.numVerts = mf->numPoints;
@@ -221,6 +234,107 @@ void CG_ImpactMark( qhandle_t markShader, const vec3_t origin, const vec3_t dir,
 	}
 }
 
+/*
+=================
+CG_ProjectFirstPendingMark
+=================
+*/
+static void CG_ProjectFirstPendingMark( void ) {
+	pendingMark_t	*pm;
+
+	pm = &pendingMarks[firstPendingMark];
+	firstPendingMark = ( firstPendingMark + 1 ) % MAX_PENDING_MARKS;
+	numPendingMarks--;
+	markProjections++;
+
+	CG_ProjectMark( pm->markShader, pm->origin, pm->dir, pm->orientation,
+		pm->color[0], pm->color[1], pm->color[2], pm->color[3],
+		pm->alphaFade, pm->radius, qfalse, pm->time );
+}
+
+/*
+=================
+CG_ProjectPendingMarks
+
+Projects queued marks until this frame's budget is spent
+=================
+*/
+static void CG_ProjectPendingMarks( void ) {
+	if ( markProjectionFrame != cg.clientFrame ) {
+		markProjectionFrame = cg.clientFrame;
+		markProjections = 0;
+	}
+
+	while ( numPendingMarks && markProjections < MAX_MARK_PROJECTIONS ) {
+		CG_ProjectFirstPendingMark();
+	}
+}
+
+/*
+=================
+CG_ImpactMark
+
+origin should be a point within a unit of the plane
+dir should be the plane normal
+
+temporary marks will not be stored or randomly oriented, but immediately
+passed to the renderer.  Others may be queued for a later frame if too
+many have been projected in this one.
+=================
+*/
+void CG_ImpactMark( qhandle_t markShader, const vec3_t origin, const vec3_t dir, 
+				   float orientation, float red, float green, float blue, float alpha,
+				   qboolean alphaFade, float radius, qboolean temporary ) {
+	pendingMark_t	*pm;
+
+	if ( !cg_addMarks.integer ) {
+		return;
+	}
+
+	if ( radius <= 0 ) {
+		CG_Error( "CG_ImpactMark called with <= 0 radius" );
+	}
+
+	//if ( markTotal >= MAX_MARK_POLYS ) {
+	//	return;
+	//}
+
+	if ( temporary ) {
+		CG_ProjectMark( markShader, origin, dir, orientation, red, green, blue, alpha,
+			alphaFade, radius, qtrue, cg.time );
+		return;
+	}
+
+	CG_ProjectPendingMarks();
+
+	if ( !numPendingMarks && markProjections < MAX_MARK_PROJECTIONS ) {
+		markProjections++;
+		CG_ProjectMark( markShader, origin, dir, orientation, red, green, blue, alpha,
+			alphaFade, radius, qfalse, cg.time );
+		return;
+	}
+
+	// make room by projecting the oldest one now
+	if ( numPendingMarks == MAX_PENDING_MARKS ) {
+		CG_ProjectFirstPendingMark();
+	}
+
+	pm = &pendingMarks[( firstPendingMark + numPendingMarks ) % MAX_PENDING_MARKS];
+	numPendingMarks++;
+
+	pm->markShader = markShader;
+	VectorCopy( origin, pm->origin );
+	VectorCopy( dir, pm->dir );
+	pm->orientation = orientation;
+	pm->color[0] = red;
+	pm->color[1] = green;
+	pm->color[2] = blue;
+	pm->color[3] = alpha;
+	pm->alphaFade = alphaFade;
+	pm->radius = radius;
+	pm->time = cg.time;
+}
+
 
 /*
 ===============
@@ -240,6 +354,8 @@ void CG_AddMarks( void ) {
 		return;
 	}
 
+	CG_ProjectPendingMarks();
+
 	mp = cg_activeMarkPolys.nextMark;
 	for ( ; mp != &cg_activeMarkPolys ; mp = next ) {
 		// grab next now, so if the local entity is freed we
@@ -288,6 +404,118 @@ void CG_AddMarks( void ) {
 		}
 
 
-		trap_R_AddPolyToScene( mp->markShader, mp->poly.numVerts, mp->verts );
+		CG_AddBatchedPoly( mp->markShader, mp->poly.numVerts, mp->verts );
+	}
+}
+
+
+/*
+===================================================================
+
+POLY BATCHES
+
+Marks, particles, tracers and wakes add lots of small polys every
+frame.  Rather than one trap call each, they are gathered by shader
+and vertex count and handed to the renderer in bulk just before the
+scene is rendered.
+
+===================================================================
+*/
+
+#define	MAX_POLY_BATCHES		32
+#define	MAX_POLY_BATCH_VERTS	512
+
+typedef struct {
+	qhandle_t	shader;
+	int			numVertsPerPoly;
+	int			numPolys;
+	polyVert_t	verts[MAX_POLY_BATCH_VERTS];
+} polyBatch_t;
+
+static polyBatch_t	cg_polyBatches[MAX_POLY_BATCHES];
+static int			cg_numPolyBatches;
+static int			cg_lastPolyBatch;
+
+/*
+===============
+CG_ClearPolyBatches
+
+Drops anything left over from a frame that was never rendered
+===============
+*/
+void CG_ClearPolyBatches( void ) {
+	cg_numPolyBatches = 0;
+	cg_lastPolyBatch = 0;
+}
+
+/*
+===============
+CG_FlushPolyBatch
+===============
+*/
+static void CG_FlushPolyBatch( polyBatch_t *batch ) {
+	if ( !batch->numPolys ) {
+		return;
+	}
+	trap_R_AddPolysToScene( batch->shader, batch->numVertsPerPoly, batch->verts, batch->numPolys );
+	batch->numPolys = 0;
+}
+
+/*
+===============
+CG_AddBatchedPoly
+===============
+*/
+void CG_AddBatchedPoly( qhandle_t shader, int numVerts, const polyVert_t *verts ) {
+	polyBatch_t	*batch;
+	int			i;
+
+	if ( numVerts <= 0 || numVerts > MAX_POLY_BATCH_VERTS ) {
+		trap_R_AddPolyToScene( shader, numVerts, verts );
+		return;
+	}
+
+	// consecutive polys usually share a batch
+	batch = &cg_polyBatches[cg_lastPolyBatch];
+	if ( cg_lastPolyBatch >= cg_numPolyBatches || batch->shader != shader || batch->numVertsPerPoly != numVerts ) {
+		for ( i = 0, batch = cg_polyBatches ; i < cg_numPolyBatches ; i++, batch++ ) {
+			if ( batch->shader == shader && batch->numVertsPerPoly == numVerts ) {
+				break;
+			}
+		}
+		if ( i == cg_numPolyBatches ) {
+			if ( cg_numPolyBatches == MAX_POLY_BATCHES ) {
+				trap_R_AddPolyToScene( shader, numVerts, verts );
+				return;
+			}
+			cg_numPolyBatches++;
+			batch->shader = shader;
+			batch->numVertsPerPoly = numVerts;
+			batch->numPolys = 0;
+		}
+		cg_lastPolyBatch = i;
+	}
+
+	if ( ( batch->numPolys + 1 ) * numVerts > MAX_POLY_BATCH_VERTS ) {
+		CG_FlushPolyBatch( batch );
+	}
+
+	memcpy( &batch->verts[batch->numPolys * numVerts], verts, numVerts * sizeof( *verts ) );
+	batch->numPolys++;
+}
+
+/*
+===============
+CG_FlushPolyBatches
+
+Submits every batched poly to the scene
+===============
+*/
+void CG_FlushPolyBatches( void ) {
+	int		i;
+
+	for ( i = 0 ; i < cg_numPolyBatches ; i++ ) {
+		CG_FlushPolyBatch( &cg_polyBatches[i] );
 	}
+	CG_ClearPolyBatches();
 }
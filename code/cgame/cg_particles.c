@@ -138,11 +138,7 @@ static float	shaderAnimSTRatio[MAX_SHADER_ANIMS] = {
 
 #define		PARTICLE_GRAVITY	40
 
-#ifdef WOLF_PARTICLES
 #define		MAX_PARTICLES	1024 * 8
-#else
-#define		MAX_PARTICLES 1024
-#endif
 
 cparticle_t	*active_particles, *free_particles;
 cparticle_t	particles[MAX_PARTICLES];
@@ -151,6 +147,7 @@ int		cl_numparticles = MAX_PARTICLES;
 qboolean		initparticles = qfalse;
 vec3_t			vforward, vright, vup;
 vec3_t			rforward, rright, rup;
+vec3_t			baseright, baseup;		// view right and up without any roll
 
 float			oldtime;
 
@@ -192,6 +189,28 @@ void CG_ClearParticles (void)
 }
 
 
+/*
+=====================
+CG_RollParticleAxis
+
+Same as AngleVectors of the view angles with roll added, without
+going through the angles for every particle
+=====================
+*/
+static void CG_RollParticleAxis( float roll, vec3_t right, vec3_t up )
+{
+	float	angle, sr, cr;
+
+	angle = DEG2RAD( roll );
+	sr = sin( angle );
+	cr = cos( angle );
+
+	VectorScale( baseright, cr, right );
+	VectorMA( right, -sr, baseup, right );
+	VectorScale( baseup, cr, up );
+	VectorMA( up, sr, baseright, up );
+}
+
 /*
 =====================
 CG_AddParticleToScene
@@ -350,7 +369,6 @@ void CG_AddParticleToScene (cparticle_t *p, vec3_t org, float alpha)
 	else if (p->type == P_SPRITE)
 	{
 		vec3_t	rr, ru;
-		vec3_t	rotate_ang;
 
 #ifdef WOLF_PARTICLES
 		VectorSet (color, 1.0, 1.0, 1.0);
@@ -365,9 +383,7 @@ void CG_AddParticleToScene (cparticle_t *p, vec3_t org, float alpha)
 		height = p->height + ( ratio * ( p->endheight - p->height) );
 
 		if (p->roll) {
-			vectoangles( cg.refdef.viewaxis[0], rotate_ang );
-			rotate_ang[ROLL] += p->roll;
-			AngleVectors ( rotate_ang, NULL, rr, ru);
+			CG_RollParticleAxis( p->roll, rr, ru );
 		}
 
 		if (p->roll) {
@@ -484,12 +500,8 @@ void CG_AddParticleToScene (cparticle_t *p, vec3_t org, float alpha)
 
 		if (p->type != P_SMOKE_IMPACT)
 		{
-			vec3_t temp;
-
-			vectoangles (rforward, temp);
 			p->accumroll += p->roll;
-			temp[ROLL] += p->accumroll * 0.1;
-			AngleVectors ( temp, NULL, rright2, rup2);
+			CG_RollParticleAxis( p->accumroll * 0.1, rright2, rup2 );
 		}
 		else
 		{
@@ -573,7 +585,6 @@ void CG_AddParticleToScene (cparticle_t *p, vec3_t org, float alpha)
 	else if (p->type == P_BLEED)
 	{
 		vec3_t	rr, ru;
-		vec3_t	rotate_ang;
 		float	pAlpha;
 
 		pAlpha = p->alpha;
@@ -583,9 +594,7 @@ void CG_AddParticleToScene (cparticle_t *p, vec3_t org, float alpha)
 
 		if (p->roll) 
 		{
-			vectoangles( cg.refdef.viewaxis[0], rotate_ang );
-			rotate_ang[ROLL] += p->roll;
-			AngleVectors ( rotate_ang, NULL, rr, ru);
+			CG_RollParticleAxis( p->roll, rr, ru );
 		}
 		else
 		{
@@ -746,7 +755,6 @@ void CG_AddParticleToScene (cparticle_t *p, vec3_t org, float alpha)
 	// Ridah
 	else if (p->type == P_ANIM) {
 		vec3_t	rr, ru;
-		vec3_t	rotate_ang;
 		int i, j;
 
 		time = cg.time - p->time;
@@ -769,9 +777,7 @@ void CG_AddParticleToScene (cparticle_t *p, vec3_t org, float alpha)
 		p->pshader = shaderAnims[i][j];
 
 		if (p->roll) {
-			vectoangles( cg.refdef.viewaxis[0], rotate_ang );
-			rotate_ang[ROLL] += p->roll;
-			AngleVectors ( rotate_ang, NULL, rr, ru);
+			CG_RollParticleAxis( p->roll, rr, ru );
 		}
 
 		if (p->roll) {
@@ -837,9 +843,9 @@ void CG_AddParticleToScene (cparticle_t *p, vec3_t org, float alpha)
 	}
 
 	if (p->type == P_WEATHER || p->type == P_WEATHER_TURBULENT || p->type == P_WEATHER_FLURRY)
-		trap_R_AddPolyToScene( p->pshader, 3, TRIverts );
+		CG_AddBatchedPoly( p->pshader, 3, TRIverts );
 	else
-		trap_R_AddPolyToScene( p->pshader, 4, verts );
+		CG_AddBatchedPoly( p->pshader, 4, verts );
 
 }
 
@@ -856,7 +862,8 @@ void CG_AddParticles (void)
 	cparticle_t		*p, *next;
 	float			alpha;
 	float			time, time2;
-	vec3_t			org;
+	vec3_t			org, delta;
+	float			radius;
 	cparticle_t		*active, *tail;
 	vec3_t			rotate_ang;
 
@@ -868,6 +875,7 @@ void CG_AddParticles (void)
 	VectorCopy( cg.refdef.viewaxis[2], vup );
 
 	vectoangles( cg.refdef.viewaxis[0], rotate_ang );
+	AngleVectors ( rotate_ang, NULL, baseright, baseup);
 	roll += ((cg.time - oldtime) * 0.1) ;
 	rotate_ang[ROLL] += (roll*0.9);
 	AngleVectors ( rotate_ang, rforward, rright, rup);
@@ -968,6 +976,18 @@ void CG_AddParticles (void)
 		org[1] = p->org[1] + p->vel[1]*time + p->accel[1]*time2;
 		org[2] = p->org[2] + p->vel[2]*time + p->accel[2]*time2;
 
+		// don't bother building quads behind the view
+		VectorSubtract (org, cg.refdef.vieworg, delta);
+		radius = p->width;
+		if (p->height > radius)
+			radius = p->height;
+		if (p->endwidth > radius)
+			radius = p->endwidth;
+		if (p->endheight > radius)
+			radius = p->endheight;
+		if (DotProduct (delta, vforward) < -2 * radius)
+			continue;
+
 		CG_AddParticleToScene (p, org, alpha);
 	}
 
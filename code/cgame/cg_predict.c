@@ -29,11 +29,144 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 static	pmove_t		cg_pmove;
 
-static	int			cg_numSolidEntities;
-static	centity_t	*cg_solidEntities[MAX_ENTITIES_IN_SNAPSHOT];
+static	int			cg_numSolidBModels;
+static	centity_t	*cg_solidBModels[MAX_ENTITIES_IN_SNAPSHOT];
+static	int			cg_numSolidBoxes;
+static	centity_t	*cg_solidBoxes[MAX_ENTITIES_IN_SNAPSHOT];
 static	int			cg_numTriggerEntities;
 static	centity_t	*cg_triggerEntities[MAX_ENTITIES_IN_SNAPSHOT];
 
+/*
+====================
+SOLID GRID
+
+The bounding box solids (players, corpses, missiles with a size) are
+bucketed into a hash grid of cells over the x/y plane, so a trace only
+clips against the boxes in the cells it overlaps.  Their positions are
+the lerped ones, so the grid is rebuilt lazily whenever the frame time
+changes or the entities have been lerped again.
+
+Brush models are few and can be huge or rotate, so they are always
+tested.
+====================
+*/
+
+#define	SOLID_GRID_SHIFT		8						// 256 unit cells
+#define	SOLID_GRID_SIZE			32						// cells per side, power of two
+#define	SOLID_GRID_OFFSET		( 128 * 1024 )			// keeps cell coordinates positive
+#define	MAX_SOLID_GRID_LINKS	( MAX_ENTITIES_IN_SNAPSHOT * 4 )
+
+typedef struct {
+	qboolean	valid;
+	int			time;
+
+	int			cellHeads[SOLID_GRID_SIZE * SOLID_GRID_SIZE];
+	int			linkNext[MAX_SOLID_GRID_LINKS];
+	int			linkBox[MAX_SOLID_GRID_LINKS];
+	int			numLinks;
+
+	int			numOversized;							// boxes too big to bucket
+	int			oversized[MAX_ENTITIES_IN_SNAPSHOT];
+
+	int			checkCount;
+	int			checked[MAX_ENTITIES_IN_SNAPSHOT];
+} solidGrid_t;
+
+static	solidGrid_t	cg_solidGrid;
+
+/*
+====================
+CG_InvalidateSolidGrid
+
+Called when the solid list is rebuilt or the entities have been lerped
+====================
+*/
+void CG_InvalidateSolidGrid( void ) {
+	cg_solidGrid.valid = qfalse;
+}
+
+/*
+====================
+CG_SolidGridCell
+====================
+*/
+static int CG_SolidGridCell( float v ) {
+	if ( v < -SOLID_GRID_OFFSET ) {
+		v = -SOLID_GRID_OFFSET;
+	} else if ( v > SOLID_GRID_OFFSET ) {
+		v = SOLID_GRID_OFFSET;
+	}
+	return (int)( v + SOLID_GRID_OFFSET ) >> SOLID_GRID_SHIFT;
+}
+
+/*
+====================
+CG_SolidBoxBounds
+====================
+*/
+static void CG_SolidBoxBounds( const centity_t *cent, vec3_t bmins, vec3_t bmaxs ) {
+	int		x, zd, zu;
+
+	// encoded bbox
+	x = (cent->currentState.solid & 255);
+	zd = ((cent->currentState.solid>>8) & 255);
+	zu = ((cent->currentState.solid>>16) & 255) - 32;
+
+	bmins[0] = bmins[1] = -x;
+	bmaxs[0] = bmaxs[1] = x;
+	bmins[2] = -zd;
+	bmaxs[2] = zu;
+}
+
+/*
+====================
+CG_BuildSolidGrid
+====================
+*/
+static void CG_BuildSolidGrid( void ) {
+	int			i, x, y;
+	int			cx0, cy0, cx1, cy1;
+	int			cell;
+	vec3_t		bmins, bmaxs;
+	centity_t	*cent;
+	solidGrid_t	*grid;
+
+	grid = &cg_solidGrid;
+	grid->valid = qtrue;
+	grid->time = cg.time;
+	grid->numLinks = 0;
+	grid->numOversized = 0;
+	for ( i = 0 ; i < SOLID_GRID_SIZE * SOLID_GRID_SIZE ; i++ ) {
+		grid->cellHeads[i] = -1;
+	}
+
+	for ( i = 0 ; i < cg_numSolidBoxes ; i++ ) {
+		cent = cg_solidBoxes[i];
+		CG_SolidBoxBounds( cent, bmins, bmaxs );
+
+		cx0 = CG_SolidGridCell( cent->lerpOrigin[0] + bmins[0] - 1 );
+		cy0 = CG_SolidGridCell( cent->lerpOrigin[1] + bmins[1] - 1 );
+		cx1 = CG_SolidGridCell( cent->lerpOrigin[0] + bmaxs[0] + 1 );
+		cy1 = CG_SolidGridCell( cent->lerpOrigin[1] + bmaxs[1] + 1 );
+
+		if ( cx1 - cx0 >= SOLID_GRID_SIZE || cy1 - cy0 >= SOLID_GRID_SIZE
+			|| grid->numLinks + ( cx1 - cx0 + 1 ) * ( cy1 - cy0 + 1 ) > MAX_SOLID_GRID_LINKS ) {
+			grid->oversized[grid->numOversized++] = i;
+			continue;
+		}
+
+		for ( y = cy0 ; y <= cy1 ; y++ ) {
+			for ( x = cx0 ; x <= cx1 ; x++ ) {
+				cell = ( y & ( SOLID_GRID_SIZE - 1 ) ) * SOLID_GRID_SIZE + ( x & ( SOLID_GRID_SIZE - 1 ) );
+				grid->linkBox[grid->numLinks] = i;
+				grid->linkNext[grid->numLinks] = grid->cellHeads[cell];
+				grid->cellHeads[cell] = grid->numLinks;
+				grid->numLinks++;
+			}
+		}
+	}
+}
+
 /*
 ====================
 CG_BuildSolidList
@@ -49,8 +182,10 @@ void CG_BuildSolidList( void ) {
 	snapshot_t	*snap;
 	entityState_t	*ent;
 
-	cg_numSolidEntities = 0;
+	cg_numSolidBModels = 0;
+	cg_numSolidBoxes = 0;
 	cg_numTriggerEntities = 0;
+	CG_InvalidateSolidGrid();
 
 	if ( cg.nextSnap && !cg.nextFrameTeleport && !cg.thisFrameTeleport ) {
 		snap = cg.nextSnap;
@@ -69,8 +204,13 @@ void CG_BuildSolidList( void ) {
 		}
 
 		if ( cent->nextState.solid ) {
-			cg_solidEntities[cg_numSolidEntities] = cent;
-			cg_numSolidEntities++;
+			if ( cent->nextState.solid == SOLID_BMODEL ) {
+				cg_solidBModels[cg_numSolidBModels] = cent;
+				cg_numSolidBModels++;
+			} else {
+				cg_solidBoxes[cg_numSolidBoxes] = cent;
+				cg_numSolidBoxes++;
+			}
 			continue;
 		}
 	}
@@ -78,63 +218,116 @@ void CG_BuildSolidList( void ) {
 
 /*
 ====================
-CG_ClipMoveToEntities
+CG_ClipMoveToEntity
 
+Returns qtrue once the trace is allsolid and no further clipping matters
 ====================
 */
-static void CG_ClipMoveToEntities ( const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end,
+static qboolean CG_ClipMoveToEntity( centity_t *cent, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end,
 							int skipNumber, int mask, trace_t *tr ) {
-	int			i, x, zd, zu;
 	trace_t		trace;
 	entityState_t	*ent;
 	clipHandle_t 	cmodel;
 	vec3_t		bmins, bmaxs;
 	vec3_t		origin, angles;
-	centity_t	*cent;
 
-	for ( i = 0 ; i < cg_numSolidEntities ; i++ ) {
-		cent = cg_solidEntities[ i ];
-		ent = &cent->currentState;
+	ent = &cent->currentState;
 
-		if ( ent->number == skipNumber ) {
-			continue;
-		}
+	if ( ent->number == skipNumber ) {
+		return qfalse;
+	}
+
+	if ( ent->solid == SOLID_BMODEL ) {
+		// special value for bmodel
+		cmodel = trap_CM_InlineModel( ent->modelindex );
+		VectorCopy( cent->lerpAngles, angles );
+		BG_EvaluateTrajectory( &cent->currentState.pos, cg.physicsTime, origin );
+	} else {
+		CG_SolidBoxBounds( cent, bmins, bmaxs );
+
+		cmodel = trap_CM_TempBoxModel( bmins, bmaxs );
+		VectorCopy( vec3_origin, angles );
+		VectorCopy( cent->lerpOrigin, origin );
+	}
+
+
+	trap_CM_TransformedBoxTrace ( &trace, start, end,
+		mins, maxs, cmodel,  mask, origin, angles);
+
+	if (trace.allsolid || trace.fraction < tr->fraction) {
+		trace.entityNum = ent->number;
+		*tr = trace;
+	} else if (trace.startsolid) {
+		tr->startsolid = qtrue;
+	}
+	return tr->allsolid;
+}
+
+/*
+====================
+CG_ClipMoveToEntities
+
+====================
+*/
+static void CG_ClipMoveToEntities ( const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end,
+							int skipNumber, int mask, trace_t *tr ) {
+	int			i, x, y, link;
+	int			cx0, cy0, cx1, cy1;
+	solidGrid_t	*grid;
 
-		if ( ent->solid == SOLID_BMODEL ) {
-			// special value for bmodel
-			cmodel = trap_CM_InlineModel( ent->modelindex );
-			VectorCopy( cent->lerpAngles, angles );
-			BG_EvaluateTrajectory( &cent->currentState.pos, cg.physicsTime, origin );
-		} else {
-			// encoded bbox
-			x = (ent->solid & 255);
-			zd = ((ent->solid>>8) & 255);
-			zu = ((ent->solid>>16) & 255) - 32;
-
-			bmins[0] = bmins[1] = -x;
-			bmaxs[0] = bmaxs[1] = x;
-			bmins[2] = -zd;
-			bmaxs[2] = zu;
-
-			cmodel = trap_CM_TempBoxModel( bmins, bmaxs );
-			VectorCopy( vec3_origin, angles );
-			VectorCopy( cent->lerpOrigin, origin );
+	for ( i = 0 ; i < cg_numSolidBModels ; i++ ) {
+		if ( CG_ClipMoveToEntity( cg_solidBModels[i], start, mins, maxs, end, skipNumber, mask, tr ) ) {
+			return;
 		}
+	}
+
+	if ( !cg_numSolidBoxes ) {
+		return;
+	}
 
+	grid = &cg_solidGrid;
+	if ( !grid->valid || grid->time != cg.time ) {
+		CG_BuildSolidGrid();
+	}
 
-		trap_CM_TransformedBoxTrace ( &trace, start, end,
-			mins, maxs, cmodel,  mask, origin, angles);
+	cx0 = CG_SolidGridCell( ( start[0] < end[0] ? start[0] : end[0] ) + mins[0] - 1 );
+	cy0 = CG_SolidGridCell( ( start[1] < end[1] ? start[1] : end[1] ) + mins[1] - 1 );
+	cx1 = CG_SolidGridCell( ( start[0] > end[0] ? start[0] : end[0] ) + maxs[0] + 1 );
+	cy1 = CG_SolidGridCell( ( start[1] > end[1] ? start[1] : end[1] ) + maxs[1] + 1 );
 
-		if (trace.allsolid || trace.fraction < tr->fraction) {
-			trace.entityNum = ent->number;
-			*tr = trace;
-		} else if (trace.startsolid) {
-			tr->startsolid = qtrue;
+	// a long trace covers the whole grid anyway
+	if ( cx1 - cx0 >= SOLID_GRID_SIZE || cy1 - cy0 >= SOLID_GRID_SIZE ) {
+		for ( i = 0 ; i < cg_numSolidBoxes ; i++ ) {
+			if ( CG_ClipMoveToEntity( cg_solidBoxes[i], start, mins, maxs, end, skipNumber, mask, tr ) ) {
+				return;
+			}
 		}
-		if ( tr->allsolid ) {
+		return;
+	}
+
+	for ( i = 0 ; i < grid->numOversized ; i++ ) {
+		if ( CG_ClipMoveToEntity( cg_solidBoxes[grid->oversized[i]], start, mins, maxs, end, skipNumber, mask, tr ) ) {
 			return;
 		}
 	}
+
+	grid->checkCount++;
+	for ( y = cy0 ; y <= cy1 ; y++ ) {
+		for ( x = cx0 ; x <= cx1 ; x++ ) {
+			link = grid->cellHeads[( y & ( SOLID_GRID_SIZE - 1 ) ) * SOLID_GRID_SIZE + ( x & ( SOLID_GRID_SIZE - 1 ) )];
+			for ( ; link != -1 ; link = grid->linkNext[link] ) {
+				i = grid->linkBox[link];
+				if ( grid->checked[i] == grid->checkCount ) {
+					continue;
+				}
+				grid->checked[i] = grid->checkCount;
+
+				if ( CG_ClipMoveToEntity( cg_solidBoxes[i], start, mins, maxs, end, skipNumber, mask, tr ) ) {
+					return;
+				}
+			}
+		}
+	}
 }
 
 /*
@@ -154,6 +347,26 @@ void	CG_Trace( trace_t *result, const vec3_t start, const vec3_t mins, const vec
 	*result = t;
 }
 
+/*
+================
+CG_TraceBatch
+
+Same as calling CG_Trace for each request, with the world traces
+made in a single trap
+================
+*/
+void CG_TraceBatch( trace_t *results, const cmTraceRequest_t *requests, int count, int skipNumber, int mask ) {
+	int		i;
+
+	trap_CM_BoxTraceBatch( results, requests, count, 0, mask );
+	for ( i = 0 ; i < count ; i++ ) {
+		results[i].entityNum = results[i].fraction != 1.0 ? ENTITYNUM_WORLD : ENTITYNUM_NONE;
+		// check all other solid models
+		CG_ClipMoveToEntities( requests[i].start, requests[i].mins, requests[i].maxs, requests[i].end,
+			skipNumber, mask, &results[i] );
+	}
+}
+
 /*
 ================
 CG_PointContents
@@ -168,8 +381,9 @@ int		CG_PointContents( const vec3_t point, int passEntityNum ) {
 
 	contents = trap_CM_PointContents (point, 0);
 
-	for ( i = 0 ; i < cg_numSolidEntities ; i++ ) {
-		cent = cg_solidEntities[ i ];
+	// only brush models have contents other than solid
+	for ( i = 0 ; i < cg_numSolidBModels ; i++ ) {
+		cent = cg_solidBModels[ i ];
 
 		ent = &cent->currentState;
 
@@ -383,6 +597,133 @@ static void CG_TouchTriggerPrediction( void ) {
 
 
 
+/*
+=================
+PREDICTION CACHE
+
+The predicted playerState_t after each command, for the commands
+predicted on top of the snapshot taken at cg_predictedBaseTime.
+=================
+*/
+
+typedef struct {
+	qboolean		hyperspace;
+	playerState_t	ps;
+} predictedCmd_t;
+
+static predictedCmd_t	cg_predictedCmds[CMD_BACKUP];	// indexed by command number
+static int				cg_predictedFirstCmd;
+static int				cg_predictedLastCmd;		// 0 when nothing is saved
+static int				cg_predictedBaseTime;
+static int				cg_predictedPmoveFixed;
+static int				cg_predictedPmoveMsec;
+
+/*
+=================
+CG_SavePredictedCmd
+=================
+*/
+static void CG_SavePredictedCmd( int cmdNum ) {
+	predictedCmd_t	*saved;
+
+	if ( !cg_predictedLastCmd ) {
+		cg_predictedFirstCmd = cmdNum;
+		cg_predictedBaseTime = cg.physicsTime;
+		cg_predictedPmoveFixed = cg_pmove.pmove_fixed;
+		cg_predictedPmoveMsec = cg_pmove.pmove_msec;
+	}
+	cg_predictedLastCmd = cmdNum;
+
+	saved = &cg_predictedCmds[cmdNum & ( CMD_BACKUP - 1 )];
+	saved->hyperspace = cg.hyperspace;
+	saved->ps = cg.predictedPlayerState;
+}
+
+/*
+=================
+CG_PredictionMatches
+
+Returns qtrue if a snapshot playerState_t is bitwise the same as the one
+predicted for its command, ignoring the fields prediction doesn't produce
+=================
+*/
+static qboolean CG_PredictionMatches( const playerState_t *predicted, const playerState_t *snap ) {
+	playerState_t	ps;
+	const int		*a, *b;
+	int				i;
+
+	ps = *snap;
+	ps.pmove_framecount = predicted->pmove_framecount;
+	ps.jumppad_frame = predicted->jumppad_frame;
+	ps.entityEventSequence = predicted->entityEventSequence;
+	ps.externalEvent = predicted->externalEvent;
+	ps.externalEventParm = predicted->externalEventParm;
+	ps.externalEventTime = predicted->externalEventTime;
+	ps.ping = predicted->ping;
+	for ( i = 0 ; i < MAX_PERSISTANT ; i++ ) {
+		ps.persistant[i] = predicted->persistant[i];
+	}
+
+	a = (const int *)&ps;
+	b = (const int *)predicted;
+	for ( i = 0 ; i < (int)( sizeof( ps ) / sizeof( int ) ) ; i++ ) {
+		if ( a[i] != b[i] ) {
+			return qfalse;
+		}
+	}
+	return qtrue;
+}
+
+/*
+=================
+CG_ResumePrediction
+
+Continues from the saved prediction if it is still valid for the snapshot
+in cg.predictedPlayerState, returning the first command that still has to
+be simulated, or 0 if everything must be predicted again
+=================
+*/
+static int CG_ResumePrediction( int current ) {
+	predictedCmd_t	*saved;
+	int				cmdNum;
+
+	if ( !cg_optimizePrediction.integer || !cg_predictedLastCmd ) {
+		return 0;
+	}
+	if ( cg.thisFrameTeleport || cg_predictedLastCmd > current
+		|| cg_predictedFirstCmd <= current - CMD_BACKUP ) {
+		return 0;
+	}
+	if ( cg_pmove.pmove_fixed != cg_predictedPmoveFixed || cg_pmove.pmove_msec != cg_predictedPmoveMsec ) {
+		return 0;
+	}
+
+	if ( cg.physicsTime != cg_predictedBaseTime ) {
+		// a new snapshot, find the command it was made after
+		for ( cmdNum = cg_predictedFirstCmd ; cmdNum <= cg_predictedLastCmd ; cmdNum++ ) {
+			saved = &cg_predictedCmds[cmdNum & ( CMD_BACKUP - 1 )];
+			if ( saved->ps.commandTime == cg.predictedPlayerState.commandTime ) {
+				break;
+			}
+		}
+		if ( cmdNum > cg_predictedLastCmd || !CG_PredictionMatches( &saved->ps, &cg.predictedPlayerState ) ) {
+			if ( cg_showmiss.integer ) {
+				CG_Printf( "prediction not resumed\n" );
+			}
+			return 0;
+		}
+
+		cg_predictedFirstCmd = cmdNum;
+		cg_predictedBaseTime = cg.physicsTime;
+	}
+
+	saved = &cg_predictedCmds[cg_predictedLastCmd & ( CMD_BACKUP - 1 )];
+	cg.predictedPlayerState = saved->ps;
+	cg.hyperspace = saved->hyperspace;
+
+	return cg_predictedLastCmd + 1;
+}
+
 /*
 =================
 CG_PredictPlayerState
@@ -401,16 +742,17 @@ but we simulate all unacknowledged commands each time, not just the new ones.
 This means that on an internet connection, quite a few pmoves may be issued
 each frame.
 
-OPTIMIZE: don't re-simulate unless the newly arrived snapshot playerState_t
-differs from the predicted one.  Would require saving all intermediate
-playerState_t during prediction.
+With cg_optimizePrediction the playerState_t after every predicted command
+is saved.  As long as the snapshot hasn't changed, or the newly arrived
+snapshot playerState_t matches what was predicted for its command, only the
+commands after the last saved one are simulated.
 
 We detect prediction errors and allow them to be decayed off over several frames
 to ease the jerk.
 =================
 */
 void CG_PredictPlayerState( void ) {
-	int			cmdNum, current;
+	int			cmdNum, current, firstCmd;
 	playerState_t	oldPlayerState;
 	qboolean	moved;
 	usercmd_t	oldestCmd;
@@ -429,12 +771,14 @@ void CG_PredictPlayerState( void ) {
 
 	// demo playback just copies the moves
 	if ( cg.demoPlayback || (cg.snap->ps.pm_flags & PMF_FOLLOW) ) {
+		cg_predictedLastCmd = 0;
 		CG_InterpolatePlayerState( qfalse );
 		return;
 	}
 
 	// non-predicting local movement will grab the latest angles
 	if ( cg_nopredict.integer || cg_synchronousClients.integer ) {
+		cg_predictedLastCmd = 0;
 		CG_InterpolatePlayerState( qtrue );
 		return;
 	}
@@ -499,9 +843,18 @@ void CG_PredictPlayerState( void ) {
 	cg_pmove.pmove_fixed = pmove_fixed.integer;// | cg_pmove_fixed.integer;
 	cg_pmove.pmove_msec = pmove_msec.integer;
 
+	// pick up where the last prediction left off if it still holds
+	firstCmd = CG_ResumePrediction( current );
+	if ( firstCmd ) {
+		moved = qtrue;
+	} else {
+		firstCmd = current - CMD_BACKUP + 1;
+		cg_predictedLastCmd = 0;
+		moved = qfalse;
+	}
+
 	// run cmds
-	moved = qfalse;
-	for ( cmdNum = current - CMD_BACKUP + 1 ; cmdNum <= current ; cmdNum++ ) {
+	for ( cmdNum = firstCmd ; cmdNum <= current ; cmdNum++ ) {
 		// get the command
 		trap_GetUserCmd( cmdNum, &cg_pmove.cmd );
 
@@ -588,6 +941,8 @@ void CG_PredictPlayerState( void ) {
 		// add push trigger movement effects
 		CG_TouchTriggerPrediction();
 
+		CG_SavePredictedCmd( cmdNum );
+
 		// check for predictable events that changed from previous predictions
 		//CG_CheckChangedPredictableEvents(&cg.predictedPlayerState);
 	}
@@ -165,6 +165,20 @@ typedef enum {
 	// 1.32
 	CG_FS_SEEK,
 
+	CG_GET_NATIVE_TRAPS,	// const cgameNativeTraps_t * ( void );
+	// direct entry points for the hottest traps, NULL unless the cgame
+	// is a native library
+
+	CG_CVAR_UPDATE_CHANGED,	// ( void );
+	// updates every registered vmCvar_t whose cvar changed since the
+	// last call, returns how many did
+
+	CG_CM_BOXTRACEBATCH,	// ( trace_t *results, const cmTraceRequest_t *requests, int count, clipHandle_t model, int brushmask );
+	// runs count traces against the same model and brushmask
+
+	CG_R_DRAWSTRETCHPICS,	// ( int numPics, const stretchPic_t *pics );
+	// draws a run of pics in one call, each with its own color
+
 /*
 	CG_LOADCAMERA,
 	CG_STARTCAMERA,
@@ -185,6 +199,30 @@ typedef enum {
 	CG_ACOS
 } cgameImport_t;
 
+// one trace of a CG_CM_BOXTRACEBATCH call
+typedef struct {
+	vec3_t		start;
+	vec3_t		mins;
+	vec3_t		maxs;
+	vec3_t		end;
+} cmTraceRequest_t;
+
+// called directly by native cgame libraries instead of going through
+// syscall, which packs every call into an argument array
+typedef struct {
+	void	(*BoxTrace)( trace_t *results, const vec3_t start, const vec3_t end, const vec3_t mins, const vec3_t maxs, clipHandle_t model, int brushmask );
+	void	(*CapsuleTrace)( trace_t *results, const vec3_t start, const vec3_t end, const vec3_t mins, const vec3_t maxs, clipHandle_t model, int brushmask );
+	void	(*TransformedBoxTrace)( trace_t *results, const vec3_t start, const vec3_t end, const vec3_t mins, const vec3_t maxs, clipHandle_t model, int brushmask, const vec3_t origin, const vec3_t angles );
+	void	(*TransformedCapsuleTrace)( trace_t *results, const vec3_t start, const vec3_t end, const vec3_t mins, const vec3_t maxs, clipHandle_t model, int brushmask, const vec3_t origin, const vec3_t angles );
+	int		(*PointContents)( const vec3_t p, clipHandle_t model );
+	int		(*TransformedPointContents)( const vec3_t p, clipHandle_t model, const vec3_t origin, const vec3_t angles );
+	void	(*AddRefEntityToScene)( const refEntity_t *re );
+	void	(*AddPolyToScene)( qhandle_t hShader, int numVerts, const polyVert_t *verts );
+	void	(*AddLightToScene)( const vec3_t org, float intensity, float r, float g, float b );
+	void	(*AddPolysToScene)( qhandle_t hShader, int numVerts, const polyVert_t *verts, int numPolys );
+	void	(*DrawStretchPics)( int numPics, const stretchPic_t *pics );
+} cgameNativeTraps_t;
+
 
 /*
 ==================================================================
@@ -30,6 +30,18 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 static intptr_t (QDECL *syscall)( intptr_t arg, ... ) = (intptr_t (QDECL *)( intptr_t, ...))-1;
 
+// direct entry points, fetched on the first trap that can use them
+static const cgameNativeTraps_t *nativeTraps;
+static qboolean nativeTrapsChecked;
+
+static const cgameNativeTraps_t *CG_NativeTraps( void ) {
+	if ( !nativeTrapsChecked ) {
+		nativeTraps = (const cgameNativeTraps_t *)syscall( CG_GET_NATIVE_TRAPS );
+		nativeTrapsChecked = qtrue;
+	}
+	return nativeTraps;
+}
+
 
 Q_EXPORT void dllEntry( intptr_t (QDECL  *syscallptr)( intptr_t arg,... ) ) {
 	syscall = syscallptr;
@@ -65,6 +77,10 @@ void	trap_Cvar_Update( vmCvar_t *vmCvar ) {
 	syscall( CG_CVAR_UPDATE, vmCvar );
 }
 
+int		trap_Cvar_UpdateChanged( void ) {
+	return syscall( CG_CVAR_UPDATE_CHANGED );
+}
+
 void	trap_Cvar_Set( const char *var_name, const char *value ) {
 	syscall( CG_CVAR_SET, var_name, value );
 }
@@ -146,22 +162,48 @@ clipHandle_t trap_CM_TempCapsuleModel( const vec3_t mins, const vec3_t maxs ) {
 }
 
 int		trap_CM_PointContents( const vec3_t p, clipHandle_t model ) {
+	if ( CG_NativeTraps() ) {
+		return nativeTraps->PointContents( p, model );
+	}
 	return syscall( CG_CM_POINTCONTENTS, p, model );
 }
 
 int		trap_CM_TransformedPointContents( const vec3_t p, clipHandle_t model, const vec3_t origin, const vec3_t angles ) {
+	if ( CG_NativeTraps() ) {
+		return nativeTraps->TransformedPointContents( p, model, origin, angles );
+	}
 	return syscall( CG_CM_TRANSFORMEDPOINTCONTENTS, p, model, origin, angles );
 }
 
 void	trap_CM_BoxTrace( trace_t *results, const vec3_t start, const vec3_t end,
 						  const vec3_t mins, const vec3_t maxs,
 						  clipHandle_t model, int brushmask ) {
+	if ( CG_NativeTraps() ) {
+		nativeTraps->BoxTrace( results, start, end, mins, maxs, model, brushmask );
+		return;
+	}
 	syscall( CG_CM_BOXTRACE, results, start, end, mins, maxs, model, brushmask );
 }
 
+void	trap_CM_BoxTraceBatch( trace_t *results, const cmTraceRequest_t *requests, int count, clipHandle_t model, int brushmask ) {
+	int		i;
+
+	if ( CG_NativeTraps() ) {
+		for ( i = 0 ; i < count ; i++ ) {
+			nativeTraps->BoxTrace( &results[i], requests[i].start, requests[i].end, requests[i].mins, requests[i].maxs, model, brushmask );
+		}
+		return;
+	}
+	syscall( CG_CM_BOXTRACEBATCH, results, requests, count, model, brushmask );
+}
+
 void	trap_CM_CapsuleTrace( trace_t *results, const vec3_t start, const vec3_t end,
 						  const vec3_t mins, const vec3_t maxs,
 						  clipHandle_t model, int brushmask ) {
+	if ( CG_NativeTraps() ) {
+		nativeTraps->CapsuleTrace( results, start, end, mins, maxs, model, brushmask );
+		return;
+	}
 	syscall( CG_CM_CAPSULETRACE, results, start, end, mins, maxs, model, brushmask );
 }
 
@@ -169,6 +211,10 @@ void	trap_CM_TransformedBoxTrace( trace_t *results, const vec3_t start, const ve
 						  const vec3_t mins, const vec3_t maxs,
 						  clipHandle_t model, int brushmask,
 						  const vec3_t origin, const vec3_t angles ) {
+	if ( CG_NativeTraps() ) {
+		nativeTraps->TransformedBoxTrace( results, start, end, mins, maxs, model, brushmask, origin, angles );
+		return;
+	}
 	syscall( CG_CM_TRANSFORMEDBOXTRACE, results, start, end, mins, maxs, model, brushmask, origin, angles );
 }
 
@@ -176,6 +222,10 @@ void	trap_CM_TransformedCapsuleTrace( trace_t *results, const vec3_t start, cons
 						  const vec3_t mins, const vec3_t maxs,
 						  clipHandle_t model, int brushmask,
 						  const vec3_t origin, const vec3_t angles ) {
+	if ( CG_NativeTraps() ) {
+		nativeTraps->TransformedCapsuleTrace( results, start, end, mins, maxs, model, brushmask, origin, angles );
+		return;
+	}
 	syscall( CG_CM_TRANSFORMEDCAPSULETRACE, results, start, end, mins, maxs, model, brushmask, origin, angles );
 }
 
@@ -255,14 +305,26 @@ void	trap_R_ClearScene( void ) {
 }
 
 void	trap_R_AddRefEntityToScene( const refEntity_t *re ) {
+	if ( CG_NativeTraps() ) {
+		nativeTraps->AddRefEntityToScene( re );
+		return;
+	}
 	syscall( CG_R_ADDREFENTITYTOSCENE, re );
 }
 
 void	trap_R_AddPolyToScene( qhandle_t hShader , int numVerts, const polyVert_t *verts ) {
+	if ( CG_NativeTraps() ) {
+		nativeTraps->AddPolyToScene( hShader, numVerts, verts );
+		return;
+	}
 	syscall( CG_R_ADDPOLYTOSCENE, hShader, numVerts, verts );
 }
 
 void	trap_R_AddPolysToScene( qhandle_t hShader , int numVerts, const polyVert_t *verts, int num ) {
+	if ( CG_NativeTraps() ) {
+		nativeTraps->AddPolysToScene( hShader, numVerts, verts, num );
+		return;
+	}
 	syscall( CG_R_ADDPOLYSTOSCENE, hShader, numVerts, verts, num );
 }
 
@@ -271,6 +333,10 @@ int		trap_R_LightForPoint( vec3_t point, vec3_t ambientLight, vec3_t directedLig
 }
 
 void	trap_R_AddLightToScene( const vec3_t org, float intensity, float r, float g, float b ) {
+	if ( CG_NativeTraps() ) {
+		nativeTraps->AddLightToScene( org, intensity, r, g, b );
+		return;
+	}
 	syscall( CG_R_ADDLIGHTTOSCENE, org, PASSFLOAT(intensity), PASSFLOAT(r), PASSFLOAT(g), PASSFLOAT(b) );
 }
 
@@ -291,6 +357,14 @@ void	trap_R_DrawStretchPic( float x, float y, float w, float h,
 	syscall( CG_R_DRAWSTRETCHPIC, PASSFLOAT(x), PASSFLOAT(y), PASSFLOAT(w), PASSFLOAT(h), PASSFLOAT(s1), PASSFLOAT(t1), PASSFLOAT(s2), PASSFLOAT(t2), hShader );
 }
 
+void	trap_R_DrawStretchPics( int numPics, const stretchPic_t *pics ) {
+	if ( CG_NativeTraps() ) {
+		nativeTraps->DrawStretchPics( numPics, pics );
+		return;
+	}
+	syscall( CG_R_DRAWSTRETCHPICS, numPics, pics );
+}
+
 void	trap_R_ModelBounds( clipHandle_t model, vec3_t mins, vec3_t maxs ) {
 	syscall( CG_R_MODELBOUNDS, model, mins, maxs );
 }
@@ -27,6 +27,10 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #define MAX_RIFF_CHUNKS 16
 
+#define MAX_AVI_THREADS 8
+#define AVI_QUEUE_SIZE  8     // jobs in flight per thread
+#define AVI_WORKER_MSEC 100
+
 typedef struct audioFormat_s
 {
   int rate;
@@ -57,6 +61,10 @@ typedef struct aviFileData_s
   int           maxRecordSize;
   qboolean      motionJpeg;
 
+  qboolean      images;         // qoi image sequence and a wav file instead
+  char          imagePath[ MAX_QPATH ];
+  qboolean      writeFailed;    // a worker couldn't write, raised on the game thread
+
   qboolean      audio;
   audioFormat_t a;
   int           numAudioFrames;
@@ -69,6 +77,42 @@ typedef struct aviFileData_s
 
 static aviFileData_t afd;
 
+// Frames and sound are copied into jobs and written on worker threads, so
+// capture only costs the game thread a copy. Chunk offsets and the index
+// are worked out when a job is queued, the writer only has to put the
+// bytes down in order. Image sequence frames are also converted and
+// compressed by the encoders, one file each, so those run in parallel.
+// With cl_aviThreads 0 the jobs run as they are queued.
+typedef struct aviJob_s
+{
+  fileHandle_t  f, idxF;        // chunk and index entry go here
+  byte          header[ 8 ];
+  int           headerSize;
+  byte          index[ 16 ];
+  int           padding;
+
+  int           width, height;  // image sequence frames
+  char          path[ MAX_OSPATH ];
+
+  qboolean      failed;
+  int           size;
+  byte          *data;          // follows the job
+} aviJob_t;
+
+typedef struct aviWorker_s
+{
+  sndWorker_t   *thread;
+  sndQueue_t    *jobs;
+  sndQueue_t    *done;
+  int           queued;         // jobs handed over and not back yet
+  void          ( *process )( aviJob_t *job );
+} aviWorker_t;
+
+static aviWorker_t  aviWriter;
+static aviWorker_t  aviEncoders[ MAX_AVI_THREADS ];
+static int          aviNumEncoders;
+static int          aviNextEncoder;
+
 #define MAX_AVI_BUFFER 2048
 
 static byte buffer[ MAX_AVI_BUFFER ];
@@ -315,24 +359,440 @@ void CL_WriteAVIHeader( void )
 
 /*
 ===============
-CL_OpenAVIForWriting
+CL_WriteWAVHeader
 
-Creates an AVI file and gets it into a state where
-writing the actual data can begin
+The sound of an image sequence, sizes are right once it's closed
 ===============
 */
-qboolean CL_OpenAVIForWriting( const char *fileName )
+static void CL_WriteWAVHeader( void )
 {
-  if( afd.fileOpen )
-    return qfalse;
+  bufIndex = 0;
+  WRITE_STRING( "RIFF" );
+  WRITE_4BYTES( 36 + afd.a.totalBytes );
+  WRITE_STRING( "WAVE" );
+  WRITE_STRING( "fmt " );
+  WRITE_4BYTES( 16 );
+  WRITE_2BYTES( afd.a.format );
+  WRITE_2BYTES( afd.a.channels );
+  WRITE_4BYTES( afd.a.rate );
+  WRITE_4BYTES( afd.a.sampleSize * afd.a.rate );
+  WRITE_2BYTES( afd.a.sampleSize );
+  WRITE_2BYTES( afd.a.bits );
+  WRITE_STRING( "data" );
+  WRITE_4BYTES( afd.a.totalBytes );
+}
 
-  Com_Memset( &afd, 0, sizeof( aviFileData_t ) );
+#define QOI_OP_INDEX  0x00
+#define QOI_OP_DIFF   0x40
+#define QOI_OP_LUMA   0x80
+#define QOI_OP_RUN    0xc0
+#define QOI_OP_RGB    0xfe
 
-  // Don't start if a framerate has not been chosen
-  if( cl_aviFrameRate->integer <= 0 )
+/*
+===============
+CL_AVIEncodeQOI
+
+Compresses a raw avi frame, bottom up BGR lines padded to
+AVI_LINE_PADDING, into a QOI image. out needs room for
+width * height * 4 + 22 bytes. Returns the size.
+===============
+*/
+static int CL_AVIEncodeQOI( const byte *in, int width, int height, byte *out )
+{
+  byte          index[ 64 ][ 3 ];
+  byte          prev[ 3 ] = { 0, 0, 0 };
+  const byte    *line, *px;
+  int           linelen, len, run;
+  int           x, y, hash;
+  int           dr, dg, db, dgr, dgb;
+
+  linelen = PAD( width * 3, AVI_LINE_PADDING );
+  Com_Memset( index, 0, sizeof( index ) );
+
+  Com_Memcpy( out, "qoif", 4 );
+  out[ 4 ] = width >> 24;
+  out[ 5 ] = width >> 16;
+  out[ 6 ] = width >> 8;
+  out[ 7 ] = width;
+  out[ 8 ] = height >> 24;
+  out[ 9 ] = height >> 16;
+  out[ 10 ] = height >> 8;
+  out[ 11 ] = height;
+  out[ 12 ] = 3;        // channels
+  out[ 13 ] = 0;        // sRGB
+  len = 14;
+
+  run = 0;
+  for( y = height - 1; y >= 0; y-- )
   {
-    Com_Printf( S_COLOR_RED "cl_aviFrameRate must be >= 1\n" );
-    return qfalse;
+    line = in + y * linelen;
+
+    for( x = 0, px = line; x < width; x++, px += 3 )
+    {
+      if( px[ 2 ] == prev[ 0 ] && px[ 1 ] == prev[ 1 ] && px[ 0 ] == prev[ 2 ] )
+      {
+        if( ++run == 62 )
+        {
+          out[ len++ ] = QOI_OP_RUN | ( run - 1 );
+          run = 0;
+        }
+        continue;
+      }
+
+      if( run )
+      {
+        out[ len++ ] = QOI_OP_RUN | ( run - 1 );
+        run = 0;
+      }
+
+      // alpha is always 255
+      hash = ( px[ 2 ] * 3 + px[ 1 ] * 5 + px[ 0 ] * 7 + 255 * 11 ) & 63;
+
+      if( index[ hash ][ 0 ] == px[ 2 ] && index[ hash ][ 1 ] == px[ 1 ] && index[ hash ][ 2 ] == px[ 0 ] )
+        out[ len++ ] = QOI_OP_INDEX | hash;
+      else
+      {
+        index[ hash ][ 0 ] = px[ 2 ];
+        index[ hash ][ 1 ] = px[ 1 ];
+        index[ hash ][ 2 ] = px[ 0 ];
+
+        dr = (signed char)( px[ 2 ] - prev[ 0 ] );
+        dg = (signed char)( px[ 1 ] - prev[ 1 ] );
+        db = (signed char)( px[ 0 ] - prev[ 2 ] );
+        dgr = dr - dg;
+        dgb = db - dg;
+
+        if( dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1 )
+          out[ len++ ] = QOI_OP_DIFF | ( dr + 2 ) << 4 | ( dg + 2 ) << 2 | ( db + 2 );
+        else if( dgr >= -8 && dgr <= 7 && dg >= -32 && dg <= 31 && dgb >= -8 && dgb <= 7 )
+        {
+          out[ len++ ] = QOI_OP_LUMA | ( dg + 32 );
+          out[ len++ ] = ( dgr + 8 ) << 4 | ( dgb + 8 );
+        }
+        else
+        {
+          out[ len++ ] = QOI_OP_RGB;
+          out[ len++ ] = px[ 2 ];
+          out[ len++ ] = px[ 1 ];
+          out[ len++ ] = px[ 0 ];
+        }
+      }
+
+      prev[ 0 ] = px[ 2 ];
+      prev[ 1 ] = px[ 1 ];
+      prev[ 2 ] = px[ 0 ];
+    }
+  }
+
+  if( run )
+    out[ len++ ] = QOI_OP_RUN | ( run - 1 );
+
+  // end marker
+  Com_Memset( out + len, 0, 7 );
+  out[ len + 7 ] = 1;
+
+  return len + 8;
+}
+
+/*
+===============
+CL_AVIWriteJob
+
+Writer thread, FS_Write only touches the file it's given
+===============
+*/
+static void CL_AVIWriteJob( aviJob_t *job )
+{
+  byte  padding[ 4 ] = { 0 };
+
+  if( FS_Write( job->header, job->headerSize, job->f ) < job->headerSize ||
+      FS_Write( job->data, job->size, job->f ) < job->size ||
+      FS_Write( padding, job->padding, job->f ) < job->padding )
+    job->failed = qtrue;
+
+  if( job->idxF && FS_Write( job->index, 16, job->idxF ) < 16 )
+    job->failed = qtrue;
+}
+
+/*
+===============
+CL_AVIImageJob
+
+Encoder thread, compresses a frame and writes its file
+===============
+*/
+static void CL_AVIImageJob( aviJob_t *job )
+{
+  byte  *out;
+  int   size;
+  FILE  *f;
+
+  out = malloc( job->width * job->height * 4 + 22 );
+  if( !out )
+  {
+    job->failed = qtrue;
+    return;
+  }
+
+  size = CL_AVIEncodeQOI( job->data, job->width, job->height, out );
+
+  f = Sys_FOpen( job->path, "wb" );
+  if( !f || fwrite( out, 1, size, f ) != size )
+    job->failed = qtrue;
+  if( f )
+    fclose( f );
+
+  free( out );
+}
+
+/*
+===============
+CL_AVIWork
+===============
+*/
+static void CL_AVIWork( void *arg )
+{
+  aviWorker_t *worker = arg;
+  aviJob_t    *job;
+
+  while( SNDDMA_QueuePop( worker->jobs, &job ) )
+  {
+    worker->process( job );
+    SNDDMA_QueuePush( worker->done, &job );
+  }
+}
+
+/*
+===============
+CL_AVIStartWorker
+
+Jobs run as they are queued if there's no thread
+===============
+*/
+static void CL_AVIStartWorker( aviWorker_t *worker, const char *name, void ( *process )( aviJob_t *job ) )
+{
+  Com_Memset( worker, 0, sizeof( *worker ) );
+  worker->process = process;
+
+  if( cl_aviThreads->integer <= 0 )
+    return;
+
+  worker->jobs = SNDDMA_CreateQueue( sizeof( aviJob_t * ), AVI_QUEUE_SIZE );
+  worker->done = SNDDMA_CreateQueue( sizeof( aviJob_t * ), AVI_QUEUE_SIZE );
+  worker->thread = SNDDMA_StartWorker( name, CL_AVIWork, worker, AVI_WORKER_MSEC );
+
+  if( !worker->thread )
+  {
+    SNDDMA_FreeQueue( worker->jobs );
+    SNDDMA_FreeQueue( worker->done );
+    worker->jobs = worker->done = NULL;
+  }
+}
+
+/*
+===============
+CL_AVIFinishJob
+===============
+*/
+static void CL_AVIFinishJob( aviJob_t *job )
+{
+  if( job->failed )
+    afd.writeFailed = qtrue;
+
+  free( job );
+}
+
+/*
+===============
+CL_AVICollect
+
+Frees the jobs a worker is done with, qfalse if there weren't any
+===============
+*/
+static qboolean CL_AVICollect( aviWorker_t *worker )
+{
+  aviJob_t  *job;
+  qboolean  collected = qfalse;
+
+  while( SNDDMA_QueuePop( worker->done, &job ) )
+  {
+    CL_AVIFinishJob( job );
+    worker->queued--;
+    collected = qtrue;
+  }
+
+  return collected;
+}
+
+/*
+===============
+CL_AVIDrain
+
+Waits for everything queued on a worker to be done
+===============
+*/
+static void CL_AVIDrain( aviWorker_t *worker )
+{
+  while( worker->queued )
+  {
+    if( !CL_AVICollect( worker ) )
+      Sys_Sleep( 1 );
+  }
+}
+
+/*
+===============
+CL_AVIStopWorker
+===============
+*/
+static void CL_AVIStopWorker( aviWorker_t *worker )
+{
+  if( !worker->thread )
+    return;
+
+  CL_AVIDrain( worker );
+  SNDDMA_StopWorker( worker->thread );
+  SNDDMA_FreeQueue( worker->jobs );
+  SNDDMA_FreeQueue( worker->done );
+  Com_Memset( worker, 0, sizeof( *worker ) );
+}
+
+/*
+===============
+CL_AVIQueue
+
+Hands a job to a worker, waiting for room if it's behind
+===============
+*/
+static void CL_AVIQueue( aviWorker_t *worker, aviJob_t *job )
+{
+  if( !worker->thread )
+  {
+    worker->process( job );
+    CL_AVIFinishJob( job );
+    return;
+  }
+
+  CL_AVICollect( worker );
+
+  while( !SNDDMA_QueuePush( worker->jobs, &job ) )
+  {
+    SNDDMA_WakeWorker( worker->thread );
+    if( !CL_AVICollect( worker ) )
+      Sys_Sleep( 1 );
+  }
+
+  worker->queued++;
+  SNDDMA_WakeWorker( worker->thread );
+}
+
+/*
+===============
+CL_AVIAllocJob
+===============
+*/
+static aviJob_t *CL_AVIAllocJob( const byte *data, int size )
+{
+  aviJob_t  *job;
+
+  job = malloc( sizeof( *job ) + size );
+  if( !job )
+    Com_Error( ERR_DROP, "CL_AVIAllocJob: failed on allocation of %i bytes", size );
+
+  Com_Memset( job, 0, sizeof( *job ) );
+  job->data = (byte *)( job + 1 );
+  job->size = size;
+  Com_Memcpy( job->data, data, size );
+
+  return job;
+}
+
+/*
+===============
+CL_AVIWriteChunk
+
+Queues a chunk for the movi list with its index entry
+===============
+*/
+static void CL_AVIWriteChunk( const char *id, int flags, const byte *data, int size )
+{
+  aviJob_t  *job;
+  int       chunkOffset = afd.fileSize - afd.moviOffset - 8;
+  int       paddingSize = PADLEN( size, 2 );
+
+  job = CL_AVIAllocJob( data, size );
+  job->f = afd.f;
+  job->idxF = afd.idxF;
+  job->padding = paddingSize;
+
+  bufIndex = 0;
+  WRITE_STRING( id );
+  WRITE_4BYTES( size );
+  Com_Memcpy( job->header, buffer, 8 );
+  job->headerSize = 8;
+
+  bufIndex = 0;
+  WRITE_STRING( id );               //dwIdentifier
+  WRITE_4BYTES( flags );            //dwFlags
+  WRITE_4BYTES( chunkOffset );      //dwOffset
+  WRITE_4BYTES( size );             //dwLength
+  Com_Memcpy( job->index, buffer, 16 );
+
+  afd.fileSize += ( 8 + size + paddingSize );
+  afd.moviSize += ( 8 + size + paddingSize );
+  afd.numIndices++;
+
+  CL_AVIQueue( &aviWriter, job );
+}
+
+/*
+===============
+CL_AVIImagePath
+===============
+*/
+static const char *CL_AVIImagePath( int frame )
+{
+  return FS_BuildOSPath( Cvar_VariableString( "fs_homedatapath" ), NULL,
+      va( "%s/%06d.qoi", afd.imagePath, frame ) );
+}
+
+/*
+===============
+CL_AVIOpenFile
+
+Opens the file, or image sequence directory, of a recording and writes
+what goes before the data
+===============
+*/
+static qboolean CL_AVIOpenFile( const char *fileName )
+{
+  Q_strncpyz( afd.fileName, fileName, MAX_QPATH );
+
+  afd.fileSize = 0;
+  afd.moviSize = 0;
+  afd.numIndices = 0;
+  afd.numVideoFrames = 0;
+  afd.numAudioFrames = 0;
+  afd.maxRecordSize = 0;
+  afd.a.totalBytes = 0;
+
+  if( afd.images )
+  {
+    // videos/<name>/000000.qoi, and the sound as videos/<name>/audio.wav
+    COM_StripExtension( fileName, afd.imagePath, sizeof( afd.imagePath ) );
+    if( FS_CreatePath( CL_AVIImagePath( 0 ) ) )
+      return qfalse;
+
+    if( afd.audio )
+    {
+      if( ( afd.f = FS_FOpenFileWrite_HomeData( va( "%s/audio.wav", afd.imagePath ) ) ) <= 0 )
+        return qfalse;
+
+      CL_WriteWAVHeader( );
+      SafeFS_Write( buffer, bufIndex, afd.f );
+    }
+
+    return qtrue;
   }
 
   if( ( afd.f = FS_FOpenFileWrite_HomeData( fileName ) ) <= 0 )
@@ -345,27 +805,59 @@ qboolean CL_OpenAVIForWriting( const char *fileName )
     return qfalse;
   }
 
-  Q_strncpyz( afd.fileName, fileName, MAX_QPATH );
+  // This doesn't write a real header, but allocates the
+  // correct amount of space at the beginning of the file
+  CL_WriteAVIHeader( );
+
+  SafeFS_Write( buffer, bufIndex, afd.f );
+  afd.fileSize = bufIndex;
+
+  bufIndex = 0;
+  START_CHUNK( "idx1" );
+  SafeFS_Write( buffer, bufIndex, afd.idxF );
+
+  afd.moviSize = 4; // For the "movi"
+
+  return qtrue;
+}
+
+/*
+===============
+CL_OpenAVIForWriting
+
+Creates an AVI file and gets it into a state where
+writing the actual data can begin
+===============
+*/
+qboolean CL_OpenAVIForWriting( const char *fileName )
+{
+  int i;
+
+  if( afd.fileOpen )
+    return qfalse;
+
+  Com_Memset( &afd, 0, sizeof( aviFileData_t ) );
+
+  // Don't start if a framerate has not been chosen
+  if( cl_aviFrameRate->integer <= 0 )
+  {
+    Com_Printf( S_COLOR_RED "cl_aviFrameRate must be >= 1\n" );
+    return qfalse;
+  }
 
   afd.frameRate = cl_aviFrameRate->integer;
   afd.framePeriod = (int)( 1000000.0f / afd.frameRate );
   afd.width = cls.glconfig.vidWidth;
   afd.height = cls.glconfig.vidHeight;
 
-  if( cl_aviMotionJpeg->integer )
+  // image sequences are made from the raw frames
+  afd.images = ( cl_aviImages->integer != 0 );
+
+  if( cl_aviMotionJpeg->integer && !afd.images )
     afd.motionJpeg = qtrue;
   else
     afd.motionJpeg = qfalse;
 
-  // Capture buffer stores RGB pixels but OpenGL ES reads RGBA and converts to RGB in-place.
-  // Encode buffer only needs to store RGB pixels.
-  // Allocate a bit more space for the capture buffer to account for possible
-  // padding at the end of pixel lines, and padding for alignment
-  #define MAX_PACK_LEN 16
-  afd.cBuffer = Z_Malloc((afd.width * 4 + MAX_PACK_LEN - 1) * afd.height + MAX_PACK_LEN - 1);
-  // raw avi files have pixel lines start on 4-byte boundaries
-  afd.eBuffer = Z_Malloc(PAD(afd.width * 3, AVI_LINE_PADDING) * afd.height);
-
   afd.a.rate = dma.speed;
   afd.a.format = WAV_FORMAT_PCM;
   afd.a.channels = dma.channels;
@@ -408,19 +900,96 @@ qboolean CL_OpenAVIForWriting( const char *fileName )
         "with OpenAL. Set s_useOpenAL to 0 for audio capture\n" );
   }
 
-  // This doesn't write a real header, but allocates the
-  // correct amount of space at the beginning of the file
-  CL_WriteAVIHeader( );
+  if( !CL_AVIOpenFile( fileName ) )
+    return qfalse;
 
-  SafeFS_Write( buffer, bufIndex, afd.f );
-  afd.fileSize = bufIndex;
+  // Capture buffer stores RGB pixels but OpenGL ES reads RGBA and converts to RGB in-place.
+  // Encode buffer only needs to store RGB pixels.
+  // Allocate a bit more space for the capture buffer to account for possible
+  // padding at the end of pixel lines, and padding for alignment
+  #define MAX_PACK_LEN 16
+  afd.cBuffer = Z_Malloc((afd.width * 4 + MAX_PACK_LEN - 1) * afd.height + MAX_PACK_LEN - 1);
+  // raw avi files have pixel lines start on 4-byte boundaries
+  afd.eBuffer = Z_Malloc(PAD(afd.width * 3, AVI_LINE_PADDING) * afd.height);
+
+  CL_AVIStartWorker( &aviWriter, "avi writer", CL_AVIWriteJob );
+
+  aviNumEncoders = 0;
+  aviNextEncoder = 0;
+  if( afd.images )
+  {
+    aviNumEncoders = MIN( MAX( cl_aviThreads->integer, 1 ), MAX_AVI_THREADS );
+    for( i = 0; i < aviNumEncoders; i++ )
+      CL_AVIStartWorker( &aviEncoders[ i ], "avi encoder", CL_AVIImageJob );
+  }
+
+  afd.fileOpen = qtrue;
 
+  return qtrue;
+}
+
+/*
+===============
+CL_AVIFinishFile
+
+Appends the index and writes the real header, the writer must be idle
+===============
+*/
+static qboolean CL_AVIFinishFile( void )
+{
+  int indexRemainder;
+  int indexSize = afd.numIndices * 16;
+  const char *idxFileName = va( "%s" INDEX_FILE_EXTENSION, afd.fileName );
+
+  FS_Seek( afd.idxF, 4, FS_SEEK_SET );
   bufIndex = 0;
-  START_CHUNK( "idx1" );
+  WRITE_4BYTES( indexSize );
   SafeFS_Write( buffer, bufIndex, afd.idxF );
+  FS_FCloseFile( afd.idxF );
 
-  afd.moviSize = 4; // For the "movi"
-  afd.fileOpen = qtrue;
+  // Write index
+
+  // Open the temp index file
+  if( ( indexSize = FS_FOpenFileRead( idxFileName,
+          &afd.idxF, qtrue ) ) <= 0 )
+  {
+    FS_FCloseFile( afd.f );
+    return qfalse;
+  }
+
+  indexRemainder = indexSize;
+
+  // Append index to end of avi file
+  while( indexRemainder > MAX_AVI_BUFFER )
+  {
+    FS_Read( buffer, MAX_AVI_BUFFER, afd.idxF );
+    SafeFS_Write( buffer, MAX_AVI_BUFFER, afd.f );
+    afd.fileSize += MAX_AVI_BUFFER;
+    indexRemainder -= MAX_AVI_BUFFER;
+  }
+  FS_Read( buffer, indexRemainder, afd.idxF );
+  SafeFS_Write( buffer, indexRemainder, afd.f );
+  afd.fileSize += indexRemainder;
+  FS_FCloseFile( afd.idxF );
+
+  // Remove temp index file
+  FS_Remove_HomeData( idxFileName );
+
+  // Write the real header
+  FS_Seek( afd.f, 0, FS_SEEK_SET );
+  CL_WriteAVIHeader( );
+
+  bufIndex = 4;
+  WRITE_4BYTES( afd.fileSize - 8 ); // "RIFF" size
+
+  bufIndex = afd.moviOffset + 4;    // Skip "LIST"
+  WRITE_4BYTES( afd.moviSize );
+
+  SafeFS_Write( buffer, bufIndex, afd.f );
+
+  FS_FCloseFile( afd.f );
+
+  Com_Printf( "Wrote %d:%d frames to %s\n", afd.numVideoFrames, afd.numAudioFrames, afd.fileName );
 
   return qtrue;
 }
@@ -428,12 +997,17 @@ qboolean CL_OpenAVIForWriting( const char *fileName )
 /*
 ===============
 CL_CheckFileSize
+
+Carries on in a new file before this one would pass 2Gb
 ===============
 */
-static qboolean CL_CheckFileSize( int bytesToAdd )
+static void CL_CheckFileSize( int bytesToAdd )
 {
   unsigned int newFileSize;
 
+  if( afd.images )
+    return;
+
   newFileSize =
     afd.fileSize +                // Current file size
     bytesToAdd +                  // What we want to add
@@ -445,15 +1019,27 @@ static qboolean CL_CheckFileSize( int bytesToAdd )
   if( newFileSize > INT_MAX )
   {
     // Close the current file...
-    CL_CloseAVI( );
+    CL_AVIDrain( &aviWriter );
+    CL_AVIFinishFile( );
 
     // ...And open a new one
-    CL_OpenAVIForWriting( va( "%s_", afd.fileName ) );
-
-    return qtrue;
+    if( !CL_AVIOpenFile( va( "%s_", afd.fileName ) ) )
+      Com_Error( ERR_DROP, "Failed to open avi file %s_", afd.fileName );
   }
+}
 
-  return qfalse;
+/*
+===============
+CL_CheckWriteFailed
+===============
+*/
+static void CL_CheckWriteFailed( void )
+{
+  if( afd.writeFailed )
+  {
+    afd.writeFailed = qfalse;
+    Com_Error( ERR_DROP, "Failed to write avi file" );
+  }
 }
 
 /*
@@ -463,42 +1049,36 @@ CL_WriteAVIVideoFrame
 */
 void CL_WriteAVIVideoFrame( const byte *imageBuffer, int size )
 {
-  int   chunkOffset = afd.fileSize - afd.moviOffset - 8;
-  int   chunkSize = 8 + size;
-  int   paddingSize = PADLEN(size, 2);
-  byte  padding[ 4 ] = { 0 };
+  aviJob_t  *job;
 
   if( !afd.fileOpen )
     return;
 
-  // Chunk header + contents + padding
-  if( CL_CheckFileSize( 8 + size + 2 ) )
+  CL_CheckWriteFailed( );
+
+  if( afd.images )
+  {
+    job = CL_AVIAllocJob( imageBuffer, size );
+    job->width = afd.width;
+    job->height = afd.height;
+    Q_strncpyz( job->path, CL_AVIImagePath( afd.numVideoFrames ), sizeof( job->path ) );
+
+    CL_AVIQueue( &aviEncoders[ aviNextEncoder ], job );
+    aviNextEncoder = ( aviNextEncoder + 1 ) % aviNumEncoders;
+
+    afd.numVideoFrames++;
     return;
+  }
 
-  bufIndex = 0;
-  WRITE_STRING( "00dc" );
-  WRITE_4BYTES( size );
+  // Chunk header + contents + padding
+  CL_CheckFileSize( 8 + size + 2 );
 
-  SafeFS_Write( buffer, 8, afd.f );
-  SafeFS_Write( imageBuffer, size, afd.f );
-  SafeFS_Write( padding, paddingSize, afd.f );
-  afd.fileSize += ( chunkSize + paddingSize );
+  CL_AVIWriteChunk( "00dc", 0x00000010, imageBuffer, size );  // all frames are KeyFrames
 
   afd.numVideoFrames++;
-  afd.moviSize += ( chunkSize + paddingSize );
 
   if( size > afd.maxRecordSize )
     afd.maxRecordSize = size;
-
-  // Index
-  bufIndex = 0;
-  WRITE_STRING( "00dc" );           //dwIdentifier
-  WRITE_4BYTES( 0x00000010 );       //dwFlags (all frames are KeyFrames)
-  WRITE_4BYTES( chunkOffset );      //dwOffset
-  WRITE_4BYTES( size );             //dwLength
-  SafeFS_Write( buffer, 16, afd.idxF );
-
-  afd.numIndices++;
 }
 
 #define PCM_BUFFER_SIZE 44100
@@ -519,9 +1099,10 @@ void CL_WriteAVIAudioFrame( const byte *pcmBuffer, int size )
   if( !afd.fileOpen )
     return;
 
+  CL_CheckWriteFailed( );
+
   // Chunk header + contents + padding
-  if( CL_CheckFileSize( 8 + bytesInBuffer + size + 2 ) )
-    return;
+  CL_CheckFileSize( 8 + bytesInBuffer + size + 2 );
 
   if( bytesInBuffer + size > PCM_BUFFER_SIZE )
   {
@@ -537,34 +1118,19 @@ void CL_WriteAVIAudioFrame( const byte *pcmBuffer, int size )
   if( bytesInBuffer >= (int)ceil( (float)afd.a.rate / (float)afd.frameRate ) *
         afd.a.sampleSize )
   {
-    int   chunkOffset = afd.fileSize - afd.moviOffset - 8;
-    int   chunkSize = 8 + bytesInBuffer;
-    int   paddingSize = PADLEN(bytesInBuffer, 2);
-    byte  padding[ 4 ] = { 0 };
-
-    bufIndex = 0;
-    WRITE_STRING( "01wb" );
-    WRITE_4BYTES( bytesInBuffer );
+    if( afd.images )
+    {
+      aviJob_t *job = CL_AVIAllocJob( pcmCaptureBuffer, bytesInBuffer );
 
-    SafeFS_Write( buffer, 8, afd.f );
-    SafeFS_Write( pcmCaptureBuffer, bytesInBuffer, afd.f );
-    SafeFS_Write( padding, paddingSize, afd.f );
-    afd.fileSize += ( chunkSize + paddingSize );
+      job->f = afd.f;
+      CL_AVIQueue( &aviWriter, job );
+    }
+    else
+      CL_AVIWriteChunk( "01wb", 0, pcmCaptureBuffer, bytesInBuffer );
 
     afd.numAudioFrames++;
-    afd.moviSize += ( chunkSize + paddingSize );
     afd.a.totalBytes += bytesInBuffer;
 
-    // Index
-    bufIndex = 0;
-    WRITE_STRING( "01wb" );           //dwIdentifier
-    WRITE_4BYTES( 0 );                //dwFlags
-    WRITE_4BYTES( chunkOffset );      //dwOffset
-    WRITE_4BYTES( bytesInBuffer );    //dwLength
-    SafeFS_Write( buffer, 16, afd.idxF );
-
-    afd.numIndices++;
-
     bytesInBuffer = 0;
   }
 }
@@ -593,9 +1159,8 @@ Closes the AVI file and writes an index chunk
 */
 qboolean CL_CloseAVI( void )
 {
-  int indexRemainder;
-  int indexSize = afd.numIndices * 16;
-  const char *idxFileName = va( "%s" INDEX_FILE_EXTENSION, afd.fileName );
+  qboolean  finished = qtrue;
+  int       i;
 
   // AVI file isn't open
   if( !afd.fileOpen )
@@ -603,59 +1168,31 @@ qboolean CL_CloseAVI( void )
 
   afd.fileOpen = qfalse;
 
-  FS_Seek( afd.idxF, 4, FS_SEEK_SET );
-  bufIndex = 0;
-  WRITE_4BYTES( indexSize );
-  SafeFS_Write( buffer, bufIndex, afd.idxF );
-  FS_FCloseFile( afd.idxF );
+  // everything queued is written first
+  for( i = 0; i < aviNumEncoders; i++ )
+    CL_AVIStopWorker( &aviEncoders[ i ] );
+  aviNumEncoders = 0;
+  CL_AVIStopWorker( &aviWriter );
 
-  // Write index
+  Z_Free( afd.cBuffer );
+  Z_Free( afd.eBuffer );
 
-  // Open the temp index file
-  if( ( indexSize = FS_FOpenFileRead( idxFileName,
-          &afd.idxF, qtrue ) ) <= 0 )
+  if( afd.images )
   {
-    FS_FCloseFile( afd.f );
-    return qfalse;
-  }
-
-  indexRemainder = indexSize;
+    if( afd.audio )
+    {
+      FS_Seek( afd.f, 0, FS_SEEK_SET );
+      CL_WriteWAVHeader( );
+      SafeFS_Write( buffer, bufIndex, afd.f );
+      FS_FCloseFile( afd.f );
+    }
 
-  // Append index to end of avi file
-  while( indexRemainder > MAX_AVI_BUFFER )
-  {
-    FS_Read( buffer, MAX_AVI_BUFFER, afd.idxF );
-    SafeFS_Write( buffer, MAX_AVI_BUFFER, afd.f );
-    afd.fileSize += MAX_AVI_BUFFER;
-    indexRemainder -= MAX_AVI_BUFFER;
+    Com_Printf( "Wrote %d:%d frames to %s/\n", afd.numVideoFrames, afd.numAudioFrames, afd.imagePath );
   }
-  FS_Read( buffer, indexRemainder, afd.idxF );
-  SafeFS_Write( buffer, indexRemainder, afd.f );
-  afd.fileSize += indexRemainder;
-  FS_FCloseFile( afd.idxF );
-
-  // Remove temp index file
-  FS_Remove_HomeData( idxFileName );
-
-  // Write the real header
-  FS_Seek( afd.f, 0, FS_SEEK_SET );
-  CL_WriteAVIHeader( );
-
-  bufIndex = 4;
-  WRITE_4BYTES( afd.fileSize - 8 ); // "RIFF" size
-
-  bufIndex = afd.moviOffset + 4;    // Skip "LIST"
-  WRITE_4BYTES( afd.moviSize );
-
-  SafeFS_Write( buffer, bufIndex, afd.f );
-
-  Z_Free( afd.cBuffer );
-  Z_Free( afd.eBuffer );
-  FS_FCloseFile( afd.f );
-
-  Com_Printf( "Wrote %d:%d frames to %s\n", afd.numVideoFrames, afd.numAudioFrames, afd.fileName );
+  else
+    finished = CL_AVIFinishFile( );
 
-  return qtrue;
+  return finished;
 }
 
 /*
@@ -0,0 +1,377 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// cl_bench.c -- timedemo benchmark passes
+
+// A timedemo plays cl_timedemoWarmup unmeasured passes and then
+// cl_timedemoPasses measured ones, replaying the demo in between. Every
+// frame records its duration and the time spent in cgame, the renderer
+// front and back end and sound, which are reduced per pass to percentiles
+// and lows and written out as json next to cl_timedemoLog.
+
+#include "client.h"
+
+#define MAX_BENCH_PASSES	32
+#define MAX_BENCH_FRAMES	65536		// about 55 minutes of demo at 20 frames a second
+
+typedef struct {
+	int		total;						// usec
+	int		times[BENCH_NUM_TIMES];
+} benchFrame_t;
+
+typedef struct {
+	int		frames;
+	float	seconds;
+	float	fps;
+	float	avg, p50, p95, p99;			// frame msec
+	float	low1, low01;				// fps over the slowest 1% and 0.1% of frames
+	float	times[BENCH_NUM_TIMES];		// average msec per frame
+} benchPass_t;
+
+static const char *benchTimeNames[BENCH_NUM_TIMES] = {
+	"cgame", "frontend", "backend", "sound"
+};
+
+static struct {
+	char			demo[MAX_OSPATH];
+	char			map[MAX_QPATH];
+	qboolean		replaying;				// the next demo command is ours
+	int				pass;					// warm-up included
+	int				warmup;
+	int				numPasses;				// measured ones
+	benchPass_t		passes[MAX_BENCH_PASSES];
+
+	benchFrame_t	*frames;				// NULL when not benchmarking
+	int				numFrames;
+	int64_t			passStart;
+	int64_t			frameStart;				// 0 before the first frame of a pass
+	int				times[BENCH_NUM_TIMES];	// the frame so far
+} bench;
+
+/*
+=================
+CL_BenchmarkDemo
+
+Called when a demo starts playing
+=================
+*/
+void CL_BenchmarkDemo( const char *demo )
+{
+	if ( !cl_timedemo->integer ) {
+		bench.replaying = qfalse;
+		return;
+	}
+
+	if ( !bench.replaying || Q_stricmp( bench.demo, demo ) ) {
+		Q_strncpyz( bench.demo, demo, sizeof( bench.demo ) );
+		bench.pass = 0;
+		bench.warmup = cl_timedemoWarmup->integer;
+		bench.numPasses = cl_timedemoPasses->integer;
+
+		if ( !bench.frames ) {
+			bench.frames = Z_Malloc( MAX_BENCH_FRAMES * sizeof( *bench.frames ) );
+		}
+	}
+
+	bench.replaying = qfalse;
+	bench.numFrames = 0;
+	bench.frameStart = 0;
+	Com_Memset( bench.times, 0, sizeof( bench.times ) );
+}
+
+/*
+=================
+CL_BenchmarkTime
+
+Adds to the current frame's time in a subsystem
+=================
+*/
+void CL_BenchmarkTime( benchTime_t which, int usec )
+{
+	bench.times[which] += usec;
+}
+
+/*
+=================
+CL_BenchmarkFrame
+
+Called once per timedemo frame, before it is drawn
+=================
+*/
+void CL_BenchmarkFrame( void )
+{
+	benchFrame_t	*frame;
+	int64_t			now;
+	int				i;
+
+	if ( !bench.frames ) {
+		return;
+	}
+
+	now = Sys_Microseconds();
+
+	if ( !bench.frameStart ) {
+		bench.passStart = now;
+	} else if ( bench.numFrames < MAX_BENCH_FRAMES ) {
+		frame = &bench.frames[bench.numFrames++];
+		frame->total = now - bench.frameStart;
+		for ( i = 0; i < BENCH_NUM_TIMES; i++ ) {
+			frame->times[i] = bench.times[i];
+		}
+
+		// the front end runs inside cgame's scene calls
+		frame->times[BENCH_CGAME] -= frame->times[BENCH_FRONTEND];
+		if ( frame->times[BENCH_CGAME] < 0 ) {
+			frame->times[BENCH_CGAME] = 0;
+		}
+	}
+
+	bench.frameStart = now;
+	Com_Memset( bench.times, 0, sizeof( bench.times ) );
+}
+
+/*
+=================
+CL_BenchmarkCompare
+=================
+*/
+static int CL_BenchmarkCompare( const void *a, const void *b )
+{
+	return ( (const benchFrame_t *)a )->total - ( (const benchFrame_t *)b )->total;
+}
+
+/*
+=================
+CL_BenchmarkLow
+
+fps over the slowest fraction of the sorted frames
+=================
+*/
+static float CL_BenchmarkLow( float fraction )
+{
+	int64_t	sum;
+	int		count, i;
+
+	count = bench.numFrames * fraction;
+	if ( count < 1 ) {
+		count = 1;
+	}
+
+	sum = 0;
+	for ( i = bench.numFrames - count; i < bench.numFrames; i++ ) {
+		sum += bench.frames[i].total;
+	}
+
+	return sum ? count * 1000000.0f / sum : 0.0f;
+}
+
+/*
+=================
+CL_BenchmarkPercentile
+=================
+*/
+static float CL_BenchmarkPercentile( float fraction )
+{
+	return bench.frames[(int)( fraction * ( bench.numFrames - 1 ) + 0.5f )].total / 1000.0f;
+}
+
+/*
+=================
+CL_BenchmarkReduce
+=================
+*/
+static void CL_BenchmarkReduce( benchPass_t *pass )
+{
+	int64_t	times[BENCH_NUM_TIMES];
+	int		i, j;
+
+	Com_Memset( pass, 0, sizeof( *pass ) );
+	Com_Memset( times, 0, sizeof( times ) );
+
+	pass->frames = bench.numFrames;
+	pass->seconds = ( bench.frameStart - bench.passStart ) / 1000000.0f;
+	if ( !pass->frames || pass->seconds <= 0 ) {
+		return;
+	}
+
+	pass->fps = pass->frames / pass->seconds;
+	pass->avg = pass->seconds * 1000.0f / pass->frames;
+
+	for ( i = 0; i < bench.numFrames; i++ ) {
+		for ( j = 0; j < BENCH_NUM_TIMES; j++ ) {
+			times[j] += bench.frames[i].times[j];
+		}
+	}
+	for ( j = 0; j < BENCH_NUM_TIMES; j++ ) {
+		pass->times[j] = times[j] / 1000.0f / pass->frames;
+	}
+
+	qsort( bench.frames, bench.numFrames, sizeof( *bench.frames ), CL_BenchmarkCompare );
+
+	pass->p50 = CL_BenchmarkPercentile( 0.5f );
+	pass->p95 = CL_BenchmarkPercentile( 0.95f );
+	pass->p99 = CL_BenchmarkPercentile( 0.99f );
+	pass->low1 = CL_BenchmarkLow( 0.01f );
+	pass->low01 = CL_BenchmarkLow( 0.001f );
+}
+
+/*
+=================
+CL_BenchmarkJsonString
+
+Demo and map names in paths never need more escaping than this
+=================
+*/
+static const char *CL_BenchmarkJsonString( const char *in )
+{
+	static char	out[MAX_OSPATH];
+	int			i;
+
+	Q_strncpyz( out, in, sizeof( out ) );
+	for ( i = 0; out[i]; i++ ) {
+		if ( out[i] == '\\' ) {
+			out[i] = '/';
+		} else if ( out[i] == '"' || (byte)out[i] < ' ' ) {
+			out[i] = '_';
+		}
+	}
+
+	return out;
+}
+
+/*
+=================
+CL_BenchmarkWrite
+=================
+*/
+static void CL_BenchmarkWrite( void )
+{
+	char			name[MAX_OSPATH];
+	char			demo[MAX_OSPATH];
+	fileHandle_t	f;
+	benchPass_t		*pass;
+	float			minFps, maxFps, meanFps;
+	int				i, j;
+
+	if ( cl_timedemoLog->string[0] ) {
+		COM_StripExtension( cl_timedemoLog->string, name, sizeof( name ) );
+		Q_strcat( name, sizeof( name ), ".json" );
+	} else {
+		COM_StripExtension( bench.demo, demo, sizeof( demo ) );
+		Com_sprintf( name, sizeof( name ), "benchmark/%s.json", COM_SkipPath( demo ) );
+	}
+
+	f = FS_FOpenFileWrite_HomeData( name );
+	if ( !f ) {
+		Com_Printf( "Couldn't open %s for writing\n", name );
+		return;
+	}
+
+	minFps = maxFps = bench.passes[0].fps;
+	meanFps = 0;
+	for ( i = 0, pass = bench.passes; i < bench.numPasses; i++, pass++ ) {
+		minFps = MIN( minFps, pass->fps );
+		maxFps = MAX( maxFps, pass->fps );
+		meanFps += pass->fps / bench.numPasses;
+	}
+
+	FS_Printf( f, "{\n" );
+	FS_Printf( f, "\t\"demo\": \"%s\",\n", CL_BenchmarkJsonString( bench.demo ) );
+	FS_Printf( f, "\t\"map\": \"%s\",\n", CL_BenchmarkJsonString( bench.map ) );
+	FS_Printf( f, "\t\"renderer\": \"%s\",\n", CL_BenchmarkJsonString( Cvar_VariableString( "cl_renderer" ) ) );
+	FS_Printf( f, "\t\"width\": %d,\n", cls.glconfig.vidWidth );
+	FS_Printf( f, "\t\"height\": %d,\n", cls.glconfig.vidHeight );
+	FS_Printf( f, "\t\"warmup\": %d,\n", bench.warmup );
+	FS_Printf( f, "\t\"fps\": { \"min\": %.2f, \"mean\": %.2f, \"max\": %.2f },\n", minFps, meanFps, maxFps );
+	FS_Printf( f, "\t\"passes\": [\n" );
+
+	for ( i = 0, pass = bench.passes; i < bench.numPasses; i++, pass++ ) {
+		FS_Printf( f, "\t\t{\n" );
+		FS_Printf( f, "\t\t\t\"frames\": %d,\n", pass->frames );
+		FS_Printf( f, "\t\t\t\"seconds\": %.3f,\n", pass->seconds );
+		FS_Printf( f, "\t\t\t\"fps\": %.2f,\n", pass->fps );
+		FS_Printf( f, "\t\t\t\"low1\": %.2f,\n", pass->low1 );
+		FS_Printf( f, "\t\t\t\"low01\": %.2f,\n", pass->low01 );
+		FS_Printf( f, "\t\t\t\"msec\": { \"avg\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f },\n",
+			pass->avg, pass->p50, pass->p95, pass->p99 );
+		FS_Printf( f, "\t\t\t\"subsystems\": {" );
+		for ( j = 0; j < BENCH_NUM_TIMES; j++ ) {
+			FS_Printf( f, "%s \"%s\": %.3f", j ? "," : "", benchTimeNames[j], pass->times[j] );
+		}
+		FS_Printf( f, " }\n" );
+		FS_Printf( f, "\t\t}%s\n", i < bench.numPasses - 1 ? "," : "" );
+	}
+
+	FS_Printf( f, "\t]\n" );
+	FS_Printf( f, "}\n" );
+
+	FS_FCloseFile( f );
+	Com_Printf( "%s written\n", name );
+}
+
+/*
+=================
+CL_BenchmarkCompleted
+
+Called when a timedemo ends, qtrue if the demo has been queued to
+play again for another pass
+=================
+*/
+qboolean CL_BenchmarkCompleted( void )
+{
+	benchPass_t	*pass;
+	int			measured;
+
+	if ( !bench.frames ) {
+		return qfalse;
+	}
+
+	Q_strncpyz( bench.map, cl.mapname, sizeof( bench.map ) );
+
+	measured = bench.pass - bench.warmup;
+	if ( measured < 0 ) {
+		Com_Printf( "warm-up pass %d of %d done\n", bench.pass + 1, bench.warmup );
+	} else {
+		pass = &bench.passes[measured];
+		CL_BenchmarkReduce( pass );
+
+		Com_Printf( "pass %d of %d: %.1f fps, %.2f/%.2f/%.2f ms p50/p95/p99, %.1f/%.1f fps 1%%/0.1%% lows\n",
+			measured + 1, bench.numPasses, pass->fps, pass->p50, pass->p95, pass->p99, pass->low1, pass->low01 );
+		Com_Printf( "  %.2f ms cgame, %.2f ms front end, %.2f ms back end, %.2f ms sound per frame\n",
+			pass->times[BENCH_CGAME], pass->times[BENCH_FRONTEND],
+			pass->times[BENCH_BACKEND], pass->times[BENCH_SOUND] );
+	}
+
+	bench.pass++;
+	if ( bench.pass < bench.warmup + bench.numPasses ) {
+		bench.replaying = qtrue;
+		Cbuf_AddText( va( "demo \"%s\"\n", bench.demo ) );
+		return qtrue;
+	}
+
+	if ( bench.numPasses > 0 ) {
+		CL_BenchmarkWrite();
+	}
+
+	Z_Free( bench.frames );
+	bench.frames = NULL;
+	return qfalse;
+}
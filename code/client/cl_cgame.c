@@ -35,6 +35,8 @@ extern qboolean loadCamera(const char *name);
 extern void startCamera(int time);
 extern qboolean getCameraInfo(int time, vec3_t *origin, vec3_t *angles);
 
+static qboolean	cgameKeepWorld;		// see CL_RestartCGame
+
 /*
 ====================
 CL_GetGameState
@@ -260,6 +262,9 @@ qboolean CL_GetServerCommand( int serverCommandNumber ) {
 	char	*s;
 	char	*cmd;
 	static char bigConfigString[BIG_INFO_STRING];
+	static char deltaConfigString[BIG_INFO_STRING];
+	const char	*old;
+	int		index, keep, tail, oldLen;
 	int argc;
 
 	// if we have irretrievably lost a reliable command, drop the connection
@@ -282,6 +287,11 @@ qboolean CL_GetServerCommand( int serverCommandNumber ) {
 
 	Com_DPrintf( "serverCommand: %i : %s\n", serverCommandNumber, s );
 
+	// replaced by a later command before it was acknowledged
+	if ( !s[0] ) {
+		return qfalse;
+	}
+
 rescan:
 	Cmd_TokenizeString( s );
 	cmd = Cmd_Argv(0);
@@ -321,6 +331,28 @@ rescan:
 		goto rescan;
 	}
 
+	// csd <index> <keep> <tail> "<middle>": the first keep and last tail
+	// characters of the configstring stay, the middle replaces the rest
+	if ( !strcmp( cmd, "csd" ) ) {
+		index = atoi( Cmd_Argv(1) );
+		if ( index < 0 || index >= MAX_CONFIGSTRINGS ) {
+			Com_Error( ERR_DROP, "CL_GetServerCommand: bad csd index %i", index );
+		}
+		old = cl.gameState.stringData + cl.gameState.stringOffsets[ index ];
+		oldLen = strlen( old );
+		keep = atoi( Cmd_Argv(2) );
+		tail = atoi( Cmd_Argv(3) );
+		if ( keep < 0 || tail < 0 || keep + tail > oldLen ) {
+			Com_Error( ERR_DROP, "CL_GetServerCommand: bad csd for configstring %i", index );
+		}
+		if ( Com_sprintf( deltaConfigString, sizeof( deltaConfigString ), "cs %i \"%.*s%s%s\"",
+			index, keep, old, Cmd_Argv(4), old + oldLen - tail ) >= (int)sizeof( deltaConfigString ) ) {
+			Com_Error( ERR_DROP, "csd exceeded BIG_INFO_STRING" );
+		}
+		s = deltaConfigString;
+		goto rescan;
+	}
+
 	if ( !strcmp( cmd, "cs" ) ) {
 		CL_ConfigstringModified();
 		// reparse the string, because CL_ConfigstringModified may have done another Cmd_TokenizeString()
@@ -386,12 +418,14 @@ CL_ShutdownCGame
 void CL_ShutdownCGame( void ) {
 	Key_SetCatcher( Key_GetCatcher( ) & ~KEYCATCH_CGAME );
 	cls.cgameStarted = qfalse;
+	cgameKeepWorld = qfalse;
 	if ( !cgvm ) {
 		return;
 	}
 	VM_Call( cgvm, CG_SHUTDOWN );
 	VM_Free( cgvm );
 	cgvm = NULL;
+	Cvar_ClearTracked( CVAR_TRACK_CGAME );
 }
 
 static int	FloatAsInt( float f ) {
@@ -400,6 +434,79 @@ static int	FloatAsInt( float f ) {
 	return fi.i;
 }
 
+/*
+====================
+Native cgame traps
+
+Called straight from a native cgame library, without packing the
+arguments for CL_CgameSystemCalls.  The renderer calls go through
+wrappers because re is filled in again on every vid_restart.
+====================
+*/
+static void CL_NativeBoxTrace( trace_t *results, const vec3_t start, const vec3_t end, const vec3_t mins, const vec3_t maxs, clipHandle_t model, int brushmask ) {
+	CM_BoxTrace( results, start, end, (float *)mins, (float *)maxs, model, brushmask, qfalse );
+}
+
+static void CL_NativeCapsuleTrace( trace_t *results, const vec3_t start, const vec3_t end, const vec3_t mins, const vec3_t maxs, clipHandle_t model, int brushmask ) {
+	CM_BoxTrace( results, start, end, (float *)mins, (float *)maxs, model, brushmask, qtrue );
+}
+
+static void CL_NativeTransformedBoxTrace( trace_t *results, const vec3_t start, const vec3_t end, const vec3_t mins, const vec3_t maxs, clipHandle_t model, int brushmask, const vec3_t origin, const vec3_t angles ) {
+	CM_TransformedBoxTrace( results, start, end, (float *)mins, (float *)maxs, model, brushmask, origin, angles, qfalse );
+}
+
+static void CL_NativeTransformedCapsuleTrace( trace_t *results, const vec3_t start, const vec3_t end, const vec3_t mins, const vec3_t maxs, clipHandle_t model, int brushmask, const vec3_t origin, const vec3_t angles ) {
+	CM_TransformedBoxTrace( results, start, end, (float *)mins, (float *)maxs, model, brushmask, origin, angles, qtrue );
+}
+
+static void CL_NativeAddRefEntityToScene( const refEntity_t *ent ) {
+	re.AddRefEntityToScene( ent );
+}
+
+static void CL_NativeAddPolyToScene( qhandle_t hShader, int numVerts, const polyVert_t *verts ) {
+	re.AddPolyToScene( hShader, numVerts, verts, 1 );
+}
+
+static void CL_NativeAddPolysToScene( qhandle_t hShader, int numVerts, const polyVert_t *verts, int numPolys ) {
+	re.AddPolyToScene( hShader, numVerts, verts, numPolys );
+}
+
+static void CL_NativeAddLightToScene( const vec3_t org, float intensity, float r, float g, float b ) {
+	re.AddLightToScene( org, intensity, r, g, b );
+}
+
+static void CL_NativeDrawStretchPics( int numPics, const stretchPic_t *pics ) {
+	re.DrawStretchPics( numPics, pics );
+}
+
+static const cgameNativeTraps_t cl_nativeTraps = {
+	CL_NativeBoxTrace,
+	CL_NativeCapsuleTrace,
+	CL_NativeTransformedBoxTrace,
+	CL_NativeTransformedCapsuleTrace,
+	CM_PointContents,
+	CM_TransformedPointContents,
+	CL_NativeAddRefEntityToScene,
+	CL_NativeAddPolyToScene,
+	CL_NativeAddLightToScene,
+	CL_NativeAddPolysToScene,
+	CL_NativeDrawStretchPics
+};
+
+/*
+====================
+CL_CM_BoxTraceBatch
+====================
+*/
+static void CL_CM_BoxTraceBatch( trace_t *results, const cmTraceRequest_t *requests, int count, clipHandle_t model, int brushmask ) {
+	int		i;
+
+	for ( i = 0 ; i < count ; i++ ) {
+		CM_BoxTrace( &results[i], requests[i].start, requests[i].end,
+			(float *)requests[i].mins, (float *)requests[i].maxs, model, brushmask, qfalse );
+	}
+}
+
 /*
 ====================
 CL_CgameSystemCalls
@@ -419,10 +526,13 @@ intptr_t CL_CgameSystemCalls( intptr_t *args ) {
 		return Sys_Milliseconds();
 	case CG_CVAR_REGISTER:
 		Cvar_Register( VMA(1), VMA(2), VMA(3), args[4] ); 
+		Cvar_Track( CVAR_TRACK_CGAME, VMA(1) );
 		return 0;
 	case CG_CVAR_UPDATE:
 		Cvar_Update( VMA(1) );
 		return 0;
+	case CG_CVAR_UPDATE_CHANGED:
+		return Cvar_UpdateTracked( CVAR_TRACK_CGAME );
 	case CG_CVAR_SET:
 		Cvar_SetSafe( VMA(1), VMA(2) );
 		return 0;
@@ -450,6 +560,8 @@ intptr_t CL_CgameSystemCalls( intptr_t *args ) {
 		return 0;
 	case CG_FS_SEEK:
 		return FS_Seek( args[1], args[2], args[3] );
+	case CG_GET_NATIVE_TRAPS:
+		return VM_IsNative( cgvm ) ? (intptr_t)&cl_nativeTraps : 0;
 	case CG_SENDCONSOLECOMMAND:
 		Cbuf_AddText( VMA(1) );
 		return 0;
@@ -488,6 +600,12 @@ intptr_t CL_CgameSystemCalls( intptr_t *args ) {
 	case CG_CM_BOXTRACE:
 		CM_BoxTrace( VMA(1), VMA(2), VMA(3), VMA(4), VMA(5), args[6], args[7], /*int capsule*/ qfalse );
 		return 0;
+	case CG_CM_BOXTRACEBATCH:
+		CL_CM_BoxTraceBatch( VMA(1), VMA(2), args[3], args[4], args[5] );
+		return 0;
+	case CG_R_DRAWSTRETCHPICS:
+		re.DrawStretchPics( args[1], VMA(2) );
+		return 0;
 	case CG_CM_CAPSULETRACE:
 		CM_BoxTrace( VMA(1), VMA(2), VMA(3), VMA(4), VMA(5), args[6], args[7], /*int capsule*/ qtrue );
 		return 0;
@@ -529,7 +647,10 @@ intptr_t CL_CgameSystemCalls( intptr_t *args ) {
 		S_StartBackgroundTrack( VMA(1), VMA(2) );
 		return 0;
 	case CG_R_LOADWORLDMAP:
-		re.LoadWorld( VMA(1) );
+		// still loaded when CL_RestartCGame starts the cgame over
+		if ( !cgameKeepWorld ) {
+			re.LoadWorld( VMA(1) );
+		}
 		return 0; 
 	case CG_R_REGISTERMODEL:
 		return re.RegisterModel( VMA(1) );
@@ -733,9 +854,13 @@ void CL_InitCGame( void ) {
 			interpret = VMI_COMPILED;
 	}
 
-	cgvm = VM_Create( "cgame", CL_CgameSystemCalls, interpret );
+	// CL_RestartCGame has reloaded it already
 	if ( !cgvm ) {
-		Com_Error( ERR_DROP, "VM_Create on cgame failed" );
+		Cvar_ClearTracked( CVAR_TRACK_CGAME );
+		cgvm = VM_Create( "cgame", CL_CgameSystemCalls, interpret );
+		if ( !cgvm ) {
+			Com_Error( ERR_DROP, "VM_Create on cgame failed" );
+		}
 	}
 	clc.state = CA_LOADING;
 
@@ -770,6 +895,31 @@ void CL_InitCGame( void ) {
 }
 
 
+/*
+====================
+CL_RestartCGame
+
+Starts the cgame over on the current snapshot, for demo_seek. The VM is
+reloaded in place like the game's on a map_restart, and the world and
+media it registers are still loaded.
+====================
+*/
+void CL_RestartCGame( void ) {
+	Key_SetCatcher( Key_GetCatcher( ) & ~KEYCATCH_CGAME );
+
+	VM_Call( cgvm, CG_SHUTDOWN );
+	Cvar_ClearTracked( CVAR_TRACK_CGAME );
+
+	cgvm = VM_Restart( cgvm, qtrue );
+	if ( !cgvm ) {
+		Com_Error( ERR_DROP, "VM_Restart on cgame failed" );
+	}
+
+	cgameKeepWorld = qtrue;
+	CL_InitCGame();
+	cgameKeepWorld = qfalse;
+}
+
 /*
 ====================
 CL_GameCommand
@@ -793,8 +943,12 @@ CL_CGameRendering
 =====================
 */
 void CL_CGameRendering( stereoFrame_t stereo ) {
+	int64_t	start;
+
+	start = Sys_Microseconds();
 	VM_Call( cgvm, CG_DRAW_ACTIVE_FRAME, cl.serverTime, stereo, clc.demoplaying );
 	VM_Debug( 0 );
+	CL_BenchmarkTime( BENCH_CGAME, Sys_Microseconds() - start );
 }
 
 
@@ -820,6 +974,47 @@ or bursted delayed packets.
 
 #define	RESET_TIME	500
 
+/*
+=================
+CL_AdjustJitterDelay
+
+Tracks how irregularly snapshots arrive, the same way RTP estimates
+interarrival jitter, and sizes the extra interpolation delay to cover it.
+The delay grows quickly when arrivals get bursty and shrinks by a msec
+per snapshot, so a stable connection settles back to no added latency.
+=================
+*/
+static void CL_AdjustJitterDelay( int newDelta ) {
+	int		deviation;
+	int		target;
+
+	if ( cl.lastSnapMessageNum ) {
+		if ( cl.snap.messageNum - cl.lastSnapMessageNum > 1 ) {
+			cl.droppedSnapshots += cl.snap.messageNum - cl.lastSnapMessageNum - 1;
+		}
+		deviation = abs( newDelta - cl.lastSnapTransit );
+		cl.snapJitter += deviation - ( ( cl.snapJitter + 8 ) >> 4 );
+	}
+	cl.lastSnapMessageNum = cl.snap.messageNum;
+	cl.lastSnapTransit = newDelta;
+
+	if ( !cl_jitterBuffer->integer ) {
+		cl.jitterDelay = 0;
+		return;
+	}
+
+	target = ( cl.snapJitter >> 4 ) * 2;
+	if ( target > cl_jitterBufferMax->integer ) {
+		target = cl_jitterBufferMax->integer;
+	}
+
+	if ( target > cl.jitterDelay ) {
+		cl.jitterDelay += ( target - cl.jitterDelay + 1 ) >> 1;
+	} else if ( target < cl.jitterDelay ) {
+		cl.jitterDelay--;
+	}
+}
+
 void CL_AdjustTimeDelta( void ) {
 	int		newDelta;
 	int		deltaDelta;
@@ -834,10 +1029,14 @@ void CL_AdjustTimeDelta( void ) {
 	newDelta = cl.snap.serverTime - cls.realtime;
 	deltaDelta = abs( newDelta - cl.serverTimeDelta );
 
+	CL_AdjustJitterDelay( newDelta );
+
 	if ( deltaDelta > RESET_TIME ) {
 		cl.serverTimeDelta = newDelta;
 		cl.oldServerTime = cl.snap.serverTime;	// FIXME: is this a problem for cgame?
 		cl.serverTime = cl.snap.serverTime;
+		cl.snapJitter = 0;
+		cl.jitterDelay = 0;
 		if ( cl_showTimeDelta->integer ) {
 			Com_Printf( "<RESET> " );
 		}
@@ -865,7 +1064,11 @@ void CL_AdjustTimeDelta( void ) {
 	}
 
 	if ( cl_showTimeDelta->integer ) {
-		Com_Printf( "%i ", cl.serverTimeDelta );
+		if ( cl.jitterDelay ) {
+			Com_Printf( "%i(+%i) ", cl.serverTimeDelta, cl.jitterDelay );
+		} else {
+			Com_Printf( "%i ", cl.serverTimeDelta );
+		}
 	}
 }
 
@@ -916,16 +1119,14 @@ void CL_FirstSnapshot( void ) {
 			return;
 		}
 
+		// decoders are made by the VoIP worker when someone first talks
 		for (i = 0; i < MAX_CLIENTS; i++) {
-			clc.opusDecoder[i] = opus_decoder_create(48000, 1, &error);
-			if ( error ) {
-				Com_DPrintf("VoIP: Error opus_decoder_create(%d) %d\n", i, error);
-				return;
-			}
+			clc.opusDecoder[i] = NULL;
 			clc.voipIgnore[i] = qfalse;
 			clc.voipGain[i] = 1.0f;
 		}
 		clc.voipCodecInitialized = qtrue;
+		CL_VoipStartWorker();
 		clc.voipMuteAll = qfalse;
 		Cmd_AddCommand ("voip", CL_Voip_f);
 		Cvar_Set("cl_voipSendTarget", "spatial");
@@ -998,7 +1199,9 @@ void CL_SetCGameTime( void ) {
 			tn = 30;
 		}
 
-		cl.serverTime = cls.realtime + cl.serverTimeDelta - tn;
+		// the jitter buffer holds time back far enough that a late
+		// snapshot still lands before the cgame needs it
+		cl.serverTime = cls.realtime + cl.serverTimeDelta - tn - cl.jitterDelay;
 
 		// guarantee that time will never flow backwards, even if
 		// serverTimeDelta made an adjustment or cl_timeNudge was changed
@@ -1007,6 +1210,12 @@ void CL_SetCGameTime( void ) {
 		}
 		cl.oldServerTime = cl.serverTime;
 
+		// the cgame will have to extrapolate past the newest snapshot
+		if ( cl.serverTime > cl.snap.serverTime && cl.lastLateMessageNum != cl.snap.messageNum ) {
+			cl.lastLateMessageNum = cl.snap.messageNum;
+			cl.lateSnapshots++;
+		}
+
 		// note if we are almost past the latest frame (without timeNudge),
 		// so we will try and adjust back a bit when the next snapshot arrives
 		if ( cls.realtime + cl.serverTimeDelta >= cl.snap.serverTime - 5 ) {
@@ -1065,6 +1274,8 @@ void CL_SetCGameTime( void ) {
 
 		clc.timeDemoFrames++;
 		cl.serverTime = clc.timeDemoBaseTime + clc.timeDemoFrames * 50;
+
+		CL_BenchmarkFrame();
 	}
 
 	while ( cl.serverTime >= cl.snap.serverTime ) {
@@ -34,6 +34,14 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "client.h"
 #include "snd_local.h"
 
+#if idx64 || defined( __SSE2__ )
+#include <emmintrin.h>
+#define CIN_SSE2
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#include <arm_neon.h>
+#define CIN_NEON
+#endif
+
 #define MAXSIZE				8
 #define MINSIZE				4
 
@@ -1508,6 +1516,70 @@ void CIN_SetLooping(int handle, qboolean loop) {
 	cinTable[handle].looping = loop;
 }
 
+/*
+==================
+CIN_HalveLine
+
+Averages each 2x2, or with rows == 1 each 2x1, block of RGBA pixels
+in a 512 pixel line (and the one after it) into 256 pixels
+==================
+*/
+static void CIN_HalveLine( const byte *in, byte *out, int rows ) {
+	int		ix, ic;
+	const byte	*in2;
+
+	// the same line twice averages to it
+	in2 = ( rows == 2 ) ? in + 2048 : in;
+	ix = 0;
+
+#if defined( CIN_SSE2 )
+	{
+		const __m128i	zero = _mm_setzero_si128();
+
+		// four pixels out of eight across
+		for ( ; ix < 2048; ix += 32 ) {
+			__m128i a0 = _mm_loadu_si128( (const __m128i *)( in + ix ) );
+			__m128i a1 = _mm_loadu_si128( (const __m128i *)( in + ix + 16 ) );
+			__m128i b0 = _mm_loadu_si128( (const __m128i *)( in2 + ix ) );
+			__m128i b1 = _mm_loadu_si128( (const __m128i *)( in2 + ix + 16 ) );
+
+			// column sums of pixels 0-1, 2-3, 4-5 and 6-7
+			__m128i s0 = _mm_add_epi16( _mm_unpacklo_epi8( a0, zero ), _mm_unpacklo_epi8( b0, zero ) );
+			__m128i s1 = _mm_add_epi16( _mm_unpackhi_epi8( a0, zero ), _mm_unpackhi_epi8( b0, zero ) );
+			__m128i s2 = _mm_add_epi16( _mm_unpacklo_epi8( a1, zero ), _mm_unpacklo_epi8( b1, zero ) );
+			__m128i s3 = _mm_add_epi16( _mm_unpackhi_epi8( a1, zero ), _mm_unpackhi_epi8( b1, zero ) );
+
+			// then each pixel with its neighbour
+			s0 = _mm_add_epi16( s0, _mm_srli_si128( s0, 8 ) );
+			s1 = _mm_add_epi16( s1, _mm_srli_si128( s1, 8 ) );
+			s2 = _mm_add_epi16( s2, _mm_srli_si128( s2, 8 ) );
+			s3 = _mm_add_epi16( s3, _mm_srli_si128( s3, 8 ) );
+
+			s0 = _mm_srli_epi16( _mm_unpacklo_epi64( s0, s1 ), 2 );
+			s2 = _mm_srli_epi16( _mm_unpacklo_epi64( s2, s3 ), 2 );
+
+			_mm_storeu_si128( (__m128i *)( out + ix / 2 ), _mm_packus_epi16( s0, s2 ) );
+		}
+	}
+#elif defined( CIN_NEON )
+	// two pixels out of four across
+	for ( ; ix < 2048; ix += 16 ) {
+		uint16x8_t s0 = vaddl_u8( vld1_u8( in + ix ), vld1_u8( in2 + ix ) );
+		uint16x8_t s1 = vaddl_u8( vld1_u8( in + ix + 8 ), vld1_u8( in2 + ix + 8 ) );
+		uint16x4_t p0 = vadd_u16( vget_low_u16( s0 ), vget_high_u16( s0 ) );
+		uint16x4_t p1 = vadd_u16( vget_low_u16( s1 ), vget_high_u16( s1 ) );
+
+		vst1_u8( out + ix / 2, vmovn_u16( vshrq_n_u16( vcombine_u16( p0, p1 ), 2 ) ) );
+	}
+#endif
+
+	for ( ; ix < 2048; ix += 8 ) {
+		for ( ic = ix; ic < ix + 4; ic++ ) {
+			out[ix / 2 + ic - ix] = ( in[ic] + in[4 + ic] + in2[ic] + in2[4 + ic] ) >> 2;
+		}
+	}
+}
+
 /*
 ==================
 CIN_ResampleCinematic
@@ -1530,34 +1602,12 @@ void CIN_ResampleCinematic(int handle, int *buf2) {
 
 	buf3 = (int*)buf;
 	if (xm==2 && ym==2) {
-		byte *bc2, *bc3;
-		int	ic, iiy;
-
-		bc2 = (byte *)buf2;
-		bc3 = (byte *)buf3;
 		for (iy = 0; iy<256; iy++) {
-			iiy = iy<<12;
-			for (ix = 0; ix<2048; ix+=8) {
-				for(ic = ix;ic<(ix+4);ic++) {
-					*bc2=(bc3[iiy+ic]+bc3[iiy+4+ic]+bc3[iiy+2048+ic]+bc3[iiy+2048+4+ic])>>2;
-					bc2++;
-				}
-			}
+			CIN_HalveLine( buf + (iy<<12), (byte *)buf2 + (iy<<10), 2 );
 		}
 	} else if (xm==2 && ym==1) {
-		byte *bc2, *bc3;
-		int	ic, iiy;
-
-		bc2 = (byte *)buf2;
-		bc3 = (byte *)buf3;
 		for (iy = 0; iy<256; iy++) {
-			iiy = iy<<11;
-			for (ix = 0; ix<2048; ix+=8) {
-				for(ic = ix;ic<(ix+4);ic++) {
-					*bc2=(bc3[iiy+ic]+bc3[iiy+4+ic])>>1;
-					bc2++;
-				}
-			}
+			CIN_HalveLine( buf + (iy<<11), (byte *)buf2 + (iy<<10), 1 );
 		}
 	} else {
 		for (iy = 0; iy<256; iy++) {
@@ -1592,14 +1642,16 @@ void CIN_DrawCinematic (int handle) {
 
 	if (cinTable[handle].dirty && (cinTable[handle].CIN_WIDTH != cinTable[handle].drawX || cinTable[handle].CIN_HEIGHT != cinTable[handle].drawY)) {
 		int *buf2;
+		int mark;
 
-		buf2 = Hunk_AllocateTempMemory( 256*256*4 );
+		mark = Com_FrameMark();
+		buf2 = Com_FrameAlloc( 256*256*4 );
 
 		CIN_ResampleCinematic(handle, buf2);
 
 		re.DrawStretchRaw( x, y, w, h, 256, 256, (byte *)buf2, handle, qtrue);
 		cinTable[handle].dirty = qfalse;
-		Hunk_FreeTempMemory(buf2);
+		Com_FrameRelease(mark);
 		return;
 	}
 
@@ -1678,14 +1730,16 @@ void CIN_UploadCinematic(int handle) {
 		// Resample the video if needed
 		if (cinTable[handle].dirty && (cinTable[handle].CIN_WIDTH != cinTable[handle].drawX || cinTable[handle].CIN_HEIGHT != cinTable[handle].drawY))  {
 			int *buf2;
+			int mark;
 
-			buf2 = Hunk_AllocateTempMemory( 256*256*4 );
+			mark = Com_FrameMark();
+			buf2 = Com_FrameAlloc( 256*256*4 );
 
 			CIN_ResampleCinematic(handle, buf2);
 
 			re.UploadCinematic( cinTable[handle].CIN_WIDTH, cinTable[handle].CIN_HEIGHT, 256, 256, (byte *)buf2, handle, qtrue);
 			cinTable[handle].dirty = qfalse;
-			Hunk_FreeTempMemory(buf2);
+			Com_FrameRelease(mark);
 		} else {
 			// Upload video at normal resolution
 			re.UploadCinematic( cinTable[handle].CIN_WIDTH, cinTable[handle].CIN_HEIGHT, cinTable[handle].drawX, cinTable[handle].drawY,
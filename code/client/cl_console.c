@@ -29,19 +29,48 @@ int g_console_field_width = DEFAULT_CONSOLE_WIDTH;
 int g_smallchar_width = SMALLCHAR_WIDTH;
 int g_smallchar_height = SMALLCHAR_HEIGHT;
 
-#define	NUM_CON_TIMES 17
+#define	NUM_CON_TIMES 17		// notify rows at most
+
+#define	CON_TEXTSIZE	32768	// characters to start with, doubled as needed
+#define	CON_LINESIZE	1024	// lines to start with, doubled as needed
+#define	CON_MAX_LINE	16384	// longer lines are broken
+#define	CON_LINE_CHARS	128		// characters allowed for each con_scrollback line
+
+#define	CON_CHAR(n)		con.text[(n) % con.textSize]
+#define	CON_LINE(n)		(&con.lines[(n) % con.lineSize])
+
+// the text is kept as printed, a line for each newline, and only
+// wrapped to the console width as it is drawn
+typedef struct {
+	int		start;			// in con.text, counting every character printed
+	int		length;
+	int		time;			// cls.realtime it was printed, 0 to keep it off
+							// the notify lines
+	int		rows;			// when wrapped at rowsWidth
+	int		rowsWidth;
+} conLine_t;
+
+typedef struct {
+	stretchPic_t	*pics;
+	int				numPics;
+	int				maxPics;
+} conPics_t;
 
-#define		CON_TEXTSIZE	32768
 typedef struct {
 	qboolean	initialized;
 
-	short	text[CON_TEXTSIZE];
-	int		current;		// line where next message will be printed
-	int		x;				// offset in current line for next print
-	int		display;		// bottom of console displays this line
+	short		*text;			// ring of textSize characters
+	int			textSize;
+	int			textEnd;		// characters ever printed
+	conLine_t	*lines;			// ring of lineSize lines
+	int			lineSize;
+	int			firstLine;		// oldest line still kept
+	int			current;		// line where next message will be printed
+	int			x;				// offset in current line for next print
+	int			display;		// bottom of console displays this line
+	int			displayRow;		// and this row of it, counting up from its last
 
 	int 	linewidth;		// characters across screen
-	int		totallines;		// total lines in console scrollback
 
 	float	xadjust;		// for wide aspect screens
 
@@ -50,18 +79,24 @@ typedef struct {
 
 	int		vislines;		// in scanlines
 
-	int		times[NUM_CON_TIMES];	// cls.realtime time the line was generated
-								// for transparent notify lines
 	vec4_t	color;
+
+	conPics_t	textPics;		// the scrollback as drawn last frame
+	int			textPicsKey[6];	// what it was drawn from
+	conPics_t	notifyPics;
+	int			generation;		// bumped whenever the text changes
 } console_t;
 
 console_t	con;
 
+static int	conRowStarts[CON_MAX_LINE + 1];
+
 cvar_t		*con_conspeed;
 cvar_t		*con_autoclear;
 cvar_t		*con_notifytime;
 cvar_t		*con_notifylines;
 cvar_t		*con_scale;
+cvar_t		*con_scrollback;
 
 
 
@@ -157,17 +192,137 @@ void Con_MessageMode4_f (void) {
 	Key_SetCatcher( Key_GetCatcher( ) ^ KEYCATCH_MESSAGE );
 }
 
+/*
+================
+Con_MaxLines
+================
+*/
+static int Con_MaxLines( void ) {
+	// printing starts before Con_Init
+	return con_scrollback ? con_scrollback->integer : CON_LINESIZE * 16;
+}
+
+/*
+================
+Con_GrowText
+================
+*/
+static qboolean Con_GrowText( void ) {
+	short	*text;
+	int		size, i;
+
+	size = con.textSize ? con.textSize * 2 : CON_TEXTSIZE;
+	text = malloc( size * sizeof( *text ) );
+	if ( !text ) {
+		return qfalse;
+	}
+
+	if ( con.text ) {
+		for ( i = CON_LINE( con.firstLine )->start; i < con.textEnd; i++ ) {
+			text[i % size] = CON_CHAR( i );
+		}
+		free( con.text );
+	}
+	con.text = text;
+	con.textSize = size;
+
+	return qtrue;
+}
+
+/*
+================
+Con_GrowLines
+================
+*/
+static qboolean Con_GrowLines( void ) {
+	conLine_t	*lines;
+	int			size, i;
+
+	size = con.lineSize ? con.lineSize * 2 : CON_LINESIZE;
+	lines = malloc( size * sizeof( *lines ) );
+	if ( !lines ) {
+		return qfalse;
+	}
+
+	if ( con.lines ) {
+		for ( i = con.firstLine; i <= con.current; i++ ) {
+			lines[i % size] = *CON_LINE( i );
+		}
+		free( con.lines );
+	}
+	con.lines = lines;
+	con.lineSize = size;
+
+	return qtrue;
+}
+
+/*
+================
+Con_DropLine
+
+Forgets the oldest line
+================
+*/
+static void Con_DropLine( void ) {
+	con.firstLine++;
+	if ( con.display < con.firstLine ) {
+		con.display = con.firstLine;
+		con.displayRow = 0;
+	}
+}
+
+/*
+================
+Con_StartLine
+================
+*/
+static void Con_StartLine( void ) {
+	conLine_t	*line;
+
+	line = CON_LINE( con.current );
+	line->start = con.textEnd;
+	line->length = 0;
+	line->time = 0;
+	line->rowsWidth = 0;
+	con.x = 0;
+}
+
+/*
+================
+Con_Setup
+================
+*/
+static void Con_Setup( void ) {
+	if ( con.initialized ) {
+		return;
+	}
+
+	con.color[0] = 
+	con.color[1] = 
+	con.color[2] =
+	con.color[3] = 1.0f;
+	con.linewidth = -1;
+	Con_CheckResize ();
+
+	if ( !Con_GrowText() || !Con_GrowLines() ) {
+		Sys_Error( "Con_Setup: out of memory" );
+	}
+	Con_StartLine();
+
+	con.initialized = qtrue;
+}
+
 /*
 ================
 Con_Clear_f
 ================
 */
 void Con_Clear_f (void) {
-	int		i;
+	Con_Setup();
 
-	for ( i = 0 ; i < CON_TEXTSIZE ; i++ ) {
-		con.text[i] = (ColorIndex(COLOR_WHITE)<<8) | ' ';
-	}
+	con.firstLine = con.current;
+	Con_StartLine();
+	con.generation++;
 
 	Con_Bottom();		// go to end
 }
@@ -183,7 +338,7 @@ Save the console contents out to a file
 void Con_Dump_f (void)
 {
 	int		l, x, i;
-	short	*line;
+	conLine_t	*line;
 	fileHandle_t	f;
 	int		bufferlen;
 	char	*buffer;
@@ -213,33 +368,37 @@ void Con_Dump_f (void)
 
 	Com_Printf ("Dumped console text to %s.\n", filename );
 
+	Con_Setup();
+
 	// skip empty lines
-	for (l = con.current - con.totallines + 1 ; l <= con.current ; l++)
+	for (l = con.firstLine ; l <= con.current ; l++)
 	{
-		line = con.text + (l%con.totallines)*con.linewidth;
-		for (x=0 ; x<con.linewidth ; x++)
-			if ((line[x] & 0xff) != ' ')
+		line = CON_LINE(l);
+		for (x=0 ; x<line->length ; x++)
+			if ((CON_CHAR(line->start + x) & 0xff) != ' ')
 				break;
-		if (x != con.linewidth)
+		if (x != line->length)
 			break;
 	}
 
 #ifdef _WIN32
-	bufferlen = con.linewidth + 3 * sizeof ( char );
+	bufferlen = CON_MAX_LINE + 3 * sizeof ( char );
 #else
-	bufferlen = con.linewidth + 2 * sizeof ( char );
+	bufferlen = CON_MAX_LINE + 2 * sizeof ( char );
 #endif
 
 	buffer = Hunk_AllocateTempMemory( bufferlen );
 
-	// write the remaining lines
-	buffer[bufferlen-1] = 0;
+	// write the remaining lines, whole rather than as wrapped on screen
 	for ( ; l <= con.current ; l++)
 	{
-		line = con.text + (l%con.totallines)*con.linewidth;
-		for(i=0; i<con.linewidth; i++)
-			buffer[i] = line[i] & 0xff;
-		for (x=con.linewidth-1 ; x>=0 ; x--)
+		line = CON_LINE(l);
+		if (l == con.current && !line->length)
+			break;
+		for(i=0; i<line->length; i++)
+			buffer[i] = CON_CHAR(line->start + i) & 0xff;
+		buffer[i] = 0;
+		for (x=line->length-1 ; x>=0 ; x--)
 		{
 			if (buffer[x] == ' ')
 				buffer[x] = 0;
@@ -266,9 +425,14 @@ Con_ClearNotify
 */
 void Con_ClearNotify( void ) {
 	int		i;
-	
-	for ( i = 0 ; i < NUM_CON_TIMES ; i++ ) {
-		con.times[i] = 0;
+
+	if ( !con.initialized ) {
+		return;
+	}
+
+	// no more than NUM_CON_TIMES lines can be showing
+	for ( i = MAX( con.firstLine, con.current - NUM_CON_TIMES ) ; i <= con.current ; i++ ) {
+		CON_LINE( i )->time = 0;
 	}
 }
 
@@ -278,13 +442,13 @@ void Con_ClearNotify( void ) {
 ================
 Con_CheckResize
 
-If the line width has changed, reformat the buffer.
+If the line width has changed, the lines are wrapped again as
+they are drawn
 ================
 */
 void Con_CheckResize (void)
 {
-	int		i, j, width, oldwidth, oldtotallines, numlines, numchars;
-	short	tbuf[CON_TEXTSIZE];
+	int		width;
 
 	if (con_scale != NULL)
 	{
@@ -313,55 +477,18 @@ void Con_CheckResize (void)
 
 	width = (cls.glconfig.vidWidth / g_smallchar_width) - 2;
 
-	if (width == con.linewidth)
-		return;
-
 	if (width < 1)			// video hasn't been initialized yet
-	{
 		width = DEFAULT_CONSOLE_WIDTH;
-		con.linewidth = width;
-		con.totallines = CON_TEXTSIZE / con.linewidth;
-		for(i=0; i<CON_TEXTSIZE; i++)
-
-			con.text[i] = (ColorIndex(COLOR_WHITE)<<8) | ' ';
-	}
-	else
-	{
-		oldwidth = con.linewidth;
-		con.linewidth = width;
-		oldtotallines = con.totallines;
-		con.totallines = CON_TEXTSIZE / con.linewidth;
-		numlines = oldtotallines;
 
-		if (con.totallines < numlines)
-			numlines = con.totallines;
-
-		numchars = oldwidth;
-	
-		if (con.linewidth < numchars)
-			numchars = con.linewidth;
-
-		Com_Memcpy (tbuf, con.text, CON_TEXTSIZE * sizeof(short));
-		for(i=0; i<CON_TEXTSIZE; i++)
-
-			con.text[i] = (ColorIndex(COLOR_WHITE)<<8) | ' ';
-
-
-		for (i=0 ; i<numlines ; i++)
-		{
-			for (j=0 ; j<numchars ; j++)
-			{
-				con.text[(con.totallines - 1 - i) * con.linewidth + j] =
-						tbuf[((con.current - i + oldtotallines) %
-							  oldtotallines) * oldwidth + j];
-			}
-		}
+	if (width == con.linewidth)
+		return;
 
+	if (con.linewidth > 0)
 		Con_ClearNotify ();
-	}
 
-	con.current = con.totallines - 1;
-	con.display = con.current;
+	con.linewidth = width;
+	con.displayRow = 0;
+	con.generation++;
 }
 
 /*
@@ -391,6 +518,9 @@ void Con_Init (void) {
 	con_autoclear = Cvar_Get("con_autoclear", "1", CVAR_ARCHIVE);
 	con_scale = Cvar_Get("con_scale", "1", CVAR_ARCHIVE);
 	Cvar_CheckRange(con_scale, 1.0f, 4.0f, qfalse);
+	con_scrollback = Cvar_Get("con_scrollback", "16384", CVAR_ARCHIVE);
+	Cvar_CheckRange(con_scrollback, CON_LINESIZE, 1 << 20, qtrue);
+	Cvar_SetDescription(con_scrollback, "Lines of console text kept to scroll back through, the buffer grows up to it as text arrives.");
 
 	Field_Clear( &g_consoleField );
 	g_consoleField.widthInChars = g_console_field_width;
@@ -435,40 +565,74 @@ Con_Linefeed
 */
 void Con_Linefeed (qboolean skipnotify)
 {
-	int		i;
+	qboolean	bottom;
 
 	// mark time for transparent overlay
-	if (con.current >= 0)
-	{
-    if (skipnotify)
-		  con.times[con.current % NUM_CON_TIMES] = 0;
-    else
-		  con.times[con.current % NUM_CON_TIMES] = cls.realtime;
+	CON_LINE(con.current)->time = skipnotify ? 0 : cls.realtime;
+
+	bottom = ( con.display == con.current && con.displayRow == 0 );
+
+	if ( con.current + 1 - con.firstLine >= MIN( con.lineSize, Con_MaxLines() ) ) {
+		if ( con.lineSize >= Con_MaxLines() || !Con_GrowLines() ) {
+			Con_DropLine();
+		}
 	}
 
-	con.x = 0;
-	if (con.display == con.current)
-		con.display++;
 	con.current++;
-	for(i=0; i<con.linewidth; i++)
-		con.text[(con.current%con.totallines)*con.linewidth+i] = (ColorIndex(COLOR_WHITE)<<8) | ' ';
+	Con_StartLine();
+	con.generation++;
+
+	if (bottom)
+		con.display = con.current;
+}
+
+/*
+===============
+Con_PutChar
+===============
+*/
+static void Con_PutChar( short ch, qboolean skipnotify ) {
+	conLine_t	*line;
+
+	line = CON_LINE(con.current);
+
+	if ( con.x == line->length ) {
+		if ( line->length == CON_MAX_LINE ) {
+			Con_Linefeed( skipnotify );
+			line = CON_LINE(con.current);
+		}
+
+		// the current line is shorter than the text, so there is room
+		// once the older lines are gone
+		while ( con.textEnd + 1 - CON_LINE(con.firstLine)->start > con.textSize ) {
+			if ( con.textSize >= Con_MaxLines() * CON_LINE_CHARS || !Con_GrowText() ) {
+				Con_DropLine();
+			}
+		}
+
+		line->length++;
+		con.textEnd++;
+	}
+
+	CON_CHAR(line->start + con.x) = ch;
+	con.x++;
+	line->rowsWidth = 0;
+	con.generation++;
 }
 
 /*
 ================
 CL_ConsolePrint
 
-Handles cursor positioning, line wrapping, etc
+Handles cursor positioning, etc
 All console printing must go through this in order to be logged to disk
 If no console is visible, the text will appear at the top of the game window
 ================
 */
 void CL_ConsolePrint( char *txt ) {
-	int		y, l;
 	unsigned char	c;
 	unsigned short	color;
 	qboolean skipnotify = qfalse;		// NERVE - SMF
-	int prev;							// NERVE - SMF
 
 	// TTimo - prefix for text that shows up in console but not in notify
 	// backported from RTCW
@@ -482,15 +646,7 @@ void CL_ConsolePrint( char *txt ) {
 		return;
 	}
 	
-	if (!con.initialized) {
-		con.color[0] = 
-		con.color[1] = 
-		con.color[2] =
-		con.color[3] = 1.0f;
-		con.linewidth = -1;
-		Con_CheckResize ();
-		con.initialized = qtrue;
-	}
+	Con_Setup();
 
 	color = ColorIndex(COLOR_WHITE);
 
@@ -501,20 +657,6 @@ void CL_ConsolePrint( char *txt ) {
 			continue;
 		}
 
-		// count word length
-		for (l=0 ; l< con.linewidth ; l++) {
-			if ( txt[l] <= ' ') {
-				break;
-			}
-
-		}
-
-		// word wrap
-		if (l != con.linewidth && (con.x + l >= con.linewidth) ) {
-			Con_Linefeed(skipnotify);
-
-		}
-
 		txt++;
 
 		switch (c)
@@ -526,28 +668,15 @@ void CL_ConsolePrint( char *txt ) {
 			con.x = 0;
 			break;
 		default:	// display character and advance
-			y = con.current % con.totallines;
-			con.text[y*con.linewidth+con.x] = (color << 8) | c;
-			con.x++;
-			if(con.x >= con.linewidth)
-				Con_Linefeed(skipnotify);
+			Con_PutChar( (color << 8) | c, skipnotify );
 			break;
 		}
 	}
 
-
 	// mark time for transparent overlay
-	if (con.current >= 0) {
-		// NERVE - SMF
-		if ( skipnotify ) {
-			prev = con.current % NUM_CON_TIMES - 1;
-			if ( prev < 0 )
-				prev = NUM_CON_TIMES - 1;
-			con.times[prev] = 0;
-		}
-		else
-		// -NERVE - SMF
-			con.times[con.current % NUM_CON_TIMES] = cls.realtime;
+	// NERVE - SMF
+	if ( !skipnotify ) {
+		CON_LINE(con.current)->time = cls.realtime;
 	}
 }
 
@@ -561,6 +690,132 @@ DRAWING
 */
 
 
+/*
+================
+Con_WrapLine
+
+Word wraps a line at width, the way it used to be wrapped as it was
+printed. Returns the number of rows, the first maxRows of which get
+where they start in rowStarts.
+================
+*/
+static int Con_WrapLine( const conLine_t *line, int width, int *rowStarts, int maxRows ) {
+	int		i, l, col, rows;
+
+	if ( maxRows > 0 ) {
+		rowStarts[0] = 0;
+	}
+	rows = 1;
+	col = 0;
+
+	for ( i = 0 ; i < line->length ; i++ ) {
+		// a word that doesn't fit goes on the next row, unless
+		// it wouldn't fit on any
+		if ( col > 0 && ( CON_CHAR( line->start + i ) & 0xff ) > ' '
+			&& ( i == 0 || ( CON_CHAR( line->start + i - 1 ) & 0xff ) <= ' ' ) ) {
+			for ( l = 1 ; l < width && i + l < line->length ; l++ ) {
+				if ( ( CON_CHAR( line->start + i + l ) & 0xff ) <= ' ' ) {
+					break;
+				}
+			}
+			if ( l < width && col + l > width ) {
+				col = width;
+			}
+		}
+
+		if ( col == width ) {
+			if ( rows < maxRows ) {
+				rowStarts[rows] = i;
+			}
+			rows++;
+			col = 0;
+		}
+		col++;
+	}
+
+	return rows;
+}
+
+/*
+================
+Con_LineRows
+================
+*/
+static int Con_LineRows( int n ) {
+	conLine_t	*line;
+
+	line = CON_LINE( n );
+
+	// nothing printed on it yet
+	if ( n == con.current && !line->length ) {
+		return 0;
+	}
+
+	if ( line->rowsWidth != con.linewidth ) {
+		line->rows = Con_WrapLine( line, con.linewidth, NULL, 0 );
+		line->rowsWidth = con.linewidth;
+	}
+
+	return line->rows;
+}
+
+/*
+================
+Con_AddPic
+================
+*/
+static void Con_AddPic( conPics_t *pics, int x, int y, int ch ) {
+	stretchPic_t	*pic;
+
+	if ( pics->numPics == pics->maxPics ) {
+		pic = realloc( pics->pics, ( pics->maxPics + 1024 ) * sizeof( *pic ) );
+		if ( !pic ) {
+			return;
+		}
+		pics->pics = pic;
+		pics->maxPics += 1024;
+	}
+
+	pic = &pics->pics[pics->numPics];
+	if ( !SCR_SmallCharPic( x, y, ch & 0xff, pic ) ) {
+		return;
+	}
+	Vector4Copy( g_color_table[ColorIndexForNumber( ch >> 8 )], pic->color );
+	pics->numPics++;
+}
+
+/*
+================
+Con_AddLinePics
+
+Queues the rows of line n from the bottom up, skipping the last
+skipRows and stopping after maxRows, the lowest at y. Returns the
+rows queued.
+================
+*/
+static int Con_AddLinePics( conPics_t *pics, int x, int y, int n, int skipRows, int maxRows ) {
+	conLine_t	*line;
+	int			rows, row, end, count, i;
+
+	line = CON_LINE( n );
+	if ( n == con.current && !line->length ) {
+		return 0;
+	}
+
+	rows = Con_WrapLine( line, con.linewidth, conRowStarts, ARRAY_LEN( conRowStarts ) );
+
+	count = 0;
+	for ( row = rows - 1 - skipRows ; row >= 0 && count < maxRows ; row--, count++ ) {
+		end = ( row + 1 < rows ) ? conRowStarts[row + 1] : line->length;
+		for ( i = conRowStarts[row] ; i < end ; i++ ) {
+			Con_AddPic( pics, x + ( i - conRowStarts[row] + 1 ) * g_smallchar_width,
+				y - count * g_smallchar_height, CON_CHAR( line->start + i ) );
+		}
+	}
+
+	return count;
+}
+
 /*
 ================
 Con_DrawInput
@@ -595,49 +850,42 @@ Draws the last few lines of output transparently over the game top
 */
 void Con_DrawNotify (void)
 {
-	int		x, v;
-	short	*text;
-	int		i;
+	conLine_t	*line;
+	int		v;
+	int		i, rows, count;
 	int		time;
 	int		skip;
-	int		currentColor;
-
-	currentColor = 7;
-	re.SetColor( g_color_table[currentColor] );
 
 	v = 0;
-	for (i= con.current-con_notifylines->integer ; i<=con.current ; i++)
-	{
-		int linelength = 0;
-
-		if (i < 0)
-			continue;
-		time = con.times[i % NUM_CON_TIMES];
-		if (time == 0)
-			continue;
-		time = cls.realtime - time;
-		if (time > con_notifytime->value*1000)
-			continue;
-		text = con.text + (i % con.totallines)*con.linewidth;
+	con.notifyPics.numPics = 0;
 
-		if (cl.snap.ps.pm_type != PM_INTERMISSION && Key_GetCatcher( ) & (KEYCATCH_UI | KEYCATCH_CGAME) ) {
-			continue;
+	if (con.initialized && (cl.snap.ps.pm_type == PM_INTERMISSION || !(Key_GetCatcher( ) & (KEYCATCH_UI | KEYCATCH_CGAME))))
+	{
+		// how many rows, then queue them from the bottom up
+		rows = 0;
+		for (i = con.current ; i >= con.firstLine && i >= con.current - NUM_CON_TIMES && rows < con_notifylines->integer ; i--)
+		{
+			line = CON_LINE(i);
+			time = line->time;
+			if (time == 0 || cls.realtime - time > con_notifytime->value*1000)
+				continue;
+			rows += MIN( Con_LineRows( i ), con_notifylines->integer - rows );
 		}
 
-		for (x = 0 ; x < con.linewidth ; x++) {
-			if ( ( text[x] & 0xff ) == ' ' ) {
+		v = rows * g_smallchar_height;
+		for (i = con.current ; rows > 0 ; i--)
+		{
+			line = CON_LINE(i);
+			time = line->time;
+			if (time == 0 || cls.realtime - time > con_notifytime->value*1000)
 				continue;
-			}
-			if ( ColorIndexForNumber( text[x]>>8 ) != currentColor ) {
-				currentColor = ColorIndexForNumber( text[x]>>8 );
-				re.SetColor( g_color_table[currentColor] );
-			}
-			SCR_DrawSmallChar( cl_conXOffset->integer + con.xadjust + (x+1)*g_smallchar_width, v, text[x] & 0xff );
-			linelength++;
+			count = Con_AddLinePics( &con.notifyPics, cl_conXOffset->integer + con.xadjust,
+				( rows - 1 ) * g_smallchar_height, i, 0, rows );
+			rows -= count;
 		}
 
-		if (linelength > 0) {
-			v += g_smallchar_height;
+		if ( con.notifyPics.numPics ) {
+			re.DrawStretchPics( con.notifyPics.numPics, con.notifyPics.pics );
 		}
 	}
 
@@ -680,12 +928,11 @@ Draws the console with the solid background
 */
 void Con_DrawSolidConsole( float frac ) {
 	int				i, x, y;
-	int				rows;
-	short			*text;
-	int				row;
+	int				rows, count;
+	int				skip;
 	int				lines;
+	int				key[6];
 //	qhandle_t		conShader;
-	int				currentColor;
 	vec4_t			color;
 
 	lines = cls.glconfig.vidHeight * frac;
@@ -734,7 +981,7 @@ void Con_DrawSolidConsole( float frac ) {
 	y = lines - (g_smallchar_height*3);
 
 	// draw from the bottom up
-	if (con.display != con.current)
+	if (con.display != con.current || con.displayRow)
 	{
 	// draw arrows to show the buffer is backscrolled
 		re.SetColor( g_color_table[ColorIndex(COLOR_RED)] );
@@ -743,38 +990,30 @@ void Con_DrawSolidConsole( float frac ) {
 		y -= g_smallchar_height;
 		rows--;
 	}
-	
-	row = con.display;
-
-	if ( con.x == 0 ) {
-		row--;
-	}
 
-	currentColor = 7;
-	re.SetColor( g_color_table[currentColor] );
-
-	for (i=0 ; i<rows ; i++, y -= g_smallchar_height, row--)
-	{
-		if (row < 0)
-			break;
-		if (con.current - row >= con.totallines) {
-			// past scrollback wrap point
-			continue;	
+	// the text only has to be laid out again when something changed
+	key[0] = con.generation;
+	key[1] = con.display;
+	key[2] = con.displayRow;
+	key[3] = y;
+	key[4] = rows;
+	key[5] = con.xadjust;
+	if ( memcmp( key, con.textPicsKey, sizeof( key ) ) ) {
+		Com_Memcpy( con.textPicsKey, key, sizeof( key ) );
+		con.textPics.numPics = 0;
+
+		skip = con.displayRow;
+		for (i = con.display ; i >= con.firstLine && rows > 0 ; i--)
+		{
+			count = Con_AddLinePics( &con.textPics, con.xadjust, y, i, skip, rows );
+			y -= count * g_smallchar_height;
+			rows -= count;
+			skip = 0;
 		}
+	}
 
-		text = con.text + (row % con.totallines)*con.linewidth;
-
-		for (x=0 ; x<con.linewidth ; x++) {
-			if ( ( text[x] & 0xff ) == ' ' ) {
-				continue;
-			}
-
-			if ( ColorIndexForNumber( text[x]>>8 ) != currentColor ) {
-				currentColor = ColorIndexForNumber( text[x]>>8 );
-				re.SetColor( g_color_table[currentColor] );
-			}
-			SCR_DrawSmallChar(  con.xadjust + (x+1)*g_smallchar_width, y, text[x] & 0xff );
-		}
+	if ( con.textPics.numPics ) {
+		re.DrawStretchPics( con.textPics.numPics, con.textPics.pics );
 	}
 
 	// draw the input prompt, user text, and cursor if desired
@@ -846,29 +1085,54 @@ void Con_RunConsole (void) {
 }
 
 
-void Con_PageUp( void ) {
-	con.display -= 2;
-	if ( con.current - con.display >= con.totallines ) {
-		con.display = con.current - con.totallines + 1;
+/*
+================
+Con_Scroll
+
+Moves the bottom of the console up by rows, or down when negative
+================
+*/
+static void Con_Scroll( int rows ) {
+	if ( !con.initialized ) {
+		return;
 	}
+
+	con.displayRow += rows;
+
+	while ( con.displayRow >= Con_LineRows( con.display ) && con.display > con.firstLine ) {
+		con.displayRow -= Con_LineRows( con.display );
+		con.display--;
+	}
+	if ( con.displayRow >= Con_LineRows( con.display ) ) {
+		con.displayRow = MAX( Con_LineRows( con.display ) - 1, 0 );
+	}
+
+	while ( con.displayRow < 0 && con.display < con.current ) {
+		con.display++;
+		con.displayRow += Con_LineRows( con.display );
+	}
+	if ( con.displayRow < 0 ) {
+		con.displayRow = 0;
+	}
+}
+
+void Con_PageUp( void ) {
+	Con_Scroll( 2 );
 }
 
 void Con_PageDown( void ) {
-	con.display += 2;
-	if (con.display > con.current) {
-		con.display = con.current;
-	}
+	Con_Scroll( -2 );
 }
 
 void Con_Top( void ) {
-	con.display = con.totallines;
-	if ( con.current - con.display >= con.totallines ) {
-		con.display = con.current - con.totallines + 1;
-	}
+	con.display = con.firstLine;
+	con.displayRow = 0;
+	Con_Scroll( 1 << 30 );
 }
 
 void Con_Bottom( void ) {
 	con.display = con.current;
+	con.displayRow = 0;
 }
 
 
@@ -0,0 +1,311 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// cl_export.c -- demo_export, demos to json lines without playing them
+
+// Each demo is read as fast as the file allows and parsed with the normal
+// CL_ParseServerMessage, but nothing after that runs: no downloads, cgame,
+// renderer or sound. Every gamestate and every snapshot becomes one line of
+// exports/<demo>.jsonl, snapshots with their playerstate, entities and the
+// server commands that arrived with them. Configstring changes are applied
+// so the configstrings in later gamestate lines stay current, any other
+// command is only written out.
+//
+// With +set cl_headless 1 on the command line the client never opens a
+// window or starts sound, so a batch is one process per demo:
+//   ls demos | xargs -P 8 -I % ioquake3 +set cl_headless 1 +demo_export % +quit
+
+#include "client.h"
+
+typedef struct {
+	fileHandle_t	file;
+	int				snapshots;
+	int				gamestates;
+	int				lastCommand;	// server commands written so far
+} demoExport_t;
+
+static demoExport_t	demoExport;
+
+/*
+====================
+CL_ExportString
+
+Writes s as a json string
+====================
+*/
+static void CL_ExportString( const char *s ) {
+	char	buffer[1024];
+	int		len;
+
+	len = 0;
+	buffer[len++] = '"';
+	for ( ; *s; s++ ) {
+		// room for the longest escape and the closing quote
+		if ( len > sizeof( buffer ) - 8 ) {
+			FS_Write( buffer, len, demoExport.file );
+			len = 0;
+		}
+
+		if ( *s == '"' || *s == '\\' ) {
+			buffer[len++] = '\\';
+			buffer[len++] = *s;
+		} else if ( (byte)*s < ' ' ) {
+			len += Com_sprintf( buffer + len, 7, "\\u%04x", (byte)*s );
+		} else {
+			buffer[len++] = *s;
+		}
+	}
+	buffer[len++] = '"';
+	FS_Write( buffer, len, demoExport.file );
+}
+
+/*
+====================
+CL_ExportInts
+====================
+*/
+static void CL_ExportInts( const char *key, const int *values, int count ) {
+	int		i;
+
+	FS_Printf( demoExport.file, ",\"%s\":[", key );
+	for ( i = 0; i < count; i++ ) {
+		FS_Printf( demoExport.file, i ? ",%i" : "%i", values[i] );
+	}
+	FS_Write( "]", 1, demoExport.file );
+}
+
+/*
+====================
+CL_ExportVector
+====================
+*/
+static void CL_ExportVector( const char *key, const vec3_t v ) {
+	FS_Printf( demoExport.file, ",\"%s\":[%g,%g,%g]", key, v[0], v[1], v[2] );
+}
+
+/*
+====================
+CL_DemoExportGamestate
+
+Called by CL_ParseGamestate instead of loading the map
+====================
+*/
+void CL_DemoExportGamestate( void ) {
+	int		i, offset;
+
+	FS_Printf( demoExport.file, "{\"type\":\"gamestate\",\"serverCommandSequence\":%i,\"clientNum\":%i,\"configstrings\":{",
+		clc.serverCommandSequence, clc.clientNum );
+
+	offset = 0;
+	for ( i = 0; i < MAX_CONFIGSTRINGS; i++ ) {
+		if ( !cl.gameState.stringOffsets[i] ) {
+			continue;
+		}
+		FS_Printf( demoExport.file, offset++ ? ",\"%i\":" : "\"%i\":", i );
+		CL_ExportString( cl.gameState.stringData + cl.gameState.stringOffsets[i] );
+	}
+	FS_Write( "}}\n", 3, demoExport.file );
+
+	demoExport.lastCommand = clc.serverCommandSequence;
+	demoExport.gamestates++;
+}
+
+/*
+====================
+CL_DemoExportCommands
+
+The server commands since the last snapshot, configstring changes
+are applied on the way
+====================
+*/
+static void CL_DemoExportCommands( void ) {
+	const char	*s;
+	int			i;
+
+	FS_Write( ",\"commands\":[", 13, demoExport.file );
+	for ( i = demoExport.lastCommand + 1; i <= clc.serverCommandSequence; i++ ) {
+		// too far behind, the rest were cycled out
+		if ( clc.serverCommandSequence - i >= MAX_RELIABLE_COMMANDS ) {
+			continue;
+		}
+
+		s = clc.serverCommands[i & ( MAX_RELIABLE_COMMANDS - 1 )];
+		if ( i > demoExport.lastCommand + 1 ) {
+			FS_Write( ",", 1, demoExport.file );
+		}
+		CL_ExportString( s );
+
+		if ( !Q_strncmp( s, "cs ", 3 ) || !Q_strncmp( s, "csd ", 4 ) || !Q_strncmp( s, "bcs", 3 ) ) {
+			CL_GetServerCommand( i );
+		}
+	}
+	FS_Write( "]", 1, demoExport.file );
+
+	demoExport.lastCommand = clc.serverCommandSequence;
+	clc.lastExecutedServerCommand = clc.serverCommandSequence;
+}
+
+/*
+====================
+CL_DemoExportSnapshot
+====================
+*/
+static void CL_DemoExportSnapshot( void ) {
+	const playerState_t	*ps;
+	const entityState_t	*es;
+	int					i;
+
+	FS_Printf( demoExport.file, "{\"type\":\"snapshot\",\"messageNum\":%i,\"serverTime\":%i,\"snapFlags\":%i,\"ping\":%i",
+		cl.snap.messageNum, cl.snap.serverTime, cl.snap.snapFlags, cl.snap.ping );
+
+	ps = &cl.snap.ps;
+	FS_Printf( demoExport.file, ",\"ps\":{\"commandTime\":%i,\"pm_type\":%i,\"pm_flags\":%i,\"clientNum\":%i,"
+		"\"weapon\":%i,\"weaponstate\":%i,\"groundEntityNum\":%i,\"eFlags\":%i,\"viewheight\":%i",
+		ps->commandTime, ps->pm_type, ps->pm_flags, ps->clientNum,
+		ps->weapon, ps->weaponstate, ps->groundEntityNum, ps->eFlags, ps->viewheight );
+	CL_ExportVector( "origin", ps->origin );
+	CL_ExportVector( "velocity", ps->velocity );
+	CL_ExportVector( "viewangles", ps->viewangles );
+	CL_ExportInts( "stats", ps->stats, MAX_STATS );
+	CL_ExportInts( "persistant", ps->persistant, MAX_PERSISTANT );
+	FS_Write( "}", 1, demoExport.file );
+
+	FS_Write( ",\"entities\":[", 13, demoExport.file );
+	for ( i = 0; i < cl.snap.numEntities; i++ ) {
+		es = &cl.parseEntities[( cl.snap.parseEntitiesNum + i ) & ( MAX_PARSE_ENTITIES - 1 )];
+		FS_Printf( demoExport.file, "%s{\"number\":%i,\"eType\":%i,\"eFlags\":%i,\"clientNum\":%i,"
+			"\"groundEntityNum\":%i,\"weapon\":%i,\"event\":%i,\"eventParm\":%i,\"modelindex\":%i,"
+			"\"legsAnim\":%i,\"torsoAnim\":%i",
+			i ? "," : "", es->number, es->eType, es->eFlags, es->clientNum,
+			es->groundEntityNum, es->weapon, es->event, es->eventParm, es->modelindex,
+			es->legsAnim, es->torsoAnim );
+		CL_ExportVector( "pos", es->pos.trBase );
+		CL_ExportVector( "angles", es->apos.trBase );
+		FS_Write( "}", 1, demoExport.file );
+	}
+	FS_Write( "]", 1, demoExport.file );
+
+	CL_DemoExportCommands();
+	FS_Write( "}\n", 2, demoExport.file );
+
+	demoExport.snapshots++;
+}
+
+/*
+====================
+CL_DemoExport
+====================
+*/
+static void CL_DemoExport( const char *arg ) {
+	char		name[MAX_OSPATH];
+	char		demo[MAX_OSPATH];
+	msg_t		buf;
+	byte		bufData[MAX_MSGLEN];
+	int			protocol, start;
+
+	// an error dropped out of the last one
+	if ( demoExport.file ) {
+		FS_FCloseFile( demoExport.file );
+		demoExport.file = 0;
+	}
+
+	CL_Disconnect( qtrue );
+
+	protocol = CL_OpenDemoFile( arg, name, &clc.demofile );
+	if ( !clc.demofile ) {
+		Com_Printf( "demo_export: couldn't open %s\n", name );
+		return;
+	}
+
+	COM_StripExtension( COM_SkipPath( name ), demo, sizeof( demo ) );
+	Com_sprintf( name, sizeof( name ), "exports/%s.jsonl", demo );
+	Com_Memset( &demoExport, 0, sizeof( demoExport ) );
+	demoExport.file = FS_FOpenFileWrite_HomeData( name );
+	if ( !demoExport.file ) {
+		Com_Printf( "demo_export: couldn't write %s\n", name );
+		CL_Disconnect( qtrue );
+		return;
+	}
+
+	Q_strncpyz( clc.demoName, arg, sizeof( clc.demoName ) );
+	Q_strncpyz( clc.servername, arg, sizeof( clc.servername ) );
+	clc.state = CA_CONNECTED;
+	clc.demoplaying = qtrue;
+	clc.demoExporting = qtrue;
+
+#ifdef LEGACY_PROTOCOL
+	clc.compat = ( protocol <= com_legacyprotocol->integer );
+#else
+	(void)protocol;
+#endif
+
+	start = Sys_Milliseconds();
+
+	MSG_Init( &buf, bufData, sizeof( bufData ) );
+	while ( CL_ReadDemoFileMessage( &buf ) ) {
+		CL_ParseServerMessage( &buf );
+
+		if ( cl.snap.valid && cl.snap.messageNum == clc.serverMessageSequence ) {
+			CL_DemoExportSnapshot();
+		}
+	}
+
+	FS_FCloseFile( demoExport.file );
+	demoExport.file = 0;
+
+	Com_Printf( "demo_export: %s, %i gamestates and %i snapshots in %.2f seconds\n",
+		name, demoExport.gamestates, demoExport.snapshots, ( Sys_Milliseconds() - start ) / 1000.0f );
+
+	CL_Disconnect( qtrue );
+}
+
+/*
+====================
+CL_DemoExport_f
+
+demo_export <demoname> [demoname ...]
+====================
+*/
+void CL_DemoExport_f( void ) {
+	char	(*demos)[MAX_OSPATH];
+	int		count, i;
+
+	if ( Cmd_Argc() < 2 ) {
+		Com_Printf( "usage: demo_export <demoname> [demoname ...]\n" );
+		return;
+	}
+
+	// parsing retokenizes the command line
+	count = Cmd_Argc() - 1;
+	demos = Z_Malloc( count * sizeof( *demos ) );
+	for ( i = 0; i < count; i++ ) {
+		Q_strncpyz( demos[i], Cmd_Argv( i + 1 ), sizeof( demos[i] ) );
+	}
+
+	// make sure a local server is killed
+	Cvar_Set( "sv_killserver", "2" );
+
+	for ( i = 0; i < count; i++ ) {
+		CL_DemoExport( demos[i] );
+	}
+
+	Z_Free( demos );
+}
@@ -25,10 +25,29 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "../qcommon/q_shared.h"
 
+#define	MAX_HTTP_DOWNLOADS	64
+
+typedef struct {
+	char			url[MAX_OSPATH];
+	char			localName[MAX_OSPATH];
+	char			tempName[MAX_OSPATH];
+	fileHandle_t	file;
+	int				resumeFrom;		// bytes already in tempName
+	int				size;			// of the whole file, once known
+	int				count;
+	qboolean		started;
+	qboolean		finished;
+} httpDownload_t;
+
 qboolean CL_HTTP_Init( void );
 qboolean CL_HTTP_Available( void );
 void CL_HTTP_Shutdown( void );
-void CL_HTTP_BeginDownload( const char *remoteURL );
-qboolean CL_HTTP_PerformDownload( void );
+int CL_HTTP_MaxDownloads( void );
+// how many downloads the backend runs at once
+void CL_HTTP_BeginDownload( httpDownload_t *dl );
+// the file is open, appending after resumeFrom bytes when that is nonzero
+httpDownload_t *CL_HTTP_PerformDownload( void );
+// returns a download that has finished, or NULL
+void CL_HTTP_CancelDownloads( void );
 
 #endif	// __CL_HTTP_H__
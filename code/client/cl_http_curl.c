@@ -65,6 +65,7 @@ CURLMcode (*qcurl_multi_fdset)(CURLM *multi_handle,
 CURLMcode (*qcurl_multi_perform)(CURLM *multi_handle,
                                                 int *running_handles);
 CURLMcode (*qcurl_multi_cleanup)(CURLM *multi_handle);
+CURLMcode (*qcurl_multi_setopt)(CURLM *multi_handle, CURLMoption option, ...);
 CURLMsg *(*qcurl_multi_info_read)(CURLM *multi_handle,
                                                 int *msgs_in_queue);
 const char *(*qcurl_multi_strerror)(CURLMcode);
@@ -72,7 +73,13 @@ const char *(*qcurl_multi_strerror)(CURLMcode);
 static void *cURLLib = NULL;
 static qboolean cURLSymbolLoadFailed = qfalse;
 
-static CURL *downloadCURL = NULL;
+typedef struct {
+	CURL			*curl;
+	httpDownload_t	*dl;
+	qboolean		checked;	// the response code was looked at
+} curlDownload_t;
+
+static curlDownload_t curlDownloads[MAX_HTTP_DOWNLOADS];
 static CURLM *downloadCURLM = NULL;
 
 /*
@@ -139,6 +146,7 @@ qboolean CL_HTTP_Init(void)
 	qcurl_multi_fdset = GPA("curl_multi_fdset");
 	qcurl_multi_perform = GPA("curl_multi_perform");
 	qcurl_multi_cleanup = GPA("curl_multi_cleanup");
+	qcurl_multi_setopt = GPA("curl_multi_setopt");
 	qcurl_multi_info_read = GPA("curl_multi_info_read");
 	qcurl_multi_strerror = GPA("curl_multi_strerror");
 
@@ -165,27 +173,30 @@ qboolean CL_HTTP_Available(void)
 
 static void CL_cURL_Cleanup(void)
 {
-	if(downloadCURLM) {
-		CURLMcode result;
+	int i;
+
+	for(i = 0; i < MAX_HTTP_DOWNLOADS; i++) {
+		curlDownload_t *cd = &curlDownloads[i];
 
-		if(downloadCURL) {
-			result = qcurl_multi_remove_handle(downloadCURLM,
-				downloadCURL);
+		if(!cd->curl)
+			continue;
+
+		if(downloadCURLM) {
+			CURLMcode result = qcurl_multi_remove_handle(downloadCURLM, cd->curl);
 			if(result != CURLM_OK) {
 				Com_DPrintf("qcurl_multi_remove_handle failed: %s\n", qcurl_multi_strerror(result));
 			}
-			qcurl_easy_cleanup(downloadCURL);
 		}
-		result = qcurl_multi_cleanup(downloadCURLM);
+		qcurl_easy_cleanup(cd->curl);
+		cd->curl = NULL;
+	}
+
+	if(downloadCURLM) {
+		CURLMcode result = qcurl_multi_cleanup(downloadCURLM);
 		if(result != CURLM_OK) {
 			Com_DPrintf("CL_cURL_Cleanup: qcurl_multi_cleanup failed: %s\n", qcurl_multi_strerror(result));
 		}
 		downloadCURLM = NULL;
-		downloadCURL = NULL;
-	}
-	else if(downloadCURL) {
-		qcurl_easy_cleanup(downloadCURL);
-		downloadCURL = NULL;
 	}
 }
 
@@ -217,6 +228,7 @@ void CL_HTTP_Shutdown( void )
 	qcurl_multi_fdset = NULL;
 	qcurl_multi_perform = NULL;
 	qcurl_multi_cleanup = NULL;
+	qcurl_multi_setopt = NULL;
 	qcurl_multi_info_read = NULL;
 	qcurl_multi_strerror = NULL;
 }
@@ -224,18 +236,48 @@ void CL_HTTP_Shutdown( void )
 static int CL_cURL_CallbackProgress(void *clientp, curl_off_t dltotal, curl_off_t dlnow,
     curl_off_t ultotal, curl_off_t ulnow)
 {
-	clc.downloadSize = (int)dltotal;
-	Cvar_SetValue( "cl_downloadSize", clc.downloadSize );
-	clc.downloadCount = (int)dlnow;
-	Cvar_SetValue( "cl_downloadCount", clc.downloadCount );
+	httpDownload_t *dl = ((curlDownload_t *)clientp)->dl;
+
+	// a resumed download only counts what is left
+	if(dltotal > 0)
+		dl->size = dl->resumeFrom + (int)dltotal;
+	dl->count = dl->resumeFrom + (int)dlnow;
 	return 0;
 }
 
+/*
+=================
+CL_cURL_RestartFile
+
+The partial file can't be resumed, start it over
+=================
+*/
+static qboolean CL_cURL_RestartFile(httpDownload_t *dl)
+{
+	FS_FCloseFile(dl->file);
+	dl->file = FS_BaseDir_FOpenFileWrite_HomeData(dl->tempName);
+	dl->resumeFrom = 0;
+	dl->count = 0;
+
+	return dl->file != 0;
+}
+
 static size_t CL_cURL_CallbackWrite(void *buffer, size_t size, size_t nmemb,
 	void *stream)
 {
-	FS_Write( buffer, size*nmemb, ((fileHandle_t*)stream)[0] );
-	return size*nmemb;
+	curlDownload_t *cd = stream;
+
+	if(!cd->checked) {
+		long code = 0;
+
+		// the server ignored the range and sent it all
+		qcurl_easy_getinfo(cd->curl, CURLINFO_RESPONSE_CODE, &code);
+		if(cd->dl->resumeFrom && code != 206 && !CL_cURL_RestartFile(cd->dl))
+			return 0;
+		cd->checked = qtrue;
+	}
+
+	return FS_Write( buffer, size*nmemb, cd->dl->file );
 }
 
 CURLcode qcurl_easy_setopt_warn(CURL *curl, CURLoption option, ...)
@@ -264,89 +306,174 @@ CURLcode qcurl_easy_setopt_warn(CURL *curl, CURLoption option, ...)
 	return result;
 }
 
-void CL_HTTP_BeginDownload( const char *remoteURL )
+/*
+=================
+CL_HTTP_MaxDownloads
+=================
+*/
+int CL_HTTP_MaxDownloads( void )
+{
+	return cl_httpDownloads->integer;
+}
+
+/*
+=================
+CL_cURL_AddDownload
+=================
+*/
+static void CL_cURL_AddDownload(curlDownload_t *cd)
 {
 	CURLMcode result;
 
-	CL_cURL_Cleanup();
+	cd->checked = qfalse;
+	qcurl_easy_setopt_warn(cd->curl, CURLOPT_RESUME_FROM_LARGE, (curl_off_t)cd->dl->resumeFrom);
+
+	result = qcurl_multi_add_handle(downloadCURLM, cd->curl);
+	if(result != CURLM_OK) {
+		qcurl_easy_cleanup(cd->curl);
+		cd->curl = NULL;
+		Com_Error(ERR_DROP,"CL_HTTP_BeginDownload: qcurl_multi_add_handle() failed: %s", qcurl_multi_strerror(result));
+	}
+}
+
+/*
+=================
+CL_HTTP_BeginDownload
+
+All the downloads share one multi handle, so requests to the same host
+reuse its connections and go over one when it speaks HTTP/2
+=================
+*/
+void CL_HTTP_BeginDownload( httpDownload_t *dl )
+{
+	curlDownload_t *cd;
+	int i;
+
+	if(!downloadCURLM) {
+		downloadCURLM = qcurl_multi_init();
+		if(!downloadCURLM) {
+			Com_Error(ERR_DROP, "CL_HTTP_BeginDownload: qcurl_multi_init() "
+				"failed");
+			return;
+		}
+		qcurl_multi_setopt(downloadCURLM, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+		qcurl_multi_setopt(downloadCURLM, CURLMOPT_MAX_HOST_CONNECTIONS, (long)cl_httpDownloads->integer);
+	}
 
-	downloadCURL = qcurl_easy_init();
-	if(!downloadCURL) {
+	for(i = 0; i < MAX_HTTP_DOWNLOADS; i++) {
+		if(!curlDownloads[i].curl)
+			break;
+	}
+	if(i == MAX_HTTP_DOWNLOADS) {
+		Com_Error(ERR_DROP, "CL_HTTP_BeginDownload: too many downloads");
+		return;
+	}
+	cd = &curlDownloads[i];
+
+	cd->curl = qcurl_easy_init();
+	if(!cd->curl) {
 		Com_Error(ERR_DROP, "CL_HTTP_BeginDownload: qcurl_easy_init() "
 			"failed");
 		return;
 	}
+	cd->dl = dl;
 
 	if(com_developer->integer)
-		qcurl_easy_setopt_warn(downloadCURL, CURLOPT_VERBOSE, 1);
-	qcurl_easy_setopt_warn(downloadCURL, CURLOPT_URL, remoteURL);
-	qcurl_easy_setopt_warn(downloadCURL, CURLOPT_TRANSFERTEXT, 0);
-	qcurl_easy_setopt_warn(downloadCURL, CURLOPT_REFERER, va("ioQ3://%s",
+		qcurl_easy_setopt_warn(cd->curl, CURLOPT_VERBOSE, 1);
+	qcurl_easy_setopt_warn(cd->curl, CURLOPT_URL, dl->url);
+	qcurl_easy_setopt_warn(cd->curl, CURLOPT_TRANSFERTEXT, 0);
+	qcurl_easy_setopt_warn(cd->curl, CURLOPT_REFERER, va("ioQ3://%s",
 		NET_AdrToString(clc.serverAddress)));
-	qcurl_easy_setopt_warn(downloadCURL, CURLOPT_USERAGENT, va("%s %s",
+	qcurl_easy_setopt_warn(cd->curl, CURLOPT_USERAGENT, va("%s %s",
 		Q3_VERSION, qcurl_version()));
-	qcurl_easy_setopt_warn(downloadCURL, CURLOPT_WRITEFUNCTION,
+	qcurl_easy_setopt_warn(cd->curl, CURLOPT_WRITEFUNCTION,
 		CL_cURL_CallbackWrite);
-	qcurl_easy_setopt_warn(downloadCURL, CURLOPT_WRITEDATA, &clc.download);
-	qcurl_easy_setopt_warn(downloadCURL, CURLOPT_NOPROGRESS, 0);
-	qcurl_easy_setopt_warn(downloadCURL, CURLOPT_XFERINFOFUNCTION,
+	qcurl_easy_setopt_warn(cd->curl, CURLOPT_WRITEDATA, cd);
+	qcurl_easy_setopt_warn(cd->curl, CURLOPT_NOPROGRESS, 0);
+	qcurl_easy_setopt_warn(cd->curl, CURLOPT_XFERINFOFUNCTION,
 		CL_cURL_CallbackProgress);
-	qcurl_easy_setopt_warn(downloadCURL, CURLOPT_PROGRESSDATA, NULL);
-	qcurl_easy_setopt_warn(downloadCURL, CURLOPT_FAILONERROR, 1);
-	qcurl_easy_setopt_warn(downloadCURL, CURLOPT_FOLLOWLOCATION, 1);
-	qcurl_easy_setopt_warn(downloadCURL, CURLOPT_MAXREDIRS, 5);
+	qcurl_easy_setopt_warn(cd->curl, CURLOPT_XFERINFODATA, cd);
+	qcurl_easy_setopt_warn(cd->curl, CURLOPT_PRIVATE, cd);
+	qcurl_easy_setopt_warn(cd->curl, CURLOPT_FAILONERROR, 1);
+	qcurl_easy_setopt_warn(cd->curl, CURLOPT_FOLLOWLOCATION, 1);
+	qcurl_easy_setopt_warn(cd->curl, CURLOPT_MAXREDIRS, 5);
 #if CURL_AT_LEAST_VERSION(7,85,0)
-	qcurl_easy_setopt_warn(downloadCURL, CURLOPT_PROTOCOLS_STR, "http,https");
+	qcurl_easy_setopt_warn(cd->curl, CURLOPT_PROTOCOLS_STR, "http,https");
 #else
-	qcurl_easy_setopt_warn(downloadCURL, CURLOPT_PROTOCOLS, CURLPROTO_HTTP | CURLPROTO_HTTPS);
+	qcurl_easy_setopt_warn(cd->curl, CURLOPT_PROTOCOLS, CURLPROTO_HTTP | CURLPROTO_HTTPS);
 #endif
-	qcurl_easy_setopt_warn(downloadCURL, CURLOPT_BUFFERSIZE, CURL_MAX_READ_SIZE);
-	downloadCURLM = qcurl_multi_init();
-	if(!downloadCURLM) {
-		qcurl_easy_cleanup(downloadCURL);
-		downloadCURL = NULL;
-		Com_Error(ERR_DROP, "CL_HTTP_BeginDownload: qcurl_multi_init() "
-			"failed");
-		return;
-	}
-	result = qcurl_multi_add_handle(downloadCURLM, downloadCURL);
-	if(result != CURLM_OK) {
-		qcurl_easy_cleanup(downloadCURL);
-		downloadCURL = NULL;
-		Com_Error(ERR_DROP,"CL_HTTP_BeginDownload: qcurl_multi_add_handle() failed: %s", qcurl_multi_strerror(result));
-		return;
-	}
+	qcurl_easy_setopt_warn(cd->curl, CURLOPT_BUFFERSIZE, CURL_MAX_READ_SIZE);
+	// wait for a connection that can multiplex rather than open another
+	qcurl_easy_setopt_warn(cd->curl, CURLOPT_PIPEWAIT, 1);
+
+	CL_cURL_AddDownload(cd);
 }
 
-qboolean CL_HTTP_PerformDownload(void)
+/*
+=================
+CL_HTTP_PerformDownload
+=================
+*/
+httpDownload_t *CL_HTTP_PerformDownload(void)
 {
 	CURLMcode res;
 	CURLMsg *msg;
+	curlDownload_t *cd;
+	char *priv;
 	int c;
 	int i = 0;
 
+	if(!downloadCURLM)
+		return NULL;
+
 	res = qcurl_multi_perform(downloadCURLM, &c);
 	while(res == CURLM_CALL_MULTI_PERFORM && i < 100) {
 		res = qcurl_multi_perform(downloadCURLM, &c);
 		i++;
 	}
 	if(res == CURLM_CALL_MULTI_PERFORM)
-		return qfalse;
-	msg = qcurl_multi_info_read(downloadCURLM, &c);
-	if(msg == NULL) {
-		return qfalse;
-	}
-	if(msg->msg != CURLMSG_DONE || msg->data.result != CURLE_OK) {
-		long code;
+		return NULL;
+
+	while((msg = qcurl_multi_info_read(downloadCURLM, &c)) != NULL) {
+		long code = 0;
+
+		if(msg->msg != CURLMSG_DONE)
+			continue;
 
+		qcurl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &priv);
+		cd = (curlDownload_t *)priv;
 		qcurl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE,
-			&code);	
-		Com_Error(ERR_DROP, "Download Error: %s Code: %ld URL: %s",
-			qcurl_easy_strerror(msg->data.result),
-			code, clc.downloadURL);
+			&code);
+		qcurl_multi_remove_handle(downloadCURLM, cd->curl);
+
+		if(msg->data.result != CURLE_OK) {
+			// the partial file is no good for this one
+			if(code == 416 && cd->dl->resumeFrom && CL_cURL_RestartFile(cd->dl)) {
+				CL_cURL_AddDownload(cd);
+				continue;
+			}
+
+			Com_Error(ERR_DROP, "Download Error: %s Code: %ld URL: %s",
+				qcurl_easy_strerror(msg->data.result),
+				code, cd->dl->url);
+		}
+
+		qcurl_easy_cleanup(cd->curl);
+		cd->curl = NULL;
+		return cd->dl;
 	}
 
-	return qtrue;
+	return NULL;
+}
+
+/*
+=================
+CL_HTTP_CancelDownloads
+=================
+*/
+void CL_HTTP_CancelDownloads(void)
+{
+	CL_cURL_Cleanup();
 }
 
 #endif /* USE_HTTP */
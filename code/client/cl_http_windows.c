@@ -29,6 +29,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 static HINTERNET hInternet = NULL;
 static HINTERNET hUrl = NULL;
+static httpDownload_t *download = NULL;
 
 static Q_PRINTF_FUNC(2, 3) void DropIf(qboolean condition, const char *fmt, ...)
 {
@@ -42,7 +43,7 @@ static Q_PRINTF_FUNC(2, 3) void DropIf(qboolean condition, const char *fmt, ...)
     Q_vsnprintf(buffer, sizeof(buffer), fmt, argptr);
     va_end(argptr);
 
-    Com_Error(ERR_DROP, "Download Error: %s URL: %s", buffer, clc.downloadURL);
+    Com_Error(ERR_DROP, "Download Error: %s URL: %s", buffer, download ? download->url : "");
 }
 
 /*
@@ -90,21 +91,39 @@ void CL_HTTP_Shutdown(void)
     }
 }
 
+/*
+=================
+CL_HTTP_MaxDownloads
+=================
+*/
+int CL_HTTP_MaxDownloads(void)
+{
+    // InternetOpenUrlA blocks, one at a time
+    return 1;
+}
+
 /*
 =================
 CL_HTTP_BeginDownload
 =================
 */
-void CL_HTTP_BeginDownload(const char *remoteURL)
+void CL_HTTP_BeginDownload(httpDownload_t *dl)
 {
     DWORD httpCode = 0;
     DWORD contentLength = 0;
     DWORD len = sizeof(httpCode);
     DWORD zero = 0;
     BOOL success;
+    const char *headers;
+
+    download = dl;
+
+    headers = va("Referer: ioQ3://%s\r\n", NET_AdrToString(clc.serverAddress));
+    if (dl->resumeFrom)
+        headers = va("%sRange: bytes=%d-\r\n", headers, dl->resumeFrom);
 
-    hUrl = InternetOpenUrlA(hInternet, remoteURL,
-                            va("Referer: ioQ3://%s\r\n", NET_AdrToString(clc.serverAddress)), (DWORD)-1,
+    hUrl = InternetOpenUrlA(hInternet, dl->url,
+                            headers, (DWORD)-1,
                             INTERNET_FLAG_HYPERLINK |
                                 INTERNET_FLAG_NO_CACHE_WRITE |
                                 INTERNET_FLAG_NO_COOKIES |
@@ -118,14 +137,31 @@ void CL_HTTP_BeginDownload(const char *remoteURL)
     success = HttpQueryInfo(hUrl, HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER, &httpCode, &len, &zero);
     DropIf(!success, "Get HTTP_QUERY_STATUS_CODE failed %lu", GetLastError());
 
+    if (dl->resumeFrom && httpCode != 206)
+    {
+        // the partial file is no good, or the server ignored the range
+        FS_FCloseFile(dl->file);
+        dl->file = FS_BaseDir_FOpenFileWrite_HomeData(dl->tempName);
+        dl->resumeFrom = 0;
+        DropIf(!dl->file, "can't open %s for writing", dl->tempName);
+
+        if (httpCode == 416)
+        {
+            InternetCloseHandle(hUrl);
+            hUrl = NULL;
+            CL_HTTP_BeginDownload(dl);
+            return;
+        }
+    }
+
     DropIf(httpCode >= 400, "HTTP code %lu", httpCode);
-    DropIf(httpCode != 200, "Unhandled HTTP code %lu", httpCode);
+    DropIf(httpCode != 200 && httpCode != 206, "Unhandled HTTP code %lu", httpCode);
 
     success = HttpQueryInfo(hUrl, HTTP_QUERY_CONTENT_LENGTH | HTTP_QUERY_FLAG_NUMBER, &contentLength, &len, &zero);
     DropIf(!success, "Get HTTP_QUERY_CONTENT_LENGTH failed %lu", GetLastError());
 
-    clc.downloadSize = (int)contentLength;
-    Cvar_SetValue("cl_downloadSize", clc.downloadSize);
+    dl->size = dl->resumeFrom + (int)contentLength;
+    dl->count = dl->resumeFrom;
 }
 
 /*
@@ -133,11 +169,15 @@ void CL_HTTP_BeginDownload(const char *remoteURL)
 CL_HTTP_PerformDownload
 =================
 */
-qboolean CL_HTTP_PerformDownload(void)
+httpDownload_t *CL_HTTP_PerformDownload(void)
 {
     static BYTE readBuffer[256 * 1024];
     DWORD bytesRead = 0;
     BOOL success;
+    httpDownload_t *dl;
+
+    if (!download)
+        return NULL;
 
     DropIf(hUrl == NULL, "hUrl is NULL");
 
@@ -146,17 +186,35 @@ qboolean CL_HTTP_PerformDownload(void)
 
     if (bytesRead > 0)
     {
-        clc.downloadCount += bytesRead;
-        Cvar_SetValue("cl_downloadCount", clc.downloadCount);
+        download->count += bytesRead;
 
-        DWORD bytesWritten = (DWORD)FS_Write(readBuffer, bytesRead, clc.download);
+        DWORD bytesWritten = (DWORD)FS_Write(readBuffer, bytesRead, download->file);
         DropIf(bytesWritten != bytesRead, "bytesWritten != bytesRead");
 
-        return qfalse;
+        return NULL;
     }
 
     InternetCloseHandle(hUrl);
-    return qtrue;
+    hUrl = NULL;
+
+    dl = download;
+    download = NULL;
+    return dl;
+}
+
+/*
+=================
+CL_HTTP_CancelDownloads
+=================
+*/
+void CL_HTTP_CancelDownloads(void)
+{
+    if (hUrl)
+    {
+        InternetCloseHandle(hUrl);
+        hUrl = NULL;
+    }
+    download = NULL;
 }
 
 #endif /* USE_HTTP */
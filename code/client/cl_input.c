@@ -658,6 +658,130 @@ void CL_CreateNewCommands( void ) {
 	cl.cmds[cmdNum] = CL_CreateCmd ();
 }
 
+/*
+=================
+Packet scheduling
+
+The server only acts on usercmds at its next frame, so sending more
+often than it runs frames gains nothing. With cl_packetSchedule the
+packet goes out on the last client frame that still reaches the
+server before its next frame, worked out from when the latest
+snapshot, sent at the start of a frame, arrived and the ping. Commands
+from the frames between go out together, and how many earlier packets
+are repeated follows the loss seen on packets from the server.
+=================
+*/
+
+#define	SCHEDULE_DELTAS			16
+#define	SCHEDULE_MARGIN_MSEC	4		// for jitter
+
+static struct {
+	int		snapRealtime;		// cls.realtime the latest snapshot arrived
+	int		snapServerTime;
+	int		deltas[SCHEDULE_DELTAS];
+	int		numDeltas;
+	int		frameMsec;			// shortest snapshot interval lately, 0 until known
+	float	loss;				// of packets from the server, smoothed
+	int		reliableSequence;	// the latest reliable command sent
+} sendSchedule;
+
+/*
+=================
+CL_PacketScheduleSnapshot
+
+Called when a new snapshot is parsed
+=================
+*/
+void CL_PacketScheduleSnapshot( void ) {
+	int		delta;
+	int		i;
+
+	delta = cl.snap.serverTime - sendSchedule.snapServerTime;
+	sendSchedule.snapRealtime = cls.realtime;
+	sendSchedule.snapServerTime = cl.snap.serverTime;
+
+	sendSchedule.loss += ( (float)clc.netchan.dropped / ( clc.netchan.dropped + 1 ) - sendSchedule.loss ) * 0.05f;
+
+	// a new map or server, start over
+	if ( delta <= 0 || delta > 1000 ) {
+		sendSchedule.numDeltas = 0;
+		sendSchedule.frameMsec = 0;
+		return;
+	}
+
+	sendSchedule.deltas[sendSchedule.numDeltas++ % SCHEDULE_DELTAS] = delta;
+
+	sendSchedule.frameMsec = delta;
+	for ( i = 0; i < SCHEDULE_DELTAS && i < sendSchedule.numDeltas; i++ ) {
+		if ( sendSchedule.deltas[i] < sendSchedule.frameMsec ) {
+			sendSchedule.frameMsec = sendSchedule.deltas[i];
+		}
+	}
+}
+
+/*
+=================
+CL_PacketScheduled
+
+sinceLast is the msec since the last packet went out
+=================
+*/
+static qboolean CL_PacketScheduled( int sinceLast ) {
+	int		frameMsec, phase;
+
+	frameMsec = sendSchedule.frameMsec;
+
+	// nothing to go on yet, or a command the server should see now
+	if ( !frameMsec || clc.reliableSequence != sendSchedule.reliableSequence ) {
+		return qtrue;
+	}
+
+	// a server frame went by without one, or a high framerate
+	// is filling up the packet
+	if ( sinceLast >= 2 * frameMsec
+		|| cl.cmdNumber - cl.outPackets[(clc.netchan.outgoingSequence - 1) & PACKET_MASK].p_cmdNumber >= MAX_PACKET_USERCMDS / 2 ) {
+		return qtrue;
+	}
+
+	// one a server frame
+	if ( sinceLast < frameMsec / 2 ) {
+		return qfalse;
+	}
+
+	// how far into a server frame the packet arrives
+	phase = ( cls.realtime - sendSchedule.snapRealtime + cl.snap.ping ) % frameMsec;
+
+	// the next client frame would be too late for this server frame
+	return ( frameMsec - phase <= cls.frametime + SCHEDULE_MARGIN_MSEC );
+}
+
+/*
+=================
+CL_PacketDup
+
+How many earlier packets' usercmds are repeated
+=================
+*/
+static int CL_PacketDup( void ) {
+	int		dup, needed;
+
+	if ( cl_packetdup->integer < 0 ) {
+		Cvar_Set( "cl_packetdup", "0" );
+	} else if ( cl_packetdup->integer > 5 ) {
+		Cvar_Set( "cl_packetdup", "5" );
+	}
+	dup = cl_packetdup->integer;
+
+	if ( !cl_packetSchedule->integer || sendSchedule.loss < 0.001f ) {
+		return dup;
+	}
+
+	// enough copies that losing every one is under 1%
+	needed = (int)ceil( log( 0.01f ) / log( MIN( sendSchedule.loss, 0.9f ) ) ) - 1;
+
+	return MIN( MAX( dup, needed ), 5 );
+}
+
 /*
 =================
 CL_ReadyToSendPacket
@@ -716,6 +840,10 @@ qboolean CL_ReadyToSendPacket( void ) {
 		return qfalse;
 	}
 
+	if ( cl_packetSchedule->integer && clc.state == CA_ACTIVE ) {
+		return CL_PacketScheduled( delta );
+	}
+
 	return qtrue;
 }
 
@@ -783,12 +911,7 @@ void CL_WritePacket( void ) {
 	// we want to send all the usercmds that were generated in the last
 	// few packet, so even if a couple packets are dropped in a row,
 	// all the cmds will make it to the server
-	if ( cl_packetdup->integer < 0 ) {
-		Cvar_Set( "cl_packetdup", "0" );
-	} else if ( cl_packetdup->integer > 5 ) {
-		Cvar_Set( "cl_packetdup", "5" );
-	}
-	oldPacketNum = (clc.netchan.outgoingSequence - 1 - cl_packetdup->integer) & PACKET_MASK;
+	oldPacketNum = (clc.netchan.outgoingSequence - 1 - CL_PacketDup()) & PACKET_MASK;
 	count = cl.cmdNumber - cl.outPackets[ oldPacketNum ].p_cmdNumber;
 	if ( count > MAX_PACKET_USERCMDS ) {
 		count = MAX_PACKET_USERCMDS;
@@ -886,12 +1009,15 @@ void CL_WritePacket( void ) {
 	cl.outPackets[ packetNum ].p_serverTime = oldcmd->serverTime;
 	cl.outPackets[ packetNum ].p_cmdNumber = cl.cmdNumber;
 	clc.lastPacketSentTime = cls.realtime;
+	sendSchedule.reliableSequence = clc.reliableSequence;
 
 	if ( cl_showSend->integer ) {
 		Com_Printf( "%i ", buf.cursize );
 	}
 
 	CL_Netchan_Transmit (&clc.netchan, &buf);	
+
+	CL_InputPacingSent();
 }
 
 /*
@@ -46,6 +46,7 @@ cvar_t	*cl_voipCaptureMult;
 cvar_t	*cl_voipShowMeter;
 cvar_t	*cl_voipProtocol;
 cvar_t	*cl_voip;
+cvar_t	*cl_voipJitter;
 #endif
 
 #ifdef USE_RENDERER_DLOPEN
@@ -66,17 +67,29 @@ cvar_t	*rconAddress;
 cvar_t	*cl_timeout;
 cvar_t	*cl_maxpackets;
 cvar_t	*cl_packetdup;
+cvar_t	*cl_packetSchedule;
+cvar_t	*cl_compressConfigstrings;
+cvar_t	*cl_compressCommands;
 cvar_t	*cl_timeNudge;
 cvar_t	*cl_showTimeDelta;
+cvar_t	*cl_jitterBuffer;
+cvar_t	*cl_jitterBufferMax;
 cvar_t	*cl_freezeDemo;
 
 cvar_t	*cl_shownet;
 cvar_t	*cl_showSend;
 cvar_t	*cl_timedemo;
 cvar_t	*cl_timedemoLog;
+cvar_t	*cl_timedemoPasses;
+cvar_t	*cl_timedemoWarmup;
+cvar_t	*cl_demoKeyframeInterval;
+cvar_t	*cl_headless;
+cvar_t	*cl_inputPacing;
 cvar_t	*cl_autoRecordDemo;
 cvar_t	*cl_aviFrameRate;
 cvar_t	*cl_aviMotionJpeg;
+cvar_t	*cl_aviThreads;
+cvar_t	*cl_aviImages;
 cvar_t	*cl_forceavidemo;
 
 cvar_t	*cl_freelook;
@@ -109,6 +122,9 @@ cvar_t	*cl_activeAction;
 cvar_t	*cl_motdString;
 
 cvar_t	*cl_allowDownload;
+#ifdef USE_HTTP
+cvar_t	*cl_httpDownloads;
+#endif
 cvar_t	*cl_conXOffset;
 cvar_t	*cl_inGameVideo;
 
@@ -162,6 +178,9 @@ void CL_CheckForResend( void );
 void CL_ShowIP_f(void);
 void CL_ServerStatus_f(void);
 void CL_ServerStatusResponse( netadr_t from, msg_t *msg );
+#ifdef USE_HTTP
+static void CL_CancelHttpDownloads( void );
+#endif
 
 /*
 ===============
@@ -308,7 +327,7 @@ void CL_VoipNewGeneration(void)
 	clc.voipPower = 0.0f;
 	clc.voipOutgoingSequence = 0;
 
-	opus_encoder_ctl(clc.opusEncoder, OPUS_RESET_STATE);
+	CL_VoipResetEncoder();
 }
 
 /*
@@ -397,8 +416,8 @@ void CL_VoipParseTargets(void)
 ===============
 CL_CaptureVoip
 
-Record more audio from the hardware if required and encode it into Opus
- data for later transmission.
+Record more audio from the hardware if required and send it off to be
+ encoded into Opus data for later transmission.
 ===============
 */
 static
@@ -435,7 +454,7 @@ void CL_CaptureVoip(void)
 	if (!clc.voipCodecInitialized)
 		return;  // just in case this gets called at a bad time.
 
-	if (clc.voipOutgoingDataSize > 0)
+	if (clc.voipOutgoingDataSize > 0 || CL_VoipEncoding())
 		return;  // packet is pending transmission, don't record more yet.
 
 	if (cl_voipUseVAD->modified) {
@@ -493,7 +512,7 @@ void CL_CaptureVoip(void)
 			static int16_t sampbuffer[VOIP_MAX_PACKET_SAMPLES];
 			float voipPower = 0.0f;
 			int voipFrames;
-			int i, bytes;
+			int i;
 
 			if (samples > VOIP_MAX_PACKET_SAMPLES)
 				samples = VOIP_MAX_PACKET_SAMPLES;
@@ -518,35 +537,13 @@ void CL_CaptureVoip(void)
 				sampbuffer[i] = (int16_t) ((flsamp) * audioMult);
 			}
 
-			// encode raw audio samples into Opus data...
-			bytes = opus_encode(clc.opusEncoder, sampbuffer, samples,
-									(unsigned char *) clc.voipOutgoingData,
-									sizeof (clc.voipOutgoingData));
-			if ( bytes <= 0 ) {
-				Com_DPrintf("VoIP: Error encoding %d samples\n", samples);
-				bytes = 0;
-			}
-
 			clc.voipPower = (voipPower / (32768.0f * 32768.0f *
 			                 ((float) samples))) * 100.0f;
 
 			if ((useVad) && (clc.voipPower < cl_voipVADThreshold->value)) {
 				CL_VoipNewGeneration();  // no "talk" for at least 1/4 second.
-			} else {
-				clc.voipOutgoingDataSize = bytes;
-				clc.voipOutgoingDataFrames = voipFrames;
-
-				Com_DPrintf("VoIP: Send %d frames, %d bytes, %f power\n",
-				            voipFrames, bytes, clc.voipPower);
-
-				#if 0
-				static FILE *encio = NULL;
-				if (encio == NULL) encio = fopen("voip-outgoing-encoded.bin", "wb");
-				if (encio != NULL) { fwrite(clc.voipOutgoingData, bytes, 1, encio); fflush(encio); }
-				static FILE *decio = NULL;
-				if (decio == NULL) decio = fopen("voip-outgoing-decoded.bin", "wb");
-				if (decio != NULL) { fwrite(sampbuffer, voipFrames * VOIP_MAX_FRAME_SAMPLES * 2, 1, decio); fflush(decio); }
-				#endif
+			} else if (!CL_VoipQueueCapture(sampbuffer, samples, voipFrames)) {
+				Com_DPrintf("VoIP: Error encoding %d samples\n", samples);
 			}
 		}
 	}
@@ -870,6 +867,7 @@ CL_DemoCompleted
 void CL_DemoCompleted( void )
 {
 	char buffer[ MAX_STRING_CHARS ];
+	qboolean replay = qfalse;
 
 	if( cl_timedemo && cl_timedemo->integer )
 	{
@@ -921,63 +919,80 @@ void CL_DemoCompleted( void )
 				}
 			}
 		}
+
+		// more benchmark passes to go
+		replay = CL_BenchmarkCompleted();
 	}
 
 	CL_Disconnect( qtrue );
-	CL_NextDemo();
+	if ( !replay ) {
+		CL_NextDemo();
+	}
 }
 
 /*
 =================
-CL_ReadDemoMessage
+CL_ReadDemoFileMessage
+
+Reads the next message from clc.demofile into buf, qfalse at the end
 =================
 */
-void CL_ReadDemoMessage( void ) {
+qboolean CL_ReadDemoFileMessage( msg_t *buf ) {
 	int			r;
-	msg_t		buf;
-	byte		bufData[ MAX_MSGLEN ];
 	int			s;
 
 	if ( !clc.demofile ) {
-		CL_DemoCompleted ();
-		return;
+		return qfalse;
 	}
 
 	// get the sequence number
 	r = FS_Read( &s, 4, clc.demofile);
 	if ( r != 4 ) {
-		CL_DemoCompleted ();
-		return;
+		return qfalse;
 	}
 	clc.serverMessageSequence = LittleLong( s );
 
-	// init the message
-	MSG_Init( &buf, bufData, sizeof( bufData ) );
-
 	// get the length
-	r = FS_Read (&buf.cursize, 4, clc.demofile);
+	r = FS_Read (&buf->cursize, 4, clc.demofile);
 	if ( r != 4 ) {
-		CL_DemoCompleted ();
-		return;
+		return qfalse;
 	}
-	buf.cursize = LittleLong( buf.cursize );
-	if ( buf.cursize == -1 ) {
-		CL_DemoCompleted ();
-		return;
+	buf->cursize = LittleLong( buf->cursize );
+	if ( buf->cursize == -1 ) {
+		return qfalse;
 	}
-	if ( buf.cursize > buf.maxsize ) {
+	if ( buf->cursize > buf->maxsize ) {
 		Com_Error (ERR_DROP, "CL_ReadDemoMessage: demoMsglen > MAX_MSGLEN");
 	}
-	r = FS_Read( buf.data, buf.cursize, clc.demofile );
-	if ( r != buf.cursize ) {
+	r = FS_Read( buf->data, buf->cursize, clc.demofile );
+	if ( r != buf->cursize ) {
 		Com_Printf( "Demo file was truncated.\n");
+		return qfalse;
+	}
+
+	buf->readcount = 0;
+	return qtrue;
+}
+
+/*
+=================
+CL_ReadDemoMessage
+=================
+*/
+void CL_ReadDemoMessage( void ) {
+	msg_t		buf;
+	byte		bufData[ MAX_MSGLEN ];
+
+	MSG_Init( &buf, bufData, sizeof( bufData ) );
+	if ( !CL_ReadDemoFileMessage( &buf ) ) {
 		CL_DemoCompleted ();
 		return;
 	}
 
-	clc.lastPacketTime = cls.realtime;
-	buf.readcount = 0;
 	CL_ParseServerMessage( &buf );
+
+	// for demo_seek
+	CL_DemoKeyframe();
 }
 
 /*
@@ -1043,6 +1058,53 @@ static int CL_WalkDemoExt(char *arg, char *name, int *demofile)
 	return -1;
 }
 
+/*
+====================
+CL_OpenDemoFile
+
+Opens demos/<arg>, with or without a protocol extension, name gets the
+file that was tried last. Returns the demo's protocol.
+====================
+*/
+int CL_OpenDemoFile( const char *arg, char *name, fileHandle_t *demofile ) {
+	char		*ext_test;
+	int			protocol, i;
+	char		walk[MAX_OSPATH];
+
+	*demofile = 0;
+	Q_strncpyz( walk, arg, sizeof( walk ) );
+
+	// check for an extension .DEMOEXT_?? (?? is protocol)
+	ext_test = strrchr(walk, '.');
+	
+	if(ext_test && !Q_stricmpn(ext_test + 1, DEMOEXT, ARRAY_LEN(DEMOEXT) - 1))
+	{
+		protocol = atoi(ext_test + ARRAY_LEN(DEMOEXT));
+
+		for(i = 0; demo_protocols[i]; i++)
+		{
+			if(demo_protocols[i] == protocol)
+				break;
+		}
+
+		if(demo_protocols[i] || protocol == com_protocol->integer
+#ifdef LEGACY_PROTOCOL
+		   || protocol == com_legacyprotocol->integer
+#endif
+		  )
+		{
+			Com_sprintf(name, MAX_OSPATH, "demos/%s", walk);
+			FS_FOpenFileRead(name, demofile, qtrue);
+			return protocol;
+		}
+
+		Com_Printf("Protocol %d not supported for demos\n", protocol);
+		*ext_test = '\0';
+	}
+
+	return CL_WalkDemoExt(walk, name, demofile);
+}
+
 /*
 ====================
 CL_CompleteDemoName
@@ -1070,9 +1132,7 @@ demo <demoname>
 void CL_PlayDemo_f( void ) {
 	char		name[MAX_OSPATH];
 	char		arg[MAX_OSPATH];
-	char		*ext_test;
-	int			protocol, i;
-	char		retry[MAX_OSPATH];
+	int			protocol;
 
 	if (Cmd_Argc() != 2) {
 		Com_Printf ("demo <demoname>\n");
@@ -1088,51 +1148,13 @@ void CL_PlayDemo_f( void ) {
 	
 	CL_Disconnect( qtrue );
 
-	// check for an extension .DEMOEXT_?? (?? is protocol)
-	ext_test = strrchr(arg, '.');
-	
-	if(ext_test && !Q_stricmpn(ext_test + 1, DEMOEXT, ARRAY_LEN(DEMOEXT) - 1))
-	{
-		protocol = atoi(ext_test + ARRAY_LEN(DEMOEXT));
-
-		for(i = 0; demo_protocols[i]; i++)
-		{
-			if(demo_protocols[i] == protocol)
-				break;
-		}
-
-		if(demo_protocols[i] || protocol == com_protocol->integer
-#ifdef LEGACY_PROTOCOL
-		   || protocol == com_legacyprotocol->integer
-#endif
-		  )
-		{
-			Com_sprintf(name, sizeof(name), "demos/%s", arg);
-			FS_FOpenFileRead(name, &clc.demofile, qtrue);
-		}
-		else
-		{
-			int len;
-
-			Com_Printf("Protocol %d not supported for demos\n", protocol);
-			len = ext_test - arg;
-
-			if(len >= ARRAY_LEN(retry))
-				len = ARRAY_LEN(retry) - 1;
-
-			Q_strncpyz(retry, arg, len + 1);
-			retry[len] = '\0';
-			protocol = CL_WalkDemoExt(retry, name, &clc.demofile);
-		}
-	}
-	else
-		protocol = CL_WalkDemoExt(arg, name, &clc.demofile);
-	
+	protocol = CL_OpenDemoFile( arg, name, &clc.demofile );
 	if (!clc.demofile) {
 		Com_Error( ERR_DROP, "couldn't open %s", name);
 		return;
 	}
 	Q_strncpyz( clc.demoName, arg, sizeof( clc.demoName ) );
+	CL_BenchmarkDemo( arg );
 
 	Con_Close();
 
@@ -1328,6 +1350,7 @@ void CL_ClearState (void) {
 //	S_StopAllSounds();
 
 	Com_Memset( &cl, 0, sizeof( cl ) );
+	CL_DemoKeyframeClear();
 }
 
 /*
@@ -1392,6 +1415,10 @@ void CL_Disconnect( qboolean showMainMenu ) {
 	*clc.downloadTempName = *clc.downloadName = 0;
 	Cvar_Set( "cl_downloadName", "" );
 
+#ifdef USE_HTTP
+	CL_CancelHttpDownloads();
+#endif
+
 #ifdef USE_MUMBLE
 	if (cl_useMumble->integer && mumble_islinked()) {
 		Com_Printf("Mumble: Unlinking from Mumble application\n");
@@ -1400,6 +1427,8 @@ void CL_Disconnect( qboolean showMainMenu ) {
 #endif
 
 #ifdef USE_VOIP
+	CL_VoipStopWorker();
+
 	if (cl_voipSend->integer) {
 		int tmp = cl_voipUseVAD->integer;
 		cl_voipUseVAD->integer = 0;  // disable this for a moment.
@@ -1413,7 +1442,10 @@ void CL_Disconnect( qboolean showMainMenu ) {
 		int i;
 		opus_encoder_destroy(clc.opusEncoder);
 		for (i = 0; i < MAX_CLIENTS; i++) {
-			opus_decoder_destroy(clc.opusDecoder[i]);
+			if (clc.opusDecoder[i]) {
+				opus_decoder_destroy(clc.opusDecoder[i]);
+				clc.opusDecoder[i] = NULL;
+			}
 		}
 		clc.voipCodecInitialized = qfalse;
 	}
@@ -2073,6 +2105,18 @@ void CL_Clientinfo_f( void ) {
 	Com_Printf( "--------------------------------------\n" );
 }
 
+/*
+==============
+CL_SnapStats_f
+==============
+*/
+void CL_SnapStats_f( void ) {
+	Com_Printf( "jitter: %i msec\n", cl.snapJitter >> 4 );
+	Com_Printf( "buffer delay: %i msec\n", cl.jitterDelay );
+	Com_Printf( "late snapshots: %i\n", cl.lateSnapshots );
+	Com_Printf( "dropped snapshots: %i\n", cl.droppedSnapshots );
+}
+
 
 //====================================================================
 
@@ -2176,33 +2220,68 @@ game directory.
 =================
 */
 static void CL_BeginDownload( const char *remoteName ) {
-	CL_AddReliableCommand(va("download %s", remoteName), qfalse);
+	// servers that don't know the block size argument just ignore it
+	CL_AddReliableCommand(va("download %s %d", remoteName, MAX_DOWNLOAD_BLKSIZE_EXT), qfalse);
 }
 
 #ifdef USE_HTTP
+static httpDownload_t	httpDownloads[MAX_HTTP_DOWNLOADS];
+static int				numHttpDownloads;
+
 /*
 =================
-CL_BeginHttpDownload
+CL_QueueHttpDownload
 =================
 */
-static void CL_BeginHttpDownload( const char *remoteURL ) {
-	if(Q_strncmp(remoteURL, "http://", strlen("http://")) != 0 &&
-		Q_strncmp(remoteURL, "https://", strlen("https://")) != 0) {
+static void CL_QueueHttpDownload( const char *remoteName, const char *localName ) {
+	httpDownload_t	*dl;
+
+	dl = &httpDownloads[numHttpDownloads++];
+	Com_Memset( dl, 0, sizeof( *dl ) );
+	Com_sprintf( dl->url, sizeof( dl->url ), "%s/%s", clc.sv_dlURL, remoteName );
+	Q_strncpyz( dl->localName, localName, sizeof( dl->localName ) );
+	Com_sprintf( dl->tempName, sizeof( dl->tempName ), "%s.tmp", localName );
+
+	if(Q_strncmp(dl->url, "http://", strlen("http://")) != 0 &&
+		Q_strncmp(dl->url, "https://", strlen("https://")) != 0) {
 		Com_Error(ERR_DROP, "Download Error: %s is a malformed/"
-			"unsupported URL", remoteURL);
+			"unsupported URL", dl->url);
 	}
+}
 
-	Com_Printf("URL: %s\n", remoteURL);
-
-	CL_HTTP_BeginDownload(remoteURL);
-	Q_strncpyz(clc.downloadURL, remoteURL, sizeof(clc.downloadURL));
+/*
+=================
+CL_BeginHttpDownload
+=================
+*/
+static void CL_BeginHttpDownload( httpDownload_t *dl ) {
+	Com_Printf("URL: %s\n", dl->url);
 
-	clc.download = FS_BaseDir_FOpenFileWrite_HomeData(clc.downloadTempName);
-	if(!clc.download) {
+	// pick up where an earlier attempt left off
+	dl->file = FS_BaseDir_FOpenFileAppend_HomeData(dl->tempName);
+	if(!dl->file) {
 		Com_Error(ERR_DROP, "CL_BeginHTTPDownload: failed to open "
-			"%s for writing", clc.downloadTempName);
+			"%s for writing", dl->tempName);
+	}
+	FS_Seek(dl->file, 0, FS_SEEK_END);
+	dl->resumeFrom = FS_FTell(dl->file);
+	if(dl->resumeFrom) {
+		Com_Printf("Resuming %s at %d bytes\n", dl->localName, dl->resumeFrom);
 	}
 
+	dl->count = dl->resumeFrom;
+	dl->started = qtrue;
+	CL_HTTP_BeginDownload(dl);
+}
+
+/*
+=================
+CL_StartHttpDownloads
+
+Everything queued comes from sv_dlURL, the backend fetches several at once
+=================
+*/
+static void CL_StartHttpDownloads( void ) {
 	if(!(clc.sv_allowDownload & DLF_NO_DISCONNECT) &&
 		!clc.disconnectedForHttpDownload) {
 
@@ -2214,6 +2293,94 @@ static void CL_BeginHttpDownload( const char *remoteURL ) {
 	}
 
 	clc.httpUsed = qtrue;
+
+	Cvar_Set( "cl_downloadSize", "0" );
+	Cvar_Set( "cl_downloadCount", "0" );
+	Cvar_SetValue( "cl_downloadTime", cls.realtime );
+}
+
+/*
+=================
+CL_HttpDownloadFrame
+
+Returns qtrue once all the queued downloads have finished
+=================
+*/
+static qboolean CL_HttpDownloadFrame( void ) {
+	httpDownload_t	*dl;
+	const char		*name;
+	char			*zippath;
+	int				active, i;
+
+	while ( ( dl = CL_HTTP_PerformDownload() ) != NULL ) {
+		FS_FCloseFile( dl->file );
+		dl->file = 0;
+		dl->finished = qtrue;
+
+		FS_BaseDir_Rename_HomeData( dl->tempName, dl->localName, qfalse );
+
+		zippath = FS_BaseDir_BuildOSPath( Cvar_VariableString( "fs_homedatapath" ), dl->localName );
+		if ( !FS_CompareZipChecksum( zippath ) ) {
+			Com_Error( ERR_DROP, "Incorrect checksum for file: %s", dl->localName );
+		}
+	}
+
+	active = 0;
+	for ( i = 0; i < numHttpDownloads; i++ ) {
+		if ( httpDownloads[i].started && !httpDownloads[i].finished ) {
+			active++;
+		}
+	}
+	for ( i = 0; i < numHttpDownloads && active < CL_HTTP_MaxDownloads(); i++ ) {
+		if ( !httpDownloads[i].started ) {
+			CL_BeginHttpDownload( &httpDownloads[i] );
+			active++;
+		}
+	}
+
+	// the ui shows all of them as one
+	name = "";
+	clc.downloadSize = clc.downloadCount = 0;
+	for ( i = 0; i < numHttpDownloads; i++ ) {
+		dl = &httpDownloads[i];
+		clc.downloadSize += dl->size;
+		clc.downloadCount += dl->count;
+		if ( !*name && dl->started && !dl->finished ) {
+			name = dl->localName;
+		}
+	}
+	if ( active > 1 ) {
+		name = va( "%s (+%d)", name, active - 1 );
+	}
+	Cvar_Set( "cl_downloadName", name );
+	Cvar_SetValue( "cl_downloadSize", clc.downloadSize );
+	Cvar_SetValue( "cl_downloadCount", clc.downloadCount );
+
+	if ( active ) {
+		return qfalse;
+	}
+
+	numHttpDownloads = 0;
+	return qtrue;
+}
+
+/*
+=================
+CL_CancelHttpDownloads
+=================
+*/
+static void CL_CancelHttpDownloads( void ) {
+	int		i;
+
+	CL_HTTP_CancelDownloads();
+
+	// the partial files are kept to resume from
+	for ( i = 0; i < numHttpDownloads; i++ ) {
+		if ( httpDownloads[i].file ) {
+			FS_FCloseFile( httpDownloads[i].file );
+		}
+	}
+	numHttpDownloads = 0;
 }
 #endif /* USE_HTTP */
 
@@ -2228,7 +2395,7 @@ void CL_NextDownload(void)
 {
 	char *s;
 	char *remoteName, *localName;
-	qboolean usedHTTP = qfalse;
+	qboolean usedHTTP;
 
 	// A download has finished, check whether this matches a referenced checksum
 	if(*clc.downloadName)
@@ -2243,7 +2410,8 @@ void CL_NextDownload(void)
 	Cvar_Set("cl_downloadName", "");
 
 	// We are looking to start a download here
-	if (*clc.downloadList) {
+	while (*clc.downloadList) {
+		usedHTTP = qfalse;
 		s = clc.downloadList;
 
 		// format is:
@@ -2254,8 +2422,8 @@ void CL_NextDownload(void)
 		remoteName = s;
 		
 		if ( (s = strchr(s, '@')) == NULL ) {
-			CL_DownloadsComplete();
-			return;
+			*clc.downloadList = 0;
+			break;
 		}
 
 		*s++ = 0;
@@ -2278,10 +2446,7 @@ void CL_NextDownload(void)
 					"have sv_dlURL set\n");
 			}
 			else if(CL_HTTP_Available()) {
-				CL_InitDownload(localName);
-				CL_BeginHttpDownload(va("%s/%s",
-					clc.sv_dlURL, remoteName));
-
+				CL_QueueHttpDownload(remoteName, localName);
 				usedHTTP = qtrue;
 			}
 		}
@@ -2310,8 +2475,23 @@ void CL_NextDownload(void)
 		// move over the rest
 		memmove( clc.downloadList, s, strlen(s) + 1);
 
+		// the rest come from the same place, queue them all
+		if ( !usedHTTP ) {
+			return;
+		}
+#ifdef USE_HTTP
+		if ( numHttpDownloads == MAX_HTTP_DOWNLOADS ) {
+			break;
+		}
+#endif
+	}
+
+#ifdef USE_HTTP
+	if ( numHttpDownloads ) {
+		CL_StartHttpDownloads();
 		return;
 	}
+#endif
 
 	CL_DownloadsComplete();
 }
@@ -2423,6 +2603,14 @@ void CL_CheckForResend( void ) {
 			Info_SetValueForKey(info, "protocol", va("%i", com_protocol->integer));
 		Info_SetValueForKey( info, "qport", va("%i", port ) );
 		Info_SetValueForKey( info, "challenge", va("%i", clc.challenge ) );
+
+		// ask for larger netchan fragments
+#ifdef LEGACY_PROTOCOL
+		if ( !clc.compat )
+#endif
+		if ( Netchan_FragmentSize() ) {
+			Info_SetValueForKey( info, "fragsize", va( "%i", Netchan_FragmentSize() ) );
+		}
 		
 		Com_sprintf( data, sizeof(data), "connect \"%s\"", info );
 		NET_OutOfBandData( NS_CLIENT, clc.serverAddress, (byte *) data, strlen ( data ) );
@@ -2764,6 +2952,14 @@ void CL_ConnectionlessPacket( netadr_t from, msg_t *msg ) {
 			      clc.challenge, qfalse);
 #endif
 
+		// the fragment size the server agreed on, if it took up the request
+#ifdef LEGACY_PROTOCOL
+		if ( !clc.compat )
+#endif
+		if ( Cmd_Argc() > 2 ) {
+			Netchan_SetFragmentSize( &clc.netchan, atoi( Cmd_Argv( 2 ) ) );
+		}
+
 		clc.state = CA_CONNECTED;
 		clc.lastPacketSentTime = -9999;		// send first packet immediately
 		return;
@@ -2962,22 +3158,20 @@ CL_Frame
 ==================
 */
 void CL_Frame ( int msec ) {
+	int64_t	start;
 
 	if ( !com_cl_running->integer ) {
 		return;
 	}
 
+	// nothing to draw or play, only commands run
+	if ( cl_headless->integer ) {
+		return;
+	}
+
 #ifdef USE_HTTP
 	if(clc.httpUsed) {
-		qboolean finished = CL_HTTP_PerformDownload();
-
-		if(finished) {
-			if(clc.download) {
-				FS_FCloseFile(clc.download);
-				clc.download = 0;
-			}
-
-			FS_BaseDir_Rename_HomeData(clc.downloadTempName, clc.downloadName, qfalse);
+		if(CL_HttpDownloadFrame()) {
 			clc.downloadRestart = qtrue;
 			CL_NextDownload();
 		}
@@ -3080,6 +3274,11 @@ void CL_Frame ( int msec ) {
 	// drop the connection
 	CL_CheckTimeout();
 
+#ifdef USE_VOIP
+	// collect decoded and encoded voice before sending
+	CL_VoipUpdate();
+#endif
+
 	// send intentions now
 	CL_SendCmd();
 
@@ -3092,8 +3291,12 @@ void CL_Frame ( int msec ) {
 	// update the screen
 	SCR_UpdateScreen();
 
+	CL_InputPacingFrame();
+
 	// update audio
+	start = Sys_Microseconds();
 	S_Update();
+	CL_BenchmarkTime( BENCH_SOUND, Sys_Microseconds() - start );
 
 #ifdef USE_VOIP
 	CL_CaptureVoip();
@@ -3198,9 +3401,15 @@ void CL_StartHunkUsers( qboolean rendererOnly ) {
 		return;
 	}
 
+	if ( cl_headless->integer ) {
+		return;
+	}
+
 	if ( !cls.rendererStarted ) {
 		cls.rendererStarted = qtrue;
+		PROFILE_BEGIN( "CL_InitRenderer" );
 		CL_InitRenderer();
+		PROFILE_END();
 	}
 
 	if ( rendererOnly ) {
@@ -3209,12 +3418,16 @@ void CL_StartHunkUsers( qboolean rendererOnly ) {
 
 	if ( !cls.soundStarted ) {
 		cls.soundStarted = qtrue;
+		PROFILE_BEGIN( "S_Init" );
 		S_Init();
+		PROFILE_END();
 	}
 
 	if ( !cls.soundRegistered ) {
 		cls.soundRegistered = qtrue;
+		PROFILE_BEGIN( "S_BeginRegistration" );
 		S_BeginRegistration();
+		PROFILE_END();
 	}
 
 	if( com_dedicated->integer ) {
@@ -3223,7 +3436,9 @@ void CL_StartHunkUsers( qboolean rendererOnly ) {
 
 	if ( !cls.uiStarted ) {
 		cls.uiStarted = qtrue;
+		PROFILE_BEGIN( "CL_InitUI" );
 		CL_InitUI();
+		PROFILE_END();
 	}
 }
 
@@ -3290,6 +3505,8 @@ void CL_InitRef( void ) {
 	ri.Printf = CL_RefPrintf;
 	ri.Error = Com_Error;
 	ri.Milliseconds = CL_ScaledMilliseconds;
+	ri.ProfileBegin = Com_ProfileBegin;
+	ri.ProfileEnd = Com_ProfileEnd;
 	ri.Malloc = CL_RefMalloc;
 	ri.Free = Z_Free;
 #ifdef HUNK_DEBUG
@@ -3301,10 +3518,15 @@ void CL_InitRef( void ) {
 	ri.Hunk_FreeTempMemory = Hunk_FreeTempMemory;
 
 	ri.CM_ClusterPVS = CM_ClusterPVS;
+	ri.CM_LeafArea = CM_LeafArea;
 	ri.CM_DrawDebugSurface = CM_DrawDebugSurface;
 
 	ri.FS_ReadFile = FS_ReadFile;
 	ri.FS_FreeFile = FS_FreeFile;
+	ri.FS_MapFile = FS_MapFile;
+	ri.FS_UnmapFile = FS_UnmapFile;
+	ri.FS_FileContentKey = FS_FileContentKey;
+	ri.MemStatSet = Com_MemStatSet;
 	ri.FS_WriteFile = FS_WriteFile;
 	ri.FS_FreeFileList = FS_FreeFileList;
 	ri.FS_ListFiles = FS_ListFiles;
@@ -3570,15 +3792,37 @@ void CL_Init( void ) {
 	cl_shownet = Cvar_Get ("cl_shownet", "0", CVAR_TEMP );
 	cl_showSend = Cvar_Get ("cl_showSend", "0", CVAR_TEMP );
 	cl_showTimeDelta = Cvar_Get ("cl_showTimeDelta", "0", CVAR_TEMP );
+	cl_jitterBuffer = Cvar_Get ("cl_jitterBuffer", "1", CVAR_ARCHIVE );
+	cl_jitterBufferMax = Cvar_Get ("cl_jitterBufferMax", "50", CVAR_ARCHIVE );
+	Cvar_CheckRange( cl_jitterBufferMax, 0, 200, qtrue );
 	cl_freezeDemo = Cvar_Get ("cl_freezeDemo", "0", CVAR_TEMP );
 	rcon_client_password = Cvar_Get ("rconPassword", "", CVAR_TEMP );
 	cl_activeAction = Cvar_Get( "activeAction", "", CVAR_TEMP );
 
 	cl_timedemo = Cvar_Get ("timedemo", "0", 0);
 	cl_timedemoLog = Cvar_Get ("cl_timedemoLog", "", CVAR_ARCHIVE);
+	cl_timedemoPasses = Cvar_Get ("cl_timedemoPasses", "1", CVAR_ARCHIVE);
+	Cvar_CheckRange( cl_timedemoPasses, 1, 32, qtrue );
+	Cvar_SetDescription( cl_timedemoPasses, "Measured passes a timedemo plays, the results go to a json file next to cl_timedemoLog." );
+	cl_timedemoWarmup = Cvar_Get ("cl_timedemoWarmup", "0", CVAR_ARCHIVE);
+	Cvar_CheckRange( cl_timedemoWarmup, 0, 8, qtrue );
+	Cvar_SetDescription( cl_timedemoWarmup, "Unmeasured passes a timedemo plays before cl_timedemoPasses." );
+	cl_demoKeyframeInterval = Cvar_Get ("cl_demoKeyframeInterval", "10", CVAR_ARCHIVE);
+	Cvar_CheckRange( cl_demoKeyframeInterval, 1, 600, qtrue );
+	Cvar_SetDescription( cl_demoKeyframeInterval, "Seconds of demo between the keyframes demo_seek restores from." );
+	cl_headless = Cvar_Get ("cl_headless", "0", CVAR_INIT);
+	Cvar_SetDescription( cl_headless, "Run the client without a window, sound or ui, for demo_export. Set on the command line." );
+	cl_inputPacing = Cvar_Get ("cl_inputPacing", "0", CVAR_ARCHIVE);
+	Cvar_CheckRange( cl_inputPacing, 0, 1, qtrue );
+	Cvar_SetDescription( cl_inputPacing, "Sample input as late in the frame as the last frames allow, with vsync or com_maxfps. See the latency command." );
 	cl_autoRecordDemo = Cvar_Get ("cl_autoRecordDemo", "0", CVAR_ARCHIVE);
 	cl_aviFrameRate = Cvar_Get ("cl_aviFrameRate", "25", CVAR_ARCHIVE);
 	cl_aviMotionJpeg = Cvar_Get ("cl_aviMotionJpeg", "1", CVAR_ARCHIVE);
+	cl_aviThreads = Cvar_Get ("cl_aviThreads", "2", CVAR_ARCHIVE);
+	Cvar_CheckRange( cl_aviThreads, 0, 8, qtrue );
+	Cvar_SetDescription( cl_aviThreads, "Threads compressing and writing captured video, 0 writes as frames are taken." );
+	cl_aviImages = Cvar_Get ("cl_aviImages", "0", CVAR_ARCHIVE);
+	Cvar_SetDescription( cl_aviImages, "Capture video as a lossless QOI image sequence and a WAV file instead of an AVI." );
 	cl_forceavidemo = Cvar_Get ("cl_forceavidemo", "0", 0);
 
 	rconAddress = Cvar_Get ("rconAddress", "", 0);
@@ -3589,6 +3833,12 @@ void CL_Init( void ) {
 
 	cl_maxpackets = Cvar_Get ("cl_maxpackets", "30", CVAR_ARCHIVE );
 	cl_packetdup = Cvar_Get ("cl_packetdup", "1", CVAR_ARCHIVE );
+	cl_packetSchedule = Cvar_Get ("cl_packetSchedule", "1", CVAR_ARCHIVE );
+	Cvar_SetDescription( cl_packetSchedule, "Send a packet once a server frame, timed to arrive just before it, repeating more commands when packets are being lost." );
+	cl_compressConfigstrings = Cvar_Get ("cl_compressConfigstrings", "1", CVAR_USERINFO | CVAR_ARCHIVE );
+	Cvar_SetDescription( cl_compressConfigstrings, "Let the server deflate the gamestate's configstrings and send configstring changes as deltas." );
+	cl_compressCommands = Cvar_Get ("cl_compressCommands", "1", CVAR_USERINFO | CVAR_ARCHIVE );
+	Cvar_SetDescription( cl_compressCommands, "Let the server deflate its reliable commands and drop the ones a newer command replaces." );
 
 	cl_run = Cvar_Get ("cl_run", "1", CVAR_ARCHIVE);
 	cl_sensitivity = Cvar_Get ("sensitivity", "5", CVAR_ARCHIVE);
@@ -3606,6 +3856,11 @@ void CL_Init( void ) {
 	cl_showMouseRate = Cvar_Get ("cl_showmouserate", "0", 0);
 
 	cl_allowDownload = Cvar_Get ("cl_allowDownload", "0", CVAR_ARCHIVE);
+#ifdef USE_HTTP
+	cl_httpDownloads = Cvar_Get ("cl_httpDownloads", "4", CVAR_ARCHIVE);
+	Cvar_CheckRange( cl_httpDownloads, 1, 16, qtrue );
+	Cvar_SetDescription( cl_httpDownloads, "How many files are downloaded from sv_dlURL at once, where the download library allows it." );
+#endif
 
 	cl_conXOffset = Cvar_Get ("cl_conXOffset", "0", 0);
 #ifdef __APPLE__
@@ -3697,6 +3952,9 @@ void CL_Init( void ) {
 
 	cl_voip = Cvar_Get ("cl_voip", "1", CVAR_ARCHIVE);
 	Cvar_CheckRange( cl_voip, 0, 1, qtrue );
+	cl_voipJitter = Cvar_Get ("cl_voipJitter", "60", CVAR_ARCHIVE);
+	Cvar_CheckRange( cl_voipJitter, 0, 500, qtrue );
+	Cvar_SetDescription( cl_voipJitter, "Milliseconds to wait for a missing VoIP packet before concealing it." );
 	cl_voipProtocol = Cvar_Get ("cl_voipProtocol", cl_voip->integer ? "opus" : "", CVAR_USERINFO | CVAR_ROM);
 #endif
 
@@ -3717,12 +3975,17 @@ void CL_Init( void ) {
 	Cmd_AddCommand ("cmd", CL_ForwardToServer_f);
 	Cmd_AddCommand ("configstrings", CL_Configstrings_f);
 	Cmd_AddCommand ("clientinfo", CL_Clientinfo_f);
+	Cmd_AddCommand ("snapstats", CL_SnapStats_f);
 	Cmd_AddCommand ("snd_restart", CL_Snd_Restart_f);
 	Cmd_AddCommand ("vid_restart", CL_Vid_Restart_f);
 	Cmd_AddCommand ("disconnect", CL_Disconnect_f);
 	Cmd_AddCommand ("record", CL_Record_f);
 	Cmd_AddCommand ("demo", CL_PlayDemo_f);
 	Cmd_SetCommandCompletionFunc( "demo", CL_CompleteDemoName );
+	Cmd_AddCommand ("demo_seek", CL_DemoSeek_f);
+	Cmd_AddCommand ("demo_export", CL_DemoExport_f);
+	Cmd_AddCommand ("latency", CL_Latency_f);
+	Cmd_SetCommandCompletionFunc( "demo_export", CL_CompleteDemoName );
 	Cmd_AddCommand ("cinematic", CL_PlayCinematic_f);
 	Cmd_AddCommand ("stoprecord", CL_StopRecord_f);
 	Cmd_AddCommand ("connect", CL_Connect_f);
@@ -3796,11 +4059,15 @@ void CL_Shutdown(char *finalmsg, qboolean disconnect, qboolean quit)
 	Cmd_RemoveCommand ("cmd");
 	Cmd_RemoveCommand ("configstrings");
 	Cmd_RemoveCommand ("clientinfo");
+	Cmd_RemoveCommand ("snapstats");
 	Cmd_RemoveCommand ("snd_restart");
 	Cmd_RemoveCommand ("vid_restart");
 	Cmd_RemoveCommand ("disconnect");
 	Cmd_RemoveCommand ("record");
 	Cmd_RemoveCommand ("demo");
+	Cmd_RemoveCommand ("demo_seek");
+	Cmd_RemoveCommand ("demo_export");
+	Cmd_RemoveCommand ("latency");
 	Cmd_RemoveCommand ("cinematic");
 	Cmd_RemoveCommand ("stoprecord");
 	Cmd_RemoveCommand ("connect");
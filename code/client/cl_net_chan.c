@@ -38,7 +38,7 @@ CL_Netchan_Encode
 */
 static void CL_Netchan_Encode( msg_t *msg ) {
 	int serverId, messageAcknowledge, reliableAcknowledge;
-	int i, index, srdc, sbit, soob;
+	int srdc, sbit, soob;
 	byte key, *string;
 
 	if ( msg->cursize <= CL_ENCODE_START ) {
@@ -62,23 +62,9 @@ static void CL_Netchan_Encode( msg_t *msg ) {
         msg->readcount = srdc;
         
 	string = (byte *)clc.serverCommands[ reliableAcknowledge & (MAX_RELIABLE_COMMANDS-1) ];
-	index = 0;
-	//
+	// the key changes with the last received now acknowledged server command
 	key = clc.challenge ^ serverId ^ messageAcknowledge;
-	for (i = CL_ENCODE_START; i < msg->cursize; i++) {
-		// modify the key with the last received now acknowledged server command
-		if (!string[index])
-			index = 0;
-		if (string[index] > 127 || string[index] == '%') {
-			key ^= '.' << (i & 1);
-		}
-		else {
-			key ^= string[index] << (i & 1);
-		}
-		index++;
-		// encode the data with this key
-		*(msg->data + i) = (*(msg->data + i)) ^ key;
-	}
+	Netchan_XorPayload( msg, CL_ENCODE_START, key, string );
 }
 
 /*
@@ -91,7 +77,7 @@ CL_Netchan_Decode
 ==============
 */
 static void CL_Netchan_Decode( msg_t *msg ) {
-	long reliableAcknowledge, i, index;
+	long reliableAcknowledge;
 	byte key, *string;
         int	srdc, sbit, soob;
 
@@ -108,23 +94,10 @@ static void CL_Netchan_Decode( msg_t *msg ) {
         msg->readcount = srdc;
 
 	string = (byte *) clc.reliableCommands[ reliableAcknowledge & (MAX_RELIABLE_COMMANDS-1) ];
-	index = 0;
-	// xor the client challenge with the netchan sequence number (need something that changes every message)
+	// xor the client challenge with the netchan sequence number (need something that changes every message),
+	// the key changes with the last sent and with this message acknowledged client command
 	key = clc.challenge ^ LittleLong( *(unsigned *)msg->data );
-	for (i = msg->readcount + CL_DECODE_START; i < msg->cursize; i++) {
-		// modify the key with the last sent and with this message acknowledged client command
-		if (!string[index])
-			index = 0;
-		if (string[index] > 127 || string[index] == '%') {
-			key ^= '.' << (i & 1);
-		}
-		else {
-			key ^= string[index] << (i & 1);
-		}
-		index++;
-		// decode the data with this key
-		*(msg->data + i) = *(msg->data + i) ^ key;
-	}
+	Netchan_XorPayload( msg, msg->readcount + CL_DECODE_START, key, string );
 }
 #endif
 
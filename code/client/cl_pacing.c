@@ -0,0 +1,210 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// cl_pacing.c -- input pacing and input latency measurement
+
+// Com_Frame samples input right after the frame limiter and the usercmd
+// built from it goes out before the scene is drawn, so what lies between
+// the sample and the picture is the drawing and, with vsync, the wait in
+// the buffer swap. With cl_inputPacing the sample is held back by the part
+// of the frame that has lately turned out to be spare, so the frame ends
+// closer to when it is shown. The hold grows a little each frame and is cut
+// back as soon as a frame runs long. Without vsync the com_maxfps limiter
+// takes the hold out of its own sleep, so the framerate stays the same.
+
+#include "client.h"
+
+#define	PACING_FRAMES		32		// frames the cadence is learned over
+#define	PACING_STEP_USEC	50
+#define	PACING_BACKOFF_USEC	1000
+#define	LATENCY_SAMPLES		256
+
+typedef struct {
+	int		usec[LATENCY_SAMPLES];
+	int		count;
+} latencySamples_t;
+
+static struct {
+	qboolean			active;
+	int64_t				sampleUsec;		// input was sampled for this frame
+	int64_t				lastSampleUsec;
+	qboolean			sent;			// the usercmd from it went out
+
+	int					holdUsec;
+	int					periods[PACING_FRAMES];
+	int					numPeriods;
+	int					settle;			// frames to wait after backing off
+
+	latencySamples_t	toSend;
+	latencySamples_t	toSwap;
+} inputPacing;
+
+/*
+=================
+CL_LatencySample
+=================
+*/
+static void CL_LatencySample( latencySamples_t *samples, int usec ) {
+	samples->usec[samples->count++ % LATENCY_SAMPLES] = usec;
+}
+
+/*
+=================
+CL_InputPacingUsec
+
+Called by Com_Frame after the frame limiter, returns how long to wait
+before sampling input
+=================
+*/
+int CL_InputPacingUsec( void ) {
+	inputPacing.active = ( cl_inputPacing->integer && clc.state == CA_ACTIVE
+		&& !clc.demoplaying && !cl_timedemo->integer
+		&& ( Cvar_VariableIntegerValue( "com_maxfps" ) > 0 || Cvar_VariableIntegerValue( "r_swapInterval" ) ) );
+
+	if ( !inputPacing.active ) {
+		inputPacing.holdUsec = 0;
+		inputPacing.settle = 0;
+	}
+
+	inputPacing.sampleUsec = Sys_Microseconds() + inputPacing.holdUsec;
+	inputPacing.sent = qfalse;
+
+	return inputPacing.holdUsec;
+}
+
+/*
+=================
+CL_InputPacingSent
+
+Called when a packet goes out
+=================
+*/
+void CL_InputPacingSent( void ) {
+	if ( inputPacing.sent || !inputPacing.sampleUsec ) {
+		return;
+	}
+
+	CL_LatencySample( &inputPacing.toSend, Sys_Microseconds() - inputPacing.sampleUsec );
+	inputPacing.sent = qtrue;
+}
+
+/*
+=================
+CL_InputPacingFrame
+
+Called after the screen is updated
+=================
+*/
+void CL_InputPacingFrame( void ) {
+	int		period, shortest;
+	int		i;
+
+	if ( !inputPacing.sampleUsec ) {
+		return;
+	}
+
+	CL_LatencySample( &inputPacing.toSwap, Sys_Microseconds() - inputPacing.sampleUsec );
+
+	period = inputPacing.sampleUsec - inputPacing.lastSampleUsec;
+	inputPacing.lastSampleUsec = inputPacing.sampleUsec;
+
+	// the first frame, or a hitch
+	if ( period <= 0 || period > 250000 ) {
+		inputPacing.numPeriods = 0;
+		return;
+	}
+
+	inputPacing.periods[inputPacing.numPeriods++ % PACING_FRAMES] = period;
+
+	if ( !inputPacing.active || inputPacing.numPeriods < PACING_FRAMES ) {
+		return;
+	}
+
+	// the cadence the limiter or the display allows
+	shortest = period;
+	for ( i = 0; i < PACING_FRAMES; i++ ) {
+		if ( inputPacing.periods[i] < shortest ) {
+			shortest = inputPacing.periods[i];
+		}
+	}
+
+	if ( period > shortest + MAX( 1000, shortest / 8 ) ) {
+		// the frame ran late, give the time back
+		inputPacing.holdUsec = MAX( inputPacing.holdUsec / 2 - PACING_BACKOFF_USEC, 0 );
+		inputPacing.settle = PACING_FRAMES;
+	} else if ( inputPacing.settle ) {
+		inputPacing.settle--;
+	} else {
+		inputPacing.holdUsec = MIN( inputPacing.holdUsec + PACING_STEP_USEC, shortest * 3 / 4 );
+	}
+}
+
+/*
+=================
+CL_LatencyCompare
+=================
+*/
+static int CL_LatencyCompare( const void *a, const void *b ) {
+	return *(const int *)a - *(const int *)b;
+}
+
+/*
+=================
+CL_LatencyPrint
+=================
+*/
+static void CL_LatencyPrint( const char *label, const latencySamples_t *samples ) {
+	int		sorted[LATENCY_SAMPLES];
+	int64_t	sum;
+	int		count, i;
+
+	count = MIN( samples->count, LATENCY_SAMPLES );
+	if ( !count ) {
+		Com_Printf( "%-16s no samples\n", label );
+		return;
+	}
+
+	Com_Memcpy( sorted, samples->usec, count * sizeof( sorted[0] ) );
+	qsort( sorted, count, sizeof( sorted[0] ), CL_LatencyCompare );
+
+	sum = 0;
+	for ( i = 0; i < count; i++ ) {
+		sum += sorted[i];
+	}
+
+	Com_Printf( "%-16s avg %.2f ms, 50%% %.2f ms, 99%% %.2f ms\n", label, sum / ( count * 1000.0f ),
+		sorted[count / 2] / 1000.0f, sorted[(int)( 0.99f * ( count - 1 ) + 0.5f )] / 1000.0f );
+}
+
+/*
+=================
+CL_Latency_f
+
+The last LATENCY_SAMPLES frames. The swap is when the driver took the
+frame, the display adds its own latency on top.
+=================
+*/
+void CL_Latency_f( void ) {
+	CL_LatencyPrint( "input to send:", &inputPacing.toSend );
+	CL_LatencyPrint( "input to swap:", &inputPacing.toSwap );
+	Com_Printf( "%-16s %.2f ms%s\n", "pacing hold:", inputPacing.holdUsec / 1000.0f,
+		inputPacing.active ? "" : " (inactive)" );
+}
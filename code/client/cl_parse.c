@@ -36,6 +36,8 @@ char *svc_strings[256] = {
 	"svc_EOF",
 	"svc_voipSpeex",
 	"svc_voipOpus",
+	"svc_configstringsDeflated",
+	"svc_serverCommandsDeflated",
 };
 
 void SHOWNET( msg_t *msg, char *s) {
@@ -322,6 +324,8 @@ void CL_ParseSnapshot( msg_t *msg ) {
 	}
 
 	cl.newSnapshots = qtrue;
+
+	CL_PacketScheduleSnapshot();
 }
 
 
@@ -454,6 +458,65 @@ static void CL_ParseServerInfo(void)
 		sizeof(clc.sv_dlURL));
 }
 
+/*
+==================
+CL_GamestateConfigstring
+==================
+*/
+static void CL_GamestateConfigstring( int index, const char *s ) {
+	int		len;
+
+	if ( index < 0 || index >= MAX_CONFIGSTRINGS ) {
+		Com_Error( ERR_DROP, "configstring > MAX_CONFIGSTRINGS" );
+	}
+	len = strlen( s );
+
+	if ( len + 1 + cl.gameState.dataCount > MAX_GAMESTATE_CHARS ) {
+		Com_Error( ERR_DROP, "MAX_GAMESTATE_CHARS exceeded" );
+	}
+
+	// append it to the gameState string buffer
+	cl.gameState.stringOffsets[ index ] = cl.gameState.dataCount;
+	Com_Memcpy( cl.gameState.stringData + cl.gameState.dataCount, s, len + 1 );
+	cl.gameState.dataCount += len + 1;
+}
+
+/*
+==================
+CL_ParseDeflatedConfigstrings
+
+All the configstrings as one deflated block of [short] index [string]
+records, see SV_SendClientGameState
+==================
+*/
+static void CL_ParseDeflatedConfigstrings( msg_t *msg ) {
+	static byte	packed[MAX_MSGLEN];
+	static char	data[MAX_GAMESTATE_CHARS + MAX_CONFIGSTRINGS * 3];
+	int			size, packedSize;
+	int			i, index;
+	char		*end;
+
+	size = MSG_ReadLong( msg );
+	packedSize = MSG_ReadLong( msg );
+	if ( size < 0 || size > sizeof( data ) || packedSize < 0 || packedSize > sizeof( packed ) ) {
+		Com_Error( ERR_DROP, "CL_ParseGamestate: bad deflated configstrings (%i, %i bytes)", size, packedSize );
+	}
+
+	MSG_ReadBitString( msg, packed, packedSize * 8 );
+	if ( msg->readcount > msg->cursize || MSG_Inflate( packed, packedSize, data, size ) != size ) {
+		Com_Error( ERR_DROP, "CL_ParseGamestate: bad deflated configstrings" );
+	}
+
+	for ( i = 0; i < size; i = end - data + 1 ) {
+		end = ( i + 2 < size ) ? memchr( data + i + 2, 0, size - i - 2 ) : NULL;
+		if ( !end ) {
+			Com_Error( ERR_DROP, "CL_ParseGamestate: truncated deflated configstrings" );
+		}
+		index = (byte)data[i] | ( (byte)data[i + 1] << 8 );
+		CL_GamestateConfigstring( index, data + i + 2 );
+	}
+}
+
 /*
 ==================
 CL_ParseGamestate
@@ -465,7 +528,6 @@ void CL_ParseGamestate( msg_t *msg ) {
 	int				newnum;
 	entityState_t	nullstate;
 	int				cmd;
-	char			*s;
 	char oldGame[MAX_QPATH];
 
 	Con_Close();
@@ -488,23 +550,10 @@ void CL_ParseGamestate( msg_t *msg ) {
 		}
 		
 		if ( cmd == svc_configstring ) {
-			int		len;
-
 			i = MSG_ReadShort( msg );
-			if ( i < 0 || i >= MAX_CONFIGSTRINGS ) {
-				Com_Error( ERR_DROP, "configstring > MAX_CONFIGSTRINGS" );
-			}
-			s = MSG_ReadBigString( msg );
-			len = strlen( s );
-
-			if ( len + 1 + cl.gameState.dataCount > MAX_GAMESTATE_CHARS ) {
-				Com_Error( ERR_DROP, "MAX_GAMESTATE_CHARS exceeded" );
-			}
-
-			// append it to the gameState string buffer
-			cl.gameState.stringOffsets[ i ] = cl.gameState.dataCount;
-			Com_Memcpy( cl.gameState.stringData + cl.gameState.dataCount, s, len + 1 );
-			cl.gameState.dataCount += len + 1;
+			CL_GamestateConfigstring( i, MSG_ReadBigString( msg ) );
+		} else if ( cmd == svc_configstringsDeflated ) {
+			CL_ParseDeflatedConfigstrings( msg );
 		} else if ( cmd == svc_baseline ) {
 			newnum = MSG_ReadBits( msg, GENTITYNUM_BITS );
 			if ( newnum < 0 || newnum >= MAX_GENTITIES ) {
@@ -532,6 +581,12 @@ void CL_ParseGamestate( msg_t *msg ) {
 	// parse serverId and other cvars
 	CL_SystemInfoChanged();
 
+	// demo_export only wants the parsed state, no media or cgame
+	if ( clc.demoExporting ) {
+		CL_DemoExportGamestate();
+		return;
+	}
+
 	// stop recording now so the demo won't have an unnecessary level load at the end.
 	if(cl_autoRecordDemo->integer && clc.demorecording)
 		CL_StopRecord_f();
@@ -670,29 +725,6 @@ qboolean CL_ShouldIgnoreVoipSender(int sender)
 	return qfalse;
 }
 
-/*
-=====================
-CL_PlayVoip
-
-Play raw data
-=====================
-*/
-
-static void CL_PlayVoip(int sender, int samplecnt, const byte *data, int flags)
-{
-	if(flags & VOIP_DIRECT)
-	{
-		S_RawSamples(sender + 1, samplecnt, 48000, 2, 1,
-	             data, clc.voipGain[sender], -1);
-	}
-
-	if(flags & VOIP_SPATIAL)
-	{
-		S_RawSamples(sender + MAX_CLIENTS + 1, samplecnt, 48000, 2, 1,
-	             data, 1.0f, sender);
-	}
-}
-
 /*
 =====================
 CL_ParseVoip
@@ -702,8 +734,6 @@ A VoIP message has been received from the server
 */
 static
 void CL_ParseVoip ( msg_t *msg, qboolean ignoreData ) {
-	static short decoded[VOIP_MAX_PACKET_SAMPLES*4]; // !!! FIXME: don't hard code
-
 	const int sender = MSG_ReadShort(msg);
 	const int generation = MSG_ReadByte(msg);
 	const int sequence = MSG_ReadLong(msg);
@@ -711,10 +741,6 @@ void CL_ParseVoip ( msg_t *msg, qboolean ignoreData ) {
 	const int packetsize = MSG_ReadShort(msg);
 	const int flags = MSG_ReadBits(msg, VOIP_FLAGCNT);
 	unsigned char encoded[4000];
-	int	numSamples;
-	int seqdiff;
-	int written = 0;
-	int i;
 
 	Com_DPrintf("VoIP: %d-byte packet from client %d\n", packetsize, sender);
 
@@ -753,73 +779,10 @@ void CL_ParseVoip ( msg_t *msg, qboolean ignoreData ) {
 		return;   // Channel is muted, bail.
 	}
 
-	// !!! FIXME: make sure data is narrowband? Does decoder handle this?
-
 	Com_DPrintf("VoIP: packet accepted!\n");
 
-	seqdiff = sequence - clc.voipIncomingSequence[sender];
-
-	// This is a new "generation" ... a new recording started, reset the bits.
-	if (generation != clc.voipIncomingGeneration[sender]) {
-		Com_DPrintf("VoIP: new generation %d!\n", generation);
-		opus_decoder_ctl(clc.opusDecoder[sender], OPUS_RESET_STATE);
-		clc.voipIncomingGeneration[sender] = generation;
-		seqdiff = 0;
-	} else if (seqdiff < 0) {   // we're ahead of the sequence?!
-		// This shouldn't happen unless the packet is corrupted or something.
-		Com_DPrintf("VoIP: misordered sequence! %d < %d!\n",
-		            sequence, clc.voipIncomingSequence[sender]);
-		// reset the decoder just in case.
-		opus_decoder_ctl(clc.opusDecoder[sender], OPUS_RESET_STATE);
-		seqdiff = 0;
-	} else if (seqdiff * VOIP_MAX_PACKET_SAMPLES*2 >= sizeof (decoded)) { // dropped more than we can handle?
-		// just start over.
-		Com_DPrintf("VoIP: Dropped way too many (%d) frames from client #%d\n",
-		            seqdiff, sender);
-		opus_decoder_ctl(clc.opusDecoder[sender], OPUS_RESET_STATE);
-		seqdiff = 0;
-	}
-
-	if (seqdiff != 0) {
-		Com_DPrintf("VoIP: Dropped %d frames from client #%d\n",
-		            seqdiff, sender);
-		// tell opus that we're missing frames...
-		for (i = 0; i < seqdiff; i++) {
-			assert((written + VOIP_MAX_PACKET_SAMPLES) * 2 < sizeof (decoded));
-			numSamples = opus_decode(clc.opusDecoder[sender], NULL, 0, decoded + written, VOIP_MAX_PACKET_SAMPLES, 0);
-			if ( numSamples <= 0 ) {
-				Com_DPrintf("VoIP: Error decoding frame %d from client #%d\n", i, sender);
-				continue;
-			}
-			written += numSamples;
-		}
-	}
-
-	numSamples = opus_decode(clc.opusDecoder[sender], encoded, packetsize, decoded + written, ARRAY_LEN(decoded) - written, 0);
-
-	if ( numSamples <= 0 ) {
-		Com_DPrintf("VoIP: Error decoding voip data from client #%d\n", sender);
-		numSamples = 0;
-	}
-
-	#if 0
-	static FILE *encio = NULL;
-	if (encio == NULL) encio = fopen("voip-incoming-encoded.bin", "wb");
-	if (encio != NULL) { fwrite(encoded, packetsize, 1, encio); fflush(encio); }
-	static FILE *decio = NULL;
-	if (decio == NULL) decio = fopen("voip-incoming-decoded.bin", "wb");
-	if (decio != NULL) { fwrite(decoded+written, numSamples*2, 1, decio); fflush(decio); }
-	#endif
-
-	written += numSamples;
-
-	Com_DPrintf("VoIP: playback %d bytes, %d samples, %d frames\n",
-	            written * 2, written, frames);
-
-	if(written > 0)
-		CL_PlayVoip(sender, written, (const byte *) decoded, flags);
-
-	clc.voipIncomingSequence[sender] = sequence + frames;
+	// sequencing and decoding happen on the VoIP worker
+	CL_VoipQueuePacket(sender, generation, sequence, frames, flags, encoded, packetsize);
 }
 #endif
 
@@ -832,14 +795,9 @@ Command strings are just saved off until cgame asks for them
 when it transitions a snapshot
 =====================
 */
-void CL_ParseCommandString( msg_t *msg ) {
-	char	*s;
-	int		seq;
+static void CL_StoreCommandString( int seq, const char *s ) {
 	int		index;
 
-	seq = MSG_ReadLong( msg );
-	s = MSG_ReadString( msg );
-
 	// see if we have already executed stored it off
 	if ( clc.serverCommandSequence >= seq ) {
 		return;
@@ -850,6 +808,60 @@ void CL_ParseCommandString( msg_t *msg ) {
 	Q_strncpyz( clc.serverCommands[ index ], s, sizeof( clc.serverCommands[ index ] ) );
 }
 
+void CL_ParseCommandString( msg_t *msg ) {
+	char	*s;
+	int		seq;
+
+	seq = MSG_ReadLong( msg );
+	s = MSG_ReadString( msg );
+
+	CL_StoreCommandString( seq, s );
+}
+
+/*
+=====================
+CL_ParseDeflatedCommandStrings
+
+The server's unacknowledged commands as one deflated block of strings,
+see SV_UpdateServerCommandsToClient
+=====================
+*/
+static void CL_ParseDeflatedCommandStrings( msg_t *msg ) {
+	static byte	packed[MAX_MSGLEN];
+	static char	data[MAX_RELIABLE_COMMANDS * MAX_STRING_CHARS];
+	int			first, last, size, packedSize;
+	int			i, seq;
+	char		*end;
+
+	first = MSG_ReadLong( msg );
+	last = MSG_ReadLong( msg );
+	size = MSG_ReadLong( msg );
+	packedSize = MSG_ReadLong( msg );
+	if ( last < first || last - first >= MAX_RELIABLE_COMMANDS || size < 0 || size > sizeof( data )
+		|| packedSize < 0 || packedSize > sizeof( packed ) ) {
+		Com_Error( ERR_DROP, "CL_ParseServerMessage: bad deflated commands (%i-%i, %i, %i bytes)", first, last, size, packedSize );
+	}
+
+	MSG_ReadBitString( msg, packed, packedSize * 8 );
+
+	// a resend of what we already have
+	if ( last <= clc.serverCommandSequence ) {
+		return;
+	}
+
+	if ( msg->readcount > msg->cursize || MSG_Inflate( packed, packedSize, data, size ) != size ) {
+		Com_Error( ERR_DROP, "CL_ParseServerMessage: bad deflated commands" );
+	}
+
+	for ( i = 0, seq = first; seq <= last; i = end - data + 1, seq++ ) {
+		end = ( i < size ) ? memchr( data + i, 0, size - i ) : NULL;
+		if ( !end ) {
+			Com_Error( ERR_DROP, "CL_ParseServerMessage: truncated deflated commands" );
+		}
+		CL_StoreCommandString( seq, data + i );
+	}
+}
+
 
 /*
 =====================
@@ -908,6 +920,9 @@ void CL_ParseServerMessage( msg_t *msg ) {
 		case svc_serverCommand:
 			CL_ParseCommandString( msg );
 			break;
+		case svc_serverCommandsDeflated:
+			CL_ParseDeflatedCommandStrings( msg );
+			break;
 		case svc_gamestate:
 			CL_ParseGamestate( msg );
 			break;
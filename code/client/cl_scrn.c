@@ -154,22 +154,22 @@ static void SCR_DrawChar( int x, int y, float size, int ch ) {
 }
 
 /*
-** SCR_DrawSmallChar
-** small chars are drawn at native screen resolution
+** SCR_SmallCharPic
+** fills in a small char at native screen resolution, qfalse for
+** nothing to draw; the color is left to the caller
 */
-void SCR_DrawSmallChar( int x, int y, int ch ) {
+qboolean SCR_SmallCharPic( int x, int y, int ch, stretchPic_t *pic ) {
 	glyphInfo_t *glyph;
-	float        w, h;
 	int          row, col;
 	float        frow, fcol, size;
 
 	ch &= 255;
 
 	if ( ch == ' ' ) {
-		return;
+		return qfalse;
 	}
 	if ( y < -g_smallchar_height ) {
-		return;
+		return qfalse;
 	}
 
 	/* Use the CoD1 font system when available.
@@ -186,17 +186,20 @@ void SCR_DrawSmallChar( int x, int y, int ch ) {
 		float scale_h = (float)g_smallchar_height / COD_FONT_LINE_H;
 		/* Cap rendered width to the cell — wide glyphs (m, w) are squished
 		   horizontally but keep their natural height, so they stay readable. */
-		w = glyph->imageWidth  * scale_h;
-		h = glyph->imageHeight * scale_h;
-		if ( w > g_smallchar_width )
-			w = g_smallchar_width;
+		pic->w = glyph->imageWidth  * scale_h;
+		pic->h = glyph->imageHeight * scale_h;
+		if ( pic->w > g_smallchar_width )
+			pic->w = g_smallchar_width;
 		/* Baseline alignment: shift each glyph down by the difference
 		   between the max ascender and this glyph's ascender. */
-		int y_off = (int)( (COD_FONT_ASCENDER - glyph->top) * scale_h );
-		re.DrawStretchPic( x, y + y_off, w, h,
-		                   glyph->s, glyph->t, glyph->s2, glyph->t2,
-		                   glyph->glyph );
-		return;
+		pic->x = x;
+		pic->y = y + (int)( (COD_FONT_ASCENDER - glyph->top) * scale_h );
+		pic->s1 = glyph->s;
+		pic->t1 = glyph->t;
+		pic->s2 = glyph->s2;
+		pic->t2 = glyph->t2;
+		pic->hShader = glyph->glyph;
+		return qtrue;
 	}
 
 	/* Fallback: Q3 charset grid */
@@ -205,10 +208,30 @@ void SCR_DrawSmallChar( int x, int y, int ch ) {
 	frow = row  * 0.0625f;
 	fcol = col  * 0.0625f;
 	size = 0.0625f;
-	re.DrawStretchPic( x, y, g_smallchar_width, g_smallchar_height,
-	                   fcol, frow,
-	                   fcol + size, frow + size,
-	                   cls.charSetShader );
+	pic->x = x;
+	pic->y = y;
+	pic->w = g_smallchar_width;
+	pic->h = g_smallchar_height;
+	pic->s1 = fcol;
+	pic->t1 = frow;
+	pic->s2 = fcol + size;
+	pic->t2 = frow + size;
+	pic->hShader = cls.charSetShader;
+	return qtrue;
+}
+
+/*
+** SCR_DrawSmallChar
+** small chars are drawn at native screen resolution
+*/
+void SCR_DrawSmallChar( int x, int y, int ch ) {
+	stretchPic_t pic;
+
+	if ( SCR_SmallCharPic( x, y, ch, &pic ) ) {
+		re.DrawStretchPic( pic.x, pic.y, pic.w, pic.h,
+		                   pic.s1, pic.t1, pic.s2, pic.t2,
+		                   pic.hShader );
+	}
 }
 
 
@@ -608,8 +631,10 @@ void SCR_UpdateScreen( void ) {
 			SCR_DrawScreenField( STEREO_CENTER );
 		}
 
-		if ( com_speeds->integer ) {
+		if ( com_speeds->integer || cl_timedemo->integer ) {
 			re.EndFrame( &time_frontend, &time_backend );
+			CL_BenchmarkTime( BENCH_FRONTEND, time_frontend * 1000 );
+			CL_BenchmarkTime( BENCH_BACKEND, time_backend * 1000 );
 		} else {
 			re.EndFrame( NULL, NULL );
 		}
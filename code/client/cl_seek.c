@@ -0,0 +1,284 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// cl_seek.c -- demo keyframes and demo_seek
+
+// Snapshots in a demo are delta compressed against earlier ones, so playback
+// can't simply start at a file offset. Every cl_demoKeyframeInterval seconds
+// of demo the parsed state a following message may depend on is kept: the
+// configstrings, the snapshot ring and the entities it points at, and any
+// server commands the cgame hasn't run yet, along with the file offset of
+// the next message. demo_seek restores the nearest keyframe at or before the
+// target, parses forward to it without drawing and starts the cgame over.
+// Keyframes are built as the demo plays, seeking past the last one builds
+// them on the way, and they last until the next gamestate.
+
+#include "client.h"
+
+#define	MAX_DEMO_KEYFRAMES	1024
+
+typedef struct {
+	int				offset;					// of the next message in the demo file
+	int				serverMessageSequence;
+	int				serverCommandSequence;
+	int				lastExecutedServerCommand;	// the ones after it follow the entities
+
+	clSnapshot_t	snap;
+	int				parseEntitiesNum;
+	int				firstEntity;			// oldest parse entity a snapshot refers to
+	gameState_t		gameState;
+	clSnapshot_t	snapshots[PACKET_BACKUP];
+} demoKeyframe_t;
+
+static demoKeyframe_t	*demoKeyframes[MAX_DEMO_KEYFRAMES];
+static int				demoNumKeyframes;
+static int				demoKeyframeGeneration;	// bumped when they are thrown away
+
+/*
+====================
+CL_DemoKeyframeClear
+
+The client state was wiped, the keyframes went with it
+====================
+*/
+void CL_DemoKeyframeClear( void ) {
+	int		i;
+
+	for ( i = 0; i < demoNumKeyframes; i++ ) {
+		free( demoKeyframes[i] );
+		demoKeyframes[i] = NULL;
+	}
+	demoNumKeyframes = 0;
+	demoKeyframeGeneration++;
+}
+
+/*
+====================
+CL_DemoKeyframe
+
+Called after each demo message is parsed
+====================
+*/
+void CL_DemoKeyframe( void ) {
+	demoKeyframe_t	*key;
+	entityState_t	*entities;
+	char			*commands;
+	int				firstEntity, numEntities;
+	int				size, len, i;
+
+	if ( !clc.demoplaying || !clc.demofile || !cl.snap.valid
+		|| cl.snap.messageNum != clc.serverMessageSequence ) {
+		return;
+	}
+
+	if ( demoNumKeyframes == MAX_DEMO_KEYFRAMES ) {
+		return;
+	}
+	if ( demoNumKeyframes && cl.snap.serverTime
+		< demoKeyframes[demoNumKeyframes - 1]->snap.serverTime + cl_demoKeyframeInterval->integer * 1000 ) {
+		return;
+	}
+
+	// the entities of every snapshot a later delta may still be against
+	firstEntity = cl.parseEntitiesNum;
+	for ( i = 0; i < PACKET_BACKUP; i++ ) {
+		if ( cl.snapshots[i].valid && cl.snap.messageNum - cl.snapshots[i].messageNum < PACKET_BACKUP
+			&& cl.snapshots[i].parseEntitiesNum < firstEntity ) {
+			firstEntity = cl.snapshots[i].parseEntitiesNum;
+		}
+	}
+	numEntities = cl.parseEntitiesNum - firstEntity;
+	if ( numEntities > MAX_PARSE_ENTITIES ) {
+		firstEntity = cl.parseEntitiesNum - MAX_PARSE_ENTITIES;
+		numEntities = MAX_PARSE_ENTITIES;
+	}
+
+	size = sizeof( *key ) + numEntities * sizeof( entityState_t );
+	for ( i = clc.lastExecutedServerCommand + 1; i <= clc.serverCommandSequence; i++ ) {
+		size += strlen( clc.serverCommands[i & ( MAX_RELIABLE_COMMANDS - 1 )] ) + 1;
+	}
+
+	key = malloc( size );
+	if ( !key ) {
+		return;
+	}
+
+	key->offset = FS_FTell( clc.demofile );
+	key->serverMessageSequence = clc.serverMessageSequence;
+	key->serverCommandSequence = clc.serverCommandSequence;
+	key->lastExecutedServerCommand = clc.lastExecutedServerCommand;
+
+	key->snap = cl.snap;
+	key->parseEntitiesNum = cl.parseEntitiesNum;
+	key->firstEntity = firstEntity;
+	key->gameState = cl.gameState;
+	Com_Memcpy( key->snapshots, cl.snapshots, sizeof( key->snapshots ) );
+
+	entities = (entityState_t *)( key + 1 );
+	for ( i = 0; i < numEntities; i++ ) {
+		entities[i] = cl.parseEntities[( firstEntity + i ) & ( MAX_PARSE_ENTITIES - 1 )];
+	}
+
+	commands = (char *)( entities + numEntities );
+	for ( i = clc.lastExecutedServerCommand + 1; i <= clc.serverCommandSequence; i++ ) {
+		len = strlen( clc.serverCommands[i & ( MAX_RELIABLE_COMMANDS - 1 )] ) + 1;
+		Com_Memcpy( commands, clc.serverCommands[i & ( MAX_RELIABLE_COMMANDS - 1 )], len );
+		commands += len;
+	}
+
+	demoKeyframes[demoNumKeyframes++] = key;
+}
+
+/*
+====================
+CL_DemoKeyframeRestore
+====================
+*/
+static void CL_DemoKeyframeRestore( const demoKeyframe_t *key ) {
+	const entityState_t	*entities;
+	const char			*commands;
+	int					numEntities;
+	int					i;
+
+	FS_Seek( clc.demofile, key->offset, FS_SEEK_SET );
+
+	clc.serverMessageSequence = key->serverMessageSequence;
+	clc.serverCommandSequence = key->serverCommandSequence;
+	clc.lastExecutedServerCommand = key->lastExecutedServerCommand;
+
+	cl.snap = key->snap;
+	cl.parseEntitiesNum = key->parseEntitiesNum;
+	cl.gameState = key->gameState;
+	Com_Memcpy( cl.snapshots, key->snapshots, sizeof( cl.snapshots ) );
+
+	numEntities = key->parseEntitiesNum - key->firstEntity;
+	entities = (const entityState_t *)( key + 1 );
+	for ( i = 0; i < numEntities; i++ ) {
+		cl.parseEntities[( key->firstEntity + i ) & ( MAX_PARSE_ENTITIES - 1 )] = entities[i];
+	}
+
+	commands = (const char *)( entities + numEntities );
+	for ( i = key->lastExecutedServerCommand + 1; i <= key->serverCommandSequence; i++ ) {
+		Q_strncpyz( clc.serverCommands[i & ( MAX_RELIABLE_COMMANDS - 1 )], commands, MAX_STRING_CHARS );
+		commands += strlen( commands ) + 1;
+	}
+}
+
+/*
+====================
+CL_DemoSkipServerCommands
+
+The cgame isn't running while seeking, the client still has to see the
+configstring changes
+====================
+*/
+static void CL_DemoSkipServerCommands( void ) {
+	int		i;
+
+	for ( i = clc.lastExecutedServerCommand + 1; i <= clc.serverCommandSequence; i++ ) {
+		CL_GetServerCommand( i );
+	}
+	clc.lastExecutedServerCommand = clc.serverCommandSequence;
+}
+
+/*
+====================
+CL_DemoSeek_f
+
+demo_seek <seconds | mm:ss | +seconds | -seconds>
+====================
+*/
+void CL_DemoSeek_f( void ) {
+	const char	*arg, *colon;
+	qboolean	relative;
+	int			start, target, msec;
+	int			generation;
+	int			i;
+
+	if ( Cmd_Argc() != 2 ) {
+		Com_Printf( "usage: demo_seek <seconds | mm:ss | +seconds | -seconds>\n" );
+		return;
+	}
+
+	if ( !clc.demoplaying || clc.state != CA_ACTIVE || !demoNumKeyframes ) {
+		Com_Printf( "Not playing a demo.\n" );
+		return;
+	}
+
+	arg = Cmd_Argv( 1 );
+	relative = ( arg[0] == '+' || arg[0] == '-' );
+	colon = strchr( arg, ':' );
+	if ( colon ) {
+		msec = ( atoi( arg + relative ) * 60 + atof( colon + 1 ) ) * 1000;
+	} else {
+		msec = atof( arg + relative ) * 1000;
+	}
+	if ( arg[0] == '-' ) {
+		msec = -msec;
+	}
+
+	// from the first snapshot of this gamestate, or from now
+	start = demoKeyframes[0]->snap.serverTime;
+	if ( relative ) {
+		target = cl.snap.serverTime + msec;
+	} else {
+		target = start + msec;
+	}
+	if ( target < start ) {
+		target = start;
+	}
+
+	// the nearest keyframe before the target, unless playing on from
+	// here gets there sooner
+	for ( i = demoNumKeyframes - 1; i > 0; i-- ) {
+		if ( demoKeyframes[i]->snap.serverTime <= target ) {
+			break;
+		}
+	}
+	if ( target < cl.snap.serverTime || demoKeyframes[i]->snap.serverTime > cl.snap.serverTime ) {
+		CL_DemoKeyframeRestore( demoKeyframes[i] );
+	}
+
+	generation = demoKeyframeGeneration;
+	CL_DemoSkipServerCommands();
+
+	while ( cl.snap.serverTime < target ) {
+		CL_ReadDemoMessage();
+
+		// the demo ended, or moved to another map and started over anyway
+		if ( !clc.demoplaying || generation != demoKeyframeGeneration ) {
+			return;
+		}
+
+		CL_DemoSkipServerCommands();
+	}
+
+	S_StopAllSounds();
+
+	// the cgame takes the latest snapshot as its first, with time
+	// set from it again once primed
+	cl.oldFrameServerTime = 0;
+	cl.newSnapshots = qtrue;
+	clc.firstDemoFrameSkipped = qfalse;
+	CL_RestartCGame();
+
+	Com_Printf( "demo_seek: %d:%02d\n", ( cl.snap.serverTime - start ) / 60000, ( ( cl.snap.serverTime - start ) / 1000 ) % 60 );
+}
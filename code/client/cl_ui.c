@@ -734,12 +734,16 @@ intptr_t CL_UISystemCalls( intptr_t *args ) {
 
 	case UI_CVAR_REGISTER:
 		Cvar_Register( VMA(1), VMA(2), VMA(3), args[4] ); 
+		Cvar_Track( CVAR_TRACK_UI, VMA(1) );
 		return 0;
 
 	case UI_CVAR_UPDATE:
 		Cvar_Update( VMA(1) );
 		return 0;
 
+	case UI_CVAR_UPDATE_CHANGED:
+		return Cvar_UpdateTracked( CVAR_TRACK_UI );
+
 	case UI_CVAR_SET:
 		Cvar_SetSafe( VMA(1), VMA(2) );
 		return 0;
@@ -1094,6 +1098,7 @@ void CL_ShutdownUI( void ) {
 	VM_Call( uivm, UI_SHUTDOWN );
 	VM_Free( uivm );
 	uivm = NULL;
+	Cvar_ClearTracked( CVAR_TRACK_UI );
 }
 
 /*
@@ -1116,7 +1121,10 @@ void CL_InitUI( void ) {
 			interpret = VMI_COMPILED;
 	}
 
+	Cvar_ClearTracked( CVAR_TRACK_UI );
+	PROFILE_BEGIN( "VM_Create ui" );
 	uivm = VM_Create( "ui", CL_UISystemCalls, interpret );
+	PROFILE_END();
 	if ( !uivm ) {
 		Com_Error( ERR_FATAL, "VM_Create on UI failed" );
 	}
@@ -1138,7 +1146,9 @@ void CL_InitUI( void ) {
 	}
 	else {
 		// init for this gamestate
+		PROFILE_BEGIN( "UI_INIT" );
 		VM_Call( uivm, UI_INIT, (clc.state >= CA_AUTHORIZING && clc.state < CA_ACTIVE) );
+		PROFILE_END();
 	}
 }
 
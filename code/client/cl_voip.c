@@ -0,0 +1,509 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// cl_voip.c -- Opus coding on an audio worker thread
+
+// The main thread parses and captures, the worker owns the encoder, the
+// decoders and the per talker jitter buffers. Everything crosses between
+// them through single producer, single consumer queues, and decoded audio
+// is handed to S_RawSamples back on the main thread in CL_VoipUpdate.
+
+#include "client.h"
+#include "snd_local.h"
+
+#ifdef USE_VOIP
+
+#define VOIP_MAX_ENCODED		1024	// clc.voipOutgoingData, ioq3 clients never send more
+#define VOIP_JITTER_PACKETS		8		// held per talker while waiting for a gap to fill
+#define VOIP_MAX_CONCEAL_FRAMES	( VOIP_MAX_PACKET_FRAMES * 4 )	// longer gaps just reset
+#define VOIP_WORKER_MSEC		5
+
+typedef struct {
+	int		sender;
+	int		generation;
+	int		sequence;
+	int		frames;
+	int		flags;
+	int		arrival;		// Sys_Milliseconds when parsed
+	int		len;
+	byte	data[VOIP_MAX_ENCODED];
+} voipIncoming_t;
+
+typedef struct {
+	int		sender;
+	int		flags;
+	int		samples;
+	int16_t	pcm[VOIP_MAX_PACKET_SAMPLES];
+} voipDecoded_t;
+
+typedef struct {
+	qboolean	reset;		// new generation, reset the encoder first
+	int		generation;
+	int		frames;
+	int		samples;
+	int16_t	pcm[VOIP_MAX_PACKET_SAMPLES];
+} voipCapture_t;
+
+typedef struct {
+	int		generation;
+	int		frames;
+	int		len;			// 0 if opus failed
+	byte	data[VOIP_MAX_ENCODED];
+} voipEncoded_t;
+
+typedef struct {
+	voipIncoming_t	pending[VOIP_JITTER_PACKETS];	// ordered by sequence
+	int		numPending;
+	int		generation;
+	int		sequence;		// next one we expect
+} voipTalker_t;
+
+static sndWorker_t	*voipWorker;
+static sndQueue_t	*voipIncomingQueue;	// main thread -> worker
+static sndQueue_t	*voipDecodedQueue;	// worker -> main thread
+static sndQueue_t	*voipCaptureQueue;	// main thread -> worker
+static sndQueue_t	*voipEncodedQueue;	// worker -> main thread
+
+// main thread
+static qboolean		voipEncoderReset;
+static qboolean		voipEncoding;		// a capture is out for encoding
+static voipCapture_t	voipCapture;
+static voipDecoded_t	voipOutput;
+static voipEncoded_t	voipEncoded;
+
+// worker thread
+static voipTalker_t	voipTalkers[MAX_CLIENTS];
+static voipIncoming_t	voipIncoming;
+static voipDecoded_t	voipDecoded;
+static voipCapture_t	voipCaptured;
+static voipEncoded_t	voipOutgoing;
+static int			voipJitterMsec;		// copied from cl_voipJitter by the main thread
+static int			voipDropped;		// decoded audio the main thread didn't keep up with
+
+
+/*
+=====================
+CL_VoipEmit
+
+Worker thread, hands decoded audio back to the main thread
+=====================
+*/
+static void CL_VoipEmit( int sender, int flags, int samples )
+{
+	if ( samples <= 0 )
+		return;
+
+	voipDecoded.sender = sender;
+	voipDecoded.flags = flags;
+	voipDecoded.samples = samples;
+
+	if ( !SNDDMA_QueuePush( voipDecodedQueue, &voipDecoded ) )
+		voipDropped++;
+}
+
+/*
+=====================
+CL_VoipConceal
+
+Worker thread, tells opus that frames went missing
+=====================
+*/
+static void CL_VoipConceal( int sender, int frames, int flags )
+{
+	while ( frames > 0 )
+	{
+		int count = frames;
+
+		if ( count > VOIP_MAX_PACKET_FRAMES )
+			count = VOIP_MAX_PACKET_FRAMES;
+
+		CL_VoipEmit( sender, flags, opus_decode( clc.opusDecoder[sender], NULL, 0,
+			voipDecoded.pcm, count * VOIP_MAX_FRAME_SAMPLES, 0 ) );
+
+		frames -= count;
+	}
+}
+
+/*
+=====================
+CL_VoipJitterRelease
+
+Worker thread, decodes what is contiguous at the head of a talker's buffer.
+A gap is waited on for voipJitterMsec after the packet behind it arrived,
+unless force is set because the buffer is full.
+=====================
+*/
+static void CL_VoipJitterRelease( int sender, int now, qboolean force )
+{
+	voipTalker_t *talker = &voipTalkers[sender];
+	voipIncoming_t *packet;
+	int gap, error;
+
+	if ( talker->numPending && !clc.opusDecoder[sender] )
+	{
+		clc.opusDecoder[sender] = opus_decoder_create( 48000, 1, &error );
+		if ( error )
+		{
+			// the worker has no console to complain on, drop the talk
+			clc.opusDecoder[sender] = NULL;
+			talker->numPending = 0;
+			return;
+		}
+	}
+
+	while ( talker->numPending )
+	{
+		packet = &talker->pending[0];
+
+		// This is a new "generation" ... a new recording started, reset the bits.
+		if ( packet->generation != talker->generation )
+		{
+			opus_decoder_ctl( clc.opusDecoder[sender], OPUS_RESET_STATE );
+			talker->generation = packet->generation;
+			talker->sequence = packet->sequence;
+		}
+
+		gap = packet->sequence - talker->sequence;
+
+		if ( gap > 0 )
+		{
+			if ( !force && now - packet->arrival < voipJitterMsec )
+				break;  // give the missing packets a chance to turn up
+
+			if ( gap > VOIP_MAX_CONCEAL_FRAMES )
+				opus_decoder_ctl( clc.opusDecoder[sender], OPUS_RESET_STATE );
+			else
+				CL_VoipConceal( sender, gap, packet->flags );
+
+			force = qfalse;
+		}
+
+		// anything behind the sequence is late or a duplicate and has
+		// already been concealed
+		if ( gap >= 0 )
+		{
+			CL_VoipEmit( sender, packet->flags, opus_decode( clc.opusDecoder[sender],
+				packet->data, packet->len, voipDecoded.pcm, VOIP_MAX_PACKET_SAMPLES, 0 ) );
+			talker->sequence = packet->sequence + packet->frames;
+		}
+
+		talker->numPending--;
+		memmove( talker->pending, talker->pending + 1, talker->numPending * sizeof( *packet ) );
+	}
+}
+
+/*
+=====================
+CL_VoipJitterInsert
+
+Worker thread
+=====================
+*/
+static void CL_VoipJitterInsert( const voipIncoming_t *in, int now )
+{
+	voipTalker_t *talker = &voipTalkers[in->sender];
+	int i;
+
+	// whatever the head is waiting for isn't coming
+	if ( talker->numPending == VOIP_JITTER_PACKETS )
+		CL_VoipJitterRelease( in->sender, now, qtrue );
+
+	// keep it ordered, a new generation goes after the old one
+	for ( i = talker->numPending; i > 0; i-- )
+	{
+		const voipIncoming_t *packet = &talker->pending[i - 1];
+
+		if ( packet->generation != in->generation || packet->sequence <= in->sequence )
+			break;
+
+		talker->pending[i] = *packet;
+	}
+
+	talker->pending[i] = *in;
+	talker->numPending++;
+}
+
+/*
+=====================
+CL_VoipWork
+
+Runs on the worker, or on the main thread from CL_VoipUpdate if there
+is no worker
+=====================
+*/
+static void CL_VoipWork( void *arg )
+{
+	int now;
+	int i;
+
+	while ( SNDDMA_QueuePop( voipCaptureQueue, &voipCaptured ) )
+	{
+		if ( voipCaptured.reset )
+			opus_encoder_ctl( clc.opusEncoder, OPUS_RESET_STATE );
+
+		voipOutgoing.generation = voipCaptured.generation;
+		voipOutgoing.frames = voipCaptured.frames;
+		voipOutgoing.len = opus_encode( clc.opusEncoder, voipCaptured.pcm, voipCaptured.samples,
+			voipOutgoing.data, sizeof( voipOutgoing.data ) );
+		if ( voipOutgoing.len < 0 )
+			voipOutgoing.len = 0;
+
+		// can't be full, there is only ever one capture out
+		SNDDMA_QueuePush( voipEncodedQueue, &voipOutgoing );
+	}
+
+	now = Sys_Milliseconds();
+
+	while ( SNDDMA_QueuePop( voipIncomingQueue, &voipIncoming ) )
+		CL_VoipJitterInsert( &voipIncoming, now );
+
+	for ( i = 0; i < MAX_CLIENTS; i++ )
+	{
+		if ( voipTalkers[i].numPending )
+			CL_VoipJitterRelease( i, now, qfalse );
+	}
+}
+
+/*
+=====================
+CL_VoipStartWorker
+
+Called once the codecs exist
+=====================
+*/
+void CL_VoipStartWorker( void )
+{
+	if ( voipIncomingQueue )
+		return;
+
+	voipIncomingQueue = SNDDMA_CreateQueue( sizeof( voipIncoming_t ), 256 );
+	voipDecodedQueue = SNDDMA_CreateQueue( sizeof( voipDecoded_t ), 128 );
+	voipCaptureQueue = SNDDMA_CreateQueue( sizeof( voipCapture_t ), 1 );
+	voipEncodedQueue = SNDDMA_CreateQueue( sizeof( voipEncoded_t ), 1 );
+
+	Com_Memset( voipTalkers, 0, sizeof( voipTalkers ) );
+	voipEncoderReset = qfalse;
+	voipEncoding = qfalse;
+	voipDropped = 0;
+	voipJitterMsec = cl_voipJitter->integer;
+
+	voipWorker = SNDDMA_StartWorker( "voip", CL_VoipWork, NULL, VOIP_WORKER_MSEC );
+	if ( !voipWorker )
+		Com_DPrintf( "VoIP: no worker thread, coding on the main thread\n" );
+}
+
+/*
+=====================
+CL_VoipStopWorker
+
+Called before the codecs are destroyed, drops anything in flight
+=====================
+*/
+void CL_VoipStopWorker( void )
+{
+	if ( !voipIncomingQueue )
+		return;
+
+	if ( voipWorker )
+	{
+		SNDDMA_StopWorker( voipWorker );
+		voipWorker = NULL;
+	}
+
+	SNDDMA_FreeQueue( voipIncomingQueue );
+	SNDDMA_FreeQueue( voipDecodedQueue );
+	SNDDMA_FreeQueue( voipCaptureQueue );
+	SNDDMA_FreeQueue( voipEncodedQueue );
+	voipIncomingQueue = NULL;
+	voipDecodedQueue = NULL;
+	voipCaptureQueue = NULL;
+	voipEncodedQueue = NULL;
+
+	voipEncoding = qfalse;
+}
+
+/*
+=====================
+CL_VoipQueuePacket
+
+Hands a packet parsed from the server to the jitter buffers
+=====================
+*/
+void CL_VoipQueuePacket( int sender, int generation, int sequence, int frames, int flags,
+	const byte *data, int len )
+{
+	voipIncoming_t in;
+
+	if ( !voipIncomingQueue )
+		return;
+
+	if ( len > sizeof( in.data ) ) {
+		Com_DPrintf( "VoIP: %d-byte packet from client %d is too large\n", len, sender );
+		return;
+	}
+
+	in.sender = sender;
+	in.generation = generation;
+	in.sequence = sequence;
+	in.frames = frames;
+	in.flags = flags;
+	in.arrival = Sys_Milliseconds();
+	in.len = len;
+	Com_Memcpy( in.data, data, len );
+
+	if ( !SNDDMA_QueuePush( voipIncomingQueue, &in ) ) {
+		Com_DPrintf( "VoIP: dropped packet from client %d, decoder is behind\n", sender );
+		return;
+	}
+
+	if ( voipWorker )
+		SNDDMA_WakeWorker( voipWorker );
+}
+
+/*
+=====================
+CL_VoipResetEncoder
+
+The next capture starts a new generation
+=====================
+*/
+void CL_VoipResetEncoder( void )
+{
+	voipEncoderReset = qtrue;
+}
+
+/*
+=====================
+CL_VoipEncoding
+
+qtrue while a capture is out for encoding, nothing more should be
+recorded until CL_VoipUpdate has collected it
+=====================
+*/
+qboolean CL_VoipEncoding( void )
+{
+	return voipEncoding;
+}
+
+/*
+=====================
+CL_VoipQueueCapture
+
+Sends captured audio off to be encoded into clc.voipOutgoingData
+=====================
+*/
+qboolean CL_VoipQueueCapture( const int16_t *samples, int count, int frames )
+{
+	if ( !voipCaptureQueue || voipEncoding )
+		return qfalse;
+
+	voipCapture.reset = voipEncoderReset;
+	voipCapture.generation = clc.voipOutgoingGeneration;
+	voipCapture.frames = frames;
+	voipCapture.samples = count;
+	Com_Memcpy( voipCapture.pcm, samples, count * sizeof( *samples ) );
+
+	if ( !SNDDMA_QueuePush( voipCaptureQueue, &voipCapture ) )
+		return qfalse;
+
+	voipEncoderReset = qfalse;
+	voipEncoding = qtrue;
+
+	if ( voipWorker )
+		SNDDMA_WakeWorker( voipWorker );
+
+	return qtrue;
+}
+
+/*
+=====================
+CL_PlayVoip
+
+Play raw data
+=====================
+*/
+static void CL_PlayVoip(int sender, int samplecnt, const byte *data, int flags)
+{
+	if(flags & VOIP_DIRECT)
+	{
+		S_RawSamples(sender + 1, samplecnt, 48000, 2, 1,
+	             data, clc.voipGain[sender], -1);
+	}
+
+	if(flags & VOIP_SPATIAL)
+	{
+		S_RawSamples(sender + MAX_CLIENTS + 1, samplecnt, 48000, 2, 1,
+	             data, 1.0f, sender);
+	}
+}
+
+/*
+=====================
+CL_VoipUpdate
+
+Collects whatever the worker has finished, once a frame
+=====================
+*/
+void CL_VoipUpdate( void )
+{
+	if ( !voipIncomingQueue )
+		return;
+
+	voipJitterMsec = cl_voipJitter->integer;
+
+	if ( !voipWorker )
+		CL_VoipWork( NULL );
+
+	while ( SNDDMA_QueuePop( voipDecodedQueue, &voipOutput ) )
+	{
+		Com_DPrintf( "VoIP: playback %d samples from client #%d\n",
+		            voipOutput.samples, voipOutput.sender );
+
+		CL_PlayVoip( voipOutput.sender, voipOutput.samples,
+			(const byte *) voipOutput.pcm, voipOutput.flags );
+	}
+
+	if ( voipDropped ) {
+		Com_DPrintf( "VoIP: playback fell behind, dropped %d buffers\n", voipDropped );
+		voipDropped = 0;
+	}
+
+	if ( SNDDMA_QueuePop( voipEncodedQueue, &voipEncoded ) )
+	{
+		voipEncoding = qfalse;
+
+		if ( voipEncoded.generation != clc.voipOutgoingGeneration )
+			return;  // talking stopped while it was being encoded
+
+		if ( voipEncoded.len <= 0 ) {
+			Com_DPrintf( "VoIP: Error encoding %d frames\n", voipEncoded.frames );
+			return;
+		}
+
+		Com_Memcpy( clc.voipOutgoingData, voipEncoded.data, voipEncoded.len );
+		clc.voipOutgoingDataSize = voipEncoded.len;
+		clc.voipOutgoingDataFrames = voipEncoded.frames;
+
+		Com_DPrintf( "VoIP: Send %d frames, %d bytes, %f power\n",
+		            voipEncoded.frames, voipEncoded.len, clc.voipPower );
+	}
+}
+#endif
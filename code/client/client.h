@@ -105,6 +105,16 @@ typedef struct {
 									// cleared when CL_AdjustTimeDelta looks at it
 	qboolean	newSnapshots;		// set on parse of any valid packet
 
+	// snapshot jitter buffer, the PACKET_BACKUP snapshot ring is the buffer
+	// and cl.serverTime is held back by jitterDelay to keep it filled
+	int			lastSnapTransit;	// snap.serverTime - cls.realtime of the last arrival
+	int			lastSnapMessageNum;	// to count snapshots that never arrived
+	int			snapJitter;			// mean arrival deviation in msec, scaled by 16
+	int			jitterDelay;		// extra msec subtracted from cl.serverTime
+	int			lateSnapshots;		// cgame ran past the newest snapshot
+	int			droppedSnapshots;	// snapshots lost or dropped on the way
+	int			lastLateMessageNum;	// count each late snapshot only once
+
 	gameState_t	gameState;			// configstrings
 	char		mapname[MAX_QPATH];	// extracted from CS_SERVERINFO
 
@@ -201,7 +211,6 @@ typedef struct {
 #ifdef USE_HTTP
 	qboolean	httpUsed;
 	qboolean	disconnectedForHttpDownload;
-	char		downloadURL[MAX_OSPATH];
 #endif /* USE_HTTP */
 	int		sv_allowDownload;
 	char		sv_dlURL[MAX_CVAR_VALUE_STRING];
@@ -217,6 +226,7 @@ typedef struct {
 	qboolean	spDemoRecording;
 	qboolean	demorecording;
 	qboolean	demoplaying;
+	qboolean	demoExporting;	// demo_export, parsing only
 	qboolean	demowaiting;	// don't record until a non-delta message is received
 	qboolean	firstDemoFrameSkipped;
 	fileHandle_t	demofile;
@@ -239,8 +249,6 @@ typedef struct {
 	// incoming data...
 	// !!! FIXME: convert from parallel arrays to array of a struct.
 	OpusDecoder *opusDecoder[MAX_CLIENTS];
-	byte voipIncomingGeneration[MAX_CLIENTS];
-	int voipIncomingSequence[MAX_CLIENTS];
 	float voipGain[MAX_CLIENTS];
 	qboolean voipIgnore[MAX_CLIENTS];
 	qboolean voipMuteAll;
@@ -372,10 +380,13 @@ extern	cvar_t	*cl_noprint;
 extern	cvar_t	*cl_timegraph;
 extern	cvar_t	*cl_maxpackets;
 extern	cvar_t	*cl_packetdup;
+extern	cvar_t	*cl_packetSchedule;
 extern	cvar_t	*cl_shownet;
 extern	cvar_t	*cl_showSend;
 extern	cvar_t	*cl_timeNudge;
 extern	cvar_t	*cl_showTimeDelta;
+extern	cvar_t	*cl_jitterBuffer;
+extern	cvar_t	*cl_jitterBufferMax;
 extern	cvar_t	*cl_freezeDemo;
 
 extern	cvar_t	*cl_yawspeed;
@@ -409,12 +420,23 @@ extern	cvar_t	*j_side_axis;
 extern	cvar_t	*j_up_axis;
 
 extern	cvar_t	*cl_timedemo;
+extern	cvar_t	*cl_timedemoLog;
+extern	cvar_t	*cl_timedemoPasses;
+extern	cvar_t	*cl_timedemoWarmup;
+extern	cvar_t	*cl_demoKeyframeInterval;
+extern	cvar_t	*cl_headless;
+extern	cvar_t	*cl_inputPacing;
 extern	cvar_t	*cl_aviFrameRate;
 extern	cvar_t	*cl_aviMotionJpeg;
+extern	cvar_t	*cl_aviThreads;
+extern	cvar_t	*cl_aviImages;
 
 extern	cvar_t	*cl_activeAction;
 
 extern	cvar_t	*cl_allowDownload;
+#ifdef USE_HTTP
+extern	cvar_t	*cl_httpDownloads;
+#endif
 extern  cvar_t  *cl_downloadMethod;
 extern	cvar_t	*cl_conXOffset;
 extern	cvar_t	*cl_inGameVideo;
@@ -441,6 +463,7 @@ extern	cvar_t	*cl_voipGainDuringCapture;
 extern	cvar_t	*cl_voipCaptureMult;
 extern	cvar_t	*cl_voipShowMeter;
 extern	cvar_t	*cl_voip;
+extern	cvar_t	*cl_voipJitter;
 
 // 20ms at 48k
 #define VOIP_MAX_FRAME_SAMPLES		( 20 * 48 )
@@ -468,6 +491,8 @@ void CL_Snd_Restart_f (void);
 void CL_StartDemoLoop( void );
 void CL_NextDemo( void );
 void CL_ReadDemoMessage( void );
+qboolean CL_ReadDemoFileMessage( msg_t *buf );
+int CL_OpenDemoFile( const char *arg, char *name, fileHandle_t *demofile );
 void CL_StopRecord_f(void);
 
 void CL_InitDownloads(void);
@@ -501,6 +526,7 @@ void CL_ShutdownInput(void);
 void CL_SendCmd (void);
 void CL_ClearState (void);
 void CL_ReadPackets (void);
+void CL_PacketScheduleSnapshot( void );
 
 void CL_WritePacket( void );
 void IN_CenterView (void);
@@ -521,6 +547,56 @@ extern int cl_connectedToCheatServer;
 void CL_Voip_f( void );
 #endif
 
+//
+// cl_seek.c
+//
+void CL_DemoKeyframeClear( void );
+void CL_DemoKeyframe( void );
+void CL_DemoSeek_f( void );
+
+//
+// cl_export.c
+//
+void CL_DemoExportGamestate( void );
+void CL_DemoExport_f( void );
+
+//
+// cl_pacing.c
+//
+void CL_InputPacingSent( void );
+void CL_InputPacingFrame( void );
+void CL_Latency_f( void );
+
+//
+// cl_bench.c
+//
+typedef enum {
+	BENCH_CGAME,
+	BENCH_FRONTEND,
+	BENCH_BACKEND,
+	BENCH_SOUND,
+	BENCH_NUM_TIMES
+} benchTime_t;
+
+void CL_BenchmarkDemo( const char *demo );
+void CL_BenchmarkTime( benchTime_t which, int usec );
+void CL_BenchmarkFrame( void );
+qboolean CL_BenchmarkCompleted( void );
+
+//
+// cl_voip.c
+//
+#ifdef USE_VOIP
+void CL_VoipStartWorker( void );
+void CL_VoipStopWorker( void );
+void CL_VoipUpdate( void );
+void CL_VoipQueuePacket( int sender, int generation, int sequence, int frames, int flags,
+	const byte *data, int len );
+void CL_VoipResetEncoder( void );
+qboolean CL_VoipEncoding( void );
+qboolean CL_VoipQueueCapture( const int16_t *samples, int count, int frames );
+#endif
+
 void CL_SystemInfoChanged( void );
 void CL_ParseServerMessage( msg_t *msg );
 
@@ -580,6 +656,7 @@ void	SCR_DrawBigString( int x, int y, const char *s, float alpha, qboolean noCol
 void	SCR_DrawBigStringColor( int x, int y, const char *s, vec4_t color, qboolean noColorEscape );	// ignores embedded color control characters
 void	SCR_DrawSmallStringExt( int x, int y, const char *string, float *setColor, qboolean forceColor, qboolean noColorEscape );
 void	SCR_DrawSmallChar( int x, int y, int ch );
+qboolean	SCR_SmallCharPic( int x, int y, int ch, stretchPic_t *pic );
 
 
 //
@@ -604,6 +681,8 @@ void CIN_CloseAllVideos(void);
 //
 void CL_InitCGame( void );
 void CL_ShutdownCGame( void );
+void CL_RestartCGame( void );
+qboolean CL_GetServerCommand( int serverCommandNumber );
 qboolean CL_GameCommand( void );
 void CL_CGameRendering( stereoFrame_t stereo );
 void CL_SetCGameTime( void );
@@ -152,74 +152,61 @@ void S_AdpcmEncode( short indata[], char outdata[], int len, struct adpcm_state
 }
 
 
-/* static */ void S_AdpcmDecode( const char indata[], short *outdata, int len, struct adpcm_state *state ) {
-    signed char *inp;		/* Input buffer pointer */
-    int outp;			/* output buffer pointer */
-    int sign;			/* Current adpcm sign bit */
-    int delta;			/* Current adpcm output value */
-    int step;			/* Stepsize */
-    int valpred;		/* Predicted value */
-    int vpdiff;			/* Current change to valpred */
-    int index;			/* Current step change index */
-    int inputbuffer;		/* place to keep next 4-bit value */
-    int bufferstep;		/* toggle between inputbuffer/input */
+/*
+** The decoder is table driven instead: for each step index and 4-bit code,
+** the signed change to the predicted value and the next step index.
+*/
+static int adpcmDiffTable[89][16];
+static byte adpcmIndexTable[89][16];
+static qboolean adpcmTablesBuilt;
 
-    outp = 0;
-    inp = (signed char *)indata;
+static void S_AdpcmBuildTables( void ) {
+    int index, delta, step, vpdiff, next;
 
-    valpred = state->sample;
-    index = state->index;
-    step = stepsizeTable[index];
+    for ( index = 0 ; index < 89 ; index++ ) {
+		step = stepsizeTable[index];
 
-    bufferstep = 0;
-    inputbuffer = 0;	// quiet a compiler warning
-    for ( ; len > 0 ; len-- ) {
-		
-		/* Step 1 - get the delta value */
-		if ( bufferstep ) {
-			delta = inputbuffer & 0xf;
-		} else {
-			inputbuffer = *inp++;
-			delta = (inputbuffer >> 4) & 0xf;
+		for ( delta = 0 ; delta < 16 ; delta++ ) {
+			vpdiff = step >> 3;
+			if ( delta & 4 ) vpdiff += step;
+			if ( delta & 2 ) vpdiff += step>>1;
+			if ( delta & 1 ) vpdiff += step>>2;
+			adpcmDiffTable[index][delta] = ( delta & 8 ) ? -vpdiff : vpdiff;
+
+			next = index + indexTable[delta];
+			if ( next < 0 ) next = 0;
+			if ( next > 88 ) next = 88;
+			adpcmIndexTable[index][delta] = next;
 		}
-		bufferstep = !bufferstep;
+    }
 
-		/* Step 2 - Find new index value (for later) */
-		index += indexTable[delta];
-		if ( index < 0 ) index = 0;
-		if ( index > 88 ) index = 88;
+    adpcmTablesBuilt = qtrue;
+}
 
-		/* Step 3 - Separate sign and magnitude */
-		sign = delta & 8;
-		delta = delta & 7;
+/* static */ void S_AdpcmDecode( const char indata[], short *outdata, int len, struct adpcm_state *state ) {
+    const byte *inp;		/* Input buffer pointer */
+    int valpred;		/* Predicted value */
+    int index;			/* Current step change index */
+    int delta;			/* Current adpcm output value */
+    int i;
 
-		/* Step 4 - Compute difference and new predicted value */
-		/*
-		** Computes 'vpdiff = (delta+0.5)*step/4', but see comment
-		** in adpcm_coder.
-		*/
-		vpdiff = step >> 3;
-		if ( delta & 4 ) vpdiff += step;
-		if ( delta & 2 ) vpdiff += step>>1;
-		if ( delta & 1 ) vpdiff += step>>2;
+    inp = (const byte *)indata;
 
-		if ( sign )
-		  valpred -= vpdiff;
-		else
-		  valpred += vpdiff;
+    valpred = state->sample;
+    index = state->index;
 
-		/* Step 5 - clamp output value */
+    /* two codes a byte, high nibble first */
+    for ( i = 0 ; i < len ; i++ ) {
+		delta = ( i & 1 ) ? ( inp[i >> 1] & 0xf ) : ( inp[i >> 1] >> 4 );
+
+		valpred += adpcmDiffTable[index][delta];
 		if ( valpred > 32767 )
 		  valpred = 32767;
 		else if ( valpred < -32768 )
 		  valpred = -32768;
 
-		/* Step 6 - Update step value */
-		step = stepsizeTable[index];
-
-		/* Step 7 - Output value */
-		outdata[outp] = valpred;
-		outp++;
+		index = adpcmIndexTable[index][delta];
+		outdata[i] = valpred;
     }
 
     state->sample = valpred;
@@ -295,6 +282,10 @@ void S_AdpcmEncodeSound( sfx_t *sfx, short *samples ) {
 	sndBuffer		*newchunk, *chunk;
 	byte			*out;
 
+	if ( !adpcmTablesBuilt ) {
+		S_AdpcmBuildTables();
+	}
+
 	inOffset = 0;
 	count = sfx->soundLength;
 	state.index = 0;
@@ -328,3 +319,69 @@ void S_AdpcmEncodeSound( sfx_t *sfx, short *samples ) {
 		count -= n;
 	}
 }
+
+
+/*
+====================
+S_AdpcmStoredSize
+
+Bytes S_AdpcmStoreSound writes for a sound of this many samples
+====================
+*/
+int S_AdpcmStoredSize( int samples ) {
+	int		blocks;
+
+	blocks = ( samples + SND_CHUNK_SIZE_BYTE*2 - 1 ) / ( SND_CHUNK_SIZE_BYTE*2 );
+	return blocks * ADPCM_STORED_BLOCK;
+}
+
+/*
+====================
+S_AdpcmStoreSound
+
+Flattens the encoded chunks of an adpcm sound, each one as its starting
+state followed by the packed codes
+====================
+*/
+void S_AdpcmStoreSound( const sfx_t *sfx, byte *out ) {
+	const sndBuffer	*chunk;
+
+	for ( chunk = sfx->soundData ; chunk ; chunk = chunk->next ) {
+		((short *)out)[0] = chunk->adpcm.sample;
+		((short *)out)[1] = chunk->adpcm.index;
+		Com_Memcpy( out + 4, chunk->sndChunk, SND_CHUNK_SIZE_BYTE );
+		out += ADPCM_STORED_BLOCK;
+	}
+}
+
+/*
+====================
+S_AdpcmLoadSound
+
+Pages in what S_AdpcmStoreSound wrote, sfx->soundLength must be set
+====================
+*/
+void S_AdpcmLoadSound( sfx_t *sfx, const byte *in ) {
+	sndBuffer	*newchunk, *chunk;
+	int			count;
+
+	if ( !adpcmTablesBuilt ) {
+		S_AdpcmBuildTables();
+	}
+
+	chunk = NULL;
+	for ( count = sfx->soundLength ; count > 0 ; count -= SND_CHUNK_SIZE_BYTE*2 ) {
+		newchunk = SND_malloc();
+		if (sfx->soundData == NULL) {
+			sfx->soundData = newchunk;
+		} else if (chunk != NULL) {
+			chunk->next = newchunk;
+		}
+		chunk = newchunk;
+
+		chunk->adpcm.sample = ((const short *)in)[0];
+		chunk->adpcm.index = ((const short *)in)[1];
+		Com_Memcpy( chunk->sndChunk, in + 4, SND_CHUNK_SIZE_BYTE );
+		in += ADPCM_STORED_BLOCK;
+	}
+}
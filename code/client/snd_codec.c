@@ -157,6 +157,65 @@ void S_CodecRegister(snd_codec_t *codec)
 	codecs = codec;
 }
 
+/*
+=================
+S_CodecContentKey
+
+Gets the content key of the file S_CodecLoad would read, trying the
+same names in the same order.  Returns qfalse when the file doesn't
+come from a pk3.
+=================
+*/
+qboolean S_CodecContentKey(const char *filename, unsigned int *crc, unsigned int *length)
+{
+	snd_codec_t *codec;
+	snd_codec_t *orgCodec = NULL;
+	char		localName[ MAX_QPATH ];
+	const char	*ext;
+	char		altName[ MAX_QPATH ];
+	int			found;
+
+	*crc = 0;
+	*length = 0;
+
+	Q_strncpyz(localName, filename, MAX_QPATH);
+
+	ext = COM_GetExtension(localName);
+
+	if( *ext )
+	{
+		for( codec = codecs; codec; codec = codec->next )
+		{
+			if( !Q_stricmp( ext, codec->ext ) )
+				break;
+		}
+
+		if( codec )
+		{
+			found = FS_FileContentKey( localName, crc, length );
+			if( found >= 0 )
+				return found > 0;
+
+			orgCodec = codec;
+			COM_StripExtension( filename, localName, MAX_QPATH );
+		}
+	}
+
+	for( codec = codecs; codec; codec = codec->next )
+	{
+		if( codec == orgCodec )
+			continue;
+
+		Com_sprintf( altName, sizeof (altName), "%s.%s", localName, codec->ext );
+
+		found = FS_FileContentKey( altName, crc, length );
+		if( found >= 0 )
+			return found > 0;
+	}
+
+	return qfalse;
+}
+
 /*
 =================
 S_CodecLoad
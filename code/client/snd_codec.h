@@ -71,6 +71,7 @@ void S_CodecInit( void );
 void S_CodecShutdown( void );
 void S_CodecRegister(snd_codec_t *codec);
 void *S_CodecLoad(const char *filename, snd_info_t *info);
+qboolean S_CodecContentKey(const char *filename, unsigned int *crc, unsigned int *length);
 snd_stream_t *S_CodecOpenStream(const char *filename);
 void S_CodecCloseStream(snd_stream_t *stream);
 int S_CodecReadStream(snd_stream_t *stream, int bytes, void *buffer);
@@ -34,8 +34,12 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "client.h"
 
 void S_Update_( void );
+static void S_UpdateSoundStreams( void );
+static void S_StopSoundStreams( void );
+static void S_StartSoundStream( sfx_t *sfx, vec3_t origin, int entityNum, qboolean localSound );
 void S_Base_StopAllSounds(void);
 void S_Base_StopBackgroundTrack( void );
+void S_Base_ClearSoundBuffer( void );
 
 snd_stream_t	*s_backgroundStream = NULL;
 static char		s_backgroundLoop[MAX_QPATH];
@@ -67,15 +71,33 @@ static vec3_t		listener_axis[3];
 int			s_soundtime;		// sample PAIRS
 int   		s_paintedtime; 		// sample PAIRS
 
-// MAX_SFX may be larger than MAX_SOUNDS because
-// of custom player sounds
-#define		MAX_SFX			4096
 sfx_t		s_knownSfx[MAX_SFX];
 int			s_numSfx = 0;
 
-#define		LOOP_HASH		128
-static	sfx_t		*sfxHash[LOOP_HASH];
-
+static	sfxRegistry_t	s_sfxRegistry;
+
+// streamed sfx, decoded into the raw streams from RAW_STREAM_SOUNDS up
+typedef struct {
+	snd_stream_t	*stream;
+	int				entityNum;		// -1 for full volume
+	qboolean		fixedOrigin;
+	vec3_t			origin;
+	int				cluster;		// with origin
+	int				startTime;
+} soundStream_t;
+
+static soundStream_t	s_soundStreams[MAX_SOUND_STREAMS];
+
+// set while S_MixThread owns mixing, the game thread then only queues
+static qboolean	s_mixThreadActive;
+static int		s_droppedSounds;
+
+cvar_t		*s_mixThread;
+cvar_t		*s_streamSize;
+cvar_t		*s_resampleCache;
+cvar_t		*s_occlusion;
+cvar_t		*s_compression;
+cvar_t		*s_precacheThreads;
 cvar_t		*s_testsound;
 cvar_t		*s_show;
 cvar_t		*s_mixahead;
@@ -170,9 +192,11 @@ void S_Base_SoundList( void ) {
 	total = 0;
 	for (sfx=s_knownSfx, i=0 ; i<s_numSfx ; i++, sfx++) {
 		size = sfx->soundLength;
-		total += size;
+		if ( !sfx->streamed ) {
+			total += size;
+		}
 		Com_Printf("%6i[%s] : %s[%s]\n", size, type[sfx->soundCompressionMethod],
-				sfx->soundName, mem[sfx->inMemory] );
+				sfx->soundName, sfx->streamed ? "streamed " : mem[sfx->inMemory] );
 	}
 	Com_Printf ("Total resident: %i\n", total);
 	S_DisplayFreeMemory();
@@ -193,7 +217,7 @@ channel_t*	S_ChannelMalloc( void ) {
 	}
 	v = freelist;
 	freelist = *(channel_t **)freelist;
-	v->allocTime = Com_Milliseconds();
+	v->allocTime = Sys_Milliseconds();
 	return v;
 }
 
@@ -222,25 +246,25 @@ void S_ChannelSetup( void ) {
 
 /*
 ================
-return a hash value for the sfx name
+S_SfxName
 ================
 */
-static long S_HashSFXName(const char *name) {
-	int		i;
-	long	hash;
-	char	letter;
+static const char *S_SfxName( int sfx ) {
+	return s_knownSfx[sfx].soundName;
+}
+
+/*
+================
+S_TouchSfx
 
-	hash = 0;
-	i = 0;
-	while (name[i] != '\0') {
-		letter = tolower(name[i]);
-		if (letter =='.') break;				// don't include extension
-		if (letter =='\\') letter = '/';		// damn path names
-		hash+=(long)(letter)*(i+119);
-		i++;
+Keeps a resident sound's place in the eviction order, the default
+sound is never evicted
+================
+*/
+static void S_TouchSfx( sfx_t *sfx ) {
+	if ( sfx->inMemory && sfx != s_knownSfx ) {
+		S_RegistryTouch( &s_sfxRegistry, sfx - s_knownSfx );
 	}
-	hash &= (LOOP_HASH-1);
-	return hash;
 }
 
 /*
@@ -252,8 +276,6 @@ Will allocate a new sfx if it isn't found
 */
 static sfx_t *S_FindName( const char *name ) {
 	int		i;
-	int		hash;
-
 	sfx_t	*sfx;
 
 	if (!name) {
@@ -275,37 +297,23 @@ static sfx_t *S_FindName( const char *name ) {
 		return NULL;
 	}
 
-	hash = S_HashSFXName(name);
-
-	sfx = sfxHash[hash];
 	// see if already loaded
-	while (sfx) {
-		if (!Q_stricmp(sfx->soundName, name) ) {
-			return sfx;
-		}
-		sfx = sfx->next;
+	i = S_RegistryFind( &s_sfxRegistry, name );
+	if ( i >= 0 ) {
+		return &s_knownSfx[i];
 	}
 
-	// find a free sfx
-	for (i=0 ; i < s_numSfx ; i++) {
-		if (!s_knownSfx[i].soundName[0]) {
-			break;
-		}
+	// sounds are never released one by one, so the next free sfx is the last
+	if (s_numSfx == MAX_SFX) {
+		Com_Error (ERR_FATAL, "S_FindName: out of sfx_t");
 	}
+	i = s_numSfx++;
 
-	if (i == s_numSfx) {
-		if (s_numSfx == MAX_SFX) {
-			Com_Error (ERR_FATAL, "S_FindName: out of sfx_t");
-		}
-		s_numSfx++;
-	}
-	
 	sfx = &s_knownSfx[i];
 	Com_Memset (sfx, 0, sizeof(*sfx));
 	strcpy (sfx->soundName, name);
 
-	sfx->next = sfxHash[hash];
-	sfxHash[hash] = sfx;
+	S_RegistryLink( &s_sfxRegistry, i );
 
 	return sfx;
 }
@@ -343,6 +351,32 @@ void S_Base_DisableSounds( void ) {
 	s_soundMuted = qtrue;
 }
 
+/*
+==================
+S_FindSoundContent
+
+Sets the content key of a sound that isn't loaded and returns another
+loaded sound with the same key, if any
+==================
+*/
+static sfx_t *S_FindSoundContent( sfx_t *sfx ) {
+	sfx_t	*other;
+	int		i;
+
+	if ( !S_CodecContentKey( sfx->soundName, &sfx->contentCrc, &sfx->contentLength ) ) {
+		return NULL;
+	}
+
+	for ( i = 0, other = s_knownSfx ; i < s_numSfx ; i++, other++ ) {
+		if ( other != sfx && ( other->soundData || other->pending ) && !other->defaultSound &&
+			other->contentCrc == sfx->contentCrc && other->contentLength == sfx->contentLength ) {
+			return other;
+		}
+	}
+
+	return NULL;
+}
+
 /*
 ==================
 S_RegisterSound
@@ -351,7 +385,7 @@ Creates a default buzz sound if the file can't be loaded
 ==================
 */
 sfxHandle_t	S_Base_RegisterSound( const char *name, qboolean compressed ) {
-	sfx_t	*sfx;
+	sfx_t	*sfx, *other;
 
 	compressed = qfalse;
 	if (!s_soundStarted) {
@@ -363,7 +397,7 @@ sfxHandle_t	S_Base_RegisterSound( const char *name, qboolean compressed ) {
 		return 0;
 	}
 
-	if ( sfx->soundData ) {
+	if ( sfx->soundData || sfx->pending ) {
 		if ( sfx->defaultSound ) {
 			Com_Printf( S_COLOR_YELLOW "WARNING: could not find %s - using default\n", sfx->soundName );
 			return 0;
@@ -371,10 +405,22 @@ sfxHandle_t	S_Base_RegisterSound( const char *name, qboolean compressed ) {
 		return sfx - s_knownSfx;
 	}
 
+	// the same file may already be loaded under another name
+	other = S_FindSoundContent( sfx );
+	if ( other ) {
+		return other - s_knownSfx;
+	}
+
 	sfx->inMemory = qfalse;
 	sfx->soundCompressed = compressed;
 
-  S_memoryLoad(sfx);
+	// handed to a precache worker if it needs resampling
+	if ( !S_LoadSound( sfx, qtrue ) ) {
+		sfx->defaultSound = qtrue;
+	}
+	if ( !sfx->pending ) {
+		S_SfxResident( sfx );
+	}
 
 	if ( sfx->defaultSound ) {
 		Com_Printf( S_COLOR_YELLOW "WARNING: could not find %s - using default\n", sfx->soundName );
@@ -393,23 +439,51 @@ S_BeginRegistration
 void S_Base_BeginRegistration( void ) {
 	s_soundMuted = qfalse;		// we can play again
 
+	// a new map, S_OcclusionUpdate sets up for it
+	S_OcclusionClear();
+
 	if (s_numSfx == 0) {
+		S_PrecacheWait( NULL );
+
+		SNDDMA_LockMixer();
 		SND_setup();
 
 		Com_Memset(s_knownSfx, '\0', sizeof(s_knownSfx));
-		Com_Memset(sfxHash, '\0', sizeof(sfx_t *) * LOOP_HASH);
+		S_RegistryClear( &s_sfxRegistry, S_SfxName );
+		SNDDMA_UnlockMixer();
 
 		S_Base_RegisterSound("sound/feedback/hit.wav", qfalse);		// changed to a sound in baseq3
 	}
 }
 
 void S_memoryLoad(sfx_t	*sfx) {
+	// registered and still being resampled, it only has to finish
+	if ( sfx->pending ) {
+		S_PrecacheWait( sfx );
+		return;
+	}
+
 	// load the sound file
-	if ( !S_LoadSound ( sfx ) ) {
+	if ( !S_LoadSound ( sfx, qfalse ) ) {
 //		Com_Printf( S_COLOR_YELLOW "WARNING: couldn't load sound: %s\n", sfx->soundName );
 		sfx->defaultSound = qtrue;
 	}
+
+	S_SfxResident( sfx );
+}
+
+/*
+================
+S_SfxResident
+
+Marks a loaded sound as playable
+================
+*/
+void S_SfxResident( sfx_t *sfx ) {
+	SNDDMA_LockMixer();
 	sfx->inMemory = qtrue;
+	S_TouchSfx( sfx );
+	SNDDMA_UnlockMixer();
 }
 
 //=============================================================================
@@ -421,11 +495,12 @@ S_SpatializeOrigin
 Used for spatializing s_channels
 =================
 */
-void S_SpatializeOrigin (vec3_t origin, int master_vol, int *left_vol, int *right_vol)
+void S_SpatializeOrigin (vec3_t origin, int cluster, int master_vol, int *left_vol, int *right_vol)
 {
     vec_t		dot;
     vec_t		dist;
     vec_t		lscale, rscale, scale;
+    vec_t		occlusion;
     vec3_t		source_vec;
     vec3_t		vec;
 
@@ -461,13 +536,16 @@ void S_SpatializeOrigin (vec3_t origin, int master_vol, int *left_vol, int *righ
 		}
 	}
 
+	// muffle it through walls and closed doors
+	occlusion = S_OcclusionGain( cluster );
+
 	// add in distance effect
-	scale = (1.0 - dist) * rscale;
+	scale = (1.0 - dist) * rscale * occlusion;
 	*right_vol = (master_vol * scale);
 	if (*right_vol < 0)
 		*right_vol = 0;
 
-	scale = (1.0 - dist) * lscale;
+	scale = (1.0 - dist) * lscale * occlusion;
 	*left_vol = (master_vol * scale);
 	if (*left_vol < 0)
 		*left_vol = 0;
@@ -515,46 +593,80 @@ static qboolean S_Base_HearingThroughEntity( int entityNum, vec3_t origin )
 		return qfalse; //not the player
 }
 
+/*
+==============================================================
+
+game thread commands
+
+The game thread validates its calls and pages sounds in, everything
+touching channels and loops is replayed by whoever mixes, so with
+s_mixThread the game thread never waits on the mixer per frame
+
+==============================================================
+*/
+
+static void S_ExecCommand( const sndCommand_t *cmd );
+
+/*
+=================
+S_RunCommands
+
+Replays the queued commands, only with the mixer lock held
+=================
+*/
+static void S_RunCommands( void ) {
+	sndCommand_t	cmd;
+
+	while ( SNDDMA_PopCommand( &cmd ) ) {
+		S_ExecCommand( &cmd );
+	}
+}
+
+/*
+=================
+S_IssueCommand
+=================
+*/
+static void S_IssueCommand( sndCommand_t *cmd ) {
+	cmd->frame = cls.framecount;
+
+	if ( !s_mixThreadActive ) {
+		S_ExecCommand( cmd );
+		return;
+	}
+
+	if ( !SNDDMA_PushCommand( cmd ) ) {
+		// mixer fell behind, catch it up here
+		SNDDMA_LockMixer();
+		S_RunCommands();
+		S_ExecCommand( cmd );
+		SNDDMA_UnlockMixer();
+	}
+}
+
 /*
 ====================
-S_Base_StartSoundEx
+S_StartSoundCommand
 
-Validates the parms and ques the sound up
 if origin is NULL, the sound will be dynamically sourced from the entity
 Entchannel 0 will never override a playing sound
 ====================
 */
-static void S_Base_StartSoundEx( vec3_t origin, int entityNum, int entchannel, sfxHandle_t sfxHandle, qboolean localSound ) {
+static void S_StartSoundCommand( const sndCommand_t *cmd ) {
 	channel_t	*ch;
-	sfx_t		*sfx;
+	sfx_t		*sfx = cmd->sfx;
+	const float	*origin = cmd->hasOrigin ? cmd->origin : NULL;
+	int			entityNum = cmd->entityNum;
   int i, oldest, chosen, time;
   int	inplay, allowed;
 	qboolean	fullVolume;
 
-	if ( !s_soundStarted || s_soundMuted ) {
+	// paged out again before the mixer got to it
+	if ( !sfx->inMemory ) {
 		return;
 	}
 
-	if ( !origin && ( entityNum < 0 || entityNum >= MAX_GENTITIES ) ) {
-		Com_Error( ERR_DROP, "S_StartSound: bad entitynum %i", entityNum );
-	}
-
-	if ( sfxHandle < 0 || sfxHandle >= s_numSfx ) {
-		Com_Printf( S_COLOR_YELLOW "S_StartSound: handle %i out of range\n", sfxHandle );
-		return;
-	}
-
-	sfx = &s_knownSfx[ sfxHandle ];
-
-	if (sfx->inMemory == qfalse) {
-		S_memoryLoad(sfx);
-	}
-
-	if ( s_show->integer == 1 ) {
-		Com_Printf( "%i : %s\n", s_paintedtime, sfx->soundName );
-	}
-
-	time = Com_Milliseconds();
+	time = Sys_Milliseconds();
 
 //	Com_Printf("playing %s\n", sfx->soundName);
 	// pick a channel to play on
@@ -565,7 +677,7 @@ static void S_Base_StartSoundEx( vec3_t origin, int entityNum, int entchannel, s
 	}
 
 	fullVolume = qfalse;
-	if (localSound || S_Base_HearingThroughEntity(entityNum, origin)) {
+	if (cmd->localSound || S_Base_HearingThroughEntity(entityNum, (float *)origin)) {
 		fullVolume = qtrue;
 	}
 
@@ -588,6 +700,7 @@ static void S_Base_StartSoundEx( vec3_t origin, int entityNum, int entchannel, s
 	}
 
 	sfx->lastTimeUsed = time;
+	S_TouchSfx( sfx );
 
 	ch = S_ChannelMalloc();	// entityNum, entchannel);
 	if (!ch) {
@@ -620,7 +733,7 @@ static void S_Base_StartSoundEx( vec3_t origin, int entityNum, int entchannel, s
 					}
 				}
 				if (chosen == -1) {
-					Com_DPrintf("dropping sound\n");
+					s_droppedSounds++;
 					return;
 				}
 			}
@@ -631,6 +744,7 @@ static void S_Base_StartSoundEx( vec3_t origin, int entityNum, int entchannel, s
 
 	if (origin) {
 		VectorCopy (origin, ch->origin);
+		ch->cluster = cmd->cluster;
 		ch->fixed_origin = qtrue;
 	} else {
 		ch->fixed_origin = qfalse;
@@ -640,13 +754,66 @@ static void S_Base_StartSoundEx( vec3_t origin, int entityNum, int entchannel, s
 	ch->entnum = entityNum;
 	ch->thesfx = sfx;
 	ch->startSample = START_SAMPLE_IMMEDIATE;
-	ch->entchannel = entchannel;
+	ch->entchannel = cmd->arg;
 	ch->leftvol = ch->master_vol;		// these will get calced at next spatialize
 	ch->rightvol = ch->master_vol;		// unless the game isn't running
 	ch->doppler = qfalse;
 	ch->fullVolume = fullVolume;
 }
 
+/*
+====================
+S_Base_StartSoundEx
+
+Validates the parms and ques the sound up
+====================
+*/
+static void S_Base_StartSoundEx( vec3_t origin, int entityNum, int entchannel, sfxHandle_t sfxHandle, qboolean localSound ) {
+	sndCommand_t	cmd;
+	sfx_t		*sfx;
+
+	if ( !s_soundStarted || s_soundMuted ) {
+		return;
+	}
+
+	if ( !origin && ( entityNum < 0 || entityNum >= MAX_GENTITIES ) ) {
+		Com_Error( ERR_DROP, "S_StartSound: bad entitynum %i", entityNum );
+	}
+
+	if ( sfxHandle < 0 || sfxHandle >= s_numSfx ) {
+		Com_Printf( S_COLOR_YELLOW "S_StartSound: handle %i out of range\n", sfxHandle );
+		return;
+	}
+
+	sfx = &s_knownSfx[ sfxHandle ];
+
+	if (sfx->inMemory == qfalse) {
+		S_memoryLoad(sfx);
+	}
+
+	if ( s_show->integer == 1 ) {
+		Com_Printf( "%i : %s\n", s_paintedtime, sfx->soundName );
+	}
+
+	if ( sfx->streamed ) {
+		S_StartSoundStream( sfx, origin, entityNum, localSound );
+		return;
+	}
+
+	cmd.type = SCMD_START_SOUND;
+	cmd.entityNum = entityNum;
+	cmd.arg = entchannel;
+	cmd.localSound = localSound;
+	cmd.sfx = sfx;
+	cmd.hasOrigin = origin != NULL;
+	cmd.cluster = -1;
+	if ( origin ) {
+		VectorCopy( origin, cmd.origin );
+		cmd.cluster = S_OcclusionCluster( origin );
+	}
+	S_IssueCommand( &cmd );
+}
+
 /*
 ====================
 S_StartSound
@@ -691,6 +858,11 @@ void S_Base_ClearSoundBuffer( void ) {
 	if (!s_soundStarted)
 		return;
 
+	SNDDMA_LockMixer();
+
+	// anything still queued refers to what is cleared below
+	S_RunCommands();
+
 	// stop looping sounds
 	Com_Memset(loopSounds, 0, MAX_GENTITIES*sizeof(loopSound_t));
 	Com_Memset(loop_channels, 0, MAX_CHANNELS*sizeof(channel_t));
@@ -709,6 +881,8 @@ void S_Base_ClearSoundBuffer( void ) {
 	if (dma.buffer)
 		Com_Memset(dma.buffer, clear, dma.samples * dma.samplebits/8);
 	SNDDMA_Submit ();
+
+	SNDDMA_UnlockMixer();
 }
 
 /*
@@ -723,6 +897,7 @@ void S_Base_StopAllSounds(void) {
 
 	// stop the background music
 	S_Base_StopBackgroundTrack();
+	S_StopSoundStreams();
 
 	S_Base_ClearSoundBuffer ();
 }
@@ -735,28 +910,44 @@ continuous looping sounds are added each frame
 ==============================================================
 */
 
-void S_Base_StopLoopingSound(int entityNum) {
+static void S_StopLoopCommand( int entityNum ) {
 	loopSounds[entityNum].active = qfalse;
 //	loopSounds[entityNum].sfx = 0;
 	loopSounds[entityNum].kill = qfalse;
 }
 
+void S_Base_StopLoopingSound(int entityNum) {
+	sndCommand_t	cmd;
+
+	cmd.type = SCMD_STOP_LOOP;
+	cmd.entityNum = entityNum;
+	S_IssueCommand( &cmd );
+}
+
 /*
 ==================
 S_ClearLoopingSounds
 
 ==================
 */
-void S_Base_ClearLoopingSounds( qboolean killall ) {
+static void S_ClearLoopsCommand( qboolean killall ) {
 	int i;
 	for ( i = 0 ; i < MAX_GENTITIES ; i++) {
 		if (killall || loopSounds[i].kill == qtrue || (loopSounds[i].sfx && loopSounds[i].sfx->soundLength == 0)) {
-			S_Base_StopLoopingSound(i);
+			S_StopLoopCommand(i);
 		}
 	}
 	numLoopChannels = 0;
 }
 
+void S_Base_ClearLoopingSounds( qboolean killall ) {
+	sndCommand_t	cmd;
+
+	cmd.type = SCMD_CLEAR_LOOPS;
+	cmd.arg = killall;
+	S_IssueCommand( &cmd );
+}
+
 /*
 ==================
 S_AddLoopingSound
@@ -765,36 +956,19 @@ Called during entity generation for a frame
 Include velocity in case I get around to doing doppler...
 ==================
 */
-void S_Base_AddLoopingSound( int entityNum, const vec3_t origin, const vec3_t velocity, sfxHandle_t sfxHandle ) {
-	sfx_t *sfx;
-
-	if ( !s_soundStarted || s_soundMuted ) {
-		return;
-	}
-
-	if ( sfxHandle < 0 || sfxHandle >= s_numSfx ) {
-		Com_Printf( S_COLOR_YELLOW "S_AddLoopingSound: handle %i out of range\n", sfxHandle );
-		return;
-	}
-
-	sfx = &s_knownSfx[ sfxHandle ];
-
-	if (sfx->inMemory == qfalse) {
-		S_memoryLoad(sfx);
-	}
+static void S_AddLoopCommand( const sndCommand_t *cmd ) {
+	int			entityNum = cmd->entityNum;
+	const float	*velocity = cmd->velocity;
 
-	if ( !sfx->soundLength ) {
-		Com_Error( ERR_DROP, "%s has length 0", sfx->soundName );
-	}
-
-	VectorCopy( origin, loopSounds[entityNum].origin );
+	VectorCopy( cmd->origin, loopSounds[entityNum].origin );
 	VectorCopy( velocity, loopSounds[entityNum].velocity );
+	loopSounds[entityNum].cluster = cmd->cluster;
 	loopSounds[entityNum].active = qtrue;
 	loopSounds[entityNum].kill = qtrue;
 	loopSounds[entityNum].doppler = qfalse;
 	loopSounds[entityNum].oldDopplerScale = 1.0;
 	loopSounds[entityNum].dopplerScale = 1.0;
-	loopSounds[entityNum].sfx = sfx;
+	loopSounds[entityNum].sfx = cmd->sfx;
 
 	if (s_doppler->integer && VectorLengthSquared(velocity)>0.0) {
 		vec3_t	out;
@@ -804,7 +978,7 @@ void S_Base_AddLoopingSound( int entityNum, const vec3_t origin, const vec3_t ve
 		lena = DistanceSquared(loopSounds[listener_number].origin, loopSounds[entityNum].origin);
 		VectorAdd(loopSounds[entityNum].origin, loopSounds[entityNum].velocity, out);
 		lenb = DistanceSquared(loopSounds[listener_number].origin, out);
-		if ((loopSounds[entityNum].framenum+1) != cls.framecount) {
+		if ((loopSounds[entityNum].framenum+1) != cmd->frame) {
 			loopSounds[entityNum].oldDopplerScale = 1.0;
 		} else {
 			loopSounds[entityNum].oldDopplerScale = loopSounds[entityNum].dopplerScale;
@@ -817,31 +991,37 @@ void S_Base_AddLoopingSound( int entityNum, const vec3_t origin, const vec3_t ve
 		}
 	}
 
-	loopSounds[entityNum].framenum = cls.framecount;
+	loopSounds[entityNum].framenum = cmd->frame;
 }
 
 /*
 ==================
-S_AddLoopingSound
+S_ValidateLoop
 
-Called during entity generation for a frame
-Include velocity in case I get around to doing doppler...
+Pages the loop sound in and fills the command, qfalse to drop the call
 ==================
 */
-void S_Base_AddRealLoopingSound( int entityNum, const vec3_t origin, const vec3_t velocity, sfxHandle_t sfxHandle ) {
+static qboolean S_ValidateLoop( sndCommand_t *cmd, const char *caller, int entityNum, const vec3_t origin, const vec3_t velocity, sfxHandle_t sfxHandle ) {
 	sfx_t *sfx;
 
 	if ( !s_soundStarted || s_soundMuted ) {
-		return;
+		return qfalse;
 	}
 
 	if ( sfxHandle < 0 || sfxHandle >= s_numSfx ) {
-		Com_Printf( S_COLOR_YELLOW "S_AddRealLoopingSound: handle %i out of range\n", sfxHandle );
-		return;
+		Com_Printf( S_COLOR_YELLOW "%s: handle %i out of range\n", caller, sfxHandle );
+		return qfalse;
 	}
 
 	sfx = &s_knownSfx[ sfxHandle ];
 
+	// loops mix from memory, decode this one in full
+	if ( sfx->streamed ) {
+		sfx->streamed = qfalse;
+		sfx->inMemory = qfalse;
+	}
+	sfx->looped = qtrue;
+
 	if (sfx->inMemory == qfalse) {
 		S_memoryLoad(sfx);
 	}
@@ -849,14 +1029,53 @@ void S_Base_AddRealLoopingSound( int entityNum, const vec3_t origin, const vec3_
 	if ( !sfx->soundLength ) {
 		Com_Error( ERR_DROP, "%s has length 0", sfx->soundName );
 	}
-	VectorCopy( origin, loopSounds[entityNum].origin );
-	VectorCopy( velocity, loopSounds[entityNum].velocity );
-	loopSounds[entityNum].sfx = sfx;
+
+	cmd->entityNum = entityNum;
+	cmd->sfx = sfx;
+	VectorCopy( origin, cmd->origin );
+	VectorCopy( velocity, cmd->velocity );
+	cmd->cluster = S_OcclusionCluster( origin );
+	return qtrue;
+}
+
+void S_Base_AddLoopingSound( int entityNum, const vec3_t origin, const vec3_t velocity, sfxHandle_t sfxHandle ) {
+	sndCommand_t	cmd;
+
+	if ( S_ValidateLoop( &cmd, "S_AddLoopingSound", entityNum, origin, velocity, sfxHandle ) ) {
+		cmd.type = SCMD_ADD_LOOP;
+		S_IssueCommand( &cmd );
+	}
+}
+
+/*
+==================
+S_AddLoopingSound
+
+Called during entity generation for a frame
+Include velocity in case I get around to doing doppler...
+==================
+*/
+static void S_AddRealLoopCommand( const sndCommand_t *cmd ) {
+	int entityNum = cmd->entityNum;
+
+	VectorCopy( cmd->origin, loopSounds[entityNum].origin );
+	VectorCopy( cmd->velocity, loopSounds[entityNum].velocity );
+	loopSounds[entityNum].cluster = cmd->cluster;
+	loopSounds[entityNum].sfx = cmd->sfx;
 	loopSounds[entityNum].active = qtrue;
 	loopSounds[entityNum].kill = qfalse;
 	loopSounds[entityNum].doppler = qfalse;
 }
 
+void S_Base_AddRealLoopingSound( int entityNum, const vec3_t origin, const vec3_t velocity, sfxHandle_t sfxHandle ) {
+	sndCommand_t	cmd;
+
+	if ( S_ValidateLoop( &cmd, "S_AddRealLoopingSound", entityNum, origin, velocity, sfxHandle ) ) {
+		cmd.type = SCMD_ADD_REAL_LOOP;
+		S_IssueCommand( &cmd );
+	}
+}
+
 
 
 /*
@@ -878,7 +1097,7 @@ void S_AddLoopSounds (void) {
 
 	numLoopChannels = 0;
 
-	time = Com_Milliseconds();
+	time = Sys_Milliseconds();
 
 	loopFrame++;
 	for ( i = 0 ; i < MAX_GENTITIES ; i++) {
@@ -888,12 +1107,13 @@ void S_AddLoopSounds (void) {
 		}
 
 		if (loop->kill) {
-			S_SpatializeOrigin( loop->origin, 127, &left_total, &right_total);			// 3d
+			S_SpatializeOrigin( loop->origin, loop->cluster, 127, &left_total, &right_total);			// 3d
 		} else {
-			S_SpatializeOrigin( loop->origin, 90,  &left_total, &right_total);			// sphere
+			S_SpatializeOrigin( loop->origin, loop->cluster, 90,  &left_total, &right_total);			// sphere
 		}
 
 		loop->sfx->lastTimeUsed = time;
+		S_TouchSfx( loop->sfx );
 
 		for (j=(i+1); j< MAX_GENTITIES ; j++) {
 			loop2 = &loopSounds[j];
@@ -903,12 +1123,13 @@ void S_AddLoopSounds (void) {
 			loop2->mergeFrame = loopFrame;
 
 			if (loop2->kill) {
-				S_SpatializeOrigin( loop2->origin, 127, &left, &right);				// 3d
+				S_SpatializeOrigin( loop2->origin, loop2->cluster, 127, &left, &right);				// 3d
 			} else {
-				S_SpatializeOrigin( loop2->origin, 90,  &left, &right);				// sphere
+				S_SpatializeOrigin( loop2->origin, loop2->cluster, 90,  &left, &right);				// sphere
 			}
 
 			loop2->sfx->lastTimeUsed = time;
+			S_TouchSfx( loop2->sfx );
 			left_total += left;
 			right_total += right;
 		}
@@ -976,7 +1197,7 @@ S_Base_RawSamples
 Music streaming
 ============
 */
-void S_Base_RawSamples( int stream, int samples, int rate, int width, int numChannels, const byte *data, float volume, int entityNum)
+static void S_AddRawSamples( int stream, int samples, int rate, int width, int numChannels, const byte *data, float volume, int entityNum, const vec3_t origin, int cluster)
 {
 	int		i;
 	int		src, dst;
@@ -999,9 +1220,11 @@ void S_Base_RawSamples( int stream, int samples, int rate, int width, int numCha
 	} else {
 		int leftvol, rightvol;
 
-		if ( entityNum >= 0 && entityNum < MAX_GENTITIES ) {
+		if ( origin ) {
+			S_SpatializeOrigin( (float *)origin, cluster, 256, &leftvol, &rightvol );
+		} else if ( entityNum >= 0 && entityNum < MAX_GENTITIES ) {
 			// support spatialized raw streams, e.g. for VoIP
-			S_SpatializeOrigin( loopSounds[ entityNum ].origin, 256, &leftvol, &rightvol );
+			S_SpatializeOrigin( loopSounds[ entityNum ].origin, loopSounds[ entityNum ].cluster, 256, &leftvol, &rightvol );
 		} else {
 			leftvol = rightvol = 256;
 		}
@@ -1095,6 +1318,13 @@ void S_Base_RawSamples( int stream, int samples, int rate, int width, int numCha
 	}
 }
 
+void S_Base_RawSamples( int stream, int samples, int rate, int width, int numChannels, const byte *data, float volume, int entityNum)
+{
+	SNDDMA_LockMixer();
+	S_AddRawSamples( stream, samples, rate, width, numChannels, data, volume, entityNum, NULL, -1 );
+	SNDDMA_UnlockMixer();
+}
+
 //=============================================================================
 
 /*
@@ -1105,10 +1335,17 @@ let the sound system know where an entity currently is
 ======================
 */
 void S_Base_UpdateEntityPosition( int entityNum, const vec3_t origin ) {
+	sndCommand_t	cmd;
+
 	if ( entityNum < 0 || entityNum >= MAX_GENTITIES ) {
 		Com_Error( ERR_DROP, "S_UpdateEntityPosition: bad entitynum %i", entityNum );
 	}
-	VectorCopy( origin, loopSounds[entityNum].origin );
+
+	cmd.type = SCMD_ENTITY_POSITION;
+	cmd.entityNum = entityNum;
+	VectorCopy( origin, cmd.origin );
+	cmd.cluster = S_OcclusionCluster( origin );
+	S_IssueCommand( &cmd );
 }
 
 
@@ -1119,20 +1356,17 @@ S_Respatialize
 Change the volumes of all the playing sounds for changes in their positions
 ============
 */
-void S_Base_Respatialize( int entityNum, const vec3_t head, vec3_t axis[3], int inwater ) {
+static void S_RespatializeCommand( const sndCommand_t *cmd ) {
 	int			i;
 	channel_t	*ch;
 	vec3_t		origin;
+	int			cluster;
 
-	if ( !s_soundStarted || s_soundMuted ) {
-		return;
-	}
-
-	listener_number = entityNum;
-	VectorCopy(head, listener_origin);
-	VectorCopy(axis[0], listener_axis[0]);
-	VectorCopy(axis[1], listener_axis[1]);
-	VectorCopy(axis[2], listener_axis[2]);
+	listener_number = cmd->entityNum;
+	VectorCopy(cmd->origin, listener_origin);
+	VectorCopy(cmd->axis[0], listener_axis[0]);
+	VectorCopy(cmd->axis[1], listener_axis[1]);
+	VectorCopy(cmd->axis[2], listener_axis[2]);
 
 	// update spatialization for dynamic sounds	
 	ch = s_channels;
@@ -1147,11 +1381,13 @@ void S_Base_Respatialize( int entityNum, const vec3_t head, vec3_t axis[3], int
 		} else {
 			if (ch->fixed_origin) {
 				VectorCopy( ch->origin, origin );
+				cluster = ch->cluster;
 			} else {
 				VectorCopy( loopSounds[ ch->entnum ].origin, origin );
+				cluster = loopSounds[ ch->entnum ].cluster;
 			}
 
-			S_SpatializeOrigin (origin, ch->master_vol, &ch->leftvol, &ch->rightvol);
+			S_SpatializeOrigin (origin, cluster, ch->master_vol, &ch->leftvol, &ch->rightvol);
 		}
 	}
 
@@ -1159,6 +1395,57 @@ void S_Base_Respatialize( int entityNum, const vec3_t head, vec3_t axis[3], int
 	S_AddLoopSounds ();
 }
 
+void S_Base_Respatialize( int entityNum, const vec3_t head, vec3_t axis[3], int inwater ) {
+	sndCommand_t	cmd;
+
+	if ( !s_soundStarted || s_soundMuted ) {
+		return;
+	}
+
+	S_OcclusionUpdate( head );
+
+	cmd.type = SCMD_RESPATIALIZE;
+	cmd.entityNum = entityNum;
+	cmd.arg = inwater;
+	VectorCopy( head, cmd.origin );
+	VectorCopy( axis[0], cmd.axis[0] );
+	VectorCopy( axis[1], cmd.axis[1] );
+	VectorCopy( axis[2], cmd.axis[2] );
+	S_IssueCommand( &cmd );
+}
+
+/*
+=================
+S_ExecCommand
+=================
+*/
+static void S_ExecCommand( const sndCommand_t *cmd ) {
+	switch ( cmd->type ) {
+	case SCMD_START_SOUND:
+		S_StartSoundCommand( cmd );
+		break;
+	case SCMD_STOP_LOOP:
+		S_StopLoopCommand( cmd->entityNum );
+		break;
+	case SCMD_CLEAR_LOOPS:
+		S_ClearLoopsCommand( cmd->arg );
+		break;
+	case SCMD_ADD_LOOP:
+		S_AddLoopCommand( cmd );
+		break;
+	case SCMD_ADD_REAL_LOOP:
+		S_AddRealLoopCommand( cmd );
+		break;
+	case SCMD_ENTITY_POSITION:
+		VectorCopy( cmd->origin, loopSounds[cmd->entityNum].origin );
+		loopSounds[cmd->entityNum].cluster = cmd->cluster;
+		break;
+	case SCMD_RESPATIALIZE:
+		S_RespatializeCommand( cmd );
+		break;
+	}
+}
+
 
 /*
 ========================
@@ -1209,15 +1496,26 @@ void S_Base_Update( void ) {
 	int			total;
 	channel_t	*ch;
 
+	// even while muted for a level load
+	if ( s_soundStarted ) {
+		S_PrecacheUpdate();
+	}
+
 	if ( !s_soundStarted || s_soundMuted ) {
 //		Com_DPrintf ("not started or muted\n");
 		return;
 	}
 
+	if ( s_droppedSounds ) {
+		Com_DPrintf( "dropped %i sounds\n", s_droppedSounds );
+		s_droppedSounds = 0;
+	}
+
 	//
 	// debugging output
 	//
 	if ( s_show->integer == 2 ) {
+		SNDDMA_LockMixer();
 		total = 0;
 		ch = s_channels;
 		for (i=0 ; i<MAX_CHANNELS; i++, ch++) {
@@ -1228,13 +1526,39 @@ void S_Base_Update( void ) {
 		}
 		
 		Com_Printf ("----(%i)---- painted: %i\n", total, s_paintedtime);
+		SNDDMA_UnlockMixer();
 	}
 
 	// add raw data from streamed samples
 	S_UpdateBackgroundTrack();
+	S_UpdateSoundStreams();
+
+	// the mixer thread can't follow the capture clock, mix here then
+	if ( s_mixThreadActive && !CL_VideoRecording() ) {
+		return;
+	}
 
 	// mix some sound
+	SNDDMA_LockMixer();
+	S_RunCommands();
 	S_Update_();
+	SNDDMA_UnlockMixer();
+}
+
+/*
+============
+S_MixThread
+
+Mixes on the thread started by S_Base_Init
+============
+*/
+static void S_MixThread( void ) {
+	SNDDMA_LockMixer();
+	S_RunCommands();
+	if ( !CL_VideoRecording() ) {
+		S_Update_();
+	}
+	SNDDMA_UnlockMixer();
 }
 
 void S_GetSoundtime(void)
@@ -1266,7 +1590,11 @@ void S_GetSoundtime(void)
 		{	// time to chop things off to avoid 32 bit limits
 			buffers = 0;
 			s_paintedtime = dma.fullsamples;
-			S_Base_StopAllSounds ();
+			// the background stream belongs to the game thread
+			if ( s_mixThreadActive )
+				S_Base_ClearSoundBuffer ();
+			else
+				S_Base_StopAllSounds ();
 		}
 	}
 	oldsamplepos = samplepos;
@@ -1301,7 +1629,7 @@ void S_Update_(void) {
 		return;
 	}
 
-	thisTime = Com_Milliseconds();
+	thisTime = Sys_Milliseconds();
 
 	// Updates s_soundtime
 	S_GetSoundtime();
@@ -1369,7 +1697,9 @@ void S_Base_StopBackgroundTrack( void ) {
 		return;
 	S_CodecCloseStream(s_backgroundStream);
 	s_backgroundStream = NULL;
+	SNDDMA_LockMixer();
 	s_rawend[0] = 0;
+	SNDDMA_UnlockMixer();
 }
 
 /*
@@ -1425,76 +1755,202 @@ void S_Base_StartBackgroundTrack( const char *intro, const char *loop ){
 
 /*
 ======================
-S_UpdateBackgroundTrack
+S_ReadRawStream
+
+Keeps a raw stream filled MAX_RAW_SAMPLES ahead from a codec stream,
+returns qfalse once the file has run out
 ======================
 */
-void S_UpdateBackgroundTrack( void ) {
+static qboolean S_ReadRawStream( int stream, snd_stream_t *file, float volume, int entityNum, const vec3_t origin, int cluster ) {
 	int		bufferSamples;
 	int		fileSamples;
 	byte	raw[30000];		// just enough to fit in a mac stack frame
 	int		fileBytes;
 	int		r;
 
-	if(!s_backgroundStream) {
-		return;
-	}
-
-	// don't bother playing anything if musicvolume is 0
-	if ( s_musicVolume->value <= 0 ) {
-		return;
-	}
-
 	// see how many samples should be copied into the raw buffer
-	if ( s_rawend[0] < s_soundtime ) {
-		s_rawend[0] = s_soundtime;
+	if ( s_rawend[stream] < s_soundtime ) {
+		s_rawend[stream] = s_soundtime;
 	}
 
-	while ( s_rawend[0] < s_soundtime + MAX_RAW_SAMPLES ) {
-		bufferSamples = MAX_RAW_SAMPLES - (s_rawend[0] - s_soundtime);
+	while ( s_rawend[stream] < s_soundtime + MAX_RAW_SAMPLES ) {
+		bufferSamples = MAX_RAW_SAMPLES - (s_rawend[stream] - s_soundtime);
 
 		// decide how much data needs to be read from the file
-		fileSamples = bufferSamples * s_backgroundStream->info.rate / dma.speed;
+		fileSamples = bufferSamples * file->info.rate / dma.speed;
 
 		if (!fileSamples)
-			return;
+			return qtrue;
 
 		// our max buffer size
-		fileBytes = fileSamples * (s_backgroundStream->info.width * s_backgroundStream->info.channels);
+		fileBytes = fileSamples * (file->info.width * file->info.channels);
 		if ( fileBytes > sizeof(raw) ) {
 			fileBytes = sizeof(raw);
-			fileSamples = fileBytes / (s_backgroundStream->info.width * s_backgroundStream->info.channels);
+			fileSamples = fileBytes / (file->info.width * file->info.channels);
 		}
 
 		// Read
-		r = S_CodecReadStream(s_backgroundStream, fileBytes, raw);
+		r = S_CodecReadStream(file, fileBytes, raw);
+		if(r <= 0)
+			return qfalse;
+
 		if(r < fileBytes)
 		{
-			fileSamples = r / (s_backgroundStream->info.width * s_backgroundStream->info.channels);
+			fileSamples = r / (file->info.width * file->info.channels);
 		}
 
-		if(r > 0)
+		// add to raw buffer
+		SNDDMA_LockMixer();
+		S_AddRawSamples(stream, fileSamples, file->info.rate,
+			file->info.width, file->info.channels, raw, volume, entityNum, origin, cluster);
+		SNDDMA_UnlockMixer();
+	}
+
+	return qtrue;
+}
+
+/*
+======================
+S_UpdateBackgroundTrack
+======================
+*/
+void S_UpdateBackgroundTrack( void ) {
+	if(!s_backgroundStream) {
+		return;
+	}
+
+	// don't bother playing anything if musicvolume is 0
+	if ( s_musicVolume->value <= 0 ) {
+		return;
+	}
+
+	while ( !S_ReadRawStream( 0, s_backgroundStream, s_musicVolume->value, -1, NULL, -1 ) ) {
+		// loop
+		if(s_backgroundLoop[0])
 		{
-			// add to raw buffer
-			S_Base_RawSamples(0, fileSamples, s_backgroundStream->info.rate,
-				s_backgroundStream->info.width, s_backgroundStream->info.channels, raw, s_musicVolume->value, -1);
+			S_OpenBackgroundStream( s_backgroundLoop );
+			if(!s_backgroundStream)
+				return;
 		}
 		else
 		{
-			// loop
-			if(s_backgroundLoop[0])
-			{
-				S_OpenBackgroundStream( s_backgroundLoop );
-				if(!s_backgroundStream)
-					return;
-			}
-			else
-			{
-				S_Base_StopBackgroundTrack();
-				return;
-			}
+			S_Base_StopBackgroundTrack();
+			return;
+		}
+	}
+}
+
+
+/*
+===============================================================================
+
+streamed sound effects
+
+===============================================================================
+*/
+
+/*
+======================
+S_StopSoundStream
+======================
+*/
+static void S_StopSoundStream( soundStream_t *ss ) {
+	if ( ss->stream ) {
+		S_CodecCloseStream( ss->stream );
+		ss->stream = NULL;
+	}
+}
+
+/*
+======================
+S_StopSoundStreams
+======================
+*/
+static void S_StopSoundStreams( void ) {
+	int		i;
+
+	for ( i = 0; i < MAX_SOUND_STREAMS; i++ ) {
+		S_StopSoundStream( &s_soundStreams[i] );
+	}
+}
+
+/*
+======================
+S_UpdateSoundStream
+======================
+*/
+static void S_UpdateSoundStream( soundStream_t *ss ) {
+	int		stream = RAW_STREAM_SOUNDS + ( ss - s_soundStreams );
+
+	if ( !S_ReadRawStream( stream, ss->stream, 1.0f, ss->entityNum, ss->fixedOrigin ? ss->origin : NULL, ss->cluster ) ) {
+		// what is buffered still plays out
+		S_StopSoundStream( ss );
+	}
+}
+
+/*
+======================
+S_UpdateSoundStreams
+======================
+*/
+static void S_UpdateSoundStreams( void ) {
+	int		i;
+
+	for ( i = 0; i < MAX_SOUND_STREAMS; i++ ) {
+		if ( s_soundStreams[i].stream ) {
+			S_UpdateSoundStream( &s_soundStreams[i] );
+		}
+	}
+}
+
+/*
+======================
+S_StartSoundStream
+
+Plays a streamed sfx through one of the raw streams, taking over
+the oldest one when all are busy
+======================
+*/
+static void S_StartSoundStream( sfx_t *sfx, vec3_t origin, int entityNum, qboolean localSound ) {
+	soundStream_t	*ss, *oldest;
+	int				i;
+
+	oldest = NULL;
+	for ( i = 0, ss = s_soundStreams; i < MAX_SOUND_STREAMS; i++, ss++ ) {
+		if ( !ss->stream ) {
+			break;
+		}
+		if ( !oldest || ss->startTime < oldest->startTime ) {
+			oldest = ss;
 		}
+	}
+	if ( i == MAX_SOUND_STREAMS ) {
+		ss = oldest;
+		S_StopSoundStream( ss );
+	}
 
+	ss->stream = S_CodecOpenStream( sfx->soundName );
+	if ( !ss->stream ) {
+		return;
 	}
+
+	ss->startTime = Com_Milliseconds();
+	ss->fixedOrigin = qfalse;
+	ss->entityNum = entityNum;
+	if ( localSound || S_Base_HearingThroughEntity( entityNum, origin ) ) {
+		ss->entityNum = -1;
+	} else if ( origin ) {
+		ss->fixedOrigin = qtrue;
+		VectorCopy( origin, ss->origin );
+		ss->cluster = S_OcclusionCluster( origin );
+	}
+
+	// start where the mixer paints next, not where the device plays
+	SNDDMA_LockMixer();
+	s_rawend[RAW_STREAM_SOUNDS + ( ss - s_soundStreams )] = s_paintedtime;
+	SNDDMA_UnlockMixer();
+
+	S_UpdateSoundStream( ss );
 }
 
 
@@ -1505,22 +1961,20 @@ S_FreeOldestSound
 */
 
 void S_FreeOldestSound( void ) {
-	int	i, oldest, used;
+	int	used;
 	sfx_t	*sfx;
 	sndBuffer	*buffer, *nbuffer;
 
-	oldest = Com_Milliseconds();
-	used = 0;
-
-	for (i=1 ; i < s_numSfx ; i++) {
-		sfx = &s_knownSfx[i];
-		if (sfx->inMemory && sfx->lastTimeUsed<oldest) {
-			used = i;
-			oldest = sfx->lastTimeUsed;
-		}
+	// the sound being loaded isn't resident yet, so it can't be picked
+	used = S_RegistryOldest( &s_sfxRegistry );
+	if ( used < 0 ) {
+		// only reached from S_LoadSound, leave the mixer running
+		SNDDMA_UnlockMixer();
+		Com_Error( ERR_DROP, "S_FreeOldestSound: out of sound memory" );
 	}
 
 	sfx = &s_knownSfx[used];
+	S_RegistryForget( &s_sfxRegistry, used );
 
 	Com_DPrintf("S_FreeOldestSound: freeing sound %s\n", sfx->soundName);
 
@@ -1543,6 +1997,13 @@ void S_Base_Shutdown( void ) {
 		return;
 	}
 
+	SNDDMA_StopMixThread();
+	s_mixThreadActive = qfalse;
+
+	S_PrecacheShutdown();
+	S_StopSoundStreams();
+	S_OcclusionClear();
+
 	SNDDMA_Shutdown();
 	SND_shutdown();
 
@@ -1568,6 +2029,20 @@ qboolean S_Base_Init( soundInterface_t *si ) {
 	s_mixPreStep = Cvar_Get ("s_mixPreStep", "0.05", CVAR_ARCHIVE);
 	s_show = Cvar_Get ("s_show", "0", CVAR_CHEAT);
 	s_testsound = Cvar_Get ("s_testsound", "0", CVAR_CHEAT);
+	s_mixThread = Cvar_Get ("s_mixThread", "1", CVAR_ARCHIVE | CVAR_LATCH);
+	s_streamSize = Cvar_Get ("s_streamSize", "1024", CVAR_ARCHIVE);
+	Cvar_SetDescription( s_streamSize, "Sounds decoding to more than this many kilobytes are streamed from disk while they play, 0 loads everything." );
+	s_resampleCache = Cvar_Get ("s_resampleCache", "1", CVAR_ARCHIVE);
+	Cvar_SetDescription( s_resampleCache, "Keep resampled sounds under cache/sound so later sessions load them directly." );
+	s_compression = Cvar_Get ("s_compression", "0", CVAR_ARCHIVE);
+	Cvar_SetDescription( s_compression, "Keep mono sounds ADPCM encoded in memory, a quarter of the size at some loss of quality." );
+	s_occlusion = Cvar_Get ("s_occlusion", "1", CVAR_ARCHIVE);
+	Cvar_CheckRange( s_occlusion, 0, 1, qfalse );
+	Cvar_SetDescription( s_occlusion, "How much sounds are muffled behind walls and closed doors, 0 disables." );
+	Cvar_SetDescription( s_mixThread, "Mix sound on a thread of its own instead of once per frame." );
+	s_precacheThreads = Cvar_Get ("s_precacheThreads", "2", CVAR_ARCHIVE | CVAR_LATCH);
+	Cvar_CheckRange( s_precacheThreads, 0, 8, qtrue );
+	Cvar_SetDescription( s_precacheThreads, "Worker threads resampling sounds while a level loads, 0 does it on the main thread." );
 
 	r = SNDDMA_Init();
 
@@ -1576,12 +2051,18 @@ qboolean S_Base_Init( soundInterface_t *si ) {
 		s_soundMuted = 1;
 //		s_numSfx = 0;
 
-		Com_Memset(sfxHash, 0, sizeof(sfx_t *)*LOOP_HASH);
+		S_RegistryClear( &s_sfxRegistry, S_SfxName );
 
 		s_soundtime = 0;
 		s_paintedtime = 0;
 
 		S_Base_StopAllSounds( );
+
+		if ( s_mixThread->integer ) {
+			s_mixThreadActive = SNDDMA_StartMixThread( S_MixThread );
+		}
+
+		S_PrecacheInit();
 	} else {
 		return qfalse;
 	}
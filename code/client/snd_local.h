@@ -59,7 +59,11 @@ typedef struct sfx_s {
 	int			soundChannels;
 	char 			soundName[MAX_QPATH];
 	int				lastTimeUsed;
-	struct sfx_s	*next;
+	qboolean		streamed;				// decoded while playing, no soundData
+	qboolean		looped;					// used as a loop sound, never streamed
+	unsigned int	contentCrc;				// pk3 content key of the loaded file,
+	unsigned int	contentLength;			// 0 length when it has none
+	qboolean		pending;				// resampling on a precache worker
 } sfx_t;
 
 typedef struct {
@@ -81,6 +85,7 @@ typedef struct {
 
 typedef struct loopSound_s {
 	vec3_t		origin;
+	int			cluster;		// see S_OcclusionCluster
 	vec3_t		velocity;
 	sfx_t		*sfx;
 	int			mergeFrame;
@@ -104,6 +109,7 @@ typedef struct
 	float		dopplerScale;
 	float		oldDopplerScale;
 	vec3_t		origin;			// only use if fixed_origin is set
+	int			cluster;		// with origin
 	qboolean	fixed_origin;	// use origin instead of fetching entnum's origin
 	sfx_t		*thesfx;		// sfx structure
 	qboolean	doppler;
@@ -177,6 +183,59 @@ void	SNDDMA_BeginPainting (void);
 
 void	SNDDMA_Submit(void);
 
+// calls the game thread makes into the dma back end, replayed by the mixer
+typedef enum {
+	SCMD_START_SOUND,
+	SCMD_STOP_LOOP,
+	SCMD_CLEAR_LOOPS,
+	SCMD_ADD_LOOP,
+	SCMD_ADD_REAL_LOOP,
+	SCMD_ENTITY_POSITION,
+	SCMD_RESPATIALIZE
+} sndCommandType_t;
+
+typedef struct {
+	sndCommandType_t	type;
+	int			entityNum;
+	int			arg;		// entchannel, killall or inwater
+	qboolean	localSound;
+	sfx_t		*sfx;
+	int			frame;		// cls.framecount when issued
+	qboolean	hasOrigin;
+	vec3_t		origin;
+	int			cluster;	// of origin, looked up by the game thread
+	vec3_t		velocity;
+	vec3_t		axis[3];
+} sndCommand_t;
+
+// runs mix on a thread of its own, qfalse if the platform can't
+qboolean SNDDMA_StartMixThread( void (*mix)( void ) );
+void	SNDDMA_StopMixThread( void );
+
+// serializes the game thread against the mixer thread, nests
+void	SNDDMA_LockMixer( void );
+void	SNDDMA_UnlockMixer( void );
+
+// single producer (game thread), single consumer (mixer lock holder)
+qboolean SNDDMA_PushCommand( const sndCommand_t *cmd );
+qboolean SNDDMA_PopCommand( sndCommand_t *cmd );
+
+// general purpose audio worker threads, function runs whenever the worker
+// is woken and at least every msec milliseconds
+typedef struct sndWorker_s sndWorker_t;
+
+sndWorker_t *SNDDMA_StartWorker( const char *name, void (*function)( void *arg ), void *arg, int msec );
+void	SNDDMA_WakeWorker( sndWorker_t *worker );
+void	SNDDMA_StopWorker( sndWorker_t *worker );
+
+// lock free single producer, single consumer queue of fixed size elements
+typedef struct sndQueue_s sndQueue_t;
+
+sndQueue_t *SNDDMA_CreateQueue( int elementSize, int count );
+void	SNDDMA_FreeQueue( sndQueue_t *queue );
+qboolean SNDDMA_QueuePush( sndQueue_t *queue, const void *element );
+qboolean SNDDMA_QueuePop( sndQueue_t *queue, void *element );
+
 #ifdef USE_VOIP
 void SNDDMA_StartCapture(void);
 int SNDDMA_AvailableCaptureSamples(void);
@@ -201,7 +260,9 @@ extern	vec3_t	listener_up;
 extern	dma_t	dma;
 
 #define	MAX_RAW_SAMPLES	16384
-#define MAX_RAW_STREAMS (MAX_CLIENTS * 2 + 1)
+#define MAX_SOUND_STREAMS	4		// streamed sfx playing at once
+#define RAW_STREAM_SOUNDS	(MAX_CLIENTS * 2 + 1)	// music, then VoIP, then these
+#define MAX_RAW_STREAMS (RAW_STREAM_SOUNDS + MAX_SOUND_STREAMS)
 extern	portable_samplepair_t s_rawsamples[MAX_RAW_STREAMS][MAX_RAW_SAMPLES];
 extern	int		s_rawend[MAX_RAW_STREAMS];
 
@@ -211,8 +272,19 @@ extern cvar_t *s_muted;
 extern cvar_t *s_doppler;
 
 extern cvar_t *s_testsound;
+extern cvar_t *s_streamSize;
+extern cvar_t *s_resampleCache;
+extern cvar_t *s_compression;
+extern cvar_t *s_occlusion;
+extern cvar_t *s_precacheThreads;
+
+qboolean S_LoadSound( sfx_t *sfx, qboolean defer );
 
-qboolean S_LoadSound( sfx_t *sfx );
+// precache workers, see S_LoadSound
+void S_PrecacheInit( void );
+void S_PrecacheShutdown( void );
+void S_PrecacheUpdate( void );
+void S_PrecacheWait( const sfx_t *sfx );
 
 void		SND_free(sndBuffer *v);
 sndBuffer*	SND_malloc( void );
@@ -222,6 +294,7 @@ void		SND_shutdown(void);
 void S_PaintChannels(int endtime);
 
 void S_memoryLoad(sfx_t *sfx);
+void S_SfxResident( sfx_t *sfx );
 
 // spatializes a channel
 void S_Spatialize(channel_t *ch);
@@ -231,6 +304,12 @@ int  S_AdpcmMemoryNeeded( const wavinfo_t *info );
 void S_AdpcmEncodeSound( sfx_t *sfx, short *samples );
 void S_AdpcmGetSamples(sndBuffer *chunk, short *to);
 
+// stored form for the sound cache, starting state and codes per chunk
+#define ADPCM_STORED_BLOCK	( 4 + SND_CHUNK_SIZE_BYTE )
+int  S_AdpcmStoredSize( int samples );
+void S_AdpcmStoreSound( const sfx_t *sfx, byte *out );
+void S_AdpcmLoadSound( sfx_t *sfx, const byte *in );
+
 // wavelet function
 
 #define SENTINEL_MULAW_ZERO_RUN 127
@@ -252,6 +331,36 @@ extern int	   sfxScratchIndex;
 
 qboolean S_Base_Init( soundInterface_t *si );
 
+// sfx registry, shared by the dma and OpenAL back ends. Each back end keeps
+// its own array of sounds; the registry hashes their names to indexes in it
+// and keeps the resident ones in least recently used order for eviction.
+// MAX_SFX may be larger than MAX_SOUNDS because of custom player sounds
+#define	MAX_SFX				4096
+#define	SFX_HASH_SIZE		1024
+
+typedef struct {
+	const char	*(*name)( int sfx );
+	int			hashTable[SFX_HASH_SIZE];	// -1 ends a chain
+	int			hashNext[MAX_SFX];
+	int			lruPrev[MAX_SFX];			// -2 when not resident
+	int			lruNext[MAX_SFX];
+	int			lruHead;					// most recently used, -1 if none
+	int			lruTail;
+} sfxRegistry_t;
+
+void	S_RegistryClear( sfxRegistry_t *reg, const char *(*name)( int sfx ) );
+int		S_RegistryFind( const sfxRegistry_t *reg, const char *name );
+void	S_RegistryLink( sfxRegistry_t *reg, int sfx );
+void	S_RegistryTouch( sfxRegistry_t *reg, int sfx );
+void	S_RegistryForget( sfxRegistry_t *reg, int sfx );
+int		S_RegistryOldest( const sfxRegistry_t *reg );
+
+// snd_occlusion.c, clusters from the game thread, gains from either
+void	S_OcclusionClear( void );
+void	S_OcclusionUpdate( const vec3_t listener );
+int		S_OcclusionCluster( const vec3_t origin );
+float	S_OcclusionGain( int cluster );
+
 // OpenAL stuff
 typedef enum
 {
@@ -249,7 +249,9 @@ void S_Update( void )
 	}
 	
 	if( si.Update ) {
+		PROFILE_BEGIN( "S_Update" );
 		si.Update( );
+		PROFILE_END( );
 	}
 }
 
@@ -46,6 +46,7 @@ static	sndBuffer	*buffer = NULL;
 static	sndBuffer	*freelist = NULL;
 static	int inUse = 0;
 static	int totalInUse = 0;
+static	int bufferBytes = 0;		// size of the chunk pool
 
 short *sfxScratchBuffer = NULL;
 sfx_t *sfxScratchPointer = NULL;
@@ -55,6 +56,7 @@ void	SND_free(sndBuffer *v) {
 	*(sndBuffer **)v = freelist;
 	freelist = (sndBuffer*)v;
 	inUse += sizeof(sndBuffer);
+	Com_MemStatSet( "sound.buffers", bufferBytes - inUse );
 }
 
 sndBuffer*	SND_malloc(void) {
@@ -71,6 +73,7 @@ redo:
 	v = freelist;
 	freelist = *(sndBuffer **)freelist;
 	v->next = NULL;
+	Com_MemStatSet( "sound.buffers", bufferBytes - inUse );
 	return v;
 }
 
@@ -89,6 +92,8 @@ void SND_setup(void) {
 	sfxScratchPointer = NULL;
 
 	inUse = scs*sizeof(sndBuffer);
+	bufferBytes = inUse;
+	Com_MemStatSet( "sound.buffers", 0 );
 	p = buffer;;
 	q = p + scs;
 	while (--q > p)
@@ -106,135 +111,367 @@ void SND_shutdown(void)
 		free(buffer);
 }
 
+/*
+===============================================================================
+
+resampling
+
+A polyphase windowed sinc filter, RESAMPLE_TAPS input samples around
+each output sample weighted by the nearest of RESAMPLE_PHASES subsample
+offsets.  Cutoff follows the lower of the two rates so decimation
+doesn't alias and upsampling doesn't image.
+
+===============================================================================
+*/
+
+#if idx64 || defined( __SSE2__ )
+#include <emmintrin.h>
+#define RESAMPLE_SSE2
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#include <arm_neon.h>
+#define RESAMPLE_NEON
+#endif
+
+#define RESAMPLE_TAPS		16		// multiple of 4 for the SIMD kernels
+#define RESAMPLE_PHASES		128
+#define RESAMPLE_ROLLOFF	0.92f	// of the lower nyquist
+
+// one per thread resampling, the main thread's and each precache worker's
+typedef struct {
+	float	taps[RESAMPLE_PHASES][RESAMPLE_TAPS];
+	float	cutoff;
+} resampleFilter_t;
+
+static resampleFilter_t	s_resampleFilter;
+
 /*
 ================
-ResampleSfx
+S_BuildResampleFilter
 
-resample / decimate to the current source rate
+Blackman windowed sinc per phase, normalized to unity gain
 ================
 */
-static int ResampleSfx( sfx_t *sfx, int channels, int inrate, int inwidth, int samples, byte *data, qboolean compressed ) {
-	int		outcount;
-	int		srcsample;
-	float	stepscale;
-	int		i, j;
-	int		sample, samplefrac, fracstep;
-	int			part;
-	sndBuffer	*chunk;
-	
-	stepscale = (float)inrate / dma.speed;	// this is usually 0.5, 1, or 2
-
-	outcount = samples / stepscale;
-
-	srcsample = 0;
-	samplefrac = 0;
-	fracstep = stepscale * 256 * channels;
-	chunk = sfx->soundData;
-
-	for (i=0 ; i<outcount ; i++)
-	{
-		srcsample += samplefrac >> 8;
-		samplefrac &= 255;
-		samplefrac += fracstep;
-		for (j=0 ; j<channels ; j++)
-		{
-			if( inwidth == 2 ) {
-				sample = ( ((short *)data)[srcsample+j] );
-			} else {
-				sample = (unsigned int)( (unsigned char)(data[srcsample+j]) - 128) << 8;
+static void S_BuildResampleFilter( resampleFilter_t *filter, float cutoff ) {
+	int		phase, tap;
+	double	x, w, sum;
+
+	if ( cutoff == filter->cutoff ) {
+		return;
+	}
+	filter->cutoff = cutoff;
+
+	for ( phase = 0; phase < RESAMPLE_PHASES; phase++ ) {
+		sum = 0;
+		for ( tap = 0; tap < RESAMPLE_TAPS; tap++ ) {
+			// distance from the output position, in input samples
+			x = tap - ( RESAMPLE_TAPS / 2 - 1 ) - (double)phase / RESAMPLE_PHASES;
+
+			w = 0.42 + 0.5 * cos( M_PI * x / ( RESAMPLE_TAPS / 2 ) ) + 0.08 * cos( 2 * M_PI * x / ( RESAMPLE_TAPS / 2 ) );
+			if ( fabs( x ) >= RESAMPLE_TAPS / 2 ) {
+				w = 0;
 			}
-			part = (i*channels+j)&(SND_CHUNK_SIZE-1);
-			if (part == 0) {
-				sndBuffer	*newchunk;
-				newchunk = SND_malloc();
-				if (chunk == NULL) {
-					sfx->soundData = newchunk;
-				} else {
-					chunk->next = newchunk;
-				}
-				chunk = newchunk;
+
+			if ( x == 0 ) {
+				w *= cutoff;
+			} else {
+				w *= sin( M_PI * cutoff * x ) / ( M_PI * x );
 			}
 
-			chunk->sndChunk[part] = sample;
+			filter->taps[phase][tap] = w;
+			sum += w;
+		}
+
+		for ( tap = 0; tap < RESAMPLE_TAPS; tap++ ) {
+			filter->taps[phase][tap] /= sum;
 		}
 	}
+}
 
-	return outcount;
+/*
+================
+S_ResampleDot
+================
+*/
+static ID_INLINE float S_ResampleDot( const float *in, const float *filter ) {
+#if defined( RESAMPLE_SSE2 )
+	__m128	sum = _mm_setzero_ps();
+	int		i;
+
+	for ( i = 0; i < RESAMPLE_TAPS; i += 4 ) {
+		sum = _mm_add_ps( sum, _mm_mul_ps( _mm_loadu_ps( in + i ), _mm_loadu_ps( filter + i ) ) );
+	}
+	sum = _mm_add_ps( sum, _mm_movehl_ps( sum, sum ) );
+	sum = _mm_add_ss( sum, _mm_shuffle_ps( sum, sum, 1 ) );
+	return _mm_cvtss_f32( sum );
+#elif defined( RESAMPLE_NEON )
+	float32x4_t	sum = vdupq_n_f32( 0.0f );
+	float32x2_t	half;
+	int			i;
+
+	for ( i = 0; i < RESAMPLE_TAPS; i += 4 ) {
+		sum = vmlaq_f32( sum, vld1q_f32( in + i ), vld1q_f32( filter + i ) );
+	}
+	half = vadd_f32( vget_low_f32( sum ), vget_high_f32( sum ) );
+	return vget_lane_f32( vpadd_f32( half, half ), 0 );
+#else
+	float	sum = 0.0f;
+	int		i;
+
+	for ( i = 0; i < RESAMPLE_TAPS; i++ ) {
+		sum += in[i] * filter[i];
+	}
+	return sum;
+#endif
+}
+
+/*
+================
+S_ResampledLength
+================
+*/
+static int S_ResampledLength( int inrate, int samples ) {
+	return (long long)samples * dma.speed / inrate;
 }
 
 /*
 ================
-ResampleSfx
+S_ResampleScratch
 
-resample / decimate to the current source rate
+floats of scratch S_ResampleSound needs
 ================
 */
-static int ResampleSfxRaw( short *sfx, int channels, int inrate, int inwidth, int samples, byte *data ) {
-	int			outcount;
-	int			srcsample;
-	float		stepscale;
-	int			i, j;
-	int			sample, samplefrac, fracstep;
-	
-	stepscale = (float)inrate / dma.speed;	// this is usually 0.5, 1, or 2
-
-	outcount = samples / stepscale;
-
-	srcsample = 0;
-	samplefrac = 0;
-	fracstep = stepscale * 256 * channels;
-
-	for (i=0 ; i<outcount ; i++)
-	{
-		srcsample += samplefrac >> 8;
-		samplefrac &= 255;
-		samplefrac += fracstep;
-		for (j=0 ; j<channels ; j++)
-		{
-			if( inwidth == 2 ) {
-				sample = LittleShort ( ((short *)data)[srcsample+j] );
+static int S_ResampleScratch( int samples ) {
+	return samples + RESAMPLE_TAPS * 2;
+}
+
+/*
+================
+S_ResampleSound
+
+resample / decimate interleaved 8 or 16 bit pcm to the current source rate,
+out needs room for S_ResampledLength frames.  Touches nothing but its
+arguments, so any thread can call it with a filter and scratch of its own.
+================
+*/
+static int S_ResampleSound( resampleFilter_t *filter, float *in, short *out, int channels, int inrate, int inwidth, int samples, const byte *data ) {
+	int		outcount;
+	double	step, pos;
+	int		i, j, sample, start, phase;
+	float	value;
+
+	outcount = S_ResampledLength( inrate, samples );
+
+	if ( inrate == dma.speed ) {
+		for ( i = 0; i < samples * channels; i++ ) {
+			if ( inwidth == 2 ) {
+				out[i] = ((const short *)data)[i];
 			} else {
-				sample = (int)( (unsigned char)(data[srcsample+j]) - 128) << 8;
+				out[i] = (int)( data[i] - 128 ) << 8;
 			}
-			sfx[i*channels+j] = sample;
+		}
+		return outcount;
+	}
+
+	step = (double)inrate / dma.speed;
+	S_BuildResampleFilter( filter, RESAMPLE_ROLLOFF * ( step > 1.0 ? 1.0 / step : 1.0 ) );
+
+	// one channel at a time, zero padded so the taps never leave the buffer
+	for ( j = 0; j < channels; j++ ) {
+		Com_Memset( in, 0, RESAMPLE_TAPS * sizeof( *in ) );
+		Com_Memset( in + RESAMPLE_TAPS + samples, 0, RESAMPLE_TAPS * sizeof( *in ) );
+		for ( i = 0; i < samples; i++ ) {
+			if ( inwidth == 2 ) {
+				in[RESAMPLE_TAPS + i] = ((const short *)data)[i * channels + j];
+			} else {
+				in[RESAMPLE_TAPS + i] = (int)( data[i * channels + j] - 128 ) << 8;
+			}
+		}
+
+		for ( i = 0, pos = 0; i < outcount; i++, pos += step ) {
+			start = (int)pos;
+			phase = (int)( ( pos - start ) * RESAMPLE_PHASES + 0.5 );
+			if ( phase == RESAMPLE_PHASES ) {
+				phase = 0;
+				start++;
+			}
+
+			value = S_ResampleDot( in + RESAMPLE_TAPS + start - ( RESAMPLE_TAPS / 2 - 1 ), filter->taps[phase] );
+			sample = (int)( value + ( value < 0 ? -0.5f : 0.5f ) );
+			out[i * channels + j] = sample < -32768 ? -32768 : sample > 32767 ? 32767 : sample;
 		}
 	}
+
 	return outcount;
 }
 
-//=============================================================================
+/*
+================
+S_StoreSoundChunks
+
+copies the resampled pcm into sndBuffer chunks
+================
+*/
+static void S_StoreSoundChunks( sfx_t *sfx, const short *samples, int count ) {
+	int			i, part;
+	sndBuffer	*chunk, *newchunk;
+
+	chunk = NULL;
+	for ( i = 0; i < count; i += SND_CHUNK_SIZE ) {
+		newchunk = SND_malloc();
+		if ( chunk == NULL ) {
+			sfx->soundData = newchunk;
+		} else {
+			chunk->next = newchunk;
+		}
+		chunk = newchunk;
+
+		part = count - i < SND_CHUNK_SIZE ? count - i : SND_CHUNK_SIZE;
+		Com_Memcpy( chunk->sndChunk, samples + i, part * sizeof( short ) );
+	}
+}
 
 /*
-==============
-S_LoadSound
+===============================================================================
 
-The filename may be different than sfx->name in the case
-of a forced fallback of a player specific sound
-==============
+sound cache
+
+Resampled pcm is written to cache/sound/<crc>_<length>_<rate>.pcm in the
+homepath, keyed by the pk3 content key of the source, so later sessions
+skip both decoding and resampling.  With s_compression the adpcm encoded
+form goes to a matching .adp file instead, so those sessions skip the
+encode as well.  Loose files have no content key and aren't cached.
+
+===============================================================================
 */
-qboolean S_LoadSound( sfx_t *sfx )
-{
-	byte	*data;
-	short	*samples;
-	snd_info_t	info;
-//	int		size;
 
-	// load it in
-	data = S_CodecLoad(sfx->soundName, &info);
-	if(!data)
-		return qfalse;
+#define SND_CACHE_IDENT		(('C'<<24)+('S'<<16)+('N'<<8)+'S')
+#define SND_CACHE_VERSION	2
+
+typedef enum {
+	SND_CACHE_PCM,
+	SND_CACHE_ADPCM
+} sndCacheFormat_t;
+
+typedef struct {
+	int				ident;
+	int				version;
+	unsigned int	contentCrc;
+	unsigned int	contentLength;
+	int				rate;
+	int				format;
+	int				channels;
+	int				samples;
+} sndCacheHeader_t;
+
+static void S_SoundCacheName( const sfx_t *sfx, sndCacheFormat_t format, char *name, int size ) {
+	Com_sprintf( name, size, "cache/sound/%08x_%x_%d.%s", sfx->contentCrc, sfx->contentLength, dma.speed,
+		format == SND_CACHE_ADPCM ? "adp" : "pcm" );
+}
+
+static int S_SoundCacheSize( sndCacheFormat_t format, int channels, int samples ) {
+	if ( format == SND_CACHE_ADPCM ) {
+		return S_AdpcmStoredSize( samples );
+	}
+	return samples * channels * sizeof( short );
+}
+
+/*
+================
+S_LoadSoundCache
+
+returns the cached data inside *buffer, or NULL
+================
+*/
+static void *S_LoadSoundCache( const sfx_t *sfx, sndCacheFormat_t format, int *channels, int *samples, void **buffer ) {
+	char				name[MAX_QPATH];
+	sndCacheHeader_t	*header;
+	long				len;
+
+	*buffer = NULL;
+	if ( !s_resampleCache->integer || !sfx->contentLength ) {
+		return NULL;
+	}
+
+	S_SoundCacheName( sfx, format, name, sizeof( name ) );
+	if ( !FS_FileExists_HomeData( name ) ) {
+		return NULL;
+	}
 
-	if ( info.width == 1 ) {
-		Com_DPrintf(S_COLOR_YELLOW "WARNING: %s is a 8 bit audio file\n", sfx->soundName);
+	len = FS_ReadFile( name, buffer );
+	if ( !*buffer ) {
+		return NULL;
 	}
 
-	if ( info.rate != 22050 ) {
-		Com_DPrintf(S_COLOR_YELLOW "WARNING: %s is not a 22kHz audio file\n", sfx->soundName);
+	header = *buffer;
+	if ( len < sizeof( *header ) || header->ident != SND_CACHE_IDENT || header->version != SND_CACHE_VERSION ||
+		header->contentCrc != sfx->contentCrc || header->contentLength != sfx->contentLength ||
+		header->rate != dma.speed || header->format != format ||
+		header->channels < 1 || header->channels > ( format == SND_CACHE_ADPCM ? 1 : 2 ) || header->samples < 0 ||
+		len != sizeof( *header ) + S_SoundCacheSize( format, header->channels, header->samples ) ) {
+		Com_DPrintf( "S_LoadSoundCache: %s is stale, rebuilding\n", name );
+		FS_FreeFile( *buffer );
+		*buffer = NULL;
+		return NULL;
 	}
 
-	samples = Hunk_AllocateTempMemory(info.channels * info.samples * sizeof(short) * 2);
+	*channels = header->channels;
+	*samples = header->samples;
+	return header + 1;
+}
+
+/*
+================
+S_WriteSoundCache
+
+The pcm, or for adpcm the encoded sfx itself
+================
+*/
+static void S_WriteSoundCache( const sfx_t *sfx, sndCacheFormat_t format, int channels, int samples, const short *pcm ) {
+	char				name[MAX_QPATH];
+	sndCacheHeader_t	*header;
+	int					size;
+
+	if ( !s_resampleCache->integer || !sfx->contentLength ) {
+		return;
+	}
 
-	sfx->lastTimeUsed = Com_Milliseconds()+1;
+	size = sizeof( *header ) + S_SoundCacheSize( format, channels, samples );
+	header = Hunk_AllocateTempMemory( size );
+
+	header->ident = SND_CACHE_IDENT;
+	header->version = SND_CACHE_VERSION;
+	header->contentCrc = sfx->contentCrc;
+	header->contentLength = sfx->contentLength;
+	header->rate = dma.speed;
+	header->format = format;
+	header->channels = channels;
+	header->samples = samples;
+
+	if ( format == SND_CACHE_ADPCM ) {
+		S_AdpcmStoreSound( sfx, (byte *)( header + 1 ) );
+	} else {
+		Com_Memcpy( header + 1, pcm, samples * channels * sizeof( short ) );
+	}
+
+	S_SoundCacheName( sfx, format, name, sizeof( name ) );
+	FS_WriteFile( name, header, size );
+
+	Hunk_FreeTempMemory( header );
+}
+
+/*
+================
+S_StoreSound
+
+pages the pcm into memory the mixer is reading
+================
+*/
+static void S_StoreSound( sfx_t *sfx, short *samples, int count, int channels, qboolean compress ) {
+	SNDDMA_LockMixer();
+
+	sfx->lastTimeUsed = Sys_Milliseconds()+1;
+	sfx->soundData = NULL;
+	sfx->soundLength = count;
 
 	// each of these compression schemes works just fine
 	// but the 16bit quality is much nicer and with a local
@@ -242,33 +479,362 @@ qboolean S_LoadSound( sfx_t *sfx )
 	// manager to do the right thing for us and page
 	// sound in as needed
 
-	if( info.channels == 1 && sfx->soundCompressed == qtrue) {
+	if( compress ) {
 		sfx->soundCompressionMethod = 1;
-		sfx->soundData = NULL;
-		sfx->soundLength = ResampleSfxRaw( samples, info.channels, info.rate, info.width, info.samples, data + info.dataofs );
 		S_AdpcmEncodeSound(sfx, samples);
 #if 0
-	} else if (info.channels == 1 && info.samples>(SND_CHUNK_SIZE*16) && info.width >1) {
+	} else if (channels == 1 && count>(SND_CHUNK_SIZE*16)) {
 		sfx->soundCompressionMethod = 3;
-		sfx->soundData = NULL;
-		sfx->soundLength = ResampleSfxRaw( samples, info.channels, info.rate, info.width, info.samples, (data + info.dataofs) );
 		encodeMuLaw( sfx, samples);
-	} else if (info.channels == 1 && info.samples>(SND_CHUNK_SIZE*6400) && info.width >1) {
+	} else if (channels == 1 && count>(SND_CHUNK_SIZE*6400)) {
 		sfx->soundCompressionMethod = 2;
-		sfx->soundData = NULL;
-		sfx->soundLength = ResampleSfxRaw( samples, info.channels, info.rate, info.width, info.samples, (data + info.dataofs) );
 		encodeWavelet( sfx, samples);
 #endif
 	} else {
 		sfx->soundCompressionMethod = 0;
-		sfx->soundData = NULL;
-		sfx->soundLength = ResampleSfx( sfx, info.channels, info.rate, info.width, info.samples, data + info.dataofs, qfalse );
+		S_StoreSoundChunks( sfx, samples, count * channels );
 	}
 
-	sfx->soundChannels = info.channels;
-	
-	Hunk_FreeTempMemory(samples);
-	Hunk_FreeTempMemory(data);
+	sfx->soundChannels = channels;
+
+	SNDDMA_UnlockMixer();
+
+	if ( compress ) {
+		S_WriteSoundCache( sfx, SND_CACHE_ADPCM, channels, count, NULL );
+	}
+}
+
+/*
+===============================================================================
+
+precache workers
+
+Sounds registered while a level loads are still decoded here, the codecs
+read through the filesystem, but resampling them is most of the work and
+goes to s_precacheThreads workers while cgame carries on registering.  The
+sound is left pending; S_PrecacheUpdate pages finished ones in once a frame
+and S_PrecacheWait finishes one on first use, or all of them before the
+sounds are thrown away.
+
+===============================================================================
+*/
+
+#define MAX_PRECACHE_WORKERS	8
+#define PRECACHE_QUEUE_SIZE		256
+#define PRECACHE_WORKER_MSEC	100
+
+typedef struct {
+	sfx_t		*sfx;
+	qboolean	compress;
+	int			channels;
+	int			inrate;
+	int			inwidth;
+	int			insamples;
+	const byte	*data;		// decoded source
+	float		*scratch;
+	short		*samples;	// resampled by the worker
+	int			count;
+} precacheJob_t;
+
+typedef struct {
+	sndWorker_t			*thread;
+	sndQueue_t			*jobs;		// main thread to worker
+	sndQueue_t			*done;		// worker to main thread
+	int					queued;		// not collected yet, main thread only
+	resampleFilter_t	filter;
+} precacheWorker_t;
+
+static precacheWorker_t	s_precacheWorkers[MAX_PRECACHE_WORKERS];
+static int				s_numPrecacheWorkers;
+static int				s_precachePending;
+
+/*
+================
+S_PrecacheWork
+
+Worker side, the job is only read and written here until it is done
+================
+*/
+static void S_PrecacheWork( void *arg ) {
+	precacheWorker_t	*worker = arg;
+	precacheJob_t		*job;
+
+	while ( SNDDMA_QueuePop( worker->jobs, &job ) ) {
+		job->count = S_ResampleSound( &worker->filter, job->scratch, job->samples,
+			job->channels, job->inrate, job->inwidth, job->insamples, job->data );
+
+		// can't be full, no more are queued than it holds
+		SNDDMA_QueuePush( worker->done, &job );
+	}
+}
+
+/*
+================
+S_PrecacheInit
+================
+*/
+void S_PrecacheInit( void ) {
+	precacheWorker_t	*worker;
+	int					i;
+
+	s_numPrecacheWorkers = 0;
+	s_precachePending = 0;
+
+	for ( i = 0; i < s_precacheThreads->integer && i < MAX_PRECACHE_WORKERS; i++ ) {
+		worker = &s_precacheWorkers[s_numPrecacheWorkers];
+		worker->jobs = SNDDMA_CreateQueue( sizeof( precacheJob_t * ), PRECACHE_QUEUE_SIZE );
+		worker->done = SNDDMA_CreateQueue( sizeof( precacheJob_t * ), PRECACHE_QUEUE_SIZE );
+		worker->queued = 0;
+		worker->filter.cutoff = 0;
+
+		worker->thread = SNDDMA_StartWorker( "precache", S_PrecacheWork, worker, PRECACHE_WORKER_MSEC );
+		if ( !worker->thread ) {
+			SNDDMA_FreeQueue( worker->jobs );
+			SNDDMA_FreeQueue( worker->done );
+			break;
+		}
+
+		s_numPrecacheWorkers++;
+	}
+
+	if ( s_precacheThreads->integer > 0 && !s_numPrecacheWorkers ) {
+		Com_DPrintf( "No precache workers, sounds load on the main thread\n" );
+	}
+}
+
+/*
+================
+S_PrecacheShutdown
+================
+*/
+void S_PrecacheShutdown( void ) {
+	precacheWorker_t	*worker;
+	int					i;
+
+	S_PrecacheWait( NULL );
+
+	for ( i = 0, worker = s_precacheWorkers; i < s_numPrecacheWorkers; i++, worker++ ) {
+		SNDDMA_StopWorker( worker->thread );
+		SNDDMA_FreeQueue( worker->jobs );
+		SNDDMA_FreeQueue( worker->done );
+	}
+
+	s_numPrecacheWorkers = 0;
+}
+
+/*
+================
+S_PrecacheQueue
+
+Hands the decoded source to the least busy worker, qfalse if it has to
+be resampled here instead
+================
+*/
+static qboolean S_PrecacheQueue( sfx_t *sfx, const snd_info_t *info, const byte *data, qboolean compress ) {
+	precacheWorker_t	*worker, *best;
+	precacheJob_t		*job;
+	size_t				scratch, samples, bytes;
+	int					i;
+
+	best = NULL;
+	for ( i = 0, worker = s_precacheWorkers; i < s_numPrecacheWorkers; i++, worker++ ) {
+		if ( worker->queued < PRECACHE_QUEUE_SIZE && ( !best || worker->queued < best->queued ) ) {
+			best = worker;
+		}
+	}
+	if ( !best ) {
+		return qfalse;
+	}
+
+	// one block, freed here once the job comes back
+	scratch = S_ResampleScratch( info->samples ) * sizeof( float );
+	samples = info->channels * ( S_ResampledLength( info->rate, info->samples ) + 1 ) * sizeof( short );
+	bytes = (size_t)info->samples * info->channels * info->width;
+
+	job = malloc( sizeof( *job ) + scratch + samples + bytes );
+	if ( !job ) {
+		return qfalse;
+	}
+
+	job->sfx = sfx;
+	job->compress = compress;
+	job->channels = info->channels;
+	job->inrate = info->rate;
+	job->inwidth = info->width;
+	job->insamples = info->samples;
+	job->scratch = (float *)( job + 1 );
+	job->samples = (short *)( (byte *)job->scratch + scratch );
+	job->data = (byte *)job->samples + samples;
+	job->count = 0;
+	Com_Memcpy( (byte *)job->data, data, bytes );
+
+	if ( !SNDDMA_QueuePush( best->jobs, &job ) ) {
+		free( job );
+		return qfalse;
+	}
+
+	best->queued++;
+	s_precachePending++;
+	sfx->pending = qtrue;
+
+	SNDDMA_WakeWorker( best->thread );
+	return qtrue;
+}
+
+/*
+================
+S_PrecacheUpdate
+
+Pages in whatever the workers have finished, main thread
+================
+*/
+void S_PrecacheUpdate( void ) {
+	precacheWorker_t	*worker;
+	precacheJob_t		*job;
+	int					i;
+
+	for ( i = 0, worker = s_precacheWorkers; i < s_numPrecacheWorkers; i++, worker++ ) {
+		while ( SNDDMA_QueuePop( worker->done, &job ) ) {
+			worker->queued--;
+			s_precachePending--;
+
+			// the same as a sound resampled in S_LoadSound
+			if ( !( job->compress && job->channels == 1 ) ) {
+				S_WriteSoundCache( job->sfx, SND_CACHE_PCM, job->channels, job->count, job->samples );
+			}
+			S_StoreSound( job->sfx, job->samples, job->count, job->channels, job->compress && job->channels == 1 );
+
+			job->sfx->pending = qfalse;
+			S_SfxResident( job->sfx );
+
+			free( job );
+		}
+	}
+}
+
+/*
+================
+S_PrecacheWait
+
+Blocks until sfx is in memory, or every pending sound with a NULL sfx
+================
+*/
+void S_PrecacheWait( const sfx_t *sfx ) {
+	S_PrecacheUpdate();
+
+	while ( sfx ? sfx->pending : s_precachePending > 0 ) {
+		Sys_Sleep( 1 );
+		S_PrecacheUpdate();
+	}
+}
+
+//=============================================================================
+
+/*
+==============
+S_LoadSound
+
+The filename may be different than sfx->name in the case
+of a forced fallback of a player specific sound.  With defer the
+resampling may be left to a precache worker, sfx->pending is set
+until it is done.
+==============
+*/
+qboolean S_LoadSound( sfx_t *sfx, qboolean defer )
+{
+	byte	*data;
+	short	*samples;
+	float	*scratch;
+	void	*cacheBuffer;
+	snd_info_t	info;
+	snd_stream_t	*stream;
+	const byte	*stored;
+	int		channels, count;
+	qboolean	compress;
+//	int		size;
+
+	// long sounds are decoded while they play, see S_StartSoundStream
+	sfx->streamed = qfalse;
+	if ( !sfx->looped && s_streamSize->integer > 0 ) {
+		stream = S_CodecOpenStream( sfx->soundName );
+		if ( stream ) {
+			info = stream->info;
+			S_CodecCloseStream( stream );
+
+			if ( info.size > s_streamSize->integer * 1024 ) {
+				sfx->streamed = qtrue;
+				sfx->soundData = NULL;
+				sfx->soundCompressionMethod = 0;
+				sfx->soundLength = info.samples;
+				sfx->soundChannels = info.channels;
+				return qtrue;
+			}
+		}
+	}
+
+	// adpcm keeps a quarter of the memory, mono only
+	compress = sfx->soundCompressed || s_compression->integer;
+
+	if ( compress ) {
+		// already encoded, nothing to decode
+		stored = S_LoadSoundCache( sfx, SND_CACHE_ADPCM, &channels, &count, &cacheBuffer );
+		if ( stored ) {
+			SNDDMA_LockMixer();
+			sfx->lastTimeUsed = Sys_Milliseconds()+1;
+			sfx->soundData = NULL;
+			sfx->soundLength = count;
+			sfx->soundCompressionMethod = 1;
+			sfx->soundChannels = channels;
+			S_AdpcmLoadSound( sfx, stored );
+			SNDDMA_UnlockMixer();
+
+			FS_FreeFile( cacheBuffer );
+			return qtrue;
+		}
+	}
+
+	data = NULL;
+	samples = S_LoadSoundCache( sfx, SND_CACHE_PCM, &channels, &count, &cacheBuffer );
+
+	if ( !samples ) {
+		// load it in
+		data = S_CodecLoad(sfx->soundName, &info);
+		if(!data)
+			return qfalse;
+
+		if ( info.width == 1 ) {
+			Com_DPrintf(S_COLOR_YELLOW "WARNING: %s is a 8 bit audio file\n", sfx->soundName);
+		}
+
+		if ( info.rate != 22050 ) {
+			Com_DPrintf(S_COLOR_YELLOW "WARNING: %s is not a 22kHz audio file\n", sfx->soundName);
+		}
+
+		if ( defer && info.rate != dma.speed && S_PrecacheQueue( sfx, &info, data + info.dataofs, compress ) ) {
+			Hunk_FreeTempMemory( data );
+			return qtrue;
+		}
+
+		channels = info.channels;
+		samples = Hunk_AllocateTempMemory( channels * ( S_ResampledLength( info.rate, info.samples ) + 1 ) * sizeof( short ) );
+		scratch = Hunk_AllocateTempMemory( S_ResampleScratch( info.samples ) * sizeof( *scratch ) );
+		count = S_ResampleSound( &s_resampleFilter, scratch, samples, channels, info.rate, info.width, info.samples, data + info.dataofs );
+		Hunk_FreeTempMemory( scratch );
+
+		// the adpcm cache below replaces this one
+		if ( info.rate != dma.speed && !( compress && channels == 1 ) ) {
+			S_WriteSoundCache( sfx, SND_CACHE_PCM, channels, count, samples );
+		}
+	}
+
+	S_StoreSound( sfx, samples, count, channels, compress && channels == 1 );
+
+	if ( cacheBuffer ) {
+		FS_FreeFile( cacheBuffer );
+	} else {
+		Hunk_FreeTempMemory(samples);
+		Hunk_FreeTempMemory(data);
+	}
 
 	return qtrue;
 }
@@ -24,6 +24,14 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "client.h"
 #include "snd_local.h"
 
+#if idx64 || defined( __SSE2__ )
+#include <emmintrin.h>
+#define MIX_SSE2
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#include <arm_neon.h>
+#define MIX_NEON
+#endif
+
 static portable_samplepair_t paintbuffer[PAINTBUFFER_SIZE];
 static int snd_vol;
 
@@ -38,7 +46,28 @@ void S_WriteLinearBlastStereo16 (void)
 	int		i;
 	int		val;
 
-	for (i=0 ; i<snd_linear_count ; i+=2)
+	i = 0;
+
+	// eight samples at a time, the narrowing saturates for us
+#if defined( MIX_SSE2 )
+	for ( ; i + 8 <= snd_linear_count ; i += 8 )
+	{
+		__m128i lo = _mm_srai_epi32( _mm_loadu_si128( (const __m128i *)( snd_p + i ) ), 8 );
+		__m128i hi = _mm_srai_epi32( _mm_loadu_si128( (const __m128i *)( snd_p + i + 4 ) ), 8 );
+
+		_mm_storeu_si128( (__m128i *)( snd_out + i ), _mm_packs_epi32( lo, hi ) );
+	}
+#elif defined( MIX_NEON )
+	for ( ; i + 8 <= snd_linear_count ; i += 8 )
+	{
+		int16x4_t lo = vqshrn_n_s32( vld1q_s32( snd_p + i ), 8 );
+		int16x4_t hi = vqshrn_n_s32( vld1q_s32( snd_p + i + 4 ), 8 );
+
+		vst1q_s16( snd_out + i, vcombine_s16( lo, hi ) );
+	}
+#endif
+
+	for ( ; i<snd_linear_count ; i+=2)
 	{
 		val = snd_p[i]>>8;
 		if (val > 0x7fff)
@@ -138,6 +167,79 @@ void S_TransferStereo16 (unsigned long *pbuf, int endtime)
 	}
 }
 
+/*
+===================
+S_TransferStereoFloat
+
+Same as S_TransferStereo16 for 32 bit float output
+===================
+*/
+static void S_TransferStereoFloat (float *pbuf, int endtime)
+{
+	const int	*p;
+	float		*out;
+	int			lpos, count, ls_paintedtime, i, val;
+
+	p = (const int *) paintbuffer;
+	ls_paintedtime = s_paintedtime;
+
+	while (ls_paintedtime < endtime)
+	{
+		// handle recirculating buffer issues
+		lpos = ls_paintedtime % dma.fullsamples;
+		out = pbuf + (lpos<<1);
+
+		count = dma.fullsamples - lpos;
+		if (ls_paintedtime + count > endtime)
+			count = endtime - ls_paintedtime;
+
+		count <<= 1;
+
+		i = 0;
+
+		// clamp to one less than max to make division max out at -1.0f
+#if defined( MIX_SSE2 )
+		{
+			const __m128 lo = _mm_set1_ps( -32767.0f );
+			const __m128 hi = _mm_set1_ps( 32767.0f );
+			const __m128 scale = _mm_set1_ps( 1.0f / 32767.0f );
+
+			for ( ; i + 4 <= count ; i += 4 )
+			{
+				__m128 v = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_loadu_si128( (const __m128i *)( p + i ) ), 8 ) );
+
+				_mm_storeu_ps( out + i, _mm_mul_ps( _mm_min_ps( _mm_max_ps( v, lo ), hi ), scale ) );
+			}
+		}
+#elif defined( MIX_NEON )
+		{
+			const float32x4_t lo = vdupq_n_f32( -32767.0f );
+			const float32x4_t hi = vdupq_n_f32( 32767.0f );
+
+			for ( ; i + 4 <= count ; i += 4 )
+			{
+				float32x4_t v = vcvtq_f32_s32( vshrq_n_s32( vld1q_s32( p + i ), 8 ) );
+
+				vst1q_f32( out + i, vmulq_n_f32( vminq_f32( vmaxq_f32( v, lo ), hi ), 1.0f / 32767.0f ) );
+			}
+		}
+#endif
+
+		for ( ; i < count ; i++ )
+		{
+			val = p[i] >> 8;
+			if (val > 0x7fff)
+				val = 0x7fff;
+			else if (val < -32767)
+				val = -32767;
+			out[i] = ((float) val) / 32767.0f;
+		}
+
+		p += count;
+		ls_paintedtime += (count>>1);
+	}
+}
+
 /*
 ===================
 S_TransferPaintBuffer
@@ -169,6 +271,10 @@ void S_TransferPaintBuffer(int endtime)
 	{	// optimized case
 		S_TransferStereo16 (pbuf, endtime);
 	}
+	else if (dma.isfloat && dma.samplebits == 32 && dma.channels == 2)
+	{
+		S_TransferStereoFloat ((float *) pbuf, endtime);
+	}
 	else
 	{	// general case
 		p = (int *) paintbuffer;
@@ -349,6 +455,154 @@ static void S_PaintChannelFrom16_scalar( channel_t *ch, const sfx_t *sc, int cou
 	}
 }
 
+#if defined( MIX_SSE2 ) || defined( MIX_NEON )
+/*
+=================
+S_PaintRun16
+
+Mixes count sample frames from one chunk. The vector loops scale in float,
+which may round the lowest of the 8 fraction bits differently from the
+integer shift of the scalar loop.
+=================
+*/
+static void S_PaintRun16( portable_samplepair_t *samp, const short *samples, int channels, int count, int leftvol, int rightvol ) {
+	int		i, data;
+
+	i = 0;
+
+#if defined( MIX_SSE2 )
+	if ( channels == 2 ) {
+		const __m128 scale = _mm_setr_ps( leftvol / 256.0f, rightvol / 256.0f, leftvol / 256.0f, rightvol / 256.0f );
+
+		for ( ; i + 4 <= count ; i += 4 ) {
+			__m128i s = _mm_loadu_si128( (const __m128i *)( samples + i * 2 ) );
+			__m128i lo = _mm_srai_epi32( _mm_unpacklo_epi16( s, s ), 16 );
+			__m128i hi = _mm_srai_epi32( _mm_unpackhi_epi16( s, s ), 16 );
+			__m128i *dst = (__m128i *)( samp + i );
+
+			lo = _mm_cvttps_epi32( _mm_mul_ps( _mm_cvtepi32_ps( lo ), scale ) );
+			hi = _mm_cvttps_epi32( _mm_mul_ps( _mm_cvtepi32_ps( hi ), scale ) );
+			_mm_storeu_si128( dst, _mm_add_epi32( _mm_loadu_si128( dst ), lo ) );
+			_mm_storeu_si128( dst + 1, _mm_add_epi32( _mm_loadu_si128( dst + 1 ), hi ) );
+		}
+	} else {
+		const __m128 lscale = _mm_set1_ps( leftvol / 256.0f );
+		const __m128 rscale = _mm_set1_ps( rightvol / 256.0f );
+
+		for ( ; i + 4 <= count ; i += 4 ) {
+			__m128i s = _mm_loadl_epi64( (const __m128i *)( samples + i ) );
+			__m128  f = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpacklo_epi16( s, s ), 16 ) );
+			__m128i l = _mm_cvttps_epi32( _mm_mul_ps( f, lscale ) );
+			__m128i r = _mm_cvttps_epi32( _mm_mul_ps( f, rscale ) );
+			__m128i *dst = (__m128i *)( samp + i );
+
+			_mm_storeu_si128( dst, _mm_add_epi32( _mm_loadu_si128( dst ), _mm_unpacklo_epi32( l, r ) ) );
+			_mm_storeu_si128( dst + 1, _mm_add_epi32( _mm_loadu_si128( dst + 1 ), _mm_unpackhi_epi32( l, r ) ) );
+		}
+	}
+#elif defined( MIX_NEON )
+	if ( channels == 2 ) {
+		const float vols[4] = { leftvol / 256.0f, rightvol / 256.0f, leftvol / 256.0f, rightvol / 256.0f };
+		const float32x4_t scale = vld1q_f32( vols );
+
+		for ( ; i + 4 <= count ; i += 4 ) {
+			int16x8_t s = vld1q_s16( samples + i * 2 );
+			int32_t *dst = (int32_t *)( samp + i );
+			int32x4_t lo = vcvtq_s32_f32( vmulq_f32( vcvtq_f32_s32( vmovl_s16( vget_low_s16( s ) ) ), scale ) );
+			int32x4_t hi = vcvtq_s32_f32( vmulq_f32( vcvtq_f32_s32( vmovl_s16( vget_high_s16( s ) ) ), scale ) );
+
+			vst1q_s32( dst, vaddq_s32( vld1q_s32( dst ), lo ) );
+			vst1q_s32( dst + 4, vaddq_s32( vld1q_s32( dst + 4 ), hi ) );
+		}
+	} else {
+		const float lscale = leftvol / 256.0f;
+		const float rscale = rightvol / 256.0f;
+
+		for ( ; i + 4 <= count ; i += 4 ) {
+			float32x4_t f = vcvtq_f32_s32( vmovl_s16( vld1_s16( samples + i ) ) );
+			int32_t *dst = (int32_t *)( samp + i );
+			int32x4x2_t lr = vzipq_s32( vcvtq_s32_f32( vmulq_n_f32( f, lscale ) ), vcvtq_s32_f32( vmulq_n_f32( f, rscale ) ) );
+
+			vst1q_s32( dst, vaddq_s32( vld1q_s32( dst ), lr.val[0] ) );
+			vst1q_s32( dst + 4, vaddq_s32( vld1q_s32( dst + 4 ), lr.val[1] ) );
+		}
+	}
+#endif
+
+	for ( ; i < count ; i++ ) {
+		data = samples[i * channels];
+		samp[i].left += (data * leftvol)>>8;
+
+		if ( channels == 2 ) {
+			data = samples[i * 2 + 1];
+		}
+		samp[i].right += (data * rightvol)>>8;
+	}
+}
+
+/*
+=================
+S_PaintChannelFrom16_simd
+
+The constant pitch case of S_PaintChannelFrom16_scalar, mixed a chunk
+at a time
+=================
+*/
+static void S_PaintChannelFrom16_simd( channel_t *ch, const sfx_t *sc, int count, int sampleOffset, int bufferOffset ) {
+	int						leftvol, rightvol, run;
+	portable_samplepair_t	*samp;
+	sndBuffer				*chunk;
+
+	if (sc->soundChannels <= 0) {
+		return;
+	}
+
+	samp = &paintbuffer[ bufferOffset ];
+
+	if (ch->doppler) {
+		sampleOffset = sampleOffset*ch->oldDopplerScale;
+	}
+
+	if ( sc->soundChannels == 2 ) {
+		sampleOffset *= sc->soundChannels;
+
+		if ( sampleOffset & 1 ) {
+			sampleOffset &= ~1;
+		}
+	}
+
+	chunk = sc->soundData;
+	while (sampleOffset>=SND_CHUNK_SIZE) {
+		chunk = chunk->next;
+		sampleOffset -= SND_CHUNK_SIZE;
+		if (!chunk) {
+			chunk = sc->soundData;
+		}
+	}
+
+	leftvol = ch->leftvol*snd_vol;
+	rightvol = ch->rightvol*snd_vol;
+
+	while ( count > 0 ) {
+		run = ( SND_CHUNK_SIZE - sampleOffset ) / sc->soundChannels;
+		if ( run > count ) {
+			run = count;
+		}
+
+		S_PaintRun16( samp, chunk->sndChunk + sampleOffset, sc->soundChannels, run, leftvol, rightvol );
+
+		samp += run;
+		count -= run;
+		sampleOffset += run * sc->soundChannels;
+
+		if ( sampleOffset == SND_CHUNK_SIZE && count > 0 ) {
+			chunk = chunk->next;
+			sampleOffset = 0;
+		}
+	}
+}
+#endif
+
 static void S_PaintChannelFrom16( channel_t *ch, const sfx_t *sc, int count, int sampleOffset, int bufferOffset ) {
 #if idppc_altivec
 	if (com_altivec->integer) {
@@ -356,6 +610,12 @@ static void S_PaintChannelFrom16( channel_t *ch, const sfx_t *sc, int count, int
 		S_PaintChannelFrom16_altivec( paintbuffer, snd_vol, ch, sc, count, sampleOffset, bufferOffset );
 		return;
 	}
+#endif
+#if defined( MIX_SSE2 ) || defined( MIX_NEON )
+	if (!ch->doppler || ch->dopplerScale==1.0f) {
+		S_PaintChannelFrom16_simd( ch, sc, count, sampleOffset, bufferOffset );
+		return;
+	}
 #endif
 	S_PaintChannelFrom16_scalar( ch, sc, count, sampleOffset, bufferOffset );
 }
@@ -402,13 +662,22 @@ void S_PaintChannelFromWavelet( channel_t *ch, sfx_t *sc, int count, int sampleO
 	}
 }
 
+/*
+=================
+S_PaintChannelFromADPCM
+
+Decodes a chunk at a time into the scratch buffer and mixes from there
+=================
+*/
 void S_PaintChannelFromADPCM( channel_t *ch, sfx_t *sc, int count, int sampleOffset, int bufferOffset ) {
-	int						data;
 	int						leftvol, rightvol;
-	int						i;
+	int						i, run;
 	portable_samplepair_t	*samp;
 	sndBuffer				*chunk;
 	short					*samples;
+#if !defined( MIX_SSE2 ) && !defined( MIX_NEON )
+	int						j, data;
+#endif
 
 	leftvol = ch->leftvol*snd_vol;
 	rightvol = ch->rightvol*snd_vol;
@@ -427,25 +696,34 @@ void S_PaintChannelFromADPCM( channel_t *ch, sfx_t *sc, int count, int sampleOff
 		i++;
 	}
 
-	if (i!=sfxScratchIndex || sfxScratchPointer != sc) {
-		S_AdpcmGetSamples( chunk, sfxScratchBuffer );
-		sfxScratchIndex = i;
-		sfxScratchPointer = sc;
-	}
-
-	samples = sfxScratchBuffer;
-
-	for ( i=0 ; i<count ; i++ ) {
-		data  = samples[sampleOffset++];
-		samp[i].left += (data * leftvol)>>8;
-		samp[i].right += (data * rightvol)>>8;
+	while ( count > 0 ) {
+		if (i!=sfxScratchIndex || sfxScratchPointer != sc) {
+			S_AdpcmGetSamples( chunk, sfxScratchBuffer );
+			sfxScratchIndex = i;
+			sfxScratchPointer = sc;
+		}
 
-		if (sampleOffset == SND_CHUNK_SIZE*4) {
-			chunk = chunk->next;
-			S_AdpcmGetSamples( chunk, sfxScratchBuffer);
-			sampleOffset = 0;
-			sfxScratchIndex++;
+		run = SND_CHUNK_SIZE*4 - sampleOffset;
+		if ( run > count ) {
+			run = count;
+		}
+		samples = sfxScratchBuffer + sampleOffset;
+
+#if defined( MIX_SSE2 ) || defined( MIX_NEON )
+		S_PaintRun16( samp, samples, 1, run, leftvol, rightvol );
+#else
+		for ( j=0 ; j<run ; j++ ) {
+			data  = samples[j];
+			samp[j].left += (data * leftvol)>>8;
+			samp[j].right += (data * rightvol)>>8;
 		}
+#endif
+
+		samp += run;
+		count -= run;
+		sampleOffset = 0;
+		chunk = chunk->next;
+		i++;
 	}
 }
 
@@ -0,0 +1,224 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// snd_occlusion.c -- coarse sound occlusion from the map's clusters and areas
+
+// Rather than tracing every sound, a source is muffled when its cluster
+// isn't in the listener cluster's PVS, or its area isn't connected to the
+// listener's through open area portals. The gain for every source cluster
+// heard this map is cached against the listener cluster, and only worked out
+// again when the listener changes cluster or every OCCLUSION_REFRESH_MSEC so
+// doors opening and closing are picked up.
+//
+// Clusters are looked up on the game thread, when a sound is started or an
+// entity moves. The mixer only reads the cached gains, under the mixer lock.
+
+#include "client.h"
+#include "snd_local.h"
+
+#define	OCCLUSION_REFRESH_MSEC	250
+#define	OCCLUSION_HIDDEN		0.6f	// not in the listener's PVS
+#define	OCCLUSION_SEALED		0.5f	// behind a closed area portal
+
+#define	AREA_UNSEEN				-2
+
+static int		occlusionNumClusters;
+static void		*occlusionBlock;
+static byte		*occlusionGain;			// per source cluster, 255 is unoccluded
+static int		*occlusionArea;			// per source cluster, AREA_UNSEEN until used
+static int		*occlusionUsed;			// the clusters heard this map
+static int		occlusionNumUsed;
+
+static int		occlusionListener = -1;	// cluster the gains are for
+static int		occlusionListenerArea;
+static int		occlusionTime;
+
+
+/*
+=================
+S_OcclusionClear
+
+Forgets the map, the next S_OcclusionUpdate picks the new one up
+=================
+*/
+void S_OcclusionClear( void ) {
+	// the mixer checks the count before touching the gains
+	SNDDMA_LockMixer();
+	occlusionNumClusters = 0;
+	SNDDMA_UnlockMixer();
+
+	if ( occlusionBlock ) {
+		Z_Free( occlusionBlock );
+		occlusionBlock = NULL;
+	}
+	occlusionGain = NULL;
+	occlusionArea = NULL;
+	occlusionUsed = NULL;
+	occlusionNumUsed = 0;
+	occlusionListener = -1;
+}
+
+/*
+=================
+S_OcclusionAlloc
+=================
+*/
+static void S_OcclusionAlloc( int numClusters ) {
+	int		i;
+
+	S_OcclusionClear();
+
+	if ( numClusters <= 0 ) {
+		return;
+	}
+
+	occlusionBlock = Z_Malloc( numClusters * ( 2 * sizeof( int ) + 1 ) );
+	occlusionArea = (int *)occlusionBlock;
+	occlusionUsed = occlusionArea + numClusters;
+	occlusionGain = (byte *)( occlusionUsed + numClusters );
+
+	for ( i = 0; i < numClusters; i++ ) {
+		occlusionArea[i] = AREA_UNSEEN;
+	}
+	Com_Memset( occlusionGain, 255, numClusters );
+
+	SNDDMA_LockMixer();
+	occlusionNumClusters = numClusters;
+	SNDDMA_UnlockMixer();
+}
+
+/*
+=================
+S_OcclusionPair
+
+Gain of a source cluster heard from the listener cluster
+=================
+*/
+static byte S_OcclusionPair( int cluster ) {
+	const byte	*pvs;
+	int			area;
+	float		gain;
+
+	if ( occlusionListener < 0 || cluster == occlusionListener ) {
+		return 255;
+	}
+
+	gain = 1.0f;
+
+	pvs = CM_ClusterPVS( occlusionListener );
+	if ( !( pvs[cluster >> 3] & ( 1 << ( cluster & 7 ) ) ) ) {
+		gain *= OCCLUSION_HIDDEN;
+	}
+
+	area = occlusionArea[cluster];
+	if ( area >= 0 && occlusionListenerArea >= 0 && !CM_AreasConnected( occlusionListenerArea, area ) ) {
+		gain *= OCCLUSION_SEALED;
+	}
+
+	gain = 1.0f - Com_Clamp( 0.0f, 1.0f, s_occlusion->value ) * ( 1.0f - gain );
+	return (byte)( gain * 255 );
+}
+
+/*
+=================
+S_OcclusionUpdate
+
+Game thread, once a frame with the listener's position
+=================
+*/
+void S_OcclusionUpdate( const vec3_t listener ) {
+	int		leaf, cluster, now;
+	int		i;
+
+	if ( CM_NumClusters() != occlusionNumClusters ) {
+		S_OcclusionAlloc( CM_NumClusters() );
+	}
+
+	if ( !occlusionNumClusters ) {
+		return;
+	}
+
+	leaf = CM_PointLeafnum( listener );
+	cluster = CM_LeafCluster( leaf );
+	now = Sys_Milliseconds();
+
+	if ( cluster == occlusionListener && now - occlusionTime < OCCLUSION_REFRESH_MSEC
+		&& !s_occlusion->modified ) {
+		return;
+	}
+
+	occlusionListener = cluster;
+	occlusionListenerArea = CM_LeafArea( leaf );
+	occlusionTime = now;
+	s_occlusion->modified = qfalse;
+
+	for ( i = 0; i < occlusionNumUsed; i++ ) {
+		occlusionGain[occlusionUsed[i]] = S_OcclusionPair( occlusionUsed[i] );
+	}
+}
+
+/*
+=================
+S_OcclusionCluster
+
+Game thread, returns the cluster to pass to S_OcclusionGain for a sound
+at origin, -1 if it shouldn't be occluded
+=================
+*/
+int S_OcclusionCluster( const vec3_t origin ) {
+	int		leaf, cluster;
+
+	// nothing until S_OcclusionUpdate has seen the current map
+	if ( !occlusionNumClusters || CM_NumClusters() != occlusionNumClusters
+		|| s_occlusion->value <= 0 ) {
+		return -1;
+	}
+
+	leaf = CM_PointLeafnum( origin );
+	cluster = CM_LeafCluster( leaf );
+	if ( cluster < 0 || cluster >= occlusionNumClusters ) {
+		return -1;
+	}
+
+	// first time this map, the gain is cached from here on
+	if ( occlusionArea[cluster] == AREA_UNSEEN ) {
+		occlusionArea[cluster] = CM_LeafArea( leaf );
+		occlusionUsed[occlusionNumUsed++] = cluster;
+		occlusionGain[cluster] = S_OcclusionPair( cluster );
+	}
+
+	return cluster;
+}
+
+/*
+=================
+S_OcclusionGain
+
+Mixer side, from 0 to 1
+=================
+*/
+float S_OcclusionGain( int cluster ) {
+	if ( cluster < 0 || cluster >= occlusionNumClusters ) {
+		return 1.0f;
+	}
+
+	return occlusionGain[cluster] * ( 1.0f / 255 );
+}
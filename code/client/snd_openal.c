@@ -138,7 +138,6 @@ typedef struct alSfx_s
 	qboolean	isDefaultChecked;		// Sound has been check if it isDefault
 	qboolean	inMemory;				// Sound is stored in memory
 	qboolean	isLocked;				// Sound is locked (can not be unloaded)
-	int				lastUsedTime;		// Time last used
 
 	int				loopCnt;		// number of loops using this sfx
 	int				loopActiveCnt;		// number of playing loops using this sfx
@@ -148,12 +147,22 @@ typedef struct alSfx_s
 static qboolean alBuffersInitialised = qfalse;
 
 // Sound effect storage, data structures
-#define MAX_SFX 4096
 static alSfx_t knownSfx[MAX_SFX];
 static sfxHandle_t numSfx = 0;
+static sfxRegistry_t sfxRegistry;
 
 static sfxHandle_t default_sfx;
 
+/*
+=================
+S_AL_BufferName
+=================
+*/
+static const char *S_AL_BufferName( int sfx )
+{
+	return knownSfx[sfx].filename;
+}
+
 /*
 =================
 S_AL_BufferFindFree
@@ -163,22 +172,11 @@ Find a free handle
 */
 static sfxHandle_t S_AL_BufferFindFree( void )
 {
-	int i;
+	// Handles are only released all at once, so the next one is free
+	if(numSfx == MAX_SFX)
+		Com_Error(ERR_FATAL, "S_AL_BufferFindFree: No free sound handles");
 
-	for(i = 0; i < MAX_SFX; i++)
-	{
-		// Got one
-		if(knownSfx[i].filename[0] == '\0')
-		{
-			if(i >= numSfx)
-				numSfx = i + 1;
-			return i;
-		}
-	}
-
-	// Shit...
-	Com_Error(ERR_FATAL, "S_AL_BufferFindFree: No free sound handles");
-	return -1;
+	return numSfx++;
 }
 
 /*
@@ -191,8 +189,7 @@ Find a sound effect if loaded, set up a handle otherwise
 static sfxHandle_t S_AL_BufferFind(const char *filename)
 {
 	// Look it up in the table
-	sfxHandle_t sfx = -1;
-	int i;
+	sfxHandle_t sfx;
 
 	if ( !filename ) {
 		Com_Error( ERR_FATAL, "Sound name is NULL" );
@@ -213,14 +210,7 @@ static sfxHandle_t S_AL_BufferFind(const char *filename)
 		return 0;
 	}
 
-	for(i = 0; i < numSfx; i++)
-	{
-		if(!Q_stricmp(knownSfx[i].filename, filename))
-		{
-			sfx = i;
-			break;
-		}
-	}
+	sfx = S_RegistryFind(&sfxRegistry, filename);
 
 	// Not found in table?
 	if(sfx == -1)
@@ -234,6 +224,7 @@ static sfxHandle_t S_AL_BufferFind(const char *filename)
 		memset(ptr, 0, sizeof(*ptr));
 		ptr->masterLoopSrc = -1;
 		strcpy(ptr->filename, filename);
+		S_RegistryLink(&sfxRegistry, sfx);
 	}
 
 	// Return the handle
@@ -296,6 +287,19 @@ static void S_AL_BufferUseDefault(sfxHandle_t sfx)
 	knownSfx[sfx].buffer = knownSfx[default_sfx].buffer;
 }
 
+/*
+=================
+S_AL_BufferTouch
+
+Moves a resident, unlocked sound to the front of the eviction order
+=================
+*/
+static void S_AL_BufferTouch(sfxHandle_t sfx)
+{
+	if(knownSfx[sfx].inMemory && !knownSfx[sfx].isLocked)
+		S_RegistryTouch(&sfxRegistry, sfx);
+}
+
 /*
 =================
 S_AL_BufferUnload
@@ -317,6 +321,7 @@ static void S_AL_BufferUnload(sfxHandle_t sfx)
 				knownSfx[sfx].filename);
 
 	knownSfx[sfx].inMemory = qfalse;
+	S_RegistryForget(&sfxRegistry, sfx);
 }
 
 /*
@@ -326,23 +331,8 @@ S_AL_BufferEvict
 */
 static qboolean S_AL_BufferEvict( void )
 {
-	int	i, oldestBuffer = -1;
-	int	oldestTime = Sys_Milliseconds( );
-
-	for( i = 0; i < numSfx; i++ )
-	{
-		if( !knownSfx[ i ].filename[ 0 ] )
-			continue;
-
-		if( !knownSfx[ i ].inMemory )
-			continue;
-
-		if( knownSfx[ i ].lastUsedTime < oldestTime )
-		{
-			oldestTime = knownSfx[ i ].lastUsedTime;
-			oldestBuffer = i;
-		}
-	}
+	// locked sounds and the one being loaded are never on the use order
+	int	oldestBuffer = S_RegistryOldest( &sfxRegistry );
 
 	if( oldestBuffer >= 0 )
 	{
@@ -488,6 +478,7 @@ static void S_AL_BufferLoad(sfxHandle_t sfx, qboolean cache)
 
 	// Woo!
 	curSfx->inMemory = qtrue;
+	S_AL_BufferTouch(sfx);
 }
 
 /*
@@ -503,7 +494,7 @@ void S_AL_BufferUse(sfxHandle_t sfx)
 
 	if((!knownSfx[sfx].inMemory) && (!knownSfx[sfx].isDefault))
 		S_AL_BufferLoad(sfx, qtrue);
-	knownSfx[sfx].lastUsedTime = Sys_Milliseconds();
+	S_AL_BufferTouch(sfx);
 }
 
 /*
@@ -520,11 +511,12 @@ qboolean S_AL_BufferInit( void )
 	// Clear the hash table, and SFX table
 	memset(knownSfx, 0, sizeof(knownSfx));
 	numSfx = 0;
+	S_RegistryClear(&sfxRegistry, S_AL_BufferName);
 
 	// Load the default sound, and lock it
 	default_sfx = S_AL_BufferFind("sound/feedback/hit.wav");
-	S_AL_BufferUse(default_sfx);
 	knownSfx[default_sfx].isLocked = qtrue;
+	S_AL_BufferUse(default_sfx);
 
 	// All done
 	alBuffersInitialised = qtrue;
@@ -570,7 +562,7 @@ sfxHandle_t S_AL_RegisterSound( const char *sample, qboolean compressed )
 
 	if((!knownSfx[sfx].inMemory) && (!knownSfx[sfx].isDefault))
 		S_AL_BufferLoad(sfx, s_alPrecache->integer);
-	knownSfx[sfx].lastUsedTime = Com_Milliseconds();
+	S_AL_BufferTouch(sfx);
 
 	if (knownSfx[sfx].isDefault) {
 		return 0;
@@ -621,6 +613,9 @@ typedef struct src_s
 	vec3_t		loopSpeakerPos;		// Origin of the loop speaker
 	
 	qboolean	local;			// Is this local (relative to the cam)
+
+	int		voice;			// One-shot voice playing here, -1 if none
+	int		freeSlot;		// Position in srcFree while inactive
 } src_t;
 
 #ifdef __APPLE__
@@ -631,6 +626,8 @@ typedef struct src_s
 static src_t srcList[MAX_SRC];
 static int srcCount = 0;
 static int srcActiveCnt = 0;
+static srcHandle_t srcFree[MAX_SRC];	// inactive sources, so taking one doesn't scan
+static int srcFreeCnt = 0;
 static qboolean alSourcesInitialised = qfalse;
 static int lastListenerNumber = -1;
 static vec3_t lastListenerOrigin = { 0.0f, 0.0f, 0.0f };
@@ -650,6 +647,36 @@ typedef struct sentity_s
 
 static sentity_t entityList[MAX_GENTITIES];
 
+/*
+One-shot sounds play as voices.  A voice runs on the clock whether or
+not it holds a source; once a frame the voices that matter most get the
+sources one-shots can have and the rest wait without one, resuming at
+the right offset if they are promoted again before they end.
+*/
+#define MAX_VOICES 512
+
+typedef struct alVoice_s
+{
+	sfxHandle_t	sfx;
+	alSrcPriority_t	priority;
+	int		entity;
+	int		channel;
+	qboolean	local;
+	qboolean	isTracking;		// follows entity instead of origin
+	vec3_t		origin;
+
+	int		startTime;		// Sys_Milliseconds when started
+	int		endTime;		// when a voice without a source is done
+	srcHandle_t	src;			// -1 while virtual
+	float		score;			// audibility, higher keeps a source
+	int		slot;			// position in voiceActive, or next free voice
+} alVoice_t;
+
+static alVoice_t voiceList[MAX_VOICES];
+static int voiceActive[MAX_VOICES];
+static int voiceActiveCnt = 0;
+static int voiceFree = -1;
+
 /*
 =================
 S_AL_SanitiseVector
@@ -753,6 +780,51 @@ static qboolean S_AL_HearingThroughEntity( int entityNum )
 		return qfalse; //not the player
 }
 
+/*
+=================
+S_AL_SrcFreePush
+=================
+*/
+static void S_AL_SrcFreePush(srcHandle_t src)
+{
+	srcList[src].freeSlot = srcFreeCnt;
+	srcFree[srcFreeCnt++] = src;
+}
+
+/*
+=================
+S_AL_SrcFreeRemove
+=================
+*/
+static void S_AL_SrcFreeRemove(srcHandle_t src)
+{
+	int slot = srcList[src].freeSlot;
+
+	srcFree[slot] = srcFree[--srcFreeCnt];
+	srcList[srcFree[slot]].freeSlot = slot;
+}
+
+/*
+=================
+S_AL_VoiceInit
+=================
+*/
+static void S_AL_VoiceInit( void )
+{
+	int i;
+
+	memset(voiceList, 0, sizeof(voiceList));
+	voiceActiveCnt = 0;
+	voiceFree = -1;
+
+	for(i = MAX_VOICES - 1; i >= 0; i--)
+	{
+		voiceList[i].src = -1;
+		voiceList[i].slot = voiceFree;
+		voiceFree = i;
+	}
+}
+
 /*
 =================
 S_AL_SrcInit
@@ -768,6 +840,7 @@ qboolean S_AL_SrcInit( void )
 	memset(srcList, 0, sizeof(srcList));
 	srcCount = 0;
 	srcActiveCnt = 0;
+	srcFreeCnt = 0;
 
 	// Cap s_alSources to MAX_SRC
 	limit = s_alSources->integer;
@@ -783,9 +856,16 @@ qboolean S_AL_SrcInit( void )
 		qalGenSources(1, &srcList[i].alSource);
 		if(qalGetError() != AL_NO_ERROR)
 			break;
+		srcList[i].voice = -1;
 		srcCount++;
 	}
 
+	// lowest handles are taken first
+	for(i = srcCount - 1; i >= 0; i--)
+		S_AL_SrcFreePush(i);
+
+	S_AL_VoiceInit();
+
 	// All done. Print this for informational purposes
 	Com_Printf( "Allocated %d sources.\n", srcCount);
 	alSourcesInitialised = qtrue;
@@ -1017,6 +1097,13 @@ static void S_AL_SrcKill(srcHandle_t src)
 	if(curSource->isLocked)
 		return;
 
+	// A one-shot losing its source carries on as a virtual voice
+	if(curSource->voice != -1)
+	{
+		voiceList[curSource->voice].src = -1;
+		curSource->voice = -1;
+	}
+
 	// Remove the entity association and loop master status
 	if(curSource->isLooping)
 	{
@@ -1054,6 +1141,7 @@ static void S_AL_SrcKill(srcHandle_t src)
 	{
 		curSource->isActive = qfalse;
 		srcActiveCnt--;
+		S_AL_SrcFreePush(src);
 	}
 	curSource->isLocked = qfalse;
 	curSource->isTracking = qfalse;
@@ -1078,6 +1166,16 @@ srcHandle_t S_AL_SrcAlloc( alSrcPriority_t priority, int entnum, int channel )
 	int weakest_numloops = 0;
 	src_t *curSource;
 
+	if(srcFreeCnt)
+	{
+		empty = srcFree[srcFreeCnt - 1];
+		S_AL_SrcFreeRemove(empty);
+		S_AL_SrcKill(empty);
+		srcList[empty].isActive = qtrue;
+		srcActiveCnt++;
+		return empty;
+	}
+
 	for(i = 0; i < srcCount; i++)
 	{
 		curSource = &srcList[i];
@@ -1145,6 +1243,7 @@ srcHandle_t S_AL_SrcAlloc( alSrcPriority_t priority, int entnum, int channel )
 	if(empty >= 0)
 	{
 		S_AL_SrcKill(empty);
+		S_AL_SrcFreeRemove(empty);
 		srcList[empty].isActive = qtrue;
 		srcActiveCnt++;
 	}
@@ -1240,6 +1339,306 @@ static qboolean S_AL_CheckInput(int entityNum, sfxHandle_t sfx)
 	return qfalse;
 }
 
+/*
+=================
+S_AL_VoiceFree
+=================
+*/
+static void S_AL_VoiceFree(int voice)
+{
+	alVoice_t *v = &voiceList[voice];
+	int last;
+
+	if(v->src != -1)
+	{
+		srcList[v->src].voice = -1;
+		v->src = -1;
+	}
+
+	// swap the last active voice into this slot
+	last = voiceActive[--voiceActiveCnt];
+	voiceActive[v->slot] = last;
+	voiceList[last].slot = v->slot;
+
+	v->slot = voiceFree;
+	voiceFree = voice;
+}
+
+/*
+=================
+S_AL_VoicePromote
+
+Gives a virtual voice a free source, picking up where it would be by now
+=================
+*/
+static void S_AL_VoicePromote(int voice)
+{
+	alVoice_t *v = &voiceList[voice];
+	src_t *curSource;
+	srcHandle_t src;
+	int elapsed;
+
+	src = srcFree[srcFreeCnt - 1];
+	S_AL_SrcFreeRemove(src);
+	srcList[src].isActive = qtrue;
+	srcActiveCnt++;
+
+	S_AL_SrcSetup(src, v->sfx, v->priority, v->entity, v->channel, v->local);
+
+	curSource = &srcList[src];
+	curSource->voice = voice;
+	curSource->isTracking = v->isTracking;
+	v->src = src;
+
+	if(!v->local)
+	{
+		qalSourcefv(curSource->alSource, AL_POSITION, v->origin);
+		S_AL_ScaleGain(curSource, v->origin);
+	}
+
+	elapsed = Sys_Milliseconds() - v->startTime;
+	if(elapsed > 0)
+		qalSourcef(curSource->alSource, AL_SEC_OFFSET, elapsed / 1000.0f);
+
+	// Start it playing
+	curSource->isPlaying = qtrue;
+	qalSourcePlay(curSource->alSource);
+}
+
+/*
+=================
+S_AL_VoiceStart
+
+Starts a one-shot as a voice, playing right away if a source is free
+=================
+*/
+static void S_AL_VoiceStart(sfxHandle_t sfx, alSrcPriority_t priority, int entnum, int channel,
+		qboolean local, const vec3_t origin, qboolean tracking)
+{
+	alVoice_t *v;
+	alSfx_t *curSfx = &knownSfx[sfx];
+	int voice;
+
+	if(voiceFree == -1)
+	{
+		Com_DPrintf(S_COLOR_YELLOW "WARNING: out of voices, dropping sfx %d\n", sfx);
+		return;
+	}
+
+	voice = voiceFree;
+	v = &voiceList[voice];
+	voiceFree = v->slot;
+
+	v->slot = voiceActiveCnt;
+	voiceActive[voiceActiveCnt++] = voice;
+
+	v->sfx = sfx;
+	v->priority = priority;
+	v->entity = entnum;
+	v->channel = channel;
+	v->local = local;
+	v->isTracking = tracking;
+	if(origin)
+		VectorCopy(origin, v->origin);
+	else
+		VectorClear(v->origin);
+
+	v->startTime = Sys_Milliseconds();
+	v->endTime = v->startTime;
+	if(curSfx->info.rate > 0)
+		v->endTime += (long long)curSfx->info.samples * 1000 / curSfx->info.rate;
+	v->src = -1;
+	v->score = 0.0f;
+
+	if(srcFreeCnt)
+		S_AL_VoicePromote(voice);
+}
+
+/*
+=================
+S_AL_VoiceScore
+
+How much a voice would be heard, local sounds above any positional one
+=================
+*/
+static float S_AL_VoiceScore(const alVoice_t *v)
+{
+	float distance, gain;
+
+	if(v->local)
+		return 2.0f;
+
+	distance = Distance(v->origin, lastListenerOrigin);
+
+	// the inverse distance clamped model OpenAL applies
+	if(distance <= s_alMinDistance->value)
+		gain = 1.0f;
+	else
+		gain = s_alMinDistance->value / (s_alMinDistance->value + s_alRolloff->value * (distance - s_alMinDistance->value));
+
+	// and the fadeout S_AL_ScaleGain adds past s_alMaxDistance
+	distance -= s_alMaxDistance->value;
+	if(distance > 0)
+	{
+		if(distance >= s_alGraceDistance->value)
+			return 0.0f;
+		gain *= 1.0f - distance / s_alGraceDistance->value;
+	}
+
+	return gain;
+}
+
+/*
+=================
+S_AL_VoiceHeapDown
+
+Restores the min-heap of voice indices below node
+=================
+*/
+static void S_AL_VoiceHeapDown(int *heap, int count, int node)
+{
+	int child, voice = heap[node];
+
+	while((child = node * 2 + 1) < count)
+	{
+		if(child + 1 < count && voiceList[heap[child + 1]].score < voiceList[heap[child]].score)
+			child++;
+
+		if(voiceList[heap[child]].score >= voiceList[voice].score)
+			break;
+
+		heap[node] = heap[child];
+		node = child;
+	}
+
+	heap[node] = voice;
+}
+
+/*
+=================
+S_AL_VoiceUpdate
+
+Retires finished voices, then hands the sources one-shots may use to
+the most audible voices, demoting whatever falls out of that set
+=================
+*/
+static void S_AL_VoiceUpdate( void )
+{
+	int heap[MAX_VOICES];
+	qboolean keep[MAX_VOICES];
+	int i, voice, budget, heapCnt, numVirtual;
+	int now = Sys_Milliseconds();
+	alVoice_t *v;
+
+	numVirtual = 0;
+	budget = srcFreeCnt;
+
+	for(i = 0; i < voiceActiveCnt; i++)
+	{
+		voice = voiceActive[i];
+		v = &voiceList[voice];
+
+		if(v->src == -1 && now >= v->endTime)
+		{
+			// freeing swaps the last voice into slot i
+			S_AL_VoiceFree(voice);
+			i--;
+			continue;
+		}
+
+		if(v->isTracking)
+			VectorCopy(entityList[v->entity].origin, v->origin);
+
+		v->score = S_AL_VoiceScore(v);
+
+		if(v->src == -1)
+		{
+			if(v->score > 0.0f)
+				numVirtual++;
+		}
+		else
+		{
+			// a little hysteresis so near ties don't swap sources every frame
+			v->score *= 1.25f;
+			budget++;
+		}
+	}
+
+	if(!numVirtual)
+		return;
+
+	// loops out of range keep their source stopped, audible voices come first
+	for(i = 0; i < srcCount && srcFreeCnt < numVirtual; i++)
+	{
+		src_t *curSource = &srcList[i];
+
+		if(curSource->isActive && !curSource->isLocked && curSource->isLooping && !curSource->isPlaying)
+		{
+			S_AL_SrcKill(i);
+			budget++;
+		}
+	}
+
+	// the budget most audible voices, lowest score on top
+	heapCnt = 0;
+	for(i = 0; i < voiceActiveCnt; i++)
+	{
+		voice = voiceActive[i];
+		keep[voice] = qfalse;
+
+		if(heapCnt < budget)
+		{
+			int node = heapCnt++;
+
+			// sift up
+			while(node > 0 && voiceList[heap[(node - 1) / 2]].score > voiceList[voice].score)
+			{
+				heap[node] = heap[(node - 1) / 2];
+				node = (node - 1) / 2;
+			}
+			heap[node] = voice;
+		}
+		else if(heapCnt && voiceList[voice].score > voiceList[heap[0]].score)
+		{
+			heap[0] = voice;
+			S_AL_VoiceHeapDown(heap, heapCnt, 0);
+		}
+	}
+
+	for(i = 0; i < heapCnt; i++)
+		keep[heap[i]] = qtrue;
+
+	// demote first so the promotions below have sources
+	for(i = 0; i < voiceActiveCnt; i++)
+	{
+		v = &voiceList[voiceActive[i]];
+
+		if(v->src != -1 && !keep[voiceActive[i]])
+			S_AL_SrcKill(v->src);
+	}
+
+	for(i = 0; i < voiceActiveCnt && srcFreeCnt; i++)
+	{
+		voice = voiceActive[i];
+		v = &voiceList[voice];
+
+		// inaudible voices stay virtual until they come in range
+		if(v->src == -1 && keep[voice] && v->score > 0.0f)
+			S_AL_VoicePromote(voice);
+	}
+}
+
+/*
+=================
+S_AL_VoiceShutup
+=================
+*/
+static void S_AL_VoiceShutup( void )
+{
+	while(voiceActiveCnt)
+		S_AL_VoiceFree(voiceActive[voiceActiveCnt - 1]);
+}
+
 /*
 =================
 S_AL_StartLocalSound
@@ -1250,23 +1649,10 @@ Play a local (non-spatialized) sound effect
 static
 void S_AL_StartLocalSound(sfxHandle_t sfx, int channel)
 {
-	srcHandle_t src;
-	
 	if(S_AL_CheckInput(0, sfx))
 		return;
 
-	// Try to grab a source
-	src = S_AL_SrcAlloc(SRCPRI_LOCAL, -1, channel);
-	
-	if(src == -1)
-		return;
-
-	// Set up the effect
-	S_AL_SrcSetup(src, sfx, SRCPRI_LOCAL, -1, channel, qtrue);
-
-	// Start it playing
-	srcList[src].isPlaying = qtrue;
-	qalSourcePlay(srcList[src].alSource);
+	S_AL_VoiceStart(sfx, SRCPRI_LOCAL, -1, channel, qtrue, NULL, qfalse);
 }
 
 /*
@@ -1279,8 +1665,6 @@ Play a one-shot sound effect
 static void S_AL_StartSound( vec3_t origin, int entnum, int entchannel, sfxHandle_t sfx )
 {
 	vec3_t sorigin;
-	srcHandle_t src;
-	src_t *curSource;
 
 	if(origin)
 	{
@@ -1304,33 +1688,8 @@ static void S_AL_StartSound( vec3_t origin, int entnum, int entchannel, sfxHandl
 	}
 	
 	S_AL_SanitiseVector(sorigin);
-	
-	if((srcActiveCnt > 5 * srcCount / 3) &&
-		(DistanceSquared(sorigin, lastListenerOrigin) >=
-		(s_alMaxDistance->value + s_alGraceDistance->value) * (s_alMaxDistance->value + s_alGraceDistance->value)))
-	{
-		// We're getting tight on sources and source is not within hearing distance so don't add it
-		return;
-	}
-
-	// Try to grab a source
-	src = S_AL_SrcAlloc(SRCPRI_ONESHOT, entnum, entchannel);
-	if(src == -1)
-		return;
-
-	S_AL_SrcSetup(src, sfx, SRCPRI_ONESHOT, entnum, entchannel, qfalse);
-	
-	curSource = &srcList[src];
-
-	if(!origin)
-		curSource->isTracking = qtrue;
-		
-	qalSourcefv(curSource->alSource, AL_POSITION, sorigin );
-	S_AL_ScaleGain(curSource, sorigin);
 
-	// Start it playing
-	curSource->isPlaying = qtrue;
-	qalSourcePlay(curSource->alSource);
+	S_AL_VoiceStart(sfx, SRCPRI_ONESHOT, entnum, entchannel, qfalse, sorigin, !origin);
 }
 
 /*
@@ -1656,6 +2015,8 @@ void S_AL_SrcUpdate( void )
 	        	qalGetSourcei(curSource->alSource, AL_SOURCE_STATE, &state);
 	        	if(state == AL_STOPPED)
         		{
+				if(curSource->voice != -1)
+					S_AL_VoiceFree(curSource->voice);
 	        		curSource->isPlaying = qfalse;
 		        	S_AL_SrcKill(i);
 		        	continue;
@@ -1683,6 +2044,9 @@ static
 void S_AL_SrcShutup( void )
 {
 	int i;
+
+	S_AL_VoiceShutup();
+
 	for(i = 0; i < srcCount; i++)
 		S_AL_SrcKill(i);
 }
@@ -2329,6 +2693,7 @@ void S_AL_Update( void )
 
 	// Update SFX channels
 	S_AL_SrcUpdate();
+	S_AL_VoiceUpdate();
 
 	// Update streams
 	for (i = 0; i < MAX_RAW_STREAMS; i++)
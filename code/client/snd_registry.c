@@ -0,0 +1,173 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// snd_registry.c -- sfx name lookup and use order for the sound back ends
+
+#include "client.h"
+#include "snd_local.h"
+
+#define	LRU_NOT_RESIDENT	-2
+
+/*
+================
+S_RegistryHash
+================
+*/
+static int S_RegistryHash( const char *name ) {
+	int		i;
+	long	hash;
+	char	letter;
+
+	hash = 0;
+	i = 0;
+	while ( name[i] != '\0' ) {
+		letter = tolower( name[i] );
+		if ( letter == '\\' ) letter = '/';		// damn path names
+		hash += (long)( letter ) * ( i + 119 );
+		i++;
+	}
+	hash = ( hash ^ ( hash >> 10 ) ^ ( hash >> 20 ) );
+	return hash & ( SFX_HASH_SIZE - 1 );
+}
+
+/*
+================
+S_RegistryClear
+
+Forgets every sound, used when the back end wipes its sfx array
+================
+*/
+void S_RegistryClear( sfxRegistry_t *reg, const char *(*name)( int sfx ) ) {
+	int		i;
+
+	reg->name = name;
+
+	for ( i = 0 ; i < SFX_HASH_SIZE ; i++ ) {
+		reg->hashTable[i] = -1;
+	}
+
+	for ( i = 0 ; i < MAX_SFX ; i++ ) {
+		reg->hashNext[i] = -1;
+		reg->lruPrev[i] = LRU_NOT_RESIDENT;
+		reg->lruNext[i] = -1;
+	}
+
+	reg->lruHead = -1;
+	reg->lruTail = -1;
+}
+
+/*
+================
+S_RegistryFind
+
+Returns the sfx registered under name, or -1
+================
+*/
+int S_RegistryFind( const sfxRegistry_t *reg, const char *name ) {
+	int		sfx;
+
+	for ( sfx = reg->hashTable[S_RegistryHash( name )] ; sfx >= 0 ; sfx = reg->hashNext[sfx] ) {
+		if ( !Q_stricmp( reg->name( sfx ), name ) ) {
+			return sfx;
+		}
+	}
+
+	return -1;
+}
+
+/*
+================
+S_RegistryLink
+
+Makes a newly named sfx findable
+================
+*/
+void S_RegistryLink( sfxRegistry_t *reg, int sfx ) {
+	int		hash;
+
+	hash = S_RegistryHash( reg->name( sfx ) );
+
+	reg->hashNext[sfx] = reg->hashTable[hash];
+	reg->hashTable[hash] = sfx;
+}
+
+/*
+================
+S_RegistryForget
+
+Takes a sfx off the use order when its data is freed
+================
+*/
+void S_RegistryForget( sfxRegistry_t *reg, int sfx ) {
+	if ( reg->lruPrev[sfx] == LRU_NOT_RESIDENT ) {
+		return;
+	}
+
+	if ( reg->lruPrev[sfx] >= 0 ) {
+		reg->lruNext[reg->lruPrev[sfx]] = reg->lruNext[sfx];
+	} else {
+		reg->lruHead = reg->lruNext[sfx];
+	}
+
+	if ( reg->lruNext[sfx] >= 0 ) {
+		reg->lruPrev[reg->lruNext[sfx]] = reg->lruPrev[sfx];
+	} else {
+		reg->lruTail = reg->lruPrev[sfx];
+	}
+
+	reg->lruPrev[sfx] = LRU_NOT_RESIDENT;
+	reg->lruNext[sfx] = -1;
+}
+
+/*
+================
+S_RegistryTouch
+
+Marks a resident sfx as the most recently used one
+================
+*/
+void S_RegistryTouch( sfxRegistry_t *reg, int sfx ) {
+	if ( reg->lruHead == sfx ) {
+		return;
+	}
+
+	S_RegistryForget( reg, sfx );
+
+	reg->lruPrev[sfx] = -1;
+	reg->lruNext[sfx] = reg->lruHead;
+	if ( reg->lruHead >= 0 ) {
+		reg->lruPrev[reg->lruHead] = sfx;
+	} else {
+		reg->lruTail = sfx;
+	}
+	reg->lruHead = sfx;
+}
+
+/*
+================
+S_RegistryOldest
+
+Returns the least recently used resident sfx, or -1
+================
+*/
+int S_RegistryOldest( const sfxRegistry_t *reg ) {
+	return reg->lruTail;
+}
@@ -525,7 +525,7 @@ void BotMatch_HelpAccompany(bot_state_t *bs, bot_match_t *match) {
 	BotEntityInfo(client, &entinfo);
 	//if info is valid (in PVS)
 	if (entinfo.valid) {
-		areanum = BotPointAreaNum(entinfo.origin);
+		areanum = BotEntityAreaNum(&entinfo);
 		if (areanum) {// && trap_AAS_AreaReachability(areanum)) {
 			bs->teamgoal.entitynum = client;
 			bs->teamgoal.areanum = areanum;
@@ -723,7 +723,7 @@ void BotMatch_Camp(bot_state_t *bs, bot_match_t *match) {
 		BotEntityInfo(client, &entinfo);
 		//if info is valid (in PVS)
 		if (entinfo.valid) {
-			areanum = BotPointAreaNum(entinfo.origin);
+			areanum = BotEntityAreaNum(&entinfo);
 			if (areanum) {// && trap_AAS_AreaReachability(areanum)) {
 				//NOTE: just assume the bot knows where the person is
 				//if (BotEntityVisible(bs->entitynum, bs->eye, bs->viewangles, 360, client)) {
@@ -1643,7 +1643,7 @@ void BotMatch_LeadTheWay(bot_state_t *bs, bot_match_t *match) {
 	BotEntityInfo(client, &entinfo);
 	//if info is valid (in PVS)
 	if (entinfo.valid) {
-		areanum = BotPointAreaNum(entinfo.origin);
+		areanum = BotEntityAreaNum(&entinfo);
 		if (areanum) { // && trap_AAS_AreaReachability(areanum)) {
 			bs->lead_teamgoal.entitynum = client;
 			bs->lead_teamgoal.areanum = areanum;
@@ -373,7 +373,7 @@ int BotGetLongTermGoal(bot_state_t *bs, int tfl, int retreat, bot_goal_t *goal)
 		}
 		//if the entity information is valid (entity in PVS)
 		if (entinfo.valid) {
-			areanum = BotPointAreaNum(entinfo.origin);
+			areanum = BotEntityAreaNum(&entinfo);
 			if (areanum && trap_AAS_AreaReachability(areanum)) {
 				//update team goal
 				bs->teamgoal.entitynum = bs->teammate;
@@ -500,7 +500,7 @@ int BotGetLongTermGoal(bot_state_t *bs, int tfl, int retreat, bot_goal_t *goal)
 		}
 		//if the entity information is valid (entity in PVS)
 		if (entinfo.valid) {
-			areanum = BotPointAreaNum(entinfo.origin);
+			areanum = BotEntityAreaNum(&entinfo);
 			if (areanum && trap_AAS_AreaReachability(areanum)) {
 				//update team goal
 				bs->teamgoal.entitynum = bs->teammate;
@@ -1067,7 +1067,7 @@ int BotLongTermGoal(bot_state_t *bs, int tfl, int retreat, bot_goal_t *goal) {
 		BotEntityInfo(bs->lead_teammate, &entinfo);
 		//
 		if (entinfo.valid) {
-			areanum = BotPointAreaNum(entinfo.origin);
+			areanum = BotEntityAreaNum(&entinfo);
 			if (areanum && trap_AAS_AreaReachability(areanum)) {
 				//update team goal
 				bs->lead_teamgoal.entitynum = bs->lead_teammate;
@@ -1384,6 +1384,17 @@ int BotPointAreaNum(vec3_t origin) {
 	return 0;
 }
 
+/*
+==================
+BotEntityAreaNum
+==================
+*/
+int BotEntityAreaNum(aas_entityinfo_t *entinfo) {
+	//botlib keeps track of the area the entity is in
+	if (entinfo->areanum) return entinfo->areanum;
+	return BotPointAreaNum(entinfo->origin);
+}
+
 /*
 ==================
 ClientName
@@ -175,6 +175,8 @@ int ClientFromName(char *name);
 int ClientOnSameTeamFromName(bot_state_t *bs, char *name);
 //
 int BotPointAreaNum(vec3_t origin);
+//returns the area the entity is in
+int BotEntityAreaNum(aas_entityinfo_t *entinfo);
 //
 void BotMapScripts(bot_state_t *bs);
 
@@ -1403,6 +1403,7 @@ int BotAIStartFrame(int time) {
 	gentity_t	*ent;
 	bot_entitystate_t state;
 	int elapsed_time, thinktime;
+	int thinkers[MAX_CLIENTS], numthinkers;
 	static int local_time;
 	static int botlib_residual;
 	static int lastbotthink_time;
@@ -1550,7 +1551,8 @@ int BotAIStartFrame(int time) {
 
 	floattime = trap_AAS_Time();
 
-	// execute scheduled bot AI
+	// gather the bots scheduled to think this frame
+	numthinkers = 0;
 	for( i = 0; i < MAX_CLIENTS; i++ ) {
 		if( !botstates[i] || !botstates[i]->inuse ) {
 			continue;
@@ -1561,14 +1563,20 @@ int BotAIStartFrame(int time) {
 		if ( botstates[i]->botthink_residual >= thinktime ) {
 			botstates[i]->botthink_residual -= thinktime;
 
-			if (!trap_AAS_Initialized()) return qfalse;
-
 			if (g_entities[i].client->pers.connected == CON_CONNECTED) {
-				BotAI(i, (float) thinktime / 1000);
+				thinkers[numthinkers++] = i;
 			}
 		}
 	}
 
+	if (numthinkers && !trap_AAS_Initialized()) return qfalse;
+
+	// execute scheduled bot AI, each bot only changes its own state and
+	// queues elementary actions, which are committed one bot at a time below
+	for( i = 0; i < numthinkers; i++ ) {
+		BotAI(thinkers[i], (float) thinktime / 1000);
+	}
+
 
 	// execute bot user commands every frame
 	for( i = 0; i < MAX_CLIENTS; i++ ) {
@@ -264,7 +264,7 @@ void BotVoiceChat_Camp(bot_state_t *bs, int client, int mode) {
 	BotEntityInfo(client, &entinfo);
 	//if info is valid (in PVS)
 	if (entinfo.valid) {
-		areanum = BotPointAreaNum(entinfo.origin);
+		areanum = BotEntityAreaNum(&entinfo);
 		if (areanum) { // && trap_AAS_AreaReachability(areanum)) {
 			//NOTE: just assume the bot knows where the person is
 			//if (BotEntityVisible(bs->entitynum, bs->eye, bs->viewangles, 360, client)) {
@@ -319,7 +319,7 @@ void BotVoiceChat_FollowMe(bot_state_t *bs, int client, int mode) {
 	BotEntityInfo(client, &entinfo);
 	//if info is valid (in PVS)
 	if (entinfo.valid) {
-		areanum = BotPointAreaNum(entinfo.origin);
+		areanum = BotEntityAreaNum(&entinfo);
 		if (areanum) { // && trap_AAS_AreaReachability(areanum)) {
 			bs->teamgoal.entitynum = client;
 			bs->teamgoal.areanum = areanum;
@@ -46,6 +46,22 @@ float	pm_flightfriction = 3.0f;
 float	pm_spectatorfriction = 5.0f;
 
 int		c_pmove = 0;
+int		c_pmoveGroundTraces = 0;
+int		c_pmoveGroundTracesSaved = 0;
+
+// the last ground trace, nothing else in the world moves during a
+// single Pmove call so an identical trace gives an identical result
+typedef struct {
+	qboolean	valid;
+	void		(*traceFunc)( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentMask );
+	vec3_t		origin;
+	vec3_t		mins, maxs;
+	int			passEntityNum;
+	int			tracemask;
+	trace_t		trace;
+} pmGroundTraceCache_t;
+
+static pmGroundTraceCache_t	pm_groundTraceCache;
 
 
 /*
@@ -1100,18 +1116,69 @@ static void PM_GroundTraceMissed( void ) {
 
 /*
 =============
-PM_GroundTrace
+PM_SameVector
+
+Bitwise comparison, so -0 and 0 are not treated as the same origin
 =============
 */
-static void PM_GroundTrace( void ) {
+static qboolean PM_SameVector( const vec3_t a, const vec3_t b ) {
+	const int	*ia = (const int *)a;
+	const int	*ib = (const int *)b;
+
+	return ia[0] == ib[0] && ia[1] == ib[1] && ia[2] == ib[2];
+}
+
+/*
+=============
+PM_TraceGround
+
+Traces a quarter unit down, reusing the previous result when the
+player hasn't moved since the last ground trace of this Pmove
+=============
+*/
+static void PM_TraceGround( trace_t *trace ) {
+	pmGroundTraceCache_t	*cache;
 	vec3_t		point;
-	trace_t		trace;
+
+	cache = &pm_groundTraceCache;
+	if ( cache->valid
+		&& cache->traceFunc == pm->trace
+		&& cache->passEntityNum == pm->ps->clientNum
+		&& cache->tracemask == pm->tracemask
+		&& PM_SameVector( cache->origin, pm->ps->origin )
+		&& PM_SameVector( cache->mins, pm->mins )
+		&& PM_SameVector( cache->maxs, pm->maxs ) ) {
+		c_pmoveGroundTracesSaved++;
+		*trace = cache->trace;
+		return;
+	}
 
 	point[0] = pm->ps->origin[0];
 	point[1] = pm->ps->origin[1];
 	point[2] = pm->ps->origin[2] - 0.25;
 
-	pm->trace (&trace, pm->ps->origin, pm->mins, pm->maxs, point, pm->ps->clientNum, pm->tracemask);
+	c_pmoveGroundTraces++;
+	pm->trace (trace, pm->ps->origin, pm->mins, pm->maxs, point, pm->ps->clientNum, pm->tracemask);
+
+	cache->valid = qtrue;
+	cache->traceFunc = pm->trace;
+	cache->passEntityNum = pm->ps->clientNum;
+	cache->tracemask = pm->tracemask;
+	VectorCopy( pm->ps->origin, cache->origin );
+	VectorCopy( pm->mins, cache->mins );
+	VectorCopy( pm->maxs, cache->maxs );
+	cache->trace = *trace;
+}
+
+/*
+=============
+PM_GroundTrace
+=============
+*/
+static void PM_GroundTrace( void ) {
+	trace_t		trace;
+
+	PM_TraceGround( &trace );
 	pml.groundTrace = trace;
 
 	// do something corrective if the trace starts in a solid...
@@ -2037,6 +2104,9 @@ void Pmove (pmove_t *pmove) {
 
 	pmove->ps->pmove_framecount = (pmove->ps->pmove_framecount+1) & ((1<<PS_PMOVEFRAMECOUNTBITS)-1);
 
+	// the world may have changed since the last call
+	pm_groundTraceCache.valid = qfalse;
+
 	// chop the move up if it is too long, to prevent framerate
 	// dependent behavior
 	while ( pmove->ps->commandTime != finalTime ) {
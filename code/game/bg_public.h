@@ -200,6 +200,9 @@ typedef struct {
 void PM_UpdateViewAngles( playerState_t *ps, const usercmd_t *cmd );
 void Pmove (pmove_t *pmove);
 
+extern	int		c_pmoveGroundTraces;
+extern	int		c_pmoveGroundTracesSaved;
+
 //===================================================================================
 
 
@@ -253,7 +253,7 @@ void	G_TouchTriggers( gentity_t *ent ) {
 	VectorSubtract( ent->client->ps.origin, range, mins );
 	VectorAdd( ent->client->ps.origin, range, maxs );
 
-	num = trap_EntitiesInBox( mins, maxs, touch, MAX_GENTITIES );
+	num = trap_TriggersInBox( ent->s.number, mins, maxs, touch, MAX_GENTITIES );
 
 	// can't use ent->absmin, because that has a one unit pad
 	VectorAdd( ent->client->ps.origin, ent->r.mins, mins );
@@ -936,9 +936,9 @@ void ClientThink_real( gentity_t *ent ) {
 				ent->client->ps.pm_type = PM_SPINTERMISSION;
 			}
 		}
-		Pmove (&pm);
+		G_Pmove (&pm);
 #else
-		Pmove (&pm);
+		G_Pmove (&pm);
 #endif
 
 	// save results of pmove
@@ -1039,6 +1039,36 @@ void ClientThink( int clientNum ) {
 	}
 }
 
+/*
+==================
+ClientThinkBatch
+
+Runs all the new commands of a packet in one call from the server
+==================
+*/
+void ClientThinkBatch( int clientNum ) {
+	usercmd_t	cmds[MAX_USERCMD_BATCH];
+	gentity_t	*ent;
+	int			i, numCmds;
+
+	ent = g_entities + clientNum;
+	numCmds = trap_GetUsercmds( clientNum, cmds, MAX_USERCMD_BATCH );
+
+	for ( i = 0 ; i < numCmds ; i++ ) {
+		// may have been kicked during the last command
+		if ( ent->client->pers.connected != CON_CONNECTED ) {
+			break;
+		}
+
+		ent->client->pers.cmd = cmds[i];
+		ent->client->lastCmdTime = level.time;
+
+		if ( !(ent->r.svFlags & SVF_BOT) && !g_synchronousClients.integer ) {
+			ClientThink_real( ent );
+		}
+	}
+}
+
 
 void G_RunClient( gentity_t *ent ) {
 	if ( !(ent->r.svFlags & SVF_BOT) && !g_synchronousClients.integer ) {
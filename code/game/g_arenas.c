@@ -147,6 +147,7 @@ static gentity_t *SpawnModelOnVictoryPad( gentity_t *pad, vec3_t offset, gentity
 	}
 
 	body->classname = ent->client->pers.netname;
+	G_IndexEntity( body );
 	body->client = ent->client;
 	body->s = ent->s;
 	body->s.eType = ET_PLAYER;		// could be ET_INVISIBLE
@@ -156,6 +157,7 @@ static gentity_t *SpawnModelOnVictoryPad( gentity_t *pad, vec3_t offset, gentity
 	body->s.number = body - g_entities;
 	body->timestamp = level.time;
 	body->physicsObject = qtrue;
+	G_AddPushCandidate( body );
 	body->physicsBounce = 0;		// don't bounce
 	body->s.event = 0;
 	body->s.pos.trType = TR_STATIONARY;
@@ -215,7 +217,7 @@ static void CelebrateStop( gentity_t *player ) {
 #define	TIMER_GESTURE	(34*66+50)
 static void CelebrateStart( gentity_t *player ) {
 	player->s.torsoAnim = ( ( player->s.torsoAnim & ANIM_TOGGLEBIT ) ^ ANIM_TOGGLEBIT ) | TORSO_GESTURE;
-	player->nextthink = level.time + TIMER_GESTURE;
+	G_SetNextThink( player, level.time + TIMER_GESTURE );
 	player->think = CelebrateStop;
 
 	/*
@@ -236,7 +238,7 @@ static void PodiumPlacementThink( gentity_t *podium ) {
 	vec3_t		origin;
 	vec3_t		f, r, u;
 
-	podium->nextthink = level.time + 100;
+	G_SetNextThink( podium, level.time + 100 );
 
 	AngleVectors( level.intermission_angle, vec, NULL, NULL );
 	VectorMA( level.intermission_origin, trap_Cvar_VariableIntegerValue( "g_podiumDist" ), vec, origin );
@@ -298,6 +300,7 @@ static gentity_t *SpawnPodium( void ) {
 	}
 
 	podium->classname = "podium";
+	G_IndexEntity( podium );
 	podium->s.eType = ET_GENERAL;
 	podium->s.number = podium - g_entities;
 	podium->clipmask = CONTENTS_SOLID;
@@ -314,7 +317,7 @@ static gentity_t *SpawnPodium( void ) {
 	trap_LinkEntity (podium);
 
 	podium->think = PodiumPlacementThink;
-	podium->nextthink = level.time + 100;
+	G_SetNextThink( podium, level.time + 100 );
 	return podium;
 }
 
@@ -337,7 +340,7 @@ void SpawnModelsOnVictoryPads( void ) {
 	player = SpawnModelOnVictoryPad( podium, offsetFirst, &g_entities[level.sortedClients[0]],
 				level.clients[ level.sortedClients[0] ].ps.persistant[PERS_RANK] &~ RANK_TIED_FLAG );
 	if ( player ) {
-		player->nextthink = level.time + 2000;
+		G_SetNextThink( player, level.time + 2000 );
 		player->think = CelebrateStart;
 		podium1 = player;
 	}
@@ -369,7 +372,7 @@ void Svcmd_AbortPodium_f( void ) {
 	}
 
 	if( podium1 ) {
-		podium1->nextthink = level.time;
+		G_SetNextThink( podium1, level.time );
 		podium1->think = CelebrateStop;
 	}
 }
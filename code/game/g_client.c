@@ -52,6 +52,7 @@ equivalent to info_player_deathmatch
 */
 void SP_info_player_start(gentity_t *ent) {
 	ent->classname = "info_player_deathmatch";
+	G_IndexEntity( ent );
 	SP_info_player_deathmatch( ent );
 }
 
@@ -368,6 +369,7 @@ void InitBodyQue (void) {
 	for (i=0; i<BODY_QUEUE_SIZE ; i++) {
 		ent = G_Spawn();
 		ent->classname = "bodyque";
+		G_IndexEntity( ent );
 		ent->neverFree = qtrue;
 		level.bodyQue[i] = ent;
 	}
@@ -387,7 +389,7 @@ void BodySink( gentity_t *ent ) {
 		ent->physicsObject = qfalse;
 		return;	
 	}
-	ent->nextthink = level.time + 100;
+	G_SetNextThink( ent, level.time + 100 );
 	ent->s.pos.trBase[2] -= 1;
 }
 
@@ -444,6 +446,7 @@ void CopyToBodyQue( gentity_t *ent ) {
 	body->s.number = body - g_entities;
 	body->timestamp = level.time;
 	body->physicsObject = qtrue;
+	G_AddPushCandidate( body );
 	body->physicsBounce = 0;		// don't bounce
 	if ( body->s.groundEntityNum == ENTITYNUM_NONE ) {
 		body->s.pos.trType = TR_GRAVITY;
@@ -453,6 +456,7 @@ void CopyToBodyQue( gentity_t *ent ) {
 		body->s.pos.trType = TR_STATIONARY;
 	}
 	body->s.event = 0;
+	G_ActivateEntity( body );
 
 	// change the animation to the last-frame only, so the sequence
 	// doesn't repeat anew for the body
@@ -482,7 +486,7 @@ void CopyToBodyQue( gentity_t *ent ) {
 	body->r.contents = CONTENTS_CORPSE;
 	body->r.ownerNum = ent->s.number;
 
-	body->nextthink = level.time + 5000;
+	G_SetNextThink( body, level.time + 5000 );
 	body->think = BodySink;
 
 	body->die = body_die;
@@ -943,6 +947,7 @@ char *ClientConnect( int clientNum, qboolean firstTime, qboolean isBot ) {
 	if( isBot ) {
 		ent->r.svFlags |= SVF_BOT;
 		ent->inuse = qtrue;
+		G_ActivateEntity( ent );
 		if( !G_BotConnect( clientNum, !firstTime ) ) {
 			return "BotConnectfailed";
 		}
@@ -1152,6 +1157,8 @@ void ClientSpawn(gentity_t *ent) {
 	ent->takedamage = qtrue;
 	ent->inuse = qtrue;
 	ent->classname = "player";
+	G_IndexEntity( ent );
+	G_ActivateEntity( ent );
 	ent->r.contents = CONTENTS_BODY;
 	ent->clipmask = MASK_PLAYERSOLID;
 	ent->die = player_die;
@@ -1320,6 +1327,7 @@ void ClientDisconnect( int clientNum ) {
 	ent->s.modelindex = 0;
 	ent->inuse = qfalse;
 	ent->classname = "disconnected";
+	G_IndexEntity( ent );
 	ent->client->pers.connected = CON_DISCONNECTED;
 	ent->client->ps.persistant[PERS_TEAM] = TEAM_FREE;
 	ent->client->sess.sessionTeam = TEAM_FREE;
@@ -318,6 +318,7 @@ void Cmd_Give_f (gentity_t *ent)
 		it_ent = G_Spawn();
 		VectorCopy( ent->r.currentOrigin, it_ent->s.origin );
 		it_ent->classname = it->classname;
+		G_IndexEntity( it_ent );
 		G_SpawnItem (it_ent, it);
 		FinishSpawningItem(it_ent );
 		memset( &trace, 0, sizeof( trace ) );
@@ -174,7 +174,7 @@ void TossClientCubes( gentity_t *self ) {
 
 	drop = LaunchItem( item, origin, velocity );
 
-	drop->nextthink = level.time + g_cubeTimeout.integer * 1000;
+	G_SetNextThink( drop, level.time + g_cubeTimeout.integer * 1000 );
 	drop->think = G_FreeEntity;
 	drop->spawnflags = self->client->sess.sessionTeam;
 }
@@ -333,10 +333,11 @@ void Kamikaze_DeathTimer( gentity_t *self ) {
 
 	ent = G_Spawn();
 	ent->classname = "kamikaze timer";
+	G_IndexEntity( ent );
 	VectorCopy(self->s.pos.trBase, ent->s.pos.trBase);
 	ent->r.svFlags |= SVF_NOCLIENT;
 	ent->think = Kamikaze_DeathActivate;
-	ent->nextthink = level.time + 5 * 1000;
+	G_SetNextThink( ent, level.time + 5 * 1000 );
 
 	ent->activator = self;
 }
@@ -459,7 +460,7 @@ void player_die( gentity_t *self, gentity_t *inflictor, gentity_t *attacker, int
 	if ((self->client->ps.eFlags & EF_TICKING) && self->activator) {
 		self->client->ps.eFlags &= ~EF_TICKING;
 		self->activator->think = G_FreeEntity;
-		self->activator->nextthink = level.time;
+		G_SetNextThink( self->activator, level.time );
 	}
 #endif
 	self->client->ps.pm_type = PM_DEAD;
@@ -414,7 +414,7 @@ void RespawnItem( gentity_t *ent ) {
 	// play the normal respawn sound only to nearby clients
 	G_AddEvent( ent, EV_ITEM_RESPAWN, 0 );
 
-	ent->nextthink = 0;
+	G_SetNextThink( ent, 0 );
 }
 
 
@@ -549,10 +549,10 @@ void Touch_Item (gentity_t *ent, gentity_t *other, trace_t *trace) {
 	// delete it).  This is used by items that are respawned by third party 
 	// events such as ctf flags
 	if ( respawn <= 0 ) {
-		ent->nextthink = 0;
+		G_SetNextThink( ent, 0 );
 		ent->think = 0;
 	} else {
-		ent->nextthink = level.time + respawn * 1000;
+		G_SetNextThink( ent, level.time + respawn * 1000 );
 		ent->think = RespawnItem;
 	}
 	trap_LinkEntity( ent );
@@ -574,10 +574,12 @@ gentity_t *LaunchItem( gitem_t *item, vec3_t origin, vec3_t velocity ) {
 	dropped = G_Spawn();
 
 	dropped->s.eType = ET_ITEM;
+	G_AddPushCandidate( dropped );
 	dropped->s.modelindex = item - bg_itemlist;	// store item number in modelindex
 	dropped->s.modelindex2 = 1; // This is non-zero is it's a dropped item
 
 	dropped->classname = item->classname;
+	G_IndexEntity( dropped );
 	dropped->item = item;
 	VectorSet (dropped->r.mins, -ITEM_RADIUS, -ITEM_RADIUS, -ITEM_RADIUS);
 	VectorSet (dropped->r.maxs, ITEM_RADIUS, ITEM_RADIUS, ITEM_RADIUS);
@@ -597,11 +599,11 @@ gentity_t *LaunchItem( gitem_t *item, vec3_t origin, vec3_t velocity ) {
 	if (g_gametype.integer == GT_CTF && item->giType == IT_TEAM) { // Special case for CTF flags
 #endif
 		dropped->think = Team_DroppedFlagThink;
-		dropped->nextthink = level.time + 30000;
+		G_SetNextThink( dropped, level.time + 30000 );
 		Team_CheckDroppedItem( dropped );
 	} else { // auto-remove after 30 seconds
 		dropped->think = G_FreeEntity;
-		dropped->nextthink = level.time + 30000;
+		G_SetNextThink( dropped, level.time + 30000 );
 	}
 
 	dropped->flags = FL_DROPPED_ITEM;
@@ -663,6 +665,7 @@ void FinishSpawningItem( gentity_t *ent ) {
 	VectorSet( ent->r.maxs, ITEM_RADIUS, ITEM_RADIUS, ITEM_RADIUS );
 
 	ent->s.eType = ET_ITEM;
+	G_AddPushCandidate( ent );
 	ent->s.modelindex = ent->item - bg_itemlist;		// store item number in modelindex
 	ent->s.modelindex2 = 0; // zero indicates this isn't a dropped item
 
@@ -704,7 +707,7 @@ void FinishSpawningItem( gentity_t *ent ) {
 		respawn = 45 + crandom() * 15;
 		ent->s.eFlags |= EF_NODRAW;
 		ent->r.contents = 0;
-		ent->nextthink = level.time + respawn * 1000;
+		G_SetNextThink( ent, level.time + respawn * 1000 );
 		ent->think = RespawnItem;
 		return;
 	}
@@ -896,7 +899,7 @@ void G_SpawnItem (gentity_t *ent, gitem_t *item) {
 	ent->item = item;
 	// some movers spawn on the second frame, so delay item
 	// spawns until the third frame so they can ride trains
-	ent->nextthink = level.time + FRAMETIME * 2;
+	G_SetNextThink( ent, level.time + FRAMETIME * 2 );
 	ent->think = FinishSpawningItem;
 
 	ent->physicsBounce = 0.50;		// items are bouncy
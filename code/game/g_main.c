@@ -57,12 +57,14 @@ vmCvar_t	g_quadfactor;
 vmCvar_t	g_forcerespawn;
 vmCvar_t	g_inactivity;
 vmCvar_t	g_debugMove;
+vmCvar_t	g_pmoveRecord;
 vmCvar_t	g_debugDamage;
 vmCvar_t	g_debugAlloc;
 vmCvar_t	g_weaponRespawn;
 vmCvar_t	g_weaponTeamRespawn;
 vmCvar_t	g_motd;
 vmCvar_t	g_synchronousClients;
+vmCvar_t	g_unlagged;
 vmCvar_t	g_warmup;
 vmCvar_t	g_doWarmup;
 vmCvar_t	g_restarted;
@@ -118,6 +120,7 @@ static cvarTable_t		gameCvarTable[] = {
 	{ &g_capturelimit, "capturelimit", "8", CVAR_SERVERINFO | CVAR_ARCHIVE | CVAR_NORESTART, 0, qtrue },
 
 	{ &g_synchronousClients, "g_synchronousClients", "0", CVAR_SYSTEMINFO, 0, qfalse  },
+	{ &g_unlagged, "g_unlagged", "0", CVAR_ARCHIVE, 0, qfalse  },
 
 	{ &g_friendlyFire, "g_friendlyFire", "0", CVAR_ARCHIVE, 0, qtrue  },
 
@@ -147,6 +150,7 @@ static cvarTable_t		gameCvarTable[] = {
 	{ &g_forcerespawn, "g_forcerespawn", "20", 0, 0, qtrue },
 	{ &g_inactivity, "g_inactivity", "0", 0, 0, qtrue },
 	{ &g_debugMove, "g_debugMove", "0", 0, 0, qfalse },
+	{ &g_pmoveRecord, "g_pmoveRecord", "", 0, 0, qfalse },
 	{ &g_debugDamage, "g_debugDamage", "0", 0, 0, qfalse },
 	{ &g_debugAlloc, "g_debugAlloc", "0", 0, 0, qfalse },
 	{ &g_motd, "g_motd", "", 0, 0, qfalse },
@@ -212,6 +216,9 @@ Q_EXPORT intptr_t vmMain( int command, int arg0, int arg1, int arg2, int arg3, i
 	case GAME_CLIENT_THINK:
 		ClientThink( arg0 );
 		return 0;
+	case GAME_CLIENT_THINK_BATCH:
+		ClientThinkBatch( arg0 );
+		return 0;
 	case GAME_CLIENT_USERINFO_CHANGED:
 		ClientUserinfoChanged( arg0 );
 		return 0;
@@ -271,45 +278,52 @@ All but the last will have the teamchain field set to the next one
 ================
 */
 void G_FindTeams( void ) {
+	static int	masterHash[1024];
+	static int	nextMaster[MAX_GENTITIES];
 	gentity_t	*e, *e2;
-	int		i, j;
+	int		i, j, hash;
 	int		c, c2;
 
+	// masters are hashed on their team so every entity only looks at
+	// the masters of teams with a similar name
+	memset( masterHash, 0, sizeof( masterHash ) );
 	c = 0;
 	c2 = 0;
-	for ( i=MAX_CLIENTS, e=g_entities+i ; i < level.num_entities ; i++,e++ ) {
-		if (!e->inuse)
+	for ( i=MAX_CLIENTS, e2=g_entities+i ; i < level.num_entities ; i++,e2++ ) {
+		if (!e2->inuse)
 			continue;
-		if (!e->team)
+		if (!e2->team)
 			continue;
-		if (e->flags & FL_TEAMMEMBER)
+		if (e2->flags & FL_TEAMMEMBER)
 			continue;
-		e->teammaster = e;
-		c++;
-		c2++;
-		for (j=i+1, e2=e+1 ; j < level.num_entities ; j++,e2++)
-		{
-			if (!e2->inuse)
-				continue;
-			if (!e2->team)
-				continue;
-			if (e2->flags & FL_TEAMMEMBER)
-				continue;
-			if (!strcmp(e->team, e2->team))
-			{
-				c2++;
-				e2->teamchain = e->teamchain;
-				e->teamchain = e2;
-				e2->teammaster = e;
-				e2->flags |= FL_TEAMMEMBER;
-
-				// make sure that targets only point at the master
-				if ( e2->targetname ) {
-					e->targetname = e2->targetname;
-					e2->targetname = NULL;
-				}
+		hash = G_EntityIndexHash( e2->team );
+		for ( j = masterHash[hash] ; j ; j = nextMaster[j - 1] ) {
+			if ( !strcmp( g_entities[j - 1].team, e2->team ) ) {
+				break;
 			}
 		}
+		if ( !j ) {
+			e2->teammaster = e2;
+			nextMaster[i] = masterHash[hash];
+			masterHash[hash] = i + 1;
+			c++;
+			c2++;
+			continue;
+		}
+		e = &g_entities[j - 1];
+		c2++;
+		e2->teamchain = e->teamchain;
+		e->teamchain = e2;
+		e2->teammaster = e;
+		e2->flags |= FL_TEAMMEMBER;
+
+		// make sure that targets only point at the master
+		if ( e2->targetname ) {
+			e->targetname = e2->targetname;
+			e2->targetname = NULL;
+			G_IndexEntity( e );
+			G_IndexEntity( e2 );
+		}
 	}
 
 	G_Printf ("%i teams with %i entities\n", c, c2);
@@ -396,10 +410,13 @@ void G_UpdateCvars( void ) {
 	cvarTable_t	*cv;
 	qboolean remapped = qfalse;
 
+	// the engine refreshes the changed vmCvars itself
+	if ( !trap_Cvar_UpdateChanged() ) {
+		return;
+	}
+
 	for ( i = 0, cv = gameCvarTable ; i < gameCvarTableSize ; i++, cv++ ) {
 		if ( cv->vmCvar ) {
-			trap_Cvar_Update( cv->vmCvar );
-
 			if ( cv->modificationCount != cv->vmCvar->modificationCount ) {
 				cv->modificationCount = cv->vmCvar->modificationCount;
 
@@ -472,6 +489,9 @@ void G_InitGame( int levelTime, int randomSeed, int restart ) {
 
 	// initialize all entities for this game
 	memset( g_entities, 0, MAX_GENTITIES * sizeof(g_entities[0]) );
+	G_ClearEntityIndex();
+	G_ClearThinkSchedule();
+	G_ClearPushCandidates();
 	level.gentities = g_entities;
 
 	// initialize all clients for this game
@@ -491,6 +511,7 @@ void G_InitGame( int levelTime, int randomSeed, int restart ) {
 
 	for ( i=0 ; i<MAX_CLIENTS ; i++ ) {
 		g_entities[i].classname = "clientslot";
+		G_IndexEntity( &g_entities[i] );
 	}
 
 	// let the server system know where the entites are
@@ -557,6 +578,8 @@ void G_ShutdownGame( int restart ) {
 		level.logFile = 0;
 	}
 
+	G_StopPmoveRecord();
+
 	// write all the client session data so we can get it back
 	G_WriteSessionData();
 
@@ -1779,6 +1802,214 @@ void CheckCvars( void ) {
 	}
 }
 
+/*
+=============================================================================
+
+THINK SCHEDULING
+
+G_RunFrame only visits the entities in the active set.  Clients, missiles,
+falling items and moving movers stay active while they need a visit every
+frame, everything else is parked until its nextthink comes due or something
+wakes it up with G_ActivateEntity.
+
+Pending thinks are kept in a binary heap ordered on time.  Rescheduling an
+entity does not remove its old entry, stale entries are dropped when they
+reach the top of the heap and no longer match the entity's nextthink.
+
+=============================================================================
+*/
+
+#define	MAX_THINK_QUEUE		( MAX_GENTITIES * 2 )
+
+typedef struct {
+	int			time;
+	int			entityNum;
+} thinkEvent_t;
+
+static thinkEvent_t	thinkQueue[MAX_THINK_QUEUE];
+static int			numThinkEvents;
+static unsigned int	activeEntities[MAX_GENTITIES / 32];
+
+/*
+=============
+G_PushThink
+=============
+*/
+static void G_PushThink( int time, int entityNum ) {
+	int		i, parent;
+
+	i = numThinkEvents++;
+	while ( i > 0 ) {
+		parent = ( i - 1 ) >> 1;
+		if ( thinkQueue[parent].time <= time ) {
+			break;
+		}
+		thinkQueue[i] = thinkQueue[parent];
+		i = parent;
+	}
+	thinkQueue[i].time = time;
+	thinkQueue[i].entityNum = entityNum;
+}
+
+/*
+=============
+G_PopThink
+
+Removes the earliest entry from the queue
+=============
+*/
+static void G_PopThink( void ) {
+	thinkEvent_t	last;
+	int				i, child;
+
+	last = thinkQueue[--numThinkEvents];
+	i = 0;
+	while ( ( child = i * 2 + 1 ) < numThinkEvents ) {
+		if ( child + 1 < numThinkEvents && thinkQueue[child + 1].time < thinkQueue[child].time ) {
+			child++;
+		}
+		if ( last.time <= thinkQueue[child].time ) {
+			break;
+		}
+		thinkQueue[i] = thinkQueue[child];
+		i = child;
+	}
+	thinkQueue[i] = last;
+}
+
+/*
+=============
+G_RebuildThinkQueue
+
+Throws away all stale entries when the queue fills up
+=============
+*/
+static void G_RebuildThinkQueue( void ) {
+	int			i;
+	gentity_t	*ent;
+
+	numThinkEvents = 0;
+	for ( i = 0, ent = g_entities ; i < level.num_entities ; i++, ent++ ) {
+		if ( ent->inuse && ent->nextthink > 0 ) {
+			G_PushThink( ent->nextthink, i );
+		}
+	}
+}
+
+/*
+=============
+G_ClearThinkSchedule
+=============
+*/
+void G_ClearThinkSchedule( void ) {
+	numThinkEvents = 0;
+	memset( activeEntities, 0, sizeof( activeEntities ) );
+}
+
+/*
+=============
+G_ActivateEntity
+
+Makes sure the entity is visited on the next pass through G_RunFrame.
+Anything that gives an idle entity work to do outside of its own think
+must call this.
+=============
+*/
+void G_ActivateEntity( gentity_t *ent ) {
+	int		num;
+
+	num = ent - g_entities;
+	activeEntities[num >> 5] |= 1u << ( num & 31 );
+}
+
+/*
+=============
+G_SetNextThink
+=============
+*/
+void G_SetNextThink( gentity_t *ent, int time ) {
+	ent->nextthink = time;
+	if ( time <= 0 ) {
+		return;
+	}
+	if ( numThinkEvents == MAX_THINK_QUEUE ) {
+		// the rebuild picks up this entity as well
+		G_RebuildThinkQueue();
+	} else {
+		G_PushThink( time, ent - g_entities );
+	}
+	if ( time <= level.time ) {
+		// entities further along in this frame still think right away
+		G_ActivateEntity( ent );
+	}
+}
+
+/*
+=============
+G_WakeThinkers
+
+Moves every entity whose think has come due into the active set
+=============
+*/
+static void G_WakeThinkers( void ) {
+	gentity_t	*ent;
+
+	while ( numThinkEvents > 0 && thinkQueue[0].time <= level.time ) {
+		ent = &g_entities[thinkQueue[0].entityNum];
+		if ( ent->inuse && ent->nextthink == thinkQueue[0].time ) {
+			G_ActivateEntity( ent );
+		}
+		G_PopThink();
+	}
+}
+
+/*
+=============
+G_EntityNeedsFrame
+
+Returns qfalse when the entity can be left alone until it is woken up again
+=============
+*/
+static qboolean G_EntityNeedsFrame( gentity_t *ent ) {
+	if ( !ent->inuse ) {
+		return qfalse;
+	}
+
+	// pending events have to be cleared
+	if ( ent->s.event || ent->freeAfterEvent || ent->unlinkAfterEvent ) {
+		return qtrue;
+	}
+
+	if ( ent - g_entities < MAX_CLIENTS ) {
+		return qtrue;
+	}
+
+	if ( ent->s.eType == ET_MISSILE ) {
+		return qtrue;
+	}
+
+	if ( ent->s.eType == ET_MOVER ) {
+		// team members are moved and never think on their own
+		if ( ent->flags & FL_TEAMMEMBER ) {
+			return qfalse;
+		}
+		if ( ent->s.pos.trType != TR_STATIONARY || ent->s.apos.trType != TR_STATIONARY ) {
+			return qtrue;
+		}
+	} else if ( ent->s.eType == ET_ITEM || ent->physicsObject ) {
+		if ( ent->s.groundEntityNum == ENTITYNUM_NONE || ent->s.pos.trType != TR_STATIONARY ) {
+			return qtrue;
+		}
+	}
+
+	// a think that is due but didn't run, e.g. an unlinked neverFree entity
+	if ( ent->nextthink > 0 && ent->nextthink <= level.time ) {
+		return qtrue;
+	}
+
+	return qfalse;
+}
+
 /*
 =============
 G_RunThink
@@ -1797,13 +2028,73 @@ void G_RunThink (gentity_t *ent) {
 		return;
 	}
 	
-	ent->nextthink = 0;
+	G_SetNextThink( ent, 0 );
 	if (!ent->think) {
 		G_Error ( "NULL ent->think");
 	}
 	ent->think (ent);
 }
 
+/*
+================
+G_RunEntity
+================
+*/
+static void G_RunEntity( gentity_t *ent ) {
+	// clear events that are too old
+	if ( level.time - ent->eventTime > EVENT_VALID_MSEC ) {
+		if ( ent->s.event ) {
+			ent->s.event = 0;	// &= EV_EVENT_BITS;
+			if ( ent->client ) {
+				ent->client->ps.externalEvent = 0;
+				// predicted events should never be set to zero
+				//ent->client->ps.events[0] = 0;
+				//ent->client->ps.events[1] = 0;
+			}
+		}
+		if ( ent->freeAfterEvent ) {
+			// tempEntities or dropped items completely go away after their event
+			G_FreeEntity( ent );
+			return;
+		} else if ( ent->unlinkAfterEvent ) {
+			// items that will respawn will hide themselves after their pickup event
+			ent->unlinkAfterEvent = qfalse;
+			trap_UnlinkEntity( ent );
+		}
+	}
+
+	// temporary entities don't think
+	if ( ent->freeAfterEvent ) {
+		return;
+	}
+
+	if ( !ent->r.linked && ent->neverFree ) {
+		return;
+	}
+
+	if ( ent->s.eType == ET_MISSILE ) {
+		G_RunMissile( ent );
+		return;
+	}
+
+	if ( ent->s.eType == ET_ITEM || ent->physicsObject ) {
+		G_RunItem( ent );
+		return;
+	}
+
+	if ( ent->s.eType == ET_MOVER ) {
+		G_RunMover( ent );
+		return;
+	}
+
+	if ( ent - g_entities < MAX_CLIENTS ) {
+		G_RunClient( ent );
+		return;
+	}
+
+	G_RunThink( ent );
+}
+
 /*
 ================
 G_RunFrame
@@ -1813,6 +2104,7 @@ Advances the non-player objects in the world
 */
 void G_RunFrame( int levelTime ) {
 	int			i;
+	unsigned int	bit;
 	gentity_t	*ent;
 
 	// if we are waiting for the level to restart, do nothing
@@ -1827,67 +2119,29 @@ void G_RunFrame( int levelTime ) {
 	// get any cvar changes
 	G_UpdateCvars();
 
+	G_WakeThinkers();
+
 	//
-	// go through all allocated objects
+	// go through all active objects, the set is checked every iteration
+	// because anything spawned or woken up further along still runs
 	//
-	ent = &g_entities[0];
-	for (i=0 ; i<level.num_entities ; i++, ent++) {
-		if ( !ent->inuse ) {
-			continue;
-		}
-
-		// clear events that are too old
-		if ( level.time - ent->eventTime > EVENT_VALID_MSEC ) {
-			if ( ent->s.event ) {
-				ent->s.event = 0;	// &= EV_EVENT_BITS;
-				if ( ent->client ) {
-					ent->client->ps.externalEvent = 0;
-					// predicted events should never be set to zero
-					//ent->client->ps.events[0] = 0;
-					//ent->client->ps.events[1] = 0;
-				}
-			}
-			if ( ent->freeAfterEvent ) {
-				// tempEntities or dropped items completely go away after their event
-				G_FreeEntity( ent );
-				continue;
-			} else if ( ent->unlinkAfterEvent ) {
-				// items that will respawn will hide themselves after their pickup event
-				ent->unlinkAfterEvent = qfalse;
-				trap_UnlinkEntity( ent );
+	for (i=0 ; i<level.num_entities ; i++) {
+		bit = 1u << ( i & 31 );
+		if ( !( activeEntities[i >> 5] & bit ) ) {
+			if ( !activeEntities[i >> 5] ) {
+				i |= 31;
 			}
-		}
-
-		// temporary entities don't think
-		if ( ent->freeAfterEvent ) {
-			continue;
-		}
-
-		if ( !ent->r.linked && ent->neverFree ) {
-			continue;
-		}
-
-		if ( ent->s.eType == ET_MISSILE ) {
-			G_RunMissile( ent );
 			continue;
 		}
 
-		if ( ent->s.eType == ET_ITEM || ent->physicsObject ) {
-			G_RunItem( ent );
-			continue;
-		}
-
-		if ( ent->s.eType == ET_MOVER ) {
-			G_RunMover( ent );
-			continue;
+		ent = &g_entities[i];
+		if ( ent->inuse ) {
+			G_RunEntity( ent );
 		}
 
-		if ( i < MAX_CLIENTS ) {
-			G_RunClient( ent );
-			continue;
+		if ( !G_EntityNeedsFrame( ent ) ) {
+			activeEntities[i >> 5] &= ~bit;
 		}
-
-		G_RunThink( ent );
 	}
 
 	// perform final fixups on the players
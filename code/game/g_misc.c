@@ -213,7 +213,7 @@ void SP_misc_portal_surface(gentity_t *ent) {
 		VectorCopy( ent->s.origin, ent->s.origin2 );
 	} else {
 		ent->think = locateCamera;
-		ent->nextthink = level.time + 100;
+		G_SetNextThink( ent, level.time + 100 );
 	}
 }
 
@@ -285,7 +285,7 @@ void Use_Shooter( gentity_t *ent, gentity_t *other, gentity_t *activator ) {
 static void InitShooter_Finish( gentity_t *ent ) {
 	ent->enemy = G_PickTarget( ent->target );
 	ent->think = 0;
-	ent->nextthink = 0;
+	G_SetNextThink( ent, 0 );
 }
 
 void InitShooter( gentity_t *ent, int weapon ) {
@@ -303,7 +303,7 @@ void InitShooter( gentity_t *ent, int weapon ) {
 	// target might be a moving object, so we can't set movedir for it
 	if ( ent->target ) {
 		ent->think = InitShooter_Finish;
-		ent->nextthink = level.time + 500;
+		G_SetNextThink( ent, level.time + 500 );
 	}
 	trap_LinkEntity( ent );
 }
@@ -355,6 +355,7 @@ void DropPortalDestination( gentity_t *player ) {
 	VectorCopy( player->r.maxs, ent->r.maxs );
 
 	ent->classname = "hi_portal destination";
+	G_IndexEntity( ent );
 	ent->s.pos.trType = TR_STATIONARY;
 
 	ent->r.contents = CONTENTS_CORPSE;
@@ -365,7 +366,7 @@ void DropPortalDestination( gentity_t *player ) {
 	VectorCopy( player->s.apos.trBase, ent->s.angles );
 
 	ent->think = G_FreeEntity;
-	ent->nextthink = level.time + 2 * 60 * 1000;
+	G_SetNextThink( ent, level.time + 2 * 60 * 1000 );
 
 	trap_LinkEntity( ent );
 
@@ -428,7 +429,7 @@ static void PortalTouch( gentity_t *self, gentity_t *other, trace_t *trace) {
 static void PortalEnable( gentity_t *self ) {
 	self->touch = PortalTouch;
 	self->think = G_FreeEntity;
-	self->nextthink = level.time + 2 * 60 * 1000;
+	G_SetNextThink( self, level.time + 2 * 60 * 1000 );
 }
 
 
@@ -448,6 +449,7 @@ void DropPortalSource( gentity_t *player ) {
 	VectorCopy( player->r.maxs, ent->r.maxs );
 
 	ent->classname = "hi_portal source";
+	G_IndexEntity( ent );
 	ent->s.pos.trType = TR_STATIONARY;
 
 	ent->r.contents = CONTENTS_CORPSE | CONTENTS_TRIGGER;
@@ -462,7 +464,7 @@ void DropPortalSource( gentity_t *player ) {
 
 //	ent->spawnflags = player->client->ps.persistant[PERS_TEAM];
 
-	ent->nextthink = level.time + 1000;
+	G_SetNextThink( ent, level.time + 1000 );
 	ent->think = PortalEnable;
 
 	// find the destination
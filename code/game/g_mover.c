@@ -41,6 +41,125 @@ typedef struct {
 } pushed_t;
 pushed_t	pushed[MAX_GENTITIES], *pushed_p;
 
+// non-client entities that movers may have to push, entries are
+// validated and compacted every time the list is searched
+static int		pushCandidates[MAX_GENTITIES];
+static int		numPushCandidates;
+static byte		pushCandidateListed[MAX_GENTITIES];
+
+/*
+============
+G_AddPushCandidate
+
+Must be called for every item, physics object and prox mine so
+movers will find it
+============
+*/
+void G_AddPushCandidate( gentity_t *ent ) {
+	int		num;
+
+	num = ent - g_entities;
+	if ( num < MAX_CLIENTS || pushCandidateListed[num] ) {
+		return;
+	}
+	pushCandidateListed[num] = qtrue;
+	pushCandidates[numPushCandidates++] = num;
+}
+
+/*
+============
+G_ClearPushCandidates
+============
+*/
+void G_ClearPushCandidates( void ) {
+	numPushCandidates = 0;
+	memset( pushCandidateListed, 0, sizeof( pushCandidateListed ) );
+}
+
+/*
+============
+G_IsPushable
+============
+*/
+static qboolean G_IsPushable( gentity_t *ent ) {
+	if ( !ent->inuse ) {
+		return qfalse;
+	}
+#ifdef MISSIONPACK
+	if ( ent->s.eType == ET_MISSILE && !strcmp( ent->classname, "prox mine" ) ) {
+		return qtrue;
+	}
+#endif
+	return ent->s.eType == ET_ITEM || ent->s.eType == ET_PLAYER || ent->physicsObject;
+}
+
+/*
+============
+G_PushEntitiesInBox
+
+Like trap_EntitiesInBox over the swept bounds of the move, but only
+returns linked entities the pusher could act on: pushable entities
+that either ride the pusher or touch its final position mins / maxs.
+Prox mines are always returned as they may be attached to the pusher.
+============
+*/
+static int G_PushEntitiesInBox( gentity_t *pusher, const vec3_t totalMins, const vec3_t totalMaxs,
+								const vec3_t mins, const vec3_t maxs, int *list ) {
+	int			i, j, num, count;
+	gentity_t	*check;
+
+	count = 0;
+	for ( i = 0 ; i < level.maxclients + numPushCandidates ; i++ ) {
+		if ( i < level.maxclients ) {
+			num = i;
+		} else {
+			num = pushCandidates[i - level.maxclients];
+		}
+		check = &g_entities[num];
+
+		if ( !G_IsPushable( check ) ) {
+			if ( num >= MAX_CLIENTS ) {
+				// freed or changed type, drop it from the list
+				pushCandidateListed[num] = qfalse;
+				j = i - level.maxclients;
+				pushCandidates[j] = pushCandidates[--numPushCandidates];
+				i--;
+			}
+			continue;
+		}
+		if ( !check->r.linked ) {
+			continue;
+		}
+
+		// same overlap test as the world sectors use
+		if ( check->r.absmin[0] > totalMaxs[0]
+		|| check->r.absmin[1] > totalMaxs[1]
+		|| check->r.absmin[2] > totalMaxs[2]
+		|| check->r.absmax[0] < totalMins[0]
+		|| check->r.absmax[1] < totalMins[1]
+		|| check->r.absmax[2] < totalMins[2] ) {
+			continue;
+		}
+
+		// entities not riding the pusher only need testing when they
+		// touch its final position
+		if ( check->s.eType != ET_MISSILE && check->s.groundEntityNum != pusher->s.number ) {
+			if ( check->r.absmin[0] >= maxs[0]
+			|| check->r.absmin[1] >= maxs[1]
+			|| check->r.absmin[2] >= maxs[2]
+			|| check->r.absmax[0] <= mins[0]
+			|| check->r.absmax[1] <= mins[1]
+			|| check->r.absmax[2] <= mins[2] ) {
+				continue;
+			}
+		}
+
+		list[count++] = num;
+	}
+
+	return count;
+}
+
 
 /*
 ============
@@ -166,6 +285,7 @@ qboolean	G_TryPushingEntity( gentity_t *check, gentity_t *pusher, vec3_t move, v
 	if ( check->s.groundEntityNum != pusher->s.number ) {
 		check->s.groundEntityNum = ENTITYNUM_NONE;
 	}
+	G_ActivateEntity( check );
 
 	block = G_TestEntityPosition( check );
 	if (!block) {
@@ -303,16 +423,18 @@ qboolean G_MoverPush( gentity_t *pusher, vec3_t move, vec3_t amove, gentity_t **
 		}
 	}
 
-	// unlink the pusher so we don't get it in the entityList
-	trap_UnlinkEntity( pusher );
-
-	listedEntities = trap_EntitiesInBox( totalMins, totalMaxs, entityList, MAX_GENTITIES );
+	listedEntities = G_PushEntitiesInBox( pusher, totalMins, totalMaxs, mins, maxs, entityList );
 
 	// move the pusher to its final position
 	VectorAdd( pusher->r.currentOrigin, move, pusher->r.currentOrigin );
 	VectorAdd( pusher->r.currentAngles, amove, pusher->r.currentAngles );
 	trap_LinkEntity( pusher );
 
+	// nothing riding or in the way
+	if ( !listedEntities ) {
+		return qtrue;
+	}
+
 	// see if any solid entities are inside the final position
 	for ( e = 0 ; e < listedEntities ; e++ ) {
 		check = &g_entities[ entityList[ e ] ];
@@ -360,15 +482,6 @@ qboolean G_MoverPush( gentity_t *pusher, vec3_t move, vec3_t amove, gentity_t **
 
 		// if the entity is standing on the pusher, it will definitely be moved
 		if ( check->s.groundEntityNum != pusher->s.number ) {
-			// see if the ent needs to be tested
-			if ( check->r.absmin[0] >= maxs[0]
-			|| check->r.absmin[1] >= maxs[1]
-			|| check->r.absmin[2] >= maxs[2]
-			|| check->r.absmax[0] <= mins[0]
-			|| check->r.absmax[1] <= mins[1]
-			|| check->r.absmax[2] <= mins[2] ) {
-				continue;
-			}
 			// see if the ent's bbox is inside the pusher's final position
 			// this does allow a fast moving object to pass through a thin entity...
 			if (!G_TestEntityPosition (check)) {
@@ -539,6 +652,9 @@ void SetMoverState( gentity_t *ent, moverState_t moverState, int time ) {
 	}
 	BG_EvaluateTrajectory( &ent->s.pos, level.time, ent->r.currentOrigin );	
 	trap_LinkEntity( ent );
+
+	// the team captain moves the whole team
+	G_ActivateEntity( ent->teammaster ? ent->teammaster : ent );
 }
 
 /*
@@ -598,7 +714,7 @@ void Reached_BinaryMover( gentity_t *ent ) {
 
 		// return to pos1 after a delay
 		ent->think = ReturnToPos1;
-		ent->nextthink = level.time + ent->wait;
+		G_SetNextThink( ent, level.time + ent->wait );
 
 		// fire targets
 		if ( !ent->activator ) {
@@ -663,7 +779,7 @@ void Use_BinaryMover( gentity_t *ent, gentity_t *other, gentity_t *activator ) {
 
 	// if all the way up, just delay before coming down
 	if ( ent->moverState == MOVER_POS2 ) {
-		ent->nextthink = level.time + ent->wait;
+		G_SetNextThink( ent, level.time + ent->wait );
 		return;
 	}
 
@@ -912,6 +1028,7 @@ void Think_SpawnNewDoorTrigger( gentity_t *ent ) {
 	// create a trigger with this size
 	other = G_Spawn ();
 	other->classname = "door_trigger";
+	G_IndexEntity( other );
 	VectorCopy (mins, other->r.mins);
 	VectorCopy (maxs, other->r.maxs);
 	other->parent = ent;
@@ -995,7 +1112,7 @@ void SP_func_door (gentity_t *ent) {
 
 	InitMover( ent );
 
-	ent->nextthink = level.time + FRAMETIME;
+	G_SetNextThink( ent, level.time + FRAMETIME );
 
 	if ( ! (ent->flags & FL_TEAMMEMBER ) ) {
 		int health;
@@ -1037,7 +1154,7 @@ void Touch_Plat( gentity_t *ent, gentity_t *other, trace_t *trace ) {
 
 	// delay return-to-pos1 by one second
 	if ( ent->moverState == MOVER_POS2 ) {
-		ent->nextthink = level.time + 1000;
+		G_SetNextThink( ent, level.time + 1000 );
 	}
 }
 
@@ -1076,6 +1193,7 @@ void SpawnPlatTrigger( gentity_t *ent ) {
 	// above the starting position
 	trigger = G_Spawn();
 	trigger->classname = "plat_trigger";
+	G_IndexEntity( trigger );
 	trigger->touch = Touch_PlatCenterTrigger;
 	trigger->r.contents = CONTENTS_TRIGGER;
 	trigger->parent = ent;
@@ -1337,7 +1455,7 @@ void Reached_Train( gentity_t *ent ) {
 
 	// if there is a "wait" value on the target, don't start moving yet
 	if ( next->wait ) {
-		ent->nextthink = level.time + next->wait * 1000;
+		G_SetNextThink( ent, level.time + next->wait * 1000 );
 		ent->think = Think_BeginMoving;
 		ent->s.pos.trType = TR_STATIONARY;
 	}
@@ -1452,7 +1570,7 @@ void SP_func_train (gentity_t *self) {
 
 	// start trains on the second frame, to make sure their targets have had
 	// a chance to spawn
-	self->nextthink = level.time + FRAMETIME;
+	G_SetNextThink( self, level.time + FRAMETIME );
 	self->think = Think_SetupTrainTargets;
 }
 
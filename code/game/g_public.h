@@ -25,6 +25,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #define	GAME_API_VERSION	8
 
+#define	MAX_USERCMD_BATCH	32		// most commands in one GAME_CLIENT_THINK_BATCH
+
 // entity->svFlags
 // the server does not know how to interpret most of the values
 // in entityStates (level eType), so the game must explicitly flag
@@ -97,6 +99,16 @@ typedef struct {
 	entityShared_t	r;				// shared by both the server system and game
 } sharedEntity_t;
 
+// one trace of a G_TRACE_BATCH call, mins and maxs are relative
+typedef struct {
+	vec3_t		start;
+	vec3_t		mins;
+	vec3_t		maxs;
+	vec3_t		end;
+	int			passEntityNum;
+	int			contentmask;
+} traceRequest_t;
+
 
 
 //===============================================================
@@ -230,6 +242,29 @@ typedef enum {
 	// 1.32
 	G_FS_SEEK,
 
+	G_GET_NATIVE_TRAPS,	// const gameNativeTraps_t * ( void );
+	// direct entry points for the hottest traps, NULL unless the game
+	// is a native library
+
+	G_CVAR_UPDATE_CHANGED,	// ( void );
+	// updates every registered vmCvar_t whose cvar changed since the
+	// last call, returns how many did
+
+	G_TRACE_BATCH,	// ( trace_t *results, const traceRequest_t *requests, int count );
+	// the same as a G_TRACE for each request
+
+	G_TRACE_AT_TIME,	// ( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int time );
+	// the same as G_TRACE, but players and bodies are clipped where they
+	// were at the given level time, as far back as the server keeps
+
+	G_TRIGGERS_IN_BOX,	// ( int entityNum, const vec3_t mins, const vec3_t maxs, int *list, int maxcount );
+	// EntitiesInBox for the entities with CONTENTS_TRIGGER, the server
+	// keeps the triggers around each client between calls
+
+	G_GET_USERCMDS,	// ( int clientNum, usercmd_t *cmds, int maxCmds );
+	// copies the commands of the GAME_CLIENT_THINK_BATCH being run,
+	// returns how many
+
 	BOTLIB_SETUP = 200,				// ( void );
 	BOTLIB_SHUTDOWN,				// ( void );
 	BOTLIB_LIBVAR_SET,
@@ -391,6 +426,19 @@ typedef enum {
 
 } gameImport_t;
 
+// called directly by native game libraries instead of going through
+// syscall, which packs every call into an argument array
+typedef struct {
+	void		(*Trace)( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask );
+	void		(*TraceCapsule)( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask );
+	int			(*PointContents)( const vec3_t point, int passEntityNum );
+	int			(*EntitiesInBox)( const vec3_t mins, const vec3_t maxs, int *list, int maxcount );
+	qboolean	(*EntityContact)( const vec3_t mins, const vec3_t maxs, const sharedEntity_t *ent );
+	qboolean	(*EntityContactCapsule)( const vec3_t mins, const vec3_t maxs, const sharedEntity_t *ent );
+	void		(*LinkEntity)( sharedEntity_t *ent );
+	void		(*UnlinkEntity)( sharedEntity_t *ent );
+} gameNativeTraps_t;
+
 
 //
 // functions exported by the game subsystem
@@ -425,6 +473,10 @@ typedef enum {
 	// The game can issue trap_argc() / trap_argv() commands to get the command
 	// and parameters.  Return qfalse if the game doesn't recognize it as a command.
 
-	BOTAI_START_FRAME				// ( int time );
+	BOTAI_START_FRAME,				// ( int time );
+
+	GAME_CLIENT_THINK_BATCH			// ( int clientNum );
+	// runs the commands G_GET_USERCMDS returns in order, the same as a
+	// GAME_CLIENT_THINK for each, a game that returns -1 gets those instead
 } gameExport_t;
 
@@ -440,6 +440,236 @@ void	Svcmd_ForceTeam_f( void ) {
 	SetTeam( &g_entities[cl - level.clients], str );
 }
 
+/*
+==============================================================================
+
+PMOVE RECORDING
+
+With g_pmoveRecord set to a file name every player Pmove is written out
+together with the player state before and after the move.  pmovebench
+replays such a file through Pmove on the current map, reporting the time
+taken and any moves that no longer produce the recorded state.  Replays
+are only exact on the map they were recorded on, without other players
+moving around.
+
+==============================================================================
+*/
+
+#define	PMOVE_RECORD_IDENT		(('C'<<24)+('R'<<16)+('M'<<8)+'P')
+#define	PMOVE_RECORD_VERSION	1
+
+typedef struct {
+	int				ident;
+	int				version;
+	int				recordSize;
+} pmoveRecordHeader_t;
+
+typedef struct {
+	int				tracemask;
+	int				noFootsteps;
+	int				gauntletHit;
+	int				pmove_fixed;
+	int				pmove_msec;
+	usercmd_t		cmd;
+	playerState_t	before;
+	playerState_t	after;
+} pmoveRecord_t;
+
+static fileHandle_t	pmoveRecordFile;
+static char			pmoveRecordName[MAX_QPATH];
+
+/*
+===================
+G_StopPmoveRecord
+===================
+*/
+void G_StopPmoveRecord( void ) {
+	if ( !pmoveRecordFile ) {
+		return;
+	}
+	trap_FS_FCloseFile( pmoveRecordFile );
+	pmoveRecordFile = 0;
+	G_Printf( "Stopped recording pmoves to %s\n", pmoveRecordName );
+	pmoveRecordName[0] = 0;
+}
+
+/*
+===================
+G_StartPmoveRecord
+===================
+*/
+static void G_StartPmoveRecord( const char *name ) {
+	pmoveRecordHeader_t	header;
+
+	G_StopPmoveRecord();
+
+	Q_strncpyz( pmoveRecordName, name, sizeof( pmoveRecordName ) );
+	trap_FS_FOpenFile( pmoveRecordName, &pmoveRecordFile, FS_WRITE );
+	if ( !pmoveRecordFile ) {
+		G_Printf( "Couldn't open %s for writing\n", pmoveRecordName );
+		return;
+	}
+
+	header.ident = PMOVE_RECORD_IDENT;
+	header.version = PMOVE_RECORD_VERSION;
+	header.recordSize = sizeof( pmoveRecord_t );
+	trap_FS_Write( &header, sizeof( header ), pmoveRecordFile );
+	G_Printf( "Recording pmoves to %s\n", pmoveRecordName );
+}
+
+/*
+===================
+G_Pmove
+
+Runs Pmove for a client think, recording it when g_pmoveRecord is set
+===================
+*/
+void G_Pmove( pmove_t *pm ) {
+	pmoveRecord_t	record;
+
+	if ( !g_pmoveRecord.string[0] ) {
+		G_StopPmoveRecord();
+		Pmove( pm );
+		return;
+	}
+
+	if ( !pmoveRecordFile || Q_stricmp( pmoveRecordName, g_pmoveRecord.string ) ) {
+		G_StartPmoveRecord( g_pmoveRecord.string );
+	}
+
+	record.tracemask = pm->tracemask;
+	record.noFootsteps = pm->noFootsteps;
+	record.gauntletHit = pm->gauntletHit;
+	record.pmove_fixed = pm->pmove_fixed;
+	record.pmove_msec = pm->pmove_msec;
+	record.cmd = pm->cmd;
+	record.before = *pm->ps;
+
+	Pmove( pm );
+
+	if ( pmoveRecordFile ) {
+		record.after = *pm->ps;
+		trap_FS_Write( &record, sizeof( record ), pmoveRecordFile );
+	}
+}
+
+/*
+===================
+G_SamePlayerState
+
+Bitwise comparison of two player states
+===================
+*/
+static qboolean G_SamePlayerState( const playerState_t *a, const playerState_t *b ) {
+	const int	*ia = (const int *)a;
+	const int	*ib = (const int *)b;
+	int			i;
+
+	for ( i = 0 ; i < (int)( sizeof( playerState_t ) / sizeof( int ) ) ; i++ ) {
+		if ( ia[i] != ib[i] ) {
+			return qfalse;
+		}
+	}
+	return qtrue;
+}
+
+/*
+===================
+Svcmd_PmoveBench_f
+
+pmovebench <file> [passes]
+===================
+*/
+void Svcmd_PmoveBench_f( void ) {
+	char				name[MAX_QPATH];
+	char				str[MAX_TOKEN_CHARS];
+	fileHandle_t		f;
+	pmoveRecordHeader_t	header;
+	static pmoveRecord_t	record;
+	playerState_t		ps;
+	pmove_t				pm;
+	int					len, numRecords;
+	int					i, pass, passes;
+	int					start, msec, mismatches;
+	int					groundTraces, groundTracesSaved;
+
+	if ( trap_Argc() < 2 ) {
+		G_Printf( "Usage: pmovebench <file> [passes]\n" );
+		return;
+	}
+
+	trap_Argv( 1, name, sizeof( name ) );
+	passes = 1;
+	if ( trap_Argc() > 2 ) {
+		trap_Argv( 2, str, sizeof( str ) );
+		passes = atoi( str );
+		if ( passes < 1 ) {
+			passes = 1;
+		}
+	}
+
+	msec = 0;
+	mismatches = 0;
+	numRecords = 0;
+	groundTraces = c_pmoveGroundTraces;
+	groundTracesSaved = c_pmoveGroundTracesSaved;
+
+	for ( pass = 0 ; pass < passes ; pass++ ) {
+		len = trap_FS_FOpenFile( name, &f, FS_READ );
+		if ( !f ) {
+			G_Printf( "Couldn't open %s\n", name );
+			return;
+		}
+		if ( len < (int)sizeof( header ) ) {
+			trap_FS_FCloseFile( f );
+			G_Printf( "%s is not a pmove recording\n", name );
+			return;
+		}
+		trap_FS_Read( &header, sizeof( header ), f );
+		if ( header.ident != PMOVE_RECORD_IDENT || header.version != PMOVE_RECORD_VERSION
+			|| header.recordSize != sizeof( pmoveRecord_t ) ) {
+			trap_FS_FCloseFile( f );
+			G_Printf( "%s is not a version %i pmove recording\n", name, PMOVE_RECORD_VERSION );
+			return;
+		}
+
+		numRecords = ( len - sizeof( header ) ) / sizeof( pmoveRecord_t );
+		for ( i = 0 ; i < numRecords ; i++ ) {
+			trap_FS_Read( &record, sizeof( record ), f );
+
+			ps = record.before;
+			memset( &pm, 0, sizeof( pm ) );
+			pm.ps = &ps;
+			pm.cmd = record.cmd;
+			pm.tracemask = record.tracemask;
+			pm.trace = trap_Trace;
+			pm.pointcontents = trap_PointContents;
+			pm.noFootsteps = record.noFootsteps;
+			pm.gauntletHit = record.gauntletHit;
+			pm.pmove_fixed = record.pmove_fixed;
+			pm.pmove_msec = record.pmove_msec;
+
+			start = trap_Milliseconds();
+			Pmove( &pm );
+			msec += trap_Milliseconds() - start;
+
+			if ( pass == 0 && !G_SamePlayerState( &ps, &record.after ) ) {
+				mismatches++;
+			}
+		}
+		trap_FS_FCloseFile( f );
+	}
+
+	G_Printf( "%i pmoves x %i passes in %i msec\n", numRecords, passes, msec );
+	G_Printf( "%i ground traces, %i reused\n", c_pmoveGroundTraces - groundTraces,
+		c_pmoveGroundTracesSaved - groundTracesSaved );
+	if ( mismatches ) {
+		G_Printf( S_COLOR_YELLOW "%i pmoves didn't match the recording\n", mismatches );
+	} else {
+		G_Printf( "all pmoves match the recording\n" );
+	}
+}
+
 char	*ConcatArgs( int start );
 
 /*
@@ -493,6 +723,11 @@ qboolean	ConsoleCommand( void ) {
 		return qtrue;
 	}
 
+	if (Q_stricmp (cmd, "pmovebench") == 0) {
+		Svcmd_PmoveBench_f();
+		return qtrue;
+	}
+
 	if (Q_stricmp (cmd, "listip") == 0) {
 		trap_SendConsoleCommand( EXEC_NOW, "g_banIPs\n" );
 		return qtrue;
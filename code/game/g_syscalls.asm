@@ -46,6 +46,11 @@ equ trap_SnapVector			-43
 equ trap_TraceCapsule		-44
 equ trap_EntityContactCapsule	-45
 equ trap_FS_Seek -46
+equ trap_Cvar_UpdateChanged -48
+equ trap_TraceBatch -49
+equ trap_TraceAtTime -50
+equ trap_TriggersInBox -51
+equ trap_GetUsercmds -52
 
 equ	memset					-101
 equ	memcpy					-102
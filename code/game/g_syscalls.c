@@ -30,6 +30,18 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 static intptr_t (QDECL *syscall)( intptr_t arg, ... ) = (intptr_t (QDECL *)( intptr_t, ...))-1;
 
+// direct entry points, fetched on the first trap that can use them
+static const gameNativeTraps_t *nativeTraps;
+static qboolean nativeTrapsChecked;
+
+static const gameNativeTraps_t *G_NativeTraps( void ) {
+	if ( !nativeTrapsChecked ) {
+		nativeTraps = (const gameNativeTraps_t *)syscall( G_GET_NATIVE_TRAPS );
+		nativeTrapsChecked = qtrue;
+	}
+	return nativeTraps;
+}
+
 
 Q_EXPORT void dllEntry( intptr_t (QDECL *syscallptr)( intptr_t arg,... ) ) {
 	syscall = syscallptr;
@@ -99,6 +111,10 @@ void	trap_Cvar_Update( vmCvar_t *cvar ) {
 	syscall( G_CVAR_UPDATE, cvar );
 }
 
+int		trap_Cvar_UpdateChanged( void ) {
+	return syscall( G_CVAR_UPDATE_CHANGED );
+}
+
 void trap_Cvar_Set( const char *var_name, const char *value ) {
 	syscall( G_CVAR_SET, var_name, value );
 }
@@ -150,14 +166,33 @@ void trap_SetBrushModel( gentity_t *ent, const char *name ) {
 }
 
 void trap_Trace( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask ) {
+	if ( G_NativeTraps() ) {
+		nativeTraps->Trace( results, start, mins, maxs, end, passEntityNum, contentmask );
+		return;
+	}
 	syscall( G_TRACE, results, start, mins, maxs, end, passEntityNum, contentmask );
 }
 
+void trap_TraceBatch( trace_t *results, const traceRequest_t *requests, int count ) {
+	syscall( G_TRACE_BATCH, results, requests, count );
+}
+
+void trap_TraceAtTime( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int time ) {
+	syscall( G_TRACE_AT_TIME, results, start, mins, maxs, end, passEntityNum, contentmask, time );
+}
+
 void trap_TraceCapsule( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask ) {
+	if ( G_NativeTraps() ) {
+		nativeTraps->TraceCapsule( results, start, mins, maxs, end, passEntityNum, contentmask );
+		return;
+	}
 	syscall( G_TRACECAPSULE, results, start, mins, maxs, end, passEntityNum, contentmask );
 }
 
 int trap_PointContents( const vec3_t point, int passEntityNum ) {
+	if ( G_NativeTraps() ) {
+		return nativeTraps->PointContents( point, passEntityNum );
+	}
 	return syscall( G_POINT_CONTENTS, point, passEntityNum );
 }
 
@@ -179,22 +214,43 @@ qboolean trap_AreasConnected( int area1, int area2 ) {
 }
 
 void trap_LinkEntity( gentity_t *ent ) {
+	if ( G_NativeTraps() ) {
+		nativeTraps->LinkEntity( (sharedEntity_t *)ent );
+		return;
+	}
 	syscall( G_LINKENTITY, ent );
 }
 
 void trap_UnlinkEntity( gentity_t *ent ) {
+	if ( G_NativeTraps() ) {
+		nativeTraps->UnlinkEntity( (sharedEntity_t *)ent );
+		return;
+	}
 	syscall( G_UNLINKENTITY, ent );
 }
 
+int trap_TriggersInBox( int entityNum, const vec3_t mins, const vec3_t maxs, int *list, int maxcount ) {
+	return syscall( G_TRIGGERS_IN_BOX, entityNum, mins, maxs, list, maxcount );
+}
+
 int trap_EntitiesInBox( const vec3_t mins, const vec3_t maxs, int *list, int maxcount ) {
+	if ( G_NativeTraps() ) {
+		return nativeTraps->EntitiesInBox( mins, maxs, list, maxcount );
+	}
 	return syscall( G_ENTITIES_IN_BOX, mins, maxs, list, maxcount );
 }
 
 qboolean trap_EntityContact( const vec3_t mins, const vec3_t maxs, const gentity_t *ent ) {
+	if ( G_NativeTraps() ) {
+		return nativeTraps->EntityContact( mins, maxs, (const sharedEntity_t *)ent );
+	}
 	return syscall( G_ENTITY_CONTACT, mins, maxs, ent );
 }
 
 qboolean trap_EntityContactCapsule( const vec3_t mins, const vec3_t maxs, const gentity_t *ent ) {
+	if ( G_NativeTraps() ) {
+		return nativeTraps->EntityContactCapsule( mins, maxs, (const sharedEntity_t *)ent );
+	}
 	return syscall( G_ENTITY_CONTACTCAPSULE, mins, maxs, ent );
 }
 
@@ -210,6 +266,10 @@ void trap_GetUsercmd( int clientNum, usercmd_t *cmd ) {
 	syscall( G_GET_USERCMD, clientNum, cmd );
 }
 
+int trap_GetUsercmds( int clientNum, usercmd_t *cmds, int maxCmds ) {
+	return syscall( G_GET_USERCMDS, clientNum, cmds, maxCmds );
+}
+
 qboolean trap_GetEntityToken( char *buffer, int bufferSize ) {
 	return syscall( G_GET_ENTITY_TOKEN, buffer, bufferSize );
 }
@@ -144,6 +144,115 @@ void G_TeamCommand( team_t team, char *cmd ) {
 }
 
 
+/*
+=============================================================================
+
+ENTITY FIELD INDEX
+
+classname, targetname and target are hashed so G_Find doesn't have to
+compare the string of every entity.  Code that changes one of these
+fields must call G_IndexEntity afterwards.
+
+=============================================================================
+*/
+
+#define	ENTITY_INDEX_HASH_SIZE	1024
+
+typedef struct {
+	int		fieldofs;
+	int		hash[ENTITY_INDEX_HASH_SIZE];	// entity number + 1 of the first in the chain
+	int		next[MAX_GENTITIES];			// entity number + 1 of the next in the chain
+	char	*indexed[MAX_GENTITIES];		// value the entity is indexed with
+} entityIndex_t;
+
+static entityIndex_t	entityIndexes[3] = {
+	{ FOFS(classname) },
+	{ FOFS(targetname) },
+	{ FOFS(target) }
+};
+
+/*
+=============
+G_EntityIndexHash
+
+Case insensitive, like the G_Find comparison
+=============
+*/
+int G_EntityIndexHash( const char *s ) {
+	unsigned	hash;
+
+	hash = 0;
+	for ( ; *s ; s++ ) {
+		hash = hash * 31 + tolower( *(unsigned char *)s );
+	}
+	return hash & ( ENTITY_INDEX_HASH_SIZE - 1 );
+}
+
+/*
+=============
+G_IndexEntityField
+
+Chains are kept sorted on entity number so G_Find returns
+entities in the same order as a linear scan
+=============
+*/
+static void G_IndexEntityField( entityIndex_t *index, int num, char *value ) {
+	int		*link;
+
+	if ( index->indexed[num] ) {
+		for ( link = &index->hash[G_EntityIndexHash( index->indexed[num] )] ; *link ; link = &index->next[*link - 1] ) {
+			if ( *link - 1 == num ) {
+				*link = index->next[num];
+				break;
+			}
+		}
+		index->next[num] = 0;
+	}
+	index->indexed[num] = value;
+	if ( value ) {
+		for ( link = &index->hash[G_EntityIndexHash( value )] ; *link && *link - 1 < num ; link = &index->next[*link - 1] ) {
+		}
+		index->next[num] = *link;
+		*link = num + 1;
+	}
+}
+
+/*
+=============
+G_IndexEntity
+
+Updates the index after the classname, targetname or target changed
+=============
+*/
+void G_IndexEntity( gentity_t *ent ) {
+	int		i, num;
+	char	*value;
+
+	num = ent - g_entities;
+	for ( i = 0 ; i < ARRAY_LEN( entityIndexes ) ; i++ ) {
+		value = *(char **)((byte *)ent + entityIndexes[i].fieldofs);
+		if ( value != entityIndexes[i].indexed[num] ) {
+			G_IndexEntityField( &entityIndexes[i], num, value );
+		}
+	}
+}
+
+/*
+=============
+G_ClearEntityIndex
+=============
+*/
+void G_ClearEntityIndex( void ) {
+	int		i;
+
+	for ( i = 0 ; i < ARRAY_LEN( entityIndexes ) ; i++ ) {
+		memset( entityIndexes[i].hash, 0, sizeof( entityIndexes[i].hash ) );
+		memset( entityIndexes[i].next, 0, sizeof( entityIndexes[i].next ) );
+		memset( entityIndexes[i].indexed, 0, sizeof( entityIndexes[i].indexed ) );
+	}
+}
+
+
 /*
 =============
 G_Find
@@ -159,12 +268,35 @@ NULL will be returned if the end of the list is reached.
 gentity_t *G_Find (gentity_t *from, int fieldofs, const char *match)
 {
 	char	*s;
+	int		i, num, start;
+	gentity_t	*ent;
 
 	if (!from)
 		from = g_entities;
 	else
 		from++;
 
+	for ( i = 0 ; i < ARRAY_LEN( entityIndexes ) ; i++ ) {
+		if ( entityIndexes[i].fieldofs != fieldofs ) {
+			continue;
+		}
+		start = from - g_entities;
+		for ( num = entityIndexes[i].hash[G_EntityIndexHash( match )] ; num ; num = entityIndexes[i].next[num - 1] ) {
+			if ( num - 1 < start ) {
+				continue;
+			}
+			ent = &g_entities[num - 1];
+			if ( !ent->inuse ) {
+				continue;
+			}
+			s = *(char **) ((byte *)ent + fieldofs);
+			if ( s && !Q_stricmp( s, match ) ) {
+				return ent;
+			}
+		}
+		return NULL;
+	}
+
 	for ( ; from < &g_entities[level.num_entities] ; from++)
 	{
 		if (!from->inuse)
@@ -369,6 +501,8 @@ void G_InitGentity( gentity_t *e ) {
 	e->classname = "noclass";
 	e->s.number = e - g_entities;
 	e->r.ownerNum = ENTITYNUM_NONE;
+	G_IndexEntity( e );
+	G_ActivateEntity( e );
 }
 
 /*
@@ -476,6 +610,7 @@ void G_FreeEntity( gentity_t *ed ) {
 	ed->classname = "freed";
 	ed->freetime = level.time;
 	ed->inuse = qfalse;
+	G_IndexEntity( ed );
 }
 
 /*
@@ -495,6 +630,7 @@ gentity_t *G_TempEntity( vec3_t origin, int event ) {
 	e->s.eType = ET_EVENTS + event;
 
 	e->classname = "tempEntity";
+	G_IndexEntity( e );
 	e->eventTime = level.time;
 	e->freeAfterEvent = qtrue;
 
@@ -597,6 +733,7 @@ void G_AddEvent( gentity_t *ent, int event, int eventParm ) {
 		ent->s.eventParm = eventParm;
 	}
 	ent->eventTime = level.time;
+	G_ActivateEntity( ent );
 }
 
 
@@ -161,6 +161,22 @@ void SnapVectorTowards( vec3_t v, vec3_t to ) {
 #define	MACHINEGUN_DAMAGE	7
 #define	MACHINEGUN_TEAM_DAMAGE	5		// wimpier MG in teamplay
 
+/*
+================
+G_ShotTrace
+
+Traces a hitscan shot.  With g_unlagged set the other players are where
+the shooter saw them when firing instead of where they are now.
+================
+*/
+static void G_ShotTrace( gentity_t *ent, trace_t *tr, const vec3_t start, const vec3_t end, int passent ) {
+	if ( g_unlagged.integer && ent->client && !( ent->r.svFlags & SVF_BOT ) ) {
+		trap_TraceAtTime( tr, start, NULL, NULL, end, passent, MASK_SHOT, ent->client->pers.cmd.serverTime );
+		return;
+	}
+	trap_Trace( tr, start, NULL, NULL, end, passent, MASK_SHOT );
+}
+
 void Bullet_Fire (gentity_t *ent, float spread, int damage, int mod ) {
 	trace_t		tr;
 	vec3_t		end;
@@ -185,7 +201,7 @@ void Bullet_Fire (gentity_t *ent, float spread, int damage, int mod ) {
 	passent = ent->s.number;
 	for (i = 0; i < 10; i++) {
 
-		trap_Trace (&tr, muzzle, NULL, NULL, end, passent, MASK_SHOT);
+		G_ShotTrace (ent, &tr, muzzle, end, passent);
 		if ( tr.surfaceFlags & SURF_NOIMPACT ) {
 			return;
 		}
@@ -267,7 +283,7 @@ SHOTGUN
 // client predicts same spreads
 #define	DEFAULT_SHOTGUN_DAMAGE	10
 
-qboolean ShotgunPellet( vec3_t start, vec3_t end, gentity_t *ent ) {
+qboolean ShotgunPellet( vec3_t start, vec3_t end, gentity_t *ent, const trace_t *firstTrace ) {
 	trace_t		tr;
 	int			damage, i, passent;
 	gentity_t	*traceEnt;
@@ -281,7 +297,11 @@ qboolean ShotgunPellet( vec3_t start, vec3_t end, gentity_t *ent ) {
 	VectorCopy( start, tr_start );
 	VectorCopy( end, tr_end );
 	for (i = 0; i < 10; i++) {
-		trap_Trace (&tr, tr_start, NULL, NULL, tr_end, passent, MASK_SHOT);
+		if ( i == 0 && firstTrace ) {
+			tr = *firstTrace;
+		} else {
+			trap_Trace (&tr, tr_start, NULL, NULL, tr_end, passent, MASK_SHOT);
+		}
 		traceEnt = &g_entities[ tr.entityNum ];
 
 		// send bullet impact
@@ -321,9 +341,12 @@ qboolean ShotgunPellet( vec3_t start, vec3_t end, gentity_t *ent ) {
 void ShotgunPattern( vec3_t origin, vec3_t origin2, int seed, gentity_t *ent ) {
 	int			i;
 	float		r, u;
-	vec3_t		end;
+	traceRequest_t	pellets[DEFAULT_SHOTGUN_COUNT];
+	trace_t		traces[DEFAULT_SHOTGUN_COUNT];
+	trace_t		*first;
 	vec3_t		localForward, localRight, localUp;
 	qboolean	hitClient = qfalse;
+	qboolean	damaged = qfalse;
 
 	// derive the right and up vectors from the forward vector, because
 	// the client won't have any other information
@@ -335,10 +358,30 @@ void ShotgunPattern( vec3_t origin, vec3_t origin2, int seed, gentity_t *ent ) {
 	for ( i = 0 ; i < DEFAULT_SHOTGUN_COUNT ; i++ ) {
 		r = Q_crandom( &seed ) * DEFAULT_SHOTGUN_SPREAD * 16;
 		u = Q_crandom( &seed ) * DEFAULT_SHOTGUN_SPREAD * 16;
-		VectorMA( origin, 8192 * 16, localForward, end);
-		VectorMA (end, r, localRight, end);
-		VectorMA (end, u, localUp, end);
-		if( ShotgunPellet( origin, end, ent ) && !hitClient ) {
+		VectorCopy( origin, pellets[i].start );
+		VectorClear( pellets[i].mins );
+		VectorClear( pellets[i].maxs );
+		VectorMA( origin, 8192 * 16, localForward, pellets[i].end);
+		VectorMA (pellets[i].end, r, localRight, pellets[i].end);
+		VectorMA (pellets[i].end, u, localUp, pellets[i].end);
+		pellets[i].passEntityNum = ent->s.number;
+		pellets[i].contentmask = MASK_SHOT;
+	}
+
+	// all of the first traces go out together
+	trap_TraceBatch( traces, pellets, DEFAULT_SHOTGUN_COUNT );
+
+	for ( i = 0 ; i < DEFAULT_SHOTGUN_COUNT ; i++ ) {
+		// once something has taken damage it may have died or gibbed,
+		// so a pellet that hit an entity is traced again
+		first = &traces[i];
+		if ( damaged && first->entityNum != ENTITYNUM_WORLD && first->entityNum != ENTITYNUM_NONE ) {
+			first = NULL;
+		} else if ( g_entities[ first->entityNum ].takedamage ) {
+			damaged = qtrue;
+		}
+
+		if( ShotgunPellet( origin, pellets[i].end, ent, first ) && !hitClient ) {
 			hitClient = qtrue;
 			ent->client->accuracy_hits++;
 		}
@@ -458,7 +501,7 @@ void weapon_railgun_fire (gentity_t *ent) {
 	hits = 0;
 	passent = ent->s.number;
 	do {
-		trap_Trace (&trace, muzzle, NULL, NULL, end, passent, MASK_SHOT );
+		G_ShotTrace (ent, &trace, muzzle, end, passent);
 		if ( trace.entityNum >= ENTITYNUM_MAX_NORMAL ) {
 			break;
 		}
@@ -620,7 +663,7 @@ void Weapon_LightningFire( gentity_t *ent ) {
 	for (i = 0; i < 10; i++) {
 		VectorMA( muzzle, LIGHTNING_RANGE, forward, end );
 
-		trap_Trace( &tr, muzzle, NULL, NULL, end, passent, MASK_SHOT );
+		G_ShotTrace( ent, &tr, muzzle, end, passent );
 
 #ifdef MISSIONPACK
 		// if not the first trace (the lightning bounced of an invulnerability sphere)
@@ -1046,7 +1089,7 @@ static void KamikazeDamage( gentity_t *self ) {
 		G_FreeEntity( self );
 		return;
 	}
-	self->nextthink = level.time + 100;
+	G_SetNextThink( self, level.time + 100 );
 
 	// add earth quake effect
 	newangles[0] = crandom() * 2;
@@ -1099,12 +1142,13 @@ void G_StartKamikaze( gentity_t *ent ) {
 	G_SetOrigin( explosion, snapped );
 
 	explosion->classname = "kamikaze";
+	G_IndexEntity( explosion );
 	explosion->s.pos.trType = TR_STATIONARY;
 
 	explosion->kamikazeTime = level.time;
 
 	explosion->think = KamikazeDamage;
-	explosion->nextthink = level.time + 100;
+	G_SetNextThink( explosion, level.time + 100 );
 	explosion->count = 0;
 	VectorClear(explosion->movedir);
 
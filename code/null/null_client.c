@@ -42,6 +42,10 @@ void Key_WriteBindings( fileHandle_t f ) {
 void CL_Frame ( int msec ) {
 }
 
+int CL_InputPacingUsec( void ) {
+	return 0;
+}
+
 void CL_PacketEvent( netadr_t from, msg_t *msg ) {
 }
 
@@ -630,6 +630,7 @@ void			trap_Error( const char *string ) Q_NO_RETURN;
 int				trap_Milliseconds( void );
 void			trap_Cvar_Register( vmCvar_t *vmCvar, const char *varName, const char *defaultValue, int flags );
 void			trap_Cvar_Update( vmCvar_t *vmCvar );
+int				trap_Cvar_UpdateChanged( void );
 void			trap_Cvar_Set( const char *var_name, const char *value );
 float			trap_Cvar_VariableValue( const char *var_name );
 void			trap_Cvar_VariableStringBuffer( const char *var_name, char *buffer, int bufsize );
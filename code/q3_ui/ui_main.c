@@ -241,14 +241,6 @@ UI_UpdateCvars
 =================
 */
 void UI_UpdateCvars( void ) {
-	int			i;
-	cvarTable_t	*cv;
-
-	for ( i = 0, cv = cvarTable ; i < cvarTableSize ; i++, cv++ ) {
-		if ( !cv->vmCvar ) {
-			continue;
-		}
-
-		trap_Cvar_Update( cv->vmCvar );
-	}
+	// the engine refreshes the changed vmCvars itself
+	trap_Cvar_UpdateChanged();
 }
@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 // cmodel.c -- model loading
 
 #include "cm_local.h"
+#include "cm_patch.h"
 
 #ifdef BSPC
 
@@ -43,10 +44,6 @@ void SetPlaneSignbits (cplane_t *out) {
 
 // to allow boxes to be treated as brush models, we allocate
 // some extra indexes along with those needed by the map
-#define	BOX_BRUSHES		1
-#define	BOX_SIDES		6
-#define	BOX_LEAFS		2
-#define	BOX_PLANES		12
 
 #define	LL(x) x=LittleLong(x)
 
@@ -62,17 +59,199 @@ byte		*cmod_base;
 cvar_t		*cm_noAreas;
 cvar_t		*cm_noCurves;
 cvar_t		*cm_playerCurveClip;
+cvar_t		*cm_shareMaps;
+cvar_t		*cm_patchCache;
 #endif
 
-cmodel_t	box_model;
-cplane_t	*box_planes;
-cbrush_t	*box_brush;
+Q_THREAD_LOCAL cBoxHull_t	cm_boxHull;
 
 
 
-void	CM_InitBoxHull (void);
 void	CM_FloodAreaConnections (void);
 
+/*
+===============================================================================
+
+					SHARED MAPS
+
+With cm_shareMaps the collision data of a map is built in reserved address
+space instead of the hunk and then published as a named shared memory
+object, keyed by the file's checksum.  Other processes on the host loading
+the same file map the object read-only instead of building their own copy.
+The data is full of pointers, so it can only be used at the address it was
+built at; a process that has something else there builds its own.  Areas
+and portal counts change as the game runs and stay in each process's hunk.
+The name is removed when the process that published it leaves the map,
+views already mapped stay valid until their processes leave it too.
+
+===============================================================================
+*/
+
+#define	CM_SHARED_IDENT		(('S'<<24)+('M'<<16)+('C'<<8)+'I')
+#define	CM_SHARED_BUILD		Q3_VERSION " " __DATE__ " " __TIME__
+#define	CM_SHARED_ALIGN		32		// same as Hunk_Alloc
+
+typedef struct {
+	int			ident;				// published last
+	char		build[64];			// only the same build has the same layouts
+	int			checksum;
+	size_t		size;
+	void		*base;				// where every pointer in here is valid
+	clipMap_t	cm;
+} cmSharedHeader_t;
+
+static struct {
+	char		name[64];
+	byte		*base;
+	size_t		size;				// reserved or mapped
+	size_t		used;
+	qboolean	building;
+	qboolean	published;			// by this process, which removes the name
+} cm_shared;
+
+/*
+==================
+CM_Alloc
+
+Cleared memory for the map, from the shared reservation while one is
+being built, else the hunk
+==================
+*/
+void *CM_Alloc( int size ) {
+#ifndef BSPC
+	void	*p;
+
+	if ( cm_shared.building ) {
+		size = PAD( size, CM_SHARED_ALIGN );
+		if ( cm_shared.used + size <= cm_shared.size ) {
+			p = cm_shared.base + cm_shared.used;
+			cm_shared.used += size;
+			return p;
+		}
+
+		// what is in the reservation stays private to this process
+		Com_DPrintf( "CM_Alloc: %s doesn't fit, not sharing it\n", cm.name );
+		cm_shared.building = qfalse;
+	}
+#endif
+	return Hunk_Alloc( size, h_high );
+}
+
+#ifndef BSPC
+/*
+==================
+CM_ReleaseShared
+==================
+*/
+static void CM_ReleaseShared( void ) {
+	if ( cm_shared.published ) {
+		Sys_RemoveSharedMemory( cm_shared.name );
+	}
+	if ( cm_shared.base ) {
+		Sys_CloseSharedMemory( cm_shared.base, cm_shared.size );
+	}
+	Com_Memset( &cm_shared, 0, sizeof( cm_shared ) );
+}
+
+/*
+==================
+CM_AttachShared
+
+Maps the collision data another process published for this file
+==================
+*/
+static qboolean CM_AttachShared( int checksum, int length, int *finalChecksum ) {
+	cmSharedHeader_t	*header;
+	void				*base;
+	size_t				size;
+	qboolean			valid;
+
+	Com_sprintf( cm_shared.name, sizeof( cm_shared.name ), "/" PRODUCT_NAME "-cm-%08x-%x", checksum, length );
+
+	header = Sys_OpenSharedMemory( cm_shared.name, NULL, sizeof( *header ) );
+	if ( !header ) {
+		return qfalse;
+	}
+	valid = header->ident == CM_SHARED_IDENT && !strcmp( header->build, CM_SHARED_BUILD );
+	base = header->base;
+	size = header->size;
+	Sys_CloseSharedMemory( header, sizeof( *header ) );
+
+	if ( !valid ) {
+		return qfalse;
+	}
+
+	header = Sys_OpenSharedMemory( cm_shared.name, base, size );
+	if ( !header ) {
+		Com_DPrintf( "CM_AttachShared: %p is taken, building %s here\n", base, cm_shared.name );
+		return qfalse;
+	}
+
+	cm_shared.base = base;
+	cm_shared.size = size;
+
+	cm = header->cm;
+	*finalChecksum = header->checksum;
+
+	cm.areas = Hunk_Alloc( cm.numAreas * sizeof( *cm.areas ), h_high );
+	cm.areaPortals = Hunk_Alloc( cm.numAreas * cm.numAreas * sizeof( *cm.areaPortals ), h_high );
+	cm.floodvalid = 0;
+	CM_FloodAreaConnections();
+
+	Com_Printf( "Mapped %i KB of shared collision data\n", (int)( size >> 10 ) );
+	return qtrue;
+}
+
+/*
+==================
+CM_BeginShared
+
+Reserves the address space the map is built in.  Nothing is taken from
+it until it is touched, so it can be far more than a map needs.
+==================
+*/
+static void CM_BeginShared( int length ) {
+	size_t	size;
+
+	size = ( 64 << 20 ) + (size_t)length * 8;
+	cm_shared.base = Sys_ReserveMemory( size );
+	if ( !cm_shared.base ) {
+		return;
+	}
+	cm_shared.size = size;
+	cm_shared.used = PAD( sizeof( cmSharedHeader_t ), CM_SHARED_ALIGN );
+	cm_shared.building = qtrue;
+}
+
+/*
+==================
+CM_PublishShared
+==================
+*/
+static void CM_PublishShared( int checksum ) {
+	cmSharedHeader_t	*header;
+
+	if ( !cm_shared.building ) {
+		return;
+	}
+	cm_shared.building = qfalse;
+
+	header = (cmSharedHeader_t *)cm_shared.base;
+	header->ident = CM_SHARED_IDENT;
+	Q_strncpyz( header->build, CM_SHARED_BUILD, sizeof( header->build ) );
+	header->checksum = checksum;
+	header->size = cm_shared.used;
+	header->base = cm_shared.base;
+	header->cm = cm;
+
+	// another process may have beaten us to it, then this stays ours alone
+	if ( Sys_PublishSharedMemory( cm_shared.name, cm_shared.base, cm_shared.used ) ) {
+		cm_shared.published = qtrue;
+		Com_DPrintf( "CM_PublishShared: %s, %i KB\n", cm_shared.name, (int)( cm_shared.used >> 10 ) );
+	}
+}
+#endif
+
 
 /*
 ===============================================================================
@@ -100,7 +279,7 @@ void CMod_LoadShaders( lump_t *l ) {
 	if (count < 1) {
 		Com_Error (ERR_DROP, "Map with no shaders");
 	}
-	cm.shaders = Hunk_Alloc( count * sizeof( *cm.shaders ), h_high );
+	cm.shaders = CM_Alloc( count * sizeof( *cm.shaders ) );
 	cm.numShaders = count;
 
 	Com_Memcpy( cm.shaders, in, count * sizeof( *cm.shaders ) );
@@ -131,7 +310,7 @@ void CMod_LoadSubmodels( lump_t *l ) {
 
 	if (count < 1)
 		Com_Error (ERR_DROP, "Map with no models");
-	cm.cmodels = Hunk_Alloc( count * sizeof( *cm.cmodels ), h_high );
+	cm.cmodels = CM_Alloc( count * sizeof( *cm.cmodels ) );
 	cm.numSubModels = count;
 
 	if ( count > MAX_SUBMODELS ) {
@@ -154,14 +333,14 @@ void CMod_LoadSubmodels( lump_t *l ) {
 
 		// make a "leaf" just to hold the model's brushes and surfaces
 		out->leaf.numLeafBrushes = LittleLong( in->numBrushes );
-		indexes = Hunk_Alloc( out->leaf.numLeafBrushes * 4, h_high );
+		indexes = CM_Alloc( out->leaf.numLeafBrushes * 4 );
 		out->leaf.firstLeafBrush = indexes - cm.leafbrushes;
 		for ( j = 0 ; j < out->leaf.numLeafBrushes ; j++ ) {
 			indexes[j] = LittleLong( in->firstBrush ) + j;
 		}
 
 		out->leaf.numLeafSurfaces = LittleLong( in->numSurfaces );
-		indexes = Hunk_Alloc( out->leaf.numLeafSurfaces * 4, h_high );
+		indexes = CM_Alloc( out->leaf.numLeafSurfaces * 4 );
 		out->leaf.firstLeafSurface = indexes - cm.leafsurfaces;
 		for ( j = 0 ; j < out->leaf.numLeafSurfaces ; j++ ) {
 			indexes[j] = LittleLong( in->firstSurface ) + j;
@@ -189,7 +368,7 @@ void CMod_LoadNodes( lump_t *l ) {
 
 	if (count < 1)
 		Com_Error (ERR_DROP, "Map has no nodes");
-	cm.nodes = Hunk_Alloc( count * sizeof( *cm.nodes ), h_high );
+	cm.nodes = CM_Alloc( count * sizeof( *cm.nodes ) );
 	cm.numNodes = count;
 
 	out = cm.nodes;
@@ -224,6 +403,49 @@ void CM_BoundBrush( cbrush_t *b ) {
 }
 
 
+/*
+=================
+CM_BuildBrushPlanes
+
+Copies the planes of every brush side past the first six into
+cbrushPlanes4_t blocks for the box tests in cm_trace.c
+=================
+*/
+static void CM_BuildBrushPlanes( void ) {
+	cbrush_t		*b;
+	cbrushPlanes4_t	*out;
+	cplane_t		*plane;
+	int				i, j, numBlocks;
+
+	numBlocks = 0;
+	for ( i = 0, b = cm.brushes ; i < cm.numBrushes ; i++, b++ ) {
+		if ( b->numsides > 6 ) {
+			numBlocks += ( b->numsides - 6 + 3 ) >> 2;
+		}
+	}
+	if ( !numBlocks ) {
+		return;
+	}
+
+	// Hunk_Alloc clears the memory, which leaves the unused lanes zero
+	out = CM_Alloc( numBlocks * sizeof( *out ) );
+
+	for ( i = 0, b = cm.brushes ; i < cm.numBrushes ; i++, b++ ) {
+		if ( b->numsides <= 6 ) {
+			continue;
+		}
+		b->planes4 = out;
+		for ( j = 6 ; j < b->numsides ; j++ ) {
+			plane = b->sides[j].plane;
+			out[( j - 6 ) >> 2].normal[0][( j - 6 ) & 3] = plane->normal[0];
+			out[( j - 6 ) >> 2].normal[1][( j - 6 ) & 3] = plane->normal[1];
+			out[( j - 6 ) >> 2].normal[2][( j - 6 ) & 3] = plane->normal[2];
+			out[( j - 6 ) >> 2].dist[( j - 6 ) & 3] = plane->dist;
+		}
+		out += ( b->numsides - 6 + 3 ) >> 2;
+	}
+}
+
 /*
 =================
 CMod_LoadBrushes
@@ -241,7 +463,7 @@ void CMod_LoadBrushes( lump_t *l ) {
 	}
 	count = l->filelen / sizeof(*in);
 
-	cm.brushes = Hunk_Alloc( ( BOX_BRUSHES + count ) * sizeof( *cm.brushes ), h_high );
+	cm.brushes = CM_Alloc( count * sizeof( *cm.brushes ) );
 	cm.numBrushes = count;
 
 	out = cm.brushes;
@@ -281,7 +503,7 @@ void CMod_LoadLeafs (lump_t *l)
 	if (count < 1)
 		Com_Error (ERR_DROP, "Map with no leafs");
 
-	cm.leafs = Hunk_Alloc( ( BOX_LEAFS + count ) * sizeof( *cm.leafs ), h_high );
+	cm.leafs = CM_Alloc( count * sizeof( *cm.leafs ) );
 	cm.numLeafs = count;
 
 	out = cm.leafs;	
@@ -300,6 +522,7 @@ void CMod_LoadLeafs (lump_t *l)
 			cm.numAreas = out->area + 1;
 	}
 
+	// written as the game runs, so never in a shared map
 	cm.areas = Hunk_Alloc( cm.numAreas * sizeof( *cm.areas ), h_high );
 	cm.areaPortals = Hunk_Alloc( cm.numAreas * cm.numAreas * sizeof( *cm.areaPortals ), h_high );
 }
@@ -324,7 +547,7 @@ void CMod_LoadPlanes (lump_t *l)
 
 	if (count < 1)
 		Com_Error (ERR_DROP, "Map with no planes");
-	cm.planes = Hunk_Alloc( ( BOX_PLANES + count ) * sizeof( *cm.planes ), h_high );
+	cm.planes = CM_Alloc( count * sizeof( *cm.planes ) );
 	cm.numPlanes = count;
 
 	out = cm.planes;	
@@ -362,7 +585,7 @@ void CMod_LoadLeafBrushes (lump_t *l)
 		Com_Error (ERR_DROP, "MOD_LoadBmodel: funny lump size");
 	count = l->filelen / sizeof(*in);
 
-	cm.leafbrushes = Hunk_Alloc( (count + BOX_BRUSHES) * sizeof( *cm.leafbrushes ), h_high );
+	cm.leafbrushes = CM_Alloc( count * sizeof( *cm.leafbrushes ) );
 	cm.numLeafBrushes = count;
 
 	out = cm.leafbrushes;
@@ -389,7 +612,7 @@ void CMod_LoadLeafSurfaces( lump_t *l )
 		Com_Error (ERR_DROP, "MOD_LoadBmodel: funny lump size");
 	count = l->filelen / sizeof(*in);
 
-	cm.leafsurfaces = Hunk_Alloc( count * sizeof( *cm.leafsurfaces ), h_high );
+	cm.leafsurfaces = CM_Alloc( count * sizeof( *cm.leafsurfaces ) );
 	cm.numLeafSurfaces = count;
 
 	out = cm.leafsurfaces;
@@ -418,7 +641,7 @@ void CMod_LoadBrushSides (lump_t *l)
 	}
 	count = l->filelen / sizeof(*in);
 
-	cm.brushsides = Hunk_Alloc( ( BOX_SIDES + count ) * sizeof( *cm.brushsides ), h_high );
+	cm.brushsides = CM_Alloc( count * sizeof( *cm.brushsides ) );
 	cm.numBrushSides = count;
 
 	out = cm.brushsides;	
@@ -441,7 +664,7 @@ CMod_LoadEntityString
 =================
 */
 void CMod_LoadEntityString( lump_t *l ) {
-	cm.entityString = Hunk_Alloc( l->filelen, h_high );
+	cm.entityString = CM_Alloc( l->filelen );
 	cm.numEntityChars = l->filelen;
 	Com_Memcpy (cm.entityString, cmod_base + l->fileofs, l->filelen);
 }
@@ -459,14 +682,14 @@ void CMod_LoadVisibility( lump_t *l ) {
     len = l->filelen;
 	if ( !len ) {
 		cm.clusterBytes = ( cm.numClusters + 31 ) & ~31;
-		cm.visibility = Hunk_Alloc( cm.clusterBytes, h_high );
+		cm.visibility = CM_Alloc( cm.clusterBytes );
 		Com_Memset( cm.visibility, 255, cm.clusterBytes );
 		return;
 	}
 	buf = cmod_base + l->fileofs;
 
 	cm.vised = qtrue;
-	cm.visibility = Hunk_Alloc( len, h_high );
+	cm.visibility = CM_Alloc( len );
 	cm.numClusters = LittleLong( ((int *)buf)[0] );
 	cm.clusterBytes = LittleLong( ((int *)buf)[1] );
 	Com_Memcpy (cm.visibility, buf + VIS_HEADER, len - VIS_HEADER );
@@ -475,13 +698,194 @@ void CMod_LoadVisibility( lump_t *l ) {
 //==================================================================
 
 
+#ifndef BSPC
+/*
+===============================================================================
+
+PATCH COLLISION CACHE
+
+The facets and border planes of every curve are written to
+cache/patches/<checksum>.pcc the first time a server loads a Q3 map, and
+read back on later loads instead of subdividing the curves again.  The file
+holds the in-memory structures as they are, so the header records their
+sizes and a cache from a different build is rebuilt rather than trusted.
+
+===============================================================================
+*/
+
+#define	PATCHCACHE_IDENT	(('C'<<24)+('C'<<16)+('P'<<8)+'I')
+#define	PATCHCACHE_VERSION	1
+
+typedef struct {
+	int		ident;
+	int		version;
+	int		checksum;
+	int		numSurfaces;
+	int		planeSize;
+	int		facetSize;
+} patchCacheHeader_t;
+
+typedef struct {
+	int		surfaceNum;
+	vec3_t	bounds[2];
+	int		numPlanes;
+	int		numFacets;
+} patchCacheEntry_t;
+
+typedef struct {
+	void		*buffer;
+	const byte	*cur;
+	const byte	*end;
+} patchCache_t;
+
+static const char *CM_PatchCacheName( int checksum ) {
+	return va( "cache/patches/%08x.pcc", checksum );
+}
+
+/*
+=================
+CM_OpenPatchCache
+
+Returns qfalse if there is no usable cache for this map
+=================
+*/
+static qboolean CM_OpenPatchCache( patchCache_t *cache, int checksum ) {
+	const patchCacheHeader_t *header;
+	long	length;
+
+	Com_Memset( cache, 0, sizeof( *cache ) );
+
+	length = FS_ReadFile( CM_PatchCacheName( checksum ), &cache->buffer );
+	if ( !cache->buffer ) {
+		return qfalse;
+	}
+
+	header = cache->buffer;
+	if ( length < sizeof( *header ) || header->ident != PATCHCACHE_IDENT
+		|| header->version != PATCHCACHE_VERSION || header->checksum != checksum
+		|| header->numSurfaces != cm.numSurfaces || header->planeSize != sizeof( patchPlane_t )
+		|| header->facetSize != sizeof( facet_t ) ) {
+		Com_DPrintf( "Ignoring stale %s\n", CM_PatchCacheName( checksum ) );
+		FS_FreeFile( cache->buffer );
+		cache->buffer = NULL;
+		return qfalse;
+	}
+
+	cache->cur = (const byte *)cache->buffer + sizeof( *header );
+	cache->end = (const byte *)cache->buffer + length;
+	return qtrue;
+}
+
+/*
+=================
+CM_ReadPatchCache
+
+Returns NULL if the next entry isn't for this surface or doesn't check out,
+the caller then generates the collision data the slow way
+=================
+*/
+static patchCollide_t *CM_ReadPatchCache( patchCache_t *cache, int surfaceNum ) {
+	const patchCacheEntry_t *entry;
+	const patchPlane_t *planes;
+	const facet_t *facets;
+	patchCollide_t *pc;
+	int		i, j;
+
+	if ( cache->end - cache->cur < sizeof( *entry ) ) {
+		return NULL;
+	}
+	entry = (const patchCacheEntry_t *)cache->cur;
+	if ( entry->surfaceNum != surfaceNum
+		|| entry->numPlanes < 0 || entry->numPlanes > MAX_PATCH_PLANES
+		|| entry->numFacets < 0 || entry->numFacets > MAX_FACETS ) {
+		return NULL;
+	}
+	planes = (const patchPlane_t *)( entry + 1 );
+	facets = (const facet_t *)( planes + entry->numPlanes );
+	if ( (const byte *)( facets + entry->numFacets ) > cache->end ) {
+		return NULL;
+	}
+
+	// a bad plane number would send traces off the end of the array
+	for ( i = 0 ; i < entry->numFacets ; i++ ) {
+		if ( (unsigned)facets[i].surfacePlane >= entry->numPlanes
+			|| (unsigned)facets[i].numBorders > ARRAY_LEN( facets[i].borderPlanes ) ) {
+			return NULL;
+		}
+		for ( j = 0 ; j < facets[i].numBorders ; j++ ) {
+			if ( (unsigned)facets[i].borderPlanes[j] >= entry->numPlanes ) {
+				return NULL;
+			}
+		}
+	}
+
+	pc = CM_Alloc( sizeof( *pc ) );
+	VectorCopy( entry->bounds[0], pc->bounds[0] );
+	VectorCopy( entry->bounds[1], pc->bounds[1] );
+	pc->numPlanes = entry->numPlanes;
+	pc->planes = CM_Alloc( pc->numPlanes * sizeof( *pc->planes ) );
+	Com_Memcpy( pc->planes, planes, pc->numPlanes * sizeof( *pc->planes ) );
+	pc->numFacets = entry->numFacets;
+	pc->facets = CM_Alloc( pc->numFacets * sizeof( *pc->facets ) );
+	Com_Memcpy( pc->facets, facets, pc->numFacets * sizeof( *pc->facets ) );
+
+	cache->cur = (const byte *)( facets + entry->numFacets );
+	return pc;
+}
+
+/*
+=================
+CM_WritePatchCache
+=================
+*/
+static void CM_WritePatchCache( int checksum ) {
+	patchCacheHeader_t	header;
+	patchCacheEntry_t	entry;
+	patchCollide_t	*pc;
+	fileHandle_t	f;
+	int		i;
+
+	f = FS_FOpenFileWrite_HomeData( CM_PatchCacheName( checksum ) );
+	if ( !f ) {
+		return;
+	}
+
+	header.ident = PATCHCACHE_IDENT;
+	header.version = PATCHCACHE_VERSION;
+	header.checksum = checksum;
+	header.numSurfaces = cm.numSurfaces;
+	header.planeSize = sizeof( patchPlane_t );
+	header.facetSize = sizeof( facet_t );
+	FS_Write( &header, sizeof( header ), f );
+
+	for ( i = 0 ; i < cm.numSurfaces ; i++ ) {
+		if ( !cm.surfaces[i] ) {
+			continue;
+		}
+		pc = cm.surfaces[i]->pc;
+
+		Com_Memset( &entry, 0, sizeof( entry ) );
+		entry.surfaceNum = i;
+		VectorCopy( pc->bounds[0], entry.bounds[0] );
+		VectorCopy( pc->bounds[1], entry.bounds[1] );
+		entry.numPlanes = pc->numPlanes;
+		entry.numFacets = pc->numFacets;
+		FS_Write( &entry, sizeof( entry ), f );
+		FS_Write( pc->planes, pc->numPlanes * sizeof( *pc->planes ), f );
+		FS_Write( pc->facets, pc->numFacets * sizeof( *pc->facets ), f );
+	}
+
+	FS_FCloseFile( f );
+}
+#endif
+
 /*
 =================
 CMod_LoadPatches
 =================
 */
 #define	MAX_PATCH_VERTS		1024
-void CMod_LoadPatches( lump_t *surfs, lump_t *verts ) {
+void CMod_LoadPatches( lump_t *surfs, lump_t *verts, int checksum, qboolean useCache ) {
 	drawVert_t	*dv, *dv_p;
 	dsurface_t	*in;
 	int			count;
@@ -491,17 +895,26 @@ void CMod_LoadPatches( lump_t *surfs, lump_t *verts ) {
 	vec3_t		points[MAX_PATCH_VERTS];
 	int			width, height;
 	int			shaderNum;
+#ifndef BSPC
+	patchCache_t	cache;
+	qboolean	cacheValid, generated;
+#endif
 
 	in = (void *)(cmod_base + surfs->fileofs);
 	if (surfs->filelen % sizeof(*in))
 		Com_Error (ERR_DROP, "MOD_LoadBmodel: funny lump size");
 	cm.numSurfaces = count = surfs->filelen / sizeof(*in);
-	cm.surfaces = Hunk_Alloc( cm.numSurfaces * sizeof( cm.surfaces[0] ), h_high );
+	cm.surfaces = CM_Alloc( cm.numSurfaces * sizeof( cm.surfaces[0] ) );
 
 	dv = (void *)(cmod_base + verts->fileofs);
 	if (verts->filelen % sizeof(*dv))
 		Com_Error (ERR_DROP, "MOD_LoadBmodel: funny lump size");
 
+#ifndef BSPC
+	cacheValid = useCache && CM_OpenPatchCache( &cache, checksum );
+	generated = qfalse;
+#endif
+
 	// scan through all the surfaces, but only load patches,
 	// not planar faces
 	for ( i = 0 ; i < count ; i++, in++ ) {
@@ -510,7 +923,7 @@ void CMod_LoadPatches( lump_t *surfs, lump_t *verts ) {
 		}
 		// FIXME: check for non-colliding patches
 
-		cm.surfaces[ i ] = patch = Hunk_Alloc( sizeof( *patch ), h_high );
+		cm.surfaces[ i ] = patch = CM_Alloc( sizeof( *patch ) );
 
 		// load the full drawverts onto the stack
 		width = LittleLong( in->patchWidth );
@@ -532,8 +945,29 @@ void CMod_LoadPatches( lump_t *surfs, lump_t *verts ) {
 		patch->surfaceFlags = cm.shaders[shaderNum].surfaceFlags;
 
 		// create the internal facet structure
+#ifndef BSPC
+		if ( cacheValid ) {
+			patch->pc = CM_ReadPatchCache( &cache, i );
+			if ( patch->pc ) {
+				continue;
+			}
+			cacheValid = qfalse;
+		}
+		generated = qtrue;
+#endif
 		patch->pc = CM_GeneratePatchCollide( width, height, points );
 	}
+
+#ifndef BSPC
+	if ( useCache ) {
+		if ( cache.buffer ) {
+			FS_FreeFile( cache.buffer );
+		}
+		if ( generated ) {
+			CM_WritePatchCache( checksum );
+		}
+	}
+#endif
 }
 
 /*
@@ -550,7 +984,7 @@ static void CMod_LoadLeafsCod1( const cod1_dleaf_t *in, int count ) {
 	if ( count < 1 )
 		Com_Error( ERR_DROP, "Map with no leafs" );
 
-	cm.leafs = Hunk_Alloc( ( BOX_LEAFS + count ) * sizeof( *cm.leafs ), h_high );
+	cm.leafs = CM_Alloc( count * sizeof( *cm.leafs ) );
 	cm.numLeafs = count;
 
 	out = cm.leafs;
@@ -570,9 +1004,6 @@ static void CMod_LoadLeafsCod1( const cod1_dleaf_t *in, int count ) {
 		if ( out->area >= cm.numAreas )
 			cm.numAreas = out->area + 1;
 	}
-
-	cm.areas      = Hunk_Alloc( cm.numAreas * sizeof( *cm.areas ), h_high );
-	cm.areaPortals = Hunk_Alloc( cm.numAreas * cm.numAreas * sizeof( *cm.areaPortals ), h_high );
 }
 
 /*
@@ -591,6 +1022,44 @@ static lump_t CM_GetCod1Lump( const byte *base, int idx ) {
 	return out;
 }
 
+/*
+=================
+CMod_LoadVisibilityCod1
+
+The CoD1 vis lump uses the Q3 layout: numClusters, clusterBytes, then one
+uncompressed bit row per cluster.  Only a missing lump or one that doesn't
+cover every cluster referenced by the leafs falls back to all-visible.
+=================
+*/
+static void CMod_LoadVisibilityCod1( lump_t *l ) {
+	byte	*buf;
+	int		numClusters, clusterBytes;
+
+	if ( l->filelen >= VIS_HEADER ) {
+		buf = cmod_base + l->fileofs;
+		numClusters = LittleLong( ((int *)buf)[0] );
+		clusterBytes = LittleLong( ((int *)buf)[1] );
+
+		if ( numClusters > 0 && numClusters >= cm.numClusters &&
+			clusterBytes >= ( numClusters + 7 ) >> 3 &&
+			numClusters <= ( l->filelen - VIS_HEADER ) / clusterBytes ) {
+			cm.vised = qtrue;
+			cm.numClusters = numClusters;
+			cm.clusterBytes = clusterBytes;
+			cm.visibility = CM_Alloc( numClusters * clusterBytes );
+			Com_Memcpy( cm.visibility, buf + VIS_HEADER, numClusters * clusterBytes );
+			return;
+		}
+
+		Com_Printf( S_COLOR_YELLOW "WARNING: CMod_LoadVisibilityCod1: bad vis lump "
+			"(%d clusters, %d bytes per cluster)\n", numClusters, clusterBytes );
+	}
+
+	cm.clusterBytes = ( cm.numClusters + 31 ) & ~31;
+	cm.visibility = CM_Alloc( cm.clusterBytes );
+	Com_Memset( cm.visibility, 255, cm.clusterBytes );
+}
+
 /*
 =================
 CMod_LoadBrushesAndSidesCod1
@@ -625,12 +1094,12 @@ static void CMod_LoadBrushesAndSidesCod1( lump_t *bl, lump_t *bsl ) {
 	numBrushSides = bsl->filelen / 8;
 
 	/* One cplane_t per axial slot (6 per brush) — stored in a separate pool */
-	axialPlanes = Hunk_Alloc( numBrushes * 6 * sizeof( cplane_t ), h_high );
+	axialPlanes = CM_Alloc( numBrushes * 6 * sizeof( cplane_t ) );
 
-	cm.brushsides    = Hunk_Alloc( ( BOX_SIDES    + numBrushSides ) * sizeof( *cm.brushsides ), h_high );
+	cm.brushsides    = CM_Alloc( numBrushSides * sizeof( *cm.brushsides ) );
 	cm.numBrushSides = numBrushSides;
 
-	cm.brushes    = Hunk_Alloc( ( BOX_BRUSHES + numBrushes ) * sizeof( *cm.brushes ), h_high );
+	cm.brushes    = CM_Alloc( numBrushes * sizeof( *cm.brushes ) );
 	cm.numBrushes = numBrushes;
 
 	brush_in    = (unsigned int *)(cmod_base + bl->fileofs);
@@ -663,6 +1132,7 @@ static void CMod_LoadBrushesAndSidesCod1( lump_t *bl, lump_t *bsl ) {
 		bout->numsides = numSides;
 		bout->contents = cm.shaders[shaderNum].contentFlags;
 		bout->shaderNum = shaderNum;
+		bout->axialBounds = ( numSides >= 6 );
 
 		/* --- 6 axial sides: plane field stores a float AABB extent --- */
 		if ( numSides >= 6 ) {
@@ -744,7 +1214,7 @@ void CMod_LoadSubmodelsCod1( lump_t *l ) {
 
 	if (count < 1)
 		Com_Error (ERR_DROP, "Map with no models");
-	cm.cmodels = Hunk_Alloc( count * sizeof( *cm.cmodels ), h_high );
+	cm.cmodels = CM_Alloc( count * sizeof( *cm.cmodels ) );
 	cm.numSubModels = count;
 
 	if ( count > MAX_SUBMODELS ) {
@@ -767,7 +1237,7 @@ void CMod_LoadSubmodelsCod1( lump_t *l ) {
 
 		// make a "leaf" just to hold the model's brushes and surfaces
 		out->leaf.numLeafBrushes = LittleLong( in->numBrushes );
-		indexes = Hunk_Alloc( out->leaf.numLeafBrushes * 4, h_high );
+		indexes = CM_Alloc( out->leaf.numLeafBrushes * 4 );
 		out->leaf.firstLeafBrush = indexes - cm.leafbrushes;
 		for ( j = 0 ; j < out->leaf.numLeafBrushes ; j++ ) {
 			indexes[j] = LittleLong( in->firstBrush ) + j;
@@ -780,6 +1250,567 @@ void CMod_LoadSubmodelsCod1( lump_t *l ) {
 	}
 }
 
+/*
+=================
+CMod_BuildSoupTree_r
+
+Splits soupPatches[first..first+count) at the median centroid of the
+longest axis until each leaf node holds two patches or fewer.
+=================
+*/
+static int cm_soupSortAxis;
+
+static int CMod_SoupPatchCompare( const void *a, const void *b ) {
+	const cSoupPatch_t *pa = a;
+	const cSoupPatch_t *pb = b;
+	float ca = pa->bounds[0][cm_soupSortAxis] + pa->bounds[1][cm_soupSortAxis];
+	float cb = pb->bounds[0][cm_soupSortAxis] + pb->bounds[1][cm_soupSortAxis];
+
+	if ( ca < cb )
+		return -1;
+	return ca > cb;
+}
+
+static int CMod_BuildSoupTree_r( int first, int count ) {
+	cSoupNode_t *node;
+	vec3_t       size;
+	int          i, num, half;
+
+	num  = cm.numSoupNodes++;
+	node = &cm.soupNodes[num];
+
+	ClearBounds( node->bounds[0], node->bounds[1] );
+	for ( i = 0; i < count; i++ ) {
+		AddPointToBounds( cm.soupPatches[first + i].bounds[0], node->bounds[0], node->bounds[1] );
+		AddPointToBounds( cm.soupPatches[first + i].bounds[1], node->bounds[0], node->bounds[1] );
+	}
+
+	if ( count <= 2 ) {
+		node->children[0] = node->children[1] = -1;
+		node->firstPatch  = first;
+		node->numPatches  = count;
+		return num;
+	}
+
+	VectorSubtract( node->bounds[1], node->bounds[0], size );
+	cm_soupSortAxis = ( size[0] >= size[1] && size[0] >= size[2] ) ? 0 : ( size[1] >= size[2] ) ? 1 : 2;
+	qsort( cm.soupPatches + first, count, sizeof( *cm.soupPatches ), CMod_SoupPatchCompare );
+
+	half = count / 2;
+	node->firstPatch = 0;
+	node->numPatches = 0;
+	i = CMod_BuildSoupTree_r( first, half );
+	cm.soupNodes[num].children[0] = i;
+	i = CMod_BuildSoupTree_r( first + half, count - half );
+	cm.soupNodes[num].children[1] = i;
+	return num;
+}
+
+/*
+=================
+CMod_BuildBrushTree_r
+
+Same split as CMod_BuildSoupTree_r, over brushTreeItems[first..first+count)
+until each leaf node holds MAX_BRUSH_TREE_ITEMS or fewer.
+=================
+*/
+static int CMod_BrushTreeItemCompare( const void *a, const void *b ) {
+	const cBrushTreeItem_t *ia = a;
+	const cBrushTreeItem_t *ib = b;
+	float ca = ia->bounds[0][cm_soupSortAxis] + ia->bounds[1][cm_soupSortAxis];
+	float cb = ib->bounds[0][cm_soupSortAxis] + ib->bounds[1][cm_soupSortAxis];
+
+	if ( ca < cb )
+		return -1;
+	return ca > cb;
+}
+
+static int CMod_BuildBrushTree_r( int first, int count ) {
+	cBrushTreeNode_t *node;
+	cBrushTreeItem_t *item;
+	vec3_t            size;
+	int               i, num, half;
+
+	num  = cm.numBrushTreeNodes++;
+	node = &cm.brushTreeNodes[num];
+
+	ClearBounds( node->bounds[0], node->bounds[1] );
+	node->contents = 0;
+	for ( i = 0, item = cm.brushTreeItems + first; i < count; i++, item++ ) {
+		AddPointToBounds( item->bounds[0], node->bounds[0], node->bounds[1] );
+		AddPointToBounds( item->bounds[1], node->bounds[0], node->bounds[1] );
+		node->contents |= item->brush ? item->brush->contents : item->patch->contents;
+	}
+
+	if ( count <= MAX_BRUSH_TREE_ITEMS ) {
+		node->axis        = 0;
+		node->children[0] = node->children[1] = -1;
+		node->firstItem   = first;
+		node->numItems    = count;
+		return num;
+	}
+
+	VectorSubtract( node->bounds[1], node->bounds[0], size );
+	cm_soupSortAxis = ( size[0] >= size[1] && size[0] >= size[2] ) ? 0 : ( size[1] >= size[2] ) ? 1 : 2;
+	qsort( cm.brushTreeItems + first, count, sizeof( *cm.brushTreeItems ), CMod_BrushTreeItemCompare );
+
+	half = count / 2;
+	node->axis      = cm_soupSortAxis;
+	node->firstItem = 0;
+	node->numItems  = 0;
+	i = CMod_BuildBrushTree_r( first, half );
+	cm.brushTreeNodes[num].children[0] = i;
+	i = CMod_BuildBrushTree_r( first + half, count - half );
+	cm.brushTreeNodes[num].children[1] = i;
+	return num;
+}
+
+/*
+=================
+CM_BuildBrushTree
+
+Gathers every brush and patch referenced by the world leafs, once each,
+and builds the tree the world traces descend
+=================
+*/
+static void CM_BuildBrushTree( void ) {
+	cLeaf_t          *leaf;
+	cbrush_t         *b;
+	cPatch_t         *patch;
+	cBrushTreeItem_t *item;
+	int               i, k, num, pass, brushnum;
+
+	cm.numBrushTreeItems = 0;
+	cm.numBrushTreeNodes = 0;
+
+	// count on the first pass, fill in on the second, with checkcount
+	// marking what has already been taken from another leaf
+	item = NULL;
+	for ( pass = 0; pass < 2; pass++ ) {
+		cm.checkcount++;
+		num = 0;
+
+		for ( i = 0, leaf = cm.leafs; i < cm.numLeafs; i++, leaf++ ) {
+			for ( k = 0; k < leaf->numLeafBrushes; k++ ) {
+				if ( leaf->firstLeafBrush + k < 0 || leaf->firstLeafBrush + k >= cm.numLeafBrushes ) {
+					break;
+				}
+				brushnum = cm.leafbrushes[ leaf->firstLeafBrush + k ];
+				if ( brushnum < 0 || brushnum >= cm.numBrushes ) {
+					continue;
+				}
+				b = &cm.brushes[brushnum];
+				if ( b->checkcount == cm.checkcount || !b->numsides ) {
+					continue;
+				}
+				b->checkcount = cm.checkcount;
+
+				if ( item ) {
+					VectorCopy( b->bounds[0], item[num].bounds[0] );
+					VectorCopy( b->bounds[1], item[num].bounds[1] );
+					item[num].brush = b;
+					item[num].patch = NULL;
+				}
+				num++;
+			}
+
+			if ( !cm.surfaces ) {
+				continue;
+			}
+			for ( k = 0; k < leaf->numLeafSurfaces; k++ ) {
+				patch = cm.surfaces[ cm.leafsurfaces[ leaf->firstLeafSurface + k ] ];
+				if ( !patch || patch->checkcount == cm.checkcount ) {
+					continue;
+				}
+				patch->checkcount = cm.checkcount;
+
+				if ( item ) {
+					VectorCopy( patch->pc->bounds[0], item[num].bounds[0] );
+					VectorCopy( patch->pc->bounds[1], item[num].bounds[1] );
+					item[num].brush = NULL;
+					item[num].patch = patch;
+				}
+				num++;
+			}
+		}
+
+		if ( !num ) {
+			return;
+		}
+		if ( !item ) {
+			item = CM_Alloc( num * sizeof( *item ) );
+		}
+	}
+
+	cm.brushTreeItems    = item;
+	cm.numBrushTreeItems = num;
+	cm.brushTreeNodes    = CM_Alloc( 2 * num * sizeof( *cm.brushTreeNodes ) );
+	CMod_BuildBrushTree_r( 0, num );
+}
+
+/*
+=================
+CMod_LoadCollisionTrisCod1
+
+Each collision leaf lists vertexCount vertexes at firstVertex in the
+CollisionVerts lump and triIndexCount u16 indexes, relative to that
+vertex range, at firstTriIndex in the index array packed into the same
+lump after the vertex data.  Triangles are grouped into patches of up to
+MAX_SOUP_PATCH_TRIANGLES with a shared material so traces can use the
+patch collision code.  Anything inconsistent leaves the map with brush
+collision only.
+=================
+*/
+static void CMod_LoadCollisionTrisCod1( lump_t *leafl, lump_t *vertl ) {
+	const cod1_collision_leaf_t *in;
+	const float                 *verts;
+	const unsigned short        *indexes;
+	vec3_t                       points[MAX_SOUP_PATCH_TRIANGLES * 3];
+	cSoupPatch_t                *patch;
+	int                          numLeafs, numVerts, numIndexes, numPatches;
+	int                          i, j, k, v;
+
+	if ( !leafl->filelen || leafl->filelen % sizeof( *in ) )
+		return;
+
+	in       = (const cod1_collision_leaf_t *)( cmod_base + leafl->fileofs );
+	numLeafs = leafl->filelen / sizeof( *in );
+
+	numVerts   = 0;
+	numPatches = 0;
+	for ( i = 0; i < numLeafs; i++ ) {
+		int last = LittleLong( in[i].firstVertex ) + (unsigned short)LittleShort( in[i].vertexCount );
+		if ( last > numVerts )
+			numVerts = last;
+		numPatches += ( (unsigned short)LittleShort( in[i].triIndexCount ) / 3 + MAX_SOUP_PATCH_TRIANGLES - 1 )
+			/ MAX_SOUP_PATCH_TRIANGLES;
+	}
+
+	if ( numVerts * (int)sizeof( vec3_t ) > vertl->filelen ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: CMod_LoadCollisionTrisCod1: collision vertexes out of range\n" );
+		return;
+	}
+
+	verts      = (const float *)( cmod_base + vertl->fileofs );
+	indexes    = (const unsigned short *)( verts + numVerts * 3 );
+	numIndexes = ( vertl->filelen - numVerts * sizeof( vec3_t ) ) / sizeof( *indexes );
+
+	for ( i = 0; i < numLeafs; i++ ) {
+		int first = LittleLong( in[i].firstTriIndex );
+		int count = (unsigned short)LittleShort( in[i].triIndexCount );
+		int vcnt  = (unsigned short)LittleShort( in[i].vertexCount );
+
+		if ( first < 0 || count % 3 || first + count > numIndexes ) {
+			Com_Printf( S_COLOR_YELLOW "WARNING: CMod_LoadCollisionTrisCod1: bad triangles in leaf %d\n", i );
+			return;
+		}
+		for ( j = 0; j < count; j++ ) {
+			if ( (unsigned short)LittleShort( indexes[first + j] ) >= vcnt ) {
+				Com_Printf( S_COLOR_YELLOW "WARNING: CMod_LoadCollisionTrisCod1: bad vertex index in leaf %d\n", i );
+				return;
+			}
+		}
+	}
+
+	if ( !numPatches )
+		return;
+
+	cm.soupPatches = CM_Alloc( numPatches * sizeof( *cm.soupPatches ) );
+	patch = cm.soupPatches;
+
+	for ( i = 0; i < numLeafs; i++, in++ ) {
+		int shaderNum = (unsigned short)LittleShort( in->materialIndex );
+		int firstVert = LittleLong( in->firstVertex );
+		int first     = LittleLong( in->firstTriIndex );
+		int numTris   = (unsigned short)LittleShort( in->triIndexCount ) / 3;
+		int contents, surfaceFlags;
+
+		if ( shaderNum < cm.numShaders ) {
+			contents     = cm.shaders[shaderNum].contentFlags;
+			surfaceFlags = cm.shaders[shaderNum].surfaceFlags;
+		} else {
+			contents     = CONTENTS_SOLID;
+			surfaceFlags = 0;
+		}
+
+		if ( !contents )
+			continue;
+
+		for ( j = 0; j < numTris; j += MAX_SOUP_PATCH_TRIANGLES ) {
+			int tris = numTris - j < MAX_SOUP_PATCH_TRIANGLES ? numTris - j : MAX_SOUP_PATCH_TRIANGLES;
+
+			ClearBounds( patch->bounds[0], patch->bounds[1] );
+			for ( k = 0; k < tris * 3; k++ ) {
+				v = firstVert + (unsigned short)LittleShort( indexes[first + j * 3 + k] );
+				points[k][0] = LittleFloat( verts[v * 3 + 0] );
+				points[k][1] = LittleFloat( verts[v * 3 + 1] );
+				points[k][2] = LittleFloat( verts[v * 3 + 2] );
+				AddPointToBounds( points[k], patch->bounds[0], patch->bounds[1] );
+			}
+
+			// expand by one unit for epsilon purposes, like the patch collide
+			for ( k = 0; k < 3; k++ ) {
+				patch->bounds[0][k] -= 1;
+				patch->bounds[1][k] += 1;
+			}
+
+			patch->patch.contents     = contents;
+			patch->patch.surfaceFlags = surfaceFlags;
+			patch->patch.pc           = CM_GenerateTriangleCollide( tris, points );
+			patch++;
+		}
+	}
+
+	cm.numSoupPatches = patch - cm.soupPatches;
+	if ( !cm.numSoupPatches )
+		return;
+
+	cm.soupNodes    = CM_Alloc( 2 * cm.numSoupPatches * sizeof( *cm.soupNodes ) );
+	cm.numSoupNodes = 0;
+	CMod_BuildSoupTree_r( 0, cm.numSoupPatches );
+
+	Com_Printf( "Loaded %d collision triangle patches, %d tree nodes (CoD1)\n",
+		cm.numSoupPatches, cm.numSoupNodes );
+}
+
+/*
+=================
+CMod_LoadDoorBoundsCod1
+
+Collects the world space bounds of the func_door and func_door_rotating
+brush models, the movers that toggle area portals in the game.
+=================
+*/
+static int CMod_LoadDoorBoundsCod1( vec3_t (*doors)[2], int maxDoors ) {
+	char	*p, *token;
+	char	key[MAX_TOKEN_CHARS];
+	char	classname[MAX_QPATH];
+	vec3_t	origin;
+	int		model, numDoors;
+
+	numDoors = 0;
+	p = cm.entityString;
+
+	while ( 1 ) {
+		token = COM_Parse( &p );
+		if ( token[0] != '{' ) {
+			break;
+		}
+
+		classname[0] = '\0';
+		model = 0;
+		VectorClear( origin );
+
+		while ( 1 ) {
+			token = COM_Parse( &p );
+			if ( !token[0] || token[0] == '}' ) {
+				break;
+			}
+			Q_strncpyz( key, token, sizeof( key ) );
+			token = COM_Parse( &p );
+
+			if ( !Q_stricmp( key, "classname" ) ) {
+				Q_strncpyz( classname, token, sizeof( classname ) );
+			} else if ( !Q_stricmp( key, "model" ) && token[0] == '*' ) {
+				model = atoi( token + 1 );
+			} else if ( !Q_stricmp( key, "origin" ) ) {
+				sscanf( token, "%f %f %f", &origin[0], &origin[1], &origin[2] );
+			}
+		}
+
+		if ( Q_stricmp( classname, "func_door" ) && Q_stricmp( classname, "func_door_rotating" ) ) {
+			continue;
+		}
+		if ( model <= 0 || model >= cm.numSubModels || numDoors == maxDoors ) {
+			continue;
+		}
+
+		// brush models are positioned by their origin, as in the game
+		VectorAdd( cm.cmodels[model].mins, origin, doors[numDoors][0] );
+		VectorAdd( cm.cmodels[model].maxs, origin, doors[numDoors][1] );
+		numDoors++;
+	}
+
+	return numDoors;
+}
+
+#define	DOOR_PORTAL_EPSILON		16
+
+/*
+=================
+CMod_PortalInDoorCod1
+
+A portal belongs to a door when its polygon lies within the door's
+closed position, give or take the frame around the doorway.
+=================
+*/
+static qboolean CMod_PortalInDoorCod1( const float *verts, int numVerts, vec3_t (*doors)[2], int numDoors ) {
+	vec3_t	mins, maxs, v;
+	int		i, j;
+
+	ClearBounds( mins, maxs );
+	for ( i = 0; i < numVerts; i++ ) {
+		for ( j = 0; j < 3; j++ ) {
+			v[j] = LittleFloat( verts[i * 3 + j] );
+		}
+		AddPointToBounds( v, mins, maxs );
+	}
+
+	for ( i = 0; i < numDoors; i++ ) {
+		for ( j = 0; j < 3; j++ ) {
+			if ( mins[j] < doors[i][0][j] - DOOR_PORTAL_EPSILON || maxs[j] > doors[i][1][j] + DOOR_PORTAL_EPSILON ) {
+				break;
+			}
+		}
+		if ( j == 3 ) {
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
+
+static int CMod_FindCellCod1( int *parent, int cell ) {
+	while ( parent[cell] != cell ) {
+		parent[cell] = parent[parent[cell]];
+		cell = parent[cell];
+	}
+	return cell;
+}
+
+/*
+=================
+CMod_BuildAreasCod1
+
+The area numbers in CoD1 leafs don't separate anything, so areas are
+rebuilt from the portal cells instead. Cells joined by an open portal
+flood into one area, while portals covered by a door separate areas the
+way q3map areaportals do, and the door opens and closes them through
+CM_AdjustAreaPortalState. Returns qfalse to keep the leaf areas when the
+cell data is unusable.
+=================
+*/
+static qboolean CMod_BuildAreasCod1( const byte *base, const cod1_dleaf_t *leafs ) {
+	lump_t				cell_l, port_l, vert_l;
+	const cod1_cell_t	*cells;
+	const cod1_portal_t	*portals;
+	const float			*verts;
+	vec3_t				(*doors)[2];
+	int					*parent, *cellArea;
+	int					numCells, numPortals, numVerts, numDoors, numDoorPortals, numAreas;
+	int					i, j, first, count, dest, cell, a, b;
+
+	cell_l = CM_GetCod1Lump( base, COD1_LUMP_CELLS );
+	port_l = CM_GetCod1Lump( base, COD1_LUMP_PORTALS );
+	vert_l = CM_GetCod1Lump( base, COD1_LUMP_PORTALVERTS );
+
+	if ( !cell_l.filelen || cell_l.filelen % sizeof( cod1_cell_t ) ||
+		port_l.filelen % sizeof( cod1_portal_t ) || vert_l.filelen % sizeof( vec3_t ) ) {
+		Com_DPrintf( "CMod_BuildAreasCod1: no usable cell data\n" );
+		return qfalse;
+	}
+
+	numCells   = cell_l.filelen / sizeof( cod1_cell_t );
+	numPortals = port_l.filelen / sizeof( cod1_portal_t );
+	numVerts   = vert_l.filelen / sizeof( vec3_t );
+
+	cells   = (const cod1_cell_t *)( base + cell_l.fileofs );
+	portals = (const cod1_portal_t *)( base + port_l.fileofs );
+	verts   = (const float *)( base + vert_l.fileofs );
+
+	for ( i = 0; i < numCells; i++ ) {
+		first = LittleLong( cells[i].firstPortal );
+		count = LittleLong( cells[i].portalCount );
+		if ( first < 0 || count < 0 || first + count > numPortals ) {
+			Com_Printf( S_COLOR_YELLOW "WARNING: CMod_BuildAreasCod1: bad portal range in cell %d\n", i );
+			return qfalse;
+		}
+	}
+
+	for ( i = 0; i < numPortals; i++ ) {
+		dest  = LittleLong( portals[i].cellIndex );
+		first = LittleLong( portals[i].firstPortalVertex );
+		count = LittleLong( portals[i].portalVertexCount );
+		if ( dest < 0 || dest >= numCells || first < 0 || count < 3 || first + count > numVerts ) {
+			Com_Printf( S_COLOR_YELLOW "WARNING: CMod_BuildAreasCod1: bad portal %d\n", i );
+			return qfalse;
+		}
+	}
+
+	// every leaf that can hold something has to be in a cell
+	for ( i = 0; i < cm.numLeafs; i++ ) {
+		cell = LittleLong( leafs[i].cellNum );
+		if ( cm.leafs[i].cluster != -1 && ( cell < 0 || cell >= numCells ) ) {
+			Com_DPrintf( "CMod_BuildAreasCod1: leaf %d has no cell\n", i );
+			return qfalse;
+		}
+	}
+
+	parent   = Hunk_AllocateTempMemory( numCells * 2 * sizeof( *parent ) );
+	cellArea = parent + numCells;
+	doors    = Hunk_AllocateTempMemory( ( cm.numSubModels + 1 ) * sizeof( *doors ) );
+	numDoors = CMod_LoadDoorBoundsCod1( doors, cm.numSubModels );
+
+	// join the cells of every open portal, keeping the lowest cell as root
+	for ( i = 0; i < numCells; i++ ) {
+		parent[i] = i;
+	}
+
+	numDoorPortals = 0;
+	for ( i = 0; i < numCells; i++ ) {
+		first = LittleLong( cells[i].firstPortal );
+		count = LittleLong( cells[i].portalCount );
+
+		for ( j = first; j < first + count; j++ ) {
+			if ( CMod_PortalInDoorCod1( verts + LittleLong( portals[j].firstPortalVertex ) * 3,
+				LittleLong( portals[j].portalVertexCount ), doors, numDoors ) ) {
+				numDoorPortals++;
+				continue;
+			}
+
+			a = CMod_FindCellCod1( parent, i );
+			b = CMod_FindCellCod1( parent, LittleLong( portals[j].cellIndex ) );
+			if ( a < b ) {
+				parent[b] = a;
+			} else if ( b < a ) {
+				parent[a] = b;
+			}
+		}
+	}
+
+	// roots come first in their set, so their area is known by then
+	numAreas = 0;
+	for ( i = 0; i < numCells; i++ ) {
+		a = CMod_FindCellCod1( parent, i );
+		if ( a == i ) {
+			cellArea[i] = numAreas++;
+		} else {
+			cellArea[i] = cellArea[a];
+		}
+	}
+
+	if ( numAreas <= MAX_MAP_AREAS ) {
+		for ( i = 0; i < cm.numLeafs; i++ ) {
+			cell = LittleLong( leafs[i].cellNum );
+			cm.leafs[i].area = ( cell >= 0 && cell < numCells ) ? cellArea[cell] : -1;
+		}
+		cm.numAreas = numAreas;
+	}
+
+	Hunk_FreeTempMemory( doors );
+	Hunk_FreeTempMemory( parent );
+
+	if ( numAreas > MAX_MAP_AREAS ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: CMod_BuildAreasCod1: %d areas, max is %d\n", numAreas, MAX_MAP_AREAS );
+		return qfalse;
+	}
+
+	Com_Printf( "CoD1 CM: %d cells, %d doors, %d door portals, %d areas\n",
+		numCells, numDoors, numDoorPortals, numAreas );
+
+	return qtrue;
+}
+
 /*
 =================
 CM_LoadMapCod1
@@ -791,8 +1822,6 @@ static void CM_LoadMapCod1( const byte *base, int length, int *checksum ) {
 	lump_t             shaders_l, planes_l, nodes_l, entities_l, vis_l;
 	const cod1_dleaf_t *leafs_in;
 	int                 num_leafs;
-	int                 i;
-	byte               *visBuf;
 
 	*checksum = LittleLong( Com_BlockChecksum( base, length ) );
 
@@ -837,6 +1866,13 @@ static void CM_LoadMapCod1( const byte *base, int length, int *checksum ) {
 		CMod_LoadBrushesAndSidesCod1( &b_l, &bs_l );
 	}
 
+	/* --- Collision triangles (lumps 25/26): terrain and curved geometry --- */
+	{
+		lump_t cl_l = CM_GetCod1Lump( base, COD1_LUMP_COLLISIONAABBS );
+		lump_t cv_l = CM_GetCod1Lump( base, COD1_LUMP_COLLISIONVERTS );
+		CMod_LoadCollisionTrisCod1( &cl_l, &cv_l );
+	}
+
 	/* Leaf surfaces: lump 13 contains int32 TriangleSoup indices used by renderer;
 	   the collision model doesn't need them, but we need a valid array */
 	{
@@ -858,6 +1894,14 @@ static void CM_LoadMapCod1( const byte *base, int length, int *checksum ) {
 	entities_l = CM_GetCod1Lump( base, COD1_LUMP_ENTITIES );
 	CMod_LoadEntityString( &entities_l );
 
+	/* --- Areas from cells + portals (lumps 17/18/11), doors from the
+	   entity string and submodels --- */
+	CMod_BuildAreasCod1( base, leafs_in );
+
+	// written as the game runs, so never in a shared map
+	cm.areas      = Hunk_Alloc( cm.numAreas * sizeof( *cm.areas ), h_high );
+	cm.areaPortals = Hunk_Alloc( cm.numAreas * cm.numAreas * sizeof( *cm.areaPortals ), h_high );
+
 	/* --- Stats --- */
 	{
 		int leavesWithBrushes = 0, totalLeafBrushRefs = 0;
@@ -872,17 +1916,9 @@ static void CM_LoadMapCod1( const byte *base, int length, int *checksum ) {
 			cm.numBrushes, cm.numBrushSides, cm.numPlanes );
 	}
 
-	/* --- Visibility: skip CoD1 vis format, mark all clusters visible --- */
+	/* --- Visibility (lump 28) --- */
 	vis_l = CM_GetCod1Lump( base, COD1_LUMP_VISIBILITY );
-	if ( vis_l.filelen > 0 ) {
-		/* CoD1 vis format not yet parsed; fall back to all-visible */
-		visBuf = Hunk_Alloc( ( cm.numClusters + 31 ) & ~31, h_high );
-		Com_Memset( visBuf, 0xff, ( cm.numClusters + 31 ) & ~31 );
-		cm.clusterBytes = ( cm.numClusters + 7 ) & ~7;
-		cm.visibility   = visBuf;
-	} else {
-		CMod_LoadVisibility( &vis_l );   /* handles zero-length case */
-	}
+	CMod_LoadVisibilityCod1( &vis_l );
 }
 
 //==================================================================
@@ -933,6 +1969,10 @@ void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
 	cm_noAreas = Cvar_Get ("cm_noAreas", "0", CVAR_CHEAT);
 	cm_noCurves = Cvar_Get ("cm_noCurves", "0", CVAR_CHEAT);
 	cm_playerCurveClip = Cvar_Get ("cm_playerCurveClip", "1", CVAR_ARCHIVE|CVAR_CHEAT );
+	cm_shareMaps = Cvar_Get( "cm_shareMaps", "1", CVAR_ARCHIVE );
+	Cvar_SetDescription( cm_shareMaps, "Share the collision data of a map with other dedicated servers on the host that load the same file" );
+	cm_patchCache = Cvar_Get( "cm_patchCache", "1", CVAR_ARCHIVE );
+	Cvar_SetDescription( cm_patchCache, "Keep the curve collision data of Q3 maps the server loads in cache/patches so later loads skip building it" );
 #endif
 	Com_DPrintf( "CM_LoadMap( %s, %i )\n", name, clientload );
 
@@ -944,12 +1984,19 @@ void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
 	// free old stuff
 	Com_Memset( &cm, 0, sizeof( cm ) );
 	CM_ClearLevelPatches();
+#ifndef BSPC
+	CM_ReleaseShared();
+	// unless it is this map, preloaded by the server
+	if ( !FS_HoldingFile( name ) ) {
+		FS_ReleaseHeldFile();
+	}
+#endif
 
 	if ( !name[0] ) {
 		cm.numLeafs = 1;
 		cm.numClusters = 1;
 		cm.numAreas = 1;
-		cm.cmodels = Hunk_Alloc( sizeof( *cm.cmodels ), h_high );
+		cm.cmodels = CM_Alloc( sizeof( *cm.cmodels ) );
 		*checksum = 0;
 		return;
 	}
@@ -958,7 +2005,7 @@ void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
 	// load the file
 	//
 #ifndef BSPC
-	length = FS_ReadFile( name, &buf.v );
+	length = FS_MapFile( name, &buf.v );
 #else
 	length = LoadQuakeFile((quakefile_t *) name, &buf.v);
 #endif
@@ -970,6 +2017,18 @@ void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
 	last_checksum = LittleLong (Com_BlockChecksum (buf.i, length));
 	*checksum = last_checksum;
 
+#ifndef BSPC
+	if ( !clientload && com_dedicated->integer && cm_shareMaps->integer ) {
+		if ( CM_AttachShared( last_checksum, length, &last_checksum ) ) {
+			FS_UnmapFile( buf.v );
+			*checksum = last_checksum;
+			Q_strncpyz( cm.name, name, sizeof( cm.name ) );
+			return;
+		}
+		CM_BeginShared( length );
+	}
+#endif
+
 	header = *(dheader_t *)buf.i;
 	for (i=0 ; i<sizeof(dheader_t)/4 ; i++) {
 		((int *)&header)[i] = LittleLong ( ((int *)&header)[i]);
@@ -979,7 +2038,13 @@ void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
 		/* CoD1 / CoDUO IBSP version 59 */
 		CM_LoadMapCod1( (byte *)buf.i, length, &last_checksum );
 		*checksum = last_checksum;
-		FS_FreeFile( buf.v );
+#ifndef BSPC
+		// the renderer reads the same file next, let it skip the pak
+		if ( com_cl_running && com_cl_running->integer && !com_dedicated->integer ) {
+			FS_HoldFile( name, buf.v, length );
+		}
+#endif
+		FS_UnmapFile( buf.v );
 	} else if ( header.version != BSP_VERSION ) {
 		Com_Error (ERR_DROP, "CM_LoadMap: %s has wrong version number (%i should be %i)"
 		, name, header.version, BSP_VERSION );
@@ -998,13 +2063,22 @@ void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
 	CMod_LoadNodes (&header.lumps[LUMP_NODES]);
 	CMod_LoadEntityString (&header.lumps[LUMP_ENTITIES]);
 	CMod_LoadVisibility( &header.lumps[LUMP_VISIBILITY] );
-	CMod_LoadPatches( &header.lumps[LUMP_SURFACES], &header.lumps[LUMP_DRAWVERTS] );
+#ifndef BSPC
+	// clients may be pure, which hides loose files, so only servers cache
+	CMod_LoadPatches( &header.lumps[LUMP_SURFACES], &header.lumps[LUMP_DRAWVERTS],
+		last_checksum, !clientload && cm_patchCache->integer );
+#else
+	CMod_LoadPatches( &header.lumps[LUMP_SURFACES], &header.lumps[LUMP_DRAWVERTS], last_checksum, qfalse );
+#endif
 
 	// we are NOT freeing the file, because it is cached for the ref
-	FS_FreeFile (buf.v);
+	FS_UnmapFile (buf.v);
 	}
 
-	CM_InitBoxHull ();
+	CM_BuildBrushPlanes ();
+
+	CM_BuildBrushTree ();
+
 
 	CM_FloodAreaConnections ();
 
@@ -1012,6 +2086,10 @@ void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
 	if ( !clientload ) {
 		Q_strncpyz( cm.name, name, sizeof( cm.name ) );
 	}
+
+#ifndef BSPC
+	CM_PublishShared( last_checksum );
+#endif
 }
 
 /*
@@ -1022,6 +2100,25 @@ CM_ClearMap
 void CM_ClearMap( void ) {
 	Com_Memset( &cm, 0, sizeof( cm ) );
 	CM_ClearLevelPatches();
+#ifndef BSPC
+	CM_ReleaseShared();
+#endif
+}
+
+/*
+==================
+CM_UnpublishMap
+
+Stops offering the map to other processes, this one keeps using it
+==================
+*/
+void CM_UnpublishMap( void ) {
+#ifndef BSPC
+	if ( cm_shared.published ) {
+		Sys_RemoveSharedMemory( cm_shared.name );
+		cm_shared.published = qfalse;
+	}
+#endif
 }
 
 /*
@@ -1037,7 +2134,7 @@ cmodel_t	*CM_ClipHandleToModel( clipHandle_t handle ) {
 		return &cm.cmodels[handle];
 	}
 	if ( handle == BOX_MODEL_HANDLE ) {
-		return &box_model;
+		return &cm_boxHull.model;
 	}
 	if ( handle < MAX_SUBMODELS ) {
 		Com_Error( ERR_DROP, "CM_ClipHandleToModel: bad handle %i < %i < %i", 
@@ -1095,46 +2192,42 @@ int		CM_LeafArea( int leafnum ) {
 ===================
 CM_InitBoxHull
 
-Set up the planes and nodes so that the six floats of a bounding box
-can just be stored out and get a proper clipping hull structure.
+Set up the planes so that the six floats of a bounding box can just be
+stored out and get a proper clipping hull structure.  The hull lives
+outside the map arrays, one per thread, so that traces against entity
+boxes can run from several threads at once.
 ===================
 */
-void CM_InitBoxHull (void)
+static void CM_InitBoxHull (void)
 {
 	int			i;
 	int			side;
 	cplane_t	*p;
 	cbrushside_t	*s;
+	cbrush_t	*b;
 
-	box_planes = &cm.planes[cm.numPlanes];
-
-	box_brush = &cm.brushes[cm.numBrushes];
-	box_brush->numsides = 6;
-	box_brush->sides = cm.brushsides + cm.numBrushSides;
-	box_brush->contents = CONTENTS_BODY;
-
-	box_model.leaf.numLeafBrushes = 1;
-//	box_model.leaf.firstLeafBrush = cm.numBrushes;
-	box_model.leaf.firstLeafBrush = cm.numLeafBrushes;
-	cm.leafbrushes[cm.numLeafBrushes] = cm.numBrushes;
+	b = &cm_boxHull.brush;
+	b->numsides = 6;
+	b->sides = cm_boxHull.sides;
+	b->contents = CONTENTS_BODY;
 
 	for (i=0 ; i<6 ; i++)
 	{
 		side = i&1;
 
 		// brush sides
-		s = &cm.brushsides[cm.numBrushSides+i];
-		s->plane = 	cm.planes + (cm.numPlanes+i*2+side);
+		s = &cm_boxHull.sides[i];
+		s->plane = 	&cm_boxHull.planes[i*2+side];
 		s->surfaceFlags = 0;
 
 		// planes
-		p = &box_planes[i*2];
+		p = &cm_boxHull.planes[i*2];
 		p->type = i>>1;
 		p->signbits = 0;
 		VectorClear (p->normal);
 		p->normal[i>>1] = 1;
 
-		p = &box_planes[i*2+1];
+		p = &cm_boxHull.planes[i*2+1];
 		p->type = 3 + (i>>1);
 		p->signbits = 0;
 		VectorClear (p->normal);
@@ -1154,29 +2247,35 @@ Capsules are handled differently though.
 ===================
 */
 clipHandle_t CM_TempBoxModel( const vec3_t mins, const vec3_t maxs, int capsule ) {
+	cplane_t	*planes;
+
+	if ( !cm_boxHull.brush.sides ) {
+		CM_InitBoxHull();
+	}
 
-	VectorCopy( mins, box_model.mins );
-	VectorCopy( maxs, box_model.maxs );
+	VectorCopy( mins, cm_boxHull.model.mins );
+	VectorCopy( maxs, cm_boxHull.model.maxs );
 
 	if ( capsule ) {
 		return CAPSULE_MODEL_HANDLE;
 	}
 
-	box_planes[0].dist = maxs[0];
-	box_planes[1].dist = -maxs[0];
-	box_planes[2].dist = mins[0];
-	box_planes[3].dist = -mins[0];
-	box_planes[4].dist = maxs[1];
-	box_planes[5].dist = -maxs[1];
-	box_planes[6].dist = mins[1];
-	box_planes[7].dist = -mins[1];
-	box_planes[8].dist = maxs[2];
-	box_planes[9].dist = -maxs[2];
-	box_planes[10].dist = mins[2];
-	box_planes[11].dist = -mins[2];
-
-	VectorCopy( mins, box_brush->bounds[0] );
-	VectorCopy( maxs, box_brush->bounds[1] );
+	planes = cm_boxHull.planes;
+	planes[0].dist = maxs[0];
+	planes[1].dist = -maxs[0];
+	planes[2].dist = mins[0];
+	planes[3].dist = -mins[0];
+	planes[4].dist = maxs[1];
+	planes[5].dist = -maxs[1];
+	planes[6].dist = mins[1];
+	planes[7].dist = -mins[1];
+	planes[8].dist = maxs[2];
+	planes[9].dist = -maxs[2];
+	planes[10].dist = mins[2];
+	planes[11].dist = -mins[2];
+
+	VectorCopy( mins, cm_boxHull.brush.bounds[0] );
+	VectorCopy( maxs, cm_boxHull.brush.bounds[1] );
 
 	return BOX_MODEL_HANDLE;
 }
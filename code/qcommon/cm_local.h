@@ -56,24 +56,70 @@ typedef struct {
 	int			shaderNum;
 } cbrushside_t;
 
+// the planes of brush sides past the first six, four to a block so the
+// box tests in cm_trace.c can run them side by side; unused lanes are zero
+typedef struct {
+	float		normal[3][4];
+	float		dist[4];
+} cbrushPlanes4_t;
+
 typedef struct {
 	int			shaderNum;		// the shader that determined the contents
 	int			contents;
 	vec3_t		bounds[2];
 	int			numsides;
 	cbrushside_t	*sides;
-	int			checkcount;		// to avoid repeated testings
+	cbrushPlanes4_t	*planes4;	// sides 6 and up, NULL if numsides <= 6
+	int			checkcount;		// dedupes leafs while the brush tree is built
+	qboolean	axialBounds;	// sides 0-5 are -x +x -y +y -z +z at bounds
 } cbrush_t;
 
 
 typedef struct {
-	int			checkcount;				// to avoid repeated testings
+	int			checkcount;				// dedupes leafs while the brush tree is built
 	int			surfaceFlags;
 	int			contents;
 	struct patchCollide_s	*pc;
 } cPatch_t;
 
 
+// CoD1 collision triangles are grouped into small patches, and an AABB
+// tree over those patches keeps traces to the triangles they can reach
+#define	MAX_SOUP_PATCH_TRIANGLES	4
+
+typedef struct {
+	vec3_t		bounds[2];
+	cPatch_t	patch;
+} cSoupPatch_t;
+
+typedef struct {
+	vec3_t		bounds[2];
+	int			children[2];		// -1 on leaf nodes
+	int			firstPatch;			// leaf nodes only, index into cm.soupPatches
+	int			numPatches;
+} cSoupNode_t;
+
+
+// every brush and patch of the world model sits in exactly one leaf of
+// an AABB tree, which traces descend instead of the BSP leafs
+#define	MAX_BRUSH_TREE_ITEMS		4
+
+typedef struct {
+	vec3_t		bounds[2];
+	cbrush_t	*brush;				// NULL for patches
+	cPatch_t	*patch;
+} cBrushTreeItem_t;
+
+typedef struct {
+	vec3_t		bounds[2];
+	int			contents;			// ored contents of everything below
+	int			axis;				// children[0] holds the lower half on this axis
+	int			children[2];		// -1 on leaf nodes
+	int			firstItem;			// leaf nodes only, index into cm.brushTreeItems
+	int			numItems;
+} cBrushTreeNode_t;
+
+
 typedef struct {
 	int			floodnum;
 	int			floodvalid;
@@ -124,21 +170,45 @@ typedef struct {
 	int			numSurfaces;
 	cPatch_t	**surfaces;			// non-patches will be NULL
 
+	int			numSoupPatches;
+	cSoupPatch_t	*soupPatches;	// CoD1 collision triangles
+	int			numSoupNodes;
+	cSoupNode_t	*soupNodes;			// root is node 0
+
+	int			numBrushTreeItems;
+	cBrushTreeItem_t	*brushTreeItems;
+	int			numBrushTreeNodes;
+	cBrushTreeNode_t	*brushTreeNodes;	// root is node 0, empty if there is nothing to collide with
+
 	int			floodvalid;
-	int			checkcount;					// incremented on each trace
+	int			checkcount;					// only touched at load time
 } clipMap_t;
 
+// the temp box model is a single brush kept per thread; queries never
+// write to clipMap_t, so any number of threads can trace at once
+typedef struct {
+	cmodel_t		model;
+	cbrush_t		brush;
+	cbrushside_t	sides[6];
+	cplane_t		planes[12];
+} cBoxHull_t;
+
 
 // keep 1/8 unit away to keep the position valid before network snapping
 // and to avoid various numeric issues
 #define	SURFACE_CLIP_EPSILON	(0.125)
 
 extern	clipMap_t	cm;
-extern	int			c_pointcontents;
+extern	Q_THREAD_LOCAL cBoxHull_t	cm_boxHull;
+extern	int			c_pointcontents;	// statistics, not exact when several threads trace
 extern	int			c_traces, c_brush_traces, c_patch_traces;
 extern	cvar_t		*cm_noAreas;
 extern	cvar_t		*cm_noCurves;
 extern	cvar_t		*cm_playerCurveClip;
+extern	cvar_t		*cm_shareMaps;
+extern	cvar_t		*cm_patchCache;
+
+void		*CM_Alloc( int size );
 
 // cm_test.c
 
@@ -191,6 +261,7 @@ qboolean CM_BoundsIntersectPoint( const vec3_t mins, const vec3_t maxs, const ve
 // cm_patch.c
 
 struct patchCollide_s	*CM_GeneratePatchCollide( int width, int height, vec3_t *points );
+struct patchCollide_s	*CM_GenerateTriangleCollide( int numTriangles, vec3_t *points );
 void CM_TraceThroughPatchCollide( traceWork_t *tw, const struct patchCollide_s *pc );
 qboolean CM_PositionTestInPatchCollide( traceWork_t *tw, const struct patchCollide_s *pc );
 void CM_ClearLevelPatches( void );
@@ -29,6 +29,7 @@ This file does not reference any globals, and has these entry points:
 
 void CM_ClearLevelPatches( void );
 struct patchCollide_s	*CM_GeneratePatchCollide( int width, int height, const vec3_t *points );
+struct patchCollide_s	*CM_GenerateTriangleCollide( int numTriangles, vec3_t *points );
 void CM_TraceThroughPatchCollide( traceWork_t *tw, const struct patchCollide_s *pc );
 qboolean CM_PositionTestInPatchCollide( traceWork_t *tw, const struct patchCollide_s *pc );
 void CM_DrawDebugSurface( void (*drawPoly)(int color, int numPoints, flaot *points) );
@@ -1115,9 +1116,9 @@ static void CM_PatchCollideFromGrid( cGrid_t *grid, patchCollide_t *pf ) {
 	// copy the results out
 	pf->numPlanes = numPlanes;
 	pf->numFacets = numFacets;
-	pf->facets = Hunk_Alloc( numFacets * sizeof( *pf->facets ), h_high );
+	pf->facets = CM_Alloc( numFacets * sizeof( *pf->facets ) );
 	Com_Memcpy( pf->facets, facets, numFacets * sizeof( *pf->facets ) );
-	pf->planes = Hunk_Alloc( numPlanes * sizeof( *pf->planes ), h_high );
+	pf->planes = CM_Alloc( numPlanes * sizeof( *pf->planes ) );
 	Com_Memcpy( pf->planes, planes, numPlanes * sizeof( *pf->planes ) );
 }
 
@@ -1175,7 +1176,7 @@ struct patchCollide_s	*CM_GeneratePatchCollide( int width, int height, vec3_t *p
 	// we now have a grid of points exactly on the curve
 	// the approximate surface defined by these points will be
 	// collided against
-	pf = Hunk_Alloc( sizeof( *pf ), h_high );
+	pf = CM_Alloc( sizeof( *pf ) );
 	ClearBounds( pf->bounds[0], pf->bounds[1] );
 	for ( i = 0 ; i < grid.width ; i++ ) {
 		for ( j = 0 ; j < grid.height ; j++ ) {
@@ -1200,6 +1201,90 @@ struct patchCollide_s	*CM_GeneratePatchCollide( int width, int height, vec3_t *p
 	return pf;
 }
 
+/*
+===================
+CM_GenerateTriangleCollide
+
+Creates a patch collide with one facet per triangle, for collision meshes
+that aren't bezier patches.  Points holds three vertexes per triangle and
+numTriangles must be small enough to stay well below MAX_FACETS and
+MAX_PATCH_PLANES.
+===================
+*/
+struct patchCollide_s	*CM_GenerateTriangleCollide( int numTriangles, vec3_t *points ) {
+	patchCollide_t	*pf;
+	facet_t			*facet;
+	float			*p[3];
+	vec3_t			up;
+	int				i, k, side;
+
+	if ( numTriangles <= 0 || numTriangles > MAX_FACETS || !points ) {
+		Com_Error( ERR_DROP, "CM_GenerateTriangleCollide: bad parameters: (%i, %p)",
+			numTriangles, (void *)points );
+	}
+
+	numPlanes = 0;
+	numFacets = 0;
+
+	for ( i = 0 ; i < numTriangles ; i++ ) {
+		p[0] = points[i*3+0];
+		p[1] = points[i*3+1];
+		p[2] = points[i*3+2];
+
+		facet = &facets[numFacets];
+		Com_Memset( facet, 0, sizeof( *facet ) );
+
+		facet->surfacePlane = CM_FindPlane( p[0], p[1], p[2] );
+		if ( facet->surfacePlane == -1 ) {
+			continue;		// degenerate
+		}
+
+		// one border through each edge, perpendicular to the surface
+		facet->numBorders = 3;
+		for ( k = 0 ; k < 3 ; k++ ) {
+			VectorMA( p[k], 4, planes[ facet->surfacePlane ].plane, up );
+			facet->borderPlanes[k] = CM_FindPlane( p[k], p[(k+1)%3], up );
+
+			side = CM_PointOnPlaneSide( p[(k+2)%3], facet->borderPlanes[k] );
+			if ( side == SIDE_ON ) {
+				facet->borderPlanes[k] = -1;
+			}
+			facet->borderInward[k] = ( side == SIDE_FRONT );
+		}
+
+		if ( CM_ValidateFacet( facet ) ) {
+			CM_AddFacetBevels( facet );
+			numFacets++;
+		}
+	}
+
+	pf = CM_Alloc( sizeof( *pf ) );
+	ClearBounds( pf->bounds[0], pf->bounds[1] );
+	for ( i = 0 ; i < numTriangles * 3 ; i++ ) {
+		AddPointToBounds( points[i], pf->bounds[0], pf->bounds[1] );
+	}
+
+	c_totalPatchBlocks += numTriangles;
+
+	pf->numPlanes = numPlanes;
+	pf->numFacets = numFacets;
+	pf->facets = CM_Alloc( numFacets * sizeof( *pf->facets ) );
+	Com_Memcpy( pf->facets, facets, numFacets * sizeof( *pf->facets ) );
+	pf->planes = CM_Alloc( numPlanes * sizeof( *pf->planes ) );
+	Com_Memcpy( pf->planes, planes, numPlanes * sizeof( *pf->planes ) );
+
+	// expand by one unit for epsilon purposes
+	pf->bounds[0][0] -= 1;
+	pf->bounds[0][1] -= 1;
+	pf->bounds[0][2] -= 1;
+
+	pf->bounds[1][0] += 1;
+	pf->bounds[1][1] += 1;
+	pf->bounds[1][2] += 1;
+
+	return pf;
+}
+
 /*
 ================================================================================
 
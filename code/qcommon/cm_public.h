@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 void		CM_LoadMap( const char *name, qboolean clientload, int *checksum);
 void		CM_ClearMap( void );
+void		CM_UnpublishMap( void );
 clipHandle_t CM_InlineModel( int index );		// 0 = world, 1 + are bmodels
 clipHandle_t CM_TempBoxModel( const vec3_t mins, const vec3_t maxs, int capsule );
 
@@ -64,4 +65,29 @@ qboolean	CM_AreasConnected( int area1, int area2 );
 int			CM_WriteAreaBits( byte *buffer, int area );
 
 // cm_patch.c
+// world traces written by the server's recordtraces command and replayed
+// by cmbench, in native byte order
+#define	CM_TRACELOG_IDENT	(('R'<<24)+('T'<<16)+('M'<<8)+'C')
+#define	CM_TRACELOG_VERSION	1
+
+typedef enum {
+	CMT_CONTENTS,			// point contents at start
+	CMT_TRACE				// box trace, a point trace when mins and maxs are zero
+} cmTraceType_t;
+
+typedef struct {
+	int			ident;
+	int			version;
+	char		map[MAX_QPATH];
+	int			checksum;
+} cmTraceLogHeader_t;
+
+typedef struct {
+	int			type;
+	int			contentmask;
+	int			capsule;
+	vec3_t		start, end;
+	vec3_t		mins, maxs;
+} cmTraceRecord_t;
+
 void CM_DrawDebugSurface( void (*drawPoly)(int color, int numPoints, float *points) );
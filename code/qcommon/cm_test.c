@@ -101,10 +101,14 @@ void CM_StoreBrushes( leafList_t *ll, int nodenum ) {
 	for ( k = 0 ; k < leaf->numLeafBrushes ; k++ ) {
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush+k];
 		b = &cm.brushes[brushnum];
-		if ( b->checkcount == cm.checkcount ) {
-			continue;	// already checked this brush in another leaf
+		for ( i = 0 ; i < ll->count ; i++ ) {
+			if ( ((cbrush_t **)ll->list)[i] == b ) {
+				break;	// already stored from another leaf
+			}
+		}
+		if ( i != ll->count ) {
+			continue;
 		}
-		b->checkcount = cm.checkcount;
 		for ( i = 0 ; i < 3 ; i++ ) {
 			if ( b->bounds[0][i] >= ll->bounds[1][i] || b->bounds[1][i] <= ll->bounds[0][i] ) {
 				break;
@@ -172,8 +176,6 @@ CM_BoxLeafnums
 int	CM_BoxLeafnums( const vec3_t mins, const vec3_t maxs, int *list, int listsize, int *lastLeaf) {
 	leafList_t	ll;
 
-	cm.checkcount++;
-
 	VectorCopy( mins, ll.bounds[0] );
 	VectorCopy( maxs, ll.bounds[1] );
 	ll.count = 0;
@@ -197,8 +199,6 @@ CM_BoxBrushes
 int CM_BoxBrushes( const vec3_t mins, const vec3_t maxs, cbrush_t **list, int listsize ) {
 	leafList_t	ll;
 
-	cm.checkcount++;
-
 	VectorCopy( mins, ll.bounds[0] );
 	VectorCopy( maxs, ll.bounds[1] );
 	ll.count = 0;
@@ -217,6 +217,31 @@ int CM_BoxBrushes( const vec3_t mins, const vec3_t maxs, cbrush_t **list, int li
 //====================================================================
 
 
+/*
+==================
+CM_PointInBrush
+==================
+*/
+static qboolean CM_PointInBrush( const vec3_t p, const cbrush_t *b ) {
+	int			i;
+	float		d;
+
+	if ( !CM_BoundsIntersectPoint( b->bounds[0], b->bounds[1], p ) ) {
+		return qfalse;
+	}
+
+	for ( i = 0 ; i < b->numsides ; i++ ) {
+		d = DotProduct( p, b->sides[i].plane->normal );
+// FIXME test for Cash
+//		if ( d >= b->sides[i].plane->dist ) {
+		if ( d > b->sides[i].plane->dist ) {
+			return qfalse;
+		}
+	}
+
+	return qtrue;
+}
+
 /*
 ==================
 CM_PointContents
@@ -225,18 +250,22 @@ CM_PointContents
 */
 int CM_PointContents( const vec3_t p, clipHandle_t model ) {
 	int			leafnum;
-	int			i, k;
+	int			k;
 	int			brushnum;
 	cLeaf_t		*leaf;
 	cbrush_t	*b;
 	int			contents;
-	float		d;
 	cmodel_t	*clipm;
 
 	if (!cm.numNodes) {	// map not loaded
 		return 0;
 	}
 
+	if ( model == BOX_MODEL_HANDLE ) {
+		b = &cm_boxHull.brush;
+		return CM_PointInBrush( p, b ) ? b->contents : 0;
+	}
+
 	if ( model ) {
 		clipm = CM_ClipHandleToModel( model );
 		leaf = &clipm->leaf;
@@ -250,21 +279,7 @@ int CM_PointContents( const vec3_t p, clipHandle_t model ) {
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush+k];
 		b = &cm.brushes[brushnum];
 
-		if ( !CM_BoundsIntersectPoint( b->bounds[0], b->bounds[1], p ) ) {
-			continue;
-		}
-
-		// see if the point is in the brush
-		for ( i = 0 ; i < b->numsides ; i++ ) {
-			d = DotProduct( p, b->sides[i].plane->normal );
-// FIXME test for Cash
-//			if ( d >= b->sides[i].plane->dist ) {
-			if ( d > b->sides[i].plane->dist ) {
-				break;
-			}
-		}
-
-		if ( i == b->numsides ) {
+		if ( CM_PointInBrush( p, b ) ) {
 			contents |= b->contents;
 		}
 	}
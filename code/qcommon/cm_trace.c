@@ -21,6 +21,14 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 #include "cm_local.h"
 
+#if idx64 || defined( __SSE__ )
+#include <xmmintrin.h>
+#define CM_SSE
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#include <arm_neon.h>
+#define CM_NEON
+#endif
+
 // always use bbox vs. bbox collision and never capsule vs. bbox or vice versa
 //#define ALWAYS_BBOX_VS_BBOX
 // always use capsule vs. capsule collision and never capsule vs. bbox or vice versa
@@ -153,6 +161,95 @@ POSITION TESTING
 ===============================================================================
 */
 
+/*
+================
+CM_BoxPlaneDists4
+
+Distances of the box start and end points in front of four brush
+planes. Uses the same operations in the same order as the scalar
+plane->dist - DotProduct( tw->offsets[ plane->signbits ], plane->normal )
+so the results match it exactly. d2 may be NULL.
+================
+*/
+static ID_INLINE void CM_BoxPlaneDists4( const traceWork_t *tw, const cbrushPlanes4_t *p, float *d1, float *d2 ) {
+#if defined( CM_SSE )
+	__m128	nx, ny, nz, mask, ox, oy, oz, dist, zero;
+
+	nx = _mm_loadu_ps( p->normal[0] );
+	ny = _mm_loadu_ps( p->normal[1] );
+	nz = _mm_loadu_ps( p->normal[2] );
+	zero = _mm_setzero_ps();
+
+	// offsets[signbits] takes size[1] on the axes the normal points down
+	mask = _mm_cmplt_ps( nx, zero );
+	ox = _mm_or_ps( _mm_and_ps( mask, _mm_set1_ps( tw->size[1][0] ) ), _mm_andnot_ps( mask, _mm_set1_ps( tw->size[0][0] ) ) );
+	mask = _mm_cmplt_ps( ny, zero );
+	oy = _mm_or_ps( _mm_and_ps( mask, _mm_set1_ps( tw->size[1][1] ) ), _mm_andnot_ps( mask, _mm_set1_ps( tw->size[0][1] ) ) );
+	mask = _mm_cmplt_ps( nz, zero );
+	oz = _mm_or_ps( _mm_and_ps( mask, _mm_set1_ps( tw->size[1][2] ) ), _mm_andnot_ps( mask, _mm_set1_ps( tw->size[0][2] ) ) );
+
+	dist = _mm_add_ps( _mm_add_ps( _mm_mul_ps( ox, nx ), _mm_mul_ps( oy, ny ) ), _mm_mul_ps( oz, nz ) );
+	dist = _mm_sub_ps( _mm_loadu_ps( p->dist ), dist );
+
+	_mm_storeu_ps( d1, _mm_sub_ps( _mm_add_ps( _mm_add_ps(
+		_mm_mul_ps( _mm_set1_ps( tw->start[0] ), nx ),
+		_mm_mul_ps( _mm_set1_ps( tw->start[1] ), ny ) ),
+		_mm_mul_ps( _mm_set1_ps( tw->start[2] ), nz ) ), dist ) );
+	if ( d2 ) {
+		_mm_storeu_ps( d2, _mm_sub_ps( _mm_add_ps( _mm_add_ps(
+			_mm_mul_ps( _mm_set1_ps( tw->end[0] ), nx ),
+			_mm_mul_ps( _mm_set1_ps( tw->end[1] ), ny ) ),
+			_mm_mul_ps( _mm_set1_ps( tw->end[2] ), nz ) ), dist ) );
+	}
+#elif defined( CM_NEON )
+	float32x4_t	nx, ny, nz, ox, oy, oz, dist, zero;
+
+	nx = vld1q_f32( p->normal[0] );
+	ny = vld1q_f32( p->normal[1] );
+	nz = vld1q_f32( p->normal[2] );
+	zero = vdupq_n_f32( 0 );
+
+	// offsets[signbits] takes size[1] on the axes the normal points down,
+	// and multiplies and adds are kept apart so nothing gets fused
+	ox = vbslq_f32( vcltq_f32( nx, zero ), vdupq_n_f32( tw->size[1][0] ), vdupq_n_f32( tw->size[0][0] ) );
+	oy = vbslq_f32( vcltq_f32( ny, zero ), vdupq_n_f32( tw->size[1][1] ), vdupq_n_f32( tw->size[0][1] ) );
+	oz = vbslq_f32( vcltq_f32( nz, zero ), vdupq_n_f32( tw->size[1][2] ), vdupq_n_f32( tw->size[0][2] ) );
+
+	dist = vaddq_f32( vaddq_f32( vmulq_f32( ox, nx ), vmulq_f32( oy, ny ) ), vmulq_f32( oz, nz ) );
+	dist = vsubq_f32( vld1q_f32( p->dist ), dist );
+
+	vst1q_f32( d1, vsubq_f32( vaddq_f32( vaddq_f32(
+		vmulq_n_f32( nx, tw->start[0] ),
+		vmulq_n_f32( ny, tw->start[1] ) ),
+		vmulq_n_f32( nz, tw->start[2] ) ), dist ) );
+	if ( d2 ) {
+		vst1q_f32( d2, vsubq_f32( vaddq_f32( vaddq_f32(
+			vmulq_n_f32( nx, tw->end[0] ),
+			vmulq_n_f32( ny, tw->end[1] ) ),
+			vmulq_n_f32( nz, tw->end[2] ) ), dist ) );
+	}
+#else
+	int		i;
+	float	dist;
+	vec3_t	normal, offset;
+
+	for ( i = 0 ; i < 4 ; i++ ) {
+		normal[0] = p->normal[0][i];
+		normal[1] = p->normal[1][i];
+		normal[2] = p->normal[2][i];
+		offset[0] = tw->size[normal[0] < 0][0];
+		offset[1] = tw->size[normal[1] < 0][1];
+		offset[2] = tw->size[normal[2] < 0][2];
+
+		dist = p->dist[i] - DotProduct( offset, normal );
+		d1[i] = DotProduct( tw->start, normal ) - dist;
+		if ( d2 ) {
+			d2[i] = DotProduct( tw->end, normal ) - dist;
+		}
+	}
+#endif
+}
+
 /*
 ================
 CM_TestBoxInBrush
@@ -166,6 +263,7 @@ void CM_TestBoxInBrush( traceWork_t *tw, cbrush_t *brush ) {
 	cbrushside_t	*side;
 	float		t;
 	vec3_t		startp;
+	float		d1s[4];
 
 	if (!brush->numsides) {
 		return;
@@ -209,18 +307,12 @@ void CM_TestBoxInBrush( traceWork_t *tw, cbrush_t *brush ) {
 		}
 	} else {
 		// the first six planes are the axial planes, so we only
-		// need to test the remainder
-		for ( i = 6 ; i < brush->numsides ; i++ ) {
-			side = brush->sides + i;
-			plane = side->plane;
-
-			// adjust the plane distance appropriately for mins/maxs
-			dist = plane->dist - DotProduct( tw->offsets[ plane->signbits ], plane->normal );
-
-			d1 = DotProduct( tw->start, plane->normal ) - dist;
+		// need to test the remainder, four at a time
+		for ( i = 6 ; i < brush->numsides ; i += 4 ) {
+			CM_BoxPlaneDists4( tw, brush->planes4 + ( ( i - 6 ) >> 2 ), d1s, NULL );
 
 			// if completely in front of face, no intersection
-			if ( d1 > 0 ) {
+			if ( d1s[0] > 0 || d1s[1] > 0 || d1s[2] > 0 || d1s[3] > 0 ) {
 				return;
 			}
 		}
@@ -249,10 +341,6 @@ void CM_TestInLeaf( traceWork_t *tw, cLeaf_t *leaf ) {
 	for (k=0 ; k<leaf->numLeafBrushes ; k++) {
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush+k];
 		b = &cm.brushes[brushnum];
-		if (b->checkcount == cm.checkcount) {
-			continue;	// already checked this brush in another leaf
-		}
-		b->checkcount = cm.checkcount;
 
 		if ( !(b->contents & tw->contents)) {
 			continue;
@@ -275,11 +363,6 @@ void CM_TestInLeaf( traceWork_t *tw, cLeaf_t *leaf ) {
 			if ( !patch ) {
 				continue;
 			}
-			if ( patch->checkcount == cm.checkcount ) {
-				continue;	// already checked this brush in another leaf
-			}
-			patch->checkcount = cm.checkcount;
-
 			if ( !(patch->contents & tw->contents)) {
 				continue;
 			}
@@ -294,6 +377,71 @@ void CM_TestInLeaf( traceWork_t *tw, cLeaf_t *leaf ) {
 	}
 }
 
+/*
+================
+CM_TestInModel
+
+The temp box model is not part of the map, so its brush is tested
+directly instead of through a leaf
+================
+*/
+static void CM_TestInModel( traceWork_t *tw, clipHandle_t model ) {
+	if ( model == BOX_MODEL_HANDLE ) {
+		if ( cm_boxHull.brush.contents & tw->contents ) {
+			CM_TestBoxInBrush( tw, &cm_boxHull.brush );
+		}
+		return;
+	}
+
+	CM_TestInLeaf( tw, &CM_ClipHandleToModel( model )->leaf );
+}
+
+/*
+================
+CM_TestInTriangleSoup
+
+Position test against the CoD1 collision triangles under soup node num
+================
+*/
+static void CM_TestInTriangleSoup( traceWork_t *tw, int num ) {
+	cSoupNode_t		*node;
+	cSoupPatch_t	*sp;
+	int				k;
+
+	node = &cm.soupNodes[num];
+	if ( !CM_BoundsIntersect( tw->bounds[0], tw->bounds[1], node->bounds[0], node->bounds[1] ) ) {
+		return;
+	}
+
+	if ( node->children[0] >= 0 ) {
+		CM_TestInTriangleSoup( tw, node->children[0] );
+		if ( tw->trace.allsolid ) {
+			return;
+		}
+		CM_TestInTriangleSoup( tw, node->children[1] );
+		return;
+	}
+
+	for ( k = 0 ; k < node->numPatches ; k++ ) {
+		sp = &cm.soupPatches[ node->firstPatch + k ];
+
+		if ( !(sp->patch.contents & tw->contents) ) {
+			continue;
+		}
+
+		if ( !CM_BoundsIntersect( tw->bounds[0], tw->bounds[1], sp->bounds[0], sp->bounds[1] ) ) {
+			continue;
+		}
+
+		if ( CM_PositionTestInPatchCollide( tw, sp->patch.pc ) ) {
+			tw->trace.startsolid = tw->trace.allsolid = qtrue;
+			tw->trace.fraction = 0;
+			tw->trace.contents = sp->patch.contents;
+			return;
+		}
+	}
+}
+
 /*
 ==================
 CM_TestCapsuleInCapsule
@@ -373,7 +521,6 @@ bounding box inside capsule check
 void CM_TestBoundingBoxInCapsule( traceWork_t *tw, clipHandle_t model ) {
 	vec3_t mins, maxs, offset, size[2];
 	clipHandle_t h;
-	cmodel_t *cmod;
 	int i;
 
 	// mins maxs of the capsule
@@ -397,8 +544,68 @@ void CM_TestBoundingBoxInCapsule( traceWork_t *tw, clipHandle_t model ) {
 	// replace the capsule with the bounding box
 	h = CM_TempBoxModel(tw->size[0], tw->size[1], qfalse);
 	// calculate collision
-	cmod = CM_ClipHandleToModel( h );
-	CM_TestInLeaf( tw, &cmod->leaf );
+	CM_TestInModel( tw, h );
+}
+
+/*
+================
+CM_TestInBrushTree
+
+Position test against the world brushes and patches under brush tree
+node num
+================
+*/
+static void CM_TestInBrushTree( traceWork_t *tw, int num ) {
+	cBrushTreeNode_t	*node;
+	cBrushTreeItem_t	*item;
+	int					k;
+
+	node = &cm.brushTreeNodes[num];
+	if ( !(node->contents & tw->contents) ) {
+		return;
+	}
+	if ( !CM_BoundsIntersect( tw->bounds[0], tw->bounds[1], node->bounds[0], node->bounds[1] ) ) {
+		return;
+	}
+
+	if ( node->children[0] >= 0 ) {
+		CM_TestInBrushTree( tw, node->children[0] );
+		if ( tw->trace.allsolid ) {
+			return;
+		}
+		CM_TestInBrushTree( tw, node->children[1] );
+		return;
+	}
+
+	for ( k = 0, item = cm.brushTreeItems + node->firstItem ; k < node->numItems ; k++, item++ ) {
+		if ( item->brush ) {
+			if ( !(item->brush->contents & tw->contents) ) {
+				continue;
+			}
+
+			CM_TestBoxInBrush( tw, item->brush );
+			if ( tw->trace.allsolid ) {
+				return;
+			}
+			continue;
+		}
+
+#ifndef BSPC
+		if ( cm_noCurves->integer ) {
+			continue;
+		}
+#endif
+		if ( !(item->patch->contents & tw->contents) ) {
+			continue;
+		}
+
+		if ( CM_PositionTestInPatchCollide( tw, item->patch->pc ) ) {
+			tw->trace.startsolid = tw->trace.allsolid = qtrue;
+			tw->trace.fraction = 0;
+			tw->trace.contents = item->patch->contents;
+			return;
+		}
+	}
 }
 
 /*
@@ -412,6 +619,14 @@ void CM_PositionTest( traceWork_t *tw ) {
 	int		i;
 	leafList_t	ll;
 
+	if ( cm.numBrushTreeNodes ) {
+		CM_TestInBrushTree( tw, 0 );
+		if ( cm.numSoupNodes && !tw->trace.allsolid ) {
+			CM_TestInTriangleSoup( tw, 0 );
+		}
+		return;
+	}
+
 	// identify the leafs we are touching
 	VectorAdd( tw->start, tw->size[0], ll.bounds[0] );
 	VectorAdd( tw->start, tw->size[1], ll.bounds[1] );
@@ -428,13 +643,8 @@ void CM_PositionTest( traceWork_t *tw ) {
 	ll.lastLeaf = 0;
 	ll.overflowed = qfalse;
 
-	cm.checkcount++;
-
 	CM_BoxLeafnums_r( &ll, 0 );
 
-
-	cm.checkcount++;
-
 	// test the contents of the leafs
 	for (i=0 ; i < ll.count ; i++) {
 		CM_TestInLeaf( tw, &cm.leafs[leafs[i]] );
@@ -442,6 +652,10 @@ void CM_PositionTest( traceWork_t *tw ) {
 			break;
 		}
 	}
+
+	if ( cm.numSoupNodes && !tw->trace.allsolid ) {
+		CM_TestInTriangleSoup( tw, 0 );
+	}
 }
 
 /*
@@ -480,7 +694,7 @@ CM_TraceThroughBrush
 ================
 */
 void CM_TraceThroughBrush( traceWork_t *tw, cbrush_t *brush ) {
-	int			i;
+	int			i, axis, numAxial;
 	cplane_t	*plane, *clipplane;
 	float		dist;
 	float		enterFrac, leaveFrac;
@@ -491,6 +705,7 @@ void CM_TraceThroughBrush( traceWork_t *tw, cbrush_t *brush ) {
 	float		t;
 	vec3_t		startp;
 	vec3_t		endp;
+	float		d1s[4], d2s[4];
 
 	enterFrac = -1.0;
 	leaveFrac = 1.0;
@@ -575,6 +790,9 @@ void CM_TraceThroughBrush( traceWork_t *tw, cbrush_t *brush ) {
 			}
 		}
 	} else {
+		// the axial sides of a brush that has them are plain slabs
+		numAxial = brush->axialBounds ? 6 : 0;
+
 		//
 		// compare the trace against all planes of the brush
 		// find the latest time the trace crosses a plane towards the interior
@@ -585,10 +803,30 @@ void CM_TraceThroughBrush( traceWork_t *tw, cbrush_t *brush ) {
 			plane = side->plane;
 
 			// adjust the plane distance appropriately for mins/maxs
-			dist = plane->dist - DotProduct( tw->offsets[ plane->signbits ], plane->normal );
+			if ( i < numAxial ) {
+				axis = i >> 1;
+				if ( i & 1 ) {
+					dist = brush->bounds[1][axis] - tw->size[0][axis];
+					d1 = tw->start[axis] - dist;
+					d2 = tw->end[axis] - dist;
+				} else {
+					dist = tw->size[1][axis] - brush->bounds[0][axis];
+					d1 = -tw->start[axis] - dist;
+					d2 = -tw->end[axis] - dist;
+				}
+			} else if ( i >= 6 ) {
+				// the rest of the sides are tested four at a time
+				if ( !( ( i - 6 ) & 3 ) ) {
+					CM_BoxPlaneDists4( tw, brush->planes4 + ( ( i - 6 ) >> 2 ), d1s, d2s );
+				}
+				d1 = d1s[( i - 6 ) & 3];
+				d2 = d2s[( i - 6 ) & 3];
+			} else {
+				dist = plane->dist - DotProduct( tw->offsets[ plane->signbits ], plane->normal );
 
-			d1 = DotProduct( tw->start, plane->normal ) - dist;
-			d2 = DotProduct( tw->end, plane->normal ) - dist;
+				d1 = DotProduct( tw->start, plane->normal ) - dist;
+				d2 = DotProduct( tw->end, plane->normal ) - dist;
+			}
 
 			if (d2 > 0) {
 				getout = qtrue;	// endpoint is not in solid
@@ -687,10 +925,6 @@ void CM_TraceThroughLeaf( traceWork_t *tw, cLeaf_t *leaf ) {
 		}
 
 		b = &cm.brushes[brushnum];
-		if ( b->checkcount == cm.checkcount ) {
-			continue;	// already checked this brush in another leaf
-		}
-		b->checkcount = cm.checkcount;
 
 		if ( !(b->contents & tw->contents) ) {
 			continue;
@@ -718,11 +952,6 @@ void CM_TraceThroughLeaf( traceWork_t *tw, cLeaf_t *leaf ) {
 			if ( !patch ) {
 				continue;
 			}
-			if ( patch->checkcount == cm.checkcount ) {
-				continue;	// already checked this patch in another leaf
-			}
-			patch->checkcount = cm.checkcount;
-
 			if ( !(patch->contents & tw->contents) ) {
 				continue;
 			}
@@ -735,6 +964,130 @@ void CM_TraceThroughLeaf( traceWork_t *tw, cLeaf_t *leaf ) {
 	}
 }
 
+/*
+================
+CM_TraceThroughModel
+================
+*/
+static void CM_TraceThroughModel( traceWork_t *tw, clipHandle_t model ) {
+	cbrush_t	*b;
+
+	if ( model == BOX_MODEL_HANDLE ) {
+		b = &cm_boxHull.brush;
+		if ( (b->contents & tw->contents) &&
+			CM_BoundsIntersect( tw->bounds[0], tw->bounds[1], b->bounds[0], b->bounds[1] ) ) {
+			CM_TraceThroughBrush( tw, b );
+		}
+		return;
+	}
+
+	CM_TraceThroughLeaf( tw, &CM_ClipHandleToModel( model )->leaf );
+}
+
+/*
+================
+CM_TraceThroughTriangleSoup
+
+Traces against the CoD1 collision triangles under soup node num, only
+visiting the patches whose bounds the trace overlaps
+================
+*/
+static void CM_TraceThroughTriangleSoup( traceWork_t *tw, int num ) {
+	cSoupNode_t		*node;
+	cSoupPatch_t	*sp;
+	int				k;
+
+	node = &cm.soupNodes[num];
+	if ( !CM_BoundsIntersect( tw->bounds[0], tw->bounds[1], node->bounds[0], node->bounds[1] ) ) {
+		return;
+	}
+
+	if ( node->children[0] >= 0 ) {
+		CM_TraceThroughTriangleSoup( tw, node->children[0] );
+		if ( !tw->trace.fraction ) {
+			return;
+		}
+		CM_TraceThroughTriangleSoup( tw, node->children[1] );
+		return;
+	}
+
+	for ( k = 0 ; k < node->numPatches ; k++ ) {
+		sp = &cm.soupPatches[ node->firstPatch + k ];
+
+		if ( !(sp->patch.contents & tw->contents) ) {
+			continue;
+		}
+
+		if ( !CM_BoundsIntersect( tw->bounds[0], tw->bounds[1], sp->bounds[0], sp->bounds[1] ) ) {
+			continue;
+		}
+
+		CM_TraceThroughPatch( tw, &sp->patch );
+		if ( !tw->trace.fraction ) {
+			return;
+		}
+	}
+}
+
+/*
+================
+CM_TraceThroughBrushTree
+
+Traces against the world brushes and patches under brush tree node num,
+taking the half nearer the start first so a hit can end the walk early
+================
+*/
+static void CM_TraceThroughBrushTree( traceWork_t *tw, int num ) {
+	cBrushTreeNode_t	*node;
+	cBrushTreeItem_t	*item;
+	int					k, side;
+
+	node = &cm.brushTreeNodes[num];
+	if ( !(node->contents & tw->contents) ) {
+		return;
+	}
+	if ( !CM_BoundsIntersect( tw->bounds[0], tw->bounds[1], node->bounds[0], node->bounds[1] ) ) {
+		return;
+	}
+
+	if ( node->children[0] >= 0 ) {
+		side = tw->end[node->axis] < tw->start[node->axis];
+		CM_TraceThroughBrushTree( tw, node->children[side] );
+		if ( !tw->trace.fraction ) {
+			return;
+		}
+		CM_TraceThroughBrushTree( tw, node->children[side^1] );
+		return;
+	}
+
+	for ( k = 0, item = cm.brushTreeItems + node->firstItem ; k < node->numItems ; k++, item++ ) {
+		if ( !CM_BoundsIntersect( tw->bounds[0], tw->bounds[1], item->bounds[0], item->bounds[1] ) ) {
+			continue;
+		}
+
+		if ( item->brush ) {
+			if ( !(item->brush->contents & tw->contents) ) {
+				continue;
+			}
+			CM_TraceThroughBrush( tw, item->brush );
+		} else {
+#ifndef BSPC
+			if ( cm_noCurves->integer ) {
+				continue;
+			}
+#endif
+			if ( !(item->patch->contents & tw->contents) ) {
+				continue;
+			}
+			CM_TraceThroughPatch( tw, item->patch );
+		}
+
+		if ( !tw->trace.fraction ) {
+			return;
+		}
+	}
+}
+
 #define RADIUS_EPSILON		1.0f
 
 /*
@@ -1002,7 +1355,6 @@ bounding box vs. capsule collision
 void CM_TraceBoundingBoxThroughCapsule( traceWork_t *tw, clipHandle_t model ) {
 	vec3_t mins, maxs, offset, size[2];
 	clipHandle_t h;
-	cmodel_t *cmod;
 	int i;
 
 	// mins maxs of the capsule
@@ -1026,8 +1378,7 @@ void CM_TraceBoundingBoxThroughCapsule( traceWork_t *tw, clipHandle_t model ) {
 	// replace the capsule with the bounding box
 	h = CM_TempBoxModel(tw->size[0], tw->size[1], qfalse);
 	// calculate collision
-	cmod = CM_ClipHandleToModel( h );
-	CM_TraceThroughLeaf( tw, &cmod->leaf );
+	CM_TraceThroughModel( tw, h );
 }
 
 //=========================================================================================
@@ -1160,11 +1511,8 @@ void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end, vec3_t mi
 	int			i;
 	traceWork_t	tw;
 	vec3_t		offset;
-	cmodel_t	*cmod;
 
-	cmod = CM_ClipHandleToModel( model );
-
-	cm.checkcount++;		// for multi-check avoidance
+	CM_ClipHandleToModel( model );	// drops on a bad handle
 
 	c_traces++;				// for statistics, may be zeroed
 
@@ -1179,6 +1527,8 @@ void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end, vec3_t mi
 		return;	// map not loaded, shouldn't happen
 	}
 
+	PROFILE_BEGIN( "CM_Trace" );
+
 	// allow NULL to be passed in for 0,0,0
 	if ( !mins ) {
 		mins = vec3_origin;
@@ -1281,7 +1631,7 @@ void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end, vec3_t mi
 #ifdef ALWAYS_BBOX_VS_BBOX // FIXME - compile time flag?
 			if ( model == BOX_MODEL_HANDLE || model == CAPSULE_MODEL_HANDLE) {
 				tw.sphere.use = qfalse;
-				CM_TestInLeaf( &tw, &cmod->leaf );
+				CM_TestInModel( &tw, model );
 			}
 			else
 #elif defined(ALWAYS_CAPSULE_VS_CAPSULE)
@@ -1299,7 +1649,7 @@ void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end, vec3_t mi
 				}
 			}
 			else {
-				CM_TestInLeaf( &tw, &cmod->leaf );
+				CM_TestInModel( &tw, model );
 			}
 		} else {
 			CM_PositionTest( &tw );
@@ -1325,7 +1675,7 @@ void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end, vec3_t mi
 #ifdef ALWAYS_BBOX_VS_BBOX
 			if ( model == BOX_MODEL_HANDLE || model == CAPSULE_MODEL_HANDLE) {
 				tw.sphere.use = qfalse;
-				CM_TraceThroughLeaf( &tw, &cmod->leaf );
+				CM_TraceThroughModel( &tw, model );
 			}
 			else
 #elif defined(ALWAYS_CAPSULE_VS_CAPSULE)
@@ -1343,10 +1693,19 @@ void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end, vec3_t mi
 				}
 			}
 			else {
-				CM_TraceThroughLeaf( &tw, &cmod->leaf );
+				CM_TraceThroughModel( &tw, model );
 			}
 		} else {
-			CM_TraceThroughTree( &tw, 0, 0, 1, tw.start, tw.end );
+			// the brush tree bounds the world brushes tighter than the
+			// BSP leafs do, which are only kept for contents and areas
+			if ( cm.numBrushTreeNodes ) {
+				CM_TraceThroughBrushTree( &tw, 0 );
+			} else {
+				CM_TraceThroughTree( &tw, 0, 0, 1, tw.start, tw.end );
+			}
+			if ( cm.numSoupNodes && tw.trace.fraction ) {
+				CM_TraceThroughTriangleSoup( &tw, 0 );
+			}
 		}
 	}
 
@@ -1366,6 +1725,8 @@ void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end, vec3_t mi
                tw.trace.fraction == 1.0 ||
                VectorLengthSquared(tw.trace.plane.normal) > 0.9999);
 	*results = tw.trace;
+
+	PROFILE_END();
 }
 
 /*
@@ -340,6 +340,7 @@ void Cmd_Echo_f (void)
 typedef struct cmd_function_s
 {
 	struct cmd_function_s	*next;
+	struct cmd_function_s	*hashNext;
 	char					*name;
 	xcommand_t				function;
 	completionFunc_t	complete;
@@ -353,6 +354,30 @@ static	char		cmd_cmd[BIG_INFO_STRING]; // the original command we received (no t
 
 static	cmd_function_t	*cmd_functions;		// possible commands to execute
 
+#define CMD_HASH_SIZE		512
+static	cmd_function_t	*cmd_hashTable[CMD_HASH_SIZE];	// same commands, keyed by lowercase name
+
+/*
+================
+Cmd_HashValue
+================
+*/
+static long Cmd_HashValue( const char *name ) {
+	int		i;
+	long	hash;
+	char	letter;
+
+	hash = 0;
+	i = 0;
+	while (name[i] != '\0') {
+		letter = tolower(name[i]);
+		hash+=(long)(letter)*(i+119);
+		i++;
+	}
+	hash &= (CMD_HASH_SIZE-1);
+	return hash;
+}
+
 /*
 ============
 Cmd_Argc
@@ -624,7 +649,7 @@ Cmd_FindCommand
 cmd_function_t *Cmd_FindCommand( const char *cmd_name )
 {
 	cmd_function_t *cmd;
-	for( cmd = cmd_functions; cmd; cmd = cmd->next )
+	for( cmd = cmd_hashTable[ Cmd_HashValue( cmd_name ) ]; cmd; cmd = cmd->hashNext )
 		if( !Q_stricmp( cmd_name, cmd->name ) )
 			return cmd;
 	return NULL;
@@ -637,6 +662,7 @@ Cmd_AddCommand
 */
 void	Cmd_AddCommand( const char *cmd_name, xcommand_t function ) {
 	cmd_function_t	*cmd;
+	long			hash;
 	
 	// fail if the command already exists
 	if( Cmd_FindCommand( cmd_name ) )
@@ -654,6 +680,10 @@ void	Cmd_AddCommand( const char *cmd_name, xcommand_t function ) {
 	cmd->complete = NULL;
 	cmd->next = cmd_functions;
 	cmd_functions = cmd;
+
+	hash = Cmd_HashValue( cmd_name );
+	cmd->hashNext = cmd_hashTable[hash];
+	cmd_hashTable[hash] = cmd;
 }
 
 /*
@@ -662,13 +692,10 @@ Cmd_SetCommandCompletionFunc
 ============
 */
 void Cmd_SetCommandCompletionFunc( const char *command, completionFunc_t complete ) {
-	cmd_function_t	*cmd;
+	cmd_function_t	*cmd = Cmd_FindCommand( command );
 
-	for( cmd = cmd_functions; cmd; cmd = cmd->next ) {
-		if( !Q_stricmp( command, cmd->name ) ) {
-			cmd->complete = complete;
-			return;
-		}
+	if( cmd ) {
+		cmd->complete = complete;
 	}
 }
 
@@ -680,7 +707,7 @@ Cmd_RemoveCommand
 void	Cmd_RemoveCommand( const char *cmd_name ) {
 	cmd_function_t	*cmd, **back;
 
-	back = &cmd_functions;
+	back = &cmd_hashTable[ Cmd_HashValue( cmd_name ) ];
 	while( 1 ) {
 		cmd = *back;
 		if ( !cmd ) {
@@ -688,13 +715,18 @@ void	Cmd_RemoveCommand( const char *cmd_name ) {
 			return;
 		}
 		if ( !strcmp( cmd_name, cmd->name ) ) {
-			*back = cmd->next;
-			Z_Free (cmd->name);
-			Z_Free (cmd);
-			return;
+			*back = cmd->hashNext;
+			break;
 		}
-		back = &cmd->next;
+		back = &cmd->hashNext;
 	}
+
+	for( back = &cmd_functions; *back != cmd; back = &(*back)->next )
+		;
+	*back = cmd->next;
+
+	Z_Free (cmd->name);
+	Z_Free (cmd);
 }
 
 /*
@@ -739,15 +771,10 @@ Cmd_CompleteArgument
 ============
 */
 void Cmd_CompleteArgument( const char *command, char *args, int argNum ) {
-	cmd_function_t	*cmd;
+	cmd_function_t	*cmd = Cmd_FindCommand( command );
 
-	for( cmd = cmd_functions; cmd; cmd = cmd->next ) {
-		if( !Q_stricmp( command, cmd->name ) ) {
-			if ( cmd->complete ) {
-				cmd->complete( args, argNum );
-			}
-			return;
-		}
+	if ( cmd && cmd->complete ) {
+		cmd->complete( args, argNum );
 	}
 }
 
@@ -760,7 +787,7 @@ A complete command line has been parsed, so try to execute it
 ============
 */
 void	Cmd_ExecuteString( const char *text ) {	
-	cmd_function_t	*cmd, **prev;
+	cmd_function_t	*cmd;
 
 	// execute the command line
 	Cmd_TokenizeString( text );		
@@ -768,26 +795,14 @@ void	Cmd_ExecuteString( const char *text ) {
 		return;		// no tokens
 	}
 
-	// check registered command functions	
-	for ( prev = &cmd_functions ; *prev ; prev = &cmd->next ) {
-		cmd = *prev;
-		if ( !Q_stricmp( cmd_argv[0],cmd->name ) ) {
-			// rearrange the links so that the command will be
-			// near the head of the list next time it is used
-			*prev = cmd->next;
-			cmd->next = cmd_functions;
-			cmd_functions = cmd;
-
-			// perform the action
-			if ( !cmd->function ) {
-				// let the cgame or game handle it
-				break;
-			} else {
-				cmd->function ();
-			}
-			return;
-		}
+	// check registered command functions
+	cmd = Cmd_FindCommand( cmd_argv[0] );
+	if ( cmd && cmd->function ) {
+		// perform the action
+		cmd->function ();
+		return;
 	}
+	// commands without a function are for the cgame or game to handle
 	
 	// check cvars
 	if ( Cvar_Command() ) {
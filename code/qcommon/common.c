@@ -95,6 +95,8 @@ cvar_t	*com_legacyprotocol;
 cvar_t	*com_basegame;
 cvar_t  *com_homepath;
 cvar_t	*com_busyWait;
+cvar_t	*com_spinBudget;
+cvar_t	*com_instances;
 #ifndef DEDICATED
 cvar_t  *con_autochat;
 #endif
@@ -107,6 +109,8 @@ cvar_t  *con_autochat;
 	void (QDECL *Q_SnapVector)(vec3_t vec);
 #endif
 
+static int	com_instance;	// which of com_instances this process is, 0 for the first
+
 // com_speeds times
 int		time_game;
 int		time_frontend;		// renderer frontend time
@@ -205,7 +209,7 @@ void QDECL Com_Printf( const char *fmt, ... ) {
 			time( &aclock );
 			newtime = localtime( &aclock );
 
-			logfile = FS_FOpenFileWrite_HomeData( "qconsole.log" );
+			logfile = FS_FOpenFileWrite_HomeData( com_instance ? va( "qconsole%i.log", com_instance ) : "qconsole.log" );
 			
 			if(logfile)
 			{
@@ -217,6 +221,10 @@ void QDECL Com_Printf( const char *fmt, ... ) {
 					// data even if we are crashing
 					FS_ForceFlush(logfile);
 				}
+				else
+				{
+					FS_SetAsync(logfile);
+				}
 			}
 			else
 			{
@@ -763,12 +771,25 @@ The rover can be left pointing at a non-empty block
 
 The zone calls are pretty much only used for small strings and structures,
 all big things are allocated on the hunk.
+
+Blocks of up to SLAB_MAX_BLOCK bytes are carved out of slabs instead: zone
+blocks tagged TAG_SLAB that each hold blocks of a single size class, so the
+many short lived strings and structures don't fragment the zone and don't
+make the rover scan it.  Slab blocks keep their memblock_t header with the
+caller's tag and the trash tester, so Z_Free, Z_FreeTags and the heap logs
+deal with them like any other block.
 ==============================================================================
 */
 
 #define	ZONEID	0x1d4a11
+#define	SLABID	0x1d4a12		// id of the blocks that live in a slab
 #define MINFRAGMENT	64
 
+#define	SLAB_SIZE		4096
+#define	SLAB_GRANULE	16
+#define	SLAB_MAX_BLOCK	256		// header and trash tester included
+#define	SLAB_CLASSES	( SLAB_MAX_BLOCK / SLAB_GRANULE )
+
 typedef struct zonedebug_s {
 	char *label;
 	char *file;
@@ -779,8 +800,8 @@ typedef struct zonedebug_s {
 typedef struct memblock_s {
 	int		size;           // including the header and possibly tiny fragments
 	int     tag;            // a tag of 0 is a free block
-	struct memblock_s       *next, *prev;
-	int     id;        		// should be ZONEID
+	struct memblock_s       *next, *prev;	// for slab blocks, the next free block and the slab's zone block
+	int     id;        		// should be ZONEID or SLABID
 #ifdef ZONE_DEBUG
 	zonedebug_t d;
 #endif
@@ -789,17 +810,35 @@ typedef struct memblock_s {
 typedef struct {
 	int		size;			// total bytes malloced, including header
 	int		used;			// total bytes used
+	int		peak;			// high-water mark of used
 	memblock_t	blocklist;	// start / end cap for linked list
 	memblock_t	*rover;
+	struct slab_s	*slabs[SLAB_CLASSES];	// slabs with free blocks, by size class
 } memzone_t;
 
+typedef struct slab_s {
+	memblock_t		*page;			// zone block holding the slab
+	byte			*blocks;
+	memblock_t		*free;			// free blocks, linked through next
+	struct slab_s	*next, *prev;	// slabs of the size class with free blocks
+	int				blockSize;
+	int				numBlocks;
+	int				numUsed;
+} slab_t;
+
 // main zone for all "dynamic" memory allocation
 static memzone_t	*mainzone;
 // we also have a small zone for small allocations that would only
 // fragment the main zone (think of cvar and cmd strings)
 static memzone_t	*smallzone;
 
+// bytes handed out per tag, for memstats
+static int			zoneTagBytes[TAG_COUNT];
+static int			zoneTagPeak[TAG_COUNT];
+
 static void Z_CheckHeap( void );
+static memblock_t *Z_ZoneAlloc( memzone_t *zone, int size, int tag );
+static void Z_ZoneFree( memzone_t *zone, memblock_t *block );
 
 /*
 ========================
@@ -819,6 +858,8 @@ static void Z_ClearZone( memzone_t *zone, int size ) {
 	zone->rover = block;
 	zone->size = size;
 	zone->used = 0;
+	zone->peak = 0;
+	Com_Memset( zone->slabs, 0, sizeof( zone->slabs ) );
 	
 	block->prev = block->next = &zone->blocklist;
 	block->tag = 0;			// free block
@@ -835,6 +876,21 @@ static int Z_AvailableZoneMemory( memzone_t *zone ) {
 	return zone->size - zone->used;
 }
 
+/*
+========================
+Z_TagStat
+========================
+*/
+static void Z_TagStat( int tag, int bytes ) {
+	if ( tag <= 0 || tag >= TAG_COUNT ) {
+		return;
+	}
+	zoneTagBytes[tag] += bytes;
+	if ( zoneTagBytes[tag] > zoneTagPeak[tag] ) {
+		zoneTagPeak[tag] = zoneTagBytes[tag];
+	}
+}
+
 /*
 ========================
 Z_AvailableMemory
@@ -846,45 +902,198 @@ int Z_AvailableMemory( void ) {
 
 /*
 ========================
-Z_Free
+Z_SlabBlock
 ========================
 */
-void Z_Free( void *ptr ) {
-	memblock_t	*block, *other;
-	memzone_t *zone;
-	
-	if (!ptr) {
-		Com_Error( ERR_DROP, "Z_Free: NULL pointer" );
+static memblock_t *Z_SlabBlock( slab_t *slab, int i ) {
+	return (memblock_t *)( slab->blocks + i * slab->blockSize );
+}
+
+/*
+========================
+Z_SlabAlloc
+
+Returns a block of the given size, header included, from a slab of its
+size class, or NULL if the zone has no room for a new slab
+========================
+*/
+static memblock_t *Z_SlabAlloc( memzone_t *zone, int size, int tag ) {
+	slab_t		*slab;
+	memblock_t	*page, *block;
+	byte		*end;
+	int			sizeClass, i;
+
+	sizeClass = ( size - 1 ) / SLAB_GRANULE;
+	slab = zone->slabs[sizeClass];
+
+	if ( !slab ) {
+		page = Z_ZoneAlloc( zone, SLAB_SIZE, TAG_SLAB );
+		if ( !page ) {
+			return NULL;
+		}
+#ifdef ZONE_DEBUG
+		page->d.label = "slab";
+		page->d.file = __FILE__;
+		page->d.line = __LINE__;
+		page->d.allocSize = SLAB_SIZE;
+#endif
+
+		slab = (slab_t *)( page + 1 );
+		slab->page = page;
+		slab->blockSize = ( sizeClass + 1 ) * SLAB_GRANULE;
+		slab->blocks = PADP( slab + 1, sizeof( intptr_t ) );
+		end = (byte *)page + page->size - 4;	// leave the page's trash tester
+		slab->numBlocks = ( end - slab->blocks ) / slab->blockSize;
+		slab->numUsed = 0;
+		slab->free = NULL;
+		for ( i = slab->numBlocks - 1 ; i >= 0 ; i-- ) {
+			block = Z_SlabBlock( slab, i );
+			block->size = slab->blockSize;
+			block->tag = 0;					// free block
+			block->id = SLABID;
+			block->prev = page;
+			block->next = slab->free;
+			slab->free = block;
+		}
+
+		slab->prev = NULL;
+		slab->next = NULL;
+		zone->slabs[sizeClass] = slab;
 	}
 
-	block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
-	if (block->id != ZONEID) {
-		Com_Error( ERR_FATAL, "Z_Free: freed a pointer without ZONEID" );
+	block = slab->free;
+	slab->free = block->next;
+	block->next = NULL;
+	slab->numUsed++;
+
+	if ( !slab->free ) {
+		// full, off the list until a block comes back
+		zone->slabs[sizeClass] = slab->next;
+		if ( slab->next ) {
+			slab->next->prev = NULL;
+		}
+		slab->next = NULL;
 	}
-	if (block->tag == 0) {
-		Com_Error( ERR_FATAL, "Z_Free: freed a freed pointer" );
+
+	block->tag = tag;
+	*(int *)((byte *)block + block->size - 4) = ZONEID;
+
+	return block;
+}
+
+/*
+========================
+Z_SlabRelease
+
+Gives an empty slab back to the zone, unless it is the only one of its
+size class with free blocks.  Returns qtrue if it was released.
+========================
+*/
+static qboolean Z_SlabRelease( memzone_t *zone, slab_t *slab ) {
+	int		sizeClass;
+
+	if ( slab->numUsed || ( !slab->prev && !slab->next ) ) {
+		return qfalse;
 	}
-	// if static memory
-	if (block->tag == TAG_STATIC) {
-		return;
+
+	sizeClass = slab->blockSize / SLAB_GRANULE - 1;
+	if ( slab->prev ) {
+		slab->prev->next = slab->next;
+	} else {
+		zone->slabs[sizeClass] = slab->next;
+	}
+	if ( slab->next ) {
+		slab->next->prev = slab->prev;
 	}
 
-	// check the memory trash tester
-	if ( *(int *)((byte *)block + block->size - 4 ) != ZONEID ) {
-		Com_Error( ERR_FATAL, "Z_Free: memory block wrote past end" );
+	Z_ZoneFree( zone, slab->page );
+
+	return qtrue;
+}
+
+/*
+========================
+Z_SlabFree
+
+Returns a block to its slab
+========================
+*/
+static slab_t *Z_SlabFree( memzone_t *zone, memblock_t *block ) {
+	memblock_t	*page;
+	slab_t		*slab;
+	int			sizeClass;
+
+	page = block->prev;
+	slab = (slab_t *)( page + 1 );
+	if ( page->tag != TAG_SLAB || slab->page != page ) {
+		Com_Error( ERR_FATAL, "Z_Free: slab block outside of a slab" );
 	}
 
-	if (block->tag == TAG_SMALL) {
-		zone = smallzone;
+	// set the block to something that should cause problems
+	// if it is referenced...
+	Com_Memset( block + 1, 0xaa, block->size - sizeof( *block ) );
+
+	block->tag = 0;		// mark as free
+
+	if ( !slab->free ) {
+		// was full, back on the list
+		sizeClass = slab->blockSize / SLAB_GRANULE - 1;
+		slab->prev = NULL;
+		slab->next = zone->slabs[sizeClass];
+		if ( slab->next ) {
+			slab->next->prev = slab;
+		}
+		zone->slabs[sizeClass] = slab;
 	}
-	else {
-		zone = mainzone;
+	block->next = slab->free;
+	slab->free = block;
+	slab->numUsed--;
+
+	return slab;
+}
+
+/*
+========================
+Z_SlabFreeTags
+
+Frees the blocks of a slab with the given tag and returns qtrue if the
+slab's zone block went back to the zone with them
+========================
+*/
+static qboolean Z_SlabFreeTags( memzone_t *zone, memblock_t *page, int tag ) {
+	slab_t		*slab;
+	memblock_t	*block;
+	int			i;
+	qboolean	freed;
+
+	slab = (slab_t *)( page + 1 );
+	freed = qfalse;
+	for ( i = 0 ; i < slab->numBlocks ; i++ ) {
+		block = Z_SlabBlock( slab, i );
+		if ( block->tag == tag ) {
+			Z_TagStat( tag, -block->size );
+			Z_SlabFree( zone, block );
+			freed = qtrue;
+		}
 	}
 
+	return freed && Z_SlabRelease( zone, slab );
+}
+
+/*
+========================
+Z_ZoneFree
+
+Gives a block back to the zone, merging it with its free neighbours
+========================
+*/
+static void Z_ZoneFree( memzone_t *zone, memblock_t *block ) {
+	memblock_t	*other;
+
 	zone->used -= block->size;
 	// set the block to something that should cause problems
 	// if it is referenced...
-	Com_Memset( ptr, 0xaa, block->size - sizeof( *block ) );
+	Com_Memset( block + 1, 0xaa, block->size - sizeof( *block ) );
 
 	block->tag = 0;		// mark as free
 	
@@ -911,6 +1120,53 @@ void Z_Free( void *ptr ) {
 	}
 }
 
+/*
+========================
+Z_Free
+========================
+*/
+void Z_Free( void *ptr ) {
+	memblock_t	*block;
+	memzone_t *zone;
+	
+	if (!ptr) {
+		Com_Error( ERR_DROP, "Z_Free: NULL pointer" );
+	}
+
+	block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
+	if (block->id != ZONEID && block->id != SLABID) {
+		Com_Error( ERR_FATAL, "Z_Free: freed a pointer without ZONEID" );
+	}
+	if (block->tag == 0) {
+		Com_Error( ERR_FATAL, "Z_Free: freed a freed pointer" );
+	}
+	// if static memory
+	if (block->tag == TAG_STATIC) {
+		return;
+	}
+
+	// check the memory trash tester
+	if ( *(int *)((byte *)block + block->size - 4 ) != ZONEID ) {
+		Com_Error( ERR_FATAL, "Z_Free: memory block wrote past end" );
+	}
+
+	Z_TagStat( block->tag, -block->size );
+
+	if (block->tag == TAG_SMALL) {
+		zone = smallzone;
+	}
+	else {
+		zone = mainzone;
+	}
+
+	if (block->id == SLABID) {
+		Z_SlabRelease( zone, Z_SlabFree( zone, block ) );
+		return;
+	}
+
+	Z_ZoneFree( zone, block );
+}
+
 
 /*
 ================
@@ -934,6 +1190,9 @@ void Z_FreeTags( int tag ) {
 			Z_Free( (void *)(zone->rover + 1) );
 			continue;
 		}
+		if ( zone->rover->tag == TAG_SLAB && Z_SlabFreeTags( zone, zone->rover, tag ) ) {
+			continue;
+		}
 		zone->rover = zone->rover->next;
 	} while ( zone->rover != &zone->blocklist );
 }
@@ -941,56 +1200,29 @@ void Z_FreeTags( int tag ) {
 
 /*
 ================
-Z_TagMalloc
+Z_ZoneAlloc
+
+First fit from the rover, returns NULL if no free block is big enough
 ================
 */
-#ifdef ZONE_DEBUG
-void *Z_TagMallocDebug( int size, int tag, char *label, char *file, int line ) {
-	int		allocSize;
-#else
-void *Z_TagMalloc( int size, int tag ) {
-#endif
-	int		extra;
+static memblock_t *Z_ZoneAlloc( memzone_t *zone, int size, int tag ) {
+	int			extra;
 	memblock_t	*start, *rover, *new, *base;
-	memzone_t *zone;
 
-	if (!tag) {
-		Com_Error( ERR_FATAL, "Z_TagMalloc: tried to use a 0 tag" );
-	}
-
-	if ( tag == TAG_SMALL ) {
-		zone = smallzone;
-	}
-	else {
-		zone = mainzone;
-	}
+	size += sizeof(memblock_t);	// account for size of block header
+	size += 4;					// space for memory trash tester
+	size = PAD(size, sizeof(intptr_t));		// align to 32/64 bit boundary
 
-#ifdef ZONE_DEBUG
-	allocSize = size;
-#endif
 	//
 	// scan through the block list looking for the first free block
 	// of sufficient size
 	//
-	size += sizeof(memblock_t);	// account for size of block header
-	size += 4;					// space for memory trash tester
-	size = PAD(size, sizeof(intptr_t));		// align to 32/64 bit boundary
-	
 	base = rover = zone->rover;
 	start = base->prev;
 	
 	do {
 		if (rover == start)	{
 			// scaned all the way around the list
-#ifdef ZONE_DEBUG
-			Z_LogHeap();
-
-			Com_Error(ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes from the %s zone: %s, line: %d (%s)",
-								size, zone == smallzone ? "small" : "main", file, line, label);
-#else
-			Com_Error(ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes from the %s zone",
-								size, zone == smallzone ? "small" : "main");
-#endif
 			return NULL;
 		}
 		if (rover->tag) {
@@ -1021,9 +1253,73 @@ void *Z_TagMalloc( int size, int tag ) {
 	
 	zone->rover = base->next;	// next allocation will start looking here
 	zone->used += base->size;	//
+	if ( zone->used > zone->peak ) {
+		zone->peak = zone->used;
+	}
 	
 	base->id = ZONEID;
 
+	// marker for memory trash testing
+	*(int *)((byte *)base + base->size - 4) = ZONEID;
+
+	return base;
+}
+
+/*
+================
+Z_TagMalloc
+================
+*/
+#ifdef ZONE_DEBUG
+void *Z_TagMallocDebug( int size, int tag, char *label, char *file, int line ) {
+	int		allocSize;
+#else
+void *Z_TagMalloc( int size, int tag ) {
+#endif
+	memblock_t	*base;
+	memzone_t *zone;
+	int			blockSize;
+
+	if (!tag) {
+		Com_Error( ERR_FATAL, "Z_TagMalloc: tried to use a 0 tag" );
+	}
+
+	if ( tag == TAG_SMALL ) {
+		zone = smallzone;
+	}
+	else {
+		zone = mainzone;
+	}
+
+#ifdef ZONE_DEBUG
+	allocSize = size;
+#endif
+
+	// small blocks come from a slab when there is room for one
+	blockSize = PAD(size + sizeof(memblock_t) + 4, sizeof(intptr_t));
+	base = NULL;
+	if ( size >= 0 && blockSize <= SLAB_MAX_BLOCK ) {
+		base = Z_SlabAlloc( zone, blockSize, tag );
+	}
+	if ( !base ) {
+		base = Z_ZoneAlloc( zone, size, tag );
+	}
+
+	if ( !base ) {
+#ifdef ZONE_DEBUG
+		Z_LogHeap();
+
+		Com_Error(ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes from the %s zone: %s, line: %d (%s)",
+							blockSize, zone == smallzone ? "small" : "main", file, line, label);
+#else
+		Com_Error(ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes from the %s zone",
+							blockSize, zone == smallzone ? "small" : "main");
+#endif
+		return NULL;
+	}
+
+	Z_TagStat( tag, base->size );
+
 #ifdef ZONE_DEBUG
 	base->d.label = label;
 	base->d.file = file;
@@ -1031,9 +1327,6 @@ void *Z_TagMalloc( int size, int tag ) {
 	base->d.allocSize = allocSize;
 #endif
 
-	// marker for memory trash testing
-	*(int *)((byte *)base + base->size - 4) = ZONEID;
-
 	return (void *) ((byte *)base + sizeof(memblock_t));
 }
 
@@ -1096,46 +1389,65 @@ static void Z_CheckHeap( void ) {
 
 /*
 ========================
-Z_LogZoneHeap
+Z_LogZoneBlock
 ========================
 */
-void Z_LogZoneHeap( memzone_t *zone, char *name ) {
+static void Z_LogZoneBlock( memblock_t *block, int *size, int *allocSize, int *numBlocks ) {
 #ifdef ZONE_DEBUG
 	char dump[32], *ptr;
 	int  i, j;
+	char		buf[4096];
+
+	ptr = ((char *) block) + sizeof(memblock_t);
+	j = 0;
+	for (i = 0; i < 20 && i < block->d.allocSize; i++) {
+		if (ptr[i] >= 32 && ptr[i] < 127) {
+			dump[j++] = ptr[i];
+		}
+		else {
+			dump[j++] = '_';
+		}
+	}
+	dump[j] = '\0';
+	Com_sprintf(buf, sizeof(buf), "size = %8d: %s, line: %d (%s) [%s]\r\n", block->d.allocSize, block->d.file, block->d.line, block->d.label, dump);
+	FS_Write(buf, strlen(buf), logfile);
+	*allocSize += block->d.allocSize;
 #endif
-	memblock_t	*block;
+	*size += block->size;
+	(*numBlocks)++;
+}
+
+/*
+========================
+Z_LogZoneHeap
+========================
+*/
+void Z_LogZoneHeap( memzone_t *zone, char *name ) {
+	memblock_t	*block, *slabBlock;
+	slab_t		*slab;
 	char		buf[4096];
 	int size, allocSize, numBlocks;
+	int			i;
 
 	if (!logfile || !FS_Initialized())
 		return;
 	size = numBlocks = 0;
-#ifdef ZONE_DEBUG
 	allocSize = 0;
-#endif
 	Com_sprintf(buf, sizeof(buf), "\r\n================\r\n%s log\r\n================\r\n", name);
 	FS_Write(buf, strlen(buf), logfile);
 	for (block = zone->blocklist.next ; block->next != &zone->blocklist; block = block->next) {
-		if (block->tag) {
-#ifdef ZONE_DEBUG
-			ptr = ((char *) block) + sizeof(memblock_t);
-			j = 0;
-			for (i = 0; i < 20 && i < block->d.allocSize; i++) {
-				if (ptr[i] >= 32 && ptr[i] < 127) {
-					dump[j++] = ptr[i];
-				}
-				else {
-					dump[j++] = '_';
+		if (block->tag == TAG_SLAB) {
+			// log the blocks in use rather than the slab
+			slab = (slab_t *)( block + 1 );
+			for (i = 0; i < slab->numBlocks; i++) {
+				slabBlock = Z_SlabBlock( slab, i );
+				if (slabBlock->tag) {
+					Z_LogZoneBlock( slabBlock, &size, &allocSize, &numBlocks );
 				}
 			}
-			dump[j] = '\0';
-			Com_sprintf(buf, sizeof(buf), "size = %8d: %s, line: %d (%s) [%s]\r\n", block->d.allocSize, block->d.file, block->d.line, block->d.label, dump);
-			FS_Write(buf, strlen(buf), logfile);
-			allocSize += block->d.allocSize;
-#endif
-			size += block->size;
-			numBlocks++;
+		}
+		else if (block->tag) {
+			Z_LogZoneBlock( block, &size, &allocSize, &numBlocks );
 		}
 	}
 #ifdef ZONE_DEBUG
@@ -1271,6 +1583,9 @@ static	hunkUsed_t	*hunk_permanent, *hunk_temp;
 
 static	byte	*s_hunkData = NULL;
 static	int		s_hunkTotal;
+static	int		s_hunkPeak;		// high-water mark of both sides, for memstats
+
+static void Com_MemStats_f( void );
 
 static	int		s_zoneTotal;
 static	int		s_smallZoneTotal;
@@ -1282,22 +1597,44 @@ Com_Meminfo_f
 =================
 */
 void Com_Meminfo_f( void ) {
-	memblock_t	*block;
+	memblock_t	*block, *slabBlock;
+	slab_t		*slab;
 	int			zoneBytes, zoneBlocks;
 	int			smallZoneBytes;
 	int			botlibBytes, rendererBytes;
+	int			slabBytes, slabUsedBytes;
 	int			unused;
+	int			i;
 
 	zoneBytes = 0;
 	botlibBytes = 0;
 	rendererBytes = 0;
 	zoneBlocks = 0;
+	slabBytes = 0;
+	slabUsedBytes = 0;
 	for (block = mainzone->blocklist.next ; ; block = block->next) {
 		if ( Cmd_Argc() != 1 ) {
 			Com_Printf ("block:%p    size:%7i    tag:%3i\n",
 				(void *)block, block->size, block->tag);
 		}
-		if ( block->tag ) {
+		if ( block->tag == TAG_SLAB ) {
+			slab = (slab_t *)( block + 1 );
+			slabBytes += block->size;
+			for ( i = 0 ; i < slab->numBlocks ; i++ ) {
+				slabBlock = Z_SlabBlock( slab, i );
+				if ( !slabBlock->tag ) {
+					continue;
+				}
+				zoneBytes += slabBlock->size;
+				zoneBlocks++;
+				slabUsedBytes += slabBlock->size;
+				if ( slabBlock->tag == TAG_BOTLIB ) {
+					botlibBytes += slabBlock->size;
+				} else if ( slabBlock->tag == TAG_RENDERER ) {
+					rendererBytes += slabBlock->size;
+				}
+			}
+		} else if ( block->tag ) {
 			zoneBytes += block->size;
 			zoneBlocks++;
 			if ( block->tag == TAG_BOTLIB ) {
@@ -1323,7 +1660,17 @@ void Com_Meminfo_f( void ) {
 
 	smallZoneBytes = 0;
 	for (block = smallzone->blocklist.next ; ; block = block->next) {
-		if ( block->tag ) {
+		if ( block->tag == TAG_SLAB ) {
+			slab = (slab_t *)( block + 1 );
+			slabBytes += block->size;
+			for ( i = 0 ; i < slab->numBlocks ; i++ ) {
+				slabBlock = Z_SlabBlock( slab, i );
+				if ( slabBlock->tag ) {
+					smallZoneBytes += slabBlock->size;
+					slabUsedBytes += slabBlock->size;
+				}
+			}
+		} else if ( block->tag ) {
 			smallZoneBytes += block->size;
 		}
 
@@ -1364,6 +1711,7 @@ void Com_Meminfo_f( void ) {
 	Com_Printf( "        %8i bytes in dynamic renderer\n", rendererBytes );
 	Com_Printf( "        %8i bytes in dynamic other\n", zoneBytes - ( botlibBytes + rendererBytes ) );
 	Com_Printf( "        %8i bytes in small Zone memory\n", smallZoneBytes );
+	Com_Printf( "%8i bytes of slabs, %i in use\n", slabBytes, slabUsedBytes );
 }
 
 /*
@@ -1587,6 +1935,7 @@ void Com_InitHunkMemory( void ) {
 	Hunk_Clear();
 
 	Cmd_AddCommand( "meminfo", Com_Meminfo_f );
+	Cmd_AddCommand( "memstats", Com_MemStats_f );
 #ifdef ZONE_DEBUG
 	Cmd_AddCommand( "zonelog", Z_LogHeap );
 #endif
@@ -1763,6 +2112,10 @@ void *Hunk_Alloc( int size, ha_pref preference ) {
 
 	hunk_permanent->temp = hunk_permanent->permanent;
 
+	if ( hunk_low.temp + hunk_high.temp > s_hunkPeak ) {
+		s_hunkPeak = hunk_low.temp + hunk_high.temp;
+	}
+
 	Com_Memset( buf, 0, size );
 
 #ifdef HUNK_DEBUG
@@ -1823,6 +2176,9 @@ void *Hunk_AllocateTempMemory( int size ) {
 	if ( hunk_temp->temp > hunk_temp->tempHighwater ) {
 		hunk_temp->tempHighwater = hunk_temp->temp;
 	}
+	if ( hunk_low.temp + hunk_high.temp > s_hunkPeak ) {
+		s_hunkPeak = hunk_low.temp + hunk_high.temp;
+	}
 
 	hdr = (hunkHeader_t *)buf;
 	buf = (void *)(hdr+1);
@@ -1897,6 +2253,273 @@ void Hunk_ClearTempMemory( void ) {
 /*
 ===================================================================
 
+FRAME ARENA
+
+Scratch memory that only has to live until the end of the current
+frame.  Allocations are a pointer bump and are never freed one by one;
+the whole arena is reset at the top of Com_Frame.  Code that can run
+many times inside a single frame (loading screens) brackets its use
+with Com_FrameMark / Com_FrameRelease.
+
+Job threads allocate from arenas of their own, see jobs.c.
+===================================================================
+*/
+
+#define	FRAME_ARENA_SIZE	( 1024 * 1024 )
+#define	FRAME_ARENA_ALIGN	16
+
+static byte	s_frameArena[FRAME_ARENA_SIZE];
+static int	s_frameArenaUsed;
+
+/*
+=================
+Com_FrameAlloc
+
+Returns 16 byte aligned memory that is valid until the next frame
+=================
+*/
+void *Com_FrameAlloc( int size ) {
+	byte	*buf;
+	int		used;
+
+	if ( Com_JobThread() ) {
+		return Com_JobFrameAlloc( size );
+	}
+
+	if ( size < 0 ) {
+		Com_Error( ERR_FATAL, "Com_FrameAlloc: bad size %i", size );
+	}
+
+	used = ( s_frameArenaUsed + FRAME_ARENA_ALIGN - 1 ) & ~( FRAME_ARENA_ALIGN - 1 );
+	if ( size > FRAME_ARENA_SIZE - used ) {
+		Com_Error( ERR_DROP, "Com_FrameAlloc: failed on %i", size );
+	}
+
+	buf = s_frameArena + used;
+	s_frameArenaUsed = used + size;
+
+	return buf;
+}
+
+/*
+=================
+Com_FrameMark
+=================
+*/
+int Com_FrameMark( void ) {
+	return s_frameArenaUsed;
+}
+
+/*
+=================
+Com_FrameRelease
+
+Gives back everything allocated since the matching Com_FrameMark
+=================
+*/
+void Com_FrameRelease( int mark ) {
+	if ( mark < 0 || mark > s_frameArenaUsed ) {
+		Com_Error( ERR_FATAL, "Com_FrameRelease: bad mark %i", mark );
+	}
+	s_frameArenaUsed = mark;
+}
+
+/*
+=================
+Com_FrameReset
+=================
+*/
+static void Com_FrameReset( void ) {
+	s_frameArenaUsed = 0;
+	Com_ResetJobArenas();
+}
+
+/*
+===================================================================
+
+MEMORY STATISTICS
+
+Current and high-water byte counts for the zone tags, the hunk and
+whatever other subsystems report through Com_MemStatSet.  The
+"memstats" command prints them one per line as
+<name> <current> <peak> [<size>], which also works through rcon, and
+com_memStatsFile writes the same text to a file every
+com_memStatsInterval seconds.
+===================================================================
+*/
+
+#define	MAX_MEM_STATS		32
+
+typedef struct {
+	char	name[32];
+	int		current;
+	int		peak;
+} memStat_t;
+
+static memStat_t	memStats[MAX_MEM_STATS];
+static int			numMemStats;
+
+static cvar_t		*com_memStatsFile;
+static cvar_t		*com_memStatsInterval;
+static int			memStatsLastWrite;
+
+static const char *zoneTagNames[TAG_COUNT] = {
+	"free",
+	"general",
+	"botlib",
+	"renderer",
+	"small",
+	"static",
+	"slab"
+};
+
+/*
+=================
+Com_MemStatSet
+
+Records the current byte count of a subsystem counter
+=================
+*/
+void Com_MemStatSet( const char *name, int bytes ) {
+	memStat_t	*stat;
+	int			i;
+
+	for ( i = 0 ; i < numMemStats ; i++ ) {
+		if ( !strcmp( memStats[i].name, name ) ) {
+			break;
+		}
+	}
+
+	if ( i == numMemStats ) {
+		if ( numMemStats == MAX_MEM_STATS ) {
+			return;
+		}
+		Q_strncpyz( memStats[i].name, name, sizeof( memStats[i].name ) );
+		memStats[i].current = 0;
+		memStats[i].peak = 0;
+		numMemStats++;
+	}
+
+	stat = &memStats[i];
+	stat->current = bytes;
+	if ( bytes > stat->peak ) {
+		stat->peak = bytes;
+	}
+}
+
+/*
+=================
+Com_MemUsage
+
+Current and high-water bytes of the main zone and the hunk
+=================
+*/
+void Com_MemUsage( int *zone, int *zonePeak, int *hunk, int *hunkPeak ) {
+	*zone = mainzone ? mainzone->used : 0;
+	*zonePeak = mainzone ? mainzone->peak : 0;
+	*hunk = s_hunkData ? hunk_low.temp + hunk_high.temp : 0;
+	*hunkPeak = s_hunkData ? s_hunkPeak : 0;
+}
+
+/*
+=================
+Com_MemStatsText
+=================
+*/
+static void Com_MemStatsText( char *buf, int size ) {
+	const char	*mapname;
+	int			i;
+
+	buf[0] = 0;
+
+	mapname = Cvar_VariableString( "mapname" );
+	Q_strcat( buf, size, va( "map %s\n", mapname[0] ? mapname : "-" ) );
+
+	if ( mainzone ) {
+		Q_strcat( buf, size, va( "mainzone %i %i %i\n", mainzone->used, mainzone->peak, mainzone->size ) );
+	}
+	if ( smallzone ) {
+		Q_strcat( buf, size, va( "smallzone %i %i %i\n", smallzone->used, smallzone->peak, smallzone->size ) );
+	}
+	for ( i = TAG_GENERAL ; i < TAG_COUNT ; i++ ) {
+		if ( i == TAG_SLAB ) {
+			continue;	// slab pages are counted by the tags of their blocks
+		}
+		Q_strcat( buf, size, va( "tag.%s %i %i\n", zoneTagNames[i], zoneTagBytes[i], zoneTagPeak[i] ) );
+	}
+
+	if ( s_hunkData ) {
+		Q_strcat( buf, size, va( "hunk %i %i %i\n", hunk_low.temp + hunk_high.temp, s_hunkPeak, s_hunkTotal ) );
+		Q_strcat( buf, size, va( "hunk.low %i %i\n", hunk_low.permanent, hunk_low.tempHighwater ) );
+		Q_strcat( buf, size, va( "hunk.high %i %i\n", hunk_high.permanent, hunk_high.tempHighwater ) );
+		Q_strcat( buf, size, va( "hunk.mark %i %i\n", hunk_low.mark, hunk_high.mark ) );
+	}
+
+	for ( i = 0 ; i < numMemStats ; i++ ) {
+		Q_strcat( buf, size, va( "%s %i %i\n", memStats[i].name, memStats[i].current, memStats[i].peak ) );
+	}
+}
+
+/*
+=================
+Com_MemStats_f
+
+"memstats reset" starts the high-water marks over from the current values
+=================
+*/
+static void Com_MemStats_f( void ) {
+	char	buf[4096];
+	int		i;
+
+	if ( !Q_stricmp( Cmd_Argv( 1 ), "reset" ) ) {
+		for ( i = 0 ; i < TAG_COUNT ; i++ ) {
+			zoneTagPeak[i] = zoneTagBytes[i];
+		}
+		if ( mainzone ) {
+			mainzone->peak = mainzone->used;
+		}
+		if ( smallzone ) {
+			smallzone->peak = smallzone->used;
+		}
+		s_hunkPeak = hunk_low.temp + hunk_high.temp;
+		for ( i = 0 ; i < numMemStats ; i++ ) {
+			memStats[i].peak = memStats[i].current;
+		}
+		return;
+	}
+
+	Com_MemStatsText( buf, sizeof( buf ) );
+	Com_Printf( "%s", buf );
+}
+
+/*
+=================
+Com_MemStatsFrame
+
+Writes com_memStatsFile when com_memStatsInterval has passed
+=================
+*/
+static void Com_MemStatsFrame( void ) {
+	char	buf[4096];
+	int		now;
+
+	if ( !com_memStatsFile->string[0] || com_memStatsInterval->integer <= 0 || !FS_Initialized() ) {
+		return;
+	}
+
+	now = Sys_Milliseconds();
+	if ( memStatsLastWrite && now - memStatsLastWrite < com_memStatsInterval->integer * 1000 ) {
+		return;
+	}
+	memStatsLastWrite = now;
+
+	Com_MemStatsText( buf, sizeof( buf ) );
+	FS_WriteFile( com_memStatsFile->string, buf, strlen( buf ) );
+}
+
+/*
+===================================================================
+
 EVENTS AND JOURNALING
 
 In addition to these events, .cfg files are also copied to the
@@ -1909,6 +2532,42 @@ static int com_pushedEventsHead = 0;
 static int com_pushedEventsTail = 0;
 static sysEvent_t	com_pushedEvents[MAX_PUSHED_EVENTS];
 
+/*
+=================
+Com_StartInstances
+
+A dedicated server with com_instances above 1 forks into that many
+servers on consecutive ports.  This happens once the filesystem and
+the hunk are set up and before any thread is started, so the pak
+index and whatever else has been loaded stay shared between the
+processes until one of them writes to it.  Everything after this,
+maps, collision and bot data included, belongs to each instance.
+=================
+*/
+static void Com_StartInstances( void ) {
+	int		port, port6;
+
+	com_instances = Cvar_Get( "com_instances", "1", CVAR_INIT );
+	Cvar_CheckRange( com_instances, 1, 64, qtrue );
+
+	if ( !com_dedicated->integer || com_instances->integer <= 1 ) {
+		return;
+	}
+
+	// the net cvars aren't registered yet, only set from the command line
+	port = *Cvar_VariableString( "net_port" ) ? Cvar_VariableIntegerValue( "net_port" ) : PORT_SERVER;
+	port6 = *Cvar_VariableString( "net_port6" ) ? Cvar_VariableIntegerValue( "net_port6" ) : PORT_SERVER;
+
+	com_instance = Sys_StartInstances( com_instances->integer );
+	Cvar_Get( "com_instance", va( "%i", com_instance ), CVAR_ROM );
+
+	if ( com_instance ) {
+		Cvar_Set( "net_port", va( "%i", port + com_instance ) );
+		Cvar_Set( "net_port6", va( "%i", port6 + com_instance ) );
+		Com_Printf( "Instance %i of %i on port %i\n", com_instance, com_instances->integer, port + com_instance );
+	}
+}
+
 /*
 =================
 Com_InitJournaling
@@ -2195,19 +2854,19 @@ int Com_EventLoop( void ) {
 	byte		bufData[MAX_MSGLEN];
 	msg_t		buf;
 
-	MSG_Init( &buf, bufData, sizeof( bufData ) );
-
 	while ( 1 ) {
 		ev = Com_GetEvent();
 
 		// if no more events are available
 		if ( ev.evType == SE_NONE ) {
-			// manually send packet events for the loopback channel
-			while ( NET_GetLoopPacket( NS_CLIENT, &evFrom, &buf ) ) {
+			// manually send packet events for the loopback channel,
+			// a reassembled netchan message leaves buf pointing at
+			// the channel's buffer so it is set up for each packet
+			while ( MSG_Init( &buf, bufData, sizeof( bufData ) ), NET_GetLoopPacket( NS_CLIENT, &evFrom, &buf ) ) {
 				CL_PacketEvent( evFrom, &buf );
 			}
 
-			while ( NET_GetLoopPacket( NS_SERVER, &evFrom, &buf ) ) {
+			while ( MSG_Init( &buf, bufData, sizeof( bufData ) ), NET_GetLoopPacket( NS_SERVER, &evFrom, &buf ) ) {
 				// if the server just shut down, flush the events
 				if ( com_sv_running->integer ) {
 					Com_RunAndTimeServerPacket( &evFrom, &buf );
@@ -2684,6 +3343,9 @@ void Com_Init( char *commandLine ) {
 	// cvar and command buffer management
 	Com_ParseCommandLine( commandLine );
 
+	// records the rest of Com_Init with com_profileStartup
+	Com_ProfileStartup( qfalse );
+
 //	Swap_Init ();
 	Cbuf_Init ();
 
@@ -2705,7 +3367,9 @@ void Com_Init( char *commandLine ) {
 	com_basegame = Cvar_Get("com_basegame", BASEGAME, CVAR_INIT);
 	com_homepath = Cvar_Get("com_homepath", "", CVAR_INIT|CVAR_PROTECTED);
 
+	PROFILE_BEGIN( "FS_InitFilesystem" );
 	FS_InitFilesystem ();
+	PROFILE_END();
 
 	Com_InitJournaling();
 
@@ -2723,7 +3387,9 @@ void Com_Init( char *commandLine ) {
 	Cmd_SetCommandCompletionFunc( "writeconfig", Cmd_CompleteCfgName );
 	Cmd_AddCommand("game_restart", Com_GameRestart_f);
 
+	PROFILE_BEGIN( "Com_ExecuteCfg" );
 	Com_ExecuteCfg();
+	PROFILE_END();
 
 	// override anything from the config files with command line args
 	Com_StartupVariable( NULL );
@@ -2737,7 +3403,11 @@ void Com_Init( char *commandLine ) {
 	Cvar_CheckRange( com_dedicated, 0, 2, qtrue );
 #endif
 	// allocate the stack based hunk allocator
+	PROFILE_BEGIN( "Com_InitHunkMemory" );
 	Com_InitHunkMemory();
+	PROFILE_END();
+
+	Com_StartInstances();
 
 	// if any archived cvars are modified after this, we will trigger a writing
 	// of the config file
@@ -2781,6 +3451,9 @@ void Com_Init( char *commandLine ) {
 	com_maxfpsMinimized = Cvar_Get( "com_maxfpsMinimized", "0", CVAR_ARCHIVE );
 	com_abnormalExit = Cvar_Get( "com_abnormalExit", "0", CVAR_ROM );
 	com_busyWait = Cvar_Get("com_busyWait", "0", CVAR_ARCHIVE);
+	com_spinBudget = Cvar_Get("com_spinBudget", "1000", CVAR_ARCHIVE);
+	com_memStatsFile = Cvar_Get( "com_memStatsFile", "", CVAR_ARCHIVE );
+	com_memStatsInterval = Cvar_Get( "com_memStatsInterval", "10", CVAR_ARCHIVE );
 	Cvar_Get("com_errorMessage", "", CVAR_ROM | CVAR_NORESTART);
 
 #ifdef CINEMATICS_INTRO
@@ -2805,7 +3478,12 @@ void Com_Init( char *commandLine ) {
 	con_autochat = Cvar_Get("con_autochat", "1", CVAR_ARCHIVE);
 #endif
 
+	PROFILE_BEGIN( "Sys_Init" );
 	Sys_Init();
+	PROFILE_END();
+	Com_InitJobs();
+	Com_InitWriter();
+	Com_InitProfile();
 
 	Sys_InitPIDFile( FS_GetCurrentGameDir() );
 
@@ -2814,11 +3492,15 @@ void Com_Init( char *commandLine ) {
 	Netchan_Init( qport & 0xffff );
 
 	VM_Init();
+	PROFILE_BEGIN( "SV_Init" );
 	SV_Init();
+	PROFILE_END();
 
 	com_dedicated->modified = qfalse;
 #ifndef DEDICATED
+	PROFILE_BEGIN( "CL_Init" );
 	CL_Init();
+	PROFILE_END();
 #endif
 
 	// set com_frameTime so that if a map is started on the
@@ -2845,7 +3527,9 @@ void Com_Init( char *commandLine ) {
 	// start in full screen ui mode
 	Cvar_Set("r_uiFullScreen", "1");
 
+	PROFILE_BEGIN( "CL_StartHunkUsers" );
 	CL_StartHunkUsers( qfalse );
+	PROFILE_END();
 
 	// make sure single player is off by default
 	Cvar_Set("ui_singlePlayerActive", "0");
@@ -2865,6 +3549,8 @@ void Com_Init( char *commandLine ) {
 	}
 
 	Com_Printf ("--- Common Initialization Complete ---\n");
+
+	Com_ProfileStartup( qtrue );
 }
 
 /*
@@ -3055,19 +3741,22 @@ int Com_ModifyMsec( int msec ) {
 /*
 =================
 Com_TimeVal
+
+Microseconds left until minUsec have passed since the last frame started
 =================
 */
+static int64_t	com_frameUsec;
 
-int Com_TimeVal(int minMsec)
+static int64_t Com_TimeVal(int64_t minUsec)
 {
-	int timeVal;
+	int64_t timeVal;
 
-	timeVal = Sys_Milliseconds() - com_frameTime;
+	timeVal = Sys_Microseconds() - com_frameUsec;
 
-	if(timeVal >= minMsec)
+	if(timeVal >= minUsec)
 		timeVal = 0;
 	else
-		timeVal = minMsec - timeVal;
+		timeVal = minUsec - timeVal;
 
 	return timeVal;
 }
@@ -3079,9 +3768,11 @@ Com_Frame
 */
 void Com_Frame( void ) {
 
-	int		msec, minMsec;
-	int		timeVal, timeValSV;
-	static int	lastTime = 0, bias = 0;
+	int		msec;
+	int64_t	minUsec, timeVal, timeValSV, spinUsec, pacingUsec;
+	int		delayMsec;
+	static int64_t	lastUsec = 0, bias = 0;
+	static int	lastTime = 0;
  
 	int		timeBeforeFirstEvents;
 	int		timeBeforeServer;
@@ -3094,6 +3785,11 @@ void Com_Frame( void ) {
 		return;			// an ERR_DROP was thrown
 	}
 
+	// everything handed out by Com_FrameAlloc last frame is dead now
+	Com_FrameReset();
+
+	Com_ProfileFrame( qfalse );
+
 	timeBeforeFirstEvents =0;
 	timeBeforeServer =0;
 	timeBeforeEvents =0;
@@ -3114,54 +3810,85 @@ void Com_Frame( void ) {
 	if(!com_timedemo->integer)
 	{
 		if(com_dedicated->integer)
-			minMsec = SV_FrameMsec();
+			minUsec = (int64_t)SV_FrameMsec() * 1000;
 		else
 		{
 			if(com_minimized->integer && com_maxfpsMinimized->integer > 0)
-				minMsec = 1000 / com_maxfpsMinimized->integer;
+				minUsec = 1000000 / com_maxfpsMinimized->integer;
 			else if(com_unfocused->integer && com_maxfpsUnfocused->integer > 0)
-				minMsec = 1000 / com_maxfpsUnfocused->integer;
+				minUsec = 1000000 / com_maxfpsUnfocused->integer;
 			else if(com_maxfps->integer > 0)
-				minMsec = 1000 / com_maxfps->integer;
+				minUsec = 1000000 / com_maxfps->integer;
 			else
-				minMsec = 1;
+				minUsec = 1000;
 			
-			timeVal = com_frameTime - lastTime;
-			bias += timeVal - minMsec;
+			timeVal = com_frameUsec - lastUsec;
+			bias += timeVal - minUsec;
 			
-			if(bias > minMsec)
-				bias = minMsec;
+			if(bias > minUsec)
+				bias = minUsec;
 			
-			// Adjust minMsec if previous frame took too long to render so
+			// Adjust minUsec if previous frame took too long to render so
 			// that framerate is stable at the requested value.
-			minMsec -= bias;
+			minUsec -= bias;
 		}
 	}
 	else
-		minMsec = 1;
+		minUsec = 1000;
+
+	// sleep in whole milliseconds until the deadline is within the
+	// spin budget, then poll the sockets until it has passed
+	spinUsec = com_spinBudget->integer;
+	if(spinUsec < 0)
+		spinUsec = 0;
 
 	do
 	{
 		if(com_sv_running->integer)
 		{
-			timeValSV = SV_SendQueuedPackets();
+			timeValSV = (int64_t)SV_SendQueuedPackets() * 1000;
 			
-			timeVal = Com_TimeVal(minMsec);
+			timeVal = Com_TimeVal(minUsec);
 
 			if(timeValSV < timeVal)
 				timeVal = timeValSV;
 		}
 		else
-			timeVal = Com_TimeVal(minMsec);
+			timeVal = Com_TimeVal(minUsec);
 		
-		if(com_busyWait->integer || timeVal < 1)
+		// wake up for the packets the network simulation holds back
+		delayMsec = NET_FlushPacketQueue();
+		if(delayMsec >= 0 && (int64_t)delayMsec * 1000 < timeVal)
+			timeVal = (int64_t)delayMsec * 1000;
+
+		if(com_busyWait->integer || timeVal <= spinUsec)
 			NET_Sleep(0);
 		else
-			NET_Sleep(timeVal - 1);
-	} while(Com_TimeVal(minMsec));
+			NET_Sleep((timeVal - spinUsec) / 1000);
+	} while(Com_TimeVal(minUsec));
+
+	// cl_inputPacing holds back sampling input
+	if(!com_dedicated->integer)
+	{
+		timeVal = CL_InputPacingUsec();
+		pacingUsec = Sys_Microseconds() + timeVal;
+
+		while(timeVal > 0)
+		{
+			if(com_busyWait->integer || timeVal <= spinUsec)
+				NET_Sleep(0);
+			else
+				NET_Sleep((timeVal - spinUsec) / 1000);
+
+			timeVal = pacingUsec - Sys_Microseconds();
+		}
+	}
 	
 	IN_Frame();
 
+	lastUsec = com_frameUsec;
+	com_frameUsec = Sys_Microseconds();
+
 	lastTime = com_frameTime;
 	com_frameTime = Com_EventLoop();
 	
@@ -3238,6 +3965,12 @@ void Com_Frame( void ) {
 
 
 	NET_FlushPacketQueue();
+	Sys_FlushPackets();
+
+	// queued file reads fill what is left of the frame
+	FS_AsyncFrame();
+
+	Com_MemStatsFrame();
 
 	//
 	// report timing information
@@ -3274,6 +4007,8 @@ void Com_Frame( void ) {
 
 	Com_ReadFromPipe( );
 
+	Com_ProfileFrame( qtrue );
+
 	com_frameNumber++;
 }
 
@@ -3283,11 +4018,15 @@ Com_Shutdown
 =================
 */
 void Com_Shutdown (void) {
+	Com_ShutdownJobs();
+
 	if (logfile) {
 		FS_FCloseFile (logfile);
 		logfile = 0;
 	}
 
+	Com_ShutdownWriter();
+
 	if ( com_journalFile ) {
 		FS_FCloseFile( com_journalFile );
 		com_journalFile = 0;
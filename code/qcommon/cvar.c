@@ -35,6 +35,29 @@ int			cvar_numIndexes;
 #define FILE_HASH_SIZE		256
 static	cvar_t	*hashTable[FILE_HASH_SIZE];
 
+// vmCvar_t registered by each module, so that a change only queues the
+// copies that refer to it and Cvar_UpdateTracked refreshes just those
+#define MAX_TRACKED_VMCVARS	MAX_CVARS
+
+typedef struct {
+	vmCvar_t	*vmCvar;
+	int			handle;
+	int			next;		// 1 + next entry for the same handle, 0 ends
+} trackedVmCvar_t;
+
+typedef struct {
+	trackedVmCvar_t	entries[MAX_TRACKED_VMCVARS];
+	int			numEntries;
+	int			first[MAX_CVARS];	// 1 + first entry per handle, 0 for none
+	int			dirty[MAX_CVARS];	// handles changed since the last update
+	int			numDirty;
+	qboolean	isDirty[MAX_CVARS];
+} cvarTracker_t;
+
+static	cvarTracker_t	cvar_trackers[CVAR_TRACK_MAX];
+
+static void Cvar_QueueTracked( cvar_t *var );
+
 /*
 ================
 return a hash value for the filename
@@ -434,6 +457,7 @@ cvar_t *Cvar_Get( const char *var_name, const char *var_value, int flags ) {
 	var->string = CopyString (var_value);
 	var->modified = qtrue;
 	var->modificationCount = 1;
+	Cvar_QueueTracked( var );
 	var->value = atof (var->string);
 	var->integer = atoi(var->string);
 	var->resetString = CopyString( var_value );
@@ -593,6 +617,7 @@ cvar_t *Cvar_Set2( const char *var_name, const char *value, qboolean force ) {
 			var->latchedString = CopyString(value);
 			var->modified = qtrue;
 			var->modificationCount++;
+			Cvar_QueueTracked( var );
 			return var;
 		}
 	}
@@ -610,6 +635,7 @@ cvar_t *Cvar_Set2( const char *var_name, const char *value, qboolean force ) {
 
 	var->modified = qtrue;
 	var->modificationCount++;
+	Cvar_QueueTracked( var );
 	
 	Z_Free (var->string);	// free the old value string
 	
@@ -1411,6 +1437,123 @@ void	Cvar_Update( vmCvar_t *vmCvar ) {
 	vmCvar->integer = cv->integer;
 }
 
+/*
+=====================
+Cvar_QueueTracked
+
+remembers a changed cvar for every module that registered it
+=====================
+*/
+static void Cvar_QueueTracked( cvar_t *var ) {
+	int				handle = var - cvar_indexes;
+	int				i;
+	cvarTracker_t	*t;
+
+	for ( i = 0, t = cvar_trackers; i < CVAR_TRACK_MAX; i++, t++ ) {
+		if ( !t->first[handle] || t->isDirty[handle] ) {
+			continue;
+		}
+		t->isDirty[handle] = qtrue;
+		t->dirty[t->numDirty++] = handle;
+	}
+}
+
+/*
+=====================
+Cvar_Track
+
+adds a vmCvar_t that was just set up by Cvar_Register to a module's list
+=====================
+*/
+void Cvar_Track( cvarTrack_t module, vmCvar_t *vmCvar ) {
+	cvarTracker_t	*t;
+	trackedVmCvar_t	*e;
+	int				i, *link;
+
+	if ( (unsigned)module >= CVAR_TRACK_MAX || !vmCvar ) {
+		return;
+	}
+	t = &cvar_trackers[module];
+
+	for ( i = 0, e = t->entries; i < t->numEntries; i++, e++ ) {
+		if ( e->vmCvar != vmCvar ) {
+			continue;
+		}
+		if ( e->handle == vmCvar->handle ) {
+			return;
+		}
+		// registered again under another name, unlink from the old cvar
+		for ( link = &t->first[e->handle]; *link != i + 1; link = &t->entries[*link - 1].next )
+			;
+		*link = e->next;
+		break;
+	}
+
+	if ( i == t->numEntries ) {
+		if ( t->numEntries == MAX_TRACKED_VMCVARS ) {
+			Com_Error( ERR_DROP, "Cvar_Track: MAX_TRACKED_VMCVARS hit" );
+		}
+		t->numEntries++;
+	}
+
+	e->vmCvar = vmCvar;
+	e->handle = vmCvar->handle;
+	e->next = t->first[e->handle];
+	t->first[e->handle] = i + 1;
+}
+
+/*
+=====================
+Cvar_UpdateTracked
+
+runs Cvar_Update on the module's copies of every cvar changed since
+the last call, returns the number of copies that changed
+=====================
+*/
+int Cvar_UpdateTracked( cvarTrack_t module ) {
+	cvarTracker_t	*t;
+	trackedVmCvar_t	*e;
+	int				i, entry, count;
+
+	if ( (unsigned)module >= CVAR_TRACK_MAX ) {
+		return 0;
+	}
+	t = &cvar_trackers[module];
+
+	count = 0;
+	for ( i = 0; i < t->numDirty; i++ ) {
+		t->isDirty[t->dirty[i]] = qfalse;
+
+		for ( entry = t->first[t->dirty[i]]; entry; entry = e->next ) {
+			int		modificationCount;
+
+			e = &t->entries[entry - 1];
+			modificationCount = e->vmCvar->modificationCount;
+			Cvar_Update( e->vmCvar );
+			if ( e->vmCvar->modificationCount != modificationCount ) {
+				count++;
+			}
+		}
+	}
+	t->numDirty = 0;
+
+	return count;
+}
+
+/*
+=====================
+Cvar_ClearTracked
+
+forgets a module's vmCvar_t, called whenever the module is loaded or freed
+=====================
+*/
+void Cvar_ClearTracked( cvarTrack_t module ) {
+	if ( (unsigned)module >= CVAR_TRACK_MAX ) {
+		return;
+	}
+	Com_Memset( &cvar_trackers[module], 0, sizeof( cvar_trackers[module] ) );
+}
+
 /*
 ==================
 Cvar_CompleteCvarName
@@ -0,0 +1,251 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// deflate.c -- a small deflate encoder
+
+// The bundled zlib only has the inflate half, so data the engine sends
+// compressed is packed here: one raw deflate block with the fixed codes,
+// matches found through hash chains.  A preset dictionary is taken as
+// the history before the data, the same as inflateSetDictionary does on
+// the other end.  The fixed codes give up some of what zlib would get,
+// which matters little for the short, repetitive strings this is for.
+
+#include "q_shared.h"
+#include "qcommon.h"
+
+#define	DEFLATE_WINDOW		32768
+#define	DEFLATE_MIN_MATCH	3
+#define	DEFLATE_MAX_MATCH	258
+#define	DEFLATE_HASH_BITS	13
+#define	DEFLATE_MAX_CHAIN	128		// candidates tried per position
+
+static const short	deflateLengthBase[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const byte	deflateLengthExtra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const unsigned short	deflateDistBase[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const byte	deflateDistExtra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+typedef struct {
+	byte		*out;
+	int			size;
+	int			bit;
+	qboolean	overflowed;
+} deflateBits_t;
+
+/*
+=================
+Deflate_PutBits
+
+Values go out first bit first
+=================
+*/
+static void Deflate_PutBits( deflateBits_t *b, unsigned value, int bits ) {
+	int		i;
+
+	if ( b->bit + bits > b->size << 3 ) {
+		b->overflowed = qtrue;
+		return;
+	}
+
+	for ( i = 0; i < bits; i++, b->bit++ ) {
+		if ( !( b->bit & 7 ) ) {
+			b->out[b->bit >> 3] = 0;
+		}
+		b->out[b->bit >> 3] |= ( ( value >> i ) & 1 ) << ( b->bit & 7 );
+	}
+}
+
+/*
+=================
+Deflate_PutCode
+
+Huffman codes go out last bit first
+=================
+*/
+static void Deflate_PutCode( deflateBits_t *b, unsigned code, int bits ) {
+	unsigned	reversed;
+	int			i;
+
+	reversed = 0;
+	for ( i = 0; i < bits; i++ ) {
+		reversed |= ( ( code >> i ) & 1 ) << ( bits - 1 - i );
+	}
+	Deflate_PutBits( b, reversed, bits );
+}
+
+/*
+=================
+Deflate_PutSymbol
+
+A literal/length symbol in the fixed code
+=================
+*/
+static void Deflate_PutSymbol( deflateBits_t *b, int symbol ) {
+	if ( symbol < 144 ) {
+		Deflate_PutCode( b, 0x30 + symbol, 8 );
+	} else if ( symbol < 256 ) {
+		Deflate_PutCode( b, 0x190 + symbol - 144, 9 );
+	} else if ( symbol < 280 ) {
+		Deflate_PutCode( b, symbol - 256, 7 );
+	} else {
+		Deflate_PutCode( b, 0xc0 + symbol - 280, 8 );
+	}
+}
+
+/*
+=================
+Deflate_PutMatch
+=================
+*/
+static void Deflate_PutMatch( deflateBits_t *b, int length, int dist ) {
+	int		i;
+
+	for ( i = 28; deflateLengthBase[i] > length; i-- ) {
+	}
+	Deflate_PutSymbol( b, 257 + i );
+	Deflate_PutBits( b, length - deflateLengthBase[i], deflateLengthExtra[i] );
+
+	for ( i = 29; deflateDistBase[i] > dist; i-- ) {
+	}
+	Deflate_PutCode( b, i, 5 );
+	Deflate_PutBits( b, dist - deflateDistBase[i], deflateDistExtra[i] );
+}
+
+#define	DEFLATE_HASH( p )	( ( ( (p)[0] << 10 ) ^ ( (p)[1] << 5 ) ^ (p)[2] ) & ( ( 1 << DEFLATE_HASH_BITS ) - 1 ) )
+
+/*
+=================
+Com_Deflate
+
+Packs in as raw deflate data following dict, which can be NULL.
+Returns the packed size, or 0 if it didn't fit in outSize bytes.
+=================
+*/
+int Com_Deflate( const void *dict, int dictLength, const void *in, int inLength, byte *out, int outSize ) {
+	deflateBits_t	b;
+	byte			*window;
+	int				*head, *prev;
+	int				total, pos, hash;
+	int				match, best, bestDist, len, chain, limit;
+
+	if ( !dict ) {
+		dictLength = 0;
+	}
+	// only the last window of the dictionary can be reached
+	if ( dictLength > DEFLATE_WINDOW ) {
+		dict = (const byte *)dict + dictLength - DEFLATE_WINDOW;
+		dictLength = DEFLATE_WINDOW;
+	}
+
+	total = dictLength + inLength;
+	window = Z_Malloc( PAD( total, sizeof( int ) ) + ( 1 << DEFLATE_HASH_BITS ) * sizeof( *head ) + total * sizeof( *prev ) );
+	head = (int *)PADP( window + total, sizeof( int ) );
+	prev = head + ( 1 << DEFLATE_HASH_BITS );
+
+	if ( dictLength ) {
+		Com_Memcpy( window, dict, dictLength );
+	}
+	Com_Memcpy( window + dictLength, in, inLength );
+	Com_Memset( head, -1, ( 1 << DEFLATE_HASH_BITS ) * sizeof( *head ) );
+
+	b.out = out;
+	b.size = outSize;
+	b.bit = 0;
+	b.overflowed = qfalse;
+
+	// a single, final block with the fixed codes
+	Deflate_PutBits( &b, 1, 1 );
+	Deflate_PutBits( &b, 1, 2 );
+
+	for ( pos = 0; pos < total && !b.overflowed; ) {
+		best = 0;
+		bestDist = 0;
+
+		if ( pos + DEFLATE_MIN_MATCH <= total ) {
+			hash = DEFLATE_HASH( window + pos );
+
+			if ( pos >= dictLength ) {
+				limit = MIN( DEFLATE_MAX_MATCH, total - pos );
+				for ( match = head[hash], chain = 0; match >= 0 && pos - match <= DEFLATE_WINDOW
+					&& chain < DEFLATE_MAX_CHAIN; match = prev[match], chain++ ) {
+					if ( window[match + best] != window[pos + best] ) {
+						continue;
+					}
+					for ( len = 0; len < limit && window[match + len] == window[pos + len]; len++ ) {
+					}
+					if ( len > best ) {
+						best = len;
+						bestDist = pos - match;
+						if ( len == limit ) {
+							break;
+						}
+					}
+				}
+			}
+
+			prev[pos] = head[hash];
+			head[hash] = pos;
+		}
+
+		// the dictionary is history only
+		if ( pos < dictLength ) {
+			pos++;
+			continue;
+		}
+
+		if ( best < DEFLATE_MIN_MATCH ) {
+			Deflate_PutSymbol( &b, window[pos] );
+			pos++;
+			continue;
+		}
+
+		Deflate_PutMatch( &b, best, bestDist );
+
+		// the positions inside the match can still start later ones
+		for ( pos++, best--; best > 0; pos++, best-- ) {
+			if ( pos + DEFLATE_MIN_MATCH <= total ) {
+				hash = DEFLATE_HASH( window + pos );
+				prev[pos] = head[hash];
+				head[hash] = pos;
+			}
+		}
+	}
+
+	Deflate_PutSymbol( &b, 256 );
+
+	Z_Free( window );
+
+	if ( b.overflowed ) {
+		return 0;
+	}
+	return ( b.bit + 7 ) >> 3;
+}
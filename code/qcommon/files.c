@@ -213,6 +213,7 @@ typedef struct fileInPack_s {
 	char					*name;		// name of the file
 	unsigned long			pos;		// file info position in zip
 	unsigned long			len;		// uncompress file size
+	unsigned long			crc;		// crc32 of the contents from the zip directory
 	struct	fileInPack_s*	next;		// next file in the hash
 } fileInPack_t;
 
@@ -221,7 +222,7 @@ typedef struct {
 	char			pakFilename[MAX_OSPATH];	// c:\quake3\baseq3\pak0.pk3
 	char			pakBasename[MAX_OSPATH];	// pak0
 	char			pakGamename[MAX_OSPATH];	// baseq3
-	unzFile			handle;						// handle to zip file
+	unzFile			handle;						// handle to zip file, opened on first read when loaded from the pak index
 	unsigned int	checksum;					// regular checksum
 	int				pure_checksum;				// checksum for pure
 	int				numfiles;					// number of files in pk3
@@ -229,6 +230,8 @@ typedef struct {
 	int				hashSize;					// hash table size (power of 2)
 	fileInPack_t*	*hashTable;					// hash table
 	fileInPack_t*	buildBuffer;				// buffer with the filenames etc.
+	fileInPack_t*	*sortedFiles;				// files by name, built on the first listing
+	int				numSortedFiles;
 } pack_t;
 
 typedef struct {
@@ -281,10 +284,12 @@ typedef struct qfile_us {
 typedef struct {
 	qfile_ut	handleFiles;
 	qboolean	handleSync;
+	qboolean	handleAsync;	// writes go through the writer thread
 	int			fileSize;
 	int			zipFilePos;
 	int			zipFileLen;
 	qboolean	zipFile;
+	pack_t		*pak;			// pak the file was opened from
 	char		name[MAX_ZPATH];
 } fileHandleData_t;
 
@@ -393,6 +398,217 @@ static long FS_HashFileName( const char *fname, int hashSize ) {
 	return hash;
 }
 
+/*
+=================
+PAK NAME HASH
+
+One table over the files of every pak in the search path, so a name
+that no pak holds costs a single probe instead of one per pak.  Each
+name points at the first search path holding it, packs before that one
+are skipped.  The table is rebuilt on the first lookup after the search
+path changes.
+=================
+*/
+
+typedef struct pakName_s {
+	const char			*name;
+	searchpath_t		*search;	// first search path holding the name
+	struct pakName_s	*next;
+} pakName_t;
+
+static pakName_t	**fs_pakNameHash;
+static pakName_t	*fs_pakNames;
+static int			fs_pakNameHashSize;
+static qboolean		fs_pakNamesValid;
+
+/*
+=================
+FS_InvalidatePakNames
+=================
+*/
+static void FS_InvalidatePakNames( void ) {
+	if ( fs_pakNameHash ) {
+		Z_Free( fs_pakNameHash );
+		Z_Free( fs_pakNames );
+	}
+	fs_pakNameHash = NULL;
+	fs_pakNames = NULL;
+	fs_pakNameHashSize = 0;
+	fs_pakNamesValid = qfalse;
+}
+
+/*
+=================
+FS_BuildPakNames
+=================
+*/
+static void FS_BuildPakNames( void ) {
+	searchpath_t	*search;
+	pakName_t		*entry;
+	int				numFiles, numNames, i;
+	long			hash;
+
+	FS_InvalidatePakNames();
+	fs_pakNamesValid = qtrue;
+
+	numFiles = 0;
+	for ( search = fs_searchpaths ; search ; search = search->next ) {
+		if ( search->pack ) {
+			numFiles += search->pack->numfiles;
+		}
+	}
+	if ( !numFiles ) {
+		return;
+	}
+
+	for ( fs_pakNameHashSize = 1 ; fs_pakNameHashSize < numFiles && fs_pakNameHashSize < 65536 ; fs_pakNameHashSize <<= 1 ) {
+	}
+
+	fs_pakNameHash = Z_Malloc( fs_pakNameHashSize * sizeof( *fs_pakNameHash ) );
+	fs_pakNames = Z_Malloc( numFiles * sizeof( *fs_pakNames ) );
+
+	numNames = 0;
+	for ( search = fs_searchpaths ; search ; search = search->next ) {
+		if ( !search->pack ) {
+			continue;
+		}
+
+		for ( i = 0 ; i < search->pack->numfiles ; i++ ) {
+			const char *name = search->pack->buildBuffer[i].name;
+
+			if ( !name ) {
+				continue;	// the pak's directory scan stopped early
+			}
+
+			hash = FS_HashFileName( name, fs_pakNameHashSize );
+			for ( entry = fs_pakNameHash[hash] ; entry ; entry = entry->next ) {
+				if ( !FS_FilenameCompare( entry->name, name ) ) {
+					break;
+				}
+			}
+			if ( entry ) {
+				continue;	// an earlier search path has it
+			}
+
+			entry = &fs_pakNames[numNames++];
+			entry->name = name;
+			entry->search = search;
+			entry->next = fs_pakNameHash[hash];
+			fs_pakNameHash[hash] = entry;
+		}
+	}
+}
+
+/*
+=================
+FS_FirstPakWithName
+
+Returns the first search path whose pak holds the file, or NULL
+=================
+*/
+static searchpath_t *FS_FirstPakWithName( const char *filename ) {
+	pakName_t	*entry;
+
+	if ( !fs_pakNamesValid ) {
+		FS_BuildPakNames();
+	}
+	if ( !fs_pakNameHash ) {
+		return NULL;
+	}
+
+	if ( filename[0] == '/' || filename[0] == '\\' ) {
+		filename++;
+	}
+
+	for ( entry = fs_pakNameHash[FS_HashFileName( filename, fs_pakNameHashSize )] ; entry ; entry = entry->next ) {
+		if ( !FS_FilenameCompare( entry->name, filename ) ) {
+			return entry->search;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+=================
+DIRECTORY LISTING CACHE
+
+Sys_ListFiles results for the directories in the search path, kept
+until something is written, renamed or removed through the file system
+or the search path is rebuilt, so repeated listings of the same folder
+don't hit the disk every time.
+=================
+*/
+
+typedef struct dirListing_s {
+	char				*netpath;
+	char				*extension;
+	char				*filter;
+	char				**files;
+	int					numFiles;
+	struct dirListing_s	*next;
+} dirListing_t;
+
+static dirListing_t	*fs_dirListings;
+
+/*
+=================
+FS_InvalidateDirListings
+=================
+*/
+static void FS_InvalidateDirListings( void ) {
+	dirListing_t	*dl, *next;
+
+	for ( dl = fs_dirListings ; dl ; dl = next ) {
+		next = dl->next;
+		Sys_FreeFileList( dl->files );
+		Z_Free( dl );
+	}
+	fs_dirListings = NULL;
+}
+
+/*
+=================
+FS_ListDirectory
+
+Sys_ListFiles through the cache.  The returned list belongs to the cache.
+=================
+*/
+static char **FS_ListDirectory( const char *netpath, const char *extension, char *filter, int *numFiles ) {
+	dirListing_t	*dl;
+	size_t			netpathLen, extensionLen, filterLen;
+
+	if ( !filter ) {
+		filter = "";
+	}
+
+	for ( dl = fs_dirListings ; dl ; dl = dl->next ) {
+		if ( !strcmp( dl->netpath, netpath ) && !strcmp( dl->extension, extension ) && !strcmp( dl->filter, filter ) ) {
+			*numFiles = dl->numFiles;
+			return dl->files;
+		}
+	}
+
+	netpathLen = strlen( netpath ) + 1;
+	extensionLen = strlen( extension ) + 1;
+	filterLen = strlen( filter ) + 1;
+
+	dl = Z_Malloc( sizeof( *dl ) + netpathLen + extensionLen + filterLen );
+	dl->netpath = (char *)( dl + 1 );
+	dl->extension = dl->netpath + netpathLen;
+	dl->filter = dl->extension + extensionLen;
+	Com_Memcpy( dl->netpath, netpath, netpathLen );
+	Com_Memcpy( dl->extension, extension, extensionLen );
+	Com_Memcpy( dl->filter, filter, filterLen );
+
+	dl->files = Sys_ListFiles( netpath, extension, filter[0] ? filter : NULL, &dl->numFiles, qfalse );
+	dl->next = fs_dirListings;
+	fs_dirListings = dl;
+
+	*numFiles = dl->numFiles;
+	return dl->files;
+}
+
 static fileHandle_t	FS_HandleForFile(void) {
 	int		i;
 
@@ -426,6 +642,10 @@ void	FS_ForceFlush( fileHandle_t f ) {
 	setvbuf( file, NULL, _IONBF, 0 );
 }
 
+void	FS_SetAsync( fileHandle_t f ) {
+	fsh[f].handleAsync = qtrue;
+}
+
 /*
 ================
 FS_fplength
@@ -566,6 +786,7 @@ qboolean FS_CreatePath (const char *OSPath) {
 		if (*ofs == PATH_SEP) {
 			// create the directory
 			*ofs = 0;
+			FS_InvalidateDirListings();
 			if (!Sys_Mkdir (path)) {
 				Com_Error( ERR_FATAL, "FS_CreatePath: failed to create path \"%s\"",
 					path );
@@ -606,6 +827,7 @@ FS_Remove
 void FS_Remove( const char *osPath ) {
 	FS_CheckFilenameIsMutable( osPath, __func__ );
 
+	FS_InvalidateDirListings();
 	remove( osPath );
 }
 
@@ -618,6 +840,7 @@ FS_Remove_HomeData
 void FS_Remove_HomeData( const char *homePath ) {
 	FS_CheckFilenameIsMutable( homePath, __func__ );
 
+	FS_InvalidateDirListings();
 	remove( FS_BuildOSPath( fs_homedatapath->string,
 			fs_gamedir, homePath ) );
 }
@@ -674,10 +897,10 @@ static qboolean FS_BaseDir_FileExists_HomeData( const char *file )
 
 /*
 ===========
-FS_OSPath_FOpenFileWrite
+FS_OSPath_FOpenFile
 ===========
 */
-static fileHandle_t FS_OSPath_FOpenFileWrite( const char *ospath, const char *filename ) {
+static fileHandle_t FS_OSPath_FOpenFile( const char *ospath, const char *filename, const char *mode ) {
 	fileHandle_t	f;
 
 	if ( !fs_searchpaths ) {
@@ -688,7 +911,7 @@ static fileHandle_t FS_OSPath_FOpenFileWrite( const char *ospath, const char *fi
 	fsh[f].zipFile = qfalse;
 
 	if ( fs_debug->integer ) {
-		Com_Printf( "FS_OSPath_FOpenFileWrite: %s\n", ospath );
+		Com_Printf( "FS_OSPath_FOpenFile: %s (%s)\n", ospath, mode );
 	}
 
 	FS_CheckFilenameIsMutable( ospath, __func__ );
@@ -697,7 +920,8 @@ static fileHandle_t FS_OSPath_FOpenFileWrite( const char *ospath, const char *fi
 		return 0;
 	}
 
-	fsh[f].handleFiles.file.o = Sys_FOpen( ospath, "wb" );
+	FS_InvalidateDirListings();
+	fsh[f].handleFiles.file.o = Sys_FOpen( ospath, mode );
 
 	Q_strncpyz( fsh[f].name, filename, sizeof( fsh[f].name ) );
 
@@ -708,6 +932,15 @@ static fileHandle_t FS_OSPath_FOpenFileWrite( const char *ospath, const char *fi
 	return f;
 }
 
+/*
+===========
+FS_OSPath_FOpenFileWrite
+===========
+*/
+static fileHandle_t FS_OSPath_FOpenFileWrite( const char *ospath, const char *filename ) {
+	return FS_OSPath_FOpenFile( ospath, filename, "wb" );
+}
+
 /*
 ===========
 FS_BaseDir_FOpenFileWrite_HomeConfig
@@ -738,6 +971,16 @@ fileHandle_t FS_BaseDir_FOpenFileWrite_HomeState( const char *filename ) {
 		FS_BaseDir_BuildOSPath(fs_homestatepath->string, filename), filename);
 }
 
+/*
+===========
+FS_BaseDir_FOpenFileAppend_HomeData
+===========
+*/
+fileHandle_t FS_BaseDir_FOpenFileAppend_HomeData( const char *filename ) {
+	return FS_OSPath_FOpenFile(
+		FS_BaseDir_BuildOSPath(fs_homedatapath->string, filename), filename, "ab");
+}
+
 /*
 ===========
 FS_BaseDir_FOpenFileRead
@@ -822,6 +1065,7 @@ void FS_BaseDir_Rename_HomeData( const char *from, const char *to, qboolean safe
 		FS_CheckFilenameIsMutable( to_ospath, __func__ );
 	}
 
+	FS_InvalidateDirListings();
 	rename(from_ospath, to_ospath);
 }
 
@@ -849,6 +1093,10 @@ void FS_FCloseFile( fileHandle_t f ) {
 		return;
 	}
 
+	if ( fsh[f].handleAsync ) {
+		Com_FlushWriter();
+	}
+
 	// we didn't find it as a pak, so close it as a unique file
 	if (fsh[f].handleFiles.file.o) {
 		fclose (fsh[f].handleFiles.file.o);
@@ -920,6 +1168,7 @@ fileHandle_t FS_FOpenFileAppend_HomeData( const char *filename ) {
 		return 0;
 	}
 
+	FS_InvalidateDirListings();
 	fsh[f].handleFiles.file.o = Sys_FOpen( ospath, "ab" );
 	fsh[f].handleSync = qfalse;
 	if (!fsh[f].handleFiles.file.o) {
@@ -1240,10 +1489,22 @@ long FS_FOpenFileReadDir(const char *filename, searchpath_t *search, fileHandle_
 							Com_Error(ERR_FATAL, "Couldn't open %s", pak->pakFilename);
 					}
 					else
+					{
+						if(!pak->handle)
+						{
+							// loaded from the pak index without opening it
+							pak->handle = unzOpen(pak->pakFilename);
+
+							if(pak->handle == NULL)
+								Com_Error(ERR_FATAL, "Couldn't open %s", pak->pakFilename);
+						}
+
 						fsh[*file].handleFiles.file.z = pak->handle;
+					}
 
 					Q_strncpyz(fsh[*file].name, filename, sizeof(fsh[*file].name));
 					fsh[*file].zipFile = qtrue;
+					fsh[*file].pak = pak;
 
 					// set the file position in the zip file (also sets the current file info)
 					unzSetOffset(fsh[*file].handleFiles.file.z, pakFile->pos);
@@ -1319,6 +1580,79 @@ long FS_FOpenFileReadDir(const char *filename, searchpath_t *search, fileHandle_
 	return -1;
 }
 
+/*
+===========
+FS_FileContentKey
+
+Finds the file the way FS_FOpenFileRead would.  If it comes from a pk3,
+the crc and size from the zip directory are returned as a key for its
+contents, so identical data under another name or in another pak can be
+recognized without reading it.  Returns 1 with the key filled in, 0 for
+a file on disk, which has no key, and -1 if the file isn't found.
+===========
+*/
+int FS_FileContentKey( const char *qpath, unsigned int *crc, unsigned int *length ) {
+	searchpath_t	*search;
+	searchpath_t	*firstPak;
+	qboolean		pastFirstPak;
+	fileInPack_t	*pakFile;
+	fileHandle_t	f;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+
+	if ( !qpath || !qpath[0] ) {
+		return -1;
+	}
+
+	// qpaths are not supposed to have a leading slash
+	if ( qpath[0] == '/' || qpath[0] == '\\' ) {
+		qpath++;
+	}
+
+	if ( strstr( qpath, ".." ) || strstr( qpath, "::" ) ) {
+		return -1;
+	}
+
+	firstPak = FS_FirstPakWithName( qpath );
+	pastFirstPak = qfalse;
+
+	for ( search = fs_searchpaths ; search ; search = search->next ) {
+		if ( search->pack ) {
+			// no pak before the first one holding the name has it
+			if ( !pastFirstPak ) {
+				if ( search != firstPak ) {
+					continue;
+				}
+				pastFirstPak = qtrue;
+			}
+
+			if ( !FS_PakIsPure( search->pack ) ) {
+				continue;
+			}
+
+			pakFile = search->pack->hashTable[FS_HashFileName( qpath, search->pack->hashSize )];
+			for ( ; pakFile ; pakFile = pakFile->next ) {
+				if ( !FS_FilenameCompare( pakFile->name, qpath ) ) {
+					*crc = (unsigned int)pakFile->crc;
+					*length = (unsigned int)pakFile->len;
+					return 1;
+				}
+			}
+		} else if ( search->dir ) {
+			// same restrictions as reading it
+			FS_FOpenFileReadDir( qpath, search, &f, qfalse, qfalse );
+			if ( f ) {
+				FS_FCloseFile( f );
+				return 0;
+			}
+		}
+	}
+
+	return -1;
+}
+
 /*
 ===========
 FS_FOpenFileRead
@@ -1332,12 +1666,20 @@ separate file or a ZIP file.
 long FS_FOpenFileRead(const char *filename, fileHandle_t *file, qboolean uniqueFILE)
 {
 	searchpath_t *search;
+	searchpath_t *firstPak;
+	qboolean pastFirstPak;
 	long len;
 	qboolean isLocalConfig;
 
 	if(!fs_searchpaths)
 		Com_Error(ERR_FATAL, "Filesystem call made without initialization");
 
+	if(filename == NULL)
+		Com_Error(ERR_FATAL, "FS_FOpenFileRead: NULL 'filename' parameter passed");
+
+	firstPak = FS_FirstPakWithName(filename);
+	pastFirstPak = qfalse;
+
 	isLocalConfig = !strcmp(filename, "autoexec.cfg") || !strcmp(filename, Q3CONFIG_CFG);
 	for(search = fs_searchpaths; search; search = search->next)
 	{
@@ -1345,6 +1687,14 @@ long FS_FOpenFileRead(const char *filename, fileHandle_t *file, qboolean uniqueF
 		if (isLocalConfig && search->pack)
 			continue;
 
+		// no pak before the first one holding the name has it
+		if (search->pack && !pastFirstPak)
+		{
+			if (search != firstPak)
+				continue;
+			pastFirstPak = qtrue;
+		}
+
 		len = FS_FOpenFileReadDir(filename, search, file, uniqueFILE, qfalse);
 
 		if(file == NULL)
@@ -1536,6 +1886,44 @@ int FS_Read( void *buffer, int len, fileHandle_t f ) {
 	}
 }
 
+/*
+=================
+FS_ReadWhole
+
+Reads an entire file from the start.  A compressed pk3 entry has all of
+its compressed data read at once into temp memory and inflated with a
+single call, straight into the buffer
+=================
+*/
+static int FS_ReadWhole( void *buffer, int len, fileHandle_t f ) {
+	unzFile	z;
+	uLong	size;
+	void	*scratch;
+	int		r;
+
+	if ( !f || !fsh[f].zipFile || len <= 0 ) {
+		return FS_Read( buffer, len, f );
+	}
+
+	z = fsh[f].handleFiles.file.z;
+	size = unzGetCurrentFileInflateSize( z );
+	if ( !size ) {
+		return FS_Read( buffer, len, f );
+	}
+
+	scratch = Hunk_AllocateTempMemory( size );
+	r = unzInflateCurrentFile( z, buffer, len, scratch, size );
+	Hunk_FreeTempMemory( scratch );
+
+	if ( r == UNZ_PARAMERROR ) {
+		// nothing was consumed, take the regular path
+		return FS_Read( buffer, len, f );
+	}
+
+	fs_readCount += len;
+	return r;
+}
+
 /*
 =================
 FS_Write
@@ -1561,6 +1949,10 @@ int FS_Write( const void *buffer, int len, fileHandle_t h ) {
 	f = FS_FileForHandle(h);
 	buf = (byte *)buffer;
 
+	if ( fsh[h].handleAsync && Com_QueueWrite( f, buffer, len, fsh[h].handleSync ) ) {
+		return len;
+	}
+
 	remaining = len;
 	tries = 0;
 	while (remaining) {
@@ -1614,6 +2006,10 @@ int FS_Seek( fileHandle_t f, long offset, int origin ) {
 		return -1;
 	}
 
+	if ( fsh[f].handleAsync ) {
+		Com_FlushWriter();
+	}
+
 	if (fsh[f].zipFile == qtrue) {
 		//FIXME: this is really, really crappy
 		//(but better than what was here before)
@@ -1765,6 +2161,130 @@ int	FS_FileIsInPAK(const char *filename, int *pChecksum ) {
 	return -1;
 }
 
+/*
+=================================================================
+
+HELD FILES
+
+A file loaded by one subsystem and needed again soon after by another,
+like a map loaded by the collision code and then by the renderer, can be
+held in the zone so the second read is a copy instead of a pak search
+and decompression.  Only one file is held, and the first read takes it.
+
+=================================================================
+*/
+
+static char		fs_heldName[MAX_QPATH];
+static byte		*fs_heldBuffer;
+static int		fs_heldLength;
+
+// views handed out by FS_MapFile
+#define	MAX_FILE_MAPPINGS	16
+
+typedef struct {
+	void		*view;
+	void		*base;
+	size_t		size;
+} fileMapping_t;
+
+static fileMapping_t	fs_mappings[MAX_FILE_MAPPINGS];
+
+static fileMapping_t *FS_FindMapping( const void *buffer ) {
+	int		i;
+
+	for ( i = 0 ; i < MAX_FILE_MAPPINGS ; i++ ) {
+		if ( fs_mappings[i].view && fs_mappings[i].view == buffer ) {
+			return &fs_mappings[i];
+		}
+	}
+	return NULL;
+}
+
+/*
+============
+FS_ReleaseHeldFile
+============
+*/
+void FS_ReleaseHeldFile( void ) {
+	if ( fs_heldBuffer ) {
+		Z_Free( fs_heldBuffer );
+	}
+	fs_heldBuffer = NULL;
+	fs_heldLength = 0;
+	fs_heldName[0] = '\0';
+}
+
+/*
+============
+FS_HoldFile
+============
+*/
+void FS_HoldFile( const char *qpath, const void *buffer, int len ) {
+	FS_ReleaseHeldFile();
+
+	if ( !qpath || !buffer || len <= 0 || strlen( qpath ) >= sizeof( fs_heldName ) ) {
+		return;
+	}
+
+	// mapping the file again is cheaper than a copy
+	if ( FS_FindMapping( buffer ) ) {
+		return;
+	}
+
+	// never starve the zone for a copy that only saves load time
+	if ( len > Z_AvailableMemory() / 2 ) {
+		Com_DPrintf( "FS_HoldFile: not holding %s, %i bytes\n", qpath, len );
+		return;
+	}
+
+	fs_heldBuffer = Z_Malloc( len );
+	Com_Memcpy( fs_heldBuffer, buffer, len );
+	fs_heldLength = len;
+	Q_strncpyz( fs_heldName, qpath, sizeof( fs_heldName ) );
+}
+
+/*
+============
+FS_HoldingFile
+============
+*/
+qboolean FS_HoldingFile( const char *qpath ) {
+	return ( fs_heldBuffer && !FS_FilenameCompare( qpath, fs_heldName ) ) ? qtrue : qfalse;
+}
+
+/*
+============
+FS_ReadHeldFile
+
+Returns -1 if qpath is not the held file
+============
+*/
+static long FS_ReadHeldFile( const char *qpath, void **buffer ) {
+	byte	*buf;
+	long	len;
+
+	if ( !fs_heldBuffer || Q_stricmp( qpath, fs_heldName ) ) {
+		return -1;
+	}
+
+	len = fs_heldLength;
+	if ( !buffer ) {
+		return len;
+	}
+
+	fs_loadCount++;
+	fs_loadStack++;
+
+	buf = Hunk_AllocateTempMemory( len + 1 );
+	Com_Memcpy( buf, fs_heldBuffer, len );
+	buf[len] = 0;
+	*buffer = buf;
+
+	FS_ReleaseHeldFile();
+
+	return len;
+}
+
 /*
 ============
 FS_ReadFileDir
@@ -1839,6 +2359,13 @@ long FS_ReadFileDir(const char *qpath, void *searchPath, qboolean unpure, void *
 
 	search = searchPath;
 
+	if ( search == NULL && !isConfig ) {
+		len = FS_ReadHeldFile( qpath, buffer );
+		if ( len >= 0 ) {
+			return len;
+		}
+	}
+
 	if(search == NULL)
 	{
 		// look for it in the filesystem or pack files
@@ -1880,54 +2407,422 @@ long FS_ReadFileDir(const char *qpath, void *searchPath, qboolean unpure, void *
 	buf = Hunk_AllocateTempMemory(len+1);
 	*buffer = buf;
 
-	FS_Read (buf, len, h);
+	FS_ReadWhole (buf, len, h);
 
 	// guarantee that it will have a trailing 0 for string operations
 	buf[len] = 0;
 	FS_FCloseFile( h );
 
-	// if we are journalling and it is a config file, write it to the journal file
-	if ( isConfig && com_journal && com_journal->integer == 1 ) {
-		Com_DPrintf( "Writing %s to journal file.\n", qpath );
-		FS_Write( &len, sizeof( len ), com_journalDataFile );
-		FS_Write( buf, len, com_journalDataFile );
-		FS_Flush( com_journalDataFile );
+	// if we are journalling and it is a config file, write it to the journal file
+	if ( isConfig && com_journal && com_journal->integer == 1 ) {
+		Com_DPrintf( "Writing %s to journal file.\n", qpath );
+		FS_Write( &len, sizeof( len ), com_journalDataFile );
+		FS_Write( buf, len, com_journalDataFile );
+		FS_Flush( com_journalDataFile );
+	}
+	return len;
+}
+
+/*
+============
+FS_ReadFile
+
+Filename are relative to the quake search path
+a null buffer will just return the file length without loading
+============
+*/
+long FS_ReadFile(const char *qpath, void **buffer)
+{
+	return FS_ReadFileDir(qpath, NULL, qfalse, buffer);
+}
+
+/*
+=============
+FS_FreeFile
+=============
+*/
+void FS_FreeFile( void *buffer ) {
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+	if ( !buffer ) {
+		Com_Error( ERR_FATAL, "FS_FreeFile( NULL )" );
+	}
+	fs_loadStack--;
+
+	Hunk_FreeTempMemory( buffer );
+
+	// if all of our temp files are free, clear all of our space
+	if ( fs_loadStack == 0 ) {
+		Hunk_ClearTempMemory();
+	}
+}
+
+/*
+============
+FS_MapFile
+
+Returns a copy-on-write view of the file when it is a loose file or
+stored uncompressed in its pak, otherwise falls back to FS_ReadFile.
+Unlike FS_ReadFile a mapped view has no trailing 0.  Either way the
+buffer has to be released with FS_UnmapFile.
+============
+*/
+long FS_MapFile( const char *qpath, void **buffer ) {
+	fileHandle_t	h;
+	fileMapping_t	*map;
+	FILE			*f;
+	long			len;
+	int64_t			offset;
+	int				i;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+
+	if ( !qpath || !qpath[0] ) {
+		Com_Error( ERR_FATAL, "FS_MapFile with empty name" );
+	}
+
+	// configs can be journaled, and a held copy is already loaded
+	if ( !buffer || strstr( qpath, ".cfg" ) || ( fs_heldBuffer && !FS_FilenameCompare( qpath, fs_heldName ) ) ) {
+		return FS_ReadFile( qpath, buffer );
+	}
+
+	for ( i = 0 ; i < MAX_FILE_MAPPINGS ; i++ ) {
+		if ( !fs_mappings[i].view ) {
+			break;
+		}
+	}
+	if ( i == MAX_FILE_MAPPINGS ) {
+		return FS_ReadFile( qpath, buffer );
+	}
+	map = &fs_mappings[i];
+
+	len = FS_FOpenFileRead( qpath, &h, qfalse );
+	if ( !h ) {
+		*buffer = NULL;
+		return -1;
+	}
+
+	f = NULL;
+	offset = 0;
+	if ( len > 0 ) {
+		if ( !fsh[h].zipFile ) {
+			map->view = Sys_MapFile( fsh[h].handleFiles.file.o, 0, len, &map->base, &map->size );
+		} else if ( fsh[h].pak ) {
+			offset = unzGetCurrentFileStoredOffset( fsh[h].handleFiles.file.z );
+			if ( offset ) {
+				f = Sys_FOpen( fsh[h].pak->pakFilename, "rb" );
+			}
+			if ( f ) {
+				map->view = Sys_MapFile( f, offset, len, &map->base, &map->size );
+				fclose( f );
+			}
+		}
+	}
+	FS_FCloseFile( h );
+
+	if ( !map->view ) {
+		return FS_ReadFile( qpath, buffer );
+	}
+
+	if ( fs_debug->integer ) {
+		Com_Printf( "FS_MapFile: %s (%li bytes)\n", qpath, len );
+	}
+
+	fs_loadCount++;
+	*buffer = map->view;
+	return len;
+}
+
+/*
+=============
+FS_UnmapFile
+=============
+*/
+void FS_UnmapFile( void *buffer ) {
+	fileMapping_t	*map;
+
+	map = FS_FindMapping( buffer );
+	if ( !map ) {
+		FS_FreeFile( buffer );
+		return;
+	}
+
+	Sys_UnmapFile( map->base, map->size );
+	Com_Memset( map, 0, sizeof( *map ) );
+}
+
+/*
+=================================================================
+
+ASYNC READS
+
+FS_ReadFileAsync queues a file and FS_AsyncFrame reads a slice of the
+queued files at the end of every frame, bounded by fs_asyncBudget, so a
+late load is spread over a few frames instead of stalling one.  The
+engine has no worker threads, so the reads still run on the main thread
+in between frames.  Callers poll their handle and free it when done;
+FS_AsyncReadWait finishes a read right away when it is needed now.
+
+=================================================================
+*/
+
+#define	MAX_ASYNC_READS		16
+
+typedef enum {
+	ASYNC_FREE,
+	ASYNC_PENDING,
+	ASYNC_DONE,
+	ASYNC_FAILED
+} asyncState_t;
+
+typedef struct {
+	asyncState_t	state;
+	fileHandle_t	file;
+	byte			*buffer;
+	long			length;
+	long			read;
+} asyncRead_t;
+
+static asyncRead_t	fs_asyncReads[MAX_ASYNC_READS];
+static cvar_t		*fs_asyncBudget;
+
+static asyncRead_t *FS_AsyncRead( int handle ) {
+	if ( handle < 1 || handle > MAX_ASYNC_READS || fs_asyncReads[handle - 1].state == ASYNC_FREE ) {
+		Com_Error( ERR_FATAL, "FS_AsyncRead: bad handle %i", handle );
+	}
+	return &fs_asyncReads[handle - 1];
+}
+
+/*
+=================
+FS_AsyncReadSome
+
+Reads up to the given number of bytes of a pending file, returns how
+many were read
+=================
+*/
+static long FS_AsyncReadSome( asyncRead_t *ar, long bytes ) {
+	long	r;
+
+	if ( bytes > ar->length - ar->read ) {
+		bytes = ar->length - ar->read;
+	}
+
+	if ( bytes <= 0 ) {
+		r = 0;
+	} else if ( !ar->read && bytes == ar->length ) {
+		r = FS_ReadWhole( ar->buffer, bytes, ar->file );
+	} else {
+		r = FS_Read( ar->buffer + ar->read, bytes, ar->file );
+	}
+	if ( r < bytes ) {
+		ar->state = ASYNC_FAILED;
+	} else {
+		ar->read += r;
+		if ( ar->read == ar->length ) {
+			ar->buffer[ar->length] = 0;
+			ar->state = ASYNC_DONE;
+		}
+	}
+
+	if ( ar->state != ASYNC_PENDING ) {
+		FS_FCloseFile( ar->file );
+		ar->file = 0;
+	}
+
+	return r;
+}
+
+/*
+=================
+FS_ReadFileAsync
+
+Queues a file to be read over the next frames.  Returns a handle to
+poll with FS_AsyncReadStatus, or 0 if the file can't be found or the
+queue is full, in which case FS_ReadFile is the way to go
+=================
+*/
+int FS_ReadFileAsync( const char *qpath ) {
+	asyncRead_t	*ar;
+	long		len;
+	int			i;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+	}
+
+	if ( !qpath || !qpath[0] ) {
+		Com_Error( ERR_FATAL, "FS_ReadFileAsync with empty name" );
+	}
+
+	for ( i = 0 ; i < MAX_ASYNC_READS ; i++ ) {
+		if ( fs_asyncReads[i].state == ASYNC_FREE ) {
+			break;
+		}
+	}
+	if ( i == MAX_ASYNC_READS ) {
+		return 0;
+	}
+	ar = &fs_asyncReads[i];
+
+	// a handle of its own, so reads in between don't move its position
+	len = FS_FOpenFileRead( qpath, &ar->file, qtrue );
+	if ( !ar->file ) {
+		return 0;
+	}
+
+	// the buffer lives across frames, so it can't come from the temp hunk
+	if ( len < 0 || len >= Z_AvailableMemory() / 2 ) {
+		FS_FCloseFile( ar->file );
+		ar->file = 0;
+		return 0;
+	}
+
+	ar->buffer = Z_Malloc( len + 1 );
+	ar->length = len;
+	ar->read = 0;
+	ar->state = ASYNC_PENDING;
+	fs_loadCount++;
+
+	if ( !len ) {
+		FS_AsyncReadSome( ar, 0 );
+	}
+
+	return i + 1;
+}
+
+/*
+=================
+FS_AsyncReadStatus
+
+Returns qfalse while the read is still going.  Once it is over the
+buffer and length are filled in, with a NULL buffer if it failed
+=================
+*/
+qboolean FS_AsyncReadStatus( int handle, void **buffer, long *length ) {
+	asyncRead_t	*ar = FS_AsyncRead( handle );
+
+	if ( ar->state == ASYNC_PENDING ) {
+		return qfalse;
+	}
+
+	if ( ar->state == ASYNC_DONE ) {
+		*buffer = ar->buffer;
+		*length = ar->length;
+	} else {
+		*buffer = NULL;
+		*length = -1;
+	}
+	return qtrue;
+}
+
+/*
+=================
+FS_AsyncReadWait
+
+Reads whatever is left of the file right away
+=================
+*/
+void FS_AsyncReadWait( int handle, void **buffer, long *length ) {
+	asyncRead_t	*ar = FS_AsyncRead( handle );
+
+	if ( ar->state == ASYNC_PENDING ) {
+		FS_AsyncReadSome( ar, ar->length - ar->read );
+	}
+	FS_AsyncReadStatus( handle, buffer, length );
+}
+
+/*
+=================
+FS_AsyncReadFree
+
+Cancels the read if it is still going and frees its buffer
+=================
+*/
+void FS_AsyncReadFree( int handle ) {
+	asyncRead_t	*ar = FS_AsyncRead( handle );
+
+	if ( ar->file ) {
+		FS_FCloseFile( ar->file );
 	}
-	return len;
+	if ( ar->buffer ) {
+		Z_Free( ar->buffer );
+	}
+	Com_Memset( ar, 0, sizeof( *ar ) );
 }
 
 /*
-============
-FS_ReadFile
+=================
+FS_HoldAsyncRead
 
-Filename are relative to the quake search path
-a null buffer will just return the file length without loading
-============
+Makes a finished read the held file, its buffer changes hands
+instead of being copied.  The handle is freed either way.
+=================
 */
-long FS_ReadFile(const char *qpath, void **buffer)
-{
-	return FS_ReadFileDir(qpath, NULL, qfalse, buffer);
+void FS_HoldAsyncRead( int handle, const char *qpath ) {
+	asyncRead_t	*ar = FS_AsyncRead( handle );
+
+	FS_ReleaseHeldFile();
+
+	if ( ar->state == ASYNC_DONE && strlen( qpath ) < sizeof( fs_heldName ) ) {
+		fs_heldBuffer = ar->buffer;
+		fs_heldLength = ar->length;
+		Q_strncpyz( fs_heldName, qpath, sizeof( fs_heldName ) );
+		ar->buffer = NULL;
+	}
+
+	FS_AsyncReadFree( handle );
 }
 
 /*
-=============
-FS_FreeFile
-=============
+=================
+FS_AsyncFrame
+
+Spends this frame's read budget on the queued files, oldest first
+=================
 */
-void FS_FreeFile( void *buffer ) {
-	if ( !fs_searchpaths ) {
-		Com_Error( ERR_FATAL, "Filesystem call made without initialization" );
+void FS_AsyncFrame( void ) {
+	asyncRead_t	*ar;
+	long		budget;
+	int			i;
+
+	if ( !fs_searchpaths || !fs_asyncBudget ) {
+		return;
 	}
-	if ( !buffer ) {
-		Com_Error( ERR_FATAL, "FS_FreeFile( NULL )" );
+
+	budget = fs_asyncBudget->integer * 1024;
+	if ( budget <= 0 ) {
+		budget = 0x7fffffff;	// no budget, finish everything queued
 	}
-	fs_loadStack--;
 
-	Hunk_FreeTempMemory( buffer );
+	for ( i = 0, ar = fs_asyncReads ; i < MAX_ASYNC_READS && budget > 0 ; i++, ar++ ) {
+		if ( ar->state == ASYNC_PENDING ) {
+			budget -= FS_AsyncReadSome( ar, budget );
+		}
+	}
+}
 
-	// if all of our temp files are free, clear all of our space
-	if ( fs_loadStack == 0 ) {
-		Hunk_ClearTempMemory();
+/*
+=================
+FS_AsyncShutdown
+
+The search paths the open handles point into are going away, so the
+reads still going fail.  Finished buffers stay until they are freed.
+=================
+*/
+static void FS_AsyncShutdown( void ) {
+	asyncRead_t	*ar;
+	int			i;
+
+	for ( i = 0, ar = fs_asyncReads ; i < MAX_ASYNC_READS ; i++, ar++ ) {
+		if ( ar->state == ASYNC_PENDING ) {
+			FS_FCloseFile( ar->file );
+			ar->file = 0;
+			ar->state = ASYNC_FAILED;
+		}
 	}
 }
 
@@ -1962,6 +2857,296 @@ void FS_WriteFile( const char *qpath, const void *buffer, int size ) {
 
 
 
+/*
+==========================================================================
+
+PAK INDEX
+
+Walking the central directory of every pk3 dominates FS_Startup on big
+installs, so the file lists and crcs are kept in pakindex.dat under the
+home state path, keyed by the pak's os path, size and modification time.
+The pure checksum depends on the server's checksum feed, so the crcs are
+kept instead of the checksums and both are rebuilt from them on load.
+
+Each record is
+	int		path length, including the terminator
+	char	path
+	int		size low, size high, mtime low, mtime high
+	int		number of files
+	int		length of the name block
+	int		pos, len, crc for each file
+	char	every lowercased file name, each with a terminator
+
+==========================================================================
+*/
+
+#define	PAKINDEX_FILE		"pakindex.dat"
+#define	PAKINDEX_IDENT		(('X'<<24)+('I'<<16)+('K'<<8)+'P')
+#define	PAKINDEX_VERSION	1
+
+typedef struct pakIndex_s {
+	struct pakIndex_s	*next;
+	int					length;
+	byte				data[1];	// variable sized record
+} pakIndex_t;
+
+typedef struct {
+	int			numFiles;
+	const byte	*files;				// pos, len and crc for each file
+	const char	*names;
+	int			namesLength;
+} pakIndexFiles_t;
+
+static pakIndex_t	*fs_pakIndex;
+static qboolean		fs_pakIndexModified;
+
+static int FS_PakIndexInt( const byte *p ) {
+	int		v;
+
+	Com_Memcpy( &v, p, sizeof( v ) );
+	return LittleLong( v );
+}
+
+static byte *FS_PakIndexPutInt( byte *p, int v ) {
+	v = LittleLong( v );
+	Com_Memcpy( p, &v, sizeof( v ) );
+	return p + sizeof( v );
+}
+
+/*
+=================
+FS_PakIndexParse
+
+Checks that a record is complete and points at its file list, returns
+the path it is for or NULL if the record is damaged
+=================
+*/
+static const char *FS_PakIndexParse( const pakIndex_t *idx, int64_t *size, int64_t *mtime, pakIndexFiles_t *files ) {
+	const byte	*p, *end;
+	const char	*path;
+	int			pathLength, count, i;
+
+	p = idx->data;
+	end = idx->data + idx->length;
+
+	if ( end - p < 4 ) {
+		return NULL;
+	}
+	pathLength = FS_PakIndexInt( p );
+	p += 4;
+	if ( pathLength < 1 || pathLength > MAX_OSPATH || end - p < pathLength + 24 ) {
+		return NULL;
+	}
+	path = (const char *)p;
+	if ( path[pathLength - 1] ) {
+		return NULL;
+	}
+	p += pathLength;
+
+	*size = (int64_t)(unsigned int)FS_PakIndexInt( p ) | ( (int64_t)FS_PakIndexInt( p + 4 ) << 32 );
+	*mtime = (int64_t)(unsigned int)FS_PakIndexInt( p + 8 ) | ( (int64_t)FS_PakIndexInt( p + 12 ) << 32 );
+	files->numFiles = FS_PakIndexInt( p + 16 );
+	files->namesLength = FS_PakIndexInt( p + 20 );
+	p += 24;
+
+	if ( files->numFiles < 0 || files->namesLength < 0 || files->numFiles > ( end - p ) / 12
+		|| end - p != files->numFiles * 12 + files->namesLength ) {
+		return NULL;
+	}
+	files->files = p;
+	files->names = (const char *)p + files->numFiles * 12;
+
+	// every name has to be terminated inside the block
+	if ( files->namesLength && files->names[files->namesLength - 1] ) {
+		return NULL;
+	}
+	for ( i = 0, count = 0 ; i < files->namesLength ; i++ ) {
+		if ( !files->names[i] ) {
+			count++;
+		}
+	}
+	if ( count != files->numFiles ) {
+		return NULL;
+	}
+
+	return path;
+}
+
+/*
+=================
+FS_FreePakIndex
+=================
+*/
+static void FS_FreePakIndex( void ) {
+	pakIndex_t	*idx, *next;
+
+	for ( idx = fs_pakIndex ; idx ; idx = next ) {
+		next = idx->next;
+		Z_Free( idx );
+	}
+	fs_pakIndex = NULL;
+	fs_pakIndexModified = qfalse;
+}
+
+/*
+=================
+FS_LoadPakIndex
+
+Reads the records saved by an earlier startup, stopping at the first
+damaged one
+=================
+*/
+static void FS_LoadPakIndex( void ) {
+	FILE		*f;
+	pakIndex_t	*idx, **tail;
+	int			header[3], length;
+
+	FS_FreePakIndex();
+
+	f = Sys_FOpen( FS_BaseDir_BuildOSPath( fs_homestatepath->string, PAKINDEX_FILE ), "rb" );
+	if ( !f ) {
+		return;
+	}
+
+	if ( fread( header, sizeof( header ), 1, f ) != 1
+		|| LittleLong( header[0] ) != PAKINDEX_IDENT || LittleLong( header[1] ) != PAKINDEX_VERSION ) {
+		fclose( f );
+		fs_pakIndexModified = qtrue;	// rewrite it in the current format
+		return;
+	}
+
+	tail = &fs_pakIndex;
+	while ( fread( &length, sizeof( length ), 1, f ) == 1 ) {
+		length = LittleLong( length );
+		if ( length <= 0 || length > 16 * 1024 * 1024 ) {
+			fs_pakIndexModified = qtrue;
+			break;
+		}
+
+		idx = Z_Malloc( sizeof( *idx ) + length );
+		idx->length = length;
+		if ( fread( idx->data, length, 1, f ) != 1 ) {
+			Z_Free( idx );
+			fs_pakIndexModified = qtrue;
+			break;
+		}
+
+		*tail = idx;
+		tail = &idx->next;
+	}
+
+	fclose( f );
+}
+
+/*
+=================
+FS_WritePakIndex
+
+Saves the index if a pak was scanned this startup, then drops it
+=================
+*/
+static void FS_WritePakIndex( void ) {
+	FILE		*f;
+	pakIndex_t	*idx;
+	int			header[3], length;
+
+	if ( fs_pakIndexModified ) {
+		f = Sys_FOpen( FS_BaseDir_BuildOSPath( fs_homestatepath->string, PAKINDEX_FILE ), "wb" );
+		if ( f ) {
+			header[0] = LittleLong( PAKINDEX_IDENT );
+			header[1] = LittleLong( PAKINDEX_VERSION );
+			header[2] = 0;
+			fwrite( header, sizeof( header ), 1, f );
+
+			for ( idx = fs_pakIndex ; idx ; idx = idx->next ) {
+				length = LittleLong( idx->length );
+				fwrite( &length, sizeof( length ), 1, f );
+				fwrite( idx->data, idx->length, 1, f );
+			}
+			fclose( f );
+		}
+	}
+
+	FS_FreePakIndex();
+}
+
+/*
+=================
+FS_FindPakIndex
+
+Returns the file list saved for an unchanged pak
+=================
+*/
+static qboolean FS_FindPakIndex( const char *zipfile, int64_t size, int64_t mtime, pakIndexFiles_t *files ) {
+	pakIndex_t	*idx;
+	const char	*path;
+	int64_t		idxSize, idxTime;
+
+	for ( idx = fs_pakIndex ; idx ; idx = idx->next ) {
+		path = FS_PakIndexParse( idx, &idxSize, &idxTime, files );
+		if ( path && !strcmp( path, zipfile ) ) {
+			return idxSize == size && idxTime == mtime;
+		}
+	}
+
+	return qfalse;
+}
+
+/*
+=================
+FS_AddPakIndex
+
+Records the file list of a freshly scanned pak, replacing what was
+saved for the same path
+=================
+*/
+static void FS_AddPakIndex( const char *zipfile, int64_t size, int64_t mtime,
+	const fileInPack_t *files, const int *crcs, int numFiles, int namesLength ) {
+	pakIndex_t	*idx, **prev;
+	byte		*p;
+	int			pathLength, length, i;
+
+	pathLength = strlen( zipfile ) + 1;
+	length = 4 + pathLength + 24 + numFiles * 12 + namesLength;
+
+	idx = Z_Malloc( sizeof( *idx ) + length );
+	idx->length = length;
+
+	p = FS_PakIndexPutInt( idx->data, pathLength );
+	Com_Memcpy( p, zipfile, pathLength );
+	p += pathLength;
+	p = FS_PakIndexPutInt( p, (int)( size & 0xffffffff ) );
+	p = FS_PakIndexPutInt( p, (int)( size >> 32 ) );
+	p = FS_PakIndexPutInt( p, (int)( mtime & 0xffffffff ) );
+	p = FS_PakIndexPutInt( p, (int)( mtime >> 32 ) );
+	p = FS_PakIndexPutInt( p, numFiles );
+	p = FS_PakIndexPutInt( p, namesLength );
+	for ( i = 0 ; i < numFiles ; i++ ) {
+		p = FS_PakIndexPutInt( p, (int)files[i].pos );
+		p = FS_PakIndexPutInt( p, (int)files[i].len );
+		p = FS_PakIndexPutInt( p, crcs[i] );
+	}
+	// the names were laid out back to back after the file table
+	if ( numFiles ) {
+		Com_Memcpy( p, files[0].name, namesLength );
+	}
+
+	// drop the stale record for this path
+	for ( prev = &fs_pakIndex ; *prev ; prev = &(*prev)->next ) {
+		if ( (*prev)->length > 4 + pathLength && !strcmp( (const char *)(*prev)->data + 4, zipfile ) ) {
+			pakIndex_t	*stale = *prev;
+
+			*prev = stale->next;
+			Z_Free( stale );
+			break;
+		}
+	}
+
+	idx->next = fs_pakIndex;
+	fs_pakIndex = idx;
+	fs_pakIndexModified = qtrue;
+}
+
 /*
 ==========================================================================
 
@@ -1992,25 +3177,45 @@ static pack_t *FS_LoadZipFile(const char *zipfile, const char *basename)
 	int				fs_numHeaderLongs;
 	int				*fs_headerLongs;
 	char			*namePtr;
+	int64_t			size, mtime;
+	qboolean		indexed, haveStat;
+	pakIndexFiles_t	indexFiles;
+	const byte		*indexFile;
+	const char		*indexName;
+	int				*crcs;
+	unsigned long	crc;
 
 	fs_numHeaderLongs = 0;
 
-	uf = unzOpen(zipfile);
-	err = unzGetGlobalInfo (uf,&gi);
+	haveStat = Sys_FileStat( zipfile, &size, &mtime );
+	indexed = haveStat && FS_FindPakIndex( zipfile, size, mtime, &indexFiles );
 
-	if (err != UNZ_OK)
-		return NULL;
+	// a pak the index knows isn't opened until a file is read from it
+	if ( indexed ) {
+		uf = NULL;
+		gi.number_entry = indexFiles.numFiles;
+	} else {
+		uf = unzOpen(zipfile);
+		err = unzGetGlobalInfo (uf,&gi);
+
+		if (err != UNZ_OK)
+			return NULL;
+	}
 
 	len = 0;
-	unzGoToFirstFile(uf);
-	for (i = 0; i < gi.number_entry; i++)
-	{
-		err = unzGetCurrentFileInfo(uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0);
-		if (err != UNZ_OK) {
-			break;
+	if ( indexed ) {
+		len = indexFiles.namesLength;
+	} else {
+		unzGoToFirstFile(uf);
+		for (i = 0; i < gi.number_entry; i++)
+		{
+			err = unzGetCurrentFileInfo(uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0);
+			if (err != UNZ_OK) {
+				break;
+			}
+			len += strlen(filename_inzip) + 1;
+			unzGoToNextFile(uf);
 		}
-		len += strlen(filename_inzip) + 1;
-		unzGoToNextFile(uf);
 	}
 
 	buildBuffer = Z_Malloc( (gi.number_entry * sizeof( fileInPack_t )) + len );
@@ -2043,28 +3248,58 @@ static pack_t *FS_LoadZipFile(const char *zipfile, const char *basename)
 
 	pack->handle = uf;
 	pack->numfiles = gi.number_entry;
-	unzGoToFirstFile(uf);
+
+	crcs = NULL;
+	if ( indexed ) {
+		indexFile = indexFiles.files;
+		indexName = indexFiles.names;
+	} else {
+		crcs = Z_Malloc( ( gi.number_entry + 1 ) * sizeof(int) );
+		unzGoToFirstFile(uf);
+	}
 
 	for (i = 0; i < gi.number_entry; i++)
 	{
-		err = unzGetCurrentFileInfo(uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0);
-		if (err != UNZ_OK) {
-			break;
+		if ( indexed ) {
+			Q_strncpyz( filename_inzip, indexName, sizeof( filename_inzip ) );
+			indexName += strlen( indexName ) + 1;
+			buildBuffer[i].pos = (unsigned int)FS_PakIndexInt( indexFile );
+			buildBuffer[i].len = (unsigned int)FS_PakIndexInt( indexFile + 4 );
+			crc = (unsigned int)FS_PakIndexInt( indexFile + 8 );
+			indexFile += 12;
+		} else {
+			err = unzGetCurrentFileInfo(uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0);
+			if (err != UNZ_OK) {
+				break;
+			}
+			Q_strlwr( filename_inzip );
+			// store the file position in the zip
+			buildBuffer[i].pos = unzGetOffset(uf);
+			buildBuffer[i].len = file_info.uncompressed_size;
+			crc = file_info.crc;
+			crcs[i] = crc;
 		}
-		if (file_info.uncompressed_size > 0) {
-			fs_headerLongs[fs_numHeaderLongs++] = LittleLong(file_info.crc);
+		buildBuffer[i].crc = crc;
+		if (buildBuffer[i].len > 0) {
+			fs_headerLongs[fs_numHeaderLongs++] = LittleLong(crc);
 		}
-		Q_strlwr( filename_inzip );
 		hash = FS_HashFileName(filename_inzip, pack->hashSize);
 		buildBuffer[i].name = namePtr;
 		strcpy( buildBuffer[i].name, filename_inzip );
 		namePtr += strlen(filename_inzip) + 1;
-		// store the file position in the zip
-		buildBuffer[i].pos = unzGetOffset(uf);
-		buildBuffer[i].len = file_info.uncompressed_size;
 		buildBuffer[i].next = pack->hashTable[hash];
 		pack->hashTable[hash] = &buildBuffer[i];
-		unzGoToNextFile(uf);
+		if ( !indexed ) {
+			unzGoToNextFile(uf);
+		}
+	}
+
+	// remember complete scans so the next startup can skip them
+	if ( crcs ) {
+		if ( haveStat && i == gi.number_entry ) {
+			FS_AddPakIndex( zipfile, size, mtime, buildBuffer, crcs, gi.number_entry, len );
+		}
+		Z_Free( crcs );
 	}
 
 	pack->checksum = Com_BlockChecksum( &fs_headerLongs[ 1 ], sizeof(*fs_headerLongs) * ( fs_numHeaderLongs - 1 ) );
@@ -2088,8 +3323,11 @@ Frees a pak structure and releases all associated resources
 
 static void FS_FreePak(pack_t *thepak)
 {
-	unzClose(thepak->handle);
+	if (thepak->handle)
+		unzClose(thepak->handle);
 	Z_Free(thepak->buildBuffer);
+	if (thepak->sortedFiles)
+		Z_Free(thepak->sortedFiles);
 	Z_Free(thepak);
 }
 
@@ -2178,6 +3416,90 @@ static int FS_AddFileToList( char *name, char *list[MAX_FOUND_FILES], int nfiles
 	return nfiles;
 }
 
+/*
+==================
+FS_SortPakFiles
+
+Builds the pak's list of files ordered by name, so a directory listing
+only has to look at the entries under its path
+==================
+*/
+static int FS_ComparePakFileNames( const void *a, const void *b ) {
+	return Q_stricmp( (*(fileInPack_t **)a)->name, (*(fileInPack_t **)b)->name );
+}
+
+static int FS_ComparePakFileOrder( const void *a, const void *b ) {
+	fileInPack_t	*fa = *(fileInPack_t **)a;
+	fileInPack_t	*fb = *(fileInPack_t **)b;
+
+	return fa < fb ? -1 : fa > fb;
+}
+
+static void FS_SortPakFiles( pack_t *pak ) {
+	int		i;
+
+	pak->sortedFiles = Z_Malloc( ( pak->numfiles + 1 ) * sizeof( *pak->sortedFiles ) );
+	pak->numSortedFiles = 0;
+	for ( i = 0 ; i < pak->numfiles ; i++ ) {
+		if ( pak->buildBuffer[i].name ) {
+			pak->sortedFiles[pak->numSortedFiles++] = &pak->buildBuffer[i];
+		}
+	}
+	qsort( pak->sortedFiles, pak->numSortedFiles, sizeof( *pak->sortedFiles ), FS_ComparePakFileNames );
+}
+
+/*
+==================
+FS_PakFilesWithPrefix
+
+Returns the entries of the pak whose name starts with prefix, in the
+order they appear in the pak.  The list is temp memory.
+==================
+*/
+static fileInPack_t **FS_PakFilesWithPrefix( pack_t *pak, const char *prefix, int prefixLength, int *numFiles ) {
+	fileInPack_t	**files;
+	int				lo, hi, mid, first;
+
+	if ( !pak->sortedFiles ) {
+		FS_SortPakFiles( pak );
+	}
+
+	// first entry not below the prefix
+	lo = 0;
+	hi = pak->numSortedFiles;
+	while ( lo < hi ) {
+		mid = ( lo + hi ) >> 1;
+		if ( Q_stricmpn( pak->sortedFiles[mid]->name, prefix, prefixLength ) < 0 ) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	first = lo;
+
+	// first entry past the prefix
+	hi = pak->numSortedFiles;
+	while ( lo < hi ) {
+		mid = ( lo + hi ) >> 1;
+		if ( Q_stricmpn( pak->sortedFiles[mid]->name, prefix, prefixLength ) <= 0 ) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	*numFiles = lo - first;
+	if ( !*numFiles ) {
+		return NULL;
+	}
+
+	files = Hunk_AllocateTempMemory( *numFiles * sizeof( *files ) );
+	Com_Memcpy( files, pak->sortedFiles + first, *numFiles * sizeof( *files ) );
+	qsort( files, *numFiles, sizeof( *files ), FS_ComparePakFileOrder );
+
+	return files;
+}
+
 /*
 ===============
 FS_ListFilteredFiles
@@ -2234,26 +3556,25 @@ char **FS_ListFilteredFiles( const char *path, const char *extension,
 				continue;
 			}
 
-			// look through all the pak file elements
 			pak = search->pack;
-			buildBuffer = pak->buildBuffer;
-			for (i = 0; i < pak->numfiles; i++) {
-				char	*name;
-				int		zpathLen, depth;
-
-				// check for directory match
-				name = buildBuffer[i].name;
-
-				if (stripPath) {
-					pathSkip = pathLength;
-					if (pathLength) {
-						pathSkip++; // include the '/'
-					}
-				} else {
-					pathSkip = 0;
+
+			if (stripPath) {
+				pathSkip = pathLength;
+				if (pathLength) {
+					pathSkip++; // include the '/'
 				}
+			} else {
+				pathSkip = 0;
+			}
+
+			if (filter) {
+				// look through all the pak file elements
+				buildBuffer = pak->buildBuffer;
+				for (i = 0; i < pak->numfiles; i++) {
+					char	*name;
+
+					name = buildBuffer[i].name;
 
-				if (filter) {
 					// case insensitive
 					if (!Com_FilterPath( filter, name, qfalse ))
 						continue;
@@ -2261,11 +3582,22 @@ char **FS_ListFilteredFiles( const char *path, const char *extension,
 					// unique the match
 					nfiles = FS_AddFileToList( name + pathSkip, list, nfiles );
 				}
-				else {
+			}
+			else {
+				fileInPack_t	**pakFiles;
+				int				numPakFiles;
+
+				// only the elements under the directory
+				pakFiles = FS_PakFilesWithPrefix( pak, path, pathLength, &numPakFiles );
+				for (i = 0; i < numPakFiles; i++) {
+					char	*name;
+					int		zpathLen, depth;
+
+					name = pakFiles[i]->name;
 
 					zpathLen = FS_ReturnPath(name, zpath, &depth);
 
-					if ( (depth-pathDepth)>2 || pathLength > zpathLen || Q_stricmpn( name, path, pathLength ) ) {
+					if ( (depth-pathDepth)>2 || pathLength > zpathLen ) {
 						continue;
 					}
 
@@ -2282,6 +3614,9 @@ char **FS_ListFilteredFiles( const char *path, const char *extension,
 					// unique the match
 					nfiles = FS_AddFileToList( name + pathSkip, list, nfiles );
 				}
+				if ( pakFiles ) {
+					Hunk_FreeTempMemory( pakFiles );
+				}
 			}
 		} else if (search->dir) { // scan for files in the filesystem
 			char	*netpath;
@@ -2294,13 +3629,12 @@ char **FS_ListFilteredFiles( const char *path, const char *extension,
 				continue;
 			} else {
 				netpath = FS_BuildOSPath( search->dir->path, search->dir->gamedir, path );
-				sysFiles = Sys_ListFiles( netpath, extension, filter, &numSysFiles, qfalse );
+				sysFiles = FS_ListDirectory( netpath, extension, filter, &numSysFiles );
 				for ( i = 0 ; i < numSysFiles ; i++ ) {
 					// unique the match
 					name = sysFiles[i];
 					nfiles = FS_AddFileToList( name, list, nfiles );
 				}
-				Sys_FreeFileList( sysFiles );
 			}
 		}
 	}
@@ -2966,6 +4300,7 @@ static void FS_AddGameDirectory( const char *path, const char *dir ) {
 			search->pack = pak;
 			search->next = fs_searchpaths;
 			fs_searchpaths = search;
+			FS_InvalidatePakNames();
 
 			pakfilesi++;
 		}
@@ -2991,6 +4326,7 @@ static void FS_AddGameDirectory( const char *path, const char *dir ) {
 
 			search->next = fs_searchpaths;
 			fs_searchpaths = search;
+			FS_InvalidatePakNames();
 
 			pakdirsi++;
 		}
@@ -3012,6 +4348,7 @@ static void FS_AddGameDirectory( const char *path, const char *dir ) {
 
 	search->next = fs_searchpaths;
 	fs_searchpaths = search;
+	FS_InvalidatePakNames();
 }
 
 /*
@@ -3226,6 +4563,8 @@ void FS_Shutdown( qboolean closemfp ) {
 	searchpath_t	*p, *next;
 	int	i;
 
+	FS_AsyncShutdown();
+
 	for(i = 0; i < MAX_FILE_HANDLES; i++) {
 		if (fsh[i].fileSize) {
 			FS_FCloseFile(i);
@@ -3245,6 +4584,10 @@ void FS_Shutdown( qboolean closemfp ) {
 		Z_Free(p);
 	}
 
+	FS_ReleaseHeldFile();
+	FS_InvalidatePakNames();
+	FS_InvalidateDirListings();
+
 	// any FS_ calls will now be an error until reinitialized
 	fs_searchpaths = NULL;
 
@@ -3299,6 +4642,7 @@ static void FS_ReorderPurePaks( void )
 				*p_insert_index = s;
 				// increment insert list
 				p_insert_index = &s->next;
+				FS_InvalidatePakNames();
 				break; // iterate to next server pack
 			}
 			p_previous = &s->next;
@@ -3377,6 +4721,7 @@ static void FS_Startup( const char *gameName )
 	fs_packFiles = 0;
 
 	fs_debug = Cvar_Get( "fs_debug", "0", 0 );
+	fs_asyncBudget = Cvar_Get( "fs_asyncBudget", "256", CVAR_ARCHIVE );
 	fs_basepath = Cvar_Get ("fs_basepath", Sys_DefaultInstallPath(), CVAR_INIT|CVAR_PROTECTED );
 	fs_basegame = Cvar_Get ("fs_basegame", "", CVAR_INIT );
 	fs_homeconfigpath = Cvar_Get ("fs_homeconfigpath", configPath, CVAR_INIT|CVAR_PROTECTED );
@@ -3418,6 +4763,8 @@ static void FS_Startup( const char *gameName )
 	FS_CreatePath(fs_homedatapath->string);
 	FS_CreatePath(fs_homestatepath->string);
 
+	FS_LoadPakIndex();
+
 	FS_AddGameDirectories(gameName);
 
 	// check for additional base game so mods can be based upon other mods
@@ -3446,6 +4793,8 @@ static void FS_Startup( const char *gameName )
 	Cmd_AddCommand ("touchFile", FS_TouchFile_f );
 	Cmd_AddCommand ("which", FS_Which_f );
 
+	FS_WritePakIndex();
+
 	// https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=506
 	// reorder the pure pk3 files according to server order
 	FS_ReorderPurePaks();
@@ -3968,6 +5317,32 @@ const char *FS_ReferencedPakNames( void ) {
 	return info;
 }
 
+/*
+=====================
+FS_PakFilename
+
+Returns the file of a pk3 named as FS_ReferencedPakNames names them,
+or NULL when no search path has it
+=====================
+*/
+const char *FS_PakFilename( const char *name ) {
+	searchpath_t	*search;
+	int				length;
+
+	for ( search = fs_searchpaths ; search ; search = search->next ) {
+		if ( !search->pack ) {
+			continue;
+		}
+		length = strlen( search->pack->pakGamename );
+		if ( !Q_stricmpn( name, search->pack->pakGamename, length ) && name[length] == '/'
+			&& !FS_FilenameCompare( name + length + 1, search->pack->pakBasename ) ) {
+			return search->pack->pakFilename;
+		}
+	}
+
+	return NULL;
+}
+
 /*
 =====================
 FS_ClearPakReferences
@@ -4288,12 +5663,16 @@ int		FS_FOpenFileByMode( const char *qpath, fileHandle_t *f, fsMode_t mode ) {
 		fsh[*f].fileSize = r;
 	}
 	fsh[*f].handleSync = sync;
+	fsh[*f].handleAsync = ( mode == FS_APPEND || mode == FS_APPEND_SYNC );
 
 	return r;
 }
 
 int		FS_FTell( fileHandle_t f ) {
 	int pos;
+	if ( fsh[f].handleAsync ) {
+		Com_FlushWriter();
+	}
 	if (fsh[f].zipFile == qtrue) {
 		pos = unztell(fsh[f].handleFiles.file.z);
 	} else {
@@ -4303,6 +5682,9 @@ int		FS_FTell( fileHandle_t f ) {
 }
 
 void	FS_Flush( fileHandle_t f ) {
+	if ( fsh[f].handleAsync ) {
+		Com_FlushWriter();
+	}
 	fflush(fsh[f].handleFiles.file.o);
 }
 
@@ -0,0 +1,467 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// jobs.c -- spreading work over the cpu cores
+
+// com_jobThreads threads are started at init.  The main thread is thread 0
+// and they are 1 and up, each with a queue of its own: a thread adds jobs to
+// the back of its queue and takes its next one from the back, a thread with
+// nothing left takes the oldest from the front of another's.  A job may be
+// counted against a jobCounter_t, to be waited on, and may be held until
+// another counter reaches zero.  Com_WaitJobs runs jobs itself while it
+// waits, so waiting inside a job can't deadlock.
+//
+// Jobs must not call Com_Error or touch the cvar, command or file systems.
+// Com_FrameAlloc on a job thread takes from that thread's own arena, which
+// is reset at the top of the first frame with no jobs outstanding.
+//
+// With com_jobThreads 0, or when no thread could be started, a job runs on
+// the spot inside Com_AddJob.
+
+#include "q_shared.h"
+#include "qcommon.h"
+
+#define	MAX_JOB_THREADS		16
+#define	MAX_JOBS			4096
+#define	JOB_QUEUE_SIZE		1024		// per thread, power of 2
+#define	JOB_ARENA_SIZE		( 256 * 1024 )
+#define	JOB_ARENA_ALIGN		16
+
+#ifdef _MSC_VER
+#define	JOB_THREAD_LOCAL	__declspec( thread )
+#else
+#define	JOB_THREAD_LOCAL	__thread
+#endif
+
+typedef struct job_s {
+	jobFunction_t	function;
+	void			*data;
+	jobCounter_t	*counter;
+	struct job_s	*next;				// free, or waiting on the same counter
+} job_t;
+
+typedef struct {
+	void			*mutex;
+	job_t			*jobs[JOB_QUEUE_SIZE];
+	int				head, tail;			// taken from the front at head
+} jobQueue_t;
+
+typedef struct {
+	void			*thread;
+	byte			*arena;
+	int				arenaUsed;
+} jobThread_t;
+
+static struct {
+	qboolean		initialized;
+	int				numThreads;
+	volatile int	shutdown;
+
+	void			*lock;				// the free jobs and the counters' waiting lists
+	void			*wake;				// posted once for each job queued
+	volatile int	queued;				// jobs in the queues
+	volatile int	outstanding;		// jobs added and not finished
+
+	job_t			pool[MAX_JOBS];
+	job_t			*free;
+
+	jobQueue_t		queues[MAX_JOB_THREADS + 1];
+	jobThread_t		threads[MAX_JOB_THREADS + 1];
+} jobs;
+
+static JOB_THREAD_LOCAL int	jobThread;		// 0 on the main thread
+
+cvar_t	*com_jobThreads;
+
+/*
+=================
+Com_JobThread
+
+The calling job thread's number, 0 on the main thread
+=================
+*/
+int Com_JobThread( void ) {
+	return jobThread;
+}
+
+/*
+=================
+Com_NumJobThreads
+=================
+*/
+int Com_NumJobThreads( void ) {
+	return jobs.numThreads;
+}
+
+/*
+=================
+Com_JobFrameAlloc
+
+Com_FrameAlloc on a job thread
+=================
+*/
+void *Com_JobFrameAlloc( int size ) {
+	jobThread_t	*thread = &jobs.threads[jobThread];
+	int			used;
+
+	used = ( thread->arenaUsed + JOB_ARENA_ALIGN - 1 ) & ~( JOB_ARENA_ALIGN - 1 );
+	if ( size < 0 || size > JOB_ARENA_SIZE - used ) {
+		// no Com_Error off the main thread
+		Sys_Error( "Com_FrameAlloc: job thread %i failed on %i", jobThread, size );
+	}
+
+	thread->arenaUsed = used + size;
+	return thread->arena + used;
+}
+
+/*
+=================
+Com_ResetJobArenas
+
+Called at the top of each frame
+=================
+*/
+void Com_ResetJobArenas( void ) {
+	int		i;
+
+	// adding nothing orders it after the job threads' writes
+	if ( Sys_AtomicAdd( &jobs.outstanding, 0 ) ) {
+		return;
+	}
+
+	for ( i = 1; i <= jobs.numThreads; i++ ) {
+		jobs.threads[i].arenaUsed = 0;
+	}
+}
+
+static void Com_RunJob( job_t *job );
+
+/*
+=================
+Com_PushJob
+
+Queues a job that can run now
+=================
+*/
+static void Com_PushJob( job_t *job ) {
+	jobQueue_t	*queue;
+	qboolean	full;
+
+	if ( !jobs.numThreads ) {
+		Com_RunJob( job );
+		return;
+	}
+
+	queue = &jobs.queues[jobThread];
+	Sys_LockMutex( queue->mutex );
+	full = ( queue->tail - queue->head == JOB_QUEUE_SIZE );
+	if ( !full ) {
+		queue->jobs[queue->tail++ & ( JOB_QUEUE_SIZE - 1 )] = job;
+	}
+	Sys_UnlockMutex( queue->mutex );
+
+	if ( full ) {
+		Com_RunJob( job );
+		return;
+	}
+
+	Sys_AtomicAdd( &jobs.queued, 1 );
+	Sys_PostSemaphore( jobs.wake, 1 );
+}
+
+/*
+=================
+Com_TakeJob
+
+The newest job of the calling thread's queue, or the oldest of another's
+=================
+*/
+static job_t *Com_TakeJob( void ) {
+	jobQueue_t	*queue;
+	job_t		*job;
+	int			i;
+
+	if ( !Sys_AtomicAdd( &jobs.queued, 0 ) ) {
+		return NULL;
+	}
+
+	job = NULL;
+	for ( i = 0; i <= jobs.numThreads && !job; i++ ) {
+		queue = &jobs.queues[( jobThread + i ) % ( jobs.numThreads + 1 )];
+
+		Sys_LockMutex( queue->mutex );
+		if ( queue->tail != queue->head ) {
+			if ( !i ) {
+				job = queue->jobs[--queue->tail & ( JOB_QUEUE_SIZE - 1 )];
+			} else {
+				job = queue->jobs[queue->head++ & ( JOB_QUEUE_SIZE - 1 )];
+			}
+		}
+		Sys_UnlockMutex( queue->mutex );
+	}
+
+	if ( job ) {
+		Sys_AtomicAdd( &jobs.queued, -1 );
+	}
+	return job;
+}
+
+/*
+=================
+Com_FinishJob
+=================
+*/
+static void Com_FinishJob( jobCounter_t *counter ) {
+	job_t	*waiting, *next;
+
+	if ( counter && !Sys_AtomicAdd( &counter->count, -1 ) && jobs.initialized ) {
+		// start whatever was held for it
+		Sys_LockMutex( jobs.lock );
+		waiting = counter->waiting;
+		counter->waiting = NULL;
+		Sys_UnlockMutex( jobs.lock );
+
+		for ( ; waiting; waiting = next ) {
+			next = waiting->next;
+			Com_PushJob( waiting );
+		}
+	}
+
+	Sys_AtomicAdd( &jobs.outstanding, -1 );
+}
+
+/*
+=================
+Com_RunJob
+=================
+*/
+static void Com_RunJob( job_t *job ) {
+	jobCounter_t	*counter;
+
+	job->function( job->data );
+	counter = job->counter;
+
+	Sys_LockMutex( jobs.lock );
+	job->next = jobs.free;
+	jobs.free = job;
+	Sys_UnlockMutex( jobs.lock );
+
+	Com_FinishJob( counter );
+}
+
+/*
+=================
+Com_AddJobAfter
+
+Runs function( data ) on some thread once after has reached zero.
+counter and after may be NULL.
+=================
+*/
+void Com_AddJobAfter( jobFunction_t function, void *data, jobCounter_t *counter, jobCounter_t *after ) {
+	job_t	*job;
+
+	if ( counter ) {
+		Sys_AtomicAdd( &counter->count, 1 );
+	}
+	Sys_AtomicAdd( &jobs.outstanding, 1 );
+
+	if ( jobs.initialized ) {
+		Sys_LockMutex( jobs.lock );
+		job = jobs.free;
+		if ( job ) {
+			jobs.free = job->next;
+		}
+		Sys_UnlockMutex( jobs.lock );
+	} else {
+		job = NULL;
+	}
+
+	if ( !job ) {
+		// out of jobs, do it here
+		if ( after ) {
+			Com_WaitJobs( after );
+		}
+
+		function( data );
+		Com_FinishJob( counter );
+		return;
+	}
+
+	job->function = function;
+	job->data = data;
+	job->counter = counter;
+	job->next = NULL;
+
+	if ( after ) {
+		Sys_LockMutex( jobs.lock );
+		if ( Sys_AtomicAdd( &after->count, 0 ) ) {
+			job->next = after->waiting;
+			after->waiting = job;
+			job = NULL;
+		}
+		Sys_UnlockMutex( jobs.lock );
+	}
+
+	if ( job ) {
+		Com_PushJob( job );
+	}
+}
+
+/*
+=================
+Com_AddJob
+=================
+*/
+void Com_AddJob( jobFunction_t function, void *data, jobCounter_t *counter ) {
+	Com_AddJobAfter( function, data, counter, NULL );
+}
+
+/*
+=================
+Com_WaitJobs
+
+Returns once every job counted against counter has finished, running
+queued jobs in the meantime
+=================
+*/
+void Com_WaitJobs( jobCounter_t *counter ) {
+	job_t	*job;
+
+	while ( Sys_AtomicAdd( &counter->count, 0 ) ) {
+		job = Com_TakeJob();
+		if ( job ) {
+			Com_RunJob( job );
+		} else {
+			// the last ones are running on other threads
+			Sys_Yield();
+		}
+	}
+}
+
+/*
+=================
+Com_JobThreadMain
+=================
+*/
+static void Com_JobThreadMain( void *arg ) {
+	job_t	*job;
+
+	jobThread = (int)(intptr_t)arg;
+
+	while ( !jobs.shutdown ) {
+		job = Com_TakeJob();
+		if ( job ) {
+			Com_RunJob( job );
+		} else {
+			Sys_WaitSemaphore( jobs.wake );
+		}
+	}
+}
+
+/*
+=================
+Com_InitJobs
+=================
+*/
+void Com_InitJobs( void ) {
+	int		count, i;
+
+	com_jobThreads = Cvar_Get( "com_jobThreads", "-1", CVAR_ARCHIVE | CVAR_LATCH );
+	Cvar_SetDescription( com_jobThreads, "Threads for engine jobs, -1 for one less than the cpu cores, 0 runs jobs as they are added" );
+
+	Com_Memset( &jobs, 0, sizeof( jobs ) );
+
+	jobs.lock = Sys_CreateMutex();
+	jobs.wake = Sys_CreateSemaphore();
+	if ( !jobs.lock || !jobs.wake ) {
+		Com_Printf( "Couldn't create the job locks, jobs run as they are added\n" );
+		return;
+	}
+
+	for ( i = 0; i < MAX_JOBS - 1; i++ ) {
+		jobs.pool[i].next = &jobs.pool[i + 1];
+	}
+	jobs.free = &jobs.pool[0];
+	jobs.initialized = qtrue;
+
+	count = com_jobThreads->integer;
+	if ( count < 0 ) {
+		count = Sys_ProcessorCount() - 1;
+	}
+	count = MIN( count, MAX_JOB_THREADS );
+
+	for ( i = 0; i <= count; i++ ) {
+		jobs.queues[i].mutex = Sys_CreateMutex();
+		if ( !jobs.queues[i].mutex ) {
+			break;
+		}
+	}
+	count = MAX( i - 1, 0 );
+
+	for ( i = 1; i <= count; i++ ) {
+		jobs.threads[i].arena = Z_Malloc( JOB_ARENA_SIZE );
+		jobs.threads[i].thread = Sys_CreateThread( Com_JobThreadMain, (void *)(intptr_t)i );
+		if ( !jobs.threads[i].thread ) {
+			Z_Free( jobs.threads[i].arena );
+			jobs.threads[i].arena = NULL;
+			break;
+		}
+		jobs.numThreads = i;
+	}
+
+	Com_Printf( "%i job threads\n", jobs.numThreads );
+}
+
+/*
+=================
+Com_ShutdownJobs
+=================
+*/
+void Com_ShutdownJobs( void ) {
+	job_t	*job;
+	int		i;
+
+	if ( !jobs.initialized ) {
+		return;
+	}
+
+	// finish off anything still queued
+	while ( ( job = Com_TakeJob() ) != NULL ) {
+		Com_RunJob( job );
+	}
+
+	jobs.shutdown = qtrue;
+	Sys_PostSemaphore( jobs.wake, jobs.numThreads );
+	for ( i = 1; i <= jobs.numThreads; i++ ) {
+		Sys_JoinThread( jobs.threads[i].thread );
+		Z_Free( jobs.threads[i].arena );
+	}
+
+	for ( i = 0; i <= MAX_JOB_THREADS; i++ ) {
+		if ( jobs.queues[i].mutex ) {
+			Sys_DestroyMutex( jobs.queues[i].mutex );
+		}
+	}
+	Sys_DestroySemaphore( jobs.wake );
+	Sys_DestroyMutex( jobs.lock );
+
+	Com_Memset( &jobs, 0, sizeof( jobs ) );
+}
@@ -22,10 +22,29 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "q_shared.h"
 #include "qcommon.h"
 
+#ifdef USE_INTERNAL_ZLIB
+#include "zlib.h"
+#else
+#include <zlib.h>
+#endif
+
 static huffman_t		msgHuff;
 
 static qboolean			msgInit = qfalse;
 
+// the message tree never changes after MSG_initHuffman, so its codes are
+// flattened into tables there instead of walking the tree for every byte
+#define	HUFF_LOOKUP_BITS	11
+
+typedef struct {
+	short		symbol;
+	byte		bits;			// 0 = code is longer than HUFF_LOOKUP_BITS
+} huffLookup_t;
+
+static unsigned int		msgHuffCode[256];		// first bit sent in bit 0
+static byte				msgHuffCodeBits[256];
+static huffLookup_t		msgHuffLookup[1 << HUFF_LOOKUP_BITS];
+
 int pcount[256];
 
 /*
@@ -101,9 +120,35 @@ bit functions
 =============================================================================
 */
 
+/*
+=================
+MSG_PutBits
+
+Stores up to 57 bits at the given bit offset in the order Huff_putBit
+stores them, clearing the rest of the last byte touched
+=================
+*/
+static void MSG_PutBits( byte *data, int bit, uint64_t value, int bits ) {
+	byte	*p;
+	int		shift;
+
+	p = data + ( bit >> 3 );
+	shift = bit & 7;
+	value <<= shift;
+	bits += shift;
+
+	*p = ( *p & ( ( 1 << shift ) - 1 ) ) | (byte)value;
+	for ( bits -= 8 ; bits > 0 ; bits -= 8 ) {
+		value >>= 8;
+		*++p = (byte)value;
+	}
+}
+
 // negative bit values include signs
 void MSG_WriteBits( msg_t *msg, int value, int bits ) {
-	int	i;
+	uint64_t	acc;
+	int			i, n, total;
+	unsigned int	uvalue;
 
 	oldsize += bits;
 
@@ -143,41 +188,166 @@ void MSG_WriteBits( msg_t *msg, int value, int bits ) {
 			Com_Error( ERR_DROP, "can't write %d bits", bits );
 		}
 	} else {
-		value &= (0xffffffff >> (32 - bits));
-		if ( bits&7 ) {
-			int nbits;
-			nbits = bits&7;
-			if ( msg->bit + nbits >= msg->maxsize << 3 ) {
-				msg->overflowed = qtrue;
-				return;
-			}
-			for( i = 0; i < nbits; i++ ) {
-				Huff_putBit( (value & 1), msg->data, &msg->bit );
-				value = (value >> 1);
-			}
-			bits = bits - nbits;
+		uvalue = (unsigned int)value & (0xffffffff >> (32 - bits));
+
+		// the odd bits go out raw, then each byte as its huffman code
+		n = bits & 7;
+		total = n;
+		for ( i = n; i < bits; i += 8 ) {
+			total += msgHuffCodeBits[( uvalue >> i ) & 0xff];
 		}
-		if ( bits ) {
-			for( i = 0; i < bits; i += 8 ) {
-				Huff_offsetTransmit( &msgHuff.compressor, (value & 0xff), msg->data, &msg->bit, msg->maxsize << 3 );
-				value = (value >> 8);
-
-				if ( msg->bit >= msg->maxsize << 3 ) {
-					msg->overflowed = qtrue;
-					return;
-				}
+		if ( msg->bit + total >= msg->maxsize << 3 ) {
+			msg->overflowed = qtrue;
+			return;
+		}
+
+		acc = uvalue & ( ( 1 << n ) - 1 );
+		for ( i = n; i < bits; i += 8 ) {
+			acc |= (uint64_t)msgHuffCode[( uvalue >> i ) & 0xff] << n;
+			n += msgHuffCodeBits[( uvalue >> i ) & 0xff];
+			if ( n >= 32 ) {
+				MSG_PutBits( msg->data, msg->bit, acc, 32 );
+				msg->bit += 32;
+				acc >>= 32;
+				n -= 32;
 			}
 		}
+		if ( n ) {
+			MSG_PutBits( msg->data, msg->bit, acc, n );
+			msg->bit += n;
+		}
 		msg->cursize = (msg->bit >> 3) + 1;
 	}
 }
 
+/*
+=================
+MSG_CopyBits
+
+Copies a run of bits in the order Huff_putBit stores them, up to 56 of
+them at a time
+=================
+*/
+void MSG_CopyBits( byte *dst, int dstBit, const byte *src, int srcBit, int bits ) {
+	uint64_t	v;
+	int		n, i, first;
+
+	while ( bits > 0 ) {
+		n = bits < 56 ? bits : 56;
+
+		first = srcBit >> 3;
+		v = 0;
+		for ( i = ( srcBit + n - 1 ) >> 3; i >= first; i-- ) {
+			v = ( v << 8 ) | src[i];
+		}
+		v >>= srcBit & 7;
+		v &= ( (uint64_t)1 << n ) - 1;
+
+		MSG_PutBits( dst, dstBit, v, n );
+
+		srcBit += n;
+		dstBit += n;
+		bits -= n;
+	}
+}
+
+/*
+=================
+MSG_WriteBitString
+
+Appends bits that were already written to another huffman message, so a
+repeated encoding doesn't have to be done again
+=================
+*/
+void MSG_WriteBitString( msg_t *msg, const byte *data, int bits ) {
+	oldsize += bits;
+
+	if ( msg->overflowed || bits <= 0 ) {
+		return;
+	}
+
+	if ( msg->oob ) {
+		Com_Error( ERR_DROP, "MSG_WriteBitString: oob message" );
+	}
+
+	if ( msg->bit + bits >= msg->maxsize << 3 ) {
+		msg->overflowed = qtrue;
+		return;
+	}
+
+	MSG_CopyBits( msg->data, msg->bit, data, 0, bits );
+	msg->bit += bits;
+	msg->cursize = (msg->bit >> 3) + 1;
+}
+
+/*
+=================
+MSG_ReadBitString
+
+Reads bits written with MSG_WriteBitString, data is zeroed past the end
+of the message
+=================
+*/
+void MSG_ReadBitString( msg_t *msg, byte *data, int bits ) {
+	if ( msg->oob ) {
+		Com_Error( ERR_DROP, "MSG_ReadBitString: oob message" );
+	}
+
+	if ( bits <= 0 ) {
+		return;
+	}
+
+	if ( msg->bit + bits > msg->cursize << 3 ) {
+		Com_Memset( data, 0, ( bits + 7 ) >> 3 );
+		msg->readcount = msg->cursize + 1;
+		return;
+	}
+
+	Com_Memset( data, 0, ( bits + 7 ) >> 3 );
+	MSG_CopyBits( data, 0, msg->data, msg->bit, bits );
+	msg->bit += bits;
+	msg->readcount = (msg->bit >> 3) + 1;
+}
+
+/*
+=================
+MSG_PeekBits
+
+Loads the bits from the read position on, first bit in bit 0, and
+returns how many of them are inside the message
+=================
+*/
+static int MSG_PeekBits( const msg_t *msg, uint64_t *window ) {
+	int		first, last, i;
+	uint64_t	w;
+
+	first = msg->bit >> 3;
+	last = first + 8;
+	if ( last > msg->cursize ) {
+		last = msg->cursize;
+	}
+	if ( last <= first ) {
+		*window = 0;
+		return 0;
+	}
+
+	w = 0;
+	for ( i = last - 1; i >= first; i-- ) {
+		w = ( w << 8 ) | msg->data[i];
+	}
+	*window = w >> ( msg->bit & 7 );
+
+	return ( ( last - first ) << 3 ) - ( msg->bit & 7 );
+}
+
 int MSG_ReadBits( msg_t *msg, int bits ) {
 	int			value;
 	int			get;
 	qboolean	sgn;
 	int			i, nbits;
-//	FILE*	fp;
+	uint64_t	window;
+	int			avail;
+	const huffLookup_t	*look;
 
 	if ( msg->readcount > msg->cursize ) {
 		return 0;
@@ -222,31 +392,38 @@ int MSG_ReadBits( msg_t *msg, int bits ) {
 		else
 			Com_Error(ERR_DROP, "can't read %d bits", bits);
 	} else {
-		nbits = 0;
-		if (bits&7) {
-			nbits = bits&7;
-			if (msg->bit + nbits > msg->cursize << 3) {
-				msg->readcount = msg->cursize + 1;
-				return 0;
-			}
-			for(i=0;i<nbits;i++) {
-				value |= (Huff_getBit(msg->data, &msg->bit)<<i);
-			}
-			bits = bits - nbits;
+		// the odd bits come in raw, then each byte as its huffman code,
+		// read out of a window of the next bits through the lookup table.
+		// Only codes longer than the table, or ones running into the end
+		// of the message, walk the tree
+		avail = MSG_PeekBits( msg, &window );
+
+		nbits = bits & 7;
+		if ( nbits > avail ) {
+			msg->readcount = msg->cursize + 1;
+			return 0;
 		}
-		if (bits) {
-//			fp = fopen("c:\\netchan.bin", "a");
-			for(i=0;i<bits;i+=8) {
-				Huff_offsetReceive (msgHuff.decompressor.tree, &get, msg->data, &msg->bit, msg->cursize<<3);
-//				fwrite(&get, 1, 1, fp);
-				value = (unsigned int)value | ((unsigned int)get<<(i+nbits));
-
-				if (msg->bit > msg->cursize<<3) {
+		value = window & ( ( 1 << nbits ) - 1 );
+		window >>= nbits;
+		avail -= nbits;
+		msg->bit += nbits;
+
+		for ( i = nbits; i < bits; i += 8 ) {
+			look = &msgHuffLookup[window & ( ( 1 << HUFF_LOOKUP_BITS ) - 1 )];
+			if ( look->bits && look->bits <= avail ) {
+				get = look->symbol;
+				window >>= look->bits;
+				avail -= look->bits;
+				msg->bit += look->bits;
+			} else {
+				Huff_offsetReceive( msgHuff.decompressor.tree, &get, msg->data, &msg->bit, msg->cursize<<3 );
+				if ( msg->bit > msg->cursize<<3 ) {
 					msg->readcount = msg->cursize + 1;
 					return 0;
 				}
+				avail = MSG_PeekBits( msg, &window );
 			}
-//			fclose(fp);
+			value = (unsigned int)value | ((unsigned int)get<<i);
 		}
 		msg->readcount = (msg->bit>>3)+1;
 	}
@@ -285,10 +462,60 @@ void MSG_WriteByte( msg_t *sb, int c ) {
 	MSG_WriteBits( sb, c, 8 );
 }
 
+/*
+=================
+MSG_WriteData
+
+Same output as writing the bytes one at a time, but oob data is copied
+in one go and huffman codes are packed 32 bits at a time
+=================
+*/
 void MSG_WriteData( msg_t *buf, const void *data, int length ) {
-	int i;
-	for(i=0;i<length;i++) {
-		MSG_WriteByte(buf, ((byte *)data)[i]);
+	const byte	*p = data;
+	uint64_t	acc;
+	int			i, n, bits;
+
+	oldsize += length << 3;
+
+	if ( buf->overflowed || length <= 0 ) {
+		return;
+	}
+
+	if ( buf->oob ) {
+		if ( buf->cursize + length > buf->maxsize ) {
+			length = buf->maxsize - buf->cursize;
+			buf->overflowed = qtrue;
+		}
+		Com_Memcpy( buf->data + buf->cursize, p, length );
+		buf->cursize += length;
+		buf->bit += length << 3;
+		return;
+	}
+
+	acc = 0;
+	n = 0;
+	for ( i = 0 ; i < length ; i++ ) {
+		bits = msgHuffCodeBits[p[i]];
+		if ( buf->bit + n + bits >= buf->maxsize << 3 ) {
+			buf->overflowed = qtrue;
+			break;
+		}
+
+		acc |= (uint64_t)msgHuffCode[p[i]] << n;
+		n += bits;
+		if ( n >= 32 ) {
+			MSG_PutBits( buf->data, buf->bit, acc, 32 );
+			buf->bit += 32;
+			acc >>= 32;
+			n -= 32;
+		}
+	}
+	if ( n ) {
+		MSG_PutBits( buf->data, buf->bit, acc, n );
+		buf->bit += n;
+	}
+	if ( i ) {
+		buf->cursize = (buf->bit >> 3) + 1;
 	}
 }
 
@@ -539,13 +766,98 @@ float MSG_ReadAngle16( msg_t *msg ) {
 }
 
 void MSG_ReadData( msg_t *msg, void *data, int len ) {
-	int		i;
+	int		i, n;
+
+	if ( msg->oob && len > 0 && msg->readcount <= msg->cursize ) {
+		// like byte reads, anything past the end comes back as 0xff
+		n = msg->cursize - msg->readcount;
+		if ( n > len ) {
+			n = len;
+		}
+		Com_Memcpy( data, msg->data + msg->readcount, n );
+		msg->readcount += n;
+		msg->bit += n << 3;
+		if ( n < len ) {
+			Com_Memset( (byte *)data + n, 0xff, len - n );
+			msg->readcount = msg->cursize + 1;
+		}
+		return;
+	}
 
 	for (i=0 ; i<len ; i++) {
 		((byte *)data)[i] = MSG_ReadByte (msg);
 	}
 }
 
+/*
+=============================================================================
+
+DEFLATED BLOCKS
+
+Raw deflate primed with a dictionary of what configstrings are made of,
+so even the short ones find matches.  The dictionary is part of the
+protocol, changing it breaks clients that negotiated compression.
+The most common strings go last, where the matches are cheapest.
+
+=============================================================================
+*/
+
+static const char msgDeflateDictionary[] =
+	"models/mapobjects/models/weapons2/models/players/sound/weapons/sound/player/"
+	"sound/misc/sound/items/sound/world/xmodel/weapon_mp_xmodel/playerbody_"
+	"xmodel/viewmodel_xmodel/head_mp_fx/impacts/fx/weapon/gfx/2d/textures/"
+	"maps/mp/mp_.bsp.md3.wav.mp3.tga.jpg"
+	"\\sv_referencedPakNames\\\\sv_referencedPaks\\\\sv_pakNames\\\\sv_paks\\"
+	"\\sv_pure\\1\\sv_cheats\\0\\timescale\\1\\g_syncronousClients\\0\\sv_serverid\\"
+	"\\fs_game\\\\sv_dlURL\\\\sv_allowDownload\\0\\gamename\\main\\g_needpass\\0"
+	"\\sv_maxRate\\0\\sv_minRate\\0\\sv_dlRate\\100\\sv_minPing\\0\\sv_maxPing\\0"
+	"\\sv_floodProtect\\1\\sv_hostname\\\\sv_maxclients\\\\sv_privateClients\\0"
+	"\\protocol\\\\version\\\\com_gamename\\\\com_protocol\\\\g_gametype\\\\mapname\\"
+	"\\timelimit\\\\fraglimit\\\\capturelimit\\\\dmflags\\0\\g_maxGameClients\\0"
+	"\\g_redteam\\\\g_blueteam\\\\c1\\\\c2\\\\hc\\100\\w\\0\\l\\0\\tt\\0\\tl\\0"
+	"n\\\\t\\0\\model\\\\hmodel\\";
+
+/*
+=================
+MSG_Deflate
+
+Returns the packed size, or 0 if it didn't fit in out
+=================
+*/
+int MSG_Deflate( const void *in, int inLength, byte *out, int outSize ) {
+	return Com_Deflate( msgDeflateDictionary, sizeof( msgDeflateDictionary ) - 1, in, inLength, out, outSize );
+}
+
+/*
+=================
+MSG_Inflate
+
+Returns the unpacked size, or -1 if the data is bad or doesn't fit in out
+=================
+*/
+int MSG_Inflate( const byte *in, int inLength, void *out, int outSize ) {
+	z_stream	z;
+	int			r;
+
+	Com_Memset( &z, 0, sizeof( z ) );
+	if ( inflateInit2( &z, -MAX_WBITS ) != Z_OK ) {
+		return -1;
+	}
+	inflateSetDictionary( &z, (const Bytef *)msgDeflateDictionary, sizeof( msgDeflateDictionary ) - 1 );
+
+	z.next_in = (Bytef *)in;
+	z.avail_in = inLength;
+	z.next_out = out;
+	z.avail_out = outSize;
+	r = inflate( &z, Z_FINISH );
+	inflateEnd( &z );
+
+	if ( r != Z_STREAM_END ) {
+		return -1;
+	}
+	return outSize - z.avail_out;
+}
+
 // a string hasher which gives the same hash value even if the
 // string is later modified via the legacy MSG read/write code
 int MSG_HashKey(const char *string, int maxlen) {
@@ -1666,8 +1978,39 @@ int msg_hData[256] = {
 13504,			// 255
 };
 
+/*
+=================
+MSG_HuffCode
+
+Flattens the path from the root to a symbol, first bit in bit 0
+=================
+*/
+static int MSG_HuffCode( const node_t *node, unsigned int *code ) {
+	const node_t	*n;
+	int		bits, i;
+
+	bits = 0;
+	for ( n = node ; n->parent ; n = n->parent ) {
+		bits++;
+	}
+	if ( bits > 32 ) {
+		Com_Error( ERR_FATAL, "MSG_initHuffman: %i bit code", bits );
+	}
+
+	*code = 0;
+	for ( i = bits - 1, n = node ; n->parent ; n = n->parent, i-- ) {
+		if ( n->parent->right == n ) {
+			*code |= 1u << i;
+		}
+	}
+
+	return bits;
+}
+
 void MSG_initHuffman( void ) {
 	int i,j;
+	unsigned int code;
+	int bits;
 
 	msgInit = qtrue;
 	Huff_Init(&msgHuff);
@@ -1677,6 +2020,26 @@ void MSG_initHuffman( void ) {
 			Huff_addRef(&msgHuff.decompressor,	(byte)i);			// Do update
 		}
 	}
+
+	for ( i = 0 ; i < 256 ; i++ ) {
+		msgHuffCodeBits[i] = MSG_HuffCode( msgHuff.compressor.loc[i], &msgHuffCode[i] );
+	}
+
+	// every window starting with a short code decodes straight to its symbol
+	Com_Memset( msgHuffLookup, 0, sizeof( msgHuffLookup ) );
+	for ( i = 0 ; i <= HMAX ; i++ ) {
+		if ( !msgHuff.decompressor.loc[i] ) {
+			continue;
+		}
+		bits = MSG_HuffCode( msgHuff.decompressor.loc[i], &code );
+		if ( bits > HUFF_LOOKUP_BITS ) {
+			continue;
+		}
+		for ( j = code ; j < ( 1 << HUFF_LOOKUP_BITS ) ; j += 1 << bits ) {
+			msgHuffLookup[j].symbol = i;
+			msgHuffLookup[j].bits = bits;
+		}
+	}
 }
 
 /*
@@ -30,7 +30,7 @@ packet header
 4	outgoing sequence.  high bit will be set if this is a fragmented message
 [2	qport (only for client to server)]
 [2	fragment start byte]
-[2	fragment length. if < FRAGMENT_SIZE, this is the last fragment]
+[2	fragment length. if < the fragment size, this is the last fragment]
 
 if the sequence number is -1, the packet should be handled as an out-of-band
 message instead of as part of a netcon.
@@ -44,12 +44,20 @@ If the base part of the net address matches and the qport matches, then the
 channel matches even if the IP port differs.  The IP port should be updated
 to the new value before sending out any replies.
 
+Fragments are FRAGMENT_SIZE bytes unless both sides agreed on larger ones
+when connecting: a client with net_fragmentSize above it asks for that in
+the "fragsize" key of its connect userinfo, and the server answers with the
+smaller of that and its own net_fragmentSize as a second argument of
+connectResponse. Larger fragments make fewer packets of a gamestate, but
+packets over the path MTU are split by IP, so it's meant for LANs.
+
 */
 
 
 #define	MAX_PACKETLEN			1400		// max size of a network packet
 
 #define	FRAGMENT_SIZE			(MAX_PACKETLEN - 100)
+#define	MAX_FRAGMENT_SIZE		8192
 #define	PACKET_HEADER			10			// two ints and a short
 
 #define	FRAGMENT_BIT	(1U<<31)
@@ -57,6 +65,9 @@ to the new value before sending out any replies.
 cvar_t		*showpackets;
 cvar_t		*showdrop;
 cvar_t		*net_qport;
+cvar_t		*net_fragmentSize;
+
+static void NET_SimInit( void );
 
 static char *netsrcString[2] = {
 	"client",
@@ -74,6 +85,37 @@ void Netchan_Init( int port ) {
 	showpackets = Cvar_Get ("showpackets", "0", CVAR_TEMP );
 	showdrop = Cvar_Get ("showdrop", "0", CVAR_TEMP );
 	net_qport = Cvar_Get ("net_qport", va("%i", port), CVAR_INIT );
+	net_fragmentSize = Cvar_Get( "net_fragmentSize", va( "%i", FRAGMENT_SIZE ), CVAR_ARCHIVE );
+	Cvar_CheckRange( net_fragmentSize, FRAGMENT_SIZE, MAX_FRAGMENT_SIZE, qtrue );
+	Cvar_SetDescription( net_fragmentSize, "Largest netchan fragment to use when the other side supports it" );
+
+	NET_SimInit();
+}
+
+/*
+==============
+Netchan_FragmentSize
+
+The larger fragment size to ask for or agree to, 0 if net_fragmentSize
+is left at the default
+==============
+*/
+int Netchan_FragmentSize( void ) {
+	if ( net_fragmentSize->integer <= FRAGMENT_SIZE ) {
+		return 0;
+	}
+	return net_fragmentSize->integer;
+}
+
+/*
+==============
+Netchan_SetFragmentSize
+
+Called with the size both sides agreed on when connecting
+==============
+*/
+void Netchan_SetFragmentSize( netchan_t *chan, int size ) {
+	chan->fragmentSize = Com_Clamp( FRAGMENT_SIZE, MAX_FRAGMENT_SIZE, size );
 }
 
 /*
@@ -93,12 +135,73 @@ void Netchan_Setup(netsrc_t sock, netchan_t *chan, netadr_t adr, int qport, int
 	chan->incomingSequence = 0;
 	chan->outgoingSequence = 1;
 	chan->challenge = challenge;
+	chan->fragmentSize = FRAGMENT_SIZE;
 
 #ifdef LEGACY_PROTOCOL
 	chan->compat = compat;
 #endif
 }
 
+#ifdef LEGACY_PROTOCOL
+/*
+==============
+Netchan_XorPayload
+
+XORs the data from start on with the key stream of the legacy protocol,
+where every byte changes the key by the next character of string, shifted
+on odd offsets. The stream repeats after two passes over the string, or
+four if it has an odd length, so only one period of it is built and the
+message is XORed with it a word at a time.
+==============
+*/
+void Netchan_XorPayload( msg_t *msg, int start, byte key, const byte *string ) {
+	byte		stream[4 * MAX_STRING_CHARS];
+	uint64_t	a, b;
+	int			len, period, count;
+	int			i, j, c;
+
+	if ( start >= msg->cursize ) {
+		return;
+	}
+
+	// an empty string keeps adding its terminator
+	len = strlen( (const char *)string );
+	if ( !len ) {
+		len = 1;
+	}
+	period = ( len & 1 ) ? 4 * len : 2 * len;
+	if ( period > sizeof( stream ) ) {
+		Com_Error( ERR_DROP, "Netchan_XorPayload: key string of %i characters", len );
+	}
+
+	count = MIN( period, msg->cursize - start );
+	for ( i = 0, j = 0; i < count; i++, j++ ) {
+		if ( j == len ) {
+			j = 0;
+		}
+		c = string[j];
+		if ( c > 127 || c == '%' ) {
+			c = '.';
+		}
+		key ^= c << ( ( start + i ) & 1 );
+		stream[i] = key;
+	}
+
+	for ( i = start; i < msg->cursize; i += period ) {
+		count = MIN( period, msg->cursize - i );
+		for ( j = 0; j + 8 <= count; j += 8 ) {
+			Com_Memcpy( &a, msg->data + i + j, 8 );
+			Com_Memcpy( &b, stream + j, 8 );
+			a ^= b;
+			Com_Memcpy( msg->data + i + j, &a, 8 );
+		}
+		for ( ; j < count; j++ ) {
+			msg->data[i + j] ^= stream[j];
+		}
+	}
+}
+#endif
+
 /*
 =================
 Netchan_TransmitNextFragment
@@ -108,7 +211,7 @@ Send one fragment of the current message
 */
 void Netchan_TransmitNextFragment( netchan_t *chan ) {
 	msg_t		send;
-	byte		send_buf[MAX_PACKETLEN];
+	byte		send_buf[MAX_PACKETLEN - FRAGMENT_SIZE + MAX_FRAGMENT_SIZE];
 	int			fragmentLength;
 	int			outgoingSequence;
 
@@ -129,7 +232,7 @@ void Netchan_TransmitNextFragment( netchan_t *chan ) {
 		MSG_WriteLong(&send, NETCHAN_GENCHECKSUM(chan->challenge, chan->outgoingSequence));
 
 	// copy the reliable message to the packet first
-	fragmentLength = FRAGMENT_SIZE;
+	fragmentLength = chan->fragmentSize;
 	if ( chan->unsentFragmentStart  + fragmentLength > chan->unsentLength ) {
 		fragmentLength = chan->unsentLength - chan->unsentFragmentStart;
 	}
@@ -159,7 +262,7 @@ void Netchan_TransmitNextFragment( netchan_t *chan ) {
 	// that is exactly the fragment length still needs to send
 	// a second packet of zero length so that the other side
 	// can tell there aren't more to follow
-	if ( chan->unsentFragmentStart == chan->unsentLength && fragmentLength != FRAGMENT_SIZE ) {
+	if ( chan->unsentFragmentStart == chan->unsentLength && fragmentLength != chan->fragmentSize ) {
 		chan->outgoingSequence++;
 		chan->unsentFragments = qfalse;
 	}
@@ -176,7 +279,7 @@ A 0 length will still generate a packet.
 */
 void Netchan_Transmit( netchan_t *chan, int length, const byte *data ) {
 	msg_t		send;
-	byte		send_buf[MAX_PACKETLEN];
+	byte		send_buf[MAX_PACKETLEN - FRAGMENT_SIZE + MAX_FRAGMENT_SIZE];
 
 	if ( length > MAX_MSGLEN ) {
 		Com_Error( ERR_DROP, "Netchan_Transmit: length = %i", length );
@@ -184,7 +287,7 @@ void Netchan_Transmit( netchan_t *chan, int length, const byte *data ) {
 	chan->unsentFragmentStart = 0;
 
 	// fragment large reliable messages
-	if ( length >= FRAGMENT_SIZE ) {
+	if ( length >= chan->fragmentSize ) {
 		chan->unsentFragments = qtrue;
 		chan->unsentLength = length;
 		Com_Memcpy( chan->unsentBuffer, data, length );
@@ -236,9 +339,10 @@ Netchan_Process
 Returns qfalse if the message should not be processed due to being
 out of order or a fragment.
 
-Msg must be large enough to hold MAX_MSGLEN, because if this is the
-final fragment of a multi-part message, the entire thing will be
-copied out.
+If this is the final fragment of a multi-part message, msg is pointed
+at the channel's fragment buffer, where the message was put together
+behind room for the sequence number, instead of copying it back. It
+stays valid until the next packet for the channel is processed.
 =================
 */
 qboolean Netchan_Process( netchan_t *chan, msg_t *msg ) {
@@ -356,7 +460,7 @@ qboolean Netchan_Process( netchan_t *chan, msg_t *msg ) {
 
 		// copy the fragment to the fragment buffer
 		if ( fragmentLength < 0 || msg->readcount + fragmentLength > msg->cursize ||
-			chan->fragmentLength + fragmentLength > sizeof( chan->fragmentBuffer ) ) {
+			chan->fragmentLength + fragmentLength > MAX_MSGLEN ) {
 			if ( showdrop->integer || showpackets->integer ) {
 				Com_Printf ("%s:illegal fragment length\n"
 				, NET_AdrToString (chan->remoteAddress ) );
@@ -364,29 +468,22 @@ qboolean Netchan_Process( netchan_t *chan, msg_t *msg ) {
 			return qfalse;
 		}
 
-		Com_Memcpy( chan->fragmentBuffer + chan->fragmentLength, 
+		Com_Memcpy( chan->fragmentBuffer + 4 + chan->fragmentLength, 
 			msg->data + msg->readcount, fragmentLength );
 
 		chan->fragmentLength += fragmentLength;
 
 		// if this wasn't the last fragment, don't process anything
-		if ( fragmentLength == FRAGMENT_SIZE ) {
+		if ( fragmentLength == chan->fragmentSize ) {
 			return qfalse;
 		}
 
-		if ( chan->fragmentLength > msg->maxsize ) {
-			Com_Printf( "%s:fragmentLength %i > msg->maxsize\n"
-				, NET_AdrToString (chan->remoteAddress ),
-				chan->fragmentLength );
-			return qfalse;
-		}
-
-		// copy the full message over the partial fragment
+		// read the full message from the fragment buffer, with
+		// the sequence number in front of it
+		*(int *)chan->fragmentBuffer = LittleLong( sequence );
 
-		// make sure the sequence number is still there
-		*(int *)msg->data = LittleLong( sequence );
-
-		Com_Memcpy( msg->data + 4, chan->fragmentBuffer, chan->fragmentLength );
+		msg->data = chan->fragmentBuffer;
+		msg->maxsize = sizeof( chan->fragmentBuffer );
 		msg->cursize = chan->fragmentLength + 4;
 		chan->fragmentLength = 0;
 		msg->readcount = 4;	// past the sequence number
@@ -477,64 +574,238 @@ void NET_SendLoopPacket (netsrc_t sock, int length, const void *data, netadr_t t
 
 //=============================================================================
 
+/*
+=============================================================================
+
+NETWORK CONDITION SIMULATION
+
+Packets to and from real addresses can be held back, spread out, dropped,
+duplicated and squeezed through a capped link, separately for each
+direction, to test the engine under conditions that otherwise need netem.
+Everything waits in one queue sorted by release time, so jitter reorders
+packets the way a real path does. The random numbers come from
+net_simSeed, so a run can be repeated.
+
+=============================================================================
+*/
+
+typedef struct {
+	cvar_t	*lag;			// msec
+	cvar_t	*jitter;		// up to this many msec more
+	cvar_t	*loss;			// percent
+	cvar_t	*dup;			// percent
+	cvar_t	*rate;			// bytes per second, 0 is uncapped
+	double	linkFree;		// msec the capped link is done with what it holds
+} netSim_t;
+
+#define	NET_SIM_UDPIP_HEADER	28
+#define	NET_SIM_MAX_BACKLOG		1000	// msec a capped link buffers before it drops
+
+static netSim_t		net_simOut, net_simIn;
+static cvar_t		*net_simSeed;
+static unsigned int	net_simRandom;
+
 typedef struct packetQueue_s {
         struct packetQueue_s *next;
         int length;
         byte *data;
-        netadr_t to;
+        netadr_t adr;		// to, or from when incoming
+        qboolean incoming;
         int release;
 } packetQueue_t;
 
 packetQueue_t *packetQueue = NULL;
 
-static void NET_QueuePacket( int length, const void *data, netadr_t to,
-	int offset )
-{
-	packetQueue_t *new, *next = packetQueue;
+/*
+==============
+NET_SimRegister
+==============
+*/
+static void NET_SimRegister( netSim_t *sim, const char *dir ) {
+	sim->lag = Cvar_Get( va( "net_lag%s", dir ), "0", CVAR_CHEAT );
+	Cvar_SetDescription( sim->lag, "Simulated latency in msec" );
+	sim->jitter = Cvar_Get( va( "net_jitter%s", dir ), "0", CVAR_CHEAT );
+	Cvar_SetDescription( sim->jitter, "Simulated random extra latency of up to this many msec, which reorders packets" );
+	sim->loss = Cvar_Get( va( "net_loss%s", dir ), "0", CVAR_CHEAT );
+	Cvar_SetDescription( sim->loss, "Simulated packet loss in percent" );
+	sim->dup = Cvar_Get( va( "net_dup%s", dir ), "0", CVAR_CHEAT );
+	Cvar_SetDescription( sim->dup, "Simulated packet duplication in percent" );
+	sim->rate = Cvar_Get( va( "net_rate%s", dir ), "0", CVAR_CHEAT );
+	Cvar_SetDescription( sim->rate, "Simulated link capacity in bytes per second, 0 for none" );
+}
 
-	if(offset > 999)
-		offset = 999;
+/*
+==============
+NET_SimInit
+==============
+*/
+static void NET_SimInit( void ) {
+	NET_SimRegister( &net_simOut, "Out" );
+	NET_SimRegister( &net_simIn, "In" );
+	net_simSeed = Cvar_Get( "net_simSeed", "0", CVAR_TEMP );
+	Cvar_SetDescription( net_simSeed, "Seed for the simulated network conditions, set it again to repeat a run" );
+}
+
+/*
+==============
+NET_SimFraction
+
+A repeatable random number in [0, 1)
+==============
+*/
+static float NET_SimFraction( void ) {
+	if ( net_simSeed->modified ) {
+		net_simSeed->modified = qfalse;
+		net_simRandom = net_simSeed->integer;
+	}
+	net_simRandom = net_simRandom * 1664525 + 1013904223;
+	return ( net_simRandom >> 8 ) / (float)( 1 << 24 );
+}
+
+/*
+==============
+NET_QueuePacket
+
+Inserts behind the packets released at the same time, so a fixed delay
+keeps the order
+==============
+*/
+static void NET_QueuePacket( int length, const void *data, netadr_t adr,
+	qboolean incoming, int release )
+{
+	packetQueue_t *new, **next;
 
 	new = S_Malloc(sizeof(packetQueue_t));
 	new->data = S_Malloc(length);
 	Com_Memcpy(new->data, data, length);
 	new->length = length;
-	new->to = to;
-	new->release = Sys_Milliseconds() + (int)((float)offset / com_timescale->value);	
-	new->next = NULL;
+	new->adr = adr;
+	new->incoming = incoming;
+	new->release = release;
 
-	if(!packetQueue) {
-		packetQueue = new;
-		return;
+	for ( next = &packetQueue; *next && (*next)->release <= release; next = &(*next)->next ) {
 	}
-	while(next) {
-		if(!next->next) {
-			next->next = new;
-			return;
+	new->next = *next;
+	*next = new;
+}
+
+/*
+==============
+NET_SimulatePacket
+
+Returns qfalse if the packet goes through untouched, otherwise it
+has been queued or dropped. delay is the old cl_ and sv_packetdelay.
+==============
+*/
+static qboolean NET_SimulatePacket( netSim_t *sim, int length, const void *data, netadr_t adr,
+	qboolean incoming, int delay )
+{
+	int		now, release, copies, jitter;
+
+	if ( !delay && sim->lag->integer <= 0 && sim->jitter->integer <= 0 && sim->loss->value <= 0
+		&& sim->dup->value <= 0 && sim->rate->integer <= 0 ) {
+		return qfalse;
+	}
+
+	if ( sim->loss->value > 0 && NET_SimFraction() * 100 < sim->loss->value ) {
+		return qtrue;
+	}
+
+	now = Sys_Milliseconds();
+	release = now;
+
+	// the capped link sends one packet after another and drops what
+	// would wait too long for it
+	if ( sim->rate->integer > 0 ) {
+		if ( sim->linkFree < now ) {
+			sim->linkFree = now;
+		}
+		if ( sim->linkFree - now > NET_SIM_MAX_BACKLOG ) {
+			return qtrue;
 		}
-		next = next->next;
+		sim->linkFree += ( length + NET_SIM_UDPIP_HEADER ) * 1000.0 / sim->rate->integer;
+		release = (int)sim->linkFree;
 	}
+
+	if ( sim->lag->integer > 0 ) {
+		delay += sim->lag->integer;
+	}
+
+	copies = ( sim->dup->value > 0 && NET_SimFraction() * 100 < sim->dup->value ) ? 2 : 1;
+	while ( copies-- ) {
+		jitter = sim->jitter->integer > 0 ? (int)( NET_SimFraction() * sim->jitter->integer ) : 0;
+		NET_QueuePacket( length, data, adr, incoming,
+			release + (int)( ( delay + jitter ) / com_timescale->value ) );
+	}
+
+	return qtrue;
 }
 
-void NET_FlushPacketQueue(void)
+/*
+==============
+NET_SimulateIncoming
+
+Called by NET_Event for each packet read from a socket, returns qtrue
+if it has been held back or dropped
+==============
+*/
+qboolean NET_SimulateIncoming( netadr_t *from, msg_t *msg ) {
+	return NET_SimulatePacket( &net_simIn, msg->cursize, msg->data, *from, qtrue, 0 );
+}
+
+/*
+==============
+NET_DeliverPacket
+
+Hands a received packet to the server, or to the client when no server
+is running
+==============
+*/
+void NET_DeliverPacket( netadr_t *from, msg_t *msg ) {
+	if ( com_sv_running->integer ) {
+		Com_RunAndTimeServerPacket( from, msg );
+	} else {
+		CL_PacketEvent( *from, msg );
+	}
+}
+
+/*
+==============
+NET_FlushPacketQueue
+
+Sends and delivers the packets that are due, returns the msec until the
+next one or -1 when none are waiting
+==============
+*/
+int NET_FlushPacketQueue(void)
 {
 	packetQueue_t *last;
+	byte bufData[MAX_MSGLEN + 1];
+	msg_t msg;
 	int now;
 
 	while(packetQueue) {
 		now = Sys_Milliseconds();
-		if(packetQueue->release >= now)
-			break;
-		Sys_SendPacket(packetQueue->length, packetQueue->data,
-			packetQueue->to);
+		if(packetQueue->release > now)
+			return packetQueue->release - now;
 		last = packetQueue;
 		packetQueue = packetQueue->next;
+		if(last->incoming) {
+			MSG_Init(&msg, bufData, sizeof(bufData));
+			Com_Memcpy(msg.data, last->data, last->length);
+			msg.cursize = last->length;
+			NET_DeliverPacket(&last->adr, &msg);
+		} else {
+			Sys_SendPacket(last->length, last->data, last->adr);
+		}
 		Z_Free(last->data);
 		Z_Free(last);
 	}
+	return -1;
 }
 
 void NET_SendPacket( netsrc_t sock, int length, const void *data, netadr_t to ) {
+	int		delay;
 
 	// sequenced packets are shown in netchan, so just show oob
 	if ( showpackets->integer && *(int *)data == -1 )	{
@@ -545,6 +816,9 @@ void NET_SendPacket( netsrc_t sock, int length, const void *data, netadr_t to )
 		NET_SendLoopPacket (sock, length, data, to);
 		return;
 	}
+	if ( SV_LoadTestPacket( sock, length, data, to ) ) {
+		return;
+	}
 	if ( to.type == NA_BOT ) {
 		return;
 	}
@@ -552,13 +826,18 @@ void NET_SendPacket( netsrc_t sock, int length, const void *data, netadr_t to )
 		return;
 	}
 
+	delay = 0;
 	if ( sock == NS_CLIENT && cl_packetdelay->integer > 0 ) {
-		NET_QueuePacket( length, data, to, cl_packetdelay->integer );
+		delay = cl_packetdelay->integer;
 	}
 	else if ( sock == NS_SERVER && sv_packetdelay->integer > 0 ) {
-		NET_QueuePacket( length, data, to, sv_packetdelay->integer );
+		delay = sv_packetdelay->integer;
 	}
-	else {
+	if ( delay > 999 ) {
+		delay = 999;
+	}
+
+	if ( !NET_SimulatePacket( &net_simOut, length, data, to, qfalse, delay ) ) {
 		Sys_SendPacket( length, data, to );
 	}
 }
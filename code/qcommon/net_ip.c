@@ -20,6 +20,14 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 ===========================================================================
 */
 
+#ifdef __linux__
+	// batch datagrams through sendmmsg/recvmmsg
+#	define NET_MMSG
+#	ifndef _GNU_SOURCE
+#		define _GNU_SOURCE
+#	endif
+#endif
+
 #include "../qcommon/q_shared.h"
 #include "../qcommon/qcommon.h"
 
@@ -152,6 +160,38 @@ typedef struct
 static nip_localaddr_t localIP[MAX_IPS];
 static int numIP;
 
+#ifdef NET_MMSG
+#define	MMSG_SEND_PACKETS	64
+#define	MMSG_SEND_BYTES		0x10000
+#define	MMSG_RECV_PACKETS	16
+
+// datagrams queued for one socket until Sys_FlushPackets
+typedef struct
+{
+	struct mmsghdr			hdrs[MMSG_SEND_PACKETS];
+	struct iovec			iov[MMSG_SEND_PACKETS];
+	struct sockaddr_storage	addrs[MMSG_SEND_PACKETS];
+	netadrtype_t			types[MMSG_SEND_PACKETS];
+	int						numPackets;
+	int						numBytes;
+	byte					data[MMSG_SEND_BYTES];
+} mmsgSendQueue_t;
+
+// datagrams already received on one socket, handed out by NET_GetPacket
+typedef struct
+{
+	struct mmsghdr			hdrs[MMSG_RECV_PACKETS];
+	struct iovec			iov[MMSG_RECV_PACKETS];
+	struct sockaddr_storage	addrs[MMSG_RECV_PACKETS];
+	int						numPackets;
+	int						nextPacket;
+	byte					data[MMSG_RECV_PACKETS][MAX_MSGLEN + 1];
+} mmsgRecvQueue_t;
+
+static mmsgSendQueue_t	ip_sendQueue, ip6_sendQueue;
+static mmsgRecvQueue_t	ip_recvQueue, ip6_recvQueue;
+#endif
+
 
 //=============================================================================
 
@@ -520,6 +560,62 @@ qboolean	NET_IsLocalAddress( netadr_t adr ) {
 
 //=============================================================================
 
+/*
+==================
+NET_RecvFrom
+
+recvfrom, but served from a recvmmsg batch where that's available
+==================
+*/
+#ifdef NET_MMSG
+static int NET_RecvFrom( SOCKET s, mmsgRecvQueue_t *q, byte *data, int maxsize, struct sockaddr_storage *from, socklen_t *fromlen )
+{
+	struct mmsghdr	*hdr;
+	int		i, ret;
+
+	if ( q->nextPacket >= q->numPackets )
+	{
+		q->numPackets = q->nextPacket = 0;
+
+		memset( q->hdrs, 0, sizeof( q->hdrs ) );
+		for ( i = 0; i < MMSG_RECV_PACKETS; i++ )
+		{
+			q->iov[i].iov_base = q->data[i];
+			q->iov[i].iov_len = sizeof( q->data[i] );
+			q->hdrs[i].msg_hdr.msg_name = &q->addrs[i];
+			q->hdrs[i].msg_hdr.msg_namelen = sizeof( q->addrs[i] );
+			q->hdrs[i].msg_hdr.msg_iov = &q->iov[i];
+			q->hdrs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		ret = recvmmsg( s, q->hdrs, MMSG_RECV_PACKETS, MSG_DONTWAIT, NULL );
+		if ( ret <= 0 )
+		{
+			if ( !ret )
+				errno = EAGAIN;
+			return SOCKET_ERROR;
+		}
+
+		q->numPackets = ret;
+	}
+
+	hdr = &q->hdrs[q->nextPacket];
+	ret = hdr->msg_len;
+	if ( ret > maxsize )
+		ret = maxsize;
+
+	memcpy( data, q->data[q->nextPacket], ret );
+	memcpy( from, &q->addrs[q->nextPacket], hdr->msg_hdr.msg_namelen );
+	*fromlen = hdr->msg_hdr.msg_namelen;
+	q->nextPacket++;
+
+	return ret;
+}
+#else
+#define NET_RecvFrom( s, q, data, maxsize, from, fromlen ) \
+	recvfrom( ( s ), (void *)( data ), ( maxsize ), 0, (struct sockaddr *)( from ), ( fromlen ) )
+#endif
+
 /*
 ==================
 NET_GetPacket
@@ -537,7 +633,7 @@ qboolean NET_GetPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr)
 	if(ip_socket != INVALID_SOCKET && FD_ISSET(ip_socket, fdr))
 	{
 		fromlen = sizeof(from);
-		ret = recvfrom( ip_socket, (void *)net_message->data, net_message->maxsize, 0, (struct sockaddr *) &from, &fromlen );
+		ret = NET_RecvFrom( ip_socket, &ip_recvQueue, net_message->data, net_message->maxsize, &from, &fromlen );
 		
 		if (ret == SOCKET_ERROR)
 		{
@@ -581,7 +677,7 @@ qboolean NET_GetPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr)
 	if(ip6_socket != INVALID_SOCKET && FD_ISSET(ip6_socket, fdr))
 	{
 		fromlen = sizeof(from);
-		ret = recvfrom(ip6_socket, (void *)net_message->data, net_message->maxsize, 0, (struct sockaddr *) &from, &fromlen);
+		ret = NET_RecvFrom( ip6_socket, &ip6_recvQueue, net_message->data, net_message->maxsize, &from, &fromlen );
 		
 		if (ret == SOCKET_ERROR)
 		{
@@ -642,6 +738,92 @@ qboolean NET_GetPacket(netadr_t *net_from, msg_t *net_message, fd_set *fdr)
 
 static char socksBuf[4096];
 
+/*
+==================
+NET_SendError
+==================
+*/
+static void NET_SendError( netadrtype_t type ) {
+	int err = socketError;
+
+	// wouldblock is silent
+	if( err == EAGAIN ) {
+		return;
+	}
+
+	// some PPP links do not allow broadcasts and return an error
+	if( ( err == EADDRNOTAVAIL ) && ( ( type == NA_BROADCAST ) ) ) {
+		return;
+	}
+
+	Com_Printf( "Sys_SendPacket: %s\n", NET_ErrorString() );
+}
+
+#ifdef NET_MMSG
+/*
+==================
+NET_FlushSendQueue
+==================
+*/
+static void NET_FlushSendQueue( mmsgSendQueue_t *q, SOCKET s ) {
+	int		sent, ret;
+
+	sent = 0;
+	while ( sent < q->numPackets && s != INVALID_SOCKET ) {
+		ret = sendmmsg( s, q->hdrs + sent, q->numPackets - sent, 0 );
+		if ( ret == SOCKET_ERROR ) {
+			// drop the datagram that failed and keep going
+			NET_SendError( q->types[sent] );
+			ret = 1;
+		}
+		sent += ret;
+	}
+
+	q->numPackets = 0;
+	q->numBytes = 0;
+}
+
+/*
+==================
+NET_QueuePacket
+==================
+*/
+static void NET_QueuePacket( mmsgSendQueue_t *q, SOCKET s, int length, const void *data,
+							 const struct sockaddr_storage *addr, socklen_t addrlen, netadrtype_t type ) {
+	struct mmsghdr	*hdr;
+	int		i;
+
+	if ( length > MMSG_SEND_BYTES ) {
+		NET_FlushSendQueue( q, s );
+		if ( sendto( s, data, length, 0, (const struct sockaddr *) addr, addrlen ) == SOCKET_ERROR ) {
+			NET_SendError( type );
+		}
+		return;
+	}
+
+	if ( q->numPackets == MMSG_SEND_PACKETS || q->numBytes + length > MMSG_SEND_BYTES ) {
+		NET_FlushSendQueue( q, s );
+	}
+
+	i = q->numPackets++;
+	memcpy( q->data + q->numBytes, data, length );
+	memcpy( &q->addrs[i], addr, addrlen );
+	q->types[i] = type;
+
+	q->iov[i].iov_base = q->data + q->numBytes;
+	q->iov[i].iov_len = length;
+
+	hdr = &q->hdrs[i];
+	memset( hdr, 0, sizeof( *hdr ) );
+	hdr->msg_hdr.msg_name = &q->addrs[i];
+	hdr->msg_hdr.msg_namelen = addrlen;
+	hdr->msg_hdr.msg_iov = &q->iov[i];
+	hdr->msg_hdr.msg_iovlen = 1;
+
+	q->numBytes += length;
+}
+#endif
+
 /*
 ==================
 Sys_SendPacket
@@ -680,26 +862,41 @@ void Sys_SendPacket( int length, const void *data, netadr_t to ) {
 		ret = sendto( ip_socket, socksBuf, length+10, 0, &socksRelayAddr, sizeof(socksRelayAddr) );
 	}
 	else {
+#ifdef NET_MMSG
+		if(addr.ss_family == AF_INET)
+		{
+			NET_QueuePacket( &ip_sendQueue, ip_socket, length, data, &addr, sizeof(struct sockaddr_in), to.type );
+			return;
+		}
+		else if(addr.ss_family == AF_INET6)
+		{
+			NET_QueuePacket( &ip6_sendQueue, ip6_socket, length, data, &addr, sizeof(struct sockaddr_in6), to.type );
+			return;
+		}
+#else
 		if(addr.ss_family == AF_INET)
 			ret = sendto( ip_socket, data, length, 0, (struct sockaddr *) &addr, sizeof(struct sockaddr_in) );
 		else if(addr.ss_family == AF_INET6)
 			ret = sendto( ip6_socket, data, length, 0, (struct sockaddr *) &addr, sizeof(struct sockaddr_in6) );
+#endif
 	}
 	if( ret == SOCKET_ERROR ) {
-		int err = socketError;
-
-		// wouldblock is silent
-		if( err == EAGAIN ) {
-			return;
-		}
+		NET_SendError( to.type );
+	}
+}
 
-		// some PPP links do not allow broadcasts and return an error
-		if( ( err == EADDRNOTAVAIL ) && ( ( to.type == NA_BROADCAST ) ) ) {
-			return;
-		}
+/*
+==================
+Sys_FlushPackets
 
-		Com_Printf( "Sys_SendPacket: %s\n", NET_ErrorString() );
-	}
+Sends everything Sys_SendPacket has queued
+==================
+*/
+void Sys_FlushPackets( void ) {
+#ifdef NET_MMSG
+	NET_FlushSendQueue( &ip_sendQueue, ip_socket );
+	NET_FlushSendQueue( &ip6_sendQueue, ip6_socket );
+#endif
 }
 
 
@@ -1536,6 +1733,13 @@ void NET_Config( qboolean enableNetworking ) {
 	}
 
 	if( stop ) {
+		// anything still queued goes out before its socket closes
+		Sys_FlushPackets();
+#ifdef NET_MMSG
+		ip_recvQueue.numPackets = ip_recvQueue.nextPacket = 0;
+		ip6_recvQueue.numPackets = ip6_recvQueue.nextPacket = 0;
+#endif
+
 		if ( ip_socket != INVALID_SOCKET ) {
 			closesocket( ip_socket );
 			ip_socket = INVALID_SOCKET;
@@ -1642,10 +1846,8 @@ void NET_Event(fd_set *fdr)
 					continue;          // drop this packet
 			}
 
-			if(com_sv_running->integer)
-				Com_RunAndTimeServerPacket(&from, &netmsg);
-			else
-				CL_PacketEvent(from, &netmsg);
+			if(!NET_SimulateIncoming(&from, &netmsg))
+				NET_DeliverPacket(&from, &netmsg);
 		}
 		else
 			break;
@@ -1669,6 +1871,9 @@ void NET_Sleep(int msec)
 	if(msec < 0)
 		msec = 0;
 
+	// don't hold replies while waiting for the next packet
+	Sys_FlushPackets();
+
 	FD_ZERO(&fdr);
 
 	if(ip_socket != INVALID_SOCKET)
@@ -1694,11 +1899,34 @@ void NET_Sleep(int msec)
 	}
 #endif
 
+#ifdef NET_MMSG
+	// the rest of a batch that NET_Event stopped short of is already here
+	if(ip_recvQueue.nextPacket < ip_recvQueue.numPackets ||
+	   ip6_recvQueue.nextPacket < ip6_recvQueue.numPackets)
+		msec = 0;
+#endif
+
 	timeout.tv_sec = msec/1000;
 	timeout.tv_usec = (msec%1000)*1000;
 
 	retval = select(highestfd + 1, &fdr, NULL, NULL, &timeout);
 
+#ifdef NET_MMSG
+	if(retval != SOCKET_ERROR)
+	{
+		if(ip_recvQueue.nextPacket < ip_recvQueue.numPackets)
+		{
+			FD_SET(ip_socket, &fdr);
+			retval++;
+		}
+		if(ip6_recvQueue.nextPacket < ip6_recvQueue.numPackets)
+		{
+			FD_SET(ip6_socket, &fdr);
+			retval++;
+		}
+	}
+#endif
+
 	if(retval == SOCKET_ERROR)
 		Com_Printf("Warning: select() syscall failed: %s\n", NET_ErrorString());
 	else if(retval > 0)
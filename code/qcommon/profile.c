@@ -0,0 +1,353 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// profile.c -- scoped timing zones written out as a chrome trace
+
+// "profile <frames> [file]" records every PROFILE_BEGIN / PROFILE_END pair
+// on every thread for that many frames, then writes them as trace event
+// json that chrome://tracing and Perfetto load.  Each thread keeps its own
+// stack of open zones; a closed zone takes the next slot of one shared
+// array through an atomic add, so threads never wait on each other.  When
+// nothing is being recorded a zone costs the test of a flag.
+//
+// "+set com_profileStartup <file>" on the command line records Com_Init
+// the same way and lists its phases on the console as it finishes.
+
+#include "q_shared.h"
+#include "qcommon.h"
+
+#define	MAX_PROFILE_EVENTS	( 256 * 1024 )
+#define	MAX_PROFILE_DEPTH	32
+
+typedef struct {
+	const char	*name;			// set last, a slot still being filled has none
+	int64_t		start;
+	int			usec;
+	int			thread;
+} profileEvent_t;
+
+typedef struct {
+	const char	*name;
+	int64_t		start;
+} profileZone_t;
+
+int					com_profiling;
+Q_THREAD_LOCAL int	com_profileDepth;
+
+static Q_THREAD_LOCAL profileZone_t	profileStack[MAX_PROFILE_DEPTH];
+static Q_THREAD_LOCAL int			profileThread;	// 0 until the thread's first zone
+
+static struct {
+	volatile int	numEvents;
+	volatile int	numThreads;
+	int				framesLeft;
+	qboolean		startup;		// recording Com_Init rather than frames
+	int64_t			startTime;
+	char			filename[MAX_QPATH];
+
+	// untouched pages cost nothing until something is recorded
+	profileEvent_t	events[MAX_PROFILE_EVENTS];
+} profile;
+
+/*
+=================
+Com_ProfileBegin
+=================
+*/
+void Com_ProfileBegin( const char *name ) {
+	profileZone_t	*zone;
+
+	if ( !com_profiling ) {
+		return;
+	}
+
+	// deeper zones are left out, their ends still balance
+	if ( com_profileDepth < MAX_PROFILE_DEPTH ) {
+		zone = &profileStack[com_profileDepth];
+		zone->name = name;
+		zone->start = Sys_Microseconds();
+	}
+	com_profileDepth++;
+}
+
+/*
+=================
+Com_ProfileEnd
+=================
+*/
+void Com_ProfileEnd( void ) {
+	profileZone_t	*zone;
+	profileEvent_t	*ev;
+	int64_t			now;
+	int				i;
+
+	if ( !com_profileDepth ) {
+		return;		// begun before the recording started
+	}
+	com_profileDepth--;
+
+	if ( !com_profiling || com_profileDepth >= MAX_PROFILE_DEPTH ) {
+		return;
+	}
+
+	now = Sys_Microseconds();
+	zone = &profileStack[com_profileDepth];
+
+	if ( !profileThread ) {
+		profileThread = Sys_AtomicAdd( &profile.numThreads, 1 );
+	}
+
+	i = Sys_AtomicAdd( &profile.numEvents, 1 ) - 1;
+	if ( i >= MAX_PROFILE_EVENTS ) {
+		return;
+	}
+
+	ev = &profile.events[i];
+	ev->start = zone->start;
+	ev->usec = (int)( now - zone->start );
+	ev->thread = profileThread;
+	ev->name = zone->name;
+}
+
+/*
+=================
+Com_WriteProfile
+=================
+*/
+static void Com_WriteProfile( void ) {
+	fileHandle_t	f;
+	profileEvent_t	*ev;
+	int				i, count, written;
+
+	count = MIN( profile.numEvents, MAX_PROFILE_EVENTS );
+
+	f = FS_FOpenFileWrite_HomeData( profile.filename );
+	if ( !f ) {
+		Com_Printf( "Couldn't write %s\n", profile.filename );
+		return;
+	}
+
+	FS_Printf( f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+	FS_Printf( f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"%s\"}}", Q3_VERSION );
+
+	written = 0;
+	for ( i = 0, ev = profile.events; i < count; i++, ev++ ) {
+		if ( !ev->name ) {
+			continue;
+		}
+		FS_Printf( f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%i,\"ts\":%lli,\"dur\":%i}",
+			ev->name, ev->thread, (long long)( ev->start - profile.startTime ), ev->usec );
+		written++;
+	}
+
+	FS_Printf( f, "\n]}\n" );
+	FS_FCloseFile( f );
+
+	Com_Printf( "Wrote %i zones to %s", written, profile.filename );
+	if ( profile.numEvents > MAX_PROFILE_EVENTS ) {
+		Com_Printf( ", %i more didn't fit", profile.numEvents - MAX_PROFILE_EVENTS );
+	}
+	Com_Printf( "\n" );
+}
+
+/*
+=================
+Com_ProfileFrame
+
+Called by Com_Frame as it starts and, with end set, finishes.  Zones
+that were open when an error jumped out of the last frame are dropped.
+=================
+*/
+void Com_ProfileFrame( qboolean end ) {
+	if ( !end ) {
+		com_profileDepth = 0;
+		PROFILE_BEGIN( "Com_Frame" );
+		return;
+	}
+
+	PROFILE_END();
+
+	if ( !com_profiling || --profile.framesLeft > 0 ) {
+		return;
+	}
+
+	com_profiling = 0;
+	Com_WriteProfile();
+}
+
+/*
+=================
+Com_CompareZoneStart
+
+Earliest first, and the outer of two zones that start together first
+=================
+*/
+static int Com_CompareZoneStart( const void *a, const void *b ) {
+	const profileEvent_t	*ea = *(const profileEvent_t **)a;
+	const profileEvent_t	*eb = *(const profileEvent_t **)b;
+
+	if ( ea->start != eb->start ) {
+		return ea->start < eb->start ? -1 : 1;
+	}
+	return eb->usec - ea->usec;
+}
+
+/*
+=================
+Com_PrintStartupZones
+
+Lists the zones of this thread in the order they started, indented by
+how deep they are nested
+=================
+*/
+#define	MAX_STARTUP_ZONES	4096
+
+static void Com_PrintStartupZones( void ) {
+	static profileEvent_t	*zones[MAX_STARTUP_ZONES];
+	int64_t			ends[MAX_PROFILE_DEPTH];
+	profileEvent_t	*ev;
+	int				i, count, numZones, depth;
+
+	count = MIN( profile.numEvents, MAX_PROFILE_EVENTS );
+
+	numZones = 0;
+	for ( i = 0, ev = profile.events; i < count && numZones < MAX_STARTUP_ZONES; i++, ev++ ) {
+		if ( ev->name && ev->thread == profileThread ) {
+			zones[numZones++] = ev;
+		}
+	}
+	qsort( zones, numZones, sizeof( zones[0] ), Com_CompareZoneStart );
+
+	Com_Printf( "----- Startup phases -----\n" );
+	depth = 0;
+	for ( i = 0; i < numZones; i++ ) {
+		ev = zones[i];
+		while ( depth && ev->start >= ends[depth - 1] ) {
+			depth--;
+		}
+		Com_Printf( "%*s%-*s %9.2f ms\n", depth * 2, "", 32 - depth * 2, ev->name, ev->usec / 1000.0 );
+		if ( depth < MAX_PROFILE_DEPTH ) {
+			ends[depth++] = ev->start + ev->usec;
+		}
+	}
+}
+
+/*
+=================
+Com_ProfileStartup
+
+Called by Com_Init once the command line is parsed and, with end set,
+as it finishes
+=================
+*/
+void Com_ProfileStartup( qboolean end ) {
+	cvar_t	*profileStartup;
+
+	if ( end ) {
+		if ( !profile.startup ) {
+			return;
+		}
+		PROFILE_END();
+		com_profiling = 0;
+		profile.startup = qfalse;
+
+		Com_PrintStartupZones();
+		Com_WriteProfile();
+		return;
+	}
+
+	Com_StartupVariable( "com_profileStartup" );
+	profileStartup = Cvar_Get( "com_profileStartup", "", CVAR_INIT );
+	if ( !profileStartup->string[0] ) {
+		return;
+	}
+
+	Q_strncpyz( profile.filename, profileStartup->string, sizeof( profile.filename ) );
+	COM_DefaultExtension( profile.filename, sizeof( profile.filename ), ".json" );
+
+	profile.numEvents = 0;
+	profile.startTime = Sys_Microseconds();
+	profile.startup = qtrue;
+	com_profiling = 1;
+
+	PROFILE_BEGIN( "Com_Init" );
+}
+
+/*
+=================
+Com_Profile_f
+=================
+*/
+static void Com_Profile_f( void ) {
+	int		frames;
+
+	if ( Cmd_Argc() < 2 ) {
+		Com_Printf( "usage: profile <frames> [file]\n" );
+		return;
+	}
+
+	if ( profile.startup ) {
+		Com_Printf( "Already recording the startup\n" );
+		return;
+	}
+
+	if ( com_profiling ) {
+		Com_Printf( "Already recording, %i frames left\n", profile.framesLeft );
+		return;
+	}
+
+	frames = atoi( Cmd_Argv( 1 ) );
+	if ( frames < 1 ) {
+		Com_Printf( "profile: need at least one frame\n" );
+		return;
+	}
+
+	if ( Cmd_Argc() > 2 ) {
+		Q_strncpyz( profile.filename, Cmd_Argv( 2 ), sizeof( profile.filename ) );
+		COM_DefaultExtension( profile.filename, sizeof( profile.filename ), ".json" );
+	} else {
+		Q_strncpyz( profile.filename, "profile.json", sizeof( profile.filename ) );
+	}
+
+	if ( !COM_CompareExtension( profile.filename, ".json" ) ) {
+		Com_Printf( "profile: %s isn't a .json file\n", profile.filename );
+		return;
+	}
+
+	Com_Memset( profile.events, 0, MIN( profile.numEvents, MAX_PROFILE_EVENTS ) * sizeof( profile.events[0] ) );
+	profile.numEvents = 0;
+	profile.startTime = Sys_Microseconds();
+
+	// this frame began before the recording and doesn't count
+	profile.framesLeft = frames + 1;
+	com_profiling = 1;
+
+	Com_Printf( "Recording %i frames to %s\n", frames, profile.filename );
+}
+
+/*
+=================
+Com_InitProfile
+=================
+*/
+void Com_InitProfile( void ) {
+	Cmd_AddCommand( "profile", Com_Profile_f );
+}
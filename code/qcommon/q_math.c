@@ -31,6 +31,14 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "q_shared.h"
 
+#if !defined( Q3_VM ) && ( idx64 || defined( __SSE__ ) )
+#include <xmmintrin.h>
+#define Q_SSE
+#elif !defined( Q3_VM ) && ( defined( __ARM_NEON ) || defined( __ARM_NEON__ ) )
+#include <arm_neon.h>
+#define Q_NEON
+#endif
+
 vec3_t	vec3_origin = {0.0f, 0.0f, 0.0f};
 vec3_t	axisDefault[3] =
 {
@@ -690,6 +698,194 @@ int BoxOnPlaneSide(vec3_t emins, vec3_t emaxs, struct cplane_s *p)
 	return sides;
 }
 
+#if defined( Q_SSE ) || defined( Q_NEON )
+/*
+==================
+BoxOnPlaneSide4
+
+The general case of BoxOnPlaneSide for four planes, with the same
+products summed in the same order so the answers match. Returns the
+sides of plane i in bits i and i + 4.
+==================
+*/
+static int BoxOnPlaneSide4( const vec3_t emins, const vec3_t emaxs, const float *normal[3], const float *dist ) {
+#if defined( Q_SSE )
+	__m128	n, mask, d0, d1, zero;
+	int		i;
+
+	zero = _mm_setzero_ps();
+	d0 = d1 = zero;
+
+	// dist[0] takes the mins on the axes the normal points down
+	for ( i = 0 ; i < 3 ; i++ ) {
+		n = _mm_loadu_ps( normal[i] );
+		mask = _mm_cmplt_ps( n, zero );
+		d0 = _mm_add_ps( d0, _mm_mul_ps( n, _mm_or_ps( _mm_and_ps( mask, _mm_set1_ps( emins[i] ) ),
+			_mm_andnot_ps( mask, _mm_set1_ps( emaxs[i] ) ) ) ) );
+		d1 = _mm_add_ps( d1, _mm_mul_ps( n, _mm_or_ps( _mm_and_ps( mask, _mm_set1_ps( emaxs[i] ) ),
+			_mm_andnot_ps( mask, _mm_set1_ps( emins[i] ) ) ) ) );
+	}
+
+	return _mm_movemask_ps( _mm_cmpge_ps( d0, _mm_loadu_ps( dist ) ) )
+		| ( _mm_movemask_ps( _mm_cmplt_ps( d1, _mm_loadu_ps( dist ) ) ) << 4 );
+#else
+	float32x4_t	n, d0, d1, zero;
+	uint32x4_t	mask;
+	uint32_t	front[4], back[4];
+	int			i, sides;
+
+	zero = vdupq_n_f32( 0 );
+	d0 = d1 = zero;
+
+	// dist[0] takes the mins on the axes the normal points down, and
+	// multiplies and adds are kept apart so nothing gets fused
+	for ( i = 0 ; i < 3 ; i++ ) {
+		n = vld1q_f32( normal[i] );
+		mask = vcltq_f32( n, zero );
+		d0 = vaddq_f32( d0, vmulq_f32( n, vbslq_f32( mask, vdupq_n_f32( emins[i] ), vdupq_n_f32( emaxs[i] ) ) ) );
+		d1 = vaddq_f32( d1, vmulq_f32( n, vbslq_f32( mask, vdupq_n_f32( emaxs[i] ), vdupq_n_f32( emins[i] ) ) ) );
+	}
+
+	vst1q_u32( front, vcgeq_f32( d0, vld1q_f32( dist ) ) );
+	vst1q_u32( back, vcltq_f32( d1, vld1q_f32( dist ) ) );
+
+	sides = 0;
+	for ( i = 0 ; i < 4 ; i++ ) {
+		sides |= ( front[i] & 1 ) << i;
+		sides |= ( back[i] & 1 ) << ( i + 4 );
+	}
+	return sides;
+#endif
+}
+#endif
+
+/*
+==================
+BoxCullPlanes
+
+BoxOnPlaneSide against each plane in planeBits, four planes at a time
+where SIMD is available. Returns planeBits without the planes the box
+is entirely in front of, or -1 if it is entirely behind one of them.
+==================
+*/
+int BoxCullPlanes( vec3_t emins, vec3_t emaxs, struct cplane_s *planes, int numPlanes, int planeBits ) {
+	int		i, sides;
+#if defined( Q_SSE ) || defined( Q_NEON )
+	float	normal[3][4], dist[4];
+	const float	*normals[3] = { normal[0], normal[1], normal[2] };
+	int		j, sides4, count;
+
+	for ( i = 0 ; i < numPlanes ; i += 4 ) {
+		if ( !( ( planeBits >> i ) & 15 ) ) {
+			continue;
+		}
+
+		count = numPlanes - i < 4 ? numPlanes - i : 4;
+		for ( j = 0 ; j < 4 ; j++ ) {
+			if ( j < count ) {
+				normal[0][j] = planes[i + j].normal[0];
+				normal[1][j] = planes[i + j].normal[1];
+				normal[2][j] = planes[i + j].normal[2];
+				dist[j] = planes[i + j].dist;
+			} else {
+				normal[0][j] = normal[1][j] = normal[2][j] = dist[j] = 0;
+			}
+		}
+
+		sides4 = BoxOnPlaneSide4( emins, emaxs, normals, dist );
+
+		for ( j = 0 ; j < count ; j++ ) {
+			if ( !( planeBits & ( 1 << ( i + j ) ) ) ) {
+				continue;
+			}
+			if ( planes[i + j].type < 3 ) {
+				sides = BoxOnPlaneSide( emins, emaxs, &planes[i + j] );
+			} else {
+				sides = ( ( sides4 >> j ) & 1 ) | ( ( ( sides4 >> ( j + 4 ) ) & 1 ) << 1 );
+			}
+			if ( sides == 2 ) {
+				return -1;
+			}
+			if ( sides == 1 ) {
+				planeBits &= ~( 1 << ( i + j ) );
+			}
+		}
+	}
+#else
+	for ( i = 0 ; i < numPlanes ; i++ ) {
+		if ( !( planeBits & ( 1 << i ) ) ) {
+			continue;
+		}
+		sides = BoxOnPlaneSide( emins, emaxs, &planes[i] );
+		if ( sides == 2 ) {
+			return -1;
+		}
+		if ( sides == 1 ) {
+			planeBits &= ~( 1 << i );
+		}
+	}
+#endif
+
+	return planeBits;
+}
+
+/*
+==================
+TransformPoints
+
+out = in[0] * axis[0] + in[1] * axis[1] + in[2] * axis[2] + origin for
+each point, summed left to right like R_LocalPointToWorld, four points
+at a time where SIMD is available. in and out may be the same.
+==================
+*/
+void TransformPoints( const vec3_t *in, vec3_t *out, int numPoints, vec3_t axis[3], const vec3_t origin ) {
+	int		i, j;
+#if defined( Q_SSE ) || defined( Q_NEON )
+	float	p[3][4], o[3][4];
+	int		k, count;
+
+	for ( i = 0 ; i < numPoints ; i += 4 ) {
+		count = numPoints - i < 4 ? numPoints - i : 4;
+		for ( j = 0 ; j < 4 ; j++ ) {
+			for ( k = 0 ; k < 3 ; k++ ) {
+				p[k][j] = j < count ? in[i + j][k] : 0;
+			}
+		}
+
+		for ( k = 0 ; k < 3 ; k++ ) {
+#if defined( Q_SSE )
+			_mm_storeu_ps( o[k], _mm_add_ps( _mm_add_ps( _mm_add_ps(
+				_mm_mul_ps( _mm_loadu_ps( p[0] ), _mm_set1_ps( axis[0][k] ) ),
+				_mm_mul_ps( _mm_loadu_ps( p[1] ), _mm_set1_ps( axis[1][k] ) ) ),
+				_mm_mul_ps( _mm_loadu_ps( p[2] ), _mm_set1_ps( axis[2][k] ) ) ),
+				_mm_set1_ps( origin[k] ) ) );
+#else
+			vst1q_f32( o[k], vaddq_f32( vaddq_f32( vaddq_f32(
+				vmulq_n_f32( vld1q_f32( p[0] ), axis[0][k] ),
+				vmulq_n_f32( vld1q_f32( p[1] ), axis[1][k] ) ),
+				vmulq_n_f32( vld1q_f32( p[2] ), axis[2][k] ) ),
+				vdupq_n_f32( origin[k] ) ) );
+#endif
+		}
+
+		for ( j = 0 ; j < count ; j++ ) {
+			out[i + j][0] = o[0][j];
+			out[i + j][1] = o[1][j];
+			out[i + j][2] = o[2][j];
+		}
+	}
+#else
+	vec3_t	v;
+
+	for ( i = 0 ; i < numPoints ; i++ ) {
+		VectorCopy( in[i], v );
+		for ( j = 0 ; j < 3 ; j++ ) {
+			out[i][j] = v[0] * axis[0][j] + v[1] * axis[1][j] + v[2] * axis[2][j] + origin[j];
+		}
+	}
+#endif
+}
+
 
 /*
 =================
@@ -137,6 +137,15 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #define Q_EXPORT
 #endif
 
+// storage that every thread gets its own copy of
+#if (defined _MSC_VER)
+#define Q_THREAD_LOCAL __declspec(thread)
+#elif (defined __GNUC__)
+#define Q_THREAD_LOCAL __thread
+#else
+#define Q_THREAD_LOCAL
+#endif
+
 /**********************************************************************
   VM Considerations
 
@@ -684,6 +693,8 @@ void AxisCopy( vec3_t in[3], vec3_t out[3] );
 
 void SetPlaneSignbits( struct cplane_s *out );
 int BoxOnPlaneSide (vec3_t emins, vec3_t emaxs, struct cplane_s *plane);
+int BoxCullPlanes( vec3_t emins, vec3_t emaxs, struct cplane_s *planes, int numPlanes, int planeBits );
+void TransformPoints( const vec3_t *in, vec3_t *out, int numPoints, vec3_t axis[3], const vec3_t origin );
 
 qboolean BoundsIntersect(const vec3_t mins, const vec3_t maxs,
 		const vec3_t mins2, const vec3_t maxs2);
@@ -60,6 +60,11 @@ struct entityState_s;
 struct playerState_s;
 
 void MSG_WriteBits( msg_t *msg, int value, int bits );
+void MSG_CopyBits( byte *dst, int dstBit, const byte *src, int srcBit, int bits );
+void MSG_WriteBitString( msg_t *msg, const byte *data, int bits );
+void MSG_ReadBitString( msg_t *msg, byte *data, int bits );
+int MSG_Deflate( const void *in, int inLength, byte *out, int outSize );
+int MSG_Inflate( const byte *in, int inLength, void *out, int outSize );
 
 void MSG_WriteChar (msg_t *sb, int c);
 void MSG_WriteByte (msg_t *sb, int c);
@@ -102,6 +107,34 @@ void MSG_ReadDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct pl
 
 void MSG_ReportChangeVectors_f( void );
 
+// snapshot deltas written by the server's recordmsgs command and replayed
+// by msgbench, in native byte order.  Each record is followed by the from
+// and to states its flags say it has.
+#define	MSG_CAPTURE_IDENT	(('P'<<24)+('A'<<16)+('C'<<8)+'M')
+#define	MSG_CAPTURE_VERSION	1
+
+#define	MSGCF_FROM			1
+#define	MSGCF_TO			2
+#define	MSGCF_FORCE			4
+
+typedef enum {
+	MSGC_SNAPSHOT,			// the deltas after it go in one snapshot
+	MSGC_PLAYERSTATE,
+	MSGC_ENTITY
+} msgCaptureType_t;
+
+typedef struct {
+	int			ident;
+	int			version;
+	int			entityStateSize;	// a capture only replays with the same structs
+	int			playerStateSize;
+} msgCaptureHeader_t;
+
+typedef struct {
+	int			type;
+	int			flags;
+} msgCaptureRecord_t;
+
 //============================================================================
 
 /*
@@ -163,7 +196,9 @@ void		NET_Init( void );
 void		NET_Shutdown( void );
 void		NET_Restart_f( void );
 void		NET_Config( qboolean enableNetworking );
-void		NET_FlushPacketQueue(void);
+int			NET_FlushPacketQueue(void);
+qboolean	NET_SimulateIncoming( netadr_t *from, msg_t *msg );
+void		NET_DeliverPacket( netadr_t *from, msg_t *msg );
 void		NET_SendPacket (netsrc_t sock, int length, const void *data, netadr_t to);
 void		QDECL NET_OutOfBandPrint( netsrc_t net_socket, netadr_t adr, const char *format, ...) Q_PRINTF_FUNC(3, 4);
 void		QDECL NET_OutOfBandData( netsrc_t sock, netadr_t adr, byte *format, int len );
@@ -187,6 +222,8 @@ void		NET_Sleep(int msec);
 #define MAX_DOWNLOAD_WINDOW		48	// ACK window of 48 download chunks. Cannot set this higher, or clients
 						// will overflow the reliable commands buffer
 #define MAX_DOWNLOAD_BLKSIZE		1024	// 896 byte block chunks
+#define MAX_DOWNLOAD_BLKSIZE_EXT	16384	// clients that name a block size after the
+						// "download" file can be sent blocks up to this
 
 #define NETCHAN_GENCHECKSUM(challenge, sequence) ((challenge) ^ ((sequence) * (challenge)))
 
@@ -206,10 +243,13 @@ typedef struct {
 	int			incomingSequence;
 	int			outgoingSequence;
 
-	// incoming fragment assembly buffer
+	int			fragmentSize;		// agreed on when connecting
+
+	// incoming fragment assembly buffer, behind room for
+	// the sequence number so the message is read in place
 	int			fragmentSequence;
 	int			fragmentLength;	
-	byte		fragmentBuffer[MAX_MSGLEN];
+	byte		fragmentBuffer[4 + MAX_MSGLEN];
 
 	// outgoing fragment buffer
 	// we need to space out the sending of large fragmented messages
@@ -229,6 +269,11 @@ typedef struct {
 
 void Netchan_Init( int qport );
 void Netchan_Setup(netsrc_t sock, netchan_t *chan, netadr_t adr, int qport, int challenge, qboolean compat);
+int Netchan_FragmentSize( void );
+void Netchan_SetFragmentSize( netchan_t *chan, int size );
+#ifdef LEGACY_PROTOCOL
+void Netchan_XorPayload( msg_t *msg, int start, byte key, const byte *string );
+#endif
 
 void Netchan_Transmit( netchan_t *chan, int length, const byte *data );
 void Netchan_TransmitNextFragment( netchan_t *chan );
@@ -295,6 +340,8 @@ enum svc_ops_e {
 // new commands, supported only by ioquake3 protocol but not legacy
 	svc_voipSpeex,     // not wrapped in USE_VOIP, so this value is reserved.
 	svc_voipOpus,      //
+	svc_configstringsDeflated,	// [long] size [long] packed size [packed bits], only in gamestate messages
+	svc_serverCommandsDeflated,	// [long] first [long] last [long] size [long] packed size [packed bits]
 };
 
 
@@ -364,6 +411,7 @@ vm_t	*VM_Restart(vm_t *vm, qboolean unpure);
 intptr_t		QDECL VM_Call( vm_t *vm, int callNum, ... );
 
 void	VM_Debug( int level );
+qboolean	VM_IsNative( vm_t *vm );
 
 void	*VM_ArgPtr( intptr_t intValue );
 void	*VM_ExplicitArgPtr( vm_t *vm, intptr_t intValue );
@@ -506,6 +554,24 @@ void	Cvar_Register( vmCvar_t *vmCvar, const char *varName, const char *defaultVa
 void	Cvar_Update( vmCvar_t *vmCvar );
 // updates an interpreted modules' version of a cvar
 
+typedef enum {
+	CVAR_TRACK_GAME,
+	CVAR_TRACK_CGAME,
+	CVAR_TRACK_UI,
+
+	CVAR_TRACK_MAX
+} cvarTrack_t;
+
+void	Cvar_Track( cvarTrack_t module, vmCvar_t *vmCvar );
+// remembers a registered vmCvar_t so Cvar_UpdateTracked refreshes it
+
+int		Cvar_UpdateTracked( cvarTrack_t module );
+// Cvar_Update on every tracked vmCvar_t whose cvar changed since the
+// last call, returns how many of them changed
+
+void	Cvar_ClearTracked( cvarTrack_t module );
+// drops a module's tracked vmCvar_t when it is loaded or freed
+
 void 	Cvar_Set( const char *var_name, const char *value );
 // will create the variable with no flags if it doesn't exist
 
@@ -643,6 +709,7 @@ fileHandle_t	FS_FCreateOpenPipeFile( const char *filename );
 fileHandle_t FS_BaseDir_FOpenFileWrite_HomeConfig( const char *filename );
 fileHandle_t FS_BaseDir_FOpenFileWrite_HomeData( const char *filename );
 fileHandle_t FS_BaseDir_FOpenFileWrite_HomeState( const char *filename );
+fileHandle_t FS_BaseDir_FOpenFileAppend_HomeData( const char *filename );
 long		FS_BaseDir_FOpenFileRead( const char *filename, fileHandle_t *fp );
 void	FS_BaseDir_Rename_HomeData( const char *from, const char *to, qboolean safe );
 long		FS_FOpenFileRead( const char *qpath, fileHandle_t *file, qboolean uniqueFILE );
@@ -675,9 +742,52 @@ long	FS_ReadFile(const char *qpath, void **buffer);
 void	FS_ForceFlush( fileHandle_t f );
 // forces flush on files we're writing to.
 
+void	FS_SetAsync( fileHandle_t f );
+// writes are handed to the writer thread, see writer.c
+
 void	FS_FreeFile( void *buffer );
 // frees the memory returned by FS_ReadFile
 
+long	FS_MapFile( const char *qpath, void **buffer );
+// like FS_ReadFile, but loose files and uncompressed pak entries come back
+// as a copy-on-write view of the file without the trailing 0
+
+void	FS_UnmapFile( void *buffer );
+// releases the buffer returned by FS_MapFile
+
+int		FS_FileContentKey( const char *qpath, unsigned int *crc, unsigned int *length );
+// 1 with the zip directory crc and size of the file that would be read,
+// 0 if it would be read from disk, -1 if it isn't found
+
+int		FS_ReadFileAsync( const char *qpath );
+// queues a file to be read a slice per frame, returns 0 when it can't be
+// queued, which leaves FS_ReadFile
+
+qboolean FS_AsyncReadStatus( int handle, void **buffer, long *length );
+// qfalse while still reading, then a NULL buffer if the read failed
+
+void	FS_AsyncReadWait( int handle, void **buffer, long *length );
+// finishes the read now
+
+void	FS_AsyncReadFree( int handle );
+// cancels the read or frees its buffer
+
+void	FS_HoldAsyncRead( int handle, const char *qpath );
+// a finished read becomes the held file without a copy, frees the handle
+
+void	FS_AsyncFrame( void );
+// does this frame's share of the queued reads
+
+void	FS_HoldFile( const char *qpath, const void *buffer, int len );
+// keeps a zone copy of a file that was just loaded, so the next
+// FS_ReadFile of the same path skips the search and decompression
+
+void	FS_ReleaseHeldFile( void );
+// drops the held copy, if any
+
+qboolean FS_HoldingFile( const char *qpath );
+// qtrue if qpath is the held file
+
 void	FS_WriteFile( const char *qpath, const void *buffer, int size );
 // writes a complete file, creating any subdirectories needed
 
@@ -707,6 +817,7 @@ const char *FS_LoadedPakPureChecksums( void );
 // Servers with sv_pure set will get this string and pass it to clients.
 
 const char *FS_ReferencedPakNames( void );
+const char *FS_PakFilename( const char *name );
 const char *FS_ReferencedPakChecksums( void );
 const char *FS_ReferencedPakPureChecksums( void );
 // Returns a space separated string containing the checksums of all loaded 
@@ -902,7 +1013,10 @@ typedef enum {
 	TAG_BOTLIB,
 	TAG_RENDERER,
 	TAG_SMALL,
-	TAG_STATIC
+	TAG_STATIC,
+	TAG_SLAB,		// zone block holding small blocks, see common.c
+
+	TAG_COUNT
 } memtag_t;
 
 /*
@@ -952,11 +1066,54 @@ qboolean Hunk_CheckMark( void );
 void Hunk_ClearTempMemory( void );
 void *Hunk_AllocateTempMemory( int size );
 void Hunk_FreeTempMemory( void *buf );
+void *Com_FrameAlloc( int size );
+int Com_FrameMark( void );
+void Com_FrameRelease( int mark );
+void *Com_JobFrameAlloc( int size );
+void Com_ResetJobArenas( void );
+void Com_MemStatSet( const char *name, int bytes );
+void Com_MemUsage( int *zone, int *zonePeak, int *hunk, int *hunkPeak );
 int	Hunk_MemoryRemaining( void );
 void Hunk_Log( void);
 
 void Com_TouchMemory( void );
 
+// jobs.c
+typedef void (*jobFunction_t)( void *data );
+
+typedef struct jobCounter_s {
+	volatile int	count;			// jobs added against it and not finished
+	struct job_s	*waiting;		// added to run once count is zero
+} jobCounter_t;
+
+void Com_InitJobs( void );
+void Com_ShutdownJobs( void );
+void Com_AddJob( jobFunction_t function, void *data, jobCounter_t *counter );
+void Com_AddJobAfter( jobFunction_t function, void *data, jobCounter_t *counter, jobCounter_t *after );
+void Com_WaitJobs( jobCounter_t *counter );
+int Com_JobThread( void );
+int Com_NumJobThreads( void );
+
+// writer.c
+void Com_InitWriter( void );
+void Com_ShutdownWriter( void );
+qboolean Com_QueueWrite( FILE *file, const void *data, int length, qboolean sync );
+void Com_FlushWriter( void );
+
+// profile.c
+// scoped zones for the profile command, only a flag test when it isn't recording
+extern	int					com_profiling;
+extern	Q_THREAD_LOCAL int	com_profileDepth;
+
+#define	PROFILE_BEGIN( name )	do { if ( com_profiling ) Com_ProfileBegin( name ); } while ( 0 )
+#define	PROFILE_END()			do { if ( com_profileDepth ) Com_ProfileEnd(); } while ( 0 )
+
+void Com_InitProfile( void );
+void Com_ProfileBegin( const char *name );
+void Com_ProfileEnd( void );
+void Com_ProfileFrame( qboolean end );
+void Com_ProfileStartup( qboolean end );
+
 // commandLine should not include the executable name (argv[0])
 void Com_Init( char *commandLine );
 void Com_Frame( void );
@@ -982,6 +1139,8 @@ void CL_Init( void );
 void CL_Disconnect( qboolean showMainMenu );
 void CL_Shutdown(char *finalmsg, qboolean disconnect, qboolean quit);
 void CL_Frame( int msec );
+int CL_InputPacingUsec( void );
+// how long to hold back sampling input for this frame
 qboolean CL_GameCommand( void );
 void CL_KeyEvent (int key, qboolean down, unsigned time);
 
@@ -1046,6 +1205,7 @@ void SV_Init( void );
 void SV_Shutdown( char *finalmsg );
 void SV_Frame( int msec );
 void SV_PacketEvent( netadr_t from, msg_t *msg );
+qboolean SV_LoadTestPacket( netsrc_t sock, int length, const void *data, netadr_t to );
 int SV_FrameMsec(void);
 qboolean SV_GameCommand( void );
 int SV_SendQueuedPackets(void);
@@ -1094,6 +1254,8 @@ void	Sys_Print( const char *msg );
 // Sys_Milliseconds should only be used for profiling purposes,
 // any game related timing information should come from event timestamps
 int		Sys_Milliseconds (void);
+// same clock as Sys_Milliseconds, for frame pacing
+int64_t	Sys_Microseconds (void);
 
 qboolean Sys_RandomBytes( byte *string, int len );
 
@@ -1105,6 +1267,8 @@ cpuFeatures_t Sys_GetProcessorFeatures( void );
 void	Sys_SetErrorText( const char *text );
 
 void	Sys_SendPacket( int length, const void *data, netadr_t to );
+void	Sys_FlushPackets( void );
+// sends the datagrams Sys_SendPacket may have queued
 
 qboolean	Sys_StringToAdr( const char *s, netadr_t *a, netadrtype_t family );
 //Does NOT parse port numbers, only base addresses.
@@ -1114,6 +1278,16 @@ void		Sys_ShowIP(void);
 
 FILE	*Sys_FOpen( const char *ospath, const char *mode );
 qboolean Sys_Mkdir( const char *path );
+qboolean Sys_FileStat( const char *ospath, int64_t *size, int64_t *mtime );
+void	*Sys_MapFile( FILE *f, int64_t offset, int64_t length, void **mapBase, size_t *mapSize );
+void	Sys_UnmapFile( void *mapBase, size_t mapSize );
+
+// named memory other processes on the host can map, where the platform has it
+void	*Sys_ReserveMemory( size_t size );
+qboolean	Sys_PublishSharedMemory( const char *name, void *base, size_t size );
+void	*Sys_OpenSharedMemory( const char *name, void *address, size_t size );
+void	Sys_CloseSharedMemory( void *base, size_t size );
+void	Sys_RemoveSharedMemory( const char *name );
 FILE	*Sys_Mkfifo( const char *ospath );
 char	*Sys_Cwd( void );
 void	Sys_SetDefaultInstallPath(const char *path);
@@ -1136,6 +1310,24 @@ char *Sys_ConsoleInput(void);
 char **Sys_ListFiles( const char *directory, const char *extension, char *filter, int *numfiles, qboolean wantsubs );
 void	Sys_FreeFileList( char **list );
 void	Sys_Sleep(int msec);
+void	Sys_Yield( void );
+
+// threads for the job system
+void	*Sys_CreateThread( void (*function)( void *arg ), void *arg );
+void	Sys_JoinThread( void *thread );
+void	*Sys_CreateMutex( void );
+void	Sys_DestroyMutex( void *mutex );
+void	Sys_LockMutex( void *mutex );
+void	Sys_UnlockMutex( void *mutex );
+void	*Sys_CreateSemaphore( void );
+void	Sys_DestroySemaphore( void *sem );
+void	Sys_WaitSemaphore( void *sem );
+void	Sys_PostSemaphore( void *sem, int count );
+int		Sys_AtomicAdd( volatile int *value, int add );	// returns the new value
+int		Sys_ProcessorCount( void );
+
+// forks count - 1 more processes, returns 0 in the caller and 1..count-1 in them
+int		Sys_StartInstances( int count );
 
 qboolean Sys_LowPhysicalMemory( void );
 
@@ -1211,6 +1403,9 @@ void	Huff_offsetTransmit (huff_t *huff, int ch, byte *fout, int *offset, int max
 void	Huff_putBit( int bit, byte *fout, int *offset);
 int		Huff_getBit( byte *fout, int *offset);
 
+// deflate.c
+int		Com_Deflate( const void *dict, int dictLength, const void *in, int inLength, byte *out, int outSize );
+
 // don't use if you don't know what you're doing.
 int		Huff_getBloc(void);
 void	Huff_setBloc(int _bloc);
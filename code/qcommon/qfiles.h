@@ -521,8 +521,16 @@ typedef struct {
 #define COD1_LUMP_TRIANGLESOUPS    6   /* DiskTriangleSoup */
 #define COD1_LUMP_VERTICES         7   /* DiskGfxVertexV59 (44 bytes) */
 #define COD1_LUMP_TRIANGLES        8   /* u16 draw indices */
-/* 9=CullGroups 10=CullGroupIndices 11=PortalVerts 12=Occluders 13=OccluderPlanes */
-/* 14=OccluderEdges 15=OccluderIndices 16=AabbTrees 17=Cells 18=Portals */
+#define COD1_LUMP_CULLGROUPS       9   /* cod1_cullgroup_t (32 bytes) */
+#define COD1_LUMP_CULLGROUPINDICES 10  /* s32 TriangleSoup indices (4 bytes each) */
+#define COD1_LUMP_PORTALVERTS      11  /* vec3 (12 bytes) */
+#define COD1_LUMP_OCCLUDERS        12  /* cod1_occluder_t (16 bytes) */
+#define COD1_LUMP_OCCLUDERPLANES   13  /* s32 plane indices (4 bytes each) */
+#define COD1_LUMP_OCCLUDEREDGES    14  /* cod1_occluderedge_t (4 bytes) */
+#define COD1_LUMP_OCCLUDERINDICES  15  /* u16 occluder indices (2 bytes each) */
+#define COD1_LUMP_AABBTREES        16  /* cod1_aabbtree_t (12 bytes) */
+#define COD1_LUMP_CELLS            17  /* cod1_cell_t */
+#define COD1_LUMP_PORTALS          18  /* cod1_portal_t (16 bytes) */
 /* 19 = unknown extra slot (retail CoD1 only) */
 #define COD1_LUMP_BSPNODES         20  /* dnode_t (36 bytes) */
 #define COD1_LUMP_BSPLEAFS         21  /* cod1_dleaf_t (36 bytes) */
@@ -553,7 +561,7 @@ typedef struct {
 /* CoD1 TriangleSoup - 16 bytes */
 typedef struct {
     unsigned short  materialIdx;
-    unsigned short  drawOrder;
+    unsigned short  lightmapIdx;   /* lightmap page, out of range when unlit */
     unsigned int    vertsOffset;   /* first vertex index in the global vertex array */
     unsigned short  vertsLength;   /* number of vertices */
     unsigned short  trisLength;    /* number of triangle indices */
@@ -605,6 +613,69 @@ typedef struct {
     unsigned int   firstTriIndex;   /* index into lump 26 */
 } cod1_collision_leaf_t;
 
+/* CoD1 (V59) cull group - 32 bytes.
+   Bounds of surfaceCount TriangleSoups listed at firstSurface in lump 10. */
+typedef struct {
+    float mins[3];
+    float maxs[3];
+    int   firstSurface;
+    int   surfaceCount;
+} cod1_cullgroup_t;
+
+/* CoD1 (V59) AABB tree node - 12 bytes.
+   Nodes are stored depth first: the childCount children of a node follow
+   it directly, each followed by its own subtree.  itemCount cull groups
+   start at firstItem in lump 9.  Bounds are not stored on disk. */
+typedef struct {
+    int firstItem;
+    int itemCount;
+    int childCount;
+} cod1_aabbtree_t;
+
+/* CoD1 (V59) occluder - 16 bytes.
+   A convex volume bounded by planeCount outward facing planes (lump 13
+   entries starting at firstPlane).  Each of the edgeCount edges at
+   firstEdge in lump 14 is the line where two of those planes meet.
+   Cells list their occluders through lump 15. */
+typedef struct {
+    int firstPlane;
+    int planeCount;
+    int firstEdge;
+    int edgeCount;
+} cod1_occluder_t;
+
+/* CoD1 (V59) occluder edge - 4 bytes, plane numbers relative to
+   cod1_occluder_t::firstPlane */
+typedef struct {
+    unsigned short planeA;
+    unsigned short planeB;
+} cod1_occluderedge_t;
+
+/* CoD1 (V59) portal cell - referenced by cod1_dleaf_t::cellNum.
+   The cull group, occluder and AABB tree ranges index the lumps of the
+   same name. */
+typedef struct {
+    float mins[3];
+    float maxs[3];
+    int   aabbTreeIndex;
+    int   firstPortal;      /* index into lump 18 */
+    int   portalCount;
+    int   firstCullGroup;
+    int   cullGroupCount;
+    int   firstOccluder;
+    int   occluderCount;
+} cod1_cell_t;
+
+/* CoD1 (V59) portal - 16 bytes.
+   A convex polygon of portalVertexCount points starting at
+   firstPortalVertex in lump 11, leading into cellIndex. */
+typedef struct {
+    int planeIndex;
+    int cellIndex;
+    int firstPortalVertex;
+    int portalVertexCount;
+} cod1_portal_t;
+
 typedef struct {
 	float		mins[3], maxs[3];
     int         firstTriangle, numTriangles;
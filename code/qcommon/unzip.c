@@ -1587,6 +1587,126 @@ extern uLong ZEXPORT unzGetOffset (file)
     return s->pos_in_central_dir;
 }
 
+/*
+  Returns the position of the data of the opened current file in the
+  zipfile if it is stored uncompressed and unencrypted, otherwise 0
+*/
+extern uLong ZEXPORT unzGetCurrentFileStoredOffset (file)
+    unzFile file;
+{
+    unz_s* s;
+    file_in_zip_read_info_s* pfile_in_zip_read_info;
+
+    if (file==NULL)
+        return 0;
+    s=(unz_s*)file;
+    pfile_in_zip_read_info=s->pfile_in_zip_read;
+    if (pfile_in_zip_read_info==NULL)
+        return 0;
+    if ((pfile_in_zip_read_info->compression_method!=0) || s->encrypted ||
+        (s->cur_file_info.flag & 1) ||
+        (s->cur_file_info.compressed_size!=s->cur_file_info.uncompressed_size))
+        return 0;
+    return pfile_in_zip_read_info->pos_in_zipfile +
+           pfile_in_zip_read_info->byte_before_the_zipfile;
+}
+
+/*
+  The compressed size of the current file if nothing of it was read yet
+  and unzInflateCurrentFile can decompress it in one go, 0 otherwise
+*/
+extern uLong ZEXPORT unzGetCurrentFileInflateSize (file)
+    unzFile file;
+{
+    unz_s* s;
+    file_in_zip_read_info_s* pfile_in_zip_read_info;
+
+    if (file==NULL)
+        return 0;
+    s=(unz_s*)file;
+    pfile_in_zip_read_info=s->pfile_in_zip_read;
+    if (pfile_in_zip_read_info==NULL)
+        return 0;
+    if ((pfile_in_zip_read_info->compression_method!=Z_DEFLATED) ||
+        (pfile_in_zip_read_info->raw) || s->encrypted ||
+        (!pfile_in_zip_read_info->stream_initialised) ||
+        (pfile_in_zip_read_info->stream.total_out!=0) ||
+        (pfile_in_zip_read_info->stream.avail_in!=0) ||
+        (pfile_in_zip_read_info->rest_read_uncompressed==0))
+        return 0;
+    return pfile_in_zip_read_info->rest_read_compressed;
+}
+
+/*
+  Decompress the whole current file into buf with a single read of the
+  compressed data into scratch and a single inflate call, instead of
+  going through read_buffer a block at a time.  len must be the
+  uncompressed size and scratch must hold unzGetCurrentFileInflateSize
+  bytes.  Returns the number of bytes decompressed, or an error code
+  with nothing read when the file doesn't qualify
+*/
+extern int ZEXPORT unzInflateCurrentFile (file, buf, len, scratch, scratchLen)
+    unzFile file;
+    voidp buf;
+    unsigned len;
+    voidp scratch;
+    unsigned scratchLen;
+{
+    unz_s* s;
+    file_in_zip_read_info_s* pfile_in_zip_read_info;
+    uLong uReadThis;
+    int err;
+
+    uReadThis = unzGetCurrentFileInflateSize(file);
+    if ((uReadThis==0) || (uReadThis>scratchLen))
+        return UNZ_PARAMERROR;
+    s=(unz_s*)file;
+    pfile_in_zip_read_info=s->pfile_in_zip_read;
+    if (len!=pfile_in_zip_read_info->rest_read_uncompressed)
+        return UNZ_PARAMERROR;
+
+    if (ZSEEK(pfile_in_zip_read_info->z_filefunc,
+              pfile_in_zip_read_info->filestream,
+              pfile_in_zip_read_info->pos_in_zipfile +
+                 pfile_in_zip_read_info->byte_before_the_zipfile,
+                 ZLIB_FILEFUNC_SEEK_SET)!=0)
+        return UNZ_ERRNO;
+    if (ZREAD(pfile_in_zip_read_info->z_filefunc,
+              pfile_in_zip_read_info->filestream,
+              scratch,uReadThis)!=uReadThis)
+        return UNZ_ERRNO;
+
+    pfile_in_zip_read_info->pos_in_zipfile += uReadThis;
+    pfile_in_zip_read_info->rest_read_compressed = 0;
+
+    pfile_in_zip_read_info->stream.next_in = (Bytef*)scratch;
+    pfile_in_zip_read_info->stream.avail_in = (uInt)uReadThis;
+    pfile_in_zip_read_info->stream.next_out = (Bytef*)buf;
+    pfile_in_zip_read_info->stream.avail_out = (uInt)len;
+
+    /* with all of the input and room for all of the output, zlib
+       finishes in one call and skips keeping its sliding window */
+    err=inflate(&pfile_in_zip_read_info->stream,Z_FINISH);
+
+    pfile_in_zip_read_info->crc32 = crc32(pfile_in_zip_read_info->crc32,
+                                          (const Bytef*)buf,
+                                          (uInt)pfile_in_zip_read_info->stream.total_out);
+    pfile_in_zip_read_info->rest_read_uncompressed -=
+        pfile_in_zip_read_info->stream.total_out;
+
+    /* read_buffer isn't behind next_in, so leave nothing for
+       unzReadCurrentFile to pick up */
+    pfile_in_zip_read_info->stream.avail_in = 0;
+
+    if ((err==Z_STREAM_END) || (err==Z_OK) || (err==Z_BUF_ERROR))
+    {
+        if (pfile_in_zip_read_info->rest_read_uncompressed==0)
+            return (int)pfile_in_zip_read_info->stream.total_out;
+        return Z_DATA_ERROR;
+    }
+    return err;
+}
+
 extern int ZEXPORT unzSetOffset (file, pos)
         unzFile file;
         uLong pos;
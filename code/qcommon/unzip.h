@@ -346,6 +346,20 @@ extern uLong ZEXPORT unzGetOffset (unzFile file);
 /* Set the current file offset */
 extern int ZEXPORT unzSetOffset (unzFile file, uLong pos);
 
+/* Get where the opened current file's data starts in the zipfile, or 0
+   when it is compressed or encrypted and can't be read from there as is */
+extern uLong ZEXPORT unzGetCurrentFileStoredOffset (unzFile file);
+
+/* Get the compressed size of the opened current file when nothing was
+   read from it yet and unzInflateCurrentFile can handle it, 0 otherwise */
+extern uLong ZEXPORT unzGetCurrentFileInflateSize (unzFile file);
+
+/* Decompress all of the opened current file into buf in one call, with
+   scratch holding the compressed data; len must be the uncompressed size
+   and scratchLen at least unzGetCurrentFileInflateSize */
+extern int ZEXPORT unzInflateCurrentFile (unzFile file, voidp buf, unsigned len,
+                                          voidp scratch, unsigned scratchLen);
+
 
 
 #ifdef __cplusplus
@@ -40,6 +40,8 @@ vm_t	*currentVM = NULL;
 vm_t	*lastVM    = NULL;
 int		vm_debugLevel;
 
+static cvar_t	*vm_profile;
+
 // used by Com_Error to get rid of running vm's before longjmp
 static int forced_unload;
 
@@ -50,6 +52,11 @@ vm_t	vmTable[MAX_VM];
 void VM_VmInfo_f( void );
 void VM_VmProfile_f( void );
 
+#ifndef NO_QVM
+static void VM_ProfileInit( vm_t *vm, vmHeader_t *header );
+#endif
+static void VM_ProfileUnwind( vm_t *vm );
+
 
 
 #if 0 // 64bit!
@@ -73,6 +80,7 @@ void VM_Init( void ) {
 	Cvar_Get( "vm_cgame", "2", CVAR_ARCHIVE );	// !@# SHIP WITH SET TO 2
 	Cvar_Get( "vm_game", "2", CVAR_ARCHIVE );	// !@# SHIP WITH SET TO 2
 	Cvar_Get( "vm_ui", "2", CVAR_ARCHIVE );		// !@# SHIP WITH SET TO 2
+	vm_profile = Cvar_Get( "vm_profile", "0", 0 );
 
 	Cmd_AddCommand ("vmprofile", VM_VmProfile_f );
 	Cmd_AddCommand ("vminfo", VM_VmInfo_f );
@@ -230,9 +238,10 @@ void VM_LoadSymbols( vm_t *vm ) {
 	int		chars;
 	int		segment;
 	int		numInstructions;
+	int		func;
 
-	// don't load symbols if not developer
-	if ( !com_developer->integer ) {
+	// don't load symbols if not developer or profiling
+	if ( !com_developer->integer && !vm->profile ) {
 		return;
 	}
 
@@ -281,6 +290,13 @@ void VM_LoadSymbols( vm_t *vm ) {
 		prev = &sym->next;
 		sym->next = NULL;
 
+		if ( vm->profile ) {
+			func = VM_ProfileFunction( vm, value );
+			if ( func >= 0 ) {
+				vm->profile->funcs[func].name = sym->symName;
+			}
+		}
+
 		// convert value from an instruction number to a code offset
 		if ( value >= 0 && value < numInstructions ) {
 			value = vm->instructionPointers[value];
@@ -672,6 +688,11 @@ vm_t *VM_Create( const char *module, intptr_t (*systemCalls)(intptr_t *),
 
 	vm->compiled = qfalse;
 
+	// the compiler needs the function table to emit the profiling calls
+	if ( vm_profile->integer ) {
+		VM_ProfileInit( vm, header );
+	}
+
 #ifndef HAVE_VM_COMPILED
 	if(interpret >= VMI_COMPILED) {
 		Com_Printf("Architecture doesn't have a bytecode compiler, using interpreter\n");
@@ -765,6 +786,18 @@ void VM_Forced_Unload_Done(void) {
 	forced_unload = 0;
 }
 
+/*
+==============
+VM_IsNative
+
+True for a module loaded from a shared library, whose pointers can be
+handed out directly
+==============
+*/
+qboolean VM_IsNative( vm_t *vm ) {
+	return vm && vm->dllHandle;
+}
+
 void *VM_ArgPtr( intptr_t intValue ) {
 	if ( !intValue ) {
 		return NULL;
@@ -841,6 +874,10 @@ intptr_t QDECL VM_Call( vm_t *vm, int callnum, ... )
 	  Com_Printf( "VM_Call( %d )\n", callnum );
 	}
 
+	PROFILE_BEGIN( "VM_Call" );
+	if ( vm->profile && !vm->callLevel ) {
+		VM_ProfileUnwind( vm );
+	}
 	++vm->callLevel;
 	// if we have a dll loaded, call it directly
 	if ( vm->entryPoint ) {
@@ -891,6 +928,7 @@ intptr_t QDECL VM_Call( vm_t *vm, int callnum, ... )
 #endif // NO_QVM
 	}
 	--vm->callLevel;
+	PROFILE_END();
 
 	if ( oldVM != NULL )
 	  currentVM = oldVM;
@@ -899,6 +937,367 @@ intptr_t QDECL VM_Call( vm_t *vm, int callnum, ... )
 
 //=================================================================
 
+#ifndef NO_QVM
+/*
+==============
+VM_OperandSize
+
+Bytes following the opcode in the qvm file
+==============
+*/
+static int VM_OperandSize( int op ) {
+	switch ( op ) {
+	case OP_ENTER:
+	case OP_CONST:
+	case OP_LOCAL:
+	case OP_LEAVE:
+	case OP_EQ:
+	case OP_NE:
+	case OP_LTI:
+	case OP_LEI:
+	case OP_GTI:
+	case OP_GEI:
+	case OP_LTU:
+	case OP_LEU:
+	case OP_GTU:
+	case OP_GEU:
+	case OP_EQF:
+	case OP_NEF:
+	case OP_LTF:
+	case OP_LEF:
+	case OP_GTF:
+	case OP_GEF:
+	case OP_BLOCK_COPY:
+		return 4;
+	case OP_ARG:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/*
+==============
+VM_ProfileInit
+
+Every function starts with an OP_ENTER, so those give the function
+table without needing the map file
+==============
+*/
+static void VM_ProfileInit( vm_t *vm, vmHeader_t *header ) {
+	vmProfile_t	*prof;
+	byte		*code;
+	int			pass, pc, instruction, op, count;
+
+	prof = Hunk_Alloc( sizeof( *prof ), h_high );
+	code = (byte *)header + header->codeOffset;
+
+	// count the functions, then record them
+	for ( pass = 0 ; pass < 2 ; pass++ ) {
+		count = 0;
+		pc = 0;
+		for ( instruction = 0 ; instruction < header->instructionCount && pc < header->codeLength ; instruction++ ) {
+			op = code[pc];
+			if ( op == OP_ENTER ) {
+				if ( pass ) {
+					prof->funcs[count].instruction = instruction;
+				}
+				count++;
+			}
+			pc += 1 + VM_OperandSize( op );
+		}
+		if ( !pass ) {
+			prof->funcs = Hunk_Alloc( ( count + 1 ) * sizeof( *prof->funcs ), h_high );
+		}
+	}
+	prof->numFuncs = count;
+
+	prof->nodes = Hunk_Alloc( MAX_VM_PROFILE_NODES * sizeof( *prof->nodes ), h_high );
+	prof->nodes[0].func = -1;
+	prof->numNodes = 1;
+
+	vm->profile = prof;
+	Com_Printf( "Profiling %i functions in %s\n", count, vm->name );
+}
+#endif
+
+/*
+==============
+VM_ProfileFunction
+
+Function table slot of the OP_ENTER at instruction, or -1
+==============
+*/
+int VM_ProfileFunction( vm_t *vm, int instruction ) {
+	vmProfile_t	*prof = vm->profile;
+	int			low, high, mid;
+
+	low = 0;
+	high = prof->numFuncs - 1;
+	while ( low <= high ) {
+		mid = ( low + high ) >> 1;
+		if ( prof->funcs[mid].instruction == instruction ) {
+			return mid;
+		}
+		if ( prof->funcs[mid].instruction < instruction ) {
+			low = mid + 1;
+		} else {
+			high = mid - 1;
+		}
+	}
+	return -1;
+}
+
+/*
+==============
+VM_ProfileFunctionAtOffset
+
+Same for the interpreter, which only knows its codeBase offset
+==============
+*/
+int VM_ProfileFunctionAtOffset( vm_t *vm, int codeOffset ) {
+	vmProfile_t	*prof = vm->profile;
+	int			low, high, mid, ofs;
+
+	low = 0;
+	high = prof->numFuncs - 1;
+	while ( low <= high ) {
+		mid = ( low + high ) >> 1;
+		ofs = vm->instructionPointers[ prof->funcs[mid].instruction ];
+		if ( ofs == codeOffset ) {
+			return mid;
+		}
+		if ( ofs < codeOffset ) {
+			low = mid + 1;
+		} else {
+			high = mid - 1;
+		}
+	}
+	return -1;
+}
+
+/*
+==============
+VM_ProfileEnter
+
+Called on every OP_ENTER while profiling
+==============
+*/
+void VM_ProfileEnter( vm_t *vm, int func ) {
+	vmProfile_t			*prof = vm->profile;
+	vmProfileNode_t		*node;
+	vmProfileFrame_t	*frame;
+	int					parent, n;
+
+	if ( func < 0 || prof->depth == MAX_VM_PROFILE_DEPTH ) {
+		prof->lostFrames++;
+		return;
+	}
+
+	// find or add the call path
+	parent = prof->depth ? prof->frames[prof->depth - 1].node : 0;
+	for ( n = prof->nodes[parent].child ; n ; n = prof->nodes[n].sibling ) {
+		if ( prof->nodes[n].func == func ) {
+			break;
+		}
+	}
+	if ( !n ) {
+		if ( prof->numNodes < MAX_VM_PROFILE_NODES ) {
+			n = prof->numNodes++;
+			node = &prof->nodes[n];
+			node->func = func;
+			node->parent = parent;
+			node->child = 0;
+			node->sibling = prof->nodes[parent].child;
+			node->exclusive = 0;
+			prof->nodes[parent].child = n;
+		} else {
+			n = parent;		// out of paths, charge the caller's
+		}
+	}
+
+	prof->funcs[func].calls++;
+	prof->funcs[func].active++;
+
+	frame = &prof->frames[prof->depth++];
+	frame->func = func;
+	frame->node = n;
+	frame->childTime = 0;
+	frame->start = Sys_Microseconds();
+}
+
+/*
+==============
+VM_ProfileLeave
+
+Called on every OP_LEAVE while profiling
+==============
+*/
+void VM_ProfileLeave( vm_t *vm ) {
+	vmProfile_t			*prof = vm->profile;
+	vmProfileFrame_t	*frame;
+	vmProfileFunc_t		*f;
+	int64_t				elapsed, self;
+
+	if ( prof->lostFrames ) {
+		prof->lostFrames--;
+		return;
+	}
+	if ( !prof->depth ) {
+		return;		// entered before a reset
+	}
+
+	frame = &prof->frames[--prof->depth];
+	elapsed = Sys_Microseconds() - frame->start;
+	self = elapsed - frame->childTime;
+
+	f = &prof->funcs[frame->func];
+	f->exclusive += self;
+	if ( !--f->active ) {
+		f->inclusive += elapsed;
+	}
+	prof->nodes[frame->node].exclusive += self;
+
+	if ( prof->depth ) {
+		prof->frames[prof->depth - 1].childTime += elapsed;
+	}
+}
+
+/*
+==============
+VM_ProfileUnwind
+
+Drops the frames a Com_Error left open inside the vm
+==============
+*/
+static void VM_ProfileUnwind( vm_t *vm ) {
+	vmProfile_t	*prof = vm->profile;
+
+	while ( prof->depth ) {
+		prof->funcs[ prof->frames[--prof->depth].func ].active--;
+	}
+	prof->lostFrames = 0;
+}
+
+static void VM_ProfileReset( vm_t *vm ) {
+	vmProfile_t	*prof = vm->profile;
+	int			i;
+
+	for ( i = 0 ; i < prof->numFuncs ; i++ ) {
+		prof->funcs[i].calls = 0;
+		prof->funcs[i].inclusive = 0;
+		prof->funcs[i].exclusive = 0;
+	}
+	prof->nodes[0].child = 0;
+	prof->numNodes = 1;
+}
+
+static const char *VM_ProfileFuncName( const vmProfileFunc_t *f ) {
+	if ( f->name ) {
+		return f->name;
+	}
+	return va( "func_%i", f->instruction );
+}
+
+static int QDECL VM_ProfileFuncSort( const void *a, const void *b ) {
+	const vmProfileFunc_t	*fa, *fb;
+
+	fa = *(const vmProfileFunc_t **)a;
+	fb = *(const vmProfileFunc_t **)b;
+
+	if ( fa->exclusive > fb->exclusive ) {
+		return -1;
+	}
+	if ( fa->exclusive < fb->exclusive ) {
+		return 1;
+	}
+	return 0;
+}
+
+/*
+==============
+VM_ProfileReport
+
+Called functions by exclusive time
+==============
+*/
+static void VM_ProfileReport( vm_t *vm ) {
+	vmProfile_t		*prof = vm->profile;
+	vmProfileFunc_t	**sorted, *f;
+	int				i, count;
+	int64_t			total;
+
+	sorted = Z_Malloc( ( prof->numFuncs + 1 ) * sizeof( *sorted ) );
+	count = 0;
+	total = 0;
+	for ( i = 0 ; i < prof->numFuncs ; i++ ) {
+		if ( prof->funcs[i].calls ) {
+			sorted[count++] = &prof->funcs[i];
+			total += prof->funcs[i].exclusive;
+		}
+	}
+
+	qsort( sorted, count, sizeof( *sorted ), VM_ProfileFuncSort );
+
+	Com_Printf( "  excl%%    excl ms    incl ms     calls  function\n" );
+	for ( i = 0 ; i < count ; i++ ) {
+		f = sorted[i];
+		Com_Printf( "%6.2f%% %10.3f %10.3f %9i  %s\n",
+			total ? 100.0 * f->exclusive / total : 0.0,
+			f->exclusive / 1000.0, f->inclusive / 1000.0, f->calls, VM_ProfileFuncName( f ) );
+	}
+	Com_Printf( "%i of %i functions called, %.3f ms in %s\n", count, prof->numFuncs, total / 1000.0, vm->name );
+
+	Z_Free( sorted );
+}
+
+/*
+==============
+VM_ProfileWriteFolded
+
+One "caller;callee exclusive_usec" line per call path, the input
+format of flamegraph.pl and speedscope
+==============
+*/
+static void VM_ProfileWriteFolded( vm_t *vm, const char *filename ) {
+	vmProfile_t		*prof = vm->profile;
+	fileHandle_t	f;
+	int				path[MAX_VM_PROFILE_DEPTH];
+	int				i, n, depth, lines;
+	const char		*name;
+
+	f = FS_FOpenFileWrite_HomeData( filename );
+	if ( !f ) {
+		Com_Printf( "Couldn't open %s\n", filename );
+		return;
+	}
+
+	lines = 0;
+	for ( i = 1 ; i < prof->numNodes ; i++ ) {
+		if ( prof->nodes[i].exclusive <= 0 ) {
+			continue;
+		}
+
+		depth = 0;
+		for ( n = i ; n && depth < MAX_VM_PROFILE_DEPTH ; n = prof->nodes[n].parent ) {
+			path[depth++] = prof->nodes[n].func;
+		}
+
+		while ( depth-- ) {
+			name = VM_ProfileFuncName( &prof->funcs[ path[depth] ] );
+			FS_Write( name, strlen( name ), f );
+			if ( depth ) {
+				FS_Write( ";", 1, f );
+			}
+		}
+		FS_Printf( f, " %lld\n", (long long)prof->nodes[i].exclusive );
+		lines++;
+	}
+
+	FS_FCloseFile( f );
+	Com_Printf( "Wrote %i call paths to %s\n", lines, filename );
+}
+
 static int QDECL VM_ProfileSort( const void *a, const void *b ) {
 	vmSymbol_t	*sa, *sb;
 
@@ -918,19 +1317,47 @@ static int QDECL VM_ProfileSort( const void *a, const void *b ) {
 ==============
 VM_VmProfile_f
 
+vmprofile [<vm>] [reset | folded <file>]
 ==============
 */
 void VM_VmProfile_f( void ) {
 	vm_t		*vm;
 	vmSymbol_t	**sorted, *sym;
-	int			i;
+	int			i, arg;
 	double		total;
 
-	if ( !lastVM ) {
+	vm = lastVM;
+	arg = 1;
+	for ( i = 0 ; i < MAX_VM && Cmd_Argc() > 1 ; i++ ) {
+		if ( vmTable[i].name[0] && !Q_stricmp( vmTable[i].name, Cmd_Argv( 1 ) ) ) {
+			vm = &vmTable[i];
+			arg = 2;
+			break;
+		}
+	}
+
+	if ( !vm ) {
 		return;
 	}
 
-	vm = lastVM;
+	if ( vm->profile ) {
+		if ( !Q_stricmp( Cmd_Argv( arg ), "reset" ) ) {
+			if ( vm->callLevel ) {
+				Com_Printf( "%s is running\n", vm->name );
+				return;
+			}
+			VM_ProfileReset( vm );
+		} else if ( !Q_stricmp( Cmd_Argv( arg ), "folded" ) ) {
+			if ( !Cmd_Argv( arg + 1 )[0] ) {
+				Com_Printf( "usage: vmprofile [<vm>] folded <file>\n" );
+				return;
+			}
+			VM_ProfileWriteFolded( vm, Cmd_Argv( arg + 1 ) );
+		} else {
+			VM_ProfileReport( vm );
+		}
+		return;
+	}
 
 	if ( !vm->numSymbols ) {
 		return;
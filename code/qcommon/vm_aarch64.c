@@ -0,0 +1,882 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+
+AArch64 VM, laid out like vm_armv7l.c
+
+The opstack, program stack and data image stay in callee saved registers
+for the whole run, so calls into C (system calls, block copies, jump
+errors) need no spilling. Every load and store into the data image is
+masked with dataMask exactly like the other backends.
+
+Docu:
+Arm Architecture Reference Manual for A-profile architecture (DDI0487)
+*/
+
+#ifdef __aarch64__
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <stddef.h>
+
+#include "vm_local.h"
+
+#define R0	0
+#define R1	1
+#define R2	2
+#define R16	16	// IP0, scratch for far calls
+
+#define FP	29
+#define LR	30
+#define SP	31
+#define ZR	31
+
+#define S0	0
+#define S1	1
+
+#define rOPSTACK	19
+#define rCODEBASE	21
+#define rPSTACK		22
+#define rDATABASE	23
+#define rDATAMASK	24
+#define rINSPOINTERS	25
+#define rPSTACKPTR	26
+
+/* exit() won't be called but use it because it is marked with noreturn */
+#define DIE( reason, args... ) \
+	do { \
+		Com_Error(ERR_DROP, "vm_aarch64 compiler error: " reason, ##args); \
+		exit(1); \
+	} while(0)
+
+/*
+ * opcode information table:
+ * - length of immediate value
+ */
+#define opImm0	0x0000 /* no immediate */
+#define opImm1	0x0001 /* 1 byte immadiate value after opcode */
+#define opImm4	0x0002 /* 4 bytes immediate value after opcode */
+
+static const unsigned char vm_opInfo[256] =
+{
+	[OP_ENTER]	= opImm4,
+	[OP_LEAVE]	= opImm4,
+	[OP_CONST]	= opImm4,
+	[OP_LOCAL]	= opImm4,
+
+	[OP_EQ]		= opImm4,
+	[OP_NE]		= opImm4,
+	[OP_LTI]	= opImm4,
+	[OP_LEI]	= opImm4,
+	[OP_GTI]	= opImm4,
+	[OP_GEI]	= opImm4,
+	[OP_LTU]	= opImm4,
+	[OP_LEU]	= opImm4,
+	[OP_GTU]	= opImm4,
+	[OP_GEU]	= opImm4,
+	[OP_EQF]	= opImm4,
+	[OP_NEF]	= opImm4,
+	[OP_LTF]	= opImm4,
+	[OP_LEF]	= opImm4,
+	[OP_GTF]	= opImm4,
+	[OP_GEF]	= opImm4,
+
+	[OP_ARG]	= opImm1,
+	[OP_BLOCK_COPY]	= opImm4,
+};
+
+static void VM_Destroy_Compiled(vm_t *vm)
+{
+	if (vm->codeBase) {
+		if (munmap(vm->codeBase, vm->codeLength))
+			Com_Printf(S_COLOR_RED "Memory unmap failed, possible memory leak\n");
+	}
+	vm->codeBase = NULL;
+}
+
+/*
+=================
+ErrJump
+Error handler for jump/call to invalid instruction number
+=================
+*/
+
+static void Q_NO_RETURN ErrJump(unsigned num)
+{
+	Com_Error(ERR_DROP, "program tried to execute code outside VM (%x)", num);
+}
+
+static int asmcall(int call, int pstack)
+{
+	// save currentVM so as to allow for recursive VM entry
+	vm_t *savedVM = currentVM;
+	intptr_t args[MAX_VMSYSCALL_ARGS];
+	int *argPosition;
+	int i, ret;
+
+	// modify VM stack pointer for recursive VM entry
+	currentVM->programStack = pstack - 4;
+
+	args[0] = -1 - call;
+	argPosition = (int *)((byte *)currentVM->dataBase + pstack + 4);
+	for( i = 1; i < ARRAY_LEN(args); i++ )
+		args[i] = argPosition[i];
+
+	ret = currentVM->systemCall(args);
+
+	currentVM = savedVM;
+
+	return ret;
+}
+
+static void _emit(vm_t *vm, unsigned isn, int pass)
+{
+	if (pass)
+		memcpy(vm->codeBase+vm->codeLength, &isn, 4);
+	vm->codeLength+=4;
+}
+
+// overwrite an instruction emitted earlier, used for short forward branches
+static void _patch(vm_t *vm, int offset, unsigned isn, int pass)
+{
+	if (pass)
+		memcpy(vm->codeBase+offset, &isn, 4);
+}
+
+#define emit(isn) _emit(vm, isn, pass)
+#define patch(offset, isn) _patch(vm, offset, isn, pass)
+
+static unsigned uimm12(unsigned val, unsigned scale)
+{
+	if (val & ((1<<scale)-1))
+		DIE("offset %u not aligned", val);
+	val >>= scale;
+	if (val > 4095)
+		DIE("offset %u too large", val);
+	return val<<10;
+}
+
+static unsigned simm9(int val)
+{
+	if (val < -256 || val > 255)
+		DIE("offset %d too large", val);
+	return (val & 0x1FF)<<12;
+}
+
+// conditions, inverted by flipping the lowest bit
+#define EQ 0b0000
+#define NE 0b0001
+#define HS 0b0010
+#define LO 0b0011
+#define MI 0b0100
+#define PL 0b0101
+#define HI 0b1000
+#define LS 0b1001
+#define GE 0b1010
+#define LT 0b1011
+#define GT 0b1100
+#define LE 0b1101
+#define INVERT(c) ((c)^1)
+
+#define BRK(v) (0xD4200000 | (((v)&0xFFFF)<<5))
+#define NOP    0xD503201F
+
+// 32 bit integer arithmetic, immediates must fit in 12 bits
+#define ADDi(dst, src, i)   (0x11000000 | uimm12(i, 0) | ((src)<<5) | (dst))
+#define SUBi(dst, src, i)   (0x51000000 | uimm12(i, 0) | ((src)<<5) | (dst))
+#define CMPi(     src, i)   (0x71000000 | uimm12(i, 0) | ((src)<<5) | ZR)
+
+#define ADD(dst, src, reg)  (0x0B000000 | ((reg)<<16) | ((src)<<5) | (dst))
+#define SUB(dst, src, reg)  (0x4B000000 | ((reg)<<16) | ((src)<<5) | (dst))
+#define CMP(     src, reg)  (0x6B000000 | ((reg)<<16) | ((src)<<5) | ZR)
+#define AND(dst, src, reg)  (0x0A000000 | ((reg)<<16) | ((src)<<5) | (dst))
+#define ORR(dst, src, reg)  (0x2A000000 | ((reg)<<16) | ((src)<<5) | (dst))
+#define EOR(dst, src, reg)  (0x4A000000 | ((reg)<<16) | ((src)<<5) | (dst))
+#define MOV(dst,      reg)  ORR(dst, ZR, reg)
+#define MVN(dst,      reg)  (0x2A200000 | ((reg)<<16) | (ZR<<5) | (dst))
+#define NEG(dst,      reg)  SUB(dst, ZR, reg)
+
+#define LSL(dst, src, reg)  (0x1AC02000 | ((reg)<<16) | ((src)<<5) | (dst))
+#define LSR(dst, src, reg)  (0x1AC02400 | ((reg)<<16) | ((src)<<5) | (dst))
+#define ASR(dst, src, reg)  (0x1AC02800 | ((reg)<<16) | ((src)<<5) | (dst))
+
+#define MUL(dst, src, reg)  (0x1B007C00 | ((reg)<<16) | ((src)<<5) | (dst))
+// dst = acc - src * reg
+#define MSUB(dst, src, reg, acc) (0x1B008000 | ((reg)<<16) | ((acc)<<10) | ((src)<<5) | (dst))
+#define SDIV(dst, src, reg) (0x1AC00C00 | ((reg)<<16) | ((src)<<5) | (dst))
+#define UDIV(dst, src, reg) (0x1AC00800 | ((reg)<<16) | ((src)<<5) | (dst))
+
+#define SXTB(dst, src)      (0x13001C00 | ((src)<<5) | (dst))
+#define SXTH(dst, src)      (0x13003C00 | ((src)<<5) | (dst))
+
+#define MOVZ(dst, i, hw)    (0x52800000 | ((hw)<<21) | (((i)&0xFFFF)<<5) | (dst))
+#define MOVK(dst, i, hw)    (0x72800000 | ((hw)<<21) | (((i)&0xFFFF)<<5) | (dst))
+#define MOVN(dst, i, hw)    (0x12800000 | ((hw)<<21) | (((i)&0xFFFF)<<5) | (dst))
+
+// 64 bit variants, only used for pointers
+#define ADDXi(dst, src, i)  (0x91000000 | uimm12(i, 0) | ((src)<<5) | (dst))
+#define SUBXi(dst, src, i)  (0xD1000000 | uimm12(i, 0) | ((src)<<5) | (dst))
+#define ADDX(dst, src, reg) (0x8B000000 | ((reg)<<16) | ((src)<<5) | (dst))
+#define MOVX(dst,      reg) (0xAA000000 | ((reg)<<16) | (ZR<<5) | (dst))
+#define MOVZX(dst, i, hw)   (0xD2800000 | ((hw)<<21) | (((i)&0xFFFF)<<5) | (dst))
+#define MOVKX(dst, i, hw)   (0xF2800000 | ((hw)<<21) | (((i)&0xFFFF)<<5) | (dst))
+
+// loads and stores with unsigned scaled offset
+#define LDRWi(dst, base, off) (0xB9400000 | uimm12(off, 2) | ((base)<<5) | (dst))
+#define STRWi(src, base, off) (0xB9000000 | uimm12(off, 2) | ((base)<<5) | (src))
+#define LDRXi(dst, base, off) (0xF9400000 | uimm12(off, 3) | ((base)<<5) | (dst))
+
+// load/store with pre-increment (base += off; *base) and post-increment (*base; base += off)
+#define LDRWpre(dst, base, off)  (0xB8400C00 | simm9(off) | ((base)<<5) | (dst))
+#define LDRWpost(dst, base, off) (0xB8400400 | simm9(off) | ((base)<<5) | (dst))
+#define STRWpre(src, base, off)  (0xB8000C00 | simm9(off) | ((base)<<5) | (src))
+#define STRXpre(src, base, off)  (0xF8000C00 | simm9(off) | ((base)<<5) | (src))
+#define LDRXpost(dst, base, off) (0xF8400400 | simm9(off) | ((base)<<5) | (dst))
+
+// loads and stores at base + (uint32_t)reg, the index is always a masked vm address
+#define LDRBr(dst, base, reg)  (0x38604800 | ((reg)<<16) | ((base)<<5) | (dst))
+#define LDRHr(dst, base, reg)  (0x78604800 | ((reg)<<16) | ((base)<<5) | (dst))
+#define LDRWr(dst, base, reg)  (0xB8604800 | ((reg)<<16) | ((base)<<5) | (dst))
+#define STRBr(src, base, reg)  (0x38204800 | ((reg)<<16) | ((base)<<5) | (src))
+#define STRHr(src, base, reg)  (0x78204800 | ((reg)<<16) | ((base)<<5) | (src))
+#define STRWr(src, base, reg)  (0xB8204800 | ((reg)<<16) | ((base)<<5) | (src))
+// dst = ((uint64_t*)base)[(uint32_t)reg]
+#define LDRXr3(dst, base, reg) (0xF8605800 | ((reg)<<16) | ((base)<<5) | (dst))
+
+// pair load/store of 64 bit registers, off is a multiple of 8
+#define STPXpre(r1, r2, base, off)  (0xA9800000 | ((((off)>>3)&0x7F)<<15) | ((r2)<<10) | ((base)<<5) | (r1))
+#define STPXi(r1, r2, base, off)    (0xA9000000 | ((((off)>>3)&0x7F)<<15) | ((r2)<<10) | ((base)<<5) | (r1))
+#define LDPXpost(r1, r2, base, off) (0xA8C00000 | ((((off)>>3)&0x7F)<<15) | ((r2)<<10) | ((base)<<5) | (r1))
+#define LDPXi(r1, r2, base, off)    (0xA9400000 | ((((off)>>3)&0x7F)<<15) | ((r2)<<10) | ((base)<<5) | (r1))
+
+// branches, offsets are relative to the branch instruction itself
+#define Bi(i)         (0x14000000 | (i))
+#define BLi(i)        (0x94000000 | (i))
+#define Bcond(c, i)   (0x54000000 | (((i)&0x7FFFF)<<5) | (c))
+#define BR(reg)       (0xD61F0000 | ((reg)<<5))
+#define BLR(reg)      (0xD63F0000 | ((reg)<<5))
+#define RET           (0xD65F0000 | (LR<<5))
+
+// single precision floating point
+#define FADD(Sd, Sn, Sm) (0x1E202800 | ((Sm)<<16) | ((Sn)<<5) | (Sd))
+#define FSUB(Sd, Sn, Sm) (0x1E203800 | ((Sm)<<16) | ((Sn)<<5) | (Sd))
+#define FMUL(Sd, Sn, Sm) (0x1E200800 | ((Sm)<<16) | ((Sn)<<5) | (Sd))
+#define FDIV(Sd, Sn, Sm) (0x1E201800 | ((Sm)<<16) | ((Sn)<<5) | (Sd))
+#define FNEG(Sd, Sn)     (0x1E214000 | ((Sn)<<5) | (Sd))
+#define FCMP(Sn, Sm)     (0x1E202000 | ((Sm)<<16) | ((Sn)<<5))
+#define SCVTF(Sd, Rn)    (0x1E220000 | ((Rn)<<5) | (Sd))
+#define FCVTZS(Rd, Sn)   (0x1E380000 | ((Sn)<<5) | (Rd))
+
+#define LDRSi(Sd, base, off)    (0xBD400000 | uimm12(off, 2) | ((base)<<5) | (Sd))
+#define STRSi(Sd, base, off)    (0xBD000000 | uimm12(off, 2) | ((base)<<5) | (Sd))
+#define LDRSpre(Sd, base, off)  (0xBC400C00 | simm9(off) | ((base)<<5) | (Sd))
+#define LDRSpost(Sd, base, off) (0xBC400400 | simm9(off) | ((base)<<5) | (Sd))
+
+// puts integer arg in 32 bit register reg
+#define emit_MOVRxi(reg, arg) do { \
+	unsigned _v = (arg); \
+	if ((_v & 0xFFFF0000) == 0xFFFF0000) \
+		emit(MOVN(reg, ~_v, 0)); \
+	else { \
+		emit(MOVZ(reg, _v, 0)); \
+		if (_v > 0xFFFF) \
+			emit(MOVK(reg, _v>>16, 1)); \
+	} \
+} while(0)
+
+// puts a host address in 64 bit register reg, always four instructions
+#define emit_MOVXi64(reg, arg) do { \
+	uint64_t _v = (uint64_t)(arg); \
+	emit(MOVZX(reg, _v, 0)); \
+	emit(MOVKX(reg, _v>>16, 1)); \
+	emit(MOVKX(reg, _v>>32, 2)); \
+	emit(MOVKX(reg, _v>>48, 3)); \
+} while(0)
+
+// dst = src +/- arg with arbitrary arg, clobbers R0 unless dst is R0
+#define emit_ADDSUBi(isni, isn, dst, src, arg) do { \
+	if ((unsigned)(arg) < 4096) \
+		emit(isni(dst, src, arg)); \
+	else { \
+		emit_MOVRxi(R0, arg); \
+		emit(isn(dst, src, R0)); \
+	} \
+} while(0)
+
+// check if instruction in R0 is within range. Clobbers R1
+#define CHECK_JUMP do { \
+	emit_MOVRxi(R1, (unsigned)vm->instructionCount); \
+	emit(CMP(R0, R1)); \
+	emit(Bcond(LO, 2)); \
+	emit(BLi(j_rel(get_offset(OFF_ERRJUMP)-vm->codeLength))); \
+} while(0)
+
+// conditional jump to a vm instruction. B.cond only reaches 1MB
+// so branch over an unconditional B instead.
+#define emit_JUMPcond(comparator, target) do { \
+	emit(Bcond(INVERT(comparator), 2)); \
+	emit(Bi(j_rel(vm->instructionPointers[target]-vm->codeLength))); \
+} while(0)
+
+#define IJ(comparator) do { \
+	emit(LDRWpost(R0, rOPSTACK, -4)); \
+	emit(LDRWpost(R1, rOPSTACK, -4)); \
+	emit(CMP(R1, R0)); \
+	emit_JUMPcond(comparator, arg.i); \
+} while (0)
+
+// unordered compares set C and V, so MI and LS are used for
+// less than and less or equal to make them false for NaN
+#define FJ(comparator) do { \
+	emit(LDRSpost(S1, rOPSTACK, -4)); \
+	emit(LDRSpost(S0, rOPSTACK, -4)); \
+	emit(FCMP(S0, S1)); \
+	emit_JUMPcond(comparator, arg.i); \
+} while (0)
+
+// r0 = *opstack; r1 = *--opstack
+#define LOAD_BINOP() do { \
+	emit(LDRWi(R0, rOPSTACK, 0)); \
+	emit(LDRWpre(R1, rOPSTACK, -4)); \
+} while (0)
+
+static inline unsigned _j_rel(int x, int pc)
+{
+	if (x&3) goto err;
+	x >>= 2;
+	if (x < -(1<<25) || x >= (1<<25))
+		goto err;
+	return x & ((1<<26)-1);
+err:
+	DIE("jump %d out of range at %d", x, pc);
+}
+
+void VM_Compile(vm_t *vm, vmHeader_t *header)
+{
+	unsigned char *code;
+	int i_count, pc = 0;
+	int pass;
+	int codeoffsets[3] = { 0 };
+
+#define j_rel(x) (pass?_j_rel(x, pc):0)
+#define get_offset(i) (codeoffsets[i])
+#define save_offset(i) (codeoffsets[i] = vm->codeLength)
+#define OFF_CODE 0
+#define OFF_ERRJUMP 1
+#define OFF_SYSCALL 2
+
+	vm->compiled = qfalse;
+
+	vm->codeBase = NULL;
+	vm->codeLength = 0;
+
+	for (pass = 0; pass < 2; ++pass) {
+
+	if(pass)
+	{
+		vm->codeBase = mmap(NULL, vm->codeLength, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+		if(vm->codeBase == MAP_FAILED)
+			Com_Error(ERR_FATAL, "VM_CompileAArch64: can't mmap memory");
+		vm->codeLength = 0;
+	}
+
+	//int (*entry)(vm_t*, int*, int*);
+	emit(STPXpre(FP, LR, SP, -96));
+	emit(STPXi(19, 20, SP, 16));
+	emit(STPXi(21, 22, SP, 32));
+	emit(STPXi(23, 24, SP, 48));
+	emit(STPXi(25, 26, SP, 64));
+	emit(STPXi(27, 28, SP, 80));
+	emit(LDRXi(rCODEBASE, R0, offsetof(vm_t, codeBase)));
+	emit(LDRXi(rDATABASE, R0, offsetof(vm_t, dataBase)));
+	emit(LDRWi(rDATAMASK, R0, offsetof(vm_t, dataMask)));
+	emit(LDRXi(rINSPOINTERS, R0, offsetof(vm_t, instructionPointers)));
+	emit(LDRWi(rPSTACK, R1, 0));
+	emit(MOVX(rPSTACKPTR, R1));
+	emit(MOVX(rOPSTACK, R2));
+
+	emit(BLi(j_rel(get_offset(OFF_CODE)-vm->codeLength)));
+
+	emit(STRWi(rPSTACK, rPSTACKPTR, 0));
+	// save return value in r0
+	emit(LDRWpost(R0, rOPSTACK, -4)); // r0 = *opstack; rOPSTACK -= 4
+
+	emit(LDPXi(27, 28, SP, 80));
+	emit(LDPXi(25, 26, SP, 64));
+	emit(LDPXi(23, 24, SP, 48));
+	emit(LDPXi(21, 22, SP, 32));
+	emit(LDPXi(19, 20, SP, 16));
+	emit(LDPXpost(FP, LR, SP, 96));
+	emit(RET);
+
+	// out of range jump, instruction number in r0
+	save_offset(OFF_ERRJUMP);
+	emit_MOVXi64(R16, ErrJump);
+	emit(BR(R16));
+
+	// system call, call number in r0 and program stack in r1.
+	// tail called so asmcall returns straight to the vm code
+	save_offset(OFF_SYSCALL);
+	emit_MOVXi64(R16, asmcall);
+	emit(BR(R16));
+
+	save_offset(OFF_CODE);
+
+	code = (unsigned char *) header + header->codeOffset;
+	pc = 0;
+
+	for (i_count = 0; i_count < header->instructionCount; i_count++) {
+		union {
+			unsigned char b[4];
+			unsigned int i;
+		} arg;
+		unsigned char op = code[pc++];
+
+		vm->instructionPointers[i_count] = vm->codeLength;
+
+		arg.i = 0;
+		if (vm_opInfo[op] & opImm4)
+		{
+			memcpy(arg.b, &code[pc], 4);
+			pc += 4;
+		}
+		else if (vm_opInfo[op] & opImm1)
+		{
+			arg.b[0] = code[pc];
+			++pc;
+		}
+
+		if (op >= OP_EQ && op <= OP_GEF && arg.i >= (unsigned)header->instructionCount)
+			DIE("jump target %u out of range at %d", arg.i, i_count);
+
+		switch ( op )
+		{
+			case OP_UNDEF:
+			case OP_IGNORE:
+				break;
+
+			case OP_BREAK:
+				emit(BRK(0));
+				break;
+
+			case OP_ENTER:
+				emit(STRXpre(LR, SP, -16)); // keep sp 16 byte aligned
+				emit_ADDSUBi(SUBi, SUB, rPSTACK, rPSTACK, arg.i); // pstack -= arg
+				break;
+
+			case OP_LEAVE:
+				emit_ADDSUBi(ADDi, ADD, rPSTACK, rPSTACK, arg.i); // pstack += arg
+				emit(LDRXpost(LR, SP, 16));
+				emit(RET);
+				break;
+
+			case OP_CALL:
+				{
+					int syscall_branch;
+
+					// get instruction nr from stack
+					emit(LDRWpost(R0, rOPSTACK, -4));  // r0 = *opstack; rOPSTACK -= 4
+					emit(CMPi(R0, 0)); // check if syscall
+					syscall_branch = vm->codeLength;
+					emit(NOP); // patched below
+					CHECK_JUMP;
+					emit(LDRXr3(R0, rINSPOINTERS, R0)); // r0 = instructionPointers[r0]
+					emit(ADDX(R0, rCODEBASE, R0)); // r0 = codeBase+r0
+					emit(BLR(R0));
+					emit(Bi(j_rel(vm->instructionPointers[i_count+1]-vm->codeLength)));
+					patch(syscall_branch, Bcond(LT, (vm->codeLength - syscall_branch)>>2));
+					emit(MOV(R1, rPSTACK));
+					emit(BLi(j_rel(get_offset(OFF_SYSCALL)-vm->codeLength)));
+					// store return value
+					emit(STRWpre(R0, rOPSTACK, 4));      // opstack+=4; *opstack = r0
+				}
+				break;
+
+			case OP_PUSH:
+				emit(ADDXi(rOPSTACK, rOPSTACK, 4));
+				break;
+
+			case OP_POP:
+				emit(SUBXi(rOPSTACK, rOPSTACK, 4));
+				break;
+
+			case OP_CONST:
+				emit_MOVRxi(R0, arg.i);
+				emit(STRWpre(R0, rOPSTACK, 4));      // opstack+=4; *opstack = r0
+				break;
+
+			case OP_LOCAL:
+				emit_ADDSUBi(ADDi, ADD, R0, rPSTACK, arg.i); // r0 = pstack+arg
+				emit(STRWpre(R0, rOPSTACK, 4));      // opstack+=4; *opstack = r0
+				break;
+
+			case OP_JUMP:
+				emit(LDRWpost(R0, rOPSTACK, -4));  // r0 = *opstack; rOPSTACK -= 4
+				CHECK_JUMP;
+				emit(LDRXr3(R0, rINSPOINTERS, R0)); // r0 = instructionPointers[r0]
+				emit(ADDX(R0, rCODEBASE, R0)); // r0 = codeBase+r0
+				emit(BR(R0));
+				break;
+
+			case OP_EQ:
+				IJ(EQ);
+				break;
+
+			case OP_NE:
+				IJ(NE);
+				break;
+
+			case OP_LTI:
+				IJ(LT);
+				break;
+
+			case OP_LEI:
+				IJ(LE);
+				break;
+
+			case OP_GTI:
+				IJ(GT);
+				break;
+
+			case OP_GEI:
+				IJ(GE);
+				break;
+
+			case OP_LTU:
+				IJ(LO);
+				break;
+
+			case OP_LEU:
+				IJ(LS);
+				break;
+
+			case OP_GTU:
+				IJ(HI);
+				break;
+
+			case OP_GEU:
+				IJ(HS);
+				break;
+
+			case OP_EQF:
+				FJ(EQ);
+				break;
+
+			case OP_NEF:
+				FJ(NE);
+				break;
+
+			case OP_LTF:
+				FJ(MI);
+				break;
+
+			case OP_LEF:
+				FJ(LS);
+				break;
+
+			case OP_GTF:
+				FJ(GT);
+				break;
+
+			case OP_GEF:
+				FJ(GE);
+				break;
+
+			case OP_LOAD1:
+				emit(LDRWi(R0, rOPSTACK, 0));   // r0 = *opstack
+				emit(AND(R0, R0, rDATAMASK));    // r0 = r0 & rDATAMASK
+				emit(LDRBr(R0, rDATABASE, R0));  // r0 = (unsigned char)dataBase[r0]
+				emit(STRWi(R0, rOPSTACK, 0));   // *opstack = r0
+				break;
+
+			case OP_LOAD2:
+				emit(LDRWi(R0, rOPSTACK, 0));   // r0 = *opstack
+				emit(AND(R0, R0, rDATAMASK));    // r0 = r0 & rDATAMASK
+				emit(LDRHr(R0, rDATABASE, R0));  // r0 = (unsigned short)dataBase[r0]
+				emit(STRWi(R0, rOPSTACK, 0));   // *opstack = r0
+				break;
+
+			case OP_LOAD4:
+				emit(LDRWi(R0, rOPSTACK, 0));   // r0 = *opstack
+				emit(AND(R0, R0, rDATAMASK));    // r0 = r0 & rDATAMASK
+				emit(LDRWr(R0, rDATABASE, R0));  // r0 = dataBase[r0]
+				emit(STRWi(R0, rOPSTACK, 0));   // *opstack = r0
+				break;
+
+			case OP_STORE1:
+				emit(LDRWpost(R0, rOPSTACK, -4));  // r0 = *opstack; rOPSTACK -= 4
+				emit(LDRWpost(R1, rOPSTACK, -4));  // r1 = *opstack; rOPSTACK -= 4
+				emit(AND(R1, R1, rDATAMASK));    // r1 = r1 & rDATAMASK
+				emit(STRBr(R0, rDATABASE, R1)); // database[r1] = r0
+				break;
+
+			case OP_STORE2:
+				emit(LDRWpost(R0, rOPSTACK, -4));  // r0 = *opstack; rOPSTACK -= 4
+				emit(LDRWpost(R1, rOPSTACK, -4));  // r1 = *opstack; rOPSTACK -= 4
+				emit(AND(R1, R1, rDATAMASK));    // r1 = r1 & rDATAMASK
+				emit(STRHr(R0, rDATABASE, R1)); // database[r1] = r0
+				break;
+
+			case OP_STORE4:
+				// value
+				emit(LDRWpost(R0, rOPSTACK, -4));  // r0 = *opstack; rOPSTACK -= 4
+				// pointer
+				emit(LDRWpost(R1, rOPSTACK, -4));  // r1 = *opstack; rOPSTACK -= 4
+				emit(AND(R1, R1, rDATAMASK));    // r1 = r1 & rDATAMASK
+				// store value at pointer
+				emit(STRWr(R0, rDATABASE, R1)); // database[r1] = r0
+				break;
+
+			case OP_ARG:
+				emit(LDRWpost(R0, rOPSTACK, -4));      // r0 = *opstack; rOPSTACK -= 4
+				emit(ADDi(R1, rPSTACK, arg.b[0]));  // r1 = programStack+arg
+				emit(AND(R1, R1, rDATAMASK));       // r1 = r1 & rDATAMASK
+				emit(STRWr(R0, rDATABASE, R1));      // dataBase[r1] = r0
+				break;
+
+			case OP_BLOCK_COPY:
+				emit(LDRWpost(R1, rOPSTACK, -4));  // r1 = src
+				emit(LDRWpost(R0, rOPSTACK, -4));  // r0 = dest
+				emit_MOVRxi(R2, arg.i);
+				emit_MOVXi64(R16, VM_BlockCopy);
+				emit(BLR(R16));
+				break;
+
+			case OP_SEX8:
+				emit(LDRWi(R0, rOPSTACK, 0));  // r0 = *opstack
+				emit(SXTB(R0, R0));            // sign extend r0
+				emit(STRWi(R0, rOPSTACK, 0));  // *opstack = r0
+				break;
+
+			case OP_SEX16:
+				emit(LDRWi(R0, rOPSTACK, 0));  // r0 = *opstack
+				emit(SXTH(R0, R0));            // sign extend r0
+				emit(STRWi(R0, rOPSTACK, 0));  // *opstack = r0
+				break;
+
+			case OP_NEGI:
+				emit(LDRWi(R0, rOPSTACK, 0));  // r0 = *opstack
+				emit(NEG(R0, R0));             // r0 = -r0
+				emit(STRWi(R0, rOPSTACK, 0));  // *opstack = r0
+				break;
+
+			case OP_ADD:
+				LOAD_BINOP();
+				emit(ADD(R0, R1, R0));         // r0 = r1 + r0
+				emit(STRWi(R0, rOPSTACK, 0));  // *opstack = r0
+				break;
+
+			case OP_SUB:
+				LOAD_BINOP();
+				emit(SUB(R0, R1, R0));         // r0 = r1 - r0
+				emit(STRWi(R0, rOPSTACK, 0));  // *opstack = r0
+				break;
+
+			case OP_DIVI:
+				LOAD_BINOP();
+				emit(SDIV(R0, R1, R0));        // r0 = r1 / r0
+				emit(STRWi(R0, rOPSTACK, 0));  // *opstack = r0
+				break;
+
+			case OP_DIVU:
+				LOAD_BINOP();
+				emit(UDIV(R0, R1, R0));        // r0 = (unsigned)r1 / r0
+				emit(STRWi(R0, rOPSTACK, 0));  // *opstack = r0
+				break;
+
+			case OP_MODI:
+				LOAD_BINOP();
+				emit(SDIV(R2, R1, R0));        // r2 = r1 / r0
+				emit(MSUB(R0, R2, R0, R1));    // r0 = r1 - r2 * r0
+				emit(STRWi(R0, rOPSTACK, 0));  // *opstack = r0
+				break;
+
+			case OP_MODU:
+				LOAD_BINOP();
+				emit(UDIV(R2, R1, R0));        // r2 = (unsigned)r1 / r0
+				emit(MSUB(R0, R2, R0, R1));    // r0 = r1 - r2 * r0
+				emit(STRWi(R0, rOPSTACK, 0));  // *opstack = r0
+				break;
+
+			case OP_MULI:
+			case OP_MULU:
+				LOAD_BINOP();
+				emit(MUL(R0, R1, R0));         // r0 = r1 * r0
+				emit(STRWi(R0, rOPSTACK, 0));  // *opstack = r0
+				break;
+
+			case OP_BAND:
+				LOAD_BINOP();
+				emit(AND(R0, R1, R0));         // r0 = r1 & r0
+				emit(STRWi(R0, rOPSTACK, 0));  // *opstack = r0
+				break;
+
+			case OP_BOR:
+				LOAD_BINOP();
+				emit(ORR(R0, R1, R0));         // r0 = r1 | r0
+				emit(STRWi(R0, rOPSTACK, 0));  // *opstack = r0
+				break;
+
+			case OP_BXOR:
+				LOAD_BINOP();
+				emit(EOR(R0, R1, R0));         // r0 = r1 ^ r0
+				emit(STRWi(R0, rOPSTACK, 0));  // *opstack = r0
+				break;
+
+			case OP_BCOM:
+				emit(LDRWi(R0, rOPSTACK, 0));  // r0 = *opstack
+				emit(MVN(R0, R0));             // r0 = ~r0
+				emit(STRWi(R0, rOPSTACK, 0));  // *opstack = r0
+				break;
+
+			case OP_LSH:
+				LOAD_BINOP();
+				emit(LSL(R0, R1, R0));         // r0 = r1 << r0
+				emit(STRWi(R0, rOPSTACK, 0));  // *opstack = r0
+				break;
+
+			case OP_RSHI:
+				LOAD_BINOP();
+				emit(ASR(R0, R1, R0));         // r0 = r1 >> r0
+				emit(STRWi(R0, rOPSTACK, 0));  // *opstack = r0
+				break;
+
+			case OP_RSHU:
+				LOAD_BINOP();
+				emit(LSR(R0, R1, R0));         // r0 = (unsigned)r1 >> r0
+				emit(STRWi(R0, rOPSTACK, 0));  // *opstack = r0
+				break;
+
+			case OP_NEGF:
+				emit(LDRSi(S0, rOPSTACK, 0));  // s0 = *((float*)opstack)
+				emit(FNEG(S0, S0));            // s0 = -s0
+				emit(STRSi(S0, rOPSTACK, 0));  // *((float*)opstack) = s0
+				break;
+
+			case OP_ADDF:
+				emit(LDRSi(S0, rOPSTACK, 0));      // s0 = *((float*)opstack)
+				emit(LDRSpre(S1, rOPSTACK, -4));   // opstack-=4; s1 = *opstack
+				emit(FADD(S0, S1, S0));            // s0 = s1 + s0
+				emit(STRSi(S0, rOPSTACK, 0));      // *((float*)opstack) = s0
+				break;
+
+			case OP_SUBF:
+				emit(LDRSi(S0, rOPSTACK, 0));      // s0 = *((float*)opstack)
+				emit(LDRSpre(S1, rOPSTACK, -4));   // opstack-=4; s1 = *opstack
+				emit(FSUB(S0, S1, S0));            // s0 = s1 - s0
+				emit(STRSi(S0, rOPSTACK, 0));      // *((float*)opstack) = s0
+				break;
+
+			case OP_DIVF:
+				emit(LDRSi(S0, rOPSTACK, 0));      // s0 = *((float*)opstack)
+				emit(LDRSpre(S1, rOPSTACK, -4));   // opstack-=4; s1 = *opstack
+				emit(FDIV(S0, S1, S0));            // s0 = s1 / s0
+				emit(STRSi(S0, rOPSTACK, 0));      // *((float*)opstack) = s0
+				break;
+
+			case OP_MULF:
+				emit(LDRSi(S0, rOPSTACK, 0));      // s0 = *((float*)opstack)
+				emit(LDRSpre(S1, rOPSTACK, -4));   // opstack-=4; s1 = *opstack
+				emit(FMUL(S0, S1, S0));            // s0 = s1 * s0
+				emit(STRSi(S0, rOPSTACK, 0));      // *((float*)opstack) = s0
+				break;
+
+			case OP_CVIF:
+				emit(LDRWi(R0, rOPSTACK, 0));  // r0 = *opstack
+				emit(SCVTF(S0, R0));           // s0 = (float)r0
+				emit(STRSi(S0, rOPSTACK, 0));  // *((float*)opstack) = s0
+				break;
+
+			case OP_CVFI:
+				emit(LDRSi(S0, rOPSTACK, 0));  // s0 = *((float*)opstack)
+				emit(FCVTZS(R0, S0));          // r0 = (int)s0
+				emit(STRWi(R0, rOPSTACK, 0));  // *opstack = r0
+				break;
+
+			default:
+				Com_Printf(S_COLOR_RED "vm_aarch64: instruction not implemented: %x\n", op);
+				VM_Destroy_Compiled(vm);
+				vm->codeLength = header->codeLength;
+				vm->compiled = qfalse;
+				return;
+		}
+	}
+
+	// never reached
+	emit(BRK(0));
+	} // pass
+
+	if (mprotect(vm->codeBase, vm->codeLength, PROT_READ|PROT_EXEC)) {
+		VM_Destroy_Compiled(vm);
+		DIE("mprotect failed");
+	}
+
+	__builtin___clear_cache((char *)vm->codeBase, (char *)vm->codeBase+vm->codeLength);
+
+	vm->destroy = VM_Destroy_Compiled;
+	vm->compiled = qtrue;
+}
+
+int VM_CallCompiled(vm_t *vm, int *args)
+{
+	byte	stack[OPSTACK_SIZE + 15];
+	int	*opStack;
+	int	programStack = vm->programStack;
+	int	stackOnEntry = programStack;
+	byte	*image = vm->dataBase;
+	int	*argPointer;
+	int	retVal;
+
+	currentVM = vm;
+
+	vm->currentlyInterpreting = qtrue;
+
+	programStack -= ( 8 + 4 * MAX_VMMAIN_ARGS );
+	argPointer = (int *)&image[ programStack + 8 ];
+	memcpy( argPointer, args, 4 * MAX_VMMAIN_ARGS );
+	argPointer[-1] = 0;
+	argPointer[-2] = -1;
+
+	opStack = PADP(stack, 16);
+	*opStack = 0xDEADBEEF;
+
+	/* call generated code */
+	{
+		int (*entry)(vm_t*, int*, int*);
+
+		entry = (void *)(vm->codeBase);
+		retVal = entry(vm, &programStack, opStack);
+	}
+
+	if(*opStack != 0xDEADBEEF)
+	{
+		Com_Error(ERR_DROP, "opStack corrupted in compiled code");
+	}
+
+	if(programStack != stackOnEntry - (8 + 4 * MAX_VMMAIN_ARGS))
+		Com_Error(ERR_DROP, "programStack corrupted in compiled code");
+
+	vm->programStack = stackOnEntry;
+	vm->currentlyInterpreting = qfalse;
+
+	return retVal;
+}
+
+#endif // __aarch64__
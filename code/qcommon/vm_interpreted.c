@@ -112,6 +112,20 @@ static char	*opnames[256] = {
 };
 #endif
 
+/*
+With GCC style computed gotos every codeBase slot gets a parallel
+vm->threadedCode entry holding the address of its handler, and each
+handler jumps straight to the next one. The switch in VM_CallInterpreted
+stays as the portable path and for DEBUG_VM, which checks every
+instruction.
+*/
+#if defined(__GNUC__) && !defined(DEBUG_VM)
+#define VM_THREADED
+#define VM_CASE(op) case op: L_##op
+#else
+#define VM_CASE(op) case op
+#endif
+
 #if idppc
 
 //FIXME: these, um... look the same to me
@@ -176,6 +190,10 @@ void VM_PrepareInterpreter( vm_t *vm, vmHeader_t *header ) {
 	int		*codeBase;
 
 	vm->codeBase = Hunk_Alloc( vm->codeLength*4, h_high );			// we're now int aligned
+#ifdef VM_THREADED
+	// filled in by the first VM_CallInterpreted
+	vm->threadedCode = Hunk_Alloc( vm->codeLength * sizeof( *vm->threadedCode ), h_high );
+#endif
 //	memcpy( vm->codeBase, (byte *)header + header->codeOffset, vm->codeLength );
 
 	// we don't need to translate the instructions, but we still need
@@ -330,6 +348,32 @@ int	VM_CallInterpreted( vm_t *vm, int *args ) {
 #ifdef DEBUG_VM
 	vmSymbol_t	*profileSymbol;
 #endif
+#ifdef VM_THREADED
+	static const void *const dispatchTable[256] = {
+		[OP_UNDEF] = &&L_OP_UNDEF, [OP_IGNORE] = &&L_OP_IGNORE, [OP_BREAK] = &&L_OP_BREAK,
+		[OP_ENTER] = &&L_OP_ENTER, [OP_LEAVE] = &&L_OP_LEAVE, [OP_CALL] = &&L_OP_CALL,
+		[OP_PUSH] = &&L_OP_PUSH, [OP_POP] = &&L_OP_POP, [OP_CONST] = &&L_OP_CONST,
+		[OP_LOCAL] = &&L_OP_LOCAL, [OP_JUMP] = &&L_OP_JUMP,
+		[OP_EQ] = &&L_OP_EQ, [OP_NE] = &&L_OP_NE,
+		[OP_LTI] = &&L_OP_LTI, [OP_LEI] = &&L_OP_LEI, [OP_GTI] = &&L_OP_GTI, [OP_GEI] = &&L_OP_GEI,
+		[OP_LTU] = &&L_OP_LTU, [OP_LEU] = &&L_OP_LEU, [OP_GTU] = &&L_OP_GTU, [OP_GEU] = &&L_OP_GEU,
+		[OP_EQF] = &&L_OP_EQF, [OP_NEF] = &&L_OP_NEF,
+		[OP_LTF] = &&L_OP_LTF, [OP_LEF] = &&L_OP_LEF, [OP_GTF] = &&L_OP_GTF, [OP_GEF] = &&L_OP_GEF,
+		[OP_LOAD1] = &&L_OP_LOAD1, [OP_LOAD2] = &&L_OP_LOAD2, [OP_LOAD4] = &&L_OP_LOAD4,
+		[OP_STORE1] = &&L_OP_STORE1, [OP_STORE2] = &&L_OP_STORE2, [OP_STORE4] = &&L_OP_STORE4,
+		[OP_ARG] = &&L_OP_ARG, [OP_BLOCK_COPY] = &&L_OP_BLOCK_COPY,
+		[OP_SEX8] = &&L_OP_SEX8, [OP_SEX16] = &&L_OP_SEX16,
+		[OP_NEGI] = &&L_OP_NEGI, [OP_ADD] = &&L_OP_ADD, [OP_SUB] = &&L_OP_SUB,
+		[OP_DIVI] = &&L_OP_DIVI, [OP_DIVU] = &&L_OP_DIVU, [OP_MODI] = &&L_OP_MODI, [OP_MODU] = &&L_OP_MODU,
+		[OP_MULI] = &&L_OP_MULI, [OP_MULU] = &&L_OP_MULU,
+		[OP_BAND] = &&L_OP_BAND, [OP_BOR] = &&L_OP_BOR, [OP_BXOR] = &&L_OP_BXOR, [OP_BCOM] = &&L_OP_BCOM,
+		[OP_LSH] = &&L_OP_LSH, [OP_RSHI] = &&L_OP_RSHI, [OP_RSHU] = &&L_OP_RSHU,
+		[OP_NEGF] = &&L_OP_NEGF, [OP_ADDF] = &&L_OP_ADDF, [OP_SUBF] = &&L_OP_SUBF,
+		[OP_DIVF] = &&L_OP_DIVF, [OP_MULF] = &&L_OP_MULF,
+		[OP_CVIF] = &&L_OP_CVIF, [OP_CVFI] = &&L_OP_CVFI,
+	};
+	const void	**threadedCode;
+#endif
 
 	// interpret the code
 	vm->currentlyInterpreting = qtrue;
@@ -347,6 +391,25 @@ int	VM_CallInterpreted( vm_t *vm, int *args ) {
 	image = vm->dataBase;
 	codeImage = (int *)vm->codeBase;
 	dataMask = vm->dataMask;
+
+#ifdef VM_THREADED
+	// label addresses only exist in here, so the handler table
+	// is filled on the first call rather than at load time
+	threadedCode = (const void **)vm->threadedCode;
+	if ( !threadedCode[0] ) {
+		int		i;
+
+		for ( i = 0; i < vm->codeLength; i++ ) {
+			unsigned int op = codeImage[i];
+
+			// anything that isn't an opcode is skipped like the switch does
+			if ( op < ARRAY_LEN( dispatchTable ) && dispatchTable[op] )
+				threadedCode[i] = dispatchTable[op];
+			else
+				threadedCode[i] = &&L_OP_UNDEF;
+		}
+	}
+#endif
 	
 	programCounter = 0;
 
@@ -401,6 +464,9 @@ nextInstruction2:
 			Com_Printf( "%s %s\n", DEBUGSTR, opnames[opcode] );
 		}
 		profileSymbol->profileCount++;
+#endif
+#ifdef VM_THREADED
+		goto *threadedCode[ programCounter++ ];
 #endif
 		opcode = codeImage[ programCounter++ ];
 
@@ -410,17 +476,20 @@ nextInstruction2:
 			Com_Error( ERR_DROP, "Bad VM instruction" );  // this should be scanned on load!
 			return 0;
 #endif
-		case OP_BREAK:
+		VM_CASE(OP_UNDEF):
+		VM_CASE(OP_IGNORE):
+			goto nextInstruction;
+		VM_CASE(OP_BREAK):
 			vm->breakCount++;
 			goto nextInstruction2;
-		case OP_CONST:
+		VM_CASE(OP_CONST):
 			opStackOfs++;
 			r1 = r0;
 			r0 = opStack[opStackOfs] = r2;
 			
 			programCounter += 1;
 			goto nextInstruction2;
-		case OP_LOCAL:
+		VM_CASE(OP_LOCAL):
 			opStackOfs++;
 			r1 = r0;
 			r0 = opStack[opStackOfs] = r2+programStack;
@@ -428,7 +497,7 @@ nextInstruction2:
 			programCounter += 1;
 			goto nextInstruction2;
 
-		case OP_LOAD4:
+		VM_CASE(OP_LOAD4):
 #ifdef DEBUG_VM
 			if(opStack[opStackOfs] & 3)
 			{
@@ -438,40 +507,40 @@ nextInstruction2:
 #endif
 			r0 = opStack[opStackOfs] = *(int *) &image[ r0 & dataMask ];
 			goto nextInstruction2;
-		case OP_LOAD2:
+		VM_CASE(OP_LOAD2):
 			r0 = opStack[opStackOfs] = *(unsigned short *)&image[ r0 & dataMask ];
 			goto nextInstruction2;
-		case OP_LOAD1:
+		VM_CASE(OP_LOAD1):
 			r0 = opStack[opStackOfs] = image[ r0 & dataMask ];
 			goto nextInstruction2;
 
-		case OP_STORE4:
+		VM_CASE(OP_STORE4):
 			*(int *)&image[ r1 & dataMask ] = r0;
 			opStackOfs -= 2;
 			goto nextInstruction;
-		case OP_STORE2:
+		VM_CASE(OP_STORE2):
 			*(short *)&image[ r1 & dataMask ] = r0;
 			opStackOfs -= 2;
 			goto nextInstruction;
-		case OP_STORE1:
+		VM_CASE(OP_STORE1):
 			image[ r1 & dataMask ] = r0;
 			opStackOfs -= 2;
 			goto nextInstruction;
 
-		case OP_ARG:
+		VM_CASE(OP_ARG):
 			// single byte offset from programStack
 			*(int *)&image[ (codeImage[programCounter] + programStack) & dataMask ] = r0;
 			opStackOfs--;
 			programCounter += 1;
 			goto nextInstruction;
 
-		case OP_BLOCK_COPY:
+		VM_CASE(OP_BLOCK_COPY):
 			VM_BlockCopy(r1, r0, r2);
 			programCounter += 1;
 			opStackOfs -= 2;
 			goto nextInstruction;
 
-		case OP_CALL:
+		VM_CASE(OP_CALL):
 			// save current program counter
 			*(int *)&image[ programStack ] = programCounter;
 			
@@ -540,17 +609,20 @@ nextInstruction2:
 			goto nextInstruction;
 
 		// push and pop are only needed for discarded or bad function return values
-		case OP_PUSH:
+		VM_CASE(OP_PUSH):
 			opStackOfs++;
 			goto nextInstruction;
-		case OP_POP:
+		VM_CASE(OP_POP):
 			opStackOfs--;
 			goto nextInstruction;
 
-		case OP_ENTER:
+		VM_CASE(OP_ENTER):
 #ifdef DEBUG_VM
 			profileSymbol = VM_ValueToFunctionSymbol( vm, programCounter );
 #endif
+			if ( vm->profile ) {
+				VM_ProfileEnter( vm, VM_ProfileFunctionAtOffset( vm, programCounter - 1 ) );
+			}
 			// get size of stack frame
 			v1 = r2;
 
@@ -571,7 +643,10 @@ nextInstruction2:
 			}
 #endif
 			goto nextInstruction;
-		case OP_LEAVE:
+		VM_CASE(OP_LEAVE):
+			if ( vm->profile ) {
+				VM_ProfileLeave( vm );
+			}
 			// remove our stack frame
 			v1 = r2;
 
@@ -601,7 +676,7 @@ nextInstruction2:
 		===================================================================
 		*/
 
-		case OP_JUMP:
+		VM_CASE(OP_JUMP):
 			if ( (unsigned)r0 >= vm->instructionCount )
 			{
 				Com_Error( ERR_DROP, "VM program counter out of range in OP_JUMP" );
@@ -613,7 +688,7 @@ nextInstruction2:
 			opStackOfs--;
 			goto nextInstruction;
 
-		case OP_EQ:
+		VM_CASE(OP_EQ):
 			opStackOfs -= 2;
 			if ( r1 == r0 ) {
 				programCounter = r2;	//vm->instructionPointers[r2];
@@ -623,7 +698,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_NE:
+		VM_CASE(OP_NE):
 			opStackOfs -= 2;
 			if ( r1 != r0 ) {
 				programCounter = r2;	//vm->instructionPointers[r2];
@@ -633,7 +708,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_LTI:
+		VM_CASE(OP_LTI):
 			opStackOfs -= 2;
 			if ( r1 < r0 ) {
 				programCounter = r2;	//vm->instructionPointers[r2];
@@ -643,7 +718,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_LEI:
+		VM_CASE(OP_LEI):
 			opStackOfs -= 2;
 			if ( r1 <= r0 ) {
 				programCounter = r2;	//vm->instructionPointers[r2];
@@ -653,7 +728,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_GTI:
+		VM_CASE(OP_GTI):
 			opStackOfs -= 2;
 			if ( r1 > r0 ) {
 				programCounter = r2;	//vm->instructionPointers[r2];
@@ -663,7 +738,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_GEI:
+		VM_CASE(OP_GEI):
 			opStackOfs -= 2;
 			if ( r1 >= r0 ) {
 				programCounter = r2;	//vm->instructionPointers[r2];
@@ -673,7 +748,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_LTU:
+		VM_CASE(OP_LTU):
 			opStackOfs -= 2;
 			if ( ((unsigned)r1) < ((unsigned)r0) ) {
 				programCounter = r2;	//vm->instructionPointers[r2];
@@ -683,7 +758,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_LEU:
+		VM_CASE(OP_LEU):
 			opStackOfs -= 2;
 			if ( ((unsigned)r1) <= ((unsigned)r0) ) {
 				programCounter = r2;	//vm->instructionPointers[r2];
@@ -693,7 +768,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_GTU:
+		VM_CASE(OP_GTU):
 			opStackOfs -= 2;
 			if ( ((unsigned)r1) > ((unsigned)r0) ) {
 				programCounter = r2;	//vm->instructionPointers[r2];
@@ -703,7 +778,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_GEU:
+		VM_CASE(OP_GEU):
 			opStackOfs -= 2;
 			if ( ((unsigned)r1) >= ((unsigned)r0) ) {
 				programCounter = r2;	//vm->instructionPointers[r2];
@@ -713,7 +788,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_EQF:
+		VM_CASE(OP_EQF):
 			opStackOfs -= 2;
 			
 			if(((float *) opStack)[(uint8_t) (opStackOfs + 1)] == ((float *) opStack)[(uint8_t) (opStackOfs + 2)])
@@ -725,7 +800,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_NEF:
+		VM_CASE(OP_NEF):
 			opStackOfs -= 2;
 
 			if(((float *) opStack)[(uint8_t) (opStackOfs + 1)] != ((float *) opStack)[(uint8_t) (opStackOfs + 2)])
@@ -737,7 +812,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_LTF:
+		VM_CASE(OP_LTF):
 			opStackOfs -= 2;
 
 			if(((float *) opStack)[(uint8_t) (opStackOfs + 1)] < ((float *) opStack)[(uint8_t) (opStackOfs + 2)])
@@ -749,7 +824,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_LEF:
+		VM_CASE(OP_LEF):
 			opStackOfs -= 2;
 
 			if(((float *) opStack)[(uint8_t) ((uint8_t) (opStackOfs + 1))] <= ((float *) opStack)[(uint8_t) ((uint8_t) (opStackOfs + 2))])
@@ -761,7 +836,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_GTF:
+		VM_CASE(OP_GTF):
 			opStackOfs -= 2;
 
 			if(((float *) opStack)[(uint8_t) (opStackOfs + 1)] > ((float *) opStack)[(uint8_t) (opStackOfs + 2)])
@@ -773,7 +848,7 @@ nextInstruction2:
 				goto nextInstruction;
 			}
 
-		case OP_GEF:
+		VM_CASE(OP_GEF):
 			opStackOfs -= 2;
 
 			if(((float *) opStack)[(uint8_t) (opStackOfs + 1)] >= ((float *) opStack)[(uint8_t) (opStackOfs + 2)])
@@ -788,101 +863,101 @@ nextInstruction2:
 
 		//===================================================================
 
-		case OP_NEGI:
+		VM_CASE(OP_NEGI):
 			opStack[opStackOfs] = -r0;
 			goto nextInstruction;
-		case OP_ADD:
+		VM_CASE(OP_ADD):
 			opStackOfs--;
 			opStack[opStackOfs] = r1 + r0;
 			goto nextInstruction;
-		case OP_SUB:
+		VM_CASE(OP_SUB):
 			opStackOfs--;
 			opStack[opStackOfs] = r1 - r0;
 			goto nextInstruction;
-		case OP_DIVI:
+		VM_CASE(OP_DIVI):
 			opStackOfs--;
 			opStack[opStackOfs] = r1 / r0;
 			goto nextInstruction;
-		case OP_DIVU:
+		VM_CASE(OP_DIVU):
 			opStackOfs--;
 			opStack[opStackOfs] = ((unsigned) r1) / ((unsigned) r0);
 			goto nextInstruction;
-		case OP_MODI:
+		VM_CASE(OP_MODI):
 			opStackOfs--;
 			opStack[opStackOfs] = r1 % r0;
 			goto nextInstruction;
-		case OP_MODU:
+		VM_CASE(OP_MODU):
 			opStackOfs--;
 			opStack[opStackOfs] = ((unsigned) r1) % ((unsigned) r0);
 			goto nextInstruction;
-		case OP_MULI:
+		VM_CASE(OP_MULI):
 			opStackOfs--;
 			opStack[opStackOfs] = r1 * r0;
 			goto nextInstruction;
-		case OP_MULU:
+		VM_CASE(OP_MULU):
 			opStackOfs--;
 			opStack[opStackOfs] = ((unsigned) r1) * ((unsigned) r0);
 			goto nextInstruction;
 
-		case OP_BAND:
+		VM_CASE(OP_BAND):
 			opStackOfs--;
 			opStack[opStackOfs] = ((unsigned) r1) & ((unsigned) r0);
 			goto nextInstruction;
-		case OP_BOR:
+		VM_CASE(OP_BOR):
 			opStackOfs--;
 			opStack[opStackOfs] = ((unsigned) r1) | ((unsigned) r0);
 			goto nextInstruction;
-		case OP_BXOR:
+		VM_CASE(OP_BXOR):
 			opStackOfs--;
 			opStack[opStackOfs] = ((unsigned) r1) ^ ((unsigned) r0);
 			goto nextInstruction;
-		case OP_BCOM:
+		VM_CASE(OP_BCOM):
 			opStack[opStackOfs] = ~((unsigned) r0);
 			goto nextInstruction;
 
-		case OP_LSH:
+		VM_CASE(OP_LSH):
 			opStackOfs--;
 			opStack[opStackOfs] = r1 << r0;
 			goto nextInstruction;
-		case OP_RSHI:
+		VM_CASE(OP_RSHI):
 			opStackOfs--;
 			opStack[opStackOfs] = r1 >> r0;
 			goto nextInstruction;
-		case OP_RSHU:
+		VM_CASE(OP_RSHU):
 			opStackOfs--;
 			opStack[opStackOfs] = ((unsigned) r1) >> r0;
 			goto nextInstruction;
 
-		case OP_NEGF:
+		VM_CASE(OP_NEGF):
 			((float *) opStack)[opStackOfs] =  -((float *) opStack)[opStackOfs];
 			goto nextInstruction;
-		case OP_ADDF:
+		VM_CASE(OP_ADDF):
 			opStackOfs--;
 			((float *) opStack)[opStackOfs] = ((float *) opStack)[opStackOfs] + ((float *) opStack)[(uint8_t) (opStackOfs + 1)];
 			goto nextInstruction;
-		case OP_SUBF:
+		VM_CASE(OP_SUBF):
 			opStackOfs--;
 			((float *) opStack)[opStackOfs] = ((float *) opStack)[opStackOfs] - ((float *) opStack)[(uint8_t) (opStackOfs + 1)];
 			goto nextInstruction;
-		case OP_DIVF:
+		VM_CASE(OP_DIVF):
 			opStackOfs--;
 			((float *) opStack)[opStackOfs] = ((float *) opStack)[opStackOfs] / ((float *) opStack)[(uint8_t) (opStackOfs + 1)];
 			goto nextInstruction;
-		case OP_MULF:
+		VM_CASE(OP_MULF):
 			opStackOfs--;
 			((float *) opStack)[opStackOfs] = ((float *) opStack)[opStackOfs] * ((float *) opStack)[(uint8_t) (opStackOfs + 1)];
 			goto nextInstruction;
 
-		case OP_CVIF:
+		VM_CASE(OP_CVIF):
 			((float *) opStack)[opStackOfs] = (float) opStack[opStackOfs];
 			goto nextInstruction;
-		case OP_CVFI:
+		VM_CASE(OP_CVFI):
 			opStack[opStackOfs] = Q_ftol(((float *) opStack)[opStackOfs]);
 			goto nextInstruction;
-		case OP_SEX8:
+		VM_CASE(OP_SEX8):
 			opStack[opStackOfs] = (signed char) opStack[opStackOfs];
 			goto nextInstruction;
-		case OP_SEX16:
+		VM_CASE(OP_SEX16):
 			opStack[opStackOfs] = (short) opStack[opStackOfs];
 			goto nextInstruction;
 		}
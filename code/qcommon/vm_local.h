@@ -138,6 +138,47 @@ typedef struct vmSymbol_s {
 	char	symName[1];		// variable sized
 } vmSymbol_t;
 
+// function level profiling of bytecode modules, see vm_profile
+#define	MAX_VM_PROFILE_DEPTH	256
+#define	MAX_VM_PROFILE_NODES	16384
+
+typedef struct {
+	int			instruction;	// of the OP_ENTER
+	const char	*name;			// from the map file, if loaded
+	int			calls;
+	int			active;			// recursion depth, so inclusive time counts once
+	int64_t		inclusive;		// usec
+	int64_t		exclusive;
+} vmProfileFunc_t;
+
+// one call path, for the folded stack dump
+typedef struct {
+	int			func;
+	int			parent;
+	int			child;			// first callee
+	int			sibling;		// next callee of parent
+	int64_t		exclusive;
+} vmProfileNode_t;
+
+typedef struct {
+	int			func;
+	int			node;
+	int64_t		start;
+	int64_t		childTime;
+} vmProfileFrame_t;
+
+typedef struct vmProfile_s {
+	int					numFuncs;
+	vmProfileFunc_t		*funcs;			// sorted by instruction
+
+	int					numNodes;
+	vmProfileNode_t		*nodes;			// 0 is the root
+
+	int					depth;
+	int					lostFrames;		// entered past MAX_VM_PROFILE_DEPTH
+	vmProfileFrame_t	frames[MAX_VM_PROFILE_DEPTH];
+} vmProfile_t;
+
 #define	VM_OFFSET_PROGRAM_STACK		0
 #define	VM_OFFSET_SYSTEM_CALL		4
 
@@ -159,6 +200,7 @@ struct vm_s {
 
 	// for interpreted modules
 	qboolean	currentlyInterpreting;
+	void		**threadedCode;		// handler address per codeBase slot
 
 	qboolean	compiled;
 	byte		*codeBase;
@@ -183,6 +225,8 @@ struct vm_s {
 
 	byte		*jumpTableTargets;
 	int			numJumpTableTargets;
+
+	struct vmProfile_s	*profile;	// NULL unless vm_profile was set at load
 };
 
 
@@ -200,4 +244,9 @@ int VM_SymbolToValue( vm_t *vm, const char *symbol );
 const char *VM_ValueToSymbol( vm_t *vm, int value );
 void VM_LogSyscalls( int *args );
 
+int VM_ProfileFunction( vm_t *vm, int instruction );
+int VM_ProfileFunctionAtOffset( vm_t *vm, int codeOffset );
+void VM_ProfileEnter( vm_t *vm, int func );
+void VM_ProfileLeave( vm_t *vm );
+
 void VM_BlockCopy(unsigned int dest, unsigned int src, size_t n);
@@ -86,7 +86,9 @@ typedef enum
 typedef enum
 {
 	VM_JMP_VIOLATION = 0,
-	VM_BLOCK_COPY = 1
+	VM_BLOCK_COPY = 1,
+	VM_PROFILE_ENTER = 2,
+	VM_PROFILE_LEAVE = 3
 } ESysCallType;
 
 static	ELastCommand	LastCommand;
@@ -453,6 +455,12 @@ static void DoSyscall(void)
 			
 			VM_BlockCopy(vm_opStackBase[(vm_opStackOfs - 1)], vm_opStackBase[vm_opStackOfs], vm_arg);
 		break;
+		case VM_PROFILE_ENTER:
+			VM_ProfileEnter(savedVM, vm_arg);
+		break;
+		case VM_PROFILE_LEAVE:
+			VM_ProfileLeave(savedVM);
+		break;
 		default:
 			Com_Error(ERR_DROP, "Unknown VM operation %d", vm_syscallNum);
 		break;
@@ -1155,6 +1163,15 @@ void VM_Compile(vm_t *vm, vmHeader_t *header)
 			EmitString("CC");				// int 3
 			break;
 		case OP_ENTER:
+			if(vm->profile)
+			{
+				EmitString("B8");			// mov eax, 0x12345678
+				Emit4(VM_PROFILE_ENTER);
+				EmitString("B9");			// mov ecx, 0x12345678
+				Emit4(VM_ProfileFunction(vm, instruction - 1));
+
+				EmitCallRel(vm, callDoSyscallOfs);
+			}
 			EmitString("81 EE");				// sub esi, 0x12345678
 			Emit4(Constant4());
 			break;
@@ -1204,6 +1221,13 @@ void VM_Compile(vm_t *vm, vmHeader_t *header)
 			break;
 		case OP_LEAVE:
 			v = Constant4();
+			if(vm->profile)
+			{
+				EmitString("B8");			// mov eax, 0x12345678
+				Emit4(VM_PROFILE_LEAVE);
+
+				EmitCallRel(vm, callDoSyscallOfs);
+			}
 			EmitString("81 C6");				// add	esi, 0x12345678
 			Emit4(v);
 			EmitString("C3");				// ret
@@ -1476,13 +1500,16 @@ void VM_Compile(vm_t *vm, vmHeader_t *header)
 			break;
 		case OP_ADD:
 			EmitMovEAXStack(vm, 0);				// mov eax, dword ptr [edi + ebx * 4]
-			EmitString("01 44 9F FC");			// add dword ptr -4[edi + ebx * 4], eax
+			EmitString("03 44 9F FC");			// add eax, dword ptr -4[edi + ebx * 4]
 			EmitCommand(LAST_COMMAND_SUB_BL_1);		// sub bl, 1
+			EmitCommand(LAST_COMMAND_MOV_STACK_EAX);	// mov dword ptr [edi + ebx * 4], eax
 			break;
 		case OP_SUB:
 			EmitMovEAXStack(vm, 0);				// mov eax, dword ptr [edi + ebx * 4]
-			EmitString("29 44 9F FC");			// sub dword ptr -4[edi + ebx * 4], eax
+			EmitString("F7 D8");				// neg eax
+			EmitString("03 44 9F FC");			// add eax, dword ptr -4[edi + ebx * 4]
 			EmitCommand(LAST_COMMAND_SUB_BL_1);		// sub bl, 1
+			EmitCommand(LAST_COMMAND_MOV_STACK_EAX);	// mov dword ptr [edi + ebx * 4], eax
 			break;
 		case OP_DIVI:
 			EmitString("8B 44 9F FC");			// mov eax,dword ptr -4[edi + ebx * 4]
@@ -1513,31 +1540,35 @@ void VM_Compile(vm_t *vm, vmHeader_t *header)
 			EmitCommand(LAST_COMMAND_SUB_BL_1);		// sub bl, 1
 			break;
 		case OP_MULI:
-			EmitString("8B 44 9F FC");			// mov eax,dword ptr -4[edi + ebx * 4]
-			EmitString("F7 2C 9F");				// imul dword ptr [edi + ebx * 4]
-			EmitString("89 44 9F FC");			// mov dword ptr -4[edi + ebx * 4],eax
+			EmitMovEAXStack(vm, 0);				// mov eax, dword ptr [edi + ebx * 4]
+			EmitString("0F AF 44 9F FC");			// imul eax, dword ptr -4[edi + ebx * 4]
 			EmitCommand(LAST_COMMAND_SUB_BL_1);		// sub bl, 1
+			EmitCommand(LAST_COMMAND_MOV_STACK_EAX);	// mov dword ptr [edi + ebx * 4], eax
 			break;
 		case OP_MULU:
-			EmitString("8B 44 9F FC");			// mov eax,dword ptr -4[edi + ebx * 4]
-			EmitString("F7 24 9F");				// mul dword ptr [edi + ebx * 4]
-			EmitString("89 44 9F FC");			// mov dword ptr -4[edi + ebx * 4],eax
+			// the low 32 bits of the product are the same signed or unsigned
+			EmitMovEAXStack(vm, 0);				// mov eax, dword ptr [edi + ebx * 4]
+			EmitString("0F AF 44 9F FC");			// imul eax, dword ptr -4[edi + ebx * 4]
 			EmitCommand(LAST_COMMAND_SUB_BL_1);		// sub bl, 1
+			EmitCommand(LAST_COMMAND_MOV_STACK_EAX);	// mov dword ptr [edi + ebx * 4], eax
 			break;
 		case OP_BAND:
 			EmitMovEAXStack(vm, 0);				// mov eax, dword ptr [edi + ebx * 4]
-			EmitString("21 44 9F FC");			// and dword ptr -4[edi + ebx * 4],eax
+			EmitString("23 44 9F FC");			// and eax, dword ptr -4[edi + ebx * 4]
 			EmitCommand(LAST_COMMAND_SUB_BL_1);		// sub bl, 1
+			EmitCommand(LAST_COMMAND_MOV_STACK_EAX);	// mov dword ptr [edi + ebx * 4], eax
 			break;
 		case OP_BOR:
 			EmitMovEAXStack(vm, 0);				// mov eax, dword ptr [edi + ebx * 4]
-			EmitString("09 44 9F FC");			// or dword ptr -4[edi + ebx * 4],eax
+			EmitString("0B 44 9F FC");			// or eax, dword ptr -4[edi + ebx * 4]
 			EmitCommand(LAST_COMMAND_SUB_BL_1);		// sub bl, 1
+			EmitCommand(LAST_COMMAND_MOV_STACK_EAX);	// mov dword ptr [edi + ebx * 4], eax
 			break;
 		case OP_BXOR:
 			EmitMovEAXStack(vm, 0);				// mov eax, dword ptr [edi + ebx * 4]
-			EmitString("31 44 9F FC");			// xor dword ptr -4[edi + ebx * 4],eax
+			EmitString("33 44 9F FC");			// xor eax, dword ptr -4[edi + ebx * 4]
 			EmitCommand(LAST_COMMAND_SUB_BL_1);		// sub bl, 1
+			EmitCommand(LAST_COMMAND_MOV_STACK_EAX);	// mov dword ptr [edi + ebx * 4], eax
 			break;
 		case OP_BCOM:
 			EmitString("F7 14 9F");				// not dword ptr [edi + ebx * 4]
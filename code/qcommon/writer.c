@@ -0,0 +1,271 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// writer.c -- log files and console output written off the main thread
+
+// qconsole.log, the logs the game module appends to and the dedicated
+// console's output when it isn't a terminal are handed to a writer thread
+// through a fixed ring, so a slow disk or pipe doesn't stall the frame.
+// The main thread is the only one that adds to the ring and the writer the
+// only one that takes from it, each moving its own position once the
+// record is complete, so neither ever waits on the other's lock.  When the
+// ring is full com_logAsync 1 waits for room and 2 drops the write, noting
+// how many went missing in the file of the last one dropped.  Anything that
+// seeks, flushes or closes a file waits for the ring to empty first.
+
+#include "q_shared.h"
+#include "qcommon.h"
+
+#define	WRITER_SIZE			( 512 * 1024 )
+#define	WRITER_ALIGN		16
+#define	WRITER_MAX_WRITE	( WRITER_SIZE / 4 )		// larger ones are written on the spot
+
+typedef struct {
+	FILE		*file;			// NULL to go on at the start of the ring
+	int			length;
+	qboolean	sync;			// flush once written
+} writerRecord_t;
+
+static struct {
+	void			*thread;
+	void			*wake;
+	volatile int	shutdown;
+
+	volatile int	readPos;		// moved by the writer
+	volatile int	writePos;		// moved by the main thread
+	int				dropped;
+	FILE			*droppedFile;	// the note goes here
+
+	byte			ring[WRITER_SIZE];
+} writer;
+
+cvar_t	*com_logAsync;
+
+#define	WRITER_RECORD_SIZE( length )	PAD( sizeof( writerRecord_t ) + ( length ), WRITER_ALIGN )
+
+/*
+=================
+Com_WriterThread
+=================
+*/
+static void Com_WriterThread( void *arg ) {
+	writerRecord_t	*record;
+	int				readPos, writePos;
+
+	while ( 1 ) {
+		readPos = writer.readPos;
+		writePos = Sys_AtomicAdd( &writer.writePos, 0 );
+
+		if ( readPos == writePos ) {
+			if ( writer.shutdown ) {
+				break;
+			}
+			Sys_WaitSemaphore( writer.wake );
+			continue;
+		}
+
+		record = (writerRecord_t *)( writer.ring + readPos );
+		if ( !record->file ) {
+			Sys_AtomicAdd( &writer.readPos, -readPos );
+			continue;
+		}
+
+		fwrite( record + 1, 1, record->length, record->file );
+		if ( record->sync ) {
+			fflush( record->file );
+		}
+
+		Sys_AtomicAdd( &writer.readPos, WRITER_RECORD_SIZE( record->length ) );
+	}
+}
+
+/*
+=================
+Com_WriterActive
+=================
+*/
+static qboolean Com_WriterActive( void ) {
+	return ( writer.thread && com_logAsync && com_logAsync->integer ) ? qtrue : qfalse;
+}
+
+/*
+=================
+Com_FlushWriter
+
+Returns once everything queued has been written
+=================
+*/
+void Com_FlushWriter( void ) {
+	if ( !writer.thread ) {
+		return;
+	}
+
+	while ( Sys_AtomicAdd( &writer.readPos, 0 ) != writer.writePos ) {
+		Sys_Yield();
+	}
+
+	// the file may be about to close
+	if ( writer.dropped && !Com_JobThread() ) {
+		fprintf( writer.droppedFile, "[%i log writes dropped]\n", writer.dropped );
+		writer.dropped = 0;
+	}
+}
+
+/*
+=================
+Com_WriterSpace
+
+Where a record of size bytes can go, or -1 while the ring is too full
+=================
+*/
+static int Com_WriterSpace( int size ) {
+	int		readPos = Sys_AtomicAdd( &writer.readPos, 0 );
+	int		writePos = writer.writePos;
+
+	// the positions must never meet from this side, that is empty
+	if ( writePos >= readPos ) {
+		if ( writePos + size < WRITER_SIZE ) {
+			return writePos;
+		}
+		if ( size < readPos ) {
+			return 0;
+		}
+	} else if ( writePos + size < readPos ) {
+		return writePos;
+	}
+
+	return -1;
+}
+
+/*
+=================
+Com_QueueRecord
+=================
+*/
+static void Com_QueueRecord( FILE *file, const void *data, int length, qboolean sync, int pos ) {
+	writerRecord_t	*record;
+	int				writePos = writer.writePos;
+	qboolean		wasEmpty;
+
+	if ( pos != writePos ) {
+		// the rest of the ring is skipped
+		record = (writerRecord_t *)( writer.ring + writePos );
+		record->file = NULL;
+		record->length = 0;
+	}
+
+	record = (writerRecord_t *)( writer.ring + pos );
+	record->file = file;
+	record->length = length;
+	record->sync = sync;
+	Com_Memcpy( record + 1, data, length );
+
+	// publish it, then see if the writer may have gone to sleep
+	Sys_AtomicAdd( &writer.writePos, pos + WRITER_RECORD_SIZE( length ) - writePos );
+	wasEmpty = ( Sys_AtomicAdd( &writer.readPos, 0 ) == writePos );
+
+	if ( wasEmpty ) {
+		Sys_PostSemaphore( writer.wake, 1 );
+	}
+}
+
+/*
+=================
+Com_QueueWrite
+
+Hands a write to the writer thread.  Returns qfalse when the caller
+should write it itself, with everything queued before already written.
+Main thread only.
+=================
+*/
+qboolean Com_QueueWrite( FILE *file, const void *data, int length, qboolean sync ) {
+	char	note[64];
+	int		pos;
+
+	if ( !Com_WriterActive() || length > WRITER_MAX_WRITE || Com_JobThread() ) {
+		Com_FlushWriter();
+		return qfalse;
+	}
+
+	if ( writer.dropped ) {
+		Com_sprintf( note, sizeof( note ), "[%i log writes dropped]\n", writer.dropped );
+		pos = Com_WriterSpace( WRITER_RECORD_SIZE( strlen( note ) ) );
+		if ( pos >= 0 ) {
+			Com_QueueRecord( writer.droppedFile, note, strlen( note ), qfalse, pos );
+			writer.dropped = 0;
+		}
+	}
+
+	while ( ( pos = Com_WriterSpace( WRITER_RECORD_SIZE( length ) ) ) < 0 ) {
+		if ( com_logAsync->integer > 1 ) {
+			writer.dropped++;
+			writer.droppedFile = file;
+			return qtrue;
+		}
+		Sys_Yield();
+	}
+
+	Com_QueueRecord( file, data, length, sync, pos );
+	return qtrue;
+}
+
+/*
+=================
+Com_InitWriter
+=================
+*/
+void Com_InitWriter( void ) {
+	com_logAsync = Cvar_Get( "com_logAsync", "1", CVAR_ARCHIVE );
+	Cvar_SetDescription( com_logAsync, "Write log files and console output on a thread of their own, 2 drops writes instead of waiting when it falls behind" );
+
+	writer.wake = Sys_CreateSemaphore();
+	if ( !writer.wake ) {
+		return;
+	}
+
+	writer.thread = Sys_CreateThread( Com_WriterThread, NULL );
+	if ( !writer.thread ) {
+		Sys_DestroySemaphore( writer.wake );
+		writer.wake = NULL;
+	}
+}
+
+/*
+=================
+Com_ShutdownWriter
+=================
+*/
+void Com_ShutdownWriter( void ) {
+	if ( !writer.thread ) {
+		return;
+	}
+
+	writer.shutdown = qtrue;
+	Sys_PostSemaphore( writer.wake, 1 );
+	Sys_JoinThread( writer.thread );
+	Sys_DestroySemaphore( writer.wake );
+
+	writer.thread = NULL;
+	writer.wake = NULL;
+	writer.shutdown = qfalse;
+	writer.readPos = writer.writePos = 0;
+	writer.dropped = 0;
+}
@@ -35,6 +35,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 extern void (APIENTRYP qglActiveTextureARB) (GLenum texture);
 extern void (APIENTRYP qglClientActiveTextureARB) (GLenum texture);
 extern void (APIENTRYP qglMultiTexCoord2fARB) (GLenum target, GLfloat s, GLfloat t);
+extern void (APIENTRYP qglCompressedTexImage2DARB) (GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void *data);
 
 extern void (APIENTRYP qglLockArraysEXT) (GLint first, GLsizei count);
 extern void (APIENTRYP qglUnlockArraysEXT) (void);
@@ -185,6 +186,7 @@ extern void (APIENTRYP qglUnlockArraysEXT) (void);
 	GLE(void, Uniform4f, GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) \
 	GLE(void, Uniform1i, GLint location, GLint v0) \
 	GLE(void, Uniform1fv, GLint location, GLsizei count, const GLfloat *value) \
+	GLE(void, Uniform4fv, GLint location, GLsizei count, const GLfloat *value) \
 	GLE(void, UniformMatrix4fv, GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) \
 	GLE(void, ValidateProgram, GLuint program) \
 	GLE(void, VertexAttribPointer, GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer) \
@@ -263,6 +265,91 @@ extern void (APIENTRYP qglUnlockArraysEXT) (void);
 	GLE(void, DeleteVertexArrays, GLsizei n, const GLuint *arrays) \
 	GLE(void, GenVertexArrays, GLsizei n, GLuint *arrays) \
 
+// GL_ARB_map_buffer_range, built-in to OpenGL 3.0
+#define QGL_ARB_map_buffer_range_PROCS \
+	GLE(void *, MapBufferRange, GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) \
+	GLE(GLboolean, UnmapBuffer, GLenum target) \
+
+// GL_ARB_sync, built-in to OpenGL 3.2
+#define QGL_ARB_sync_PROCS \
+	GLE(GLsync, FenceSync, GLenum condition, GLbitfield flags) \
+	GLE(GLenum, ClientWaitSync, GLsync sync, GLbitfield flags, GLuint64 timeout) \
+	GLE(void, DeleteSync, GLsync sync) \
+
+// GL_EXT_multi_draw_arrays, built-in to OpenGL 1.4 but not OpenGL ES
+#define QGL_EXT_multi_draw_arrays_PROCS \
+	GLE(void, MultiDrawElements, GLenum mode, const GLsizei *count, GLenum type, const void *const *indices, GLsizei drawcount) \
+
+// GL_ARB_multi_draw_indirect, built-in to OpenGL 4.3
+#define QGL_ARB_multi_draw_indirect_PROCS \
+	GLE(void, MultiDrawElementsIndirect, GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride) \
+
+#ifndef GL_ARB_draw_indirect
+#define GL_ARB_draw_indirect
+#define GL_DRAW_INDIRECT_BUFFER                       0x8F3F
+#endif
+
+// GL_ARB_buffer_storage, built-in to OpenGL 4.4
+#define QGL_ARB_buffer_storage_PROCS \
+	GLE(void, BufferStorage, GLenum target, GLsizeiptr size, const void *data, GLbitfield flags) \
+
+#ifndef GL_ARB_buffer_storage
+#define GL_ARB_buffer_storage
+#define GL_MAP_PERSISTENT_BIT                         0x0040
+#define GL_MAP_COHERENT_BIT                           0x0080
+#endif
+
+// GL_ARB_get_program_binary, built-in to OpenGL 4.1
+#define QGL_ARB_get_program_binary_PROCS \
+	GLE(void, GetProgramBinary, GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary) \
+	GLE(void, ProgramBinary, GLuint program, GLenum binaryFormat, const void *binary, GLsizei length) \
+	GLE(void, ProgramParameteri, GLuint program, GLenum pname, GLint value) \
+
+#ifndef GL_ARB_get_program_binary
+#define GL_ARB_get_program_binary
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT            0x8257
+#define GL_PROGRAM_BINARY_LENGTH                      0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS                 0x87FE
+#endif
+
+// GL_ARB_uniform_buffer_object, built-in to OpenGL 3.1
+#define QGL_ARB_uniform_buffer_object_PROCS \
+	GLE(GLuint, GetUniformBlockIndex, GLuint program, const GLchar *uniformBlockName) \
+	GLE(void, UniformBlockBinding, GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding) \
+	GLE(void, BindBufferRange, GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) \
+
+#ifndef GL_ARB_uniform_buffer_object
+#define GL_ARB_uniform_buffer_object
+#define GL_UNIFORM_BUFFER                             0x8A11
+#define GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT            0x8A34
+#define GL_INVALID_INDEX                              0xFFFFFFFFu
+#endif
+
+// GL_ARB_multi_bind, built-in to OpenGL 4.4
+#define QGL_ARB_multi_bind_PROCS \
+	GLE(void, BindTextures, GLuint first, GLsizei count, const GLuint *textures) \
+
+// GL_ARB_timer_query, built-in to OpenGL 3.3
+#define QGL_ARB_timer_query_PROCS \
+	GLE(void, QueryCounter, GLuint id, GLenum target) \
+	GLE(void, GetQueryObjectui64v, GLuint id, GLenum pname, GLuint64 *params) \
+
+#ifndef GL_ARB_timer_query
+#define GL_ARB_timer_query
+#define GL_TIME_ELAPSED                               0x88BF
+#define GL_TIMESTAMP                                  0x8E28
+#endif
+
+// GL_KHR_parallel_shader_compile
+#define QGL_KHR_parallel_shader_compile_PROCS \
+	GLE(void, MaxShaderCompilerThreadsKHR, GLuint count) \
+
+#ifndef GL_KHR_parallel_shader_compile
+#define GL_KHR_parallel_shader_compile
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR            0x91B0
+#define GL_COMPLETION_STATUS_KHR                      0x91B1
+#endif
+
 #ifndef GL_ARB_texture_compression_rgtc
 #define GL_ARB_texture_compression_rgtc
 #define GL_COMPRESSED_RED_RGTC1                       0x8DBB
@@ -306,6 +393,7 @@ extern void (APIENTRYP qglUnlockArraysEXT) (void);
 	GLE(GLvoid, ProgramUniform3fEXT, GLuint program, GLint location, GLfloat v0, GLfloat v1, GLfloat v2) \
 	GLE(GLvoid, ProgramUniform4fEXT, GLuint program, GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) \
 	GLE(GLvoid, ProgramUniform1fvEXT, GLuint program, GLint location, GLsizei count, const GLfloat *value) \
+	GLE(GLvoid, ProgramUniform4fvEXT, GLuint program, GLint location, GLsizei count, const GLfloat *value) \
 	GLE(GLvoid, ProgramUniformMatrix4fvEXT, GLuint program, GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) \
 	GLE(GLvoid, NamedRenderbufferStorageEXT, GLuint renderbuffer, GLenum internalformat, GLsizei width, GLsizei height) \
 	GLE(GLvoid, NamedRenderbufferStorageMultisampleEXT, GLuint renderbuffer, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height) \
@@ -327,6 +415,16 @@ QGL_3_0_PROCS;
 QGL_ARB_occlusion_query_PROCS;
 QGL_ARB_framebuffer_object_PROCS;
 QGL_ARB_vertex_array_object_PROCS;
+QGL_ARB_map_buffer_range_PROCS;
+QGL_ARB_sync_PROCS;
+QGL_ARB_buffer_storage_PROCS;
+QGL_EXT_multi_draw_arrays_PROCS;
+QGL_ARB_multi_draw_indirect_PROCS;
+QGL_ARB_get_program_binary_PROCS;
+QGL_ARB_uniform_buffer_object_PROCS;
+QGL_ARB_multi_bind_PROCS;
+QGL_ARB_timer_query_PROCS;
+QGL_KHR_parallel_shader_compile_PROCS;
 QGL_EXT_direct_state_access_PROCS;
 #undef GLE
 
@@ -44,6 +44,7 @@ typedef enum
 	IMGFLAG_NOLIGHTSCALE   = 0x0020,
 	IMGFLAG_CLAMPTOEDGE    = 0x0040,
 	IMGFLAG_GENNORMALMAP   = 0x0080,
+	IMGFLAG_SDF            = 0x0100,	// alpha holds a signed distance field
 } imgFlags_t;
 
 typedef struct image_s {
@@ -60,7 +61,14 @@ typedef struct image_s {
 	imgType_t   type;
 	imgFlags_t  flags;
 
+	unsigned int	contentCrc;			// pk3 content key of the file it was loaded from,
+	unsigned int	contentLength;		// 0 length when it has none
+
+	qboolean	streamed;			// reloaded from disk at other mip levels by texture streaming
+	int			streamDrop;			// mip levels currently left off the top, beyond picmip
+
 	struct image_s*	next;
+	struct image_s*	nextContent;		// next image in the content hash
 } image_t;
 
 // any change in the LIGHTMAP_* defines here MUST be reflected in
@@ -114,6 +122,7 @@ extern cvar_t *r_ext_max_anisotropy;
 extern cvar_t *r_stereoEnabled;
 
 extern	cvar_t	*r_saveFontData;
+extern	cvar_t	*r_fontSDF;
 
 qboolean	R_GetModeInfo( int *width, int *height, float *windowAspect, int mode );
 
@@ -122,6 +131,7 @@ void  R_NoiseInit( void );
 
 image_t     *R_FindImageFile( const char *name, imgType_t type, imgFlags_t flags );
 image_t *R_CreateImage( const char *name, byte *pic, int width, int height, imgType_t type, imgFlags_t flags, int internalFormat );
+void R_LoadImage( const char *name, byte **pic, int *width, int *height, GLenum *picFormat, int *numMips );
 
 void R_IssuePendingRenderCommands( void );
 qhandle_t		 RE_RegisterShaderLightMap( const char *name, int lightmapIndex );
@@ -160,6 +170,7 @@ IMPLEMENTATION SPECIFIC FUNCTIONS
 void		GLimp_Init( qboolean fixedFunction );
 void		GLimp_Shutdown( void );
 void		GLimp_EndFrame( void );
+void		GLimp_CheckFullscreen( void );
 
 void		GLimp_LogComment( char *comment );
 void		GLimp_Minimize(void);
@@ -168,5 +179,23 @@ void		GLimp_SetGamma( unsigned char red[256],
 		unsigned char green[256],
 		unsigned char blue[256] );
 
+// the render thread owns the GL context while it runs a command list,
+// the front end must call GLimp_FrontEndSleep before any GL call
+qboolean	GLimp_SpawnRenderThread( void (*function)( void ) );
+void		GLimp_ShutdownRenderThread( void );
+void		*GLimp_RendererSleep( void );
+void		GLimp_FrontEndSleep( void );
+void		GLimp_WakeRenderer( void *data );
+
+// worker threads for CPU work that never touches GL, all sharing one
+// recursive lock and one condition variable
+int			GLimp_SpawnWorkers( int count, void (*function)( int worker ) );
+void		GLimp_ShutdownWorkers( void );
+int			GLimp_WorkerIndex( void );
+void		GLimp_LockWorkers( void );
+void		GLimp_UnlockWorkers( void );
+void		GLimp_WaitWorkers( void );
+void		GLimp_WakeWorkers( void );
+
 
 #endif
@@ -330,6 +330,176 @@ float readFloat( void ) {
 	return me.ffred;
 }
 
+/*
+Signed distance field glyph pages
+
+With r_fontSDF the coverage of each glyph page is turned into a distance
+field, 0.5 on the glyph edge and FONT_SDF_SPREAD texels to either side, so
+the renderer can rebuild a sharp edge at any scale from the one atlas.  The
+fields are written to cache/<page>.sdf and reused while the checksum of the
+source page still matches.
+*/
+#define FONT_SDF_IDENT		(('F'<<24)+('D'<<16)+('S'<<8)+'F')
+#define FONT_SDF_VERSION	1
+#define FONT_SDF_SPREAD		4
+#define FONT_SDF_POINTSIZE	48
+
+typedef struct {
+	int			ident;
+	int			version;
+	unsigned	checksum;
+	int			width;
+	int			height;
+} fontSdfHeader_t;
+
+static unsigned R_FontChecksum( unsigned hash, const void *data, int len ) {
+	const byte *p = data;
+
+	while ( len-- > 0 ) {
+		hash ^= *p++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static void R_BuildGlyphSDF( const byte *pic, byte *field, int width, int height ) {
+	int x, y, dx, dy;
+
+	for ( y = 0; y < height; y++ ) {
+		for ( x = 0; x < width; x++ ) {
+			int      a = pic[( y * width + x ) * 4 + 3];
+			qboolean inside = a >= 128;
+			float    best = FONT_SDF_SPREAD;
+			float    dist;
+
+			// partially covered texels carry their own sub-texel edge
+			if ( a > 0 && a < 255 ) {
+				best = fabs( a / 255.0f - 0.5f );
+			}
+
+			for ( dy = -FONT_SDF_SPREAD; dy <= FONT_SDF_SPREAD; dy++ ) {
+				if ( y + dy < 0 || y + dy >= height )
+					continue;
+
+				for ( dx = -FONT_SDF_SPREAD; dx <= FONT_SDF_SPREAD; dx++ ) {
+					float d;
+
+					if ( x + dx < 0 || x + dx >= width )
+						continue;
+
+					if ( ( pic[( ( y + dy ) * width + x + dx ) * 4 + 3] >= 128 ) == inside )
+						continue;
+
+					d = sqrt( dx * dx + dy * dy ) - 0.5f;
+					if ( d < best )
+						best = d;
+				}
+			}
+
+			dist = inside ? best : -best;
+			field[y * width + x] = (byte)Com_Clamp( 0, 255, 127.5f + dist * 127.5f / FONT_SDF_SPREAD + 0.5f );
+		}
+	}
+}
+
+/*
+R_RegisterGlyphSDF
+
+Registers the distance field of the RGBA glyph page pic as shader name.
+*/
+static qhandle_t R_RegisterGlyphSDF( const char *name, const byte *pic, int width, int height ) {
+	fontSdfHeader_t *header;
+	char            cacheName[MAX_QPATH];
+	unsigned        checksum;
+	byte            *buffer, *field, *rgba;
+	void            *cached;
+	image_t         *image;
+	int             i, len;
+
+	checksum = R_FontChecksum( 2166136261u, &width, sizeof( width ) );
+	checksum = R_FontChecksum( checksum, &height, sizeof( height ) );
+	for ( i = 0; i < width * height; i++ ) {
+		checksum = R_FontChecksum( checksum, &pic[i * 4 + 3], 1 );
+	}
+
+	buffer = ri.Malloc( sizeof( *header ) + width * height );
+	header = (fontSdfHeader_t *)buffer;
+	field  = buffer + sizeof( *header );
+
+	Com_sprintf( cacheName, sizeof( cacheName ), "cache/%s.sdf", name );
+	len = ri.FS_ReadFile( cacheName, &cached );
+	if ( cached && len == sizeof( *header ) + width * height &&
+		((fontSdfHeader_t *)cached)->ident == FONT_SDF_IDENT && ((fontSdfHeader_t *)cached)->version == FONT_SDF_VERSION &&
+		((fontSdfHeader_t *)cached)->checksum == checksum && ((fontSdfHeader_t *)cached)->width == width &&
+		((fontSdfHeader_t *)cached)->height == height ) {
+		Com_Memcpy( field, (byte *)cached + sizeof( *header ), width * height );
+	} else {
+		R_BuildGlyphSDF( pic, field, width, height );
+
+		header->ident    = FONT_SDF_IDENT;
+		header->version  = FONT_SDF_VERSION;
+		header->checksum = checksum;
+		header->width    = width;
+		header->height   = height;
+		ri.FS_WriteFile( cacheName, buffer, sizeof( *header ) + width * height );
+	}
+
+	if ( cached ) {
+		ri.FS_FreeFile( cached );
+	}
+
+	rgba = ri.Malloc( width * height * 4 );
+	for ( i = 0; i < width * height; i++ ) {
+		rgba[i * 4 + 0] = 255;
+		rgba[i * 4 + 1] = 255;
+		rgba[i * 4 + 2] = 255;
+		rgba[i * 4 + 3] = field[i];
+	}
+
+	image = R_CreateImage( name, rgba, width, height, IMGTYPE_COLORALPHA, IMGFLAG_CLAMPTOEDGE | IMGFLAG_NO_COMPRESSION | IMGFLAG_SDF, 0 );
+
+	ri.Free( rgba );
+	ri.Free( buffer );
+
+	return RE_RegisterShaderFromImage( name, LIGHTMAP_2D, image, qfalse );
+}
+
+/*
+R_RegisterGlyphPage
+
+Registers the page behind a pre-rendered glyph, as a distance field when
+r_fontSDF is on and the page can be read back uncompressed.
+*/
+static qhandle_t R_RegisterGlyphPage( const char *shaderName ) {
+	char      name[MAX_QPATH];
+	byte      *pic;
+	int       width, height, numMips;
+	GLenum    picFormat;
+	qhandle_t h;
+
+	if ( !r_fontSDF || !r_fontSDF->integer ) {
+		return RE_RegisterShaderNoMip( shaderName );
+	}
+
+	R_LoadImage( shaderName, &pic, &width, &height, &picFormat, &numMips );
+	if ( !pic ) {
+		return RE_RegisterShaderNoMip( shaderName );
+	}
+
+	if ( picFormat != GL_RGBA8 ) {
+		ri.Free( pic );
+		return RE_RegisterShaderNoMip( shaderName );
+	}
+
+	COM_StripExtension( shaderName, name, sizeof( name ) );
+	Q_strcat( name, sizeof( name ), "_sdf" );
+	h = R_RegisterGlyphSDF( name, pic, width, height );
+	ri.Free( pic );
+
+	return h;
+}
+
 void RE_RegisterFont(const char *fontName, int pointSize, fontInfo_t *font) {
 #ifdef BUILD_FREETYPE
 	FT_Face face;
@@ -342,6 +512,7 @@ void RE_RegisterFont(const char *fontName, int pointSize, fontInfo_t *font) {
 	float max;
 	float dpi = 72;
 	float glyphScale;
+	qboolean sdf;
 #endif
 	void *faceData;
 	int i, len;
@@ -417,7 +588,18 @@ void RE_RegisterFont(const char *fontName, int pointSize, fontInfo_t *font) {
 //		Com_Memcpy(font, faceData, sizeof(fontInfo_t));
 		Q_strncpyz(font->name, name, sizeof(font->name));
 		for (i = GLYPH_START; i <= GLYPH_END; i++) {
-			font->glyphs[i].glyph = RE_RegisterShaderNoMip(font->glyphs[i].shaderName);
+			int j;
+
+			// glyphs share a handful of pages, only build each one once
+			for (j = GLYPH_START; j < i; j++) {
+				if (!Q_stricmp(font->glyphs[j].shaderName, font->glyphs[i].shaderName))
+					break;
+			}
+
+			if (j < i)
+				font->glyphs[i].glyph = font->glyphs[j].glyph;
+			else
+				font->glyphs[i].glyph = R_RegisterGlyphPage(font->glyphs[i].shaderName);
 		}
 		Com_Memcpy(&registeredFont[registeredFontCount++], font, sizeof(fontInfo_t));
 		ri.FS_FreeFile(faceData);
@@ -432,6 +614,23 @@ void RE_RegisterFont(const char *fontName, int pointSize, fontInfo_t *font) {
 		return;
 	}
 
+	sdf = r_fontSDF && r_fontSDF->integer;
+	if (sdf) {
+		// one distance field atlas serves every point size, glyphScale
+		// brings its metrics back to the size the ui expects
+		for (i = 0; i < registeredFontCount; i++) {
+			if (!Q_stricmpn(registeredFont[i].glyphs[GLYPH_START].shaderName, "fonts/fontImage_sdf_", 20)) {
+				Com_Memcpy(font, &registeredFont[i], sizeof(fontInfo_t));
+				Q_strncpyz(font->name, name, sizeof(font->name));
+				Com_Memcpy(&registeredFont[registeredFontCount++], font, sizeof(fontInfo_t));
+				return;
+			}
+		}
+
+		Q_strncpyz(font->name, name, sizeof(font->name));
+		pointSize = FONT_SDF_POINTSIZE;
+	}
+
 	len = ri.FS_ReadFile(fontName, &faceData);
 	if (len <= 0) {
 		ri.Printf(PRINT_WARNING, "RE_RegisterFont: Unable to read font file '%s'\n", fontName);
@@ -511,14 +710,19 @@ void RE_RegisterFont(const char *fontName, int pointSize, fontInfo_t *font) {
 				imageBuff[left++] = ((float)out[k] * max);
 			}
 
-			Com_sprintf (name, sizeof(name), "fonts/fontImage_%i_%i.tga", imageNumber++, pointSize);
-			if (r_saveFontData->integer) { 
-				WriteTGA(name, imageBuff, 256, 256);
-			}
+			if (sdf) {
+				Com_sprintf (name, sizeof(name), "fonts/fontImage_sdf_%i", imageNumber++);
+				h = R_RegisterGlyphSDF(name, imageBuff, 256, 256);
+			} else {
+				Com_sprintf (name, sizeof(name), "fonts/fontImage_%i_%i.tga", imageNumber++, pointSize);
+				if (r_saveFontData->integer) { 
+					WriteTGA(name, imageBuff, 256, 256);
+				}
 
-			//Com_sprintf (name, sizeof(name), "fonts/fontImage_%i_%i", imageNumber++, pointSize);
-			image = R_CreateImage(name, imageBuff, 256, 256, IMGTYPE_COLORALPHA, IMGFLAG_CLAMPTOEDGE, 0 );
-			h = RE_RegisterShaderFromImage(name, LIGHTMAP_2D, image, qfalse);
+				//Com_sprintf (name, sizeof(name), "fonts/fontImage_%i_%i", imageNumber++, pointSize);
+				image = R_CreateImage(name, imageBuff, 256, 256, IMGTYPE_COLORALPHA, IMGFLAG_CLAMPTOEDGE, 0 );
+				h = RE_RegisterShaderFromImage(name, LIGHTMAP_2D, image, qfalse);
+			}
 			for (j = lastStart; j < i; j++) {
 				font->glyphs[j].glyph = h;
 				Q_strncpyz(font->glyphs[j].shaderName, name, sizeof(font->glyphs[j].shaderName));
@@ -546,7 +750,8 @@ void RE_RegisterFont(const char *fontName, int pointSize, fontInfo_t *font) {
 	font->glyphScale = glyphScale;
 	Com_Memcpy(&registeredFont[registeredFontCount++], font, sizeof(fontInfo_t));
 
-	if (r_saveFontData->integer) {
+	// saved .dat files must point at coverage pages, not distance fields
+	if (r_saveFontData->integer && !sdf) {
 		ri.FS_WriteFile(va("fonts/fontImage_%i.dat", pointSize), font, sizeof(fontInfo_t));
 	}
 
@@ -24,7 +24,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "tr_types.h"
 
-#define	REF_API_VERSION		8
+#define	REF_API_VERSION		12
 
 //
 // these are the functions exported by the refresh module
@@ -72,6 +72,9 @@ typedef struct {
 	void	(*SetColor)( const float *rgba );	// NULL = 1,1,1,1
 	void	(*DrawStretchPic) ( float x, float y, float w, float h, 
 		float s1, float t1, float s2, float t2, qhandle_t hShader );	// 0 = white
+	// draws a run of pics, switching color only where it changes, and
+	// leaves the current color set to that of the last pic
+	void	(*DrawStretchPics) ( int numPics, const stretchPic_t *pics );
 
 	// Draw images for cinematic rendering, pass as 32 bit rgba
 	void	(*DrawStretchRaw) (int x, int y, int w, int h, int cols, int rows, const byte *data, int client, qboolean dirty);
@@ -115,6 +118,10 @@ typedef struct {
 	// for anything game related.  Get time from the refdef
 	int		(*Milliseconds)( void );
 
+	// timing zones for the profile command, free when it isn't recording
+	void	(*ProfileBegin)( const char *name );
+	void	(*ProfileEnd)( void );
+
 	// stack based memory allocation for per-level things that
 	// won't be freed
 #ifdef HUNK_DEBUG
@@ -129,6 +136,9 @@ typedef struct {
 	void	*(*Malloc)( int bytes );
 	void	(*Free)( void *buf );
 
+	// current byte count of a counter shown by "memstats"
+	void	(*MemStatSet)( const char *name, int bytes );
+
 	cvar_t	*(*Cvar_Get)( const char *name, const char *value, int flags );
 	void	(*Cvar_Set)( const char *name, const char *value );
 	void	(*Cvar_SetValue) (const char *name, float value);
@@ -146,6 +156,7 @@ typedef struct {
 	void	(*Cmd_ExecuteText) (int exec_when, const char *text);
 
 	byte	*(*CM_ClusterPVS)(int cluster);
+	int		(*CM_LeafArea)(int leafnum);
 
 	// visualization for debugging collision detection
 	void	(*CM_DrawDebugSurface)( void (*drawPoly)(int color, int numPoints, float *points) );
@@ -155,6 +166,12 @@ typedef struct {
 	int		(*FS_FileIsInPAK)( const char *name, int *pCheckSum );
 	long		(*FS_ReadFile)( const char *name, void **buf );
 	void	(*FS_FreeFile)( void *buf );
+	// mapped views have no trailing 0 and go back through FS_UnmapFile
+	long	(*FS_MapFile)( const char *name, void **buf );
+	void	(*FS_UnmapFile)( void *buf );
+	// 1 with the zip directory crc and size of the file, 0 for a file on
+	// disk, -1 if it doesn't exist
+	int		(*FS_FileContentKey)( const char *name, unsigned int *crc, unsigned int *length );
 	char **	(*FS_ListFiles)( const char *name, const char *extension, int *numfilesfound );
 	void	(*FS_FreeFileList)( char **filelist );
 	void	(*FS_WriteFile)( const char *qpath, const void *buffer, int size );
@@ -65,6 +65,14 @@ typedef struct {
 	byte		modulate[4];
 } polyVert_t;
 
+// one quad of a DrawStretchPics call, in screen coordinates
+typedef struct {
+	float		x, y, w, h;
+	float		s1, t1, s2, t2;
+	float		color[4];
+	qhandle_t	hShader;
+} stretchPic_t;
+
 typedef struct poly_s {
 	qhandle_t			hShader;
 	int					numVerts;
@@ -213,7 +221,7 @@ typedef struct {
 	// used CDS.
 	qboolean				isFullscreen;
 	qboolean				stereoEnabled;
-	qboolean				smpActive;		// UNUSED, present for compatibility
+	qboolean				smpActive;		// the renderer back end runs in its own thread
 } glconfig_t;
 
 #endif	// __TR_TYPES_H
@@ -403,8 +403,13 @@ static void SetViewportAndScissor( void ) {
 	// set the window clipping
 	qglViewport( backEnd.viewParms.viewportX, backEnd.viewParms.viewportY, 
 		backEnd.viewParms.viewportWidth, backEnd.viewParms.viewportHeight );
-	qglScissor( backEnd.viewParms.viewportX, backEnd.viewParms.viewportY, 
-		backEnd.viewParms.viewportWidth, backEnd.viewParms.viewportHeight );
+	if ( backEnd.viewParms.scissorWidth ) {
+		qglScissor( backEnd.viewParms.scissorX, backEnd.viewParms.scissorY,
+			backEnd.viewParms.scissorWidth, backEnd.viewParms.scissorHeight );
+	} else {
+		qglScissor( backEnd.viewParms.viewportX, backEnd.viewParms.viewportY, 
+			backEnd.viewParms.viewportWidth, backEnd.viewParms.viewportHeight );
+	}
 }
 
 /*
@@ -495,6 +500,23 @@ void RB_BeginDrawingView (void) {
 }
 
 
+/*
+==================
+RB_BatchSurface
+
+A batch drawn from tr.worldVbo holds no client vertexes, so other
+surface types have to start a batch of their own.
+==================
+*/
+static void RB_BatchSurface( surfaceType_t *surface ) {
+	if ( tess.useWorldVbo && *surface != SF_TRIANGLES ) {
+		RB_EndSurface();
+		RB_BeginSurface( tess.shader, tess.fogNum );
+	}
+
+	rb_surfaceTable[ *surface ]( surface );
+}
+
 /*
 ==================
 RB_RenderDrawSurfList
@@ -533,7 +555,7 @@ void RB_RenderDrawSurfList( drawSurf_t *drawSurfs, int numDrawSurfs ) {
 	for (i = 0, drawSurf = drawSurfs ; i < numDrawSurfs ; i++, drawSurf++) {
 		if ( drawSurf->sort == (unsigned)oldSort ) {
 			// fast path, same as previous sort
-			rb_surfaceTable[ *drawSurf->surface ]( drawSurf->surface );
+			RB_BatchSurface( drawSurf->surface );
 			continue;
 		}
 		oldSort = (int)drawSurf->sort;
@@ -653,7 +675,7 @@ void RB_RenderDrawSurfList( drawSurf_t *drawSurfs, int numDrawSurfs ) {
 		}
 
 		// add the triangles for this surface
-		rb_surfaceTable[ *drawSurf->surface ]( drawSurf->surface );
+		RB_BatchSurface( drawSurf->surface );
 	}
 
 	backEnd.refdef.floatTime = originalTime;
@@ -1106,6 +1128,7 @@ RB_ExecuteRenderCommands
 void RB_ExecuteRenderCommands( const void *data ) {
 	int		t1, t2;
 
+	ri.ProfileBegin( "RB_ExecuteRenderCommands" );
 	t1 = ri.Milliseconds ();
 
 	while ( 1 ) {
@@ -1144,6 +1167,7 @@ void RB_ExecuteRenderCommands( const void *data ) {
 			// stop rendering
 			t2 = ri.Milliseconds ();
 			backEnd.pc.msec = t2 - t1;
+			ri.ProfileEnd();
 			return;
 		}
 	}
@@ -238,6 +238,51 @@ static void R_LoadCod1Surfaces( const byte *base ) {
 	}
 }
 
+/* -------------------------------------------------------------------------
+   World vertex buffer – every soup's verts uploaded once, back to back.
+   Surfaces keep their client copy for shaders that have to rewrite
+   vertexes each frame; static ones only rebase their indexes.
+   ------------------------------------------------------------------------- */
+static void R_CreateCod1WorldVbo( void ) {
+	srfTriangles_t *tri;
+	int  numVerts, i;
+
+	if ( !r_worldVBO->integer || !qglBindBuffer ) {
+		return;
+	}
+
+	numVerts = 0;
+	for ( i = 0; i < s_worldData.numsurfaces; i++ ) {
+		tri = (srfTriangles_t *)s_worldData.surfaces[i].data;
+		numVerts += tri->numVerts;
+	}
+	if ( !numVerts ) {
+		return;
+	}
+
+	qglGenBuffers( 1, &tr.worldVbo );
+	qglBindBuffer( GL_ARRAY_BUFFER, tr.worldVbo );
+	qglBufferData( GL_ARRAY_BUFFER, numVerts * sizeof( drawVert_t ), NULL, GL_STATIC_DRAW );
+
+	numVerts = 0;
+	for ( i = 0; i < s_worldData.numsurfaces; i++ ) {
+		tri = (srfTriangles_t *)s_worldData.surfaces[i].data;
+		if ( !tri->numVerts ) {
+			continue;
+		}
+		qglBufferSubData( GL_ARRAY_BUFFER, numVerts * sizeof( drawVert_t ),
+			tri->numVerts * sizeof( drawVert_t ), tri->verts );
+		tri->inWorldVbo     = qtrue;
+		tri->vboFirstVertex = numVerts;
+		numVerts += tri->numVerts;
+	}
+
+	qglBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	ri.Printf( PRINT_ALL, "...%d vertexes in the world vertex buffer (%d KB)\n",
+		numVerts, (int)( numVerts * sizeof( drawVert_t ) / 1024 ) );
+}
+
 /* -------------------------------------------------------------------------
    Marksurfaces – lump 13 contains int32 TriangleSoup indices.
    Each entry maps a "leaf surface slot" to a surface in s_worldData.surfaces.
@@ -319,7 +364,9 @@ static void R_LoadCod1NodesAndLeafs( const byte *base ) {
 		out->maxs[0] = out->maxs[1] = out->maxs[2] =  MAX_WORLD_COORD;
 
 		out->cluster = LittleLong( leaf_in->cluster );
-		out->area    = LittleLong( leaf_in->area );
+		/* areas are rebuilt from the cells by the collision map, which
+		   the snapshot areamask refers to */
+		out->area    = ri.CM_LeafArea( i );
 
 		if ( out->cluster >= s_worldData.numClusters )
 			s_worldData.numClusters = out->cluster + 1;
@@ -334,25 +381,60 @@ static void R_LoadCod1NodesAndLeafs( const byte *base ) {
 }
 
 /* -------------------------------------------------------------------------
-   Visibility – CoD1 vis format is not yet fully understood.
-   For now mark everything visible (all clusters see each other).
+   Visibility – lump 28.
+
+   The CoD1 vis lump uses the Q3 layout: numClusters, clusterBytes, then one
+   uncompressed bit row per cluster.  Everything is marked visible only when
+   the lump is missing or does not cover the clusters referenced by leafs.
    ------------------------------------------------------------------------- */
 static void R_LoadVisibilityCod1( const byte *base ) {
-	int len;
+	lump_t      l = R_GetCod1Lump( base, COD1_LUMP_VISIBILITY );
+	const byte *buf;
+	int         len, numClusters, clusterBytes;
+	byte       *vis;
+
+	if ( l.filelen >= 8 ) {
+		buf          = base + l.fileofs;
+		numClusters  = LittleLong( ( (const int *)buf )[0] );
+		clusterBytes = LittleLong( ( (const int *)buf )[1] );
+
+		if ( numClusters > 0 && numClusters >= s_worldData.numClusters &&
+			clusterBytes >= ( numClusters + 7 ) >> 3 &&
+			numClusters <= ( l.filelen - 8 ) / clusterBytes ) {
+			s_worldData.numClusters  = numClusters;
+			s_worldData.clusterBytes = clusterBytes;
+
+			if ( tr.externalVisData ) {
+				s_worldData.vis = tr.externalVisData;
+			} else {
+				vis = ri.Hunk_Alloc( numClusters * clusterBytes, h_low );
+				Com_Memcpy( vis, buf + 8, numClusters * clusterBytes );
+				s_worldData.vis = vis;
+			}
+
+			len = ( numClusters + 63 ) & ~63;
+			s_worldData.novis = ri.Hunk_Alloc( len, h_low );
+			Com_Memset( s_worldData.novis, 0xff, len );
+			return;
+		}
+
+		ri.Printf( PRINT_WARNING, "WARNING: R_LoadVisibilityCod1: bad vis lump (%d clusters, %d bytes per cluster)\n",
+			numClusters, clusterBytes );
+	}
 
-	/* numClusters set by R_LoadCod1NodesAndLeafs */
+	/* No usable vis data: all clusters visible from all clusters.
+	   numClusters was set by R_LoadCod1NodesAndLeafs */
 	len = ( s_worldData.numClusters + 63 ) & ~63;
 	s_worldData.novis = ri.Hunk_Alloc( len, h_low );
 	Com_Memset( s_worldData.novis, 0xff, len );
 
-	/* For now, all clusters visible from all clusters */
 	s_worldData.numClusters  = s_worldData.numClusters  ? s_worldData.numClusters  : 1;
 	s_worldData.clusterBytes = ( s_worldData.numClusters + 7 ) & ~7;
 
 	if ( tr.externalVisData ) {
 		s_worldData.vis = tr.externalVisData;
 	} else {
-		byte *vis = ri.Hunk_Alloc( s_worldData.numClusters * s_worldData.clusterBytes, h_low );
+		vis = ri.Hunk_Alloc( s_worldData.numClusters * s_worldData.clusterBytes, h_low );
 		Com_Memset( vis, 0xff, s_worldData.numClusters * s_worldData.clusterBytes );
 		s_worldData.vis = vis;
 	}
@@ -446,10 +528,11 @@ void R_LoadCod1WorldMap( const byte *base ) {
 	s_worldData.fogs    = ri.Hunk_Alloc( sizeof( *s_worldData.fogs ), h_low );
 	s_worldData.numfogs = 0;
 	R_LoadCod1Surfaces   ( base );   /* lumps 6/7/8 – geometry */
+	R_CreateCod1WorldVbo ();
 	R_LoadCod1Marksurfaces( base );  /* lump 13 – leaf-surface indices */
 	R_LoadCod1NodesAndLeafs( base ); /* lumps 20/21 – BSP tree */
 	R_LoadSubmodelsCod1  ( base );   /* lump 27 – submodels    */
-	R_LoadVisibilityCod1 ( base );   /* lump 26 – vis (stub)   */
+	R_LoadVisibilityCod1 ( base );   /* lump 28 – vis          */
 	R_LoadEntitiesCod1   ( base );   /* lump 29 – entities     */
 
 	s_worldData.dataSize = (byte *)ri.Hunk_Alloc( 0, h_low ) - startMarker;
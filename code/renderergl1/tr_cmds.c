@@ -234,6 +234,33 @@ void RE_StretchPic ( float x, float y, float w, float h,
 	cmd->t2 = t2;
 }
 
+/*
+=============
+RE_StretchPics
+
+Queues a whole run of pics from one call, so a string of text
+costs one trap instead of one per character
+=============
+*/
+void RE_StretchPics( int numPics, const stretchPic_t *pics ) {
+	const float	*color;
+	int			i;
+
+	if ( !tr.registered ) {
+		return;
+	}
+	color = NULL;
+	for ( i = 0 ; i < numPics ; i++, pics++ ) {
+		if ( !color || color[0] != pics->color[0] || color[1] != pics->color[1]
+			|| color[2] != pics->color[2] || color[3] != pics->color[3] ) {
+			color = pics->color;
+			RE_SetColor( color );
+		}
+		RE_StretchPic( pics->x, pics->y, pics->w, pics->h,
+			pics->s1, pics->t1, pics->s2, pics->t2, pics->hShader );
+	}
+}
+
 #define MODE_RED_CYAN	1
 #define MODE_RED_BLUE	2
 #define MODE_RED_GREEN	3
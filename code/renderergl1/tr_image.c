@@ -22,6 +22,14 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 // tr_image.c
 #include "tr_local.h"
 
+#if idx64 || defined( __SSE2__ )
+#include <emmintrin.h>
+#define IMAGE_SSE2
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#include <arm_neon.h>
+#define IMAGE_NEON
+#endif
+
 static byte			 s_intensitytable[256];
 static unsigned char s_gammatable[256];
 
@@ -30,6 +38,8 @@ int		gl_filter_max = GL_LINEAR;
 
 #define FILE_HASH_SIZE		1024
 static	image_t*		hashTable[FILE_HASH_SIZE];
+static	image_t*		contentHashTable[FILE_HASH_SIZE];	// by pk3 content key
+static	int				imageBytes;		// estimated texture memory, for memstats
 
 /*
 ** R_GammaCorrect
@@ -185,6 +195,10 @@ void R_ImageList_f( void ) {
 				// 64 bits per 16 pixels, so 4 bits per pixel
 				estSize /= 2;
 				break;
+			case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+				format = "DXT3 ";
+				// 128 bits per 16 pixels, so 1 byte per pixel
+				break;
 			case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
 				format = "DXT5 ";
 				// 128 bits per 16 pixels, so 1 byte per pixel
@@ -284,6 +298,104 @@ void R_ImageList_f( void ) {
 
 //=======================================================================
 
+/*
+================
+R_AverageTexels
+
+Averages four RGBA texels per channel, rounding down
+================
+*/
+static ID_INLINE void R_AverageTexels( const byte *a, const byte *b, const byte *c, const byte *d, byte *out )
+{
+#if defined( IMAGE_SSE2 )
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sum;
+
+	sum = _mm_add_epi16( _mm_unpacklo_epi8( _mm_cvtsi32_si128( *(const int *)a ), zero ),
+		_mm_unpacklo_epi8( _mm_cvtsi32_si128( *(const int *)b ), zero ) );
+	sum = _mm_add_epi16( sum, _mm_unpacklo_epi8( _mm_cvtsi32_si128( *(const int *)c ), zero ) );
+	sum = _mm_add_epi16( sum, _mm_unpacklo_epi8( _mm_cvtsi32_si128( *(const int *)d ), zero ) );
+	sum = _mm_srli_epi16( sum, 2 );
+	*(int *)out = _mm_cvtsi128_si32( _mm_packus_epi16( sum, sum ) );
+#elif defined( IMAGE_NEON )
+	uint16x8_t sum;
+
+	sum = vaddl_u8( vreinterpret_u8_u32( vdup_n_u32( *(const uint32_t *)a ) ),
+		vreinterpret_u8_u32( vdup_n_u32( *(const uint32_t *)b ) ) );
+	sum = vaddw_u8( sum, vreinterpret_u8_u32( vdup_n_u32( *(const uint32_t *)c ) ) );
+	sum = vaddw_u8( sum, vreinterpret_u8_u32( vdup_n_u32( *(const uint32_t *)d ) ) );
+	vst1_lane_u32( (uint32_t *)out, vreinterpret_u32_u8( vshrn_n_u16( sum, 2 ) ), 0 );
+#else
+	out[0] = ( a[0] + b[0] + c[0] + d[0] ) >> 2;
+	out[1] = ( a[1] + b[1] + c[1] + d[1] ) >> 2;
+	out[2] = ( a[2] + b[2] + c[2] + d[2] ) >> 2;
+	out[3] = ( a[3] + b[3] + c[3] + d[3] ) >> 2;
+#endif
+}
+
+/*
+================
+R_BoxFilterRows
+
+Halves a pair of rows into one, four output texels at a time where SIMD
+is available
+================
+*/
+static void R_BoxFilterRows( const byte *in, const byte *in2, byte *out, int outWidth )
+{
+	int		i = 0;
+
+#if defined( IMAGE_SSE2 )
+	const __m128i zero = _mm_setzero_si128();
+
+	for ( ; i + 4 <= outWidth ; i += 4, in += 32, in2 += 32, out += 16 ) {
+		__m128	a0 = _mm_castsi128_ps( _mm_loadu_si128( (const __m128i *)in ) );
+		__m128	a1 = _mm_castsi128_ps( _mm_loadu_si128( (const __m128i *)( in + 16 ) ) );
+		__m128	b0 = _mm_castsi128_ps( _mm_loadu_si128( (const __m128i *)in2 ) );
+		__m128	b1 = _mm_castsi128_ps( _mm_loadu_si128( (const __m128i *)( in2 + 16 ) ) );
+		// split even and odd texels so each lane pairs with its neighbour
+		__m128i	ae = _mm_castps_si128( _mm_shuffle_ps( a0, a1, _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+		__m128i	ao = _mm_castps_si128( _mm_shuffle_ps( a0, a1, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+		__m128i	be = _mm_castps_si128( _mm_shuffle_ps( b0, b1, _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+		__m128i	bo = _mm_castps_si128( _mm_shuffle_ps( b0, b1, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+		__m128i	lo, hi;
+
+		lo = _mm_add_epi16( _mm_unpacklo_epi8( ae, zero ), _mm_unpacklo_epi8( ao, zero ) );
+		lo = _mm_add_epi16( lo, _mm_unpacklo_epi8( be, zero ) );
+		lo = _mm_add_epi16( lo, _mm_unpacklo_epi8( bo, zero ) );
+		hi = _mm_add_epi16( _mm_unpackhi_epi8( ae, zero ), _mm_unpackhi_epi8( ao, zero ) );
+		hi = _mm_add_epi16( hi, _mm_unpackhi_epi8( be, zero ) );
+		hi = _mm_add_epi16( hi, _mm_unpackhi_epi8( bo, zero ) );
+
+		_mm_storeu_si128( (__m128i *)out, _mm_packus_epi16( _mm_srli_epi16( lo, 2 ), _mm_srli_epi16( hi, 2 ) ) );
+	}
+#elif defined( IMAGE_NEON )
+	for ( ; i + 4 <= outWidth ; i += 4, in += 32, in2 += 32, out += 16 ) {
+		// vld2 splits even and odd texels
+		uint32x4x2_t	a = vld2q_u32( (const uint32_t *)in );
+		uint32x4x2_t	b = vld2q_u32( (const uint32_t *)in2 );
+		uint8x16_t		ae = vreinterpretq_u8_u32( a.val[0] );
+		uint8x16_t		ao = vreinterpretq_u8_u32( a.val[1] );
+		uint8x16_t		be = vreinterpretq_u8_u32( b.val[0] );
+		uint8x16_t		bo = vreinterpretq_u8_u32( b.val[1] );
+		uint16x8_t		lo, hi;
+
+		lo = vaddl_u8( vget_low_u8( ae ), vget_low_u8( ao ) );
+		lo = vaddw_u8( lo, vget_low_u8( be ) );
+		lo = vaddw_u8( lo, vget_low_u8( bo ) );
+		hi = vaddl_u8( vget_high_u8( ae ), vget_high_u8( ao ) );
+		hi = vaddw_u8( hi, vget_high_u8( be ) );
+		hi = vaddw_u8( hi, vget_high_u8( bo ) );
+
+		vst1q_u8( out, vcombine_u8( vshrn_n_u16( lo, 2 ), vshrn_n_u16( hi, 2 ) ) );
+	}
+#endif
+
+	for ( ; i < outWidth ; i++, in += 8, in2 += 8, out += 4 ) {
+		R_AverageTexels( in, in + 4, in2, in2 + 4, out );
+	}
+}
+
 /*
 ================
 ResampleTexture
@@ -329,10 +441,7 @@ static void ResampleTexture( unsigned *in, int inwidth, int inheight, unsigned *
 			pix2 = (byte *)inrow + p2[j];
 			pix3 = (byte *)inrow2 + p1[j];
 			pix4 = (byte *)inrow2 + p2[j];
-			((byte *)(out+j))[0] = (pix1[0] + pix2[0] + pix3[0] + pix4[0])>>2;
-			((byte *)(out+j))[1] = (pix1[1] + pix2[1] + pix3[1] + pix4[1])>>2;
-			((byte *)(out+j))[2] = (pix1[2] + pix2[2] + pix3[2] + pix4[2])>>2;
-			((byte *)(out+j))[3] = (pix1[3] + pix2[3] + pix3[3] + pix4[3])>>2;
+			R_AverageTexels( pix1, pix2, pix3, pix4, (byte *)(out+j) );
 		}
 	}
 }
@@ -347,55 +456,93 @@ lighting range
 */
 void R_LightScaleTexture (unsigned *in, int inwidth, int inheight, qboolean only_gamma )
 {
-	if ( only_gamma )
-	{
-		if ( !glConfig.deviceSupportsGamma )
-		{
-			int		i, c;
-			byte	*p;
-
-			p = (byte *)in;
+	byte		table[256];
+	qboolean	identity = qtrue;
+	byte		*p;
+	int			i, c;
 
-			c = inwidth*inheight;
-			for (i=0 ; i<c ; i++, p+=4)
-			{
-				p[0] = s_gammatable[p[0]];
-				p[1] = s_gammatable[p[1]];
-				p[2] = s_gammatable[p[2]];
-			}
+	// fold intensity and gamma into a single lookup, and skip the pass
+	// entirely when it wouldn't change anything
+	for ( i = 0 ; i < 256 ; i++ ) {
+		table[i] = only_gamma ? i : s_intensitytable[i];
+		if ( !glConfig.deviceSupportsGamma ) {
+			table[i] = s_gammatable[table[i]];
+		}
+		if ( table[i] != i ) {
+			identity = qfalse;
 		}
 	}
-	else
-	{
-		int		i, c;
-		byte	*p;
 
-		p = (byte *)in;
-
-		c = inwidth*inheight;
+	if ( identity ) {
+		return;
+	}
 
-		if ( glConfig.deviceSupportsGamma )
-		{
-			for (i=0 ; i<c ; i++, p+=4)
-			{
-				p[0] = s_intensitytable[p[0]];
-				p[1] = s_intensitytable[p[1]];
-				p[2] = s_intensitytable[p[2]];
-			}
-		}
-		else
-		{
-			for (i=0 ; i<c ; i++, p+=4)
-			{
-				p[0] = s_gammatable[s_intensitytable[p[0]]];
-				p[1] = s_gammatable[s_intensitytable[p[1]]];
-				p[2] = s_gammatable[s_intensitytable[p[2]]];
-			}
-		}
+	p = (byte *)in;
+	c = inwidth*inheight;
+	for (i=0 ; i<c ; i++, p+=4)
+	{
+		p[0] = table[p[0]];
+		p[1] = table[p[1]];
+		p[2] = table[p[2]];
 	}
 }
 
 
+#if defined( IMAGE_SSE2 ) || defined( IMAGE_NEON )
+/*
+================
+R_FilterTexel
+
+One texel of R_MipMap2: the 4x4 texels at rows[] and cols[] weighted
+1 2 2 1 both ways.  x / 36 is taken as ( x * 7282 ) >> 18, which is exact
+for the largest possible sum of 36 * 255.
+================
+*/
+static ID_INLINE void R_FilterTexel( const byte **rows, const int *cols, byte *out )
+{
+	int		k;
+#if defined( IMAGE_SSE2 )
+	const __m128i zero = _mm_setzero_si128();
+	__m128i	sum[4], total;
+
+	for ( k = 0 ; k < 4 ; k++ ) {
+		const byte *row = rows[k];
+
+		sum[k] = _mm_add_epi16( _mm_unpacklo_epi8( _mm_cvtsi32_si128( *(const int *)( row + cols[1] ) ), zero ),
+			_mm_unpacklo_epi8( _mm_cvtsi32_si128( *(const int *)( row + cols[2] ) ), zero ) );
+		sum[k] = _mm_add_epi16( sum[k], sum[k] );
+		sum[k] = _mm_add_epi16( sum[k], _mm_unpacklo_epi8( _mm_cvtsi32_si128( *(const int *)( row + cols[0] ) ), zero ) );
+		sum[k] = _mm_add_epi16( sum[k], _mm_unpacklo_epi8( _mm_cvtsi32_si128( *(const int *)( row + cols[3] ) ), zero ) );
+	}
+
+	total = _mm_add_epi16( sum[1], sum[2] );
+	total = _mm_add_epi16( total, total );
+	total = _mm_add_epi16( total, _mm_add_epi16( sum[0], sum[3] ) );
+	total = _mm_srli_epi16( _mm_mulhi_epu16( total, _mm_set1_epi16( 7282 ) ), 2 );
+	*(int *)out = _mm_cvtsi128_si32( _mm_packus_epi16( total, total ) );
+#else
+	uint16x8_t	sum[4], total;
+	uint16x4_t	quotient;
+
+	for ( k = 0 ; k < 4 ; k++ ) {
+		const byte *row = rows[k];
+
+		sum[k] = vaddl_u8( vreinterpret_u8_u32( vdup_n_u32( *(const uint32_t *)( row + cols[1] ) ) ),
+			vreinterpret_u8_u32( vdup_n_u32( *(const uint32_t *)( row + cols[2] ) ) ) );
+		sum[k] = vaddq_u16( sum[k], sum[k] );
+		sum[k] = vaddw_u8( sum[k], vreinterpret_u8_u32( vdup_n_u32( *(const uint32_t *)( row + cols[0] ) ) ) );
+		sum[k] = vaddw_u8( sum[k], vreinterpret_u8_u32( vdup_n_u32( *(const uint32_t *)( row + cols[3] ) ) ) );
+	}
+
+	total = vaddq_u16( sum[1], sum[2] );
+	total = vaddq_u16( total, total );
+	total = vaddq_u16( total, vaddq_u16( sum[0], sum[3] ) );
+	quotient = vshr_n_u16( vshrn_n_u32( vmull_u16( vget_low_u16( total ), vdup_n_u16( 7282 ) ), 16 ), 2 );
+	vst1_lane_u32( (uint32_t *)out, vreinterpret_u32_u8( vmovn_u16( vcombine_u16( quotient, quotient ) ) ), 0 );
+#endif
+}
+#endif
+
 /*
 ================
 R_MipMap2
@@ -406,9 +553,7 @@ Proper linear filter
 */
 static void R_MipMap2( unsigned *in, int inWidth, int inHeight ) {
 	int			i, j, k;
-	byte		*outpix;
 	int			inWidthMask, inHeightMask;
-	int			total;
 	int			outWidth, outHeight;
 	unsigned	*temp;
 
@@ -419,9 +564,29 @@ static void R_MipMap2( unsigned *in, int inWidth, int inHeight ) {
 	inWidthMask = inWidth - 1;
 	inHeightMask = inHeight - 1;
 
+#if defined( IMAGE_SSE2 ) || defined( IMAGE_NEON )
+	for ( i = 0 ; i < outHeight ; i++ ) {
+		const byte	*rows[4];
+		int			cols[4];
+
+		for ( k = 0 ; k < 4 ; k++ ) {
+			rows[k] = (const byte *)&in[ ((i*2-1+k)&inHeightMask)*inWidth ];
+		}
+
+		for ( j = 0 ; j < outWidth ; j++ ) {
+			for ( k = 0 ; k < 4 ; k++ ) {
+				cols[k] = ((j*2-1+k)&inWidthMask) * 4;
+			}
+			R_FilterTexel( rows, cols, (byte *)( temp + i * outWidth + j ) );
+		}
+	}
+#else
 	for ( i = 0 ; i < outHeight ; i++ ) {
 		for ( j = 0 ; j < outWidth ; j++ ) {
-			outpix = (byte *) ( temp + i * outWidth + j );
+			byte	*outpix = (byte *) ( temp + i * outWidth + j );
+			int		total;
+
+
 			for ( k = 0 ; k < 4 ; k++ ) {
 				total = 
 					1 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
@@ -447,6 +612,7 @@ static void R_MipMap2( unsigned *in, int inWidth, int inHeight ) {
 			}
 		}
 	}
+#endif
 
 	Com_Memcpy( in, temp, outWidth * outHeight * 4 );
 	ri.Hunk_FreeTempMemory( temp );
@@ -460,7 +626,7 @@ Operates in place, quartering the size of the texture
 ================
 */
 static void R_MipMap (byte *in, int width, int height) {
-	int		i, j;
+	int		i;
 	byte	*out;
 	int		row;
 
@@ -489,13 +655,8 @@ static void R_MipMap (byte *in, int width, int height) {
 		return;
 	}
 
-	for (i=0 ; i<height ; i++, in+=row) {
-		for (j=0 ; j<width ; j++, out+=4, in+=8) {
-			out[0] = (in[0] + in[4] + in[row+0] + in[row+4])>>2;
-			out[1] = (in[1] + in[5] + in[row+1] + in[row+5])>>2;
-			out[2] = (in[2] + in[6] + in[row+2] + in[row+6])>>2;
-			out[3] = (in[3] + in[7] + in[row+3] + in[row+7])>>2;
-		}
+	for (i=0 ; i<height ; i++, in+=row*2, out+=width*4) {
+		R_BoxFilterRows( in, in + row, out, width );
 	}
 }
 
@@ -550,6 +711,103 @@ Upload32
 
 ===============
 */
+/*
+===============
+R_SetUploadFilter
+===============
+*/
+static void R_SetUploadFilter( qboolean mipmap )
+{
+	if (mipmap)
+	{
+		if ( textureFilterAnisotropic )
+			qglTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT,
+					(GLint)Com_Clamp( 1, maxAnisotropy, r_ext_max_anisotropy->integer ) );
+
+		qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, gl_filter_min);
+		qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, gl_filter_max);
+	}
+	else
+	{
+		if ( textureFilterAnisotropic )
+			qglTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 1 );
+
+		qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+		qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	}
+}
+
+
+/*
+===============
+R_CompressedMipSize
+===============
+*/
+static int R_CompressedMipSize( int width, int height, GLenum picFormat )
+{
+	int numBlocks = ( ( width + 3 ) / 4 ) * ( ( height + 3 ) / 4 );
+
+	return numBlocks * ( ( picFormat == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ) ? 8 : 16 );
+}
+
+
+/*
+===============
+UploadCompressed
+
+Uploads S3TC blocks as loaded from a DDS or KTX2 file, using its stored mip
+levels rather than rebuilding them with R_MipMap.  Picmip and the GL
+size limit drop stored levels from the top of the chain.
+===============
+*/
+static void UploadCompressed( byte *data, int width, int height,
+						  GLenum picFormat, int numMips,
+						  qboolean mipmap, qboolean picmip,
+						  int *format,
+						  int *pUploadWidth, int *pUploadHeight )
+{
+	int		skip = picmip ? r_picmip->integer : 0;
+	int		miplevel, size;
+
+	while ( numMips > 1 && ( skip > 0 || width > glConfig.maxTextureSize || height > glConfig.maxTextureSize ) ) {
+		data += R_CompressedMipSize( width, height, picFormat );
+		width = MAX( 1, width >> 1 );
+		height = MAX( 1, height >> 1 );
+		numMips--;
+		skip--;
+	}
+
+	if ( !mipmap ) {
+		numMips = 1;
+	}
+
+	*pUploadWidth = width;
+	*pUploadHeight = height;
+	*format = picFormat;
+
+	for ( miplevel = 0 ; miplevel < numMips ; miplevel++ ) {
+		size = R_CompressedMipSize( width, height, picFormat );
+		qglCompressedTexImage2DARB( GL_TEXTURE_2D, miplevel, picFormat, width, height, 0, size, data );
+		data += size;
+
+		if ( width == 1 && height == 1 ) {
+			break;
+		}
+		width = MAX( 1, width >> 1 );
+		height = MAX( 1, height >> 1 );
+	}
+
+	// a file without a full chain would otherwise leave the texture incomplete
+	if ( mipmap && miplevel == numMips ) {
+		qglTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, numMips - 1 );
+	}
+
+	R_SetUploadFilter( mipmap );
+
+	GL_CheckErrors();
+}
+
+
 static void Upload32( unsigned *data, 
 						  int width, int height, 
 						  qboolean mipmap, 
@@ -802,23 +1060,7 @@ static void Upload32( unsigned *data,
 	}
 done:
 
-	if (mipmap)
-	{
-		if ( textureFilterAnisotropic )
-			qglTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT,
-					(GLint)Com_Clamp( 1, maxAnisotropy, r_ext_max_anisotropy->integer ) );
-
-		qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, gl_filter_min);
-		qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, gl_filter_max);
-	}
-	else
-	{
-		if ( textureFilterAnisotropic )
-			qglTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 1 );
-
-		qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-		qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-	}
+	R_SetUploadFilter( mipmap );
 
 	GL_CheckErrors();
 
@@ -831,17 +1073,19 @@ done:
 
 /*
 ================
-R_CreateImage
+R_CreateImage2
 
-This is the only way any image_t are created
+This is the only way any image_t are created.  picFormat is GL_RGBA8 for
+plain pixels, or an S3TC format for numMips levels of DDS or KTX2 blocks.
 ================
 */
-image_t *R_CreateImage( const char *name, byte *pic, int width, int height,
+image_t *R_CreateImage2( const char *name, byte *pic, int width, int height, GLenum picFormat, int numMips,
 		imgType_t type, imgFlags_t flags, int internalFormat ) {
 	image_t		*image;
 	qboolean	isLightmap = qfalse;
 	long		hash;
 	int         glWrapClampMode;
+	int			texelBytes;
 
 	if (strlen(name) >= MAX_QPATH ) {
 		ri.Error (ERR_DROP, "R_CreateImage: \"%s\" is too long", name);
@@ -883,7 +1127,15 @@ image_t *R_CreateImage( const char *name, byte *pic, int width, int height,
 
 	GL_Bind(image);
 
-	Upload32( (unsigned *)pic, image->width, image->height, 
+	if ( picFormat != GL_RGBA8 ) {
+		UploadCompressed( pic, image->width, image->height, picFormat, numMips,
+								image->flags & IMGFLAG_MIPMAP,
+								image->flags & IMGFLAG_PICMIP,
+								&image->internalFormat,
+								&image->uploadWidth,
+								&image->uploadHeight );
+	} else {
+		Upload32( (unsigned *)pic, image->width, image->height, 
 								image->flags & IMGFLAG_MIPMAP,
 								image->flags & IMGFLAG_PICMIP,
 								isLightmap,
@@ -891,6 +1143,7 @@ image_t *R_CreateImage( const char *name, byte *pic, int width, int height,
 								&image->internalFormat,
 								&image->uploadWidth,
 								&image->uploadHeight );
+	}
 
 	qglTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, glWrapClampMode );
 	qglTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, glWrapClampMode );
@@ -906,9 +1159,29 @@ image_t *R_CreateImage( const char *name, byte *pic, int width, int height,
 	image->next = hashTable[hash];
 	hashTable[hash] = image;
 
+	// four bytes a texel (half or one for S3TC blocks), plus a third for the mip chain
+	texelBytes = image->uploadWidth * image->uploadHeight * ( ( flags & IMGFLAG_MIPMAP ) ? 16 : 12 ) / 3;
+	if ( picFormat == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT )
+		texelBytes /= 8;
+	else if ( picFormat != GL_RGBA8 )
+		texelBytes /= 4;
+	imageBytes += texelBytes;
+	ri.MemStatSet( "renderer.images", imageBytes );
+
 	return image;
 }
 
+
+/*
+================
+R_CreateImage
+================
+*/
+image_t *R_CreateImage( const char *name, byte *pic, int width, int height,
+		imgType_t type, imgFlags_t flags, int internalFormat ) {
+	return R_CreateImage2( name, pic, width, height, GL_RGBA8, 0, type, flags, internalFormat );
+}
+
 //===================================================================
 
 typedef struct
@@ -920,9 +1193,13 @@ typedef struct
 // Note that the ordering indicates the order of preference used
 // when there are multiple images of different formats available
 void R_LoadDDS( const char *name, byte **pic, int *width, int *height );
+void R_LoadCompressedDDS( const char *name, byte **pic, int *width, int *height, GLenum *picFormat, int *numMips );
+void R_LoadKTX( const char *name, byte **pic, int *width, int *height );
+void R_LoadCompressedKTX( const char *name, byte **pic, int *width, int *height, GLenum *picFormat, int *numMips );
 
 static imageExtToLoaderMap_t imageLoaders[ ] =
 {
+	{ "ktx2", R_LoadKTX },
 	{ "dds",  R_LoadDDS },
 	{ "tga",  R_LoadTGA },
 	{ "jpg",  R_LoadJPG },
@@ -935,15 +1212,34 @@ static imageExtToLoaderMap_t imageLoaders[ ] =
 
 static int numImageLoaders = ARRAY_LEN( imageLoaders );
 
+/*
+=================
+R_LoadImageFile
+
+Runs one loader, letting DDS and KTX2 hand back S3TC blocks when
+picFormat is set.
+=================
+*/
+static void R_LoadImageFile( int loader, const char *name, byte **pic, int *width, int *height, GLenum *picFormat, int *numMips )
+{
+	if ( picFormat && imageLoaders[ loader ].ImageLoader == R_LoadDDS )
+		R_LoadCompressedDDS( name, pic, width, height, picFormat, numMips );
+	else if ( picFormat && imageLoaders[ loader ].ImageLoader == R_LoadKTX )
+		R_LoadCompressedKTX( name, pic, width, height, picFormat, numMips );
+	else
+		imageLoaders[ loader ].ImageLoader( name, pic, width, height );
+}
+
 /*
 =================
 R_LoadImage
 
 Loads any of the supported image types into a canonical
-32 bit format.
+32 bit format.  If picFormat is not NULL, DXT compressed DDS and KTX2
+files are returned as blocks instead, with *picFormat and *numMips set.
 =================
 */
-void R_LoadImage( const char *name, byte **pic, int *width, int *height )
+void R_LoadImage( const char *name, byte **pic, int *width, int *height, GLenum *picFormat, int *numMips )
 {
 	qboolean orgNameFailed = qfalse;
 	int orgLoader = -1;
@@ -955,6 +1251,10 @@ void R_LoadImage( const char *name, byte **pic, int *width, int *height )
 	*pic = NULL;
 	*width = 0;
 	*height = 0;
+	if ( picFormat )
+		*picFormat = GL_RGBA8;
+	if ( numMips )
+		*numMips = 0;
 
 	Q_strncpyz( localName, name, MAX_QPATH );
 
@@ -968,7 +1268,7 @@ void R_LoadImage( const char *name, byte **pic, int *width, int *height )
 			if( !Q_stricmp( ext, imageLoaders[ i ].ext ) )
 			{
 				// Load
-				imageLoaders[ i ].ImageLoader( localName, pic, width, height );
+				R_LoadImageFile( i, localName, pic, width, height, picFormat, numMips );
 				break;
 			}
 		}
@@ -1002,7 +1302,7 @@ void R_LoadImage( const char *name, byte **pic, int *width, int *height )
 		altName = va( "%s.%s", localName, imageLoaders[ i ].ext );
 
 		// Load
-		imageLoaders[ i ].ImageLoader( altName, pic, width, height );
+		R_LoadImageFile( i, altName, pic, width, height, picFormat, numMips );
 
 		if( *pic )
 		{
@@ -1018,6 +1318,84 @@ void R_LoadImage( const char *name, byte **pic, int *width, int *height )
 }
 
 
+/*
+===============
+R_ImageContentKey
+
+Gets the content key of the file R_LoadImage would read for name,
+trying the same names in the same order.  Returns qfalse when the file
+doesn't come from a pk3.
+===============
+*/
+static qboolean R_ImageContentKey( const char *name, unsigned int *crc, unsigned int *length )
+{
+	int orgLoader = -1;
+	int i, found;
+	char localName[ MAX_QPATH ];
+	const char *ext;
+
+	*crc = 0;
+	*length = 0;
+
+	Q_strncpyz( localName, name, MAX_QPATH );
+
+	ext = COM_GetExtension( localName );
+
+	if( *ext )
+	{
+		for( i = 0; i < numImageLoaders; i++ )
+		{
+			if( !Q_stricmp( ext, imageLoaders[ i ].ext ) )
+				break;
+		}
+
+		if( i < numImageLoaders )
+		{
+			found = ri.FS_FileContentKey( localName, crc, length );
+			if( found >= 0 )
+				return found > 0;
+
+			orgLoader = i;
+			COM_StripExtension( name, localName, MAX_QPATH );
+		}
+	}
+
+	for( i = 0; i < numImageLoaders; i++ )
+	{
+		if (i == orgLoader)
+			continue;
+
+		found = ri.FS_FileContentKey( va( "%s.%s", localName, imageLoaders[ i ].ext ), crc, length );
+		if( found >= 0 )
+			return found > 0;
+	}
+
+	return qfalse;
+}
+
+
+/*
+===============
+R_CanUploadCompressed
+
+DDS blocks can only go to GL untouched when nothing would have
+rewritten the decoded texels: greyscale, r_intensity, software gamma
+and colored mip levels all work on RGBA.
+===============
+*/
+static qboolean R_CanUploadCompressed( imgFlags_t flags )
+{
+	if ( !qglCompressedTexImage2DARB || glConfig.textureCompression != TC_S3TC_ARB )
+		return qfalse;
+
+	if ( flags & IMGFLAG_NO_COMPRESSION )
+		return qfalse;
+
+	return glConfig.deviceSupportsGamma && r_intensity->value == 1 &&
+		!r_greyscale->value && !r_colorMipLevels->integer;
+}
+
+
 /*
 ===============
 R_FindImageFile
@@ -1032,6 +1410,10 @@ image_t	*R_FindImageFile( const char *name, imgType_t type, imgFlags_t flags )
 	int		width, height;
 	byte	*pic;
 	long	hash;
+	unsigned int	contentCrc, contentLength;
+	long	contentHash = 0;
+	GLenum	picFormat = GL_RGBA8;
+	int		numMips = 0;
 
 	if (!name) {
 		return NULL;
@@ -1054,16 +1436,37 @@ image_t	*R_FindImageFile( const char *name, imgType_t type, imgFlags_t flags )
 		}
 	}
 
+	//
+	// the same file may already be loaded under another name
+	//
+	if ( R_ImageContentKey( name, &contentCrc, &contentLength ) ) {
+		contentHash = contentCrc & ( FILE_HASH_SIZE - 1 );
+		for (image=contentHashTable[contentHash]; image; image=image->nextContent) {
+			if ( image->contentCrc == contentCrc && image->contentLength == contentLength &&
+				image->type == type && image->flags == flags ) {
+				return image;
+			}
+		}
+	}
+
 	//
 	// load the pic from disk
 	//
-	R_LoadImage( name, &pic, &width, &height );
+	R_LoadImage( name, &pic, &width, &height, R_CanUploadCompressed( flags ) ? &picFormat : NULL, &numMips );
 	if ( pic == NULL ) {
 		return NULL;
 	}
 
-	image = R_CreateImage( ( char * ) name, pic, width, height, type, flags, 0 );
+	image = R_CreateImage2( ( char * ) name, pic, width, height, picFormat, numMips, type, flags, 0 );
 	ri.Free( pic );
+
+	if ( contentLength ) {
+		image->contentCrc = contentCrc;
+		image->contentLength = contentLength;
+		image->nextContent = contentHashTable[contentHash];
+		contentHashTable[contentHash] = image;
+	}
+
 	return image;
 }
 
@@ -1352,6 +1755,7 @@ R_InitImages
 */
 void	R_InitImages( void ) {
 	Com_Memset(hashTable, 0, sizeof(hashTable));
+	Com_Memset(contentHashTable, 0, sizeof(contentHashTable));
 	// build brightness translation tables
 	R_SetColorMappings();
 
@@ -1373,6 +1777,8 @@ void R_DeleteTextures( void ) {
 	Com_Memset( tr.images, 0, sizeof( tr.images ) );
 
 	tr.numImages = 0;
+	imageBytes = 0;
+	ri.MemStatSet( "renderer.images", 0 );
 
 	Com_Memset( glState.currenttextures, 0, sizeof( glState.currenttextures ) );
 	if ( qglActiveTextureARB ) {
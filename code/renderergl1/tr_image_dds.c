@@ -4,6 +4,9 @@ DDS (DirectDraw Surface) texture loader for renderergl1.
 
 Decompresses DXT1, DXT3, DXT5 blocks to RGBA and handles uncompressed
 DDS formats. CoD1 uses DDS textures extensively for its assets.
+
+When the caller can upload S3TC directly, R_LoadCompressedDDS hands back
+the raw DXT blocks and every stored mip level instead.
 ===========================================================================
 */
 
@@ -16,6 +19,7 @@ DDS formats. CoD1 uses DDS textures extensively for its assets.
 #define DDPF_FOURCC         0x4
 #define DDPF_RGB            0x40
 #define DDPF_LUMINANCE      0x20000
+#define DDSD_MIPMAPCOUNT    0x20000
 
 #define FOURCC(a,b,c,d) ((unsigned int)((a)|((b)<<8)|((c)<<16)|((d)<<24)))
 #define FOURCC_DXT1  FOURCC('D','X','T','1')
@@ -243,6 +247,21 @@ static void DecompressDXT5( const byte *src, byte *dst, int width, int height )
 	}
 }
 
+/*
+ * Decodes one level of S3TC blocks, as the matching GL format names them,
+ * to RGBA.  Shared with the KTX2 loader for when the blocks can't be
+ * uploaded as they are.
+ */
+void R_DecodeDXT( const byte *src, byte *dst, int width, int height, GLenum format )
+{
+	if( format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT )
+		DecompressDXT1( src, dst, width, height );
+	else if( format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT )
+		DecompressDXT3( src, dst, width, height );
+	else
+		DecompressDXT5( src, dst, width, height );
+}
+
 /* ---- Uncompressed DDS ---- */
 
 static byte SampleChannel( unsigned int val, unsigned int mask )
@@ -285,9 +304,71 @@ static void DecodeUncompressed( const byte *src, byte *dst, int width, int heigh
 	}
 }
 
-/* ---- Public loader ---- */
+/*
+ * Copies the DXT blocks of every mip level present in the file so they can
+ * go straight to glCompressedTexImage2D.  Returns qfalse when the image has
+ * to be decoded instead: non power of two sizes (GL1 resamples those), or
+ * not enough stored levels to fit under the GL size limit.
+ */
+static qboolean CopyDXTBlocks( const ddsHeader_t *hdr, const byte *data, int dataLen,
+	byte **pic, GLenum *picFormat, int *numMips )
+{
+	int blockSize = ( hdr->pfFourCC == FOURCC_DXT1 ) ? 8 : 16;
+	int w = (int)hdr->width;
+	int h = (int)hdr->height;
+	int levels, total, size;
 
-void R_LoadDDS( const char *name, byte **pic, int *width, int *height )
+	if( ( w & ( w - 1 ) ) || ( h & ( h - 1 ) ) )
+		return qfalse;
+
+	levels = ( ( hdr->flags & DDSD_MIPMAPCOUNT ) && hdr->mipMapCount > 0 ) ? (int)hdr->mipMapCount : 1;
+
+	for( total = 0, *numMips = 0; *numMips < levels; (*numMips)++ )
+	{
+		size = ( ( w + 3 ) / 4 ) * ( ( h + 3 ) / 4 ) * blockSize;
+		if( total + size > dataLen )
+			break;
+		total += size;
+
+		if( w == 1 && h == 1 )
+		{
+			(*numMips)++;
+			break;
+		}
+		w = MAX( 1, w >> 1 );
+		h = MAX( 1, h >> 1 );
+	}
+
+	if( *numMips == 0 || (int)( hdr->width >> ( *numMips - 1 ) ) > glConfig.maxTextureSize ||
+		(int)( hdr->height >> ( *numMips - 1 ) ) > glConfig.maxTextureSize )
+	{
+		*numMips = 1;
+		return qfalse;
+	}
+
+	*pic = ri.Malloc( total );
+	Com_Memcpy( *pic, data, total );
+
+	if( hdr->pfFourCC == FOURCC_DXT1 )
+		*picFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+	else if( hdr->pfFourCC == FOURCC_DXT3 )
+		*picFormat = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+	else
+		*picFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+
+	return qtrue;
+}
+
+/* ---- Public loaders ---- */
+
+/*
+ * picFormat and numMips may be NULL, in which case the image is always
+ * decoded to RGBA.  Otherwise DXT1/3/5 images come back as raw blocks with
+ * *picFormat set to the matching S3TC format, and everything else comes
+ * back as RGBA with *picFormat set to GL_RGBA8.
+ */
+void R_LoadCompressedDDS( const char *name, byte **pic, int *width, int *height,
+	GLenum *picFormat, int *numMips )
 {
 	union { byte *b; void *v; } buffer;
 	int len;
@@ -297,6 +378,10 @@ void R_LoadDDS( const char *name, byte **pic, int *width, int *height )
 	*pic    = NULL;
 	*width  = 0;
 	*height = 0;
+	if( picFormat )
+		*picFormat = GL_RGBA8;
+	if( numMips )
+		*numMips = 1;
 
 	len = ri.FS_ReadFile( (char *)name, &buffer.v );
 	if( !buffer.b || len < 0 )
@@ -339,7 +424,15 @@ void R_LoadDDS( const char *name, byte **pic, int *width, int *height )
 
 	data = buffer.b + 4 + sizeof(ddsHeader_t);
 
-	/* Output is always RGBA */
+	if( picFormat && numMips && ( hdr->pfFlags & DDPF_FOURCC ) &&
+		( hdr->pfFourCC == FOURCC_DXT1 || hdr->pfFourCC == FOURCC_DXT3 || hdr->pfFourCC == FOURCC_DXT5 ) &&
+		CopyDXTBlocks( hdr, data, len - 4 - (int)sizeof(ddsHeader_t), pic, picFormat, numMips ) )
+	{
+		ri.FS_FreeFile( buffer.v );
+		return;
+	}
+
+	/* Everything else is decoded to RGBA */
 	*pic = ri.Malloc( (*width) * (*height) * 4 );
 	Com_Memset( *pic, 0, (*width) * (*height) * 4 );
 
@@ -403,3 +496,8 @@ void R_LoadDDS( const char *name, byte **pic, int *width, int *height )
 
 	ri.FS_FreeFile( buffer.v );
 }
+
+void R_LoadDDS( const char *name, byte **pic, int *width, int *height )
+{
+	R_LoadCompressedDDS( name, pic, width, height, NULL, NULL );
+}
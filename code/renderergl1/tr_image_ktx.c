@@ -0,0 +1,270 @@
+/*
+===========================================================================
+KTX2 texture loader for renderergl1.
+
+Reads KTX2 containers holding S3TC (BC1/BC2/BC3) blocks or RGBA8 texels,
+each mip level stored as is or zlib supercompressed, so paks can carry
+textures much smaller than the equivalent DDS.  The levels are inflated
+at load and go to GL as blocks with their mip chain when the caller can
+upload S3TC, otherwise the base level is decoded to RGBA.
+===========================================================================
+*/
+
+#include "tr_local.h"
+#include "../renderercommon/puff.h"
+
+/* ---- KTX2 header structures ---- */
+
+static const byte ktx2Identifier[12] = {
+	0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+
+#define KTX2_SUPERCOMPRESSION_NONE	0
+#define KTX2_SUPERCOMPRESSION_ZLIB	3
+
+/* the Vulkan format numbers KTX2 names its texel formats by */
+#define VK_FORMAT_R8G8B8A8_UNORM		37
+#define VK_FORMAT_R8G8B8A8_SRGB			43
+#define VK_FORMAT_BC1_RGB_UNORM_BLOCK	131
+#define VK_FORMAT_BC1_RGB_SRGB_BLOCK	132
+#define VK_FORMAT_BC1_RGBA_UNORM_BLOCK	133
+#define VK_FORMAT_BC1_RGBA_SRGB_BLOCK	134
+#define VK_FORMAT_BC2_UNORM_BLOCK		135
+#define VK_FORMAT_BC2_SRGB_BLOCK		136
+#define VK_FORMAT_BC3_UNORM_BLOCK		137
+#define VK_FORMAT_BC3_SRGB_BLOCK		138
+
+typedef struct {
+	byte				identifier[12];
+	unsigned int		vkFormat;
+	unsigned int		typeSize;
+	unsigned int		pixelWidth;
+	unsigned int		pixelHeight;
+	unsigned int		pixelDepth;
+	unsigned int		layerCount;
+	unsigned int		faceCount;
+	unsigned int		levelCount;
+	unsigned int		supercompressionScheme;
+	unsigned int		dfdByteOffset;
+	unsigned int		dfdByteLength;
+	unsigned int		kvdByteOffset;
+	unsigned int		kvdByteLength;
+	unsigned long long	sgdByteOffset;
+	unsigned long long	sgdByteLength;
+} ktx2Header_t;
+
+typedef struct {
+	unsigned long long	byteOffset;
+	unsigned long long	byteLength;
+	unsigned long long	uncompressedByteLength;
+} ktx2Level_t;
+
+void R_DecodeDXT( const byte *src, byte *dst, int width, int height, GLenum format );
+
+/*
+ * The GL format a KTX2 vkFormat comes back as, GL_RGBA8 for plain texels,
+ * or 0 when the loader doesn't take it.  sRGB variants load as their
+ * linear counterparts, the same as the DDS and TGA loaders treat texels.
+ */
+static GLenum KTX2_PicFormat( unsigned int vkFormat )
+{
+	switch( vkFormat )
+	{
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+		return GL_RGBA8;
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+	case VK_FORMAT_BC2_UNORM_BLOCK:
+	case VK_FORMAT_BC2_SRGB_BLOCK:
+		return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+		return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	default:
+		return 0;
+	}
+}
+
+static int KTX2_LevelSize( int width, int height, GLenum format )
+{
+	if( format == GL_RGBA8 )
+		return width * height * 4;
+
+	return ( ( width + 3 ) / 4 ) * ( ( height + 3 ) / 4 ) *
+		( ( format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ) ? 8 : 16 );
+}
+
+/*
+ * Copies or inflates one level into dst, which has exactly size bytes.
+ * zlib levels carry a two byte header and an adler32 around the deflate
+ * data puff reads.
+ */
+static qboolean KTX2_ReadLevel( const ktx2Header_t *hdr, const ktx2Level_t *level,
+	const byte *file, int fileLen, byte *dst, int size )
+{
+	uint32_t destLen, srcLen;
+
+	if( level->byteOffset > (unsigned long long)fileLen ||
+		level->byteLength > (unsigned long long)fileLen - level->byteOffset )
+		return qfalse;
+
+	if( hdr->supercompressionScheme == KTX2_SUPERCOMPRESSION_NONE )
+	{
+		if( level->byteLength != (unsigned long long)size )
+			return qfalse;
+		Com_Memcpy( dst, file + level->byteOffset, size );
+		return qtrue;
+	}
+
+	if( level->uncompressedByteLength != (unsigned long long)size || level->byteLength < 6 )
+		return qfalse;
+
+	destLen = size;
+	srcLen = (uint32_t)level->byteLength - 6;
+	if( puff( dst, &destLen, (uint8_t *)file + level->byteOffset + 2, &srcLen ) != 0 )
+		return qfalse;
+
+	return destLen == (uint32_t)size;
+}
+
+/* ---- Public loaders ---- */
+
+/*
+ * picFormat and numMips may be NULL, in which case the image is always
+ * decoded to RGBA.  Otherwise power of two BC1/2/3 images come back as the
+ * blocks of every stored level with *picFormat set to the matching S3TC
+ * format, the way R_LoadCompressedDDS returns them.
+ */
+void R_LoadCompressedKTX( const char *name, byte **pic, int *width, int *height,
+	GLenum *picFormat, int *numMips )
+{
+	union { byte *b; void *v; } buffer;
+	const ktx2Header_t *hdr;
+	const ktx2Level_t *levels;
+	GLenum format;
+	qboolean direct;
+	byte *blocks, *rgba;
+	int len, levelCount, keep, total, size, w, h, pw, ph, i, y;
+
+	*pic    = NULL;
+	*width  = 0;
+	*height = 0;
+	if( picFormat )
+		*picFormat = GL_RGBA8;
+	if( numMips )
+		*numMips = 1;
+
+	len = ri.FS_ReadFile( (char *)name, &buffer.v );
+	if( !buffer.b || len < 0 )
+		return;
+
+	hdr = (const ktx2Header_t *)buffer.b;
+	if( len < (int)sizeof( ktx2Header_t ) || memcmp( hdr->identifier, ktx2Identifier, sizeof( ktx2Identifier ) ) )
+	{
+		ri.Printf( PRINT_WARNING, "R_LoadKTX: %s is not a KTX2 file\n", name );
+		ri.FS_FreeFile( buffer.v );
+		return;
+	}
+
+	format = KTX2_PicFormat( hdr->vkFormat );
+	if( !format )
+	{
+		ri.Printf( PRINT_WARNING, "R_LoadKTX: %s has unsupported format %u\n", name, hdr->vkFormat );
+		ri.FS_FreeFile( buffer.v );
+		return;
+	}
+
+	if( hdr->supercompressionScheme != KTX2_SUPERCOMPRESSION_NONE &&
+		hdr->supercompressionScheme != KTX2_SUPERCOMPRESSION_ZLIB )
+	{
+		ri.Printf( PRINT_WARNING, "R_LoadKTX: %s has unsupported supercompression %u\n",
+			name, hdr->supercompressionScheme );
+		ri.FS_FreeFile( buffer.v );
+		return;
+	}
+
+	w = (int)hdr->pixelWidth;
+	h = (int)hdr->pixelHeight;
+	if( w <= 0 || h <= 0 || w > 4096 || h > 4096 || hdr->pixelDepth > 1 ||
+		hdr->layerCount > 1 || hdr->faceCount != 1 )
+	{
+		ri.Printf( PRINT_WARNING, "R_LoadKTX: %s is not a single %dx%d 2D image\n", name, w, h );
+		ri.FS_FreeFile( buffer.v );
+		return;
+	}
+
+	// a level count of 0 asks for generated mips, which R_MipMap does anyway
+	levelCount = MAX( 1, (int)hdr->levelCount );
+	if( levelCount > 13 || len < (int)sizeof( ktx2Header_t ) + levelCount * (int)sizeof( ktx2Level_t ) )
+	{
+		ri.Printf( PRINT_WARNING, "R_LoadKTX: %s has a bad level index\n", name );
+		ri.FS_FreeFile( buffer.v );
+		return;
+	}
+	levels = (const ktx2Level_t *)( buffer.b + sizeof( ktx2Header_t ) );
+
+	// S3TC goes up with its stored chain when it can, like CopyDXTBlocks,
+	// otherwise only the base level is needed
+	direct = format != GL_RGBA8 && picFormat && numMips && !( w & ( w - 1 ) ) && !( h & ( h - 1 ) ) &&
+		( w >> ( levelCount - 1 ) ) <= glConfig.maxTextureSize && ( h >> ( levelCount - 1 ) ) <= glConfig.maxTextureSize;
+	keep = direct ? levelCount : 1;
+
+	for( total = 0, i = 0; i < keep; i++ )
+		total += KTX2_LevelSize( MAX( 1, w >> i ), MAX( 1, h >> i ), format );
+
+	blocks = ri.Malloc( total );
+	for( total = 0, i = 0; i < keep; i++ )
+	{
+		size = KTX2_LevelSize( MAX( 1, w >> i ), MAX( 1, h >> i ), format );
+		if( !KTX2_ReadLevel( hdr, &levels[i], buffer.b, len, blocks + total, size ) )
+			break;
+		total += size;
+	}
+	ri.FS_FreeFile( buffer.v );
+
+	if( i == 0 )
+	{
+		ri.Printf( PRINT_WARNING, "R_LoadKTX: %s has a bad base level\n", name );
+		ri.Free( blocks );
+		return;
+	}
+
+	*width  = w;
+	*height = h;
+
+	if( format == GL_RGBA8 )
+	{
+		*pic = blocks;
+		return;
+	}
+
+	// a truncated chain still goes up if what was read fits
+	if( direct && ( w >> ( i - 1 ) ) <= glConfig.maxTextureSize && ( h >> ( i - 1 ) ) <= glConfig.maxTextureSize )
+	{
+		*pic = blocks;
+		*picFormat = format;
+		*numMips = i;
+		return;
+	}
+
+	// decode the base level, padded out to whole blocks
+	pw = ( w + 3 ) & ~3;
+	ph = ( h + 3 ) & ~3;
+	rgba = ri.Malloc( pw * ph * 4 );
+	R_DecodeDXT( blocks, rgba, pw, ph, format );
+	ri.Free( blocks );
+
+	*pic = ri.Malloc( w * h * 4 );
+	for( y = 0; y < h; y++ )
+		Com_Memcpy( *pic + y * w * 4, rgba + y * pw * 4, w * 4 );
+	ri.Free( rgba );
+}
+
+void R_LoadKTX( const char *name, byte **pic, int *width, int *height )
+{
+	R_LoadCompressedKTX( name, pic, width, height, NULL, NULL );
+}
@@ -104,6 +104,7 @@ cvar_t	*r_stencilbits;
 cvar_t	*r_depthbits;
 cvar_t	*r_colorbits;
 cvar_t	*r_primitives;
+cvar_t	*r_worldVBO;
 cvar_t	*r_texturebits;
 cvar_t  *r_ext_multisample;
 
@@ -158,6 +159,7 @@ cvar_t	*r_debugLight;
 cvar_t	*r_debugSort;
 cvar_t	*r_printShaders;
 cvar_t	*r_saveFontData;
+cvar_t	*r_fontSDF;		// never registered, there is no distance field path here
 
 cvar_t	*r_marksOnTriangleMeshes;
 
@@ -1093,6 +1095,7 @@ void R_Register( void )
 	r_railSegmentLength = ri.Cvar_Get( "r_railSegmentLength", "32", CVAR_ARCHIVE );
 
 	r_primitives = ri.Cvar_Get( "r_primitives", "0", CVAR_ARCHIVE );
+	r_worldVBO = ri.Cvar_Get( "r_worldVBO", "1", CVAR_ARCHIVE | CVAR_LATCH );
 
 	r_ambientScale = ri.Cvar_Get( "r_ambientScale", "0.6", CVAR_CHEAT );
 	r_directedScale = ri.Cvar_Get( "r_directedScale", "1", CVAR_CHEAT );
@@ -1239,11 +1242,17 @@ void R_Init( void ) {
 	backEndData->polyVerts = (polyVert_t *) ((char *) ptr + sizeof( *backEndData ) + sizeof(srfPoly_t) * max_polys);
 	R_InitNextFrame();
 
+	ri.ProfileBegin( "InitOpenGL" );
 	InitOpenGL();
+	ri.ProfileEnd();
 
+	ri.ProfileBegin( "R_InitImages" );
 	R_InitImages();
+	ri.ProfileEnd();
 
+	ri.ProfileBegin( "R_InitShaders" );
 	R_InitShaders();
+	ri.ProfileEnd();
 
 	R_InitSkins();
 
@@ -1284,6 +1293,10 @@ void RE_Shutdown( qboolean destroyWindow ) {
 	if ( tr.registered ) {
 		R_IssuePendingRenderCommands();
 		R_DeleteTextures();
+		if ( tr.worldVbo ) {
+			qglDeleteBuffers( 1, &tr.worldVbo );
+			tr.worldVbo = 0;
+		}
 	}
 
 	R_DoneFreeType();
@@ -1374,6 +1387,7 @@ refexport_t *GetRefAPI ( int apiVersion, refimport_t *rimp ) {
 
 	re.SetColor = RE_SetColor;
 	re.DrawStretchPic = RE_StretchPic;
+	re.DrawStretchPics = RE_StretchPics;
 	re.DrawStretchRaw = RE_StretchRaw;
 	re.UploadCinematic = RE_UploadCinematic;
 
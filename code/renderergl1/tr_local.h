@@ -37,10 +37,12 @@ QGL_1_1_PROCS;
 QGL_1_1_FIXED_FUNCTION_PROCS;
 QGL_DESKTOP_1_1_PROCS;
 QGL_DESKTOP_1_1_FIXED_FUNCTION_PROCS;
+QGL_1_5_PROCS;
 QGL_3_0_PROCS;
 #undef GLE
 
 #define GL_INDEX_TYPE		GL_UNSIGNED_INT
+#define BUFFER_OFFSET(i) ((char *)NULL + (i))
 typedef unsigned int glIndex_t;
 
 // 14 bits
@@ -362,6 +364,9 @@ typedef struct shader_s {
 	qboolean	needsST2;
 	qboolean	needsColor;
 
+	qboolean	vboStatic;				// stages only read unmodified vertex data, so
+										// world surfaces can draw from tr.worldVbo
+
 	int			numDeforms;
 	deformStage_t	deforms[MAX_SHADER_DEFORMS];
 
@@ -461,6 +466,7 @@ typedef struct {
 	int			frameCount;			// copied from tr.frameCount
 	cplane_t	portalPlane;		// clip anything behind this if mirroring
 	int			viewportX, viewportY, viewportWidth, viewportHeight;
+	int			scissorX, scissorY, scissorWidth, scissorHeight;	// portal views only draw the portal's bounds
 	float		fovX, fovY;
 	float		projectionMatrix[16];
 	cplane_t	frustum[4];
@@ -507,12 +513,14 @@ typedef struct drawSurf_s {
 #define	MAX_GRID_SIZE		65			// max dimensions of a grid mesh in memory
 
 // when cgame directly specifies a polygon, it becomes a srfPoly_t
-// as soon as it is called
+// as soon as it is called, or is appended to the previous one when
+// it has the same shader, fog and vertex count
 typedef struct srfPoly_s {
 	surfaceType_t	surfaceType;
 	qhandle_t		hShader;
 	int				fogIndex;
-	int				numVerts;
+	int				numVerts;		// all fans
+	int				numFanVerts;	// each fan
 	polyVert_t		*verts;
 } srfPoly_t;
 
@@ -587,6 +595,10 @@ typedef struct {
 
 	int				numVerts;
 	drawVert_t		*verts;
+
+	// set when verts were also uploaded to tr.worldVbo
+	qboolean		inWorldVbo;
+	int				vboFirstVertex;
 } srfTriangles_t;
 
 typedef struct {
@@ -970,6 +982,8 @@ typedef struct {
 	float					sawToothTable[FUNCTABLE_SIZE];
 	float					inverseSawToothTable[FUNCTABLE_SIZE];
 	float					fogTable[FOG_TABLE_SIZE];
+
+	GLuint					worldVbo;		// static vertexes of a CoD1 world, 0 if none
 } trGlobals_t;
 
 extern backEndState_t	backEnd;
@@ -1002,6 +1016,7 @@ extern cvar_t	*r_measureOverdraw;		// enables stencil buffer overdraw measuremen
 extern cvar_t	*r_lodbias;				// push/pull LOD transitions
 extern cvar_t	*r_lodscale;
 
+extern cvar_t	*r_worldVBO;			// draw static CoD1 world surfaces from a vertex buffer
 extern cvar_t	*r_primitives;			// "0" = based on compiled vertex array existence
 										// "1" = glDrawElemet tristrips
 										// "2" = glDrawElements triangles
@@ -1247,6 +1262,8 @@ typedef struct shaderCommands_s
 	int			numIndexes;
 	int			numVertexes;
 
+	qboolean	useWorldVbo;	// indexes point into tr.worldVbo, not xyz
+
 	// info extracted from current shader
 	int			numPasses;
 	void		(*currentStageIteratorFunc)( void );
@@ -1567,7 +1584,7 @@ typedef enum {
 // the limits apply to the sum of all scenes in a frame --
 // the main view, all the 3D icons, etc
 #define	MAX_POLYS		600
-#define	MAX_POLYVERTS	4096
+#define	MAX_POLYVERTS	32768
 
 // all of the information needed by the back end must be
 // contained in a backEndData_t
@@ -1596,6 +1613,7 @@ void R_AddDrawSurfCmd( drawSurf_t *drawSurfs, int numDrawSurfs );
 void RE_SetColor( const float *rgba );
 void RE_StretchPic ( float x, float y, float w, float h, 
 					  float s1, float t1, float s2, float t2, qhandle_t hShader );
+void RE_StretchPics( int numPics, const stretchPic_t *pics );
 void RE_BeginFrame( stereoFrame_t stereoFrame );
 void RE_EndFrame( int *frontEndMsec, int *backEndMsec );
 void RE_SaveJPG(char * filename, int quality, int image_width, int image_height,
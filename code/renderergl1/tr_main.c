@@ -559,6 +559,52 @@ void R_SetupProjection(viewParms_t *dest, float zProj, qboolean computeFrustum)
 		R_SetupFrustum(dest, xmin, xmax, ymax, zProj, stereoSep);
 }
 
+/*
+===============
+R_SetupScissorFrustum
+
+Narrows the frustum to the planes through the eye and the edges of the
+scissor rectangle
+===============
+*/
+static void R_SetupScissorFrustum( viewParms_t *dest, float zProj )
+{
+	float	xmax, ymax, left, right, bottom, top;
+	int		i;
+
+	// stereo views offset the frustum, keep the full one
+	if ( dest->stereoFrame != STEREO_CENTER && r_stereoSeparation->value != 0 )
+		return;
+
+	xmax = zProj * tan( dest->fovX * M_PI / 360.0f );
+	ymax = zProj * tan( dest->fovY * M_PI / 360.0f );
+
+	left = xmax * ( 2.0f * ( dest->scissorX - dest->viewportX ) / dest->viewportWidth - 1 );
+	right = xmax * ( 2.0f * ( dest->scissorX + dest->scissorWidth - dest->viewportX ) / dest->viewportWidth - 1 );
+	bottom = ymax * ( 2.0f * ( dest->scissorY - dest->viewportY ) / dest->viewportHeight - 1 );
+	top = ymax * ( 2.0f * ( dest->scissorY + dest->scissorHeight - dest->viewportY ) / dest->viewportHeight - 1 );
+
+	// axis[1] points left and axis[2] up
+	VectorScale( dest->or.axis[0], right, dest->frustum[0].normal );
+	VectorMA( dest->frustum[0].normal, zProj, dest->or.axis[1], dest->frustum[0].normal );
+
+	VectorScale( dest->or.axis[0], -left, dest->frustum[1].normal );
+	VectorMA( dest->frustum[1].normal, -zProj, dest->or.axis[1], dest->frustum[1].normal );
+
+	VectorScale( dest->or.axis[0], -bottom, dest->frustum[2].normal );
+	VectorMA( dest->frustum[2].normal, zProj, dest->or.axis[2], dest->frustum[2].normal );
+
+	VectorScale( dest->or.axis[0], top, dest->frustum[3].normal );
+	VectorMA( dest->frustum[3].normal, -zProj, dest->or.axis[2], dest->frustum[3].normal );
+
+	for ( i = 0 ; i < 4 ; i++ ) {
+		VectorNormalize( dest->frustum[i].normal );
+		dest->frustum[i].type = PLANE_NON_AXIAL;
+		dest->frustum[i].dist = DotProduct( dest->or.origin, dest->frustum[i].normal );
+		SetPlaneSignbits( &dest->frustum[i] );
+	}
+}
+
 /*
 ===============
 R_SetupProjectionZ
@@ -844,9 +890,10 @@ static qboolean IsMirror( const drawSurf_t *drawSurf, int entityNum )
 /*
 ** SurfIsOffscreen
 **
-** Determines if a surface is completely offscreen.
+** Determines if a surface is completely offscreen, and if not the window
+** rectangle it covers.
 */
-static qboolean SurfIsOffscreen( const drawSurf_t *drawSurf, vec4_t clipDest[128] ) {
+static qboolean SurfIsOffscreen( const drawSurf_t *drawSurf, int bounds[4] ) {
 	float shortest = 100000000;
 	int entityNum;
 	int numTriangles;
@@ -856,6 +903,8 @@ static qboolean SurfIsOffscreen( const drawSurf_t *drawSurf, vec4_t clipDest[128
 	vec4_t clip, eye;
 	int i;
 	unsigned int pointAnd = (unsigned int)~0;
+	float mins[2] = { 1, 1 }, maxs[2] = { -1, -1 };
+	qboolean behind = qfalse;
 
 	R_RotateForViewer();
 
@@ -884,6 +933,18 @@ static qboolean SurfIsOffscreen( const drawSurf_t *drawSurf, vec4_t clipDest[128
 			}
 		}
 		pointAnd &= pointFlags;
+
+		// normalized device coordinates of the points in front of the eye
+		if ( clip[3] <= 0 )
+		{
+			behind = qtrue;
+			continue;
+		}
+		for ( j = 0; j < 2; j++ )
+		{
+			mins[j] = MIN( mins[j], clip[j] / clip[3] );
+			maxs[j] = MAX( maxs[j], clip[j] / clip[3] );
+		}
 	}
 
 	// trivially reject
@@ -892,6 +953,21 @@ static qboolean SurfIsOffscreen( const drawSurf_t *drawSurf, vec4_t clipDest[128
 		return qtrue;
 	}
 
+	// a surface crossing the eye plane can cover any of the screen
+	if ( behind )
+	{
+		mins[0] = mins[1] = -1;
+		maxs[0] = maxs[1] = 1;
+	}
+	bounds[0] = tr.viewParms.viewportX + floor( ( Com_Clamp( -1, 1, mins[0] ) + 1 ) * 0.5f * tr.viewParms.viewportWidth );
+	bounds[1] = tr.viewParms.viewportY + floor( ( Com_Clamp( -1, 1, mins[1] ) + 1 ) * 0.5f * tr.viewParms.viewportHeight );
+	bounds[2] = tr.viewParms.viewportX + ceil( ( Com_Clamp( -1, 1, maxs[0] ) + 1 ) * 0.5f * tr.viewParms.viewportWidth );
+	bounds[3] = tr.viewParms.viewportY + ceil( ( Com_Clamp( -1, 1, maxs[1] ) + 1 ) * 0.5f * tr.viewParms.viewportHeight );
+	if ( bounds[2] <= bounds[0] || bounds[3] <= bounds[1] )
+	{
+		return qtrue;
+	}
+
 	// determine if this surface is backfaced and also determine the distance
 	// to the nearest vertex so we can cull based on portal range.  Culling
 	// based on vertex distance isn't 100% correct (we should be checking for
@@ -945,7 +1021,7 @@ Returns qtrue if another view has been rendered
 ========================
 */
 qboolean R_MirrorViewBySurface (drawSurf_t *drawSurf, int entityNum) {
-	vec4_t			clipDest[128];
+	int				bounds[4];
 	viewParms_t		newParms;
 	viewParms_t		oldParms;
 	orientation_t	surface, camera;
@@ -961,7 +1037,7 @@ qboolean R_MirrorViewBySurface (drawSurf_t *drawSurf, int entityNum) {
 	}
 
 	// trivially reject portal/mirror
-	if ( SurfIsOffscreen( drawSurf, clipDest ) ) {
+	if ( SurfIsOffscreen( drawSurf, bounds ) ) {
 		return qfalse;
 	}
 
@@ -984,7 +1060,12 @@ qboolean R_MirrorViewBySurface (drawSurf_t *drawSurf, int entityNum) {
 	R_MirrorVector (oldParms.or.axis[1], &surface, &camera, newParms.or.axis[1]);
 	R_MirrorVector (oldParms.or.axis[2], &surface, &camera, newParms.or.axis[2]);
 
-	// OPTIMIZE: restrict the viewport on the mirrored view
+	// the mirrored view only shows through the portal's bounds on screen,
+	// so it is scissored and culled to them
+	newParms.scissorX = bounds[0];
+	newParms.scissorY = bounds[1];
+	newParms.scissorWidth = bounds[2] - bounds[0];
+	newParms.scissorHeight = bounds[3] - bounds[1];
 
 	// render the mirror view
 	R_RenderView (&newParms);
@@ -1361,6 +1442,8 @@ void R_RenderView (viewParms_t *parms) {
 		return;
 	}
 
+	ri.ProfileBegin( "R_RenderView" );
+
 	tr.viewCount++;
 
 	tr.viewParms = *parms;
@@ -1376,6 +1459,10 @@ void R_RenderView (viewParms_t *parms) {
 
 	R_SetupProjection(&tr.viewParms, r_zproj->value, qtrue);
 
+	if ( tr.viewParms.scissorWidth ) {
+		R_SetupScissorFrustum( &tr.viewParms, r_zproj->value );
+	}
+
 	R_GenerateDrawSurfs();
 
 	// if we overflowed MAX_DRAWSURFS, the drawsurfs
@@ -1390,6 +1477,8 @@ void R_RenderView (viewParms_t *parms) {
 
 	// draw main system development information (surface outlines, etc)
 	R_DebugGraphics();
+
+	ri.ProfileEnd();
 }
 
 
@@ -109,6 +109,7 @@ RE_AddPolyToScene
 */
 void RE_AddPolyToScene( qhandle_t hShader, int numVerts, const polyVert_t *verts, int numPolys ) {
 	srfPoly_t	*poly;
+	polyVert_t	*dest;
 	int			i, j;
 	int			fogIndex;
 	fog_t		*fog;
@@ -135,23 +136,15 @@ void RE_AddPolyToScene( qhandle_t hShader, int numVerts, const polyVert_t *verts
 			return;
 		}
 
-		poly = &backEndData->polys[r_numpolys];
-		poly->surfaceType = SF_POLY;
-		poly->hShader = hShader;
-		poly->numVerts = numVerts;
-		poly->verts = &backEndData->polyVerts[r_numpolyverts];
-		
-		Com_Memcpy( poly->verts, &verts[numVerts*j], numVerts * sizeof( *verts ) );
+		dest = &backEndData->polyVerts[r_numpolyverts];
+		Com_Memcpy( dest, &verts[numVerts*j], numVerts * sizeof( *verts ) );
 
 		if ( glConfig.hardwareType == GLHW_RAGEPRO ) {
-			poly->verts->modulate[0] = 255;
-			poly->verts->modulate[1] = 255;
-			poly->verts->modulate[2] = 255;
-			poly->verts->modulate[3] = 255;
+			dest->modulate[0] = 255;
+			dest->modulate[1] = 255;
+			dest->modulate[2] = 255;
+			dest->modulate[3] = 255;
 		}
-		// done.
-		r_numpolys++;
-		r_numpolyverts += numVerts;
 
 		// if no world is loaded
 		if ( tr.world == NULL ) {
@@ -162,10 +155,10 @@ void RE_AddPolyToScene( qhandle_t hShader, int numVerts, const polyVert_t *verts
 			fogIndex = 0;
 		} else {
 			// find which fog volume the poly is in
-			VectorCopy( poly->verts[0].xyz, bounds[0] );
-			VectorCopy( poly->verts[0].xyz, bounds[1] );
-			for ( i = 1 ; i < poly->numVerts ; i++ ) {
-				AddPointToBounds( poly->verts[i].xyz, bounds[0], bounds[1] );
+			VectorCopy( dest[0].xyz, bounds[0] );
+			VectorCopy( dest[0].xyz, bounds[1] );
+			for ( i = 1 ; i < numVerts ; i++ ) {
+				AddPointToBounds( dest[i].xyz, bounds[0], bounds[1] );
 			}
 			for ( fogIndex = 1 ; fogIndex < tr.world->numfogs ; fogIndex++ ) {
 				fog = &tr.world->fogs[fogIndex]; 
@@ -182,7 +175,28 @@ void RE_AddPolyToScene( qhandle_t hShader, int numVerts, const polyVert_t *verts
 				fogIndex = 0;
 			}
 		}
+
+		r_numpolyverts += numVerts;
+
+		// a poly just like the previous one extends its surface instead
+		// of adding another draw surface
+		if ( r_numpolys > r_firstScenePoly ) {
+			poly = &backEndData->polys[r_numpolys - 1];
+			if ( poly->hShader == hShader && poly->fogIndex == fogIndex
+				&& poly->numFanVerts == numVerts && poly->verts + poly->numVerts == dest ) {
+				poly->numVerts += numVerts;
+				continue;
+			}
+		}
+
+		poly = &backEndData->polys[r_numpolys];
+		poly->surfaceType = SF_POLY;
+		poly->hShader = hShader;
 		poly->fogIndex = fogIndex;
+		poly->numVerts = numVerts;
+		poly->numFanVerts = numVerts;
+		poly->verts = dest;
+		r_numpolys++;
 	}
 }
 
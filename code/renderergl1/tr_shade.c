@@ -325,6 +325,7 @@ void RB_BeginSurface( shader_t *shader, int fogNum ) {
 	tess.shader = state;
 	tess.fogNum = fogNum;
 	tess.dlightBits = 0;		// will be OR'd in by surface functions
+	tess.useWorldVbo = qfalse;
 	tess.xstages = state->stages;
 	tess.numPasses = state->numUnfoggedPasses;
 	tess.currentStageIteratorFunc = state->optimalStageIteratorFunc;
@@ -1282,6 +1283,136 @@ void RB_StageIteratorLightmappedMultitexture( void ) {
 	}
 }
 
+/*
+** RB_WorldVboStageColor
+
+Returns qfalse when the stage takes its colors from the vertexes,
+otherwise the single color ComputeColors would give every vertex.
+*/
+static qboolean RB_WorldVboStageColor( shaderStage_t *pStage, byte color[4] ) {
+	switch ( pStage->rgbGen )
+	{
+	case CGEN_IDENTITY:
+		color[0] = color[1] = color[2] = color[3] = 0xff;
+		break;
+	case CGEN_IDENTITY_LIGHTING:
+		color[0] = color[1] = color[2] = color[3] = tr.identityLightByte;
+		break;
+	case CGEN_CONST:
+		*(int *)color = *(int *)pStage->constantColor;
+		break;
+	default:
+		return qfalse;
+	}
+
+	if ( pStage->alphaGen == AGEN_IDENTITY ) {
+		color[3] = 0xff;
+	} else if ( pStage->alphaGen == AGEN_CONST ) {
+		color[3] = pStage->constantColor[3];
+	}
+
+	return qtrue;
+}
+
+static void RB_WorldVboTexCoordPointer( textureBundle_t *bundle ) {
+	if ( bundle->tcGen == TCGEN_LIGHTMAP ) {
+		qglTexCoordPointer( 2, GL_FLOAT, sizeof( drawVert_t ), BUFFER_OFFSET( offsetof( drawVert_t, lightmap ) ) );
+	} else {
+		qglTexCoordPointer( 2, GL_FLOAT, sizeof( drawVert_t ), BUFFER_OFFSET( offsetof( drawVert_t, st ) ) );
+	}
+}
+
+/*
+** RB_StageIteratorWorldVbo
+
+Draws a batch whose indexes point into tr.worldVbo. Only vboStatic
+shaders without fog or dynamic lights get here, so every stage can read
+its texture coordinates and colors straight from the buffer.
+*/
+static void RB_StageIteratorWorldVbo( void ) {
+	shaderCommands_t *input;
+	shader_t		*shader;
+	byte			color[4];
+	int				stage;
+
+	input = &tess;
+	shader = input->shader;
+
+	if ( r_logFile->integer ) {
+		GLimp_LogComment( va("--- RB_StageIteratorWorldVbo( %s ) ---\n", tess.shader->name) );
+	}
+
+	GL_Cull( shader->cullType );
+
+	if ( shader->polygonOffset ) {
+		qglEnable( GL_POLYGON_OFFSET_FILL );
+		qglPolygonOffset( r_offsetFactor->value, r_offsetUnits->value );
+	}
+
+	qglBindBuffer( GL_ARRAY_BUFFER, tr.worldVbo );
+	qglVertexPointer( 3, GL_FLOAT, sizeof( drawVert_t ), BUFFER_OFFSET( offsetof( drawVert_t, xyz ) ) );
+
+	for ( stage = 0; stage < MAX_SHADER_STAGES; stage++ ) {
+		shaderStage_t *pStage = tess.xstages[stage];
+
+		if ( !pStage ) {
+			break;
+		}
+
+		if ( RB_WorldVboStageColor( pStage, color ) ) {
+			qglDisableClientState( GL_COLOR_ARRAY );
+			qglColor4ubv( color );
+		} else {
+			qglEnableClientState( GL_COLOR_ARRAY );
+			qglColorPointer( 4, GL_UNSIGNED_BYTE, sizeof( drawVert_t ), BUFFER_OFFSET( offsetof( drawVert_t, color ) ) );
+		}
+
+		GL_State( pStage->stateBits );
+
+		qglEnableClientState( GL_TEXTURE_COORD_ARRAY );
+		RB_WorldVboTexCoordPointer( &pStage->bundle[0] );
+		R_BindAnimatedImage( &pStage->bundle[0] );
+
+		if ( pStage->bundle[1].image[0] != 0 ) {
+			// same GeForce clip plane workaround as DrawMultitextured
+			if ( backEnd.viewParms.isPortal ) {
+				qglPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
+			}
+
+			GL_SelectTexture( 1 );
+			qglEnable( GL_TEXTURE_2D );
+			qglEnableClientState( GL_TEXTURE_COORD_ARRAY );
+
+			if ( r_lightmap->integer ) {
+				GL_TexEnv( GL_REPLACE );
+			} else {
+				GL_TexEnv( tess.shader->multitextureEnv );
+			}
+
+			RB_WorldVboTexCoordPointer( &pStage->bundle[1] );
+			R_BindAnimatedImage( &pStage->bundle[1] );
+
+			qglDrawElements( GL_TRIANGLES, input->numIndexes, GL_INDEX_TYPE, input->indexes );
+
+			qglDisable( GL_TEXTURE_2D );
+			GL_SelectTexture( 0 );
+		} else {
+			qglDrawElements( GL_TRIANGLES, input->numIndexes, GL_INDEX_TYPE, input->indexes );
+		}
+
+		// allow skipping out to show just lightmaps during development
+		if ( r_lightmap->integer && ( pStage->bundle[0].isLightmap || pStage->bundle[1].isLightmap ) ) {
+			break;
+		}
+	}
+
+	qglBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	if ( shader->polygonOffset ) {
+		qglDisable( GL_POLYGON_OFFSET_FILL );
+	}
+}
+
 /*
 ** RB_EndSurface
 */
@@ -1322,7 +1453,11 @@ void RB_EndSurface( void ) {
 	//
 	// call off to shader specific tess end function
 	//
-	tess.currentStageIteratorFunc();
+	if ( tess.useWorldVbo ) {
+		RB_StageIteratorWorldVbo();
+	} else {
+		tess.currentStageIteratorFunc();
+	}
 
 	//
 	// draw debugging stuff
@@ -1775,6 +1775,80 @@ static void ComputeStageIteratorFunc( void )
 	}
 }
 
+/*
+===================
+ComputeVboStatic
+
+A shader is static when no stage generates or animates its vertex
+data, so world surfaces using it can be drawn straight from
+tr.worldVbo. Colors must be either constant for the whole stage or
+the unmodified vertex colors.
+===================
+*/
+static qboolean StageIsStatic( shaderStage_t *pStage )
+{
+	int		b;
+
+	for ( b = 0; b < NUM_TEXTURE_BUNDLES; b++ )
+	{
+		if ( b && !pStage->bundle[b].image[0] )
+		{
+			break;
+		}
+		if ( pStage->bundle[b].tcGen != TCGEN_TEXTURE && pStage->bundle[b].tcGen != TCGEN_LIGHTMAP )
+		{
+			return qfalse;
+		}
+		if ( pStage->bundle[b].numTexMods )
+		{
+			return qfalse;
+		}
+	}
+
+	switch ( pStage->rgbGen )
+	{
+	case CGEN_IDENTITY:
+	case CGEN_IDENTITY_LIGHTING:
+	case CGEN_CONST:
+		return pStage->alphaGen == AGEN_SKIP || pStage->alphaGen == AGEN_IDENTITY
+			|| pStage->alphaGen == AGEN_CONST;
+	case CGEN_VERTEX:
+		if ( tr.identityLight != 1 )
+		{
+			return qfalse;
+		}
+		// AGEN_IDENTITY keeps the vertex alpha here, see ComputeColors
+		return pStage->alphaGen == AGEN_SKIP || pStage->alphaGen == AGEN_VERTEX
+			|| pStage->alphaGen == AGEN_IDENTITY;
+	case CGEN_EXACT_VERTEX:
+		return pStage->alphaGen == AGEN_SKIP || pStage->alphaGen == AGEN_VERTEX;
+	default:
+		return qfalse;
+	}
+}
+
+static void ComputeVboStatic( void )
+{
+	int		stage;
+
+	shader.vboStatic = qfalse;
+
+	if ( shader.isSky || shader.numDeforms || shader.sort == SS_PORTAL || !shader.numUnfoggedPasses )
+	{
+		return;
+	}
+
+	for ( stage = 0; stage < shader.numUnfoggedPasses; stage++ )
+	{
+		if ( !StageIsStatic( &stages[stage] ) )
+		{
+			return;
+		}
+	}
+
+	shader.vboStatic = qtrue;
+}
+
 typedef struct {
 	int		blendA;
 	int		blendB;
@@ -2393,6 +2467,7 @@ static shader_t *FinishShader( void ) {
 
 	// determine which stage iterator function is appropriate
 	ComputeStageIteratorFunc();
+	ComputeVboStatic();
 
 	return GeneratePermanentShader();
 }
@@ -187,34 +187,74 @@ RB_SurfacePolychain
 =============
 */
 static void RB_SurfacePolychain( srfPoly_t *p ) {
-	int		i;
+	int		i, j;
 	int		numv;
+	polyVert_t	*v;
+
+	// merged polys are stored as consecutive fans of numFanVerts
+	for ( j = 0, v = p->verts; j < p->numVerts; j += p->numFanVerts, v += p->numFanVerts ) {
+		RB_CHECKOVERFLOW( p->numFanVerts, 3*(p->numFanVerts - 2) );
+
+		// fan triangles into the tess array
+		numv = tess.numVertexes;
+		for ( i = 0; i < p->numFanVerts; i++ ) {
+			VectorCopy( v[i].xyz, tess.xyz[numv] );
+			tess.texCoords[numv][0][0] = v[i].st[0];
+			tess.texCoords[numv][0][1] = v[i].st[1];
+			*(int *)&tess.vertexColors[numv] = *(int *)v[ i ].modulate;
+
+			numv++;
+		}
+
+		// generate fan indexes into the tess array
+		for ( i = 0; i < p->numFanVerts-2; i++ ) {
+			tess.indexes[tess.numIndexes + 0] = tess.numVertexes;
+			tess.indexes[tess.numIndexes + 1] = tess.numVertexes + i + 1;
+			tess.indexes[tess.numIndexes + 2] = tess.numVertexes + i + 2;
+			tess.numIndexes += 3;
+		}
 
-	RB_CHECKOVERFLOW( p->numVerts, 3*(p->numVerts - 2) );
+		tess.numVertexes = numv;
+	}
+}
+
+
+/*
+=============
+RB_SurfaceTrianglesVbo
 
-	// fan triangles into the tess array
-	numv = tess.numVertexes;
-	for ( i = 0; i < p->numVerts; i++ ) {
-		VectorCopy( p->verts[i].xyz, tess.xyz[numv] );
-		tess.texCoords[numv][0][0] = p->verts[i].st[0];
-		tess.texCoords[numv][0][1] = p->verts[i].st[1];
-		*(int *)&tess.vertexColors[numv] = *(int *)p->verts[ i ].modulate;
+Surfaces already in tr.worldVbo only need their indexes rebased when
+the shader leaves their vertexes untouched. Anything that has to see
+the vertexes in tess (fog, dlights, debug views) takes the copy path.
+=============
+*/
+static qboolean RB_SurfaceTrianglesVbo( srfTriangles_t *srf ) {
+	int			i;
+	glIndex_t	*indexes;
 
-		numv++;
+	if ( !srf->inWorldVbo || !tess.shader->vboStatic ) {
+		return qfalse;
+	}
+	if ( tess.fogNum || srf->dlightBits || tess.numVertexes ) {
+		return qfalse;
 	}
+	if ( r_showtris->integer || r_shownormals->integer ) {
+		return qfalse;
+	}
+
+	RB_CHECKOVERFLOW( 0, srf->numIndexes );
+
+	tess.useWorldVbo = qtrue;
 
-	// generate fan indexes into the tess array
-	for ( i = 0; i < p->numVerts-2; i++ ) {
-		tess.indexes[tess.numIndexes + 0] = tess.numVertexes;
-		tess.indexes[tess.numIndexes + 1] = tess.numVertexes + i + 1;
-		tess.indexes[tess.numIndexes + 2] = tess.numVertexes + i + 2;
-		tess.numIndexes += 3;
+	indexes = tess.indexes + tess.numIndexes;
+	for ( i = 0 ; i < srf->numIndexes ; i++ ) {
+		indexes[i] = srf->vboFirstVertex + srf->indexes[i];
 	}
+	tess.numIndexes += srf->numIndexes;
 
-	tess.numVertexes = numv;
+	return qtrue;
 }
 
-
 /*
 =============
 RB_SurfaceTriangles
@@ -228,6 +268,14 @@ static void RB_SurfaceTriangles( srfTriangles_t *srf ) {
 	int			dlightBits;
 	qboolean	needsNormal;
 
+	if ( RB_SurfaceTrianglesVbo( srf ) ) {
+		return;
+	}
+	if ( tess.useWorldVbo ) {
+		RB_EndSurface();
+		RB_BeginSurface( tess.shader, tess.fogNum );
+	}
+
 	dlightBits = srf->dlightBits;
 	tess.dlightBits |= dlightBits;
 
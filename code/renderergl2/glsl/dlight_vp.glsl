@@ -11,7 +11,17 @@ uniform float  u_Time;
 #endif
 
 uniform vec4   u_Color;
+#if defined(USE_UBO)
+layout(std140) uniform Entity
+{
+	mat4   u_ModelViewProjectionMatrix;
+	mat4   u_ModelMatrix;
+	vec3   u_ViewOrigin;
+	vec3   u_LocalViewOrigin;
+};
+#else
 uniform mat4   u_ModelViewProjectionMatrix;
+#endif
 
 varying vec2   var_Tex1;
 varying vec4   var_Color;
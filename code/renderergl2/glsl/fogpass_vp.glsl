@@ -21,10 +21,25 @@ uniform float   u_DeformParams[5];
 #endif
 
 uniform float   u_Time;
+#if defined(USE_UBO)
+layout(std140) uniform Entity
+{
+	mat4   u_ModelViewProjectionMatrix;
+	mat4   u_ModelMatrix;
+	vec3   u_ViewOrigin;
+	vec3   u_LocalViewOrigin;
+};
+#else
 uniform mat4    u_ModelViewProjectionMatrix;
+#endif
 
 #if defined(USE_VERTEX_ANIMATION)
 uniform float   u_VertexLerp;
+#elif defined(USE_BONE_ANIMATION) && defined(USE_UBO)
+layout(std140) uniform Bones
+{
+	mat4   u_BoneMatrix[MAX_GLSL_BONES];
+};
 #elif defined(USE_BONE_ANIMATION)
 uniform mat4 u_BoneMatrix[MAX_GLSL_BONES];
 #endif
@@ -27,6 +27,18 @@ void main()
 		if (alpha < 0.5)
 			discard;
 	}
+	else if (u_AlphaTest == 4)
+	{
+		// signed distance field, the edge sits at 0.5
+#if defined(USE_DERIVATIVES)
+		float width = clamp(fwidth(color.a) * 0.75, 1.0 / 255.0, 0.5);
+#else
+		float width = 0.0625;
+#endif
+		alpha = smoothstep(0.5 - width, 0.5 + width, color.a) * var_Color.a;
+		if (alpha == 0.0)
+			discard;
+	}
 	
 	gl_FragColor.rgb = color.rgb * var_Color.rgb;
 	gl_FragColor.a = alpha;
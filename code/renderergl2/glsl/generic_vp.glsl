@@ -27,7 +27,7 @@ uniform vec4   u_DiffuseTexMatrix6;
 uniform vec4   u_DiffuseTexMatrix7;
 #endif
 
-#if defined(USE_TCGEN) || defined(USE_RGBAGEN)
+#if (defined(USE_TCGEN) || defined(USE_RGBAGEN)) && !defined(USE_UBO)
 uniform vec3   u_LocalViewOrigin;
 #endif
 
@@ -50,7 +50,17 @@ uniform float  u_DeformParams[5];
 uniform float  u_Time;
 #endif
 
+#if defined(USE_UBO)
+layout(std140) uniform Entity
+{
+	mat4   u_ModelViewProjectionMatrix;
+	mat4   u_ModelMatrix;
+	vec3   u_ViewOrigin;
+	vec3   u_LocalViewOrigin;
+};
+#else
 uniform mat4   u_ModelViewProjectionMatrix;
+#endif
 uniform vec4   u_BaseColor;
 uniform vec4   u_VertColor;
 
@@ -65,6 +75,11 @@ uniform float  u_PortalRange;
 
 #if defined(USE_VERTEX_ANIMATION)
 uniform float  u_VertexLerp;
+#elif defined(USE_BONE_ANIMATION) && defined(USE_UBO)
+layout(std140) uniform Bones
+{
+	mat4   u_BoneMatrix[MAX_GLSL_BONES];
+};
 #elif defined(USE_BONE_ANIMATION)
 uniform mat4 u_BoneMatrix[MAX_GLSL_BONES];
 #endif
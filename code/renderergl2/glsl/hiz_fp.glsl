@@ -0,0 +1,30 @@
+uniform sampler2D u_TextureMap;
+
+uniform vec2      u_InvTexRes;
+uniform vec4      u_ViewInfo; // footprint width, footprint height, zero, zero
+varying vec2      var_TexCoords;
+
+// keeps the farthest depth under each texel, so a box in front of it is
+// in front of everything it covers
+void main()
+{
+	vec2 start = floor(var_TexCoords / u_InvTexRes - 0.5 * u_ViewInfo.xy);
+	float depth = 0.0;
+
+	// loop bounds must be constant, HIZ_MAX_FOOTPRINT in tr_local.h
+	for (int y = 0; y < 33; y++)
+	{
+		if (float(y) > u_ViewInfo.y)
+			break;
+
+		for (int x = 0; x < 33; x++)
+		{
+			if (float(x) > u_ViewInfo.x)
+				break;
+
+			depth = max(depth, texture2D(u_TextureMap, (start + vec2(x, y) + 0.5) * u_InvTexRes).r);
+		}
+	}
+
+	gl_FragColor = vec4(depth, depth, depth, 1.0);
+}
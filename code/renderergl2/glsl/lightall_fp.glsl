@@ -68,6 +68,18 @@ varying vec4      var_LightDir;
 varying vec4      var_PrimaryLightDir;
 #endif
 
+#if defined(USE_DLIGHT_CLUSTERS)
+uniform sampler2D u_DlightClusterMap;
+uniform vec4      u_DlightClusterTile;  // viewport x, y, tiles per pixel x, y
+uniform vec4      u_DlightClusterPlane; // view forward, -dot(forward, view origin)
+uniform vec4      u_DlightClusterSlice; // slices per log2 depth, 1 / zNear, 0 = off
+uniform vec4      u_DlightOrigins[MAX_DLIGHTS]; // origin, 1 / radius^2
+uniform vec4      u_DlightColors[MAX_DLIGHTS];  // color, 1 = additive
+
+varying vec3      var_DlightPosition;
+varying vec3      var_DlightNormal;
+#endif
+
 
 #define EPSILON 0.00000001
 
@@ -257,6 +269,61 @@ vec4 hitCube(vec3 ray, vec3 pos, vec3 invSize, float lod, samplerCube tex)
 }
 #endif
 
+#if defined(USE_DLIGHT_CLUSTERS)
+vec3 AddClusterDlights(vec3 litColor)
+{
+	if (u_DlightClusterSlice.z == 0.0)
+		return litColor;
+
+	vec2 tile = floor((gl_FragCoord.xy - u_DlightClusterTile.xy) * u_DlightClusterTile.zw);
+	tile = clamp(tile, vec2(0.0), vec2(DLIGHT_CLUSTERS_X - 1.0, DLIGHT_CLUSTERS_Y - 1.0));
+
+	float depth = dot(var_DlightPosition, u_DlightClusterPlane.xyz) + u_DlightClusterPlane.w;
+	float slice = floor(log2(max(depth * u_DlightClusterSlice.y, 1.0)) * u_DlightClusterSlice.x);
+	slice = min(slice, DLIGHT_CLUSTERS_Z - 1.0);
+
+	vec2 st = (vec2(slice * DLIGHT_CLUSTERS_X + tile.x, tile.y) + vec2(0.5)) / vec2(DLIGHT_CLUSTERS_X * DLIGHT_CLUSTERS_Z, DLIGHT_CLUSTERS_Y);
+	vec4 mask = floor(texture2D(u_DlightClusterMap, st) * 255.0 + vec4(0.5));
+
+	vec3 modulate = vec3(0.0);
+	vec3 add = vec3(0.0);
+
+	// light i is bit i % 8 of channel i / 8
+	for (int c = 0; c < 4; c++)
+	{
+		float bits = mask[c];
+
+		for (int b = 0; b < 8; b++)
+		{
+			if (bits < 0.5)
+				break;
+
+			float bit = mod(bits, 2.0);
+			bits = floor(bits * 0.5);
+
+			if (bit < 0.5)
+				continue;
+
+			// index with loop counters only, GLSL ES 1.00 allows no more
+			vec4 origin = u_DlightOrigins[c * 8 + b];
+			vec4 color = u_DlightColors[c * 8 + b];
+			vec3 dist = origin.xyz - var_DlightPosition;
+
+			// close to the falloff of the q3 dlight image, zero at the radius
+			float attenuation = clamp(0.3 / max(dot(dist, dist) * origin.w, 0.0001) - 0.3, 0.0, 1.0);
+			attenuation *= step(0.0, dot(dist, var_DlightNormal));
+
+			vec3 light = color.rgb * attenuation;
+			modulate += light * (1.0 - color.a);
+			add      += light * color.a;
+		}
+	}
+
+	// same as blending the q3 dlight pass, dst * (1 + light) or dst + light
+	return litColor * (vec3(1.0) + modulate) + add;
+}
+#endif
+
 void main()
 {
 	vec3 viewDir, lightColor, ambientColor, reflectance;
@@ -517,5 +584,9 @@ void main()
 
 #endif
 
+#if defined(USE_DLIGHT_CLUSTERS)
+	gl_FragColor.rgb = AddClusterDlights(gl_FragColor.rgb);
+#endif
+
 	gl_FragColor.a = alpha;
 }
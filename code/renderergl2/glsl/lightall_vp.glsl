@@ -25,7 +25,7 @@ attribute vec3 attr_LightDirection;
 uniform vec4   u_EnableTextures; // x = normal, y = deluxe, z = specular, w = cube
 #endif
 
-#if defined(USE_LIGHT) && !defined(USE_FAST_LIGHT)
+#if defined(USE_LIGHT) && !defined(USE_FAST_LIGHT) && !defined(USE_UBO)
 uniform vec3   u_ViewOrigin;
 #endif
 
@@ -33,8 +33,10 @@ uniform vec3   u_ViewOrigin;
 uniform int    u_TCGen0;
 uniform vec3   u_TCGen0Vector0;
 uniform vec3   u_TCGen0Vector1;
+#if !defined(USE_UBO)
 uniform vec3   u_LocalViewOrigin;
 #endif
+#endif
 
 #if defined(USE_TCMOD)
 uniform vec4   u_DiffuseTexMatrix0;
@@ -47,16 +49,31 @@ uniform vec4   u_DiffuseTexMatrix6;
 uniform vec4   u_DiffuseTexMatrix7;
 #endif
 
+#if defined(USE_UBO)
+layout(std140) uniform Entity
+{
+	mat4   u_ModelViewProjectionMatrix;
+	mat4   u_ModelMatrix;
+	vec3   u_ViewOrigin;
+	vec3   u_LocalViewOrigin;
+};
+#else
 uniform mat4   u_ModelViewProjectionMatrix;
+#endif
 uniform vec4   u_BaseColor;
 uniform vec4   u_VertColor;
 
-#if defined(USE_MODELMATRIX)
+#if defined(USE_MODELMATRIX) && !defined(USE_UBO)
 uniform mat4   u_ModelMatrix;
 #endif
 
 #if defined(USE_VERTEX_ANIMATION)
 uniform float  u_VertexLerp;
+#elif defined(USE_BONE_ANIMATION) && defined(USE_UBO)
+layout(std140) uniform Bones
+{
+	mat4   u_BoneMatrix[MAX_GLSL_BONES];
+};
 #elif defined(USE_BONE_ANIMATION)
 uniform mat4 u_BoneMatrix[MAX_GLSL_BONES];
 #endif
@@ -73,6 +90,11 @@ uniform vec4  u_PrimaryLightOrigin;
 uniform float u_PrimaryLightRadius;
 #endif
 
+#if defined(USE_DLIGHT_CLUSTERS)
+varying vec3   var_DlightPosition;
+varying vec3   var_DlightNormal;
+#endif
+
 varying vec4   var_TexCoords;
 
 varying vec4   var_Color;
@@ -222,6 +244,11 @@ void main()
   #endif
 #endif
 
+#if defined(USE_DLIGHT_CLUSTERS)
+	var_DlightPosition = position;
+	var_DlightNormal   = normal;
+#endif
+
 #if defined(USE_LIGHT) && !defined(USE_FAST_LIGHT)
 	vec3 bitangent = cross(normal, tangent) * attr_Tangent.w;
 #endif
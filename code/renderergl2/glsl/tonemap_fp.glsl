@@ -7,6 +7,12 @@ uniform vec4      u_Color;
 uniform vec2      u_AutoExposureMinMax;
 uniform vec3      u_ToneMinAvgMaxLinear;
 
+#if defined(USE_SSAO)
+uniform sampler2D u_ScreenImageMap; // half res ssao
+uniform sampler2D u_ScreenDepthMap;
+uniform vec4      u_ViewInfo; // zfar / znear, zfar, 1/ssao width, 1/ssao height
+#endif
+
 varying vec2      var_TexCoords;
 varying float     var_InvWhite;
 
@@ -24,10 +30,51 @@ float FilmicTonemap(float x)
 	return ((x*(SS*x+LA*LS)+TS*TAN)/(x*(SS*x+LS)+TS*TAD)) - TAN/TAD;
 }
 
+#if defined(USE_SSAO)
+float getLinearDepth(sampler2D depthMap, const vec2 tex, const float zFarDivZNear)
+{
+	float sampleZDivW = texture2D(depthMap, tex).r;
+	return 1.0 / mix(zFarDivZNear, 1.0, sampleZDivW);
+}
+
+float ssaoTap(vec2 base, vec2 offset, vec2 tex, float depthCenter, inout float total)
+{
+	vec2 sampleTex = base + offset * u_ViewInfo.zw;
+	float sampleDepth = getLinearDepth(u_ScreenDepthMap, sampleTex, u_ViewInfo.x);
+
+	// bilinear weight, cut down across depth edges
+	vec2 bilinear = max(vec2(0.0), 1.0 - abs(tex - sampleTex) / u_ViewInfo.zw);
+	float weight = bilinear.x * bilinear.y / (1.0 + abs(sampleDepth - depthCenter) * u_ViewInfo.y);
+
+	total += weight;
+	return texture2D(u_ScreenImageMap, sampleTex).r * weight;
+}
+
+// depth aware upsample of the half res ssao
+float getSsao(vec2 tex)
+{
+	float depthCenter = getLinearDepth(u_ScreenDepthMap, tex, u_ViewInfo.x);
+	vec2 base = (floor(tex / u_ViewInfo.zw - 0.5) + 0.5) * u_ViewInfo.zw;
+	float total = 0.0;
+	float result = 0.0;
+
+	result += ssaoTap(base, vec2(0.0, 0.0), tex, depthCenter, total);
+	result += ssaoTap(base, vec2(1.0, 0.0), tex, depthCenter, total);
+	result += ssaoTap(base, vec2(0.0, 1.0), tex, depthCenter, total);
+	result += ssaoTap(base, vec2(1.0, 1.0), tex, depthCenter, total);
+
+	return total > 0.0 ? result / total : texture2D(u_ScreenImageMap, tex).r;
+}
+#endif
+
 void main()
 {
 	vec4 color = texture2D(u_TextureMap, var_TexCoords) * u_Color;
 
+#if defined(USE_SSAO)
+	color.rgb *= getSsao(var_TexCoords);
+#endif
+
 #if defined(USE_PBR)
 	color.rgb *= color.rgb;
 #endif
@@ -23,7 +23,9 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "tr_fbo.h"
 #include "tr_dsa.h"
 
-backEndData_t	*backEndData;
+backEndData_t	*backEndData[SMP_FRAMES];
+
+volatile qboolean	renderThreadActive;
 backEndState_t	backEnd;
 
 
@@ -58,7 +60,7 @@ void GL_BindToTMU( image_t *image, int tmu )
 		ri.Printf(PRINT_WARNING, "GL_BindToTMU: NULL image\n");
 	}
 
-	GL_BindMultiTexture(GL_TEXTURE0 + tmu, target, texture);
+	GL_QueueTexture(GL_TEXTURE0 + tmu, target, texture);
 }
 
 
@@ -67,9 +69,12 @@ void GL_BindToTMU( image_t *image, int tmu )
 */
 void GL_Cull( int cullType ) {
 	if ( glState.faceCulling == cullType ) {
+		backEnd.pc.c_cullChangesSkipped++;
 		return;
 	}
 
+	backEnd.pc.c_cullChanges++;
+
 	if ( cullType == CT_TWO_SIDED ) 
 	{
 		qglDisable( GL_CULL_FACE );
@@ -102,9 +107,12 @@ void GL_State( unsigned long stateBits )
 
 	if ( !diff )
 	{
+		backEnd.pc.c_stateChangesSkipped++;
 		return;
 	}
 
+	backEnd.pc.c_stateChanges++;
+
 	//
 	// check depthFunc bits
 	//
@@ -351,6 +359,10 @@ void RB_BeginDrawingView (void) {
 			FBO_AttachImage(fbo, cubemap->image, GL_COLOR_ATTACHMENT0_EXT, backEnd.viewParms.targetFboLayer);
 		}
 
+		// start from the cached static depth instead of a cleared buffer
+		if (backEnd.viewParms.flags & VPF_RESTOREDEPTH)
+			FBO_FastBlit(backEnd.viewParms.depthCacheFbo, NULL, fbo, NULL, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
 		FBO_Bind(fbo);
 	}
 
@@ -362,7 +374,8 @@ void RB_BeginDrawingView (void) {
 	// ensures that depth writes are enabled for the depth clear
 	GL_State( GLS_DEFAULT );
 	// clear relevant buffers
-	clearBits = GL_DEPTH_BUFFER_BIT;
+	if (!(backEnd.viewParms.flags & VPF_RESTOREDEPTH))
+		clearBits = GL_DEPTH_BUFFER_BIT;
 
 	if ( r_measureOverdraw->integer || r_shadows->integer == 2 )
 	{
@@ -379,7 +392,8 @@ void RB_BeginDrawingView (void) {
 		clearBits |= GL_COLOR_BUFFER_BIT;
 	}
 
-	qglClear( clearBits );
+	if ( clearBits )
+		qglClear( clearBits );
 
 	if ( ( backEnd.refdef.rdflags & RDF_HYPERSPACE ) )
 	{
@@ -436,6 +450,8 @@ void RB_RenderDrawSurfList( drawSurf_t *drawSurfs, int numDrawSurfs ) {
 	int				oldSort;
 	double			originalTime;
 	FBO_t*			fbo = NULL;
+	qboolean		timeSurfs;
+	gpuTimer_t		surfTimer, oldSurfTimer;
 
 	// save original time for entity shader offsets
 	originalTime = backEnd.refdef.floatTime;
@@ -454,6 +470,10 @@ void RB_RenderDrawSurfList( drawSurf_t *drawSurfs, int numDrawSurfs ) {
 	oldCubemapIndex = -1;
 	oldSort = -1;
 
+	// world and entity time is split at batch boundaries of the main pass
+	timeSurfs = !backEnd.depthFill && !(backEnd.viewParms.flags & VPF_DEPTHSHADOW);
+	oldSurfTimer = GPUTIMER_COUNT;
+
 	backEnd.pc.c_surfaces += numDrawSurfs;
 
 	for (i = 0, drawSurf = drawSurfs ; i < numDrawSurfs ; i++, drawSurf++) {
@@ -478,6 +498,14 @@ void RB_RenderDrawSurfList( drawSurf_t *drawSurfs, int numDrawSurfs ) {
 			if (oldShader != NULL) {
 				RB_EndSurface();
 			}
+			surfTimer = (entityNum == REFENTITYNUM_WORLD) ? GPUTIMER_WORLD : GPUTIMER_ENTITIES;
+			if (timeSurfs && surfTimer != oldSurfTimer)
+			{
+				if (oldSurfTimer != GPUTIMER_COUNT)
+					RB_EndGpuTimer(oldSurfTimer);
+				RB_BeginGpuTimer(surfTimer);
+				oldSurfTimer = surfTimer;
+			}
 			RB_BeginSurface( shader, fogNum, cubemapIndex );
 			backEnd.pc.c_surfBatches++;
 			oldShader = shader;
@@ -593,6 +621,9 @@ void RB_RenderDrawSurfList( drawSurf_t *drawSurfs, int numDrawSurfs ) {
 		RB_EndSurface();
 	}
 
+	if (oldSurfTimer != GPUTIMER_COUNT)
+		RB_EndGpuTimer(oldSurfTimer);
+
 	if (glRefConfig.framebufferObject)
 		FBO_Bind(fbo);
 
@@ -660,6 +691,63 @@ void	RB_SetGL2D (void) {
 }
 
 
+// cinematic frames are copied into a pixel unpack buffer, orphaned each
+// frame so the copy never waits on the last transfer, and the texture is
+// updated from it without the driver taking the data there and then
+static GLuint	cinematicUnpack;
+
+/*
+=============
+RB_CinematicUnpack
+=============
+*/
+static qboolean RB_CinematicUnpack( void )
+{
+	return r_cinematicUpload->integer && glRefConfig.mapBufferRange && qglesMajorVersion < 1;
+}
+
+/*
+=============
+RB_ShutdownCinematicUpload
+=============
+*/
+void RB_ShutdownCinematicUpload( void )
+{
+	if ( cinematicUnpack )
+		qglDeleteBuffers( 1, &cinematicUnpack );
+
+	cinematicUnpack = 0;
+}
+
+/*
+=============
+RB_UploadCinematicUnpack
+=============
+*/
+static void RB_UploadCinematicUnpack( GLuint texture, int cols, int rows, const byte *data )
+{
+	GLsizeiptr	size = cols * rows * 4;
+	void		*mapped;
+
+	if ( !cinematicUnpack )
+		qglGenBuffers( 1, &cinematicUnpack );
+
+	qglBindBuffer( GL_PIXEL_UNPACK_BUFFER, cinematicUnpack );
+	qglBufferData( GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW );
+
+	mapped = qglMapBufferRange( GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
+	if ( mapped ) {
+		Com_Memcpy( mapped, data, size );
+		qglUnmapBuffer( GL_PIXEL_UNPACK_BUFFER );
+		qglTextureSubImage2DEXT( texture, GL_TEXTURE_2D, 0, 0, 0, cols, rows, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+		qglBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+		return;
+	}
+
+	qglBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+	qglTextureSubImage2DEXT( texture, GL_TEXTURE_2D, 0, 0, 0, cols, rows, GL_RGBA, GL_UNSIGNED_BYTE, data );
+}
+
 /*
 =============
 RE_StretchRaw
@@ -684,8 +772,11 @@ void RE_StretchRaw (int x, int y, int w, int h, int cols, int rows, const byte *
 		RB_EndSurface();
 	}
 
-	// we definitely want to sync every frame for the cinematics
-	qglFinish();
+	// we definitely want to sync every frame for the cinematics, unless
+	// they stream through the unpack buffer
+	if ( !RB_CinematicUnpack() ) {
+		qglFinish();
+	}
 
 	start = 0;
 	if ( r_speeds->integer ) {
@@ -715,6 +806,7 @@ void RE_StretchRaw (int x, int y, int w, int h, int cols, int rows, const byte *
 	}
 
 	RB_SetGL2D();
+	RB_BeginGpuTimer(GPUTIMER_2D);
 
 	VectorSet4(quadVerts[0], x,     y,     0.0f, 1.0f);
 	VectorSet4(quadVerts[1], x + w, y,     0.0f, 1.0f);
@@ -744,6 +836,11 @@ void RE_UploadCinematic (int w, int h, int cols, int rows, const byte *data, int
 		return;
 	}
 
+	// the upload needs the GL context
+	if ( glConfig.smpActive ) {
+		R_IssuePendingRenderCommands();
+	}
+
 	texture = tr.scratchImage[client]->texnum;
 
 	// if the scratchImage isn't in the format we want, specify it as a new texture
@@ -777,6 +874,8 @@ void RE_UploadCinematic (int w, int h, int cols, int rows, const byte *data, int
 				qglTextureSubImage2DEXT(texture, GL_TEXTURE_2D, 0, 0, 0, cols, rows, GL_RGB, GL_UNSIGNED_BYTE, buffer);
 
 				ri.Hunk_FreeTempMemory( buffer );
+			} else if ( RB_CinematicUnpack() ) {
+				RB_UploadCinematicUnpack( texture, cols, rows, data );
 			} else {
 				qglTextureSubImage2DEXT(texture, GL_TEXTURE_2D, 0, 0, 0, cols, rows, GL_RGBA, GL_UNSIGNED_BYTE, data);
 			}
@@ -806,21 +905,15 @@ const void	*RB_SetColor( const void *data ) {
 
 /*
 =============
-RB_StretchPic
+RB_AddPic2D
+
+Appends one pic to tess, starting a new surface if the shader changes
 =============
 */
-const void *RB_StretchPic ( const void *data ) {
-	const stretchPicCommand_t	*cmd;
+static void RB_AddPic2D( const stretchPicCommand_t *cmd, const byte *color2D ) {
 	shader_t *shader;
 	int		numVerts, numIndexes;
 
-	cmd = (const stretchPicCommand_t *)data;
-
-	if (glRefConfig.framebufferObject)
-		FBO_Bind(tr.renderFbo);
-
-	RB_SetGL2D();
-
 	shader = cmd->shader;
 	if ( shader != tess.shader ) {
 		if ( tess.numIndexes ) {
@@ -847,7 +940,7 @@ const void *RB_StretchPic ( const void *data ) {
 	{
 		uint16_t color[4];
 
-		VectorScale4(backEnd.color2D, 257, color);
+		VectorScale4(color2D, 257, color);
 
 		VectorCopy4(color, tess.color[ numVerts ]);
 		VectorCopy4(color, tess.color[ numVerts + 1]);
@@ -882,11 +975,352 @@ const void *RB_StretchPic ( const void *data ) {
 
 	tess.texCoords[ numVerts + 3 ][0] = cmd->s1;
 	tess.texCoords[ numVerts + 3 ][1] = cmd->t2;
+}
+
+// pics gathered from one run of stretch pic and set color commands
+#define MAX_BATCH_PICS	512
+
+typedef struct {
+	const stretchPicCommand_t	*cmd;
+	float	mins[2], maxs[2];
+	byte	color[4];
+	int		layer;
+	int		order;
+} batchPic_t;
+
+static batchPic_t	batchPics[MAX_BATCH_PICS];
+
+static int RB_ComparePics2D( const void *a, const void *b ) {
+	const batchPic_t *pa = (const batchPic_t *)a;
+	const batchPic_t *pb = (const batchPic_t *)b;
+
+	if ( pa->layer != pb->layer ) {
+		return pa->layer - pb->layer;
+	}
+	if ( pa->cmd->shader != pb->cmd->shader ) {
+		return pa->cmd->shader->index - pb->cmd->shader->index;
+	}
+	return pa->order - pb->order;
+}
+
+/*
+=============
+RB_StretchPicBatch
+
+Menus and the HUD alternate between a few shaders (font, icons, fills), and
+drawing them in order starts a new surface on every change.  Gather the run
+of pics up to the next command that isn't 2D and draw it grouped by shader.
+
+There is no depth in 2D, so the order only matters where pics overlap.  Each
+pic goes into the lowest layer that still draws it after every earlier pic
+it overlaps, or in the same layer if that pic has the same shader since the
+order inside a shader group is kept.  Pics are then drawn by layer, shader
+and original order.
+=============
+*/
+static const void *RB_StretchPicBatch( const void *data ) {
+	const stretchPicCommand_t	*cmd;
+	batchPic_t	*pic, *other;
+	int		numPics, layer, l, i;
+
+	numPics = 0;
+	while ( numPics < MAX_BATCH_PICS ) {
+		data = PADP(data, sizeof(void *));
+
+		if ( *(const int *)data == RC_SET_COLOR ) {
+			data = RB_SetColor( data );
+			continue;
+		}
+		if ( *(const int *)data != RC_STRETCH_PIC ) {
+			break;
+		}
+
+		cmd = (const stretchPicCommand_t *)data;
+		data = (const void *)(cmd + 1);
+
+		pic = &batchPics[numPics];
+		pic->cmd = cmd;
+		pic->mins[0] = MIN( cmd->x, cmd->x + cmd->w );
+		pic->maxs[0] = MAX( cmd->x, cmd->x + cmd->w );
+		pic->mins[1] = MIN( cmd->y, cmd->y + cmd->h );
+		pic->maxs[1] = MAX( cmd->y, cmd->y + cmd->h );
+		Byte4Copy( backEnd.color2D, pic->color );
+		pic->order = numPics;
+
+		layer = 0;
+		for ( i = numPics - 1; i >= 0; i-- ) {
+			other = &batchPics[i];
+
+			l = other->layer + ( other->cmd->shader != cmd->shader );
+			if ( l <= layer ) {
+				continue;
+			}
+
+			// pics that only share an edge don't share pixels
+			if ( pic->mins[0] >= other->maxs[0] || pic->maxs[0] <= other->mins[0]
+				|| pic->mins[1] >= other->maxs[1] || pic->maxs[1] <= other->mins[1] ) {
+				continue;
+			}
+
+			layer = l;
+		}
+		pic->layer = layer;
+
+		numPics++;
+	}
+
+	qsort( batchPics, numPics, sizeof( batchPics[0] ), RB_ComparePics2D );
+
+	for ( i = 0; i < numPics; i++ ) {
+		RB_AddPic2D( batchPics[i].cmd, batchPics[i].color );
+	}
+
+	return data;
+}
+
+/*
+=============
+RB_StretchPic
+=============
+*/
+const void *RB_StretchPic ( const void *data ) {
+	const stretchPicCommand_t	*cmd;
+
+	cmd = (const stretchPicCommand_t *)data;
+
+	if (glRefConfig.framebufferObject)
+		FBO_Bind(tr.renderFbo);
+
+	RB_SetGL2D();
+	RB_BeginGpuTimer(GPUTIMER_2D);
+
+	if ( r_batch2D->integer ) {
+		return RB_StretchPicBatch( data );
+	}
+
+	RB_AddPic2D( cmd, backEnd.color2D );
 
 	return (const void *)(cmd + 1);
 }
 
 
+/*
+=============
+RB_UpdateHiZ
+
+Reduce the first main view of the frame to the farthest depth under each
+HIZ texel and start reading that back.  The readback from two frames ago is
+done by now, so it is mapped without a stall and handed to the front end
+along with the matrix it was rendered with.
+=============
+*/
+static void RB_UpdateHiZ( void )
+{
+	hizBuffer_t *hiz;
+	vec4_t srcTexCoords, viewInfo;
+	void *data;
+	int index;
+
+	if (!tr.hizFbo || backEnd.hizFrameCount == backEnd.viewParms.frameCount)
+		return;
+
+	// portals and cubemaps see something else, and cubemaps have their own depth buffer
+	if (backEnd.viewParms.isPortal || (backEnd.viewParms.flags & VPF_ORTHOGRAPHIC)
+		|| (tr.renderCubeFbo && backEnd.viewParms.targetFbo == tr.renderCubeFbo))
+		return;
+
+	// depth wasn't copied out, see RB_DrawSurfs
+	if (tr.renderFbo == NULL && glRefConfig.intelGraphics)
+		return;
+
+	if (backEnd.viewParms.viewportWidth > HIZ_WIDTH * HIZ_MAX_FOOTPRINT
+		|| backEnd.viewParms.viewportHeight > HIZ_HEIGHT * HIZ_MAX_FOOTPRINT)
+		return;
+
+	backEnd.hizFrameCount = backEnd.viewParms.frameCount;
+
+	srcTexCoords[0] = backEnd.viewParms.viewportX / (float)tr.renderDepthImage->width;
+	srcTexCoords[1] = backEnd.viewParms.viewportY / (float)tr.renderDepthImage->height;
+	srcTexCoords[2] = (backEnd.viewParms.viewportX + backEnd.viewParms.viewportWidth)  / (float)tr.renderDepthImage->width;
+	srcTexCoords[3] = (backEnd.viewParms.viewportY + backEnd.viewParms.viewportHeight) / (float)tr.renderDepthImage->height;
+
+	VectorSet4(viewInfo, backEnd.viewParms.viewportWidth / (float)HIZ_WIDTH, backEnd.viewParms.viewportHeight / (float)HIZ_HEIGHT, 0.0f, 0.0f);
+
+	GLSL_BindProgram(&tr.hizShader);
+	GLSL_SetUniformVec4(&tr.hizShader, UNIFORM_VIEWINFO, viewInfo);
+
+	FBO_BlitFromTexture(tr.renderDepthImage, srcTexCoords, NULL, tr.hizFbo, NULL, &tr.hizShader, NULL, 0);
+
+	// start this frame's readback
+	index = tr.hizReadbackIndex;
+
+	FBO_Bind(tr.hizFbo);
+	qglBindBuffer(GL_PIXEL_PACK_BUFFER, tr.hizReadback[index]);
+	qglReadPixels(0, 0, HIZ_WIDTH, HIZ_HEIGHT, GL_RED, GL_FLOAT, NULL);
+
+	Mat4Multiply(backEnd.viewParms.projectionMatrix, backEnd.viewParms.world.modelMatrix, tr.hizReadbackViewProjection[index]);
+	VectorCopy(backEnd.viewParms.or.origin, tr.hizReadbackOrigin[index]);
+	tr.hizReadbackActive[index] = qtrue;
+
+	// and finish the oldest one
+	index = (index + 1) % HIZ_READBACKS;
+	tr.hizReadbackIndex = index;
+
+	hiz = &tr.hiz[backEnd.smpFrame];
+	hiz->valid = qfalse;
+
+	if (tr.hizReadbackActive[index])
+	{
+		qglBindBuffer(GL_PIXEL_PACK_BUFFER, tr.hizReadback[index]);
+		data = qglMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(hiz->depth), GL_MAP_READ_BIT);
+
+		if (data)
+		{
+			Com_Memcpy(hiz->depth, data, sizeof(hiz->depth));
+			qglUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+			Mat4Copy(tr.hizReadbackViewProjection[index], hiz->viewProjection);
+			VectorCopy(tr.hizReadbackOrigin[index], hiz->origin);
+			hiz->valid = qtrue;
+		}
+	}
+
+	qglBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+
+/*
+=============
+RB_DlightClusterSlice
+=============
+*/
+static int RB_DlightClusterSlice( float depth ) {
+	int slice;
+
+	if ( depth <= backEnd.viewParms.zNear ) {
+		return 0;
+	}
+
+	slice = log2( depth * backEnd.dlightClusterSlice[1] ) * backEnd.dlightClusterSlice[0];
+
+	return MIN( slice, DLIGHT_CLUSTERS_Z - 1 );
+}
+
+/*
+=============
+RB_BinDlights
+
+Marks every screen tile and depth slice the bounding box of each dlight can
+touch and uploads the bit masks for lightall, which adds the dlights in the
+surface's own pass instead of one more pass per light.  Surfaces lit this
+way are picked by RB_SurfaceDlightClusters.
+=============
+*/
+static void RB_BinDlights( void ) {
+	static byte	clusters[DLIGHT_CLUSTERS_Y][DLIGHT_CLUSTERS_Z * DLIGHT_CLUSTERS_X][4];
+	const float	*m = backEnd.viewParms.world.modelMatrix;
+	const float	*p = backEnd.viewParms.projectionMatrix;
+	float		zNear = backEnd.viewParms.zNear;
+	dlight_t	*dl;
+	vec3_t		eye;
+	float		depth, radius, ndc[2], mins[2], maxs[2];
+	int			tiles[2][2], slices[2];
+	int			l, i, x, y, z;
+
+	backEnd.dlightClusters = qfalse;
+
+	if ( !tr.dlightClusterImage || !backEnd.refdef.num_dlights
+		|| ( backEnd.viewParms.flags & ( VPF_DEPTHSHADOW | VPF_ORTHOGRAPHIC ) ) ) {
+		return;
+	}
+
+	// depth slices are spaced evenly in log2 depth from zNear to zFar
+	VectorCopy( backEnd.viewParms.or.axis[0], backEnd.dlightClusterPlane );
+	backEnd.dlightClusterPlane[3] = -DotProduct( backEnd.viewParms.or.axis[0], backEnd.viewParms.or.origin );
+	backEnd.dlightClusterSlice[0] = DLIGHT_CLUSTERS_Z / log2( MAX( backEnd.viewParms.zFar / zNear, 2.0f ) );
+	backEnd.dlightClusterSlice[1] = 1.0f / zNear;
+	backEnd.dlightClusterSlice[2] = 1.0f;
+	backEnd.dlightClusterSlice[3] = 0.0f;
+
+	VectorSet4( backEnd.dlightClusterTile, backEnd.viewParms.viewportX, backEnd.viewParms.viewportY,
+		(float)DLIGHT_CLUSTERS_X / backEnd.viewParms.viewportWidth, (float)DLIGHT_CLUSTERS_Y / backEnd.viewParms.viewportHeight );
+
+	Com_Memset( clusters, 0, sizeof( clusters ) );
+
+	for ( l = 0; l < backEnd.refdef.num_dlights; l++ ) {
+		dl = &backEnd.refdef.dlights[l];
+		radius = dl->radius;
+
+		VectorCopy( dl->origin, backEnd.dlightOrigins[l] );
+		backEnd.dlightOrigins[l][3] = 1.0f / ( radius * radius );
+		VectorCopy( dl->color, backEnd.dlightColors[l] );
+		backEnd.dlightColors[l][3] = dl->additive ? 1.0f : 0.0f;
+
+		for ( i = 0; i < 3; i++ ) {
+			eye[i] = m[i] * dl->origin[0] + m[4 + i] * dl->origin[1] + m[8 + i] * dl->origin[2] + m[12 + i];
+		}
+		depth = -eye[2];
+
+		if ( depth + radius < zNear ) {
+			continue;
+		}
+
+		if ( depth - radius <= zNear ) {
+			// around the eye, the box doesn't project to anything useful
+			tiles[0][0] = tiles[1][0] = 0;
+			tiles[0][1] = DLIGHT_CLUSTERS_X - 1;
+			tiles[1][1] = DLIGHT_CLUSTERS_Y - 1;
+		} else {
+			mins[0] = mins[1] = 1.0f;
+			maxs[0] = maxs[1] = -1.0f;
+
+			// the corners of the box around the light give its screen bounds
+			for ( i = 0; i < 8; i++ ) {
+				vec3_t	corner;
+				float	w;
+
+				corner[0] = eye[0] + ( ( i & 1 ) ? radius : -radius );
+				corner[1] = eye[1] + ( ( i & 2 ) ? radius : -radius );
+				corner[2] = eye[2] + ( ( i & 4 ) ? radius : -radius );
+
+				w = p[3] * corner[0] + p[7] * corner[1] + p[11] * corner[2] + p[15];
+				ndc[0] = ( p[0] * corner[0] + p[4] * corner[1] + p[8] * corner[2] + p[12] ) / w;
+				ndc[1] = ( p[1] * corner[0] + p[5] * corner[1] + p[9] * corner[2] + p[13] ) / w;
+
+				mins[0] = MIN( mins[0], ndc[0] );
+				mins[1] = MIN( mins[1], ndc[1] );
+				maxs[0] = MAX( maxs[0], ndc[0] );
+				maxs[1] = MAX( maxs[1], ndc[1] );
+			}
+
+			if ( mins[0] > 1.0f || mins[1] > 1.0f || maxs[0] < -1.0f || maxs[1] < -1.0f ) {
+				continue;
+			}
+
+			tiles[0][0] = Com_Clamp( 0, DLIGHT_CLUSTERS_X - 1, floor( ( mins[0] * 0.5f + 0.5f ) * DLIGHT_CLUSTERS_X ) );
+			tiles[0][1] = Com_Clamp( 0, DLIGHT_CLUSTERS_X - 1, floor( ( maxs[0] * 0.5f + 0.5f ) * DLIGHT_CLUSTERS_X ) );
+			tiles[1][0] = Com_Clamp( 0, DLIGHT_CLUSTERS_Y - 1, floor( ( mins[1] * 0.5f + 0.5f ) * DLIGHT_CLUSTERS_Y ) );
+			tiles[1][1] = Com_Clamp( 0, DLIGHT_CLUSTERS_Y - 1, floor( ( maxs[1] * 0.5f + 0.5f ) * DLIGHT_CLUSTERS_Y ) );
+		}
+
+		slices[0] = RB_DlightClusterSlice( depth - radius );
+		slices[1] = RB_DlightClusterSlice( depth + radius );
+
+		for ( z = slices[0]; z <= slices[1]; z++ ) {
+			for ( y = tiles[1][0]; y <= tiles[1][1]; y++ ) {
+				for ( x = tiles[0][0]; x <= tiles[0][1]; x++ ) {
+					clusters[y][z * DLIGHT_CLUSTERS_X + x][l >> 3] |= 1 << ( l & 7 );
+				}
+			}
+		}
+	}
+
+	qglTextureSubImage2DEXT( tr.dlightClusterImage->texnum, GL_TEXTURE_2D, 0, 0, 0,
+		DLIGHT_CLUSTERS_X * DLIGHT_CLUSTERS_Z, DLIGHT_CLUSTERS_Y, GL_RGBA, GL_UNSIGNED_BYTE, clusters );
+
+	backEnd.dlightClusters = qtrue;
+}
+
 /*
 =============
 RB_DrawSurfs
@@ -909,9 +1343,15 @@ const void	*RB_DrawSurfs( const void *data ) {
 
 	isShadowView = !!(backEnd.viewParms.flags & VPF_DEPTHSHADOW);
 
+	RB_EndGpuTimer(GPUTIMER_2D);
+	if (isShadowView)
+		RB_BeginGpuTimer(GPUTIMER_SHADOWS);
+
 	// clear the z buffer, set the modelview, etc
 	RB_BeginDrawingView ();
 
+	RB_BinDlights();
+
 	if (glRefConfig.framebufferObject && (backEnd.viewParms.flags & VPF_DEPTHCLAMP) && glRefConfig.depthClamp)
 	{
 		qglEnable(GL_DEPTH_CLAMP);
@@ -924,12 +1364,18 @@ const void	*RB_DrawSurfs( const void *data ) {
 
 		VectorSet4(viewInfo, backEnd.viewParms.zFar / r_znear->value, backEnd.viewParms.zFar, 0.0, 0.0);
 
+		if (!isShadowView)
+			RB_BeginGpuTimer(GPUTIMER_DEPTHPREPASS);
+
 		backEnd.depthFill = qtrue;
 		qglColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
 		RB_RenderDrawSurfList( cmd->drawSurfs, cmd->numDrawSurfs );
 		qglColorMask(!backEnd.colorMask[0], !backEnd.colorMask[1], !backEnd.colorMask[2], !backEnd.colorMask[3]);
 		backEnd.depthFill = qfalse;
 
+		if (!isShadowView)
+			RB_EndGpuTimer(GPUTIMER_DEPTHPREPASS);
+
 		if (!isShadowView)
 		{
 			if (tr.msaaResolveFbo)
@@ -955,6 +1401,8 @@ const void	*RB_DrawSurfs( const void *data ) {
 				FBO_BlitFromTexture(tr.renderDepthImage, srcTexCoords, NULL, tr.hdrDepthFbo, NULL, NULL, NULL, 0);
 			}
 
+			RB_UpdateHiZ();
+
 			if (r_sunlightMode->integer && backEnd.viewParms.flags & VPF_USESUNLIGHT)
 			{
 				vec4_t quadVerts[4];
@@ -1200,6 +1648,9 @@ const void	*RB_DrawSurfs( const void *data ) {
 	backEnd.viewParms.isMirror = qfalse;
 	backEnd.viewParms.flags = 0;
 
+	if (isShadowView)
+		RB_EndGpuTimer(GPUTIMER_SHADOWS);
+
 	return (const void *)(cmd + 1);
 }
 
@@ -1453,11 +1904,15 @@ const void	*RB_SwapBuffers( const void *data ) {
 		RB_EndSurface();
 	}
 
+	RB_EndGpuTimer(GPUTIMER_2D);
+
 	// texture swapping test
 	if ( r_showImages->integer ) {
 		RB_ShowImages();
 	}
 
+	RB_DrawGpuTimers();
+
 	cmd = (const swapBuffersCommand_t *)data;
 
 	// we measure overdraw by reading back the stencil buffer and
@@ -1478,7 +1933,11 @@ const void	*RB_SwapBuffers( const void *data ) {
 		ri.Hunk_FreeTempMemory( stencilReadback );
 	}
 
+	RB_BeginGpuTimer(GPUTIMER_POSTPROCESS);
 	RB_PresentToScreen();
+	RB_EndGpuTimer(GPUTIMER_POSTPROCESS);
+
+	RB_EndGpuTimerFrame();
 
 	if ( !glState.finishCalled ) {
 		qglFinish();
@@ -1540,18 +1999,22 @@ const void *RB_PostProcess(const void *data)
 	const postProcessCommand_t *cmd = data;
 	FBO_t *srcFbo, *dstFbo;
 	ivec4_t srcBox, dstBox;
-	qboolean autoExposure;
+	qboolean autoExposure, toneMap, fuseSsao, laterPasses;
 
 	// finish any 2D drawing if needed
 	if(tess.numIndexes)
 		RB_EndSurface();
 
+	RB_EndGpuTimer(GPUTIMER_2D);
+
 	if (!glRefConfig.framebufferObject || !r_postProcess->integer)
 	{
 		// do nothing
 		return (const void *)(cmd + 1);
 	}
 
+	RB_BeginGpuTimer(GPUTIMER_POSTPROCESS);
+
 	if (cmd)
 	{
 		backEnd.refdef = cmd->refdef;
@@ -1574,7 +2037,15 @@ const void *RB_PostProcess(const void *data)
 	dstBox[2] = backEnd.viewParms.viewportWidth;
 	dstBox[3] = backEnd.viewParms.viewportHeight;
 
-	if (r_ssao->integer)
+	toneMap = srcFbo && r_hdr->integer && (r_toneMap->integer || r_forceToneMap->integer);
+
+	// the tonemap pass can apply SSAO itself
+	fuseSsao = r_ssao->integer && toneMap && tr.tonemapShader[1].program;
+
+	// sun rays and bokeh work on srcFbo after tonemapping, see RB_BokehBlur() for the threshold
+	laterPasses = r_drawSunRays->integer || backEnd.refdef.blurFactor * 10.0f >= 0.004f;
+
+	if (r_ssao->integer && !fuseSsao)
 	{
 		srcBox[0] = backEnd.viewParms.viewportX      * tr.screenSsaoImage->width  / (float)glConfig.vidWidth;
 		srcBox[1] = backEnd.viewParms.viewportY      * tr.screenSsaoImage->height / (float)glConfig.vidHeight;
@@ -1591,14 +2062,24 @@ const void *RB_PostProcess(const void *data)
 
 	if (srcFbo)
 	{
-		if (r_hdr->integer && (r_toneMap->integer || r_forceToneMap->integer))
+		if (toneMap)
 		{
 			autoExposure = r_autoExposure->integer || r_forceAutoExposure->integer;
 
-			// Use an intermediate FBO because it can't blit to the same FBO directly
-			// and can't read from an MSAA dstFbo later.
-			RB_ToneMap(srcFbo, srcBox, tr.screenScratchFbo, srcBox, autoExposure);
-			FBO_FastBlit(tr.screenScratchFbo, srcBox, srcFbo, srcBox, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+			if (srcFbo != dstFbo && !laterPasses)
+			{
+				// Nothing reads the result back, so tonemap the MSAA resolve
+				// straight into the render target and skip both copies.
+				RB_ToneMap(srcFbo, srcBox, dstFbo, dstBox, autoExposure, fuseSsao);
+				srcFbo = dstFbo;
+			}
+			else
+			{
+				// Use an intermediate FBO because it can't blit to the same FBO directly
+				// and can't read from an MSAA dstFbo later.
+				RB_ToneMap(srcFbo, srcBox, tr.screenScratchFbo, srcBox, autoExposure, fuseSsao);
+				FBO_FastBlit(tr.screenScratchFbo, srcBox, srcFbo, srcBox, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+			}
 		}
 		else if (r_cameraExposure->value != 0.0f)
 		{
@@ -1746,12 +2227,34 @@ const void *RB_PostProcess(const void *data)
 	}
 #endif
 
+	RB_EndGpuTimer(GPUTIMER_POSTPROCESS);
+
 	return (const void *)(cmd + 1);
 }
 
 // FIXME: put this function declaration elsewhere
 void R_SaveDDS(const char *filename, byte *pic, int width, int height, int depth);
 
+/*
+=============
+RB_ReadCubemap
+
+Reads all six sides of a cubemap, one after another
+=============
+*/
+static void RB_ReadCubemap(cubemap_t *cubemap, byte *pixels)
+{
+	int sideSize = r_cubemapSize->integer * r_cubemapSize->integer * 4;
+	int j;
+
+	for (j = 0; j < 6; j++)
+	{
+		FBO_AttachImage(tr.renderCubeFbo, cubemap->image, GL_COLOR_ATTACHMENT0_EXT, j);
+		qglReadPixels(0, 0, r_cubemapSize->integer, r_cubemapSize->integer, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		pixels += sideSize;
+	}
+}
+
 /*
 =============
 RB_ExportCubemaps
@@ -1778,7 +2281,7 @@ const void *RB_ExportCubemaps(const void *data)
 		FBO_t *oldFbo = glState.currentFBO;
 		int sideSize = r_cubemapSize->integer * r_cubemapSize->integer * 4;
 		byte *cubemapPixels = ri.Malloc(sideSize * 6);
-		int i, j;
+		int i;
 
 		FBO_Bind(tr.renderCubeFbo);
 
@@ -1786,14 +2289,8 @@ const void *RB_ExportCubemaps(const void *data)
 		{
 			char filename[MAX_QPATH];
 			cubemap_t *cubemap = &tr.cubemaps[i];
-			byte *p = cubemapPixels;
 
-			for (j = 0; j < 6; j++)
-			{
-				FBO_AttachImage(tr.renderCubeFbo, cubemap->image, GL_COLOR_ATTACHMENT0_EXT, j);
-				qglReadPixels(0, 0, r_cubemapSize->integer, r_cubemapSize->integer, GL_RGBA, GL_UNSIGNED_BYTE, p);
-				p += sideSize;
-			}
+			RB_ReadCubemap(cubemap, cubemapPixels);
 
 			if (cubemap->name[0])
 			{
@@ -1818,6 +2315,40 @@ const void *RB_ExportCubemaps(const void *data)
 }
 
 
+/*
+=============
+RB_SaveCubemap
+
+=============
+*/
+const void *RB_SaveCubemap(const void *data)
+{
+	const saveCubemapCommand_t *cmd = data;
+	cubemap_t *cubemap = &tr.cubemaps[cmd->cubemapIndex];
+
+	// finish any 2D drawing if needed
+	if (tess.numIndexes)
+		RB_EndSurface();
+
+	if (glRefConfig.framebufferObject && tr.world && cmd->cubemapIndex < tr.numCubemaps && cubemap->image)
+	{
+		FBO_t *oldFbo = glState.currentFBO;
+		byte *cubemapPixels = ri.Malloc(r_cubemapSize->integer * r_cubemapSize->integer * 4 * 6);
+
+		FBO_Bind(tr.renderCubeFbo);
+		RB_ReadCubemap(cubemap, cubemapPixels);
+		FBO_Bind(oldFbo);
+
+		R_SaveDDS(cmd->filename, cubemapPixels, r_cubemapSize->integer, r_cubemapSize->integer, 6);
+		ri.Printf(PRINT_DEVELOPER, "Cached cubemap %d as %s\n", cmd->cubemapIndex, cmd->filename);
+
+		ri.Free(cubemapPixels);
+	}
+
+	return (const void *)(cmd + 1);
+}
+
+
 /*
 ====================
 RB_ExecuteRenderCommands
@@ -1826,8 +2357,15 @@ RB_ExecuteRenderCommands
 void RB_ExecuteRenderCommands( const void *data ) {
 	int		t1, t2;
 
+	ri.ProfileBegin( "RB_ExecuteRenderCommands" );
 	t1 = ri.Milliseconds ();
 
+	if ( backEndData[1] && data == backEndData[1]->commands.cmds ) {
+		backEnd.smpFrame = 1;
+	} else {
+		backEnd.smpFrame = 0;
+	}
+
 	while ( 1 ) {
 		data = PADP(data, sizeof(void *));
 
@@ -1868,6 +2406,9 @@ void RB_ExecuteRenderCommands( const void *data ) {
 		case RC_EXPORT_CUBEMAPS:
 			data = RB_ExportCubemaps(data);
 			break;
+		case RC_SAVE_CUBEMAP:
+			data = RB_SaveCubemap(data);
+			break;
 		case RC_END_OF_LIST:
 		default:
 			// finish any 2D drawing if needed
@@ -1877,8 +2418,35 @@ void RB_ExecuteRenderCommands( const void *data ) {
 			// stop rendering
 			t2 = ri.Milliseconds ();
 			backEnd.pc.msec = t2 - t1;
+			ri.ProfileEnd();
 			return;
 		}
 	}
 
 }
+
+
+/*
+================
+RB_RenderThread
+================
+*/
+void RB_RenderThread( void ) {
+	const void	*data;
+
+	// wait for either a rendering command or a quit command
+	while ( 1 ) {
+		// sleep until we have work to do
+		data = GLimp_RendererSleep();
+
+		if ( !data ) {
+			return;	// all done, renderer is shutting down
+		}
+
+		renderThreadActive = qtrue;
+
+		RB_ExecuteRenderCommands( data );
+
+		renderThreadActive = qfalse;
+	}
+}
@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 /* CoD1 IBSP v59 loader (tr_bsp_cod1.c) */
 void R_LoadCod1WorldMap( const byte *base );
+void R_LoadStaticModelsCod1( void );
 
 #define JSON_IMPLEMENTATION
 #include "../qcommon/json.h"
@@ -498,7 +499,7 @@ static	void R_LoadLightmaps( lump_t *l, lump_t *surfs ) {
 
 
 // If FatPackU() or FatPackV() changes, update FixFatLightmapTexCoords()
-static float FatPackU(float input, int lightmapnum)
+float FatPackU(float input, int lightmapnum)
 {
 	if (lightmapnum < 0)
 		return input;
@@ -515,7 +516,7 @@ static float FatPackU(float input, int lightmapnum)
 	return input;
 }
 
-static float FatPackV(float input, int lightmapnum)
+float FatPackV(float input, int lightmapnum)
 {
 	if (lightmapnum < 0)
 		return input;
@@ -533,7 +534,7 @@ static float FatPackV(float input, int lightmapnum)
 }
 
 
-static int FatLightmap(int lightmapnum)
+int FatLightmap(int lightmapnum)
 {
 	if (lightmapnum < 0)
 		return lightmapnum;
@@ -1916,6 +1917,7 @@ static	void R_LoadNodesAndLeafs (lump_t *nodeLump, lump_t *leafLump) {
 		out->plane = s_worldData.planes + p;
 
 		out->contents = CONTENTS_NODE;	// differentiate from leafs
+		out->cell = -1;
 
 		for (j=0 ; j<2 ; j++)
 		{
@@ -1939,6 +1941,7 @@ static	void R_LoadNodesAndLeafs (lump_t *nodeLump, lump_t *leafLump) {
 
 		out->cluster = LittleLong(inLeaf->cluster);
 		out->area = LittleLong(inLeaf->area);
+		out->cell = -1;
 
 		if ( out->cluster >= s_worldData.numClusters ) {
 			s_worldData.numClusters = out->cluster + 1;
@@ -2284,13 +2287,15 @@ void R_LoadEntities( lump_t *l ) {
 	w->lightGridSize[1] = 64;
 	w->lightGridSize[2] = 128;
 
-	p = (char *)(fileBase + l->fileofs);
-
-	// store for reference by the cgame
+	// store for reference by the cgame, the lump doesn't have to
+	// be terminated when the map is a mapped view of the file
 	w->entityString = ri.Hunk_Alloc( l->filelen + 1, h_low );
-	strcpy( w->entityString, p );
+	Com_Memcpy( w->entityString, fileBase + l->fileofs, l->filelen );
+	w->entityString[l->filelen] = 0;
 	w->entityParsePoint = w->entityString;
 
+	p = w->entityString;
+
 	token = COM_ParseExt( &p, qtrue );
 	if (!*token || *token != '{') {
 		return;
@@ -2622,6 +2627,23 @@ void R_AssignCubemapsToWorldSurfaces(void)
 }
 
 
+// rendered cubemaps are cached per map file and cubemap size
+static char s_cubemapCacheDir[MAX_QPATH];
+
+static void R_SetCubemapCacheDir(const byte *data, long len)
+{
+	unsigned hash = 2166136261u;
+
+	while (len-- > 0)
+	{
+		hash ^= *data++;
+		hash *= 16777619u;
+	}
+
+	Com_sprintf(s_cubemapCacheDir, sizeof(s_cubemapCacheDir), "cache/cubemaps/%s_%08x_%d", s_worldData.baseName, hash, r_cubemapSize->integer);
+}
+
+
 void R_LoadCubemaps(void)
 {
 	int i;
@@ -2635,10 +2657,23 @@ void R_LoadCubemaps(void)
 		Com_sprintf(filename, MAX_QPATH, "cubemaps/%s/%03d.dds", tr.world->baseName, i);
 
 		cubemap->image = R_FindImageFile(filename, IMGTYPE_COLORALPHA, flags);
+
+		if (!cubemap->image && r_cubemapCache->integer)
+		{
+			Com_sprintf(filename, MAX_QPATH, "%s/%03d.dds", s_cubemapCacheDir, i);
+			cubemap->image = R_FindImageFile(filename, IMGTYPE_COLORALPHA, flags | IMGFLAG_NO_COMPRESSION);
+		}
 	}
 }
 
 
+static void R_CacheCubemap(int cubemapIndex)
+{
+	if (r_cubemapCache->integer)
+		R_SaveCubemap(cubemapIndex, va("%s/%03d.dds", s_cubemapCacheDir, cubemapIndex));
+}
+
+
 void R_RenderMissingCubemaps(void)
 {
 	int i, j;
@@ -2650,6 +2685,13 @@ void R_RenderMissingCubemaps(void)
 		{
 			tr.cubemaps[i].image = R_CreateImage(va("*cubeMap%d", i), NULL, r_cubemapSize->integer, r_cubemapSize->integer, IMGTYPE_COLORALPHA, flags, GL_RGBA8);
 
+			// leave it to R_RenderPendingCubemaps() instead of holding up the load
+			if (r_cubemapSidesPerFrame->integer)
+			{
+				tr.cubemaps[i].missingSides = 6;
+				continue;
+			}
+
 			for (j = 0; j < 6; j++)
 			{
 				RE_ClearScene();
@@ -2657,6 +2699,45 @@ void R_RenderMissingCubemaps(void)
 				R_IssuePendingRenderCommands();
 				R_InitNextFrame();
 			}
+
+			R_CacheCubemap(i);
+			R_IssuePendingRenderCommands();
+		}
+	}
+}
+
+
+/*
+=================
+R_RenderPendingCubemaps
+
+Renders up to r_cubemapSidesPerFrame sides of the cubemaps that were neither
+shipped with the map nor cached, and caches each one once it is complete.
+Surfaces ignore a cubemap until all its sides are there.
+=================
+*/
+void R_RenderPendingCubemaps(void)
+{
+	int i, sides;
+
+	if (!tr.world || !r_cubeMapping->integer || !glRefConfig.framebufferObject)
+		return;
+
+	sides = MAX(r_cubemapSidesPerFrame->integer, 1);
+
+	for (i = 0; i < tr.numCubemaps && sides; i++)
+	{
+		cubemap_t *cubemap = &tr.cubemaps[i];
+
+		while (cubemap->missingSides && sides)
+		{
+			RE_ClearScene();
+			R_RenderCubemapSide(i, 6 - cubemap->missingSides, qfalse);
+			cubemap->missingSides--;
+			sides--;
+
+			if (!cubemap->missingSides)
+				R_CacheCubemap(i);
 		}
 	}
 }
@@ -2710,6 +2791,7 @@ void RE_LoadWorldMap( const char *name ) {
 		void *v;
 	} buffer;
 	byte		*startMarker;
+	long		fileLen;
 
 	if ( tr.worldMapLoaded ) {
 		ri.Error( ERR_DROP, "ERROR: attempted to redundantly load world map" );
@@ -2737,11 +2819,16 @@ void RE_LoadWorldMap( const char *name ) {
 
 	// reset last cascade sun direction so last shadow cascade is rerendered
 	VectorClear(tr.lastCascadeSunDirection);
+	Com_Memset(tr.sunShadowCache, 0, sizeof(tr.sunShadowCache));
+
+	// depth read back from the last map would occlude things on this one
+	Com_Memset(tr.hiz, 0, sizeof(tr.hiz));
+	Com_Memset(tr.hizReadbackActive, 0, sizeof(tr.hizReadbackActive));
 
 	tr.worldMapLoaded = qtrue;
 
 	// load it
-    ri.FS_ReadFile( name, &buffer.v );
+	fileLen = ri.FS_MapFile( name, &buffer.v );
 	if ( !buffer.b ) {
 		ri.Error (ERR_DROP, "RE_LoadWorldMap: %s not found", name);
 	}
@@ -2767,9 +2854,10 @@ void RE_LoadWorldMap( const char *name ) {
 	if ( i == COD1_BSP_VERSION ) {
 		/* CoD1 / CoDUO IBSP version 59 */
 		R_LoadCod1WorldMap( buffer.b );
-		s_worldData.dataSize = (byte *)ri.Hunk_Alloc(0, h_low) - startMarker;
 		tr.world = &s_worldData;
-		ri.FS_FreeFile( buffer.v );
+		R_LoadStaticModelsCod1( );
+		s_worldData.dataSize = (byte *)ri.Hunk_Alloc(0, h_low) - startMarker;
+		ri.FS_UnmapFile( buffer.v );
 		return;
 	}
 
@@ -2786,10 +2874,12 @@ void RE_LoadWorldMap( const char *name ) {
 	// load into heap
 	R_LoadEntities( &header->lumps[LUMP_ENTITIES] );
 	R_LoadShaders( &header->lumps[LUMP_SHADERS] );
+	R_PrefetchWorldImages( s_worldData.shaders, s_worldData.numShaders );
 	R_LoadLightmaps( &header->lumps[LUMP_LIGHTMAPS], &header->lumps[LUMP_SURFACES] );
 	R_LoadPlanes (&header->lumps[LUMP_PLANES]);
 	R_LoadFogs( &header->lumps[LUMP_FOGS], &header->lumps[LUMP_BRUSHES], &header->lumps[LUMP_BRUSHSIDES] );
 	R_LoadSurfaces( &header->lumps[LUMP_SURFACES], &header->lumps[LUMP_DRAWVERTS], &header->lumps[LUMP_DRAWINDEXES] );
+	R_FinishImagePrefetch();
 	R_LoadMarksurfaces (&header->lumps[LUMP_LEAFSURFACES]);
 	R_LoadNodesAndLeafs (&header->lumps[LUMP_NODES], &header->lumps[LUMP_LEAFS]);
 	R_LoadSubmodels (&header->lumps[LUMP_MODELS]);
@@ -3020,9 +3110,10 @@ void RE_LoadWorldMap( const char *name ) {
 	// Render or load all cubemaps
 	if (r_cubeMapping->integer && tr.numCubemaps && glRefConfig.framebufferObject)
 	{
+		R_SetCubemapCacheDir(buffer.b, fileLen);
 		R_LoadCubemaps();
 		R_RenderMissingCubemaps();
 	}
 
-    ri.FS_FreeFile( buffer.v );
+    ri.FS_UnmapFile( buffer.v );
 }
@@ -20,6 +20,10 @@ extern byte     *fileBase;
 void R_ColorShiftLightingBytes( byte in[4], byte out[4] );
 void R_SetParent( mnode_t *node, mnode_t *parent );
 void R_LoadEntities( lump_t *l );
+qboolean R_ParseSpawnVars( char *spawnVarChars, int maxSpawnVarChars, int *numSpawnVars, char *spawnVars[][2] );
+float FatPackU( float input, int lightmapnum );
+float FatPackV( float input, int lightmapnum );
+int FatLightmap( int lightmapnum );
 
 /* -------------------------------------------------------------------------
    Helpers
@@ -59,14 +63,27 @@ static void R_LoadShadersCod1( const byte *base ) {
 
 /* -------------------------------------------------------------------------
    Lightmaps (identical 128x128x3 format, identical to GL1 version)
+
+   With r_mergeLightmaps the 128x128 pages are packed into fat lightmaps the
+   same way R_LoadLightmaps does, and R_LoadCod1Surfaces rewrites the soup
+   lightmap UVs with FatPackU/FatPackV.
    ------------------------------------------------------------------------- */
+static int s_cod1NumLightmaps;
+
 static void R_LoadLightmapsCod1( const byte *base ) {
 	lump_t      l = R_GetCod1Lump( base, COD1_LUMP_LIGHTMAPS );
+	imgFlags_t  imgFlags = IMGFLAG_NOLIGHTSCALE | IMGFLAG_NO_COMPRESSION | IMGFLAG_CLAMPTOEDGE;
 	byte       *buf, *buf_p;
-	int         len, i, j;
+	int         len, i, j, numLightmapsPerPage;
 	static byte image[128 * 128 * 4];
 	byte        tmp[4];
 
+	tr.lightmapSize       = 128;
+	tr.worldDeluxeMapping = qfalse;
+	tr.fatLightmapCols    = 0;
+	tr.fatLightmapRows    = 0;
+	s_cod1NumLightmaps    = 0;
+
 	len = l.filelen;
 	if ( !len )
 		return;
@@ -74,15 +91,43 @@ static void R_LoadLightmapsCod1( const byte *base ) {
 
 	R_IssuePendingRenderCommands();
 
-	tr.numLightmaps = len / ( 128 * 128 * 3 );
+	s_cod1NumLightmaps = len / ( 128 * 128 * 3 );
+	tr.numLightmaps = s_cod1NumLightmaps;
 	if ( tr.numLightmaps == 1 )
 		tr.numLightmaps++;
 
 	if ( r_vertexLight->integer || glConfig.hardwareType == GLHW_PERMEDIA2 )
 		return;
 
+	numLightmapsPerPage = 1;
+	if ( r_mergeLightmaps->integer && s_cod1NumLightmaps > 1 ) {
+		int maxLightmapsPerAxis = glConfig.maxTextureSize / tr.lightmapSize;
+		int lightmapCols = 4, lightmapRows = 4;
+
+		while ( lightmapCols * lightmapRows < s_cod1NumLightmaps && lightmapCols != maxLightmapsPerAxis )
+			lightmapCols <<= 1;
+
+		while ( lightmapCols * lightmapRows < s_cod1NumLightmaps && lightmapRows != maxLightmapsPerAxis )
+			lightmapRows <<= 1;
+
+		tr.fatLightmapCols  = lightmapCols;
+		tr.fatLightmapRows  = lightmapRows;
+		numLightmapsPerPage = lightmapCols * lightmapRows;
+
+		tr.numLightmaps = ( s_cod1NumLightmaps + numLightmapsPerPage - 1 ) / numLightmapsPerPage;
+	}
+
 	tr.lightmaps = ri.Hunk_Alloc( tr.numLightmaps * sizeof( image_t * ), h_low );
-	for ( i = 0; i < tr.numLightmaps; i++ ) {
+
+	if ( tr.fatLightmapCols ) {
+		for ( i = 0; i < tr.numLightmaps; i++ ) {
+			tr.lightmaps[i] = R_CreateImage( va( "_fatlightmap%d", i ), NULL,
+				tr.fatLightmapCols * tr.lightmapSize, tr.fatLightmapRows * tr.lightmapSize,
+				IMGTYPE_COLORALPHA, imgFlags, GL_RGBA8 );
+		}
+	}
+
+	for ( i = 0; i < s_cod1NumLightmaps; i++ ) {
 		buf_p = buf + i * 128 * 128 * 3;
 		for ( j = 0; j < 128 * 128; j++ ) {
 			tmp[0] = buf_p[j*3+0];
@@ -91,9 +136,16 @@ static void R_LoadLightmapsCod1( const byte *base ) {
 			tmp[3] = 255;
 			R_ColorShiftLightingBytes( tmp, &image[j*4] );
 		}
-		tr.lightmaps[i] = R_CreateImage( va( "*lightmap%d", i ), image,
-			128, 128, IMGTYPE_COLORALPHA,
-			IMGFLAG_NOLIGHTSCALE | IMGFLAG_NO_COMPRESSION | IMGFLAG_CLAMPTOEDGE, 0 );
+
+		if ( tr.fatLightmapCols ) {
+			int onPage = i % numLightmapsPerPage;
+			R_UpdateSubImage( tr.lightmaps[i / numLightmapsPerPage], image,
+				( onPage % tr.fatLightmapCols ) * tr.lightmapSize, ( onPage / tr.fatLightmapCols ) * tr.lightmapSize,
+				tr.lightmapSize, tr.lightmapSize, GL_RGBA8 );
+		} else {
+			tr.lightmaps[i] = R_CreateImage( va( "*lightmap%d", i ), image,
+				128, 128, IMGTYPE_COLORALPHA, imgFlags, 0 );
+		}
 	}
 }
 
@@ -127,6 +179,101 @@ static void R_LoadPlanesCod1( const byte *base ) {
 	}
 }
 
+/* -------------------------------------------------------------------------
+   Processed vertex cache
+
+   The colour shift, normal packing, tangent frames and fat lightmap UVs
+   below only depend on the soup, vertex and triangle lumps, the overbright
+   shift and the lightmap layout, so the finished srfVert_t stream is
+   written to cache/<map>.cod1verts in the homepath and reused while the
+   checksum still matches.
+   ------------------------------------------------------------------------- */
+#define COD1_VERTCACHE_IDENT	(('C'<<24)+('V'<<16)+('1'<<8)+'C')
+#define COD1_VERTCACHE_VERSION	2
+
+typedef struct {
+	int			ident;
+	int			version;
+	unsigned	checksum;
+	int			vertSize;
+	int			numVerts;
+} cod1VertCacheHeader_t;
+
+static unsigned R_Cod1Checksum( unsigned hash, const void *data, int len ) {
+	const byte *p = data;
+
+	while ( len-- > 0 ) {
+		hash ^= *p++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static unsigned R_Cod1VertCacheChecksum( const byte *base ) {
+	static const int lumps[] = { COD1_LUMP_TRIANGLESOUPS, COD1_LUMP_VERTICES, COD1_LUMP_TRIANGLES };
+	unsigned hash = 2166136261u;
+	int      shift, i;
+
+	for ( i = 0; i < ARRAY_LEN( lumps ); i++ ) {
+		lump_t l = R_GetCod1Lump( base, lumps[i] );
+		hash = R_Cod1Checksum( hash, &l.filelen, sizeof( l.filelen ) );
+		hash = R_Cod1Checksum( hash, base + l.fileofs, l.filelen );
+	}
+
+	shift = r_mapOverBrightBits->integer - tr.overbrightBits;
+	hash  = R_Cod1Checksum( hash, &shift, sizeof( shift ) );
+	hash  = R_Cod1Checksum( hash, &tr.fatLightmapCols, sizeof( tr.fatLightmapCols ) );
+	hash  = R_Cod1Checksum( hash, &tr.fatLightmapRows, sizeof( tr.fatLightmapRows ) );
+	return R_Cod1Checksum( hash, &s_cod1NumLightmaps, sizeof( s_cod1NumLightmaps ) );
+}
+
+static const srfVert_t *R_LoadCod1VertCache( const char *name, unsigned checksum, int numVerts, void **buffer ) {
+	cod1VertCacheHeader_t *header;
+	long                   len;
+
+	len = ri.FS_ReadFile( name, buffer );
+	if ( !*buffer )
+		return NULL;
+
+	header = *buffer;
+	if ( len != sizeof( *header ) + numVerts * sizeof( srfVert_t ) || header->ident != COD1_VERTCACHE_IDENT ||
+		header->version != COD1_VERTCACHE_VERSION || header->checksum != checksum ||
+		header->vertSize != sizeof( srfVert_t ) || header->numVerts != numVerts ) {
+		ri.Printf( PRINT_DEVELOPER, "R_LoadCod1VertCache: %s is stale, rebuilding\n", name );
+		ri.FS_FreeFile( *buffer );
+		*buffer = NULL;
+		return NULL;
+	}
+
+	return (const srfVert_t *)( header + 1 );
+}
+
+static void R_WriteCod1VertCache( const char *name, unsigned checksum, int numVerts ) {
+	cod1VertCacheHeader_t *header;
+	srfVert_t             *out;
+	int                    size, i;
+
+	size   = sizeof( *header ) + numVerts * sizeof( srfVert_t );
+	header = ri.Hunk_AllocateTempMemory( size );
+	out    = (srfVert_t *)( header + 1 );
+
+	header->ident    = COD1_VERTCACHE_IDENT;
+	header->version  = COD1_VERTCACHE_VERSION;
+	header->checksum = checksum;
+	header->vertSize = sizeof( srfVert_t );
+	header->numVerts = numVerts;
+
+	for ( i = 0; i < s_worldData.numsurfaces; i++ ) {
+		srfBspSurface_t *cv = (srfBspSurface_t *)s_worldData.surfaces[i].data;
+		Com_Memcpy( out, cv->verts, cv->numVerts * sizeof( *out ) );
+		out += cv->numVerts;
+	}
+
+	ri.FS_WriteFile( name, header, size );
+	ri.Hunk_FreeTempMemory( header );
+}
+
 /* -------------------------------------------------------------------------
    Geometry – GL2 version using srfBspSurface_t / srfVert_t / glIndex_t
    ------------------------------------------------------------------------- */
@@ -134,7 +281,11 @@ static void R_LoadCod1Surfaces( const byte *base ) {
 	const cod1_trianglesoup_t *ts_in;
 	const cod1_vertex_t       *verts_base;
 	const unsigned short      *tris_base;
-	int  num_ts, i, j;
+	const srfVert_t           *cached;
+	void                      *cacheBuffer;
+	char                       cacheName[MAX_QPATH];
+	unsigned                   checksum = 0;
+	int  num_ts, num_verts, i, j;
 	lump_t ts_l, vt_l, tr_l;
 
 	ts_l = R_GetCod1Lump( base, COD1_LUMP_TRIANGLESOUPS );
@@ -159,21 +310,37 @@ static void R_LoadCod1Surfaces( const byte *base ) {
 
 	ri.Printf( PRINT_ALL, "...loading %d CoD1 triangle soups\n", num_ts );
 
+	num_verts = 0;
+	for ( i = 0; i < num_ts; i++ )
+		num_verts += LittleShort( ts_in[i].vertsLength );
+
+	Com_sprintf( cacheName, sizeof( cacheName ), "cache/%s.cod1verts", s_worldData.baseName );
+	cached = NULL;
+	cacheBuffer = NULL;
+	if ( r_vertCache->integer ) {
+		checksum = R_Cod1VertCacheChecksum( base );
+		cached   = R_LoadCod1VertCache( cacheName, checksum, num_verts, &cacheBuffer );
+	}
+
 	for ( i = 0; i < num_ts; i++ ) {
 		msurface_t            *surf = &s_worldData.surfaces[i];
 		srfBspSurface_t       *cv;
 		const cod1_trianglesoup_t *ts = &ts_in[i];
 		int   mat_idx   = LittleShort( ts->materialIdx );
+		int   lm_idx    = LittleShort( ts->lightmapIdx );
 		int   verts_off = LittleLong ( ts->vertsOffset );
 		int   verts_len = LittleShort( ts->vertsLength );
 		int   tris_off  = LittleLong ( ts->trisOffset  );
 		int   tris_len  = LittleShort( ts->trisLength  );
 
 		/* Assign shader */
+		if ( lm_idx >= s_cod1NumLightmaps || !tr.lightmaps || r_fullbright->integer )
+			lm_idx = LIGHTMAP_WHITEIMAGE;
+
 		surf->cubemapIndex = 0;
 		if ( mat_idx >= 0 && mat_idx < s_worldData.numShaders ) {
 			dshader_t *dsh = &s_worldData.shaders[mat_idx];
-			surf->shader = R_FindShader( dsh->shader, LIGHTMAP_WHITEIMAGE, qtrue );
+			surf->shader = R_FindShaderEx( dsh->shader, FatLightmap( lm_idx ), qtrue, lm_idx );
 		} else {
 			surf->shader = tr.defaultShader;
 		}
@@ -196,6 +363,20 @@ static void R_LoadCod1Surfaces( const byte *base ) {
 		surf->cullinfo.type = CULLINFO_BOX;
 		ClearBounds( surf->cullinfo.bounds[0], surf->cullinfo.bounds[1] );
 
+		/* Copy indices (u16 → glIndex_t) */
+		for ( j = 0; j < tris_len; j++ ) {
+			cv->indexes[j] = (glIndex_t)LittleShort( tris_base[tris_off + j] );
+		}
+
+		if ( cached ) {
+			Com_Memcpy( cv->verts, cached, verts_len * sizeof( srfVert_t ) );
+			cached += verts_len;
+
+			for ( j = 0; j < verts_len; j++ )
+				AddPointToBounds( cv->verts[j].xyz, surf->cullinfo.bounds[0], surf->cullinfo.bounds[1] );
+			continue;
+		}
+
 		/* Copy vertices */
 		for ( j = 0; j < verts_len; j++ ) {
 			const cod1_vertex_t *src = &verts_base[verts_off + j];
@@ -211,8 +392,8 @@ static void R_LoadCod1Surfaces( const byte *base ) {
 
 			dst->st[0]      = LittleFloat( src->uv[0] );
 			dst->st[1]      = LittleFloat( src->uv[1] );
-			dst->lightmap[0]= LittleFloat( src->lightmapUV[0] );
-			dst->lightmap[1]= LittleFloat( src->lightmapUV[1] );
+			dst->lightmap[0]= FatPackU( LittleFloat( src->lightmapUV[0] ), lm_idx );
+			dst->lightmap[1]= FatPackV( LittleFloat( src->lightmapUV[1] ), lm_idx );
 
 			n[0] = LittleFloat( src->normal[0] );
 			n[1] = LittleFloat( src->normal[1] );
@@ -234,11 +415,6 @@ static void R_LoadCod1Surfaces( const byte *base ) {
 			R_VaoPackColor( dst->color, c );
 		}
 
-		/* Copy indices (u16 → glIndex_t) */
-		for ( j = 0; j < tris_len; j++ ) {
-			cv->indexes[j] = (glIndex_t)LittleShort( tris_base[tris_off + j] );
-		}
-
 		/* Calculate tangent vectors per triangle */
 		{
 			glIndex_t *tri;
@@ -251,26 +427,377 @@ static void R_LoadCod1Surfaces( const byte *base ) {
 			}
 		}
 	}
+
+	if ( cacheBuffer ) {
+		ri.Printf( PRINT_DEVELOPER, "...using cached vertexes from %s\n", cacheName );
+		ri.FS_FreeFile( cacheBuffer );
+	} else if ( r_vertCache->integer && num_verts ) {
+		R_WriteCod1VertCache( cacheName, checksum, num_verts );
+	}
 }
 
 /* -------------------------------------------------------------------------
    Marksurfaces – GL2 stores int indices (not msurface_t* pointers)
+
+   The LeafSurfaces lump holds int32 TriangleSoup indices, as in GL1.  A flat
+   0..numsurfaces-1 list is appended after them so leaves whose range is
+   unusable can still reference every surface.
    ------------------------------------------------------------------------- */
+static int s_cod1FlatMarksurface;
+
 static void R_LoadCod1Marksurfaces( const byte *base ) {
+	lump_t      l = R_GetCod1Lump( base, COD1_LUMP_LEAFSURFACES );
+	const int  *in;
 	int        *out;
-	int         i, count;
+	int         i, count, idx;
 
-	/* CoD1 leaves have cell indices, invalid in Q3.
-	   Fix: generate a flat list 0..numsurfaces-1 and make all leaves visible. */
-	count = s_worldData.numsurfaces;
-	out = ri.Hunk_Alloc( count * sizeof( *out ), h_low );
+	in    = (const int *)( base + l.fileofs );
+	count = l.filelen / sizeof( int );
+
+	out = ri.Hunk_Alloc( ( count + s_worldData.numsurfaces ) * sizeof( *out ), h_low );
 
 	s_worldData.marksurfaces    = out;
-	s_worldData.nummarksurfaces = count;
+	s_worldData.nummarksurfaces = count + s_worldData.numsurfaces;
+	s_cod1FlatMarksurface       = count;
 
 	for ( i = 0; i < count; i++ ) {
-		out[i] = i;
+		idx = LittleLong( in[i] );
+		if ( idx < 0 || idx >= s_worldData.numsurfaces ) {
+			ri.Printf( PRINT_WARNING, "WARNING: R_LoadCod1Marksurfaces: bad surface index %d, ignoring leaf surfaces\n", idx );
+			s_cod1FlatMarksurface = 0;
+			break;
+		}
+		out[i] = idx;
+	}
+
+	for ( i = 0; i < s_worldData.numsurfaces; i++ ) {
+		out[s_cod1FlatMarksurface + i] = i;
+	}
+	s_worldData.nummarksurfaces = s_cod1FlatMarksurface + s_worldData.numsurfaces;
+}
+
+/* -------------------------------------------------------------------------
+   Cells + Portals + PortalVerts (lumps 17/18/11)
+
+   Used by R_MarkCells for per-frame portal visibility.  Any inconsistency
+   leaves numCells at 0, which disables the portal walk for the map.
+   ------------------------------------------------------------------------- */
+static void R_LoadCellsAndPortalsCod1( const byte *base ) {
+	lump_t               cell_l = R_GetCod1Lump( base, COD1_LUMP_CELLS );
+	lump_t               port_l = R_GetCod1Lump( base, COD1_LUMP_PORTALS );
+	lump_t               vert_l = R_GetCod1Lump( base, COD1_LUMP_PORTALVERTS );
+	const cod1_cell_t   *cell_in;
+	const cod1_portal_t *port_in;
+	const float         *vert_in;
+	mcell_t             *cell;
+	mportal_t           *portal;
+	vec3_t              *verts;
+	vec4_t               plane;
+	int                  num_cells, num_portals, num_verts, i, j;
+
+	s_worldData.numCells   = 0;
+	s_worldData.numPortals = 0;
+
+	if ( !cell_l.filelen || cell_l.filelen % sizeof( cod1_cell_t ) ||
+		port_l.filelen % sizeof( cod1_portal_t ) || vert_l.filelen % sizeof( vec3_t ) ) {
+		ri.Printf( PRINT_DEVELOPER, "R_LoadCellsAndPortalsCod1: no usable cell data\n" );
+		return;
+	}
+
+	num_cells   = cell_l.filelen / sizeof( cod1_cell_t );
+	num_portals = port_l.filelen / sizeof( cod1_portal_t );
+	num_verts   = vert_l.filelen / sizeof( vec3_t );
+
+	cell_in = (const cod1_cell_t *)( base + cell_l.fileofs );
+	port_in = (const cod1_portal_t *)( base + port_l.fileofs );
+	vert_in = (const float *)( base + vert_l.fileofs );
+
+	for ( i = 0; i < num_cells; i++ ) {
+		int first = LittleLong( cell_in[i].firstPortal );
+		int count = LittleLong( cell_in[i].portalCount );
+		if ( first < 0 || count < 0 || first + count > num_portals ) {
+			ri.Printf( PRINT_WARNING, "WARNING: R_LoadCellsAndPortalsCod1: bad portal range in cell %d\n", i );
+			return;
+		}
+	}
+
+	for ( i = 0; i < num_portals; i++ ) {
+		int dest  = LittleLong( port_in[i].cellIndex );
+		int first = LittleLong( port_in[i].firstPortalVertex );
+		int count = LittleLong( port_in[i].portalVertexCount );
+		if ( dest < 0 || dest >= num_cells || first < 0 || count < 3 || count > MAX_PORTAL_VERTS ||
+			first + count > num_verts ) {
+			ri.Printf( PRINT_WARNING, "WARNING: R_LoadCellsAndPortalsCod1: bad portal %d\n", i );
+			return;
+		}
+	}
+
+	verts = ri.Hunk_Alloc( num_verts * sizeof( *verts ), h_low );
+	for ( i = 0; i < num_verts; i++ ) {
+		verts[i][0] = LittleFloat( vert_in[i * 3 + 0] );
+		verts[i][1] = LittleFloat( vert_in[i * 3 + 1] );
+		verts[i][2] = LittleFloat( vert_in[i * 3 + 2] );
+	}
+
+	s_worldData.portals = portal = ri.Hunk_Alloc( num_portals * sizeof( *portal ), h_low );
+	for ( i = 0; i < num_portals; i++, port_in++, portal++ ) {
+		portal->cell     = LittleLong( port_in->cellIndex );
+		portal->numVerts = LittleLong( port_in->portalVertexCount );
+		portal->verts    = verts + LittleLong( port_in->firstPortalVertex );
+
+		/* the stored plane index isn't needed; the polygon defines it */
+		if ( !PlaneFromPoints( plane, portal->verts[0], portal->verts[1], portal->verts[2] ) )
+			VectorSet4( plane, 0, 0, 0, 0 );
+		VectorCopy( plane, portal->plane.normal );
+		portal->plane.dist = plane[3];
+		portal->plane.type = PlaneTypeForNormal( portal->plane.normal );
+		SetPlaneSignbits( &portal->plane );
 	}
+
+	s_worldData.cells = cell = ri.Hunk_Alloc( num_cells * sizeof( *cell ), h_low );
+	for ( i = 0; i < num_cells; i++, cell_in++, cell++ ) {
+		for ( j = 0; j < 3; j++ ) {
+			cell->bounds[0][j] = LittleFloat( cell_in->mins[j] );
+			cell->bounds[1][j] = LittleFloat( cell_in->maxs[j] );
+		}
+		cell->firstPortal = LittleLong( cell_in->firstPortal );
+		cell->numPortals  = LittleLong( cell_in->portalCount );
+		cell->aabbTree    = LittleLong( cell_in->aabbTreeIndex );	/* checked by R_LoadCullGroupsCod1 */
+		cell->firstOccluder = LittleLong( cell_in->firstOccluder );	/* checked by R_LoadOccludersCod1 */
+		cell->numOccluders  = LittleLong( cell_in->occluderCount );
+	}
+
+	s_worldData.numCells   = num_cells;
+	s_worldData.numPortals = num_portals;
+
+	ri.Printf( PRINT_DEVELOPER, "...loaded %d CoD1 cells, %d portals\n", num_cells, num_portals );
+}
+
+/* -------------------------------------------------------------------------
+   CullGroups + CullGroupIndices + AabbTrees (lumps 9/10/16)
+
+   Node bounds aren't stored on disk, R_SetupAabbTreeCod1 derives them from
+   the cull groups and children while checking the depth-first layout.
+   ------------------------------------------------------------------------- */
+static int R_SetupAabbTreeCod1( const cod1_aabbtree_t *in, int index, int depth ) {
+	maabbtree_t *tree;
+	int          i, child;
+
+	if ( index < 0 || index >= s_worldData.numAabbTrees || depth > 64 )
+		return -1;
+
+	tree = &s_worldData.aabbTrees[index];
+	tree->firstCullGroup = LittleLong( in[index].firstItem );
+	tree->numCullGroups  = LittleLong( in[index].itemCount );
+	tree->numChildren    = LittleLong( in[index].childCount );
+
+	if ( tree->firstCullGroup < 0 || tree->numCullGroups < 0 || tree->numChildren < 0 ||
+		tree->firstCullGroup + tree->numCullGroups > s_worldData.numCullGroups )
+		return -1;
+
+	ClearBounds( tree->bounds[0], tree->bounds[1] );
+	for ( i = 0; i < tree->numCullGroups; i++ ) {
+		mcullgroup_t *group = &s_worldData.cullGroups[tree->firstCullGroup + i];
+		AddPointToBounds( group->bounds[0], tree->bounds[0], tree->bounds[1] );
+		AddPointToBounds( group->bounds[1], tree->bounds[0], tree->bounds[1] );
+	}
+
+	child = index + 1;
+	for ( i = 0; i < tree->numChildren; i++ ) {
+		int next = R_SetupAabbTreeCod1( in, child, depth + 1 );
+		if ( next < 0 )
+			return -1;
+		AddPointToBounds( s_worldData.aabbTrees[child].bounds[0], tree->bounds[0], tree->bounds[1] );
+		AddPointToBounds( s_worldData.aabbTrees[child].bounds[1], tree->bounds[0], tree->bounds[1] );
+		child = next;
+	}
+
+	tree->next = child;
+	return child;
+}
+
+static void R_LoadCullGroupsCod1( const byte *base ) {
+	lump_t                  group_l = R_GetCod1Lump( base, COD1_LUMP_CULLGROUPS );
+	lump_t                  index_l = R_GetCod1Lump( base, COD1_LUMP_CULLGROUPINDICES );
+	lump_t                  tree_l  = R_GetCod1Lump( base, COD1_LUMP_AABBTREES );
+	const cod1_cullgroup_t *group_in;
+	const int              *index_in;
+	mcullgroup_t           *group;
+	int                     num_groups, num_indices, num_trees, i, j;
+
+	s_worldData.numCullGroups = 0;
+	s_worldData.numAabbTrees  = 0;
+
+	if ( !group_l.filelen || !tree_l.filelen || group_l.filelen % sizeof( cod1_cullgroup_t ) ||
+		index_l.filelen % sizeof( int ) || tree_l.filelen % sizeof( cod1_aabbtree_t ) ) {
+		ri.Printf( PRINT_DEVELOPER, "R_LoadCullGroupsCod1: no usable AABB tree data\n" );
+		return;
+	}
+
+	num_groups  = group_l.filelen / sizeof( cod1_cullgroup_t );
+	num_indices = index_l.filelen / sizeof( int );
+	num_trees   = tree_l.filelen / sizeof( cod1_aabbtree_t );
+
+	group_in = (const cod1_cullgroup_t *)( base + group_l.fileofs );
+	index_in = (const int *)( base + index_l.fileofs );
+
+	s_worldData.cullGroupSurfaces = ri.Hunk_Alloc( num_indices * sizeof( int ), h_low );
+	s_worldData.surfacesInTree    = ri.Hunk_Alloc( s_worldData.numsurfaces, h_low );
+	for ( i = 0; i < num_indices; i++ ) {
+		int idx = LittleLong( index_in[i] );
+		if ( idx < 0 || idx >= s_worldData.numWorldSurfaces ) {
+			ri.Printf( PRINT_WARNING, "WARNING: R_LoadCullGroupsCod1: bad surface index %d\n", idx );
+			return;
+		}
+		s_worldData.cullGroupSurfaces[i] = idx;
+	}
+
+	s_worldData.cullGroups = group = ri.Hunk_Alloc( num_groups * sizeof( *group ), h_low );
+	for ( i = 0; i < num_groups; i++, group_in++, group++ ) {
+		for ( j = 0; j < 3; j++ ) {
+			group->bounds[0][j] = LittleFloat( group_in->mins[j] );
+			group->bounds[1][j] = LittleFloat( group_in->maxs[j] );
+		}
+		group->firstSurface = LittleLong( group_in->firstSurface );
+		group->numSurfaces  = LittleLong( group_in->surfaceCount );
+		if ( group->firstSurface < 0 || group->numSurfaces < 0 || group->firstSurface + group->numSurfaces > num_indices ) {
+			ri.Printf( PRINT_WARNING, "WARNING: R_LoadCullGroupsCod1: bad cull group %d\n", i );
+			return;
+		}
+
+		/* the stored bounds must cover the soups or culling would drop them */
+		for ( j = 0; j < group->numSurfaces; j++ ) {
+			msurface_t *surf = &s_worldData.surfaces[s_worldData.cullGroupSurfaces[group->firstSurface + j]];
+			AddPointToBounds( surf->cullinfo.bounds[0], group->bounds[0], group->bounds[1] );
+			AddPointToBounds( surf->cullinfo.bounds[1], group->bounds[0], group->bounds[1] );
+		}
+	}
+
+	s_worldData.numCullGroups = num_groups;
+	s_worldData.numAabbTrees  = num_trees;
+	s_worldData.aabbTrees     = ri.Hunk_Alloc( num_trees * sizeof( *s_worldData.aabbTrees ), h_low );
+
+	for ( i = 0; i < num_trees; i = s_worldData.aabbTrees[i].next ) {
+		if ( R_SetupAabbTreeCod1( (const cod1_aabbtree_t *)( base + tree_l.fileofs ), i, 0 ) < 0 ) {
+			ri.Printf( PRINT_WARNING, "WARNING: R_LoadCullGroupsCod1: bad AABB tree at node %d\n", i );
+			s_worldData.numCullGroups = 0;
+			s_worldData.numAabbTrees  = 0;
+			return;
+		}
+	}
+
+	for ( i = 0; i < s_worldData.numCells; i++ ) {
+		mcell_t *cell = &s_worldData.cells[i];
+		if ( cell->aabbTree < 0 || cell->aabbTree >= num_trees )
+			cell->aabbTree = -1;
+	}
+
+	for ( i = 0; i < num_indices; i++ )
+		s_worldData.surfacesInTree[s_worldData.cullGroupSurfaces[i]] = 1;
+
+	s_worldData.surfacesTreeCount = ri.Hunk_Alloc( s_worldData.numsurfaces * sizeof( int ), h_low );
+
+	ri.Printf( PRINT_DEVELOPER, "...loaded %d CoD1 cull groups, %d AABB tree nodes\n", num_groups, num_trees );
+}
+
+/* -------------------------------------------------------------------------
+   Occluders + OccluderPlanes + OccluderEdges + OccluderIndices (lumps 12-15)
+
+   Used by R_MarkOccluders to build shadow frusta each frame.
+   ------------------------------------------------------------------------- */
+static void R_LoadOccludersCod1( const byte *base ) {
+	lump_t                     occ_l   = R_GetCod1Lump( base, COD1_LUMP_OCCLUDERS );
+	lump_t                     plane_l = R_GetCod1Lump( base, COD1_LUMP_OCCLUDERPLANES );
+	lump_t                     edge_l  = R_GetCod1Lump( base, COD1_LUMP_OCCLUDEREDGES );
+	lump_t                     index_l = R_GetCod1Lump( base, COD1_LUMP_OCCLUDERINDICES );
+	const cod1_occluder_t     *occ_in;
+	const int                 *plane_in;
+	const cod1_occluderedge_t *edge_in;
+	const unsigned short      *index_in;
+	moccluder_t               *occ;
+	int                        num_occ, num_planes, num_edges, num_indices, i, j;
+
+	s_worldData.numOccluders = 0;
+
+	if ( !occ_l.filelen || occ_l.filelen % sizeof( cod1_occluder_t ) || plane_l.filelen % sizeof( int ) ||
+		edge_l.filelen % sizeof( cod1_occluderedge_t ) || index_l.filelen % sizeof( unsigned short ) ) {
+		ri.Printf( PRINT_DEVELOPER, "R_LoadOccludersCod1: no usable occluder data\n" );
+		return;
+	}
+
+	num_occ     = occ_l.filelen / sizeof( cod1_occluder_t );
+	num_planes  = plane_l.filelen / sizeof( int );
+	num_edges   = edge_l.filelen / sizeof( cod1_occluderedge_t );
+	num_indices = index_l.filelen / sizeof( unsigned short );
+
+	occ_in   = (const cod1_occluder_t *)( base + occ_l.fileofs );
+	plane_in = (const int *)( base + plane_l.fileofs );
+	edge_in  = (const cod1_occluderedge_t *)( base + edge_l.fileofs );
+	index_in = (const unsigned short *)( base + index_l.fileofs );
+
+	s_worldData.occluderPlanes = ri.Hunk_Alloc( num_planes * sizeof( cplane_t * ), h_low );
+	for ( i = 0; i < num_planes; i++ ) {
+		int p = LittleLong( plane_in[i] );
+		if ( p < 0 || p >= s_worldData.numplanes ) {
+			ri.Printf( PRINT_WARNING, "WARNING: R_LoadOccludersCod1: bad plane %d\n", p );
+			return;
+		}
+		s_worldData.occluderPlanes[i] = s_worldData.planes + p;
+	}
+
+	s_worldData.occluders = occ = ri.Hunk_Alloc( num_occ * sizeof( *occ ), h_low );
+	for ( i = 0; i < num_occ; i++, occ_in++, occ++ ) {
+		occ->firstPlane = LittleLong( occ_in->firstPlane );
+		occ->numPlanes  = LittleLong( occ_in->planeCount );
+		occ->firstEdge  = LittleLong( occ_in->firstEdge );
+		occ->numEdges   = LittleLong( occ_in->edgeCount );
+
+		if ( occ->firstPlane < 0 || occ->numPlanes < 0 || occ->firstPlane + occ->numPlanes > num_planes ||
+			occ->firstEdge < 0 || occ->numEdges < 0 || occ->firstEdge + occ->numEdges > num_edges ) {
+			ri.Printf( PRINT_WARNING, "WARNING: R_LoadOccludersCod1: bad occluder %d\n", i );
+			return;
+		}
+
+		for ( j = 0; j < occ->numEdges; j++ ) {
+			const cod1_occluderedge_t *e = &edge_in[occ->firstEdge + j];
+			if ( LittleShort( e->planeA ) >= occ->numPlanes || LittleShort( e->planeB ) >= occ->numPlanes ) {
+				ri.Printf( PRINT_WARNING, "WARNING: R_LoadOccludersCod1: bad edge in occluder %d\n", i );
+				return;
+			}
+		}
+
+		/* too complex for a per-frame shadow frustum */
+		if ( occ->numPlanes + occ->numEdges > MAX_OCCLUDER_PLANES )
+			occ->numPlanes = 0;
+	}
+
+	s_worldData.occluderEdges = ri.Hunk_Alloc( num_edges * sizeof( *s_worldData.occluderEdges ), h_low );
+	for ( i = 0; i < num_edges; i++ ) {
+		s_worldData.occluderEdges[i][0] = LittleShort( edge_in[i].planeA );
+		s_worldData.occluderEdges[i][1] = LittleShort( edge_in[i].planeB );
+	}
+
+	s_worldData.occluderIndices = ri.Hunk_Alloc( num_indices * sizeof( int ), h_low );
+	for ( i = 0; i < num_indices; i++ ) {
+		s_worldData.occluderIndices[i] = LittleShort( index_in[i] );
+		if ( s_worldData.occluderIndices[i] >= num_occ ) {
+			ri.Printf( PRINT_WARNING, "WARNING: R_LoadOccludersCod1: bad occluder index %d\n", s_worldData.occluderIndices[i] );
+			return;
+		}
+	}
+
+	for ( i = 0; i < s_worldData.numCells; i++ ) {
+		mcell_t *cell = &s_worldData.cells[i];
+		if ( cell->firstOccluder < 0 || cell->numOccluders < 0 || cell->firstOccluder + cell->numOccluders > num_indices ) {
+			cell->firstOccluder = 0;
+			cell->numOccluders  = 0;
+		}
+	}
+
+	s_worldData.numOccluders       = num_occ;
+	s_worldData.numOccluderIndices = num_indices;
+
+	ri.Printf( PRINT_DEVELOPER, "...loaded %d CoD1 occluders\n", num_occ );
 }
 
 /* -------------------------------------------------------------------------
@@ -308,6 +835,7 @@ static void R_LoadCod1NodesAndLeafs( const byte *base ) {
 		p         = LittleLong( node_in->planeNum );
 		out->plane = s_worldData.planes + p;
 		out->contents = CONTENTS_NODE;
+		out->cell     = -1;
 
 		for ( j = 0; j < 2; j++ ) {
 			p = LittleLong( node_in->children[j] );
@@ -325,30 +853,74 @@ static void R_LoadCod1NodesAndLeafs( const byte *base ) {
 		out->maxs[0] = out->maxs[1] = out->maxs[2] =  MAX_WORLD_COORD;
 
 		out->cluster = LittleLong( leaf_in->cluster );
-		out->area    = LittleLong( leaf_in->area );
+		/* areas are rebuilt from the cells by the collision map, which
+		   the snapshot areamask refers to */
+		out->area    = ri.CM_LeafArea( i );
+		out->cell    = LittleLong( leaf_in->cellNum );
+		if ( out->cell < 0 || out->cell >= s_worldData.numCells )
+			out->cell = -1;
 
 		if ( out->cluster >= s_worldData.numClusters )
 			s_worldData.numClusters = out->cluster + 1;
 
-		/* GL2: make all surfaces visible from every leaf to avoid CoD1 index issues */
-		out->firstmarksurface = 0;
-		out->nummarksurfaces  = s_worldData.numsurfaces;
+		/* fall back to the flat list if the leaf range is unusable */
+		out->firstmarksurface = LittleLong( leaf_in->firstLeafSurface );
+		out->nummarksurfaces  = LittleLong( leaf_in->numLeafSurfaces );
+		if ( !s_cod1FlatMarksurface || out->firstmarksurface < 0 || out->nummarksurfaces < 0 ||
+			out->firstmarksurface + out->nummarksurfaces > s_cod1FlatMarksurface ) {
+			out->firstmarksurface = s_cod1FlatMarksurface;
+			out->nummarksurfaces  = s_worldData.numsurfaces;
+		}
 	}
 
 	R_SetParent( s_worldData.nodes, NULL );
 }
 
 /* -------------------------------------------------------------------------
-   Visibility stub (identical to GL1 version)
+   Visibility
+
+   The CoD1 vis lump uses the Q3 layout: numClusters, clusterBytes, then one
+   uncompressed bit row per cluster.  Everything is marked visible only when
+   the lump is missing or does not cover the clusters referenced by leafs.
    ------------------------------------------------------------------------- */
 static void R_LoadVisibilityCod1( const byte *base ) {
+	lump_t      l = R_GetCod1Lump( base, COD1_LUMP_VISIBILITY );
+	const byte *buf;
+	int         numClusters, clusterBytes;
+	byte       *vis;
+
+	if ( l.filelen >= 8 ) {
+		buf          = base + l.fileofs;
+		numClusters  = LittleLong( ( (const int *)buf )[0] );
+		clusterBytes = LittleLong( ( (const int *)buf )[1] );
+
+		if ( numClusters > 0 && numClusters >= s_worldData.numClusters &&
+			clusterBytes >= ( numClusters + 7 ) >> 3 &&
+			numClusters <= ( l.filelen - 8 ) / clusterBytes ) {
+			s_worldData.numClusters  = numClusters;
+			s_worldData.clusterBytes = clusterBytes;
+
+			if ( tr.externalVisData ) {
+				s_worldData.vis = tr.externalVisData;
+			} else {
+				vis = ri.Hunk_Alloc( numClusters * clusterBytes, h_low );
+				Com_Memcpy( vis, buf + 8, numClusters * clusterBytes );
+				s_worldData.vis = vis;
+			}
+			return;
+		}
+
+		ri.Printf( PRINT_WARNING, "WARNING: R_LoadVisibilityCod1: bad vis lump (%d clusters, %d bytes per cluster)\n",
+			numClusters, clusterBytes );
+	}
+
 	s_worldData.numClusters  = s_worldData.numClusters  ? s_worldData.numClusters  : 1;
 	s_worldData.clusterBytes = ( s_worldData.numClusters + 7 ) & ~7;
 
 	if ( tr.externalVisData ) {
 		s_worldData.vis = tr.externalVisData;
 	} else {
-		byte *vis = ri.Hunk_Alloc( s_worldData.numClusters * s_worldData.clusterBytes, h_low );
+		vis = ri.Hunk_Alloc( s_worldData.numClusters * s_worldData.clusterBytes, h_low );
 		Com_Memset( vis, 0xff, s_worldData.numClusters * s_worldData.clusterBytes );
 		s_worldData.vis = vis;
 	}
@@ -363,6 +935,153 @@ static void R_LoadEntitiesCod1( const byte *base ) {
 	R_LoadEntities( &l );
 }
 
+/* -------------------------------------------------------------------------
+   Light lists for entity lighting
+
+   CoD1 maps carry no light grid.  The light entities still in the entity
+   string are listed per cell instead, so lighting a model only weighs the
+   lights that reach the cell it stands in.  Lights not enclosed by the cell
+   they are in, and lights outside every cell, also go on the list used for
+   leafs without a cell.
+   ------------------------------------------------------------------------- */
+#define COD1_LIGHT_RADIUS		300.0f
+#define COD1_MAX_SPAWN_VARS		64
+
+static qboolean R_Cod1LightTouchesBounds( const mlight_t *light, const vec3_t bounds[2] ) {
+	float d = 0, e;
+	int   i;
+
+	for ( i = 0; i < 3; i++ ) {
+		if ( light->origin[i] < bounds[0][i] )
+			e = bounds[0][i] - light->origin[i];
+		else if ( light->origin[i] > bounds[1][i] )
+			e = light->origin[i] - bounds[1][i];
+		else
+			continue;
+		d += e * e;
+	}
+
+	return d < light->radius * light->radius;
+}
+
+static qboolean R_Cod1LightInsideBounds( const mlight_t *light, const vec3_t bounds[2] ) {
+	int i;
+
+	for ( i = 0; i < 3; i++ ) {
+		if ( light->origin[i] - light->radius < bounds[0][i] || light->origin[i] + light->radius > bounds[1][i] )
+			return qfalse;
+	}
+
+	return qtrue;
+}
+
+static int R_Cod1BuildLightLists( int *out ) {
+	int total = 0, i, j;
+
+	for ( i = 0; i < s_worldData.numCells; i++ ) {
+		mcell_t *cell = &s_worldData.cells[i];
+
+		cell->firstLight = total;
+		cell->numLights  = 0;
+		for ( j = 0; j < s_worldData.numLights; j++ ) {
+			if ( R_Cod1LightTouchesBounds( &s_worldData.lights[j], cell->bounds ) ) {
+				if ( out )
+					out[total] = j;
+				total++;
+				cell->numLights++;
+			}
+		}
+	}
+
+	s_worldData.firstOutsideLight = total;
+	s_worldData.numOutsideLights  = 0;
+	for ( j = 0; j < s_worldData.numLights; j++ ) {
+		for ( i = 0; i < s_worldData.numCells; i++ ) {
+			if ( R_Cod1LightInsideBounds( &s_worldData.lights[j], s_worldData.cells[i].bounds ) )
+				break;
+		}
+
+		if ( i == s_worldData.numCells ) {
+			if ( out )
+				out[total] = j;
+			total++;
+			s_worldData.numOutsideLights++;
+		}
+	}
+
+	return total;
+}
+
+static void R_LoadLightsCod1( void ) {
+	char      spawnVarChars[2048];
+	char     *spawnVars[COD1_MAX_SPAWN_VARS][2];
+	int       numSpawnVars, numLights, i;
+	mlight_t *light;
+
+	R_ClearEntityLightCache();
+
+	numLights = 0;
+	while ( R_ParseSpawnVars( spawnVarChars, sizeof( spawnVarChars ), &numSpawnVars, spawnVars ) ) {
+		for ( i = 0; i < numSpawnVars; i++ ) {
+			if ( !Q_stricmp( spawnVars[i][0], "classname" ) && !Q_stricmp( spawnVars[i][1], "light" ) )
+				numLights++;
+		}
+	}
+
+	if ( !numLights )
+		return;
+
+	s_worldData.lights = ri.Hunk_Alloc( numLights * sizeof( *s_worldData.lights ), h_low );
+
+	light = s_worldData.lights;
+	while ( R_ParseSpawnVars( spawnVarChars, sizeof( spawnVarChars ), &numSpawnVars, spawnVars ) ) {
+		qboolean isLight = qfalse, originSet = qfalse;
+		float    intensity = COD1_LIGHT_RADIUS, radius = 0, scale = 1.0f, max;
+		vec3_t   color;
+
+		VectorSet( color, 1, 1, 1 );
+
+		for ( i = 0; i < numSpawnVars; i++ ) {
+			if ( !Q_stricmp( spawnVars[i][0], "classname" ) && !Q_stricmp( spawnVars[i][1], "light" ) )
+				isLight = qtrue;
+			else if ( !Q_stricmp( spawnVars[i][0], "origin" ) )
+				originSet = sscanf( spawnVars[i][1], "%f %f %f", &light->origin[0], &light->origin[1], &light->origin[2] ) == 3;
+			else if ( !Q_stricmp( spawnVars[i][0], "light" ) || !Q_stricmp( spawnVars[i][0], "_light" ) )
+				sscanf( spawnVars[i][1], "%f", &intensity );
+			else if ( !Q_stricmp( spawnVars[i][0], "radius" ) )
+				sscanf( spawnVars[i][1], "%f", &radius );
+			else if ( !Q_stricmp( spawnVars[i][0], "intensity" ) )
+				sscanf( spawnVars[i][1], "%f", &scale );
+			else if ( !Q_stricmp( spawnVars[i][0], "_color" ) || !Q_stricmp( spawnVars[i][0], "color" ) )
+				sscanf( spawnVars[i][1], "%f %f %f", &color[0], &color[1], &color[2] );
+		}
+
+		if ( !isLight || !originSet )
+			continue;
+
+		// the light value doubles as the radius, as with linear q3map lights
+		light->radius = radius > 0 ? radius : intensity;
+		if ( light->radius <= 0 || scale <= 0 )
+			continue;
+
+		max = MAX( MAX( color[0], color[1] ), color[2] );
+		if ( max <= 0 )
+			continue;
+
+		VectorScale( color, 255.0f * scale / max, light->color );
+		light++;
+	}
+
+	s_worldData.numLights = light - s_worldData.lights;
+	if ( !s_worldData.numLights )
+		return;
+
+	s_worldData.cellLights = ri.Hunk_Alloc( MAX( R_Cod1BuildLightLists( NULL ), 1 ) * sizeof( int ), h_low );
+	R_Cod1BuildLightLists( s_worldData.cellLights );
+
+	ri.Printf( PRINT_ALL, "...%d lights for entity lighting\n", s_worldData.numLights );
+}
+
 /* -------------------------------------------------------------------------
    Submodels – GL2 bmodel_t uses int firstSurface/numSurfaces indices
    ------------------------------------------------------------------------- */
@@ -431,6 +1150,515 @@ static void R_LoadSubmodelsCod1( const byte *base ) {
 	}
 }
 
+/* -------------------------------------------------------------------------
+   Static world VAOs
+
+   Soups are sorted by shader and cell and packed into as few VAOs as the
+   16-bit indexes allow, so runs of neighbouring soups end up contiguous in
+   one index buffer.  surfacesDrawOrder makes R_AddWorldSurfaces emit them in
+   that order, which lets the back end draw each run with a single call.
+   ------------------------------------------------------------------------- */
+static int R_Cod1SurfaceCompare( const void *a, const void *b ) {
+	int         ia = *(const int *)a;
+	int         ib = *(const int *)b;
+	msurface_t *sa = &s_worldData.surfaces[ia];
+	msurface_t *sb = &s_worldData.surfaces[ib];
+
+	if ( sa->shader->sortedIndex != sb->shader->sortedIndex )
+		return sa->shader->sortedIndex < sb->shader->sortedIndex ? -1 : 1;
+
+	if ( s_worldData.surfacesCell[ia] != s_worldData.surfacesCell[ib] )
+		return s_worldData.surfacesCell[ia] < s_worldData.surfacesCell[ib] ? -1 : 1;
+
+	return ia - ib;
+}
+
+/* -------------------------------------------------------------------------
+   Soup cells
+
+   A soup's cell is the first cell whose AABB tree references it.  The VAO
+   packing groups soups by it, and R_AddWorldSurfaces uses it to emit the
+   opaque world roughly front to back.
+   ------------------------------------------------------------------------- */
+static void R_AssignSurfaceCellsCod1( void ) {
+	int i, j, k;
+
+	if ( !s_worldData.numsurfaces )
+		return;
+
+	s_worldData.surfacesCell = ri.Hunk_Alloc( s_worldData.numsurfaces * sizeof( int ), h_low );
+
+	for ( i = 0; i < s_worldData.numsurfaces; i++ )
+		s_worldData.surfacesCell[i] = -1;
+
+	for ( i = 0; i < s_worldData.numCells && s_worldData.numAabbTrees; i++ ) {
+		int tree = s_worldData.cells[i].aabbTree;
+
+		if ( tree < 0 || tree >= s_worldData.numAabbTrees )
+			continue;
+
+		for ( j = tree; j < s_worldData.aabbTrees[tree].next; j++ ) {
+			maabbtree_t *node = &s_worldData.aabbTrees[j];
+
+			for ( k = 0; k < node->numCullGroups; k++ ) {
+				mcullgroup_t *group = &s_worldData.cullGroups[node->firstCullGroup + k];
+				int           n;
+
+				for ( n = 0; n < group->numSurfaces; n++ ) {
+					int surf = s_worldData.cullGroupSurfaces[group->firstSurface + n];
+					if ( s_worldData.surfacesCell[surf] < 0 )
+						s_worldData.surfacesCell[surf] = i;
+				}
+			}
+		}
+	}
+
+	if ( !s_worldData.numCells || !s_worldData.numWorldSurfaces )
+		return;
+
+	s_worldData.cellRank        = ri.Hunk_Alloc( s_worldData.numCells * sizeof( int ), h_low );
+	s_worldData.cellOrder       = ri.Hunk_Alloc( ( s_worldData.numCells + 1 ) * sizeof( int ), h_low );
+	s_worldData.cellDist        = ri.Hunk_Alloc( s_worldData.numCells * sizeof( float ), h_low );
+	s_worldData.surfacesVisible = ri.Hunk_Alloc( s_worldData.numWorldSurfaces * sizeof( int ), h_low );
+	s_worldData.surfacesSorted  = ri.Hunk_Alloc( s_worldData.numWorldSurfaces * sizeof( int ), h_low );
+}
+
+static void R_CreateWorldVaosCod1( void ) {
+	int        *order;
+	int         numSorted, numVaos, first, last, i, j;
+
+	if ( !r_worldVaos->integer || !s_worldData.numsurfaces )
+		return;
+
+	order = ri.Hunk_AllocateTempMemory( s_worldData.numsurfaces * sizeof( int ) );
+
+	/* sky, portal and CPU deformed shaders keep going through tess */
+	numSorted = 0;
+	for ( i = 0; i < s_worldData.numsurfaces; i++ ) {
+		msurface_t      *surf = &s_worldData.surfaces[i];
+		srfBspSurface_t *cv   = (srfBspSurface_t *)surf->data;
+
+		if ( surf->shader->isSky || surf->shader->isPortal || ShaderRequiresCPUDeforms( surf->shader ) )
+			continue;
+
+		if ( !cv->numVerts || !cv->numIndexes )
+			continue;
+
+		order[numSorted++] = i;
+	}
+
+	qsort( order, numSorted, sizeof( *order ), R_Cod1SurfaceCompare );
+
+	numVaos = 0;
+	for ( first = 0; first < numSorted; first = last ) {
+		srfVert_t *verts;
+		glIndex_t *indexes;
+		vao_t     *vao;
+		int        numVerts = 0, numIndexes = 0;
+
+		for ( last = first; last < numSorted; last++ ) {
+			srfBspSurface_t *cv = (srfBspSurface_t *)s_worldData.surfaces[order[last]].data;
+
+			if ( numVerts + cv->numVerts > 65536 )
+				break;
+
+			numVerts   += cv->numVerts;
+			numIndexes += cv->numIndexes;
+		}
+
+		verts   = ri.Hunk_AllocateTempMemory( numVerts * sizeof( *verts ) );
+		indexes = ri.Hunk_AllocateTempMemory( numIndexes * sizeof( *indexes ) );
+
+		numVerts = numIndexes = 0;
+		for ( i = first; i < last; i++ ) {
+			srfBspSurface_t *cv = (srfBspSurface_t *)s_worldData.surfaces[order[i]].data;
+
+			Com_Memcpy( verts + numVerts, cv->verts, cv->numVerts * sizeof( *verts ) );
+			for ( j = 0; j < cv->numIndexes; j++ )
+				indexes[numIndexes + j] = numVerts + cv->indexes[j];
+
+			cv->firstIndex = numIndexes;
+			numVerts   += cv->numVerts;
+			numIndexes += cv->numIndexes;
+		}
+
+		vao = R_CreateVao2( va( "cod1world%d", numVaos ), numVerts, verts, numIndexes, indexes );
+		if ( vao )
+			R_CreateDepthVao( vao, numVerts, verts );
+
+		for ( i = first; i < last; i++ )
+			( (srfBspSurface_t *)s_worldData.surfaces[order[i]].data )->vao = vao;
+
+		ri.Hunk_FreeTempMemory( indexes );
+		ri.Hunk_FreeTempMemory( verts );
+		numVaos++;
+	}
+
+	/* world surfaces in vao order first, then the ones drawn through tess */
+	s_worldData.surfacesDrawOrder = ri.Hunk_Alloc( s_worldData.numWorldSurfaces * sizeof( int ), h_low );
+	for ( i = 0, j = 0; i < numSorted; i++ ) {
+		if ( order[i] < s_worldData.numWorldSurfaces )
+			s_worldData.surfacesDrawOrder[j++] = order[i];
+	}
+	for ( i = 0; i < s_worldData.numWorldSurfaces; i++ ) {
+		if ( !( (srfBspSurface_t *)s_worldData.surfaces[i].data )->vao )
+			s_worldData.surfacesDrawOrder[j++] = i;
+	}
+
+	ri.Hunk_FreeTempMemory( order );
+
+	ri.Printf( PRINT_ALL, "...packed %d CoD1 soups into %d world VAOs\n", numSorted, numVaos );
+}
+
+/* -------------------------------------------------------------------------
+   Static models
+
+   misc_model props whose model loads as MD3 are baked into world space
+   once.  Frame 0 of the first LOD is transformed and lit at the prop
+   origin.  The surfaces are packed into VAOs by material, so the props
+   draw like the world.  Every leaf the prop box touches lists the prop, and
+   the leaf walk marks it for the view.  Props with a targetname can be
+   moved by script, so they stay entities, and so do props whose shaders
+   take their colour from the entity.  RE_AddRefEntityToScene drops the
+   entities cgame sends for the baked props.  Runs once tr.world is set,
+   as the lighting goes through R_LightForPoint.
+   ------------------------------------------------------------------------- */
+static qboolean R_StaticModelShaderOk( const shader_t *sh ) {
+	int i;
+
+	for ( i = 0; i < MAX_SHADER_STAGES && sh->stages[i] && sh->stages[i]->active; i++ ) {
+		const shaderStage_t *stage = sh->stages[i];
+
+		if ( stage->rgbGen == CGEN_ENTITY || stage->rgbGen == CGEN_ONE_MINUS_ENTITY || stage->rgbGen == CGEN_LIGHTING_DIFFUSE )
+			return qfalse;
+
+		if ( stage->alphaGen == AGEN_ENTITY || stage->alphaGen == AGEN_ONE_MINUS_ENTITY )
+			return qfalse;
+	}
+
+	return qtrue;
+}
+
+static shader_t *R_StaticModelSurfaceShader( const mdvSurface_t *surf ) {
+	if ( !surf->numShaderIndexes )
+		return tr.defaultShader;
+
+	return R_FindShader( tr.shaders[surf->shaderIndexes[0]]->name, LIGHTMAP_BY_VERTEX, qtrue );
+}
+
+/* returns the model of a bakeable misc_model, 0 for anything else */
+static qhandle_t R_ParseStaticModel( int numSpawnVars, char *spawnVars[][2], vec3_t origin, vec3_t angles ) {
+	const char *model = NULL;
+	qboolean    isModel = qfalse;
+	mdvModel_t *mdv;
+	model_t    *mod;
+	qhandle_t   h;
+	int         i;
+
+	VectorClear( origin );
+	VectorClear( angles );
+
+	for ( i = 0; i < numSpawnVars; i++ ) {
+		if ( !Q_stricmp( spawnVars[i][0], "classname" ) )
+			isModel = !Q_stricmp( spawnVars[i][1], "misc_model" );
+		else if ( !Q_stricmp( spawnVars[i][0], "targetname" ) )
+			return 0;
+		else if ( !Q_stricmp( spawnVars[i][0], "model" ) )
+			model = spawnVars[i][1];
+		else if ( !Q_stricmp( spawnVars[i][0], "origin" ) )
+			sscanf( spawnVars[i][1], "%f %f %f", &origin[0], &origin[1], &origin[2] );
+		else if ( !Q_stricmp( spawnVars[i][0], "angles" ) )
+			sscanf( spawnVars[i][1], "%f %f %f", &angles[0], &angles[1], &angles[2] );
+		else if ( !Q_stricmp( spawnVars[i][0], "angle" ) )
+			sscanf( spawnVars[i][1], "%f", &angles[YAW] );
+	}
+
+	if ( !isModel || !model || !model[0] )
+		return 0;
+
+	h   = RE_RegisterModel( model );
+	mod = R_GetModelByHandle( h );
+	if ( !h || mod->type != MOD_MESH || !mod->mdv[0] )
+		return 0;
+
+	mdv = mod->mdv[0];
+	for ( i = 0; i < mdv->numSurfaces; i++ ) {
+		if ( !R_StaticModelShaderOk( R_StaticModelSurfaceShader( &mdv->surfaces[i] ) ) )
+			return 0;
+	}
+
+	return h;
+}
+
+static void R_StaticModelLeafs( mnode_t *node, vec3_t bounds[2], int model, int *counts, int *out ) {
+	int leaf;
+
+	while ( node->contents == -1 ) {
+		int side = BoxOnPlaneSide( bounds[0], bounds[1], node->plane );
+
+		if ( side == 1 ) {
+			node = node->children[0];
+		} else if ( side == 2 ) {
+			node = node->children[1];
+		} else {
+			R_StaticModelLeafs( node->children[0], bounds, model, counts, out );
+			node = node->children[1];
+		}
+	}
+
+	leaf = node - s_worldData.nodes;
+	if ( out )
+		out[node->firstStaticModel + counts[leaf]] = model;
+	counts[leaf]++;
+}
+
+static void R_BakeStaticModel( mstaticModel_t *sm, const vec3_t angles ) {
+	mdvModel_t *mdv = R_GetModelByHandle( sm->hModel )->mdv[0];
+	vec3_t      axis[3], ambient, directed, lightDir;
+	int         i, j;
+
+	AnglesToAxis( angles, axis );
+	VectorCopy( axis[0], sm->forward );
+
+	if ( !R_LightForPoint( sm->origin, ambient, directed, lightDir ) ) {
+		VectorSet( ambient, tr.identityLight * 150, tr.identityLight * 150, tr.identityLight * 150 );
+		VectorCopy( ambient, directed );
+		VectorCopy( tr.sunDirection, lightDir );
+	}
+
+	// the minimum add and clamp of R_SetupEntityLighting
+	for ( i = 0; i < 3; i++ ) {
+		ambient[i]  = MIN( ambient[i] + tr.identityLight * 32, 255.0f );
+		directed[i] = MIN( directed[i], 255.0f );
+	}
+
+	ClearBounds( sm->bounds[0], sm->bounds[1] );
+
+	for ( i = 0; i < sm->numSurfaces; i++ ) {
+		const mdvSurface_t *in   = &mdv->surfaces[i];
+		msurface_t         *surf = &s_worldData.staticSurfaces[sm->firstSurface + i];
+		srfBspSurface_t    *cv;
+
+		cv = ri.Hunk_Alloc( sizeof( *cv ), h_low );
+		cv->surfaceType = SF_TRIANGLES;
+		cv->numVerts    = in->numVerts;
+		cv->verts       = ri.Hunk_Alloc( in->numVerts * sizeof( *cv->verts ), h_low );
+		cv->numIndexes  = in->numIndexes;
+		cv->indexes     = ri.Hunk_Alloc( in->numIndexes * sizeof( *cv->indexes ), h_low );
+		Com_Memcpy( cv->indexes, in->indexes, in->numIndexes * sizeof( *cv->indexes ) );
+
+		surf->data         = (surfaceType_t *)cv;
+		surf->shader       = R_StaticModelSurfaceShader( in );
+		surf->fogIndex     = 0;
+		surf->cubemapIndex = 0;
+		surf->cullinfo.type = CULLINFO_BOX;
+		ClearBounds( surf->cullinfo.bounds[0], surf->cullinfo.bounds[1] );
+
+		for ( j = 0; j < in->numVerts; j++ ) {
+			const mdvVertex_t *src = &in->verts[j];
+			srfVert_t         *dst = &cv->verts[j];
+			vec3_t             n, wn;
+			vec4_t             t, wt, c;
+			float              d;
+
+			VectorCopy( sm->origin, dst->xyz );
+			VectorMA( dst->xyz, src->xyz[0], axis[0], dst->xyz );
+			VectorMA( dst->xyz, src->xyz[1], axis[1], dst->xyz );
+			VectorMA( dst->xyz, src->xyz[2], axis[2], dst->xyz );
+			AddPointToBounds( dst->xyz, surf->cullinfo.bounds[0], surf->cullinfo.bounds[1] );
+
+			dst->st[0] = in->st[j].st[0];
+			dst->st[1] = in->st[j].st[1];
+			dst->lightmap[0] = dst->lightmap[1] = 0;
+
+			R_VaoUnpackNormal( n, (int16_t *)src->normal );
+			VectorScale( axis[0], n[0], wn );
+			VectorMA( wn, n[1], axis[1], wn );
+			VectorMA( wn, n[2], axis[2], wn );
+			R_VaoPackNormal( dst->normal, wn );
+
+			R_VaoUnpackTangent( t, (int16_t *)src->tangent );
+			VectorScale( axis[0], t[0], wt );
+			VectorMA( wt, t[1], axis[1], wt );
+			VectorMA( wt, t[2], axis[2], wt );
+			wt[3] = t[3];
+			R_VaoPackTangent( dst->tangent, wt );
+
+			R_VaoPackNormal( dst->lightdir, lightDir );
+
+			d = MAX( DotProduct( wn, lightDir ), 0.0f );
+			c[0] = MIN( ( ambient[0] + directed[0] * d ) / 255.0f, 1.0f );
+			c[1] = MIN( ( ambient[1] + directed[1] * d ) / 255.0f, 1.0f );
+			c[2] = MIN( ( ambient[2] + directed[2] * d ) / 255.0f, 1.0f );
+			c[3] = 1.0f;
+			R_VaoPackColor( dst->color, c );
+		}
+
+		AddPointToBounds( surf->cullinfo.bounds[0], sm->bounds[0], sm->bounds[1] );
+		AddPointToBounds( surf->cullinfo.bounds[1], sm->bounds[0], sm->bounds[1] );
+	}
+}
+
+static int R_StaticSurfaceCompare( const void *a, const void *b ) {
+	int         ia = *(const int *)a;
+	int         ib = *(const int *)b;
+	msurface_t *sa = &s_worldData.staticSurfaces[ia];
+	msurface_t *sb = &s_worldData.staticSurfaces[ib];
+
+	if ( sa->shader->sortedIndex != sb->shader->sortedIndex )
+		return sa->shader->sortedIndex < sb->shader->sortedIndex ? -1 : 1;
+
+	return ia - ib;
+}
+
+static void R_CreateStaticModelVaos( void ) {
+	int *order;
+	int  numSorted, numVaos, first, last, i, j;
+
+	order = ri.Hunk_AllocateTempMemory( s_worldData.numStaticSurfaces * sizeof( int ) );
+
+	numSorted = 0;
+	for ( i = 0; i < s_worldData.numStaticSurfaces; i++ ) {
+		msurface_t *surf = &s_worldData.staticSurfaces[i];
+
+		if ( surf->shader->isSky || surf->shader->isPortal || ShaderRequiresCPUDeforms( surf->shader ) )
+			continue;
+
+		order[numSorted++] = i;
+	}
+
+	qsort( order, numSorted, sizeof( *order ), R_StaticSurfaceCompare );
+
+	numVaos = 0;
+	for ( first = 0; first < numSorted; first = last ) {
+		srfVert_t *verts;
+		glIndex_t *indexes;
+		vao_t     *vao;
+		int        numVerts = 0, numIndexes = 0;
+
+		for ( last = first; last < numSorted; last++ ) {
+			srfBspSurface_t *cv = (srfBspSurface_t *)s_worldData.staticSurfaces[order[last]].data;
+
+			if ( last > first && numVerts + cv->numVerts > 65536 )
+				break;
+
+			numVerts   += cv->numVerts;
+			numIndexes += cv->numIndexes;
+		}
+
+		verts   = ri.Hunk_AllocateTempMemory( numVerts * sizeof( *verts ) );
+		indexes = ri.Hunk_AllocateTempMemory( numIndexes * sizeof( *indexes ) );
+
+		numVerts = numIndexes = 0;
+		for ( i = first; i < last; i++ ) {
+			srfBspSurface_t *cv = (srfBspSurface_t *)s_worldData.staticSurfaces[order[i]].data;
+
+			Com_Memcpy( verts + numVerts, cv->verts, cv->numVerts * sizeof( *verts ) );
+			for ( j = 0; j < cv->numIndexes; j++ )
+				indexes[numIndexes + j] = numVerts + cv->indexes[j];
+
+			cv->firstIndex = numIndexes;
+			numVerts   += cv->numVerts;
+			numIndexes += cv->numIndexes;
+		}
+
+		vao = R_CreateVao2( va( "staticmodels%d", numVaos ), numVerts, verts, numIndexes, indexes );
+
+		for ( i = first; i < last; i++ )
+			( (srfBspSurface_t *)s_worldData.staticSurfaces[order[i]].data )->vao = vao;
+
+		ri.Hunk_FreeTempMemory( indexes );
+		ri.Hunk_FreeTempMemory( verts );
+		numVaos++;
+	}
+
+	ri.Hunk_FreeTempMemory( order );
+}
+
+void R_LoadStaticModelsCod1( void ) {
+	char            spawnVarChars[2048];
+	char           *spawnVars[COD1_MAX_SPAWN_VARS][2];
+	int             numSpawnVars, numModels, numSurfaces, numRefs, i;
+	int            *counts;
+	vec3_t          origin, angles;
+	mstaticModel_t *sm;
+	qhandle_t       h;
+
+	for ( i = 0; i < STATIC_MODEL_HASH; i++ )
+		s_worldData.staticModelHash[i] = -1;
+
+	if ( !r_staticModels->integer )
+		return;
+
+	numModels = numSurfaces = 0;
+	while ( R_ParseSpawnVars( spawnVarChars, sizeof( spawnVarChars ), &numSpawnVars, spawnVars ) ) {
+		h = R_ParseStaticModel( numSpawnVars, spawnVars, origin, angles );
+		if ( h ) {
+			numModels++;
+			numSurfaces += R_GetModelByHandle( h )->mdv[0]->numSurfaces;
+		}
+	}
+
+	if ( !numModels )
+		return;
+
+	s_worldData.staticModels      = ri.Hunk_Alloc( numModels * sizeof( *s_worldData.staticModels ), h_low );
+	s_worldData.staticSurfaces    = ri.Hunk_Alloc( numSurfaces * sizeof( *s_worldData.staticSurfaces ), h_low );
+	s_worldData.numStaticSurfaces = numSurfaces;
+
+	sm = s_worldData.staticModels;
+	numSurfaces = 0;
+	while ( R_ParseSpawnVars( spawnVarChars, sizeof( spawnVarChars ), &numSpawnVars, spawnVars ) ) {
+		int key;
+
+		h = R_ParseStaticModel( numSpawnVars, spawnVars, origin, angles );
+		if ( !h )
+			continue;
+
+		sm->hModel       = h;
+		sm->firstSurface = numSurfaces;
+		sm->numSurfaces  = R_GetModelByHandle( h )->mdv[0]->numSurfaces;
+		VectorCopy( origin, sm->origin );
+		R_BakeStaticModel( sm, angles );
+		numSurfaces += sm->numSurfaces;
+
+		key = R_StaticModelHash( h, origin );
+		sm->hashNext = s_worldData.staticModelHash[key];
+		s_worldData.staticModelHash[key] = sm - s_worldData.staticModels;
+		sm++;
+	}
+	s_worldData.numStaticModels = sm - s_worldData.staticModels;
+
+	/* list each prop in every leaf its box touches */
+	counts = ri.Hunk_AllocateTempMemory( s_worldData.numnodes * sizeof( int ) );
+	Com_Memset( counts, 0, s_worldData.numnodes * sizeof( int ) );
+
+	for ( i = 0; i < s_worldData.numStaticModels; i++ )
+		R_StaticModelLeafs( s_worldData.nodes, s_worldData.staticModels[i].bounds, i, counts, NULL );
+
+	numRefs = 0;
+	for ( i = 0; i < s_worldData.numnodes; i++ ) {
+		s_worldData.nodes[i].firstStaticModel = numRefs;
+		s_worldData.nodes[i].numStaticModels  = counts[i];
+		numRefs += counts[i];
+		counts[i] = 0;
+	}
+
+	s_worldData.leafStaticModels = ri.Hunk_Alloc( numRefs * sizeof( int ), h_low );
+	for ( i = 0; i < s_worldData.numStaticModels; i++ )
+		R_StaticModelLeafs( s_worldData.nodes, s_worldData.staticModels[i].bounds, i, counts, s_worldData.leafStaticModels );
+
+	ri.Hunk_FreeTempMemory( counts );
+
+	s_worldData.staticModelsViewCount   = ri.Hunk_Alloc( s_worldData.numStaticModels * sizeof( int ), h_low );
+	s_worldData.staticModelsDlightBits  = ri.Hunk_Alloc( s_worldData.numStaticModels * sizeof( int ), h_low );
+	s_worldData.staticModelsPshadowBits = ri.Hunk_Alloc( s_worldData.numStaticModels * sizeof( int ), h_low );
+
+	R_CreateStaticModelVaos();
+
+	ri.Printf( PRINT_ALL, "...baked %d static models, %d surfaces\n", s_worldData.numStaticModels, s_worldData.numStaticSurfaces );
+}
+
 /* =========================================================================
    R_LoadCod1WorldMap – main entry point called from RE_LoadWorldMap.
    ========================================================================= */
@@ -440,6 +1668,7 @@ void R_LoadCod1WorldMap( const byte *base ) {
 	fileBase = (byte *)base;
 
 	R_LoadShadersCod1    ( base );
+	R_PrefetchWorldImages( s_worldData.shaders, s_worldData.numShaders );
 	R_LoadLightmapsCod1  ( base );
 	R_LoadPlanesCod1     ( base );
 
@@ -447,9 +1676,16 @@ void R_LoadCod1WorldMap( const byte *base ) {
 	s_worldData.numfogs = 0;
 
 	R_LoadCod1Surfaces   ( base );
+	R_FinishImagePrefetch( );
 	R_LoadCod1Marksurfaces( base );
+	R_LoadCellsAndPortalsCod1( base );
+	R_LoadOccludersCod1  ( base );
 	R_LoadCod1NodesAndLeafs( base );
 	R_LoadSubmodelsCod1  ( base );
+	R_LoadCullGroupsCod1 ( base );
+	R_AssignSurfaceCellsCod1( );
+	R_CreateWorldVaosCod1( );
 	R_LoadVisibilityCod1 ( base );
 	R_LoadEntitiesCod1   ( base );
+	R_LoadLightsCod1     ( );
 }
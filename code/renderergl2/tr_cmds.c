@@ -21,6 +21,107 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 #include "tr_local.h"
 
+#define	PC_OFS(x)	(size_t)&(((backEndCounters_t *)0)->x)
+#define	PC_NONE		((size_t)-1)
+
+// GL work per frame, with what the state caches kept from reaching the driver
+static const struct {
+	const char	*name;
+	size_t		issued;
+	size_t		skipped;
+} glCounters[] = {
+	{ "draws",			PC_OFS( c_draws ),				PC_NONE },
+	{ "multidraws",		PC_OFS( c_multiDraws ),			PC_NONE },
+	{ "programs",		PC_OFS( c_glslShaderBinds ),	PC_OFS( c_glslShaderBindsSkipped ) },
+	{ "uniforms",		PC_OFS( c_uniforms ),			PC_OFS( c_uniformsSkipped ) },
+	{ "uniformblocks",	PC_OFS( c_uniformBlocks ),		PC_NONE },
+	{ "textures",		PC_OFS( c_textureBinds ),		PC_OFS( c_textureBindsSkipped ) },
+	{ "state",			PC_OFS( c_stateChanges ),		PC_OFS( c_stateChangesSkipped ) },
+	{ "cull",			PC_OFS( c_cullChanges ),		PC_OFS( c_cullChangesSkipped ) },
+	{ "vaos",			PC_OFS( c_vaoBinds ),			PC_OFS( c_vaoBindsSkipped ) },
+	{ "fbos",			PC_OFS( c_fboBinds ),			PC_OFS( c_fboBindsSkipped ) },
+	{ "uploads",		PC_OFS( c_bufferUploads ),		PC_NONE },
+	{ "uploadbytes",	PC_OFS( c_bufferUploadBytes ),	PC_NONE },
+};
+
+#define	NUM_GL_COUNTERS	ARRAY_LEN( glCounters )
+
+static int R_GLCounter( size_t ofs ) {
+	if ( ofs == PC_NONE ) {
+		return 0;
+	}
+	return *(int *)( (byte *)&backEnd.pc + ofs );
+}
+
+/*
+=====================
+R_PrintGLCounters
+
+r_speeds 8 prints the busiest counters first, r_speeds 9 prints a CSV line
+per frame (after a header) for pasting into a spreadsheet from the log
+=====================
+*/
+static void R_PrintGLCounters( qboolean csv ) {
+	static qboolean	csvHeader;
+	int				order[NUM_GL_COUNTERS];
+	int				i, j, t;
+	char			line[1024];
+
+	if ( csv ) {
+		if ( !csvHeader ) {
+			Q_strncpyz( line, "frame,msec", sizeof( line ) );
+			for ( i = 0; i < NUM_GL_COUNTERS; i++ ) {
+				Q_strcat( line, sizeof( line ), va( ",%s", glCounters[i].name ) );
+				if ( glCounters[i].skipped != PC_NONE ) {
+					Q_strcat( line, sizeof( line ), va( ",%s_skipped", glCounters[i].name ) );
+				}
+			}
+			ri.Printf( PRINT_ALL, "%s\n", line );
+			csvHeader = qtrue;
+		}
+
+		Com_sprintf( line, sizeof( line ), "%i,%i", tr.frameCount, backEnd.pc.msec );
+		for ( i = 0; i < NUM_GL_COUNTERS; i++ ) {
+			Q_strcat( line, sizeof( line ), va( ",%i", R_GLCounter( glCounters[i].issued ) ) );
+			if ( glCounters[i].skipped != PC_NONE ) {
+				Q_strcat( line, sizeof( line ), va( ",%i", R_GLCounter( glCounters[i].skipped ) ) );
+			}
+		}
+		ri.Printf( PRINT_ALL, "%s\n", line );
+		return;
+	}
+
+	// leaving CSV mode starts a new table next time
+	csvHeader = qfalse;
+
+	for ( i = 0; i < NUM_GL_COUNTERS; i++ ) {
+		order[i] = i;
+	}
+
+	// byte counts would always win, so they go last
+	for ( i = 0; i < NUM_GL_COUNTERS - 2; i++ ) {
+		for ( j = i + 1; j < NUM_GL_COUNTERS - 1; j++ ) {
+			if ( R_GLCounter( glCounters[order[j]].issued ) > R_GLCounter( glCounters[order[i]].issued ) ) {
+				t = order[i]; order[i] = order[j]; order[j] = t;
+			}
+		}
+	}
+
+	line[0] = '\0';
+	for ( i = 0; i < NUM_GL_COUNTERS; i++ ) {
+		const char *name = glCounters[order[i]].name;
+		int issued = R_GLCounter( glCounters[order[i]].issued );
+
+		if ( glCounters[order[i]].skipped != PC_NONE ) {
+			Q_strcat( line, sizeof( line ), va( "%s %i (%i skipped)  ", name, issued,
+				R_GLCounter( glCounters[order[i]].skipped ) ) );
+		} else {
+			Q_strcat( line, sizeof( line ), va( "%s %i  ", name, issued ) );
+		}
+	}
+	ri.Printf( PRINT_ALL, "%s\n", line );
+}
+
 /*
 =====================
 R_PerformanceCounters
@@ -46,8 +147,11 @@ void R_PerformanceCounters( void ) {
 		ri.Printf (PRINT_ALL, "(md3) %i sin %i sclip  %i sout %i bin %i bclip %i bout\n",
 			tr.pc.c_sphere_cull_md3_in, tr.pc.c_sphere_cull_md3_clip, tr.pc.c_sphere_cull_md3_out, 
 			tr.pc.c_box_cull_md3_in, tr.pc.c_box_cull_md3_clip, tr.pc.c_box_cull_md3_out );
+		ri.Printf (PRINT_ALL, "(aabb) %i in %i clip %i out  (hiz) %i out\n",
+			tr.pc.c_aabb_in, tr.pc.c_aabb_clip, tr.pc.c_aabb_out, tr.pc.c_hiz_out );
 	} else if (r_speeds->integer == 3) {
-		ri.Printf (PRINT_ALL, "viewcluster: %i\n", tr.viewCluster );
+		ri.Printf (PRINT_ALL, "viewcluster: %i  cells: %i  portals: %i  occluders: %i  occluded: %i\n",
+			tr.viewCluster, tr.pc.c_cells, tr.pc.c_portals, tr.pc.c_occluders, tr.pc.c_occluded );
 	} else if (r_speeds->integer == 4) {
 		if ( backEnd.pc.c_dlightVertexes ) {
 			ri.Printf (PRINT_ALL, "dlight srf:%i  culled:%i  verts:%i  tris:%i\n", 
@@ -61,8 +165,8 @@ void R_PerformanceCounters( void ) {
 	}
 	else if (r_speeds->integer == 6 )
 	{
-		ri.Printf( PRINT_ALL, "flare adds:%i tests:%i renders:%i\n", 
-			backEnd.pc.c_flareAdds, backEnd.pc.c_flareTests, backEnd.pc.c_flareRenders );
+		ri.Printf( PRINT_ALL, "flare adds:%i tests:%i renders:%i queries:%i\n", 
+			backEnd.pc.c_flareAdds, backEnd.pc.c_flareTests, backEnd.pc.c_flareRenders, backEnd.pc.c_flareQueries );
 	}
 	else if (r_speeds->integer == 7 )
 	{
@@ -71,6 +175,10 @@ void R_PerformanceCounters( void ) {
 		ri.Printf( PRINT_ALL, "GLSL binds: %i  draws: gen %i light %i fog %i dlight %i\n",
 			backEnd.pc.c_glslShaderBinds, backEnd.pc.c_genericDraws, backEnd.pc.c_lightallDraws, backEnd.pc.c_fogDraws, backEnd.pc.c_dlightDraws);
 	}
+	else if (r_speeds->integer == 8 || r_speeds->integer == 9 )
+	{
+		R_PrintGLCounters( r_speeds->integer == 9 );
+	}
 
 	Com_Memset( &tr.pc, 0, sizeof( tr.pc ) );
 	Com_Memset( &backEnd.pc, 0, sizeof( backEnd.pc ) );
@@ -85,23 +193,59 @@ R_IssueRenderCommands
 void R_IssueRenderCommands( qboolean runPerformanceCounters ) {
 	renderCommandList_t	*cmdList;
 
-	cmdList = &backEndData->commands;
+	cmdList = &backEndData[tr.smpFrame]->commands;
 	assert(cmdList);
+
+	// a sync with nothing queued doesn't need to wake the render thread
+	if ( glConfig.smpActive && !cmdList->used && !runPerformanceCounters ) {
+		return;
+	}
+
 	// add an end-of-list command
 	*(int *)(cmdList->cmds + cmdList->used) = RC_END_OF_LIST;
 
 	// clear it out, in case this is a sync and not a buffer flip
 	cmdList->used = 0;
 
+	if ( glConfig.smpActive ) {
+		if ( r_showSmp->integer ) {
+			// R if the front end had to wait for the back end, . if not
+			ri.Printf( PRINT_ALL, renderThreadActive ? "R" : "." );
+		}
+
+		// sleep until the renderer has completed
+		GLimp_FrontEndSleep();
+
+		// the window is only changed while the render thread is idle
+		GLimp_CheckFullscreen();
+	}
+
+	// at this point, the back end thread is idle, so it is ok
+	// to look at its performance counters
 	if ( runPerformanceCounters ) {
 		R_PerformanceCounters();
+		R_LogGpuTimers();
+
+		// once a frame, while the front end may still touch the GL context
+		R_UpdateTextureStreaming();
 	}
 
 	// actually start the commands going
 	if ( !r_skipBackEnd->integer ) {
 		// let it start on the new batch
-		RB_ExecuteRenderCommands( cmdList->cmds );
+		if ( !glConfig.smpActive ) {
+			RB_ExecuteRenderCommands( cmdList->cmds );
+		} else {
+			GLimp_WakeRenderer( cmdList->cmds );
+
+			// screenshots and the like use the hunk and file system
+			// from the back end, so keep the main thread out of them
+			if ( tr.smpSyncFrame || r_measureOverdraw->integer || r_shownormals->integer ) {
+				GLimp_FrontEndSleep();
+			}
+		}
 	}
+	tr.smpSyncFrame = qfalse;
 }
 
 
@@ -117,6 +261,11 @@ void R_IssuePendingRenderCommands( void ) {
 		return;
 	}
 	R_IssueRenderCommands( qfalse );
+
+	// the front end owns the GL context once the render thread is idle
+	if ( glConfig.smpActive ) {
+		GLimp_FrontEndSleep();
+	}
 }
 
 /*
@@ -129,7 +278,7 @@ make sure there is enough command space
 void *R_GetCommandBufferReserved( int bytes, int reservedBytes ) {
 	renderCommandList_t	*cmdList;
 
-	cmdList = &backEndData->commands;
+	cmdList = &backEndData[tr.smpFrame]->commands;
 	bytes = PAD(bytes, sizeof(void *));
 
 	// always leave room for the end of list command
@@ -280,6 +429,33 @@ void RE_StretchPic ( float x, float y, float w, float h,
 	cmd->t2 = t2;
 }
 
+/*
+=============
+RE_StretchPics
+
+Queues a whole run of pics from one call, so a string of text
+costs one trap instead of one per character
+=============
+*/
+void RE_StretchPics( int numPics, const stretchPic_t *pics ) {
+	const float	*color;
+	int			i;
+
+	if ( !tr.registered ) {
+		return;
+	}
+	color = NULL;
+	for ( i = 0 ; i < numPics ; i++, pics++ ) {
+		if ( !color || color[0] != pics->color[0] || color[1] != pics->color[1]
+			|| color[2] != pics->color[2] || color[3] != pics->color[3] ) {
+			color = pics->color;
+			RE_SetColor( color );
+		}
+		RE_StretchPic( pics->x, pics->y, pics->w, pics->h,
+			pics->s1, pics->t1, pics->s2, pics->t2, pics->hShader );
+	}
+}
+
 #define MODE_RED_CYAN	1
 #define MODE_RED_BLUE	2
 #define MODE_RED_GREEN	3
@@ -444,6 +620,8 @@ void RE_BeginFrame( stereoFrame_t stereoFrame ) {
 		{
 			if(r_anaglyphMode->modified)
 			{
+				R_IssuePendingRenderCommands();
+
 				// clear both, front and backbuffer.
 				qglColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 				backEnd.colorMask[0] = GL_FALSE;
@@ -518,6 +696,7 @@ void RE_BeginFrame( stereoFrame_t stereoFrame ) {
 
 			if(r_anaglyphMode->modified)
 			{
+				R_IssuePendingRenderCommands();
 				qglColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 				backEnd.colorMask[0] = 0;
 				backEnd.colorMask[1] = 0;
@@ -532,6 +711,10 @@ void RE_BeginFrame( stereoFrame_t stereoFrame ) {
 				cmd->buffer = (int)GL_BACK;
 		}
 	}
+
+	// probes that weren't cached are filled in a few sides at a time
+	if (stereoFrame != STEREO_RIGHT)
+		R_RenderPendingCubemaps();
 	
 	tr.refdef.stereoFrame = stereoFrame;
 }
@@ -590,10 +773,12 @@ void RE_TakeVideoFrame( int width, int height,
 	}
 
 	cmd->commandId = RC_VIDEOFRAME;
+	tr.smpSyncFrame = qtrue;
 
 	cmd->width = width;
 	cmd->height = height;
 	cmd->captureBuffer = captureBuffer;
 	cmd->encodeBuffer = encodeBuffer;
 	cmd->motionJpeg = motionJpeg;
+	cmd->frameCount = tr.frameCount;
 }
@@ -24,9 +24,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 static struct
 {
-	GLuint textures[NUM_TEXTURE_BUNDLES];
+	GLuint textures[NUM_TEXTURE_UNITS];
 	GLenum texunit;
 
+	// with GL_ARB_multi_bind, what the next draw wants bound
+	GLuint queuedTextures[NUM_TEXTURE_UNITS];
+	qboolean texturesQueued;
+
 	GLuint program;
 
 	GLuint drawFramebuffer;
@@ -41,19 +45,21 @@ void GL_BindNullTextures(void)
 
 	if (glRefConfig.directStateAccess)
 	{
-		for (i = 0; i < NUM_TEXTURE_BUNDLES; i++)
+		for (i = 0; i < NUM_TEXTURE_UNITS; i++)
 		{
 			qglBindMultiTextureEXT(GL_TEXTURE0 + i, GL_TEXTURE_2D, 0);
 			glDsaState.textures[i] = 0;
+			glDsaState.queuedTextures[i] = 0;
 		}
 	}
 	else
 	{
-		for (i = 0; i < NUM_TEXTURE_BUNDLES; i++)
+		for (i = 0; i < NUM_TEXTURE_UNITS; i++)
 		{
 			qglActiveTexture(GL_TEXTURE0 + i);
 			qglBindTexture(GL_TEXTURE_2D, 0);
 			glDsaState.textures[i] = 0;
+			glDsaState.queuedTextures[i] = 0;
 		}
 
 		qglActiveTexture(GL_TEXTURE0);
@@ -65,8 +71,15 @@ int GL_BindMultiTexture(GLenum texunit, GLenum target, GLuint texture)
 {
 	GLuint tmu = texunit - GL_TEXTURE0;
 
+	glDsaState.queuedTextures[tmu] = texture;
+
 	if (glDsaState.textures[tmu] == texture)
+	{
+		backEnd.pc.c_textureBindsSkipped++;
 		return 0;
+	}
+
+	backEnd.pc.c_textureBinds++;
 
 	if (target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z)
 		target = GL_TEXTURE_CUBE_MAP;
@@ -76,6 +89,55 @@ int GL_BindMultiTexture(GLenum texunit, GLenum target, GLuint texture)
 	return 1;
 }
 
+/*
+With GL_ARB_multi_bind, texture binds for a draw are only recorded here, and
+GL_FlushTextures binds every changed unit with a single glBindTextures.
+*/
+void GL_QueueTexture(GLenum texunit, GLenum target, GLuint texture)
+{
+	if (!glRefConfig.multiBind)
+	{
+		GL_BindMultiTexture(texunit, target, texture);
+		return;
+	}
+
+	glDsaState.queuedTextures[texunit - GL_TEXTURE0] = texture;
+	glDsaState.texturesQueued = qtrue;
+}
+
+void GL_FlushTextures(void)
+{
+	int first, last;
+
+	if (!glDsaState.texturesQueued)
+		return;
+
+	glDsaState.texturesQueued = qfalse;
+
+	for (first = 0; first < NUM_TEXTURE_UNITS; first++)
+	{
+		if (glDsaState.queuedTextures[first] != glDsaState.textures[first])
+			break;
+	}
+
+	if (first == NUM_TEXTURE_UNITS)
+	{
+		backEnd.pc.c_textureBindsSkipped++;
+		return;
+	}
+
+	for (last = NUM_TEXTURE_UNITS - 1; last > first; last--)
+	{
+		if (glDsaState.queuedTextures[last] != glDsaState.textures[last])
+			break;
+	}
+
+	// units in between that didn't change are just bound again
+	backEnd.pc.c_textureBinds++;
+	qglBindTextures(first, last - first + 1, &glDsaState.queuedTextures[first]);
+	Com_Memcpy(&glDsaState.textures[first], &glDsaState.queuedTextures[first], (last - first + 1) * sizeof(GLuint));
+}
+
 GLvoid APIENTRY GLDSA_BindMultiTextureEXT(GLenum texunit, GLenum target, GLuint texture)
 {
 	if (glDsaState.texunit != texunit)
@@ -197,6 +259,13 @@ GLvoid APIENTRY GLDSA_ProgramUniform1fvEXT(GLuint program, GLint location,
 	qglUniform1fv(location, count, value);
 }
 
+GLvoid APIENTRY GLDSA_ProgramUniform4fvEXT(GLuint program, GLint location,
+	GLsizei count, const GLfloat *value)
+{
+	GL_UseProgram(program);
+	qglUniform4fv(location, count, value);
+}
+
 GLvoid APIENTRY GLDSA_ProgramUniformMatrix4fvEXT(GLuint program, GLint location,
 	GLsizei count, GLboolean transpose,
 	const GLfloat *value)
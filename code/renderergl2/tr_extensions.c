@@ -214,6 +214,190 @@ void GLimp_InitExtraExtensions(void)
 		ri.Printf(PRINT_ALL, result[2], extension);
 	}
 
+	// OpenGL 3.0 - GL_ARB_map_buffer_range
+	extension = "GL_ARB_map_buffer_range";
+	glRefConfig.mapBufferRange = qfalse;
+	if (q_gl_version_at_least_3_0 || SDL_GL_ExtensionSupported(extension))
+	{
+		glRefConfig.mapBufferRange = qtrue;
+
+		QGL_ARB_map_buffer_range_PROCS;
+
+		ri.Printf(PRINT_ALL, result[glRefConfig.mapBufferRange], extension);
+	}
+	else
+	{
+		ri.Printf(PRINT_ALL, result[2], extension);
+	}
+
+	// OpenGL 4.4 - GL_ARB_buffer_storage
+	// persistent mapping also needs the GL 3.2 fence functions
+	extension = "GL_ARB_buffer_storage";
+	glRefConfig.bufferStorage = qfalse;
+	if ((QGL_VERSION_ATLEAST(4, 4) || SDL_GL_ExtensionSupported(extension))
+		&& (q_gl_version_at_least_3_2 || SDL_GL_ExtensionSupported("GL_ARB_sync"))
+		&& glRefConfig.mapBufferRange)
+	{
+		glRefConfig.bufferStorage = !!r_arb_buffer_storage->integer;
+
+		// QGL_*_PROCS becomes several functions, do not remove {}
+		if (glRefConfig.bufferStorage)
+		{
+			QGL_ARB_sync_PROCS;
+			QGL_ARB_buffer_storage_PROCS;
+		}
+
+		ri.Printf(PRINT_ALL, result[glRefConfig.bufferStorage], extension);
+	}
+	else
+	{
+		ri.Printf(PRINT_ALL, result[2], extension);
+	}
+
+	// OpenGL 3.1 - GL_ARB_uniform_buffer_object
+	// the blocks are declared with GLSL 1.50 and streamed through a persistent mapping
+	extension = "GL_ARB_uniform_buffer_object";
+	glRefConfig.uniformBufferObject = qfalse;
+	if (q_gl_version_at_least_3_2 && glRefConfig.bufferStorage)
+	{
+		glRefConfig.uniformBufferObject = !!r_arb_uniform_buffer_object->integer;
+
+		// QGL_*_PROCS becomes several functions, do not remove {}
+		if (glRefConfig.uniformBufferObject)
+		{
+			QGL_ARB_uniform_buffer_object_PROCS;
+
+			qglGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &glRefConfig.uniformBufferOffsetAlignment);
+		}
+
+		ri.Printf(PRINT_ALL, result[glRefConfig.uniformBufferObject], extension);
+	}
+	else
+	{
+		ri.Printf(PRINT_ALL, result[2], extension);
+	}
+
+	// OpenGL 1.4 - GL_EXT_multi_draw_arrays
+	// only the core entry point is loaded
+	extension = "GL_EXT_multi_draw_arrays";
+	glRefConfig.multiDrawElements = qfalse;
+	if (QGL_VERSION_ATLEAST(1, 4))
+	{
+		glRefConfig.multiDrawElements = !!r_ext_multi_draw_arrays->integer;
+
+		// QGL_*_PROCS becomes several functions, do not remove {}
+		if (glRefConfig.multiDrawElements)
+		{
+			QGL_EXT_multi_draw_arrays_PROCS;
+		}
+
+		ri.Printf(PRINT_ALL, result[glRefConfig.multiDrawElements], extension);
+	}
+	else
+	{
+		ri.Printf(PRINT_ALL, result[2], extension);
+	}
+
+	// OpenGL 4.3 - GL_ARB_multi_draw_indirect
+	extension = "GL_ARB_multi_draw_indirect";
+	glRefConfig.multiDrawIndirect = qfalse;
+	if (QGL_VERSION_ATLEAST(4, 3) || SDL_GL_ExtensionSupported(extension))
+	{
+		glRefConfig.multiDrawIndirect = glRefConfig.multiDrawElements && r_arb_multi_draw_indirect->integer;
+
+		// QGL_*_PROCS becomes several functions, do not remove {}
+		if (glRefConfig.multiDrawIndirect)
+		{
+			QGL_ARB_multi_draw_indirect_PROCS;
+		}
+
+		ri.Printf(PRINT_ALL, result[glRefConfig.multiDrawIndirect], extension);
+	}
+	else
+	{
+		ri.Printf(PRINT_ALL, result[2], extension);
+	}
+
+	// OpenGL 4.4 - GL_ARB_multi_bind
+	extension = "GL_ARB_multi_bind";
+	glRefConfig.multiBind = qfalse;
+	if (QGL_VERSION_ATLEAST(4, 4) || SDL_GL_ExtensionSupported(extension))
+	{
+		glRefConfig.multiBind = !!r_arb_multi_bind->integer;
+
+		// QGL_*_PROCS becomes several functions, do not remove {}
+		if (glRefConfig.multiBind)
+		{
+			QGL_ARB_multi_bind_PROCS;
+		}
+
+		ri.Printf(PRINT_ALL, result[glRefConfig.multiBind], extension);
+	}
+	else
+	{
+		ri.Printf(PRINT_ALL, result[2], extension);
+	}
+
+	// OpenGL 3.3 - GL_ARB_timer_query
+	// only used by r_gpuTimers, so always loaded when present
+	extension = "GL_ARB_timer_query";
+	glRefConfig.timerQuery = qfalse;
+	if (QGL_VERSION_ATLEAST(3, 3) || SDL_GL_ExtensionSupported(extension))
+	{
+		glRefConfig.timerQuery = qtrue;
+
+		QGL_ARB_timer_query_PROCS;
+
+		ri.Printf(PRINT_ALL, result[1], extension);
+	}
+	else
+	{
+		ri.Printf(PRINT_ALL, result[2], extension);
+	}
+
+	// GL_KHR_parallel_shader_compile
+	// lets the driver compile on its own threads while the next shader is
+	// submitted, GLSL_InitGPUShaders only waits on a program when it links
+	extension = "GL_KHR_parallel_shader_compile";
+	if (SDL_GL_ExtensionSupported(extension))
+	{
+		QGL_KHR_parallel_shader_compile_PROCS;
+
+		qglMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+
+		ri.Printf(PRINT_ALL, result[1], extension);
+	}
+	else
+	{
+		ri.Printf(PRINT_ALL, result[2], extension);
+	}
+
+	// OpenGL 4.1 - GL_ARB_get_program_binary
+	extension = "GL_ARB_get_program_binary";
+	glRefConfig.programBinary = qfalse;
+	if (QGL_VERSION_ATLEAST(4, 1) || SDL_GL_ExtensionSupported(extension))
+	{
+		glRefConfig.programBinary = !!r_arb_get_program_binary->integer;
+
+		// QGL_*_PROCS becomes several functions, do not remove {}
+		if (glRefConfig.programBinary)
+		{
+			GLint numFormats = 0;
+
+			QGL_ARB_get_program_binary_PROCS;
+
+			// some drivers expose the extension without any usable format
+			qglGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+			glRefConfig.programBinary = numFormats > 0;
+		}
+
+		ri.Printf(PRINT_ALL, result[glRefConfig.programBinary], extension);
+	}
+	else
+	{
+		ri.Printf(PRINT_ALL, result[2], extension);
+	}
+
 	// OpenGL 3.0 - GL_ARB_texture_float
 	extension = "GL_ARB_texture_float";
 	glRefConfig.textureFloat = qfalse;
@@ -231,8 +231,13 @@ void FBO_Bind(FBO_t * fbo)
 	}
 
 	if (glState.currentFBO == fbo)
+	{
+		backEnd.pc.c_fboBindsSkipped++;
 		return;
-		
+	}
+
+	backEnd.pc.c_fboBinds++;
+
 	if (r_logFile->integer)
 	{
 		// don't just call LogComment, or we will get a call to va() every frame!
@@ -349,6 +354,18 @@ void FBO_Init(void)
 			FBO_AttachImage(tr.sunShadowFbo[i], tr.sunShadowDepthImage[i], GL_DEPTH_ATTACHMENT, 0);
 			R_CheckFBO(tr.sunShadowFbo[i]);
 		}
+
+		// static world depth is kept here and blitted into the cascade each frame
+		if (r_shadowCascadeCache->integer && glRefConfig.framebufferBlit)
+		{
+			for (i = 0; i < 3; i++)
+			{
+				tr.sunShadowCacheFbo[i] = FBO_Create(va("_sunshadowcache%d", i), tr.sunShadowDepthImage[i]->width, tr.sunShadowDepthImage[i]->height);
+				FBO_CreateBuffer(tr.sunShadowCacheFbo[i], GL_RGBA8, 0, 0);
+				FBO_CreateBuffer(tr.sunShadowCacheFbo[i], GL_DEPTH_COMPONENT24_ARB, 0, 0);
+				R_CheckFBO(tr.sunShadowCacheFbo[i]);
+			}
+		}
 	}
 
 	if (tr.screenShadowImage)
@@ -399,6 +416,21 @@ void FBO_Init(void)
 		R_CheckFBO(tr.hdrDepthFbo);
 	}
 
+	if (tr.hizImage)
+	{
+		tr.hizFbo = FBO_Create("_hiz", tr.hizImage->width, tr.hizImage->height);
+		FBO_AttachImage(tr.hizFbo, tr.hizImage, GL_COLOR_ATTACHMENT0, 0);
+		R_CheckFBO(tr.hizFbo);
+
+		qglGenBuffers(HIZ_READBACKS, tr.hizReadback);
+		for (i = 0; i < HIZ_READBACKS; i++)
+		{
+			qglBindBuffer(GL_PIXEL_PACK_BUFFER, tr.hizReadback[i]);
+			qglBufferData(GL_PIXEL_PACK_BUFFER, sizeof(tr.hiz[0].depth), NULL, GL_STREAM_READ);
+		}
+		qglBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
 	if (tr.screenSsaoImage)
 	{
 		tr.screenSsaoFbo = FBO_Create("_screenssao", tr.screenSsaoImage->width, tr.screenSsaoImage->height);
@@ -456,6 +488,9 @@ void FBO_Shutdown(void)
 		if(fbo->frameBuffer)
 			qglDeleteFramebuffers(1, &fbo->frameBuffer);
 	}
+
+	if (tr.hizReadback[0])
+		qglDeleteBuffers(HIZ_READBACKS, tr.hizReadback);
 }
 
 /*
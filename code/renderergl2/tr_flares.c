@@ -51,6 +51,9 @@ frame may have multiple scenes.
 RB_RenderFlares() will be called once per view (twice in a mirrored scene, potentially
 up to five or more times in a frame with 3D status bar icons).
 
+When occlusion queries are available, visibility lags a frame or two behind
+instead of stalling on a depth readback for every flare; the fade hides it.
+
 =============================================================================
 */
 
@@ -71,6 +74,8 @@ typedef struct flare_s {
 
 	qboolean	visible;			// state of last test
 	float		drawIntensity;		// may be non 0 even if !visible due to fading
+	qboolean	queryActive;		// an occlusion query is in flight for it
+	qboolean	queryVisible;		// result of the last finished query
 
 	int			windowX, windowY;
 	float		eyeZ;
@@ -84,6 +89,11 @@ typedef struct flare_s {
 flare_t		r_flareStructs[MAX_FLARES];
 flare_t		*r_activeFlares, *r_inactiveFlares;
 
+// with occlusion queries, flares are tested against the depth buffer by
+// drawing a point-sized quad at their depth, and the result is picked up a
+// frame or so later instead of stalling on a depth readback
+GLuint		r_flareQueries[MAX_FLARES];
+
 int flareCoeff;
 
 /*
@@ -120,6 +130,30 @@ void R_ClearFlares( void ) {
 }
 
 
+/*
+==================
+R_InitFlareQueries
+==================
+*/
+void R_InitFlareQueries( void ) {
+	if ( !glRefConfig.occlusionQuery )
+		return;
+
+	qglGenQueries( MAX_FLARES, r_flareQueries );
+}
+
+/*
+==================
+R_ShutdownFlareQueries
+==================
+*/
+void R_ShutdownFlareQueries( void ) {
+	if ( !glRefConfig.occlusionQuery )
+		return;
+
+	qglDeleteQueries( MAX_FLARES, r_flareQueries );
+}
+
 /*
 ==================
 RB_AddFlare
@@ -194,6 +228,11 @@ void RB_AddFlare( void *surface, int fogNum, vec3_t point, vec3_t color, vec3_t
 	if ( f->addedFrame != backEnd.viewParms.frameCount - 1 ) {
 		f->visible = qfalse;
 		f->fadeTime = backEnd.refdef.time - 2000;
+
+		// a query still in flight was for a different position, or even
+		// a different surface, so don't let its result leak in
+		f->queryActive = qfalse;
+		f->queryVisible = qfalse;
 	}
 
 	f->addedFrame = backEnd.viewParms.frameCount;
@@ -267,6 +306,61 @@ FLARE BACK END
 ===============================================================================
 */
 
+/*
+==================
+RB_QueryFlare
+
+Returns the visibility from the flare's last finished query, and issues a
+new one once it has.  Expects RB_RenderFlares to have set up the state.
+==================
+*/
+static qboolean RB_QueryFlare( flare_t *f ) {
+	GLuint			query = r_flareQueries[f - r_flareStructs];
+	vec4_t			eyePos, clipPos, quadVerts[4];
+	vec2_t			texCoords[4];
+	float			dx, dy, z;
+
+	if ( f->queryActive ) {
+		GLint		available = 0;
+		GLuint		sampleCount = 0;
+
+		qglGetQueryObjectiv( query, GL_QUERY_RESULT_AVAILABLE, &available );
+		if ( !available ) {
+			return f->queryVisible;
+		}
+
+		// a sample count on desktop GL, a boolean on OpenGL ES
+		qglGetQueryObjectuiv( query, GL_QUERY_RESULT, &sampleCount );
+		f->queryActive = qfalse;
+		f->queryVisible = sampleCount > 0;
+	}
+
+	R_TransformModelToClip( f->origin, backEnd.or.modelMatrix, backEnd.viewParms.projectionMatrix, eyePos, clipPos );
+	if ( clipPos[3] <= 0.0f ) {
+		return qfalse;
+	}
+
+	// a pixel wide quad, pulled a little towards the eye so the surface the flare is on doesn't hide it
+	dx = 1.0f / backEnd.viewParms.viewportWidth;
+	dy = 1.0f / backEnd.viewParms.viewportHeight;
+	z = clipPos[2] / clipPos[3] - 2e-5f;
+
+	VectorSet4( quadVerts[0], clipPos[0] / clipPos[3] - dx, clipPos[1] / clipPos[3] - dy, z, 1.0f );
+	VectorSet4( quadVerts[1], clipPos[0] / clipPos[3] + dx, clipPos[1] / clipPos[3] - dy, z, 1.0f );
+	VectorSet4( quadVerts[2], clipPos[0] / clipPos[3] + dx, clipPos[1] / clipPos[3] + dy, z, 1.0f );
+	VectorSet4( quadVerts[3], clipPos[0] / clipPos[3] - dx, clipPos[1] / clipPos[3] + dy, z, 1.0f );
+	Com_Memset( texCoords, 0, sizeof( texCoords ) );
+
+	backEnd.pc.c_flareQueries++;
+
+	qglBeginQuery( glRefConfig.occlusionQueryTarget, query );
+	RB_InstantQuad2( quadVerts, texCoords );
+	qglEndQuery( glRefConfig.occlusionQueryTarget );
+	f->queryActive = qtrue;
+
+	return f->queryVisible;
+}
+
 /*
 ==================
 RB_TestFlare
@@ -282,6 +376,11 @@ void RB_TestFlare( flare_t *f ) {
 
 	backEnd.pc.c_flareTests++;
 
+	if ( glRefConfig.occlusionQuery ) {
+		visible = RB_QueryFlare( f );
+		goto fade;
+	}
+
 	// doing a readpixels is as good as doing a glFinish(), so
 	// don't bother with another sync
 	glState.finishCalled = qfalse;
@@ -319,6 +418,7 @@ void RB_TestFlare( flare_t *f ) {
 		visible = (flareDepth - depthBias) <= depth; // in front (with margin)
 	}
 
+fade:
 	if ( visible ) {
 		if ( !f->visible ) {
 			f->visible = qtrue;
@@ -492,7 +592,7 @@ void RB_RenderFlares (void) {
 	}
 
 	if ( r_flares->modified ) {
-		if ( qglesMajorVersion >= 1 && !glRefConfig.readDepth ) {
+		if ( qglesMajorVersion >= 1 && !glRefConfig.readDepth && !glRefConfig.occlusionQuery ) {
 			ri.Printf( PRINT_WARNING, "OpenGL ES needs GL_NV_read_depth to read depth to determine if flares are visible\n" );
 			ri.Cvar_Set( "r_flares", "0" );
 		}
@@ -512,6 +612,20 @@ void RB_RenderFlares (void) {
 
 //	RB_AddDlightFlares();
 
+	// the query quads are already in clip space and only touch depth
+	if ( glRefConfig.occlusionQuery ) {
+		mat4_t	identity;
+
+		Mat4Identity( identity );
+		GLSL_BindProgram( &tr.textureColorShader );
+		GLSL_SetUniformMat4( &tr.textureColorShader, UNIFORM_MODELVIEWPROJECTIONMATRIX, identity );
+		GLSL_SetUniformVec4( &tr.textureColorShader, UNIFORM_COLOR, colorWhite );
+		GL_BindToTMU( tr.whiteImage, TB_COLORMAP );
+		GL_State( 0 );
+		GL_Cull( CT_TWO_SIDED );
+		qglColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+	}
+
 	// perform z buffer readback on each flare in this view
 	draw = qfalse;
 	prev = &r_activeFlares;
@@ -543,6 +657,10 @@ void RB_RenderFlares (void) {
 		prev = &f->next;
 	}
 
+	if ( glRefConfig.occlusionQuery ) {
+		qglColorMask( !backEnd.colorMask[0], !backEnd.colorMask[1], !backEnd.colorMask[2], !backEnd.colorMask[3] );
+	}
+
 	if ( !draw ) {
 		return;		// none visible
 	}
@@ -54,6 +54,8 @@ extern const char *fallbackShader_tonemap_vp;
 extern const char *fallbackShader_tonemap_fp;
 extern const char* fallbackShader_greyscale_vp;
 extern const char* fallbackShader_greyscale_fp;
+extern const char *fallbackShader_hiz_vp;
+extern const char *fallbackShader_hiz_fp;
 
 typedef struct uniformInfo_s
 {
@@ -158,7 +160,14 @@ static uniformInfo_t uniformsInfo[] =
 	{ "u_AlphaTest", GLSL_INT },
 
 	{ "u_BoneMatrix", GLSL_MAT16_BONEMATRIX },
-	{ "u_Greyscale", GLSL_FLOAT }
+	{ "u_Greyscale", GLSL_FLOAT },
+
+	{ "u_DlightClusterMap",   GLSL_INT },
+	{ "u_DlightClusterTile",  GLSL_VEC4 },
+	{ "u_DlightClusterPlane", GLSL_VEC4 },
+	{ "u_DlightClusterSlice", GLSL_VEC4 },
+	{ "u_DlightOrigins",      GLSL_VEC4_DLIGHTS },
+	{ "u_DlightColors",       GLSL_VEC4_DLIGHTS }
 };
 
 typedef enum
@@ -330,6 +339,9 @@ static void GLSL_GetShaderHeader( GLenum shaderType, const GLchar *extra, char *
 
 	Q_strcat(dest, size, "#ifndef M_PI\n#define M_PI 3.14159265358979323846\n#endif\n");
 
+	if (glRefConfig.uniformBufferObject)
+		Q_strcat(dest, size, "#define USE_UBO\n");
+
 	//Q_strcat(dest, size, va("#ifndef MAX_SHADOWMAPS\n#define MAX_SHADOWMAPS %i\n#endif\n", MAX_SHADOWMAPS));
 
 	Q_strcat(dest, size,
@@ -411,26 +423,17 @@ static void GLSL_GetShaderHeader( GLenum shaderType, const GLchar *extra, char *
 
 static int GLSL_CompileGPUShader(GLuint program, GLuint *prevShader, const GLchar *buffer, int size, GLenum shaderType)
 {
-	GLint           compiled;
 	GLuint          shader;
 
 	shader = qglCreateShader(shaderType);
 
 	qglShaderSource(shader, 1, (const GLchar **)&buffer, &size);
 
-	// compile shader
+	// compile shader, the status is only looked at if the program doesn't
+	// link so that the driver can compile the vertex and fragment shaders
+	// side by side
 	qglCompileShader(shader);
 
-	// check if shader compiled
-	qglGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
-	if(!compiled)
-	{
-		GLSL_PrintLog(shader, GLSL_PRINTLOG_SHADER_SOURCE, qfalse);
-		GLSL_PrintLog(shader, GLSL_PRINTLOG_SHADER_INFO, qfalse);
-		ri.Error(ERR_DROP, "Couldn't compile shader");
-		return 0;
-	}
-
 	if (*prevShader)
 	{
 		qglDetachShader(program, *prevShader);
@@ -508,16 +511,36 @@ static int GLSL_LoadGPUShaderText(const char *name, const char *fallback,
 	return result;
 }
 
-static void GLSL_LinkProgram(GLuint program)
+static void GLSL_CheckCompiled(GLuint shader)
+{
+	GLint           compiled;
+
+	if (!shader)
+		return;
+
+	qglGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if(!compiled)
+	{
+		GLSL_PrintLog(shader, GLSL_PRINTLOG_SHADER_SOURCE, qfalse);
+		GLSL_PrintLog(shader, GLSL_PRINTLOG_SHADER_INFO, qfalse);
+		ri.Error(ERR_DROP, "Couldn't compile shader");
+	}
+}
+
+static void GLSL_LinkProgram(shaderProgram_t *program)
 {
 	GLint           linked;
 
-	qglLinkProgram(program);
+	qglLinkProgram(program->program);
 
-	qglGetProgramiv(program, GL_LINK_STATUS, &linked);
+	qglGetProgramiv(program->program, GL_LINK_STATUS, &linked);
 	if(!linked)
 	{
-		GLSL_PrintLog(program, GLSL_PRINTLOG_PROGRAM_INFO, qfalse);
+		// a shader that didn't compile is the likelier cause
+		GLSL_CheckCompiled(program->vertexShader);
+		GLSL_CheckCompiled(program->fragmentShader);
+
+		GLSL_PrintLog(program->program, GLSL_PRINTLOG_PROGRAM_INFO, qfalse);
 		ri.Error(ERR_DROP, "shaders failed to link");
 	}
 }
@@ -540,8 +563,121 @@ static void GLSL_ShowProgramUniforms(GLuint program)
 	}
 }
 
+/*
+Linked programs are cached in glslcache/ with GL_ARB_get_program_binary, so
+later starts and vid_restarts can skip compiling and linking.  A binary is
+only good for the driver that made it and the exact source it came from, so
+both go into the file name and the header.
+*/
+
+#define GLSL_BINARY_IDENT		(('B'<<24)+('P'<<16)+('L'<<8)+'G')
+#define GLSL_BINARY_VERSION		1
+
+typedef struct {
+	int				ident;
+	int				version;
+	unsigned int	sourceHash;		// second hash of the key, to catch file name collisions
+	int				sourceLength;
+	int				attribs;
+	GLenum			binaryFormat;
+	int				binaryLength;
+} glslBinaryHeader_t;
+
+static int numCachedShaders;
+
+static unsigned int GLSL_HashString(unsigned int hash, const char *string)
+{
+	const byte *s = (const byte *)string;
+
+	// FNV-1a
+	while (*s)
+	{
+		hash ^= *s++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static unsigned int GLSL_ProgramBinaryHash(unsigned int hash, int attribs, const char *vpCode, const char *fpCode)
+{
+	hash = GLSL_HashString(hash, glConfig.vendor_string);
+	hash = GLSL_HashString(hash, glConfig.renderer_string);
+	hash = GLSL_HashString(hash, glConfig.version_string);
+	hash = GLSL_HashString(hash, va("%d", attribs));
+	hash = GLSL_HashString(hash, vpCode);
+	if (fpCode)
+		hash = GLSL_HashString(hash, fpCode);
+
+	return hash;
+}
+
+static qboolean GLSL_LoadProgramBinary(shaderProgram_t *program, const char *filename, unsigned int sourceHash, int sourceLength)
+{
+	glslBinaryHeader_t *header;
+	void *buffer;
+	long size;
+	GLint linked;
+
+	size = ri.FS_ReadFile(filename, &buffer);
+	if (!buffer)
+		return qfalse;
+
+	header = buffer;
+	if (size < sizeof(*header) || header->ident != GLSL_BINARY_IDENT || header->version != GLSL_BINARY_VERSION
+		|| header->sourceHash != sourceHash || header->sourceLength != sourceLength || header->attribs != program->attribs
+		|| header->binaryLength <= 0 || header->binaryLength > size - sizeof(*header))
+	{
+		ri.FS_FreeFile(buffer);
+		return qfalse;
+	}
+
+	qglProgramBinary(program->program, header->binaryFormat, header + 1, header->binaryLength);
+	ri.FS_FreeFile(buffer);
+
+	// the driver may still turn it down, e.g. after an update that kept the version string
+	qglGetProgramiv(program->program, GL_LINK_STATUS, &linked);
+	if (!linked)
+	{
+		ri.Printf(PRINT_DEVELOPER, "...stale program binary '%s'\n", filename);
+		return qfalse;
+	}
+
+	ri.Printf(PRINT_DEVELOPER, "...loading program binary '%s'\n", filename);
+	numCachedShaders++;
+	return qtrue;
+}
+
+static void GLSL_SaveProgramBinary(shaderProgram_t *program, const char *filename, unsigned int sourceHash, int sourceLength)
+{
+	glslBinaryHeader_t *header;
+	GLint length = 0;
+
+	qglGetProgramiv(program->program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	header = ri.Hunk_AllocateTempMemory(sizeof(*header) + length);
+	header->ident = GLSL_BINARY_IDENT;
+	header->version = GLSL_BINARY_VERSION;
+	header->sourceHash = sourceHash;
+	header->sourceLength = sourceLength;
+	header->attribs = program->attribs;
+	header->binaryLength = 0;
+
+	qglGetProgramBinary(program->program, length, &header->binaryLength, &header->binaryFormat, header + 1);
+	if (header->binaryLength > 0)
+		ri.FS_WriteFile(filename, header, sizeof(*header) + header->binaryLength);
+
+	ri.Hunk_FreeTempMemory(header);
+}
+
 static int GLSL_InitGPUShader2(shaderProgram_t * program, const char *name, int attribs, const char *vpCode, const char *fpCode)
 {
+	char binaryName[MAX_QPATH];
+	unsigned int sourceHash = 0;
+	int sourceLength = 0;
+
 	ri.Printf(PRINT_DEVELOPER, "------- GPU shader -------\n");
 
 	if(strlen(name) >= MAX_QPATH)
@@ -554,6 +690,22 @@ static int GLSL_InitGPUShader2(shaderProgram_t * program, const char *name, int
 	program->program = qglCreateProgram();
 	program->attribs = attribs;
 
+	if (glRefConfig.programBinary)
+	{
+		sourceHash = GLSL_ProgramBinaryHash(5381u, attribs, vpCode, fpCode);
+		sourceLength = strlen(vpCode) + (fpCode ? strlen(fpCode) : 0);
+		Com_sprintf(binaryName, sizeof(binaryName), "glslcache/%s_%08x.bin", name,
+			GLSL_ProgramBinaryHash(2166136261u, attribs, vpCode, fpCode));
+
+		if (GLSL_LoadProgramBinary(program, binaryName, sourceHash, sourceLength))
+			return 1;
+
+		// start over with a clean program object
+		qglDeleteProgram(program->program);
+		program->program = qglCreateProgram();
+		qglProgramParameteri(program->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
 	if (!(GLSL_CompileGPUShader(program->program, &program->vertexShader, vpCode, strlen(vpCode), GL_VERTEX_SHADER)))
 	{
 		ri.Printf(PRINT_ALL, "GLSL_InitGPUShader2: Unable to load \"%s\" as GL_VERTEX_SHADER\n", name);
@@ -616,7 +768,10 @@ static int GLSL_InitGPUShader2(shaderProgram_t * program, const char *name, int
 	if(attribs & ATTR_TANGENT2)
 		qglBindAttribLocation(program->program, ATTR_INDEX_TANGENT2, "attr_Tangent2");
 
-	GLSL_LinkProgram(program->program);
+	GLSL_LinkProgram(program);
+
+	if (glRefConfig.programBinary)
+		GLSL_SaveProgramBinary(program, binaryName, sourceHash, sourceLength);
 
 	return 1;
 }
@@ -715,12 +870,70 @@ void GLSL_InitUniforms(shaderProgram_t *program)
 			case GLSL_MAT16_BONEMATRIX:
 				size += sizeof(vec_t) * 16 * glRefConfig.glslMaxAnimatedBones;
 				break;
+			case GLSL_VEC4_DLIGHTS:
+				size += sizeof(vec_t) * 4 * MAX_DLIGHTS;
+				break;
 			default:
 				break;
 		}
 	}
 
 	program->uniformBuffer = ri.Malloc(size);
+
+	program->entityBlock = qfalse;
+	program->boneBlock = qfalse;
+	if (glRefConfig.uniformBufferObject)
+	{
+		GLuint index = qglGetUniformBlockIndex(program->program, "Entity");
+
+		if (index != GL_INVALID_INDEX)
+		{
+			qglUniformBlockBinding(program->program, index, UNIFORM_BLOCK_ENTITY);
+			program->entityBlock = qtrue;
+		}
+
+		index = qglGetUniformBlockIndex(program->program, "Bones");
+
+		if (index != GL_INVALID_INDEX)
+		{
+			qglUniformBlockBinding(program->program, index, UNIFORM_BLOCK_BONES);
+			program->boneBlock = qtrue;
+		}
+	}
+}
+
+/*
+Stores a uniform that lives in the Entity block, returns qfalse for the rest
+*/
+static qboolean GLSL_SetEntityBlockUniform(int uniformNum, const vec_t *v, int size)
+{
+	vec_t *dest;
+
+	switch (uniformNum)
+	{
+		case UNIFORM_MODELVIEWPROJECTIONMATRIX:
+			dest = glState.entityBlock.modelViewProjectionMatrix;
+			break;
+		case UNIFORM_MODELMATRIX:
+			dest = glState.entityBlock.modelMatrix;
+			break;
+		case UNIFORM_VIEWORIGIN:
+			dest = glState.entityBlock.viewOrigin;
+			break;
+		case UNIFORM_LOCALVIEWORIGIN:
+			dest = glState.entityBlock.localViewOrigin;
+			break;
+		default:
+			return qfalse;
+	}
+
+	if (memcmp(dest, v, sizeof(vec_t) * size))
+	{
+		Com_Memcpy(dest, v, sizeof(vec_t) * size);
+		glState.entityBlockDirty = qtrue;
+	}
+
+	return qtrue;
 }
 
 void GLSL_FinishGPUShader(shaderProgram_t *program)
@@ -745,11 +958,13 @@ void GLSL_SetUniformInt(shaderProgram_t *program, int uniformNum, GLint value)
 
 	if (value == *compare)
 	{
+		backEnd.pc.c_uniformsSkipped++;
 		return;
 	}
 
 	*compare = value;
 
+	backEnd.pc.c_uniforms++;
 	qglProgramUniform1iEXT(program->program, uniforms[uniformNum], value);
 }
 
@@ -769,11 +984,13 @@ void GLSL_SetUniformFloat(shaderProgram_t *program, int uniformNum, GLfloat valu
 
 	if (value == *compare)
 	{
+		backEnd.pc.c_uniformsSkipped++;
 		return;
 	}
 
 	*compare = value;
 	
+	backEnd.pc.c_uniforms++;
 	qglProgramUniform1fEXT(program->program, uniforms[uniformNum], value);
 }
 
@@ -793,12 +1010,14 @@ void GLSL_SetUniformVec2(shaderProgram_t *program, int uniformNum, const vec2_t
 
 	if (v[0] == compare[0] && v[1] == compare[1])
 	{
+		backEnd.pc.c_uniformsSkipped++;
 		return;
 	}
 
 	compare[0] = v[0];
 	compare[1] = v[1];
 
+	backEnd.pc.c_uniforms++;
 	qglProgramUniform2fEXT(program->program, uniforms[uniformNum], v[0], v[1]);
 }
 
@@ -807,6 +1026,9 @@ void GLSL_SetUniformVec3(shaderProgram_t *program, int uniformNum, const vec3_t
 	GLint *uniforms = program->uniforms;
 	vec_t *compare = (float *)(program->uniformBuffer + program->uniformBufferOffsets[uniformNum]);
 
+	if (program->entityBlock && GLSL_SetEntityBlockUniform(uniformNum, v, 3))
+		return;
+
 	if (uniforms[uniformNum] == -1)
 		return;
 
@@ -818,11 +1040,13 @@ void GLSL_SetUniformVec3(shaderProgram_t *program, int uniformNum, const vec3_t
 
 	if (VectorCompare(v, compare))
 	{
+		backEnd.pc.c_uniformsSkipped++;
 		return;
 	}
 
 	VectorCopy(v, compare);
 
+	backEnd.pc.c_uniforms++;
 	qglProgramUniform3fEXT(program->program, uniforms[uniformNum], v[0], v[1], v[2]);
 }
 
@@ -842,11 +1066,13 @@ void GLSL_SetUniformVec4(shaderProgram_t *program, int uniformNum, const vec4_t
 
 	if (VectorCompare4(v, compare))
 	{
+		backEnd.pc.c_uniformsSkipped++;
 		return;
 	}
 
 	VectorCopy4(v, compare);
 
+	backEnd.pc.c_uniforms++;
 	qglProgramUniform4fEXT(program->program, uniforms[uniformNum], v[0], v[1], v[2], v[3]);
 }
 
@@ -866,11 +1092,13 @@ void GLSL_SetUniformFloat5(shaderProgram_t *program, int uniformNum, const vec5_
 
 	if (VectorCompare5(v, compare))
 	{
+		backEnd.pc.c_uniformsSkipped++;
 		return;
 	}
 
 	VectorCopy5(v, compare);
 
+	backEnd.pc.c_uniforms++;
 	qglProgramUniform1fvEXT(program->program, uniforms[uniformNum], 5, v);
 }
 
@@ -879,6 +1107,9 @@ void GLSL_SetUniformMat4(shaderProgram_t *program, int uniformNum, const mat4_t
 	GLint *uniforms = program->uniforms;
 	vec_t *compare = (float *)(program->uniformBuffer + program->uniformBufferOffsets[uniformNum]);
 
+	if (program->entityBlock && GLSL_SetEntityBlockUniform(uniformNum, matrix, 16))
+		return;
+
 	if (uniforms[uniformNum] == -1)
 		return;
 
@@ -890,11 +1121,13 @@ void GLSL_SetUniformMat4(shaderProgram_t *program, int uniformNum, const mat4_t
 
 	if (Mat4Compare(matrix, compare))
 	{
+		backEnd.pc.c_uniformsSkipped++;
 		return;
 	}
 
 	Mat4Copy(matrix, compare);
 
+	backEnd.pc.c_uniforms++;
 	qglProgramUniformMatrix4fvEXT(program->program, uniforms[uniformNum], 1, GL_FALSE, matrix);
 }
 
@@ -922,14 +1155,42 @@ void GLSL_SetUniformMat4BoneMatrix(shaderProgram_t *program, int uniformNum, /*c
 
 	if (!memcmp(matrix, compare, numMatricies * sizeof(mat4_t)))
 	{
+		backEnd.pc.c_uniformsSkipped++;
 		return;
 	}
 
 	Com_Memcpy(compare, matrix, numMatricies * sizeof(mat4_t));
 
+	backEnd.pc.c_uniforms++;
 	qglProgramUniformMatrix4fvEXT(program->program, uniforms[uniformNum], numMatricies, GL_FALSE, &matrix[0][0]);
 }
 
+void GLSL_SetUniformVec4Dlights(shaderProgram_t *program, int uniformNum, const vec4_t *v, int numDlights)
+{
+	GLint *uniforms = program->uniforms;
+	vec_t *compare = (float *)(program->uniformBuffer + program->uniformBufferOffsets[uniformNum]);
+
+	if (uniforms[uniformNum] == -1)
+		return;
+
+	if (uniformsInfo[uniformNum].type != GLSL_VEC4_DLIGHTS)
+	{
+		ri.Printf( PRINT_WARNING, "GLSL_SetUniformVec4Dlights: wrong type for uniform %i in program %s\n", uniformNum, program->name);
+		return;
+	}
+
+	if (!memcmp(v, compare, numDlights * sizeof(vec4_t)))
+	{
+		backEnd.pc.c_uniformsSkipped++;
+		return;
+	}
+
+	Com_Memcpy(compare, v, numDlights * sizeof(vec4_t));
+
+	backEnd.pc.c_uniforms++;
+	qglProgramUniform4fvEXT(program->program, uniforms[uniformNum], numDlights, &v[0][0]);
+}
+
 void GLSL_DeleteGPUShader(shaderProgram_t *program)
 {
 	if(program->program)
@@ -970,6 +1231,7 @@ void GLSL_InitGPUShaders(void)
 	R_IssuePendingRenderCommands();
 
 	startTime = ri.Milliseconds();
+	numCachedShaders = 0;
 
 	// OpenGL ES may not have enough attributes to fit ones used for vertex animation
 	if ( glRefConfig.maxVertexAttribs > ATTR_INDEX_NORMAL2 ) {
@@ -1020,6 +1282,17 @@ void GLSL_InitGPUShaders(void)
 		if (i & GENERICDEF_USE_RGBAGEN)
 			Q_strcat(extradefines, 1024, "#define USE_RGBAGEN\n");
 
+		// fwidth() for distance field font edges
+		if (qglesMajorVersion < 3 && glRefConfig.standardDerivatives)
+		{
+			Q_strcat(extradefines, 1024, "#extension GL_OES_standard_derivatives : enable\n");
+			Q_strcat(extradefines, 1024, "#define USE_DERIVATIVES\n");
+		}
+		else if (glRefConfig.glslMajorVersion > 1 || (glRefConfig.glslMajorVersion == 1 && glRefConfig.glslMinorVersion >= 10))
+		{
+			Q_strcat(extradefines, 1024, "#define USE_DERIVATIVES\n");
+		}
+
 		if (!GLSL_InitGPUShader(&tr.genericShader[i], "generic", attribs, qtrue, extradefines, qtrue, fallbackShader_generic_vp, fallbackShader_generic_fp))
 		{
 			ri.Error(ERR_FATAL, "Could not load generic shader!");
@@ -1141,6 +1414,14 @@ void GLSL_InitGPUShaders(void)
 		if (r_dlightMode->integer >= 2)
 			Q_strcat(extradefines, 1024, "#define USE_SHADOWMAP\n");
 
+		if (lightType && tr.dlightClusterImage)
+		{
+			Q_strcat(extradefines, 1024, "#define USE_DLIGHT_CLUSTERS\n");
+			Q_strcat(extradefines, 1024, va("#define MAX_DLIGHTS %d\n", MAX_DLIGHTS));
+			Q_strcat(extradefines, 1024, va("#define DLIGHT_CLUSTERS_X %d.0\n#define DLIGHT_CLUSTERS_Y %d.0\n#define DLIGHT_CLUSTERS_Z %d.0\n",
+				DLIGHT_CLUSTERS_X, DLIGHT_CLUSTERS_Y, DLIGHT_CLUSTERS_Z));
+		}
+
 		if (glRefConfig.swizzleNormalmap)
 			Q_strcat(extradefines, 1024, "#define SWIZZLE_NORMALMAP\n");
 
@@ -1273,6 +1554,7 @@ void GLSL_InitGPUShaders(void)
 		GLSL_SetUniformInt(&tr.lightallShader[i], UNIFORM_SPECULARMAP, TB_SPECULARMAP);
 		GLSL_SetUniformInt(&tr.lightallShader[i], UNIFORM_SHADOWMAP,   TB_SHADOWMAP);
 		GLSL_SetUniformInt(&tr.lightallShader[i], UNIFORM_CUBEMAP,     TB_CUBEMAP);
+		GLSL_SetUniformInt(&tr.lightallShader[i], UNIFORM_DLIGHTCLUSTERMAP, TB_DLIGHTCLUSTERS);
 
 		GLSL_FinishGPUShader(&tr.lightallShader[i]);
 
@@ -1370,22 +1652,33 @@ void GLSL_InitGPUShaders(void)
 	numEtcShaders++;
 
 
-	attribs = ATTR_POSITION | ATTR_TEXCOORD;
-	extradefines[0] = '\0';
-
-	if (!GLSL_InitGPUShader(&tr.tonemapShader, "tonemap", attribs, qtrue, extradefines, qtrue, fallbackShader_tonemap_vp, fallbackShader_tonemap_fp))
+	for (i = 0; i < 2; i++)
 	{
-		ri.Error(ERR_FATAL, "Could not load tonemap shader!");
-	}
+		if (i == 1 && !r_ssao->integer)
+			continue;
+
+		attribs = ATTR_POSITION | ATTR_TEXCOORD;
+		extradefines[0] = '\0';
 
-	GLSL_InitUniforms(&tr.tonemapShader);
+		if (i == 1)
+			Q_strcat(extradefines, 1024, "#define USE_SSAO\n");
 
-	GLSL_SetUniformInt(&tr.tonemapShader, UNIFORM_TEXTUREMAP, TB_COLORMAP);
-	GLSL_SetUniformInt(&tr.tonemapShader, UNIFORM_LEVELSMAP,  TB_LEVELSMAP);
+		if (!GLSL_InitGPUShader(&tr.tonemapShader[i], "tonemap", attribs, qtrue, extradefines, qtrue, fallbackShader_tonemap_vp, fallbackShader_tonemap_fp))
+		{
+			ri.Error(ERR_FATAL, "Could not load tonemap shader!");
+		}
 
-	GLSL_FinishGPUShader(&tr.tonemapShader);
+		GLSL_InitUniforms(&tr.tonemapShader[i]);
 
-	numEtcShaders++;
+		GLSL_SetUniformInt(&tr.tonemapShader[i], UNIFORM_TEXTUREMAP, TB_COLORMAP);
+		GLSL_SetUniformInt(&tr.tonemapShader[i], UNIFORM_LEVELSMAP,  TB_LEVELSMAP);
+		GLSL_SetUniformInt(&tr.tonemapShader[i], UNIFORM_SCREENIMAGEMAP, TB_NORMALMAP);
+		GLSL_SetUniformInt(&tr.tonemapShader[i], UNIFORM_SCREENDEPTHMAP, TB_DELUXEMAP);
+
+		GLSL_FinishGPUShader(&tr.tonemapShader[i]);
+
+		numEtcShaders++;
+	}
 
 
 	for (i = 0; i < 2; i++)
@@ -1466,6 +1759,25 @@ void GLSL_InitGPUShaders(void)
 
 	numEtcShaders++;
 
+	if (tr.hizImage)
+	{
+		attribs = ATTR_POSITION | ATTR_TEXCOORD;
+		extradefines[0] = '\0';
+
+		if (!GLSL_InitGPUShader(&tr.hizShader, "hiz", attribs, qtrue, extradefines, qtrue, fallbackShader_hiz_vp, fallbackShader_hiz_fp))
+		{
+			ri.Error(ERR_FATAL, "Could not load hiz shader!");
+		}
+
+		GLSL_InitUniforms(&tr.hizShader);
+
+		GLSL_SetUniformInt(&tr.hizShader, UNIFORM_TEXTUREMAP, TB_DIFFUSEMAP);
+
+		GLSL_FinishGPUShader(&tr.hizShader);
+
+		numEtcShaders++;
+	}
+
 	// GLSL 1.10+ or GL_OES_standard_derivatives extension are required for dFdx() and dFdy() GLSL functions
 	if (glRefConfig.glslMajorVersion > 1 || (glRefConfig.glslMajorVersion == 1 && glRefConfig.glslMinorVersion >= 10)
 	    || glRefConfig.standardDerivatives)
@@ -1548,9 +1860,9 @@ void GLSL_InitGPUShaders(void)
 
 	endTime = ri.Milliseconds();
 
-	ri.Printf(PRINT_ALL, "loaded %i GLSL shaders (%i gen %i light %i etc) in %5.2f seconds\n", 
+	ri.Printf(PRINT_ALL, "loaded %i GLSL shaders (%i gen %i light %i etc, %i cached) in %5.2f seconds\n", 
 		numGenShaders + numLightShaders + numEtcShaders, numGenShaders, numLightShaders, 
-		numEtcShaders, (endTime - startTime) / 1000.0);
+		numEtcShaders, numCachedShaders, (endTime - startTime) / 1000.0);
 }
 
 void GLSL_ShutdownGPUShaders(void)
@@ -1584,13 +1896,16 @@ void GLSL_ShutdownGPUShaders(void)
 	GLSL_DeleteGPUShader(&tr.pshadowShader);
 	GLSL_DeleteGPUShader(&tr.down4xShader);
 	GLSL_DeleteGPUShader(&tr.bokehShader);
-	GLSL_DeleteGPUShader(&tr.tonemapShader);
+
+	for ( i = 0; i < 2; i++)
+		GLSL_DeleteGPUShader(&tr.tonemapShader[i]);
 
 	for ( i = 0; i < 2; i++)
 		GLSL_DeleteGPUShader(&tr.calclevels4xShader[i]);
 
 	GLSL_DeleteGPUShader(&tr.shadowmaskShader);
 	GLSL_DeleteGPUShader(&tr.ssaoShader);
+	GLSL_DeleteGPUShader(&tr.hizShader);
 
 	for ( i = 0; i < 4; i++)
 		GLSL_DeleteGPUShader(&tr.depthBlurShader[i]);
@@ -1610,6 +1925,8 @@ void GLSL_BindProgram(shaderProgram_t * program)
 
 	if (GL_UseProgram(programObject))
 		backEnd.pc.c_glslShaderBinds++;
+	else
+		backEnd.pc.c_glslShaderBindsSkipped++;
 }
 
 
@@ -0,0 +1,465 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// tr_gputimer.c -- GL_TIMESTAMP queries around the main back end passes
+
+#include "tr_local.h"
+
+/*
+Each frame records a list of timestamps, every one tagged with the timer
+it opens or closes.  The lists are read back a few frames later, once the
+GPU has caught up, so timing never stalls the pipeline.  A timer may be
+opened and closed several times a frame (one shadow view per cascade, the
+world / entity switches in the draw list), the intervals are summed.
+*/
+
+#define GPUTIMER_FRAMES		4			// frames in flight before a list is reused
+#define GPUTIMER_QUERIES	512			// timestamps per frame
+#define GPUTIMER_BEGIN		0x80		// mark flag, timestamp opens the timer
+#define GPUTIMER_LOGFRAMES	8			// resolved frames kept for the front end
+#define GPUTIMER_LOGSIZE	( 256 * 1024 )	// csv bytes kept before the log restarts
+
+typedef struct {
+	GLuint		queries[GPUTIMER_QUERIES];
+	byte		marks[GPUTIMER_QUERIES];
+	int			numQueries;
+	int			frameCount;
+	qboolean	pending;
+} gpuTimerFrame_t;
+
+typedef struct {
+	int			frameCount;
+	float		msec[GPUTIMER_COUNT];
+} gpuTimerResult_t;
+
+static const char *gpuTimerNames[GPUTIMER_COUNT] = {
+	"frame", "shadows", "prepass", "world", "entities", "postprocess", "2d"
+};
+
+static const vec4_t gpuTimerColors[GPUTIMER_COUNT] = {
+	{ 1.0f, 1.0f, 1.0f, 1.0f },		// frame
+	{ 0.5f, 0.5f, 1.0f, 1.0f },		// shadows
+	{ 0.5f, 0.5f, 0.5f, 1.0f },		// prepass
+	{ 0.25f, 1.0f, 0.25f, 1.0f },	// world
+	{ 1.0f, 1.0f, 0.25f, 1.0f },	// entities
+	{ 1.0f, 0.25f, 1.0f, 1.0f },	// postprocess
+	{ 0.25f, 1.0f, 1.0f, 1.0f },	// 2d
+};
+
+static qboolean			gpuTimersInit;
+static gpuTimerFrame_t	gpuFrames[GPUTIMER_FRAMES];
+static int				gpuFrameNum;		// list being recorded
+static int				gpuFrameCount;
+static qboolean			gpuRecording;
+static qboolean			gpuActive[GPUTIMER_COUNT];
+
+// written by the back end, read by the front end while the back end is idle
+static float			gpuMsec[GPUTIMER_COUNT];
+static gpuTimerResult_t	gpuResults[GPUTIMER_LOGFRAMES];
+static int				gpuResultHead;
+
+// front end csv log
+static char				*gpuLog;
+static int				gpuLogLength;
+static int				gpuLogTail;
+static int				gpuLogLines;
+static int				gpuLogPart;
+static char				gpuLogMap[MAX_QPATH];
+static char				gpuLogName[MAX_QPATH];
+
+
+/*
+===============
+R_InitGpuTimers
+===============
+*/
+void R_InitGpuTimers( void )
+{
+	int i;
+
+	if ( !glRefConfig.timerQuery )
+		return;
+
+	for ( i = 0; i < GPUTIMER_FRAMES; i++ )
+	{
+		qglGenQueries( GPUTIMER_QUERIES, gpuFrames[i].queries );
+		gpuFrames[i].numQueries = 0;
+		gpuFrames[i].pending = qfalse;
+	}
+
+	gpuFrameNum = 0;
+	gpuRecording = qfalse;
+	Com_Memset( gpuActive, 0, sizeof( gpuActive ) );
+	Com_Memset( gpuMsec, 0, sizeof( gpuMsec ) );
+
+	gpuTimersInit = qtrue;
+}
+
+/*
+===============
+R_ShutdownGpuTimers
+===============
+*/
+void R_ShutdownGpuTimers( void )
+{
+	int i;
+
+	if ( !gpuTimersInit )
+		return;
+
+	for ( i = 0; i < GPUTIMER_FRAMES; i++ )
+		qglDeleteQueries( GPUTIMER_QUERIES, gpuFrames[i].queries );
+
+	if ( gpuLog )
+	{
+		if ( gpuLogLines )
+			ri.FS_WriteFile( gpuLogName, gpuLog, gpuLogLength );
+
+		ri.Free( gpuLog );
+		gpuLog = NULL;
+		gpuLogLines = 0;
+	}
+
+	gpuTimersInit = qfalse;
+	gpuRecording = qfalse;
+}
+
+static void RB_GpuTimestamp( int mark )
+{
+	gpuTimerFrame_t *frame = &gpuFrames[gpuFrameNum];
+
+	qglQueryCounter( frame->queries[frame->numQueries], GL_TIMESTAMP );
+	frame->marks[frame->numQueries++] = mark;
+}
+
+/*
+===============
+RB_BeginGpuTimer
+
+The first timer of a frame also opens GPUTIMER_FRAME.
+===============
+*/
+void RB_BeginGpuTimer( gpuTimer_t timer )
+{
+	gpuTimerFrame_t *frame;
+
+	if ( !gpuRecording )
+	{
+		if ( !gpuTimersInit || !r_gpuTimers->integer )
+			return;
+
+		// the GPU is a whole ring behind, drop this frame rather than wait
+		frame = &gpuFrames[gpuFrameNum];
+		if ( frame->pending )
+			return;
+
+		frame->numQueries = 0;
+		gpuRecording = qtrue;
+		gpuActive[GPUTIMER_FRAME] = qtrue;
+		RB_GpuTimestamp( GPUTIMER_FRAME | GPUTIMER_BEGIN );
+	}
+
+	if ( gpuActive[timer] )
+		return;
+
+	// leave room to close every timer
+	frame = &gpuFrames[gpuFrameNum];
+	if ( frame->numQueries + GPUTIMER_COUNT >= GPUTIMER_QUERIES )
+		return;
+
+	gpuActive[timer] = qtrue;
+	RB_GpuTimestamp( timer | GPUTIMER_BEGIN );
+}
+
+/*
+===============
+RB_EndGpuTimer
+===============
+*/
+void RB_EndGpuTimer( gpuTimer_t timer )
+{
+	if ( !gpuRecording || !gpuActive[timer] )
+		return;
+
+	gpuActive[timer] = qfalse;
+	RB_GpuTimestamp( timer );
+}
+
+/*
+===============
+RB_ResolveGpuTimers
+
+Reads back every finished frame, oldest first, without waiting on the GPU.
+===============
+*/
+static void RB_ResolveGpuTimers( void )
+{
+	int i, j;
+
+	for ( i = 0; i < GPUTIMER_FRAMES; i++ )
+	{
+		gpuTimerFrame_t *frame = &gpuFrames[( gpuFrameNum + i ) % GPUTIMER_FRAMES];
+		gpuTimerResult_t *result;
+		GLuint64 begin[GPUTIMER_COUNT];
+		GLuint64 stamp;
+		GLuint available;
+
+		if ( !frame->pending )
+			continue;
+
+		// timestamps complete in order, so the last one covers the list
+		qglGetQueryObjectuiv( frame->queries[frame->numQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available );
+		if ( !available )
+			break;
+
+		result = &gpuResults[gpuResultHead % GPUTIMER_LOGFRAMES];
+		result->frameCount = frame->frameCount;
+		Com_Memset( result->msec, 0, sizeof( result->msec ) );
+		Com_Memset( begin, 0, sizeof( begin ) );
+
+		for ( j = 0; j < frame->numQueries; j++ )
+		{
+			int mark = frame->marks[j];
+
+			qglGetQueryObjectui64v( frame->queries[j], GL_QUERY_RESULT, &stamp );
+
+			if ( mark & GPUTIMER_BEGIN )
+				begin[mark & ~GPUTIMER_BEGIN] = stamp;
+			else if ( stamp > begin[mark] )
+				result->msec[mark] += ( stamp - begin[mark] ) / 1000000.0;
+		}
+
+		for ( j = 0; j < GPUTIMER_COUNT; j++ )
+			gpuMsec[j] += ( result->msec[j] - gpuMsec[j] ) * 0.1f;
+
+		gpuResultHead++;
+		frame->pending = qfalse;
+	}
+}
+
+/*
+===============
+RB_EndGpuTimerFrame
+
+Called once a frame from RB_SwapBuffers, before the buffers are swapped.
+===============
+*/
+void RB_EndGpuTimerFrame( void )
+{
+	int i;
+
+	if ( !gpuTimersInit )
+		return;
+
+	if ( gpuRecording )
+	{
+		gpuTimerFrame_t *frame = &gpuFrames[gpuFrameNum];
+
+		// GPUTIMER_FRAME is first, so it closes last
+		for ( i = GPUTIMER_COUNT - 1; i >= 0; i-- )
+			RB_EndGpuTimer( i );
+
+		frame->frameCount = gpuFrameCount;
+		frame->pending = qtrue;
+		gpuRecording = qfalse;
+		gpuFrameNum = ( gpuFrameNum + 1 ) % GPUTIMER_FRAMES;
+	}
+
+	gpuFrameCount++;
+
+	RB_ResolveGpuTimers();
+}
+
+static void RB_GpuTimerQuad( float x, float y, float w, float h, const vec4_t color )
+{
+	vec4_t quadVerts[4];
+	vec2_t texCoords[4];
+
+	VectorSet4( quadVerts[0], x,     y,     0, 1 );
+	VectorSet4( quadVerts[1], x + w, y,     0, 1 );
+	VectorSet4( quadVerts[2], x + w, y + h, 0, 1 );
+	VectorSet4( quadVerts[3], x,     y + h, 0, 1 );
+
+	VectorSet2( texCoords[0], 0.0f, 0.0f );
+	VectorSet2( texCoords[1], 1.0f, 0.0f );
+	VectorSet2( texCoords[2], 1.0f, 1.0f );
+	VectorSet2( texCoords[3], 0.0f, 1.0f );
+
+	GLSL_SetUniformVec4( &tr.textureColorShader, UNIFORM_COLOR, color );
+	RB_InstantQuad2( quadVerts, texCoords );
+}
+
+/*
+===============
+RB_DrawGpuTimers
+
+One bar per timer in the bottom left corner, the width of the screen
+is 33.3 msec with ticks at 8.3 and 16.7 msec.  The colors are listed by
+the gputimers command.
+===============
+*/
+void RB_DrawGpuTimers( void )
+{
+	static const vec4_t background = { 0.0f, 0.0f, 0.0f, 0.5f };
+	static const vec4_t tick = { 1.0f, 0.25f, 0.25f, 1.0f };
+	float msecWidth, rowHeight, x, y;
+	int i;
+
+	if ( !gpuTimersInit || !r_gpuTimers->integer )
+		return;
+
+	if ( glRefConfig.framebufferObject )
+		FBO_Bind( tr.renderFbo );
+
+	RB_SetGL2D();
+
+	GL_State( GLS_DEPTHTEST_DISABLE | GLS_SRCBLEND_SRC_ALPHA | GLS_DSTBLEND_ONE_MINUS_SRC_ALPHA );
+	GL_Cull( CT_TWO_SIDED );
+
+	GLSL_BindProgram( &tr.textureColorShader );
+	GLSL_SetUniformMat4( &tr.textureColorShader, UNIFORM_MODELVIEWPROJECTIONMATRIX, glState.modelviewProjection );
+	GL_BindToTMU( tr.whiteImage, TB_COLORMAP );
+
+	msecWidth = glConfig.vidWidth / 33.3f;
+	rowHeight = MAX( glConfig.vidHeight / 96.0f, 2.0f );
+	x = rowHeight;
+	y = glConfig.vidHeight - rowHeight * ( GPUTIMER_COUNT + 2 );
+
+	RB_GpuTimerQuad( 0, y - rowHeight, glConfig.vidWidth, rowHeight * ( GPUTIMER_COUNT + 2 ), background );
+
+	for ( i = 0; i < GPUTIMER_COUNT; i++ )
+	{
+		float w = MIN( gpuMsec[i] * msecWidth, glConfig.vidWidth - x );
+
+		if ( w > 0.0f )
+			RB_GpuTimerQuad( x, y + i * rowHeight, w, rowHeight * 0.75f, gpuTimerColors[i] );
+	}
+
+	RB_GpuTimerQuad( x + 8.33f * msecWidth, y - rowHeight * 0.5f, 1, rowHeight * ( GPUTIMER_COUNT + 0.5f ), tick );
+	RB_GpuTimerQuad( x + 16.67f * msecWidth, y - rowHeight * 0.5f, 1, rowHeight * ( GPUTIMER_COUNT + 0.5f ), tick );
+}
+
+/*
+===============
+R_GpuTimers_f
+===============
+*/
+void R_GpuTimers_f( void )
+{
+	static const char *colorNames[GPUTIMER_COUNT] = {
+		"white", "blue", "grey", "green", "yellow", "magenta", "cyan"
+	};
+	int i;
+
+	if ( !gpuTimersInit )
+	{
+		ri.Printf( PRINT_ALL, "GPU timers need GL_ARB_timer_query\n" );
+		return;
+	}
+
+	if ( !r_gpuTimers->integer )
+	{
+		ri.Printf( PRINT_ALL, "GPU timers are off, set r_gpuTimers 1\n" );
+		return;
+	}
+
+	for ( i = 0; i < GPUTIMER_COUNT; i++ )
+		ri.Printf( PRINT_ALL, "%-12s %-8s %6.2f msec\n", gpuTimerNames[i], colorNames[i], gpuMsec[i] );
+}
+
+static void R_FlushGpuTimerLog( void )
+{
+	if ( gpuLog && gpuLogLength )
+		ri.FS_WriteFile( gpuLogName, gpuLog, gpuLogLength );
+
+	gpuLogLines = 0;
+}
+
+/*
+===============
+R_LogGpuTimers
+
+Appends the frames resolved since the last call to
+gputimers/<map>_<part>.csv.  Runs in the front end while the back end is
+idle.  The file is rewritten every 64 lines, the next part is started when
+it grows too large and part 0 again when the map changes.
+===============
+*/
+void R_LogGpuTimers( void )
+{
+	const char *map;
+	int i, j;
+
+	if ( r_gpuTimers->integer != 2 || !gpuTimersInit )
+	{
+		if ( gpuLogLines )
+			R_FlushGpuTimerLog();
+
+		gpuLogTail = gpuResultHead;
+		return;
+	}
+
+	map = tr.world ? tr.world->baseName : "nomap";
+
+	if ( !gpuLog || Q_stricmp( map, gpuLogMap ) || gpuLogLength > GPUTIMER_LOGSIZE - 1024 )
+	{
+		if ( gpuLogLines )
+			R_FlushGpuTimerLog();
+
+		if ( !gpuLog )
+			gpuLog = ri.Malloc( GPUTIMER_LOGSIZE );
+
+		if ( Q_stricmp( map, gpuLogMap ) )
+		{
+			Q_strncpyz( gpuLogMap, map, sizeof( gpuLogMap ) );
+			gpuLogPart = 0;
+		}
+		else
+			gpuLogPart++;
+
+		Com_sprintf( gpuLogName, sizeof( gpuLogName ), "gputimers/%s_%i.csv", gpuLogMap, gpuLogPart );
+
+		Com_sprintf( gpuLog, GPUTIMER_LOGSIZE, "# %s, %s, %s\nframe", glConfig.renderer_string, glConfig.version_string, gpuLogMap );
+		for ( i = 0; i < GPUTIMER_COUNT; i++ )
+			Q_strcat( gpuLog, GPUTIMER_LOGSIZE, va( ",%s", gpuTimerNames[i] ) );
+		Q_strcat( gpuLog, GPUTIMER_LOGSIZE, "\n" );
+		gpuLogLength = strlen( gpuLog );
+	}
+
+	// older results were overwritten
+	if ( gpuResultHead - gpuLogTail > GPUTIMER_LOGFRAMES )
+		gpuLogTail = gpuResultHead - GPUTIMER_LOGFRAMES;
+
+	for ( ; gpuLogTail < gpuResultHead; gpuLogTail++ )
+	{
+		const gpuTimerResult_t *result = &gpuResults[gpuLogTail % GPUTIMER_LOGFRAMES];
+
+		gpuLogLength += Com_sprintf( gpuLog + gpuLogLength, GPUTIMER_LOGSIZE - gpuLogLength, "%i", result->frameCount );
+		for ( j = 0; j < GPUTIMER_COUNT; j++ )
+			gpuLogLength += Com_sprintf( gpuLog + gpuLogLength, GPUTIMER_LOGSIZE - gpuLogLength, ",%.3f", result->msec[j] );
+		gpuLogLength += Com_sprintf( gpuLog + gpuLogLength, GPUTIMER_LOGSIZE - gpuLogLength, "\n" );
+
+		gpuLogLines++;
+	}
+
+	if ( gpuLogLines >= 64 )
+		R_FlushGpuTimerLog();
+}
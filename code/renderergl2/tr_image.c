@@ -22,6 +22,16 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 // tr_image.c
 #include "tr_local.h"
 
+#include <setjmp.h>
+
+#if idx64 || defined( __SSE2__ )
+#include <emmintrin.h>
+#define IMAGE_SSE2
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#include <arm_neon.h>
+#define IMAGE_NEON
+#endif
+
 #include "tr_dsa.h"
 
 static byte			 s_intensitytable[256];
@@ -32,6 +42,9 @@ int		gl_filter_max = GL_LINEAR;
 
 #define FILE_HASH_SIZE		1024
 static	image_t*		hashTable[FILE_HASH_SIZE];
+static	image_t*		contentHashTable[FILE_HASH_SIZE];	// by pk3 content key
+static	int				imageBytes;		// estimated texture memory, for memstats
+static	int				streamBytes;	// part of imageBytes that texture streaming may drop
 
 /*
 ** R_GammaCorrect
@@ -316,6 +329,41 @@ void R_ImageList_f( void ) {
 
 //=======================================================================
 
+/*
+================
+R_AverageTexels
+
+Averages four RGBA texels per channel, rounding down
+================
+*/
+static ID_INLINE void R_AverageTexels( const byte *a, const byte *b, const byte *c, const byte *d, byte *out )
+{
+#if defined( IMAGE_SSE2 )
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sum;
+
+	sum = _mm_add_epi16( _mm_unpacklo_epi8( _mm_cvtsi32_si128( *(const int *)a ), zero ),
+		_mm_unpacklo_epi8( _mm_cvtsi32_si128( *(const int *)b ), zero ) );
+	sum = _mm_add_epi16( sum, _mm_unpacklo_epi8( _mm_cvtsi32_si128( *(const int *)c ), zero ) );
+	sum = _mm_add_epi16( sum, _mm_unpacklo_epi8( _mm_cvtsi32_si128( *(const int *)d ), zero ) );
+	sum = _mm_srli_epi16( sum, 2 );
+	*(int *)out = _mm_cvtsi128_si32( _mm_packus_epi16( sum, sum ) );
+#elif defined( IMAGE_NEON )
+	uint16x8_t sum;
+
+	sum = vaddl_u8( vreinterpret_u8_u32( vdup_n_u32( *(const uint32_t *)a ) ),
+		vreinterpret_u8_u32( vdup_n_u32( *(const uint32_t *)b ) ) );
+	sum = vaddw_u8( sum, vreinterpret_u8_u32( vdup_n_u32( *(const uint32_t *)c ) ) );
+	sum = vaddw_u8( sum, vreinterpret_u8_u32( vdup_n_u32( *(const uint32_t *)d ) ) );
+	vst1_lane_u32( (uint32_t *)out, vreinterpret_u32_u8( vshrn_n_u16( sum, 2 ) ), 0 );
+#else
+	out[0] = ( a[0] + b[0] + c[0] + d[0] ) >> 2;
+	out[1] = ( a[1] + b[1] + c[1] + d[1] ) >> 2;
+	out[2] = ( a[2] + b[2] + c[2] + d[2] ) >> 2;
+	out[3] = ( a[3] + b[3] + c[3] + d[3] ) >> 2;
+#endif
+}
+
 /*
 ================
 ResampleTexture
@@ -356,15 +404,12 @@ static void ResampleTexture( byte *in, int inwidth, int inheight, byte *out,
 	for (i=0 ; i<outheight ; i++) {
 		inrow = in + 4*inwidth*(int)((i+0.25)*inheight/outheight);
 		inrow2 = in + 4*inwidth*(int)((i+0.75)*inheight/outheight);
-		for (j=0 ; j<outwidth ; j++) {
+		for (j=0 ; j<outwidth ; j++, out+=4) {
 			pix1 = inrow + p1[j];
 			pix2 = inrow + p2[j];
 			pix3 = inrow2 + p1[j];
 			pix4 = inrow2 + p2[j];
-			*out++ = (pix1[0] + pix2[0] + pix3[0] + pix4[0])>>2;
-			*out++ = (pix1[1] + pix2[1] + pix3[1] + pix4[1])>>2;
-			*out++ = (pix1[2] + pix2[2] + pix3[2] + pix4[2])>>2;
-			*out++ = (pix1[3] + pix2[3] + pix3[3] + pix4[3])>>2;
+			R_AverageTexels( pix1, pix2, pix3, pix4, out );
 		}
 	}
 }
@@ -1254,54 +1299,63 @@ lighting range
 */
 void R_LightScaleTexture (byte *in, int inwidth, int inheight, qboolean only_gamma )
 {
-	if ( only_gamma )
-	{
-		if ( !glConfig.deviceSupportsGamma )
-		{
-			int		i, c;
-			byte	*p;
-
-			p = in;
+	byte		table[256];
+	qboolean	identity = qtrue;
+	byte		*p;
+	int			i, c;
 
-			c = inwidth*inheight;
-			for (i=0 ; i<c ; i++, p+=4)
-			{
-				p[0] = s_gammatable[p[0]];
-				p[1] = s_gammatable[p[1]];
-				p[2] = s_gammatable[p[2]];
-			}
+	// fold intensity and gamma into a single lookup, and skip the pass
+	// entirely when it wouldn't change anything
+	for ( i = 0 ; i < 256 ; i++ ) {
+		table[i] = only_gamma ? i : s_intensitytable[i];
+		if ( !glConfig.deviceSupportsGamma ) {
+			table[i] = s_gammatable[table[i]];
+		}
+		if ( table[i] != i ) {
+			identity = qfalse;
 		}
 	}
-	else
+
+	if ( identity ) {
+		return;
+	}
+
+	p = in;
+	c = inwidth*inheight;
+	for (i=0 ; i<c ; i++, p+=4)
 	{
-		int		i, c;
-		byte	*p;
+		p[0] = table[p[0]];
+		p[1] = table[p[1]];
+		p[2] = table[p[2]];
+	}
+}
 
-		p = in;
 
-		c = inwidth*inheight;
+static float	downmipSrgbLookup[256];		// a quarter of each value in linear space
+static float	downmipSrgbLevels[256];		// the linear value each sRGB value starts at
+static qboolean	downmipSrgbLookupSet;
 
-		if ( glConfig.deviceSupportsGamma )
-		{
-			for (i=0 ; i<c ; i++, p+=4)
-			{
-				p[0] = s_intensitytable[p[0]];
-				p[1] = s_intensitytable[p[1]];
-				p[2] = s_intensitytable[p[2]];
-			}
-		}
-		else
-		{
-			for (i=0 ; i<c ; i++, p+=4)
-			{
-				p[0] = s_gammatable[s_intensitytable[p[0]]];
-				p[1] = s_gammatable[s_intensitytable[p[1]]];
-				p[2] = s_gammatable[s_intensitytable[p[2]]];
-			}
+/*
+================
+R_LinearToSrgb
+
+Same as (byte)(powf(linear, 1.0f / 2.2f) * 255.0f), by a binary search of
+the levels instead of a powf per channel
+================
+*/
+static ID_INLINE byte R_LinearToSrgb( float linear )
+{
+	int		value = 0;
+	int		step;
+
+	for ( step = 128 ; step ; step >>= 1 ) {
+		if ( downmipSrgbLevels[value + step] <= linear ) {
+			value += step;
 		}
 	}
-}
 
+	return value;
+}
 
 /*
 ================
@@ -1316,14 +1370,14 @@ static void R_MipMapsRGB( byte *in, int inWidth, int inHeight)
 	int x, y, c, stride;
 	const byte *in2;
 	float total;
-	static float downmipSrgbLookup[256];
-	static int downmipSrgbLookupSet = 0;
 	byte *out = in;
 
 	if (!downmipSrgbLookupSet) {
-		for (x = 0; x < 256; x++)
-			downmipSrgbLookup[x] = powf(x / 255.0f, 2.2f) * 0.25f;
-		downmipSrgbLookupSet = 1;
+		for (x = 0; x < 256; x++) {
+			downmipSrgbLevels[x] = powf(x / 255.0f, 2.2f);
+			downmipSrgbLookup[x] = downmipSrgbLevels[x] * 0.25f;
+		}
+		downmipSrgbLookupSet = qtrue;
 	}
 
 	if (inWidth == 1 && inHeight == 1)
@@ -1334,7 +1388,7 @@ static void R_MipMapsRGB( byte *in, int inWidth, int inHeight)
 			for (c = 3; c; c--, in++) {
 				total  = (downmipSrgbLookup[*(in)] + downmipSrgbLookup[*(in + 4)]) * 2.0f;
 
-				*out++ = (byte)(powf(total, 1.0f / 2.2f) * 255.0f);
+				*out++ = R_LinearToSrgb(total);
 			}
 			*out++ = (*(in) + *(in + 4)) >> 1; in += 5;
 		}
@@ -1352,7 +1406,7 @@ static void R_MipMapsRGB( byte *in, int inWidth, int inHeight)
 				total = downmipSrgbLookup[*(in)]  + downmipSrgbLookup[*(in + 4)]
 				      + downmipSrgbLookup[*(in2)] + downmipSrgbLookup[*(in2 + 4)];
 
-				*out++ = (byte)(powf(total, 1.0f / 2.2f) * 255.0f);
+				*out++ = R_LinearToSrgb(total);
 			}
 
 			*out++ = (*(in) + *(in + 4) + *(in2) + *(in2 + 4)) >> 2; in += 5, in2 += 5;
@@ -1576,7 +1630,7 @@ RawImage_ScaleToPower2
 
 ===============
 */
-static qboolean RawImage_ScaleToPower2( byte **data, int *inout_width, int *inout_height, imgType_t type, imgFlags_t flags, byte **resampledBuffer)
+static qboolean RawImage_ScaleToPower2( byte **data, int *inout_width, int *inout_height, imgType_t type, imgFlags_t flags, int picmipLevels, byte **resampledBuffer)
 {
 	int width =         *inout_width;
 	int height =        *inout_height;
@@ -1675,8 +1729,8 @@ static qboolean RawImage_ScaleToPower2( byte **data, int *inout_width, int *inou
 	// perform optional picmip operation
 	//
 	if ( picmip ) {
-		scaled_width >>= r_picmip->integer;
-		scaled_height >>= r_picmip->integer;
+		scaled_width >>= picmipLevels;
+		scaled_height >>= picmipLevels;
 	}
 
 	//
@@ -2156,17 +2210,34 @@ static void Upload32(byte *data, int x, int y, int width, int height, GLenum pic
 
 /*
 ================
-R_CreateImage2
+R_ImageBytes
 
-This is the only way any image_t are created
+Estimated texture memory of an image, four bytes a texel plus a third
+for the mip chain.
 ================
 */
-image_t *R_CreateImage2( const char *name, byte *pic, int width, int height, GLenum picFormat, int numMips, imgType_t type, imgFlags_t flags, int internalFormat ) {
+static int R_ImageBytes( const image_t *image )
+{
+	return image->uploadWidth * image->uploadHeight * ( ( image->flags & IMGFLAG_MIPMAP ) ? 16 : 12 ) / 3 *
+		( ( image->flags & IMGFLAG_CUBEMAP ) ? 6 : 1 );
+}
+
+
+/*
+================
+R_UploadImageData
+
+Sizes the storage of an existing image and uploads pic into it, used both
+for new images and for streamed images changing resolution.  A zero
+internalFormat is picked from the pixels.
+================
+*/
+static void R_UploadImageData( image_t *image, byte *pic, int width, int height, GLenum picFormat, int numMips, int internalFormat ) {
 	byte       *resampledBuffer = NULL;
-	image_t    *image;
 	qboolean    isLightmap = qfalse, scaled = qfalse;
-	long        hash;
-	int         glWrapClampMode, mipWidth, mipHeight, miplevel;
+	int         glWrapClampMode, mipWidth, mipHeight, miplevel, picmipLevels;
+	imgType_t   type = image->type;
+	imgFlags_t  flags = image->flags;
 	qboolean    rgba8 = picFormat == GL_RGBA8 || picFormat == GL_SRGB8_ALPHA8_EXT;
 	qboolean    mipmap = !!(flags & IMGFLAG_MIPMAP);
 	qboolean    cubemap = !!(flags & IMGFLAG_CUBEMAP);
@@ -2175,33 +2246,17 @@ image_t *R_CreateImage2( const char *name, byte *pic, int width, int height, GLe
 	GLenum textureTarget = cubemap ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
 	GLenum dataFormat, dataType;
 
-	if (strlen(name) >= MAX_QPATH ) {
-		ri.Error (ERR_DROP, "R_CreateImage: \"%s\" is too long", name);
-	}
-	if ( !strncmp( name, "*lightmap", 9 ) ) {
+	if ( !strncmp( image->imgName, "*lightmap", 9 ) ) {
 		isLightmap = qtrue;
 	}
 
-	if ( tr.numImages == MAX_DRAWIMAGES ) {
-		ri.Error( ERR_DROP, "R_CreateImage: MAX_DRAWIMAGES hit");
-	}
-
-	image = tr.images[tr.numImages] = ri.Hunk_Alloc( sizeof( image_t ), h_low );
-	qglGenTextures(1, &image->texnum);
-	tr.numImages++;
-
-	image->type = type;
-	image->flags = flags;
-
-	strcpy (image->imgName, name);
-
-	image->width = width;
-	image->height = height;
 	if (flags & IMGFLAG_CLAMPTOEDGE)
 		glWrapClampMode = GL_CLAMP_TO_EDGE;
 	else
 		glWrapClampMode = GL_REPEAT;
 
+	picmipLevels = r_picmip->integer + image->streamDrop;
+
 	if (!internalFormat)
 		internalFormat = RawImage_GetFormat(pic, width * height, picFormat, isLightmap, image->type, image->flags);
 
@@ -2248,7 +2303,7 @@ image_t *R_CreateImage2( const char *name, byte *pic, int width, int height, GLe
 				dataType = GL_UNSIGNED_SHORT_4_4_4_4;
 				break;
 			default:
-				ri.Error( ERR_DROP, "Missing OpenGL ES support for image '%s' with internal format 0x%X\n", name, internalFormat );
+				ri.Error( ERR_DROP, "Missing OpenGL ES support for image '%s' with internal format 0x%X\n", image->imgName, internalFormat );
 		}
 	}
 
@@ -2259,10 +2314,10 @@ image_t *R_CreateImage2( const char *name, byte *pic, int width, int height, GLe
 	if (!cubemap)
 	{
 		if (rgba8)
-			scaled = RawImage_ScaleToPower2(&pic, &width, &height, type, flags, &resampledBuffer);
+			scaled = RawImage_ScaleToPower2(&pic, &width, &height, type, flags, picmipLevels, &resampledBuffer);
 		else if (pic && picmip)
 		{
-			for (miplevel = r_picmip->integer; miplevel > 0 && numMips > 1; miplevel--, numMips--)
+			for (miplevel = picmipLevels; miplevel > 0 && numMips > 1; miplevel--, numMips--)
 			{
 				int size = CalculateMipSize(width, height, picFormat);
 				width = MAX(1, width >> 1);
@@ -2300,6 +2355,10 @@ image_t *R_CreateImage2( const char *name, byte *pic, int width, int height, GLe
 	}
 	while (!lastMip);
 
+	// a streamed image that shrank keeps stale levels past its new chain
+	if (image->streamed)
+		qglTextureParameteriEXT(image->texnum, textureTarget, GL_TEXTURE_MAX_LEVEL, miplevel - 1);
+
 	// Upload data.
 	if (pic)
 		Upload32(pic, 0, 0, width, height, picFormat, dataFormat, dataType, numMips, image, scaled);
@@ -2339,15 +2398,81 @@ image_t *R_CreateImage2( const char *name, byte *pic, int width, int height, GLe
 	}
 
 	GL_CheckErrors();
+}
+
+
+/*
+================
+R_CreateStreamedImage
+
+streamDrop is the number of mip levels left off the top at creation for
+an image R_UpdateTextureStreaming may reload from disk, or -1 for an
+image that always stays as uploaded.
+
+This is the only way any image_t are created
+================
+*/
+static image_t *R_CreateStreamedImage( const char *name, byte *pic, int width, int height, GLenum picFormat, int numMips, imgType_t type, imgFlags_t flags, int internalFormat, int streamDrop ) {
+	image_t    *image;
+	long        hash;
+
+	if (strlen(name) >= MAX_QPATH ) {
+		ri.Error (ERR_DROP, "R_CreateImage: \"%s\" is too long", name);
+	}
+
+	// the upload needs the GL context
+	if ( glConfig.smpActive ) {
+		R_IssuePendingRenderCommands();
+	}
+
+	if ( tr.numImages == MAX_DRAWIMAGES ) {
+		ri.Error( ERR_DROP, "R_CreateImage: MAX_DRAWIMAGES hit");
+	}
+
+	image = tr.images[tr.numImages] = ri.Hunk_Alloc( sizeof( image_t ), h_low );
+	qglGenTextures(1, &image->texnum);
+	tr.numImages++;
+
+	image->type = type;
+	image->flags = flags;
+
+	strcpy (image->imgName, name);
+
+	image->width = width;
+	image->height = height;
+
+	if ( streamDrop >= 0 ) {
+		image->streamed = qtrue;
+		image->streamDrop = streamDrop;
+	}
+
+	R_UploadImageData( image, pic, width, height, picFormat, numMips, internalFormat );
 
 	hash = generateHashValue(name);
 	image->next = hashTable[hash];
 	hashTable[hash] = image;
 
+	imageBytes += R_ImageBytes( image );
+	ri.MemStatSet( "renderer.images", imageBytes );
+
+	if ( image->streamed ) {
+		streamBytes += R_ImageBytes( image );
+	}
+
 	return image;
 }
 
 
+/*
+================
+R_CreateImage2
+================
+*/
+image_t *R_CreateImage2( const char *name, byte *pic, int width, int height, GLenum picFormat, int numMips, imgType_t type, imgFlags_t flags, int internalFormat ) {
+	return R_CreateStreamedImage( name, pic, width, height, picFormat, numMips, type, flags, internalFormat, -1 );
+}
+
+
 /*
 ================
 R_CreateImage
@@ -2415,7 +2540,7 @@ void R_LoadImage( const char *name, byte **pic, int *width, int *height, GLenum
 	char localName[ MAX_QPATH ];
 	char ddsName[ MAX_QPATH ];
 	const char *ext;
-	char *altName;
+	char altName[ MAX_QPATH ];
 
 	*pic = NULL;
 	*width = 0;
@@ -2454,7 +2579,7 @@ void R_LoadImage( const char *name, byte **pic, int *width, int *height, GLenum
 		for (i = 0; i < numImageLoaders; i++) {
 			if (i == orgLoader)
 				continue;
-			altName = va("%s.%s", localName, imageLoaders[i].ext);
+			Com_sprintf(altName, sizeof(altName), "%s.%s", localName, imageLoaders[i].ext);
 			imageLoaders[i].ImageLoader(altName, pic, width, height);
 			if (*pic) {
 				if (orgNameFailed)
@@ -2486,7 +2611,7 @@ void R_LoadImage( const char *name, byte **pic, int *width, int *height, GLenum
 			continue;
 		if (!Q_stricmp(imageLoaders[i].ext, "dds"))
 			continue;
-		altName = va("%s.%s", localName, imageLoaders[i].ext);
+		Com_sprintf(altName, sizeof(altName), "%s.%s", localName, imageLoaders[i].ext);
 		imageLoaders[i].ImageLoader(altName, pic, width, height);
 		if (*pic) {
 			if (orgNameFailed)
@@ -2503,6 +2628,515 @@ void R_LoadImage( const char *name, byte **pic, int *width, int *height, GLenum
 }
 
 
+/*
+===============
+R_ImageContentKey
+
+Gets the content key of the file R_LoadImage would read for name,
+trying the same names in the same order.  Returns qfalse when the file
+doesn't come from a pk3.
+===============
+*/
+static qboolean R_ImageContentKey( const char *name, unsigned int *crc, unsigned int *length )
+{
+	int orgLoader = -1;
+	int i, found;
+	char localName[ MAX_QPATH ];
+	char ddsName[ MAX_QPATH ];
+	const char *ext;
+
+	*crc = 0;
+	*length = 0;
+
+	Q_strncpyz(localName, name, sizeof(localName));
+	ext = COM_GetExtension(localName);
+	COM_StripExtension(name, ddsName, sizeof(ddsName));
+	Q_strcat(ddsName, sizeof(ddsName), ".dds");
+
+	if (r_ext_compressed_textures->integer) {
+		found = ri.FS_FileContentKey(ddsName, crc, length);
+		if (found >= 0)
+			return found > 0;
+	}
+
+	if (ext && *ext && Q_stricmp(ext, "dds")) {
+		for (i = 0; i < numImageLoaders; i++) {
+			if (!Q_stricmp(ext, imageLoaders[i].ext)) {
+				found = ri.FS_FileContentKey(localName, crc, length);
+				if (found >= 0)
+					return found > 0;
+				orgLoader = i;
+				break;
+			}
+		}
+		COM_StripExtension(name, localName, sizeof(localName));
+	}
+
+	for (i = 0; i < numImageLoaders; i++) {
+		if (i == orgLoader)
+			continue;
+		if (!r_ext_compressed_textures->integer && !Q_stricmp(imageLoaders[i].ext, "dds"))
+			continue;
+		found = ri.FS_FileContentKey(va("%s.%s", localName, imageLoaders[i].ext), crc, length);
+		if (found >= 0)
+			return found > 0;
+	}
+
+	if (!r_ext_compressed_textures->integer) {
+		found = ri.FS_FileContentKey(ddsName, crc, length);
+		if (found >= 0)
+			return found > 0;
+	}
+
+	return qfalse;
+}
+
+
+/*
+============================================================================
+
+IMAGE PREFETCH
+
+While the world loads, worker threads decode the images its shaders name
+ahead of the main thread, which then only has to upload them.  The file
+system and the allocators behind ri aren't thread safe, so for as long as
+workers run ri points at wrappers that serialize those calls on the
+worker lock, and workers take their file and temp buffers from the zone
+so the hunk's temp stack stays in order.
+
+============================================================================
+*/
+
+#define MAX_PREFETCH_WORKERS	8
+#define PREFETCH_MAX_BYTES		( 64 * 1024 * 1024 )	// decoded but not yet taken
+
+typedef enum {
+	PREFETCH_QUEUED,
+	PREFETCH_DECODING,
+	PREFETCH_DONE,
+	PREFETCH_FAILED,	// a loader raised an error, the main thread loads it again
+	PREFETCH_TAKEN
+} prefetchState_t;
+
+typedef struct {
+	char			name[MAX_QPATH];
+	prefetchState_t	state;
+	byte			*pic;
+	int				width, height;
+	GLenum			picFormat;
+	int				numMips;
+} prefetchImage_t;
+
+static struct {
+	qboolean		active;
+	qboolean		quit;
+	prefetchImage_t	*images;		// MAX_DRAWIMAGES, from the zone
+	int				numImages;
+	int				nextImage;		// next one for a worker
+	int				pendingBytes;	// decoded images nobody took yet
+	refimport_t		ri;				// the real imports while ri points at the wrappers
+	jmp_buf			abort[MAX_PREFETCH_WORKERS];
+} prefetch;
+
+#define PREFETCH_MSG		1024
+
+static void QDECL R_PrefetchPrintf( int printLevel, const char *fmt, ... )
+{
+	va_list	argptr;
+	char	msg[PREFETCH_MSG];
+
+	va_start( argptr, fmt );
+	Q_vsnprintf( msg, sizeof( msg ), fmt, argptr );
+	va_end( argptr );
+
+	GLimp_LockWorkers();
+	prefetch.ri.Printf( printLevel, "%s", msg );
+	GLimp_UnlockWorkers();
+}
+
+static void QDECL R_PrefetchError( int errorLevel, const char *fmt, ... ) Q_NO_RETURN;
+static void QDECL R_PrefetchError( int errorLevel, const char *fmt, ... )
+{
+	va_list	argptr;
+	char	msg[PREFETCH_MSG];
+	int		worker = GLimp_WorkerIndex();
+
+	va_start( argptr, fmt );
+	Q_vsnprintf( msg, sizeof( msg ), fmt, argptr );
+	va_end( argptr );
+
+	// a bad file only fails its own job, whatever the loader had
+	// allocated is left to the zone
+	if ( worker >= 0 ) {
+		longjmp( prefetch.abort[worker], 1 );
+	}
+
+	R_FinishImagePrefetch();
+	ri.Error( errorLevel, "%s", msg );
+}
+
+static void *R_PrefetchMalloc( int bytes )
+{
+	void	*buf;
+
+	GLimp_LockWorkers();
+	buf = prefetch.ri.Malloc( bytes );
+	GLimp_UnlockWorkers();
+
+	return buf;
+}
+
+static void R_PrefetchFree( void *buf )
+{
+	GLimp_LockWorkers();
+	prefetch.ri.Free( buf );
+	GLimp_UnlockWorkers();
+}
+
+static void *R_PrefetchAllocateTempMemory( int size )
+{
+	if ( GLimp_WorkerIndex() >= 0 ) {
+		return R_PrefetchMalloc( size );
+	}
+
+	return prefetch.ri.Hunk_AllocateTempMemory( size );
+}
+
+static void R_PrefetchFreeTempMemory( void *buf )
+{
+	if ( GLimp_WorkerIndex() >= 0 ) {
+		R_PrefetchFree( buf );
+		return;
+	}
+
+	prefetch.ri.Hunk_FreeTempMemory( buf );
+}
+
+static long R_PrefetchReadFile( const char *name, void **buf )
+{
+	void	*hunkBuf;
+	long	len;
+
+	GLimp_LockWorkers();
+	if ( !buf || GLimp_WorkerIndex() < 0 ) {
+		len = prefetch.ri.FS_ReadFile( name, buf );
+	} else {
+		// copied out of the hunk right away, keeping its temp stack in order
+		len = prefetch.ri.FS_ReadFile( name, &hunkBuf );
+		*buf = NULL;
+		if ( hunkBuf ) {
+			*buf = prefetch.ri.Malloc( len + 1 );
+			Com_Memcpy( *buf, hunkBuf, len + 1 );
+			prefetch.ri.FS_FreeFile( hunkBuf );
+		}
+	}
+	GLimp_UnlockWorkers();
+
+	return len;
+}
+
+static void R_PrefetchFreeFile( void *buf )
+{
+	GLimp_LockWorkers();
+	if ( GLimp_WorkerIndex() >= 0 ) {
+		prefetch.ri.Free( buf );
+	} else {
+		prefetch.ri.FS_FreeFile( buf );
+	}
+	GLimp_UnlockWorkers();
+}
+
+static int R_PrefetchFileIsInPAK( const char *name, int *pCheckSum )
+{
+	int		result;
+
+	GLimp_LockWorkers();
+	result = prefetch.ri.FS_FileIsInPAK( name, pCheckSum );
+	GLimp_UnlockWorkers();
+
+	return result;
+}
+
+static long R_PrefetchMapFile( const char *name, void **buf )
+{
+	long	len;
+
+	GLimp_LockWorkers();
+	len = prefetch.ri.FS_MapFile( name, buf );
+	GLimp_UnlockWorkers();
+
+	return len;
+}
+
+static void R_PrefetchUnmapFile( void *buf )
+{
+	GLimp_LockWorkers();
+	prefetch.ri.FS_UnmapFile( buf );
+	GLimp_UnlockWorkers();
+}
+
+static int R_PrefetchFileContentKey( const char *name, unsigned int *crc, unsigned int *length )
+{
+	int		result;
+
+	GLimp_LockWorkers();
+	result = prefetch.ri.FS_FileContentKey( name, crc, length );
+	GLimp_UnlockWorkers();
+
+	return result;
+}
+
+static qboolean R_PrefetchFileExists( const char *file )
+{
+	qboolean	result;
+
+	GLimp_LockWorkers();
+	result = prefetch.ri.FS_FileExists( file );
+	GLimp_UnlockWorkers();
+
+	return result;
+}
+
+/*
+===============
+R_PrefetchDecode
+===============
+*/
+static qboolean R_PrefetchDecode( int worker, prefetchImage_t *image )
+{
+	if ( setjmp( prefetch.abort[worker] ) ) {
+		image->pic = NULL;
+		return qfalse;
+	}
+
+	R_LoadImage( image->name, &image->pic, &image->width, &image->height, &image->picFormat, &image->numMips );
+	return qtrue;
+}
+
+/*
+===============
+R_PrefetchWorker
+===============
+*/
+static void R_PrefetchWorker( int worker )
+{
+	prefetchImage_t	*image;
+	qboolean		decoded;
+
+	GLimp_LockWorkers();
+	while ( !prefetch.quit && prefetch.nextImage < prefetch.numImages ) {
+		if ( prefetch.pendingBytes > PREFETCH_MAX_BYTES ) {
+			GLimp_WaitWorkers();
+			continue;
+		}
+
+		image = &prefetch.images[prefetch.nextImage++];
+		if ( image->state != PREFETCH_QUEUED ) {
+			// the main thread got to it first
+			continue;
+		}
+		image->state = PREFETCH_DECODING;
+		GLimp_UnlockWorkers();
+
+		decoded = R_PrefetchDecode( worker, image );
+
+		GLimp_LockWorkers();
+		if ( decoded ) {
+			image->state = PREFETCH_DONE;
+			prefetch.pendingBytes += image->width * image->height * 4;
+		} else {
+			image->state = PREFETCH_FAILED;
+		}
+		GLimp_WakeWorkers();
+	}
+	GLimp_UnlockWorkers();
+}
+
+/*
+===============
+R_AddImagePrefetch
+
+Queues a file name R_FindImageFile will be asked for before
+R_FinishImagePrefetch.
+===============
+*/
+void R_AddImagePrefetch( const char *name )
+{
+	image_t	*image;
+	int		i;
+
+	if ( prefetch.active || !r_imageThreads->integer || !name[0] ) {
+		return;
+	}
+
+	for ( image = hashTable[generateHashValue( name )]; image; image = image->next ) {
+		if ( !strcmp( name, image->imgName ) ) {
+			return;
+		}
+	}
+
+	if ( !prefetch.images ) {
+		prefetch.images = ri.Malloc( MAX_DRAWIMAGES * sizeof( *prefetch.images ) );
+		prefetch.numImages = 0;
+	}
+
+	if ( prefetch.numImages == MAX_DRAWIMAGES ) {
+		return;
+	}
+
+	for ( i = 0 ; i < prefetch.numImages ; i++ ) {
+		if ( !strcmp( name, prefetch.images[i].name ) ) {
+			return;
+		}
+	}
+
+	Com_Memset( &prefetch.images[prefetch.numImages], 0, sizeof( prefetch.images[0] ) );
+	Q_strncpyz( prefetch.images[prefetch.numImages].name, name, MAX_QPATH );
+	prefetch.numImages++;
+}
+
+/*
+===============
+R_StartImagePrefetch
+
+Starts r_imageThreads workers on the queued names
+===============
+*/
+void R_StartImagePrefetch( void )
+{
+	int		numWorkers;
+
+	if ( prefetch.active || !prefetch.images ) {
+		return;
+	}
+
+	if ( !prefetch.numImages ) {
+		ri.Free( prefetch.images );
+		prefetch.images = NULL;
+		return;
+	}
+
+	// the render thread calls ri too, keep it idle
+	if ( glConfig.smpActive ) {
+		R_IssuePendingRenderCommands();
+	}
+
+	prefetch.quit = qfalse;
+	prefetch.nextImage = 0;
+	prefetch.pendingBytes = 0;
+
+	prefetch.ri = ri;
+	ri.Printf = R_PrefetchPrintf;
+	ri.Error = R_PrefetchError;
+	ri.Malloc = R_PrefetchMalloc;
+	ri.Free = R_PrefetchFree;
+	ri.Hunk_AllocateTempMemory = R_PrefetchAllocateTempMemory;
+	ri.Hunk_FreeTempMemory = R_PrefetchFreeTempMemory;
+	ri.FS_FileIsInPAK = R_PrefetchFileIsInPAK;
+	ri.FS_ReadFile = R_PrefetchReadFile;
+	ri.FS_FreeFile = R_PrefetchFreeFile;
+	ri.FS_MapFile = R_PrefetchMapFile;
+	ri.FS_UnmapFile = R_PrefetchUnmapFile;
+	ri.FS_FileContentKey = R_PrefetchFileContentKey;
+	ri.FS_FileExists = R_PrefetchFileExists;
+	prefetch.active = qtrue;
+
+	numWorkers = GLimp_SpawnWorkers( MIN( r_imageThreads->integer, MAX_PREFETCH_WORKERS ), R_PrefetchWorker );
+	if ( !numWorkers ) {
+		R_FinishImagePrefetch();
+		return;
+	}
+
+	ri.Printf( PRINT_DEVELOPER, "Prefetching %d images on %d threads\n", prefetch.numImages, numWorkers );
+}
+
+/*
+===============
+R_FinishImagePrefetch
+
+Stops the workers, puts ri back and drops whatever nobody asked for
+===============
+*/
+void R_FinishImagePrefetch( void )
+{
+	int		i;
+
+	if ( !prefetch.active ) {
+		return;
+	}
+
+	GLimp_LockWorkers();
+	prefetch.quit = qtrue;
+	GLimp_WakeWorkers();
+	GLimp_UnlockWorkers();
+
+	GLimp_ShutdownWorkers();
+
+	ri = prefetch.ri;
+	prefetch.active = qfalse;
+
+	for ( i = 0 ; i < prefetch.numImages ; i++ ) {
+		if ( prefetch.images[i].state == PREFETCH_DONE && prefetch.images[i].pic ) {
+			ri.Free( prefetch.images[i].pic );
+		}
+	}
+
+	ri.Free( prefetch.images );
+	prefetch.images = NULL;
+	prefetch.numImages = 0;
+}
+
+/*
+===============
+R_TakePrefetchedImage
+
+Hands over what a worker decoded for name, waiting for it if a worker is
+on it.  Returns qfalse when the caller should load the file itself.
+===============
+*/
+static qboolean R_TakePrefetchedImage( const char *name, byte **pic, int *width, int *height, GLenum *picFormat, int *numMips )
+{
+	prefetchImage_t	*image = NULL;
+	qboolean		taken = qfalse;
+	int				i;
+
+	if ( !prefetch.active ) {
+		return qfalse;
+	}
+
+	for ( i = 0 ; i < prefetch.numImages ; i++ ) {
+		if ( !strcmp( name, prefetch.images[i].name ) ) {
+			image = &prefetch.images[i];
+			break;
+		}
+	}
+
+	if ( !image ) {
+		return qfalse;
+	}
+
+	GLimp_LockWorkers();
+	while ( image->state == PREFETCH_DECODING ) {
+		GLimp_WaitWorkers();
+	}
+
+	if ( image->state == PREFETCH_DONE ) {
+		*pic = image->pic;
+		*width = image->width;
+		*height = image->height;
+		*picFormat = image->picFormat;
+		*numMips = image->numMips;
+		prefetch.pendingBytes -= image->width * image->height * 4;
+		GLimp_WakeWorkers();
+		taken = qtrue;
+	}
+	image->state = PREFETCH_TAKEN;
+	GLimp_UnlockWorkers();
+
+	return taken;
+}
+
+
 /*
 ===============
 R_FindImageFile
@@ -2520,6 +3154,11 @@ image_t	*R_FindImageFile( const char *name, imgType_t type, imgFlags_t flags )
 	int picNumMips;
 	long	hash;
 	imgFlags_t checkFlagsTrue, checkFlagsFalse;
+	unsigned int	contentCrc = 0, contentLength = 0;
+	long	contentHash = 0;
+	imgFlags_t	requestedFlags = flags;
+	qboolean	pixelsChanged = qfalse;
+	int		streamDrop = -1;
 
 	if (!name) {
 		return NULL;
@@ -2543,9 +3182,25 @@ image_t	*R_FindImageFile( const char *name, imgType_t type, imgFlags_t flags )
 	}
 
 	//
-	// load the pic from disk
+	// the same file may already be loaded under another name, unless a
+	// normal map has to be found or made for this one
+	//
+	if ( !(flags & IMGFLAG_GENNORMALMAP) && R_ImageContentKey( name, &contentCrc, &contentLength ) ) {
+		contentHash = contentCrc & ( FILE_HASH_SIZE - 1 );
+		for (image=contentHashTable[contentHash]; image; image=image->nextContent) {
+			if ( image->contentCrc == contentCrc && image->contentLength == contentLength &&
+				image->type == type && image->flags == flags ) {
+				return image;
+			}
+		}
+	}
+
+	//
+	// load the pic from disk, unless a worker already did
 	//
-	R_LoadImage( name, &pic, &width, &height, &picFormat, &picNumMips );
+	if ( !R_TakePrefetchedImage( name, &pic, &width, &height, &picFormat, &picNumMips ) ) {
+		R_LoadImage( name, &pic, &width, &height, &picFormat, &picNumMips );
+	}
 	if ( pic == NULL ) {
 		return NULL;
 	}
@@ -2574,6 +3229,8 @@ image_t	*R_FindImageFile( const char *name, imgType_t type, imgFlags_t flags )
 			byte *normalPic;
 			int x, y;
 
+			pixelsChanged = qtrue;
+
 			normalWidth = width;
 			normalHeight = height;
 			normalPic = ri.Malloc(width * height * 4);
@@ -2670,12 +3327,126 @@ image_t	*R_FindImageFile( const char *name, imgType_t type, imgFlags_t flags )
 			flags &= ~IMGFLAG_MIPMAP;
 	}
 
-	image = R_CreateImage2( ( char * ) name, pic, width, height, picFormat, picNumMips, type, flags, 0 );
+	// streamed images get reloaded by name, so only plain files qualify
+	if ( r_streamTextures->integer && !qglesMajorVersion && !pixelsChanged &&
+		( flags & ( IMGFLAG_MIPMAP | IMGFLAG_PICMIP ) ) == ( IMGFLAG_MIPMAP | IMGFLAG_PICMIP ) &&
+		!( flags & IMGFLAG_CUBEMAP ) )
+	{
+		streamDrop = r_streamTextures->integer;
+	}
+
+	image = R_CreateStreamedImage( ( char * ) name, pic, width, height, picFormat, picNumMips, type, flags, 0, streamDrop );
 	ri.Free( pic );
+
+	// flags may have lost IMGFLAG_MIPMAP above, only images created as asked are shared
+	if ( contentLength && flags == requestedFlags ) {
+		image->contentCrc = contentCrc;
+		image->contentLength = contentLength;
+		image->nextContent = contentHashTable[contentHash];
+		contentHashTable[contentHash] = image;
+	}
+
 	return image;
 }
 
 
+/*
+===============
+R_StreamImage
+
+Reloads a streamed image from disk with streamDrop levels left off.
+===============
+*/
+static void R_StreamImage( image_t *image, int streamDrop )
+{
+	byte	*pic;
+	int		width, height, numMips;
+	GLenum	picFormat;
+
+	R_LoadImage( image->imgName, &pic, &width, &height, &picFormat, &numMips );
+	if ( pic == NULL ) {
+		// the file went away, leave the image as it is
+		image->streamed = qfalse;
+		streamBytes -= R_ImageBytes( image );
+		return;
+	}
+
+	imageBytes -= R_ImageBytes( image );
+	streamBytes -= R_ImageBytes( image );
+
+	image->streamDrop = streamDrop;
+	R_UploadImageData( image, pic, width, height, picFormat, numMips, image->internalFormat );
+	ri.Free( pic );
+
+	imageBytes += R_ImageBytes( image );
+	streamBytes += R_ImageBytes( image );
+	ri.MemStatSet( "renderer.images", imageBytes );
+}
+
+
+/*
+===============
+R_UpdateTextureStreaming
+
+Streamed images load r_streamTextures mip levels short.  Each frame, up
+to r_streamUploads of them move: the least recently bound go back to
+their load level while streamed memory is over r_streamBudget, then
+images the back end bound last frame come up one level at a time.
+===============
+*/
+void R_UpdateTextureStreaming( void )
+{
+	static int	nextImage;
+	image_t		*image, *oldest;
+	int			budget, uploads, i, n;
+
+	if ( !r_streamTextures->integer || !tr.numImages ) {
+		return;
+	}
+
+	budget = r_streamBudget->integer * 1024 * 1024;
+	uploads = r_streamUploads->integer;
+
+	while ( uploads > 0 && streamBytes > budget ) {
+		oldest = NULL;
+		for ( i = 0 ; i < tr.numImages ; i++ ) {
+			image = tr.images[i];
+			if ( !image->streamed || image->streamDrop >= r_streamTextures->integer ||
+				image->frameUsed >= tr.frameCount - 1 ) {
+				continue;
+			}
+			if ( !oldest || image->frameUsed < oldest->frameUsed ) {
+				oldest = image;
+			}
+		}
+
+		if ( !oldest ) {
+			break;
+		}
+
+		R_StreamImage( oldest, r_streamTextures->integer );
+		uploads--;
+	}
+
+	// round robin, so a busy view doesn't keep starving the same images
+	for ( n = 0 ; n < tr.numImages && uploads > 0 ; n++ ) {
+		image = tr.images[( nextImage + n ) % tr.numImages];
+		if ( !image->streamed || !image->streamDrop || image->frameUsed < tr.frameCount - 1 ) {
+			continue;
+		}
+
+		// a level up is four times the texels
+		if ( streamBytes + R_ImageBytes( image ) * 3 > budget ) {
+			continue;
+		}
+
+		R_StreamImage( image, image->streamDrop - 1 );
+		uploads--;
+	}
+	nextImage = ( nextImage + n ) % tr.numImages;
+}
+
+
 /*
 ================
 R_CreateDlightImage
@@ -2851,6 +3622,33 @@ void R_CreateBuiltinImages( void ) {
 			tr.shadowCubemaps[x] = R_CreateImage(va("*shadowcubemap%i", x), NULL, PSHADOW_MAP_SIZE, PSHADOW_MAP_SIZE, IMGTYPE_COLORALPHA, IMGFLAG_CLAMPTOEDGE | IMGFLAG_CUBEMAP, 0);
 		}
 	}
+	else if (r_dlightClusters->integer)
+	{
+		GLint maxVectors = 0;
+
+		// lightall needs the origin and color of every dlight in fragment uniforms
+		if (qglesMajorVersion >= 1)
+		{
+			qglGetIntegerv(GL_MAX_FRAGMENT_UNIFORM_VECTORS, &maxVectors);
+		}
+		else
+		{
+			qglGetIntegerv(GL_MAX_FRAGMENT_UNIFORM_COMPONENTS, &maxVectors);
+			maxVectors /= 4;
+		}
+
+		if (maxVectors >= 4 * MAX_DLIGHTS)
+		{
+			tr.dlightClusterImage = R_CreateImage("*dlightClusters", NULL, DLIGHT_CLUSTERS_X * DLIGHT_CLUSTERS_Z, DLIGHT_CLUSTERS_Y,
+				IMGTYPE_COLORALPHA, IMGFLAG_NO_COMPRESSION | IMGFLAG_CLAMPTOEDGE, GL_RGBA8);
+			qglTextureParameterfEXT(tr.dlightClusterImage->texnum, GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			qglTextureParameterfEXT(tr.dlightClusterImage->texnum, GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		}
+		else
+		{
+			ri.Printf(PRINT_WARNING, "WARNING: only %d fragment uniforms, dlight clusters disabled\n", maxVectors);
+		}
+	}
 
 	// with overbright bits active, we need an image which is some fraction of full color,
 	// for default lightmaps, etc
@@ -2895,6 +3693,9 @@ void R_CreateBuiltinImages( void ) {
 		if (r_shadowBlur->integer || r_ssao->integer)
 			tr.hdrDepthImage = R_CreateImage("*hdrDepth", NULL, width, height, IMGTYPE_COLORALPHA, IMGFLAG_NO_COMPRESSION | IMGFLAG_CLAMPTOEDGE, GL_R32F);
 
+		if (r_hizCull->integer && glRefConfig.mapBufferRange)
+			tr.hizImage = R_CreateImage("*hiz", NULL, HIZ_WIDTH, HIZ_HEIGHT, IMGTYPE_COLORALPHA, IMGFLAG_NO_COMPRESSION | IMGFLAG_CLAMPTOEDGE, GL_R32F);
+
 		if (r_drawSunRays->integer)
 			tr.sunRaysImage = R_CreateImage("*sunRays", NULL, width, height, IMGTYPE_COLORALPHA, IMGFLAG_NO_COMPRESSION | IMGFLAG_CLAMPTOEDGE, rgbFormat);
 
@@ -3034,6 +3835,7 @@ R_InitImages
 */
 void	R_InitImages( void ) {
 	Com_Memset(hashTable, 0, sizeof(hashTable));
+	Com_Memset(contentHashTable, 0, sizeof(contentHashTable));
 	// build brightness translation tables
 	R_SetColorMappings();
 
@@ -3049,12 +3851,17 @@ R_DeleteTextures
 void R_DeleteTextures( void ) {
 	int		i;
 
+	R_FinishImagePrefetch();
+
 	for ( i=0; i<tr.numImages ; i++ ) {
 		qglDeleteTextures( 1, &tr.images[i]->texnum );
 	}
 	Com_Memset( tr.images, 0, sizeof( tr.images ) );
 
 	tr.numImages = 0;
+	imageBytes = 0;
+	streamBytes = 0;
+	ri.MemStatSet( "renderer.images", 0 );
 
 	GL_BindNullTextures();
 }
@@ -62,6 +62,9 @@ cvar_t	*r_stereoSeparation;
 
 cvar_t	*r_skipBackEnd;
 
+cvar_t	*r_smp;
+cvar_t	*r_showSmp;
+
 cvar_t	*r_stereoEnabled;
 cvar_t	*r_anaglyphMode;
 
@@ -78,13 +81,23 @@ cvar_t	*r_dlightBacks;
 
 cvar_t	*r_lodbias;
 cvar_t	*r_lodscale;
+cvar_t	*r_autoLods;
 
 cvar_t	*r_norefresh;
 cvar_t	*r_drawentities;
 cvar_t	*r_drawworld;
 cvar_t	*r_speeds;
+cvar_t	*r_gpuTimers;
+cvar_t	*r_batch2D;
 cvar_t	*r_fullbright;
 cvar_t	*r_novis;
+cvar_t	*r_cellPortals;
+cvar_t	*r_aabbTreeCull;
+cvar_t	*r_occluders;
+cvar_t	*r_worldVaos;
+cvar_t	*r_vertCache;
+cvar_t	*r_staticModels;
+cvar_t	*r_shaderCache;
 cvar_t	*r_nocull;
 cvar_t	*r_facePlaneCull;
 cvar_t	*r_showcluster;
@@ -104,6 +117,13 @@ cvar_t  *r_ext_texture_float;
 cvar_t  *r_ext_framebuffer_multisample;
 cvar_t  *r_arb_seamless_cube_map;
 cvar_t  *r_arb_vertex_array_object;
+cvar_t  *r_arb_buffer_storage;
+cvar_t  *r_arb_uniform_buffer_object;
+cvar_t  *r_hizCull;
+cvar_t  *r_ext_multi_draw_arrays;
+cvar_t  *r_arb_multi_draw_indirect;
+cvar_t  *r_arb_get_program_binary;
+cvar_t  *r_arb_multi_bind;
 cvar_t  *r_ext_direct_state_access;
 
 cvar_t  *r_cameraExposure;
@@ -126,6 +146,7 @@ cvar_t  *r_forceAutoExposureMin;
 cvar_t  *r_forceAutoExposureMax;
 
 cvar_t  *r_depthPrepass;
+cvar_t  *r_frontToBack;
 cvar_t  *r_ssao;
 
 cvar_t  *r_normalMapping;
@@ -136,6 +157,8 @@ cvar_t  *r_parallaxMapOffset;
 cvar_t  *r_parallaxMapShadows;
 cvar_t  *r_cubeMapping;
 cvar_t  *r_cubemapSize;
+cvar_t  *r_cubemapCache;
+cvar_t  *r_cubemapSidesPerFrame;
 cvar_t  *r_deluxeSpecular;
 cvar_t  *r_pbr;
 cvar_t  *r_baseNormalX;
@@ -146,10 +169,15 @@ cvar_t  *r_baseGloss;
 cvar_t  *r_glossType;
 cvar_t  *r_mergeLightmaps;
 cvar_t  *r_dlightMode;
+cvar_t  *r_dlightClusters;
 cvar_t  *r_pshadowDist;
 cvar_t  *r_imageUpsample;
 cvar_t  *r_imageUpsampleMaxSize;
 cvar_t  *r_imageUpsampleType;
+cvar_t  *r_streamTextures;
+cvar_t  *r_streamBudget;
+cvar_t  *r_streamUploads;
+cvar_t  *r_imageThreads;
 cvar_t  *r_genNormalMaps;
 cvar_t  *r_forceSun;
 cvar_t  *r_forceSunLightScale;
@@ -163,6 +191,7 @@ cvar_t  *r_shadowMapSize;
 cvar_t  *r_shadowCascadeZNear;
 cvar_t  *r_shadowCascadeZFar;
 cvar_t  *r_shadowCascadeZBias;
+cvar_t  *r_shadowCascadeCache;
 cvar_t  *r_ignoreDstAlpha;
 
 cvar_t	*r_ignoreGLErrors;
@@ -225,12 +254,15 @@ cvar_t	*r_debugLight;
 cvar_t	*r_debugSort;
 cvar_t	*r_printShaders;
 cvar_t	*r_saveFontData;
+cvar_t	*r_fontSDF;
 
 cvar_t	*r_marksOnTriangleMeshes;
 
 cvar_t	*r_vaoCache;
 
 cvar_t	*r_aviMotionJpegQuality;
+cvar_t	*r_videoReadback;
+cvar_t	*r_cinematicUpload;
 cvar_t	*r_screenshotJpegQuality;
 
 cvar_t	*r_maxpolys;
@@ -624,6 +656,7 @@ void R_TakeScreenshot( int x, int y, int width, int height, char *name, qboolean
 		return;
 	}
 	cmd->commandId = RC_SCREENSHOT;
+	tr.smpSyncFrame = qtrue;
 
 	cmd->x = x;
 	cmd->y = y;
@@ -885,6 +918,29 @@ void R_ExportCubemaps(void)
 		return;
 	}
 	cmd->commandId = RC_EXPORT_CUBEMAPS;
+	tr.smpSyncFrame = qtrue;
+}
+
+
+/*
+==================
+R_SaveCubemap
+
+Writes one rendered cubemap to a DDS file
+==================
+*/
+void R_SaveCubemap( int cubemapIndex, const char *filename )
+{
+	saveCubemapCommand_t	*cmd;
+
+	cmd = R_GetCommandBuffer(sizeof(*cmd));
+	if (!cmd) {
+		return;
+	}
+	cmd->commandId = RC_SAVE_CUBEMAP;
+	cmd->cubemapIndex = cubemapIndex;
+	Q_strncpyz(cmd->filename, filename, sizeof(cmd->filename));
+	tr.smpSyncFrame = qtrue;
 }
 
 
@@ -900,41 +956,46 @@ void R_ExportCubemaps_f(void)
 
 //============================================================================
 
+// video frames are read into pixel pack buffers and encoded when the next
+// frame is captured, by which time the GPU is done with them
+#define VIDEO_READBACKS 2
+
+static struct {
+	GLuint	buffers[VIDEO_READBACKS];
+	size_t	size;
+	int		index;
+	qboolean	pending;		// buffers[index ^ 1] holds an unencoded frame
+	int		frameCount;		// of the pending frame
+} videoReadback;
+
 /*
 ==================
-RB_TakeVideoFrameCmd
+RB_ShutdownVideoReadback
 ==================
 */
-const void *RB_TakeVideoFrameCmd( const void *data )
+static void RB_ShutdownVideoReadback( void )
 {
-	const videoFrameCommand_t	*cmd;
-	byte				*cBuf;
-	size_t				memcount, bytesPerPixel, linelen, avilinelen;
-	int				padwidth, avipadwidth, padlen, avipadlen;
-	int				yin, xin, xout;
-	GLint packAlign, format;
+	if ( videoReadback.buffers[0] )
+		qglDeleteBuffers( VIDEO_READBACKS, videoReadback.buffers );
 
-	// finish any 2D drawing if needed
-	if(tess.numIndexes)
-		RB_EndSurface();
+	Com_Memset( &videoReadback, 0, sizeof( videoReadback ) );
+}
 
-	cmd = (const videoFrameCommand_t *)data;
-	
-	// OpenGL ES is only required to support reading GL_RGBA
-	if (qglesMajorVersion >= 1) {
-		format = GL_RGBA;
-		bytesPerPixel = 4;
-	} else {
-		format = GL_RGB;
-		bytesPerPixel = 3;
-	}
+/*
+==================
+RB_EncodeVideoFrame
 
-	qglGetIntegerv(GL_PACK_ALIGNMENT, &packAlign);
+Gamma corrects and converts the pixels read into cBuf and hands them to the
+AVI writer
+==================
+*/
+static void RB_EncodeVideoFrame( const videoFrameCommand_t *cmd, byte *cBuf, GLint format, size_t bytesPerPixel, int padwidth )
+{
+	size_t				memcount, linelen, avilinelen;
+	int				padlen, avipadwidth, avipadlen;
+	int				yin, xin, xout;
 
 	linelen = cmd->width * bytesPerPixel;
-
-	// Alignment stuff for glReadPixels
-	padwidth = PAD(linelen, packAlign);
 	padlen = padwidth - linelen;
 
 	avilinelen = cmd->width * 3;
@@ -943,11 +1004,6 @@ const void *RB_TakeVideoFrameCmd( const void *data )
 	avipadwidth = PAD(avilinelen, AVI_LINE_PADDING);
 	avipadlen = avipadwidth - avilinelen;
 
-	cBuf = PADP(cmd->captureBuffer, packAlign);
-		
-	qglReadPixels(0, 0, cmd->width, cmd->height, format,
-		GL_UNSIGNED_BYTE, cBuf);
-
 	memcount = padwidth * cmd->height;
 
 	// gamma correct
@@ -1004,6 +1060,103 @@ const void *RB_TakeVideoFrameCmd( const void *data )
 		
 		ri.CL_WriteAVIVideoFrame(cmd->encodeBuffer, avipadwidth * cmd->height);
 	}
+}
+
+/*
+==================
+RB_TakeVideoFrameCmd
+==================
+*/
+const void *RB_TakeVideoFrameCmd( const void *data )
+{
+	const videoFrameCommand_t	*cmd;
+	byte				*cBuf;
+	size_t				memcount, bytesPerPixel, linelen;
+	int				padwidth;
+	GLint packAlign, format;
+	void *pixels;
+
+	// finish any 2D drawing if needed
+	if(tess.numIndexes)
+		RB_EndSurface();
+
+	cmd = (const videoFrameCommand_t *)data;
+	
+	// OpenGL ES is only required to support reading GL_RGBA
+	if (qglesMajorVersion >= 1) {
+		format = GL_RGBA;
+		bytesPerPixel = 4;
+	} else {
+		format = GL_RGB;
+		bytesPerPixel = 3;
+	}
+
+	qglGetIntegerv(GL_PACK_ALIGNMENT, &packAlign);
+
+	linelen = cmd->width * bytesPerPixel;
+
+	// Alignment stuff for glReadPixels
+	padwidth = PAD(linelen, packAlign);
+	memcount = padwidth * cmd->height;
+
+	cBuf = PADP(cmd->captureBuffer, packAlign);
+
+	if (!r_videoReadback->integer || !glRefConfig.mapBufferRange)
+	{
+		if (videoReadback.buffers[0])
+			RB_ShutdownVideoReadback();
+
+		qglReadPixels(0, 0, cmd->width, cmd->height, format,
+			GL_UNSIGNED_BYTE, cBuf);
+
+		RB_EncodeVideoFrame(cmd, cBuf, format, bytesPerPixel, padwidth);
+
+		return (const void *)(cmd + 1);
+	}
+
+	if (videoReadback.size != memcount)
+	{
+		int i;
+
+		RB_ShutdownVideoReadback();
+
+		qglGenBuffers(VIDEO_READBACKS, videoReadback.buffers);
+		for (i = 0; i < VIDEO_READBACKS; i++)
+		{
+			qglBindBuffer(GL_PIXEL_PACK_BUFFER, videoReadback.buffers[i]);
+			qglBufferData(GL_PIXEL_PACK_BUFFER, memcount, NULL, GL_STREAM_READ);
+		}
+		videoReadback.size = memcount;
+	}
+
+	// a frame left over from a recording that has since stopped is dropped
+	if (videoReadback.pending && cmd->frameCount != videoReadback.frameCount + 1)
+		videoReadback.pending = qfalse;
+
+	qglBindBuffer(GL_PIXEL_PACK_BUFFER, videoReadback.buffers[videoReadback.index]);
+	qglReadPixels(0, 0, cmd->width, cmd->height, format,
+		GL_UNSIGNED_BYTE, NULL);
+
+	videoReadback.index ^= 1;
+
+	if (videoReadback.pending)
+	{
+		qglBindBuffer(GL_PIXEL_PACK_BUFFER, videoReadback.buffers[videoReadback.index]);
+		pixels = qglMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, memcount, GL_MAP_READ_BIT);
+
+		if (pixels)
+		{
+			Com_Memcpy(cBuf, pixels, memcount);
+			qglUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+			RB_EncodeVideoFrame(cmd, cBuf, format, bytesPerPixel, padwidth);
+		}
+	}
+
+	qglBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	videoReadback.pending = qtrue;
+	videoReadback.frameCount = cmd->frameCount;
 
 	return (const void *)(cmd + 1);	
 }
@@ -1103,6 +1256,9 @@ void GfxInfo_f( void )
 		"fullscreen"
 	};
 
+	// the extension queries below need the GL context
+	R_IssuePendingRenderCommands();
+
 	ri.Printf( PRINT_ALL, "\nGL_VENDOR: %s\n", glConfig.vendor_string );
 	ri.Printf( PRINT_ALL, "GL_RENDERER: %s\n", glConfig.renderer_string );
 	ri.Printf( PRINT_ALL, "GL_VERSION: %s\n", glConfig.version_string );
@@ -1166,6 +1322,9 @@ void GfxInfo_f( void )
 	if ( r_finish->integer ) {
 		ri.Printf( PRINT_ALL, "Forcing glFinish\n" );
 	}
+	if ( glConfig.smpActive ) {
+		ri.Printf( PRINT_ALL, "Using dual processor acceleration\n" );
+	}
 }
 
 /*
@@ -1175,6 +1334,8 @@ GfxMemInfo_f
 */
 void GfxMemInfo_f( void ) 
 {
+	R_IssuePendingRenderCommands();
+
 	switch (glRefConfig.memInfo)
 	{
 		case MI_NONE:
@@ -1239,12 +1400,19 @@ void R_Register( void )
 	r_ext_multitexture = ri.Cvar_Get( "r_ext_multitexture", "1", CVAR_ARCHIVE | CVAR_LATCH );
 	r_ext_compiled_vertex_array = ri.Cvar_Get( "r_ext_compiled_vertex_array", "1", CVAR_ARCHIVE | CVAR_LATCH);
 	r_ext_texture_env_add = ri.Cvar_Get( "r_ext_texture_env_add", "1", CVAR_ARCHIVE | CVAR_LATCH);
+	r_smp = ri.Cvar_Get( "r_smp", "0", CVAR_ARCHIVE | CVAR_LATCH );
 
 	r_ext_framebuffer_object = ri.Cvar_Get( "r_ext_framebuffer_object", "1", CVAR_ARCHIVE | CVAR_LATCH);
 	r_ext_texture_float = ri.Cvar_Get( "r_ext_texture_float", "1", CVAR_ARCHIVE | CVAR_LATCH);
 	r_ext_framebuffer_multisample = ri.Cvar_Get( "r_ext_framebuffer_multisample", "0", CVAR_ARCHIVE | CVAR_LATCH);
 	r_arb_seamless_cube_map = ri.Cvar_Get( "r_arb_seamless_cube_map", "0", CVAR_ARCHIVE | CVAR_LATCH);
 	r_arb_vertex_array_object = ri.Cvar_Get( "r_arb_vertex_array_object", "1", CVAR_ARCHIVE | CVAR_LATCH);
+	r_arb_buffer_storage = ri.Cvar_Get( "r_arb_buffer_storage", "1", CVAR_ARCHIVE | CVAR_LATCH);
+	r_arb_uniform_buffer_object = ri.Cvar_Get( "r_arb_uniform_buffer_object", "1", CVAR_ARCHIVE | CVAR_LATCH);
+	r_ext_multi_draw_arrays = ri.Cvar_Get( "r_ext_multi_draw_arrays", "1", CVAR_ARCHIVE | CVAR_LATCH);
+	r_arb_multi_draw_indirect = ri.Cvar_Get( "r_arb_multi_draw_indirect", "1", CVAR_ARCHIVE | CVAR_LATCH);
+	r_arb_get_program_binary = ri.Cvar_Get( "r_arb_get_program_binary", "1", CVAR_ARCHIVE | CVAR_LATCH);
+	r_arb_multi_bind = ri.Cvar_Get( "r_arb_multi_bind", "1", CVAR_ARCHIVE | CVAR_LATCH);
 	r_ext_direct_state_access = ri.Cvar_Get("r_ext_direct_state_access", "1", CVAR_ARCHIVE | CVAR_LATCH);
 
 	r_ext_texture_filter_anisotropic = ri.Cvar_Get( "r_ext_texture_filter_anisotropic",
@@ -1298,6 +1466,8 @@ void R_Register( void )
 	r_cameraExposure = ri.Cvar_Get( "r_cameraExposure", "1", CVAR_CHEAT );
 
 	r_depthPrepass = ri.Cvar_Get( "r_depthPrepass", "1", CVAR_ARCHIVE );
+	r_frontToBack = ri.Cvar_Get( "r_frontToBack", "1", CVAR_ARCHIVE );
+	r_hizCull = ri.Cvar_Get( "r_hizCull", "1", CVAR_ARCHIVE | CVAR_LATCH );
 	r_ssao = ri.Cvar_Get( "r_ssao", "0", CVAR_LATCH | CVAR_ARCHIVE );
 
 	r_normalMapping = ri.Cvar_Get( "r_normalMapping", "1", CVAR_ARCHIVE | CVAR_LATCH );
@@ -1308,6 +1478,9 @@ void R_Register( void )
 	r_parallaxMapShadows = ri.Cvar_Get( "r_parallaxMapShadows", "0", CVAR_ARCHIVE | CVAR_LATCH );
 	r_cubeMapping = ri.Cvar_Get( "r_cubeMapping", "0", CVAR_ARCHIVE | CVAR_LATCH );
 	r_cubemapSize = ri.Cvar_Get( "r_cubemapSize", "128", CVAR_ARCHIVE | CVAR_LATCH );
+	r_cubemapCache = ri.Cvar_Get( "r_cubemapCache", "1", CVAR_ARCHIVE | CVAR_LATCH );
+	r_cubemapSidesPerFrame = ri.Cvar_Get( "r_cubemapSidesPerFrame", "1", CVAR_ARCHIVE );
+	ri.Cvar_CheckRange( r_cubemapSidesPerFrame, 0, 6, qtrue );
 	r_deluxeSpecular = ri.Cvar_Get("r_deluxeSpecular", "0.3", CVAR_ARCHIVE | CVAR_LATCH);
 	r_pbr = ri.Cvar_Get("r_pbr", "0", CVAR_ARCHIVE | CVAR_LATCH);
 	r_baseNormalX = ri.Cvar_Get( "r_baseNormalX", "1.0", CVAR_ARCHIVE | CVAR_LATCH );
@@ -1317,11 +1490,19 @@ void R_Register( void )
 	r_baseGloss = ri.Cvar_Get( "r_baseGloss", "0.3", CVAR_ARCHIVE | CVAR_LATCH );
 	r_glossType = ri.Cvar_Get("r_glossType", "1", CVAR_ARCHIVE | CVAR_LATCH);
 	r_dlightMode = ri.Cvar_Get( "r_dlightMode", "0", CVAR_ARCHIVE | CVAR_LATCH );
+	r_dlightClusters = ri.Cvar_Get( "r_dlightClusters", "1", CVAR_ARCHIVE | CVAR_LATCH );
 	r_pshadowDist = ri.Cvar_Get( "r_pshadowDist", "128", CVAR_ARCHIVE );
 	r_mergeLightmaps = ri.Cvar_Get( "r_mergeLightmaps", "1", CVAR_ARCHIVE | CVAR_LATCH );
 	r_imageUpsample = ri.Cvar_Get( "r_imageUpsample", "0", CVAR_ARCHIVE | CVAR_LATCH );
 	r_imageUpsampleMaxSize = ri.Cvar_Get( "r_imageUpsampleMaxSize", "1024", CVAR_ARCHIVE | CVAR_LATCH );
 	r_imageUpsampleType = ri.Cvar_Get( "r_imageUpsampleType", "1", CVAR_ARCHIVE | CVAR_LATCH );
+
+	r_streamTextures = ri.Cvar_Get( "r_streamTextures", "0", CVAR_ARCHIVE | CVAR_LATCH );
+	ri.Cvar_CheckRange( r_streamTextures, 0, 4, qtrue );
+	r_streamBudget = ri.Cvar_Get( "r_streamBudget", "256", CVAR_ARCHIVE );
+	r_streamUploads = ri.Cvar_Get( "r_streamUploads", "2", CVAR_ARCHIVE );
+	r_imageThreads = ri.Cvar_Get( "r_imageThreads", "0", CVAR_ARCHIVE );
+	ri.Cvar_CheckRange( r_imageThreads, 0, 8, qtrue );
 	r_genNormalMaps = ri.Cvar_Get( "r_genNormalMaps", "0", CVAR_ARCHIVE | CVAR_LATCH );
 
 	r_forceSun = ri.Cvar_Get( "r_forceSun", "0", CVAR_CHEAT );
@@ -1337,6 +1518,7 @@ void R_Register( void )
 	r_shadowCascadeZNear = ri.Cvar_Get( "r_shadowCascadeZNear", "8", CVAR_ARCHIVE | CVAR_LATCH );
 	r_shadowCascadeZFar = ri.Cvar_Get( "r_shadowCascadeZFar", "1024", CVAR_ARCHIVE | CVAR_LATCH );
 	r_shadowCascadeZBias = ri.Cvar_Get( "r_shadowCascadeZBias", "0", CVAR_ARCHIVE | CVAR_LATCH );
+	r_shadowCascadeCache = ri.Cvar_Get( "r_shadowCascadeCache", "0", CVAR_ARCHIVE | CVAR_LATCH );
 	r_ignoreDstAlpha = ri.Cvar_Get( "r_ignoreDstAlpha", "1", CVAR_ARCHIVE | CVAR_LATCH );
 
 	//
@@ -1397,6 +1579,7 @@ void R_Register( void )
 	r_debugSort = ri.Cvar_Get( "r_debugSort", "0", CVAR_CHEAT );
 	r_printShaders = ri.Cvar_Get( "r_printShaders", "0", 0 );
 	r_saveFontData = ri.Cvar_Get( "r_saveFontData", "0", 0 );
+	r_fontSDF = ri.Cvar_Get( "r_fontSDF", "1", CVAR_ARCHIVE | CVAR_LATCH );
 
 	r_nocurves = ri.Cvar_Get ("r_nocurves", "0", CVAR_CHEAT );
 	r_drawworld = ri.Cvar_Get ("r_drawworld", "1", CVAR_CHEAT );
@@ -1408,16 +1591,29 @@ void R_Register( void )
 	r_flareCoeff = ri.Cvar_Get ("r_flareCoeff", FLARE_STDCOEFF, CVAR_CHEAT);
 
 	r_skipBackEnd = ri.Cvar_Get ("r_skipBackEnd", "0", CVAR_CHEAT);
+	r_showSmp = ri.Cvar_Get ("r_showSmp", "0", CVAR_CHEAT);
 
 	r_measureOverdraw = ri.Cvar_Get( "r_measureOverdraw", "0", CVAR_CHEAT );
 	r_lodscale = ri.Cvar_Get( "r_lodscale", "5", CVAR_CHEAT );
+	r_autoLods = ri.Cvar_Get( "r_autoLods", "2", CVAR_ARCHIVE | CVAR_LATCH );
+	ri.Cvar_CheckRange( r_autoLods, 0, MD3_MAX_LODS - 1, qtrue );
 	r_norefresh = ri.Cvar_Get ("r_norefresh", "0", CVAR_CHEAT);
 	r_drawentities = ri.Cvar_Get ("r_drawentities", "1", CVAR_CHEAT );
 	r_ignore = ri.Cvar_Get( "r_ignore", "1", CVAR_CHEAT );
 	r_nocull = ri.Cvar_Get ("r_nocull", "0", CVAR_CHEAT);
 	r_novis = ri.Cvar_Get ("r_novis", "0", CVAR_CHEAT);
+	r_cellPortals = ri.Cvar_Get ("r_cellPortals", "1", CVAR_CHEAT);
+	r_aabbTreeCull = ri.Cvar_Get ("r_aabbTreeCull", "1", CVAR_CHEAT);
+	r_occluders = ri.Cvar_Get ("r_occluders", "8", CVAR_CHEAT);
+	ri.Cvar_CheckRange( r_occluders, 0, MAX_VIEW_OCCLUDERS, qtrue );
+	r_worldVaos = ri.Cvar_Get ("r_worldVaos", "1", CVAR_ARCHIVE | CVAR_LATCH);
+	r_vertCache = ri.Cvar_Get ("r_vertCache", "1", CVAR_ARCHIVE);
+	r_staticModels = ri.Cvar_Get ("r_staticModels", "1", CVAR_ARCHIVE | CVAR_LATCH);
+	r_shaderCache = ri.Cvar_Get ("r_shaderCache", "1", CVAR_ARCHIVE);
 	r_showcluster = ri.Cvar_Get ("r_showcluster", "0", CVAR_CHEAT);
 	r_speeds = ri.Cvar_Get ("r_speeds", "0", CVAR_CHEAT);
+	r_gpuTimers = ri.Cvar_Get ("r_gpuTimers", "0", CVAR_CHEAT);
+	r_batch2D = ri.Cvar_Get ("r_batch2D", "1", CVAR_ARCHIVE);
 	r_verbose = ri.Cvar_Get( "r_verbose", "0", CVAR_CHEAT );
 	r_logFile = ri.Cvar_Get( "r_logFile", "0", CVAR_CHEAT );
 	r_debugSurface = ri.Cvar_Get ("r_debugSurface", "0", CVAR_CHEAT);
@@ -1438,6 +1634,8 @@ void R_Register( void )
 	r_vaoCache = ri.Cvar_Get("r_vaoCache", "0", CVAR_ARCHIVE);
 
 	r_aviMotionJpegQuality = ri.Cvar_Get("r_aviMotionJpegQuality", "90", CVAR_ARCHIVE);
+	r_videoReadback = ri.Cvar_Get("r_videoReadback", "1", CVAR_ARCHIVE);
+	r_cinematicUpload = ri.Cvar_Get("r_cinematicUpload", "1", CVAR_ARCHIVE);
 	r_screenshotJpegQuality = ri.Cvar_Get("r_screenshotJpegQuality", "90", CVAR_ARCHIVE);
 
 	r_maxpolys = ri.Cvar_Get( "r_maxpolys", va("%d", MAX_POLYS), 0);
@@ -1456,24 +1654,33 @@ void R_Register( void )
 	ri.Cmd_AddCommand( "minimize", GLimp_Minimize );
 	ri.Cmd_AddCommand( "gfxmeminfo", GfxMemInfo_f );
 	ri.Cmd_AddCommand( "exportCubemaps", R_ExportCubemaps_f );
+	ri.Cmd_AddCommand( "gputimers", R_GpuTimers_f );
 }
 
 void R_InitQueries(void)
 {
+	R_InitGpuTimers();
+
 	if (!glRefConfig.occlusionQuery)
 		return;
 
 	if (r_drawSunRays->integer)
 		qglGenQueries(ARRAY_LEN(tr.sunFlareQuery), tr.sunFlareQuery);
+
+	R_InitFlareQueries();
 }
 
 void R_ShutDownQueries(void)
 {
+	R_ShutdownGpuTimers();
+
 	if (!glRefConfig.occlusionQuery)
 		return;
 
 	if (r_drawSunRays->integer)
 		qglDeleteQueries(ARRAY_LEN(tr.sunFlareQuery), tr.sunFlareQuery);
+
+	R_ShutdownFlareQueries();
 }
 
 /*
@@ -1544,24 +1751,41 @@ void R_Init( void ) {
 	if (max_polyverts < MAX_POLYVERTS)
 		max_polyverts = MAX_POLYVERTS;
 
-	ptr = ri.Hunk_Alloc( sizeof( *backEndData ) + sizeof(srfPoly_t) * max_polys + sizeof(polyVert_t) * max_polyverts, h_low);
-	backEndData = (backEndData_t *) ptr;
-	backEndData->polys = (srfPoly_t *) ((char *) ptr + sizeof( *backEndData ));
-	backEndData->polyVerts = (polyVert_t *) ((char *) ptr + sizeof( *backEndData ) + sizeof(srfPoly_t) * max_polys);
+	for ( i = 0 ; i < SMP_FRAMES ; i++ ) {
+		// the second set is only needed by the render thread
+		if ( i > 0 && !r_smp->integer ) {
+			backEndData[i] = NULL;
+			continue;
+		}
+		ptr = ri.Hunk_Alloc( sizeof( *backEndData[i] ) + sizeof(srfPoly_t) * max_polys + sizeof(polyVert_t) * max_polyverts, h_low);
+		backEndData[i] = (backEndData_t *) ptr;
+		backEndData[i]->polys = (srfPoly_t *) ((char *) ptr + sizeof( *backEndData[i] ));
+		backEndData[i]->polyVerts = (polyVert_t *) ((char *) ptr + sizeof( *backEndData[i] ) + sizeof(srfPoly_t) * max_polys);
+	}
 	R_InitNextFrame();
 
+	ri.ProfileBegin( "InitOpenGL" );
 	InitOpenGL();
+	ri.ProfileEnd();
 
+	ri.ProfileBegin( "R_InitImages" );
 	R_InitImages();
+	ri.ProfileEnd();
 
 	if (glRefConfig.framebufferObject)
 		FBO_Init();
 
+	R_InitUniformStream();
+
+	ri.ProfileBegin( "GLSL_InitGPUShaders" );
 	GLSL_InitGPUShaders();
+	ri.ProfileEnd();
 
 	R_InitVaos();
 
+	ri.ProfileBegin( "R_InitShaders" );
 	R_InitShaders();
+	ri.ProfileEnd();
 
 	R_InitSkins();
 
@@ -1576,6 +1800,14 @@ void R_Init( void ) {
 	if ( err != GL_NO_ERROR )
 		ri.Printf (PRINT_ALL, "glGetError() = 0x%x\n", err);
 
+	// hand the back end to its own thread once everything that
+	// needs the GL context on this thread is done
+	if ( r_smp->integer && backEndData[1] ) {
+		ri.Printf( PRINT_ALL, "Trying SMP acceleration...\n" );
+		glConfig.smpActive = GLimp_SpawnRenderThread( RB_RenderThread );
+		ri.Printf( PRINT_ALL, glConfig.smpActive ? "...succeeded.\n" : "...failed.\n" );
+	}
+
 	// print info
 	GfxInfo_f();
 	ri.Printf( PRINT_ALL, "----- finished R_Init -----\n" );
@@ -1601,16 +1833,25 @@ void RE_Shutdown( qboolean destroyWindow ) {
 	ri.Cmd_RemoveCommand( "minimize" );
 	ri.Cmd_RemoveCommand( "gfxmeminfo" );
 	ri.Cmd_RemoveCommand( "exportCubemaps" );
+	ri.Cmd_RemoveCommand( "gputimers" );
 
+	// let the render thread finish and take the GL context back
+	if ( glConfig.smpActive ) {
+		GLimp_ShutdownRenderThread();
+		glConfig.smpActive = qfalse;
+	}
 
 	if ( tr.registered ) {
 		R_IssuePendingRenderCommands();
 		R_ShutDownQueries();
+		RB_ShutdownVideoReadback();
+		RB_ShutdownCinematicUpload();
 		if (glRefConfig.framebufferObject)
 			FBO_Shutdown();
 		R_DeleteTextures();
 		R_ShutdownVaos();
 		GLSL_ShutdownGPUShaders();
+		R_ShutdownUniformStream();
 	}
 
 	R_DoneFreeType();
@@ -1702,6 +1943,7 @@ refexport_t *GetRefAPI ( int apiVersion, refimport_t *rimp ) {
 
 	re.SetColor = RE_SetColor;
 	re.DrawStretchPic = RE_StretchPic;
+	re.DrawStretchPics = RE_StretchPics;
 	re.DrawStretchRaw = RE_StretchRaw;
 	re.UploadCinematic = RE_UploadCinematic;
 
@@ -99,7 +99,7 @@ void R_DlightBmodel( bmodel_t *bmodel ) {
 			case SF_FACE:
 			case SF_GRID:
 			case SF_TRIANGLES:
-				((srfBspSurface_t *)surf->data)->dlightBits = mask;
+				((srfBspSurface_t *)surf->data)->dlightBits[ tr.smpFrame ] = mask;
 				break;
 
 			default:
@@ -121,6 +121,115 @@ extern	cvar_t	*r_ambientScale;
 extern	cvar_t	*r_directedScale;
 extern	cvar_t	*r_debugLight;
 
+/*
+=================
+R_SetupEntityLightingCod1
+
+CoD1 maps have no light grid, so the light entities listed for the cell
+the entity stands in are summed instead.  The result is kept per entity
+slot and reused while the model stays at the same spot, which covers the
+map models and anything standing still.  Returns qfalse if no light
+reaches the entity.
+=================
+*/
+#define ENTITY_LIGHT_CACHE	256
+
+typedef struct {
+	qboolean	valid;
+	qboolean	lit;
+	qhandle_t	hModel;
+	vec3_t		origin;
+	vec3_t		color;
+	vec3_t		lightDir;
+} entityLightCache_t;
+
+static entityLightCache_t entityLightCache[ENTITY_LIGHT_CACHE];
+
+void R_ClearEntityLightCache( void ) {
+	Com_Memset( entityLightCache, 0, sizeof( entityLightCache ) );
+}
+
+static qboolean R_SetupEntityLightingCod1( const trRefdef_t *refdef, trRefEntity_t *ent, const vec3_t lightOrigin, world_t *world ) {
+	entityLightCache_t	*cache = NULL;
+	const int	*list;
+	mnode_t		*leaf;
+	vec3_t		color, dir, delta;
+	int			i, count, slot;
+	float		d, w;
+
+	slot = ent - refdef->entities;
+	if ( slot >= 0 && slot < refdef->num_entities && slot < ENTITY_LIGHT_CACHE ) {
+		cache = &entityLightCache[slot];
+
+		if ( cache->valid && cache->hModel == ent->e.hModel && VectorCompare( cache->origin, lightOrigin ) ) {
+			if ( !cache->lit ) {
+				return qfalse;
+			}
+
+			VectorCopy( cache->color, color );
+			VectorCopy( cache->lightDir, dir );
+			goto scale;
+		}
+	}
+
+	leaf = R_PointInLeaf( lightOrigin );
+	if ( leaf->cell >= 0 ) {
+		list = world->cellLights + world->cells[leaf->cell].firstLight;
+		count = world->cells[leaf->cell].numLights;
+	} else {
+		list = world->cellLights + world->firstOutsideLight;
+		count = world->numOutsideLights;
+	}
+
+	VectorClear( color );
+	VectorClear( dir );
+
+	for ( i = 0; i < count; i++ ) {
+		const mlight_t *light = &world->lights[list[i]];
+
+		VectorSubtract( light->origin, lightOrigin, delta );
+		d = VectorNormalize( delta );
+		if ( d >= light->radius ) {
+			continue;
+		}
+
+		w = 1.0f - d / light->radius;
+		w *= w;
+
+		VectorMA( color, w, light->color, color );
+		VectorMA( dir, w * ( light->color[0] + light->color[1] + light->color[2] ), delta, dir );
+	}
+
+	if ( cache ) {
+		cache->valid = qtrue;
+		cache->hModel = ent->e.hModel;
+		VectorCopy( lightOrigin, cache->origin );
+		cache->lit = qfalse;
+	}
+
+	if ( color[0] + color[1] + color[2] <= 0 ) {
+		return qfalse;
+	}
+
+	if ( VectorNormalize( dir ) == 0 ) {
+		VectorSet( dir, 0, 0, 1 );
+	}
+
+	if ( cache ) {
+		cache->lit = qtrue;
+		VectorCopy( color, cache->color );
+		VectorCopy( dir, cache->lightDir );
+	}
+
+scale:
+	// a quarter of it goes to ambient, like the light grid of a typical q3 map
+	VectorScale( color, tr.identityLight * 0.25f * r_ambientScale->value, ent->ambientLight );
+	VectorScale( color, tr.identityLight * 0.75f * r_directedScale->value, ent->directedLight );
+	VectorCopy( dir, ent->lightDir );
+
+	return qtrue;
+}
+
 /*
 =================
 R_SetupEntityLightingGrid
@@ -347,6 +456,9 @@ void R_SetupEntityLighting( const trRefdef_t *refdef, trRefEntity_t *ent ) {
 	if ( !(refdef->rdflags & RDF_NOWORLDMODEL ) 
 		&& tr.world->lightGridData ) {
 		R_SetupEntityLightingGrid( ent, tr.world );
+	} else if ( !(refdef->rdflags & RDF_NOWORLDMODEL )
+		&& tr.world->numLights && R_SetupEntityLightingCod1( refdef, ent, lightOrigin, tr.world ) ) {
+		// lit by the light entities of the cell
 	} else {
 		ent->ambientLight[0] = ent->ambientLight[1] = 
 			ent->ambientLight[2] = tr.identityLight * 150;
@@ -446,10 +558,21 @@ R_LightForPoint
 */
 int R_LightForPoint( vec3_t point, vec3_t ambientLight, vec3_t directedLight, vec3_t lightDir )
 {
+	static trRefdef_t noEntities;	// keeps the point out of the entity light cache
 	trRefEntity_t ent;
 	
 	if ( tr.world->lightGridData == NULL )
-	  return qfalse;
+	{
+		// CoD1 maps, lit from the light list of the cell
+		Com_Memset(&ent, 0, sizeof(ent));
+		if ( !tr.world->numLights || !R_SetupEntityLightingCod1( &noEntities, &ent, point, tr.world ) )
+			return qfalse;
+
+		VectorCopy(ent.ambientLight, ambientLight);
+		VectorCopy(ent.directedLight, directedLight);
+		VectorCopy(ent.lightDir, lightDir);
+		return qtrue;
+	}
 
 	Com_Memset(&ent, 0, sizeof(ent));
 	VectorCopy( point, ent.e.origin );
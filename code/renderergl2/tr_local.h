@@ -46,6 +46,16 @@ QGL_3_0_PROCS;
 QGL_ARB_occlusion_query_PROCS;
 QGL_ARB_framebuffer_object_PROCS;
 QGL_ARB_vertex_array_object_PROCS;
+QGL_ARB_map_buffer_range_PROCS;
+QGL_ARB_sync_PROCS;
+QGL_ARB_buffer_storage_PROCS;
+QGL_EXT_multi_draw_arrays_PROCS;
+QGL_ARB_multi_draw_indirect_PROCS;
+QGL_ARB_get_program_binary_PROCS;
+QGL_ARB_uniform_buffer_object_PROCS;
+QGL_ARB_multi_bind_PROCS;
+QGL_ARB_timer_query_PROCS;
+QGL_KHR_parallel_shader_compile_PROCS;
 QGL_EXT_direct_state_access_PROCS;
 #undef GLE
 
@@ -75,6 +85,7 @@ typedef struct cubemap_s {
 	vec3_t origin;
 	float parallaxRadius;
 	image_t *image;
+	int missingSides;		// sides still to be rendered by R_RenderPendingCubemaps()
 } cubemap_t;
 
 typedef struct dlight_s {
@@ -147,6 +158,8 @@ typedef struct vao_s
 
 	uint32_t        indexesIBO;
 	int             indexesSize;	// amount of memory data allocated for all triangles in bytes
+
+	struct vao_s   *depthVao;		// positions only, shares indexesIBO, for the depth prepass
 } vao_t;
 
 //===============================================================================
@@ -373,7 +386,11 @@ enum
 	TB_SHADOWMAP   = 5,
 	TB_CUBEMAP     = 6,
 	TB_SHADOWMAP4  = 6,
-	NUM_TEXTURE_BUNDLES = 7
+	NUM_TEXTURE_BUNDLES = 7,
+
+	// units past the bundles only hold renderer images, never shader stage ones
+	TB_DLIGHTCLUSTERS = 7,
+	NUM_TEXTURE_UNITS = 8
 };
 
 typedef enum
@@ -609,7 +626,8 @@ enum
 	GLSL_VEC3,
 	GLSL_VEC4,
 	GLSL_MAT16,
-	GLSL_MAT16_BONEMATRIX
+	GLSL_MAT16_BONEMATRIX,
+	GLSL_VEC4_DLIGHTS
 };
 
 typedef enum
@@ -710,6 +728,13 @@ typedef enum
 
 	UNIFORM_GREYSCALE,
 
+	UNIFORM_DLIGHTCLUSTERMAP,
+	UNIFORM_DLIGHTCLUSTERTILE,
+	UNIFORM_DLIGHTCLUSTERPLANE,
+	UNIFORM_DLIGHTCLUSTERSLICE,
+	UNIFORM_DLIGHTORIGINS,
+	UNIFORM_DLIGHTCOLORS,
+
 	UNIFORM_COUNT
 } uniform_t;
 
@@ -728,8 +753,22 @@ typedef struct shaderProgram_s
 	GLint uniforms[UNIFORM_COUNT];
 	short uniformBufferOffsets[UNIFORM_COUNT]; // max 32767/64=511 uniforms
 	char  *uniformBuffer;
+
+	qboolean        entityBlock;	// takes its transform from the Entity uniform block
+	qboolean        boneBlock;		// takes u_BoneMatrix from the Bones uniform block
 } shaderProgram_t;
 
+// std140 layout of the Entity uniform block, see USE_UBO in the vertex shaders
+#define UNIFORM_BLOCK_ENTITY 0
+#define UNIFORM_BLOCK_BONES 1	// mat4 u_BoneMatrix[MAX_GLSL_BONES]
+
+typedef struct {
+	mat4_t			modelViewProjectionMatrix;
+	mat4_t			modelMatrix;
+	vec4_t			viewOrigin;
+	vec4_t			localViewOrigin;
+} entityBlock_t;
+
 // trRefdef_t holds everything that comes in refdef_t,
 // as well as the locally generated scene information
 typedef struct {
@@ -823,7 +862,8 @@ typedef enum {
 	VPF_ORTHOGRAPHIC    = 0x10,
 	VPF_USESUNLIGHT     = 0x20,
 	VPF_FARPLANEFRUSTUM = 0x40,
-	VPF_NOCUBEMAPS      = 0x80
+	VPF_NOCUBEMAPS      = 0x80,
+	VPF_RESTOREDEPTH    = 0x100
 } viewParmFlags_t;
 
 typedef struct {
@@ -838,6 +878,7 @@ typedef struct {
 	cplane_t	portalPlane;		// clip anything behind this if mirroring
 	int			viewportX, viewportY, viewportWidth, viewportHeight;
 	FBO_t		*targetFbo;
+	FBO_t		*depthCacheFbo;		// depth copied into targetFbo before drawing with VPF_RESTOREDEPTH
 	int         targetFboLayer;
 	int         targetFboCubemapIndex;
 	float		fovX, fovY;
@@ -891,12 +932,14 @@ typedef struct drawSurf_s {
 #define	MAX_GRID_SIZE		65			// max dimensions of a grid mesh in memory
 
 // when cgame directly specifies a polygon, it becomes a srfPoly_t
-// as soon as it is called
+// as soon as it is called, or is appended to the previous one when
+// it has the same shader, fog and vertex count
 typedef struct srfPoly_s {
 	surfaceType_t	surfaceType;
 	qhandle_t		hShader;
 	int				fogIndex;
-	int				numVerts;
+	int				numVerts;		// all fans
+	int				numFanVerts;	// each fan
 	polyVert_t		*verts;
 } srfPoly_t;
 
@@ -925,14 +968,18 @@ typedef struct
 
 #define srfVert_t_cleared(x) srfVert_t (x) = {{0, 0, 0}, {0, 0}, {0, 0}, {0, 0, 0, 0}, {0, 0, 0, 0}, {0, 0, 0, 0}, {0, 0, 0, 0}}
 
+// the front end builds one frame while the back end draws the other
+#define	SMP_FRAMES		2
+
 // srfBspSurface_t covers SF_GRID, SF_TRIANGLES, and SF_POLY
 typedef struct srfBspSurface_s
 {
 	surfaceType_t   surfaceType;
 
-	// dynamic lighting information
-	int				dlightBits;
-	int             pshadowBits;
+	// dynamic lighting information, written by the front end for
+	// the frame it is building while the back end reads the other
+	int				dlightBits[SMP_FRAMES];
+	int             pshadowBits[SMP_FRAMES];
 
 	// culling information
 	vec3_t			cullBounds[2];
@@ -947,6 +994,10 @@ typedef struct srfBspSurface_s
 	// vertexes
 	int             numVerts;
 	srfVert_t      *verts;
+
+	// static world vao, CoD1 soups only
+	vao_t          *vao;
+	int             firstIndex;
 	
 	// SF_GRID specific variables after here
 
@@ -1052,6 +1103,7 @@ typedef struct srfVaoMdvMesh_s
 
 	// static render data
 	vao_t          *vao;
+	int             firstIndex;		// generated lods share the vao of lod 0
 } srfVaoMdvMesh_t;
 
 extern	void (*rb_surfaceTable[SF_NUM_SURFACE_TYPES])(void *);
@@ -1142,8 +1194,84 @@ typedef struct mnode_s {
 
 	int         firstmarksurface;
 	int			nummarksurfaces;
+
+	int			cell;			// CoD1 portal cell, -1 if none
+
+	int			firstStaticModel;	// index into world->leafStaticModels
+	int			numStaticModels;
 } mnode_t;
 
+// CoD1 misc_model props baked into world space at load
+#define STATIC_MODEL_HASH	256
+
+typedef struct {
+	qhandle_t	hModel;
+	vec3_t		origin;
+	vec3_t		forward;		// first axis, to tell the prop from a turned entity
+	vec3_t		bounds[2];
+	int			firstSurface;	// index into world->staticSurfaces
+	int			numSurfaces;
+	int			hashNext;		// -1 ends the chain
+} mstaticModel_t;
+
+// CoD1 cell/portal visibility
+typedef struct {
+	vec3_t		bounds[2];
+	int			firstPortal;
+	int			numPortals;
+	int			aabbTree;		// root in world->aabbTrees, -1 if none
+	int			firstOccluder;	// index into world->occluderIndices
+	int			numOccluders;
+	int			firstLight;		// index into world->cellLights
+	int			numLights;
+
+	int			visFrame;		// == world->cellFrame if reached this frame
+	qboolean	onStack;		// being walked, don't recurse back in
+} mcell_t;
+
+#define	MAX_PORTAL_VERTS	64
+
+// CoD1 light entities, used for entity lighting in place of a light grid
+typedef struct {
+	vec3_t		origin;
+	vec3_t		color;			// 0-255 at the light, falls off to 0 at radius
+	float		radius;
+} mlight_t;
+
+// CoD1 occluders
+#define	MAX_OCCLUDER_PLANES	32
+#define	MAX_VIEW_OCCLUDERS	16
+
+typedef struct {
+	int			firstPlane;		// index into world->occluderPlanes
+	int			numPlanes;
+	int			firstEdge;		// index into world->occluderEdges
+	int			numEdges;
+	int			frameCount;		// already considered for this view
+} moccluder_t;
+
+// CoD1 hierarchical surface culling
+typedef struct {
+	vec3_t		bounds[2];
+	int			firstSurface;	// index into world->cullGroupSurfaces
+	int			numSurfaces;
+} mcullgroup_t;
+
+typedef struct {
+	vec3_t		bounds[2];
+	int			firstCullGroup;
+	int			numCullGroups;
+	int			numChildren;	// children follow this node in the array
+	int			next;			// index of the node after this subtree
+} maabbtree_t;
+
+typedef struct {
+	int			cell;			// cell on the far side
+	int			numVerts;
+	vec3_t		*verts;
+	cplane_t	plane;
+} mportal_t;
+
 typedef struct {
 	vec3_t		bounds[2];		// for culling
 	int	        firstSurface;
@@ -1195,6 +1323,54 @@ typedef struct {
 	int			clusterBytes;
 	const byte	*vis;			// may be passed in by CM_LoadMap to save space
 
+	int			numCells;
+	mcell_t		*cells;
+	int			numPortals;
+	mportal_t	*portals;
+	int			cellFrame;
+	qboolean	cellsActive;	// view is inside a cell this frame
+
+	int			numCullGroups;
+	mcullgroup_t *cullGroups;
+	int			*cullGroupSurfaces;
+	int			numAabbTrees;
+	maabbtree_t	*aabbTrees;
+	int			*surfacesTreeCount;	// == tr.viewCount if accepted by the tree walk
+	byte		*surfacesInTree;		// surface is referenced by some cull group
+
+	int			*surfacesDrawOrder;		// world surfaces in static vao order, or NULL
+
+	int			*surfacesCell;			// CoD1 cell a soup belongs to, -1 if none
+	int			*cellRank;				// per view, 0 for the cell nearest the viewer
+	int			*cellOrder;				// numCells + 1, doubles as rank counts
+	float		*cellDist;
+	int			*surfacesVisible;		// scratch for the front to back ordering
+	int			*surfacesSorted;
+
+	int			numOccluders;
+	moccluder_t	*occluders;
+	cplane_t	**occluderPlanes;
+	unsigned short (*occluderEdges)[2];
+	int			numOccluderIndices;
+	int			*occluderIndices;
+	int			occluderFrame;
+
+	int			numLights;
+	mlight_t	*lights;
+	int			*cellLights;		// light lists of the cells, then the one for leafs outside cells
+	int			firstOutsideLight;
+	int			numOutsideLights;
+
+	int			numStaticModels;
+	mstaticModel_t	*staticModels;
+	int			numStaticSurfaces;
+	msurface_t	*staticSurfaces;
+	int			*leafStaticModels;
+	int			*staticModelsViewCount;
+	int			*staticModelsDlightBits;
+	int			*staticModelsPshadowBits;
+	int			staticModelHash[STATIC_MODEL_HASH];
+
 	char		*entityString;
 	char		*entityParsePoint;
 } world_t;
@@ -1362,6 +1538,10 @@ typedef struct {
 	int		c_box_cull_md3_in, c_box_cull_md3_clip, c_box_cull_md3_out;
 
 	int		c_leafs;
+	int		c_cells, c_portals;
+	int		c_aabb_in, c_aabb_clip, c_aabb_out;
+	int		c_hiz_out;
+	int		c_occluders, c_occluded;
 	int		c_dlightSurfaces;
 	int		c_dlightSurfacesCulled;
 } frontEndCounters_t;
@@ -1390,6 +1570,9 @@ typedef struct {
 	mat4_t        modelview;
 	mat4_t        projection;
 	mat4_t		modelviewProjection;
+	entityBlock_t	entityBlock;	// set through GLSL_SetUniform*, uploaded at draw time
+	qboolean		entityBlockDirty;
+	qboolean		boneMatrixDirty;	// boneMatrix changed since the Bones block was uploaded
 } glstate_t;
 
 typedef enum {
@@ -1434,6 +1617,15 @@ typedef struct {
 
 	qboolean vertexArrayObject;
 	qboolean directStateAccess;
+	qboolean mapBufferRange;
+	qboolean bufferStorage;
+	qboolean uniformBufferObject;
+	GLint uniformBufferOffsetAlignment;
+	qboolean multiDrawElements;
+	qboolean multiDrawIndirect;
+	qboolean programBinary;
+	qboolean multiBind;
+	qboolean timerQuery;
 
 	int maxVertexAttribs;
 	qboolean gpuVertexAnimation;
@@ -1467,13 +1659,33 @@ typedef struct {
 	int		c_flareAdds;
 	int		c_flareTests;
 	int		c_flareRenders;
+	int		c_flareQueries;
 
 	int     c_glslShaderBinds;
+	int     c_glslShaderBindsSkipped;
 	int     c_genericDraws;
 	int     c_lightallDraws;
 	int     c_fogDraws;
 	int     c_dlightDraws;
 
+	// GL calls and the redundant ones filtered out before reaching the driver, r_speeds 8 and 9
+	int		c_draws;
+	int		c_multiDraws;
+	int		c_uniforms;
+	int		c_uniformsSkipped;
+	int		c_uniformBlocks;
+	int		c_textureBinds;
+	int		c_textureBindsSkipped;
+	int		c_stateChanges;
+	int		c_stateChangesSkipped;
+	int		c_cullChanges;
+	int		c_cullChangesSkipped;
+	int		c_vaoBindsSkipped;
+	int		c_fboBinds;
+	int		c_fboBindsSkipped;
+	int		c_bufferUploads;
+	int		c_bufferUploadBytes;
+
 	int		msec;			// total msec for backend run
 } backEndCounters_t;
 
@@ -1497,8 +1709,40 @@ typedef struct {
 	qboolean    colorMask[4];
 	qboolean    depthFill;
 	float       greyscale;
+
+	int			smpFrame;		// which backEndData the current commands came from
+	int			hizFrameCount;	// last frame RB_UpdateHiZ read back
+
+	// dlights binned for the current view, see RB_BinDlights
+	qboolean	dlightClusters;
+	vec4_t		dlightClusterTile;
+	vec4_t		dlightClusterPlane;
+	vec4_t		dlightClusterSlice;
+	vec4_t		dlightOrigins[MAX_DLIGHTS];
+	vec4_t		dlightColors[MAX_DLIGHTS];
 } backEndState_t;
 
+// a max-depth pyramid level of the last main view, read back for the front
+// end to occlusion cull against; see RB_UpdateHiZ and R_HizOccluded
+#define HIZ_WIDTH		128
+#define HIZ_HEIGHT		64
+#define HIZ_MAX_FOOTPRINT 32	// must match the loop bound in hiz_fp.glsl
+#define HIZ_READBACKS	3		// so the one we map is two frames old and done
+#define HIZ_MAX_MOVE	64		// past this, parallax makes the old depth useless
+
+// dlights are binned into screen tiles and log spaced depth slices for each
+// view, the bit masks go into a DLIGHT_CLUSTERS_X * Z by Y texture
+#define DLIGHT_CLUSTERS_X	16
+#define DLIGHT_CLUSTERS_Y	8
+#define DLIGHT_CLUSTERS_Z	16
+
+typedef struct {
+	qboolean	valid;
+	vec3_t		origin;
+	mat4_t		viewProjection;		// of the view the depth came from
+	float		depth[HIZ_HEIGHT][HIZ_WIDTH];	// window depth, row 0 at the bottom
+} hizBuffer_t;
+
 /*
 ** trGlobals_t 
 **
@@ -1521,6 +1765,9 @@ typedef struct {
 
 	int						frameSceneNum;	// zeroed at RE_BeginFrame
 
+	int						smpFrame;		// backEndData the front end is filling
+	qboolean				smpSyncFrame;	// wait for the back end, it uses main thread resources
+
 	qboolean				worldMapLoaded;
 	qboolean				worldDeluxeMapping;
 	vec2_t                  autoExposureMinMax;
@@ -1554,6 +1801,8 @@ typedef struct {
 	image_t                 *screenShadowImage;
 	image_t                 *screenSsaoImage;
 	image_t					*hdrDepthImage;
+	image_t					*hizImage;
+	image_t					*dlightClusterImage;	// per cluster bit mask of the dlights touching it
 	image_t                 *renderCubeImage;
 	
 	image_t					*textureDepthImage;
@@ -1569,9 +1818,11 @@ typedef struct {
 	FBO_t					*calcLevelsFbo;
 	FBO_t					*targetLevelsFbo;
 	FBO_t					*sunShadowFbo[4];
+	FBO_t					*sunShadowCacheFbo[3];
 	FBO_t					*screenShadowFbo;
 	FBO_t					*screenSsaoFbo;
 	FBO_t					*hdrDepthFbo;
+	FBO_t					*hizFbo;
 	FBO_t                   *renderCubeFbo;
 
 	shader_t				*defaultShader;
@@ -1611,13 +1862,14 @@ typedef struct {
 	shaderProgram_t pshadowShader;
 	shaderProgram_t down4xShader;
 	shaderProgram_t bokehShader;
-	shaderProgram_t tonemapShader;
+	shaderProgram_t tonemapShader[2];	// [1] also applies the half res SSAO
 	shaderProgram_t calclevels4xShader[2];
 	shaderProgram_t shadowmaskShader;
 	shaderProgram_t ssaoShader;
 	shaderProgram_t depthBlurShader[4];
 	shaderProgram_t testcubeShader;
 	shaderProgram_t greyscaleShader;
+	shaderProgram_t hizShader;
 
 
 	// -----------------------------------------
@@ -1642,6 +1894,13 @@ typedef struct {
 	vec3_t                  lastCascadeSunDirection;
 	float                   lastCascadeSunMvp[16];
 
+	// static world depth for the first three cascades, r_shadowCascadeCache
+	struct {
+		qboolean            valid;
+		vec3_t              sunDir;
+		vec3_t              bounds[2];
+	} sunShadowCache[3];
+
 	frontEndCounters_t		pc;
 	int						frontEndMsec;		// not in pc due to clearing issue
 
@@ -1675,6 +1934,13 @@ typedef struct {
 	int						sunFlareQueryIndex;
 	qboolean				sunFlareQueryActive[2];
 
+	GLuint					hizReadback[HIZ_READBACKS];	// GL_PIXEL_PACK_BUFFERs
+	mat4_t					hizReadbackViewProjection[HIZ_READBACKS];
+	vec3_t					hizReadbackOrigin[HIZ_READBACKS];
+	qboolean				hizReadbackActive[HIZ_READBACKS];
+	int						hizReadbackIndex;
+	hizBuffer_t				hiz[SMP_FRAMES];	// back end fills backEnd.smpFrame, front end reads tr.smpFrame
+
 	float					sinTable[FUNCTABLE_SIZE];
 	float					squareTable[FUNCTABLE_SIZE];
 	float					triangleTable[FUNCTABLE_SIZE];
@@ -1712,6 +1978,7 @@ extern cvar_t	*r_measureOverdraw;		// enables stencil buffer overdraw measuremen
 
 extern cvar_t	*r_lodbias;				// push/pull LOD transitions
 extern cvar_t	*r_lodscale;
+extern cvar_t	*r_autoLods;			// lods generated for MD3s that ship only one
 
 extern cvar_t	*r_inGameVideo;				// controls whether in game video should be draw
 extern cvar_t	*r_fastsky;				// controls whether sky should be cleared or drawn
@@ -1723,8 +1990,17 @@ extern	cvar_t	*r_norefresh;			// bypasses the ref rendering
 extern	cvar_t	*r_drawentities;		// disable/enable entity rendering
 extern	cvar_t	*r_drawworld;			// disable/enable world rendering
 extern	cvar_t	*r_speeds;				// various levels of information display
+extern	cvar_t	*r_gpuTimers;			// GPU time of the main passes, 1 = bars, 2 = also csv log
+extern	cvar_t	*r_batch2D;				// group runs of 2D pics by shader where they don't overlap
 extern  cvar_t	*r_detailTextures;		// enables/disables detail texturing stages
 extern	cvar_t	*r_novis;				// disable/enable usage of PVS
+extern	cvar_t	*r_cellPortals;			// CoD1 maps: per-frame cell/portal visibility
+extern	cvar_t	*r_aabbTreeCull;		// CoD1 maps: hierarchical surface culling
+extern	cvar_t	*r_occluders;			// CoD1 maps: max occluders used per view
+extern	cvar_t	*r_worldVaos;			// CoD1 maps: pack soups into static world vaos
+extern	cvar_t	*r_vertCache;			// CoD1 maps: cache processed vertexes in the homepath
+extern	cvar_t	*r_staticModels;		// CoD1 maps: bake misc_model props into the world
+extern	cvar_t	*r_shaderCache;			// cache the combined shader text in the homepath
 extern	cvar_t	*r_nocull;
 extern	cvar_t	*r_facePlaneCull;		// enables culling of planar surfaces with back side test
 extern	cvar_t	*r_nocurves;
@@ -1738,6 +2014,13 @@ extern  cvar_t  *r_ext_texture_float;
 extern  cvar_t  *r_ext_framebuffer_multisample;
 extern  cvar_t  *r_arb_seamless_cube_map;
 extern  cvar_t  *r_arb_vertex_array_object;
+extern  cvar_t  *r_arb_buffer_storage;
+extern  cvar_t  *r_arb_uniform_buffer_object;
+extern  cvar_t  *r_hizCull;
+extern  cvar_t  *r_ext_multi_draw_arrays;
+extern  cvar_t  *r_arb_multi_draw_indirect;
+extern  cvar_t  *r_arb_get_program_binary;
+extern  cvar_t  *r_arb_multi_bind;
 extern  cvar_t  *r_ext_direct_state_access;
 
 extern	cvar_t	*r_nobind;						// turns off binding to appropriate textures
@@ -1774,6 +2057,11 @@ extern	cvar_t	*r_subdivisions;
 extern	cvar_t	*r_lodCurveError;
 extern	cvar_t	*r_skipBackEnd;
 
+extern	cvar_t	*r_smp;
+extern	cvar_t	*r_showSmp;
+
+extern	volatile qboolean	renderThreadActive;
+
 extern	cvar_t	*r_anaglyphMode;
 
 extern  cvar_t  *r_externalGLSL;
@@ -1796,6 +2084,7 @@ extern  cvar_t  *r_forceAutoExposureMax;
 extern  cvar_t  *r_cameraExposure;
 
 extern  cvar_t  *r_depthPrepass;
+extern  cvar_t  *r_frontToBack;			// emit opaque world soups nearest cell first
 extern  cvar_t  *r_ssao;
 
 extern  cvar_t  *r_normalMapping;
@@ -1806,6 +2095,8 @@ extern  cvar_t  *r_parallaxMapOffset;
 extern  cvar_t  *r_parallaxMapShadows;
 extern  cvar_t  *r_cubeMapping;
 extern  cvar_t  *r_cubemapSize;
+extern  cvar_t  *r_cubemapCache;
+extern  cvar_t  *r_cubemapSidesPerFrame;
 extern  cvar_t  *r_deluxeSpecular;
 extern  cvar_t  *r_pbr;
 extern  cvar_t  *r_baseNormalX;
@@ -1815,11 +2106,16 @@ extern  cvar_t  *r_baseSpecular;
 extern  cvar_t  *r_baseGloss;
 extern  cvar_t  *r_glossType;
 extern  cvar_t  *r_dlightMode;
+extern  cvar_t  *r_dlightClusters;
 extern  cvar_t  *r_pshadowDist;
 extern  cvar_t  *r_mergeLightmaps;
 extern  cvar_t  *r_imageUpsample;
 extern  cvar_t  *r_imageUpsampleMaxSize;
 extern  cvar_t  *r_imageUpsampleType;
+extern  cvar_t  *r_streamTextures;				// mip levels world textures load without, 0 to load them whole
+extern  cvar_t  *r_streamBudget;				// MB of streamed textures before unused ones are dropped again
+extern  cvar_t  *r_streamUploads;				// streamed images reloaded per frame
+extern  cvar_t  *r_imageThreads;				// threads decoding world images during a map load
 extern  cvar_t  *r_genNormalMaps;
 extern  cvar_t  *r_forceSun;
 extern  cvar_t  *r_forceSunLightScale;
@@ -1833,6 +2129,7 @@ extern  cvar_t  *r_shadowMapSize;
 extern  cvar_t  *r_shadowCascadeZNear;
 extern  cvar_t  *r_shadowCascadeZFar;
 extern  cvar_t  *r_shadowCascadeZBias;
+extern  cvar_t  *r_shadowCascadeCache;
 extern  cvar_t  *r_ignoreDstAlpha;
 
 extern	cvar_t	*r_greyscale;
@@ -1854,6 +2151,8 @@ extern cvar_t	*r_marksOnTriangleMeshes;
 
 extern cvar_t *r_vaoCache;
 
+extern cvar_t	*r_cinematicUpload;
+
 //====================================================================
 
 static ID_INLINE qboolean ShaderRequiresCPUDeforms(const shader_t * shader)
@@ -1889,6 +2188,7 @@ void R_RenderDlightCubemaps(const refdef_t *fd);
 void R_RenderPshadowMaps(const refdef_t *fd);
 void R_RenderSunShadowMaps(const refdef_t *fd, int level);
 void R_RenderCubemapSide( int cubemapIndex, int cubemapSide, qboolean subscene );
+void R_RenderPendingCubemaps( void );
 
 void R_AddMD3Surfaces( trRefEntity_t *e );
 void R_AddNullModelSurfaces( trRefEntity_t *e );
@@ -1915,6 +2215,9 @@ qboolean R_CalcTangentVectors(srfVert_t * dv[3]);
 void R_LocalNormalToWorld (const vec3_t local, vec3_t world);
 void R_LocalPointToWorld (const vec3_t local, vec3_t world);
 int R_CullBox (vec3_t bounds[2]);
+qboolean R_HizOccluded( vec3_t bounds[2] );
+int R_StaticModelHash( qhandle_t hModel, const vec3_t origin );
+qboolean R_StaticModelEntity( const refEntity_t *ent );
 int R_CullLocalBox (vec3_t bounds[2]);
 int R_CullPointAndRadiusEx( const vec3_t origin, float radius, const cplane_t* frustum, int numPlanes );
 int R_CullPointAndRadius( const vec3_t origin, float radius );
@@ -1975,6 +2278,7 @@ void	GL_Cull( int cullType );
 
 void	RE_StretchRaw (int x, int y, int w, int h, int cols, int rows, const byte *data, int client, qboolean dirty);
 void	RE_UploadCinematic (int w, int h, int cols, int rows, const byte *data, int client, qboolean dirty);
+void	RB_ShutdownCinematicUpload( void );
 
 void		RE_BeginFrame( stereoFrame_t stereoFrame );
 void		RE_BeginRegistration( glconfig_t *glconfig );
@@ -2005,6 +2309,10 @@ float	R_FogFactor( float s, float t );
 void	R_InitImages( void );
 void	R_DeleteTextures( void );
 int		R_SumOfUsedImages( void );
+void	R_UpdateTextureStreaming( void );
+void	R_AddImagePrefetch( const char *name );
+void	R_StartImagePrefetch( void );
+void	R_FinishImagePrefetch( void );
 void	R_InitSkins( void );
 skin_t	*R_GetSkinByHandle( qhandle_t hSkin );
 
@@ -2020,6 +2328,7 @@ shader_t	*R_FindShaderEx( const char *name, int lightmapIndex, qboolean mipRawIm
 shader_t	*R_GetShaderByHandle( qhandle_t hShader );
 shader_t	*R_GetShaderByState( int index, long *cycleTime );
 shader_t *R_FindShaderByName( const char *name );
+void		R_PrefetchWorldImages( const dshader_t *shaders, int numShaders );
 void		R_InitShaders( void );
 void		R_ShaderList_f( void );
 void    R_RemapShader(const char *oldShader, const char *newShader, const char *timeOffset);
@@ -2042,6 +2351,8 @@ TESSELATOR/SHADER DECLARATIONS
 ====================================================================
 */
 
+#define MAX_MULTIDRAWS 1024
+
 typedef struct stageVars
 {
 	color4ub_t	colors[SHADER_MAX_VERTEXES];
@@ -2064,6 +2375,12 @@ typedef struct shaderCommands_s
 	vao_t       *vao;
 	qboolean    useInternalVao;
 	qboolean    useCacheVao;
+	int         streamFirstIndex;	// where RB_UpdateTessVao put the indexes in the tess IBO
+
+	// disjoint index ranges of one static world VAO, drawn in a single call
+	int         numMultiDraws;
+	int         multiDrawFirst[MAX_MULTIDRAWS];
+	GLsizei     multiDrawCount[MAX_MULTIDRAWS];
 
 	stageVars_t	svars Q_ALIGN(16);
 
@@ -2107,6 +2424,7 @@ void RB_InstantQuad( vec4_t quadVerts[4] );
 void RB_InstantQuad2(vec4_t quadVerts[4], vec2_t texCoords[4]);
 
 void RB_ShowImages( void );
+void RB_SetGL2D( void );
 
 
 /*
@@ -2119,6 +2437,7 @@ WORLD MAP
 
 void R_AddBrushModelSurfaces( trRefEntity_t *e );
 void R_AddWorldSurfaces( void );
+mnode_t *R_PointInLeaf( const vec3_t p );
 qboolean R_inPVS( const vec3_t p1, const vec3_t p2 );
 
 
@@ -2131,6 +2450,8 @@ FLARES
 */
 
 void R_ClearFlares( void );
+void R_InitFlareQueries( void );
+void R_ShutdownFlareQueries( void );
 
 void RB_AddFlare( void *surface, int fogNum, vec3_t point, vec3_t color, vec3_t normal );
 void RB_AddDlightFlares( void );
@@ -2139,6 +2460,35 @@ void RB_RenderFlares (void);
 /*
 ============================================================
 
+GPU TIMERS
+
+============================================================
+*/
+
+typedef enum {
+	GPUTIMER_FRAME,
+	GPUTIMER_SHADOWS,
+	GPUTIMER_DEPTHPREPASS,
+	GPUTIMER_WORLD,
+	GPUTIMER_ENTITIES,
+	GPUTIMER_POSTPROCESS,
+	GPUTIMER_2D,
+	GPUTIMER_COUNT
+} gpuTimer_t;
+
+void R_InitGpuTimers( void );
+void R_ShutdownGpuTimers( void );
+void R_GpuTimers_f( void );
+void R_LogGpuTimers( void );
+
+void RB_BeginGpuTimer( gpuTimer_t timer );
+void RB_EndGpuTimer( gpuTimer_t timer );
+void RB_EndGpuTimerFrame( void );
+void RB_DrawGpuTimers( void );
+
+/*
+============================================================
+
 LIGHTS
 
 ============================================================
@@ -2146,6 +2496,7 @@ LIGHTS
 
 void R_DlightBmodel( bmodel_t *bmodel );
 void R_SetupEntityLighting( const trRefdef_t *refdef, trRefEntity_t *ent );
+void R_ClearEntityLightCache( void );
 void R_TransformDlights( int count, dlight_t *dl, orientationr_t *or );
 int R_LightForPoint( vec3_t point, vec3_t ambientLight, vec3_t directedLight, vec3_t lightDir );
 int R_LightDirForPoint( vec3_t point, vec3_t lightDir, vec3_t normal, world_t *world );
@@ -2221,6 +2572,7 @@ void R_VaoUnpackNormal(vec3_t v, int16_t *pack);
 
 vao_t          *R_CreateVao(const char *name, byte *vertexes, int vertexesSize, byte *indexes, int indexesSize, vaoUsage_t usage);
 vao_t          *R_CreateVao2(const char *name, int numVertexes, srfVert_t *verts, int numIndexes, glIndex_t *inIndexes);
+void            R_CreateDepthVao(vao_t *vao, int numVertexes, srfVert_t *verts);
 
 void            R_BindVao(vao_t *vao);
 void            R_BindNullVao(void);
@@ -2232,6 +2584,11 @@ void            R_ShutdownVaos(void);
 void            R_VaoList_f(void);
 
 void            RB_UpdateTessVao(unsigned int attribBits);
+void            RB_MultiDrawElements(void);
+
+void            R_InitUniformStream(void);
+void            R_ShutdownUniformStream(void);
+void            RB_FlushUniformBlocks(void);
 
 void VaoCache_Commit(void);
 void VaoCache_DrawElements(int numIndexes, int firstIndex);
@@ -2264,6 +2621,7 @@ void GLSL_SetUniformVec3(shaderProgram_t *program, int uniformNum, const vec3_t
 void GLSL_SetUniformVec4(shaderProgram_t *program, int uniformNum, const vec4_t v);
 void GLSL_SetUniformMat4(shaderProgram_t *program, int uniformNum, const mat4_t matrix);
 void GLSL_SetUniformMat4BoneMatrix(shaderProgram_t *program, int uniformNum, /*const*/ mat4_t *matrix, int numMatricies);
+void GLSL_SetUniformVec4Dlights(shaderProgram_t *program, int uniformNum, const vec4_t *v, int numDlights);
 
 shaderProgram_t *GLSL_GetGenericShaderProgram(int stage);
 
@@ -2432,6 +2790,7 @@ typedef struct {
 	byte					*captureBuffer;
 	byte					*encodeBuffer;
 	qboolean			motionJpeg;
+	int						frameCount;
 } videoFrameCommand_t;
 
 typedef struct
@@ -2462,6 +2821,12 @@ typedef struct {
 	int commandId;
 } exportCubemapsCommand_t;
 
+typedef struct {
+	int commandId;
+	int cubemapIndex;
+	char filename[MAX_QPATH];
+} saveCubemapCommand_t;
+
 typedef enum {
 	RC_END_OF_LIST,
 	RC_SET_COLOR,
@@ -2475,7 +2840,8 @@ typedef enum {
 	RC_CLEARDEPTH,
 	RC_CAPSHADOWMAP,
 	RC_POSTPROCESS,
-	RC_EXPORT_CUBEMAPS
+	RC_EXPORT_CUBEMAPS,
+	RC_SAVE_CUBEMAP
 } renderCommand_t;
 
 
@@ -2483,7 +2849,7 @@ typedef enum {
 // the limits apply to the sum of all scenes in a frame --
 // the main view, all the 3D icons, etc
 #define	MAX_POLYS		600
-#define	MAX_POLYVERTS	4096
+#define	MAX_POLYVERTS	32768
 
 // all of the information needed by the back end must be
 // contained in a backEndData_t
@@ -2500,13 +2866,15 @@ typedef struct {
 extern	int		max_polys;
 extern	int		max_polyverts;
 
-extern	backEndData_t	*backEndData;	// the second one may not be allocated
+extern	backEndData_t	*backEndData[SMP_FRAMES];	// the second one may not be allocated
 
 
 void *R_GetCommandBuffer( int bytes );
 void RB_ExecuteRenderCommands( const void *data );
+void RB_RenderThread( void );
 
 void R_IssuePendingRenderCommands( void );
+void R_SaveCubemap( int cubemapIndex, const char *filename );
 
 void R_AddDrawSurfCmd( drawSurf_t *drawSurfs, int numDrawSurfs );
 void R_AddCapShadowmapCmd( int dlight, int cubeSide );
@@ -2515,6 +2883,7 @@ void R_AddPostProcessCmd (void);
 void RE_SetColor( const float *rgba );
 void RE_StretchPic ( float x, float y, float w, float h, 
 					  float s1, float t1, float s2, float t2, qhandle_t hShader );
+void RE_StretchPics( int numPics, const stretchPic_t *pics );
 void RE_BeginFrame( stereoFrame_t stereoFrame );
 void RE_EndFrame( int *frontEndMsec, int *backEndMsec );
 void RE_SaveJPG(char * filename, int quality, int image_width, int image_height,
@@ -254,8 +254,7 @@ int R_CullLocalBox(vec3_t localBounds[2]) {
 	return CULL_CLIP;		// partially clipped
 #else
 	int             j;
-	vec3_t          transformed;
-	vec3_t          v;
+	vec3_t          corners[8];
 	vec3_t          worldBounds[2];
 
 	if(r_nocull->integer)
@@ -264,17 +263,19 @@ int R_CullLocalBox(vec3_t localBounds[2]) {
 	}
 
 	// transform into world space
-	ClearBounds(worldBounds[0], worldBounds[1]);
-
 	for(j = 0; j < 8; j++)
 	{
-		v[0] = localBounds[j & 1][0];
-		v[1] = localBounds[(j >> 1) & 1][1];
-		v[2] = localBounds[(j >> 2) & 1][2];
+		corners[j][0] = localBounds[j & 1][0];
+		corners[j][1] = localBounds[(j >> 1) & 1][1];
+		corners[j][2] = localBounds[(j >> 2) & 1][2];
+	}
 
-		R_LocalPointToWorld(v, transformed);
+	TransformPoints((const vec3_t *)corners, corners, 8, tr.or.axis, tr.or.origin);
 
-		AddPointToBounds(transformed, worldBounds[0], worldBounds[1]);
+	ClearBounds(worldBounds[0], worldBounds[1]);
+	for(j = 0; j < 8; j++)
+	{
+		AddPointToBounds(corners[j], worldBounds[0], worldBounds[1]);
 	}
 
 	return R_CullBox(worldBounds);
@@ -289,30 +290,23 @@ Returns CULL_IN, CULL_CLIP, or CULL_OUT
 =================
 */
 int R_CullBox(vec3_t worldBounds[2]) {
-	int             i;
-	cplane_t       *frust;
 	qboolean        anyClip;
 	int             r, numPlanes;
 
 	numPlanes = (tr.viewParms.flags & VPF_FARPLANEFRUSTUM) ? 5 : 4;
 
 	// check against frustum planes
-	anyClip = qfalse;
-	for(i = 0; i < numPlanes; i++)
+	r = BoxCullPlanes(worldBounds[0], worldBounds[1], tr.viewParms.frustum, numPlanes, (1 << numPlanes) - 1);
+	if(r < 0)
 	{
-		frust = &tr.viewParms.frustum[i];
-
-		r = BoxOnPlaneSide(worldBounds[0], worldBounds[1], frust);
+		// completely outside frustum
+		return CULL_OUT;
+	}
+	anyClip = r != 0;
 
-		if(r == 2)
-		{
-			// completely outside frustum
-			return CULL_OUT;
-		}
-		if(r == 3)
-		{
-			anyClip = qtrue;
-		}
+	if(R_HizOccluded(worldBounds))
+	{
+		return CULL_OUT;
 	}
 
 	if(!anyClip)
@@ -325,6 +319,73 @@ int R_CullBox(vec3_t worldBounds[2]) {
 	return CULL_CLIP;
 }
 
+/*
+=================
+R_HizOccluded
+
+Returns qtrue if a world space box is behind the depth the last main view
+left in tr.hiz.  Anything the old depth can't vouch for, like boxes crossing
+the eye plane or the edge of the old view, counts as visible.
+=================
+*/
+qboolean R_HizOccluded( vec3_t bounds[2] ) {
+	hizBuffer_t	*hiz = &tr.hiz[tr.smpFrame];
+	vec4_t		corner, clip;
+	vec3_t		mins, maxs, delta;
+	int			i, x, y, x0, y0, x1, y1;
+	float		depth;
+
+	if ( !hiz->valid || !r_hizCull->integer || r_nocull->integer ) {
+		return qfalse;
+	}
+
+	if ( tr.viewParms.isPortal || ( tr.viewParms.flags & ( VPF_SHADOWMAP | VPF_DEPTHSHADOW | VPF_ORTHOGRAPHIC ) )
+		|| ( tr.refdef.rdflags & RDF_NOWORLDMODEL ) || ( tr.renderCubeFbo && tr.viewParms.targetFbo == tr.renderCubeFbo ) ) {
+		return qfalse;
+	}
+
+	VectorSubtract( tr.viewParms.or.origin, hiz->origin, delta );
+	if ( DotProduct( delta, delta ) > HIZ_MAX_MOVE * HIZ_MAX_MOVE ) {
+		return qfalse;
+	}
+
+	ClearBounds( mins, maxs );
+	for ( i = 0; i < 8; i++ ) {
+		VectorSet4( corner, bounds[i & 1][0], bounds[( i >> 1 ) & 1][1], bounds[( i >> 2 ) & 1][2], 1.0f );
+		Mat4Transform( hiz->viewProjection, corner, clip );
+
+		if ( clip[3] <= 0.0f ) {
+			return qfalse;
+		}
+
+		VectorScale( clip, 1.0f / clip[3], clip );
+		AddPointToBounds( clip, mins, maxs );
+	}
+
+	if ( mins[0] < -1.0f || mins[1] < -1.0f || maxs[0] > 1.0f || maxs[1] > 1.0f ) {
+		return qfalse;
+	}
+
+	x0 = ( mins[0] * 0.5f + 0.5f ) * HIZ_WIDTH;
+	y0 = ( mins[1] * 0.5f + 0.5f ) * HIZ_HEIGHT;
+	x1 = MIN( ( maxs[0] * 0.5f + 0.5f ) * HIZ_WIDTH,  HIZ_WIDTH  - 1 );
+	y1 = MIN( ( maxs[1] * 0.5f + 0.5f ) * HIZ_HEIGHT, HIZ_HEIGHT - 1 );
+
+	depth = mins[2] * 0.5f + 0.5f;
+
+	for ( y = y0; y <= y1; y++ ) {
+		for ( x = x0; x <= x1; x++ ) {
+			if ( depth <= hiz->depth[y][x] ) {
+				return qfalse;
+			}
+		}
+	}
+
+	tr.pc.c_hiz_out++;
+
+	return qtrue;
+}
+
 /*
 ** R_CullLocalPointAndRadius
 */
@@ -1403,50 +1464,68 @@ DRAWSURF SORTING
 R_Radix
 ===============
 */
-static ID_INLINE void R_Radix( int offset, int size, drawSurf_t *source, drawSurf_t *dest )
+static ID_INLINE void R_Radix( int shift, const int *count, int size, drawSurf_t *source, drawSurf_t *dest )
 {
-  int           count[ 256 ] = { 0 };
   int           index[ 256 ];
   int           i;
-  unsigned char *sortKey = NULL;
-  unsigned char *end = NULL;
-
-  sortKey = ( (unsigned char *)&source[ 0 ].sort ) + offset;
-  end = sortKey + ( size * sizeof( drawSurf_t ) );
-  for( ; sortKey < end; sortKey += sizeof( drawSurf_t ) )
-    ++count[ *sortKey ];
 
   index[ 0 ] = 0;
 
   for( i = 1; i < 256; ++i )
     index[ i ] = index[ i - 1 ] + count[ i - 1 ];
 
-  sortKey = ( (unsigned char *)&source[ 0 ].sort ) + offset;
-  for( i = 0; i < size; ++i, sortKey += sizeof( drawSurf_t ) )
-    dest[ index[ *sortKey ]++ ] = source[ i ];
+  for( i = 0; i < size; ++i )
+    dest[ index[ ( source[ i ].sort >> shift ) & 255 ]++ ] = source[ i ];
 }
 
 /*
 ===============
 R_RadixSort
 
-Radix sort with 4 byte size buckets
+Radix sort with 4 byte size buckets.  All four histograms are gathered in
+a single pass over the keys, and a byte that is the same in every key (the
+entity number for world surfaces, the fog and shadow bits for most views)
+doesn't get a pass of its own.  Input that is already in order, such as
+a world added in shader order, is left alone.
 ===============
 */
 static void R_RadixSort( drawSurf_t *source, int size )
 {
   static drawSurf_t scratch[ MAX_DRAWSURFS ];
-#ifdef Q3_LITTLE_ENDIAN
-  R_Radix( 0, size, source, scratch );
-  R_Radix( 1, size, scratch, source );
-  R_Radix( 2, size, source, scratch );
-  R_Radix( 3, size, scratch, source );
-#else
-  R_Radix( 3, size, source, scratch );
-  R_Radix( 2, size, scratch, source );
-  R_Radix( 1, size, source, scratch );
-  R_Radix( 0, size, scratch, source );
-#endif //Q3_LITTLE_ENDIAN
+  static int        count[ 4 ][ 256 ];
+  drawSurf_t        *from = source, *to = scratch, *swap;
+  qboolean          sorted = qtrue;
+  unsigned int      key, last = 0;
+  int               i, pass;
+
+  Com_Memset( count, 0, sizeof( count ) );
+
+  for( i = 0; i < size; ++i )
+  {
+    key = source[ i ].sort;
+    ++count[ 0 ][ key & 255 ];
+    ++count[ 1 ][ ( key >> 8 ) & 255 ];
+    ++count[ 2 ][ ( key >> 16 ) & 255 ];
+    ++count[ 3 ][ key >> 24 ];
+    if( key < last )
+      sorted = qfalse;
+    last = key;
+  }
+
+  if( sorted )
+    return;
+
+  for( pass = 0; pass < 4; ++pass )
+  {
+    if( count[ pass ][ ( source[ 0 ].sort >> ( pass * 8 ) ) & 255 ] == size )
+      continue;
+
+    R_Radix( pass * 8, count[ pass ], size, from, to );
+    swap = from; from = to; to = swap;
+  }
+
+  if( from != source )
+    Com_Memcpy( source, from, size * sizeof( drawSurf_t ) );
 }
 
 //==========================================================================================
@@ -1744,6 +1823,8 @@ void R_RenderView (viewParms_t *parms) {
 		return;
 	}
 
+	ri.ProfileBegin( "R_RenderView" );
+
 	tr.viewCount++;
 
 	tr.viewParms = *parms;
@@ -1773,6 +1854,8 @@ void R_RenderView (viewParms_t *parms) {
 
 	// draw main system development information (surface outlines, etc)
 	R_DebugGraphics();
+
+	ri.ProfileEnd();
 }
 
 
@@ -2199,6 +2282,130 @@ static float CalcSplit(float n, float f, float i, float m)
 	return (n * pow(f / n, i / m) + (f - n) * i / m) / 2.0f;
 }
 
+/*
+=================
+R_SunShadowCacheBounds
+
+Fits a texel snapped square around the bounding sphere of a cascade's view
+slice, deep enough for the whole world.  The square is reused for as long
+as the sphere stays inside it and the sun doesn't move, so the static world
+depth cached for it stays valid.  Returns qtrue if the static world has to
+be drawn again.
+=================
+*/
+#define SUNSHADOW_CACHE_MARGIN 1.5f
+
+static qboolean R_SunShadowCacheBounds(const refdef_t *fd, int level, const vec4_t lightDir, mat4_t lightViewMatrix, float splitZNear, float splitZFar, vec3_t lightviewBounds[2])
+{
+	vec4_t point, center, lightViewPoint;
+	vec3_t corner;
+	float lx, ly, radius, size, worldUnitsPerTexel;
+	mnode_t *root;
+	int i;
+
+	// bounding sphere of the view slice, the far corners are always the furthest
+	VectorMA(fd->vieworg, (splitZNear + splitZFar) * 0.5f, fd->viewaxis[0], point);
+	point[3] = 1;
+
+	lx = splitZFar * tan(fd->fov_x * M_PI / 360.0f);
+	ly = splitZFar * tan(fd->fov_y * M_PI / 360.0f);
+	VectorMA(fd->vieworg, splitZFar, fd->viewaxis[0], corner);
+	VectorMA(corner, lx, fd->viewaxis[1], corner);
+	VectorMA(corner, ly, fd->viewaxis[2], corner);
+	radius = Distance(point, corner);
+
+	Mat4Transform(lightViewMatrix, point, center);
+
+	if (tr.sunShadowCache[level].valid && r_forceSun->integer != 2
+		&& VectorCompare(lightDir, tr.sunShadowCache[level].sunDir)
+		&& center[1] - radius >= tr.sunShadowCache[level].bounds[0][1]
+		&& center[1] + radius <= tr.sunShadowCache[level].bounds[1][1]
+		&& center[2] - radius >= tr.sunShadowCache[level].bounds[0][2]
+		&& center[2] + radius <= tr.sunShadowCache[level].bounds[1][2])
+	{
+		VectorCopy(tr.sunShadowCache[level].bounds[0], lightviewBounds[0]);
+		VectorCopy(tr.sunShadowCache[level].bounds[1], lightviewBounds[1]);
+		return qfalse;
+	}
+
+	// leave some room to move before the next redraw, and keep
+	// the square on texel boundaries so static edges don't swim
+	size = 2.0f * radius * SUNSHADOW_CACHE_MARGIN;
+	worldUnitsPerTexel = size / tr.sunShadowFbo[level]->width;
+
+	for (i = 1; i < 3; i++)
+	{
+		float mid = floor(center[i] / worldUnitsPerTexel) * worldUnitsPerTexel;
+
+		lightviewBounds[0][i] = mid - size * 0.5f;
+		lightviewBounds[1][i] = mid + size * 0.5f;
+	}
+
+	// depth covers every world caster, not just the ones near this slice
+	root = tr.world->nodes;
+	lightviewBounds[0][0] = center[0] - radius;
+	lightviewBounds[1][0] = center[0] + radius;
+	lightViewPoint[3] = 1;
+	point[3] = 1;
+
+	for (i = 0; i < 8; i++)
+	{
+		point[0] = (i & 1) ? root->maxs[0] : root->mins[0];
+		point[1] = (i & 2) ? root->maxs[1] : root->mins[1];
+		point[2] = (i & 4) ? root->maxs[2] : root->mins[2];
+		Mat4Transform(lightViewMatrix, point, lightViewPoint);
+
+		lightviewBounds[0][0] = MIN(lightviewBounds[0][0], lightViewPoint[0]);
+		lightviewBounds[1][0] = MAX(lightviewBounds[1][0], lightViewPoint[0]);
+	}
+
+	tr.sunShadowCache[level].valid = qtrue;
+	VectorCopy(lightDir, tr.sunShadowCache[level].sunDir);
+	VectorCopy(lightviewBounds[0], tr.sunShadowCache[level].bounds[0]);
+	VectorCopy(lightviewBounds[1], tr.sunShadowCache[level].bounds[1]);
+
+	return qtrue;
+}
+
+/*
+=================
+R_AddSunShadowView
+
+Queues one view into a sun shadow cascade.
+=================
+*/
+static void R_AddSunShadowView(const viewParms_t *shadowParms, vec3_t lightviewBounds[2], qboolean addWorld, qboolean addEntities)
+{
+	int firstDrawSurf;
+
+	tr.viewCount++;
+
+	tr.viewParms = *shadowParms;
+	tr.viewParms.frameSceneNum = tr.frameSceneNum;
+	tr.viewParms.frameCount = tr.frameCount;
+
+	firstDrawSurf = tr.refdef.numDrawSurfs;
+
+	tr.viewCount++;
+
+	// set viewParms.world
+	R_RotateForViewer ();
+
+	R_SetupProjectionOrtho(&tr.viewParms, lightviewBounds);
+
+	if (addWorld)
+		R_AddWorldSurfaces ();
+
+	if (addEntities)
+	{
+		R_AddPolygonSurfaces();
+
+		R_AddEntitySurfaces ();
+	}
+
+	R_SortDrawSurfs( tr.refdef.drawSurfs + firstDrawSurf, tr.refdef.numDrawSurfs - firstDrawSurf );
+}
+
 
 void R_RenderSunShadowMaps(const refdef_t *fd, int level)
 {
@@ -2210,6 +2417,8 @@ void R_RenderSunShadowMaps(const refdef_t *fd, int level)
 	float viewZNear, viewZFar;
 	vec3_t lightviewBounds[2];
 	qboolean lightViewIndependentOfCameraView = qfalse;
+	qboolean cached = (level != 3 && tr.sunShadowCacheFbo[level] != NULL);
+	qboolean drawStatic = qtrue;
 
 	if (r_forceSun->integer == 2)
 	{
@@ -2271,7 +2480,8 @@ void R_RenderSunShadowMaps(const refdef_t *fd, int level)
 			break;
 	}
 	
-	if (level != 3)
+	// cached cascades need a light view that doesn't follow the camera
+	if (level != 3 && !cached)
 		VectorCopy(fd->vieworg, lightOrigin);
 	else
 		VectorCopy(tr.world->lightGridOrigin, lightOrigin);
@@ -2279,7 +2489,7 @@ void R_RenderSunShadowMaps(const refdef_t *fd, int level)
 	// Make up a projection
 	VectorScale(lightDir, -1.0f, lightViewAxis[0]);
 
-	if (level == 3 || lightViewIndependentOfCameraView)
+	if (level == 3 || lightViewIndependentOfCameraView || cached)
 	{
 		// Use world up as light view up
 		VectorSet(lightViewAxis[2], 0, 0, 1);
@@ -2299,7 +2509,7 @@ void R_RenderSunShadowMaps(const refdef_t *fd, int level)
 	// Check if too close to parallel to light direction
 	if (fabsf(DotProduct(lightViewAxis[2], lightViewAxis[0])) > 0.9f)
 	{
-		if (level == 3 || lightViewIndependentOfCameraView)
+		if (level == 3 || lightViewIndependentOfCameraView || cached)
 		{
 			// Use world left as light view up
 			VectorSet(lightViewAxis[2], 0, 1, 0);
@@ -2336,7 +2546,11 @@ void R_RenderSunShadowMaps(const refdef_t *fd, int level)
 
 		ClearBounds(lightviewBounds[0], lightviewBounds[1]);
 
-		if (level != 3)
+		if (cached)
+		{
+			drawStatic = R_SunShadowCacheBounds(fd, level, lightDir, lightViewMatrix, splitZNear, splitZFar, lightviewBounds);
+		}
+		else if (level != 3)
 		{
 			// add view near plane
 			lx = splitZNear * tan(fd->fov_x * M_PI / 360.0f);
@@ -2481,8 +2695,6 @@ void R_RenderSunShadowMaps(const refdef_t *fd, int level)
 	}
 
 	{
-		int firstDrawSurf;
-
 		Com_Memset( &shadowParms, 0, sizeof( shadowParms ) );
 
 		if (glRefConfig.framebufferObject)
@@ -2517,29 +2729,25 @@ void R_RenderSunShadowMaps(const refdef_t *fd, int level)
 
 		VectorCopy(lightOrigin, shadowParms.pvsOrigin );
 
+		if (cached)
 		{
-			tr.viewCount++;
-
-			tr.viewParms = shadowParms;
-			tr.viewParms.frameSceneNum = tr.frameSceneNum;
-			tr.viewParms.frameCount = tr.frameCount;
-
-			firstDrawSurf = tr.refdef.numDrawSurfs;
-
-			tr.viewCount++;
-
-			// set viewParms.world
-			R_RotateForViewer ();
-
-			R_SetupProjectionOrtho(&tr.viewParms, lightviewBounds);
-
-			R_AddWorldSurfaces ();
-
-			R_AddPolygonSurfaces();
+			// static world into the cache when it moved, then
+			// entities on top of a copy of it every frame
+			if (drawStatic)
+			{
+				viewParms_t staticParms = shadowParms;
 
-			R_AddEntitySurfaces ();
+				staticParms.targetFbo = tr.sunShadowCacheFbo[level];
+				R_AddSunShadowView(&staticParms, lightviewBounds, qtrue, qfalse);
+			}
 
-			R_SortDrawSurfs( tr.refdef.drawSurfs + firstDrawSurf, tr.refdef.numDrawSurfs - firstDrawSurf );
+			shadowParms.flags |= VPF_RESTOREDEPTH;
+			shadowParms.depthCacheFbo = tr.sunShadowCacheFbo[level];
+			R_AddSunShadowView(&shadowParms, lightviewBounds, qfalse, qtrue);
+		}
+		else
+		{
+			R_AddSunShadowView(&shadowParms, lightviewBounds, qtrue, qtrue);
 		}
 
 		Mat4Multiply(tr.viewParms.projectionMatrix, tr.viewParms.world.modelMatrix, tr.refdef.sunShadowMvp[level]);
@@ -190,10 +190,43 @@ void R_BoxSurfaces_r(mnode_t *node, vec3_t mins, vec3_t maxs, surfaceType_t **li
 	}
 }
 
+/*
+=================
+R_PolyOutsideBounds
+
+Returns qtrue if every point is beyond the same side of the bounds
+=================
+*/
+static qboolean R_PolyOutsideBounds( int numPoints, vec3_t *points, const vec3_t mins, const vec3_t maxs ) {
+	int		i, j;
+
+	for ( j = 0 ; j < 3 ; j++ ) {
+		for ( i = 0 ; i < numPoints ; i++ ) {
+			if ( points[i][j] >= mins[j] ) {
+				break;
+			}
+		}
+		if ( i == numPoints ) {
+			return qtrue;
+		}
+		for ( i = 0 ; i < numPoints ; i++ ) {
+			if ( points[i][j] <= maxs[j] ) {
+				break;
+			}
+		}
+		if ( i == numPoints ) {
+			return qtrue;
+		}
+	}
+	return qfalse;
+}
+
 /*
 =================
 R_AddMarkFragments
 
+mins and maxs bound the clip volume, polys outside of them are
+rejected without chopping
 =================
 */
 void R_AddMarkFragments(int numClipPoints, vec3_t clipPoints[2][MAX_VERTS_ON_POLY],
@@ -205,6 +238,10 @@ void R_AddMarkFragments(int numClipPoints, vec3_t clipPoints[2][MAX_VERTS_ON_POL
 	int pingPong, i;
 	markFragment_t	*mf;
 
+	if ( R_PolyOutsideBounds( numClipPoints, clipPoints[0], mins, maxs ) ) {
+		return;
+	}
+
 	// chop the surface by all the bounding planes of the to be projected polygon
 	pingPong = 0;
 
@@ -261,6 +298,8 @@ int R_MarkFragments( int numPoints, const vec3_t *points, const vec3_t projectio
 	int				i, j, k, m, n;
 	surfaceType_t	*surfaces[64];
 	vec3_t			mins, maxs;
+	vec3_t			clipMins, clipMaxs;
+	float			d;
 	int				returnedFragments;
 	int				returnedPoints;
 	vec3_t			normals[MAX_VERTS_ON_POLY+2];
@@ -315,6 +354,23 @@ int R_MarkFragments( int numPoints, const vec3_t *points, const vec3_t projectio
 	dists[numPoints+1] = DotProduct(normals[numPoints+1], points[0]) - 20;
 	numPlanes = numPoints + 2;
 
+	// bound the volume between the side, near and far planes, with
+	// room for the chopping epsilon
+	ClearBounds( clipMins, clipMaxs );
+	for ( i = 0 ; i < numPoints ; i++ ) {
+		vec3_t	temp;
+
+		d = DotProduct( projectionDir, points[0] ) - DotProduct( projectionDir, points[i] );
+		VectorMA( points[i], d - 32, projectionDir, temp );
+		AddPointToBounds( temp, clipMins, clipMaxs );
+		VectorMA( points[i], d + 20, projectionDir, temp );
+		AddPointToBounds( temp, clipMins, clipMaxs );
+	}
+	for ( i = 0 ; i < 3 ; i++ ) {
+		clipMins[i] -= 2;
+		clipMaxs[i] += 2;
+	}
+
 	numsurfaces = 0;
 	R_BoxSurfaces_r(tr.world->nodes, mins, maxs, surfaces, 64, &numsurfaces, projectionDir);
 	//assert(numsurfaces <= 64);
@@ -376,7 +432,7 @@ int R_MarkFragments( int numPoints, const vec3_t *points, const vec3_t projectio
 										   numPlanes, normals, dists,
 										   maxPoints, pointBuffer,
 										   maxFragments, fragmentBuffer,
-										   &returnedPoints, &returnedFragments, mins, maxs);
+										   &returnedPoints, &returnedFragments, clipMins, clipMaxs);
 
 						if ( returnedFragments == maxFragments ) {
 							return returnedFragments;	// not enough space for more fragments
@@ -403,7 +459,7 @@ int R_MarkFragments( int numPoints, const vec3_t *points, const vec3_t projectio
 										   numPlanes, normals, dists,
 										   maxPoints, pointBuffer,
 										   maxFragments, fragmentBuffer,
-										   &returnedPoints, &returnedFragments, mins, maxs);
+										   &returnedPoints, &returnedFragments, clipMins, clipMaxs);
 
 						if ( returnedFragments == maxFragments ) {
 							return returnedFragments;	// not enough space for more fragments
@@ -434,7 +490,7 @@ int R_MarkFragments( int numPoints, const vec3_t *points, const vec3_t projectio
 								   numPlanes, normals, dists,
 								   maxPoints, pointBuffer,
 								   maxFragments, fragmentBuffer,
-								   &returnedPoints, &returnedFragments, mins, maxs);
+								   &returnedPoints, &returnedFragments, clipMins, clipMaxs);
 				if ( returnedFragments == maxFragments ) {
 					return returnedFragments;	// not enough space for more fragments
 				}
@@ -458,7 +514,7 @@ int R_MarkFragments( int numPoints, const vec3_t *points, const vec3_t projectio
 				R_AddMarkFragments(3, clipPoints,
 								   numPlanes, normals, dists,
 								   maxPoints, pointBuffer,
-								   maxFragments, fragmentBuffer, &returnedPoints, &returnedFragments, mins, maxs);
+								   maxFragments, fragmentBuffer, &returnedPoints, &returnedFragments, clipMins, clipMaxs);
 				if(returnedFragments == maxFragments)
 				{
 					return returnedFragments;	// not enough space for more fragments
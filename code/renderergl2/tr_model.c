@@ -189,6 +189,8 @@ typedef struct
 	qhandle_t (*ModelLoader)( const char *, model_t * );
 } modelExtToLoaderMap_t;
 
+#define XMODEL_VERSION_COD1		20
+
 // Note that the ordering indicates the order of preference used
 // when there are multiple models of different formats available
 static modelExtToLoaderMap_t modelLoaders[ ] =
@@ -238,6 +240,34 @@ model_t *R_AllocModel( void ) {
 	return mod;
 }
 
+/*
+====================
+R_WarnXModel
+
+CoD1 xmodels are extensionless files starting with a 16 bit version, 20
+for CoD1.  None of the loaders read them, so say why the model is missing
+instead of leaving a silent default model.
+====================
+*/
+static void R_WarnXModel( const char *name ) {
+	union {
+		byte *b;
+		void *v;
+	} buf;
+	int		len;
+
+	len = ri.FS_ReadFile( name, &buf.v );
+	if ( !buf.v ) {
+		return;
+	}
+
+	if ( len >= 2 && ( buf.b[0] | ( buf.b[1] << 8 ) ) == XMODEL_VERSION_COD1 ) {
+		ri.Printf( PRINT_WARNING, "RE_RegisterModel: %s is a CoD1 xmodel, convert it to IQM or MD3\n", name );
+	}
+
+	ri.FS_FreeFile( buf.v );
+}
+
 /*
 ====================
 RE_RegisterModel
@@ -362,9 +392,163 @@ qhandle_t RE_RegisterModel( const char *name ) {
 		}
 	}
 
+	if ( !hModel && !*COM_GetExtension( name ) ) {
+		R_WarnXModel( name );
+	}
+
 	return hModel;
 }
 
+/*
+=================
+R_ClusterMD3Surface
+
+Snaps the frame 0 vertexes of surf to a grid of cellSize and keeps the
+triangles whose corners land in three different cells, with each corner
+moved to the first vertex seen in its cell.  Only the indexes change, so
+every frame still animates.  Returns the number of indexes written to out.
+=================
+*/
+static int R_ClusterMD3Surface(const mdvSurface_t *surf, const vec3_t mins, float cellSize, glIndex_t *out)
+{
+	int             *cellKeys, *cellVerts, *rep;
+	int             hashSize, numIndexes, i, j;
+
+	hashSize = 1;
+	while (hashSize < surf->numVerts * 2)
+		hashSize <<= 1;
+
+	cellKeys = ri.Malloc(sizeof(*cellKeys) * hashSize * 3);
+	cellVerts = ri.Malloc(sizeof(*cellVerts) * hashSize);
+	rep = ri.Malloc(sizeof(*rep) * surf->numVerts);
+
+	for (i = 0; i < hashSize; i++)
+		cellVerts[i] = -1;
+
+	for (i = 0; i < surf->numVerts; i++)
+	{
+		int key[3];
+		unsigned h;
+
+		for (j = 0; j < 3; j++)
+			key[j] = (int)floor((surf->verts[i].xyz[j] - mins[j]) / cellSize);
+
+		h = ((unsigned)key[0] * 73856093u ^ (unsigned)key[1] * 19349663u ^ (unsigned)key[2] * 83492791u) & (hashSize - 1);
+		while (cellVerts[h] >= 0 && (cellKeys[h * 3 + 0] != key[0] || cellKeys[h * 3 + 1] != key[1] || cellKeys[h * 3 + 2] != key[2]))
+			h = (h + 1) & (hashSize - 1);
+
+		if (cellVerts[h] < 0)
+		{
+			cellVerts[h] = i;
+			cellKeys[h * 3 + 0] = key[0];
+			cellKeys[h * 3 + 1] = key[1];
+			cellKeys[h * 3 + 2] = key[2];
+		}
+
+		rep[i] = cellVerts[h];
+	}
+
+	numIndexes = 0;
+	for (i = 0; i < surf->numIndexes; i += 3)
+	{
+		int a = rep[surf->indexes[i + 0]];
+		int b = rep[surf->indexes[i + 1]];
+		int c = rep[surf->indexes[i + 2]];
+
+		if (a == b || b == c || a == c)
+			continue;
+
+		out[numIndexes++] = a;
+		out[numIndexes++] = b;
+		out[numIndexes++] = c;
+	}
+
+	ri.Free(rep);
+	ri.Free(cellVerts);
+	ri.Free(cellKeys);
+
+	return numIndexes;
+}
+
+/*
+=================
+R_GenerateMD3Lods
+
+Fills the lod slots of an MD3 that ships without _1/_2 files with vertex
+clustered copies, r_autoLods of them at most.  A copy shares everything
+with lod 0 but its surfaces and their indexes.  Stops at the first level
+that doesn't drop at least a quarter of the triangles left.  Returns the
+number of lods added.
+=================
+*/
+static int R_GenerateMD3Lods(model_t *mod, mdvModel_t *mdvModel)
+{
+	// grid cells across the model for each generated lod
+	static const float cellsAcross[MD3_MAX_LODS] = { 0, 24, 8 };
+	glIndex_t       **lodIndexes;
+	int             *lodNumIndexes;
+	float           cellSize;
+	int             lod, i, total, prevTotal;
+
+	if (r_autoLods->integer <= 0 || !mdvModel->numSurfaces)
+		return 0;
+
+	cellSize = RadiusFromBounds(mdvModel->frames[0].bounds[0], mdvModel->frames[0].bounds[1]) * 2.0f;
+	if (cellSize <= 0)
+		return 0;
+
+	lodIndexes = ri.Malloc(sizeof(*lodIndexes) * mdvModel->numSurfaces);
+	lodNumIndexes = ri.Malloc(sizeof(*lodNumIndexes) * mdvModel->numSurfaces);
+
+	prevTotal = 0;
+	for (i = 0; i < mdvModel->numSurfaces; i++)
+		prevTotal += mdvModel->surfaces[i].numIndexes;
+
+	for (lod = 1; lod <= r_autoLods->integer && lod < MD3_MAX_LODS; lod++)
+	{
+		mdvModel_t *lodModel;
+
+		total = 0;
+		for (i = 0; i < mdvModel->numSurfaces; i++)
+		{
+			lodIndexes[i] = ri.Malloc(sizeof(glIndex_t) * MAX(mdvModel->surfaces[i].numIndexes, 1));
+			lodNumIndexes[i] = R_ClusterMD3Surface(&mdvModel->surfaces[i], mdvModel->frames[0].bounds[0],
+				cellSize / cellsAcross[lod], lodIndexes[i]);
+			total += lodNumIndexes[i];
+		}
+
+		if (total > prevTotal * 3 / 4)
+		{
+			for (i = 0; i < mdvModel->numSurfaces; i++)
+				ri.Free(lodIndexes[i]);
+			break;
+		}
+
+		lodModel = mod->mdv[lod] = ri.Hunk_Alloc(sizeof(*lodModel), h_low);
+		*lodModel = *mdvModel;
+		lodModel->surfaces = ri.Hunk_Alloc(sizeof(*lodModel->surfaces) * mdvModel->numSurfaces, h_low);
+
+		for (i = 0; i < mdvModel->numSurfaces; i++)
+		{
+			mdvSurface_t *surf = &lodModel->surfaces[i];
+
+			*surf = mdvModel->surfaces[i];
+			surf->model = lodModel;
+			surf->numIndexes = lodNumIndexes[i];
+			surf->indexes = ri.Hunk_Alloc(sizeof(*surf->indexes) * MAX(lodNumIndexes[i], 1), h_low);
+			Com_Memcpy(surf->indexes, lodIndexes[i], sizeof(*surf->indexes) * lodNumIndexes[i]);
+			ri.Free(lodIndexes[i]);
+		}
+
+		prevTotal = total;
+	}
+
+	ri.Free(lodNumIndexes);
+	ri.Free(lodIndexes);
+
+	return lod - 1;
+}
+
 /*
 =================
 R_LoadMD3
@@ -373,6 +557,7 @@ R_LoadMD3
 static qboolean R_LoadMD3(model_t * mod, int lod, void *buffer, int bufferSize, const char *modName)
 {
 	int             f, i, j;
+	int             numAutoLods;
 
 	md3Header_t    *md3Model;
 	md3Frame_t     *md3Frame;
@@ -664,10 +849,21 @@ static qboolean R_LoadMD3(model_t * mod, int lod, void *buffer, int bufferSize,
 		surf++;
 	}
 
+	// models that ship a single lod get coarser ones generated
+	numAutoLods = 0;
+	if (lod == 0 && !mod->numLods)
+		numAutoLods = R_GenerateMD3Lods(mod, mdvModel);
+
 	if (mdvModel->numFrames > 1 && !glRefConfig.gpuVertexAnimation)
 	{
 		mdvModel->numVaoSurfaces = 0;
 		mdvModel->vaoSurfaces = NULL;
+
+		for (i = 1; i <= numAutoLods; i++)
+		{
+			mod->mdv[i]->numVaoSurfaces = 0;
+			mod->mdv[i]->vaoSurfaces = NULL;
+		}
 	}
 	else
 	{
@@ -676,6 +872,12 @@ static qboolean R_LoadMD3(model_t * mod, int lod, void *buffer, int bufferSize,
 		mdvModel->numVaoSurfaces = mdvModel->numSurfaces;
 		mdvModel->vaoSurfaces = ri.Hunk_Alloc(sizeof(*mdvModel->vaoSurfaces) * mdvModel->numSurfaces, h_low);
 
+		for (i = 1; i <= numAutoLods; i++)
+		{
+			mod->mdv[i]->numVaoSurfaces = mdvModel->numSurfaces;
+			mod->mdv[i]->vaoSurfaces = ri.Hunk_Alloc(sizeof(*mdvModel->vaoSurfaces) * mdvModel->numSurfaces, h_low);
+		}
+
 		vaoSurf = mdvModel->vaoSurfaces;
 		surf = mdvModel->surfaces;
 		for (i = 0; i < mdvModel->numSurfaces; i++, vaoSurf++, surf++)
@@ -684,6 +886,8 @@ static qboolean R_LoadMD3(model_t * mod, int lod, void *buffer, int bufferSize,
 			uint32_t stride_xyz, stride_st, stride_normal, stride_tangent;
 			uint32_t dataSize, dataOfs;
 			uint8_t *data;
+			glIndex_t *indexes;
+			int numIndexes;
 
 			if (mdvModel->numFrames > 1)
 			{
@@ -770,7 +974,31 @@ static qboolean R_LoadMD3(model_t * mod, int lod, void *buffer, int bufferSize,
 			vaoSurf->numIndexes = surf->numIndexes;
 			vaoSurf->numVerts = surf->numVerts;
 			
-			vaoSurf->vao = R_CreateVao(va("staticMD3Mesh_VAO '%s'", surf->name), data, dataSize, (byte *)surf->indexes, surf->numIndexes * sizeof(*surf->indexes), VAO_USAGE_STATIC);
+			// generated lods keep their indexes after those of lod 0
+			indexes = surf->indexes;
+			numIndexes = surf->numIndexes;
+			if (numAutoLods)
+			{
+				for (f = 1; f <= numAutoLods; f++)
+					numIndexes += mod->mdv[f]->surfaces[i].numIndexes;
+
+				indexes = ri.Malloc(sizeof(*indexes) * numIndexes);
+				Com_Memcpy(indexes, surf->indexes, sizeof(*indexes) * surf->numIndexes);
+				numIndexes = surf->numIndexes;
+
+				for (f = 1; f <= numAutoLods; f++)
+				{
+					mdvSurface_t *lodSurf = &mod->mdv[f]->surfaces[i];
+
+					Com_Memcpy(indexes + numIndexes, lodSurf->indexes, sizeof(*indexes) * lodSurf->numIndexes);
+					numIndexes += lodSurf->numIndexes;
+				}
+			}
+
+			vaoSurf->vao = R_CreateVao(va("staticMD3Mesh_VAO '%s'", surf->name), data, dataSize, (byte *)indexes, numIndexes * sizeof(*indexes), VAO_USAGE_STATIC);
+
+			if (indexes != surf->indexes)
+				ri.Free(indexes);
 
 			vaoSurf->vao->attribs[ATTR_INDEX_POSITION].enabled = 1;
 			vaoSurf->vao->attribs[ATTR_INDEX_TEXCOORD].enabled = 1;
@@ -813,10 +1041,25 @@ static qboolean R_LoadMD3(model_t * mod, int lod, void *buffer, int bufferSize,
 
 			Vao_SetVertexPointers(vaoSurf->vao);
 
+			numIndexes = surf->numIndexes;
+			for (f = 1; f <= numAutoLods; f++)
+			{
+				srfVaoMdvMesh_t *lodVaoSurf = &mod->mdv[f]->vaoSurfaces[i];
+
+				*lodVaoSurf = *vaoSurf;
+				lodVaoSurf->mdvModel = mod->mdv[f];
+				lodVaoSurf->mdvSurface = &mod->mdv[f]->surfaces[i];
+				lodVaoSurf->numIndexes = lodVaoSurf->mdvSurface->numIndexes;
+				lodVaoSurf->firstIndex = numIndexes;
+				numIndexes += lodVaoSurf->numIndexes;
+			}
+
 			ri.Free(data);
 		}
 	}
 
+	mod->numLods += numAutoLods;
+
 	return qtrue;
 }
 
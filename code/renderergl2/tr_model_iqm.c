@@ -161,6 +161,29 @@ static vec_t QuatNormalize2( const quat_t v, quat_t out) {
 	return length;
 }
 
+// pose matrices, see RB_IQMPoseMats.  Used by the back end, and only
+// cleared while registration has it idle
+#define POSE_CACHE_SIZE		16
+
+typedef struct {
+	const iqmData_t	*data;
+	int				frame, oldframe;
+	float			backlerp;
+	float			poseMats[IQM_MAX_JOINTS * 12];
+} poseCache_t;
+
+static poseCache_t	poseCache[POSE_CACHE_SIZE];
+static poseCache_t	*boneMatrixPose;	// what glState.boneMatrix holds
+
+static void R_ClearIQMPoseCache( void ) {
+	int i;
+
+	for ( i = 0; i < POSE_CACHE_SIZE; i++ ) {
+		poseCache[i].data = NULL;
+	}
+	boneMatrixPose = NULL;
+}
+
 /*
 =================
 R_LoadIQM
@@ -614,6 +637,9 @@ qboolean R_LoadIQM( model_t *mod, void *buffer, int filesize, const char *mod_na
 		size += 6 * sizeof(float);							// model bounds
 	}
 
+	// the hunk may hand a cached model's address to this one
+	R_ClearIQMPoseCache();
+
 	mod->type = MOD_IQM;
 	iqmData = (iqmData_t *)ri.Hunk_Alloc( size, h_low );
 	mod->modelData = iqmData;
@@ -1398,6 +1424,40 @@ static void ComputePoseMats( iqmData_t *data, int frame, int oldframe,
 	}
 }
 
+/*
+=================
+RB_IQMPoseMats
+
+The pose matrices depend only on the model, the two frames and the lerp,
+so a few of them are kept around: every surface of a model, and every
+pass over it, shares one ComputePoseMats call per frame.
+=================
+*/
+static poseCache_t *RB_IQMPoseMats( iqmData_t *data, int frame, int oldframe, float backlerp ) {
+	poseCache_t	*cache;
+
+	if ( oldframe == frame ) {
+		backlerp = 0.0f;
+	}
+
+	cache = &poseCache[( ( (intptr_t)data >> 4 ) ^ ( frame * 7 ) ^ ( oldframe * 13 ) ) & ( POSE_CACHE_SIZE - 1 )];
+	if ( cache->data == data && cache->frame == frame && cache->oldframe == oldframe && cache->backlerp == backlerp ) {
+		return cache;
+	}
+
+	ComputePoseMats( data, frame, oldframe, backlerp, cache->poseMats );
+	cache->data = data;
+	cache->frame = frame;
+	cache->oldframe = oldframe;
+	cache->backlerp = backlerp;
+
+	if ( boneMatrixPose == cache ) {
+		boneMatrixPose = NULL;
+	}
+
+	return cache;
+}
+
 static void ComputeJointMats( iqmData_t *data, int frame, int oldframe,
 			      float backlerp, float *mat ) {
 	float	*mat1;
@@ -1431,7 +1491,7 @@ Compute vertices for this model surface
 void RB_IQMSurfaceAnim( surfaceType_t *surface ) {
 	srfIQModel_t	*surf = (srfIQModel_t *)surface;
 	iqmData_t	*data = surf->data;
-	float		poseMats[IQM_MAX_JOINTS * 12];
+	const float	*poseMats;
 	float		influenceVtxMat[SHADER_MAX_VERTEXES * 12];
 	float		influenceNrmMat[SHADER_MAX_VERTEXES * 9];
 	int		i;
@@ -1476,7 +1536,7 @@ void RB_IQMSurfaceAnim( surfaceType_t *surface ) {
 
 	if ( data->num_poses > 0 ) {
 		// compute interpolated joint matrices
-		ComputePoseMats( data, frame, oldframe, backlerp, poseMats );
+		poseMats = RB_IQMPoseMats( data, frame, oldframe, backlerp )->poseMats;
 
 		// compute vertex blend influence matricies
 		for( i = 0; i < surf->num_influences; i++ ) {
@@ -1685,17 +1745,20 @@ void RB_IQMSurfaceAnimVao(srfVaoIQModel_t * surface)
 	glState.boneAnimation = data->num_poses;
 
 	if ( glState.boneAnimation ) {
-		float		jointMats[IQM_MAX_JOINTS * 12];
+		poseCache_t	*pose;
+		const float	*jointMats;
 		int			frame = data->num_frames ? backEnd.currentEntity->e.frame % data->num_frames : 0;
 		int			oldframe = data->num_frames ? backEnd.currentEntity->e.oldframe % data->num_frames : 0;
 		float		backlerp = backEnd.currentEntity->e.backlerp;
 		int i;
 
 		// compute interpolated joint matrices
-		ComputePoseMats( surface->iqmData, frame, oldframe, backlerp, jointMats );
+		pose = RB_IQMPoseMats( surface->iqmData, frame, oldframe, backlerp );
+		jointMats = pose->poseMats;
 
-		// convert row-major order 3x4 matrix to column-major order 4x4 matrix
-		for ( i = 0; i < data->num_poses; i++ ) {
+		// convert row-major order 3x4 matrix to column-major order 4x4 matrix,
+		// unless the last surface already did
+		for ( i = 0; pose != boneMatrixPose && i < data->num_poses; i++ ) {
 			glState.boneMatrix[i][0] = jointMats[i*12+0];
 			glState.boneMatrix[i][1] = jointMats[i*12+4];
 			glState.boneMatrix[i][2] = jointMats[i*12+8];
@@ -1713,6 +1776,11 @@ void RB_IQMSurfaceAnimVao(srfVaoIQModel_t * surface)
 			glState.boneMatrix[i][14] = jointMats[i*12+11];
 			glState.boneMatrix[i][15] = 1.0f;
 		}
+
+		if ( pose != boneMatrixPose ) {
+			boneMatrixPose = pose;
+			glState.boneMatrixDirty = qtrue;
+		}
 	}
 
 	RB_EndSurface();
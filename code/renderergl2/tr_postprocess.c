@@ -22,8 +22,9 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "tr_local.h"
 
-void RB_ToneMap(FBO_t *hdrFbo, ivec4_t hdrBox, FBO_t *ldrFbo, ivec4_t ldrBox, int autoExposure)
+void RB_ToneMap(FBO_t *hdrFbo, ivec4_t hdrBox, FBO_t *ldrFbo, ivec4_t ldrBox, int autoExposure, qboolean ssao)
 {
+	shaderProgram_t *sp = &tr.tonemapShader[0];
 	ivec4_t srcBox, dstBox;
 	vec4_t color;
 	static int lastFrameCount = 0;
@@ -90,7 +91,22 @@ void RB_ToneMap(FBO_t *hdrFbo, ivec4_t hdrBox, FBO_t *ldrFbo, ivec4_t ldrBox, in
 	else
 		GL_BindToTMU(tr.fixedLevelsImage, TB_LEVELSMAP);
 
-	FBO_Blit(hdrFbo, hdrBox, NULL, ldrFbo, ldrBox, &tr.tonemapShader, color, 0);
+	// multiply in the SSAO here instead of in a separate full screen pass
+	if (ssao && tr.tonemapShader[1].program)
+	{
+		vec4_t viewInfo;
+
+		sp = &tr.tonemapShader[1];
+
+		VectorSet4(viewInfo, backEnd.viewParms.zFar / r_znear->value, backEnd.viewParms.zFar,
+			1.0f / tr.screenSsaoImage->width, 1.0f / tr.screenSsaoImage->height);
+		GLSL_SetUniformVec4(sp, UNIFORM_VIEWINFO, viewInfo);
+
+		GL_BindToTMU(tr.screenSsaoImage, TB_NORMALMAP);
+		GL_BindToTMU(tr.hdrDepthImage, TB_DELUXEMAP);
+	}
+
+	FBO_Blit(hdrFbo, hdrBox, NULL, ldrFbo, ldrBox, sp, color, 0);
 }
 
 /*
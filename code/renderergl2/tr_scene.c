@@ -43,7 +43,15 @@ R_InitNextFrame
 ====================
 */
 void R_InitNextFrame( void ) {
-	backEndData->commands.used = 0;
+	// use the other buffers next frame, because the render thread
+	// may still be drawing from the current ones
+	if ( glConfig.smpActive ) {
+		tr.smpFrame ^= 1;
+	} else {
+		tr.smpFrame = 0;
+	}
+
+	backEndData[tr.smpFrame]->commands.used = 0;
 
 	r_firstSceneDrawSurf = 0;
 
@@ -111,6 +119,7 @@ RE_AddPolyToScene
 */
 void RE_AddPolyToScene( qhandle_t hShader, int numVerts, const polyVert_t *verts, int numPolys ) {
 	srfPoly_t	*poly;
+	polyVert_t	*dest;
 	int			i, j;
 	int			fogIndex;
 	fog_t		*fog;
@@ -139,23 +148,15 @@ void RE_AddPolyToScene( qhandle_t hShader, int numVerts, const polyVert_t *verts
 			return;
 		}
 
-		poly = &backEndData->polys[r_numpolys];
-		poly->surfaceType = SF_POLY;
-		poly->hShader = hShader;
-		poly->numVerts = numVerts;
-		poly->verts = &backEndData->polyVerts[r_numpolyverts];
-		
-		Com_Memcpy( poly->verts, &verts[numVerts*j], numVerts * sizeof( *verts ) );
+		dest = &backEndData[tr.smpFrame]->polyVerts[r_numpolyverts];
+		Com_Memcpy( dest, &verts[numVerts*j], numVerts * sizeof( *verts ) );
 
 		if ( glConfig.hardwareType == GLHW_RAGEPRO ) {
-			poly->verts->modulate[0] = 255;
-			poly->verts->modulate[1] = 255;
-			poly->verts->modulate[2] = 255;
-			poly->verts->modulate[3] = 255;
+			dest->modulate[0] = 255;
+			dest->modulate[1] = 255;
+			dest->modulate[2] = 255;
+			dest->modulate[3] = 255;
 		}
-		// done.
-		r_numpolys++;
-		r_numpolyverts += numVerts;
 
 		// if no world is loaded
 		if ( tr.world == NULL ) {
@@ -166,10 +167,10 @@ void RE_AddPolyToScene( qhandle_t hShader, int numVerts, const polyVert_t *verts
 			fogIndex = 0;
 		} else {
 			// find which fog volume the poly is in
-			VectorCopy( poly->verts[0].xyz, bounds[0] );
-			VectorCopy( poly->verts[0].xyz, bounds[1] );
-			for ( i = 1 ; i < poly->numVerts ; i++ ) {
-				AddPointToBounds( poly->verts[i].xyz, bounds[0], bounds[1] );
+			VectorCopy( dest[0].xyz, bounds[0] );
+			VectorCopy( dest[0].xyz, bounds[1] );
+			for ( i = 1 ; i < numVerts ; i++ ) {
+				AddPointToBounds( dest[i].xyz, bounds[0], bounds[1] );
 			}
 			for ( fogIndex = 1 ; fogIndex < tr.world->numfogs ; fogIndex++ ) {
 				fog = &tr.world->fogs[fogIndex]; 
@@ -186,7 +187,28 @@ void RE_AddPolyToScene( qhandle_t hShader, int numVerts, const polyVert_t *verts
 				fogIndex = 0;
 			}
 		}
+
+		r_numpolyverts += numVerts;
+
+		// a poly just like the previous one extends its surface instead
+		// of adding another draw surface
+		if ( r_numpolys > r_firstScenePoly ) {
+			poly = &backEndData[tr.smpFrame]->polys[r_numpolys - 1];
+			if ( poly->hShader == hShader && poly->fogIndex == fogIndex
+				&& poly->numFanVerts == numVerts && poly->verts + poly->numVerts == dest ) {
+				poly->numVerts += numVerts;
+				continue;
+			}
+		}
+
+		poly = &backEndData[tr.smpFrame]->polys[r_numpolys];
+		poly->surfaceType = SF_POLY;
+		poly->hShader = hShader;
 		poly->fogIndex = fogIndex;
+		poly->numVerts = numVerts;
+		poly->numFanVerts = numVerts;
+		poly->verts = dest;
+		r_numpolys++;
 	}
 }
 
@@ -221,12 +243,16 @@ void RE_AddRefEntityToScene( const refEntity_t *ent ) {
 	if ( (int)ent->reType < 0 || ent->reType >= RT_MAX_REF_ENTITY_TYPE ) {
 		ri.Error( ERR_DROP, "RE_AddRefEntityToScene: bad reType %i", ent->reType );
 	}
+	// already drawn with the world
+	if ( R_StaticModelEntity( ent ) ) {
+		return;
+	}
 
-	backEndData->entities[r_numentities].e = *ent;
-	backEndData->entities[r_numentities].lightingCalculated = qfalse;
+	backEndData[tr.smpFrame]->entities[r_numentities].e = *ent;
+	backEndData[tr.smpFrame]->entities[r_numentities].lightingCalculated = qfalse;
 
 	CrossProduct(ent->axis[0], ent->axis[1], cross);
-	backEndData->entities[r_numentities].mirrored = (DotProduct(ent->axis[2], cross) < 0.f);
+	backEndData[tr.smpFrame]->entities[r_numentities].mirrored = (DotProduct(ent->axis[2], cross) < 0.f);
 
 	r_numentities++;
 }
@@ -254,7 +280,7 @@ void RE_AddDynamicLightToScene( const vec3_t org, float intensity, float r, floa
 	if ( glConfig.hardwareType == GLHW_RIVA128 || glConfig.hardwareType == GLHW_PERMEDIA2 ) {
 		return;
 	}
-	dl = &backEndData->dlights[r_numdlights++];
+	dl = &backEndData[tr.smpFrame]->dlights[r_numdlights++];
 	VectorCopy (org, dl->origin);
 	dl->radius = intensity;
 	dl->color[0] = r;
@@ -403,19 +429,19 @@ void RE_BeginScene(const refdef_t *fd)
 	tr.refdef.floatTime = tr.refdef.time * 0.001;
 
 	tr.refdef.numDrawSurfs = r_firstSceneDrawSurf;
-	tr.refdef.drawSurfs = backEndData->drawSurfs;
+	tr.refdef.drawSurfs = backEndData[tr.smpFrame]->drawSurfs;
 
 	tr.refdef.num_entities = r_numentities - r_firstSceneEntity;
-	tr.refdef.entities = &backEndData->entities[r_firstSceneEntity];
+	tr.refdef.entities = &backEndData[tr.smpFrame]->entities[r_firstSceneEntity];
 
 	tr.refdef.num_dlights = r_numdlights - r_firstSceneDlight;
-	tr.refdef.dlights = &backEndData->dlights[r_firstSceneDlight];
+	tr.refdef.dlights = &backEndData[tr.smpFrame]->dlights[r_firstSceneDlight];
 
 	tr.refdef.numPolys = r_numpolys - r_firstScenePoly;
-	tr.refdef.polys = &backEndData->polys[r_firstScenePoly];
+	tr.refdef.polys = &backEndData[tr.smpFrame]->polys[r_firstScenePoly];
 
 	tr.refdef.num_pshadows = 0;
-	tr.refdef.pshadows = &backEndData->pshadows[0];
+	tr.refdef.pshadows = &backEndData[tr.smpFrame]->pshadows[0];
 
 	// turn off dynamic lighting globally by clearing all the
 	// dlights if it needs to be disabled or if vertex lighting is enabled
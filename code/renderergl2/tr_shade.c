@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 // tr_shade.c
 
 #include "tr_local.h" 
+#include "tr_dsa.h"
 
 /*
 
@@ -40,12 +41,25 @@ R_DrawElements
 
 void R_DrawElements( int numIndexes, int firstIndex )
 {
+	RB_FlushUniformBlocks();
+	GL_FlushTextures();
+
+	backEnd.pc.c_draws++;
+
 	if (tess.useCacheVao)
 	{
 		VaoCache_DrawElements(numIndexes, firstIndex);
 	}
+	else if (tess.numMultiDraws > 1)
+	{
+		RB_MultiDrawElements();
+		backEnd.pc.c_multiDraws++;
+	}
 	else
 	{
+		if (glState.currentVao == tess.vao)
+			firstIndex += tess.streamFirstIndex;
+
 		qglDrawElements(GL_TRIANGLES, numIndexes, GL_INDEX_TYPE, BUFFER_OFFSET(firstIndex * sizeof(glIndex_t)));
 	}
 }
@@ -144,7 +158,7 @@ static void DrawNormals (shaderCommands_t *input) {
 	if (!input) return;
 
 	const int vertexCount = input->numVertexes;
-	if (vertexCount <= 0) return;
+	if (vertexCount <= 0 || vertexCount > SHADER_MAX_VERTEXES) return;   // static world vao draws
 	if (!input->shader || input->shader->isSky) return;   // do not draw over sky/clouds
 	if (input->shader->numDeforms > 0) return;  // skip vertex-deformed surfaces
 
@@ -260,6 +274,7 @@ static void DrawNormals (shaderCommands_t *input) {
 	qglEnableVertexAttribArray(ATTR_INDEX_POSITION);
 	qglVertexAttribPointer(ATTR_INDEX_POSITION, 3, GL_FLOAT, GL_FALSE, 0, (const void*)0);
 
+	GL_FlushTextures();
 	qglDrawArrays(GL_LINES, 0, numVerts);
 
 	qglDisableVertexAttribArray(ATTR_INDEX_POSITION);
@@ -292,6 +307,7 @@ void RB_BeginSurface( shader_t *shader, int fogNum, int cubemapIndex ) {
 
 	tess.numIndexes = 0;
 	tess.firstIndex = 0;
+	tess.numMultiDraws = 0;
 	tess.numVertexes = 0;
 	tess.shader = state;
 	tess.fogNum = fogNum;
@@ -488,6 +504,24 @@ static void ComputeDeformValues(int *deformGen, vec5_t deformParams)
 }
 
 
+/*
+===================
+RB_SurfaceDlightClusters
+
+Whether the dlights on this surface are added in its lightall pass from the
+clusters RB_BinDlights made, instead of in a pass for each light
+===================
+*/
+static qboolean RB_SurfaceDlightClusters( void ) {
+	shaderStage_t *pStage = tess.xstages[0];
+
+	return backEnd.dlightClusters && !backEnd.depthFill && tess.shader->sort <= SS_OPAQUE
+		&& r_lightmap->integer == 0 && !(tess.shader->surfaceFlags & (SURF_NODLIGHT | SURF_SKY))
+		&& tess.shader->numUnfoggedPasses == 1 && pStage->glslShaderGroup == tr.lightallShader
+		&& (pStage->glslShaderIndex & LIGHTDEF_LIGHTTYPE_MASK);
+}
+
+
 static void ProjectDlightTexture( void ) {
 	int		l;
 	vec3_t	origin;
@@ -1291,6 +1325,11 @@ static void RB_IterateStagesGeneric( shaderCommands_t *input )
 		{
 			GLSL_SetUniformInt(sp, UNIFORM_ALPHATEST, 3);
 		}
+		else if (pStage->glslShaderGroup != tr.lightallShader && pStage->bundle[0].image[0]
+			&& (pStage->bundle[0].image[0]->flags & IMGFLAG_SDF))
+		{
+			GLSL_SetUniformInt(sp, UNIFORM_ALPHATEST, 4);
+		}
 		else
 		{
 			GLSL_SetUniformInt(sp, UNIFORM_ALPHATEST, 0);
@@ -1417,6 +1456,23 @@ static void RB_IterateStagesGeneric( shaderCommands_t *input )
 			int i;
 			vec4_t enableTextures;
 
+			if (RB_SurfaceDlightClusters())
+			{
+				GL_BindToTMU(tr.dlightClusterImage, TB_DLIGHTCLUSTERS);
+				GLSL_SetUniformVec4(sp, UNIFORM_DLIGHTCLUSTERTILE, backEnd.dlightClusterTile);
+				GLSL_SetUniformVec4(sp, UNIFORM_DLIGHTCLUSTERPLANE, backEnd.dlightClusterPlane);
+				GLSL_SetUniformVec4(sp, UNIFORM_DLIGHTCLUSTERSLICE, backEnd.dlightClusterSlice);
+				GLSL_SetUniformVec4Dlights(sp, UNIFORM_DLIGHTORIGINS, backEnd.dlightOrigins, backEnd.refdef.num_dlights);
+				GLSL_SetUniformVec4Dlights(sp, UNIFORM_DLIGHTCOLORS, backEnd.dlightColors, backEnd.refdef.num_dlights);
+			}
+			else
+			{
+				vec4_t noClusters = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+				// z = 0 turns the clusters off
+				GLSL_SetUniformVec4(sp, UNIFORM_DLIGHTCLUSTERSLICE, noClusters);
+			}
+
 			if (r_sunlightMode->integer && (backEnd.viewParms.flags & VPF_USESUNLIGHT) && (pStage->glslShaderIndex & LIGHTDEF_LIGHTTYPE_MASK))
 			{
 				// FIXME: screenShadowImage is NULL if no framebuffers
@@ -1507,7 +1563,7 @@ static void RB_IterateStagesGeneric( shaderCommands_t *input )
 						GL_BindToTMU( tr.whiteImage, TB_SPECULARMAP );
 				}
 
-				enableTextures[3] = (r_cubeMapping->integer && !(tr.viewParms.flags & VPF_NOCUBEMAPS) && input->cubemapIndex) ? 1.0f : 0.0f;
+				enableTextures[3] = (r_cubeMapping->integer && !(tr.viewParms.flags & VPF_NOCUBEMAPS) && input->cubemapIndex && !tr.cubemaps[input->cubemapIndex - 1].missingSides) ? 1.0f : 0.0f;
 			}
 
 			GLSL_SetUniformVec4(sp, UNIFORM_ENABLETEXTURES, enableTextures);
@@ -1528,7 +1584,7 @@ static void RB_IterateStagesGeneric( shaderCommands_t *input )
 		//
 		// testing cube map
 		//
-		if (!(tr.viewParms.flags & VPF_NOCUBEMAPS) && input->cubemapIndex && r_cubeMapping->integer)
+		if (!(tr.viewParms.flags & VPF_NOCUBEMAPS) && input->cubemapIndex && r_cubeMapping->integer && !tr.cubemaps[input->cubemapIndex - 1].missingSides)
 		{
 			vec4_t vec;
 			cubemap_t *cubemap = &tr.cubemaps[input->cubemapIndex - 1];
@@ -1757,7 +1813,7 @@ void RB_StageIteratorGeneric( void )
 	// now do any dynamic lighting needed
 	//
 	if ( tess.dlightBits && tess.shader->sort <= SS_OPAQUE && r_lightmap->integer == 0
-		&& !(tess.shader->surfaceFlags & (SURF_NODLIGHT | SURF_SKY) ) ) {
+		&& !(tess.shader->surfaceFlags & (SURF_NODLIGHT | SURF_SKY) ) && !RB_SurfaceDlightClusters() ) {
 		if (tess.shader->numUnfoggedPasses == 1 && tess.xstages[0]->glslShaderGroup == tr.lightallShader
 			&& (tess.xstages[0]->glslShaderIndex & LIGHTDEF_LIGHTTYPE_MASK) && r_dlightMode->integer)
 		{
@@ -1846,6 +1902,7 @@ void RB_EndSurface( void ) {
 	tess.numIndexes = 0;
 	tess.numVertexes = 0;
 	tess.firstIndex = 0;
+	tess.numMultiDraws = 0;
 	tess.useCacheVao = qfalse;
 	tess.useInternalVao = qfalse;
 
@@ -2681,7 +2681,7 @@ sortedIndex.
 ==============
 */
 static void FixRenderCommandList( int newShader ) {
-	renderCommandList_t	*cmdList = &backEndData->commands;
+	renderCommandList_t	*cmdList = &backEndData[tr.smpFrame]->commands;
 
 	if( cmdList ) {
 		const void *curCmd = cmdList->cmds;
@@ -3357,6 +3357,71 @@ shader_t *R_FindShaderByName( const char *name ) {
 }
 
 
+/*
+==================
+R_PrefetchWorldImages
+
+Queues the images the world's shaders will ask R_FindImageFile for and
+starts decoding them, so they are ready by the time the surfaces load
+==================
+*/
+void R_PrefetchWorldImages( const dshader_t *shaders, int numShaders ) {
+	char		strippedName[MAX_QPATH];
+	char		*shaderText, *token;
+	int			i, depth;
+
+	if ( !r_imageThreads->integer ) {
+		return;
+	}
+
+	for ( i = 0 ; i < numShaders ; i++ ) {
+		COM_StripExtension( shaders[i].shader, strippedName, sizeof( strippedName ) );
+
+		shaderText = FindShaderInShaderText( strippedName );
+		if ( !shaderText ) {
+			// R_FindShaderEx falls back to an image of the same name
+			R_AddImagePrefetch( shaders[i].shader );
+			continue;
+		}
+
+		depth = 0;
+		while ( 1 ) {
+			token = COM_ParseExt( &shaderText, qtrue );
+			if ( !token[0] ) {
+				break;
+			}
+
+			if ( token[0] == '{' ) {
+				depth++;
+			} else if ( token[0] == '}' ) {
+				if ( --depth <= 0 ) {
+					break;
+				}
+			} else if ( !Q_stricmp( token, "map" ) || !Q_stricmp( token, "clampmap" ) ) {
+				token = COM_ParseExt( &shaderText, qfalse );
+				if ( !Q_stricmp( token, "clamp" ) ) {
+					token = COM_ParseExt( &shaderText, qfalse );
+				}
+				if ( token[0] && token[0] != '$' && token[0] != '*' ) {
+					R_AddImagePrefetch( token );
+				}
+			} else if ( !Q_stricmp( token, "animMap" ) ) {
+				COM_ParseExt( &shaderText, qfalse );
+				while ( 1 ) {
+					token = COM_ParseExt( &shaderText, qfalse );
+					if ( !token[0] ) {
+						break;
+					}
+					R_AddImagePrefetch( token );
+				}
+			}
+		}
+	}
+
+	R_StartImagePrefetch();
+}
+
+
 /*
 ===============
 R_FindShader
@@ -3429,6 +3494,12 @@ shader_t *R_FindShaderEx( const char *name, int lightmapIndex, qboolean mipRawIm
 		}
 	}
 
+	// make sure the render thread is stopped, because we are probably
+	// going to upload an image and resort the shaders it is drawing with
+	if ( glConfig.smpActive ) {
+		R_IssuePendingRenderCommands();
+	}
+
 	InitShaderEx( strippedName, lightmapIndex, realLightmapIndex );
 
 	//
@@ -3564,6 +3635,10 @@ qhandle_t RE_RegisterShaderFromImage(const char *name, int lightmapIndex, image_
 		}
 	}
 
+	if ( glConfig.smpActive ) {
+		R_IssuePendingRenderCommands();
+	}
+
 	InitShader( name, lightmapIndex );
 
 	//
@@ -3794,6 +3869,207 @@ void	R_ShaderList_f (void) {
 	ri.Printf (PRINT_ALL, "------------------\n");
 }
 
+/*
+====================
+Shader text cache
+
+The combined and compressed shader text is saved to cache/shadertext.bin
+in the homepath together with where each shader starts and its name hash,
+so later starts skip reading, checking and tokenizing every shader file.
+The checksum covers the file names and their crc and size in the pak
+directories, which needs no file reads.  Shader files on disk have no
+such key, so the cache isn't used while there are any.
+=====================
+*/
+#define SHADERCACHE_NAME	"cache/shadertext.bin"
+#define SHADERCACHE_IDENT	(('C'<<24)+('H'<<16)+('S'<<8)+'S')
+#define SHADERCACHE_VERSION	1
+
+typedef struct {
+	int			ident;
+	int			version;
+	unsigned	checksum;
+	int			hashSize;
+	int			numShaders;
+	int			textLength;
+} shaderCacheHeader_t;
+
+typedef struct {
+	int			offset;
+	int			hash;
+} shaderCacheEntry_t;
+
+static unsigned ShaderCacheHash( unsigned hash, const void *data, int len ) {
+	const byte *p = data;
+
+	while ( len-- > 0 ) {
+		hash ^= *p++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+/*
+====================
+ShaderFileName
+
+Picks the .mtr file over the .shader file with the same name
+=====================
+*/
+static int ShaderFileName( const char *shaderFile, char *filename, int size, unsigned int *crc, unsigned int *length )
+{
+	char *ext;
+	int found;
+
+	Com_sprintf( filename, size, "scripts/%s", shaderFile );
+	if ( (ext = strrchr(filename, '.')) )
+	{
+		strcpy(ext, ".mtr");
+	}
+
+	found = ri.FS_FileContentKey( filename, crc, length );
+	if ( found < 0 || ( found == 1 && !*length ) )
+	{
+		Com_sprintf( filename, size, "scripts/%s", shaderFile );
+		found = ri.FS_FileContentKey( filename, crc, length );
+	}
+
+	return found;
+}
+
+/*
+====================
+ShaderCacheChecksum
+
+Returns 0 if the shader files can't be keyed
+=====================
+*/
+static unsigned ShaderCacheChecksum( char **shaderFiles, int numShaderFiles )
+{
+	char filename[MAX_QPATH];
+	unsigned int crc, length;
+	unsigned hash = 2166136261u;
+	int i;
+
+	for ( i = 0; i < numShaderFiles; i++ )
+	{
+		if ( ShaderFileName( shaderFiles[i], filename, sizeof( filename ), &crc, &length ) != 1 )
+			return 0;
+
+		hash = ShaderCacheHash( hash, filename, strlen( filename ) + 1 );
+		hash = ShaderCacheHash( hash, &crc, sizeof( crc ) );
+		hash = ShaderCacheHash( hash, &length, sizeof( length ) );
+	}
+
+	return hash ? hash : 1;
+}
+
+static void AllocShaderTextHashTable( const int *shaderTextHashTableSizes, int numShaders )
+{
+	char *hashMem;
+	int i;
+
+	hashMem = ri.Hunk_Alloc( ( numShaders + MAX_SHADERTEXT_HASH ) * sizeof(char *), h_low );
+
+	for (i = 0; i < MAX_SHADERTEXT_HASH; i++) {
+		shaderTextHashTable[i] = (char **) hashMem;
+		hashMem = ((char *) hashMem) + ((shaderTextHashTableSizes[i] + 1) * sizeof(char *));
+	}
+}
+
+static qboolean LoadShaderCache( unsigned checksum )
+{
+	shaderCacheHeader_t *header;
+	const shaderCacheEntry_t *entries;
+	int shaderTextHashTableSizes[MAX_SHADERTEXT_HASH];
+	void *buffer;
+	long len;
+	int i;
+
+	len = ri.FS_ReadFile( SHADERCACHE_NAME, &buffer );
+	if ( !buffer )
+		return qfalse;
+
+	header = buffer;
+	if ( len < sizeof( *header ) || header->ident != SHADERCACHE_IDENT || header->version != SHADERCACHE_VERSION ||
+		header->checksum != checksum || header->hashSize != MAX_SHADERTEXT_HASH || header->numShaders < 0 || header->textLength < 0 ||
+		len != sizeof( *header ) + header->numShaders * sizeof( *entries ) + header->textLength + 1 )
+	{
+		ri.Printf( PRINT_DEVELOPER, "LoadShaderCache: %s is stale, rebuilding\n", SHADERCACHE_NAME );
+		ri.FS_FreeFile( buffer );
+		return qfalse;
+	}
+
+	entries = (const shaderCacheEntry_t *)( header + 1 );
+
+	Com_Memset(shaderTextHashTableSizes, 0, sizeof(shaderTextHashTableSizes));
+	for ( i = 0; i < header->numShaders; i++ )
+	{
+		if ( entries[i].offset < 0 || entries[i].offset >= header->textLength ||
+			entries[i].hash < 0 || entries[i].hash >= MAX_SHADERTEXT_HASH )
+		{
+			ri.Printf( PRINT_WARNING, "WARNING: %s is corrupt, rebuilding\n", SHADERCACHE_NAME );
+			ri.FS_FreeFile( buffer );
+			return qfalse;
+		}
+
+		shaderTextHashTableSizes[entries[i].hash]++;
+	}
+
+	s_shaderText = ri.Hunk_Alloc( header->textLength + 1, h_low );
+	Com_Memcpy( s_shaderText, entries + header->numShaders, header->textLength );
+	s_shaderText[header->textLength] = '\0';
+
+	AllocShaderTextHashTable( shaderTextHashTableSizes, header->numShaders );
+
+	Com_Memset(shaderTextHashTableSizes, 0, sizeof(shaderTextHashTableSizes));
+	for ( i = 0; i < header->numShaders; i++ )
+	{
+		int hash = entries[i].hash;
+
+		shaderTextHashTable[hash][shaderTextHashTableSizes[hash]++] = s_shaderText + entries[i].offset;
+	}
+
+	ri.Printf( PRINT_DEVELOPER, "...%i shaders from %s\n", header->numShaders, SHADERCACHE_NAME );
+
+	ri.FS_FreeFile( buffer );
+	return qtrue;
+}
+
+static void WriteShaderCache( unsigned checksum, int numShaders )
+{
+	shaderCacheHeader_t *header;
+	shaderCacheEntry_t *entry;
+	int textLength, size, i, j;
+
+	textLength = strlen( s_shaderText );
+	size = sizeof( *header ) + numShaders * sizeof( *entry ) + textLength + 1;
+	header = ri.Hunk_AllocateTempMemory( size );
+
+	header->ident = SHADERCACHE_IDENT;
+	header->version = SHADERCACHE_VERSION;
+	header->checksum = checksum;
+	header->hashSize = MAX_SHADERTEXT_HASH;
+	header->numShaders = numShaders;
+	header->textLength = textLength;
+
+	entry = (shaderCacheEntry_t *)( header + 1 );
+	for ( i = 0; i < MAX_SHADERTEXT_HASH; i++ )
+	{
+		for ( j = 0; shaderTextHashTable[i][j]; j++, entry++ )
+		{
+			entry->offset = shaderTextHashTable[i][j] - s_shaderText;
+			entry->hash = i;
+		}
+	}
+
+	Com_Memcpy( entry, s_shaderText, textLength + 1 );
+
+	ri.FS_WriteFile( SHADERCACHE_NAME, header, size );
+	ri.Hunk_FreeTempMemory( header );
+}
+
 /*
 ====================
 ScanAndLoadShaderFiles
@@ -3810,10 +4086,11 @@ static void ScanAndLoadShaderFiles( void )
 	char *p;
 	int numShaderFiles;
 	int i;
-	char *oldp, *token, *hashMem, *textEnd;
+	char *oldp, *token, *textEnd;
 	int shaderTextHashTableSizes[MAX_SHADERTEXT_HASH], hash, size;
 	char shaderName[MAX_QPATH];
 	int shaderLine;
+	unsigned checksum = 0;
 
 	long sum = 0, summand;
 	// scan for shader files
@@ -3829,25 +4106,25 @@ static void ScanAndLoadShaderFiles( void )
 		numShaderFiles = MAX_SHADER_FILES;
 	}
 
+	if ( r_shaderCache->integer )
+	{
+		checksum = ShaderCacheChecksum( shaderFiles, numShaderFiles );
+
+		if ( checksum && LoadShaderCache( checksum ) )
+		{
+			ri.FS_FreeFileList( shaderFiles );
+			return;
+		}
+	}
+
 	// load and parse shader files
 	for ( i = 0; i < numShaderFiles; i++ )
 	{
 		char filename[MAX_QPATH];
+		unsigned int crc, length;
 
 		// look for a .mtr file first
-		{
-			char *ext;
-			Com_sprintf( filename, sizeof( filename ), "scripts/%s", shaderFiles[i] );
-			if ( (ext = strrchr(filename, '.')) )
-			{
-				strcpy(ext, ".mtr");
-			}
-
-			if ( ri.FS_ReadFile( filename, NULL ) <= 0 )
-			{
-				Com_sprintf( filename, sizeof( filename ), "scripts/%s", shaderFiles[i] );
-			}
-		}
+		ShaderFileName( shaderFiles[i], filename, sizeof( filename ), &crc, &length );
 		
 		ri.Printf( PRINT_DEVELOPER, "...loading '%s'\n", filename );
 		summand = ri.FS_ReadFile( filename, (void **)&buffers[i] );
@@ -3937,14 +4214,7 @@ static void ScanAndLoadShaderFiles( void )
 		SkipBracedSection(&p, 0);
 	}
 
-	size += MAX_SHADERTEXT_HASH;
-
-	hashMem = ri.Hunk_Alloc( size * sizeof(char *), h_low );
-
-	for (i = 0; i < MAX_SHADERTEXT_HASH; i++) {
-		shaderTextHashTable[i] = (char **) hashMem;
-		hashMem = ((char *) hashMem) + ((shaderTextHashTableSizes[i] + 1) * sizeof(char *));
-	}
+	AllocShaderTextHashTable( shaderTextHashTableSizes, size );
 
 	Com_Memset(shaderTextHashTableSizes, 0, sizeof(shaderTextHashTableSizes));
 
@@ -3963,7 +4233,8 @@ static void ScanAndLoadShaderFiles( void )
 		SkipBracedSection(&p, 0);
 	}
 
-	return;
+	if ( checksum )
+		WriteShaderCache( checksum, size );
 
 }
 
@@ -22,6 +22,14 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 // tr_surf.c
 #include "tr_local.h"
 
+#if idx64 || defined( __SSE2__ )
+#include <emmintrin.h>
+#define SURFACE_SSE2
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#include <arm_neon.h>
+#define SURFACE_NEON
+#endif
+
 /*
 
   THIS ENTIRE FILE IS BACK END
@@ -280,36 +288,40 @@ RB_SurfacePolychain
 =============
 */
 static void RB_SurfacePolychain( srfPoly_t *p ) {
-	int		i;
+	int		i, j;
 	int		numv;
+	polyVert_t	*v;
 
 	RB_CheckVao(tess.vao);
 
-	RB_CHECKOVERFLOW( p->numVerts, 3*(p->numVerts - 2) );
-
-	// fan triangles into the tess array
-	numv = tess.numVertexes;
-	for ( i = 0; i < p->numVerts; i++ ) {
-		VectorCopy( p->verts[i].xyz, tess.xyz[numv] );
-		tess.texCoords[numv][0] = p->verts[i].st[0];
-		tess.texCoords[numv][1] = p->verts[i].st[1];
-		tess.color[numv][0] = (int)p->verts[i].modulate[0] * 257;
-		tess.color[numv][1] = (int)p->verts[i].modulate[1] * 257;
-		tess.color[numv][2] = (int)p->verts[i].modulate[2] * 257;
-		tess.color[numv][3] = (int)p->verts[i].modulate[3] * 257;
+	// merged polys are stored as consecutive fans of numFanVerts
+	for ( j = 0, v = p->verts; j < p->numVerts; j += p->numFanVerts, v += p->numFanVerts ) {
+		RB_CHECKOVERFLOW( p->numFanVerts, 3*(p->numFanVerts - 2) );
+
+		// fan triangles into the tess array
+		numv = tess.numVertexes;
+		for ( i = 0; i < p->numFanVerts; i++ ) {
+			VectorCopy( v[i].xyz, tess.xyz[numv] );
+			tess.texCoords[numv][0] = v[i].st[0];
+			tess.texCoords[numv][1] = v[i].st[1];
+			tess.color[numv][0] = (int)v[i].modulate[0] * 257;
+			tess.color[numv][1] = (int)v[i].modulate[1] * 257;
+			tess.color[numv][2] = (int)v[i].modulate[2] * 257;
+			tess.color[numv][3] = (int)v[i].modulate[3] * 257;
+
+			numv++;
+		}
 
-		numv++;
-	}
+		// generate fan indexes into the tess array
+		for ( i = 0; i < p->numFanVerts-2; i++ ) {
+			tess.indexes[tess.numIndexes + 0] = tess.numVertexes;
+			tess.indexes[tess.numIndexes + 1] = tess.numVertexes + i + 1;
+			tess.indexes[tess.numIndexes + 2] = tess.numVertexes + i + 2;
+			tess.numIndexes += 3;
+		}
 
-	// generate fan indexes into the tess array
-	for ( i = 0; i < p->numVerts-2; i++ ) {
-		tess.indexes[tess.numIndexes + 0] = tess.numVertexes;
-		tess.indexes[tess.numIndexes + 1] = tess.numVertexes + i + 1;
-		tess.indexes[tess.numIndexes + 2] = tess.numVertexes + i + 2;
-		tess.numIndexes += 3;
+		tess.numVertexes = numv;
 	}
-
-	tess.numVertexes = numv;
 }
 
 static void RB_SurfaceVertsAndIndexes( int numVerts, srfVert_t *verts, int numIndexes, glIndex_t *indexes, int dlightBits, int pshadowBits)
@@ -456,15 +468,97 @@ static qboolean RB_SurfaceVaoCached(int numVerts, srfVert_t *verts, int numIndex
 RB_SurfaceTriangles
 =============
 */
+/*
+=============
+RB_SurfaceWorldVao
+
+Soups packed by R_CreateWorldVaosCod1 extend the current draw as long as
+they are in the same VAO.  Soups that follow the last one in the index
+buffer lengthen its range, others start a new range for RB_MultiDrawElements
+to submit with the rest.
+
+The depth prepass draws from the position-only copy of the VAO unless the
+shader needs more than positions to decide coverage.
+=============
+*/
+static qboolean RB_DepthOnlyPositions( const shader_t *shader ) {
+	int stage;
+
+	if (!backEnd.depthFill || shader->numDeforms)
+		return qfalse;
+
+	for (stage = 0; stage < MAX_SHADER_STAGES && shader->stages[stage]; stage++)
+	{
+		if (shader->stages[stage]->stateBits & GLS_ATEST_BITS)
+			return qfalse;
+	}
+
+	return qtrue;
+}
+
+static void RB_SurfaceWorldVao( srfBspSurface_t *srf ) {
+	int last = tess.numMultiDraws - 1;
+	qboolean contiguous = last >= 0 && tess.multiDrawFirst[last] + tess.multiDrawCount[last] == srf->firstIndex;
+	vao_t *vao = srf->vao;
+
+	if (vao->depthVao && RB_DepthOnlyPositions(tess.shader))
+		vao = vao->depthVao;
+
+	if (tess.numIndexes && (tess.useInternalVao || tess.useCacheVao || glState.currentVao != vao || !tess.numMultiDraws
+		|| (!contiguous && (!glRefConfig.multiDrawElements || tess.numMultiDraws == MAX_MULTIDRAWS))))
+	{
+		RB_EndSurface();
+		RB_BeginSurface(tess.shader, tess.fogNum, tess.cubemapIndex);
+	}
+
+	if (!tess.numIndexes)
+	{
+		R_BindVao(vao);
+		tess.useInternalVao = qfalse;
+		tess.firstIndex = srf->firstIndex;
+		tess.numMultiDraws = 0;
+		contiguous = qfalse;
+	}
+
+	if (contiguous)
+	{
+		tess.multiDrawCount[tess.numMultiDraws - 1] += srf->numIndexes;
+	}
+	else
+	{
+		tess.multiDrawFirst[tess.numMultiDraws] = srf->firstIndex;
+		tess.multiDrawCount[tess.numMultiDraws] = srf->numIndexes;
+		tess.numMultiDraws++;
+	}
+
+	tess.numIndexes += srf->numIndexes;
+	tess.numVertexes += srf->numVerts;
+	tess.dlightBits |= srf->dlightBits[ backEnd.smpFrame ];
+	tess.pshadowBits |= srf->pshadowBits[ backEnd.smpFrame ];
+}
+
 static void RB_SurfaceTriangles( srfBspSurface_t *srf ) {
+	if (srf->vao && !ShaderRequiresCPUDeforms(tess.shader) && !tess.shader->isSky && !tess.shader->isPortal)
+	{
+		RB_SurfaceWorldVao(srf);
+		return;
+	}
+
+	// flush a pending static world vao draw
+	if (tess.numIndexes && !tess.useInternalVao && !tess.useCacheVao)
+	{
+		RB_EndSurface();
+		RB_BeginSurface(tess.shader, tess.fogNum, tess.cubemapIndex);
+	}
+
 	if (RB_SurfaceVaoCached(srf->numVerts, srf->verts, srf->numIndexes,
-		srf->indexes, srf->dlightBits, srf->pshadowBits))
+		srf->indexes, srf->dlightBits[ backEnd.smpFrame ], srf->pshadowBits[ backEnd.smpFrame ]))
 	{
 		return;
 	}
 
 	RB_SurfaceVertsAndIndexes(srf->numVerts, srf->verts, srf->numIndexes,
-			srf->indexes, srf->dlightBits, srf->pshadowBits);
+			srf->indexes, srf->dlightBits[ backEnd.smpFrame ], srf->pshadowBits[ backEnd.smpFrame ]);
 }
 
 
@@ -813,9 +907,79 @@ static void LerpMeshVertexes(mdvSurface_t *surf, float backlerp)
 		//
 
 		mdvVertex_t *oldVerts;
+#if defined( SURFACE_SSE2 )
+		const __m128 frontlerp4 = _mm_set1_ps(1.0f - backlerp);
+		const __m128 backlerp4 = _mm_set1_ps(backlerp);
+		const __m128 xyzMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+		// normal[3] is cleared, tangent[3] is the handedness of the new frame
+		const __m128i lerpMask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+		const __m128i newMask = _mm_set_epi16(-1, 0, 0, 0, 0, 0, 0, 0);
+#elif defined( SURFACE_NEON )
+		const float frontlerp = 1.0f - backlerp;
+#endif
 
 		oldVerts = surf->verts + backEnd.currentEntity->e.oldframe * surf->numVerts;
 
+#if defined( SURFACE_SSE2 )
+		// xyz is loaded with the first two normal components behind it,
+		// normal and tangent are adjacent in mdvVertex_t
+		for (vertNum=0 ; vertNum < surf->numVerts ; vertNum++)
+		{
+			__m128 xyz, lo, hi;
+			__m128i n, o, packed;
+
+			xyz = _mm_add_ps(_mm_mul_ps(_mm_and_ps(_mm_loadu_ps(newVerts->xyz), xyzMask), frontlerp4),
+				_mm_mul_ps(_mm_and_ps(_mm_loadu_ps(oldVerts->xyz), xyzMask), backlerp4));
+			_mm_store_ps(outXyz, xyz);
+
+			n = _mm_loadu_si128((const __m128i *)newVerts->normal);
+			o = _mm_loadu_si128((const __m128i *)oldVerts->normal);
+
+			lo = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(n, n), 16)), frontlerp4),
+				_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(o, o), 16)), backlerp4));
+			hi = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(n, n), 16)), frontlerp4),
+				_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(o, o), 16)), backlerp4));
+
+			packed = _mm_packs_epi32(_mm_cvttps_epi32(lo), _mm_cvttps_epi32(hi));
+			packed = _mm_or_si128(_mm_and_si128(packed, lerpMask), _mm_and_si128(n, newMask));
+
+			_mm_storel_epi64((__m128i *)outNormal, packed);
+			_mm_storel_epi64((__m128i *)outTangent, _mm_unpackhi_epi64(packed, packed));
+
+			newVerts++;
+			oldVerts++;
+			outXyz += 4;
+			outNormal += 4;
+			outTangent += 4;
+		}
+#elif defined( SURFACE_NEON )
+		for (vertNum=0 ; vertNum < surf->numVerts ; vertNum++)
+		{
+			float32x4_t nxyz, oxyz, lo, hi;
+			int16x8_t n, o;
+
+			nxyz = vsetq_lane_f32(0.0f, vld1q_f32(newVerts->xyz), 3);
+			oxyz = vsetq_lane_f32(0.0f, vld1q_f32(oldVerts->xyz), 3);
+			vst1q_f32(outXyz, vaddq_f32(vmulq_n_f32(nxyz, frontlerp), vmulq_n_f32(oxyz, backlerp)));
+
+			n = vld1q_s16(newVerts->normal);
+			o = vld1q_s16(oldVerts->normal);
+
+			lo = vaddq_f32(vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(n))), frontlerp),
+				vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(o))), backlerp));
+			hi = vaddq_f32(vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(n))), frontlerp),
+				vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(o))), backlerp));
+
+			vst1_s16(outNormal, vset_lane_s16(0, vqmovn_s32(vcvtq_s32_f32(lo)), 3));
+			vst1_s16(outTangent, vset_lane_s16(newVerts->tangent[3], vqmovn_s32(vcvtq_s32_f32(hi)), 3));
+
+			newVerts++;
+			oldVerts++;
+			outXyz += 4;
+			outNormal += 4;
+			outTangent += 4;
+		}
+#else
 		for (vertNum=0 ; vertNum < surf->numVerts ; vertNum++)
 		{
 			VectorLerp(newVerts->xyz,    oldVerts->xyz,    backlerp, outXyz);
@@ -836,6 +1000,7 @@ static void LerpMeshVertexes(mdvSurface_t *surf, float backlerp)
 			outNormal += 4;
 			outTangent += 4;
 		}
+#endif
 	}
 
 }
@@ -893,13 +1058,13 @@ RB_SurfaceFace
 */
 static void RB_SurfaceFace( srfBspSurface_t *srf ) {
 	if (RB_SurfaceVaoCached(srf->numVerts, srf->verts, srf->numIndexes,
-		srf->indexes, srf->dlightBits, srf->pshadowBits))
+		srf->indexes, srf->dlightBits[ backEnd.smpFrame ], srf->pshadowBits[ backEnd.smpFrame ]))
 	{
 		return;
 	}
 
 	RB_SurfaceVertsAndIndexes(srf->numVerts, srf->verts, srf->numIndexes,
-			srf->indexes, srf->dlightBits, srf->pshadowBits);
+			srf->indexes, srf->dlightBits[ backEnd.smpFrame ], srf->pshadowBits[ backEnd.smpFrame ]);
 }
 
 
@@ -961,17 +1126,17 @@ static void RB_SurfaceGrid( srfBspSurface_t *srf ) {
 	//int		*vDlightBits;
 
 	if (RB_SurfaceVaoCached(srf->numVerts, srf->verts, srf->numIndexes,
-		srf->indexes, srf->dlightBits, srf->pshadowBits))
+		srf->indexes, srf->dlightBits[ backEnd.smpFrame ], srf->pshadowBits[ backEnd.smpFrame ]))
 	{
 		return;
 	}
 
 	RB_CheckVao(tess.vao);
 
-	dlightBits = srf->dlightBits;
+	dlightBits = srf->dlightBits[ backEnd.smpFrame ];
 	tess.dlightBits |= dlightBits;
 
-	pshadowBits = srf->pshadowBits;
+	pshadowBits = srf->pshadowBits[ backEnd.smpFrame ];
 	tess.pshadowBits |= pshadowBits;
 
 	// determine the allowable discrepance
@@ -1236,6 +1401,7 @@ void RB_SurfaceVaoMdvMesh(srfVaoMdvMesh_t * surface)
 
 	tess.numIndexes = surface->numIndexes;
 	tess.numVertexes = surface->numVerts;
+	tess.firstIndex = surface->firstIndex;
 
 	//mdvModel = surface->mdvModel;
 	//mdvSurface = surface->mdvSurface;
@@ -22,6 +22,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 // tr_vbo.c
 #include "tr_local.h"
 
+static int vaoBytes;	// vertex and index buffer memory, for memstats
+
 
 void R_VaoPackTangent(int16_t *out, vec4_t v)
 {
@@ -160,6 +162,8 @@ vao_t *R_CreateVao(const char *name, byte *vertexes, int vertexesSize, byte *ind
 	qglBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vao->indexesIBO);
 	qglBufferData(GL_ELEMENT_ARRAY_BUFFER, indexesSize, indexes, glUsage);
 
+	vaoBytes += vertexesSize + indexesSize;
+	ri.MemStatSet( "renderer.vao", vaoBytes );
 
 	glState.currentVao = vao;
 
@@ -314,6 +318,8 @@ vao_t *R_CreateVao2(const char *name, int numVertexes, srfVert_t *verts, int num
 	qglBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vao->indexesIBO);
 	qglBufferData(GL_ELEMENT_ARRAY_BUFFER, vao->indexesSize, indexes, glUsage);
 
+	vaoBytes += vao->vertexesSize + vao->indexesSize;
+	ri.MemStatSet( "renderer.vao", vaoBytes );
 
 	Vao_SetVertexPointers(vao);
 
@@ -328,6 +334,75 @@ vao_t *R_CreateVao2(const char *name, int numVertexes, srfVert_t *verts, int num
 }
 
 
+/*
+============
+R_CreateDepthVao
+
+Gives a static vao a tightly packed copy of its positions that draws with
+the same index buffer.  The depth prepass binds it for shaders that only
+need positions, fetching 12 bytes per vertex instead of the whole
+interleaved vertex.
+============
+*/
+void R_CreateDepthVao(vao_t *vao, int numVertexes, srfVert_t *verts)
+{
+	vao_t          *depthVao;
+	vec3_t         *xyz;
+	int             i;
+
+	R_IssuePendingRenderCommands();
+
+	depthVao = ri.Hunk_Alloc(sizeof(*depthVao), h_low);
+
+	memset(depthVao, 0, sizeof(*depthVao));
+
+	Com_sprintf(depthVao->name, sizeof(depthVao->name), "%s_depth", vao->name);
+
+	depthVao->attribs[ATTR_INDEX_POSITION].enabled = 1;
+	depthVao->attribs[ATTR_INDEX_POSITION].count = 3;
+	depthVao->attribs[ATTR_INDEX_POSITION].type = GL_FLOAT;
+	depthVao->attribs[ATTR_INDEX_POSITION].normalized = GL_FALSE;
+	depthVao->attribs[ATTR_INDEX_POSITION].offset = 0;
+	depthVao->attribs[ATTR_INDEX_POSITION].stride = sizeof(*xyz);
+
+	if (glRefConfig.vertexArrayObject)
+	{
+		qglGenVertexArrays(1, &depthVao->vao);
+		qglBindVertexArray(depthVao->vao);
+	}
+
+	xyz = ri.Hunk_AllocateTempMemory(numVertexes * sizeof(*xyz));
+	for (i = 0; i < numVertexes; i++)
+		VectorCopy(verts[i].xyz, xyz[i]);
+
+	depthVao->vertexesSize = numVertexes * sizeof(*xyz);
+
+	qglGenBuffers(1, &depthVao->vertexesVBO);
+
+	qglBindBuffer(GL_ARRAY_BUFFER, depthVao->vertexesVBO);
+	qglBufferData(GL_ARRAY_BUFFER, depthVao->vertexesSize, xyz, GL_STATIC_DRAW);
+
+	// the index buffer belongs to the full vao
+	depthVao->indexesIBO = vao->indexesIBO;
+	depthVao->indexesSize = vao->indexesSize;
+
+	qglBindBuffer(GL_ELEMENT_ARRAY_BUFFER, depthVao->indexesIBO);
+
+	vaoBytes += depthVao->vertexesSize;
+	ri.MemStatSet( "renderer.vao", vaoBytes );
+
+	Vao_SetVertexPointers(depthVao);
+
+	glState.currentVao = depthVao;
+
+	GL_CheckErrors();
+
+	ri.Hunk_FreeTempMemory(xyz);
+
+	vao->depthVao = depthVao;
+}
+
+
 /*
 ============
 R_BindVao
@@ -378,6 +453,10 @@ void R_BindVao(vao_t * vao)
 				Vao_SetVertexPointers(vao);
 		}
 	}
+	else
+	{
+		backEnd.pc.c_vaoBindsSkipped++;
+	}
 }
 
 /*
@@ -410,6 +489,295 @@ void R_BindNullVao(void)
 }
 
 
+/*
+==============================================================================
+
+TESS STREAMING
+
+With GL_ARB_buffer_storage the tess VAO's buffers are persistently mapped
+rings instead of being orphaned on every batch.  Each batch is copied in at
+the ring's cursor and the attribute pointers and first index are moved to
+it.  The rings are split in segments; a fence goes in when the cursor leaves
+a segment, and is waited on before the cursor comes back around to it.
+
+==============================================================================
+*/
+
+#define TESS_STREAM_SEGMENTS 4
+#define TESS_STREAM_ALIGN 16
+
+typedef struct
+{
+	GLuint  buffer;
+	byte   *base;
+	int     size;
+	int     segmentSize;
+	int     offset;
+	int     segment;
+	GLsync  fences[TESS_STREAM_SEGMENTS];
+}
+streamBuffer_t;
+
+static streamBuffer_t tessVertexStream;
+static streamBuffer_t tessIndexStream;
+
+// GL_ARB_multi_draw_indirect command, for RB_MultiDrawElements
+typedef struct
+{
+	GLuint  count;
+	GLuint  instanceCount;
+	GLuint  firstIndex;
+	GLint   baseVertex;
+	GLuint  baseInstance;
+}
+drawElementsIndirectCommand_t;
+
+static GLuint multiDrawIndirectBuffer;
+
+static qboolean R_InitStreamBuffer(streamBuffer_t *sb, GLenum target, int segmentSize)
+{
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	Com_Memset(sb, 0, sizeof(*sb));
+	sb->segmentSize = segmentSize;
+	sb->size = segmentSize * TESS_STREAM_SEGMENTS;
+
+	qglGenBuffers(1, &sb->buffer);
+	qglBindBuffer(target, sb->buffer);
+	qglBufferStorage(target, sb->size, NULL, flags);
+	sb->base = qglMapBufferRange(target, 0, sb->size, flags);
+
+	return sb->base != NULL;
+}
+
+static void R_WaitStreamSegment(streamBuffer_t *sb, int segment)
+{
+	GLsync fence = sb->fences[segment];
+
+	if (!fence)
+		return;
+
+	// only stalls if the GPU is a whole ring behind us
+	while (qglClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+		;
+
+	qglDeleteSync(fence);
+	sb->fences[segment] = NULL;
+}
+
+/*
+============
+R_AllocStream
+
+Returns the offset of size writable bytes in the ring
+============
+*/
+static int R_AllocStream(streamBuffer_t *sb, int size)
+{
+	int offset, lastSegment;
+
+	offset = (sb->offset + TESS_STREAM_ALIGN - 1) & ~(TESS_STREAM_ALIGN - 1);
+	if (offset + size > sb->size)
+		offset = 0;
+
+	lastSegment = (offset + size - 1) / sb->segmentSize;
+
+	while (sb->segment != lastSegment)
+	{
+		sb->fences[sb->segment] = qglFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		sb->segment = (sb->segment + 1) % TESS_STREAM_SEGMENTS;
+		R_WaitStreamSegment(sb, sb->segment);
+	}
+
+	sb->offset = offset + size;
+
+	return offset;
+}
+
+/*
+============
+R_InitTessStream
+
+Swap the tess VAO's buffers for persistently mapped rings, keeping the
+orphaned ones if that fails.  Expects tess.vao to be bound.
+============
+*/
+static void R_InitTessStream(void)
+{
+	// a segment holds at least a full tess batch, so a batch never spans the whole ring
+	int vertexSegment = 1024 * 1024;
+	int indexSegment = 256 * 1024;
+
+	if (!glRefConfig.bufferStorage)
+		return;
+
+	if (!R_InitStreamBuffer(&tessVertexStream, GL_ARRAY_BUFFER, vertexSegment)
+		|| !R_InitStreamBuffer(&tessIndexStream, GL_ELEMENT_ARRAY_BUFFER, indexSegment))
+	{
+		ri.Printf(PRINT_WARNING, "R_InitTessStream: couldn't map streaming buffers, orphaning instead\n");
+
+		if (tessVertexStream.buffer)
+			qglDeleteBuffers(1, &tessVertexStream.buffer);
+		if (tessIndexStream.buffer)
+			qglDeleteBuffers(1, &tessIndexStream.buffer);
+
+		Com_Memset(&tessVertexStream, 0, sizeof(tessVertexStream));
+		Com_Memset(&tessIndexStream, 0, sizeof(tessIndexStream));
+
+		qglBindBuffer(GL_ARRAY_BUFFER, tess.vao->vertexesVBO);
+		qglBindBuffer(GL_ELEMENT_ARRAY_BUFFER, tess.vao->indexesIBO);
+
+		glRefConfig.bufferStorage = qfalse;
+		return;
+	}
+
+	qglDeleteBuffers(1, &tess.vao->vertexesVBO);
+	qglDeleteBuffers(1, &tess.vao->indexesIBO);
+
+	vaoBytes += tessVertexStream.size - tess.vao->vertexesSize;
+	vaoBytes += tessIndexStream.size - tess.vao->indexesSize;
+	ri.MemStatSet( "renderer.vao", vaoBytes );
+
+	tess.vao->vertexesVBO = tessVertexStream.buffer;
+	tess.vao->vertexesSize = tessVertexStream.size;
+	tess.vao->indexesIBO = tessIndexStream.buffer;
+	tess.vao->indexesSize = tessIndexStream.size;
+}
+
+static void R_ShutdownTessStream(void)
+{
+	int i;
+
+	// the buffers themselves are deleted, and so unmapped, with the tess VAO
+	for (i = 0; i < TESS_STREAM_SEGMENTS; i++)
+	{
+		if (tessVertexStream.fences[i])
+			qglDeleteSync(tessVertexStream.fences[i]);
+		if (tessIndexStream.fences[i])
+			qglDeleteSync(tessIndexStream.fences[i]);
+	}
+
+	Com_Memset(&tessVertexStream, 0, sizeof(tessVertexStream));
+	Com_Memset(&tessIndexStream, 0, sizeof(tessIndexStream));
+}
+
+/*
+==============================================================================
+
+UNIFORM STREAMING
+
+The per-draw transform of the surface shaders lives in the Entity uniform
+block.  GLSL_SetUniform* only fills in glState.entityBlock; when a draw
+finds it changed, it is copied into another persistently mapped ring and
+the range is bound, so a run of draws with the same entity costs nothing
+and a new entity costs one copy and one bind whatever the program.
+
+==============================================================================
+*/
+
+static streamBuffer_t uniformStream;
+static streamBuffer_t boneStream;
+static int entityBlockSize;
+static int boneBlockSize;
+
+static void R_DeleteStreamBuffer(streamBuffer_t *sb, GLenum target)
+{
+	int i;
+
+	if (!sb->buffer)
+		return;
+
+	for (i = 0; i < TESS_STREAM_SEGMENTS; i++)
+	{
+		if (sb->fences[i])
+			qglDeleteSync(sb->fences[i]);
+	}
+
+	qglBindBuffer(target, sb->buffer);
+	if (sb->base)
+		qglUnmapBuffer(target);
+	qglBindBuffer(target, 0);
+	qglDeleteBuffers(1, &sb->buffer);
+
+	Com_Memset(sb, 0, sizeof(*sb));
+}
+
+void R_InitUniformStream(void)
+{
+	int align;
+
+	if (!glRefConfig.uniformBufferObject)
+		return;
+
+	// every allocation is the same multiple of the offset alignment, so the cursor stays aligned
+	align = MAX(glRefConfig.uniformBufferOffsetAlignment, TESS_STREAM_ALIGN);
+	entityBlockSize = (sizeof(entityBlock_t) + align - 1) / align * align;
+	boneBlockSize = (IQM_MAX_JOINTS * sizeof(mat4_t) + align - 1) / align * align;
+
+	// bones get a ring of their own, so a Bones range left bound while
+	// only entities change isn't written over
+	if (!R_InitStreamBuffer(&uniformStream, GL_UNIFORM_BUFFER, 256 * 1024)
+		|| !R_InitStreamBuffer(&boneStream, GL_UNIFORM_BUFFER, 512 * 1024))
+	{
+		ri.Printf(PRINT_WARNING, "R_InitUniformStream: couldn't map uniform buffer, using plain uniforms\n");
+
+		R_DeleteStreamBuffer(&uniformStream, GL_UNIFORM_BUFFER);
+		R_DeleteStreamBuffer(&boneStream, GL_UNIFORM_BUFFER);
+
+		glRefConfig.uniformBufferObject = qfalse;
+		return;
+	}
+
+	qglBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	// a block has room for every joint an IQM can have, which plain
+	// uniforms often don't
+	glRefConfig.glslMaxAnimatedBones = IQM_MAX_JOINTS;
+
+	glState.entityBlockDirty = qtrue;
+	glState.boneMatrixDirty = qtrue;
+}
+
+void R_ShutdownUniformStream(void)
+{
+	R_DeleteStreamBuffer(&uniformStream, GL_UNIFORM_BUFFER);
+	R_DeleteStreamBuffer(&boneStream, GL_UNIFORM_BUFFER);
+}
+
+/*
+============
+RB_FlushUniformBlocks
+
+Called before every draw
+============
+*/
+void RB_FlushUniformBlocks(void)
+{
+	int offset;
+
+	if (glState.entityBlockDirty && uniformStream.buffer)
+	{
+		offset = R_AllocStream(&uniformStream, entityBlockSize);
+		Com_Memcpy(uniformStream.base + offset, &glState.entityBlock, sizeof(entityBlock_t));
+		qglBindBufferRange(GL_UNIFORM_BUFFER, UNIFORM_BLOCK_ENTITY, uniformStream.buffer, offset, sizeof(entityBlock_t));
+		backEnd.pc.c_uniformBlocks++;
+
+		glState.entityBlockDirty = qfalse;
+	}
+
+	// only the model's own joints are copied, the range covers the whole block
+	if (glState.boneAnimation && glState.boneMatrixDirty && boneStream.buffer)
+	{
+		offset = R_AllocStream(&boneStream, boneBlockSize);
+		Com_Memcpy(boneStream.base + offset, glState.boneMatrix, glState.boneAnimation * sizeof(mat4_t));
+		qglBindBufferRange(GL_UNIFORM_BUFFER, UNIFORM_BLOCK_BONES, boneStream.buffer, offset, IQM_MAX_JOINTS * sizeof(mat4_t));
+		backEnd.pc.c_uniformBlocks++;
+
+		glState.boneMatrixDirty = qfalse;
+	}
+}
+
+
 /*
 ============
 R_InitVaos
@@ -495,10 +863,19 @@ void R_InitVaos(void)
 	tess.attribPointers[ATTR_INDEX_COLOR]          = tess.color;
 	tess.attribPointers[ATTR_INDEX_LIGHTDIRECTION] = tess.lightdir;
 
+	R_InitTessStream();
+
 	Vao_SetVertexPointers(tess.vao);
 
 	R_BindNullVao();
 
+	if (glRefConfig.multiDrawIndirect)
+	{
+		qglGenBuffers(1, &multiDrawIndirectBuffer);
+		qglBindBuffer(GL_DRAW_INDIRECT_BUFFER, multiDrawIndirectBuffer);
+		qglBufferData(GL_DRAW_INDIRECT_BUFFER, MAX_MULTIDRAWS * sizeof(drawElementsIndirectCommand_t), NULL, GL_STREAM_DRAW);
+	}
+
 	VaoCache_Init();
 
 	GL_CheckErrors();
@@ -518,6 +895,14 @@ void R_ShutdownVaos(void)
 
 	R_BindNullVao();
 
+	R_ShutdownTessStream();
+
+	if (multiDrawIndirectBuffer)
+	{
+		qglDeleteBuffers(1, &multiDrawIndirectBuffer);
+		multiDrawIndirectBuffer = 0;
+	}
+
 	for(i = 0; i < tr.numVaos; i++)
 	{
 		vao = tr.vaos[i];
@@ -534,9 +919,20 @@ void R_ShutdownVaos(void)
 		{
 			qglDeleteBuffers(1, &vao->indexesIBO);
 		}
+
+		if(vao->depthVao)
+		{
+			if(vao->depthVao->vao)
+				qglDeleteVertexArrays(1, &vao->depthVao->vao);
+
+			if(vao->depthVao->vertexesVBO)
+				qglDeleteBuffers(1, &vao->depthVao->vertexesVBO);
+		}
 	}
 
 	tr.numVaos = 0;
+	vaoBytes = 0;
+	ri.MemStatSet( "renderer.vao", 0 );
 }
 
 /*
@@ -606,7 +1002,8 @@ void RB_UpdateTessVao(unsigned int attribBits)
 		R_BindVao(tess.vao);
 
 		// orphan old vertex buffer so we don't stall on it
-		qglBufferData(GL_ARRAY_BUFFER, tess.vao->vertexesSize, NULL, GL_DYNAMIC_DRAW);
+		if (!glRefConfig.bufferStorage)
+			qglBufferData(GL_ARRAY_BUFFER, tess.vao->vertexesSize, NULL, GL_DYNAMIC_DRAW);
 
 		// if nothing to set, set everything
 		if(!(attribBits & ATTR_BITS))
@@ -622,12 +1019,24 @@ void RB_UpdateTessVao(unsigned int attribBits)
 			if (attribUpload & attribBit)
 			{
 				// note: tess has a VBO where stride == size
-				qglBufferSubData(GL_ARRAY_BUFFER, vAtb->offset, tess.numVertexes * vAtb->stride, tess.attribPointers[attribIndex]);
+				int size = tess.numVertexes * vAtb->stride;
+
+				backEnd.pc.c_bufferUploads++;
+				backEnd.pc.c_bufferUploadBytes += size;
+
+				if (glRefConfig.bufferStorage)
+				{
+					vAtb->offset = R_AllocStream(&tessVertexStream, size);
+					Com_Memcpy(tessVertexStream.base + vAtb->offset, tess.attribPointers[attribIndex], size);
+				}
+				else
+					qglBufferSubData(GL_ARRAY_BUFFER, vAtb->offset, size, tess.attribPointers[attribIndex]);
 			}
 
 			if (attribBits & attribBit)
 			{
-				if (!glRefConfig.vertexArrayObject)
+				// streamed attributes move every batch, so always repoint them
+				if (!glRefConfig.vertexArrayObject || glRefConfig.bufferStorage)
 					qglVertexAttribPointer(attribIndex, vAtb->count, vAtb->type, vAtb->normalized, vAtb->stride, BUFFER_OFFSET(vAtb->offset));
 
 				if (!(glState.vertexAttribsEnabled & attribBit))
@@ -646,10 +1055,67 @@ void RB_UpdateTessVao(unsigned int attribBits)
 			}
 		}
 
-		// orphan old index buffer so we don't stall on it
-		qglBufferData(GL_ELEMENT_ARRAY_BUFFER, tess.vao->indexesSize, NULL, GL_DYNAMIC_DRAW);
+		backEnd.pc.c_bufferUploads++;
+		backEnd.pc.c_bufferUploadBytes += tess.numIndexes * sizeof(tess.indexes[0]);
+
+		if (glRefConfig.bufferStorage)
+		{
+			int size = tess.numIndexes * sizeof(tess.indexes[0]);
+			int offset = R_AllocStream(&tessIndexStream, size);
+
+			Com_Memcpy(tessIndexStream.base + offset, tess.indexes, size);
+			tess.streamFirstIndex = offset / sizeof(tess.indexes[0]);
+		}
+		else
+		{
+			// orphan old index buffer so we don't stall on it
+			qglBufferData(GL_ELEMENT_ARRAY_BUFFER, tess.vao->indexesSize, NULL, GL_DYNAMIC_DRAW);
+
+			qglBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, tess.numIndexes * sizeof(tess.indexes[0]), tess.indexes);
+		}
+	}
+}
+
+/*
+==============
+RB_MultiDrawElements
+
+Draw the index ranges RB_SurfaceWorldVao collected from the bound world
+VAO in a single call, through an indirect command buffer when we can.
+==============
+*/
+void RB_MultiDrawElements(void)
+{
+	int i;
+
+	if (glRefConfig.multiDrawIndirect)
+	{
+		static drawElementsIndirectCommand_t cmds[MAX_MULTIDRAWS];
+
+		for (i = 0; i < tess.numMultiDraws; i++)
+		{
+			cmds[i].count         = tess.multiDrawCount[i];
+			cmds[i].instanceCount = 1;
+			cmds[i].firstIndex    = tess.multiDrawFirst[i];
+			cmds[i].baseVertex    = 0;
+			cmds[i].baseInstance  = 0;
+		}
+
+		// orphan so we don't stall on the last batch's commands
+		qglBindBuffer(GL_DRAW_INDIRECT_BUFFER, multiDrawIndirectBuffer);
+		qglBufferData(GL_DRAW_INDIRECT_BUFFER, MAX_MULTIDRAWS * sizeof(cmds[0]), NULL, GL_STREAM_DRAW);
+		qglBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, tess.numMultiDraws * sizeof(cmds[0]), cmds);
+
+		qglMultiDrawElementsIndirect(GL_TRIANGLES, GL_INDEX_TYPE, NULL, tess.numMultiDraws, 0);
+	}
+	else
+	{
+		static const void *offsets[MAX_MULTIDRAWS];
+
+		for (i = 0; i < tess.numMultiDraws; i++)
+			offsets[i] = BUFFER_OFFSET(tess.multiDrawFirst[i] * sizeof(glIndex_t));
 
-		qglBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, tess.numIndexes * sizeof(tess.indexes[0]), tess.indexes);
+		qglMultiDrawElements(GL_TRIANGLES, tess.multiDrawCount, GL_INDEX_TYPE, offsets, tess.numMultiDraws);
 	}
 }
 
@@ -21,6 +21,36 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 #include "tr_local.h"
 
+// CoD1 occluder shadow frusta for the current view, see R_MarkOccluders
+static cplane_t	viewOccluderPlanes[MAX_VIEW_OCCLUDERS][MAX_OCCLUDER_PLANES];
+static int		viewOccluderNumPlanes[MAX_VIEW_OCCLUDERS];
+static int		numViewOccluders;
+
+/*
+================
+R_BoxOccluded
+
+Returns qtrue if the box is completely inside one of the view's occluder
+shadow frusta
+================
+*/
+static qboolean R_BoxOccluded( vec3_t mins, vec3_t maxs ) {
+	int		i, j;
+
+	for ( i = 0; i < numViewOccluders; i++ ) {
+		for ( j = 0; j < viewOccluderNumPlanes[i]; j++ ) {
+			if ( BoxOnPlaneSide( mins, maxs, &viewOccluderPlanes[i][j] ) != 1 ) {
+				break;
+			}
+		}
+		if ( j == viewOccluderNumPlanes[i] ) {
+			tr.pc.c_occluded++;
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
 
 
 /*
@@ -213,7 +243,7 @@ static int R_DlightSurface( msurface_t *surf, int dlightBits ) {
 		case SF_FACE:
 		case SF_GRID:
 		case SF_TRIANGLES:
-			((srfBspSurface_t *)surf->data)->dlightBits = dlightBits;
+			((srfBspSurface_t *)surf->data)->dlightBits[ tr.smpFrame ] = dlightBits;
 			break;
 
 		default:
@@ -298,7 +328,7 @@ static int R_PshadowSurface( msurface_t *surf, int pshadowBits ) {
 		case SF_FACE:
 		case SF_GRID:
 		case SF_TRIANGLES:
-			((srfBspSurface_t *)surf->data)->pshadowBits = pshadowBits;
+			((srfBspSurface_t *)surf->data)->pshadowBits[ tr.smpFrame ] = pshadowBits;
 			break;
 
 		default:
@@ -414,58 +444,18 @@ static void R_RecursiveWorldNode( mnode_t *node, uint32_t planeBits, uint32_t dl
 		// if the bounding volume is outside the frustum, nothing
 		// inside can be visible OPTIMIZE: don't do this all the way to leafs?
 
-		if ( !r_nocull->integer ) {
+		if ( !r_nocull->integer && planeBits ) {
 			int		r;
 
-			if ( planeBits & 1 ) {
-				r = BoxOnPlaneSide(node->mins, node->maxs, &tr.viewParms.frustum[0]);
-				if (r == 2) {
-					return;						// culled
-				}
-				if ( r == 1 ) {
-					planeBits &= ~1;			// all descendants will also be in front
-				}
-			}
-
-			if ( planeBits & 2 ) {
-				r = BoxOnPlaneSide(node->mins, node->maxs, &tr.viewParms.frustum[1]);
-				if (r == 2) {
-					return;						// culled
-				}
-				if ( r == 1 ) {
-					planeBits &= ~2;			// all descendants will also be in front
-				}
-			}
-
-			if ( planeBits & 4 ) {
-				r = BoxOnPlaneSide(node->mins, node->maxs, &tr.viewParms.frustum[2]);
-				if (r == 2) {
-					return;						// culled
-				}
-				if ( r == 1 ) {
-					planeBits &= ~4;			// all descendants will also be in front
-				}
-			}
-
-			if ( planeBits & 8 ) {
-				r = BoxOnPlaneSide(node->mins, node->maxs, &tr.viewParms.frustum[3]);
-				if (r == 2) {
-					return;						// culled
-				}
-				if ( r == 1 ) {
-					planeBits &= ~8;			// all descendants will also be in front
-				}
+			r = BoxCullPlanes( node->mins, node->maxs, tr.viewParms.frustum, 5, planeBits );
+			if ( r < 0 ) {
+				return;						// culled
 			}
+			planeBits = r;					// descendants are in front of the planes this node is
+		}
 
-			if ( planeBits & 16 ) {
-				r = BoxOnPlaneSide(node->mins, node->maxs, &tr.viewParms.frustum[4]);
-				if (r == 2) {
-					return;						// culled
-				}
-				if ( r == 1 ) {
-					planeBits &= ~16;			// all descendants will also be in front
-				}
-			}
+		if ( numViewOccluders && R_BoxOccluded( node->mins, node->maxs ) ) {
+			return;
 		}
 
 		if ( node->contents != -1 ) {
@@ -536,6 +526,12 @@ static void R_RecursiveWorldNode( mnode_t *node, uint32_t planeBits, uint32_t dl
 		int			c;
 		int surf, *view;
 
+		// CoD1 cell not reached by the portal walk
+		if ( tr.world->cellsActive && node->cell >= 0 &&
+			tr.world->cells[node->cell].visFrame != tr.world->cellFrame ) {
+			return;
+		}
+
 		tr.pc.c_leafs++;
 
 		// add to z buffer bounds
@@ -579,6 +575,26 @@ static void R_RecursiveWorldNode( mnode_t *node, uint32_t planeBits, uint32_t dl
 			}
 			view++;
 		}
+
+		// and the static models standing in it
+		view = tr.world->leafStaticModels + node->firstStaticModel;
+
+		c = node->numStaticModels;
+		while (c--) {
+			surf = *view;
+			if (tr.world->staticModelsViewCount[surf] != tr.viewCount)
+			{
+				tr.world->staticModelsViewCount[surf] = tr.viewCount;
+				tr.world->staticModelsDlightBits[surf] = dlightBits;
+				tr.world->staticModelsPshadowBits[surf] = pshadowBits;
+			}
+			else
+			{
+				tr.world->staticModelsDlightBits[surf] |= dlightBits;
+				tr.world->staticModelsPshadowBits[surf] |= pshadowBits;
+			}
+			view++;
+		}
 	}
 
 }
@@ -589,7 +605,7 @@ static void R_RecursiveWorldNode( mnode_t *node, uint32_t planeBits, uint32_t dl
 R_PointInLeaf
 ===============
 */
-static mnode_t *R_PointInLeaf( const vec3_t p ) {
+mnode_t *R_PointInLeaf( const vec3_t p ) {
 	mnode_t		*node;
 	float		d;
 	cplane_t	*plane;
@@ -647,6 +663,362 @@ qboolean R_inPVS( const vec3_t p1, const vec3_t p2 ) {
 	return qtrue;
 }
 
+/*
+===============================================================================
+
+CoD1 CELL / PORTAL VISIBILITY
+
+===============================================================================
+*/
+
+#define	MAX_PORTAL_DEPTH	32
+
+/*
+=================
+R_ClipPortalWinding
+
+Clips a convex winding to the front side of a plane, returns the new
+number of points
+=================
+*/
+static int R_ClipPortalWinding( vec3_t *in, int numIn, vec3_t *out, const cplane_t *plane ) {
+	float	dists[MAX_PORTAL_VERTS];
+	int		i, numOut;
+
+	for ( i = 0; i < numIn; i++ ) {
+		dists[i] = DotProduct( in[i], plane->normal ) - plane->dist;
+	}
+
+	numOut = 0;
+	for ( i = 0; i < numIn && numOut < MAX_PORTAL_VERTS - 1; i++ ) {
+		int		next = ( i + 1 ) % numIn;
+		float	frac;
+
+		if ( dists[i] >= 0 ) {
+			VectorCopy( in[i], out[numOut] );
+			numOut++;
+		}
+
+		if ( ( dists[i] >= 0 ) == ( dists[next] >= 0 ) ) {
+			continue;
+		}
+
+		frac = dists[i] / ( dists[i] - dists[next] );
+		out[numOut][0] = in[i][0] + frac * ( in[next][0] - in[i][0] );
+		out[numOut][1] = in[i][1] + frac * ( in[next][1] - in[i][1] );
+		out[numOut][2] = in[i][2] + frac * ( in[next][2] - in[i][2] );
+		numOut++;
+	}
+
+	return numOut;
+}
+
+/*
+=================
+R_WalkCell
+
+Marks a cell as visible and recurses through every portal that is still
+inside the (narrowed) view frustum
+=================
+*/
+static void R_WalkCell( mcell_t *cell, const cplane_t *planes, int numPlanes, int depth ) {
+	vec3_t		winding[2][MAX_PORTAL_VERTS];
+	cplane_t	newPlanes[MAX_PORTAL_VERTS];
+	mportal_t	*portal;
+	const float	*eye = tr.viewParms.or.origin;
+	int			i, j;
+
+	if ( cell->visFrame != tr.world->cellFrame ) {
+		cell->visFrame = tr.world->cellFrame;
+		tr.pc.c_cells++;
+	}
+
+	if ( depth >= MAX_PORTAL_DEPTH ) {
+		return;
+	}
+
+	cell->onStack = qtrue;
+
+	for ( i = 0, portal = tr.world->portals + cell->firstPortal; i < cell->numPortals; i++, portal++ ) {
+		mcell_t		*dest = tr.world->cells + portal->cell;
+		int			numVerts, cur;
+		float		d;
+
+		if ( dest->onStack ) {
+			continue;
+		}
+
+		// a portal the eye is standing in can't narrow anything
+		d = DotProduct( eye, portal->plane.normal ) - portal->plane.dist;
+		if ( d > -1.0f && d < 1.0f ) {
+			tr.pc.c_portals++;
+			R_WalkCell( dest, planes, numPlanes, depth + 1 );
+			continue;
+		}
+
+		Com_Memcpy( winding[0], portal->verts, portal->numVerts * sizeof( vec3_t ) );
+		numVerts = portal->numVerts;
+		cur = 0;
+
+		for ( j = 0; j < numPlanes && numVerts >= 3; j++ ) {
+			numVerts = R_ClipPortalWinding( winding[cur], numVerts, winding[cur ^ 1], &planes[j] );
+			cur ^= 1;
+		}
+
+		if ( numVerts < 3 ) {
+			continue;
+		}
+
+		tr.pc.c_portals++;
+
+		// build a frustum from the eye through each edge of the clipped portal
+		for ( j = 0; j < numVerts; j++ ) {
+			cplane_t	*p = &newPlanes[j];
+			vec3_t		v1, v2;
+
+			VectorSubtract( winding[cur][j], eye, v1 );
+			VectorSubtract( winding[cur][( j + 1 ) % numVerts], eye, v2 );
+			CrossProduct( v1, v2, p->normal );
+			if ( VectorNormalize( p->normal ) == 0.0f ) {
+				break;
+			}
+			p->dist = DotProduct( eye, p->normal );
+
+			// face the plane toward the winding
+			if ( DotProduct( winding[cur][( j + 2 ) % numVerts], p->normal ) - p->dist < 0 ) {
+				VectorNegate( p->normal, p->normal );
+				p->dist = -p->dist;
+			}
+			p->type = PLANE_NON_AXIAL;
+			SetPlaneSignbits( p );
+		}
+
+		if ( j < numVerts ) {
+			R_WalkCell( dest, planes, numPlanes, depth + 1 );
+		} else {
+			R_WalkCell( dest, newPlanes, numVerts, depth + 1 );
+		}
+	}
+
+	cell->onStack = qfalse;
+}
+
+/*
+=================
+R_MarkCells
+
+Flood the CoD1 cell graph from the view cell through the portals
+that survive frustum clipping.  Leafs in cells that weren't reached
+are skipped by R_RecursiveWorldNode.
+=================
+*/
+static void R_MarkCells( void ) {
+	mnode_t		*leaf;
+
+	tr.world->cellsActive = qfalse;
+
+	if ( !tr.world->numCells || !r_cellPortals->integer || r_novis->integer || r_lockpvs->integer ) {
+		return;
+	}
+
+	if ( tr.viewParms.flags & ( VPF_SHADOWMAP | VPF_DEPTHSHADOW | VPF_ORTHOGRAPHIC ) ) {
+		return;
+	}
+
+	leaf = R_PointInLeaf( tr.viewParms.or.origin );
+	if ( leaf->cell < 0 ) {
+		return;
+	}
+
+	tr.world->cellFrame++;
+	tr.world->cellsActive = qtrue;
+
+	R_WalkCell( tr.world->cells + leaf->cell, tr.viewParms.frustum, 4, 0 );
+}
+
+/*
+=================
+R_AddViewOccluder
+
+Builds the shadow frustum of a convex occluder: the front facing planes
+flipped, plus a plane through the eye and each silhouette edge.  Every
+plane faces into the occluded region.
+=================
+*/
+static void R_AddViewOccluder( moccluder_t *occ, const float *dists ) {
+	cplane_t	*out = viewOccluderPlanes[numViewOccluders];
+	int			i, numPlanes = 0;
+
+	for ( i = 0; i < occ->numPlanes; i++ ) {
+		cplane_t	*p = tr.world->occluderPlanes[occ->firstPlane + i];
+
+		if ( dists[i] <= 0 ) {
+			continue;
+		}
+
+		VectorNegate( p->normal, out[numPlanes].normal );
+		out[numPlanes].dist = -p->dist;
+		out[numPlanes].type = PLANE_NON_AXIAL;
+		SetPlaneSignbits( &out[numPlanes] );
+		numPlanes++;
+	}
+
+	for ( i = 0; i < occ->numEdges; i++ ) {
+		unsigned short	*edge = tr.world->occluderEdges[occ->firstEdge + i];
+		cplane_t		*a, *b;
+		float			da = dists[edge[0]], db = dists[edge[1]];
+		float			len;
+
+		// silhouette edges join a front and a back facing plane
+		if ( ( da > 0 ) == ( db > 0 ) ) {
+			continue;
+		}
+		if ( da <= 0 ) {
+			float	t = da;
+			da = db;
+			db = t;
+			a = tr.world->occluderPlanes[occ->firstPlane + edge[1]];
+			b = tr.world->occluderPlanes[occ->firstPlane + edge[0]];
+		} else {
+			a = tr.world->occluderPlanes[occ->firstPlane + edge[0]];
+			b = tr.world->occluderPlanes[occ->firstPlane + edge[1]];
+		}
+
+		// the combination of the two planes that contains the eye,
+		// positive on the occluder's side
+		out[numPlanes].normal[0] = db * a->normal[0] - da * b->normal[0];
+		out[numPlanes].normal[1] = db * a->normal[1] - da * b->normal[1];
+		out[numPlanes].normal[2] = db * a->normal[2] - da * b->normal[2];
+		out[numPlanes].dist = db * a->dist - da * b->dist;
+
+		len = VectorNormalize( out[numPlanes].normal );
+		if ( len == 0.0f ) {
+			return;
+		}
+		out[numPlanes].dist /= len;
+		out[numPlanes].type = PLANE_NON_AXIAL;
+		SetPlaneSignbits( &out[numPlanes] );
+		numPlanes++;
+	}
+
+	if ( numPlanes < 4 ) {
+		return;		// not a closed volume
+	}
+
+	viewOccluderNumPlanes[numViewOccluders] = numPlanes;
+	numViewOccluders++;
+	tr.pc.c_occluders++;
+}
+
+/*
+=================
+R_MarkOccluders
+
+Picks the nearest CoD1 occluders in the reached cells (or the whole map
+without a cell walk) and builds their shadow frusta for this view
+=================
+*/
+static void R_MarkOccluders( void ) {
+	moccluder_t	*best[MAX_VIEW_OCCLUDERS];
+	float		bestDist[MAX_VIEW_OCCLUDERS];
+	float		dists[MAX_OCCLUDER_PLANES];
+	int			numBest, maxOccluders;
+	int			i, j, k, c;
+
+	numViewOccluders = 0;
+
+	maxOccluders = r_occluders->integer;
+	if ( !tr.world->numOccluders || maxOccluders <= 0 || r_nocull->integer ) {
+		return;
+	}
+
+	if ( tr.viewParms.flags & ( VPF_SHADOWMAP | VPF_DEPTHSHADOW | VPF_ORTHOGRAPHIC ) ) {
+		return;
+	}
+
+	if ( maxOccluders > MAX_VIEW_OCCLUDERS ) {
+		maxOccluders = MAX_VIEW_OCCLUDERS;
+	}
+
+	tr.world->occluderFrame++;
+	numBest = 0;
+
+	for ( c = 0; c < ( tr.world->cellsActive ? tr.world->numCells : 1 ); c++ ) {
+		int		first, count;
+
+		if ( tr.world->cellsActive ) {
+			mcell_t	*cell = tr.world->cells + c;
+
+			if ( cell->visFrame != tr.world->cellFrame ) {
+				continue;
+			}
+			first = cell->firstOccluder;
+			count = cell->numOccluders;
+		} else {
+			first = 0;
+			count = tr.world->numOccluders;
+		}
+
+		for ( i = 0; i < count; i++ ) {
+			moccluder_t	*occ;
+			float		dist;
+
+			if ( tr.world->cellsActive ) {
+				occ = tr.world->occluders + tr.world->occluderIndices[first + i];
+			} else {
+				occ = tr.world->occluders + i;
+			}
+
+			if ( occ->frameCount == tr.world->occluderFrame || !occ->numPlanes ) {
+				continue;
+			}
+			occ->frameCount = tr.world->occluderFrame;
+
+			// the largest plane distance is a lower bound on the distance
+			// to a convex volume, and isn't positive if the eye is inside
+			dist = -1;
+			for ( j = 0; j < occ->numPlanes; j++ ) {
+				cplane_t	*p = tr.world->occluderPlanes[occ->firstPlane + j];
+				float		d = DotProduct( tr.viewParms.or.origin, p->normal ) - p->dist;
+
+				if ( d > dist ) {
+					dist = d;
+				}
+			}
+			if ( dist <= 0 ) {
+				continue;
+			}
+
+			// insertion sort into the nearest list
+			for ( k = numBest; k > 0 && bestDist[k - 1] > dist; k-- ) {
+				if ( k < maxOccluders ) {
+					best[k] = best[k - 1];
+					bestDist[k] = bestDist[k - 1];
+				}
+			}
+			if ( k < maxOccluders ) {
+				best[k] = occ;
+				bestDist[k] = dist;
+				if ( numBest < maxOccluders ) {
+					numBest++;
+				}
+			}
+		}
+	}
+
+	for ( i = 0; i < numBest; i++ ) {
+		moccluder_t	*occ = best[i];
+
+		for ( j = 0; j < occ->numPlanes; j++ ) {
+			cplane_t	*p = tr.world->occluderPlanes[occ->firstPlane + j];
+
+			dists[j] = DotProduct( tr.viewParms.or.origin, p->normal ) - p->dist;
+		}
+
+		R_AddViewOccluder( occ, dists );
+	}
+}
+
 /*
 ===============
 R_MarkLeaves
@@ -733,6 +1105,307 @@ static void R_MarkLeaves (void) {
 }
 
 
+/*
+================
+R_CullAabbTree
+
+Rejects whole CoD1 AABB tree subtrees against the frustum, and stamps the
+surfaces of every cull group that may be visible
+================
+*/
+static void R_CullAabbTree( maabbtree_t *tree, uint32_t planeBits ) {
+	int		i, j, child;
+
+	if ( planeBits ) {
+		for ( i = 0; i < 5; i++ ) {
+			int		r;
+
+			if ( !( planeBits & ( 1 << i ) ) ) {
+				continue;
+			}
+
+			r = BoxOnPlaneSide( tree->bounds[0], tree->bounds[1], &tr.viewParms.frustum[i] );
+			if ( r == 2 ) {
+				tr.pc.c_aabb_out++;
+				return;
+			}
+			if ( r == 1 ) {
+				planeBits &= ~( 1 << i );	// all descendants will also be in front
+			}
+		}
+	}
+
+	if ( R_HizOccluded( tree->bounds ) ) {
+		return;
+	}
+
+	if ( planeBits ) {
+		tr.pc.c_aabb_clip++;
+	} else {
+		tr.pc.c_aabb_in++;
+	}
+
+	for ( i = 0; i < tree->numCullGroups; i++ ) {
+		mcullgroup_t	*group = tr.world->cullGroups + tree->firstCullGroup + i;
+		int				*surf;
+
+		if ( planeBits ) {
+			for ( j = 0; j < 5; j++ ) {
+				if ( ( planeBits & ( 1 << j ) ) &&
+					BoxOnPlaneSide( group->bounds[0], group->bounds[1], &tr.viewParms.frustum[j] ) == 2 ) {
+					break;
+				}
+			}
+			if ( j < 5 ) {
+				continue;
+			}
+		}
+
+		if ( R_HizOccluded( group->bounds ) ) {
+			continue;
+		}
+
+		surf = tr.world->cullGroupSurfaces + group->firstSurface;
+		for ( j = 0; j < group->numSurfaces; j++ ) {
+			tr.world->surfacesTreeCount[surf[j]] = tr.viewCount;
+		}
+	}
+
+	child = tree - tr.world->aabbTrees + 1;
+	for ( i = 0; i < tree->numChildren; i++ ) {
+		R_CullAabbTree( tr.world->aabbTrees + child, planeBits );
+		child = tr.world->aabbTrees[child].next;
+	}
+}
+
+/*
+================
+R_CullAabbTrees
+
+Returns qtrue if surfacesTreeCount is valid for this view
+================
+*/
+static qboolean R_CullAabbTrees( void ) {
+	uint32_t	planeBits;
+	int			i;
+
+	if ( !tr.world->numAabbTrees || !r_aabbTreeCull->integer || r_nocull->integer ) {
+		return qfalse;
+	}
+
+	planeBits = (tr.viewParms.flags & VPF_FARPLANEFRUSTUM) ? 31 : 15;
+
+	if ( tr.world->cellsActive ) {
+		for ( i = 0; i < tr.world->numCells; i++ ) {
+			mcell_t	*cell = tr.world->cells + i;
+
+			if ( cell->visFrame == tr.world->cellFrame && cell->aabbTree >= 0 ) {
+				R_CullAabbTree( tr.world->aabbTrees + cell->aabbTree, planeBits );
+			}
+		}
+	} else {
+		for ( i = 0; i < tr.world->numAabbTrees; i = tr.world->aabbTrees[i].next ) {
+			R_CullAabbTree( tr.world->aabbTrees + i, planeBits );
+		}
+	}
+
+	return qtrue;
+}
+
+/*
+=============
+R_AddStaticModelSurfaces
+
+Adds the baked static models the leaf walk reached, after a box test
+against the frustum and the occluders
+=============
+*/
+static void R_AddStaticModelSurfaces( uint32_t planeBits ) {
+	int		i, j;
+
+	for ( i = 0; i < tr.world->numStaticModels; i++ ) {
+		mstaticModel_t	*sm = tr.world->staticModels + i;
+
+		if ( tr.world->staticModelsViewCount[i] != tr.viewCount ) {
+			continue;
+		}
+
+		if ( !r_nocull->integer ) {
+			for ( j = 0; j < 5; j++ ) {
+				if ( ( planeBits & ( 1 << j ) ) &&
+					BoxOnPlaneSide( sm->bounds[0], sm->bounds[1], &tr.viewParms.frustum[j] ) == 2 ) {
+					break;
+				}
+			}
+			if ( j < 5 ) {
+				continue;
+			}
+
+			if ( numViewOccluders && R_BoxOccluded( sm->bounds[0], sm->bounds[1] ) ) {
+				continue;
+			}
+
+			if ( R_HizOccluded( sm->bounds ) ) {
+				continue;
+			}
+		}
+
+		for ( j = 0; j < sm->numSurfaces; j++ ) {
+			R_AddWorldSurface( tr.world->staticSurfaces + sm->firstSurface + j,
+				tr.world->staticModelsDlightBits[i], tr.world->staticModelsPshadowBits[i] );
+		}
+		tr.refdef.dlightMask |= tr.world->staticModelsDlightBits[i];
+	}
+}
+
+/*
+=============
+R_StaticModelHash
+=============
+*/
+int R_StaticModelHash( qhandle_t hModel, const vec3_t origin ) {
+	unsigned	hash;
+
+	hash = hModel * 31u + (unsigned)(int)floor( origin[0] ) * 73856093u;
+	hash ^= (unsigned)(int)floor( origin[1] ) * 19349663u;
+	hash ^= (unsigned)(int)floor( origin[2] ) * 83492791u;
+
+	return hash & ( STATIC_MODEL_HASH - 1 );
+}
+
+/*
+=============
+R_StaticModelEntity
+
+Returns qtrue if ent is the entity cgame sends for a baked static model
+=============
+*/
+qboolean R_StaticModelEntity( const refEntity_t *ent ) {
+	int		i;
+
+	if ( !tr.world || !tr.world->numStaticModels ) {
+		return qfalse;
+	}
+
+	if ( ent->reType != RT_MODEL || ent->renderfx || ent->frame || ent->oldframe ||
+		ent->customShader || ent->customSkin || ent->skinNum || ent->nonNormalizedAxes ) {
+		return qfalse;
+	}
+
+	for ( i = tr.world->staticModelHash[R_StaticModelHash( ent->hModel, ent->origin )]; i >= 0; i = tr.world->staticModels[i].hashNext ) {
+		mstaticModel_t	*sm = tr.world->staticModels + i;
+
+		if ( sm->hModel == ent->hModel && VectorCompare( sm->origin, ent->origin ) &&
+			DotProduct( sm->forward, ent->axis[0] ) > 0.999f ) {
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
+
+/*
+=============
+R_RankCells
+
+Ranks the cells by the distance from the view origin to their bounds,
+nearest first.  Cells the portal walk didn't reach all share the last
+rank, which is also where soups outside any cell go.  Returns the number
+of ranks.
+=============
+*/
+static int R_CellDistCompare( const void *a, const void *b ) {
+	float da = tr.world->cellDist[*(const int *)a];
+	float db = tr.world->cellDist[*(const int *)b];
+
+	if ( da != db ) {
+		return da < db ? -1 : 1;
+	}
+
+	return *(const int *)a - *(const int *)b;
+}
+
+static int R_RankCells( void ) {
+	int i, j, numOrdered;
+
+	numOrdered = 0;
+	for ( i = 0; i < tr.world->numCells; i++ ) {
+		mcell_t *cell = &tr.world->cells[i];
+		float    dist = 0;
+
+		if ( tr.world->cellsActive && cell->visFrame != tr.world->cellFrame ) {
+			continue;
+		}
+
+		for ( j = 0; j < 3; j++ ) {
+			float d = 0;
+
+			if ( tr.viewParms.or.origin[j] < cell->bounds[0][j] ) {
+				d = cell->bounds[0][j] - tr.viewParms.or.origin[j];
+			} else if ( tr.viewParms.or.origin[j] > cell->bounds[1][j] ) {
+				d = tr.viewParms.or.origin[j] - cell->bounds[1][j];
+			}
+			dist += d * d;
+		}
+
+		tr.world->cellDist[i] = dist;
+		tr.world->cellOrder[numOrdered++] = i;
+	}
+
+	qsort( tr.world->cellOrder, numOrdered, sizeof( int ), R_CellDistCompare );
+
+	for ( i = 0; i < tr.world->numCells; i++ ) {
+		tr.world->cellRank[i] = numOrdered;
+	}
+
+	for ( i = 0; i < numOrdered; i++ ) {
+		tr.world->cellRank[tr.world->cellOrder[i]] = i;
+	}
+
+	return numOrdered + 1;
+}
+
+/*
+=============
+R_SortSurfacesFrontToBack
+
+Reorders the accepted world soups by the rank of their cell, keeping the
+static vao order within a cell.  The draw surface sort is stable, so every
+shader's soups then reach the back end nearest cell first, which lets the
+depth prepass reject more of the far geometry.  The shader order itself
+can't change, there is no room left in the sort key for a depth.
+=============
+*/
+static int *R_SortSurfacesFrontToBack( int numVisible ) {
+	int *counts, numRanks, i;
+
+	numRanks = R_RankCells();
+
+	// the cell order isn't needed once the ranks are handed out
+	counts = tr.world->cellOrder;
+	Com_Memset( counts, 0, numRanks * sizeof( int ) );
+
+	for ( i = 0; i < numVisible; i++ ) {
+		int cell = tr.world->surfacesCell[tr.world->surfacesVisible[i]];
+
+		counts[cell < 0 ? numRanks - 1 : tr.world->cellRank[cell]]++;
+	}
+
+	for ( i = 1; i < numRanks; i++ ) {
+		counts[i] += counts[i - 1];
+	}
+
+	// walk backwards so equal ranks keep their order
+	for ( i = numVisible - 1; i >= 0; i-- ) {
+		int surf = tr.world->surfacesVisible[i];
+		int cell = tr.world->surfacesCell[surf];
+
+		tr.world->surfacesSorted[--counts[cell < 0 ? numRanks - 1 : tr.world->cellRank[cell]]] = surf;
+	}
+
+	return tr.world->surfacesSorted;
+}
+
 /*
 =============
 R_AddWorldSurfaces
@@ -740,6 +1413,7 @@ R_AddWorldSurfaces
 */
 void R_AddWorldSurfaces (void) {
 	uint32_t planeBits, dlightBits, pshadowBits;
+	qboolean treeCulled;
 
 	if ( !r_drawworld->integer ) {
 		return;
@@ -756,6 +1430,9 @@ void R_AddWorldSurfaces (void) {
 	if (!(tr.viewParms.flags & VPF_DEPTHSHADOW))
 		R_MarkLeaves ();
 
+	R_MarkCells ();
+	R_MarkOccluders ();
+
 	// clear out the visible min/max
 	ClearBounds( tr.viewParms.visBounds[0], tr.viewParms.visBounds[1] );
 
@@ -788,22 +1465,56 @@ void R_AddWorldSurfaces (void) {
 
 	R_RecursiveWorldNode( tr.world->nodes, planeBits, dlightBits, pshadowBits);
 
+	treeCulled = R_CullAabbTrees();
+
 	// now add all the potentially visible surfaces
 	// also mask invisible dlights for next frame
 	{
-		int i;
+		int i, j, numVisible, *visible;
+		qboolean frontToBack = r_frontToBack->integer && tr.world->surfacesSorted;
 
 		tr.refdef.dlightMask = 0;
+		numVisible = 0;
 
-		for (i = 0; i < tr.world->numWorldSurfaces; i++)
+		for (j = 0; j < tr.world->numWorldSurfaces; j++)
 		{
+			i = tr.world->surfacesDrawOrder ? tr.world->surfacesDrawOrder[j] : j;
+
 			if (tr.world->surfacesViewCount[i] != tr.viewCount)
 				continue;
 
+			if (treeCulled && tr.world->surfacesInTree[i] && tr.world->surfacesTreeCount[i] != tr.viewCount)
+				continue;
+
+			if (numViewOccluders && (tr.world->surfaces[i].cullinfo.type & CULLINFO_BOX) &&
+				R_BoxOccluded(tr.world->surfaces[i].cullinfo.bounds[0], tr.world->surfaces[i].cullinfo.bounds[1]))
+				continue;
+
+			if (frontToBack)
+			{
+				tr.world->surfacesVisible[numVisible++] = i;
+				continue;
+			}
+
 			R_AddWorldSurface( tr.world->surfaces + i, tr.world->surfacesDlightBits[i], tr.world->surfacesPshadowBits[i] );
 			tr.refdef.dlightMask |= tr.world->surfacesDlightBits[i];
 		}
 
+		if (numVisible)
+		{
+			visible = R_SortSurfacesFrontToBack( numVisible );
+
+			for (j = 0; j < numVisible; j++)
+			{
+				i = visible[j];
+
+				R_AddWorldSurface( tr.world->surfaces + i, tr.world->surfacesDlightBits[i], tr.world->surfacesPshadowBits[i] );
+				tr.refdef.dlightMask |= tr.world->surfacesDlightBits[i];
+			}
+		}
+
+		R_AddStaticModelSurfaces( planeBits );
+
 		tr.refdef.dlightMask = ~tr.refdef.dlightMask;
 	}
 }
@@ -60,6 +60,7 @@ int qglesMajorVersion, qglesMinorVersion;
 void (APIENTRYP qglActiveTextureARB) (GLenum texture);
 void (APIENTRYP qglClientActiveTextureARB) (GLenum texture);
 void (APIENTRYP qglMultiTexCoord2fARB) (GLenum target, GLfloat s, GLfloat t);
+void (APIENTRYP qglCompressedTexImage2DARB) (GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void *data);
 
 void (APIENTRYP qglLockArraysEXT) (GLint first, GLsizei count);
 void (APIENTRYP qglUnlockArraysEXT) (void);
@@ -78,6 +79,16 @@ QGL_3_0_PROCS;
 QGL_ARB_occlusion_query_PROCS;
 QGL_ARB_framebuffer_object_PROCS;
 QGL_ARB_vertex_array_object_PROCS;
+QGL_ARB_map_buffer_range_PROCS;
+QGL_ARB_sync_PROCS;
+QGL_ARB_buffer_storage_PROCS;
+QGL_EXT_multi_draw_arrays_PROCS;
+QGL_ARB_multi_draw_indirect_PROCS;
+QGL_ARB_get_program_binary_PROCS;
+QGL_ARB_uniform_buffer_object_PROCS;
+QGL_ARB_multi_bind_PROCS;
+QGL_ARB_timer_query_PROCS;
+QGL_KHR_parallel_shader_compile_PROCS;
 QGL_EXT_direct_state_access_PROCS;
 #undef GLE
 
@@ -375,11 +386,22 @@ static void GLimp_ClearProcAddresses( void ) {
 	QGL_ARB_occlusion_query_PROCS;
 	QGL_ARB_framebuffer_object_PROCS;
 	QGL_ARB_vertex_array_object_PROCS;
+	QGL_ARB_map_buffer_range_PROCS;
+	QGL_ARB_sync_PROCS;
+	QGL_ARB_buffer_storage_PROCS;
+	QGL_EXT_multi_draw_arrays_PROCS;
+	QGL_ARB_multi_draw_indirect_PROCS;
+	QGL_ARB_get_program_binary_PROCS;
+	QGL_ARB_uniform_buffer_object_PROCS;
+	QGL_ARB_multi_bind_PROCS;
+	QGL_ARB_timer_query_PROCS;
+	QGL_KHR_parallel_shader_compile_PROCS;
 	QGL_EXT_direct_state_access_PROCS;
 
 	qglActiveTextureARB = NULL;
 	qglClientActiveTextureARB = NULL;
 	qglMultiTexCoord2fARB = NULL;
+	qglCompressedTexImage2DARB = NULL;
 
 	qglLockArraysEXT = NULL;
 	qglUnlockArraysEXT = NULL;
@@ -900,6 +922,7 @@ static void GLimp_InitExtensions( qboolean fixedFunction )
 	ri.Printf( PRINT_ALL, "Initializing OpenGL extensions\n" );
 
 	glConfig.textureCompression = TC_NONE;
+	qglCompressedTexImage2DARB = NULL;
 
 	// GL_EXT_texture_compression_s3tc
 	if ( ( QGLES_VERSION_ATLEAST( 2, 0 ) || SDL_GL_ExtensionSupported( "GL_ARB_texture_compression" ) ) &&
@@ -909,6 +932,11 @@ static void GLimp_InitExtensions( qboolean fixedFunction )
 		{
 			glConfig.textureCompression = TC_S3TC_ARB;
 			ri.Printf( PRINT_ALL, "...using GL_EXT_texture_compression_s3tc\n" );
+
+			// lets the GL1 renderer upload DDS blocks without decoding them
+			qglCompressedTexImage2DARB = SDL_GL_GetProcAddress( "glCompressedTexImage2DARB" );
+			if ( !qglCompressedTexImage2DARB )
+				qglCompressedTexImage2DARB = SDL_GL_GetProcAddress( "glCompressedTexImage2D" );
 		}
 		else
 		{
@@ -1026,6 +1054,33 @@ static void GLimp_InitExtensions( qboolean fixedFunction )
 		{
 			ri.Printf( PRINT_ALL, "...GL_EXT_compiled_vertex_array not found\n" );
 		}
+
+		// GL_ARB_vertex_buffer_object, core since OpenGL 1.5
+		if ( QGL_VERSION_ATLEAST( 1, 5 ) )
+		{
+			ri.Printf( PRINT_ALL, "...using OpenGL 1.5 vertex buffer objects\n" );
+#define GLE( ret, name, ... ) qgl##name = (name##proc *) SDL_GL_GetProcAddress( "gl" #name );
+			QGL_1_5_PROCS;
+#undef GLE
+		}
+		else if ( SDL_GL_ExtensionSupported( "GL_ARB_vertex_buffer_object" ) )
+		{
+			ri.Printf( PRINT_ALL, "...using GL_ARB_vertex_buffer_object\n" );
+#define GLE( ret, name, ... ) qgl##name = (name##proc *) SDL_GL_GetProcAddress( "gl" #name "ARB" );
+			QGL_1_5_PROCS;
+#undef GLE
+		}
+		else
+		{
+			ri.Printf( PRINT_ALL, "...GL_ARB_vertex_buffer_object not found\n" );
+		}
+
+		if ( !qglBindBuffer || !qglDeleteBuffers || !qglGenBuffers || !qglBufferData || !qglBufferSubData )
+		{
+#define GLE( ret, name, ... ) qgl##name = NULL;
+			QGL_1_5_PROCS;
+#undef GLE
+		}
 	}
 
 	textureFilterAnisotropic = qfalse;
@@ -1190,6 +1245,23 @@ void GLimp_EndFrame( void )
 		SDL_GL_SwapWindow( SDL_window );
 	}
 
+	// the render thread never touches the window, the
+	// front end checks for a fullscreen toggle instead
+	if ( !glConfig.smpActive )
+	{
+		GLimp_CheckFullscreen();
+	}
+}
+
+/*
+===============
+GLimp_CheckFullscreen
+
+Applies a change to r_fullscreen, must be called from the main thread
+===============
+*/
+void GLimp_CheckFullscreen( void )
+{
 	if( r_fullscreen->modified )
 	{
 		int         fullscreen;
@@ -1223,3 +1295,425 @@ void GLimp_EndFrame( void )
 		r_fullscreen->modified = qfalse;
 	}
 }
+
+/*
+===========================================================
+
+SMP acceleration
+
+The GL context belongs to whichever thread is currently issuing GL
+calls.  The front end hands it to the render thread along with each
+command list, and takes it back once the render thread goes idle.
+
+===========================================================
+*/
+
+static SDL_mutex	*smpMutex = NULL;
+static SDL_cond		*renderCommandsEvent = NULL;
+static SDL_cond		*renderCompletedEvent = NULL;
+static SDL_Thread	*renderThread = NULL;
+static void			(*renderThreadFunction)( void ) = NULL;
+
+static void			*smpData = NULL;
+static qboolean		smpDataReady;			// set until the render thread picks up smpData
+static qboolean		smpRendererBusy;		// set from GLimp_WakeRenderer until the commands are done
+static qboolean		smpRendererHasWork;		// only touched by the render thread
+static qboolean		smpFrontEndOwnsContext;	// only touched by the front end
+
+/*
+===============
+GLimp_RenderThreadWrapper
+===============
+*/
+static int GLimp_RenderThreadWrapper( void *arg )
+{
+	renderThreadFunction();
+	return 0;
+}
+
+/*
+===============
+GLimp_DestroySmpObjects
+===============
+*/
+static void GLimp_DestroySmpObjects( void )
+{
+	if ( renderCommandsEvent )
+	{
+		SDL_DestroyCond( renderCommandsEvent );
+		renderCommandsEvent = NULL;
+	}
+	if ( renderCompletedEvent )
+	{
+		SDL_DestroyCond( renderCompletedEvent );
+		renderCompletedEvent = NULL;
+	}
+	if ( smpMutex )
+	{
+		SDL_DestroyMutex( smpMutex );
+		smpMutex = NULL;
+	}
+}
+
+/*
+===============
+GLimp_SpawnRenderThread
+
+Must be called from the thread that owns the GL context
+===============
+*/
+qboolean GLimp_SpawnRenderThread( void (*function)( void ) )
+{
+	if ( renderThread )
+	{
+		ri.Printf( PRINT_WARNING, "GLimp_SpawnRenderThread: render thread already running\n" );
+		return qfalse;
+	}
+
+	smpMutex = SDL_CreateMutex();
+	renderCommandsEvent = SDL_CreateCond();
+	renderCompletedEvent = SDL_CreateCond();
+	if ( !smpMutex || !renderCommandsEvent || !renderCompletedEvent )
+	{
+		ri.Printf( PRINT_WARNING, "GLimp_SpawnRenderThread: %s\n", SDL_GetError() );
+		GLimp_DestroySmpObjects();
+		return qfalse;
+	}
+
+	smpData = NULL;
+	smpDataReady = qfalse;
+	smpRendererBusy = qfalse;
+	smpRendererHasWork = qfalse;
+	smpFrontEndOwnsContext = qtrue;
+
+	renderThreadFunction = function;
+	renderThread = SDL_CreateThread( GLimp_RenderThreadWrapper, "render", NULL );
+	if ( !renderThread )
+	{
+		ri.Printf( PRINT_WARNING, "GLimp_SpawnRenderThread: %s\n", SDL_GetError() );
+		GLimp_DestroySmpObjects();
+		return qfalse;
+	}
+
+	return qtrue;
+}
+
+/*
+===============
+GLimp_ShutdownRenderThread
+
+Lets the render thread finish its commands and exit, then takes the
+GL context back for the main thread
+===============
+*/
+void GLimp_ShutdownRenderThread( void )
+{
+	if ( !renderThread )
+	{
+		return;
+	}
+
+	GLimp_WakeRenderer( NULL );
+	SDL_WaitThread( renderThread, NULL );
+	renderThread = NULL;
+
+	GLimp_DestroySmpObjects();
+
+	SDL_GL_MakeCurrent( SDL_window, SDL_glContext );
+	smpFrontEndOwnsContext = qfalse;
+}
+
+/*
+===============
+GLimp_RendererSleep
+
+Called by the render thread when it has finished a command list,
+returns the next one or NULL when the thread should exit
+===============
+*/
+void *GLimp_RendererSleep( void )
+{
+	void	*data;
+
+	SDL_LockMutex( smpMutex );
+
+	if ( smpRendererHasWork )
+	{
+		// give the context back before the front end can wake up
+		SDL_GL_MakeCurrent( SDL_window, NULL );
+		smpRendererHasWork = qfalse;
+		smpRendererBusy = qfalse;
+		SDL_CondSignal( renderCompletedEvent );
+	}
+
+	while ( !smpDataReady )
+	{
+		SDL_CondWait( renderCommandsEvent, smpMutex );
+	}
+	data = smpData;
+	smpDataReady = qfalse;
+
+	SDL_UnlockMutex( smpMutex );
+
+	if ( data )
+	{
+		SDL_GL_MakeCurrent( SDL_window, SDL_glContext );
+		smpRendererHasWork = qtrue;
+	}
+
+	return data;
+}
+
+/*
+===============
+GLimp_FrontEndSleep
+
+Waits for the render thread to go idle and takes the GL context
+===============
+*/
+void GLimp_FrontEndSleep( void )
+{
+	if ( smpFrontEndOwnsContext )
+	{
+		return;
+	}
+
+	SDL_LockMutex( smpMutex );
+	while ( smpRendererBusy )
+	{
+		SDL_CondWait( renderCompletedEvent, smpMutex );
+	}
+	SDL_UnlockMutex( smpMutex );
+
+	SDL_GL_MakeCurrent( SDL_window, SDL_glContext );
+	smpFrontEndOwnsContext = qtrue;
+}
+
+/*
+===============
+GLimp_WakeRenderer
+
+Hands a command list and the GL context to the render thread
+===============
+*/
+void GLimp_WakeRenderer( void *data )
+{
+	GLimp_FrontEndSleep();
+
+	SDL_GL_MakeCurrent( SDL_window, NULL );
+	smpFrontEndOwnsContext = qfalse;
+
+	SDL_LockMutex( smpMutex );
+	smpData = data;
+	smpDataReady = qtrue;
+	smpRendererBusy = qtrue;
+	SDL_CondSignal( renderCommandsEvent );
+	SDL_UnlockMutex( smpMutex );
+}
+
+/*
+===========================================================
+
+Worker threads
+
+Plain CPU work for the renderer, such as decoding images while a map
+loads.  Workers never touch the GL context.  They share one lock and
+one condition variable with whoever feeds them work.
+
+===========================================================
+*/
+
+#define MAX_WORKER_THREADS	16
+
+static SDL_mutex	*workerMutex = NULL;
+static SDL_cond		*workerEvent = NULL;
+static SDL_Thread	*workerThreads[MAX_WORKER_THREADS];
+static SDL_threadID	workerIds[MAX_WORKER_THREADS];	// set by each worker as it starts
+static int			numWorkerThreads;
+static void			(*workerFunction)( int worker ) = NULL;
+
+/*
+===============
+GLimp_WorkerThreadWrapper
+===============
+*/
+static int GLimp_WorkerThreadWrapper( void *arg )
+{
+	int worker = (int)(intptr_t)arg;
+
+	SDL_LockMutex( workerMutex );
+	workerIds[worker] = SDL_ThreadID();
+	SDL_UnlockMutex( workerMutex );
+
+	workerFunction( worker );
+	return 0;
+}
+
+/*
+===============
+GLimp_DestroyWorkerObjects
+===============
+*/
+static void GLimp_DestroyWorkerObjects( void )
+{
+	if ( workerEvent )
+	{
+		SDL_DestroyCond( workerEvent );
+		workerEvent = NULL;
+	}
+	if ( workerMutex )
+	{
+		SDL_DestroyMutex( workerMutex );
+		workerMutex = NULL;
+	}
+}
+
+/*
+===============
+GLimp_SpawnWorkers
+
+Starts up to count threads running function, each with its own index.
+Returns how many started.
+===============
+*/
+int GLimp_SpawnWorkers( int count, void (*function)( int worker ) )
+{
+	int i;
+
+	if ( numWorkerThreads )
+	{
+		ri.Printf( PRINT_WARNING, "GLimp_SpawnWorkers: workers already running\n" );
+		return 0;
+	}
+
+	workerMutex = SDL_CreateMutex();
+	workerEvent = SDL_CreateCond();
+	if ( !workerMutex || !workerEvent )
+	{
+		ri.Printf( PRINT_WARNING, "GLimp_SpawnWorkers: %s\n", SDL_GetError() );
+		GLimp_DestroyWorkerObjects();
+		return 0;
+	}
+
+	workerFunction = function;
+	Com_Memset( workerIds, 0, sizeof( workerIds ) );
+
+	if ( count > MAX_WORKER_THREADS )
+	{
+		count = MAX_WORKER_THREADS;
+	}
+
+	for ( i = 0; i < count; i++ )
+	{
+		workerThreads[i] = SDL_CreateThread( GLimp_WorkerThreadWrapper, "worker", (void *)(intptr_t)i );
+		if ( !workerThreads[i] )
+		{
+			ri.Printf( PRINT_WARNING, "GLimp_SpawnWorkers: %s\n", SDL_GetError() );
+			break;
+		}
+		numWorkerThreads++;
+	}
+
+	if ( !numWorkerThreads )
+	{
+		GLimp_DestroyWorkerObjects();
+	}
+
+	return numWorkerThreads;
+}
+
+/*
+===============
+GLimp_ShutdownWorkers
+
+Waits for every worker function to return
+===============
+*/
+void GLimp_ShutdownWorkers( void )
+{
+	int i;
+
+	if ( !numWorkerThreads )
+	{
+		return;
+	}
+
+	for ( i = 0; i < numWorkerThreads; i++ )
+	{
+		SDL_WaitThread( workerThreads[i], NULL );
+		workerThreads[i] = NULL;
+	}
+	numWorkerThreads = 0;
+
+	GLimp_DestroyWorkerObjects();
+}
+
+/*
+===============
+GLimp_WorkerIndex
+
+The calling worker's index, or -1 on any other thread
+===============
+*/
+int GLimp_WorkerIndex( void )
+{
+	SDL_threadID id;
+	int i;
+
+	if ( !workerMutex )
+	{
+		return -1;
+	}
+
+	// every slot, since workers run before GLimp_SpawnWorkers has counted them
+	id = SDL_ThreadID();
+	for ( i = 0; i < MAX_WORKER_THREADS; i++ )
+	{
+		if ( workerIds[i] == id )
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/*
+===============
+GLimp_LockWorkers
+
+The lock is recursive.  GLimp_WaitWorkers must only be called with it
+held exactly once.
+===============
+*/
+void GLimp_LockWorkers( void )
+{
+	if ( workerMutex )
+	{
+		SDL_LockMutex( workerMutex );
+	}
+}
+
+void GLimp_UnlockWorkers( void )
+{
+	if ( workerMutex )
+	{
+		SDL_UnlockMutex( workerMutex );
+	}
+}
+
+void GLimp_WaitWorkers( void )
+{
+	if ( workerMutex )
+	{
+		SDL_CondWait( workerEvent, workerMutex );
+	}
+}
+
+void GLimp_WakeWorkers( void )
+{
+	if ( workerEvent )
+	{
+		SDL_CondBroadcast( workerEvent );
+	}
+}
@@ -1240,6 +1240,11 @@ void IN_Frame( void )
 {
 	qboolean loading;
 
+	// no window to take input from
+	if ( cl_headless && cl_headless->integer ) {
+		return;
+	}
+
 	IN_JoyMove( );
 
 	// If not DISCONNECTED (main menu) or ACTIVE (in game), we're loading
@@ -46,6 +46,37 @@ static int dmapos = 0;
 static int dmasize = 0;
 
 static SDL_AudioDeviceID sdlPlaybackDevice;
+static int sdlCallbackMsec;
+
+// mixer thread, see S_Base_Init
+#define MIX_QUEUE_SIZE	4096	// power of two
+
+static SDL_Thread *mixThread;
+static SDL_mutex *mixMutex;
+static SDL_atomic_t mixQuit;
+static void (*mixFunction)( void );
+
+static sndCommand_t mixQueue[MIX_QUEUE_SIZE];
+static SDL_atomic_t mixQueueHead;	// next to write, owned by the game thread
+static SDL_atomic_t mixQueueTail;	// next to read, owned by whoever holds mixMutex
+
+// audio worker threads, see CL_VoipStartWorker and S_PrecacheInit
+struct sndWorker_s {
+	SDL_Thread	*thread;
+	SDL_sem		*wake;
+	SDL_atomic_t	quit;
+	void		(*function)( void *arg );
+	void		*arg;
+	int			msec;
+};
+
+struct sndQueue_s {
+	byte		*elements;
+	int			elementSize;
+	int			count;		// power of two
+	SDL_atomic_t	head;	// next to write, owned by the producer
+	SDL_atomic_t	tail;	// next to read, owned by the consumer
+};
 
 #if defined USE_VOIP && SDL_VERSION_ATLEAST( 2, 0, 5 )
 #define USE_SDL_AUDIO_CAPTURE
@@ -277,6 +308,7 @@ qboolean SNDDMA_Init(void)
 	dma.speed = obtained.freq;
 	dmasize = (dma.samples * (dma.samplebits/8));
 	dma.buffer = calloc(1, dmasize);
+	sdlCallbackMsec = obtained.samples * 1000 / obtained.freq;
 
 #ifdef USE_SDL_AUDIO_CAPTURE
 	// !!! FIXME: some of these SDL_OpenAudioDevice() values should be cvars.
@@ -383,6 +415,307 @@ void SNDDMA_BeginPainting (void)
 }
 
 
+/*
+===============
+SNDDMA_MixThread
+===============
+*/
+static int SNDDMA_MixThread( void *data )
+{
+	// wake twice per device callback so the mix stays ahead of it
+	int msec = sdlCallbackMsec / 2;
+
+	if ( msec < 1 )
+		msec = 1;
+
+	while ( !SDL_AtomicGet( &mixQuit ) )
+	{
+		mixFunction();
+		SDL_Delay( msec );
+	}
+
+	return 0;
+}
+
+/*
+===============
+SNDDMA_StartMixThread
+
+Runs function on its own thread until SNDDMA_StopMixThread
+===============
+*/
+qboolean SNDDMA_StartMixThread( void (*function)( void ) )
+{
+	if ( mixThread || !snd_inited )
+		return qfalse;
+
+	mixMutex = SDL_CreateMutex();
+	if ( !mixMutex )
+	{
+		Com_Printf( "SNDDMA_StartMixThread: %s\n", SDL_GetError() );
+		return qfalse;
+	}
+
+	SDL_AtomicSet( &mixQuit, 0 );
+	SDL_AtomicSet( &mixQueueHead, 0 );
+	SDL_AtomicSet( &mixQueueTail, 0 );
+	mixFunction = function;
+
+	mixThread = SDL_CreateThread( SNDDMA_MixThread, "mixer", NULL );
+	if ( !mixThread )
+	{
+		Com_Printf( "SNDDMA_StartMixThread: %s\n", SDL_GetError() );
+		SDL_DestroyMutex( mixMutex );
+		mixMutex = NULL;
+		return qfalse;
+	}
+
+	return qtrue;
+}
+
+/*
+===============
+SNDDMA_StopMixThread
+===============
+*/
+void SNDDMA_StopMixThread( void )
+{
+	if ( !mixThread )
+		return;
+
+	SDL_AtomicSet( &mixQuit, 1 );
+	SDL_WaitThread( mixThread, NULL );
+	mixThread = NULL;
+
+	SDL_DestroyMutex( mixMutex );
+	mixMutex = NULL;
+}
+
+/*
+===============
+SNDDMA_LockMixer
+
+Keeps the mixer thread out while the game thread touches mixing state,
+nests, and does nothing when there is no mixer thread
+===============
+*/
+void SNDDMA_LockMixer( void )
+{
+	if ( mixMutex )
+		SDL_LockMutex( mixMutex );
+}
+
+void SNDDMA_UnlockMixer( void )
+{
+	if ( mixMutex )
+		SDL_UnlockMutex( mixMutex );
+}
+
+/*
+===============
+SNDDMA_PushCommand
+
+Game thread only, returns qfalse when the queue is full
+===============
+*/
+qboolean SNDDMA_PushCommand( const sndCommand_t *cmd )
+{
+	int head = SDL_AtomicGet( &mixQueueHead );
+
+	if ( head - SDL_AtomicGet( &mixQueueTail ) >= MIX_QUEUE_SIZE )
+		return qfalse;
+
+	mixQueue[head & ( MIX_QUEUE_SIZE - 1 )] = *cmd;
+
+	// the atomic set is a full barrier, the command is visible first
+	SDL_AtomicSet( &mixQueueHead, head + 1 );
+	return qtrue;
+}
+
+/*
+===============
+SNDDMA_PopCommand
+
+Only with the mixer lock held, returns qfalse when the queue is empty
+===============
+*/
+qboolean SNDDMA_PopCommand( sndCommand_t *cmd )
+{
+	int tail = SDL_AtomicGet( &mixQueueTail );
+
+	if ( tail == SDL_AtomicGet( &mixQueueHead ) )
+		return qfalse;
+
+	*cmd = mixQueue[tail & ( MIX_QUEUE_SIZE - 1 )];
+	SDL_AtomicSet( &mixQueueTail, tail + 1 );
+	return qtrue;
+}
+
+/*
+===============
+SNDDMA_WorkerThread
+===============
+*/
+static int SNDDMA_WorkerThread( void *data )
+{
+	sndWorker_t *worker = data;
+
+	while ( !SDL_AtomicGet( &worker->quit ) )
+	{
+		SDL_SemWaitTimeout( worker->wake, worker->msec );
+		worker->function( worker->arg );
+	}
+
+	return 0;
+}
+
+/*
+===============
+SNDDMA_StartWorker
+
+Runs function( arg ) on its own thread whenever it is woken, and at least
+every msec milliseconds, NULL if the platform can't
+===============
+*/
+sndWorker_t *SNDDMA_StartWorker( const char *name, void (*function)( void *arg ), void *arg, int msec )
+{
+	sndWorker_t *worker;
+
+	worker = Z_Malloc( sizeof( *worker ) );
+	worker->wake = SDL_CreateSemaphore( 0 );
+	if ( !worker->wake )
+	{
+		Com_Printf( "SNDDMA_StartWorker: %s\n", SDL_GetError() );
+		Z_Free( worker );
+		return NULL;
+	}
+
+	SDL_AtomicSet( &worker->quit, 0 );
+	worker->function = function;
+	worker->arg = arg;
+	worker->msec = msec;
+
+	worker->thread = SDL_CreateThread( SNDDMA_WorkerThread, name, worker );
+	if ( !worker->thread )
+	{
+		Com_Printf( "SNDDMA_StartWorker: %s\n", SDL_GetError() );
+		SDL_DestroySemaphore( worker->wake );
+		Z_Free( worker );
+		return NULL;
+	}
+
+	return worker;
+}
+
+/*
+===============
+SNDDMA_WakeWorker
+===============
+*/
+void SNDDMA_WakeWorker( sndWorker_t *worker )
+{
+	// one pending wake is enough, don't let the count run away
+	if ( SDL_SemValue( worker->wake ) == 0 )
+		SDL_SemPost( worker->wake );
+}
+
+/*
+===============
+SNDDMA_StopWorker
+
+Waits for the function to return, it won't be called again
+===============
+*/
+void SNDDMA_StopWorker( sndWorker_t *worker )
+{
+	SDL_AtomicSet( &worker->quit, 1 );
+	SDL_SemPost( worker->wake );
+	SDL_WaitThread( worker->thread, NULL );
+
+	SDL_DestroySemaphore( worker->wake );
+	Z_Free( worker );
+}
+
+/*
+===============
+SNDDMA_CreateQueue
+
+Single producer, single consumer, count is rounded up to a power of two
+===============
+*/
+sndQueue_t *SNDDMA_CreateQueue( int elementSize, int count )
+{
+	sndQueue_t *queue;
+	int size;
+
+	for ( size = 1; size < count; size <<= 1 )
+		;
+
+	queue = Z_Malloc( sizeof( *queue ) + elementSize * size );
+	queue->elements = (byte *)( queue + 1 );
+	queue->elementSize = elementSize;
+	queue->count = size;
+	SDL_AtomicSet( &queue->head, 0 );
+	SDL_AtomicSet( &queue->tail, 0 );
+
+	return queue;
+}
+
+/*
+===============
+SNDDMA_FreeQueue
+
+Neither end may be in use
+===============
+*/
+void SNDDMA_FreeQueue( sndQueue_t *queue )
+{
+	Z_Free( queue );
+}
+
+/*
+===============
+SNDDMA_QueuePush
+
+Producer only, returns qfalse when the queue is full
+===============
+*/
+qboolean SNDDMA_QueuePush( sndQueue_t *queue, const void *element )
+{
+	int head = SDL_AtomicGet( &queue->head );
+
+	if ( head - SDL_AtomicGet( &queue->tail ) >= queue->count )
+		return qfalse;
+
+	Com_Memcpy( queue->elements + ( head & ( queue->count - 1 ) ) * queue->elementSize,
+		element, queue->elementSize );
+
+	// the atomic set is a full barrier, the element is visible first
+	SDL_AtomicSet( &queue->head, head + 1 );
+	return qtrue;
+}
+
+/*
+===============
+SNDDMA_QueuePop
+
+Consumer only, returns qfalse when the queue is empty
+===============
+*/
+qboolean SNDDMA_QueuePop( sndQueue_t *queue, void *element )
+{
+	int tail = SDL_AtomicGet( &queue->tail );
+
+	if ( tail == SDL_AtomicGet( &queue->head ) )
+		return qfalse;
+
+	Com_Memcpy( element, queue->elements + ( tail & ( queue->count - 1 ) ) * queue->elementSize,
+		queue->elementSize );
+	SDL_AtomicSet( &queue->tail, tail + 1 );
+	return qtrue;
+}
+
+
 #ifdef USE_VOIP
 void SNDDMA_StartCapture(void)
 {
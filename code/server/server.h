@@ -36,16 +36,24 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #ifdef USE_VOIP
 #define VOIP_QUEUE_LENGTH 64
 
+// one packet is shared by every client it is relayed to, and only as much
+// of data as len needs is allocated
 typedef struct voipServerPacket_s
 {
+	int refCount;
 	int generation;
 	int sequence;
 	int frames;
 	int len;
 	int sender;
-	int flags;
 	byte data[4000];
 } voipServerPacket_t;
+
+typedef struct
+{
+	voipServerPacket_t *packet;
+	int flags;		// VOIP_DIRECT differs per recipient
+} voipQueuedPacket_t;
 #endif
 
 typedef struct svEntity_s {
@@ -57,7 +65,7 @@ typedef struct svEntity_s {
 	int			clusternums[MAX_ENT_CLUSTERS];
 	int			lastCluster;		// if all the clusters don't fit in clusternums
 	int			areanum, areanum2;
-	int			snapshotCounter;	// used to prevent double adding from portal views
+	qboolean	linkedTrigger;		// linked with CONTENTS_TRIGGER
 } svEntity_t;
 
 typedef enum {
@@ -75,7 +83,6 @@ typedef struct {
 	// https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=475
 	// the serverId associated with the current checksumFeed (always <= serverId)
 	int       checksumFeedServerId;	
-	int				snapshotCounter;	// incremented for each snapshot built
 	int				timeResidual;		// <= 1000 / sv_frame->value
 	int				nextFrameTime;		// when time > nextFrameTime, process world
 	char			*configstrings[MAX_CONFIGSTRINGS];
@@ -93,6 +100,8 @@ typedef struct {
 
 	int				restartTime;
 	int				time;
+
+	qboolean		noThinkBatch;		// the game doesn't know GAME_CLIENT_THINK_BATCH
 } server_t;
 
 
@@ -104,9 +113,10 @@ typedef struct {
 	byte			areabits[MAX_MAP_AREA_BYTES];		// portalarea visibility bits
 	playerState_t	ps;
 	int				num_entities;
-	int				first_entity;		// into the circular sv_packet_entities[]
+	int				first_entity;		// into the circular svs.snapshotEntities[]
 										// the entities MUST be in increasing state number
 										// order, otherwise the delta compression will fail
+	int				oldestState;		// lowest svs.snapshotStates index referenced
 	int				messageSent;		// time the message was transmitted
 	int				messageAcked;		// time the message was acked
 	int				messageSize;		// used to rate drop packets
@@ -130,6 +140,16 @@ typedef struct netchan_buffer_s {
 	struct netchan_buffer_s *next;
 } netchan_buffer_t;
 
+// traffic counted for the metrics command, from the time the slot was taken
+typedef struct {
+	int64_t			bytesSent;
+	int64_t			bytesReceived;
+	int				packetsSent;
+	int				packetsReceived;
+	int				choked;					// snapshots held back by rate or a full send queue
+	int				dropped;				// incoming packets the netchan found missing
+} clientMetrics_t;
+
 typedef struct client_s {
 	clientState_t	state;
 	char			userinfo[MAX_INFO_STRING];		// name, etc
@@ -138,12 +158,17 @@ typedef struct client_s {
 	int				reliableSequence;		// last added reliable message, not necessarily sent or acknowledged yet
 	int				reliableAcknowledge;	// last acknowledged reliable message
 	int				reliableSent;			// last sent reliable message, not necessarily acknowledged yet
+	qboolean		reliableSuperseded[MAX_RELIABLE_COMMANDS];	// a later pending command replaces it, resent empty
 	int				messageAcknowledge;
 
 	int				gamestateMessageNum;	// netchan->outgoingSequence of gamestate
 	int				challenge;
 
 	usercmd_t		lastUsercmd;
+	const usercmd_t	*thinkCmds;			// the commands of the GAME_CLIENT_THINK_BATCH being run
+	int				numThinkCmds;
+	int				thinkCredit;		// thousandths of a usercmd sv_clientThinkRate still allows
+	int				thinkCreditTime;
 	int				lastMessageNum;		// for delta compression
 	int				lastClientCommand;	// reliable client message sequence
 	char			lastClientCommandString[MAX_STRING_CHARS];
@@ -160,6 +185,7 @@ typedef struct client_s {
 	int				downloadXmitBlock;	// last block we xmited
 	unsigned char	*downloadBlocks[MAX_DOWNLOAD_WINDOW];	// the buffers for the download blocks
 	int				downloadBlockSize[MAX_DOWNLOAD_WINDOW];
+	int				downloadBlockMax;	// bytes per block the client asked for
 	qboolean		downloadEOF;		// We have sent the EOF block
 	int				downloadSendTime;	// time we last got an ack from the client
 
@@ -188,13 +214,23 @@ typedef struct client_s {
 	qboolean hasVoip;
 	qboolean muteAllVoip;
 	qboolean ignoreVoipFromClient[MAX_CLIENTS];
-	voipServerPacket_t *voipPacket[VOIP_QUEUE_LENGTH];
+	voipQueuedPacket_t voipPacket[VOIP_QUEUE_LENGTH];
 	int queuedVoipPackets;
 	int queuedVoipIndex;
 #endif
 
 	int				oldServerTime;
 	qboolean		csUpdated[MAX_CONFIGSTRINGS];
+	qboolean		compressConfigstrings;	// takes a deflated gamestate and csd deltas
+	qboolean		compressCommands;		// takes svc_serverCommandsDeflated and empty superseded commands
+
+	// the pending reliable commands last deflated, resent as is until one is
+	// acknowledged or added
+	int				deflatedFirst, deflatedLast;
+	int				deflatedSize, deflatedPackedSize;
+	byte			deflatedCommands[MAX_MSGLEN / 4];
+
+	clientMetrics_t	metrics;
 	
 #ifdef LEGACY_PROTOCOL
 	qboolean		compat;
@@ -226,6 +262,24 @@ typedef struct {
 	qboolean	connected;
 } challenge_t;
 
+#define	METRIC_FRAME_BUCKETS	8		// SV_Frame times from under 1 msec, doubling, to 64 msec and over
+
+// counted from server start for the metrics command
+typedef struct {
+	int			frames;
+	int64_t		frameUsec;
+	int			frameMaxUsec;
+	int			frameBuckets[METRIC_FRAME_BUCKETS];
+	int64_t		gameUsec;					// GAME_RUN_FRAME
+	int64_t		botUsec;					// SV_BotFrame
+	int64_t		snapshotBuildUsec;
+	int64_t		snapshotSendUsec;			// writing and sending once built
+	int64_t		snapshots;
+	int64_t		traces;
+	int			frameMaxTraces;
+	int			lastTraces;					// c_traces at the end of the last frame
+} serverMetrics_t;
+
 // this structure will be cleared only when the game dll changes
 typedef struct {
 	qboolean	initialized;				// sv_init has completed
@@ -237,7 +291,10 @@ typedef struct {
 	client_t	*clients;					// [sv_maxclients->integer];
 	int			numSnapshotEntities;		// sv_maxclients->integer*PACKET_BACKUP*MAX_SNAPSHOT_ENTITIES
 	int			nextSnapshotEntities;		// next snapshotEntities to use
-	entityState_t	*snapshotEntities;		// [numSnapshotEntities]
+	int			*snapshotEntities;			// [numSnapshotEntities], index into snapshotStates
+	int			numSnapshotStates;			// MIN( numSnapshotEntities, PACKET_BACKUP*MAX_GENTITIES )
+	int			nextSnapshotStates;			// next snapshotStates to use
+	entityState_t	*snapshotStates;		// [numSnapshotStates], shared by all clients' frames
 	int			nextHeartbeatTime;
 	challenge_t	challenges[MAX_CHALLENGES];	// to prevent invalid IPs from connecting
 	netadr_t	redirectAddress;			// for rcon return messages
@@ -245,6 +302,8 @@ typedef struct {
 	netadr_t	authorizeAddress;			// authorize server address
 #endif
 	int			masterResolveTime[MAX_MASTER_SERVERS]; // next svs.time that server should do dns lookup for master server
+
+	serverMetrics_t	metrics;
 } serverStatic_t;
 
 #define SERVER_MAXBANS	1024
@@ -291,10 +350,18 @@ extern	cvar_t	*sv_gametype;
 extern	cvar_t	*sv_pure;
 extern	cvar_t	*sv_floodProtect;
 extern	cvar_t	*sv_lanForceRate;
+extern	cvar_t	*sv_snapshotPriority;
+extern	cvar_t	*sv_traceCache;
+extern	cvar_t	*sv_preloadNextMap;
+extern	cvar_t	*sv_compressConfigstrings;
+extern	cvar_t	*sv_compressCommands;
 #ifndef STANDALONE
 extern	cvar_t	*sv_strictAuth;
 #endif
 extern	cvar_t	*sv_banFile;
+extern	cvar_t	*sv_metricsPassword;
+extern	cvar_t	*sv_clientThinkRate;
+extern	cvar_t	*sv_clientThinkBatch;
 
 extern	serverBan_t serverBans[SERVER_MAXBANS];
 extern	int serverBansCount;
@@ -302,6 +369,8 @@ extern	int serverBansCount;
 #ifdef USE_VOIP
 extern	cvar_t	*sv_voip;
 extern	cvar_t	*sv_voipProtocol;
+
+void SV_ReleaseVoipPacket( voipServerPacket_t *packet );
 #endif
 
 
@@ -337,6 +406,7 @@ void QDECL SV_SendServerCommand( client_t *cl, const char *fmt, ...) Q_PRINTF_FU
 
 
 void SV_AddOperatorCommands (void);
+void SV_AddMetricsCommands( void );
 void SV_RemoveOperatorCommands (void);
 
 
@@ -357,6 +427,8 @@ void SV_GetUserinfo( int index, char *buffer, int bufferSize );
 
 void SV_ChangeMaxClients( void );
 void SV_SpawnServer( char *server, qboolean killBots );
+void SV_PreloadNextMap( void );
+void SV_ClearPreload( void );
 
 
 
@@ -400,6 +472,37 @@ void SV_WriteFrameToClient (client_t *client, msg_t *msg);
 void SV_SendMessageToClient( msg_t *msg, client_t *client );
 void SV_SendClientMessages( void );
 void SV_SendClientSnapshot( client_t *client );
+entityState_t *SV_SnapshotEntity( clientSnapshot_t *frame, int index );
+void SV_RecordMsgs_f( void );
+void SV_StopRecordingMsgs( void );
+
+//
+// sv_loadtest.c
+//
+qboolean SV_IsLoadTestAddress( netadr_t adr );
+void SV_LoadTest_f( void );
+void SV_LoadTestFrame( void );
+void SV_LoadTestFrameTime( int usec );
+void SV_LoadTestShutdown( void );
+
+//
+// sv_demo.c
+//
+void SV_RecordDemo_f( void );
+void SV_StopRecordingDemo( void );
+void SV_DemoConfigstring( int index );
+void SV_DemoServerCommand( int clientNum, const char *cmd );
+void SV_DemoClientSnapshot( client_t *client, clientSnapshot_t *frame, const byte *entities );
+void SV_DemoFrame( void );
+void SV_DemoPov_f( void );
+
+//
+// sv_http.c
+//
+void SV_HTTPInit( void );
+void SV_HTTPSpawn( void );
+void SV_HTTPShutdown( void );
+const char *SV_ServerInfoString( void );
 
 //
 // sv_game.c
@@ -440,6 +543,15 @@ void SV_BotInitBotLib(void);
 void SV_ClearWorld (void);
 // called after the world model has been loaded, before linking any entities
 
+void SV_RecordTraces_f( void );
+void SV_StopRecordingTraces( void );
+// recordtraces writes the world traces and point contents queries the
+// game makes, in the cm_public.h trace log format
+
+void SV_InvalidateTraceCache( void );
+// forget every cached SV_Trace / SV_PointContents result, done whenever
+// an entity is linked or unlinked and at the start of each game frame
+
 void SV_UnlinkEntity( sharedEntity_t *ent );
 // call before removing an entity, and before trying to move one,
 // so it doesn't clip against itself
@@ -482,10 +594,25 @@ void SV_Trace( trace_t *results, const vec3_t start, vec3_t mins, vec3_t maxs, c
 
 // passEntityNum is explicitly excluded from clipping checks (normally ENTITYNUM_NONE)
 
+void SV_TraceMany( trace_t *results, const traceRequest_t *requests, int count, int capsule );
+// same as calling SV_Trace for each request, but the nearby entities
+// are only gathered once for the whole batch
+
 
 void SV_ClipToEntity( trace_t *trace, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int entityNum, int contentmask, int capsule );
 // clip to a specific entity
 
+int SV_TriggersInBox( int entityNum, const vec3_t mins, const vec3_t maxs, int *list, int maxcount );
+// the entities with CONTENTS_TRIGGER in the box, cached per client
+
+void SV_ClearEntityHistory( void );
+void SV_RecordEntityHistory( void );
+// saves where the CONTENTS_BODY entities are at the end of a game frame
+
+void SV_TraceAtTime( trace_t *results, const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule, int time );
+// same as SV_Trace, but entities in the history are clipped where they
+// were at the given server time
+
 //
 // sv_net_chan.c
 //
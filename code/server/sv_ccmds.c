@@ -310,6 +310,8 @@ static void SV_MapRestart_f( void ) {
 	sv.state = SS_GAME;
 	sv.restarting = qfalse;
 
+	SV_DemoServerCommand( -1, "map_restart\n" );
+
 	// connect and begin all the clients
 	for (i=0 ; i<sv_maxclients->integer ; i++) {
 		client = &svs.clients[i];
@@ -1393,7 +1395,7 @@ static void SV_Serverinfo_f( void ) {
 	}
 
 	Com_Printf ("Server info settings:\n");
-	Info_Print ( Cvar_InfoString( CVAR_SERVERINFO ) );
+	Info_Print ( SV_ServerInfoString() );
 }
 
 
@@ -1539,6 +1541,11 @@ void SV_AddOperatorCommands( void ) {
 	Cmd_AddCommand ("dumpuser", SV_DumpUser_f);
 	Cmd_AddCommand ("map_restart", SV_MapRestart_f);
 	Cmd_AddCommand ("sectorlist", SV_SectorList_f);
+	Cmd_AddCommand ("recordtraces", SV_RecordTraces_f);
+	Cmd_AddCommand ("recordmsgs", SV_RecordMsgs_f);
+	Cmd_AddCommand ("svrecord", SV_RecordDemo_f);
+	Cmd_AddCommand ("svdemo_pov", SV_DemoPov_f);
+	Cmd_AddCommand ("loadtest", SV_LoadTest_f);
 	Cmd_AddCommand ("map", SV_Map_f);
 	Cmd_SetCommandCompletionFunc( "map", SV_CompleteMapName );
 #ifndef PRE_RELEASE_DEMO
@@ -147,7 +147,8 @@ void SV_GetChallenge(netadr_t from)
 #ifndef STANDALONE
 	// Drop the authorize stuff if this client is coming in via v6 as the auth server does not support ipv6.
 	// Drop also for addresses coming in on local LAN and for stand-alone games independent from id's assets.
-	if(challenge->adr.type == NA_IP && !com_standalone->integer && !Sys_IsLANAddress(from))
+	// Drop it for the synthetic load test clients too.
+	if(challenge->adr.type == NA_IP && !com_standalone->integer && !Sys_IsLANAddress(from) && !SV_IsLoadTestAddress(from))
 	{
 		// look up the authorize server's IP
 		if (svs.authorizeAddress.type == NA_BAD)
@@ -329,6 +330,7 @@ void SV_DirectConnect( netadr_t from ) {
 	int			version;
 	int			qport;
 	int			challenge;
+	int			fragmentSize;
 	char		*password;
 	int			startIndex;
 	intptr_t		denied;
@@ -570,8 +572,21 @@ gotnewcl:
 
 	SV_UserinfoChanged( newcl );
 
-	// send the connect packet to the client
-	NET_OutOfBandPrint(NS_SERVER, from, "connectResponse %d", challenge);
+	// send the connect packet to the client, with the fragment size
+	// if it asked for larger ones and this server allows them
+	fragmentSize = MIN( atoi( Info_ValueForKey( userinfo, "fragsize" ) ), Netchan_FragmentSize() );
+#ifdef LEGACY_PROTOCOL
+	if ( compat ) {
+		fragmentSize = 0;
+	}
+#endif
+	// the loopback buffers only hold packets of the default size
+	if ( fragmentSize > 0 && from.type != NA_LOOPBACK ) {
+		Netchan_SetFragmentSize( &newcl->netchan, fragmentSize );
+		NET_OutOfBandPrint( NS_SERVER, from, "connectResponse %d %d", challenge, newcl->netchan.fragmentSize );
+	} else {
+		NET_OutOfBandPrint(NS_SERVER, from, "connectResponse %d", challenge);
+	}
 
 	Com_DPrintf( "Going from CS_FREE to CS_CONNECTED for %s\n", newcl->name );
 
@@ -608,16 +623,17 @@ Destructor for data allocated in a client structure
 void SV_FreeClient(client_t *client)
 {
 #ifdef USE_VOIP
-	int index;
-	
-	for(index = client->queuedVoipIndex; index < client->queuedVoipPackets; index++)
+	int i;
+
+	for(i = 0; i < client->queuedVoipPackets; i++)
 	{
-		index %= ARRAY_LEN(client->voipPacket);
-		
-		Z_Free(client->voipPacket[index]);
+		int index = (client->queuedVoipIndex + i) % ARRAY_LEN(client->voipPacket);
+
+		SV_ReleaseVoipPacket(client->voipPacket[index].packet);
 	}
-	
+
 	client->queuedVoipPackets = 0;
+	client->queuedVoipIndex = 0;
 #endif
 
 	SV_Netchan_FreeQueue(client);
@@ -706,6 +722,51 @@ void SV_DropClient( client_t *drop, const char *reason ) {
 	}
 }
 
+/*
+================
+SV_WriteDeflatedConfigstrings
+
+Writes every configstring as one deflated block of [short] index
+[string] records, for clients that take it.  Returns qfalse if nothing
+was written and they have to go out one by one.
+================
+*/
+static qboolean SV_WriteDeflatedConfigstrings( msg_t *msg ) {
+	static byte	data[MAX_GAMESTATE_CHARS + MAX_CONFIGSTRINGS * 3];
+	static byte	packed[MAX_MSGLEN];
+	int			size, packedSize, len;
+	int			i;
+
+	size = 0;
+	for ( i = 0 ; i < MAX_CONFIGSTRINGS ; i++ ) {
+		if ( !sv.configstrings[i][0] ) {
+			continue;
+		}
+		len = strlen( sv.configstrings[i] ) + 1;
+		if ( size + 2 + len > sizeof( data ) ) {
+			return qfalse;
+		}
+		data[size++] = i & 0xff;
+		data[size++] = i >> 8;
+		Com_Memcpy( data + size, sv.configstrings[i], len );
+		size += len;
+	}
+
+	// not worth it unless it comes out smaller
+	packedSize = MSG_Deflate( data, size, packed, MIN( size, sizeof( packed ) ) );
+	if ( !packedSize ) {
+		return qfalse;
+	}
+
+	MSG_WriteByte( msg, svc_configstringsDeflated );
+	MSG_WriteLong( msg, size );
+	MSG_WriteLong( msg, packedSize );
+	MSG_WriteBitString( msg, packed, packedSize * 8 );
+
+	Com_DPrintf( "SV_WriteDeflatedConfigstrings: %i bytes in %i\n", size, packedSize );
+	return qtrue;
+}
+
 /*
 ================
 SV_SendClientGameState
@@ -751,11 +812,14 @@ static void SV_SendClientGameState( client_t *client ) {
 	MSG_WriteLong( &msg, client->reliableSequence );
 
 	// write the configstrings
-	for ( start = 0 ; start < MAX_CONFIGSTRINGS ; start++ ) {
-		if (sv.configstrings[start][0]) {
-			MSG_WriteByte( &msg, svc_configstring );
-			MSG_WriteShort( &msg, start );
-			MSG_WriteBigString( &msg, sv.configstrings[start] );
+	if ( !client->compressConfigstrings || !sv_compressConfigstrings->integer
+		|| !SV_WriteDeflatedConfigstrings( &msg ) ) {
+		for ( start = 0 ; start < MAX_CONFIGSTRINGS ; start++ ) {
+			if (sv.configstrings[start][0]) {
+				MSG_WriteByte( &msg, svc_configstring );
+				MSG_WriteShort( &msg, start );
+				MSG_WriteBigString( &msg, sv.configstrings[start] );
+			}
 		}
 	}
 
@@ -930,6 +994,18 @@ static void SV_BeginDownload_f( client_t *cl ) {
 	// cl->downloadName is non-zero now, SV_WriteDownloadToClient will see this and open
 	// the file itself
 	Q_strncpyz( cl->downloadName, Cmd_Argv(1), sizeof(cl->downloadName) );
+
+	// newer clients name the largest block they can take, older
+	// ones only handle the original size
+	cl->downloadBlockMax = MAX_DOWNLOAD_BLKSIZE;
+	if ( Cmd_Argc() > 2 ) {
+		cl->downloadBlockMax = atoi( Cmd_Argv(2) );
+		if ( cl->downloadBlockMax > MAX_DOWNLOAD_BLKSIZE_EXT ) {
+			cl->downloadBlockMax = MAX_DOWNLOAD_BLKSIZE_EXT;
+		} else if ( cl->downloadBlockMax < MAX_DOWNLOAD_BLKSIZE ) {
+			cl->downloadBlockMax = MAX_DOWNLOAD_BLKSIZE;
+		}
+	}
 }
 
 /*
@@ -1071,9 +1147,9 @@ int SV_WriteDownloadToClient(client_t *cl, msg_t *msg)
 		curindex = (cl->downloadCurrentBlock % MAX_DOWNLOAD_WINDOW);
 
 		if (!cl->downloadBlocks[curindex])
-			cl->downloadBlocks[curindex] = Z_Malloc(MAX_DOWNLOAD_BLKSIZE);
+			cl->downloadBlocks[curindex] = Z_Malloc(cl->downloadBlockMax);
 
-		cl->downloadBlockSize[curindex] = FS_Read( cl->downloadBlocks[curindex], MAX_DOWNLOAD_BLKSIZE, cl->download );
+		cl->downloadBlockSize[curindex] = FS_Read( cl->downloadBlocks[curindex], cl->downloadBlockMax, cl->download );
 
 		if (cl->downloadBlockSize[curindex] < 0) {
 			// EOF right now
@@ -1177,6 +1253,7 @@ int SV_SendQueuedMessages(void)
 SV_SendDownloadMessages
 
 Send one round of download messages to all clients
+Returns the number of bytes sent
 ==================
 */
 
@@ -1201,8 +1278,8 @@ int SV_SendDownloadMessages(void)
 			if(retval)
 			{
 				MSG_WriteByte(&msg, svc_EOF);
+				numDLs += msg.cursize;
 				SV_Netchan_Transmit(cl, &msg);
-				numDLs += retval;
 			}
 		}
 	}
@@ -1465,6 +1542,20 @@ void SV_UserinfoChanged( client_t *cl ) {
 		cl->snapshotMsec = i;		
 	}
 	
+#ifdef LEGACY_PROTOCOL
+	if ( cl->compat )
+		cl->compressConfigstrings = qfalse;
+	else
+#endif
+		cl->compressConfigstrings = atoi( Info_ValueForKey( cl->userinfo, "cl_compressConfigstrings" ) ) ? qtrue : qfalse;
+
+#ifdef LEGACY_PROTOCOL
+	if ( cl->compat )
+		cl->compressCommands = qfalse;
+	else
+#endif
+		cl->compressCommands = atoi( Info_ValueForKey( cl->userinfo, "cl_compressCommands" ) ) ? qtrue : qfalse;
+
 #ifdef USE_VOIP
 #ifdef LEGACY_PROTOCOL
 	if(cl->compat)
@@ -1676,6 +1767,75 @@ void SV_ClientThink (client_t *cl, usercmd_t *cmd) {
 	VM_Call( gvm, GAME_CLIENT_THINK, cl - svs.clients );
 }
 
+/*
+==================
+SV_ClientThinkBatch
+
+Runs a packet's new commands with one GAME_CLIENT_THINK_BATCH when the
+game has it, instead of a GAME_CLIENT_THINK for each
+==================
+*/
+static void SV_ClientThinkBatch( client_t *cl, usercmd_t *cmds, int numCmds ) {
+	int		i, count;
+
+	if ( sv_clientThinkBatch->integer && !sv.noThinkBatch ) {
+		for ( i = 0 ; i < numCmds && cl->state == CS_ACTIVE ; i += count ) {
+			count = MIN( numCmds - i, MAX_USERCMD_BATCH );
+			cl->lastUsercmd = cmds[i + count - 1];
+			cl->thinkCmds = cmds + i;
+			cl->numThinkCmds = count;
+			if ( VM_Call( gvm, GAME_CLIENT_THINK_BATCH, cl - svs.clients ) == -1 ) {
+				sv.noThinkBatch = qtrue;
+				Com_DPrintf( "game has no GAME_CLIENT_THINK_BATCH\n" );
+				break;
+			}
+		}
+		cl->thinkCmds = NULL;
+		cl->numThinkCmds = 0;
+		if ( !sv.noThinkBatch ) {
+			return;
+		}
+		// only the first batch can get here, nothing has run yet
+	}
+
+	for ( i = 0 ; i < numCmds ; i++ ) {
+		SV_ClientThink( cl, &cmds[i] );
+	}
+}
+
+/*
+==================
+SV_ClientThinkBudget
+
+How many of numCmds new commands sv_clientThinkRate lets the client run
+now.  Credit builds up with server time and holds at most
+THINK_BURST_MSEC worth, so a burst after a stall still gets through.
+==================
+*/
+#define	THINK_BURST_MSEC	100
+
+static int SV_ClientThinkBudget( client_t *cl, int numCmds ) {
+	int		rate, elapsed, limit, allowed;
+
+	rate = sv_clientThinkRate->integer;
+	if ( rate <= 0 ) {
+		return numCmds;
+	}
+
+	elapsed = svs.time - cl->thinkCreditTime;
+	cl->thinkCreditTime = svs.time;
+	if ( elapsed < 0 || elapsed > THINK_BURST_MSEC ) {
+		elapsed = THINK_BURST_MSEC;
+	}
+
+	limit = MAX( rate * THINK_BURST_MSEC, 1000 );
+	cl->thinkCredit = MIN( cl->thinkCredit + rate * elapsed, limit );
+
+	allowed = MIN( cl->thinkCredit / 1000, numCmds );
+	cl->thinkCredit -= allowed * 1000;
+	return allowed;
+}
+
 /*
 ==================
 SV_UserMove
@@ -1690,7 +1850,7 @@ each of the backup packets.
 */
 static void SV_UserMove( client_t *cl, msg_t *msg, qboolean delta ) {
 	int			i, key;
-	int			cmdCount;
+	int			cmdCount, newCount, allowed;
 	usercmd_t	nullcmd;
 	usercmd_t	cmds[MAX_PACKET_USERCMDS];
 	usercmd_t	*cmd, *oldcmd;
@@ -1766,6 +1926,7 @@ static void SV_UserMove( client_t *cl, msg_t *msg, qboolean delta ) {
 	// usually, the first couple commands will be duplicates
 	// of ones we have previously received, but the servertimes
 	// in the commands will cause them to be immediately discarded
+	newCount = 0;
 	for ( i =  0 ; i < cmdCount ; i++ ) {
 		// if this is a cmd from before a map_restart ignore it
 		if ( cmds[i].serverTime > cmds[cmdCount-1].serverTime ) {
@@ -1780,7 +1941,14 @@ static void SV_UserMove( client_t *cl, msg_t *msg, qboolean delta ) {
 		if ( cmds[i].serverTime <= cl->lastUsercmd.serverTime ) {
 			continue;
 		}
-		SV_ClientThink (cl, &cmds[ i ]);
+		cmds[newCount++] = cmds[i];
+	}
+
+	// over the rate cap the oldest commands are dropped, the newest
+	// one's servertime still moves the player through the whole gap
+	allowed = SV_ClientThinkBudget( cl, newCount );
+	if ( allowed > 0 ) {
+		SV_ClientThinkBatch( cl, cmds + newCount - allowed, allowed );
 	}
 }
 
@@ -1812,9 +1980,10 @@ void SV_UserVoip(client_t *cl, msg_t *msg, qboolean ignoreData)
 	int sender, generation, sequence, frames, packetsize;
 	uint8_t recips[(MAX_CLIENTS + 7) / 8];
 	int flags;
-	byte encoded[sizeof(cl->voipPacket[0]->data)];
 	client_t *client = NULL;
 	voipServerPacket_t *packet = NULL;
+	byte encoded[sizeof(packet->data)];
+	voipQueuedPacket_t *queued;
 	int i;
 
 	sender = cl - svs.clients;
@@ -1879,19 +2048,37 @@ void SV_UserVoip(client_t *cl, msg_t *msg, qboolean ignoreData)
 			continue;  // no room for another packet right now.
 		}
 
-		packet = Z_Malloc(sizeof(*packet));
-		packet->sender = sender;
-		packet->frames = frames;
-		packet->len = packetsize;
-		packet->generation = generation;
-		packet->sequence = sequence;
-		packet->flags = flags;
-		memcpy(packet->data, encoded, packetsize);
+		// every recipient shares the one copy
+		if (!packet) {
+			packet = Z_Malloc(offsetof(voipServerPacket_t, data) + packetsize);
+			packet->sender = sender;
+			packet->frames = frames;
+			packet->len = packetsize;
+			packet->generation = generation;
+			packet->sequence = sequence;
+			memcpy(packet->data, encoded, packetsize);
+		}
 
-		client->voipPacket[(client->queuedVoipIndex + client->queuedVoipPackets) % ARRAY_LEN(client->voipPacket)] = packet;
+		packet->refCount++;
+		queued = &client->voipPacket[(client->queuedVoipIndex + client->queuedVoipPackets) % ARRAY_LEN(client->voipPacket)];
+		queued->packet = packet;
+		queued->flags = flags;
 		client->queuedVoipPackets++;
 	}
 }
+
+/*
+==================
+SV_ReleaseVoipPacket
+
+Drops one recipient's reference
+==================
+*/
+void SV_ReleaseVoipPacket(voipServerPacket_t *packet)
+{
+	if (--packet->refCount <= 0)
+		Z_Free(packet);
+}
 #endif
 
 
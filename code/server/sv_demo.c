@@ -0,0 +1,819 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// sv_demo.c -- server demos holding every client's view of a match
+
+#include "server.h"
+
+/*
+=============================================================================
+
+A server demo records a match once for all clients.  Each frame delta
+encodes the entities any client was sent against the previous frame, then
+adds the playerstate, areabits and entity set of every client that got a
+snapshot, so it costs about one client's worth of encoding.  svdemo_pov
+turns one client's view back into a normal demo.
+
+After the header the file holds messages the way client demos do, a
+length and the bits.  The first message is the gamestate, each of the
+others one server frame, and a length of -1 ends the file.
+
+=============================================================================
+*/
+
+#define	SVDEMO_IDENT		(('M'<<24)+('D'<<16)+('V'<<8)+'S')
+#define	SVDEMO_VERSION		1
+#define	SVDEMO_EXT			"svdm"
+#define	SVDEMO_MSGLEN		( MAX_MSGLEN * 8 )	// all the clients' snapshots of a frame
+#define	SVDEMO_ALL_CLIENTS	255
+
+typedef enum {
+	svdm_bad,
+	svdm_eof,
+	svdm_configstring,		// short index, big string
+	svdm_baseline,			// entity delta from nullstate
+	svdm_serverCommand,		// byte client or SVDEMO_ALL_CLIENTS, string
+	svdm_frame,				// long server time, entity deltas against the last frame
+	svdm_player				// byte client, playerstate, areabits, entity set changes
+} svDemoOp_t;
+
+typedef struct {
+	int		ident;
+	int		version;
+	int		entityStateSize;
+	int		playerStateSize;
+	int		checksumFeed;
+} svDemoHeader_t;
+
+// a client as of its last recorded snapshot
+typedef struct {
+	qboolean		valid;
+	playerState_t	ps;
+	int				areabytes;
+	byte			areabits[MAX_MAP_AREA_BYTES];
+	byte			entities[MAX_GENTITIES/8];
+} svDemoPlayer_t;
+
+typedef struct {
+	fileHandle_t	file;
+	int				frames;
+
+	msg_t			msg;			// gathers the current frame
+	byte			msgData[SVDEMO_MSGLEN];
+
+	// the snapshots built since the last frame
+	qboolean		snapshot[MAX_CLIENTS];
+	svDemoPlayer_t	pending[MAX_CLIENTS];
+
+	// what the last frame held
+	byte			entities[MAX_GENTITIES/8];
+	entityState_t	states[MAX_GENTITIES];
+	svDemoPlayer_t	players[MAX_CLIENTS];
+} svDemo_t;
+
+static svDemo_t	*sv_demo;
+
+#define	DEMO_BIT( bits, e )		( (bits)[(e) >> 3] & ( 1 << ( (e) & 7 ) ) )
+
+/*
+=============================================================================
+
+RECORDING
+
+=============================================================================
+*/
+
+/*
+=============
+SV_DemoBeginMessage
+=============
+*/
+static void SV_DemoBeginMessage( void ) {
+	MSG_Init( &sv_demo->msg, sv_demo->msgData, sizeof( sv_demo->msgData ) );
+	MSG_Bitstream( &sv_demo->msg );
+	sv_demo->msg.allowoverflow = qtrue;
+}
+
+/*
+=============
+SV_DemoWriteMessage
+=============
+*/
+static void SV_DemoWriteMessage( void ) {
+	int		len;
+
+	len = LittleLong( sv_demo->msg.cursize );
+	FS_Write( &len, 4, sv_demo->file );
+	FS_Write( sv_demo->msg.data, sv_demo->msg.cursize, sv_demo->file );
+
+	SV_DemoBeginMessage();
+}
+
+/*
+=============
+SV_StopRecordingDemo
+=============
+*/
+void SV_StopRecordingDemo( void ) {
+	int		len;
+
+	if ( !sv_demo ) {
+		return;
+	}
+
+	len = -1;
+	FS_Write( &len, 4, sv_demo->file );
+	FS_FCloseFile( sv_demo->file );
+	Com_Printf( "Recorded %i server demo frames\n", sv_demo->frames );
+
+	Z_Free( sv_demo );
+	sv_demo = NULL;
+}
+
+/*
+=============
+SV_RecordDemo_f
+
+svrecord <demo> records every client's view until svrecord is given
+without a demo or the map changes
+=============
+*/
+void SV_RecordDemo_f( void ) {
+	char			filename[MAX_QPATH];
+	svDemoHeader_t	header;
+	entityState_t	nullstate, *base;
+	fileHandle_t	f;
+	msg_t			*msg;
+	int				i;
+
+	SV_StopRecordingDemo();
+
+	if ( Cmd_Argc() < 2 ) {
+		return;
+	}
+
+	if ( !com_sv_running->integer ) {
+		Com_Printf( "Server is not running.\n" );
+		return;
+	}
+
+	Com_sprintf( filename, sizeof( filename ), "demos/%s.%s", Cmd_Argv( 1 ), SVDEMO_EXT );
+	f = FS_FOpenFileWrite_HomeData( filename );
+	if ( !f ) {
+		Com_Printf( "Couldn't write %s\n", filename );
+		return;
+	}
+
+	header.ident = LittleLong( SVDEMO_IDENT );
+	header.version = LittleLong( SVDEMO_VERSION );
+	header.entityStateSize = LittleLong( sizeof( entityState_t ) );
+	header.playerStateSize = LittleLong( sizeof( playerState_t ) );
+	header.checksumFeed = LittleLong( sv.checksumFeed );
+	FS_Write( &header, sizeof( header ), f );
+
+	sv_demo = Z_Malloc( sizeof( *sv_demo ) );
+	sv_demo->file = f;
+	SV_DemoBeginMessage();
+	msg = &sv_demo->msg;
+
+	// the gamestate
+	for ( i = 0 ; i < MAX_CONFIGSTRINGS ; i++ ) {
+		if ( sv.configstrings[i][0] ) {
+			MSG_WriteByte( msg, svdm_configstring );
+			MSG_WriteShort( msg, i );
+			MSG_WriteBigString( msg, sv.configstrings[i] );
+		}
+	}
+
+	Com_Memset( &nullstate, 0, sizeof( nullstate ) );
+	for ( i = 0 ; i < MAX_GENTITIES ; i++ ) {
+		base = &sv.svEntities[i].baseline;
+		if ( !base->number ) {
+			continue;
+		}
+		MSG_WriteByte( msg, svdm_baseline );
+		MSG_WriteDeltaEntity( msg, &nullstate, base, qtrue );
+	}
+
+	MSG_WriteByte( msg, svdm_eof );
+	SV_DemoWriteMessage();
+
+	Com_Printf( "Recording server demo to %s\n", filename );
+}
+
+/*
+=============
+SV_DemoConfigstring
+=============
+*/
+void SV_DemoConfigstring( int index ) {
+	if ( !sv_demo ) {
+		return;
+	}
+
+	MSG_WriteByte( &sv_demo->msg, svdm_configstring );
+	MSG_WriteShort( &sv_demo->msg, index );
+	MSG_WriteBigString( &sv_demo->msg, sv.configstrings[index] );
+}
+
+/*
+=============
+SV_DemoServerCommand
+
+A game command for one client, or all of them with -1
+=============
+*/
+void SV_DemoServerCommand( int clientNum, const char *cmd ) {
+	if ( !sv_demo ) {
+		return;
+	}
+
+	MSG_WriteByte( &sv_demo->msg, svdm_serverCommand );
+	MSG_WriteByte( &sv_demo->msg, clientNum < 0 ? SVDEMO_ALL_CLIENTS : clientNum );
+	MSG_WriteString( &sv_demo->msg, cmd );
+}
+
+/*
+=============
+SV_DemoClientSnapshot
+
+Keeps the view of a snapshot SV_BuildClientSnapshot just made, for the
+next frame
+=============
+*/
+void SV_DemoClientSnapshot( client_t *client, clientSnapshot_t *frame, const byte *entities ) {
+	svDemoPlayer_t	*p;
+	int				clientNum;
+
+	if ( !sv_demo ) {
+		return;
+	}
+
+	clientNum = client - svs.clients;
+	p = &sv_demo->pending[clientNum];
+	p->ps = frame->ps;
+	p->areabytes = frame->areabytes;
+	Com_Memcpy( p->areabits, frame->areabits, sizeof( p->areabits ) );
+	Com_Memcpy( p->entities, entities, sizeof( p->entities ) );
+	sv_demo->snapshot[clientNum] = qtrue;
+}
+
+/*
+=============
+SV_DemoFrame
+
+Called after SV_SendClientMessages, while the entities still hold the
+states the snapshots were built from
+=============
+*/
+void SV_DemoFrame( void ) {
+	byte			sent[MAX_GENTITIES/8];
+	msg_t			*msg;
+	svDemoPlayer_t	*p, *pending;
+	entityState_t	*state;
+	int				i, e, any;
+
+	if ( !sv_demo ) {
+		return;
+	}
+
+	msg = &sv_demo->msg;
+
+	// the entities any client was sent
+	Com_Memset( sent, 0, sizeof( sent ) );
+	any = 0;
+	for ( i = 0 ; i < sv_maxclients->integer ; i++ ) {
+		if ( !sv_demo->snapshot[i] ) {
+			continue;
+		}
+		for ( e = 0 ; e < MAX_GENTITIES/8 ; e++ ) {
+			sent[e] |= sv_demo->pending[i].entities[e];
+		}
+		any++;
+	}
+
+	// commands wait for the next snapshot, or go alone if they pile up
+	if ( !any ) {
+		if ( msg->cursize > SVDEMO_MSGLEN / 2 ) {
+			MSG_WriteByte( msg, svdm_eof );
+			SV_DemoWriteMessage();
+		}
+		return;
+	}
+
+	MSG_WriteByte( msg, svdm_frame );
+	MSG_WriteLong( msg, sv.time );
+
+	for ( e = 0 ; e < MAX_GENTITIES ; e++ ) {
+		if ( !( sent[e >> 3] | sv_demo->entities[e >> 3] ) ) {
+			e |= 7;
+			continue;
+		}
+		if ( DEMO_BIT( sent, e ) ) {
+			state = &SV_GentityNum( e )->s;
+			if ( DEMO_BIT( sv_demo->entities, e ) ) {
+				MSG_WriteDeltaEntity( msg, &sv_demo->states[e], state, qfalse );
+			} else {
+				MSG_WriteDeltaEntity( msg, &sv.svEntities[e].baseline, state, qtrue );
+			}
+			sv_demo->states[e] = *state;
+		} else if ( DEMO_BIT( sv_demo->entities, e ) ) {
+			MSG_WriteDeltaEntity( msg, &sv_demo->states[e], NULL, qtrue );
+		}
+	}
+	MSG_WriteBits( msg, MAX_GENTITIES-1, GENTITYNUM_BITS );
+	Com_Memcpy( sv_demo->entities, sent, sizeof( sent ) );
+
+	for ( i = 0 ; i < sv_maxclients->integer ; i++ ) {
+		if ( !sv_demo->snapshot[i] ) {
+			continue;
+		}
+		sv_demo->snapshot[i] = qfalse;
+		p = &sv_demo->players[i];
+		pending = &sv_demo->pending[i];
+
+		MSG_WriteByte( msg, svdm_player );
+		MSG_WriteByte( msg, i );
+		MSG_WriteDeltaPlayerstate( msg, p->valid ? &p->ps : NULL, &pending->ps );
+		MSG_WriteByte( msg, pending->areabytes );
+		MSG_WriteData( msg, pending->areabits, pending->areabytes );
+
+		// the entity set only sends the bytes that changed
+		for ( e = 0 ; e < MAX_GENTITIES/8 ; e++ ) {
+			if ( p->entities[e] != pending->entities[e] ) {
+				MSG_WriteShort( msg, e );
+				MSG_WriteByte( msg, pending->entities[e] );
+			}
+		}
+		MSG_WriteShort( msg, -1 );
+
+		*p = *pending;
+		p->valid = qtrue;
+	}
+
+	MSG_WriteByte( msg, svdm_eof );
+
+	if ( msg->overflowed ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: server demo frame overflowed\n" );
+		SV_StopRecordingDemo();
+		return;
+	}
+
+	SV_DemoWriteMessage();
+	sv_demo->frames++;
+}
+
+/*
+=============================================================================
+
+ONE CLIENT'S VIEW
+
+=============================================================================
+*/
+
+typedef struct {
+	fileHandle_t	out;
+	int				clientNum;
+	int				serverTime;
+
+	// the server demo as of the message being read
+	char			*configstrings[MAX_CONFIGSTRINGS];
+	entityState_t	baselines[MAX_GENTITIES];
+	byte			entities[MAX_GENTITIES/8];
+	entityState_t	states[MAX_GENTITIES];
+	svDemoPlayer_t	players[MAX_CLIENTS];
+
+	// the client demo being written
+	msg_t			msg;
+	byte			msgData[MAX_MSGLEN];
+	int				sequence;
+	int				commandSequence;
+	int				commands;			// since the last snapshot
+	int				snapshots;
+	int				snapshotSequence;	// message of the last snapshot
+	playerState_t	sentPs;
+	byte			sentEntities[MAX_GENTITIES/8];
+	entityState_t	sentStates[MAX_GENTITIES];
+
+	byte			inData[SVDEMO_MSGLEN];
+} svDemoPov_t;
+
+/*
+=============
+SV_DemoPovBeginMessage
+=============
+*/
+static void SV_DemoPovBeginMessage( svDemoPov_t *pov ) {
+	MSG_Init( &pov->msg, pov->msgData, sizeof( pov->msgData ) );
+	MSG_Bitstream( &pov->msg );
+
+	// the reliable acknowledge every server message starts with
+	MSG_WriteLong( &pov->msg, 0 );
+}
+
+/*
+=============
+SV_DemoPovWriteMessage
+=============
+*/
+static void SV_DemoPovWriteMessage( svDemoPov_t *pov ) {
+	int		len;
+
+	MSG_WriteByte( &pov->msg, svc_EOF );
+
+	len = LittleLong( pov->sequence );
+	FS_Write( &len, 4, pov->out );
+	len = LittleLong( pov->msg.cursize );
+	FS_Write( &len, 4, pov->out );
+	FS_Write( pov->msg.data, pov->msg.cursize, pov->out );
+
+	pov->sequence++;
+	SV_DemoPovBeginMessage( pov );
+}
+
+/*
+=============
+SV_DemoPovCommand
+
+The cgame reads commands when snapshots arrive, so ones that would cycle
+out of its buffer while the client is gone are dropped
+=============
+*/
+static void SV_DemoPovCommand( svDemoPov_t *pov, const char *cmd ) {
+	if ( !pov->snapshots || pov->commands >= MAX_RELIABLE_COMMANDS / 2 ) {
+		return;
+	}
+
+	if ( pov->msg.cursize + strlen( cmd ) + 16 > MAX_MSGLEN / 2 ) {
+		SV_DemoPovWriteMessage( pov );
+	}
+
+	MSG_WriteByte( &pov->msg, svc_serverCommand );
+	MSG_WriteLong( &pov->msg, ++pov->commandSequence );
+	MSG_WriteString( &pov->msg, cmd );
+	pov->commands++;
+}
+
+/*
+=============
+SV_DemoPovConfigstring
+
+Same commands as SV_SendConfigstring
+=============
+*/
+static void SV_DemoPovConfigstring( svDemoPov_t *pov, int index ) {
+	int		maxChunkSize = MAX_STRING_CHARS - 24;
+	int		sent, remaining;
+	char	buf[MAX_STRING_CHARS];
+	char	*cmd;
+	const char	*s = pov->configstrings[index];
+
+	remaining = strlen( s );
+	if ( remaining < maxChunkSize ) {
+		SV_DemoPovCommand( pov, va( "cs %i \"%s\"\n", index, s ) );
+		return;
+	}
+
+	for ( sent = 0 ; remaining > 0 ; sent += maxChunkSize - 1, remaining -= maxChunkSize - 1 ) {
+		if ( sent == 0 ) {
+			cmd = "bcs0";
+		} else if ( remaining < maxChunkSize ) {
+			cmd = "bcs2";
+		} else {
+			cmd = "bcs1";
+		}
+		Q_strncpyz( buf, &s[sent], maxChunkSize );
+		SV_DemoPovCommand( pov, va( "%s %i \"%s\"\n", cmd, index, buf ) );
+	}
+}
+
+/*
+=============
+SV_DemoPovGamestate
+
+Written before the client's first snapshot, with the configstrings
+of that moment
+=============
+*/
+static void SV_DemoPovGamestate( svDemoPov_t *pov ) {
+	entityState_t	nullstate;
+	msg_t			*msg = &pov->msg;
+	int				i;
+
+	SV_DemoPovBeginMessage( pov );
+
+	MSG_WriteByte( msg, svc_gamestate );
+	MSG_WriteLong( msg, pov->commandSequence );
+
+	for ( i = 0 ; i < MAX_CONFIGSTRINGS ; i++ ) {
+		if ( pov->configstrings[i] && pov->configstrings[i][0] ) {
+			MSG_WriteByte( msg, svc_configstring );
+			MSG_WriteShort( msg, i );
+			MSG_WriteBigString( msg, pov->configstrings[i] );
+		}
+	}
+
+	Com_Memset( &nullstate, 0, sizeof( nullstate ) );
+	for ( i = 0 ; i < MAX_GENTITIES ; i++ ) {
+		if ( !pov->baselines[i].number ) {
+			continue;
+		}
+		MSG_WriteByte( msg, svc_baseline );
+		MSG_WriteDeltaEntity( msg, &nullstate, &pov->baselines[i], qtrue );
+	}
+
+	MSG_WriteByte( msg, svc_EOF );
+
+	MSG_WriteLong( msg, pov->clientNum );
+	// the checksum feed follows, and SV_DemoPovWriteMessage ends it
+}
+
+/*
+=============
+SV_DemoPovSnapshot
+=============
+*/
+static void SV_DemoPovSnapshot( svDemoPov_t *pov ) {
+	svDemoPlayer_t	*p = &pov->players[pov->clientNum];
+	msg_t			*msg = &pov->msg;
+	qboolean		delta;
+	int				e, was, is;
+
+	// a snapshot can take most of a message
+	if ( msg->cursize > MAX_MSGLEN / 4 ) {
+		SV_DemoPovWriteMessage( pov );
+	}
+
+	delta = pov->snapshots && pov->sequence - pov->snapshotSequence < PACKET_BACKUP - 3;
+
+	MSG_WriteByte( msg, svc_snapshot );
+	MSG_WriteLong( msg, pov->serverTime );
+	MSG_WriteByte( msg, delta ? pov->sequence - pov->snapshotSequence : 0 );
+	MSG_WriteByte( msg, 0 );		// snapFlags
+	MSG_WriteByte( msg, p->areabytes );
+	MSG_WriteData( msg, p->areabits, p->areabytes );
+
+	MSG_WriteDeltaPlayerstate( msg, delta ? &pov->sentPs : NULL, &p->ps );
+
+	for ( e = 0 ; e < MAX_GENTITIES ; e++ ) {
+		was = delta && DEMO_BIT( pov->sentEntities, e );
+		is = DEMO_BIT( p->entities, e );
+		if ( is && was ) {
+			MSG_WriteDeltaEntity( msg, &pov->sentStates[e], &pov->states[e], qfalse );
+		} else if ( is ) {
+			MSG_WriteDeltaEntity( msg, &pov->baselines[e], &pov->states[e], qtrue );
+		} else if ( was ) {
+			MSG_WriteDeltaEntity( msg, &pov->sentStates[e], NULL, qtrue );
+		}
+		if ( is ) {
+			pov->sentStates[e] = pov->states[e];
+		}
+	}
+	MSG_WriteBits( msg, MAX_GENTITIES-1, GENTITYNUM_BITS );
+
+	pov->sentPs = p->ps;
+	Com_Memcpy( pov->sentEntities, p->entities, sizeof( pov->sentEntities ) );
+	pov->snapshotSequence = pov->sequence;
+	pov->snapshots++;
+	pov->commands = 0;
+
+	SV_DemoPovWriteMessage( pov );
+}
+
+/*
+=============
+SV_DemoPovMessage
+
+Applies one server demo message, writing what the client saw of it
+=============
+*/
+static qboolean SV_DemoPovMessage( svDemoPov_t *pov, msg_t *msg, int checksumFeed ) {
+	entityState_t	nullstate, state;
+	playerState_t	ps;
+	svDemoPlayer_t	*p;
+	const char		*s;
+	int				op, i, e;
+
+	Com_Memset( &nullstate, 0, sizeof( nullstate ) );
+
+	while ( 1 ) {
+		if ( msg->readcount > msg->cursize ) {
+			return qfalse;
+		}
+
+		op = MSG_ReadByte( msg );
+		switch ( op ) {
+		case svdm_eof:
+			return qtrue;
+
+		case svdm_configstring:
+			i = MSG_ReadShort( msg );
+			if ( i < 0 || i >= MAX_CONFIGSTRINGS ) {
+				return qfalse;
+			}
+			s = MSG_ReadBigString( msg );
+			if ( pov->configstrings[i] ) {
+				Z_Free( pov->configstrings[i] );
+			}
+			pov->configstrings[i] = CopyString( s );
+			SV_DemoPovConfigstring( pov, i );
+			break;
+
+		case svdm_baseline:
+			e = MSG_ReadBits( msg, GENTITYNUM_BITS );
+			MSG_ReadDeltaEntity( msg, &nullstate, &pov->baselines[e], e );
+			break;
+
+		case svdm_serverCommand:
+			i = MSG_ReadByte( msg );
+			s = MSG_ReadString( msg );
+			if ( i == SVDEMO_ALL_CLIENTS || i == pov->clientNum ) {
+				SV_DemoPovCommand( pov, s );
+			}
+			break;
+
+		case svdm_frame:
+			pov->serverTime = MSG_ReadLong( msg );
+			while ( 1 ) {
+				e = MSG_ReadBits( msg, GENTITYNUM_BITS );
+				if ( e == MAX_GENTITIES-1 ) {
+					break;
+				}
+				if ( msg->readcount > msg->cursize ) {
+					return qfalse;
+				}
+				MSG_ReadDeltaEntity( msg, DEMO_BIT( pov->entities, e ) ? &pov->states[e] : &pov->baselines[e], &state, e );
+				if ( state.number == MAX_GENTITIES-1 ) {
+					pov->entities[e >> 3] &= ~( 1 << ( e & 7 ) );
+				} else {
+					pov->entities[e >> 3] |= 1 << ( e & 7 );
+					pov->states[e] = state;
+				}
+			}
+			break;
+
+		case svdm_player:
+			i = MSG_ReadByte( msg );
+			if ( i >= MAX_CLIENTS ) {
+				return qfalse;
+			}
+			p = &pov->players[i];
+			MSG_ReadDeltaPlayerstate( msg, p->valid ? &p->ps : NULL, &ps );
+			p->ps = ps;
+			p->valid = qtrue;
+
+			p->areabytes = MSG_ReadByte( msg );
+			if ( p->areabytes > MAX_MAP_AREA_BYTES ) {
+				return qfalse;
+			}
+			MSG_ReadData( msg, p->areabits, p->areabytes );
+
+			while ( ( e = MSG_ReadShort( msg ) ) != -1 ) {
+				if ( e < 0 || e >= MAX_GENTITIES/8 || msg->readcount > msg->cursize ) {
+					return qfalse;
+				}
+				p->entities[e] = MSG_ReadByte( msg );
+			}
+
+			if ( i == pov->clientNum ) {
+				if ( !pov->snapshots ) {
+					SV_DemoPovGamestate( pov );
+					MSG_WriteLong( &pov->msg, checksumFeed );
+					SV_DemoPovWriteMessage( pov );
+				}
+				SV_DemoPovSnapshot( pov );
+			}
+			break;
+
+		default:
+			return qfalse;
+		}
+	}
+}
+
+/*
+=============
+SV_DemoPov_f
+
+svdemo_pov <svdemo> <client> [demo] writes what a client saw in a server
+demo as a client demo
+=============
+*/
+void SV_DemoPov_f( void ) {
+	char			filename[MAX_OSPATH];
+	char			demoName[MAX_QPATH];
+	svDemoHeader_t	header;
+	svDemoPov_t		*pov;
+	fileHandle_t	in;
+	msg_t			msg;
+	int				len, i;
+
+	if ( Cmd_Argc() < 3 ) {
+		Com_Printf( "usage: svdemo_pov <svdemo> <client> [demo]\n" );
+		return;
+	}
+
+	Com_sprintf( filename, sizeof( filename ), "demos/%s.%s", Cmd_Argv( 1 ), SVDEMO_EXT );
+	FS_FOpenFileRead( filename, &in, qtrue );
+	if ( !in ) {
+		Com_Printf( "Couldn't open %s\n", filename );
+		return;
+	}
+
+	if ( FS_Read( &header, sizeof( header ), in ) != sizeof( header )
+		|| LittleLong( header.ident ) != SVDEMO_IDENT
+		|| LittleLong( header.version ) != SVDEMO_VERSION
+		|| LittleLong( header.entityStateSize ) != sizeof( entityState_t )
+		|| LittleLong( header.playerStateSize ) != sizeof( playerState_t ) ) {
+		Com_Printf( "%s is not a server demo of this version\n", filename );
+		FS_FCloseFile( in );
+		return;
+	}
+
+	pov = Z_Malloc( sizeof( *pov ) );
+	pov->clientNum = atoi( Cmd_Argv( 2 ) );
+	if ( pov->clientNum < 0 || pov->clientNum >= MAX_CLIENTS ) {
+		Com_Printf( "Bad client number %i\n", pov->clientNum );
+		Z_Free( pov );
+		FS_FCloseFile( in );
+		return;
+	}
+
+	if ( Cmd_Argc() > 3 ) {
+		Q_strncpyz( demoName, Cmd_Argv( 3 ), sizeof( demoName ) );
+	} else {
+		Com_sprintf( demoName, sizeof( demoName ), "%s_%i", Cmd_Argv( 1 ), pov->clientNum );
+	}
+	Com_sprintf( filename, sizeof( filename ), "demos/%s.%s%d", demoName, DEMOEXT, com_protocol->integer );
+	pov->out = FS_FOpenFileWrite_HomeData( filename );
+	if ( !pov->out ) {
+		Com_Printf( "Couldn't write %s\n", filename );
+		Z_Free( pov );
+		FS_FCloseFile( in );
+		return;
+	}
+
+	SV_DemoPovBeginMessage( pov );
+
+	while ( FS_Read( &len, 4, in ) == 4 ) {
+		len = LittleLong( len );
+		if ( len == -1 ) {
+			break;
+		}
+		if ( len < 0 || len > sizeof( pov->inData ) || FS_Read( pov->inData, len, in ) != len ) {
+			Com_Printf( S_COLOR_YELLOW "WARNING: server demo is truncated\n" );
+			break;
+		}
+
+		MSG_Init( &msg, pov->inData, sizeof( pov->inData ) );
+		msg.cursize = len;
+		MSG_BeginReading( &msg );
+		if ( !SV_DemoPovMessage( pov, &msg, LittleLong( header.checksumFeed ) ) ) {
+			Com_Printf( S_COLOR_YELLOW "WARNING: bad server demo message\n" );
+			break;
+		}
+	}
+
+	// commands that came after the last snapshot
+	if ( pov->snapshots && pov->msg.cursize > 4 ) {
+		SV_DemoPovWriteMessage( pov );
+	}
+
+	len = -1;
+	FS_Write( &len, 4, pov->out );
+	FS_Write( &len, 4, pov->out );
+	FS_FCloseFile( pov->out );
+	FS_FCloseFile( in );
+
+	if ( pov->snapshots ) {
+		Com_Printf( "Wrote %i snapshots of client %i to %s\n", pov->snapshots, pov->clientNum, filename );
+	} else {
+		Com_Printf( "Client %i has no snapshots in the server demo\n", pov->clientNum );
+		FS_Remove_HomeData( filename );
+	}
+
+	for ( i = 0 ; i < MAX_CONFIGSTRINGS ; i++ ) {
+		if ( pov->configstrings[i] ) {
+			Z_Free( pov->configstrings[i] );
+		}
+	}
+	Z_Free( pov );
+}
@@ -75,6 +75,10 @@ Sends a command string to a client
 ===============
 */
 void SV_GameSendServerCommand( int clientNum, const char *text ) {
+	if ( clientNum >= -1 && clientNum < sv_maxclients->integer ) {
+		SV_DemoServerCommand( clientNum, text );
+	}
+
 	if ( clientNum == -1 ) {
 		SV_SendServerCommand( NULL, "%s", text );
 	} else {
@@ -274,6 +278,29 @@ void SV_GetUsercmd( int clientNum, usercmd_t *cmd ) {
 	*cmd = svs.clients[clientNum].lastUsercmd;
 }
 
+/*
+===============
+SV_GetUsercmds
+
+The commands of the batch the game is running for a client
+===============
+*/
+static int SV_GetUsercmds( int clientNum, usercmd_t *cmds, int maxCmds ) {
+	client_t	*cl;
+	int			count;
+
+	if ( clientNum < 0 || clientNum >= sv_maxclients->integer ) {
+		Com_Error( ERR_DROP, "SV_GetUsercmds: bad clientNum:%i", clientNum );
+	}
+	cl = &svs.clients[clientNum];
+
+	count = MIN( cl->numThinkCmds, maxCmds );
+	if ( count > 0 ) {
+		Com_Memcpy( cmds, cl->thinkCmds, count * sizeof( *cmds ) );
+	}
+	return MAX( count, 0 );
+}
+
 //==============================================
 
 static int	FloatAsInt( float f ) {
@@ -282,6 +309,41 @@ static int	FloatAsInt( float f ) {
 	return fi.i;
 }
 
+/*
+====================
+Native game traps
+
+Called straight from a native game library, without packing the
+arguments for SV_GameSystemCalls
+====================
+*/
+static void SV_NativeTrace( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask ) {
+	SV_Trace( results, start, (float *)mins, (float *)maxs, end, passEntityNum, contentmask, qfalse );
+}
+
+static void SV_NativeTraceCapsule( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask ) {
+	SV_Trace( results, start, (float *)mins, (float *)maxs, end, passEntityNum, contentmask, qtrue );
+}
+
+static qboolean SV_NativeEntityContact( const vec3_t mins, const vec3_t maxs, const sharedEntity_t *ent ) {
+	return SV_EntityContact( (float *)mins, (float *)maxs, ent, qfalse );
+}
+
+static qboolean SV_NativeEntityContactCapsule( const vec3_t mins, const vec3_t maxs, const sharedEntity_t *ent ) {
+	return SV_EntityContact( (float *)mins, (float *)maxs, ent, qtrue );
+}
+
+static const gameNativeTraps_t sv_nativeTraps = {
+	SV_NativeTrace,
+	SV_NativeTraceCapsule,
+	SV_PointContents,
+	SV_AreaEntities,
+	SV_NativeEntityContact,
+	SV_NativeEntityContactCapsule,
+	SV_LinkEntity,
+	SV_UnlinkEntity
+};
+
 /*
 ====================
 SV_GameSystemCalls
@@ -301,10 +363,21 @@ intptr_t SV_GameSystemCalls( intptr_t *args ) {
 		return Sys_Milliseconds();
 	case G_CVAR_REGISTER:
 		Cvar_Register( VMA(1), VMA(2), VMA(3), args[4] ); 
+		Cvar_Track( CVAR_TRACK_GAME, VMA(1) );
 		return 0;
 	case G_CVAR_UPDATE:
 		Cvar_Update( VMA(1) );
 		return 0;
+	case G_CVAR_UPDATE_CHANGED:
+		return Cvar_UpdateTracked( CVAR_TRACK_GAME );
+	case G_TRACE_BATCH:
+		SV_TraceMany( VMA(1), VMA(2), args[3], /*int capsule*/ qfalse );
+		return 0;
+	case G_TRIGGERS_IN_BOX:
+		return SV_TriggersInBox( args[1], VMA(2), VMA(3), VMA(4), args[5] );
+	case G_TRACE_AT_TIME:
+		SV_TraceAtTime( VMA(1), VMA(2), VMA(3), VMA(4), VMA(5), args[6], args[7], /*int capsule*/ qfalse, args[8] );
+		return 0;
 	case G_CVAR_SET:
 		Cvar_SetSafe( (const char *)VMA(1), (const char *)VMA(2) );
 		return 0;
@@ -337,6 +410,8 @@ intptr_t SV_GameSystemCalls( intptr_t *args ) {
 		return FS_GetFileList( VMA(1), VMA(2), VMA(3), args[4] );
 	case G_FS_SEEK:
 		return FS_Seek( args[1], args[2], args[3] );
+	case G_GET_NATIVE_TRAPS:
+		return VM_IsNative( gvm ) ? (intptr_t)&sv_nativeTraps : 0;
 
 	case G_LOCATE_GAME_DATA:
 		SV_LocateGameData( VMA(1), args[2], args[3], VMA(4), args[5] );
@@ -405,6 +480,8 @@ intptr_t SV_GameSystemCalls( intptr_t *args ) {
 	case G_GET_USERCMD:
 		SV_GetUsercmd( args[1], VMA(2) );
 		return 0;
+	case G_GET_USERCMDS:
+		return SV_GetUsercmds( args[1], VMA(2), args[3] );
 	case G_GET_ENTITY_TOKEN:
 		{
 			const char	*s;
@@ -863,6 +940,7 @@ void SV_ShutdownGameProgs( void ) {
 	VM_Call( gvm, GAME_SHUTDOWN, qfalse );
 	VM_Free( gvm );
 	gvm = NULL;
+	Cvar_ClearTracked( CVAR_TRACK_GAME );
 }
 
 /*
@@ -885,6 +963,9 @@ static void SV_InitGameVM( qboolean restart ) {
 	for ( i = 0 ; i < sv_maxclients->integer ; i++ ) {
 		svs.clients[i].gentity = NULL;
 	}
+
+	// the game registers its cvars again from GAME_INIT
+	Cvar_ClearTracked( CVAR_TRACK_GAME );
 	
 	// use the current msec count for a random seed
 	// init for this gamestate
@@ -0,0 +1,599 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// sv_http.c -- the dedicated server's own download server
+
+#ifdef __linux__
+#	ifndef _GNU_SOURCE
+#		define _GNU_SOURCE
+#	endif
+#endif
+
+#include "server.h"
+
+#ifdef _WIN32
+#	include <winsock2.h>
+typedef int socklen_t;
+#	define socketError		WSAGetLastError( )
+#	define EWOULDBLOCK_ERROR	WSAEWOULDBLOCK
+#else
+#	include <sys/socket.h>
+#	include <sys/types.h>
+#	include <sys/time.h>
+#	include <netinet/in.h>
+#	include <arpa/inet.h>
+#	include <errno.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#	ifdef __linux__
+#		include <sys/sendfile.h>
+#	endif
+typedef int SOCKET;
+#	define INVALID_SOCKET		-1
+#	define closesocket			close
+#	define socketError			errno
+#	define EWOULDBLOCK_ERROR	EAGAIN
+#endif
+
+/*
+=============================================================================
+
+With sv_httpPort set a dedicated server serves the pk3s clients may
+download over HTTP itself, and advertises the listener as sv_dlURL when
+none is set, so clients fetch them through cURL instead of the UDP
+downloads SV_WriteDownloadToClient pumps from the frame.
+
+One thread does all of the listening, parsing and sending on non-blocking
+sockets.  The main thread only hands it the list of downloadable paks at
+each map start; the frame itself does no download work.  Files are sent
+straight from the pk3 with sendfile where the system has it.
+
+=============================================================================
+*/
+
+#define	HTTP_MAX_CONNECTIONS	32
+#define	HTTP_MAX_PAKS			512
+#define	HTTP_REQUEST_SIZE		2048
+#define	HTTP_TIMEOUT_MSEC		30000	// idle connections are closed
+#define	HTTP_SELECT_MSEC		100		// how soon shutdown is noticed
+#define	HTTP_CHUNK				( 64 * 1024 )
+
+typedef struct {
+	char		name[MAX_QPATH];	// main/pak.pk3, as clients ask for it
+	char		path[MAX_OSPATH];
+} httpPak_t;
+
+typedef struct {
+	SOCKET		sock;
+	int			lastActive;
+
+	char		request[HTTP_REQUEST_SIZE];
+	int			requestLength;
+
+	char		header[512];		// sent before the file
+	int			headerLength;
+	int			headerSent;
+
+	FILE		*file;
+	long		offset;
+	long		size;
+} httpConnection_t;
+
+static struct {
+	void				*thread;
+	volatile int		shutdown;
+	SOCKET				listener;
+	int					port;
+
+	void				*pakLock;
+	int					numPaks;
+	httpPak_t			paks[HTTP_MAX_PAKS];
+
+	httpConnection_t	connections[HTTP_MAX_CONNECTIONS];
+	byte				buffer[HTTP_CHUNK];		// where sendfile is missing
+} sv_http;
+
+static cvar_t	*sv_httpPort;
+static cvar_t	*sv_httpHost;
+
+/*
+==================
+SV_HTTPSetNonBlocking
+==================
+*/
+static qboolean SV_HTTPSetNonBlocking( SOCKET sock ) {
+#ifdef _WIN32
+	u_long	arg = 1;
+
+	return ioctlsocket( sock, FIONBIO, &arg ) != SOCKET_ERROR;
+#else
+	return fcntl( sock, F_SETFL, fcntl( sock, F_GETFL, 0 ) | O_NONBLOCK ) != -1;
+#endif
+}
+
+/*
+==================
+SV_HTTPClose
+==================
+*/
+static void SV_HTTPClose( httpConnection_t *c ) {
+	if ( c->file ) {
+		fclose( c->file );
+	}
+	closesocket( c->sock );
+	Com_Memset( c, 0, sizeof( *c ) );
+	c->sock = INVALID_SOCKET;
+}
+
+/*
+==================
+SV_HTTPRespond
+==================
+*/
+static void SV_HTTPRespond( httpConnection_t *c, const char *status, long length ) {
+	c->headerLength = Com_sprintf( c->header, sizeof( c->header ),
+		"HTTP/1.1 %s\r\n"
+		"Content-Type: application/octet-stream\r\n"
+		"Content-Length: %ld\r\n"
+		"Connection: close\r\n"
+		"\r\n", status, length );
+	c->headerSent = 0;
+}
+
+/*
+==================
+SV_HTTPFindPak
+
+Finds the file of a pak the clients of this map may download
+==================
+*/
+static qboolean SV_HTTPFindPak( const char *name, char *path, int pathSize ) {
+	qboolean	found = qfalse;
+	int			i;
+
+	Sys_LockMutex( sv_http.pakLock );
+	for ( i = 0 ; i < sv_http.numPaks ; i++ ) {
+		if ( !Q_stricmp( sv_http.paks[i].name, name ) ) {
+			Q_strncpyz( path, sv_http.paks[i].path, pathSize );
+			found = qtrue;
+			break;
+		}
+	}
+	Sys_UnlockMutex( sv_http.pakLock );
+
+	return found;
+}
+
+/*
+==================
+SV_HTTPParseRequest
+
+Answers a complete request header, only GET and HEAD of the listed paks
+==================
+*/
+static void SV_HTTPParseRequest( httpConnection_t *c ) {
+	char		name[MAX_QPATH];
+	char		path[MAX_OSPATH];
+	char		*s, *uri;
+	qboolean	head;
+	int			i, hex;
+
+	s = c->request;
+	if ( !Q_strncmp( s, "GET ", 4 ) ) {
+		head = qfalse;
+		uri = s + 4;
+	} else if ( !Q_strncmp( s, "HEAD ", 5 ) ) {
+		head = qtrue;
+		uri = s + 5;
+	} else {
+		SV_HTTPRespond( c, "405 Method Not Allowed", 0 );
+		return;
+	}
+
+	// the path without the leading slash or a query, decoded
+	while ( *uri == '/' ) {
+		uri++;
+	}
+	for ( i = 0 ; *uri && *uri != ' ' && *uri != '?' && *uri != '\r' ; uri++ ) {
+		if ( i == sizeof( name ) - 1 ) {
+			SV_HTTPRespond( c, "404 Not Found", 0 );
+			return;
+		}
+		if ( *uri == '%' && sscanf( uri + 1, "%2x", &hex ) == 1 ) {
+			name[i++] = hex;
+			uri += 2;
+		} else {
+			name[i++] = *uri;
+		}
+	}
+	name[i] = 0;
+
+	if ( !SV_HTTPFindPak( name, path, sizeof( path ) ) ) {
+		SV_HTTPRespond( c, "404 Not Found", 0 );
+		return;
+	}
+
+	c->file = Sys_FOpen( path, "rb" );
+	if ( !c->file ) {
+		SV_HTTPRespond( c, "404 Not Found", 0 );
+		return;
+	}
+	fseek( c->file, 0, SEEK_END );
+	c->size = ftell( c->file );
+	c->offset = 0;
+	SV_HTTPRespond( c, "200 OK", c->size );
+
+	if ( head ) {
+		fclose( c->file );
+		c->file = NULL;
+	}
+}
+
+/*
+==================
+SV_HTTPRead
+
+Returns qfalse when the connection is done with
+==================
+*/
+static qboolean SV_HTTPRead( httpConnection_t *c ) {
+	int		r;
+
+	r = recv( c->sock, c->request + c->requestLength, sizeof( c->request ) - 1 - c->requestLength, 0 );
+	if ( r <= 0 ) {
+		return r < 0 && socketError == EWOULDBLOCK_ERROR;
+	}
+	c->requestLength += r;
+	c->request[c->requestLength] = 0;
+
+	if ( strstr( c->request, "\r\n\r\n" ) ) {
+		SV_HTTPParseRequest( c );
+	} else if ( c->requestLength == sizeof( c->request ) - 1 ) {
+		SV_HTTPRespond( c, "400 Bad Request", 0 );
+	}
+	return qtrue;
+}
+
+/*
+==================
+SV_HTTPWrite
+
+Returns qfalse when the connection is done with
+==================
+*/
+static qboolean SV_HTTPWrite( httpConnection_t *c ) {
+	int		r, length;
+
+	if ( c->headerSent < c->headerLength ) {
+		r = send( c->sock, c->header + c->headerSent, c->headerLength - c->headerSent, 0 );
+		if ( r < 0 ) {
+			return socketError == EWOULDBLOCK_ERROR;
+		}
+		c->headerSent += r;
+		return c->headerSent < c->headerLength || c->file;
+	}
+
+	if ( !c->file || c->offset >= c->size ) {
+		return qfalse;
+	}
+
+	length = MIN( c->size - c->offset, HTTP_CHUNK );
+#ifdef __linux__
+	{
+		off_t	offset = c->offset;
+
+		r = sendfile( c->sock, fileno( c->file ), &offset, length );
+	}
+#else
+	fseek( c->file, c->offset, SEEK_SET );
+	length = fread( sv_http.buffer, 1, length, c->file );
+	if ( length <= 0 ) {
+		return qfalse;
+	}
+	r = send( c->sock, (const char *)sv_http.buffer, length, 0 );
+#endif
+	if ( r < 0 ) {
+		return socketError == EWOULDBLOCK_ERROR;
+	}
+	if ( r == 0 ) {
+		return qfalse;
+	}
+	c->offset += r;
+
+	return c->offset < c->size;
+}
+
+/*
+==================
+SV_HTTPAccept
+==================
+*/
+static void SV_HTTPAccept( int now ) {
+	httpConnection_t	*c;
+	SOCKET				sock;
+	int					i;
+
+	sock = accept( sv_http.listener, NULL, NULL );
+	if ( sock == INVALID_SOCKET ) {
+		return;
+	}
+
+	for ( i = 0, c = sv_http.connections ; i < HTTP_MAX_CONNECTIONS ; i++, c++ ) {
+		if ( c->sock == INVALID_SOCKET ) {
+			break;
+		}
+	}
+	if ( i == HTTP_MAX_CONNECTIONS || !SV_HTTPSetNonBlocking( sock ) ) {
+		closesocket( sock );
+		return;
+	}
+
+	c->sock = sock;
+	c->lastActive = now;
+}
+
+/*
+==================
+SV_HTTPThread
+==================
+*/
+static void SV_HTTPThread( void *arg ) {
+	httpConnection_t	*c;
+	fd_set				readSet, writeSet;
+	struct timeval		timeout;
+	SOCKET				highest;
+	int					i, now;
+	qboolean			keep;
+
+	while ( !sv_http.shutdown ) {
+		FD_ZERO( &readSet );
+		FD_ZERO( &writeSet );
+		FD_SET( sv_http.listener, &readSet );
+		highest = sv_http.listener;
+
+		for ( i = 0, c = sv_http.connections ; i < HTTP_MAX_CONNECTIONS ; i++, c++ ) {
+			if ( c->sock == INVALID_SOCKET ) {
+				continue;
+			}
+			// read until there is a response to send
+			if ( c->headerLength ) {
+				FD_SET( c->sock, &writeSet );
+			} else {
+				FD_SET( c->sock, &readSet );
+			}
+			if ( c->sock > highest ) {
+				highest = c->sock;
+			}
+		}
+
+		timeout.tv_sec = 0;
+		timeout.tv_usec = HTTP_SELECT_MSEC * 1000;
+		if ( select( highest + 1, &readSet, &writeSet, NULL, &timeout ) < 0 ) {
+			Sys_Sleep( HTTP_SELECT_MSEC );
+			continue;
+		}
+
+		now = Sys_Milliseconds();
+		for ( i = 0, c = sv_http.connections ; i < HTTP_MAX_CONNECTIONS ; i++, c++ ) {
+			if ( c->sock == INVALID_SOCKET ) {
+				continue;
+			}
+
+			keep = qtrue;
+			if ( FD_ISSET( c->sock, &readSet ) ) {
+				keep = SV_HTTPRead( c );
+				c->lastActive = now;
+			} else if ( FD_ISSET( c->sock, &writeSet ) ) {
+				keep = SV_HTTPWrite( c );
+				c->lastActive = now;
+			} else if ( now - c->lastActive > HTTP_TIMEOUT_MSEC ) {
+				keep = qfalse;
+			}
+
+			if ( !keep ) {
+				SV_HTTPClose( c );
+			}
+		}
+
+		if ( FD_ISSET( sv_http.listener, &readSet ) ) {
+			SV_HTTPAccept( now );
+		}
+	}
+
+	for ( i = 0, c = sv_http.connections ; i < HTTP_MAX_CONNECTIONS ; i++, c++ ) {
+		if ( c->sock != INVALID_SOCKET ) {
+			SV_HTTPClose( c );
+		}
+	}
+}
+
+/*
+==================
+SV_HTTPShutdown
+==================
+*/
+void SV_HTTPShutdown( void ) {
+	if ( !sv_http.thread ) {
+		return;
+	}
+
+	sv_http.shutdown = qtrue;
+	Sys_JoinThread( sv_http.thread );
+	sv_http.thread = NULL;
+
+	closesocket( sv_http.listener );
+	sv_http.listener = INVALID_SOCKET;
+	sv_http.port = 0;
+	sv_http.numPaks = 0;
+
+	Com_Printf( "HTTP downloads stopped\n" );
+}
+
+/*
+==================
+SV_HTTPListen
+==================
+*/
+static qboolean SV_HTTPListen( int port ) {
+	struct sockaddr_in	addr;
+	const char			*ip;
+	int					i, reuse = 1;
+
+	sv_http.listener = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+	if ( sv_http.listener == INVALID_SOCKET ) {
+		Com_Printf( "WARNING: SV_HTTPListen: socket: %i\n", socketError );
+		return qfalse;
+	}
+	setsockopt( sv_http.listener, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse, sizeof( reuse ) );
+
+	// the same interface the game listens on
+	Com_Memset( &addr, 0, sizeof( addr ) );
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons( port );
+	ip = Cvar_VariableString( "net_ip" );
+	addr.sin_addr.s_addr = inet_addr( ip );
+	if ( addr.sin_addr.s_addr == INADDR_NONE ) {
+		addr.sin_addr.s_addr = INADDR_ANY;
+	}
+
+	if ( bind( sv_http.listener, (struct sockaddr *)&addr, sizeof( addr ) ) < 0
+		|| listen( sv_http.listener, HTTP_MAX_CONNECTIONS ) < 0
+		|| !SV_HTTPSetNonBlocking( sv_http.listener ) ) {
+		Com_Printf( "WARNING: Couldn't listen for HTTP downloads on port %i: %i\n", port, socketError );
+		closesocket( sv_http.listener );
+		sv_http.listener = INVALID_SOCKET;
+		return qfalse;
+	}
+
+	for ( i = 0 ; i < HTTP_MAX_CONNECTIONS ; i++ ) {
+		sv_http.connections[i].sock = INVALID_SOCKET;
+	}
+	sv_http.shutdown = qfalse;
+	sv_http.port = port;
+	if ( !sv_http.pakLock ) {
+		sv_http.pakLock = Sys_CreateMutex();
+	}
+	sv_http.thread = Sys_CreateThread( SV_HTTPThread, NULL );
+	if ( !sv_http.thread ) {
+		Com_Printf( "WARNING: Couldn't start the HTTP download thread\n" );
+		closesocket( sv_http.listener );
+		sv_http.listener = INVALID_SOCKET;
+		sv_http.port = 0;
+		return qfalse;
+	}
+
+	Com_Printf( "HTTP downloads on port %i\n", port );
+	return qtrue;
+}
+
+/*
+==================
+SV_HTTPSpawn
+
+Called once the map's referenced paks are known, hands the ones that
+may be downloaded to the download thread
+==================
+*/
+void SV_HTTPSpawn( void ) {
+	char		pak[MAX_QPATH];
+	const char	*path;
+	int			i, numPaks;
+
+	if ( !com_dedicated->integer || !sv_httpPort->integer ) {
+		SV_HTTPShutdown();
+		return;
+	}
+
+	if ( sv_http.port != sv_httpPort->integer ) {
+		SV_HTTPShutdown();
+		if ( !SV_HTTPListen( sv_httpPort->integer ) ) {
+			return;
+		}
+	}
+
+	// the same paks SV_WriteDownloadToClient would send
+	Sys_LockMutex( sv_http.pakLock );
+	numPaks = 0;
+	if ( ( sv_allowDownload->integer & DLF_ENABLE ) && !( sv_allowDownload->integer & DLF_NO_REDIRECT ) ) {
+		Cmd_TokenizeStringIgnoreQuotes( FS_ReferencedPakNames() );
+		for ( i = 0 ; i < Cmd_Argc() && numPaks < HTTP_MAX_PAKS ; i++ ) {
+			Q_strncpyz( pak, Cmd_Argv( i ), sizeof( pak ) );
+#ifndef STANDALONE
+			if ( FS_idPak( pak, BASETA, NUM_TA_PAKS ) ) {
+				continue;
+			}
+#endif
+			if ( FS_idPak( pak, BASEGAME, NUM_ID_PAKS ) ) {
+				continue;
+			}
+			path = FS_PakFilename( pak );
+			if ( !path ) {
+				continue;
+			}
+			Com_sprintf( sv_http.paks[numPaks].name, sizeof( sv_http.paks[numPaks].name ), "%s.pk3", pak );
+			Q_strncpyz( sv_http.paks[numPaks].path, path, sizeof( sv_http.paks[numPaks].path ) );
+			numPaks++;
+		}
+	}
+	sv_http.numPaks = numPaks;
+	Sys_UnlockMutex( sv_http.pakLock );
+}
+
+/*
+==================
+SV_ServerInfoString
+
+The serverinfo with the download server as sv_dlURL when there is none
+==================
+*/
+const char *SV_ServerInfoString( void ) {
+	static char	info[MAX_INFO_STRING];
+	const char	*host;
+
+	Q_strncpyz( info, Cvar_InfoString( CVAR_SERVERINFO ), sizeof( info ) );
+	if ( !sv_http.thread || *Cvar_VariableString( "sv_dlURL" ) ) {
+		return info;
+	}
+
+	host = sv_httpHost->string;
+	if ( !*host ) {
+		host = Cvar_VariableString( "net_ip" );
+		if ( inet_addr( host ) == INADDR_NONE || inet_addr( host ) == INADDR_ANY ) {
+			return info;
+		}
+	}
+	Info_SetValueForKey( info, "sv_dlURL", va( "http://%s:%i", host, sv_http.port ) );
+	return info;
+}
+
+/*
+==================
+SV_HTTPInit
+==================
+*/
+void SV_HTTPInit( void ) {
+	sv_httpPort = Cvar_Get( "sv_httpPort", "0", CVAR_ARCHIVE );
+	Cvar_CheckRange( sv_httpPort, 0, 65535, qtrue );
+	Cvar_SetDescription( sv_httpPort, "TCP port a dedicated server serves its downloadable pk3s on over HTTP, from the next map, 0 for none." );
+	sv_httpHost = Cvar_Get( "sv_httpHost", "", CVAR_ARCHIVE );
+	Cvar_SetDescription( sv_httpHost, "Host name or address clients reach the HTTP download server at, advertised as sv_dlURL when that is empty. Defaults to net_ip." );
+	sv_http.listener = INVALID_SOCKET;
+}
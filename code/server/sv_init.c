@@ -70,6 +70,36 @@ static void SV_SendConfigstring(client_t *client, int index)
 	}
 }
 
+/*
+===============
+SV_ConfigstringDelta
+
+Builds the csd command that turns old into the new value of the
+configstring, or returns qfalse when a full cs is about as short
+===============
+*/
+static qboolean SV_ConfigstringDelta( int index, const char *old, char *delta, int deltaSize ) {
+	const char	*val = sv.configstrings[index];
+	int			len, oldLen, keep, tail;
+
+	len = strlen( val );
+	oldLen = strlen( old );
+
+	for ( keep = 0; keep < len && keep < oldLen && val[keep] == old[keep]; keep++ ) {
+	}
+	for ( tail = 0; tail < len - keep && tail < oldLen - keep
+		&& val[len - tail - 1] == old[oldLen - tail - 1]; tail++ ) {
+	}
+
+	// the numbers cost a few bytes, and the middle has to fit one command
+	if ( keep + tail < 16 || len - keep - tail >= MAX_STRING_CHARS - 64 ) {
+		return qfalse;
+	}
+
+	Com_sprintf( delta, deltaSize, "csd %i %i %i \"%.*s\"\n", index, keep, tail, len - keep - tail, val + keep );
+	return qtrue;
+}
+
 /*
 ===============
 SV_UpdateConfigstrings
@@ -106,6 +136,9 @@ SV_SetConfigstring
 void SV_SetConfigstring (int index, const char *val) {
 	int		i;
 	client_t	*client;
+	char		*old;
+	char		delta[MAX_STRING_CHARS];
+	qboolean	hasDelta;
 
 	if ( index < 0 || index >= MAX_CONFIGSTRINGS ) {
 		Com_Error (ERR_DROP, "SV_SetConfigstring: bad index %i", index);
@@ -121,12 +154,16 @@ void SV_SetConfigstring (int index, const char *val) {
 	}
 
 	// change the string in sv
-	Z_Free( sv.configstrings[index] );
+	old = sv.configstrings[index];
 	sv.configstrings[index] = CopyString( val );
+	SV_DemoConfigstring( index );
 
 	// send it to all the clients if we aren't
 	// spawning a new server
 	if ( sv.state == SS_GAME || sv.restarting ) {
+		// active clients have the old value, so those that take
+		// deltas only need what changed
+		hasDelta = sv_compressConfigstrings->integer && SV_ConfigstringDelta( index, old, delta, sizeof( delta ) );
 
 		// send the data to all relevant clients
 		for (i = 0, client = svs.clients; i < sv_maxclients->integer ; i++, client++) {
@@ -139,10 +176,16 @@ void SV_SetConfigstring (int index, const char *val) {
 			if ( index == CS_SERVERINFO && client->gentity && (client->gentity->r.svFlags & SVF_NOSERVERINFO) ) {
 				continue;
 			}
-		
-			SV_SendConfigstring(client, index);
+
+			if ( hasDelta && client->compressConfigstrings ) {
+				SV_SendServerCommand( client, "%s", delta );
+			} else {
+				SV_SendConfigstring(client, index);
+			}
 		}
 	}
+
+	Z_Free( old );
 }
 
 /*
@@ -386,6 +429,173 @@ static void SV_TouchFile( const char *filename ) {
 	}
 }
 
+/*
+===============================================================================
+
+NEXT MAP PRELOAD
+
+While a map is played the bsp of the map nextmap leads to is read in the
+background through the async reads, a slice per frame.  SV_SpawnServer
+hands the finished copy to the filesystem as its held file, so
+CM_LoadMap takes it from memory instead of the pak.
+
+===============================================================================
+*/
+
+static struct {
+	char	name[MAX_QPATH];	// map being preloaded
+	int		handle;				// async read, 0 if none
+} sv_preload;
+
+/*
+================
+SV_ClearPreload
+================
+*/
+void SV_ClearPreload( void ) {
+	if ( sv_preload.handle ) {
+		FS_AsyncReadFree( sv_preload.handle );
+	}
+	Com_Memset( &sv_preload, 0, sizeof( sv_preload ) );
+}
+
+/*
+================
+SV_NextMapName
+
+Follows nextmap through vstr to the map it starts, if any
+================
+*/
+static qboolean SV_NextMapName( char *name, int size ) {
+	char		buffer[MAX_CVAR_VALUE_STRING];
+	char		token[MAX_TOKEN_CHARS];
+	const char	*p;
+	int			depth;
+
+	Cvar_VariableStringBuffer( "nextmap", buffer, sizeof( buffer ) );
+
+	for ( depth = 0; depth < 8; ) {
+		p = buffer;
+		while ( 1 ) {
+			Q_strncpyz( token, COM_Parse( (char **)&p ), sizeof( token ) );
+			if ( !token[0] ) {
+				return qfalse;
+			}
+			if ( token[strlen( token ) - 1] == ';' ) {
+				token[strlen( token ) - 1] = '\0';
+			}
+
+			if ( !Q_stricmp( token, "map" ) || !Q_stricmp( token, "devmap" ) ) {
+				Q_strncpyz( name, COM_Parse( (char **)&p ), size );
+				if ( name[0] && name[strlen( name ) - 1] == ';' ) {
+					name[strlen( name ) - 1] = '\0';
+				}
+				return name[0] ? qtrue : qfalse;
+			}
+
+			if ( !Q_stricmp( token, "vstr" ) ) {
+				Q_strncpyz( token, COM_Parse( (char **)&p ), sizeof( token ) );
+				if ( token[0] && token[strlen( token ) - 1] == ';' ) {
+					token[strlen( token ) - 1] = '\0';
+				}
+				Cvar_VariableStringBuffer( token, buffer, sizeof( buffer ) );
+				depth++;
+				break;
+			}
+		}
+	}
+
+	return qfalse;
+}
+
+/*
+================
+SV_PreloadNextMap
+
+Called every server frame, starts reading the next map once it is known
+================
+*/
+void SV_PreloadNextMap( void ) {
+	char	name[MAX_QPATH];
+
+	if ( !sv_preloadNextMap->integer || !SV_NextMapName( name, sizeof( name ) )
+		|| !Q_stricmp( name, sv_mapname->string ) ) {
+		if ( sv_preload.handle ) {
+			SV_ClearPreload();
+		}
+		return;
+	}
+
+	if ( !Q_stricmp( name, sv_preload.name ) ) {
+		return;
+	}
+
+	SV_ClearPreload();
+	Q_strncpyz( sv_preload.name, name, sizeof( sv_preload.name ) );
+
+	// missing or too big for the zone, it loads the usual way
+	sv_preload.handle = FS_ReadFileAsync( va( "maps/%s.bsp", name ) );
+	if ( sv_preload.handle ) {
+		Com_DPrintf( "Preloading %s\n", name );
+	}
+}
+
+/*
+================
+SV_FinishPreload
+
+Called before the filesystem restarts, the rest of the read is done now
+if the map being spawned is the one preloaded
+================
+*/
+static void SV_FinishPreload( const char *server ) {
+	void	*buffer;
+	long	length;
+
+	if ( !sv_preload.handle || Q_stricmp( server, sv_preload.name ) ) {
+		SV_ClearPreload();
+		return;
+	}
+
+	FS_AsyncReadWait( sv_preload.handle, &buffer, &length );
+	if ( !buffer ) {
+		SV_ClearPreload();
+	}
+}
+
+/*
+================
+SV_UsePreload
+
+Called after the filesystem restarted, the copy is used if the pak it
+would come from still has the same file
+================
+*/
+static void SV_UsePreload( void ) {
+	char			name[MAX_QPATH];
+	fileHandle_t	f;
+	void			*buffer;
+	long			length;
+
+	if ( !sv_preload.handle ) {
+		return;
+	}
+
+	Com_sprintf( name, sizeof( name ), "maps/%s.bsp", sv_preload.name );
+	FS_AsyncReadStatus( sv_preload.handle, &buffer, &length );
+
+	// this also references the pak for pure clients, as loading it would
+	if ( FS_FOpenFileRead( name, &f, qfalse ) == length && f ) {
+		FS_HoldAsyncRead( sv_preload.handle, name );
+		sv_preload.handle = 0;
+	}
+	if ( f ) {
+		FS_FCloseFile( f );
+	}
+
+	SV_ClearPreload();
+}
+
 /*
 ================
 SV_SpawnServer
@@ -415,6 +625,9 @@ void SV_SpawnServer( char *server, qboolean killBots ) {
 	// make sure all the client stuff is unloaded
 	CL_ShutdownAll(qfalse);
 
+	// server demos hold one map
+	SV_StopRecordingDemo();
+
 	// clear the whole hunk because we're (re)loading the server
 	Hunk_Clear();
 
@@ -435,9 +648,15 @@ void SV_SpawnServer( char *server, qboolean killBots ) {
 	FS_ClearPakReferences(0);
 
 	// allocate the snapshot entities on the hunk
-	svs.snapshotEntities = Hunk_Alloc( sizeof(entityState_t)*svs.numSnapshotEntities, h_high );
+	svs.snapshotEntities = Hunk_Alloc( sizeof(*svs.snapshotEntities)*svs.numSnapshotEntities, h_high );
 	svs.nextSnapshotEntities = 0;
 
+	// the clients' frames of one send frame share an entity's state, so
+	// a send frame stores at most MAX_GENTITIES of them
+	svs.numSnapshotStates = MIN( svs.numSnapshotEntities, PACKET_BACKUP * MAX_GENTITIES );
+	svs.snapshotStates = Hunk_Alloc( sizeof(entityState_t)*svs.numSnapshotStates, h_high );
+	svs.nextSnapshotStates = 0;
+
 	// toggle the server bit so clients can detect that a
 	// server has changed
 	svs.snapFlagServerBit ^= SNAPFLAG_SERVERCOUNT;
@@ -465,7 +684,9 @@ void SV_SpawnServer( char *server, qboolean killBots ) {
 
 	// get a new checksum feed and restart the file system
 	sv.checksumFeed = ( ((unsigned int)rand() << 16) ^ (unsigned int)rand() ) ^ Com_Milliseconds();
+	SV_FinishPreload( server );
 	FS_Restart( sv.checksumFeed );
+	SV_UsePreload();
 
 	CM_LoadMap( va("maps/%s.bsp", server), qfalse, &checksum );
 
@@ -592,7 +813,10 @@ void SV_SpawnServer( char *server, qboolean killBots ) {
 	cvar_modifiedFlags &= ~CVAR_SYSTEMINFO;
 	SV_SetConfigstring( CS_SYSTEMINFO, systemInfo );
 
-	SV_SetConfigstring( CS_SERVERINFO, Cvar_InfoString( CVAR_SERVERINFO ) );
+	// the download server takes the paks clients may now ask for
+	SV_HTTPSpawn();
+
+	SV_SetConfigstring( CS_SERVERINFO, SV_ServerInfoString() );
 	cvar_modifiedFlags &= ~CVAR_SERVERINFO;
 
 	// any media configstring setting now should issue a warning
@@ -628,6 +852,7 @@ void SV_Init (void)
 	int index;
 
 	SV_AddOperatorCommands ();
+	SV_AddMetricsCommands ();
 
 	// serverinfo vars
 	Cvar_Get ("dmflags", "0", CVAR_SERVERINFO);
@@ -675,6 +900,7 @@ void SV_Init (void)
 
 	sv_allowDownload = Cvar_Get ("sv_allowDownload", "0", CVAR_SERVERINFO);
 	Cvar_Get ("sv_dlURL", "", CVAR_SERVERINFO | CVAR_ARCHIVE);
+	SV_HTTPInit();
 	
 	sv_master[0] = Cvar_Get("sv_master1", MASTER_SERVER_NAME, 0);
 	sv_master[1] = Cvar_Get("sv_master2", "directory.ioquake3.org", 0);
@@ -687,10 +913,19 @@ void SV_Init (void)
 	sv_killserver = Cvar_Get ("sv_killserver", "0", 0);
 	sv_mapChecksum = Cvar_Get ("sv_mapChecksum", "", CVAR_ROM);
 	sv_lanForceRate = Cvar_Get ("sv_lanForceRate", "1", CVAR_ARCHIVE );
+	sv_snapshotPriority = Cvar_Get ("sv_snapshotPriority", "1", CVAR_ARCHIVE );
+	sv_traceCache = Cvar_Get ("sv_traceCache", "0", CVAR_ARCHIVE );
+	sv_preloadNextMap = Cvar_Get ("sv_preloadNextMap", "1", CVAR_ARCHIVE );
+	sv_compressConfigstrings = Cvar_Get ("sv_compressConfigstrings", "1", CVAR_ARCHIVE );
+	sv_compressCommands = Cvar_Get ("sv_compressCommands", "1", CVAR_ARCHIVE );
 #ifndef STANDALONE
 	sv_strictAuth = Cvar_Get ("sv_strictAuth", "1", CVAR_ARCHIVE );
 #endif
 	sv_banFile = Cvar_Get("sv_banFile", "serverbans.dat", CVAR_ARCHIVE);
+	sv_metricsPassword = Cvar_Get ("sv_metricsPassword", "", CVAR_TEMP );
+	sv_clientThinkRate = Cvar_Get ("sv_clientThinkRate", "0", CVAR_ARCHIVE );
+	Cvar_CheckRange( sv_clientThinkRate, 0, 1000, qtrue );
+	sv_clientThinkBatch = Cvar_Get ("sv_clientThinkBatch", "1", CVAR_ARCHIVE );
 
 	// initialize bot cvars so they are listed and can be set before loading the botlib
 	SV_BotInitCvars();
@@ -759,9 +994,16 @@ void SV_Shutdown( char *finalmsg ) {
 	SV_RemoveOperatorCommands();
 	SV_MasterShutdown();
 	SV_ShutdownGameProgs();
+	SV_ClearPreload();
 
 	// free current level
+	SV_StopRecordingTraces();
+	SV_StopRecordingMsgs();
+	SV_StopRecordingDemo();
+	SV_LoadTestShutdown();
+	SV_HTTPShutdown();
 	SV_ClearServer();
+	CM_UnpublishMap();
 
 	// free server static data
 	if(svs.clients)
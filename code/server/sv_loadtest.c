@@ -0,0 +1,1024 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// sv_loadtest.c -- synthetic clients for load testing the server
+
+#include "server.h"
+
+/*
+=============================================================================
+
+The load test connects fake clients that speak the real protocol: they
+challenge, connect, take the gamestate and snapshots through a netchan and
+send usercmds that SV_ExecuteClientMessage parses like anyone else's.
+
+They live in the 198.18.0.0/15 benchmarking range (RFC 2544). Nothing
+addressed there reaches a socket, NET_SendPacket hands it to
+SV_LoadTestPacket instead, so a dedicated server can measure its frame
+time against the number of clients without a fleet of real ones.
+
+=============================================================================
+*/
+
+#define	LT_CMD_MSEC			8		// usercmds at 125 fps
+#define	LT_PACKET_MSEC		33		// packets at cl_maxpackets 30
+#define	LT_RESEND_MSEC		1000	// connection packets, and packets until the gamestate
+#define	LT_CONNECT_STAGGER	4		// clients started per frame, under the getchallenge limit
+#define	LT_COMMANDS			8		// reliable commands kept for retransmit, a power of 2
+#define	LT_FRAME_BUCKETS	1000	// 0.1 msec frame time buckets
+#define	LT_MAX_TRACK		65536	// demo snapshots kept
+#define	LT_PORT				27960
+
+typedef enum {
+	LT_FREE,
+	LT_CHALLENGING,		// sending getchallenge
+	LT_CONNECTING,		// sending connect
+	LT_CONNECTED,		// netchan is up
+	LT_FAILED			// refused or dropped, waits for the next loadtest command
+} loadClientState_t;
+
+typedef struct {
+	loadClientState_t	state;
+	netadr_t	adr;
+	int			qport;
+	int			clientChallenge;
+	int			challenge;
+	int			lastSend;			// realtime of the last packet
+
+	netchan_t	netchan;
+	qboolean	gotGamestate;
+	int			serverId;
+	int			checksumFeed;
+	int			serverMessageSequence;
+	int			serverCommandSequence;
+	int			serverCommandHash;	// MSG_HashKey of command serverCommandSequence
+	int			snapServerTime;		// of the newest snapshot or gamestate
+	int			snapRealtime;		// when it arrived
+	qboolean	gotSnapshot;
+
+	int			reliableSequence;
+	int			reliableAcknowledge;
+	char		reliableCommands[LT_COMMANDS][MAX_STRING_CHARS];
+
+	usercmd_t	cmds[MAX_PACKET_USERCMDS];	// generated since the last packet
+	int			numCmds;
+	int			cmdTime;			// realtime of the last usercmd
+	int			cmdServerTime;		// serverTime of the last usercmd
+
+	int			trackStart;			// msec into the demo track at cmdTime 0
+	int			trackIndex;
+	float		yaw;				// wandering without a demo
+	float		turn;
+	int			rightmove;
+	int			nextTurn;
+} loadClient_t;
+
+typedef struct {
+	int			time;				// snapshot serverTime from the start of the demo
+	int			angles[3];
+	int			weapon;
+	signed char	forwardmove, rightmove, upmove;
+} loadTrackPoint_t;
+
+typedef struct {
+	int			frames;
+	int64_t		usec;
+	int			maxUsec;
+	int64_t		packetUsec;			// in SV_PacketEvent for the clients' packets
+	int			buckets[LT_FRAME_BUCKETS];
+} loadStats_t;
+
+static loadClient_t		lt_clients[MAX_CLIENTS];
+static int				lt_numClients;		// clients wanted
+
+static loadTrackPoint_t	*lt_track;
+static int				lt_trackCount;
+static int				lt_trackDuration;
+
+static loadStats_t		lt_stats;
+
+static int				lt_rampMax;
+static int				lt_rampStep;
+static int				lt_rampMsec;
+static int				lt_rampEnd;			// realtime the current level ends, 0 until it settles
+
+static byte				lt_toServer[MAX_MSGLEN];
+static byte				lt_toClient[MAX_MSGLEN];
+
+/*
+==================
+SV_IsLoadTestAddress
+==================
+*/
+qboolean SV_IsLoadTestAddress( netadr_t adr ) {
+	return adr.type == NA_IP && adr.ip[0] == 198 && ( adr.ip[1] & 0xfe ) == 18;
+}
+
+/*
+==================
+SV_LoadClientForAddress
+==================
+*/
+static loadClient_t *SV_LoadClientForAddress( netadr_t adr ) {
+	int		i;
+
+	i = ( ( adr.ip[1] & 1 ) << 16 ) + ( adr.ip[2] << 8 ) + adr.ip[3] - 1;
+	if ( i < 0 || i >= MAX_CLIENTS || lt_clients[i].state == LT_FREE ) {
+		return NULL;
+	}
+	return &lt_clients[i];
+}
+
+/*
+==================
+SV_LoadArg
+
+Returns the integer value of word n of s, which can't go through
+Cmd_TokenizeString because the server is still using its own arguments
+==================
+*/
+static int SV_LoadArg( const char *s, int n ) {
+	while ( n-- > 0 ) {
+		s = strchr( s, ' ' );
+		if ( !s ) {
+			return 0;
+		}
+		s++;
+	}
+	return atoi( s );
+}
+
+/*
+==================
+SV_LoadClientCommand
+==================
+*/
+static void SV_LoadClientCommand( loadClient_t *lc, const char *cmd ) {
+	if ( lc->reliableSequence - lc->reliableAcknowledge >= LT_COMMANDS ) {
+		return;
+	}
+	lc->reliableSequence++;
+	Q_strncpyz( lc->reliableCommands[lc->reliableSequence & ( LT_COMMANDS - 1 )], cmd, MAX_STRING_CHARS );
+}
+
+/*
+==================
+SV_LoadClientSendPureChecksums
+
+Sends the cp a client running the server's cgame and ui would, so pure
+servers let the load clients in
+==================
+*/
+static void SV_LoadClientSendPureChecksums( loadClient_t *lc ) {
+	int		cgame, ui, pak;
+
+	cgame = ui = 0;
+	FS_FileIsInPAK( "vm/cgame.qvm", &cgame );
+	FS_FileIsInPAK( "vm/ui.qvm", &ui );
+	pak = atoi( FS_LoadedPakPureChecksums() );
+
+	SV_LoadClientCommand( lc, va( "cp %d %d %d @ %d %d", lc->serverId, cgame, ui,
+		pak, lc->checksumFeed ^ pak ^ 1 ) );
+}
+
+/*
+==================
+SV_LoadParseGamestate
+
+Skips the configstrings and baselines after the command sequence of a
+gamestate, keeping the serverId and checksum feed
+==================
+*/
+static qboolean SV_LoadParseGamestate( msg_t *msg, int *serverId, int *checksumFeed ) {
+	entityState_t	nullstate, es;
+	const char		*s;
+	int				cmd, index;
+
+	Com_Memset( &nullstate, 0, sizeof( nullstate ) );
+
+	while ( 1 ) {
+		cmd = MSG_ReadByte( msg );
+		if ( cmd == svc_EOF ) {
+			break;
+		}
+
+		if ( cmd == svc_configstring ) {
+			index = MSG_ReadShort( msg );
+			s = MSG_ReadBigString( msg );
+			if ( index == CS_SYSTEMINFO ) {
+				*serverId = atoi( Info_ValueForKey( s, "sv_serverid" ) );
+			}
+		} else if ( cmd == svc_baseline ) {
+			index = MSG_ReadBits( msg, GENTITYNUM_BITS );
+			MSG_ReadDeltaEntity( msg, &nullstate, &es, index );
+		} else {
+			// the load clients don't ask for deflated configstrings
+			return qfalse;
+		}
+
+		if ( msg->readcount > msg->cursize ) {
+			return qfalse;
+		}
+	}
+
+	MSG_ReadLong( msg );	// clientNum
+	*checksumFeed = MSG_ReadLong( msg );
+
+	return msg->readcount <= msg->cursize;
+}
+
+/*
+==================
+SV_LoadClientParseMessage
+
+Only reads what the client's next packet needs: the command and message
+sequences for the usercmd key, the gamestate and the snapshot time
+==================
+*/
+static void SV_LoadClientParseMessage( loadClient_t *lc, msg_t *msg ) {
+	const char	*s;
+	int			cmd, seq;
+
+	MSG_Bitstream( msg );
+
+	seq = MSG_ReadLong( msg );
+	if ( seq > lc->reliableAcknowledge && seq <= lc->reliableSequence ) {
+		lc->reliableAcknowledge = seq;
+	}
+
+	while ( msg->readcount <= msg->cursize ) {
+		cmd = MSG_ReadByte( msg );
+		if ( cmd == svc_EOF || cmd == -1 ) {
+			break;
+		}
+
+		switch ( cmd ) {
+		case svc_nop:
+			break;
+
+		case svc_serverCommand:
+			seq = MSG_ReadLong( msg );
+			s = MSG_ReadString( msg );
+			if ( seq <= lc->serverCommandSequence ) {
+				break;
+			}
+			lc->serverCommandSequence = seq;
+			lc->serverCommandHash = MSG_HashKey( s, 32 );
+			if ( !Q_strncmp( s, "disconnect", 10 ) ) {
+				Com_Printf( "loadtest%i dropped: %s\n", (int)( lc - lt_clients ), s + 10 );
+				lc->state = LT_FAILED;
+				return;
+			}
+			break;
+
+		case svc_gamestate:
+			seq = MSG_ReadLong( msg );
+			if ( seq != lc->serverCommandSequence ) {
+				lc->serverCommandSequence = seq;
+				lc->serverCommandHash = 0;
+			}
+			if ( !SV_LoadParseGamestate( msg, &lc->serverId, &lc->checksumFeed ) ) {
+				Com_DPrintf( "loadtest%i: bad gamestate\n", (int)( lc - lt_clients ) );
+				return;
+			}
+			lc->gotGamestate = qtrue;
+			lc->gotSnapshot = qfalse;
+			lc->snapServerTime = sv.time;
+			lc->snapRealtime = Sys_Milliseconds();
+			if ( sv_pure->integer ) {
+				SV_LoadClientSendPureChecksums( lc );
+			}
+			break;
+
+		case svc_snapshot:
+			// the entities that follow don't matter to the load client
+			lc->snapServerTime = MSG_ReadLong( msg );
+			lc->snapRealtime = Sys_Milliseconds();
+			lc->gotSnapshot = qtrue;
+			return;
+
+		default:
+			return;
+		}
+	}
+}
+
+/*
+==================
+SV_LoadClientConnectionless
+==================
+*/
+static void SV_LoadClientConnectionless( loadClient_t *lc, msg_t *msg ) {
+	const char	*s;
+
+	MSG_BeginReadingOOB( msg );
+	MSG_ReadLong( msg );	// -1
+	s = MSG_ReadStringLine( msg );
+
+	if ( !Q_strncmp( s, "challengeResponse ", 18 ) ) {
+		if ( lc->state != LT_CHALLENGING || SV_LoadArg( s, 2 ) != lc->clientChallenge ) {
+			return;
+		}
+		lc->challenge = SV_LoadArg( s, 1 );
+		lc->state = LT_CONNECTING;
+		lc->lastSend = Sys_Milliseconds() - LT_RESEND_MSEC;
+	} else if ( !Q_strncmp( s, "connectResponse ", 16 ) ) {
+		if ( lc->state != LT_CONNECTING || SV_LoadArg( s, 1 ) != lc->challenge ) {
+			return;
+		}
+		Netchan_Setup( NS_CLIENT, &lc->netchan, lc->adr, lc->qport, lc->challenge, qfalse );
+		lc->state = LT_CONNECTED;
+		lc->lastSend = Sys_Milliseconds() - LT_RESEND_MSEC;
+	} else if ( !Q_stricmp( s, "print" ) ) {
+		if ( lc->state == LT_CHALLENGING || lc->state == LT_CONNECTING ) {
+			Com_Printf( "loadtest%i refused: %s", (int)( lc - lt_clients ), MSG_ReadString( msg ) );
+			lc->state = LT_FAILED;
+		}
+	} else if ( !Q_strncmp( s, "disconnect", 10 ) ) {
+		lc->state = LT_FAILED;
+	}
+}
+
+/*
+==================
+SV_LoadTestPacket
+
+Called by NET_SendPacket for every packet, returns qtrue if it was
+between the server and one of its load clients and has been delivered
+==================
+*/
+qboolean SV_LoadTestPacket( netsrc_t sock, int length, const void *data, netadr_t to ) {
+	loadClient_t	*lc;
+	msg_t			msg;
+	int64_t			start;
+
+	if ( !SV_IsLoadTestAddress( to ) ) {
+		return qfalse;
+	}
+
+	// nothing in the benchmarking range goes on the wire
+	lc = SV_LoadClientForAddress( to );
+	if ( !lc || length > MAX_MSGLEN ) {
+		return qtrue;
+	}
+
+	if ( sock == NS_CLIENT ) {
+		MSG_Init( &msg, lt_toServer, sizeof( lt_toServer ) );
+		Com_Memcpy( msg.data, data, length );
+		msg.cursize = length;
+
+		start = Sys_Microseconds();
+		SV_PacketEvent( lc->adr, &msg );
+		lt_stats.packetUsec += Sys_Microseconds() - start;
+		return qtrue;
+	}
+
+	MSG_Init( &msg, lt_toClient, sizeof( lt_toClient ) );
+	Com_Memcpy( msg.data, data, length );
+	msg.cursize = length;
+
+	if ( length >= 4 && *(int *)msg.data == -1 ) {
+		SV_LoadClientConnectionless( lc, &msg );
+		return qtrue;
+	}
+
+	if ( lc->state != LT_CONNECTED || !Netchan_Process( &lc->netchan, &msg ) ) {
+		return qtrue;
+	}
+	lc->serverMessageSequence = LittleLong( *(int *)msg.data );
+
+	SV_LoadClientParseMessage( lc, &msg );
+	return qtrue;
+}
+
+/*
+==================
+SV_LoadClientSendPacket
+
+Mirrors CL_WritePacket
+==================
+*/
+static void SV_LoadClientSendPacket( loadClient_t *lc, int now ) {
+	msg_t		buf;
+	byte		data[MAX_MSGLEN];
+	usercmd_t	nullcmd, *oldcmd;
+	int			i, key;
+
+	MSG_Init( &buf, data, sizeof( data ) );
+	MSG_Bitstream( &buf );
+
+	MSG_WriteLong( &buf, lc->serverId );
+	MSG_WriteLong( &buf, lc->serverMessageSequence );
+	MSG_WriteLong( &buf, lc->serverCommandSequence );
+
+	for ( i = lc->reliableAcknowledge + 1; i <= lc->reliableSequence; i++ ) {
+		MSG_WriteByte( &buf, clc_clientCommand );
+		MSG_WriteLong( &buf, i );
+		MSG_WriteString( &buf, lc->reliableCommands[i & ( LT_COMMANDS - 1 )] );
+	}
+
+	if ( lc->numCmds ) {
+		MSG_WriteByte( &buf, lc->gotSnapshot ? clc_move : clc_moveNoDelta );
+		MSG_WriteByte( &buf, lc->numCmds );
+
+		key = lc->checksumFeed ^ lc->serverMessageSequence ^ lc->serverCommandHash;
+
+		Com_Memset( &nullcmd, 0, sizeof( nullcmd ) );
+		oldcmd = &nullcmd;
+		for ( i = 0; i < lc->numCmds; i++ ) {
+			MSG_WriteDeltaUsercmdKey( &buf, key, oldcmd, &lc->cmds[i] );
+			oldcmd = &lc->cmds[i];
+		}
+		lc->numCmds = 0;
+	}
+
+	MSG_WriteByte( &buf, clc_EOF );
+
+	lc->lastSend = now;
+	Netchan_Transmit( &lc->netchan, buf.cursize, buf.data );
+	while ( lc->netchan.unsentFragments ) {
+		Netchan_TransmitNextFragment( &lc->netchan );
+	}
+}
+
+/*
+==================
+SV_LoadClientTrackCmd
+
+Plays the demo track from the client's own starting point, looping
+==================
+*/
+static void SV_LoadClientTrackCmd( loadClient_t *lc, usercmd_t *cmd ) {
+	loadTrackPoint_t	*pt;
+	int					t;
+
+	t = ( lc->trackStart + lc->cmdTime ) % lt_trackDuration;
+	if ( t < lt_track[lc->trackIndex].time ) {
+		lc->trackIndex = 0;
+	}
+	while ( lc->trackIndex + 1 < lt_trackCount && lt_track[lc->trackIndex + 1].time <= t ) {
+		lc->trackIndex++;
+	}
+
+	pt = &lt_track[lc->trackIndex];
+	VectorCopy( pt->angles, cmd->angles );
+	cmd->weapon = pt->weapon;
+	cmd->forwardmove = pt->forwardmove;
+	cmd->rightmove = pt->rightmove;
+	cmd->upmove = pt->upmove;
+}
+
+/*
+==================
+SV_LoadClientWanderCmd
+
+Runs forward, turning and strafing at random and jumping now and then
+==================
+*/
+static void SV_LoadClientWanderCmd( loadClient_t *lc, usercmd_t *cmd ) {
+	if ( lc->cmdTime >= lc->nextTurn ) {
+		lc->nextTurn = lc->cmdTime + 1000 + rand() % 2000;
+		lc->turn = ( rand() % 181 - 90 ) * 0.001f * LT_CMD_MSEC;
+		lc->rightmove = ( rand() % 3 - 1 ) * 127;
+		if ( !( rand() % 4 ) ) {
+			cmd->upmove = 127;
+		}
+	}
+	lc->yaw = AngleNormalize360( lc->yaw + lc->turn );
+
+	cmd->angles[YAW] = ANGLE2SHORT( lc->yaw );
+	cmd->forwardmove = 127;
+	cmd->rightmove = lc->rightmove;
+}
+
+/*
+==================
+SV_LoadClientMove
+
+Generates the usercmds since the last frame, timed from the newest
+snapshot like a client's cl.serverTime
+==================
+*/
+static void SV_LoadClientMove( loadClient_t *lc, int now ) {
+	usercmd_t	*cmd;
+
+	if ( now - lc->cmdTime > MAX_PACKET_USERCMDS * LT_CMD_MSEC ) {
+		lc->cmdTime = now - MAX_PACKET_USERCMDS * LT_CMD_MSEC;
+	}
+
+	while ( lc->cmdTime + LT_CMD_MSEC <= now ) {
+		lc->cmdTime += LT_CMD_MSEC;
+
+		if ( lc->numCmds == MAX_PACKET_USERCMDS ) {
+			memmove( lc->cmds, lc->cmds + 1, ( MAX_PACKET_USERCMDS - 1 ) * sizeof( usercmd_t ) );
+			lc->numCmds--;
+		}
+		cmd = &lc->cmds[lc->numCmds++];
+		Com_Memset( cmd, 0, sizeof( *cmd ) );
+
+		cmd->serverTime = lc->snapServerTime + lc->cmdTime - lc->snapRealtime;
+		if ( cmd->serverTime <= lc->cmdServerTime ) {
+			cmd->serverTime = lc->cmdServerTime + 1;
+		}
+		lc->cmdServerTime = cmd->serverTime;
+
+		if ( lt_track ) {
+			SV_LoadClientTrackCmd( lc, cmd );
+		} else {
+			SV_LoadClientWanderCmd( lc, cmd );
+		}
+	}
+}
+
+/*
+==================
+SV_LoadClientStart
+==================
+*/
+static void SV_LoadClientStart( loadClient_t *lc, int num, int now ) {
+	Com_Memset( lc, 0, sizeof( *lc ) );
+
+	lc->state = LT_CHALLENGING;
+	lc->adr.type = NA_IP;
+	lc->adr.ip[0] = 198;
+	lc->adr.ip[1] = 18 + ( ( num + 1 ) >> 16 );
+	lc->adr.ip[2] = ( ( num + 1 ) >> 8 ) & 0xff;
+	lc->adr.ip[3] = ( num + 1 ) & 0xff;
+	lc->adr.port = BigShort( LT_PORT );
+	lc->qport = Cvar_VariableIntegerValue( "net_qport" ) & 0xffff;	// Netchan_Transmit sends this one
+	lc->clientChallenge = ( ( rand() << 16 ) ^ rand() ) ^ now;
+	lc->lastSend = now - LT_RESEND_MSEC;
+
+	lc->cmdTime = now;
+	lc->yaw = rand() % 360;
+	if ( lt_track ) {
+		lc->trackStart = lt_trackDuration * num / MAX_CLIENTS;
+	}
+}
+
+/*
+==================
+SV_LoadClientDisconnect
+==================
+*/
+static void SV_LoadClientDisconnect( loadClient_t *lc, int now ) {
+	if ( lc->state == LT_CONNECTED ) {
+		lc->numCmds = 0;
+		SV_LoadClientCommand( lc, "disconnect" );
+		SV_LoadClientSendPacket( lc, now );
+	}
+	lc->state = LT_FREE;
+}
+
+/*
+==================
+SV_LoadClientFrame
+==================
+*/
+static void SV_LoadClientFrame( loadClient_t *lc, int now ) {
+	switch ( lc->state ) {
+	case LT_CHALLENGING:
+		if ( now - lc->lastSend >= LT_RESEND_MSEC ) {
+			lc->lastSend = now;
+			NET_OutOfBandPrint( NS_CLIENT, lc->adr, "getchallenge %d %s",
+				lc->clientChallenge, com_gamename->string );
+		}
+		break;
+
+	case LT_CONNECTING:
+		if ( now - lc->lastSend >= LT_RESEND_MSEC ) {
+			char	data[MAX_INFO_STRING + 10];
+			int		len;
+
+			lc->lastSend = now;
+			len = Com_sprintf( data, sizeof( data ), "connect \"\\name\\loadtest%i\\rate\\25000\\snaps\\20"
+				"\\protocol\\%i\\qport\\%i\\challenge\\%i\"", (int)( lc - lt_clients ),
+				com_protocol->integer, lc->qport, lc->challenge );
+			NET_OutOfBandData( NS_CLIENT, lc->adr, (byte *)data, len );
+		}
+		break;
+
+	case LT_CONNECTED:
+		if ( !lc->gotGamestate ) {
+			if ( now - lc->lastSend >= LT_RESEND_MSEC ) {
+				SV_LoadClientSendPacket( lc, now );
+			}
+			break;
+		}
+		SV_LoadClientMove( lc, now );
+		if ( now - lc->lastSend >= LT_PACKET_MSEC ) {
+			SV_LoadClientSendPacket( lc, now );
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+/*
+==================
+SV_LoadTestResetStats
+==================
+*/
+static void SV_LoadTestResetStats( void ) {
+	Com_Memset( &lt_stats, 0, sizeof( lt_stats ) );
+}
+
+/*
+==================
+SV_LoadTestReport
+==================
+*/
+static void SV_LoadTestReport( void ) {
+	int		i, connected, failed, count, p99;
+
+	connected = failed = 0;
+	for ( i = 0; i < lt_numClients; i++ ) {
+		if ( lt_clients[i].state == LT_CONNECTED && lt_clients[i].gotSnapshot ) {
+			connected++;
+		} else if ( lt_clients[i].state == LT_FAILED ) {
+			failed++;
+		}
+	}
+
+	if ( !lt_stats.frames ) {
+		Com_Printf( "%3i clients (%i failed)   no frames\n", connected, failed );
+		return;
+	}
+
+	p99 = LT_FRAME_BUCKETS - 1;
+	count = 0;
+	for ( i = 0; i < LT_FRAME_BUCKETS; i++ ) {
+		count += lt_stats.buckets[i];
+		if ( count * 100 >= lt_stats.frames * 99 ) {
+			p99 = i;
+			break;
+		}
+	}
+
+	Com_Printf( "%3i clients (%i failed)   frame %6.2f avg %6.2f p99 %6.2f max ms   packets %6.2f ms   %i frames\n",
+		connected, failed,
+		lt_stats.usec / 1000.0 / lt_stats.frames, ( p99 + 1 ) / 10.0, lt_stats.maxUsec / 1000.0,
+		lt_stats.packetUsec / 1000.0 / lt_stats.frames, lt_stats.frames );
+}
+
+/*
+==================
+SV_LoadTestSettled
+
+All of the wanted clients are in the game or have given up
+==================
+*/
+static qboolean SV_LoadTestSettled( void ) {
+	int		i;
+
+	for ( i = 0; i < lt_numClients; i++ ) {
+		if ( lt_clients[i].state == LT_FAILED ) {
+			continue;
+		}
+		if ( lt_clients[i].state != LT_CONNECTED || !lt_clients[i].gotSnapshot ) {
+			return qfalse;
+		}
+	}
+	return qtrue;
+}
+
+/*
+==================
+SV_LoadTestRamp
+
+Holds each client count for the ramp period once it has connected,
+then reports it and adds the next step
+==================
+*/
+static void SV_LoadTestRamp( int now ) {
+	if ( !lt_rampEnd ) {
+		if ( SV_LoadTestSettled() ) {
+			SV_LoadTestResetStats();
+			lt_rampEnd = now + lt_rampMsec;
+		}
+		return;
+	}
+
+	if ( now < lt_rampEnd ) {
+		return;
+	}
+
+	SV_LoadTestReport();
+
+	if ( lt_numClients >= lt_rampMax ) {
+		Com_Printf( "Load test ramp done\n" );
+		lt_rampMax = 0;
+		lt_numClients = 0;
+		return;
+	}
+
+	lt_numClients = MIN( lt_numClients + lt_rampStep, lt_rampMax );
+	lt_rampEnd = 0;
+}
+
+/*
+==================
+SV_LoadTestFrame
+
+Runs the load clients ahead of each server frame
+==================
+*/
+void SV_LoadTestFrame( void ) {
+	int		i, now, started;
+
+	now = Sys_Milliseconds();
+
+	if ( lt_rampMax ) {
+		SV_LoadTestRamp( now );
+	}
+
+	started = 0;
+	for ( i = 0; i < MAX_CLIENTS; i++ ) {
+		loadClient_t	*lc = &lt_clients[i];
+
+		if ( i >= lt_numClients ) {
+			if ( lc->state != LT_FREE ) {
+				SV_LoadClientDisconnect( lc, now );
+			}
+			continue;
+		}
+
+		if ( lc->state == LT_FREE ) {
+			if ( started == LT_CONNECT_STAGGER ) {
+				continue;
+			}
+			SV_LoadClientStart( lc, i, now );
+			started++;
+		}
+
+		SV_LoadClientFrame( lc, now );
+	}
+}
+
+/*
+==================
+SV_LoadTestFrameTime
+==================
+*/
+void SV_LoadTestFrameTime( int usec ) {
+	if ( !lt_numClients ) {
+		return;
+	}
+
+	lt_stats.frames++;
+	lt_stats.usec += usec;
+	if ( usec > lt_stats.maxUsec ) {
+		lt_stats.maxUsec = usec;
+	}
+	lt_stats.buckets[MIN( usec / 100, LT_FRAME_BUCKETS - 1 )]++;
+}
+
+/*
+==================
+SV_LoadTestTrack
+
+Turns the player states of a demo into the usercmds that would have
+moved them, for the load clients to replay
+==================
+*/
+static qboolean SV_LoadTestTrack( const char *name ) {
+	char				filename[MAX_QPATH];
+	byte				*buffer, *p, *end;
+	byte				data[MAX_MSGLEN];
+	byte				areamask[MAX_MAP_AREA_BYTES];
+	msg_t				msg;
+	playerState_t		*ps, *from;
+	int					*psSeq;
+	int					seq, len, cmd, serverTime, deltaNum, areabytes, firstTime, size, dummy, i;
+	loadTrackPoint_t	*pt;
+	float				yaw, speed, fwd, right;
+
+	if ( lt_track ) {
+		Z_Free( lt_track );
+		lt_track = NULL;
+	}
+	lt_trackCount = 0;
+
+	if ( !name ) {
+		return qtrue;
+	}
+
+	if ( strchr( name, '.' ) ) {
+		Q_strncpyz( filename, name, sizeof( filename ) );
+	} else {
+		Com_sprintf( filename, sizeof( filename ), "demos/%s.%s%d", name, DEMOEXT, com_protocol->integer );
+	}
+
+	size = FS_ReadFile( filename, (void **)&buffer );
+	if ( !buffer ) {
+		Com_Printf( "Couldn't open %s\n", filename );
+		return qfalse;
+	}
+
+	lt_track = Z_Malloc( LT_MAX_TRACK * sizeof( *lt_track ) );
+	ps = Z_Malloc( PACKET_BACKUP * sizeof( *ps ) );
+	psSeq = Z_Malloc( PACKET_BACKUP * sizeof( *psSeq ) );
+	firstTime = 0;
+
+	for ( p = buffer, end = buffer + size; p + 8 <= end && lt_trackCount < LT_MAX_TRACK; p += len ) {
+		seq = LittleLong( ( (int *)p )[0] );
+		len = LittleLong( ( (int *)p )[1] );
+		p += 8;
+		if ( seq == -1 || len < 0 || len > sizeof( data ) || p + len > end ) {
+			break;
+		}
+
+		MSG_Init( &msg, data, sizeof( data ) );
+		Com_Memcpy( data, p, len );
+		msg.cursize = len;
+		MSG_Bitstream( &msg );
+		MSG_ReadLong( &msg );	// reliableAcknowledge
+
+		while ( msg.readcount <= msg.cursize ) {
+			cmd = MSG_ReadByte( &msg );
+			if ( cmd == svc_serverCommand ) {
+				MSG_ReadLong( &msg );
+				MSG_ReadString( &msg );
+				continue;
+			}
+			if ( cmd == svc_serverCommandsDeflated ) {
+				MSG_ReadLong( &msg );	// first
+				MSG_ReadLong( &msg );	// last
+				MSG_ReadLong( &msg );	// size
+				for ( i = MSG_ReadLong( &msg ); i > 0 && msg.readcount <= msg.cursize; i-- ) {
+					MSG_ReadBits( &msg, 8 );
+				}
+				continue;
+			}
+			if ( cmd == svc_gamestate ) {
+				MSG_ReadLong( &msg );
+				if ( !SV_LoadParseGamestate( &msg, &dummy, &dummy ) ) {
+					break;
+				}
+				continue;
+			}
+			if ( cmd != svc_snapshot ) {
+				break;
+			}
+
+			serverTime = MSG_ReadLong( &msg );
+			deltaNum = MSG_ReadByte( &msg );
+			MSG_ReadByte( &msg );	// snapFlags
+			areabytes = MSG_ReadByte( &msg );
+			if ( areabytes > sizeof( areamask ) ) {
+				break;
+			}
+			MSG_ReadData( &msg, areamask, areabytes );
+
+			from = NULL;
+			if ( deltaNum ) {
+				if ( psSeq[( seq - deltaNum ) & PACKET_MASK] != seq - deltaNum ) {
+					break;
+				}
+				from = &ps[( seq - deltaNum ) & PACKET_MASK];
+			}
+			MSG_ReadDeltaPlayerstate( &msg, from, &ps[seq & PACKET_MASK] );
+			psSeq[seq & PACKET_MASK] = seq;
+			from = &ps[seq & PACKET_MASK];
+
+			if ( !lt_trackCount ) {
+				firstTime = serverTime;
+			}
+			pt = &lt_track[lt_trackCount++];
+			pt->time = serverTime - firstTime;
+			pt->angles[0] = ANGLE2SHORT( from->viewangles[0] ) - from->delta_angles[0];
+			pt->angles[1] = ANGLE2SHORT( from->viewangles[1] ) - from->delta_angles[1];
+			pt->angles[2] = ANGLE2SHORT( from->viewangles[2] ) - from->delta_angles[2];
+			pt->weapon = from->weapon;
+
+			// the move that points the horizontal velocity where it goes
+			yaw = DEG2RAD( from->viewangles[YAW] );
+			fwd = from->velocity[0] * cos( yaw ) + from->velocity[1] * sin( yaw );
+			right = from->velocity[0] * sin( yaw ) - from->velocity[1] * cos( yaw );
+			speed = sqrt( fwd * fwd + right * right );
+			if ( speed > 20 ) {
+				pt->forwardmove = 127 * fwd / speed;
+				pt->rightmove = 127 * right / speed;
+			}
+			if ( from->velocity[2] > 100 ) {
+				pt->upmove = 127;
+			}
+			break;
+		}
+	}
+
+	Z_Free( psSeq );
+	Z_Free( ps );
+	FS_FreeFile( buffer );
+
+	if ( lt_trackCount < 2 ) {
+		Com_Printf( "No snapshots in %s\n", filename );
+		Z_Free( lt_track );
+		lt_track = NULL;
+		lt_trackCount = 0;
+		return qfalse;
+	}
+
+	lt_trackDuration = lt_track[lt_trackCount - 1].time + 1;
+	Com_Printf( "Replaying %i snapshots, %.1f seconds, of %s\n", lt_trackCount, lt_trackDuration / 1000.0f, filename );
+	return qtrue;
+}
+
+/*
+==================
+SV_LoadTest_f
+
+loadtest <clients> [demo] keeps that many synthetic clients connected,
+moving like the recording player of the demo or wandering without one.
+loadtest ramp <max> <step> <seconds> [demo] adds clients a step at a time
+and prints the frame times at each count. loadtest stop disconnects them.
+==================
+*/
+void SV_LoadTest_f( void ) {
+	const char	*demo;
+	int			count;
+
+	if ( !com_sv_running->integer ) {
+		Com_Printf( "Server is not running.\n" );
+		return;
+	}
+
+	if ( Cmd_Argc() < 2 ) {
+		Com_Printf( "usage: loadtest <clients> [demo]\n"
+			"       loadtest ramp <max> <step> <seconds> [demo]\n"
+			"       loadtest stop\n" );
+		if ( lt_numClients ) {
+			SV_LoadTestReport();
+		}
+		return;
+	}
+
+	if ( !Q_stricmp( Cmd_Argv( 1 ), "stop" ) ) {
+		lt_numClients = 0;
+		lt_rampMax = 0;
+		return;
+	}
+
+	if ( !Q_stricmp( Cmd_Argv( 1 ), "ramp" ) ) {
+		if ( Cmd_Argc() < 5 ) {
+			Com_Printf( "usage: loadtest ramp <max> <step> <seconds> [demo]\n" );
+			return;
+		}
+		demo = Cmd_Argc() > 5 ? Cmd_Argv( 5 ) : NULL;
+		if ( !SV_LoadTestTrack( demo ) ) {
+			return;
+		}
+
+		lt_rampMax = (int)Com_Clamp( 1, sv_maxclients->integer, atoi( Cmd_Argv( 2 ) ) );
+		lt_rampStep = MAX( 1, atoi( Cmd_Argv( 3 ) ) );
+		lt_rampMsec = MAX( 1, atoi( Cmd_Argv( 4 ) ) ) * 1000;
+		lt_rampEnd = 0;
+		lt_numClients = MIN( lt_rampStep, lt_rampMax );
+		SV_LoadTestResetStats();
+		Com_Printf( "Ramping to %i load clients, %i every %i seconds\n", lt_rampMax, lt_rampStep, lt_rampMsec / 1000 );
+		return;
+	}
+
+	count = atoi( Cmd_Argv( 1 ) );
+	demo = Cmd_Argc() > 2 ? Cmd_Argv( 2 ) : NULL;
+	if ( count && !SV_LoadTestTrack( demo ) ) {
+		return;
+	}
+
+	lt_numClients = (int)Com_Clamp( 0, sv_maxclients->integer, count );
+	lt_rampMax = 0;
+	SV_LoadTestResetStats();
+}
+
+/*
+==================
+SV_LoadTestShutdown
+
+The server has dropped everyone already
+==================
+*/
+void SV_LoadTestShutdown( void ) {
+	Com_Memset( lt_clients, 0, sizeof( lt_clients ) );
+	lt_numClients = 0;
+	lt_rampMax = 0;
+}
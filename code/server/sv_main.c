@@ -58,10 +58,18 @@ cvar_t	*sv_gametype;
 cvar_t	*sv_pure;
 cvar_t	*sv_floodProtect;
 cvar_t	*sv_lanForceRate; // dedicated 1 (LAN) server forces local client rates to 99999 (bug #491)
+cvar_t	*sv_snapshotPriority;	// rank and stagger snapshot entities for choked clients
+cvar_t	*sv_traceCache;			// reuse identical traces until something moves
+cvar_t	*sv_preloadNextMap;		// read the next map in the background
+cvar_t	*sv_compressConfigstrings;	// deflated gamestates and configstring deltas for clients that take them
+cvar_t	*sv_compressCommands;		// deflated and coalesced reliable commands for clients that take them
 #ifndef STANDALONE
 cvar_t	*sv_strictAuth;
 #endif
 cvar_t	*sv_banFile;
+cvar_t	*sv_metricsPassword;	// answers getmetrics queries that carry it
+cvar_t	*sv_clientThinkRate;	// most usercmds per second run for each client
+cvar_t	*sv_clientThinkBatch;	// hand the game all the usercmds of a packet at once
 
 serverBan_t serverBans[SERVER_MAXBANS];
 int serverBansCount = 0;
@@ -102,35 +110,64 @@ static char	*SV_ExpandNewlines( char *in ) {
 
 /*
 ======================
-SV_ReplacePendingServerCommands
+SV_ConfigstringCommandIndex
 
-FIXME: This is ugly
+The configstring a reliable command sets, or -1.  Only "cs" and "bcs0"
+replace a configstring outright, the deltas and the later big
+configstring pieces build on what came before them.
 ======================
 */
-#if 0 // unused
-static int SV_ReplacePendingServerCommands( client_t *client, const char *cmd ) {
-	int i, index, csnum1, csnum2;
+static int SV_ConfigstringCommandIndex( const char *cmd, qboolean replaces ) {
+	if ( !Q_strncmp( cmd, "cs ", 3 ) ) {
+		return atoi( cmd + 3 );
+	}
+	if ( !Q_strncmp( cmd, "bcs0 ", 5 ) ) {
+		return atoi( cmd + 5 );
+	}
+	if ( replaces ) {
+		return -1;
+	}
+	if ( !Q_strncmp( cmd, "csd ", 4 ) ) {
+		return atoi( cmd + 4 );
+	}
+	if ( !Q_strncmp( cmd, "bcs1 ", 5 ) || !Q_strncmp( cmd, "bcs2 ", 5 ) ) {
+		return atoi( cmd + 5 );
+	}
+	return -1;
+}
 
-	for ( i = client->reliableSent+1; i <= client->reliableSequence; i++ ) {
+/*
+======================
+SV_SupersedePendingServerCommands
+
+Marks the unacknowledged commands the newly added one makes pointless, a
+configstring set again or an older scoreboard, so they are resent empty.
+The text stays in reliableCommands: the client may already hold it, and
+the usercmd key hashes the last command the client acknowledged.
+======================
+*/
+static void SV_SupersedePendingServerCommands( client_t *client, const char *cmd ) {
+	const char	*old;
+	int			i, index, csnum;
+	qboolean	scores;
+
+	scores = !Q_strncmp( cmd, "scores ", 7 );
+	csnum = scores ? -1 : SV_ConfigstringCommandIndex( cmd, qtrue );
+	if ( !scores && csnum < 0 ) {
+		return;
+	}
+
+	for ( i = client->reliableAcknowledge + 1 ; i < client->reliableSequence ; i++ ) {
 		index = i & ( MAX_RELIABLE_COMMANDS - 1 );
-		//
-		if ( !Q_strncmp(cmd, client->reliableCommands[ index ], strlen("cs")) ) {
-			sscanf(cmd, "cs %i", &csnum1);
-			sscanf(client->reliableCommands[ index ], "cs %i", &csnum2);
-			if ( csnum1 == csnum2 ) {
-				Q_strncpyz( client->reliableCommands[ index ], cmd, sizeof( client->reliableCommands[ index ] ) );
-				/*
-				if ( client->netchan.remoteAddress.type != NA_BOT ) {
-					Com_Printf( "WARNING: client %i removed double pending config string %i: %s\n", client-svs.clients, csnum1, cmd );
-				}
-				*/
-				return qtrue;
-			}
+		if ( client->reliableSuperseded[ index ] ) {
+			continue;
+		}
+		old = client->reliableCommands[ index ];
+		if ( scores ? !Q_strncmp( old, "scores ", 7 ) : SV_ConfigstringCommandIndex( old, qfalse ) == csnum ) {
+			client->reliableSuperseded[ index ] = qtrue;
 		}
 	}
-	return qfalse;
 }
-#endif
 
 /*
 ======================
@@ -143,12 +180,6 @@ not have future snapshot_t executed before it is executed
 void SV_AddServerCommand( client_t *client, const char *cmd ) {
 	int		index, i;
 
-	// this is very ugly but it's also a waste to for instance send multiple config string updates
-	// for the same config string index in one snapshot
-//	if ( SV_ReplacePendingServerCommands( client, cmd ) ) {
-//		return;
-//	}
-
 	// do not send commands until the gamestate has been sent
 	if( client->state < CS_PRIMED )
 		return;
@@ -175,6 +206,13 @@ void SV_AddServerCommand( client_t *client, const char *cmd ) {
 	}
 	index = client->reliableSequence & ( MAX_RELIABLE_COMMANDS - 1 );
 	Q_strncpyz( client->reliableCommands[ index ], cmd, sizeof( client->reliableCommands[ index ] ) );
+	client->reliableSuperseded[ index ] = qfalse;
+
+	// it's a waste to for instance send multiple config string updates
+	// for the same config string index in one snapshot
+	if ( client->compressCommands && sv_compressCommands->integer ) {
+		SV_SupersedePendingServerCommands( client, cmd );
+	}
 }
 
 
@@ -521,6 +559,80 @@ qboolean SVC_RateLimitAddress( netadr_t from, int burst, int period ) {
 	return SVC_RateLimit( bucket, burst, period );
 }
 
+// getstatus and getinfo answers are kept until something they are built
+// from changes, only the echoed challenge is per request
+typedef struct {
+	qboolean	connected;
+	int			score;
+	int			ping;
+	char		name[MAX_NAME_LENGTH];
+} svcStatusPlayer_t;
+
+static qboolean	svc_statusValid;
+static int		svc_statusServerId;
+static char		svc_statusInfo[MAX_INFO_STRING];
+static char		svc_statusPlayers[MAX_MSGLEN];
+static svcStatusPlayer_t	svc_statusPlayerKeys[MAX_CLIENTS];
+
+static qboolean	svc_infoValid;
+static int		svc_infoServerId;
+static int		svc_infoCount, svc_infoHumans;
+static char		svc_infoString[MAX_INFO_STRING];
+
+/*
+================
+SVC_InvalidateInfo
+
+Called when serverinfo or systeminfo cvars change
+================
+*/
+static void SVC_InvalidateInfo( void ) {
+	svc_statusValid = qfalse;
+	svc_infoValid = qfalse;
+}
+
+/*
+================
+SVC_StatusPlayersChanged
+
+Compares everything the status player list is printed from against the
+values the cached list was built with, and records the new ones
+================
+*/
+static qboolean SVC_StatusPlayersChanged( void ) {
+	svcStatusPlayer_t	*key;
+	client_t	*cl;
+	playerState_t	*ps;
+	qboolean	changed;
+	int			i;
+
+	changed = qfalse;
+	for ( i = 0 ; i < sv_maxclients->integer ; i++ ) {
+		cl = &svs.clients[i];
+		key = &svc_statusPlayerKeys[i];
+
+		if ( cl->state < CS_CONNECTED ) {
+			if ( key->connected ) {
+				key->connected = qfalse;
+				changed = qtrue;
+			}
+			continue;
+		}
+
+		ps = SV_GameClientNum( i );
+		if ( !key->connected || key->score != ps->persistant[PERS_SCORE] ||
+			key->ping != cl->ping || strcmp( key->name, cl->name ) ) {
+			key->connected = qtrue;
+			key->score = ps->persistant[PERS_SCORE];
+			key->ping = cl->ping;
+			Q_strncpyz( key->name, cl->name, sizeof( key->name ) );
+			changed = qtrue;
+		}
+	}
+
+	return changed;
+}
+
 /*
 ================
 SVC_Status
@@ -532,7 +644,6 @@ the simple info query.
 */
 static void SVC_Status( netadr_t from ) {
 	char	player[1024];
-	char	status[MAX_MSGLEN];
 	int		i;
 	client_t	*cl;
 	playerState_t	*ps;
@@ -563,31 +674,93 @@ static void SVC_Status( netadr_t from ) {
 	if(strlen(Cmd_Argv(1)) > 128)
 		return;
 
-	strcpy( infostring, Cvar_InfoString( CVAR_SERVERINFO ) );
+	if ( svc_statusServerId != sv.serverId || ( cvar_modifiedFlags & CVAR_SERVERINFO ) ) {
+		svc_statusValid = qfalse;
+	}
+
+	if ( !svc_statusValid ) {
+		Q_strncpyz( svc_statusInfo, SV_ServerInfoString(), sizeof( svc_statusInfo ) );
+	}
+
+	if ( SVC_StatusPlayersChanged() || !svc_statusValid ) {
+		svc_statusValid = qtrue;
+		svc_statusServerId = sv.serverId;
+
+		svc_statusPlayers[0] = 0;
+		statusLength = 0;
+
+		for (i=0 ; i < sv_maxclients->integer ; i++) {
+			cl = &svs.clients[i];
+			if ( cl->state >= CS_CONNECTED ) {
+				ps = SV_GameClientNum( i );
+				Com_sprintf (player, sizeof(player), "%i %i \"%s\"\n", 
+					ps->persistant[PERS_SCORE], cl->ping, cl->name);
+				playerLength = strlen(player);
+				if (statusLength + playerLength >= sizeof(svc_statusPlayers) ) {
+					break;		// can't hold any more
+				}
+				strcpy (svc_statusPlayers + statusLength, player);
+				statusLength += playerLength;
+			}
+		}
+	}
+
+	strcpy( infostring, svc_statusInfo );
 
 	// echo back the parameter to status. so master servers can use it as a challenge
 	// to prevent timed spoofed reply packets that add ghost servers
 	Info_SetValueForKey( infostring, "challenge", Cmd_Argv(1) );
 
-	status[0] = 0;
-	statusLength = 0;
+	NET_OutOfBandPrint( NS_SERVER, from, "statusResponse\n%s\n%s", infostring, svc_statusPlayers );
+}
 
-	for (i=0 ; i < sv_maxclients->integer ; i++) {
-		cl = &svs.clients[i];
-		if ( cl->state >= CS_CONNECTED ) {
-			ps = SV_GameClientNum( i );
-			Com_sprintf (player, sizeof(player), "%i %i \"%s\"\n", 
-				ps->persistant[PERS_SCORE], cl->ping, cl->name);
-			playerLength = strlen(player);
-			if (statusLength + playerLength >= sizeof(status) ) {
-				break;		// can't hold any more
-			}
-			strcpy (status + statusLength, player);
-			statusLength += playerLength;
-		}
+/*
+================
+SVC_BuildInfoString
+
+The getinfo keys that follow the challenge
+================
+*/
+static void SVC_BuildInfoString( char *infostring, int count, int humans ) {
+	char	*gamedir;
+
+	infostring[0] = 0;
+
+	Info_SetValueForKey( infostring, "gamename", com_gamename->string );
+
+#ifdef LEGACY_PROTOCOL
+	if(com_legacyprotocol->integer > 0)
+		Info_SetValueForKey(infostring, "protocol", va("%i", com_legacyprotocol->integer));
+	else
+#endif
+		Info_SetValueForKey(infostring, "protocol", va("%i", com_protocol->integer));
+
+	Info_SetValueForKey( infostring, "hostname", sv_hostname->string );
+	Info_SetValueForKey( infostring, "mapname", sv_mapname->string );
+	Info_SetValueForKey( infostring, "clients", va("%i", count) );
+	Info_SetValueForKey(infostring, "g_humanplayers", va("%i", humans));
+	Info_SetValueForKey( infostring, "sv_maxclients", 
+		va("%i", sv_maxclients->integer - sv_privateClients->integer ) );
+	Info_SetValueForKey( infostring, "gametype", va("%i", sv_gametype->integer ) );
+	Info_SetValueForKey( infostring, "pure", va("%i", sv_pure->integer ) );
+	Info_SetValueForKey(infostring, "g_needpass", va("%d", Cvar_VariableIntegerValue("g_needpass")));
+
+#ifdef USE_VOIP
+	if (sv_voipProtocol->string && *sv_voipProtocol->string) {
+		Info_SetValueForKey( infostring, "voip", sv_voipProtocol->string );
 	}
+#endif
 
-	NET_OutOfBandPrint( NS_SERVER, from, "statusResponse\n%s\n%s", infostring, status );
+	if( sv_minPing->integer ) {
+		Info_SetValueForKey( infostring, "minPing", va("%i", sv_minPing->integer) );
+	}
+	if( sv_maxPing->integer ) {
+		Info_SetValueForKey( infostring, "maxPing", va("%i", sv_maxPing->integer) );
+	}
+	gamedir = Cvar_VariableString( "fs_game" );
+	if( *gamedir ) {
+		Info_SetValueForKey( infostring, "game", gamedir );
+	}
 }
 
 /*
@@ -600,7 +773,6 @@ if a user is interested in a server to do a full status
 */
 void SVC_Info( netadr_t from ) {
 	int		i, count, humans;
-	char	*gamedir;
 	char	infostring[MAX_INFO_STRING];
 
 	// ignore if we are in single player
@@ -642,49 +814,237 @@ void SVC_Info( netadr_t from ) {
 		}
 	}
 
+	if ( !svc_infoValid || svc_infoServerId != sv.serverId || count != svc_infoCount || humans != svc_infoHumans
+		|| ( cvar_modifiedFlags & ( CVAR_SERVERINFO | CVAR_SYSTEMINFO ) ) ) {
+		svc_infoValid = qtrue;
+		svc_infoServerId = sv.serverId;
+		svc_infoCount = count;
+		svc_infoHumans = humans;
+		SVC_BuildInfoString( svc_infoString, count, humans );
+	}
+
 	infostring[0] = 0;
 
 	// echo back the parameter to status. so servers can use it as a challenge
 	// to prevent timed spoofed reply packets that add ghost servers
 	Info_SetValueForKey( infostring, "challenge", Cmd_Argv(1) );
 
-	Info_SetValueForKey( infostring, "gamename", com_gamename->string );
+	if ( strlen( infostring ) + strlen( svc_infoString ) < sizeof( infostring ) ) {
+		Q_strcat( infostring, sizeof( infostring ), svc_infoString );
+	} else {
+		Com_Printf ("Info string length exceeded\n");
+	}
 
-#ifdef LEGACY_PROTOCOL
-	if(com_legacyprotocol->integer > 0)
-		Info_SetValueForKey(infostring, "protocol", va("%i", com_legacyprotocol->integer));
-	else
-#endif
-		Info_SetValueForKey(infostring, "protocol", va("%i", com_protocol->integer));
+	NET_OutOfBandPrint( NS_SERVER, from, "infoResponse\n%s", infostring );
+}
 
-	Info_SetValueForKey( infostring, "hostname", sv_hostname->string );
-	Info_SetValueForKey( infostring, "mapname", sv_mapname->string );
-	Info_SetValueForKey( infostring, "clients", va("%i", count) );
-	Info_SetValueForKey(infostring, "g_humanplayers", va("%i", humans));
-	Info_SetValueForKey( infostring, "sv_maxclients", 
-		va("%i", sv_maxclients->integer - sv_privateClients->integer ) );
-	Info_SetValueForKey( infostring, "gametype", va("%i", sv_gametype->integer ) );
-	Info_SetValueForKey( infostring, "pure", va("%i", sv_pure->integer ) );
-	Info_SetValueForKey(infostring, "g_needpass", va("%d", Cvar_VariableIntegerValue("g_needpass")));
+/*
+==============================================================================
 
-#ifdef USE_VOIP
-	if (sv_voipProtocol->string && *sv_voipProtocol->string) {
-		Info_SetValueForKey( infostring, "voip", sv_voipProtocol->string );
+METRICS
+
+Counters for watching a server from outside instead of reading its
+console: a histogram of SV_Frame times, the time spent in the game, the
+bots and building and sending snapshots, traces, memory high-water marks
+and each client's traffic.  They count from server start and are written
+in the prometheus text format, by the "metrics" command, which works
+through rcon, and in answer to "getmetrics <sv_metricsPassword>" packets.
+
+==============================================================================
+*/
+
+extern	int		c_traces;
+
+/*
+=================
+SV_MetricsFrame
+
+Called as SV_Frame finishes a frame that ran
+=================
+*/
+static void SV_MetricsFrame( int usec ) {
+	serverMetrics_t	*m = &svs.metrics;
+	int				bucket, traces;
+
+	m->frames++;
+	m->frameUsec += usec;
+	if ( usec > m->frameMaxUsec ) {
+		m->frameMaxUsec = usec;
 	}
-#endif
+	for ( bucket = 0; bucket < METRIC_FRAME_BUCKETS - 1 && usec >= ( 1000 << bucket ); bucket++ ) {
+	}
+	m->frameBuckets[bucket]++;
 
-	if( sv_minPing->integer ) {
-		Info_SetValueForKey( infostring, "minPing", va("%i", sv_minPing->integer) );
+	// com_showtrace zeroes the count every frame
+	traces = c_traces - m->lastTraces;
+	if ( traces < 0 ) {
+		traces = c_traces;
 	}
-	if( sv_maxPing->integer ) {
-		Info_SetValueForKey( infostring, "maxPing", va("%i", sv_maxPing->integer) );
+	m->lastTraces = c_traces;
+	m->traces += traces;
+	if ( traces > m->frameMaxTraces ) {
+		m->frameMaxTraces = traces;
 	}
-	gamedir = Cvar_VariableString( "fs_game" );
-	if( *gamedir ) {
-		Info_SetValueForKey( infostring, "game", gamedir );
+}
+
+/*
+=================
+SV_MetricsLine
+=================
+*/
+static void SV_MetricsLine( char *buf, int size, const char *fmt, ... ) Q_PRINTF_FUNC(3, 4);
+static void SV_MetricsLine( char *buf, int size, const char *fmt, ... ) {
+	va_list	argptr;
+	int		len;
+
+	len = strlen( buf );
+	va_start( argptr, fmt );
+	Q_vsnprintf( buf + len, size - len, fmt, argptr );
+	va_end( argptr );
+}
+
+/*
+=================
+SV_MetricsText
+
+Everything counted, one prometheus sample per line
+=================
+*/
+static void SV_MetricsText( char *buf, int size ) {
+	serverMetrics_t	*m = &svs.metrics;
+	client_t		*cl;
+	char			name[MAX_NAME_LENGTH], *s;
+	int				i, count, zone, zonePeak, hunk, hunkPeak;
+
+	buf[0] = 0;
+
+	SV_MetricsLine( buf, size, "sv_frames_total %i\n", m->frames );
+	for ( i = 0, count = 0; i < METRIC_FRAME_BUCKETS - 1; i++ ) {
+		count += m->frameBuckets[i];
+		SV_MetricsLine( buf, size, "sv_frame_seconds_bucket{le=\"%g\"} %i\n", ( 1000 << i ) / 1e6, count );
+	}
+	SV_MetricsLine( buf, size, "sv_frame_seconds_bucket{le=\"+Inf\"} %i\n", m->frames );
+	SV_MetricsLine( buf, size, "sv_frame_seconds_sum %.6f\n", m->frameUsec / 1e6 );
+	SV_MetricsLine( buf, size, "sv_frame_seconds_count %i\n", m->frames );
+	SV_MetricsLine( buf, size, "sv_frame_seconds_max %.6f\n", m->frameMaxUsec / 1e6 );
+	SV_MetricsLine( buf, size, "sv_game_seconds_total %.6f\n", m->gameUsec / 1e6 );
+	SV_MetricsLine( buf, size, "sv_bot_seconds_total %.6f\n", m->botUsec / 1e6 );
+	SV_MetricsLine( buf, size, "sv_snapshot_build_seconds_total %.6f\n", m->snapshotBuildUsec / 1e6 );
+	SV_MetricsLine( buf, size, "sv_snapshot_send_seconds_total %.6f\n", m->snapshotSendUsec / 1e6 );
+	SV_MetricsLine( buf, size, "sv_snapshots_total %lli\n", (long long)m->snapshots );
+	SV_MetricsLine( buf, size, "sv_traces_total %lli\n", (long long)m->traces );
+	SV_MetricsLine( buf, size, "sv_frame_traces_max %i\n", m->frameMaxTraces );
+
+	Com_MemUsage( &zone, &zonePeak, &hunk, &hunkPeak );
+	SV_MetricsLine( buf, size, "sv_zone_bytes %i\n", zone );
+	SV_MetricsLine( buf, size, "sv_zone_peak_bytes %i\n", zonePeak );
+	SV_MetricsLine( buf, size, "sv_hunk_bytes %i\n", hunk );
+	SV_MetricsLine( buf, size, "sv_hunk_peak_bytes %i\n", hunkPeak );
+
+	if ( !svs.clients ) {
+		return;
 	}
 
-	NET_OutOfBandPrint( NS_SERVER, from, "infoResponse\n%s", infostring );
+	for ( i = 0, count = 0; i < sv_maxclients->integer; i++ ) {
+		if ( svs.clients[i].state >= CS_CONNECTED ) {
+			count++;
+		}
+	}
+	SV_MetricsLine( buf, size, "sv_clients %i\n", count );
+
+	for ( i = 0, cl = svs.clients; i < sv_maxclients->integer; i++, cl++ ) {
+		if ( cl->state < CS_CONNECTED || cl->netchan.remoteAddress.type == NA_BOT ) {
+			continue;
+		}
+
+		// label values can't hold quotes or backslashes
+		Q_strncpyz( name, cl->name, sizeof( name ) );
+		Q_CleanStr( name );
+		for ( s = name; *s; s++ ) {
+			if ( *s == '"' || *s == '\\' ) {
+				*s = '_';
+			}
+		}
+
+#define	CLIENT_METRIC( metric, fmt, value ) \
+		SV_MetricsLine( buf, size, "sv_client_" metric "{client=\"%i\",name=\"%s\"} " fmt "\n", i, name, value )
+		CLIENT_METRIC( "sent_bytes_total", "%lli", (long long)cl->metrics.bytesSent );
+		CLIENT_METRIC( "sent_packets_total", "%i", cl->metrics.packetsSent );
+		CLIENT_METRIC( "received_bytes_total", "%lli", (long long)cl->metrics.bytesReceived );
+		CLIENT_METRIC( "received_packets_total", "%i", cl->metrics.packetsReceived );
+		CLIENT_METRIC( "choked_total", "%i", cl->metrics.choked );
+		CLIENT_METRIC( "dropped_total", "%i", cl->metrics.dropped );
+		CLIENT_METRIC( "ping_milliseconds", "%i", cl->ping );
+#undef CLIENT_METRIC
+	}
+}
+
+/*
+=================
+SV_Metrics_f
+=================
+*/
+static void SV_Metrics_f( void ) {
+	static char	buf[65536];
+	char		*line, *next;
+
+	SV_MetricsText( buf, sizeof( buf ) );
+
+	// a line at a time, the whole text is more than one print takes
+	for ( line = buf; *line; line = next ) {
+		next = strchr( line, '\n' );
+		if ( !next ) {
+			Com_Printf( "%s\n", line );
+			break;
+		}
+		*next++ = 0;
+		Com_Printf( "%s\n", line );
+	}
+}
+
+/*
+=================
+SVC_Metrics
+
+Answers a getmetrics query in packets of whole lines
+=================
+*/
+static void SVC_Metrics( netadr_t from ) {
+	static char	buf[65536];
+	char		*start, *end, *next;
+
+	// only with the password, so nobody can use it as an amplifier
+	if ( SVC_RateLimitAddress( from, 10, 1000 ) ) {
+		Com_DPrintf( "SVC_Metrics: rate limit from %s exceeded, dropping request\n",
+			NET_AdrToString( from ) );
+		return;
+	}
+
+	if ( !sv_metricsPassword->string[0] || strcmp( Cmd_Argv( 1 ), sv_metricsPassword->string ) ) {
+		return;
+	}
+
+	SV_MetricsText( buf, sizeof( buf ) );
+
+	for ( start = buf; *start; start = end ) {
+		for ( end = start; *end; end = next ) {
+			next = strchr( end, '\n' );
+			next = next ? next + 1 : end + strlen( end );
+			if ( next - start > 1200 && end > start ) {
+				break;
+			}
+		}
+		NET_OutOfBandPrint( NS_SERVER, from, "metricsResponse\n%.*s", (int)( end - start ), start );
+	}
+}
+
+/*
+=================
+SV_AddMetricsCommands
+=================
+*/
+void SV_AddMetricsCommands( void ) {
+	Cmd_AddCommand( "metrics", SV_Metrics_f );
 }
 
 /*
@@ -813,6 +1173,8 @@ static void SV_ConnectionlessPacket( netadr_t from, msg_t *msg ) {
 #endif
 	} else if (!Q_stricmp(c, "rcon")) {
 		SVC_RemoteCommand( from, msg );
+	} else if (!Q_stricmp(c, "getmetrics")) {
+		SVC_Metrics( from );
 	} else if (!Q_stricmp(c, "disconnect")) {
 		// if a client starts up a local server, we may see some spurious
 		// server disconnect messages when their new server sees our final
@@ -869,8 +1231,12 @@ void SV_PacketEvent( netadr_t from, msg_t *msg ) {
 			cl->netchan.remoteAddress.port = from.port;
 		}
 
+		cl->metrics.packetsReceived++;
+		cl->metrics.bytesReceived += msg->cursize;
+
 		// make sure it is a valid, in sequence packet
 		if (SV_Netchan_Process(cl, msg)) {
+			cl->metrics.dropped += cl->netchan.dropped;
 			// zombie clients still need to do the Netchan_Process
 			// to make sure they don't need to retransmit the final
 			// reliable message, but they don't do any other processing
@@ -1055,6 +1421,7 @@ happen before SV_Frame is called
 void SV_Frame( int msec ) {
 	int		frameMsec;
 	int		startTime;
+	int64_t	frameStart, usec;
 
 	// the menu kills the server with this cvar
 	if ( sv_killserver->integer ) {
@@ -1118,9 +1485,18 @@ void SV_Frame( int msec ) {
 		return;
 	}
 
+	// the load clients' packets are timed apart from the frame
+	SV_LoadTestFrame();
+
+	PROFILE_BEGIN( "SV_Frame" );
+	frameStart = Sys_Microseconds();
+
 	// update infostrings if anything has been changed
+	if ( cvar_modifiedFlags & ( CVAR_SERVERINFO | CVAR_SYSTEMINFO ) ) {
+		SVC_InvalidateInfo();
+	}
 	if ( cvar_modifiedFlags & CVAR_SERVERINFO ) {
-		SV_SetConfigstring( CS_SERVERINFO, Cvar_InfoString( CVAR_SERVERINFO ) );
+		SV_SetConfigstring( CS_SERVERINFO, SV_ServerInfoString() );
 		cvar_modifiedFlags &= ~CVAR_SERVERINFO;
 	}
 	if ( cvar_modifiedFlags & CVAR_SYSTEMINFO ) {
@@ -1137,17 +1513,23 @@ void SV_Frame( int msec ) {
 	// update ping based on the all received frames
 	SV_CalcPings();
 
+	usec = Sys_Microseconds();
 	if (com_dedicated->integer) SV_BotFrame (sv.time);
+	svs.metrics.botUsec += Sys_Microseconds() - usec;
 
 	// run the game simulation in chunks
+	usec = Sys_Microseconds();
 	while ( sv.timeResidual >= frameMsec ) {
 		sv.timeResidual -= frameMsec;
 		svs.time += frameMsec;
 		sv.time += frameMsec;
 
 		// let everything in the world think and move
+		SV_InvalidateTraceCache();
 		VM_Call (gvm, GAME_RUN_FRAME, sv.time);
+		SV_RecordEntityHistory();
 	}
+	svs.metrics.gameUsec += Sys_Microseconds() - usec;
 
 	if ( com_speeds->integer ) {
 		time_game = Sys_Milliseconds () - startTime;
@@ -1161,6 +1543,13 @@ void SV_Frame( int msec ) {
 
 	// send a heartbeat to the master if needed
 	SV_MasterHeartbeat(HEARTBEAT_FOR_MASTER);
+
+	SV_PreloadNextMap();
+
+	usec = Sys_Microseconds() - frameStart;
+	SV_MetricsFrame( (int)usec );
+	SV_LoadTestFrameTime( (int)usec );
+	PROFILE_END();
 }
 
 /*
@@ -1225,7 +1614,7 @@ Return the time in msec until we expect to be called next
 
 int SV_SendQueuedPackets(void)
 {
-	int numBlocks;
+	int numBytes;
 	int dlStart, deltaT, delayT;
 	static int dlNextRound = 0;
 	int timeVal = INT_MAX;
@@ -1249,14 +1638,14 @@ int SV_SendQueuedPackets(void)
 		}
 		else
 		{
-			numBlocks = SV_SendDownloadMessages();
+			numBytes = SV_SendDownloadMessages();
 
-			if(numBlocks)
+			if(numBytes)
 			{
 				// There are active downloads
 				deltaT = Sys_Milliseconds() - dlStart;
 
-				delayT = 1000 * numBlocks * MAX_DOWNLOAD_BLKSIZE;
+				delayT = 1000 * numBytes;
 				delayT /= sv_dlRate->integer * 1024;
 
 				if(delayT <= deltaT + 1)
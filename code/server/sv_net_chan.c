@@ -36,7 +36,6 @@ SV_Netchan_Encode
 */
 static void SV_Netchan_Encode(client_t *client, msg_t *msg, const char *clientCommandString)
 {
-	long i, index;
 	byte key, *string;
 	int	srdc, sbit;
 	qboolean soob;
@@ -60,23 +59,10 @@ static void SV_Netchan_Encode(client_t *client, msg_t *msg, const char *clientCo
 	msg->readcount = srdc;
 
 	string = (byte *) clientCommandString;
-	index = 0;
-	// xor the client challenge with the netchan sequence number
+	// xor the client challenge with the netchan sequence number, the key changes
+	// with the last received and with this message acknowledged client command
 	key = client->challenge ^ client->netchan.outgoingSequence;
-	for (i = SV_ENCODE_START; i < msg->cursize; i++) {
-		// modify the key with the last received and with this message acknowledged client command
-		if (!string[index])
-			index = 0;
-		if (string[index] > 127 || string[index] == '%') {
-			key ^= '.' << (i & 1);
-		}
-		else {
-			key ^= string[index] << (i & 1);
-		}
-		index++;
-		// encode the data with this key
-		*(msg->data + i) = *(msg->data + i) ^ key;
-	}
+	Netchan_XorPayload( msg, SV_ENCODE_START, key, string );
 }
 
 /*
@@ -92,7 +78,7 @@ SV_Netchan_Decode
 */
 static void SV_Netchan_Decode( client_t *client, msg_t *msg ) {
 	int serverId, messageAcknowledge, reliableAcknowledge;
-	int i, index, srdc, sbit;
+	int srdc, sbit;
 	qboolean soob;
 	byte key, *string;
 
@@ -111,23 +97,9 @@ static void SV_Netchan_Decode( client_t *client, msg_t *msg ) {
 	msg->readcount = srdc;
 
 	string = (byte *)client->reliableCommands[ reliableAcknowledge & (MAX_RELIABLE_COMMANDS-1) ];
-	index = 0;
-	//
+	// the key changes with the last sent and acknowledged server command
 	key = client->challenge ^ serverId ^ messageAcknowledge;
-	for (i = msg->readcount + SV_DECODE_START; i < msg->cursize; i++) {
-		// modify the key with the last sent and acknowledged server command
-		if (!string[index])
-			index = 0;
-		if (string[index] > 127 || string[index] == '%') {
-			key ^= '.' << (i & 1);
-		}
-		else {
-			key ^= string[index] << (i & 1);
-		}
-		index++;
-		// decode the data with this key
-		*(msg->data + i) = *(msg->data + i) ^ key;
-	}
+	Netchan_XorPayload( msg, msg->readcount + SV_DECODE_START, key, string );
 }
 #endif
 
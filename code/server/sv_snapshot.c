@@ -45,6 +45,214 @@ A normal server packet will look like:
 =============================================================================
 */
 
+// work shared between clients is only trusted while SV_SendClientMessages
+// runs, because the game can move and relink entities between calls
+static unsigned		sv_sendFrame;
+static qboolean		sv_sendFrameActive;
+
+/*
+=============================================================================
+
+Entity deltas shared by every client that has the same from state.  All
+the snapshots built in one send frame share the same current entity
+states, so the key only needs the from state.
+
+=============================================================================
+*/
+
+#define	DELTA_CACHE_SIZE	1024	// direct mapped on the entity number
+#define	DELTA_CACHE_BYTES	64		// longer deltas are just written
+
+typedef struct {
+	unsigned		frame;
+	qboolean		force;
+	entityState_t	from;
+	int				bits;
+	byte			data[DELTA_CACHE_BYTES];
+} svDeltaCache_t;
+
+static svDeltaCache_t	sv_deltaCache[DELTA_CACHE_SIZE];
+
+/*
+=============================================================================
+
+Client frames hold indexes into svs.snapshotStates, so an entity that
+several clients are sent in one send frame has its state copied once.
+
+=============================================================================
+*/
+
+static unsigned		sv_stateFrame[MAX_GENTITIES];	// sv_sendFrame sv_stateNum is from
+static int			sv_stateNum[MAX_GENTITIES];
+
+/*
+=============
+SV_SnapshotEntity
+=============
+*/
+entityState_t *SV_SnapshotEntity( clientSnapshot_t *frame, int index ) {
+	int		state;
+
+	state = svs.snapshotEntities[(frame->first_entity + index) % svs.numSnapshotEntities];
+	return &svs.snapshotStates[state % svs.numSnapshotStates];
+}
+
+/*
+=============
+SV_SnapshotState
+
+The svs.snapshotStates index holding the current state of an entity
+=============
+*/
+static int SV_SnapshotState( int entityNum ) {
+	int		state;
+
+	if ( sv_sendFrameActive && sv_stateFrame[entityNum] == sv_sendFrame ) {
+		return sv_stateNum[entityNum];
+	}
+
+	state = svs.nextSnapshotStates++;
+	svs.snapshotStates[state % svs.numSnapshotStates] = SV_GentityNum( entityNum )->s;
+
+	sv_stateFrame[entityNum] = sv_sendFrame;
+	sv_stateNum[entityNum] = state;
+	return state;
+}
+
+/*
+=============================================================================
+
+MESSAGE CAPTURE
+
+=============================================================================
+*/
+
+static fileHandle_t	sv_msgCapture;
+static int			sv_msgCaptureCount;
+
+/*
+=============
+SV_StopRecordingMsgs
+=============
+*/
+void SV_StopRecordingMsgs( void ) {
+	if ( !sv_msgCapture ) {
+		return;
+	}
+
+	FS_FCloseFile( sv_msgCapture );
+	sv_msgCapture = 0;
+	Com_Printf( "Recorded %i snapshots\n", sv_msgCaptureCount );
+}
+
+/*
+=============
+SV_RecordMsgs_f
+
+recordmsgs <file> writes the player and entity state deltas of every
+snapshot sent until recordmsgs is given without a file, for msgbench
+to replay
+=============
+*/
+void SV_RecordMsgs_f( void ) {
+	msgCaptureHeader_t	header;
+	char				filename[MAX_QPATH];
+
+	SV_StopRecordingMsgs();
+
+	if ( Cmd_Argc() < 2 ) {
+		return;
+	}
+
+	Q_strncpyz( filename, Cmd_Argv( 1 ), sizeof( filename ) );
+	COM_DefaultExtension( filename, sizeof( filename ), ".msgs" );
+	if ( !COM_CompareExtension( filename, ".msgs" ) ) {
+		Com_Printf( "recordmsgs: %s isn't a .msgs file\n", filename );
+		return;
+	}
+
+	sv_msgCapture = FS_FOpenFileWrite_HomeData( filename );
+	if ( !sv_msgCapture ) {
+		Com_Printf( "Couldn't write %s\n", filename );
+		return;
+	}
+
+	header.ident = MSG_CAPTURE_IDENT;
+	header.version = MSG_CAPTURE_VERSION;
+	header.entityStateSize = sizeof( entityState_t );
+	header.playerStateSize = sizeof( playerState_t );
+	FS_Write( &header, sizeof( header ), sv_msgCapture );
+
+	sv_msgCaptureCount = 0;
+	Com_Printf( "Recording snapshots to %s\n", filename );
+}
+
+/*
+=============
+SV_CaptureDelta
+=============
+*/
+static void SV_CaptureDelta( msgCaptureType_t type, const void *from, const void *to, int size, qboolean force ) {
+	msgCaptureRecord_t	rec;
+
+	rec.type = type;
+	rec.flags = ( from ? MSGCF_FROM : 0 ) | ( to ? MSGCF_TO : 0 ) | ( force ? MSGCF_FORCE : 0 );
+	FS_Write( &rec, sizeof( rec ), sv_msgCapture );
+	if ( from ) {
+		FS_Write( from, size, sv_msgCapture );
+	}
+	if ( to ) {
+		FS_Write( to, size, sv_msgCapture );
+	}
+
+	if ( type == MSGC_SNAPSHOT ) {
+		sv_msgCaptureCount++;
+	}
+}
+
+/*
+=============
+SV_WriteDeltaEntity
+
+MSG_WriteDeltaEntity for the current state of an entity, reusing the
+bits another client was sent this frame when it had the same from state
+=============
+*/
+static void SV_WriteDeltaEntity( msg_t *msg, entityState_t *from, entityState_t *to, qboolean force ) {
+	svDeltaCache_t	*cache;
+	int				startBit;
+
+	if ( sv_msgCapture ) {
+		SV_CaptureDelta( MSGC_ENTITY, from, to, sizeof( *to ), force );
+	}
+
+	// deferred entities resend an old state, which other clients' bits don't cover
+	if ( !sv_sendFrameActive || msg->oob
+		|| memcmp( to, &SV_GentityNum( to->number )->s, sizeof( *to ) ) ) {
+		MSG_WriteDeltaEntity( msg, from, to, force );
+		return;
+	}
+
+	cache = &sv_deltaCache[ to->number & ( DELTA_CACHE_SIZE - 1 ) ];
+	if ( cache->frame == sv_sendFrame && cache->from.number == from->number
+		&& cache->force == force && !memcmp( &cache->from, from, sizeof( *from ) ) ) {
+		MSG_WriteBitString( msg, cache->data, cache->bits );
+		return;
+	}
+
+	startBit = msg->bit;
+	MSG_WriteDeltaEntity( msg, from, to, force );
+	if ( msg->overflowed || msg->bit - startBit > DELTA_CACHE_BYTES * 8 ) {
+		return;
+	}
+
+	cache->frame = sv_sendFrame;
+	cache->force = force;
+	cache->from = *from;
+	cache->bits = msg->bit - startBit;
+	MSG_CopyBits( cache->data, 0, msg->data, startBit, cache->bits );
+}
+
 /*
 =============
 SV_EmitPacketEntities
@@ -73,14 +281,14 @@ static void SV_EmitPacketEntities( clientSnapshot_t *from, clientSnapshot_t *to,
 		if ( newindex >= to->num_entities ) {
 			newnum = 9999;
 		} else {
-			newent = &svs.snapshotEntities[(to->first_entity+newindex) % svs.numSnapshotEntities];
+			newent = SV_SnapshotEntity( to, newindex );
 			newnum = newent->number;
 		}
 
 		if ( oldindex >= from_num_entities ) {
 			oldnum = 9999;
 		} else {
-			oldent = &svs.snapshotEntities[(from->first_entity+oldindex) % svs.numSnapshotEntities];
+			oldent = SV_SnapshotEntity( from, oldindex );
 			oldnum = oldent->number;
 		}
 
@@ -88,7 +296,7 @@ static void SV_EmitPacketEntities( clientSnapshot_t *from, clientSnapshot_t *to,
 			// delta update from old position
 			// because the force parm is qfalse, this will not result
 			// in any bytes being emitted if the entity has not changed at all
-			MSG_WriteDeltaEntity (msg, oldent, newent, qfalse );
+			SV_WriteDeltaEntity (msg, oldent, newent, qfalse );
 			oldindex++;
 			newindex++;
 			continue;
@@ -96,13 +304,16 @@ static void SV_EmitPacketEntities( clientSnapshot_t *from, clientSnapshot_t *to,
 
 		if ( newnum < oldnum ) {
 			// this is a new entity, send it from the baseline
-			MSG_WriteDeltaEntity (msg, &sv.svEntities[newnum].baseline, newent, qtrue );
+			SV_WriteDeltaEntity (msg, &sv.svEntities[newnum].baseline, newent, qtrue );
 			newindex++;
 			continue;
 		}
 
 		if ( newnum > oldnum ) {
 			// the old entity isn't present in the new message
+			if ( sv_msgCapture ) {
+				SV_CaptureDelta( MSGC_ENTITY, oldent, NULL, sizeof( *oldent ), qtrue );
+			}
 			MSG_WriteDeltaEntity (msg, oldent, NULL, qtrue );
 			oldindex++;
 			continue;
@@ -114,6 +325,45 @@ static void SV_EmitPacketEntities( clientSnapshot_t *from, clientSnapshot_t *to,
 
 
 
+/*
+==================
+SV_DeltaFrame
+
+The frame the snapshot being created will be delta compressed from, if any
+==================
+*/
+static clientSnapshot_t *SV_DeltaFrame( client_t *client, qboolean report ) {
+	clientSnapshot_t	*oldframe;
+
+	if ( client->deltaMessage <= 0 || client->state != CS_ACTIVE ) {
+		// client is asking for a retransmit
+		return NULL;
+	}
+
+	if ( client->netchan.outgoingSequence - client->deltaMessage 
+		>= (PACKET_BACKUP - 3) ) {
+		// client hasn't gotten a good message through in a long time
+		if ( report ) {
+			Com_DPrintf ("%s: Delta request from out of date packet.\n", client->name);
+		}
+		return NULL;
+	}
+
+	// we have a valid snapshot to delta from
+	oldframe = &client->frames[ client->deltaMessage & PACKET_MASK ];
+
+	// the snapshot's entities may still have rolled off the buffer, though
+	if ( oldframe->first_entity <= svs.nextSnapshotEntities - svs.numSnapshotEntities
+		|| oldframe->oldestState <= svs.nextSnapshotStates - svs.numSnapshotStates ) {
+		if ( report ) {
+			Com_DPrintf ("%s: Delta request from out of date entities.\n", client->name);
+		}
+		return NULL;
+	}
+
+	return oldframe;
+}
+
 /*
 ==================
 SV_WriteSnapshotToClient
@@ -129,27 +379,11 @@ static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
 	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
 
 	// try to use a previous frame as the source for delta compressing the snapshot
-	if ( client->deltaMessage <= 0 || client->state != CS_ACTIVE ) {
-		// client is asking for a retransmit
-		oldframe = NULL;
-		lastframe = 0;
-	} else if ( client->netchan.outgoingSequence - client->deltaMessage 
-		>= (PACKET_BACKUP - 3) ) {
-		// client hasn't gotten a good message through in a long time
-		Com_DPrintf ("%s: Delta request from out of date packet.\n", client->name);
-		oldframe = NULL;
-		lastframe = 0;
-	} else {
-		// we have a valid snapshot to delta from
-		oldframe = &client->frames[ client->deltaMessage & PACKET_MASK ];
+	oldframe = SV_DeltaFrame( client, qtrue );
+	if ( oldframe ) {
 		lastframe = client->netchan.outgoingSequence - client->deltaMessage;
-
-		// the snapshot's entities may still have rolled off the buffer, though
-		if ( oldframe->first_entity <= svs.nextSnapshotEntities - svs.numSnapshotEntities ) {
-			Com_DPrintf ("%s: Delta request from out of date entities.\n", client->name);
-			oldframe = NULL;
-			lastframe = 0;
-		}
+	} else {
+		lastframe = 0;
 	}
 
 	MSG_WriteByte (msg, svc_snapshot);
@@ -189,6 +423,11 @@ static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
 	MSG_WriteByte (msg, frame->areabytes);
 	MSG_WriteData (msg, frame->areabits, frame->areabytes);
 
+	if ( sv_msgCapture ) {
+		SV_CaptureDelta( MSGC_SNAPSHOT, NULL, NULL, 0, qfalse );
+		SV_CaptureDelta( MSGC_PLAYERSTATE, oldframe ? &oldframe->ps : NULL, &frame->ps, sizeof( frame->ps ), qfalse );
+	}
+
 	// delta encode the playerstate
 	if ( oldframe ) {
 		MSG_WriteDeltaPlayerstate( msg, &oldframe->ps, &frame->ps );
@@ -208,6 +447,77 @@ static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
 }
 
 
+/*
+==================
+SV_PendingServerCommand
+
+The text sent for an unacknowledged command, empty once a later one
+replaces it
+==================
+*/
+static const char *SV_PendingServerCommand( client_t *client, int sequence ) {
+	int		index;
+
+	index = sequence & ( MAX_RELIABLE_COMMANDS - 1 );
+	if ( client->compressCommands && client->reliableSuperseded[ index ] ) {
+		return "";
+	}
+	return client->reliableCommands[ index ];
+}
+
+/*
+==================
+SV_WriteDeflatedServerCommands
+
+All the unacknowledged commands as one deflated block of strings, kept
+from the last packet while the pending range hasn't moved
+==================
+*/
+static qboolean SV_WriteDeflatedServerCommands( client_t *client, msg_t *msg ) {
+	static char	data[MAX_RELIABLE_COMMANDS * MAX_STRING_CHARS];
+	const char	*s;
+	int			first, last;
+	int			i, j, len, size;
+
+	first = client->reliableAcknowledge + 1;
+	last = client->reliableSequence;
+
+	if ( client->deflatedFirst != first || client->deflatedLast != last ) {
+		size = 0;
+		for ( i = first ; i <= last ; i++ ) {
+			s = SV_PendingServerCommand( client, i );
+			len = strlen( s ) + 1;
+			Com_Memcpy( data + size, s, len );
+			// the same substitutions MSG_WriteString makes
+			for ( j = size ; j < size + len - 1 ; j++ ) {
+				if ( ((byte *)data)[j] > 127 || data[j] == '%' ) {
+					data[j] = '.';
+				}
+			}
+			size += len;
+		}
+
+		// not worth it unless it comes out smaller
+		client->deflatedFirst = first;
+		client->deflatedLast = last;
+		client->deflatedSize = size;
+		client->deflatedPackedSize = MSG_Deflate( data, size, client->deflatedCommands,
+			MIN( size, sizeof( client->deflatedCommands ) ) );
+	}
+
+	if ( !client->deflatedPackedSize ) {
+		return qfalse;
+	}
+
+	MSG_WriteByte( msg, svc_serverCommandsDeflated );
+	MSG_WriteLong( msg, first );
+	MSG_WriteLong( msg, last );
+	MSG_WriteLong( msg, client->deflatedSize );
+	MSG_WriteLong( msg, client->deflatedPackedSize );
+	MSG_WriteBitString( msg, client->deflatedCommands, client->deflatedPackedSize * 8 );
+	return qtrue;
+}
+
 /*
 ==================
 SV_UpdateServerCommandsToClient
@@ -219,10 +529,14 @@ void SV_UpdateServerCommandsToClient( client_t *client, msg_t *msg ) {
 	int		i;
 
 	// write any unacknowledged serverCommands
-	for ( i = client->reliableAcknowledge + 1 ; i <= client->reliableSequence ; i++ ) {
-		MSG_WriteByte( msg, svc_serverCommand );
-		MSG_WriteLong( msg, i );
-		MSG_WriteString( msg, client->reliableCommands[ i & (MAX_RELIABLE_COMMANDS-1) ] );
+	if ( client->reliableAcknowledge < client->reliableSequence
+		&& ( !client->compressCommands || !sv_compressCommands->integer
+		|| !SV_WriteDeflatedServerCommands( client, msg ) ) ) {
+		for ( i = client->reliableAcknowledge + 1 ; i <= client->reliableSequence ; i++ ) {
+			MSG_WriteByte( msg, svc_serverCommand );
+			MSG_WriteLong( msg, i );
+			MSG_WriteString( msg, SV_PendingServerCommand( client, i ) );
+		}
 	}
 	client->reliableSent = client->reliableSequence;
 }
@@ -235,53 +549,288 @@ Build a client snapshot structure
 =============================================================================
 */
 
+// entity numbers are bounded, so the snapshot set is a bit per entity
+// that is walked in entity order, ready for SV_EmitPacketEntities
 typedef struct {
 	int		numSnapshotEntities;
-	int		snapshotEntities[MAX_SNAPSHOT_ENTITIES];	
+	int		maxSnapshotEntities;
+	byte	bits[MAX_GENTITIES/8];
 } snapshotEntityNumbers_t;
 
+// entities closer than this always get their changes, past it a choked
+// client gets them every other snapshot, and past the far distance every fourth
+#define	SNAPSHOT_NEAR_DIST		1024
+#define	SNAPSHOT_FAR_DIST		3072
+
+typedef struct {
+	float	priority;
+	int		number;
+} snapshotPriority_t;
+
+/*
+===============
+SV_AddEntToSnapshot
+===============
+*/
+static void SV_AddEntToSnapshot( sharedEntity_t *gEnt, snapshotEntityNumbers_t *eNums ) {
+	int		e;
+
+	e = gEnt->s.number;
+
+	// if we have already added this entity to this snapshot, don't add again
+	if ( eNums->bits[e >> 3] & ( 1 << ( e & 7 ) ) ) {
+		return;
+	}
+
+	// if we are full, silently discard entities
+	if ( eNums->numSnapshotEntities == eNums->maxSnapshotEntities ) {
+		return;
+	}
+
+	eNums->bits[e >> 3] |= 1 << ( e & 7 );
+	eNums->numSnapshotEntities++;
+}
+
+/*
+===============
+SV_EntityPriority
+
+Lower is more important: broadcast entities, then by distance to the
+viewer with players counted as closer than they are
+===============
+*/
+static float SV_EntityPriority( sharedEntity_t *ent, const vec3_t org ) {
+	vec3_t	center;
+	float	dist;
+
+	if ( ent->r.svFlags & SVF_BROADCAST ) {
+		return 0;
+	}
+
+	VectorAdd( ent->r.absmin, ent->r.absmax, center );
+	VectorScale( center, 0.5f, center );
+	dist = DistanceSquared( center, org );
+
+	if ( ent->s.number < sv_maxclients->integer ) {
+		dist *= 0.25f;
+	}
+
+	return dist;
+}
+
 /*
 =======================
-SV_QsortEntityNumbers
+SV_QsortEntityPriority
 =======================
 */
-static int QDECL SV_QsortEntityNumbers( const void *a, const void *b ) {
-	int	*ea, *eb;
+static int QDECL SV_QsortEntityPriority( const void *a, const void *b ) {
+	const snapshotPriority_t	*pa, *pb;
+
+	pa = (const snapshotPriority_t *)a;
+	pb = (const snapshotPriority_t *)b;
+
+	if ( pa->priority != pb->priority ) {
+		return pa->priority < pb->priority ? -1 : 1;
+	}
+
+	return pa->number - pb->number;
+}
+
+/*
+===============
+SV_TrimSnapshotEntities
+
+Keeps the MAX_SNAPSHOT_ENTITIES most important entities of an overfull set,
+instead of whichever had the lowest numbers
+===============
+*/
+static void SV_TrimSnapshotEntities( snapshotEntityNumbers_t *eNums, const vec3_t org ) {
+	static snapshotPriority_t	ranked[MAX_GENTITIES];
+	int		e, i, n;
+
+	n = 0;
+	for ( e = 0 ; e < sv.num_entities ; e++ ) {
+		if ( eNums->bits[e >> 3] & ( 1 << ( e & 7 ) ) ) {
+			ranked[n].priority = SV_EntityPriority( SV_GentityNum( e ), org );
+			ranked[n].number = e;
+			n++;
+		}
+	}
+
+	qsort( ranked, n, sizeof( ranked[0] ), SV_QsortEntityPriority );
+
+	for ( i = MAX_SNAPSHOT_ENTITIES ; i < n ; i++ ) {
+		e = ranked[i].number;
+		eNums->bits[e >> 3] &= ~( 1 << ( e & 7 ) );
+	}
 
-	ea = (int *)a;
-	eb = (int *)b;
+	eNums->numSnapshotEntities = MAX_SNAPSHOT_ENTITIES;
+}
+
+/*
+===============
+SV_DeferEntity
+
+A choked client can be sent the state it already has for a far away
+entity, which costs nothing to delta.  The entity number staggers which
+snapshots carry the real update, so none of them wait long.
+===============
+*/
+static qboolean SV_DeferEntity( sharedEntity_t *ent, entityState_t *old, const vec3_t org, int sequence ) {
+	float	dist;
+	int		mask;
+
+	if ( ent->s.number < sv_maxclients->integer ) {
+		return qfalse;
+	}
+
+	if ( ent->r.svFlags & SVF_BROADCAST ) {
+		return qfalse;
+	}
 
-	if ( *ea == *eb ) {
-		Com_Error( ERR_DROP, "SV_QsortEntityStates: duplicated entity" );
+	// events are only seen when they change, never hold them back
+	if ( ent->s.event != old->event ) {
+		return qfalse;
 	}
 
-	if ( *ea < *eb ) {
-		return -1;
+	dist = SV_EntityPriority( ent, org );
+	if ( dist < SNAPSHOT_NEAR_DIST * SNAPSHOT_NEAR_DIST ) {
+		return qfalse;
 	}
 
-	return 1;
+	mask = dist < SNAPSHOT_FAR_DIST * SNAPSHOT_FAR_DIST ? 1 : 3;
+
+	return ( ( ent->s.number + sequence ) & mask ) != 0;
 }
 
+/*
+=============================================================================
+
+Entity visibility shared by every viewer in the same cluster and area.
+
+=============================================================================
+*/
+
+#define	VIS_CACHE_SIZE		32		// direct mapped, collisions just recompute
+
+typedef struct {
+	unsigned	frame;
+	int			cluster;
+	int			area;
+	int			numEntities;
+	short		entities[MAX_GENTITIES];	// in entity order
+} svVisCache_t;
+
+static svVisCache_t	sv_visCache[VIS_CACHE_SIZE];
 
 /*
 ===============
-SV_AddEntToSnapshot
+SV_EntityVisibleFromCluster
+
+Checks the area connection and the PVS, nothing that depends on the viewer.
 ===============
 */
-static void SV_AddEntToSnapshot( svEntity_t *svEnt, sharedEntity_t *gEnt, snapshotEntityNumbers_t *eNums ) {
-	// if we have already added this entity to this snapshot, don't add again
-	if ( svEnt->snapshotCounter == sv.snapshotCounter ) {
-		return;
+static qboolean SV_EntityVisibleFromCluster( svEntity_t *svEnt, int clientarea, byte *clientpvs ) {
+	int		i, l;
+
+	// ignore if not touching a PV leaf
+	// check area
+	if ( !CM_AreasConnected( clientarea, svEnt->areanum ) ) {
+		// doors can legally straddle two areas, so
+		// we may need to check another one
+		if ( !CM_AreasConnected( clientarea, svEnt->areanum2 ) ) {
+			return qfalse;		// blocked by a door
+		}
 	}
-	svEnt->snapshotCounter = sv.snapshotCounter;
 
-	// if we are full, silently discard entities
-	if ( eNums->numSnapshotEntities == MAX_SNAPSHOT_ENTITIES ) {
-		return;
+	// check individual leafs
+	if ( !svEnt->numClusters ) {
+		return qfalse;
+	}
+	l = 0;
+	for ( i=0 ; i < svEnt->numClusters ; i++ ) {
+		l = svEnt->clusternums[i];
+		if ( clientpvs[l >> 3] & (1 << (l&7) ) ) {
+			return qtrue;
+		}
 	}
 
-	eNums->snapshotEntities[ eNums->numSnapshotEntities ] = gEnt->s.number;
-	eNums->numSnapshotEntities++;
+	// if we haven't found it to be visible,
+	// check overflow clusters that coudln't be stored
+	if ( svEnt->lastCluster ) {
+		for ( ; l <= svEnt->lastCluster ; l++ ) {
+			if ( clientpvs[l >> 3] & (1 << (l&7) ) ) {
+				break;
+			}
+		}
+		if ( l != svEnt->lastCluster ) {
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
+
+/*
+===============
+SV_ClusterVisibleEntities
+
+Returns the entities that are linked, not SVF_NOCLIENT, and either
+broadcast or visible from the cluster and area, in entity order.
+===============
+*/
+static svVisCache_t *SV_ClusterVisibleEntities( int clientcluster, int clientarea, byte *clientpvs ) {
+	static svVisCache_t	uncached;
+	svVisCache_t	*cache;
+	sharedEntity_t	*ent;
+	svEntity_t		*svEnt;
+	int				e;
+
+	if ( sv_sendFrameActive ) {
+		cache = &sv_visCache[ ( clientcluster * 31 + clientarea ) & ( VIS_CACHE_SIZE - 1 ) ];
+		if ( cache->frame == sv_sendFrame && cache->cluster == clientcluster
+			&& cache->area == clientarea ) {
+			return cache;
+		}
+		cache->frame = sv_sendFrame;
+	} else {
+		cache = &uncached;
+		cache->frame = 0;
+	}
+	cache->cluster = clientcluster;
+	cache->area = clientarea;
+	cache->numEntities = 0;
+
+	for ( e = 0 ; e < sv.num_entities ; e++ ) {
+		ent = SV_GentityNum(e);
+
+		// never send entities that aren't linked in
+		if ( !ent->r.linked ) {
+			continue;
+		}
+
+		if (ent->s.number != e) {
+			Com_DPrintf ("FIXING ENT->S.NUMBER!!!\n");
+			ent->s.number = e;
+		}
+
+		// entities can be flagged to explicitly not be sent to the client
+		if ( ent->r.svFlags & SVF_NOCLIENT ) {
+			continue;
+		}
+
+		svEnt = SV_SvEntityForGentity( ent );
+
+		// broadcast entities are always sent
+		if ( !( ent->r.svFlags & SVF_BROADCAST ) &&
+			!SV_EntityVisibleFromCluster( svEnt, clientarea, clientpvs ) ) {
+			continue;
+		}
+
+		cache->entities[ cache->numEntities++ ] = e;
+	}
+
+	return cache;
 }
 
 /*
@@ -293,12 +842,10 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 									snapshotEntityNumbers_t *eNums, qboolean portal ) {
 	int		e, i;
 	sharedEntity_t *ent;
-	svEntity_t	*svEnt;
-	int		l;
 	int		clientarea, clientcluster;
 	int		leafnum;
 	byte	*clientpvs;
-	byte	*bitvector;
+	svVisCache_t	*visible;
 
 	// during an error shutdown message we may need to transmit
 	// the shutdown message after the server has shutdown, so
@@ -316,23 +863,11 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 
 	clientpvs = CM_ClusterPVS (clientcluster);
 
-	for ( e = 0 ; e < sv.num_entities ; e++ ) {
-		ent = SV_GentityNum(e);
-
-		// never send entities that aren't linked in
-		if ( !ent->r.linked ) {
-			continue;
-		}
-
-		if (ent->s.number != e) {
-			Com_DPrintf ("FIXING ENT->S.NUMBER!!!\n");
-			ent->s.number = e;
-		}
+	visible = SV_ClusterVisibleEntities( clientcluster, clientarea, clientpvs );
 
-		// entities can be flagged to explicitly not be sent to the client
-		if ( ent->r.svFlags & SVF_NOCLIENT ) {
-			continue;
-		}
+	for ( i = 0 ; i < visible->numEntities ; i++ ) {
+		e = visible->entities[i];
+		ent = SV_GentityNum(e);
 
 		// entities can be flagged to be sent to only one client
 		if ( ent->r.svFlags & SVF_SINGLECLIENT ) {
@@ -354,62 +889,18 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 				continue;
 		}
 
-		svEnt = SV_SvEntityForGentity( ent );
-
 		// don't double add an entity through portals
-		if ( svEnt->snapshotCounter == sv.snapshotCounter ) {
+		if ( eNums->bits[e >> 3] & ( 1 << ( e & 7 ) ) ) {
 			continue;
 		}
 
-		// broadcast entities are always sent
-		if ( ent->r.svFlags & SVF_BROADCAST ) {
-			SV_AddEntToSnapshot( svEnt, ent, eNums );
-			continue;
-		}
-
-		// ignore if not touching a PV leaf
-		// check area
-		if ( !CM_AreasConnected( clientarea, svEnt->areanum ) ) {
-			// doors can legally straddle two areas, so
-			// we may need to check another one
-			if ( !CM_AreasConnected( clientarea, svEnt->areanum2 ) ) {
-				continue;		// blocked by a door
-			}
-		}
-
-		bitvector = clientpvs;
+		// add it
+		SV_AddEntToSnapshot( ent, eNums );
 
-		// check individual leafs
-		if ( !svEnt->numClusters ) {
+		// broadcast entities are never portals
+		if ( ent->r.svFlags & SVF_BROADCAST ) {
 			continue;
 		}
-		l = 0;
-		for ( i=0 ; i < svEnt->numClusters ; i++ ) {
-			l = svEnt->clusternums[i];
-			if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
-				break;
-			}
-		}
-
-		// if we haven't found it to be visible,
-		// check overflow clusters that coudln't be stored
-		if ( i == svEnt->numClusters ) {
-			if ( svEnt->lastCluster ) {
-				for ( ; l <= svEnt->lastCluster ; l++ ) {
-					if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
-						break;
-					}
-				}
-				if ( l == svEnt->lastCluster ) {
-					continue;	// not visible
-				}
-			} else {
-				continue;
-			}
-		}
-
-		// add it
-		SV_AddEntToSnapshot( svEnt, ent, eNums );
 
 		// if it's a portal entity, add everything visible from its camera position
 		if ( ent->r.svFlags & SVF_PORTAL ) {
@@ -421,8 +912,11 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 				}
 			}
 			SV_AddEntitiesVisibleFromPoint( ent->s.origin2, frame, eNums, qtrue );
-		}
 
+			// the portal view may have evicted our set, fetching it again
+			// rebuilds the same list so the index still holds
+			visible = SV_ClusterVisibleEntities( clientcluster, clientarea, clientpvs );
+		}
 	}
 }
 
@@ -441,24 +935,22 @@ For viewing through other player's eyes, clent can be something other than clien
 */
 static void SV_BuildClientSnapshot( client_t *client ) {
 	vec3_t						org;
-	clientSnapshot_t			*frame;
+	clientSnapshot_t			*frame, *oldframe;
 	snapshotEntityNumbers_t		entityNumbers;
-	int							i;
+	int							i, e, bits, oldindex, state, oldstate;
 	sharedEntity_t				*ent;
-	entityState_t				*state;
-	svEntity_t					*svEnt;
+	entityState_t				*oldent;
 	sharedEntity_t				*clent;
 	int							clientNum;
 	playerState_t				*ps;
 
-	// bump the counter used to prevent double adding
-	sv.snapshotCounter++;
-
 	// this is the frame we are creating
 	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
 
 	// clear everything in this snapshot
 	entityNumbers.numSnapshotEntities = 0;
+	entityNumbers.maxSnapshotEntities = sv_snapshotPriority->integer ? MAX_GENTITIES : MAX_SNAPSHOT_ENTITIES;
+	Com_Memset( entityNumbers.bits, 0, sizeof( entityNumbers.bits ) );
 	Com_Memset( frame->areabits, 0, sizeof( frame->areabits ) );
 
   // https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=62
@@ -479,9 +971,8 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 	if ( clientNum < 0 || clientNum >= MAX_GENTITIES ) {
 		Com_Error( ERR_DROP, "SV_SvEntityForGentity: bad gEnt" );
 	}
-	svEnt = &sv.svEntities[ clientNum ];
-
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	// marking it as already added keeps it out without counting it
+	entityNumbers.bits[clientNum >> 3] |= 1 << ( clientNum & 7 );
 
 	// find the client's viewpoint
 	VectorCopy( ps->origin, org );
@@ -491,12 +982,29 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 	// may include portal entities that merge other viewpoints
 	SV_AddEntitiesVisibleFromPoint( org, frame, &entityNumbers, qfalse );
 
-	// if there were portals visible, there may be out of order entities
-	// in the list which will need to be resorted for the delta compression
-	// to work correctly.  This also catches the error condition
-	// of an entity being included twice.
-	qsort( entityNumbers.snapshotEntities, entityNumbers.numSnapshotEntities, 
-		sizeof( entityNumbers.snapshotEntities[0] ), SV_QsortEntityNumbers );
+	entityNumbers.bits[clientNum >> 3] &= ~( 1 << ( clientNum & 7 ) );
+
+	// too many to send, drop the least important
+	if ( entityNumbers.numSnapshotEntities > MAX_SNAPSHOT_ENTITIES ) {
+		SV_TrimSnapshotEntities( &entityNumbers, org );
+	}
+
+	// a choked client gets far entities' changes on staggered snapshots
+	oldframe = NULL;
+	if ( sv_snapshotPriority->integer && client->rateDelayed ) {
+		oldframe = SV_DeltaFrame( client, qfalse );
+
+		// the states stored below must not overwrite the reused ones
+		if ( oldframe && ( oldframe->first_entity <= svs.nextSnapshotEntities
+			- svs.numSnapshotEntities + MAX_SNAPSHOT_ENTITIES
+			|| oldframe->oldestState <= svs.nextSnapshotStates
+			- svs.numSnapshotStates + MAX_SNAPSHOT_ENTITIES ) ) {
+			oldframe = NULL;
+		}
+	}
+	oldindex = 0;
+	oldstate = 0;
+	oldent = NULL;
 
 	// now that all viewpoint's areabits have been OR'd together, invert
 	// all of them to make it a mask vector, which is what the renderer wants
@@ -504,13 +1012,42 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 		((int *)frame->areabits)[i] = ((int *)frame->areabits)[i] ^ -1;
 	}
 
-	// copy the entity states out
+	// reference the entity states, the set yields them in the
+	// ascending order the delta compression needs
 	frame->num_entities = 0;
 	frame->first_entity = svs.nextSnapshotEntities;
-	for ( i = 0 ; i < entityNumbers.numSnapshotEntities ; i++ ) {
-		ent = SV_GentityNum(entityNumbers.snapshotEntities[i]);
-		state = &svs.snapshotEntities[svs.nextSnapshotEntities % svs.numSnapshotEntities];
-		*state = ent->s;
+	frame->oldestState = svs.nextSnapshotStates;
+	for ( e = 0 ; e < sv.num_entities ; e++ ) {
+		bits = entityNumbers.bits[e >> 3];
+		if ( !bits ) {
+			e |= 7;
+			continue;
+		}
+		if ( !( bits & ( 1 << ( e & 7 ) ) ) ) {
+			continue;
+		}
+		ent = SV_GentityNum(e);
+
+		if ( oldframe ) {
+			for ( ; oldindex < oldframe->num_entities ; oldindex++ ) {
+				oldstate = svs.snapshotEntities[(oldframe->first_entity + oldindex) % svs.numSnapshotEntities];
+				oldent = &svs.snapshotStates[oldstate % svs.numSnapshotStates];
+				if ( oldent->number >= e ) {
+					break;
+				}
+			}
+		}
+
+		if ( oldframe && oldindex < oldframe->num_entities && oldent->number == e
+			&& SV_DeferEntity( ent, oldent, org, client->netchan.outgoingSequence ) ) {
+			state = oldstate;
+		} else {
+			state = SV_SnapshotState( e );
+		}
+		if ( state < frame->oldestState ) {
+			frame->oldestState = state;
+		}
+		svs.snapshotEntities[svs.nextSnapshotEntities % svs.numSnapshotEntities] = state;
 		svs.nextSnapshotEntities++;
 		// this should never hit, map should always be restarted first in SV_Frame
 		if ( svs.nextSnapshotEntities >= 0x7FFFFFFE ) {
@@ -518,6 +1055,8 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 		}
 		frame->num_entities++;
 	}
+
+	SV_DemoClientSnapshot( client, frame, entityNumbers.bits );
 }
 
 #ifdef USE_VOIP
@@ -532,6 +1071,7 @@ static void SV_WriteVoipToClient(client_t *cl, msg_t *msg)
 {
 	int totalbytes = 0;
 	int i;
+	voipQueuedPacket_t *queued;
 	voipServerPacket_t *packet;
 
 	if(cl->queuedVoipPackets)
@@ -539,7 +1079,8 @@ static void SV_WriteVoipToClient(client_t *cl, msg_t *msg)
 		// Write as many VoIP packets as we reasonably can...
 		for(i = 0; i < cl->queuedVoipPackets; i++)
 		{
-			packet = cl->voipPacket[(i + cl->queuedVoipIndex) % ARRAY_LEN(cl->voipPacket)];
+			queued = &cl->voipPacket[(i + cl->queuedVoipIndex) % ARRAY_LEN(cl->voipPacket)];
+			packet = queued->packet;
 
 			if(!*cl->downloadName)
 			{
@@ -553,11 +1094,11 @@ static void SV_WriteVoipToClient(client_t *cl, msg_t *msg)
 		        	MSG_WriteLong(msg, packet->sequence);
 		        	MSG_WriteByte(msg, packet->frames);
         			MSG_WriteShort(msg, packet->len);
-        			MSG_WriteBits(msg, packet->flags, VOIP_FLAGCNT);
+        			MSG_WriteBits(msg, queued->flags, VOIP_FLAGCNT);
 	        		MSG_WriteData(msg, packet->data, packet->len);
                         }
 
-			Z_Free(packet);
+			SV_ReleaseVoipPacket(packet);
 		}
 
 		cl->queuedVoipPackets -= i;
@@ -576,6 +1117,9 @@ Called by SV_SendClientSnapshot and SV_SendClientGameState
 */
 void SV_SendMessageToClient(msg_t *msg, client_t *client)
 {
+	client->metrics.packetsSent++;
+	client->metrics.bytesSent += msg->cursize;
+
 	// record information about the message
 	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSize = msg->cursize;
 	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSent = svs.time;
@@ -597,9 +1141,14 @@ Also called by SV_FinalMessage
 void SV_SendClientSnapshot( client_t *client ) {
 	byte		msg_buf[MAX_MSGLEN];
 	msg_t		msg;
+	int64_t		start, built;
 
 	// build the snapshot
+	start = Sys_Microseconds();
 	SV_BuildClientSnapshot( client );
+	built = Sys_Microseconds();
+	svs.metrics.snapshotBuildUsec += built - start;
+	svs.metrics.snapshots++;
 
 	// bots need to have their snapshots build, but
 	// the query them directly without needing to be sent
@@ -632,6 +1181,7 @@ void SV_SendClientSnapshot( client_t *client ) {
 	}
 
 	SV_SendMessageToClient( &msg, client );
+	svs.metrics.snapshotSendUsec += Sys_Microseconds() - built;
 }
 
 
@@ -645,6 +1195,17 @@ void SV_SendClientMessages(void)
 	int		i;
 	client_t	*c;
 
+	// entities can't move until the loop is done, so clients can share
+	// visible entity sets and entity deltas
+	if ( ++sv_sendFrame == 0 ) {
+		Com_Memset( sv_visCache, 0, sizeof( sv_visCache ) );
+		Com_Memset( sv_deltaCache, 0, sizeof( sv_deltaCache ) );
+		Com_Memset( sv_stateFrame, 0, sizeof( sv_stateFrame ) );
+		sv_sendFrame = 1;
+	}
+	sv_sendFrameActive = qtrue;
+	PROFILE_BEGIN( "SV_SendClientMessages" );
+
 	// send a message to each connected client
 	for(i=0; i < sv_maxclients->integer; i++)
 	{
@@ -662,6 +1223,7 @@ void SV_SendClientMessages(void)
 		if(c->netchan.unsentFragments || c->netchan_start_queue)
 		{
 			c->rateDelayed = qtrue;
+			c->metrics.choked++;
 			continue;		// Drop this snapshot if the packet queue is still full or delta compression will break
 		}
 
@@ -673,6 +1235,7 @@ void SV_SendClientMessages(void)
 			{
 				// Not enough time since last packet passed through the line
 				c->rateDelayed = qtrue;
+				c->metrics.choked++;
 				continue;
 			}
 		}
@@ -682,4 +1245,9 @@ void SV_SendClientMessages(void)
 		c->lastSnapshotTime = svs.time;
 		c->rateDelayed = qfalse;
 	}
+
+	SV_DemoFrame();
+
+	PROFILE_END();
+	sv_sendFrameActive = qfalse;
 }
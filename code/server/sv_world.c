@@ -54,26 +54,44 @@ clipHandle_t SV_ClipHandleForEntity( const sharedEntity_t *ent ) {
 ENTITY CHECKING
 
 To avoid linearly searching through lists of entities during environment testing,
-the world is carved up with an evenly spaced, axially aligned bsp tree.  Entities
-are kept in chains either at the final leafs, or at the first node that splits
-them, which prevents having to deal with multiple fragments of a single entity.
+the world is carved up into a stack of loose grids in x and y, sized from the
+world bounds.  Each level has cells four times as wide as the one below it and
+the top level is a single cell covering everything.  An entity is chained in the
+cell holding the center of its box, on the finest level whose cells are at least
+as wide as the box, so a box never reaches more than half a cell past its own
+cell.  Queries only have to look at the cells around their bounds on each level,
+which keeps the cost tied to how crowded that part of the map is instead of to
+the number of entities in the world.
 
 ===============================================================================
 */
 
+static void SV_TriggersChanged( void );
+
 typedef struct worldSector_s {
-	int		axis;		// -1 = leaf node
-	float	dist;
-	struct worldSector_s	*children[2];
 	svEntity_t	*entities;
 } worldSector_t;
 
-#define	AREA_DEPTH	4
-#define	AREA_NODES	64
+#define	SECTOR_MIN_SIZE		256		// narrowest cell on the finest level
+#define	SECTOR_MAX_CELLS	64		// cells across the finest level
+#define	SECTOR_SCALE		4		// cell width growth from one level to the next
+#define	SECTOR_MAX_LEVELS	5
+
+#define	AREA_NODES	( 64*64 + 16*16 + 4*4 + 1 )
+
+typedef struct {
+	float			cellSize;
+	int				cells[2];		// cells across x and y
+	worldSector_t	*sectors;		// cells[0] * cells[1], row major on y
+} sectorLevel_t;
 
 worldSector_t	sv_worldSectors[AREA_NODES];
 int			sv_numworldSectors;
 
+static sectorLevel_t	sv_sectorLevels[SECTOR_MAX_LEVELS];
+static int				sv_numSectorLevels;
+static vec3_t			sv_sectorOrigin;
+
 
 /*
 ===============
@@ -81,61 +99,77 @@ SV_SectorList_f
 ===============
 */
 void SV_SectorList_f( void ) {
-	int				i, c;
-	worldSector_t	*sec;
+	int				i, l, c, total;
+	sectorLevel_t	*lev;
 	svEntity_t		*ent;
 
-	for ( i = 0 ; i < AREA_NODES ; i++ ) {
-		sec = &sv_worldSectors[i];
+	for ( l = 0 ; l < sv_numSectorLevels ; l++ ) {
+		lev = &sv_sectorLevels[l];
 
-		c = 0;
-		for ( ent = sec->entities ; ent ; ent = ent->nextEntityInWorldSector ) {
-			c++;
+		total = 0;
+		for ( i = 0 ; i < lev->cells[0] * lev->cells[1] ; i++ ) {
+			c = 0;
+			for ( ent = lev->sectors[i].entities ; ent ; ent = ent->nextEntityInWorldSector ) {
+				c++;
+			}
+			if ( c ) {
+				Com_Printf( "level %i sector %i,%i: %i entities\n", l,
+					i % lev->cells[0], i / lev->cells[0], c );
+			}
+			total += c;
 		}
-		Com_Printf( "sector %i: %i entities\n", i, c );
+		Com_Printf( "level %i: %ix%i cells of %.0f units, %i entities\n", l,
+			lev->cells[0], lev->cells[1], lev->cellSize, total );
 	}
 }
 
 /*
 ===============
-SV_CreateworldSector
+SV_SectorCell
 
-Builds a uniformly subdivided tree for the given world size
+Cell on the given level holding the coordinate, clamped to the grid
 ===============
 */
-static worldSector_t *SV_CreateworldSector( int depth, vec3_t mins, vec3_t maxs ) {
-	worldSector_t	*anode;
-	vec3_t		size;
-	vec3_t		mins1, maxs1, mins2, maxs2;
+static int SV_SectorCell( const sectorLevel_t *lev, int axis, float v ) {
+	v = ( v - sv_sectorOrigin[axis] ) / lev->cellSize;
+	if ( v <= 0 ) {
+		return 0;
+	}
+	if ( v >= lev->cells[axis] - 1 ) {
+		return lev->cells[axis] - 1;
+	}
+	return (int)v;
+}
 
-	anode = &sv_worldSectors[sv_numworldSectors];
-	sv_numworldSectors++;
+/*
+===============
+SV_SectorForBounds
 
-	if (depth == AREA_DEPTH) {
-		anode->axis = -1;
-		anode->children[0] = anode->children[1] = NULL;
-		return anode;
+Picks the cell an entity with the given absolute bounds is chained in
+===============
+*/
+static worldSector_t *SV_SectorForBounds( const vec3_t absmin, const vec3_t absmax ) {
+	sectorLevel_t	*lev;
+	float		size;
+	int			l, x, y;
+
+	size = absmax[0] - absmin[0];
+	if ( absmax[1] - absmin[1] > size ) {
+		size = absmax[1] - absmin[1];
 	}
-	
-	VectorSubtract (maxs, mins, size);
-	if (size[0] > size[1]) {
-		anode->axis = 0;
-	} else {
-		anode->axis = 1;
+
+	// the top level takes everything that is too big for the others
+	for ( l = 0 ; l < sv_numSectorLevels - 1 ; l++ ) {
+		if ( size <= sv_sectorLevels[l].cellSize ) {
+			break;
+		}
 	}
+	lev = &sv_sectorLevels[l];
 
-	anode->dist = 0.5 * (maxs[anode->axis] + mins[anode->axis]);
-	VectorCopy (mins, mins1);	
-	VectorCopy (mins, mins2);	
-	VectorCopy (maxs, maxs1);	
-	VectorCopy (maxs, maxs2);	
-	
-	maxs1[anode->axis] = mins2[anode->axis] = anode->dist;
-	
-	anode->children[0] = SV_CreateworldSector (depth+1, mins2, maxs2);
-	anode->children[1] = SV_CreateworldSector (depth+1, mins1, maxs1);
+	x = SV_SectorCell( lev, 0, 0.5f * ( absmin[0] + absmax[0] ) );
+	y = SV_SectorCell( lev, 1, 0.5f * ( absmin[1] + absmax[1] ) );
 
-	return anode;
+	return &lev->sectors[y * lev->cells[0] + x];
 }
 
 /*
@@ -147,14 +181,58 @@ SV_ClearWorld
 void SV_ClearWorld( void ) {
 	clipHandle_t	h;
 	vec3_t			mins, maxs;
+	sectorLevel_t	*lev;
+	float			size, cellSize;
+	int				i;
 
 	Com_Memset( sv_worldSectors, 0, sizeof(sv_worldSectors) );
 	sv_numworldSectors = 0;
 
+	SV_InvalidateTraceCache();
+	SV_ClearEntityHistory();
+	SV_StopRecordingTraces();
+	SV_TriggersChanged();
+
 	// get world map bounds
 	h = CM_InlineModel( 0 );
 	CM_ModelBounds( h, mins, maxs );
-	SV_CreateworldSector( 0, mins, maxs );
+	VectorCopy( mins, sv_sectorOrigin );
+
+	size = maxs[0] - mins[0];
+	if ( maxs[1] - mins[1] > size ) {
+		size = maxs[1] - mins[1];
+	}
+
+	cellSize = size / SECTOR_MAX_CELLS;
+	if ( cellSize < SECTOR_MIN_SIZE ) {
+		cellSize = SECTOR_MIN_SIZE;
+	}
+
+	for ( sv_numSectorLevels = 0 ; sv_numSectorLevels < SECTOR_MAX_LEVELS ; sv_numSectorLevels++ ) {
+		lev = &sv_sectorLevels[sv_numSectorLevels];
+
+		lev->cellSize = cellSize;
+		for ( i = 0 ; i < 2 ; i++ ) {
+			lev->cells[i] = (int)ceil( ( maxs[i] - mins[i] ) / cellSize );
+			if ( lev->cells[i] < 1 ) {
+				lev->cells[i] = 1;
+			} else if ( lev->cells[i] > SECTOR_MAX_CELLS ) {
+				lev->cells[i] = SECTOR_MAX_CELLS;
+			}
+		}
+
+		lev->sectors = &sv_worldSectors[sv_numworldSectors];
+		sv_numworldSectors += lev->cells[0] * lev->cells[1];
+
+		if ( ( lev->cells[0] == 1 && lev->cells[1] == 1 ) || sv_numSectorLevels == SECTOR_MAX_LEVELS - 1 ) {
+			// a single cell, or the last level we have room for, which
+			// the oversized entities still end up on
+			sv_numSectorLevels++;
+			break;
+		}
+
+		cellSize *= SECTOR_SCALE;
+	}
 }
 
 
@@ -173,6 +251,13 @@ void SV_UnlinkEntity( sharedEntity_t *gEnt ) {
 
 	gEnt->r.linked = qfalse;
 
+	SV_InvalidateTraceCache();
+
+	if ( ent->linkedTrigger ) {
+		ent->linkedTrigger = qfalse;
+		SV_TriggersChanged();
+	}
+
 	ws = ent->worldSector;
 	if ( !ws ) {
 		return;		// not linked in anywhere
@@ -215,9 +300,7 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 
 	ent = SV_SvEntityForGentity( gEnt );
 
-	if ( ent->worldSector ) {
-		SV_UnlinkEntity( gEnt );	// unlink from old position
-	}
+	SV_InvalidateTraceCache();
 
 	// encode the size into the entityState_t for client prediction
 	if ( gEnt->r.bmodel ) {
@@ -291,6 +374,9 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 	// if none of the leafs were inside the map, the
 	// entity is outside the world and can be considered unlinked
 	if ( !num_leafs ) {
+		if ( ent->worldSector ) {
+			SV_UnlinkEntity( gEnt );	// unlink from old position
+		}
 		return;
 	}
 
@@ -332,24 +418,23 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 
 	gEnt->r.linkcount++;
 
-	// find the first world sector node that the ent's box crosses
-	node = sv_worldSectors;
-	while (1)
-	{
-		if (node->axis == -1)
-			break;
-		if ( gEnt->r.absmin[node->axis] > node->dist)
-			node = node->children[0];
-		else if ( gEnt->r.absmax[node->axis] < node->dist)
-			node = node->children[1];
-		else
-			break;		// crosses the node
-	}
-	
-	// link it in
-	ent->worldSector = node;
-	ent->nextEntityInWorldSector = node->entities;
-	node->entities = ent;
+	// most relinks leave the entity in the cell it already is in
+	node = SV_SectorForBounds( gEnt->r.absmin, gEnt->r.absmax );
+	if ( ent->worldSector != node ) {
+		if ( ent->worldSector ) {
+			SV_UnlinkEntity( gEnt );	// unlink from old position
+		}
+
+		// link it in
+		ent->worldSector = node;
+		ent->nextEntityInWorldSector = node->entities;
+		node->entities = ent;
+	}
+
+	if ( ent->linkedTrigger || ( gEnt->r.contents & CONTENTS_TRIGGER ) ) {
+		ent->linkedTrigger = ( gEnt->r.contents & CONTENTS_TRIGGER ) != 0;
+		SV_TriggersChanged();
+	}
 
 	gEnt->r.linked = qtrue;
 }
@@ -374,11 +459,12 @@ typedef struct {
 
 /*
 ====================
-SV_AreaEntities_r
+SV_AreaEntitiesInSector
 
+Returns qfalse once the list is full
 ====================
 */
-static void SV_AreaEntities_r( worldSector_t *node, areaParms_t *ap ) {
+static qboolean SV_AreaEntitiesInSector( worldSector_t *node, areaParms_t *ap ) {
 	svEntity_t	*check, *next;
 	sharedEntity_t *gcheck;
 
@@ -398,24 +484,14 @@ static void SV_AreaEntities_r( worldSector_t *node, areaParms_t *ap ) {
 
 		if ( ap->count == ap->maxcount ) {
 			Com_Printf ("SV_AreaEntities: MAXCOUNT\n");
-			return;
+			return qfalse;
 		}
 
 		ap->list[ap->count] = check - sv.svEntities;
 		ap->count++;
 	}
-	
-	if (node->axis == -1) {
-		return;		// terminal node
-	}
 
-	// recurse down both sides
-	if ( ap->maxs[node->axis] > node->dist ) {
-		SV_AreaEntities_r ( node->children[0], ap );
-	}
-	if ( ap->mins[node->axis] < node->dist ) {
-		SV_AreaEntities_r ( node->children[1], ap );
-	}
+	return qtrue;
 }
 
 /*
@@ -425,6 +501,9 @@ SV_AreaEntities
 */
 int SV_AreaEntities( const vec3_t mins, const vec3_t maxs, int *entityList, int maxcount ) {
 	areaParms_t		ap;
+	sectorLevel_t	*lev;
+	float			loose;
+	int				l, x, y, x0, x1, y0, y1;
 
 	ap.mins = mins;
 	ap.maxs = maxs;
@@ -432,13 +511,110 @@ int SV_AreaEntities( const vec3_t mins, const vec3_t maxs, int *entityList, int
 	ap.count = 0;
 	ap.maxcount = maxcount;
 
-	SV_AreaEntities_r( sv_worldSectors, &ap );
+	for ( l = 0 ; l < sv_numSectorLevels ; l++ ) {
+		lev = &sv_sectorLevels[l];
+
+		// entities hang at most half a cell past the cell they are chained in
+		loose = 0.5f * lev->cellSize;
+		x0 = SV_SectorCell( lev, 0, mins[0] - loose );
+		x1 = SV_SectorCell( lev, 0, maxs[0] + loose );
+		y0 = SV_SectorCell( lev, 1, mins[1] - loose );
+		y1 = SV_SectorCell( lev, 1, maxs[1] + loose );
+
+		for ( y = y0 ; y <= y1 ; y++ ) {
+			for ( x = x0 ; x <= x1 ; x++ ) {
+				if ( !SV_AreaEntitiesInSector( &lev->sectors[y * lev->cells[0] + x], &ap ) ) {
+					return ap.count;
+				}
+			}
+		}
+	}
 
 	return ap.count;
 }
 
 
 
+/*
+===============================================================================
+
+TRACE CACHE
+
+With sv_traceCache set, SV_Trace and SV_PointContents remember their
+results until an entity is linked or unlinked or the next game frame
+starts, so the same question asked again by the bots or the game is
+answered without walking the BSP. Game code that changes r.contents or
+r.currentOrigin without relinking can see stale results, which is why
+it is off by default.
+
+===============================================================================
+*/
+
+#define	TRACE_CACHE_SIZE		1024		// must be a power of two
+
+typedef struct {
+	vec3_t		start, end;
+	vec3_t		mins, maxs;
+	int			passEntityNum;
+	int			contentmask;
+	int			capsule;
+} traceKey_t;
+
+typedef struct {
+	traceKey_t	key;
+	int			generation;
+	trace_t		trace;
+} traceCacheEntry_t;
+
+typedef struct {
+	vec3_t		point;
+	int			passEntityNum;
+} contentsKey_t;
+
+typedef struct {
+	contentsKey_t	key;
+	int			generation;
+	int			contents;
+} contentsCacheEntry_t;
+
+static traceCacheEntry_t	sv_traceCacheEntries[TRACE_CACHE_SIZE];
+static contentsCacheEntry_t	sv_contentsCacheEntries[TRACE_CACHE_SIZE];
+
+// entries from any other generation are stale, zero is never current
+static int		sv_traceCacheGeneration = 1;
+
+/*
+===============
+SV_InvalidateTraceCache
+===============
+*/
+void SV_InvalidateTraceCache( void ) {
+	if ( ++sv_traceCacheGeneration == 0 ) {
+		// wrapped, make sure nothing old can match again
+		Com_Memset( sv_traceCacheEntries, 0, sizeof( sv_traceCacheEntries ) );
+		Com_Memset( sv_contentsCacheEntries, 0, sizeof( sv_contentsCacheEntries ) );
+		sv_traceCacheGeneration = 1;
+	}
+}
+
+/*
+===============
+SV_TraceCacheHash
+===============
+*/
+static unsigned SV_TraceCacheHash( const void *key, int size ) {
+	const unsigned	*data = key;
+	unsigned		hash;
+	int				i;
+
+	hash = 2166136261u;
+	for ( i = 0 ; i < size / 4 ; i++ ) {
+		hash = ( hash ^ data[i] ) * 16777619u;
+	}
+
+	return ( hash ^ ( hash >> 16 ) ) & ( TRACE_CACHE_SIZE - 1 );
+}
+
 //===========================================================================
 
 
@@ -499,21 +675,56 @@ void SV_ClipToEntity( trace_t *trace, const vec3_t start, const vec3_t mins, con
 
 /*
 ====================
-SV_ClipMoveToEntities
+SV_ClipMoveToModel
 
+Clips the move against one entity's model at the given position and
+keeps the result if it is closer than what was hit so far
 ====================
 */
-static void SV_ClipMoveToEntities( moveclip_t *clip ) {
-	int			i, num;
-	int			touchlist[MAX_GENTITIES];
+static void SV_ClipMoveToModel( moveclip_t *clip, int entityNum, clipHandle_t clipHandle, const vec3_t origin, const vec3_t angles ) {
+	trace_t		trace;
+
+	CM_TransformedBoxTrace ( &trace, (float *)clip->start, (float *)clip->end,
+		(float *)clip->mins, (float *)clip->maxs, clipHandle,  clip->contentmask,
+		origin, angles, clip->capsule);
+
+	if ( trace.allsolid ) {
+		clip->trace.allsolid = qtrue;
+		trace.entityNum = entityNum;
+	} else if ( trace.startsolid ) {
+		clip->trace.startsolid = qtrue;
+		trace.entityNum = entityNum;
+	}
+
+	if ( trace.fraction < clip->trace.fraction ) {
+		qboolean	oldStart;
+
+		// make sure we keep a startsolid from a previous trace
+		oldStart = clip->trace.startsolid;
+
+		trace.entityNum = entityNum;
+		clip->trace = trace;
+		clip->trace.startsolid |= oldStart;
+	}
+}
+
+
+/*
+====================
+SV_ClipMoveToEntityList
+
+Clips the move against the given entities. When the list was gathered
+for a larger volume than this move, cull skips the ones outside of
+clip->boxmins / clip->boxmaxs the way SV_AreaEntities would have.
+====================
+*/
+static void SV_ClipMoveToEntityList( moveclip_t *clip, const int *touchlist, int num, qboolean cull ) {
+	int			i;
 	sharedEntity_t *touch;
 	int			passOwnerNum;
-	trace_t		trace;
 	clipHandle_t	clipHandle;
 	float		*origin, *angles;
 
-	num = SV_AreaEntities( clip->boxmins, clip->boxmaxs, touchlist, MAX_GENTITIES);
-
 	if ( clip->passEntityNum != ENTITYNUM_NONE ) {
 		passOwnerNum = ( SV_GentityNum( clip->passEntityNum ) )->r.ownerNum;
 		if ( passOwnerNum == ENTITYNUM_NONE ) {
@@ -529,6 +740,15 @@ static void SV_ClipMoveToEntities( moveclip_t *clip ) {
 		}
 		touch = SV_GentityNum( touchlist[i] );
 
+		if ( cull && ( touch->r.absmin[0] > clip->boxmaxs[0]
+			|| touch->r.absmin[1] > clip->boxmaxs[1]
+			|| touch->r.absmin[2] > clip->boxmaxs[2]
+			|| touch->r.absmax[0] < clip->boxmins[0]
+			|| touch->r.absmax[1] < clip->boxmins[1]
+			|| touch->r.absmax[2] < clip->boxmins[2] ) ) {
+			continue;
+		}
+
 		// see if we should ignore this entity
 		if ( clip->passEntityNum != ENTITYNUM_NONE ) {
 			if ( touchlist[i] == clip->passEntityNum ) {
@@ -559,32 +779,156 @@ static void SV_ClipMoveToEntities( moveclip_t *clip ) {
 			angles = vec3_origin;	// boxes don't rotate
 		}
 
-		CM_TransformedBoxTrace ( &trace, (float *)clip->start, (float *)clip->end,
-			(float *)clip->mins, (float *)clip->maxs, clipHandle,  clip->contentmask,
-			origin, angles, clip->capsule);
+		SV_ClipMoveToModel( clip, touch->s.number, clipHandle, origin, angles );
+	}
+}
+
+
+/*
+====================
+SV_ClipMoveToEntities
+
+====================
+*/
+static void SV_ClipMoveToEntities( moveclip_t *clip ) {
+	int			num;
+	int			touchlist[MAX_GENTITIES];
+
+	num = SV_AreaEntities( clip->boxmins, clip->boxmaxs, touchlist, MAX_GENTITIES);
+
+	SV_ClipMoveToEntityList( clip, touchlist, num, qfalse );
+}
 
-		if ( trace.allsolid ) {
-			clip->trace.allsolid = qtrue;
-			trace.entityNum = touch->s.number;
-		} else if ( trace.startsolid ) {
-			clip->trace.startsolid = qtrue;
-			trace.entityNum = touch->s.number;
-		}
 
-		if ( trace.fraction < clip->trace.fraction ) {
-			qboolean	oldStart;
+/*
+====================
+SV_SetupMoveClip
+
+Fills in everything but the trace, which the caller has already clipped
+to the world
+====================
+*/
+static void SV_SetupMoveClip( moveclip_t *clip, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule ) {
+	int			i;
 
-			// make sure we keep a startsolid from a previous trace
-			oldStart = clip->trace.startsolid;
+	clip->contentmask = contentmask;
+	clip->start = start;
+//	VectorCopy( clip->trace.endpos, clip->end );
+	VectorCopy( end, clip->end );
+	clip->mins = mins;
+	clip->maxs = maxs;
+	clip->passEntityNum = passEntityNum;
+	clip->capsule = capsule;
 
-			trace.entityNum = touch->s.number;
-			clip->trace = trace;
-			clip->trace.startsolid |= oldStart;
+	// create the bounding box of the entire move
+	// we can limit it to the part of the move not
+	// already clipped off by the world, which can be
+	// a significant savings for line of sight and shot traces
+	for ( i=0 ; i<3 ; i++ ) {
+		if ( end[i] > start[i] ) {
+			clip->boxmins[i] = clip->start[i] + clip->mins[i] - 1;
+			clip->boxmaxs[i] = clip->end[i] + clip->maxs[i] + 1;
+		} else {
+			clip->boxmins[i] = clip->end[i] + clip->mins[i] - 1;
+			clip->boxmaxs[i] = clip->start[i] + clip->maxs[i] + 1;
 		}
 	}
 }
 
 
+/*
+===============================================================================
+
+TRACE RECORDING
+
+===============================================================================
+*/
+
+static fileHandle_t	sv_traceLog;
+static int			sv_traceLogCount;
+
+/*
+==================
+SV_StopRecordingTraces
+==================
+*/
+void SV_StopRecordingTraces( void ) {
+	if ( !sv_traceLog ) {
+		return;
+	}
+
+	FS_FCloseFile( sv_traceLog );
+	sv_traceLog = 0;
+	Com_Printf( "Recorded %i world traces\n", sv_traceLogCount );
+}
+
+/*
+==================
+SV_RecordTraces_f
+
+recordtraces <file> writes every world trace and point contents query
+the game makes until recordtraces is given without a file or the map
+changes, for cmbench to replay
+==================
+*/
+void SV_RecordTraces_f( void ) {
+	cmTraceLogHeader_t	header;
+	char				filename[MAX_QPATH];
+
+	SV_StopRecordingTraces();
+
+	if ( Cmd_Argc() < 2 ) {
+		return;
+	}
+
+	if ( !com_sv_running->integer ) {
+		Com_Printf( "Server is not running.\n" );
+		return;
+	}
+
+	Q_strncpyz( filename, Cmd_Argv( 1 ), sizeof( filename ) );
+	COM_DefaultExtension( filename, sizeof( filename ), ".traces" );
+	if ( !COM_CompareExtension( filename, ".traces" ) ) {
+		Com_Printf( "recordtraces: %s isn't a .traces file\n", filename );
+		return;
+	}
+
+	sv_traceLog = FS_FOpenFileWrite_HomeData( filename );
+	if ( !sv_traceLog ) {
+		Com_Printf( "Couldn't write %s\n", filename );
+		return;
+	}
+
+	Com_Memset( &header, 0, sizeof( header ) );
+	header.ident = CM_TRACELOG_IDENT;
+	header.version = CM_TRACELOG_VERSION;
+	Com_sprintf( header.map, sizeof( header.map ), "maps/%s.bsp", sv_mapname->string );
+	header.checksum = sv_mapChecksum->integer;
+	FS_Write( &header, sizeof( header ), sv_traceLog );
+
+	sv_traceLogCount = 0;
+	Com_Printf( "Recording world traces to %s\n", filename );
+}
+
+/*
+==================
+SV_RecordTrace
+==================
+*/
+static void SV_RecordTrace( cmTraceType_t type, const vec3_t start, const vec3_t end, const vec3_t mins, const vec3_t maxs, int contentmask, int capsule ) {
+	cmTraceRecord_t	rec;
+
+	rec.type = type;
+	rec.contentmask = contentmask;
+	rec.capsule = capsule;
+	VectorCopy( start, rec.start );
+	VectorCopy( end, rec.end );
+	VectorCopy( mins, rec.mins );
+	VectorCopy( maxs, rec.maxs );
+	FS_Write( &rec, sizeof( rec ), sv_traceLog );
+	sv_traceLogCount++;
+}
+
 /*
 ==================
 SV_Trace
@@ -595,7 +939,8 @@ passEntityNum and entities owned by passEntityNum are explicitly not checked.
 */
 void SV_Trace( trace_t *results, const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule ) {
 	moveclip_t	clip;
-	int			i;
+	traceKey_t	key;
+	traceCacheEntry_t	*entry;
 
 	if ( !mins ) {
 		mins = vec3_origin;
@@ -604,6 +949,427 @@ void SV_Trace( trace_t *results, const vec3_t start, vec3_t mins, vec3_t maxs, c
 		maxs = vec3_origin;
 	}
 
+	if ( sv_traceLog ) {
+		SV_RecordTrace( CMT_TRACE, start, end, mins, maxs, contentmask, capsule );
+	}
+
+	entry = NULL;
+	if ( sv_traceCache->integer ) {
+		VectorCopy( start, key.start );
+		VectorCopy( end, key.end );
+		VectorCopy( mins, key.mins );
+		VectorCopy( maxs, key.maxs );
+		key.passEntityNum = passEntityNum;
+		key.contentmask = contentmask;
+		key.capsule = capsule;
+
+		entry = &sv_traceCacheEntries[SV_TraceCacheHash( &key, sizeof( key ) )];
+		if ( entry->generation == sv_traceCacheGeneration && !memcmp( &entry->key, &key, sizeof( key ) ) ) {
+			*results = entry->trace;
+			return;
+		}
+	}
+
+	Com_Memset ( &clip, 0, sizeof ( moveclip_t ) );
+
+	// clip to world
+	CM_BoxTrace( &clip.trace, start, end, mins, maxs, 0, contentmask, capsule );
+	clip.trace.entityNum = clip.trace.fraction != 1.0 ? ENTITYNUM_WORLD : ENTITYNUM_NONE;
+	if ( clip.trace.fraction != 0 ) {
+		SV_SetupMoveClip( &clip, start, mins, maxs, end, passEntityNum, contentmask, capsule );
+
+		// clip to other solid entities
+		SV_ClipMoveToEntities ( &clip );
+	}
+
+	*results = clip.trace;
+
+	if ( entry ) {
+		entry->key = key;
+		entry->generation = sv_traceCacheGeneration;
+		entry->trace = clip.trace;
+	}
+}
+
+
+/*
+==================
+SV_TraceMany
+
+Runs count independent traces, giving the same results as calling
+SV_Trace for each. The entities near the moves are gathered once for
+the whole batch instead of once per trace.
+==================
+*/
+void SV_TraceMany( trace_t *results, const traceRequest_t *requests, int count, int capsule ) {
+	moveclip_t	clip;
+	const traceRequest_t	*req;
+	int			touchlist[MAX_GENTITIES];
+	vec3_t		mins, maxs;
+	int			i, num;
+
+	// clip to world
+	ClearBounds( mins, maxs );
+	for ( i = 0, req = requests ; i < count ; i++, req++ ) {
+		if ( sv_traceLog ) {
+			SV_RecordTrace( CMT_TRACE, req->start, req->end, req->mins, req->maxs, req->contentmask, capsule );
+		}
+		CM_BoxTrace( &results[i], req->start, req->end, (float *)req->mins, (float *)req->maxs, 0, req->contentmask, capsule );
+		results[i].entityNum = results[i].fraction != 1.0 ? ENTITYNUM_WORLD : ENTITYNUM_NONE;
+		if ( results[i].fraction == 0 ) {
+			continue;	// blocked immediately by the world
+		}
+
+		SV_SetupMoveClip( &clip, req->start, req->mins, req->maxs, req->end, req->passEntityNum, req->contentmask, capsule );
+		AddPointToBounds( clip.boxmins, mins, maxs );
+		AddPointToBounds( clip.boxmaxs, mins, maxs );
+	}
+
+	if ( mins[0] > maxs[0] ) {
+		return;		// every move was blocked by the world
+	}
+
+	num = SV_AreaEntities( mins, maxs, touchlist, MAX_GENTITIES );
+
+	// clip to other solid entities
+	for ( i = 0, req = requests ; i < count ; i++, req++ ) {
+		if ( results[i].fraction == 0 ) {
+			continue;
+		}
+
+		clip.trace = results[i];
+		SV_SetupMoveClip( &clip, req->start, req->mins, req->maxs, req->end, req->passEntityNum, req->contentmask, capsule );
+
+		if ( num == MAX_GENTITIES ) {
+			// the shared list may have been cut short
+			SV_ClipMoveToEntities( &clip );
+		} else {
+			SV_ClipMoveToEntityList( &clip, touchlist, num, qtrue );
+		}
+
+		results[i] = clip.trace;
+	}
+}
+
+
+
+/*
+===============================================================================
+
+TRIGGER QUERIES
+
+Every client looks for the triggers around it each frame.  The triggers
+found in a box somewhat larger than the one asked for are kept per
+client, and later queries are answered from that list for as long as
+the box stays inside it and no trigger has been linked or unlinked
+anywhere.  Game code must relink an entity after giving it
+CONTENTS_TRIGGER for it to be found.
+
+===============================================================================
+*/
+
+#define	TRIGGER_CACHE_MARGIN	64
+#define	MAX_TRIGGER_CACHE		64
+
+typedef struct {
+	int			generation;		// zero is never current
+	vec3_t		mins, maxs;
+	int			numTriggers;
+	int			triggers[MAX_TRIGGER_CACHE];
+} triggerCache_t;
+
+static triggerCache_t	sv_triggerCaches[MAX_CLIENTS];
+static int				sv_triggerGeneration = 1;
+
+/*
+===============
+SV_TriggersChanged
+===============
+*/
+static void SV_TriggersChanged( void ) {
+	if ( ++sv_triggerGeneration == 0 ) {
+		// wrapped, make sure nothing old can match again
+		Com_Memset( sv_triggerCaches, 0, sizeof( sv_triggerCaches ) );
+		sv_triggerGeneration = 1;
+	}
+}
+
+/*
+===============
+SV_AreaTriggers
+
+SV_AreaEntities for the entities with CONTENTS_TRIGGER
+===============
+*/
+static int SV_AreaTriggers( const vec3_t mins, const vec3_t maxs, int *list, int maxcount ) {
+	int			touch[MAX_GENTITIES];
+	int			i, num, count;
+
+	num = SV_AreaEntities( mins, maxs, touch, MAX_GENTITIES );
+
+	count = 0;
+	for ( i = 0 ; i < num && count < maxcount ; i++ ) {
+		if ( SV_GentityNum( touch[i] )->r.contents & CONTENTS_TRIGGER ) {
+			list[count++] = touch[i];
+		}
+	}
+
+	return count;
+}
+
+/*
+===============
+SV_TriggersInBox
+
+Returns the triggers whose absmin / absmax intersects the given bounds,
+using the cached list for entityNum when it is a client
+===============
+*/
+int SV_TriggersInBox( int entityNum, const vec3_t mins, const vec3_t maxs, int *list, int maxcount ) {
+	triggerCache_t	*cache;
+	sharedEntity_t	*check;
+	int				i, count;
+
+	if ( entityNum < 0 || entityNum >= MAX_CLIENTS ) {
+		return SV_AreaTriggers( mins, maxs, list, maxcount );
+	}
+
+	cache = &sv_triggerCaches[entityNum];
+	if ( cache->generation != sv_triggerGeneration
+		|| mins[0] < cache->mins[0] || mins[1] < cache->mins[1] || mins[2] < cache->mins[2]
+		|| maxs[0] > cache->maxs[0] || maxs[1] > cache->maxs[1] || maxs[2] > cache->maxs[2] ) {
+		for ( i = 0 ; i < 3 ; i++ ) {
+			cache->mins[i] = mins[i] - TRIGGER_CACHE_MARGIN;
+			cache->maxs[i] = maxs[i] + TRIGGER_CACHE_MARGIN;
+		}
+
+		cache->numTriggers = SV_AreaTriggers( cache->mins, cache->maxs, cache->triggers, MAX_TRIGGER_CACHE );
+		if ( cache->numTriggers == MAX_TRIGGER_CACHE ) {
+			// may have been cut short
+			cache->generation = 0;
+			return SV_AreaTriggers( mins, maxs, list, maxcount );
+		}
+		cache->generation = sv_triggerGeneration;
+	}
+
+	count = 0;
+	for ( i = 0 ; i < cache->numTriggers && count < maxcount ; i++ ) {
+		check = SV_GentityNum( cache->triggers[i] );
+		if ( check->r.absmin[0] > maxs[0]
+			|| check->r.absmin[1] > maxs[1]
+			|| check->r.absmin[2] > maxs[2]
+			|| check->r.absmax[0] < mins[0]
+			|| check->r.absmax[1] < mins[1]
+			|| check->r.absmax[2] < mins[2] ) {
+			continue;
+		}
+		list[count++] = cache->triggers[i];
+	}
+
+	return count;
+}
+
+
+/*
+===============================================================================
+
+ENTITY HISTORY
+
+At the end of every server frame the position and bounds of each linked
+entity with CONTENTS_BODY are saved in a ring buffer.  SV_TraceAtTime
+clips against those entities where they were at an earlier time, so the
+game can compensate hitscan weapons for the shooter's latency without
+moving and relinking anyone.  Only the rewound entities whose bounds
+touch the move are clipped against.
+
+===============================================================================
+*/
+
+#define	ENTITY_HISTORY_FRAMES		32		// must be a power of two
+#define	MAX_HISTORY_ENTITIES		128
+
+typedef struct {
+	int			number;
+	int			contents;
+	qboolean	capsule;
+	vec3_t		origin;
+	vec3_t		mins, maxs;
+	vec3_t		absmin, absmax;
+} historyEntity_t;
+
+typedef struct {
+	int				time;
+	int				numEntities;
+	historyEntity_t	entities[MAX_HISTORY_ENTITIES];	// sorted by number
+} historyFrame_t;
+
+static historyFrame_t	sv_entityHistory[ENTITY_HISTORY_FRAMES];
+static int				sv_entityHistoryHead;		// next frame to write
+static int				sv_entityHistoryFrames;		// valid frames
+
+/*
+===============
+SV_ClearEntityHistory
+===============
+*/
+void SV_ClearEntityHistory( void ) {
+	sv_entityHistoryHead = 0;
+	sv_entityHistoryFrames = 0;
+}
+
+/*
+===============
+SV_RecordEntityHistory
+
+Called after each game frame
+===============
+*/
+void SV_RecordEntityHistory( void ) {
+	historyFrame_t	*frame;
+	historyEntity_t	*hent;
+	sharedEntity_t	*ent;
+	int				i;
+
+	frame = &sv_entityHistory[sv_entityHistoryHead];
+	sv_entityHistoryHead = ( sv_entityHistoryHead + 1 ) & ( ENTITY_HISTORY_FRAMES - 1 );
+	if ( sv_entityHistoryFrames < ENTITY_HISTORY_FRAMES ) {
+		sv_entityHistoryFrames++;
+	}
+
+	frame->time = sv.time;
+	frame->numEntities = 0;
+	for ( i = 0 ; i < sv.num_entities ; i++ ) {
+		ent = SV_GentityNum( i );
+		if ( !ent->r.linked || ent->r.bmodel || !( ent->r.contents & CONTENTS_BODY ) ) {
+			continue;
+		}
+		if ( frame->numEntities == MAX_HISTORY_ENTITIES ) {
+			break;
+		}
+
+		hent = &frame->entities[frame->numEntities++];
+		hent->number = i;
+		hent->contents = ent->r.contents;
+		hent->capsule = ( ent->r.svFlags & SVF_CAPSULE ) != 0;
+		VectorCopy( ent->r.currentOrigin, hent->origin );
+		VectorCopy( ent->r.mins, hent->mins );
+		VectorCopy( ent->r.maxs, hent->maxs );
+		VectorCopy( ent->r.absmin, hent->absmin );
+		VectorCopy( ent->r.absmax, hent->absmax );
+	}
+}
+
+/*
+===============
+SV_HistoryFrame
+
+Returns the frame age frames before the newest one
+===============
+*/
+static historyFrame_t *SV_HistoryFrame( int age ) {
+	return &sv_entityHistory[( sv_entityHistoryHead - 1 - age ) & ( ENTITY_HISTORY_FRAMES - 1 )];
+}
+
+/*
+===============
+SV_RewindEntities
+
+Fills in where the recorded entities were at the given time,
+interpolating between the frames around it.  Returns qfalse if time is
+not in the past of the newest frame.
+===============
+*/
+static qboolean SV_RewindEntities( int time, historyEntity_t *list, int *count ) {
+	historyFrame_t	*from, *to;
+	historyEntity_t	*a, *b, *out;
+	float			frac;
+	int				age, i, j, k;
+
+	if ( !sv_entityHistoryFrames || time >= SV_HistoryFrame( 0 )->time ) {
+		return qfalse;
+	}
+
+	// find the newest frame at or before time
+	to = SV_HistoryFrame( 0 );
+	from = to;
+	for ( age = 1 ; age < sv_entityHistoryFrames ; age++ ) {
+		from = SV_HistoryFrame( age );
+		if ( from->time <= time ) {
+			break;
+		}
+		to = from;
+	}
+
+	if ( from->time >= time || from == to ) {
+		// exactly on a frame, or older than anything we have left
+		Com_Memcpy( list, from->entities, from->numEntities * sizeof( *list ) );
+		*count = from->numEntities;
+		return qtrue;
+	}
+
+	frac = (float)( time - from->time ) / (float)( to->time - from->time );
+
+	// both lists are sorted, an entity that is missing from the newer
+	// frame stays where it was
+	*count = 0;
+	for ( i = 0, j = 0 ; i < from->numEntities ; i++ ) {
+		a = &from->entities[i];
+		out = &list[(*count)++];
+		*out = *a;
+
+		while ( j < to->numEntities && to->entities[j].number < a->number ) {
+			j++;
+		}
+		if ( j == to->numEntities || to->entities[j].number != a->number ) {
+			continue;
+		}
+		b = &to->entities[j];
+
+		for ( k = 0 ; k < 3 ; k++ ) {
+			out->origin[k] = a->origin[k] + frac * ( b->origin[k] - a->origin[k] );
+			out->absmin[k] = a->absmin[k] + frac * ( b->absmin[k] - a->absmin[k] );
+			out->absmax[k] = a->absmax[k] + frac * ( b->absmax[k] - a->absmax[k] );
+		}
+	}
+
+	return qtrue;
+}
+
+/*
+==================
+SV_TraceAtTime
+
+The same as SV_Trace, but the entities in the history are clipped
+against where they were at the given server time
+==================
+*/
+void SV_TraceAtTime( trace_t *results, const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule, int time ) {
+	static historyEntity_t	rewound[MAX_HISTORY_ENTITIES];
+	static byte		isRewound[MAX_GENTITIES];
+	moveclip_t		clip;
+	historyEntity_t	*hent;
+	sharedEntity_t	*touch;
+	int				touchlist[MAX_GENTITIES];
+	int				numRewound, num, numCurrent;
+	int				passOwnerNum;
+	int				i;
+
+	if ( !SV_RewindEntities( time, rewound, &numRewound ) ) {
+		SV_Trace( results, start, mins, maxs, end, passEntityNum, contentmask, capsule );
+		return;
+	}
+
+	if ( !mins ) {
+		mins = vec3_origin;
+	}
+	if ( !maxs ) {
+		maxs = vec3_origin;
+	}
+
+	if ( sv_traceLog ) {
+		SV_RecordTrace( CMT_TRACE, start, end, mins, maxs, contentmask, capsule );
+	}
+
 	Com_Memset ( &clip, 0, sizeof ( moveclip_t ) );
 
 	// clip to world
@@ -611,34 +1377,77 @@ void SV_Trace( trace_t *results, const vec3_t start, vec3_t mins, vec3_t maxs, c
 	clip.trace.entityNum = clip.trace.fraction != 1.0 ? ENTITYNUM_WORLD : ENTITYNUM_NONE;
 	if ( clip.trace.fraction == 0 ) {
 		*results = clip.trace;
-		return;		// blocked immediately by the world
+		return;
 	}
 
-	clip.contentmask = contentmask;
-	clip.start = start;
-//	VectorCopy( clip.trace.endpos, clip.end );
-	VectorCopy( end, clip.end );
-	clip.mins = mins;
-	clip.maxs = maxs;
-	clip.passEntityNum = passEntityNum;
-	clip.capsule = capsule;
+	SV_SetupMoveClip( &clip, start, mins, maxs, end, passEntityNum, contentmask, capsule );
 
-	// create the bounding box of the entire move
-	// we can limit it to the part of the move not
-	// already clipped off by the world, which can be
-	// a significant savings for line of sight and shot traces
-	for ( i=0 ; i<3 ; i++ ) {
-		if ( end[i] > start[i] ) {
-			clip.boxmins[i] = clip.start[i] + clip.mins[i] - 1;
-			clip.boxmaxs[i] = clip.end[i] + clip.maxs[i] + 1;
-		} else {
-			clip.boxmins[i] = clip.end[i] + clip.mins[i] - 1;
-			clip.boxmaxs[i] = clip.start[i] + clip.maxs[i] + 1;
+	// the entities that aren't in the history are clipped where they are now
+	for ( i = 0 ; i < numRewound ; i++ ) {
+		isRewound[rewound[i].number] = qtrue;
+	}
+
+	num = SV_AreaEntities( clip.boxmins, clip.boxmaxs, touchlist, MAX_GENTITIES );
+	for ( i = 0, numCurrent = 0 ; i < num ; i++ ) {
+		if ( !isRewound[touchlist[i]] ) {
+			touchlist[numCurrent++] = touchlist[i];
 		}
 	}
 
-	// clip to other solid entities
-	SV_ClipMoveToEntities ( &clip );
+	SV_ClipMoveToEntityList( &clip, touchlist, numCurrent, qfalse );
+
+	for ( i = 0 ; i < numRewound ; i++ ) {
+		isRewound[rewound[i].number] = qfalse;
+	}
+
+	// then the rewound ones that still exist
+	if ( clip.passEntityNum != ENTITYNUM_NONE ) {
+		passOwnerNum = ( SV_GentityNum( clip.passEntityNum ) )->r.ownerNum;
+		if ( passOwnerNum == ENTITYNUM_NONE ) {
+			passOwnerNum = -1;
+		}
+	} else {
+		passOwnerNum = -1;
+	}
+
+	for ( i = 0, hent = rewound ; i < numRewound ; i++, hent++ ) {
+		if ( clip.trace.allsolid ) {
+			break;
+		}
+
+		if ( hent->absmin[0] > clip.boxmaxs[0]
+			|| hent->absmin[1] > clip.boxmaxs[1]
+			|| hent->absmin[2] > clip.boxmaxs[2]
+			|| hent->absmax[0] < clip.boxmins[0]
+			|| hent->absmax[1] < clip.boxmins[1]
+			|| hent->absmax[2] < clip.boxmins[2] ) {
+			continue;
+		}
+
+		touch = SV_GentityNum( hent->number );
+		if ( !touch->r.linked ) {
+			continue;	// gone or unlinked since
+		}
+
+		if ( clip.passEntityNum != ENTITYNUM_NONE ) {
+			if ( hent->number == clip.passEntityNum ) {
+				continue;
+			}
+			if ( touch->r.ownerNum == clip.passEntityNum ) {
+				continue;
+			}
+			if ( touch->r.ownerNum == passOwnerNum ) {
+				continue;
+			}
+		}
+
+		if ( !( clip.contentmask & hent->contents ) ) {
+			continue;
+		}
+
+		SV_ClipMoveToModel( &clip, hent->number, CM_TempBoxModel( hent->mins, hent->maxs, hent->capsule ),
+			hent->origin, vec3_origin );
+	}
 
 	*results = clip.trace;
 }
@@ -657,6 +1466,23 @@ int SV_PointContents( const vec3_t p, int passEntityNum ) {
 	int			contents, c2;
 	clipHandle_t	clipHandle;
 	float		*angles;
+	contentsKey_t	key;
+	contentsCacheEntry_t	*entry;
+
+	if ( sv_traceLog ) {
+		SV_RecordTrace( CMT_CONTENTS, p, p, vec3_origin, vec3_origin, 0, qfalse );
+	}
+
+	entry = NULL;
+	if ( sv_traceCache->integer ) {
+		VectorCopy( p, key.point );
+		key.passEntityNum = passEntityNum;
+
+		entry = &sv_contentsCacheEntries[SV_TraceCacheHash( &key, sizeof( key ) )];
+		if ( entry->generation == sv_traceCacheGeneration && !memcmp( &entry->key, &key, sizeof( key ) ) ) {
+			return entry->contents;
+		}
+	}
 
 	// get base contents from world
 	contents = CM_PointContents( p, 0 );
@@ -681,6 +1507,12 @@ int SV_PointContents( const vec3_t p, int passEntityNum ) {
 		contents |= c2;
 	}
 
+	if ( entry ) {
+		entry->key = key;
+		entry->generation = sv_traceCacheGeneration;
+		entry->contents = contents;
+	}
+
 	return contents;
 }
 
@@ -44,6 +44,15 @@ void CON_Init( void )
 {
 }
 
+/*
+==================
+CON_Detach
+==================
+*/
+void CON_Detach( void )
+{
+}
+
 /*
 ==================
 CON_Input
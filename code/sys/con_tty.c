@@ -325,6 +325,28 @@ void CON_Init( void )
 	CON_Show();
 }
 
+/*
+==================
+CON_Detach
+
+Leaves the terminal and stdin to the process that set them up, for a
+forked copy that keeps printing but shouldn't read or touch tty modes
+==================
+*/
+void CON_Detach( void )
+{
+	int fd = open( "/dev/null", O_RDONLY );
+
+	if( fd >= 0 )
+	{
+		dup2( fd, STDIN_FILENO );
+		close( fd );
+	}
+
+	ttycon_on = qfalse;
+	stdin_active = qfalse;
+}
+
 /*
 ==================
 CON_Input
@@ -510,7 +532,7 @@ void CON_Print( const char *msg )
 
 	if( com_ansiColor && com_ansiColor->integer )
 		Sys_AnsiColorPrint( msg );
-	else
+	else if( ttycon_on || !Com_QueueWrite( stderr, msg, strlen( msg ), qfalse ) )
 		fputs( msg, stderr );
 
 	if (!ttycon_on) {
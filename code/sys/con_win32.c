@@ -539,6 +539,15 @@ void CON_WindowsColorPrint( const char *msg )
 	}
 }
 
+/*
+==================
+CON_Detach
+==================
+*/
+void CON_Detach( void )
+{
+}
+
 /*
 ==================
 CON_Print
@@ -45,6 +45,7 @@ void CON_Shutdown( void );
 void CON_Init( void );
 char *CON_Input( void );
 void CON_Print( const char *message );
+void CON_Detach( void );
 
 unsigned int CON_LogSize( void );
 unsigned int CON_LogWrite( const char *in );
@@ -182,9 +182,15 @@ Sys_PIDFileName
 static char *Sys_PIDFileName( const char *gamedir )
 {
 	const char *homeStatePath = Cvar_VariableString( "fs_homestatepath" );
+	int instance = Cvar_VariableIntegerValue( "com_instance" );
 
 	if( *homeStatePath != '\0' )
+	{
+		if( instance )
+			return va( "%s/%s/%s.%i", homeStatePath, gamedir, PID_FILENAME, instance );
+
 		return va( "%s/%s/%s", homeStatePath, gamedir, PID_FILENAME );
+	}
 
 	return NULL;
 }
@@ -302,6 +308,9 @@ Single exit point (regular exit or in case of error)
 */
 static Q_NO_RETURN void Sys_Exit( int exitCode )
 {
+	// whatever the writer thread still holds, the error included
+	Com_FlushWriter( );
+
 	CON_Shutdown( );
 
 #ifndef DEDICATED
@@ -41,6 +41,11 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include <sys/wait.h>
 #include <time.h>
 #include <sys/resource.h>
+#include <pthread.h>
+#include <sched.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
 
 qboolean stdinIsATTY;
 
@@ -527,34 +532,32 @@ char* Sys_MicrosoftStorePath(void)
 
 /*
 ================
-Sys_Milliseconds
+Sys_Microseconds
 ================
 */
-/* base time in seconds, that's our origin
-   timeval:tv_sec is an int:
-   assuming this wraps every 0x7fffffff - ~68 years since the Epoch (1970) - we're safe till 2038 */
-unsigned long sys_timeBase = 0;
-/* current time in ms, using sys_timeBase as origin
-   NOTE: sys_timeBase*1000 + curtime -> ms since the Epoch
-     0x7fffffff ms - ~24 days
-   although timeval:tv_usec is an int, I'm not sure wether it is actually used as an unsigned int
-     (which would affect the wrap period) */
-int curtime;
-int Sys_Milliseconds (void)
+/* base time in seconds of the monotonic clock, that's our origin
+   NOTE: the millisecond clock derived from it wraps after 0x7fffffff ms - ~24 days */
+static time_t sys_timeBase = 0;
+int64_t Sys_Microseconds (void)
 {
-	struct timeval tp;
+	struct timespec ts;
 
-	gettimeofday(&tp, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &ts);
 
 	if (!sys_timeBase)
-	{
-		sys_timeBase = tp.tv_sec;
-		return tp.tv_usec/1000;
-	}
+		sys_timeBase = ts.tv_sec;
 
-	curtime = (tp.tv_sec - sys_timeBase)*1000 + tp.tv_usec/1000;
+	return (int64_t)(ts.tv_sec - sys_timeBase)*1000000 + ts.tv_nsec/1000;
+}
 
-	return curtime;
+/*
+================
+Sys_Milliseconds
+================
+*/
+int Sys_Milliseconds (void)
+{
+	return Sys_Microseconds() / 1000;
 }
 
 /*
@@ -661,6 +664,210 @@ qboolean Sys_Mkdir( const char *path )
 	return qtrue;
 }
 
+/*
+==================
+Sys_FileStat
+==================
+*/
+qboolean Sys_FileStat( const char *ospath, int64_t *size, int64_t *mtime )
+{
+	struct stat buf;
+
+	if ( stat( ospath, &buf ) != 0 || !S_ISREG( buf.st_mode ) )
+		return qfalse;
+
+	*size = buf.st_size;
+	*mtime = buf.st_mtime;
+
+	return qtrue;
+}
+
+/*
+==================
+Sys_MapFile
+
+Maps part of an open file copy-on-write, so the view can be written
+to without touching the file
+==================
+*/
+void *Sys_MapFile( FILE *f, int64_t offset, int64_t length, void **mapBase, size_t *mapSize )
+{
+	struct stat buf;
+	long pageSize = sysconf( _SC_PAGESIZE );
+	int64_t start;
+	void *base;
+
+	if ( pageSize <= 0 || offset < 0 || length <= 0 )
+		return NULL;
+
+	// pages past the end of the file fault instead of reading zeros
+	if ( fstat( fileno( f ), &buf ) != 0 || offset + length > buf.st_size )
+		return NULL;
+
+	start = offset - offset % pageSize;
+	*mapSize = (size_t)( offset - start + length );
+
+	base = mmap( NULL, *mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno( f ), (off_t)start );
+	if ( base == MAP_FAILED )
+		return NULL;
+
+	*mapBase = base;
+	return (byte *)base + ( offset - start );
+}
+
+/*
+==================
+Sys_UnmapFile
+==================
+*/
+void Sys_UnmapFile( void *mapBase, size_t mapSize )
+{
+	munmap( mapBase, mapSize );
+}
+
+/*
+==================
+Sys_ReserveMemory
+
+Address space that only takes memory as it is touched, zero filled
+==================
+*/
+void *Sys_ReserveMemory( size_t size )
+{
+	void *base = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+
+	return base == MAP_FAILED ? NULL : base;
+}
+
+/*
+==================
+Sys_PublishSharedMemory
+
+Copies size bytes at base into a new shared memory object and maps the
+object read-only over them, so the memory is the object's from then on.
+The first int is copied last; a reader that sees it set sees the rest.
+Fails if the name is taken or there's no room for the object.
+==================
+*/
+qboolean Sys_PublishSharedMemory( const char *name, void *base, size_t size )
+{
+	int fd;
+	void *view;
+
+	if( size < sizeof( int ) )
+		return qfalse;
+
+	fd = shm_open( name, O_RDWR | O_CREAT | O_EXCL, 0644 );
+	if( fd < 0 )
+		return qfalse;
+
+	// take the pages now, running out later would be a SIGBUS
+#ifdef __linux__
+	if( posix_fallocate( fd, 0, size ) != 0 )
+#else
+	if( ftruncate( fd, size ) != 0 )
+#endif
+	{
+		close( fd );
+		shm_unlink( name );
+		return qfalse;
+	}
+
+	view = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+	if( view == MAP_FAILED )
+	{
+		close( fd );
+		shm_unlink( name );
+		return qfalse;
+	}
+
+	memcpy( (byte *)view + sizeof( int ), (byte *)base + sizeof( int ), size - sizeof( int ) );
+	__sync_synchronize( );
+	*(volatile int *)view = *(int *)base;
+	munmap( view, size );
+
+	if( mmap( base, size, PROT_READ, MAP_SHARED | MAP_FIXED, fd, 0 ) == MAP_FAILED )
+	{
+		// the name just doesn't get used
+		close( fd );
+		shm_unlink( name );
+		return qfalse;
+	}
+
+	close( fd );
+	return qtrue;
+}
+
+/*
+==================
+Sys_OpenSharedMemory
+
+Maps the first size bytes of a shared memory object read-only, exactly
+at address unless it is NULL
+==================
+*/
+void *Sys_OpenSharedMemory( const char *name, void *address, size_t size )
+{
+	struct stat buf;
+	int fd, flags;
+	void *base;
+
+	fd = shm_open( name, O_RDONLY, 0 );
+	if( fd < 0 )
+		return NULL;
+
+	// pages past the end fault instead of reading zeros
+	if( fstat( fd, &buf ) != 0 || (size_t)buf.st_size < size )
+	{
+		close( fd );
+		return NULL;
+	}
+
+	flags = MAP_SHARED;
+#ifdef MAP_FIXED_NOREPLACE
+	if( address )
+		flags |= MAP_FIXED_NOREPLACE;
+#endif
+	base = mmap( address, size, PROT_READ, flags, fd, 0 );
+	close( fd );
+
+	if( base == MAP_FAILED )
+		return NULL;
+
+	// older kernels take the address as a hint only
+	if( address && base != address )
+	{
+		munmap( base, size );
+		return NULL;
+	}
+
+	return base;
+}
+
+/*
+==================
+Sys_CloseSharedMemory
+
+Unmaps a reservation or shared memory view
+==================
+*/
+void Sys_CloseSharedMemory( void *base, size_t size )
+{
+	munmap( base, size );
+}
+
+/*
+==================
+Sys_RemoveSharedMemory
+
+Removes the name, views that are mapped stay valid
+==================
+*/
+void Sys_RemoveSharedMemory( const char *name )
+{
+	shm_unlink( name );
+}
+
 /*
 ==================
 Sys_Mkfifo
@@ -968,6 +1175,238 @@ void Sys_Sleep( int msec )
 	}
 }
 
+/*
+==================
+Sys_Yield
+
+Gives the rest of the time slice to another thread
+==================
+*/
+void Sys_Yield( void )
+{
+	sched_yield();
+}
+
+typedef struct
+{
+	void	(*function)( void *arg );
+	void	*arg;
+	pthread_t	thread;
+} sysThread_t;
+
+typedef struct
+{
+	pthread_mutex_t	mutex;
+	pthread_cond_t	cond;
+	int		count;
+} sysSemaphore_t;
+
+/*
+==================
+Sys_ThreadMain
+==================
+*/
+static void *Sys_ThreadMain( void *arg )
+{
+	sysThread_t *thread = arg;
+
+	thread->function( thread->arg );
+	return NULL;
+}
+
+/*
+==================
+Sys_CreateThread
+
+Returns NULL if the thread couldn't be started
+==================
+*/
+void *Sys_CreateThread( void (*function)( void *arg ), void *arg )
+{
+#ifdef __EMSCRIPTEN__
+	return NULL;
+#else
+	sysThread_t *thread = malloc( sizeof( *thread ) );
+
+	if( !thread )
+		return NULL;
+
+	thread->function = function;
+	thread->arg = arg;
+	if( pthread_create( &thread->thread, NULL, Sys_ThreadMain, thread ) != 0 )
+	{
+		free( thread );
+		return NULL;
+	}
+
+	return thread;
+#endif
+}
+
+/*
+==================
+Sys_JoinThread
+
+Waits for the thread to return and frees it
+==================
+*/
+void Sys_JoinThread( void *thread )
+{
+	pthread_join( ( (sysThread_t *)thread )->thread, NULL );
+	free( thread );
+}
+
+/*
+==================
+Sys_CreateMutex
+==================
+*/
+void *Sys_CreateMutex( void )
+{
+	pthread_mutex_t *mutex = malloc( sizeof( *mutex ) );
+
+	if( mutex && pthread_mutex_init( mutex, NULL ) != 0 )
+	{
+		free( mutex );
+		return NULL;
+	}
+
+	return mutex;
+}
+
+/*
+==================
+Sys_DestroyMutex
+==================
+*/
+void Sys_DestroyMutex( void *mutex )
+{
+	pthread_mutex_destroy( mutex );
+	free( mutex );
+}
+
+/*
+==================
+Sys_LockMutex
+==================
+*/
+void Sys_LockMutex( void *mutex )
+{
+	pthread_mutex_lock( mutex );
+}
+
+/*
+==================
+Sys_UnlockMutex
+==================
+*/
+void Sys_UnlockMutex( void *mutex )
+{
+	pthread_mutex_unlock( mutex );
+}
+
+/*
+==================
+Sys_CreateSemaphore
+
+A counting semaphore starting at 0.  macOS has no unnamed POSIX
+semaphores, so it is built on a condition variable.
+==================
+*/
+void *Sys_CreateSemaphore( void )
+{
+	sysSemaphore_t *sem = malloc( sizeof( *sem ) );
+
+	if( !sem )
+		return NULL;
+
+	if( pthread_mutex_init( &sem->mutex, NULL ) != 0 )
+	{
+		free( sem );
+		return NULL;
+	}
+
+	if( pthread_cond_init( &sem->cond, NULL ) != 0 )
+	{
+		pthread_mutex_destroy( &sem->mutex );
+		free( sem );
+		return NULL;
+	}
+
+	sem->count = 0;
+	return sem;
+}
+
+/*
+==================
+Sys_DestroySemaphore
+==================
+*/
+void Sys_DestroySemaphore( void *sem )
+{
+	sysSemaphore_t *s = sem;
+
+	pthread_cond_destroy( &s->cond );
+	pthread_mutex_destroy( &s->mutex );
+	free( s );
+}
+
+/*
+==================
+Sys_WaitSemaphore
+==================
+*/
+void Sys_WaitSemaphore( void *sem )
+{
+	sysSemaphore_t *s = sem;
+
+	pthread_mutex_lock( &s->mutex );
+	while( !s->count )
+		pthread_cond_wait( &s->cond, &s->mutex );
+	s->count--;
+	pthread_mutex_unlock( &s->mutex );
+}
+
+/*
+==================
+Sys_PostSemaphore
+==================
+*/
+void Sys_PostSemaphore( void *sem, int count )
+{
+	sysSemaphore_t *s = sem;
+
+	pthread_mutex_lock( &s->mutex );
+	s->count += count;
+	if( count == 1 )
+		pthread_cond_signal( &s->cond );
+	else
+		pthread_cond_broadcast( &s->cond );
+	pthread_mutex_unlock( &s->mutex );
+}
+
+/*
+==================
+Sys_AtomicAdd
+==================
+*/
+int Sys_AtomicAdd( volatile int *value, int add )
+{
+	return __sync_add_and_fetch( value, add );
+}
+
+/*
+==================
+Sys_ProcessorCount
+==================
+*/
+int Sys_ProcessorCount( void )
+{
+	long count = sysconf( _SC_NPROCESSORS_ONLN );
+
+	return ( count > 0 ) ? (int)count : 1;
+}
+
 /*
 ==============
 Sys_ErrorDialog
@@ -1272,6 +1711,43 @@ qboolean Sys_PIDIsRunning( int pid )
 	return kill( pid, 0 ) == 0;
 }
 
+/*
+==============
+Sys_StartInstances
+==============
+*/
+int Sys_StartInstances( int count )
+{
+	int		i;
+	pid_t	pid;
+
+	// nothing buffered should come out twice
+	fflush( NULL );
+
+	for( i = 1; i < count; i++ )
+	{
+		pid = fork( );
+
+		if( pid < 0 )
+		{
+			Com_Printf( "Couldn't start instance %i: %s\n", i, strerror( errno ) );
+			break;
+		}
+
+		if( pid == 0 )
+		{
+#ifdef __linux__
+			// don't outlive the first instance
+			prctl( PR_SET_PDEATHSIG, SIGTERM );
+#endif
+			CON_Detach( );
+			return i;
+		}
+	}
+
+	return 0;
+}
+
 /*
 =================
 Sys_DllExtension
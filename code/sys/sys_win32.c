@@ -252,22 +252,34 @@ char* Sys_MicrosoftStorePath(void)
 
 /*
 ================
-Sys_Milliseconds
+Sys_Microseconds
 ================
 */
-int sys_timeBase;
-int Sys_Milliseconds (void)
+int64_t Sys_Microseconds (void)
 {
-	int             sys_curtime;
-	static qboolean initialized = qfalse;
+	static LARGE_INTEGER	frequency, timeBase;
+	LARGE_INTEGER			now;
 
-	if (!initialized) {
-		sys_timeBase = timeGetTime();
-		initialized = qtrue;
+	if (!frequency.QuadPart) {
+		QueryPerformanceFrequency(&frequency);
+		QueryPerformanceCounter(&timeBase);
 	}
-	sys_curtime = timeGetTime() - sys_timeBase;
+	QueryPerformanceCounter(&now);
+	now.QuadPart -= timeBase.QuadPart;
 
-	return sys_curtime;
+	// split the division so the multiply can't overflow
+	return (now.QuadPart / frequency.QuadPart) * 1000000 +
+		(now.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+}
+
+/*
+================
+Sys_Milliseconds
+================
+*/
+int Sys_Milliseconds (void)
+{
+	return Sys_Microseconds() / 1000;
 }
 
 /*
@@ -412,6 +424,76 @@ qboolean Sys_Mkdir( const char *path )
 	return qtrue;
 }
 
+/*
+==============
+Sys_FileStat
+==============
+*/
+qboolean Sys_FileStat( const char *ospath, int64_t *size, int64_t *mtime )
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+
+	if( !GetFileAttributesEx( ospath, GetFileExInfoStandard, &data ) ||
+		( data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) )
+		return qfalse;
+
+	*size = ( (int64_t)data.nFileSizeHigh << 32 ) | data.nFileSizeLow;
+	*mtime = ( (int64_t)data.ftLastWriteTime.dwHighDateTime << 32 ) | data.ftLastWriteTime.dwLowDateTime;
+
+	return qtrue;
+}
+
+/*
+==============
+Sys_MapFile
+
+Maps part of an open file copy-on-write, so the view can be written
+to without touching the file
+==============
+*/
+void *Sys_MapFile( FILE *f, int64_t offset, int64_t length, void **mapBase, size_t *mapSize )
+{
+	SYSTEM_INFO info;
+	LARGE_INTEGER size;
+	HANDLE file, mapping;
+	int64_t start;
+	void *base;
+
+	file = (HANDLE)_get_osfhandle( _fileno( f ) );
+	if( file == INVALID_HANDLE_VALUE || offset < 0 || length <= 0 )
+		return NULL;
+
+	if( !GetFileSizeEx( file, &size ) || offset + length > size.QuadPart )
+		return NULL;
+
+	GetSystemInfo( &info );
+	start = offset - offset % info.dwAllocationGranularity;
+	*mapSize = (size_t)( offset - start + length );
+
+	mapping = CreateFileMapping( file, NULL, PAGE_WRITECOPY, 0, 0, NULL );
+	if( !mapping )
+		return NULL;
+
+	// the view keeps the mapping alive
+	base = MapViewOfFile( mapping, FILE_MAP_COPY, (DWORD)( start >> 32 ), (DWORD)start, *mapSize );
+	CloseHandle( mapping );
+	if( !base )
+		return NULL;
+
+	*mapBase = base;
+	return (byte *)base + ( offset - start );
+}
+
+/*
+==============
+Sys_UnmapFile
+==============
+*/
+void Sys_UnmapFile( void *mapBase, size_t mapSize )
+{
+	UnmapViewOfFile( mapBase );
+}
+
 /*
 ==================
 Sys_Mkfifo
@@ -714,6 +796,192 @@ void Sys_Sleep( int msec )
 #endif
 }
 
+/*
+==============
+Sys_Yield
+
+Gives the rest of the time slice to another thread
+==============
+*/
+void Sys_Yield( void )
+{
+	SwitchToThread();
+}
+
+typedef struct
+{
+	void	(*function)( void *arg );
+	void	*arg;
+	HANDLE	thread;
+} sysThread_t;
+
+/*
+==============
+Sys_ThreadMain
+==============
+*/
+static DWORD WINAPI Sys_ThreadMain( LPVOID arg )
+{
+	sysThread_t *thread = arg;
+
+	thread->function( thread->arg );
+	return 0;
+}
+
+/*
+==============
+Sys_CreateThread
+
+Returns NULL if the thread couldn't be started
+==============
+*/
+void *Sys_CreateThread( void (*function)( void *arg ), void *arg )
+{
+	sysThread_t *thread = malloc( sizeof( *thread ) );
+
+	if( !thread )
+		return NULL;
+
+	thread->function = function;
+	thread->arg = arg;
+	thread->thread = CreateThread( NULL, 0, Sys_ThreadMain, thread, 0, NULL );
+	if( !thread->thread )
+	{
+		free( thread );
+		return NULL;
+	}
+
+	return thread;
+}
+
+/*
+==============
+Sys_JoinThread
+
+Waits for the thread to return and frees it
+==============
+*/
+void Sys_JoinThread( void *thread )
+{
+	sysThread_t *t = thread;
+
+	WaitForSingleObject( t->thread, INFINITE );
+	CloseHandle( t->thread );
+	free( t );
+}
+
+/*
+==============
+Sys_CreateMutex
+==============
+*/
+void *Sys_CreateMutex( void )
+{
+	CRITICAL_SECTION *mutex = malloc( sizeof( *mutex ) );
+
+	if( mutex )
+		InitializeCriticalSection( mutex );
+
+	return mutex;
+}
+
+/*
+==============
+Sys_DestroyMutex
+==============
+*/
+void Sys_DestroyMutex( void *mutex )
+{
+	DeleteCriticalSection( mutex );
+	free( mutex );
+}
+
+/*
+==============
+Sys_LockMutex
+==============
+*/
+void Sys_LockMutex( void *mutex )
+{
+	EnterCriticalSection( mutex );
+}
+
+/*
+==============
+Sys_UnlockMutex
+==============
+*/
+void Sys_UnlockMutex( void *mutex )
+{
+	LeaveCriticalSection( mutex );
+}
+
+/*
+==============
+Sys_CreateSemaphore
+
+A counting semaphore starting at 0
+==============
+*/
+void *Sys_CreateSemaphore( void )
+{
+	return CreateSemaphore( NULL, 0, 0x7fffffff, NULL );
+}
+
+/*
+==============
+Sys_DestroySemaphore
+==============
+*/
+void Sys_DestroySemaphore( void *sem )
+{
+	CloseHandle( sem );
+}
+
+/*
+==============
+Sys_WaitSemaphore
+==============
+*/
+void Sys_WaitSemaphore( void *sem )
+{
+	WaitForSingleObject( sem, INFINITE );
+}
+
+/*
+==============
+Sys_PostSemaphore
+==============
+*/
+void Sys_PostSemaphore( void *sem, int count )
+{
+	if( count > 0 )
+		ReleaseSemaphore( sem, count, NULL );
+}
+
+/*
+==============
+Sys_AtomicAdd
+==============
+*/
+int Sys_AtomicAdd( volatile int *value, int add )
+{
+	return InterlockedExchangeAdd( (volatile LONG *)value, add ) + add;
+}
+
+/*
+==============
+Sys_ProcessorCount
+==============
+*/
+int Sys_ProcessorCount( void )
+{
+	SYSTEM_INFO info;
+
+	GetSystemInfo( &info );
+	return ( info.dwNumberOfProcessors > 0 ) ? (int)info.dwNumberOfProcessors : 1;
+}
+
 /*
 ==============
 Sys_ErrorDialog
@@ -883,6 +1151,65 @@ int Sys_PID( void )
 	return GetCurrentProcessId( );
 }
 
+/*
+==============
+Sys_ReserveMemory
+==============
+*/
+void *Sys_ReserveMemory( size_t size )
+{
+	return NULL;
+}
+
+/*
+==============
+Sys_PublishSharedMemory
+==============
+*/
+qboolean Sys_PublishSharedMemory( const char *name, void *base, size_t size )
+{
+	return qfalse;
+}
+
+/*
+==============
+Sys_OpenSharedMemory
+==============
+*/
+void *Sys_OpenSharedMemory( const char *name, void *address, size_t size )
+{
+	return NULL;
+}
+
+/*
+==============
+Sys_CloseSharedMemory
+==============
+*/
+void Sys_CloseSharedMemory( void *base, size_t size )
+{
+}
+
+/*
+==============
+Sys_RemoveSharedMemory
+==============
+*/
+void Sys_RemoveSharedMemory( const char *name )
+{
+}
+
+/*
+==============
+Sys_StartInstances
+==============
+*/
+int Sys_StartInstances( int count )
+{
+	Com_Printf( "com_instances isn't supported on this platform\n" );
+	return 0;
+}
+
 /*
 ==============
 Sys_PIDIsRunning
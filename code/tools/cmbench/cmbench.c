@@ -0,0 +1,684 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// cmbench.c -- collision model benchmark
+
+// Loads a bsp through the engine's cm_*.c and times point contents,
+// ray, box and capsule traces against the world, either a workload
+// generated from the map's open space or one recorded by the server's
+// recordtraces command.  The rest of qcommon is stood in for by the
+// few functions the collision code calls.  A hash of every result is
+// printed with the times, so a change to the collision code can be
+// checked to give the same answers as well as timed.
+
+#include "../../qcommon/q_shared.h"
+#include "../../qcommon/qcommon.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define	BENCH_MASK		( CONTENTS_SOLID | CONTENTS_PLAYERCLIP | CONTENTS_BODY )
+
+typedef enum {
+	BK_CONTENTS,
+	BK_RAY,
+	BK_BOX,
+	BK_CAPSULE,
+	BK_NUM_KINDS
+} benchKind_t;
+
+static const char	*benchKindNames[BK_NUM_KINDS] = {
+	"contents", "ray", "box", "capsule"
+};
+
+typedef struct {
+	int		count;
+	int64_t	best;			// fastest pass, in microseconds
+} benchTimes_t;
+
+static cvar_t			*bench_cvars;
+
+static cmTraceRecord_t	*bench_records[BK_NUM_KINDS];
+static int				bench_numRecords[BK_NUM_KINDS];
+
+static unsigned			bench_seed = 0x1234567;
+
+cvar_t					*com_dedicated;
+cvar_t					*com_cl_running;
+
+int						com_profiling;
+Q_THREAD_LOCAL int		com_profileDepth;
+
+/*
+==============================================================================
+
+STAND-INS FOR QCOMMON
+
+==============================================================================
+*/
+
+void QDECL Com_Printf( const char *fmt, ... ) {
+	va_list	argptr;
+
+	va_start( argptr, fmt );
+	vprintf( fmt, argptr );
+	va_end( argptr );
+}
+
+void QDECL Com_DPrintf( const char *fmt, ... ) {
+}
+
+void QDECL Com_Error( int code, const char *fmt, ... ) {
+	va_list	argptr;
+
+	va_start( argptr, fmt );
+	fprintf( stderr, "ERROR: " );
+	vfprintf( stderr, fmt, argptr );
+	fprintf( stderr, "\n" );
+	va_end( argptr );
+	exit( 1 );
+}
+
+/*
+=================
+Cvar_Get
+
+Cvars set with -set keep their value, the rest take the default
+=================
+*/
+cvar_t *Cvar_Get( const char *name, const char *value, int flags ) {
+	cvar_t	*var;
+
+	for ( var = bench_cvars; var; var = var->next ) {
+		if ( !Q_stricmp( var->name, name ) ) {
+			return var;
+		}
+	}
+
+	var = calloc( 1, sizeof( *var ) );
+	var->name = strdup( name );
+	var->string = strdup( value );
+	var->value = atof( value );
+	var->integer = atoi( value );
+	var->flags = flags;
+	var->next = bench_cvars;
+	bench_cvars = var;
+
+	return var;
+}
+
+void Cvar_SetDescription( cvar_t *var, const char *description ) {
+}
+
+#ifdef HUNK_DEBUG
+void *Hunk_AllocDebug( int size, ha_pref preference, char *label, char *file, int line ) {
+#else
+void *Hunk_Alloc( int size, ha_pref preference ) {
+#endif
+	void	*buf;
+
+	buf = calloc( 1, size );
+	if ( !buf ) {
+		Com_Error( ERR_FATAL, "Hunk_Alloc: failed on %i", size );
+	}
+	return buf;
+}
+
+#ifdef ZONE_DEBUG
+void *Z_MallocDebug( int size, char *label, char *file, int line ) {
+#else
+void *Z_Malloc( int size ) {
+#endif
+	void	*buf;
+
+	buf = calloc( 1, size );
+	if ( !buf ) {
+		Com_Error( ERR_FATAL, "Z_Malloc: failed on %i", size );
+	}
+	return buf;
+}
+
+void Z_Free( void *ptr ) {
+	free( ptr );
+}
+
+void *Hunk_AllocateTempMemory( int size ) {
+	return Z_Malloc( size );
+}
+
+void Hunk_FreeTempMemory( void *buf ) {
+	free( buf );
+}
+
+/*
+=================
+FS_MapFile
+
+The map is named by its path on disk
+=================
+*/
+long FS_MapFile( const char *qpath, void **buffer ) {
+	FILE	*f;
+	long	length;
+
+	*buffer = NULL;
+
+	f = fopen( qpath, "rb" );
+	if ( !f ) {
+		return -1;
+	}
+
+	fseek( f, 0, SEEK_END );
+	length = ftell( f );
+	fseek( f, 0, SEEK_SET );
+
+	*buffer = malloc( length + 1 );
+	if ( fread( *buffer, 1, length, f ) != length ) {
+		free( *buffer );
+		*buffer = NULL;
+		length = -1;
+	}
+	fclose( f );
+
+	return length;
+}
+
+void FS_UnmapFile( void *buffer ) {
+	free( buffer );
+}
+
+void FS_HoldFile( const char *qpath, const void *buffer, int len ) {
+}
+
+void FS_ReleaseHeldFile( void ) {
+}
+
+qboolean FS_HoldingFile( const char *qpath ) {
+	return qfalse;
+}
+
+// no patch cache, every run builds the curves
+long FS_ReadFile( const char *qpath, void **buffer ) {
+	*buffer = NULL;
+	return -1;
+}
+
+void FS_FreeFile( void *buffer ) {
+}
+
+fileHandle_t FS_FOpenFileWrite_HomeData( const char *filename ) {
+	return 0;
+}
+
+int FS_Write( const void *buffer, int len, fileHandle_t f ) {
+	return 0;
+}
+
+void FS_FCloseFile( fileHandle_t f ) {
+}
+
+void *Sys_ReserveMemory( size_t size ) {
+	return NULL;
+}
+
+qboolean Sys_PublishSharedMemory( const char *name, void *base, size_t size ) {
+	return qfalse;
+}
+
+void *Sys_OpenSharedMemory( const char *name, void *address, size_t size ) {
+	return NULL;
+}
+
+void Sys_CloseSharedMemory( void *base, size_t size ) {
+}
+
+void Sys_RemoveSharedMemory( const char *name ) {
+}
+
+void Com_ProfileBegin( const char *name ) {
+}
+
+void Com_ProfileEnd( void ) {
+}
+
+void BotDrawDebugPolygons( void (*drawPoly)( int color, int numPoints, float *points ), int value ) {
+}
+
+/*
+=================
+Bench_Microseconds
+=================
+*/
+static int64_t Bench_Microseconds( void ) {
+#ifdef _WIN32
+	static LARGE_INTEGER	frequency;
+	LARGE_INTEGER			now;
+
+	if ( !frequency.QuadPart ) {
+		QueryPerformanceFrequency( &frequency );
+	}
+	QueryPerformanceCounter( &now );
+	return now.QuadPart * 1000000 / frequency.QuadPart;
+#else
+	struct timespec	now;
+
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+#endif
+}
+
+/*
+==============================================================================
+
+WORKLOADS
+
+==============================================================================
+*/
+
+/*
+=================
+Bench_Random
+
+0 to 1, the same series for the same -seed on every platform
+=================
+*/
+static float Bench_Random( void ) {
+	bench_seed ^= bench_seed << 13;
+	bench_seed ^= bench_seed >> 17;
+	bench_seed ^= bench_seed << 5;
+	return ( bench_seed & 0xffffff ) / (float)0x1000000;
+}
+
+/*
+=================
+Bench_KindForRecord
+=================
+*/
+static benchKind_t Bench_KindForRecord( const cmTraceRecord_t *rec ) {
+	if ( rec->type == CMT_CONTENTS ) {
+		return BK_CONTENTS;
+	}
+	if ( rec->capsule ) {
+		return BK_CAPSULE;
+	}
+	if ( VectorCompare( rec->mins, vec3_origin ) && VectorCompare( rec->maxs, vec3_origin ) ) {
+		return BK_RAY;
+	}
+	return BK_BOX;
+}
+
+/*
+=================
+Bench_AddRecord
+=================
+*/
+static void Bench_AddRecord( const cmTraceRecord_t *rec ) {
+	benchKind_t	kind;
+	int			n;
+
+	kind = Bench_KindForRecord( rec );
+	n = bench_numRecords[kind];
+
+	// grown by doubling
+	if ( !( n & ( n - 1 ) ) ) {
+		bench_records[kind] = realloc( bench_records[kind], ( n ? n * 2 : 1 ) * sizeof( *rec ) );
+		if ( !bench_records[kind] ) {
+			Com_Error( ERR_FATAL, "out of memory for %i records", n * 2 );
+		}
+	}
+	bench_records[kind][n] = *rec;
+	bench_numRecords[kind]++;
+}
+
+/*
+=================
+Bench_OpenPoint
+
+A point outside the solid, found by trying random ones within the world
+=================
+*/
+static void Bench_OpenPoint( const vec3_t mins, const vec3_t maxs, vec3_t point ) {
+	int		i, tries;
+
+	for ( tries = 0; tries < 100000; tries++ ) {
+		for ( i = 0; i < 3; i++ ) {
+			point[i] = mins[i] + Bench_Random() * ( maxs[i] - mins[i] );
+		}
+		if ( !( CM_PointContents( point, 0 ) & CONTENTS_SOLID ) ) {
+			return;
+		}
+	}
+	Com_Error( ERR_FATAL, "no open space found in the world" );
+}
+
+/*
+=================
+Bench_GenerateWorkload
+
+count queries of each kind: contents anywhere in the world, rays
+as long as shots from open space and box and capsule moves the size of
+a player's from open space
+=================
+*/
+static void Bench_GenerateWorkload( int count ) {
+	static const vec3_t	playerMins = { -15, -15, -24 };
+	static const vec3_t	playerMaxs = { 15, 15, 32 };
+	cmTraceRecord_t		rec;
+	vec3_t				mins, maxs, dir;
+	float				length;
+	benchKind_t			kind;
+	int					i, j;
+
+	CM_ModelBounds( 0, mins, maxs );
+
+	for ( kind = 0; kind < BK_NUM_KINDS; kind++ ) {
+		for ( i = 0; i < count; i++ ) {
+			Com_Memset( &rec, 0, sizeof( rec ) );
+			rec.contentmask = BENCH_MASK;
+
+			if ( kind == BK_CONTENTS ) {
+				rec.type = CMT_CONTENTS;
+				for ( j = 0; j < 3; j++ ) {
+					rec.start[j] = mins[j] + Bench_Random() * ( maxs[j] - mins[j] );
+				}
+				VectorCopy( rec.start, rec.end );
+				Bench_AddRecord( &rec );
+				continue;
+			}
+
+			rec.type = CMT_TRACE;
+			Bench_OpenPoint( mins, maxs, rec.start );
+
+			for ( j = 0; j < 3; j++ ) {
+				dir[j] = Bench_Random() * 2 - 1;
+			}
+			if ( VectorNormalize( dir ) == 0 ) {
+				dir[0] = 1;
+			}
+
+			if ( kind == BK_RAY ) {
+				length = 256 + Bench_Random() * 7936;
+			} else {
+				length = 16 + Bench_Random() * 240;
+				VectorCopy( playerMins, rec.mins );
+				VectorCopy( playerMaxs, rec.maxs );
+				rec.capsule = ( kind == BK_CAPSULE );
+			}
+			VectorMA( rec.start, length, dir, rec.end );
+
+			Bench_AddRecord( &rec );
+		}
+	}
+}
+
+/*
+=================
+Bench_ReadWorkload
+=================
+*/
+static void Bench_ReadWorkload( const char *filename, const char *mapname ) {
+	cmTraceLogHeader_t	header;
+	cmTraceRecord_t		rec;
+	FILE				*f;
+
+	f = fopen( filename, "rb" );
+	if ( !f ) {
+		Com_Error( ERR_FATAL, "couldn't open %s", filename );
+	}
+
+	if ( fread( &header, sizeof( header ), 1, f ) != 1 || header.ident != CM_TRACELOG_IDENT ) {
+		Com_Error( ERR_FATAL, "%s isn't a trace log", filename );
+	}
+	if ( header.version != CM_TRACELOG_VERSION ) {
+		Com_Error( ERR_FATAL, "%s is version %i, not %i", filename, header.version, CM_TRACELOG_VERSION );
+	}
+	header.map[sizeof( header.map ) - 1] = 0;
+	if ( Q_stricmp( COM_SkipPath( header.map ), COM_SkipPath( (char *)mapname ) ) ) {
+		Com_Printf( "WARNING: %s was recorded on %s\n", filename, header.map );
+	}
+
+	while ( fread( &rec, sizeof( rec ), 1, f ) == 1 ) {
+		Bench_AddRecord( &rec );
+	}
+	fclose( f );
+}
+
+/*
+=================
+Bench_WriteWorkload
+=================
+*/
+static void Bench_WriteWorkload( const char *filename, const char *mapname, int checksum ) {
+	cmTraceLogHeader_t	header;
+	benchKind_t			kind;
+	FILE				*f;
+
+	f = fopen( filename, "wb" );
+	if ( !f ) {
+		Com_Error( ERR_FATAL, "couldn't write %s", filename );
+	}
+
+	Com_Memset( &header, 0, sizeof( header ) );
+	header.ident = CM_TRACELOG_IDENT;
+	header.version = CM_TRACELOG_VERSION;
+	Q_strncpyz( header.map, mapname, sizeof( header.map ) );
+	header.checksum = checksum;
+	fwrite( &header, sizeof( header ), 1, f );
+
+	for ( kind = 0; kind < BK_NUM_KINDS; kind++ ) {
+		fwrite( bench_records[kind], sizeof( cmTraceRecord_t ), bench_numRecords[kind], f );
+	}
+	fclose( f );
+}
+
+/*
+==============================================================================
+
+RUNNING
+
+==============================================================================
+*/
+
+/*
+=================
+Bench_HashResult
+=================
+*/
+static unsigned Bench_HashResult( unsigned hash, const void *data, int length ) {
+	const byte	*p = data;
+	int			i;
+
+	for ( i = 0; i < length; i++ ) {
+		hash = ( hash ^ p[i] ) * 16777619;
+	}
+	return hash;
+}
+
+/*
+=================
+Bench_RunKind
+
+Returns the microseconds taken by one pass over the kind's queries
+=================
+*/
+static int64_t Bench_RunKind( benchKind_t kind, unsigned *hash ) {
+	cmTraceRecord_t	*rec;
+	trace_t			trace;
+	int64_t			start;
+	int				i, contents;
+
+	rec = bench_records[kind];
+	start = Bench_Microseconds();
+
+	for ( i = 0; i < bench_numRecords[kind]; i++, rec++ ) {
+		if ( kind == BK_CONTENTS ) {
+			contents = CM_PointContents( rec->start, 0 );
+			*hash = Bench_HashResult( *hash, &contents, sizeof( contents ) );
+			continue;
+		}
+
+		CM_BoxTrace( &trace, rec->start, rec->end, rec->mins, rec->maxs, 0, rec->contentmask, rec->capsule );
+		*hash = Bench_HashResult( *hash, &trace.fraction, sizeof( trace.fraction ) );
+		*hash = Bench_HashResult( *hash, &trace.contents, sizeof( trace.contents ) );
+		*hash = Bench_HashResult( *hash, &trace.allsolid, sizeof( trace.allsolid ) );
+	}
+
+	return Bench_Microseconds() - start;
+}
+
+/*
+=================
+Bench_Usage
+=================
+*/
+static void Bench_Usage( void ) {
+	printf( "usage: cmbench [options] <file.bsp>\n"
+		"  -n <count>        queries of each kind to generate (default 100000)\n"
+		"  -seed <number>    seed for the generated queries\n"
+		"  -passes <count>   times to run the queries, the fastest is shown (default 5)\n"
+		"  -replay <file>    run the queries in a recordtraces log instead\n"
+		"  -write <file>     save the queries to replay later\n"
+		"  -set <cvar> <value>  set a collision cvar before loading\n" );
+	exit( 1 );
+}
+
+int main( int argc, char **argv ) {
+	benchTimes_t	times[BK_NUM_KINDS], all;
+	const char		*mapname, *replay, *write;
+	unsigned		hash, scratch;
+	int64_t			usec, passUsec;
+	int				count, passes, checksum;
+	int				pass, brushTraces, patchTraces, i;
+	benchKind_t		kind;
+	extern int		c_brush_traces, c_patch_traces;
+
+	mapname = replay = write = NULL;
+	count = 100000;
+	passes = 5;
+
+	for ( i = 1; i < argc; i++ ) {
+		if ( !strcmp( argv[i], "-n" ) && i + 1 < argc ) {
+			count = atoi( argv[++i] );
+		} else if ( !strcmp( argv[i], "-seed" ) && i + 1 < argc ) {
+			bench_seed = strtoul( argv[++i], NULL, 0 );
+			if ( !bench_seed ) {
+				bench_seed = 1;
+			}
+		} else if ( !strcmp( argv[i], "-passes" ) && i + 1 < argc ) {
+			passes = atoi( argv[++i] );
+		} else if ( !strcmp( argv[i], "-replay" ) && i + 1 < argc ) {
+			replay = argv[++i];
+		} else if ( !strcmp( argv[i], "-write" ) && i + 1 < argc ) {
+			write = argv[++i];
+		} else if ( !strcmp( argv[i], "-set" ) && i + 2 < argc ) {
+			Cvar_Get( argv[i + 1], argv[i + 2], 0 );
+			i += 2;
+		} else if ( argv[i][0] != '-' && !mapname ) {
+			mapname = argv[i];
+		} else {
+			Bench_Usage();
+		}
+	}
+
+	if ( !mapname || count < 1 || passes < 1 ) {
+		Bench_Usage();
+	}
+
+	com_dedicated = Cvar_Get( "dedicated", "1", 0 );
+	com_cl_running = Cvar_Get( "cl_running", "0", 0 );
+	Cvar_Get( "cm_shareMaps", "0", 0 );
+
+	usec = Bench_Microseconds();
+	CM_LoadMap( mapname, qfalse, &checksum );
+	Com_Printf( "Loaded %s in %.1f ms, checksum %i\n", mapname, ( Bench_Microseconds() - usec ) / 1000.0, checksum );
+
+	if ( replay ) {
+		Bench_ReadWorkload( replay, mapname );
+	} else {
+		Bench_GenerateWorkload( count );
+	}
+	if ( write ) {
+		Bench_WriteWorkload( write, mapname, checksum );
+	}
+
+	for ( kind = 0; kind < BK_NUM_KINDS && !bench_numRecords[kind]; kind++ ) {
+	}
+	if ( kind == BK_NUM_KINDS ) {
+		Com_Error( ERR_FATAL, "no queries to run" );
+	}
+
+	Com_Memset( times, 0, sizeof( times ) );
+	brushTraces = patchTraces = 0;
+	hash = 2166136261u;
+
+	for ( pass = 0; pass < passes; pass++ ) {
+		c_brush_traces = c_patch_traces = 0;
+
+		for ( kind = 0; kind < BK_NUM_KINDS; kind++ ) {
+			if ( !bench_numRecords[kind] ) {
+				continue;
+			}
+
+			// every pass has to come out the same, only the first is hashed
+			passUsec = Bench_RunKind( kind, pass ? &scratch : &hash );
+
+			times[kind].count = bench_numRecords[kind];
+			if ( !pass || passUsec < times[kind].best ) {
+				times[kind].best = passUsec;
+			}
+		}
+
+		brushTraces = c_brush_traces;
+		patchTraces = c_patch_traces;
+	}
+
+	Com_Memset( &all, 0, sizeof( all ) );
+	Com_Printf( "\n%-10s %10s %12s %10s %14s\n", "kind", "queries", "best ms", "ns/query", "queries/s" );
+	for ( kind = 0; kind <= BK_NUM_KINDS; kind++ ) {
+		benchTimes_t	*t;
+
+		if ( kind == BK_NUM_KINDS ) {
+			t = &all;
+		} else {
+			t = &times[kind];
+			if ( !t->count ) {
+				continue;
+			}
+			all.count += t->count;
+			all.best += t->best;
+		}
+
+		Com_Printf( "%-10s %10i %12.2f %10.1f %14.0f\n", kind == BK_NUM_KINDS ? "all" : benchKindNames[kind],
+			t->count, t->best / 1000.0, t->best * 1000.0 / t->count,
+			t->best ? t->count * 1000000.0 / t->best : 0.0 );
+	}
+
+	Com_Printf( "\n%i passes, %i brush and %i patch tests a pass, result hash %08x\n",
+		passes, brushTraces, patchTraces, hash );
+
+	return 0;
+}
@@ -0,0 +1,567 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Quake III Arena source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// msgbench.c -- snapshot encode / decode benchmark
+
+// Replays the player and entity state deltas of a recordmsgs capture
+// through msg.c the way the server writes snapshots and the client reads
+// them, and times both directions.  Every decoded state is checked
+// against the one that was encoded, and the encoded packets can be saved
+// as golden output and later compared byte for byte, so changes to the
+// bit packing or the huffman code can be shown to leave the wire format
+// alone.
+
+#include "../../qcommon/q_shared.h"
+#include "../../qcommon/qcommon.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define	GOLDEN_IDENT		(('D'<<24)+('L'<<16)+('O'<<8)+'G')
+#define	GOLDEN_VERSION		1
+
+typedef struct {
+	int			type;
+	int			flags;
+	const void	*from;
+	const void	*to;
+} benchDelta_t;
+
+typedef struct {
+	int			firstDelta;
+	int			numDeltas;
+	int			offset;			// into bench_packetData
+	int			size;
+} benchPacket_t;
+
+static byte				*bench_capture;
+
+static benchDelta_t		*bench_deltas;
+static int				bench_numDeltas;
+
+static benchPacket_t	*bench_packets;
+static int				bench_numPackets;
+
+static byte				*bench_packetData;
+static int				bench_packetDataSize;
+static int				bench_packetDataAlloc;
+
+cvar_t					*cl_shownet;
+
+/*
+==============================================================================
+
+STAND-INS FOR QCOMMON
+
+==============================================================================
+*/
+
+void QDECL Com_Printf( const char *fmt, ... ) {
+	va_list	argptr;
+
+	va_start( argptr, fmt );
+	vprintf( fmt, argptr );
+	va_end( argptr );
+}
+
+void QDECL Com_Error( int code, const char *fmt, ... ) {
+	va_list	argptr;
+
+	va_start( argptr, fmt );
+	fprintf( stderr, "ERROR: " );
+	vfprintf( stderr, fmt, argptr );
+	fprintf( stderr, "\n" );
+	va_end( argptr );
+	exit( 1 );
+}
+
+#ifdef ZONE_DEBUG
+void *Z_MallocDebug( int size, char *label, char *file, int line ) {
+#else
+void *Z_Malloc( int size ) {
+#endif
+	void	*buf;
+
+	buf = calloc( 1, size );
+	if ( !buf ) {
+		Com_Error( ERR_FATAL, "Z_Malloc: failed on %i", size );
+	}
+	return buf;
+}
+
+void Z_Free( void *ptr ) {
+	free( ptr );
+}
+
+/*
+=================
+Bench_Microseconds
+=================
+*/
+static int64_t Bench_Microseconds( void ) {
+#ifdef _WIN32
+	static LARGE_INTEGER	frequency;
+	LARGE_INTEGER			now;
+
+	if ( !frequency.QuadPart ) {
+		QueryPerformanceFrequency( &frequency );
+	}
+	QueryPerformanceCounter( &now );
+	return now.QuadPart * 1000000 / frequency.QuadPart;
+#else
+	struct timespec	now;
+
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+#endif
+}
+
+/*
+=================
+Bench_ReadFile
+=================
+*/
+static byte *Bench_ReadFile( const char *filename, int *length ) {
+	FILE	*f;
+	byte	*buf;
+
+	f = fopen( filename, "rb" );
+	if ( !f ) {
+		Com_Error( ERR_FATAL, "couldn't open %s", filename );
+	}
+
+	fseek( f, 0, SEEK_END );
+	*length = ftell( f );
+	fseek( f, 0, SEEK_SET );
+
+	buf = malloc( *length + 1 );
+	if ( !buf || fread( buf, 1, *length, f ) != *length ) {
+		Com_Error( ERR_FATAL, "couldn't read %s", filename );
+	}
+	fclose( f );
+
+	return buf;
+}
+
+/*
+==============================================================================
+
+CAPTURES
+
+==============================================================================
+*/
+
+/*
+=================
+Bench_LoadCapture
+
+Splits a recordmsgs capture into snapshots of deltas that point into it
+=================
+*/
+static void Bench_LoadCapture( const char *filename ) {
+	msgCaptureHeader_t	header;
+	msgCaptureRecord_t	rec;
+	benchDelta_t		*delta;
+	int					length, pos, size;
+
+	bench_capture = Bench_ReadFile( filename, &length );
+
+	if ( length < sizeof( header ) ) {
+		Com_Error( ERR_FATAL, "%s isn't a message capture", filename );
+	}
+	Com_Memcpy( &header, bench_capture, sizeof( header ) );
+	if ( header.ident != MSG_CAPTURE_IDENT ) {
+		Com_Error( ERR_FATAL, "%s isn't a message capture", filename );
+	}
+	if ( header.version != MSG_CAPTURE_VERSION ) {
+		Com_Error( ERR_FATAL, "%s is version %i, not %i", filename, header.version, MSG_CAPTURE_VERSION );
+	}
+	if ( header.entityStateSize != sizeof( entityState_t ) || header.playerStateSize != sizeof( playerState_t ) ) {
+		Com_Error( ERR_FATAL, "%s was captured with different state structs", filename );
+	}
+
+	// no more deltas than records, no more packets than deltas
+	bench_deltas = malloc( ( length / sizeof( rec ) + 1 ) * sizeof( *bench_deltas ) );
+	bench_packets = malloc( ( length / sizeof( rec ) + 1 ) * sizeof( *bench_packets ) );
+
+	for ( pos = sizeof( header ); pos + sizeof( rec ) <= length; ) {
+		Com_Memcpy( &rec, bench_capture + pos, sizeof( rec ) );
+		pos += sizeof( rec );
+
+		if ( rec.type == MSGC_SNAPSHOT ) {
+			bench_packets[bench_numPackets].firstDelta = bench_numDeltas;
+			bench_packets[bench_numPackets].numDeltas = 0;
+			bench_numPackets++;
+			continue;
+		}
+
+		if ( rec.type == MSGC_PLAYERSTATE ) {
+			size = sizeof( playerState_t );
+		} else if ( rec.type == MSGC_ENTITY ) {
+			size = sizeof( entityState_t );
+		} else {
+			Com_Error( ERR_FATAL, "%s: bad record type %i at %i", filename, rec.type, pos );
+		}
+
+		if ( !bench_numPackets ) {
+			Com_Error( ERR_FATAL, "%s: delta before the first snapshot", filename );
+		}
+
+		delta = &bench_deltas[bench_numDeltas++];
+		delta->type = rec.type;
+		delta->flags = rec.flags;
+		delta->from = delta->to = NULL;
+		if ( rec.flags & MSGCF_FROM ) {
+			delta->from = bench_capture + pos;
+			pos += size;
+		}
+		if ( rec.flags & MSGCF_TO ) {
+			delta->to = bench_capture + pos;
+			pos += size;
+		}
+		if ( pos > length ) {
+			Com_Error( ERR_FATAL, "%s is cut short", filename );
+		}
+		bench_packets[bench_numPackets - 1].numDeltas++;
+	}
+
+	if ( !bench_numPackets ) {
+		Com_Error( ERR_FATAL, "%s has no snapshots", filename );
+	}
+}
+
+/*
+=================
+Bench_EntityWritten
+
+MSG_WriteDeltaEntity writes nothing for an unchanged entity unless forced
+=================
+*/
+static qboolean Bench_EntityWritten( const benchDelta_t *delta ) {
+	if ( !delta->to ) {
+		return delta->from != NULL;
+	}
+	if ( delta->flags & MSGCF_FORCE ) {
+		return qtrue;
+	}
+	return memcmp( delta->from, delta->to, sizeof( entityState_t ) ) != 0;
+}
+
+/*
+==============================================================================
+
+RUNNING
+
+==============================================================================
+*/
+
+/*
+=================
+Bench_Encode
+
+Writes every snapshot into bench_packetData, returning the microseconds taken
+=================
+*/
+static int64_t Bench_Encode( void ) {
+	static byte		buf[MAX_MSGLEN];
+	benchPacket_t	*packet;
+	benchDelta_t	*delta;
+	msg_t			msg;
+	int64_t			start, usec;
+	int				i, j;
+
+	usec = 0;
+	bench_packetDataSize = 0;
+
+	for ( i = 0, packet = bench_packets; i < bench_numPackets; i++, packet++ ) {
+		start = Bench_Microseconds();
+
+		MSG_Init( &msg, buf, sizeof( buf ) );
+		for ( j = 0, delta = bench_deltas + packet->firstDelta; j < packet->numDeltas; j++, delta++ ) {
+			if ( delta->type == MSGC_PLAYERSTATE ) {
+				MSG_WriteDeltaPlayerstate( &msg, (playerState_t *)delta->from, (playerState_t *)delta->to );
+			} else {
+				MSG_WriteDeltaEntity( &msg, (entityState_t *)delta->from, (entityState_t *)delta->to,
+					( delta->flags & MSGCF_FORCE ) != 0 );
+			}
+		}
+		MSG_WriteBits( &msg, MAX_GENTITIES - 1, GENTITYNUM_BITS );	// end of packetentities
+
+		usec += Bench_Microseconds() - start;
+
+		if ( msg.overflowed ) {
+			Com_Error( ERR_FATAL, "snapshot %i overflowed", i );
+		}
+
+		if ( bench_packetDataSize + msg.cursize > bench_packetDataAlloc ) {
+			bench_packetDataAlloc = ( bench_packetDataSize + msg.cursize ) * 2;
+			bench_packetData = realloc( bench_packetData, bench_packetDataAlloc );
+			if ( !bench_packetData ) {
+				Com_Error( ERR_FATAL, "out of memory for %i bytes of snapshots", bench_packetDataAlloc );
+			}
+		}
+
+		packet->offset = bench_packetDataSize;
+		packet->size = msg.cursize;
+		Com_Memcpy( bench_packetData + bench_packetDataSize, buf, msg.cursize );
+		bench_packetDataSize += msg.cursize;
+	}
+
+	return usec;
+}
+
+/*
+=================
+Bench_Decode
+
+Reads every snapshot back, counting the states that didn't come out as
+they went in.  Returns the microseconds taken.
+=================
+*/
+static int64_t Bench_Decode( int *mismatches ) {
+	static byte		buf[MAX_MSGLEN];
+	benchPacket_t	*packet;
+	benchDelta_t	*delta;
+	msg_t			msg;
+	entityState_t	es;
+	playerState_t	ps;
+	int64_t			start, usec;
+	int				i, j, number;
+
+	usec = 0;
+	*mismatches = 0;
+
+	for ( i = 0, packet = bench_packets; i < bench_numPackets; i++, packet++ ) {
+		// reading doesn't change the data, but a real client reads its own copy
+		Com_Memcpy( buf, bench_packetData + packet->offset, packet->size );
+
+		start = Bench_Microseconds();
+
+		MSG_Init( &msg, buf, sizeof( buf ) );
+		msg.cursize = packet->size;
+		MSG_BeginReading( &msg );
+
+		for ( j = 0, delta = bench_deltas + packet->firstDelta; j < packet->numDeltas; j++, delta++ ) {
+			if ( delta->type == MSGC_PLAYERSTATE ) {
+				MSG_ReadDeltaPlayerstate( &msg, (playerState_t *)delta->from, &ps );
+				if ( memcmp( &ps, delta->to, sizeof( ps ) ) ) {
+					( *mismatches )++;
+				}
+				continue;
+			}
+
+			if ( !Bench_EntityWritten( delta ) ) {
+				continue;
+			}
+
+			number = MSG_ReadBits( &msg, GENTITYNUM_BITS );
+			MSG_ReadDeltaEntity( &msg, (entityState_t *)delta->from, &es, number );
+			if ( delta->to ? memcmp( &es, delta->to, sizeof( es ) ) : es.number != MAX_GENTITIES - 1 ) {
+				( *mismatches )++;
+			}
+		}
+
+		if ( MSG_ReadBits( &msg, GENTITYNUM_BITS ) != MAX_GENTITIES - 1 || msg.readcount > msg.cursize ) {
+			Com_Error( ERR_FATAL, "snapshot %i didn't read back to its end", i );
+		}
+
+		usec += Bench_Microseconds() - start;
+	}
+
+	return usec;
+}
+
+/*
+=================
+Bench_WriteGolden
+=================
+*/
+static void Bench_WriteGolden( const char *filename ) {
+	int		header[3];
+	FILE	*f;
+	int		i;
+
+	f = fopen( filename, "wb" );
+	if ( !f ) {
+		Com_Error( ERR_FATAL, "couldn't write %s", filename );
+	}
+
+	header[0] = GOLDEN_IDENT;
+	header[1] = GOLDEN_VERSION;
+	header[2] = bench_numPackets;
+	fwrite( header, sizeof( header ), 1, f );
+
+	for ( i = 0; i < bench_numPackets; i++ ) {
+		fwrite( &bench_packets[i].size, sizeof( int ), 1, f );
+		fwrite( bench_packetData + bench_packets[i].offset, 1, bench_packets[i].size, f );
+	}
+	fclose( f );
+
+	Com_Printf( "Wrote %i golden snapshots to %s\n", bench_numPackets, filename );
+}
+
+/*
+=================
+Bench_VerifyGolden
+
+Returns qfalse if any snapshot was encoded differently
+=================
+*/
+static qboolean Bench_VerifyGolden( const char *filename ) {
+	benchPacket_t	*packet;
+	byte			*golden;
+	int				length, pos, size, i, j;
+	int				header[3];
+
+	golden = Bench_ReadFile( filename, &length );
+
+	if ( length < sizeof( header ) ) {
+		Com_Error( ERR_FATAL, "%s isn't a golden file", filename );
+	}
+	Com_Memcpy( header, golden, sizeof( header ) );
+	if ( header[0] != GOLDEN_IDENT || header[1] != GOLDEN_VERSION ) {
+		Com_Error( ERR_FATAL, "%s isn't a golden file", filename );
+	}
+	if ( header[2] != bench_numPackets ) {
+		Com_Printf( "FAILED: %s has %i snapshots, the capture %i\n", filename, header[2], bench_numPackets );
+		return qfalse;
+	}
+
+	pos = sizeof( header );
+	for ( i = 0, packet = bench_packets; i < bench_numPackets; i++, packet++ ) {
+		if ( pos + sizeof( int ) > length ) {
+			Com_Error( ERR_FATAL, "%s is cut short", filename );
+		}
+		Com_Memcpy( &size, golden + pos, sizeof( int ) );
+		pos += sizeof( int );
+		if ( size < 0 || pos + size > length ) {
+			Com_Error( ERR_FATAL, "%s is cut short", filename );
+		}
+
+		if ( size != packet->size ) {
+			Com_Printf( "FAILED: snapshot %i is %i bytes, %i in %s\n", i, packet->size, size, filename );
+			return qfalse;
+		}
+		for ( j = 0; j < size; j++ ) {
+			if ( golden[pos + j] != bench_packetData[packet->offset + j] ) {
+				Com_Printf( "FAILED: snapshot %i differs from %s at byte %i\n", i, filename, j );
+				return qfalse;
+			}
+		}
+		pos += size;
+	}
+
+	free( golden );
+	Com_Printf( "%i snapshots match %s\n", bench_numPackets, filename );
+	return qtrue;
+}
+
+/*
+=================
+Bench_Usage
+=================
+*/
+static void Bench_Usage( void ) {
+	printf( "usage: msgbench [options] <file.msgs>\n"
+		"  -passes <count>   times to encode and decode, the fastest is shown (default 5)\n"
+		"  -golden <file>    save the encoded snapshots\n"
+		"  -verify <file>    compare the encoded snapshots with saved ones, exit 1 if they differ\n" );
+	exit( 1 );
+}
+
+int main( int argc, char **argv ) {
+	const char	*capture, *golden, *verify;
+	int64_t		usec, bestEncode, bestDecode;
+	int			passes, pass, mismatches, entities, players, i;
+
+	capture = golden = verify = NULL;
+	passes = 5;
+
+	for ( i = 1; i < argc; i++ ) {
+		if ( !strcmp( argv[i], "-passes" ) && i + 1 < argc ) {
+			passes = atoi( argv[++i] );
+		} else if ( !strcmp( argv[i], "-golden" ) && i + 1 < argc ) {
+			golden = argv[++i];
+		} else if ( !strcmp( argv[i], "-verify" ) && i + 1 < argc ) {
+			verify = argv[++i];
+		} else if ( argv[i][0] != '-' && !capture ) {
+			capture = argv[i];
+		} else {
+			Bench_Usage();
+		}
+	}
+
+	if ( !capture || passes < 1 ) {
+		Bench_Usage();
+	}
+
+	Bench_LoadCapture( capture );
+
+	players = entities = 0;
+	for ( i = 0; i < bench_numDeltas; i++ ) {
+		if ( bench_deltas[i].type == MSGC_PLAYERSTATE ) {
+			players++;
+		} else if ( Bench_EntityWritten( &bench_deltas[i] ) ) {
+			entities++;
+		}
+	}
+
+	bestEncode = bestDecode = 0;
+	mismatches = 0;
+	for ( pass = 0; pass < passes; pass++ ) {
+		usec = Bench_Encode();
+		if ( !pass || usec < bestEncode ) {
+			bestEncode = usec;
+		}
+
+		usec = Bench_Decode( &mismatches );
+		if ( !pass || usec < bestDecode ) {
+			bestDecode = usec;
+		}
+	}
+
+	Com_Printf( "%i snapshots, %i player states, %i entity deltas, %i bytes, %.1f bytes a snapshot\n",
+		bench_numPackets, players, entities, bench_packetDataSize, bench_packetDataSize / (float)bench_numPackets );
+	Com_Printf( "encode %8.2f ms %10.0f snapshots/s %8.1f MB/s\n", bestEncode / 1000.0,
+		bestEncode ? bench_numPackets * 1000000.0 / bestEncode : 0.0,
+		bestEncode ? bench_packetDataSize / (double)bestEncode : 0.0 );
+	Com_Printf( "decode %8.2f ms %10.0f snapshots/s %8.1f MB/s\n", bestDecode / 1000.0,
+		bestDecode ? bench_numPackets * 1000000.0 / bestDecode : 0.0,
+		bestDecode ? bench_packetDataSize / (double)bestDecode : 0.0 );
+	if ( mismatches ) {
+		Com_Printf( "WARNING: %i states didn't decode to what was encoded\n", mismatches );
+	}
+
+	if ( golden ) {
+		Bench_WriteGolden( golden );
+	}
+	if ( verify && !Bench_VerifyGolden( verify ) ) {
+		return 1;
+	}
+
+	return 0;
+}
@@ -7,19 +7,42 @@ and resolves @REFERENCE strings used in menu definitions.
 
 #include "ui_local.h"
 
-/* Open-addressing hash table (linear probing).
-   Strings are stored in a shared pool to keep per-entry overhead small. */
-
-#define LOC_HASH_SIZE   8192            /* must be power of 2 */
-#define MAX_LOC_ENTRIES 5500
-#define LOC_POOL_SIZE   (512 * 1024)    /* 512 KB for all key+value strings */
-
-static unsigned short loc_hash[LOC_HASH_SIZE]; /* 0=empty, else entry index+1 */
-static int   loc_key_ofs[MAX_LOC_ENTRIES];
-static int   loc_val_ofs[MAX_LOC_ENTRIES];
-static char  loc_pool[LOC_POOL_SIZE];
-static int   loc_pool_used;
-static int   loc_count;
+/* The strings are kept in one blob: a header, an open-addressing hash
+   table of { full hash, key offset, value offset } at most half full,
+   and the key and value strings. It is built from the .str files the
+   first time and saved as cache/localize/<language>.loc, later loads
+   checksum the .str files and read the blob back in one go when they
+   are unchanged, without tokenizing them. Only the blob size is capped,
+   not the number of strings. */
+
+#define LOC_LANGUAGE    "english"
+#define LOC_IDENT       (('C'<<24)+('O'<<16)+('L'<<8)+'U')
+#define LOC_VERSION     1
+#define LOC_BLOB_SIZE   (1024 * 1024)
+#define LOC_STAGE_SIZE  (512 * 1024)    /* key/value pairs as parsed */
+
+typedef struct {
+	int ident;
+	int version;
+	int checksum;
+	int numStrings;
+	int hashSize;                       /* power of 2, > 2 * numStrings */
+	int size;                           /* of the whole blob */
+} locHeader_t;
+
+typedef struct {
+	unsigned int hash;
+	int key;                            /* 0=empty, else blob offset */
+	int value;
+} locSlot_t;
+
+static int       loc_blob[LOC_BLOB_SIZE / sizeof(int)];
+static locHeader_t *loc_header;         /* NULL until a blob is loaded */
+static locSlot_t *loc_slots;
+
+static char      loc_stage[LOC_STAGE_SIZE];
+static int       loc_stage_used;
+static int       loc_stage_count;
 
 /* ------------------------------------------------------------------ */
 
@@ -30,47 +53,19 @@ static unsigned int Loc_HashStr(const char *s) {
 		if (c >= 'a' && c <= 'z') c -= 32; /* to upper */
 		h = ((h << 5) + h) ^ c;
 	}
-	return h & (LOC_HASH_SIZE - 1);
-}
-
-static int Loc_PoolAdd(const char *s, int len) {
-	int ofs = loc_pool_used;
-	if (ofs + len + 1 > LOC_POOL_SIZE) return -1;
-	Com_Memcpy(loc_pool + ofs, s, len);
-	loc_pool[ofs + len] = '\0';
-	loc_pool_used += len + 1;
-	return ofs;
+	return h;
 }
 
+/* Appends key\0value\0 to the stage, later pairs win when the blob
+   is built */
 static void Loc_Store(const char *key, int keyLen, const char *val, int valLen) {
-	unsigned int h;
-	int slot, i, ko, vo;
-
-	if (loc_count >= MAX_LOC_ENTRIES) return;
-
-	h = Loc_HashStr(key);
+	if (loc_stage_used + keyLen + valLen + 2 > LOC_STAGE_SIZE) return;
 
-	/* linear probe to find empty or matching slot */
-	for (i = 0; i < LOC_HASH_SIZE; i++) {
-		slot = (h + i) & (LOC_HASH_SIZE - 1);
-		if (loc_hash[slot] == 0) break;                         /* empty */
-		if (Q_stricmp(loc_pool + loc_key_ofs[loc_hash[slot]-1], key) == 0) {
-			/* already stored — update value */
-			vo = Loc_PoolAdd(val, valLen);
-			if (vo >= 0) loc_val_ofs[loc_hash[slot]-1] = vo;
-			return;
-		}
-	}
-	if (i == LOC_HASH_SIZE) return; /* table full */
-
-	ko = Loc_PoolAdd(key, keyLen);
-	vo = Loc_PoolAdd(val, valLen);
-	if (ko < 0 || vo < 0) return;
-
-	loc_key_ofs[loc_count] = ko;
-	loc_val_ofs[loc_count] = vo;
-	loc_hash[slot] = (unsigned short)(loc_count + 1);
-	loc_count++;
+	Com_Memcpy(loc_stage + loc_stage_used, key, keyLen + 1);
+	loc_stage_used += keyLen + 1;
+	Com_Memcpy(loc_stage + loc_stage_used, val, valLen + 1);
+	loc_stage_used += valLen + 1;
+	loc_stage_count++;
 }
 
 /* ------------------------------------------------------------------ */
@@ -143,58 +138,196 @@ static void ParseStrBuf(const char *buf, int len) {
 
 /* ------------------------------------------------------------------ */
 
+/* Returns the slot key is in, or the empty one it would go in */
+static locSlot_t *Loc_FindSlot(locSlot_t *slots, int hashSize, const char *base,
+                               const char *key, unsigned int hash) {
+	int slot = hash & (hashSize - 1);
+	while (slots[slot].key) {
+		if (slots[slot].hash == hash && Q_stricmp(base + slots[slot].key, key) == 0) break;
+		slot = (slot + 1) & (hashSize - 1);
+	}
+	return &slots[slot];
+}
+
+/* Lays the staged pairs out as a blob in loc_blob */
+static qboolean Loc_BuildBlob(unsigned int checksum) {
+	locHeader_t *header = (locHeader_t *)loc_blob;
+	locSlot_t   *slots  = (locSlot_t *)(header + 1);
+	locSlot_t   *slot;
+	char        *blob   = (char *)loc_blob;
+	const char  *key, *val;
+	unsigned int hash;
+	int hashSize, size, len, i;
+
+	hashSize = 16;
+	while (hashSize <= loc_stage_count * 2) hashSize <<= 1;
+
+	size = sizeof(*header) + hashSize * sizeof(*slots);
+	if (size > LOC_BLOB_SIZE) return qfalse;
+	Com_Memset(slots, 0, hashSize * sizeof(*slots));
+
+	/* stage offsets to begin with, so a later pair replaces the value */
+	for (key = loc_stage + 1; key < loc_stage + loc_stage_used; key = val + strlen(val) + 1) {
+		val  = key + strlen(key) + 1;
+		hash = Loc_HashStr(key);
+		slot = Loc_FindSlot(slots, hashSize, loc_stage, key, hash);
+		slot->hash  = hash;
+		slot->key   = key - loc_stage;
+		slot->value = val - loc_stage;
+	}
+
+	header->numStrings = 0;
+	for (i = 0; i < hashSize; i++) {
+		if (!slots[i].key) continue;
+
+		key = loc_stage + slots[i].key;
+		val = loc_stage + slots[i].value;
+		len = strlen(key) + strlen(val) + 2;
+		if (size + len > LOC_BLOB_SIZE) return qfalse;
+
+		slots[i].key = size;
+		Com_Memcpy(blob + size, key, strlen(key) + 1);
+		slots[i].value = size + strlen(key) + 1;
+		Com_Memcpy(blob + slots[i].value, val, strlen(val) + 1);
+		size += len;
+		header->numStrings++;
+	}
+
+	header->ident    = LOC_IDENT;
+	header->version  = LOC_VERSION;
+	header->checksum = checksum;
+	header->hashSize = hashSize;
+	header->size     = size;
+	return qtrue;
+}
+
+/* Reads a saved blob into loc_blob, checking it can be trusted */
+static qboolean Loc_LoadBlob(const char *path, unsigned int checksum) {
+	locHeader_t *header = (locHeader_t *)loc_blob;
+	locSlot_t   *slots  = (locSlot_t *)(header + 1);
+	const char  *blob   = (const char *)loc_blob;
+	fileHandle_t f;
+	int len, strings, i;
+
+	len = trap_FS_FOpenFile(path, &f, FS_READ);
+	if (!f) return qfalse;
+	if (len < (int)sizeof(*header) || len > LOC_BLOB_SIZE) {
+		trap_FS_FCloseFile(f);
+		return qfalse;
+	}
+	trap_FS_Read(loc_blob, len, f);
+	trap_FS_FCloseFile(f);
+
+	if (header->ident != LOC_IDENT || header->version != LOC_VERSION
+		|| header->checksum != (int)checksum || header->size != len) return qfalse;
+
+	if (header->hashSize < 16 || (header->hashSize & (header->hashSize - 1))
+		|| header->numStrings < 0 || header->numStrings * 2 >= header->hashSize
+		|| header->hashSize > (len - (int)sizeof(*header)) / (int)sizeof(*slots)) return qfalse;
+
+	strings = sizeof(*header) + header->hashSize * sizeof(*slots);
+	if (strings >= len || blob[len - 1] != '\0') return qfalse;
+
+	for (i = 0; i < header->hashSize; i++) {
+		if (!slots[i].key) continue;
+		if (slots[i].key < strings || slots[i].key >= len
+			|| slots[i].value < strings || slots[i].value >= len) return qfalse;
+	}
+	return qtrue;
+}
+
+/* ------------------------------------------------------------------ */
+
 #define LOC_FILE_BUF (256 * 1024)
 static char loc_filebuf[LOC_FILE_BUF];
 
+/* Reads a .str file into loc_filebuf, returns its length or -1 */
+static int Loc_ReadFile(const char *name, qboolean warn) {
+	fileHandle_t f;
+	char path[MAX_QPATH];
+	int  flen;
+
+	Com_sprintf(path, sizeof(path), "localizedstrings/" LOC_LANGUAGE "/%s", name);
+	flen = trap_FS_FOpenFile(path, &f, FS_READ);
+	if (!f) return -1;
+	if (flen >= LOC_FILE_BUF) {
+		if (warn) trap_Print(va(S_COLOR_YELLOW "Localize_Init: %s too large (%i bytes)\n", path, flen));
+		trap_FS_FCloseFile(f);
+		return -1;
+	}
+	trap_FS_Read(loc_filebuf, flen, f);
+	loc_filebuf[flen] = '\0';
+	trap_FS_FCloseFile(f);
+	return flen;
+}
+
 void Localize_Init(void) {
 	char filelist[4096];
-	int  count, i;
+	char path[MAX_QPATH];
+	unsigned int checksum;
+	qboolean cached;
+	fileHandle_t f;
+	int  count, flen, i, j;
 	const char *fp;
 
-	Com_Memset(loc_hash,    0, sizeof(loc_hash));
-	Com_Memset(loc_key_ofs, 0, sizeof(loc_key_ofs));
-	Com_Memset(loc_val_ofs, 0, sizeof(loc_val_ofs));
-	loc_pool_used = 0;
-	loc_count     = 0;
+	loc_header = NULL;
+	loc_slots  = NULL;
 
-	count = trap_FS_GetFileList("localizedstrings/english", ".str",
+	count = trap_FS_GetFileList("localizedstrings/" LOC_LANGUAGE, ".str",
 	                            filelist, sizeof(filelist));
 
+	/* the names and contents of the .str files */
+	checksum = 2166136261u ^ LOC_VERSION;
 	fp = filelist;
 	for (i = 0; i < count; i++, fp += strlen(fp) + 1) {
-		fileHandle_t f;
-		char path[MAX_QPATH];
-		int  flen;
-
-		Com_sprintf(path, sizeof(path), "localizedstrings/english/%s", fp);
-		flen = trap_FS_FOpenFile(path, &f, FS_READ);
-		if (!f) continue;
-		if (flen >= LOC_FILE_BUF) {
-			trap_Print(va(S_COLOR_YELLOW "Localize_Init: %s too large (%i bytes)\n", path, flen));
+		for (j = 0; fp[j]; j++) checksum = (checksum ^ (unsigned char)fp[j]) * 16777619;
+		flen = Loc_ReadFile(fp, qtrue);
+		checksum = (checksum ^ flen) * 16777619;
+		for (j = 0; j < flen; j++) checksum = (checksum ^ (unsigned char)loc_filebuf[j]) * 16777619;
+	}
+
+	Com_sprintf(path, sizeof(path), "cache/localize/%s.loc", LOC_LANGUAGE);
+	cached = Loc_LoadBlob(path, checksum);
+	if (!cached) {
+		loc_stage[0]    = '\0';         /* offset 0 stays unused */
+		loc_stage_used  = 1;
+		loc_stage_count = 0;
+
+		fp = filelist;
+		for (i = 0; i < count; i++, fp += strlen(fp) + 1) {
+			flen = Loc_ReadFile(fp, qfalse);
+			if (flen >= 0) ParseStrBuf(loc_filebuf, flen);
+		}
+
+		if (!Loc_BuildBlob(checksum)) {
+			trap_Print(S_COLOR_YELLOW "Localize_Init: strings don't fit\n");
+			return;
+		}
+
+		trap_FS_FOpenFile(path, &f, FS_WRITE);
+		if (f) {
+			trap_FS_Write(loc_blob, ((locHeader_t *)loc_blob)->size, f);
 			trap_FS_FCloseFile(f);
-			continue;
 		}
-		trap_FS_Read(loc_filebuf, flen, f);
-		loc_filebuf[flen] = '\0';
-		trap_FS_FCloseFile(f);
-		ParseStrBuf(loc_filebuf, flen);
 	}
 
-	trap_Print(va("Localize_Init: loaded %i strings from %i files\n", loc_count, count));
+	loc_header = (locHeader_t *)loc_blob;
+	loc_slots  = (locSlot_t *)(loc_header + 1);
+
+	trap_Print(va("Localize_Init: loaded %i strings from %i files%s\n",
+	              loc_header->numStrings, count, cached ? " (cached)" : ""));
 }
 
 /* ------------------------------------------------------------------ */
 
 static const char *Loc_Lookup(const char *key) {
-	unsigned int h = Loc_HashStr(key);
-	int i, slot;
-	for (i = 0; i < LOC_HASH_SIZE; i++) {
-		slot = (h + i) & (LOC_HASH_SIZE - 1);
-		if (loc_hash[slot] == 0) break;
-		if (Q_stricmp(loc_pool + loc_key_ofs[loc_hash[slot]-1], key) == 0)
-			return loc_pool + loc_val_ofs[loc_hash[slot]-1];
-	}
-	return NULL;
+	locSlot_t *slot;
+
+	if (!loc_header) return NULL;
+
+	slot = Loc_FindSlot(loc_slots, loc_header->hashSize, (const char *)loc_blob,
+	                    key, Loc_HashStr(key));
+	return slot->key ? (const char *)loc_blob + slot->value : NULL;
 }
 
 const char *Localize_GetString(const char *key) {
@@ -691,7 +691,7 @@ qboolean Asset_Parse(int handle) {
 	pc_token_t token;
 	const char *tempStr;
 
-	if (!trap_PC_ReadToken(handle, &token))
+	if (!PC_ReadToken(handle, &token))
 		return qfalse;
 	if (Q_stricmp(token.string, "{") != 0) {
 		return qfalse;
@@ -701,7 +701,7 @@ qboolean Asset_Parse(int handle) {
 
 		memset(&token, 0, sizeof(pc_token_t));
 
-		if (!trap_PC_ReadToken(handle, &token))
+		if (!PC_ReadToken(handle, &token))
 			return qfalse;
 
 		if (Q_stricmp(token.string, "}") == 0) {
@@ -859,14 +859,14 @@ void UI_ParseMenu(const char *menuFile) {
 
 	Com_Printf("Parsing menu file: %s\n", menuFile);
 
-	handle = trap_PC_LoadSource(menuFile);
+	handle = PC_LoadSource(menuFile);
 	if (!handle) {
 		return;
 	}
 
 	while ( 1 ) {
 		memset(&token, 0, sizeof(pc_token_t));
-		if (!trap_PC_ReadToken( handle, &token )) {
+		if (!PC_ReadToken( handle, &token )) {
 			break;
 		}
 
@@ -897,13 +897,13 @@ void UI_ParseMenu(const char *menuFile) {
 			Menu_New(handle);
 		}
 	}
-	trap_PC_FreeSource(handle);
+	PC_FreeSource(handle);
 }
 
 qboolean Load_Menu(int handle) {
 	pc_token_t token;
 
-	if (!trap_PC_ReadToken(handle, &token))
+	if (!PC_ReadToken(handle, &token))
 		return qfalse;
 	if (token.string[0] != '{') {
 		return qfalse;
@@ -911,7 +911,7 @@ qboolean Load_Menu(int handle) {
 
 	while ( 1 ) {
 
-		if (!trap_PC_ReadToken(handle, &token))
+		if (!PC_ReadToken(handle, &token))
 			return qfalse;
     
 		if ( token.string[0] == 0 ) {
@@ -934,10 +934,10 @@ void UI_LoadMenus(const char *menuFile, qboolean reset) {
 
 	start = trap_Milliseconds();
 
-	handle = trap_PC_LoadSource( menuFile );
+	handle = PC_LoadSource( menuFile );
 	if (!handle) {
 		Com_Printf( S_COLOR_YELLOW "menu file not found: %s, using default\n", menuFile );
-		handle = trap_PC_LoadSource( "ui/menus.txt" );
+		handle = PC_LoadSource( "ui/menus.txt" );
 		if (!handle) {
 			trap_Error( S_COLOR_RED "default menu file not found: ui/menus.txt, unable to continue!" );
 		}
@@ -950,7 +950,7 @@ void UI_LoadMenus(const char *menuFile, qboolean reset) {
 	}
 
 	while ( 1 ) {
-		if (!trap_PC_ReadToken(handle, &token))
+		if (!PC_ReadToken(handle, &token))
 			break;
 		if( token.string[0] == 0 || token.string[0] == '}') {
 			break;
@@ -971,7 +971,7 @@ void UI_LoadMenus(const char *menuFile, qboolean reset) {
 
 	Com_Printf("UI menu load time = %d milli seconds\n", trap_Milliseconds() - start);
 
-	trap_PC_FreeSource( handle );
+	PC_FreeSource( handle );
 }
 
 void UI_Load(void) {
@@ -5713,6 +5713,7 @@ vmCvar_t	ui_netSource;
 vmCvar_t	ui_serverFilterType;
 vmCvar_t	ui_opponentName;
 vmCvar_t	ui_menuFiles;
+vmCvar_t	ui_menuCache;
 vmCvar_t	ui_currentTier;
 vmCvar_t	ui_currentMap;
 vmCvar_t	ui_currentNetMap;
@@ -5834,6 +5835,7 @@ static cvarTable_t		cvarTable[] = {
 	{ &ui_blueteam5, "ui_blueteam5", "0", CVAR_ARCHIVE },
 	{ &ui_netSource, "ui_netSource", "1", CVAR_ARCHIVE },
 	{ &ui_menuFiles, "ui_menuFiles", "ui/menus.txt", CVAR_ARCHIVE },
+	{ &ui_menuCache, "ui_menuCache", "1", CVAR_ARCHIVE },
 	{ &ui_currentTier, "ui_currentTier", "0", CVAR_ARCHIVE },
 	{ &ui_currentMap, "ui_currentMap", "0", CVAR_ARCHIVE },
 	{ &ui_currentNetMap, "ui_currentNetMap", "0", CVAR_ARCHIVE },
@@ -5904,16 +5906,8 @@ UI_UpdateCvars
 =================
 */
 void UI_UpdateCvars( void ) {
-	int			i;
-	cvarTable_t	*cv;
-
-	for ( i = 0, cv = cvarTable ; i < cvarTableSize ; i++, cv++ ) {
-		if ( !cv->vmCvar ) {
-			continue;
-		}
-
-		trap_Cvar_Update( cv->vmCvar );
-	}
+	// the engine refreshes the changed vmCvars itself
+	trap_Cvar_UpdateChanged();
 }
 
 
@@ -125,6 +125,10 @@ typedef enum {
 	UI_FS_SEEK,
 	UI_SET_PBCLSTATUS,
 
+	UI_CVAR_UPDATE_CHANGED,	// ( void );
+	// updates every registered vmCvar_t whose cvar changed since the
+	// last call, returns how many did
+
 	UI_MEMSET = 100,
 	UI_MEMCPY,
 	UI_STRNCPY,
@@ -57,6 +57,10 @@ static itemDef_t *g_editItem = NULL;
 menuDef_t Menus[MAX_MENUS];      // defined menus
 int menuCount = 0;               // how many
 
+#define MENUHASH_SIZE 64
+static int menuHash[MENUHASH_SIZE];   // menus by name, index + 1
+static int menuHashNext[MAX_MENUS];
+
 menuDef_t *menuStack[MAX_OPEN_MENUS];
 int openMenuCount = 0;
 
@@ -68,6 +72,8 @@ static int lastListBoxClickTime = 0;
 void Item_RunScript(itemDef_t *item, const char *s);
 void Item_SetupKeywordHash(void);
 void Menu_SetupKeywordHash(void);
+void Script_SetupCommandHash(void);
+int KeywordHash_Key(const char *keyword);
 int BindingIDFromName(const char *name);
 qboolean Item_Bind_HandleKey(itemDef_t *item, int key, qboolean down);
 itemDef_t *Menu_SetPrevCursorItem(menuDef_t *menu);
@@ -240,15 +246,496 @@ void String_Init(void) {
 	strHandleCount = 0;
 	strPoolIndex = 0;
 	menuCount = 0;
+	memset(menuHash, 0, sizeof(menuHash));
 	openMenuCount = 0;
 	UI_InitMemory();
 	Item_SetupKeywordHash();
 	Menu_SetupKeywordHash();
+	Script_SetupCommandHash();
 	if (DC && DC->getBindingBuf) {
 		Controls_GetConfig();
 	}
 }
 
+/*
+=================
+Menu source cache
+
+The precompiler hands out menu sources a token per syscall and expands
+the includes and defines of every file again on each load. The tokens a
+source gave are kept in cache/menus/<source>.pc behind a checksum of the
+source and the files it includes, later loads of the unchanged source
+read them back a block at a time. Parsing goes on from the tokens as
+before, so assets are still registered by it. ui_menuCache 0 turns the
+cache off.
+=================
+*/
+
+#define PC_CACHE_IDENT		(('C'<<24)+('C'<<16)+('P'<<8)+'M')
+#define PC_CACHE_VERSION	1
+#define PC_CACHE_HANDLE		0x10000		// above the precompiler's handles
+#define PC_CACHE_SOURCES	4			// open at once
+#define PC_CACHE_BLOCK		16384
+#define PC_CACHE_INCLUDES	32
+#define PC_CACHE_DEPTH		8
+
+// token types that are not tokens
+#define PC_CACHE_FILE		-1			// the source name the following come from
+#define PC_CACHE_NONE		-2			// a read failed
+#define PC_CACHE_END		-3			// written when the source was freed
+
+typedef struct {
+	int		ident;
+	int		version;
+	int		checksum;
+} pcCacheHeader_t;
+
+typedef struct {
+	int		type;
+	int		subtype;
+	int		intvalue;
+	float	floatvalue;
+	int		line;
+	int		length;			// of the string following it
+} pcCacheToken_t;
+
+typedef struct {
+	qboolean		inuse;
+	int				handle;			// precompiler source being recorded, 0 when reading
+	fileHandle_t	file;
+	int				remaining;		// bytes of the file behind the block
+	int				blockPos, blockLen;
+	char			filename[128];
+	int				line;
+	byte			block[PC_CACHE_BLOCK];
+} pcCache_t;
+
+static pcCache_t	pcCaches[PC_CACHE_SOURCES];
+
+static char			pcIncludes[PC_CACHE_INCLUDES][MAX_QPATH];
+static int			pcNumIncludes;
+
+/*
+=================
+PC_CacheChecksumFile
+
+Folds the file and anything it includes into the checksum, returns
+qfalse if it doesn't exist
+=================
+*/
+static qboolean PC_CacheChecksumFile( const char *filename, unsigned *checksum, int depth ) {
+	char			includes[8][MAX_QPATH];
+	char			line[256];
+	byte			buffer[1024];
+	fileHandle_t	f;
+	int				len, count, lineLen, numIncludes;
+	int				i, j;
+	char			*s, *end;
+
+	len = trap_FS_FOpenFile( filename, &f, FS_READ );
+	if ( !f ) {
+		return qfalse;
+	}
+
+	*checksum = ( *checksum ^ len ) * 16777619;
+
+	numIncludes = 0;
+	lineLen = 0;
+	while ( len > 0 ) {
+		count = MIN( len, sizeof( buffer ) );
+		trap_FS_Read( buffer, count, f );
+		len -= count;
+
+		for ( i = 0; i < count; i++ ) {
+			*checksum = ( *checksum ^ buffer[i] ) * 16777619;
+
+			if ( buffer[i] != '\n' && lineLen < sizeof( line ) - 1 ) {
+				line[lineLen++] = buffer[i];
+			}
+			if ( buffer[i] != '\n' && len + count - i > 1 ) {
+				continue;
+			}
+
+			// a line ended, look for #include "file" or <file>
+			line[lineLen] = '\0';
+			lineLen = 0;
+			for ( s = line; *s == ' ' || *s == '\t'; s++ ) {
+			}
+			if ( Q_strncmp( s, "#include", 8 ) || numIncludes == ARRAY_LEN( includes ) ) {
+				continue;
+			}
+			for ( s += 8; *s == ' ' || *s == '\t'; s++ ) {
+			}
+			if ( *s != '"' && *s != '<' ) {
+				continue;
+			}
+			end = strchr( s + 1, *s == '"' ? '"' : '>' );
+			if ( !end || end - s - 1 >= MAX_QPATH ) {
+				continue;
+			}
+			*end = '\0';
+			Q_strncpyz( includes[numIncludes++], s + 1, MAX_QPATH );
+		}
+	}
+
+	trap_FS_FCloseFile( f );
+
+	if ( depth == PC_CACHE_DEPTH ) {
+		return qtrue;
+	}
+
+	for ( i = 0; i < numIncludes; i++ ) {
+		// each file once
+		for ( j = 0; j < pcNumIncludes; j++ ) {
+			if ( !Q_stricmp( pcIncludes[j], includes[i] ) ) {
+				break;
+			}
+		}
+		if ( j < pcNumIncludes || pcNumIncludes == PC_CACHE_INCLUDES ) {
+			continue;
+		}
+		Q_strncpyz( pcIncludes[pcNumIncludes++], includes[i], MAX_QPATH );
+
+		// one that is missing now may not be later
+		if ( !PC_CacheChecksumFile( includes[i], checksum, depth + 1 ) ) {
+			*checksum = ( *checksum ^ 0xff ) * 16777619;
+		}
+	}
+
+	return qtrue;
+}
+
+/*
+=================
+PC_CacheWrite
+=================
+*/
+static void PC_CacheWrite( pcCache_t *cache, const void *data, int length ) {
+	if ( cache->blockLen + length > PC_CACHE_BLOCK ) {
+		trap_FS_Write( cache->block, cache->blockLen, cache->file );
+		cache->blockLen = 0;
+	}
+	memcpy( cache->block + cache->blockLen, data, length );
+	cache->blockLen += length;
+}
+
+/*
+=================
+PC_CacheWriteToken
+=================
+*/
+static void PC_CacheWriteToken( pcCache_t *cache, int type, const pc_token_t *pc_token, const char *string ) {
+	pcCacheToken_t	token;
+
+	memset( &token, 0, sizeof( token ) );
+	token.type = type;
+	if ( pc_token ) {
+		token.subtype = pc_token->subtype;
+		token.intvalue = pc_token->intvalue;
+		token.floatvalue = pc_token->floatvalue;
+	}
+	token.line = cache->line;
+	token.length = string ? strlen( string ) : 0;
+
+	PC_CacheWrite( cache, &token, sizeof( token ) );
+	PC_CacheWrite( cache, string, token.length );
+}
+
+/*
+=================
+PC_CacheRecord
+
+Called for every read of a source being recorded
+=================
+*/
+static void PC_CacheRecord( pcCache_t *cache, const pc_token_t *pc_token ) {
+	char	filename[128];
+
+	if ( !pc_token ) {
+		PC_CacheWriteToken( cache, PC_CACHE_NONE, NULL, NULL );
+		return;
+	}
+
+	filename[0] = '\0';
+	cache->line = 0;
+	trap_PC_SourceFileAndLine( cache->handle, filename, &cache->line );
+	if ( strcmp( filename, cache->filename ) ) {
+		Q_strncpyz( cache->filename, filename, sizeof( cache->filename ) );
+		PC_CacheWriteToken( cache, PC_CACHE_FILE, NULL, cache->filename );
+	}
+
+	PC_CacheWriteToken( cache, pc_token->type, pc_token, pc_token->string );
+}
+
+/*
+=================
+PC_CacheRead
+=================
+*/
+static qboolean PC_CacheRead( pcCache_t *cache, void *data, int length ) {
+	int		count;
+
+	if ( cache->blockPos + length > cache->blockLen ) {
+		// move what is left to the front and fill up behind it
+		cache->blockLen -= cache->blockPos;
+		memmove( cache->block, cache->block + cache->blockPos, cache->blockLen );
+		cache->blockPos = 0;
+
+		count = MIN( PC_CACHE_BLOCK - cache->blockLen, cache->remaining );
+		trap_FS_Read( cache->block + cache->blockLen, count, cache->file );
+		cache->blockLen += count;
+		cache->remaining -= count;
+
+		if ( length > cache->blockLen ) {
+			return qfalse;
+		}
+	}
+
+	memcpy( data, cache->block + cache->blockPos, length );
+	cache->blockPos += length;
+	return qtrue;
+}
+
+/*
+=================
+PC_CacheOpen
+=================
+*/
+static qboolean PC_CacheOpen( pcCache_t *cache, const char *filename, int checksum ) {
+	pcCacheHeader_t	header;
+	pcCacheToken_t	end;
+	int				len;
+
+	len = trap_FS_FOpenFile( va( "cache/menus/%s.pc", filename ), &cache->file, FS_READ );
+	if ( !cache->file ) {
+		return qfalse;
+	}
+
+	if ( len < sizeof( header ) + sizeof( end ) ) {
+		trap_FS_FCloseFile( cache->file );
+		return qfalse;
+	}
+
+	trap_FS_Read( &header, sizeof( header ), cache->file );
+
+	// the end marker is only there if the recording was finished
+	trap_FS_Seek( cache->file, len - sizeof( end ), FS_SEEK_SET );
+	trap_FS_Read( &end, sizeof( end ), cache->file );
+
+	if ( header.ident != PC_CACHE_IDENT || header.version != PC_CACHE_VERSION
+		|| header.checksum != checksum || end.type != PC_CACHE_END ) {
+		trap_FS_FCloseFile( cache->file );
+		return qfalse;
+	}
+
+	trap_FS_Seek( cache->file, sizeof( header ), FS_SEEK_SET );
+
+	cache->inuse = qtrue;
+	cache->handle = 0;
+	cache->remaining = len - sizeof( header );
+	cache->blockPos = cache->blockLen = 0;
+	cache->filename[0] = '\0';
+	cache->line = 0;
+	return qtrue;
+}
+
+/*
+=================
+PC_CacheCreate
+=================
+*/
+static void PC_CacheCreate( pcCache_t *cache, int handle, const char *filename, int checksum ) {
+	pcCacheHeader_t	header;
+
+	trap_FS_FOpenFile( va( "cache/menus/%s.pc", filename ), &cache->file, FS_WRITE );
+	if ( !cache->file ) {
+		return;
+	}
+
+	cache->inuse = qtrue;
+	cache->handle = handle;
+	cache->blockPos = cache->blockLen = 0;
+	cache->filename[0] = '\0';
+	cache->line = 0;
+
+	header.ident = PC_CACHE_IDENT;
+	header.version = PC_CACHE_VERSION;
+	header.checksum = checksum;
+	PC_CacheWrite( cache, &header, sizeof( header ) );
+}
+
+/*
+=================
+PC_CacheForHandle
+=================
+*/
+static pcCache_t *PC_CacheForHandle( int handle ) {
+	int		i;
+
+	if ( handle >= PC_CACHE_HANDLE && handle < PC_CACHE_HANDLE + PC_CACHE_SOURCES ) {
+		return &pcCaches[handle - PC_CACHE_HANDLE];
+	}
+
+	for ( i = 0; i < PC_CACHE_SOURCES; i++ ) {
+		if ( pcCaches[i].inuse && pcCaches[i].handle == handle ) {
+			return &pcCaches[i];
+		}
+	}
+	return NULL;
+}
+
+/*
+=================
+PC_LoadSource
+
+Returns a cached source if there is a current one, otherwise loads it
+with the precompiler and records its tokens as they are read
+=================
+*/
+int PC_LoadSource( const char *filename ) {
+	pcCache_t	*cache;
+	unsigned	checksum;
+	int			handle, i;
+
+	if ( !DC || !DC->getCVarValue || !DC->getCVarValue( "ui_menuCache" ) ) {
+		return trap_PC_LoadSource( filename );
+	}
+
+	for ( i = 0; i < PC_CACHE_SOURCES; i++ ) {
+		if ( !pcCaches[i].inuse ) {
+			break;
+		}
+	}
+	if ( i == PC_CACHE_SOURCES ) {
+		return trap_PC_LoadSource( filename );
+	}
+	cache = &pcCaches[i];
+
+	checksum = 2166136261u ^ PC_CACHE_VERSION;
+	pcNumIncludes = 0;
+	if ( !PC_CacheChecksumFile( filename, &checksum, 0 ) ) {
+		return trap_PC_LoadSource( filename );
+	}
+
+	if ( PC_CacheOpen( cache, filename, checksum ) ) {
+		return PC_CACHE_HANDLE + i;
+	}
+
+	handle = trap_PC_LoadSource( filename );
+	if ( handle ) {
+		PC_CacheCreate( cache, handle, filename, checksum );
+	}
+	return handle;
+}
+
+/*
+=================
+PC_FreeSource
+=================
+*/
+int PC_FreeSource( int handle ) {
+	pcCache_t	*cache;
+
+	cache = PC_CacheForHandle( handle );
+	if ( cache && cache->handle ) {
+		PC_CacheWriteToken( cache, PC_CACHE_END, NULL, NULL );
+		trap_FS_Write( cache->block, cache->blockLen, cache->file );
+	}
+	if ( cache ) {
+		trap_FS_FCloseFile( cache->file );
+		cache->inuse = qfalse;
+	}
+
+	if ( handle >= PC_CACHE_HANDLE ) {
+		return qtrue;
+	}
+	return trap_PC_FreeSource( handle );
+}
+
+/*
+=================
+PC_ReadToken
+=================
+*/
+int PC_ReadToken( int handle, pc_token_t *pc_token ) {
+	pcCacheToken_t	token;
+	pcCache_t		*cache;
+	int				ret;
+
+	cache = PC_CacheForHandle( handle );
+
+	if ( handle < PC_CACHE_HANDLE ) {
+		ret = trap_PC_ReadToken( handle, pc_token );
+		if ( cache ) {
+			PC_CacheRecord( cache, ret ? pc_token : NULL );
+		}
+		return ret;
+	}
+
+	if ( !cache || !cache->inuse ) {
+		return qfalse;
+	}
+
+	while ( PC_CacheRead( cache, &token, sizeof( token ) ) ) {
+		if ( token.length < 0 || token.length >= MAX_TOKENLENGTH ) {
+			break;
+		}
+
+		if ( token.type == PC_CACHE_FILE ) {
+			if ( token.length >= sizeof( cache->filename ) || !PC_CacheRead( cache, cache->filename, token.length ) ) {
+				break;
+			}
+			cache->filename[token.length] = '\0';
+			continue;
+		}
+
+		if ( token.type == PC_CACHE_END ) {
+			// stay at the end
+			cache->blockPos -= sizeof( token );
+			break;
+		}
+
+		if ( token.type == PC_CACHE_NONE ) {
+			break;
+		}
+
+		if ( !PC_CacheRead( cache, pc_token->string, token.length ) ) {
+			break;
+		}
+		pc_token->string[token.length] = '\0';
+		pc_token->type = token.type;
+		pc_token->subtype = token.subtype;
+		pc_token->intvalue = token.intvalue;
+		pc_token->floatvalue = token.floatvalue;
+		cache->line = token.line;
+		return qtrue;
+	}
+
+	return qfalse;
+}
+
+/*
+=================
+PC_SourceFileAndLine
+=================
+*/
+int PC_SourceFileAndLine( int handle, char *filename, int *line ) {
+	pcCache_t	*cache;
+
+	if ( handle < PC_CACHE_HANDLE ) {
+		return trap_PC_SourceFileAndLine( handle, filename, line );
+	}
+
+	cache = PC_CacheForHandle( handle );
+	if ( !cache || !cache->inuse ) {
+		return qfalse;
+	}
+
+	strcpy( filename, cache->filename );
+	*line = cache->line;
+	return qtrue;
+}
+
 #if 0
 /*
 =================
@@ -267,7 +754,7 @@ static Q_PRINTF_FUNC(2, 3) void PC_SourceWarning(int handle, char *format, ...)
 
 	filename[0] = '\0';
 	line = 0;
-	trap_PC_SourceFileAndLine(handle, filename, &line);
+	PC_SourceFileAndLine(handle, filename, &line);
 
 	Com_Printf(S_COLOR_YELLOW "WARNING: %s, line %d: %s\n", filename, line, string);
 }
@@ -290,7 +777,7 @@ static Q_PRINTF_FUNC(2, 3) void PC_SourceError(int handle, char *format, ...) {
 
 	filename[0] = '\0';
 	line = 0;
-	trap_PC_SourceFileAndLine(handle, filename, &line);
+	PC_SourceFileAndLine(handle, filename, &line);
 
 	Com_Printf(S_COLOR_RED "ERROR: %s, line %d: %s\n", filename, line, string);
 }
@@ -340,10 +827,10 @@ qboolean PC_Float_Parse(int handle, float *f) {
 	pc_token_t token;
 	int negative = qfalse;
 
-	if (!trap_PC_ReadToken(handle, &token))
+	if (!PC_ReadToken(handle, &token))
 		return qfalse;
 	if (token.string[0] == '-') {
-		if (!trap_PC_ReadToken(handle, &token))
+		if (!PC_ReadToken(handle, &token))
 			return qfalse;
 		negative = qtrue;
 	}
@@ -422,10 +909,10 @@ qboolean PC_Int_Parse(int handle, int *i) {
 
 	if (!i)
 		return qfalse;
-	if (!trap_PC_ReadToken(handle, &token))
+	if (!PC_ReadToken(handle, &token))
 		return qfalse;
 	if (token.string[0] == '-') {
-		if (!trap_PC_ReadToken(handle, &token))
+		if (!PC_ReadToken(handle, &token))
 			return qfalse;
 		negative = qtrue;
 	}
@@ -499,7 +986,7 @@ PC_String_Parse
 qboolean PC_String_Parse(int handle, const char **out) {
 	pc_token_t token;
 
-	if (!trap_PC_ReadToken(handle, &token))
+	if (!PC_ReadToken(handle, &token))
 		return qfalse;
 	
 	*(out) = String_Alloc(token.string);
@@ -519,14 +1006,14 @@ qboolean PC_Script_Parse(int handle, const char **out) {
 	// scripts start with { and have ; separated command lists.. commands are command, arg.. 
 	// basically we want everything between the { } as it will be interpreted at run time
   
-	if (!trap_PC_ReadToken(handle, &token))
+	if (!PC_ReadToken(handle, &token))
 		return qfalse;
 	if (Q_stricmp(token.string, "{") != 0) {
 	    return qfalse;
 	}
 
 	while ( 1 ) {
-		if (!trap_PC_ReadToken(handle, &token))
+		if (!PC_ReadToken(handle, &token))
 			return qfalse;
 
 		if (Q_stricmp(token.string, "}") == 0) {
@@ -732,6 +1219,10 @@ void Item_SetScreenCoords(itemDef_t *item, float x, float y) {
   // force the text rects to recompute
   item->textRect.w = 0;
   item->textRect.h = 0;
+
+  if (item->parent) {
+    ((menuDef_t*)item->parent)->hitGridDirty = qtrue;
+  }
 }
 
 // FIXME: consolidate this with nearby stuff
@@ -778,6 +1269,55 @@ void Menu_UpdatePosition(menuDef_t *menu) {
   }
 }
 
+/*
+===============
+Menu_AddItemLink
+
+Links are appended so each chain stays in menu order
+===============
+*/
+static void Menu_AddItemLink(menuDef_t *menu, itemDef_t *item, const char *key, qboolean group) {
+	itemLink_t *link, **tail;
+
+	link = UI_Alloc(sizeof(itemLink_t));
+	if (!link) {
+		return;
+	}
+	link->item = item;
+	link->key = key;
+	link->group = group;
+	link->next = NULL;
+
+	for (tail = &menu->itemHash[KeywordHash_Key(key) & (ITEMHASH_SIZE-1)]; *tail; tail = &(*tail)->next) {
+	}
+	*tail = link;
+}
+
+/*
+===============
+Menu_SetupItemHash
+
+Scripts find items by name or group on every event, the names and
+groups don't change once the menu is parsed
+===============
+*/
+static void Menu_SetupItemHash(menuDef_t *menu) {
+	itemDef_t *item;
+	int i;
+
+	memset(menu->itemHash, 0, sizeof(menu->itemHash));
+	for (i = 0; i < menu->itemCount; i++) {
+		item = menu->items[i];
+		if (item->window.name) {
+			Menu_AddItemLink(menu, item, item->window.name, qfalse);
+		}
+		// an item grouped under its own name matches once
+		if (item->window.group && (!item->window.name || Q_stricmp(item->window.group, item->window.name))) {
+			Menu_AddItemLink(menu, item, item->window.group, qtrue);
+		}
+	}
+}
+
 void Menu_PostParse(menuDef_t *menu) {
 	if (menu == NULL) {
 		return;
@@ -789,6 +1329,7 @@ void Menu_PostParse(menuDef_t *menu) {
 		menu->window.rect.h = 480;
 	}
 	Menu_UpdatePosition(menu);
+	Menu_SetupItemHash(menu);
 }
 
 itemDef_t *Menu_ClearFocus(menuDef_t *menu) {
@@ -825,29 +1366,110 @@ qboolean Rect_ContainsPoint(rectDef_t *rect, float x, float y) {
   return qfalse;
 }
 
-int Menu_ItemsMatchingGroup(menuDef_t *menu, const char *name) {
-  int i;
-  int count = 0;
+/*
+===============
+HitGrid_Cell
+===============
+*/
+static int HitGrid_Cell(float v, int count) {
+  int cell;
+
+  if (v <= 0) {
+    return 0;
+  }
+  cell = v / HITGRID_CELLSIZE;
+  return (cell < count) ? cell : count - 1;
+}
+
+/*
+===============
+Menu_SetupHitGrid
+
+Bins the items by the cells their rects reach into, so a point only
+has to be tested against the items of its own cell
+===============
+*/
+static void Menu_SetupHitGrid(menuDef_t *menu) {
+  int i, x, y, x0, y0, x1, y1;
+  rectDef_t *r;
+
+  memset(menu->hitGrid, 0, sizeof(menu->hitGrid));
+  menu->hitGridDirty = qfalse;
+
   for (i = 0; i < menu->itemCount; i++) {
-    if (Q_stricmp(menu->items[i]->window.name, name) == 0 || (menu->items[i]->window.group && Q_stricmp(menu->items[i]->window.group, name) == 0)) {
-      count++;
-    } 
+    r = &menu->items[i]->window.rect;
+    if (!(r->w > 0 && r->h > 0)) {
+      continue;
+    }
+
+    x0 = HitGrid_Cell(r->x, HITGRID_COLS);
+    x1 = HitGrid_Cell(r->x + r->w, HITGRID_COLS);
+    y0 = HitGrid_Cell(r->y, HITGRID_ROWS);
+    y1 = HitGrid_Cell(r->y + r->h, HITGRID_ROWS);
+    for (y = y0; y <= y1; y++) {
+      for (x = x0; x <= x1; x++) {
+        menu->hitGrid[y * HITGRID_COLS + x][i >> 5] |= 1u << (i & 31);
+      }
+    }
+  }
+}
+
+/*
+===============
+Menu_HitCell
+
+The items that may contain x, y, NULL when it is off screen and
+all of them may
+===============
+*/
+static const unsigned *Menu_HitCell(menuDef_t *menu, float x, float y) {
+  if (!(x >= 0 && x < 640 && y >= 0 && y < 480)) {
+    return NULL;
+  }
+
+  if (menu->hitGridDirty) {
+    Menu_SetupHitGrid(menu);
+  }
+  return menu->hitGrid[(int)(y / HITGRID_CELLSIZE) * HITGRID_COLS + (int)(x / HITGRID_CELLSIZE)];
+}
+
+static qboolean HitCell_HasItem(const unsigned *cell, int i) {
+  return (!cell || cell[i >> 5] & (1u << (i & 31))) ? qtrue : qfalse;
+}
+
+/*
+===============
+Menu_ItemsMatching
+
+Fills items with those named or grouped p, in menu order, and returns
+how many there are. items must hold MAX_MENUITEMS.
+===============
+*/
+int Menu_ItemsMatching(menuDef_t *menu, const char *p, itemDef_t **items) {
+  itemLink_t *link;
+  int count = 0;
+  if (menu == NULL || p == NULL) {
+    return 0;
+  }
+  for (link = menu->itemHash[KeywordHash_Key(p) & (ITEMHASH_SIZE-1)]; link; link = link->next) {
+    if (Q_stricmp(link->key, p) == 0) {
+      items[count++] = link->item;
+    }
   }
   return count;
 }
 
+int Menu_ItemsMatchingGroup(menuDef_t *menu, const char *name) {
+  itemDef_t *items[MAX_MENUITEMS];
+  return Menu_ItemsMatching(menu, name, items);
+}
+
 itemDef_t *Menu_GetMatchingItemByNumber(menuDef_t *menu, int index, const char *name) {
-  int i;
-  int count = 0;
-  for (i = 0; i < menu->itemCount; i++) {
-    if (Q_stricmp(menu->items[i]->window.name, name) == 0 || (menu->items[i]->window.group && Q_stricmp(menu->items[i]->window.group, name) == 0)) {
-      if (count == index) {
-        return menu->items[i];
-      }
-      count++;
-    } 
+  itemDef_t *items[MAX_MENUITEMS];
+  if (index < 0 || index >= Menu_ItemsMatching(menu, name, items)) {
+    return NULL;
   }
-  return NULL;
+  return items[index];
 }
 
 
@@ -903,14 +1525,14 @@ void Script_SetBackground(itemDef_t *item, char **args) {
 
 
 itemDef_t *Menu_FindItemByName(menuDef_t *menu, const char *p) {
-  int i;
+  itemLink_t *link;
   if (menu == NULL || p == NULL) {
     return NULL;
   }
 
-  for (i = 0; i < menu->itemCount; i++) {
-    if (Q_stricmp(p, menu->items[i]->window.name) == 0) {
-      return menu->items[i];
+  for (link = menu->itemHash[KeywordHash_Key(p) & (ITEMHASH_SIZE-1)]; link; link = link->next) {
+    if (!link->group && Q_stricmp(p, link->key) == 0) {
+      return link->item;
     }
   }
 
@@ -936,16 +1558,16 @@ void Script_SetItemColor(itemDef_t *item, char **args) {
   vec4_t *out;
   // expecting type of color to set and 4 args for the color
   if (String_Parse(args, &itemname) && String_Parse(args, &name)) {
-    itemDef_t *item2;
+    itemDef_t *item2, *items[MAX_MENUITEMS];
     int j;
-    int count = Menu_ItemsMatchingGroup(item->parent, itemname);
+    int count = Menu_ItemsMatching(item->parent, itemname, items);
 
     if (!Color_Parse(args, &color)) {
       return;
     }
 
     for (j = 0; j < count; j++) {
-      item2 = Menu_GetMatchingItemByNumber(item->parent, j, itemname);
+      item2 = items[j];
       if (item2 != NULL) {
         out = NULL;
         if (Q_stricmp(name, "backcolor") == 0) {
@@ -969,11 +1591,11 @@ void Script_SetItemColor(itemDef_t *item, char **args) {
 
 
 void Menu_ShowItemByName(menuDef_t *menu, const char *p, qboolean bShow) {
-	itemDef_t *item;
+	itemDef_t *item, *items[MAX_MENUITEMS];
 	int i;
-	int count = Menu_ItemsMatchingGroup(menu, p);
+	int count = Menu_ItemsMatching(menu, p, items);
 	for (i = 0; i < count; i++) {
-		item = Menu_GetMatchingItemByNumber(menu, i, p);
+		item = items[i];
 		if (item != NULL) {
 			if (bShow) {
 				item->window.flags |= WINDOW_VISIBLE;
@@ -990,11 +1612,11 @@ void Menu_ShowItemByName(menuDef_t *menu, const char *p, qboolean bShow) {
 }
 
 void Menu_FadeItemByName(menuDef_t *menu, const char *p, qboolean fadeOut) {
-  itemDef_t *item;
+  itemDef_t *item, *items[MAX_MENUITEMS];
   int i;
-  int count = Menu_ItemsMatchingGroup(menu, p);
+  int count = Menu_ItemsMatching(menu, p, items);
   for (i = 0; i < count; i++) {
-    item = Menu_GetMatchingItemByNumber(menu, i, p);
+    item = items[i];
     if (item != NULL) {
       if (fadeOut) {
         item->window.flags |= (WINDOW_FADINGOUT | WINDOW_VISIBLE);
@@ -1009,14 +1631,35 @@ void Menu_FadeItemByName(menuDef_t *menu, const char *p, qboolean fadeOut) {
 
 menuDef_t *Menus_FindByName(const char *p) {
   int i;
-  for (i = 0; i < menuCount; i++) {
-    if (Q_stricmp(Menus[i].window.name, p) == 0) {
-      return &Menus[i];
+  if (p == NULL) {
+    return NULL;
+  }
+  for (i = menuHash[KeywordHash_Key(p) & (MENUHASH_SIZE-1)]; i; i = menuHashNext[i - 1]) {
+    if (Q_stricmp(Menus[i - 1].window.name, p) == 0) {
+      return &Menus[i - 1];
     } 
   }
   return NULL;
 }
 
+/*
+===============
+Menus_AddToHash
+
+The first menu of a name is the one found
+===============
+*/
+static void Menus_AddToHash(int index) {
+  const char *name = Menus[index].window.name;
+  int hash;
+  if (name == NULL || Menus_FindByName(name)) {
+    return;
+  }
+  hash = KeywordHash_Key(name) & (MENUHASH_SIZE-1);
+  menuHashNext[index] = menuHash[hash];
+  menuHash[hash] = index + 1;
+}
+
 void Menus_ShowByName(const char *p) {
 	menuDef_t *menu = Menus_FindByName(p);
 	if (menu) {
@@ -1143,11 +1786,11 @@ void Script_RestartHide(itemDef_t *item, char **args) {
 }
 
 void Menu_TransitionItemByName(menuDef_t *menu, const char *p, rectDef_t rectFrom, rectDef_t rectTo, int time, float amt) {
-  itemDef_t *item;
+  itemDef_t *item, *items[MAX_MENUITEMS];
   int i;
-  int count = Menu_ItemsMatchingGroup(menu, p);
+  int count = Menu_ItemsMatching(menu, p, items);
   for (i = 0; i < count; i++) {
-    item = Menu_GetMatchingItemByNumber(menu, i, p);
+    item = items[i];
     if (item != NULL) {
       item->window.flags |= (WINDOW_INTRANSITION | WINDOW_VISIBLE);
       item->window.offsetTime = time;
@@ -1178,11 +1821,11 @@ void Script_Transition(itemDef_t *item, char **args) {
 
 
 void Menu_OrbitItemByName(menuDef_t *menu, const char *p, float x, float y, float cx, float cy, int time) {
-  itemDef_t *item;
+  itemDef_t *item, *items[MAX_MENUITEMS];
   int i;
-  int count = Menu_ItemsMatchingGroup(menu, p);
+  int count = Menu_ItemsMatching(menu, p, items);
   for (i = 0; i < count; i++) {
-    item = Menu_GetMatchingItemByNumber(menu, i, p);
+    item = items[i];
     if (item != NULL) {
       item->window.flags |= (WINDOW_ORBITING | WINDOW_VISIBLE);
       item->window.offsetTime = time;
@@ -1305,6 +1948,26 @@ commandDef_t commandList[] =
 
 int scriptCommandCount = ARRAY_LEN(commandList);
 
+#define COMMANDHASH_SIZE 64
+static int commandHash[COMMANDHASH_SIZE];		// index + 1
+static int commandHashNext[ARRAY_LEN(commandList)];
+
+/*
+===============
+Script_SetupCommandHash
+===============
+*/
+void Script_SetupCommandHash(void) {
+  int i, hash;
+
+  memset(commandHash, 0, sizeof(commandHash));
+  for (i = scriptCommandCount - 1; i >= 0; i--) {
+    hash = KeywordHash_Key(commandList[i].name) & (COMMANDHASH_SIZE-1);
+    commandHashNext[i] = commandHash[hash];
+    commandHash[hash] = i + 1;
+  }
+}
+
 
 void Item_RunScript(itemDef_t *item, const char *s) {
   char script[1024], *p;
@@ -1326,9 +1989,9 @@ void Item_RunScript(itemDef_t *item, const char *s) {
       }
 
       bRan = qfalse;
-      for (i = 0; i < scriptCommandCount; i++) {
-        if (Q_stricmp(command, commandList[i].name) == 0) {
-          (commandList[i].handler(item, &p));
+      for (i = commandHash[KeywordHash_Key(command) & (COMMANDHASH_SIZE-1)]; i; i = commandHashNext[i - 1]) {
+        if (Q_stricmp(command, commandList[i - 1].name) == 0) {
+          (commandList[i - 1].handler(item, &p));
           bRan = qtrue;
           break;
         }
@@ -1342,40 +2005,70 @@ void Item_RunScript(itemDef_t *item, const char *s) {
 }
 
 
-qboolean Item_EnableShowViaCvar(itemDef_t *item, int flag) {
+/*
+===============
+Item_TestCvarValue
+===============
+*/
+static qboolean Item_TestCvarValue(itemDef_t *item, int flag, const char *buff) {
   char script[1024], *p;
-  memset(script, 0, sizeof(script));
+  const char *val;
+
+  Q_strncpyz(script, item->enableCvar, sizeof(script));
+  p = script;
+  while (1) {
+    // expect value then ; or NULL, NULL ends list
+    if (!String_Parse(&p, &val)) {
+      return (item->cvarFlags & flag) ? qfalse : qtrue;
+    }
+
+    if (val[0] == ';' && val[1] == '\0') {
+      continue;
+    }
+
+    // enable it if any of the values are true, disable it for a
+    // disable or hide list
+    if (Q_stricmp(buff, val) == 0) {
+      return (item->cvarFlags & flag) ? qtrue : qfalse;
+    }
+  }
+}
+
+/*
+===============
+Item_EnableShowViaCvar
+
+The value list is only parsed again once the cvar changes, this runs
+for every item with one on each frame and mouse move
+===============
+*/
+qboolean Item_EnableShowViaCvar(itemDef_t *item, int flag) {
   if (item && item->enableCvar && *item->enableCvar && item->cvarTest && *item->cvarTest) {
 		char buff[1024];
-	  DC->getCVarString(item->cvarTest, buff, sizeof(buff));
+		qboolean passed;
 
-    Q_strcat(script, 1024, item->enableCvar);
-    p = script;
-    while (1) {
-      const char *val;
-      // expect value then ; or NULL, NULL ends list
-      if (!String_Parse(&p, &val)) {
-				return (item->cvarFlags & flag) ? qfalse : qtrue;
-      }
+	  DC->getCVarString(item->cvarTest, buff, sizeof(buff));
 
-      if (val[0] == ';' && val[1] == '\0') {
-        continue;
-      }
+		if (strlen(buff) >= sizeof(item->cvarTestValue)) {
+			item->cvarTestKnown = 0;
+			return Item_TestCvarValue(item, flag, buff);
+		}
 
-			// enable it if any of the values are true
-			if (item->cvarFlags & flag) {
-        if (Q_stricmp(buff, val) == 0) {
-					return qtrue;
-				}
-			} else {
-				// disable it if any of the values are true
-        if (Q_stricmp(buff, val) == 0) {
-					return qfalse;
-				}
-			}
+		if (strcmp(buff, item->cvarTestValue)) {
+			Q_strncpyz(item->cvarTestValue, buff, sizeof(item->cvarTestValue));
+			item->cvarTestKnown = 0;
+		} else if (item->cvarTestKnown & flag) {
+			return (item->cvarTestPassed & flag) ? qtrue : qfalse;
+		}
 
-    }
-		return (item->cvarFlags & flag) ? qfalse : qtrue;
+		passed = Item_TestCvarValue(item, flag, buff);
+		item->cvarTestKnown |= flag;
+		if (passed) {
+			item->cvarTestPassed |= flag;
+		} else {
+			item->cvarTestPassed &= ~flag;
+		}
+		return passed;
   }
 	return qtrue;
 }
@@ -1732,9 +2425,12 @@ void Item_MouseLeave(itemDef_t *item) {
 }
 
 itemDef_t *Menu_HitTest(menuDef_t *menu, float x, float y) {
+  const unsigned *cell;
   int i;
+
+  cell = Menu_HitCell(menu, x, y);
   for (i = 0; i < menu->itemCount; i++) {
-    if (Rect_ContainsPoint(&menu->items[i]->window.rect, x, y)) {
+    if (HitCell_HasItem(cell, i) && Rect_ContainsPoint(&menu->items[i]->window.rect, x, y)) {
       return menu->items[i];
     }
   }
@@ -4295,6 +4991,7 @@ void Item_Init(itemDef_t *item) {
 void Menu_HandleMouseMove(menuDef_t *menu, float x, float y) {
   int i, pass;
   qboolean focusSet = qfalse;
+  const unsigned *cell;
 
   itemDef_t *overItem;
   if (menu == NULL) {
@@ -4314,6 +5011,8 @@ void Menu_HandleMouseMove(menuDef_t *menu, float x, float y) {
 		return;
 	}
 
+  cell = Menu_HitCell(menu, x, y);
+
   // FIXME: this is the whole issue of focus vs. mouse over.. 
   // need a better overall solution as i don't like going through everything twice
   for (pass = 0; pass < 2; pass++) {
@@ -4321,6 +5020,11 @@ void Menu_HandleMouseMove(menuDef_t *menu, float x, float y) {
       // turn off focus each item
       // menu->items[i].window.flags &= ~WINDOW_HASFOCUS;
 
+      // nowhere near the cursor, only a mouse over to end
+      if (!HitCell_HasItem(cell, i) && !(menu->items[i]->window.flags & WINDOW_MOUSEOVER)) {
+        continue;
+      }
+
       if (!(menu->items[i]->window.flags & (WINDOW_VISIBLE | WINDOW_FORCED))) {
         continue;
       }
@@ -4452,7 +5156,7 @@ typedef struct keywordHash_s
 	struct keywordHash_s *next;
 } keywordHash_t;
 
-int KeywordHash_Key(char *keyword) {
+int KeywordHash_Key(const char *keyword) {
 	int hash, i;
 
 	hash = 0;
@@ -5062,7 +5766,7 @@ qboolean ItemParse_cvarStrList( itemDef_t *item, int handle ) {
 	multiPtr->strDef = qtrue;
 	multiPtr->videoMode = qfalse;
 
-	if (!trap_PC_ReadToken(handle, &token))
+	if (!PC_ReadToken(handle, &token))
 		return qfalse;
 	if (*token.string != '{') {
 		return qfalse;
@@ -5070,7 +5774,7 @@ qboolean ItemParse_cvarStrList( itemDef_t *item, int handle ) {
 
 	pass = 0;
 	while ( 1 ) {
-		if (!trap_PC_ReadToken(handle, &token)) {
+		if (!PC_ReadToken(handle, &token)) {
 			PC_SourceError(handle, "end of file inside menu item");
 			return qfalse;
 		}
@@ -5111,14 +5815,14 @@ qboolean ItemParse_cvarFloatList( itemDef_t *item, int handle ) {
 	multiPtr->strDef = qfalse;
 	multiPtr->videoMode = qfalse;
 
-	if (!trap_PC_ReadToken(handle, &token))
+	if (!PC_ReadToken(handle, &token))
 		return qfalse;
 	if (*token.string != '{') {
 		return qfalse;
 	}
 
 	while ( 1 ) {
-		if (!trap_PC_ReadToken(handle, &token)) {
+		if (!PC_ReadToken(handle, &token)) {
 			PC_SourceError(handle, "end of file inside menu item");
 			return qfalse;
 		}
@@ -5470,13 +6174,13 @@ qboolean Item_Parse(int handle, itemDef_t *item) {
 	keywordHash_t *key;
 
 
-	if (!trap_PC_ReadToken(handle, &token))
+	if (!PC_ReadToken(handle, &token))
 		return qfalse;
 	if (*token.string != '{') {
 		return qfalse;
 	}
 	while ( 1 ) {
-		if (!trap_PC_ReadToken(handle, &token)) {
+		if (!PC_ReadToken(handle, &token)) {
 			PC_SourceError(handle, "end of file inside menu item");
 			return qfalse;
 		}
@@ -5881,7 +6585,7 @@ qboolean Menu_Parse(int handle, menuDef_t *menu) {
 	pc_token_t token;
 	keywordHash_t *key;
 
-	if (!trap_PC_ReadToken(handle, &token))
+	if (!PC_ReadToken(handle, &token))
 		return qfalse;
 	if (*token.string != '{') {
 		return qfalse;
@@ -5890,7 +6594,7 @@ qboolean Menu_Parse(int handle, menuDef_t *menu) {
 	while ( 1 ) {
 
 		memset(&token, 0, sizeof(pc_token_t));
-		if (!trap_PC_ReadToken(handle, &token)) {
+		if (!PC_ReadToken(handle, &token)) {
 			PC_SourceError(handle, "end of file inside menu");
 			return qfalse;
 		}
@@ -5924,6 +6628,7 @@ void Menu_New(int handle) {
 		Menu_Init(menu);
 		if (Menu_Parse(handle, menu)) {
 			Menu_PostParse(menu);
+			Menus_AddToHash(menuCount);
 			menuCount++;
 		}
 	}
@@ -5951,6 +6656,7 @@ void Menu_PaintAll(void) {
 
 void Menu_Reset(void) {
 	menuCount = 0;
+	memset(menuHash, 0, sizeof(menuHash));
 }
 
 displayContextDef_t *Display_GetContext(void) {
@@ -6069,11 +6775,16 @@ void Display_CacheAll(void) {
 static qboolean Menu_OverActiveItem(menuDef_t *menu, float x, float y) {
  	if (menu && menu->window.flags & (WINDOW_VISIBLE | WINDOW_FORCED)) {
 		if (Rect_ContainsPoint(&menu->window.rect, x, y)) {
+			const unsigned *cell = Menu_HitCell(menu, x, y);
 			int i;
 			for (i = 0; i < menu->itemCount; i++) {
 				// turn off focus each item
 				// menu->items[i].window.flags &= ~WINDOW_HASFOCUS;
 
+				if (!HitCell_HasItem(cell, i)) {
+					continue;
+				}
+
 				if (!(menu->items[i]->window.flags & (WINDOW_VISIBLE | WINDOW_FORCED))) {
 					continue;
 				}
@@ -243,6 +243,9 @@ typedef struct itemDef_s {
   const char *cvarTest;          // associated cvar for enable actions
 	const char *enableCvar;			   // enable, disable, show, or hide based on value, this can contain a list
 	int cvarFlags;								 //	what type of action to take on cvarenables
+	char cvarTestValue[32];				 // cvarTest value the cached enable/show results are for
+	int cvarTestKnown;						 // CVAR_ENABLE and/or CVAR_SHOW, results cached for it
+	int cvarTestPassed;						 // those of them that passed
   sfxHandle_t focusSound;
 	int numColors;								 // number of color ranges
 	colorRangeDef_t colorRanges[MAX_COLOR_RANGES];
@@ -251,6 +254,20 @@ typedef struct itemDef_s {
 	void *typeData;								 // type specific data ptr's	
 } itemDef_t;
 
+#define ITEMHASH_SIZE 32
+
+// the 640x480 screen split in cells for hit testing
+#define HITGRID_CELLSIZE 80
+#define HITGRID_COLS (640 / HITGRID_CELLSIZE)
+#define HITGRID_ROWS (480 / HITGRID_CELLSIZE)
+
+typedef struct itemLink_s {
+  itemDef_t *item;
+  const char *key;               // the item's name or its group
+  qboolean group;
+  struct itemLink_s *next;
+} itemLink_t;
+
 typedef struct {
   Window window;
   const char  *font;								// font
@@ -269,6 +286,9 @@ typedef struct {
   vec4_t focusColor;								// focus color for items
   vec4_t disableColor;							// focus color for items
   itemDef_t *items[MAX_MENUITEMS];	// items this menu contains   
+  itemLink_t *itemHash[ITEMHASH_SIZE];	// items by name and group, in menu order
+  unsigned hitGrid[HITGRID_COLS * HITGRID_ROWS][(MAX_MENUITEMS + 31) / 32];	// items whose rect reaches into each cell
+  qboolean hitGridDirty;						// an item rect moved since the grid was built
 } menuDef_t;
 
 typedef struct {
@@ -426,6 +446,7 @@ int Display_CursorType(int x, int y);
 qboolean Display_KeyBindPending( void );
 void Menus_OpenByName(const char *p);
 menuDef_t *Menus_FindByName(const char *p);
+int Menu_ItemsMatching(menuDef_t *menu, const char *p, itemDef_t **items);
 void Menus_ShowByName(const char *p);
 void Menus_CloseByName(const char *p);
 void Display_HandleKey(int key, qboolean down, int x, int y);
@@ -449,4 +470,15 @@ int			trap_PC_FreeSource( int handle );
 int			trap_PC_ReadToken( int handle, pc_token_t *pc_token );
 int			trap_PC_SourceFileAndLine( int handle, char *filename, int *line );
 
+int			trap_FS_FOpenFile( const char *qpath, fileHandle_t *f, fsMode_t mode );
+void		trap_FS_Read( void *buffer, int len, fileHandle_t f );
+void		trap_FS_Write( const void *buffer, int len, fileHandle_t f );
+void		trap_FS_FCloseFile( fileHandle_t f );
+int			trap_FS_Seek( fileHandle_t f, long offset, int origin ); // fsOrigin_t
+
+int			PC_LoadSource( const char *filename );
+int			PC_FreeSource( int handle );
+int			PC_ReadToken( int handle, pc_token_t *pc_token );
+int			PC_SourceFileAndLine( int handle, char *filename, int *line );
+
 #endif
@@ -63,6 +63,10 @@ void trap_Cvar_Update( vmCvar_t *cvar ) {
 	syscall( UI_CVAR_UPDATE, cvar );
 }
 
+int trap_Cvar_UpdateChanged( void ) {
+	return syscall( UI_CVAR_UPDATE_CHANGED );
+}
+
 void trap_Cvar_Set( const char *var_name, const char *value ) {
 	syscall( UI_CVAR_SET, var_name, value );
 }